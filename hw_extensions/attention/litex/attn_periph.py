@@ -0,0 +1,98 @@
+# Attention engine — LiteX CSR wrapper.
+#
+# Integrates attn_core (Verilog) into a LiteX SoC via the CSR bus.
+# START and CLEAR are one-cycle pulses (CTRL write with the bit set); FAST and CAUSAL are
+# stored config. SHAPE holds S (tokens), D (channels) and the head_dim of the next run; D is
+# also the row length of the Q_IN4 / K_IN4 / V_IN4 streams, so write it before loading.
+# CTX_OUT returns four int8 context values (lane 0 = bits 7:0); writing CTX_NEXT advances by
+# one word, as GEMV's Y_NEXT (reads have no side effects).
+# clock_gate=True (or "bufgce"; "latch" for simulation and other targets) clocks the core from
+# a gated copy of sys_clk (gemv/rtl/clk_gate.v), as GEMVPeripheral: CLK_EN (reset 1) turns it
+# on, 0 stops it once no run is busy, STATUS[2] (clk_on) reads whether it runs. Q/K/V, the
+# context and CYCLES are kept while it is off (ATTN_CLOCK_GATE firmware).
+#
+# Usage (in your SoC target):
+#   self.submodules.attn = AttnPeripheral()
+#   self.add_csr("attn")
+#   self.add_source("path/to/rtl/attn_core.v")
+#   self.add_source("path/to/exp_lut/exp_lut.v")    # the engine's exp table
+#   self.add_source("path/to/gemv/rtl/clk_gate.v")  # clock_gate only
+
+from migen import *
+from litex.soc.interconnect.csr import AutoCSR, CSRStorage, CSRStatus
+
+
+class AttnPeripheral(Module, AutoCSR):
+    """LiteX peripheral for attn_core. CTRL, SHAPE, CFG, STATUS, Q_IN4, K_IN4, V_IN4, CTX_OUT,
+    CTX_NEXT, CYCLES (+ CLK_EN with clock_gate)."""
+
+    def __init__(self, s_max=16, d_max=64, clock_gate=False):
+        assert s_max <= 32 and d_max % 4 == 0 and d_max <= 128
+        assert clock_gate in (False, True, "bufgce", "latch")
+
+        # --- CTRL: [0]=start (pulse), [1]=clear (pulse), [2]=fast, [3]=causal (stored config) ---
+        self.ctrl = CSRStorage(4, name="ctrl")
+        # --- SHAPE: [5:0]=S, [15:8]=D, [23:16]=head_dim ---
+        self.shape = CSRStorage(24, name="shape", description="S tokens, D channels, head_dim of the next run")
+        # --- CFG: [4:0]=score_shift (arithmetic right shift of each score) ---
+        self.cfg = CSRStorage(5, reset=5, name="cfg", description="Score shift (TinyFormer: 5)")
+        self.status = CSRStatus(3 if clock_gate else 2, name="status")  # [0]=busy, [1]=done — combinational from core, [2]=clk_on
+
+        # --- Packed stream registers: 4 int8 lanes per write, lane 0 in bits [7:0] ---
+        self.q_in4 = CSRStorage(32, name="q_in4", description="Write next 4 int8 Q values, row-major (lane 0 = LSB)")
+        self.k_in4 = CSRStorage(32, name="k_in4", description="Write next 4 int8 K values, row-major (lane 0 = LSB)")
+        self.v_in4 = CSRStorage(32, name="v_in4", description="Write next 4 int8 V values, row-major (lane 0 = LSB)")
+
+        self.ctx_out = CSRStatus(32, name="ctx_out", description="Read 4 int8 context values at current index (lane 0 = LSB)")
+        self.ctx_next = CSRStorage(1, name="ctx_next", description="Write to advance the context read pointer by one word (pulse)")
+        self.cycles = CSRStatus(32, name="cycles", description="Busy cycles of the last run")
+
+        # --- Core signals ---
+        self.busy = Signal()
+        self.done = Signal()
+
+        # --- Core clock: sys_clk, or its gated copy (CLK_EN, held on while a run is busy) ---
+        core_clk = ClockSignal()
+        clk_on = Signal()
+        if clock_gate:
+            self.clk_en = CSRStorage(1, reset=1, name="clk_en",
+                description="1: core clock on; 0: off once no run is busy")
+            core_clk = Signal()
+            self.specials += Instance(
+                "clk_gate",
+                p_BUFGCE=int(clock_gate != "latch"),
+                i_clk=ClockSignal(),
+                i_reset=ResetSignal(),
+                i_en=self.clk_en.storage | self.busy,
+                o_gclk=core_clk,
+                o_on=clk_on,
+            )
+
+        self.specials += Instance(
+            "attn_core",
+            p_S_MAX=s_max,
+            p_D_MAX=d_max,
+            i_clk=core_clk,
+            i_reset=ResetSignal(),
+            i_q_wr_en=self.q_in4.re,
+            i_q_wr_data=self.q_in4.dat_w,
+            i_k_wr_en=self.k_in4.re,
+            i_k_wr_data=self.k_in4.dat_w,
+            i_v_wr_en=self.v_in4.re,
+            i_v_wr_data=self.v_in4.dat_w,
+            i_s_dim=self.shape.storage[0:6],
+            i_d_dim=self.shape.storage[8:16],
+            i_hd_dim=self.shape.storage[16:24],
+            i_score_shift=self.cfg.storage,
+            i_fast=self.ctrl.storage[2],
+            i_causal=self.ctrl.storage[3],
+            # START and CLEAR: one-cycle pulses when CTRL is written with the bit set
+            i_start=self.ctrl.re & self.ctrl.dat_w[0],
+            i_clear=self.ctrl.re & self.ctrl.dat_w[1],
+            o_busy=self.busy,
+            o_done=self.done,
+            o_cycles=self.cycles.status,
+            i_ctx_rd_en=self.ctx_next.re,
+            o_ctx_rd_data=self.ctx_out.status,
+        )
+        self.comb += self.status.status.eq(Cat(self.busy, self.done, clk_on))
@@ -0,0 +1,416 @@
+/*
+ * Attention engine: context = softmax(Q K^T >> shift) V for every query and
+ * head of one encoder block, from Q, K and V held in local memory.
+ * Bit-exact with attention_multi_head() in litex_port/common/tinyformer.c
+ * (two-pass softmax), per query i and head h (channels h0 .. h0 + hd):
+ *   s_j    = dot(Q[i][h], K[j][h]) >>> score_shift     (j < n; TinyFormer: 5)
+ *   idx_j  = min(-((s_j - max_j s_j) >>> 3), 15)
+ *   e_j    = lut[idx_j]                                 (Q10, exp_lut.v)
+ *   w_j    = (e_j << 15) / sum_j e_j                    (fast = 0)
+ *   w_j    = (e_j * (2^31 / sum_j e_j)) >> 16           (fast = 1, FAST_SOFTMAX)
+ *   ctx[d] = sat8(sum_j ((w_j * V[j][d]) >>> 15))
+ * with n = S, or i + 1 keys when causal.
+ * CSR-fed: the wrapper pushes Q, K and V through packed write ports
+ * (4 int8 lanes per write, lane 0 = bits 7:0, row-major [S][D]), pulses
+ * start, and reads the int8 context back four channels per word.
+ * Per query and head: the scores take n * hd / 4 + 2 cycles (4 MACs per
+ * cycle), the exps n + 1, the normalize 17 + 17 per LUT entry the row uses
+ * (as softmax_core, one division per entry rather than per key; fast:
+ * 33 + 16), the context n * hd / 4 + 2 (4 channels per cycle), plus one.
+ */
+
+module attn_core #(
+    parameter S_MAX = 16,    /* tokens (queries and keys) */
+    parameter D_MAX = 64     /* channels, multiple of 4 */
+) (
+    input  wire         clk,
+    input  wire         reset,
+
+    /* Packed write ports (driven by wrapper when CPU writes Q_IN4, K_IN4,
+     * V_IN4): row-major [S][D], row length d_dim */
+    input  wire         q_wr_en,
+    input  wire [31:0]  q_wr_data,
+    input  wire         k_wr_en,
+    input  wire [31:0]  k_wr_data,
+    input  wire         v_wr_en,
+    input  wire [31:0]  v_wr_data,
+
+    /* Shape and config (from SHAPE, CFG and CTRL; hold while busy) */
+    input  wire [5:0]   s_dim,       /* 1..S_MAX tokens */
+    input  wire [7:0]   d_dim,       /* 4..D_MAX channels, multiple of 4 */
+    input  wire [7:0]   hd_dim,      /* head_dim: divides d_dim, multiple of 4 */
+    input  wire [4:0]   score_shift, /* arithmetic right shift of each score */
+    input  wire         fast,        /* reciprocal-multiply normalize */
+    input  wire         causal,      /* query i attends keys 0 .. i */
+
+    /* Control (from CTRL) */
+    input  wire         start,
+    input  wire         clear,       /* clear done, rewind the write and read pointers */
+
+    /* Status */
+    output reg          busy,
+    output reg          done,
+    output reg  [31:0]  cycles,      /* busy cycles of the last run */
+
+    /* Context read port: 4 int8 at the read index (row-major [S][D]);
+     * ctx_rd_en advances by one word */
+    input  wire         ctx_rd_en,
+    output wire [31:0]  ctx_rd_data
+);
+
+    localparam DW     = D_MAX / 4;          /* words per row */
+    localparam WORDS  = S_MAX * DW;
+    localparam S_BITS = $clog2(S_MAX) + 1;  /* counts 0 .. S_MAX */
+
+    reg [31:0] q_mem   [0:WORDS-1];
+    reg [31:0] k_mem   [0:WORDS-1];
+    reg [31:0] v_mem   [0:WORDS-1];
+    reg [31:0] ctx_mem [0:WORDS-1];
+
+    reg signed [31:0] s_mem   [0:S_MAX-1];  /* shifted scores of the row */
+    reg [3:0]         idx_mem [0:S_MAX-1];  /* LUT index of each key */
+    reg [15:0]        w_tab   [0:15];       /* Q15 weight of each LUT entry */
+
+    wire [7:0] d_words  = d_dim >> 2;
+    wire [7:0] hd_words = hd_dim >> 2;
+
+    /* --- Write and read pointers: (row, word), the word wrapping at d_dim / 4 --- */
+    reg [S_BITS-1:0] q_wr_r, k_wr_r, v_wr_r, ctx_rd_r;
+    reg [7:0]        q_wr_w, k_wr_w, v_wr_w, ctx_rd_w;
+    wire q_wr_ok = q_wr_en && !busy && q_wr_r < S_MAX;
+    wire k_wr_ok = k_wr_en && !busy && k_wr_r < S_MAX;
+    wire v_wr_ok = v_wr_en && !busy && v_wr_r < S_MAX;
+
+    always @(posedge clk) begin
+        if (q_wr_ok) q_mem[q_wr_r * DW + q_wr_w] <= q_wr_data;
+        if (k_wr_ok) k_mem[k_wr_r * DW + k_wr_w] <= k_wr_data;
+        if (v_wr_ok) v_mem[v_wr_r * DW + v_wr_w] <= v_wr_data;
+    end
+
+    always @(posedge clk) begin
+        if (reset || (clear && !busy)) begin
+            q_wr_r <= 0;  q_wr_w <= 0;
+            k_wr_r <= 0;  k_wr_w <= 0;
+            v_wr_r <= 0;  v_wr_w <= 0;
+            ctx_rd_r <= 0;  ctx_rd_w <= 0;
+        end else begin
+            if (q_wr_ok) begin
+                if (q_wr_w + 8'd1 >= d_words) begin q_wr_w <= 0; q_wr_r <= q_wr_r + 1'b1; end
+                else q_wr_w <= q_wr_w + 8'd1;
+            end
+            if (k_wr_ok) begin
+                if (k_wr_w + 8'd1 >= d_words) begin k_wr_w <= 0; k_wr_r <= k_wr_r + 1'b1; end
+                else k_wr_w <= k_wr_w + 8'd1;
+            end
+            if (v_wr_ok) begin
+                if (v_wr_w + 8'd1 >= d_words) begin v_wr_w <= 0; v_wr_r <= v_wr_r + 1'b1; end
+                else v_wr_w <= v_wr_w + 8'd1;
+            end
+            if (ctx_rd_en && !busy) begin
+                if (ctx_rd_w + 8'd1 >= d_words) begin ctx_rd_w <= 0; ctx_rd_r <= ctx_rd_r + 1'b1; end
+                else ctx_rd_w <= ctx_rd_w + 8'd1;
+            end
+        end
+    end
+
+    assign ctx_rd_data = ctx_mem[ctx_rd_r * DW + ctx_rd_w];
+
+    /* --- Loop state: query qi, head channel h0 (in words: h0w), key j, word w --- */
+    localparam [3:0] S_IDLE   = 4'd0,
+                     S_SCORE  = 4'd1,
+                     S_EXP    = 4'd2,
+                     S_LOAD   = 4'd3,   /* next used LUT entry for the divider */
+                     S_DIV    = 4'd4,
+                     S_RECIP  = 4'd5,
+                     S_MUL    = 4'd6,
+                     S_CTX    = 4'd7,
+                     S_NEXT   = 4'd8,
+                     S_DONE   = 4'd9;
+    reg [3:0]        state;
+    reg [S_BITS-1:0] qi;
+    reg [7:0]        h0w;
+    reg [S_BITS-1:0] j;          /* issue: key */
+    reg [7:0]        w;          /* issue: word of the head */
+    reg              iss_done;   /* every word of the phase issued */
+    wire [S_BITS-1:0] n_keys = causal ? qi + 1'b1 : s_dim[S_BITS-1:0];
+    wire             iss_last_w = (w + 8'd1 >= hd_words);
+    wire             iss_last_j = (j + 1'b1 >= n_keys);
+
+    /* Registered memory reads, one stage behind the issue */
+    reg [31:0]       q_q, k_q, v_q;
+    reg              p_vld;      /* data stage holds a word */
+    reg              p_last;     /* last word of a score / last key of a context word */
+    reg [S_BITS-1:0] p_j;
+    reg [7:0]        p_w;
+
+    always @(posedge clk) begin
+        q_q <= q_mem[qi * DW + h0w + w];
+        k_q <= k_mem[j * DW + h0w + w];
+        v_q <= v_mem[j * DW + h0w + w];
+    end
+
+    /* --- Score stage: 4 int8 MACs per cycle --- */
+    wire signed [15:0] qk0 = $signed(q_q[7:0])   * $signed(k_q[7:0]);
+    wire signed [15:0] qk1 = $signed(q_q[15:8])  * $signed(k_q[15:8]);
+    wire signed [15:0] qk2 = $signed(q_q[23:16]) * $signed(k_q[23:16]);
+    wire signed [15:0] qk3 = $signed(q_q[31:24]) * $signed(k_q[31:24]);
+    reg  signed [31:0] s_acc;
+    wire signed [31:0] s_sum   = s_acc + qk0 + qk1 + qk2 + qk3;
+    wire signed [31:0] s_shr   = s_sum >>> score_shift;
+    reg  signed [31:0] max_score;
+
+    /* --- Exps: LUT index of key j, s_j <= max --- */
+    wire signed [31:0] s_diff = s_mem[j] - max_score;
+    wire signed [31:0] s_neg  = -(s_diff >>> 3);
+    wire [3:0]         e_idx  = (s_neg > 15) ? 4'd15 : s_neg[3:0];
+    wire [15:0]        e_val;
+    reg  [31:0]        sum_exp;
+    reg  [15:0]        used;     /* LUT entries the row uses */
+
+    exp_lut u_lut_e (
+        .clk(clk),
+        .reset(reset),
+        .index({1'b0, e_idx}),
+        .value(e_val)
+    );
+
+    /* --- Normalize, one restoring division per LUT entry (as softmax_core) --- */
+    reg [31:0]  div_rem;
+    reg [31:0]  div_num;
+    reg [31:0]  div_q;
+    reg [5:0]   div_cnt;
+    reg [4:0]   tab_i;
+    reg [31:0]  recip;
+    wire [15:0] t_val;
+    wire [31:0] div_den = (sum_exp == 32'd0) ? 32'd1 : sum_exp;
+    wire [32:0] rem_s   = {div_rem, div_num[31]};
+    wire        rem_ge  = (rem_s >= {1'b0, div_den});
+    wire [32:0] rem_sub = rem_s - {1'b0, div_den};
+    wire [31:0] rem_nx  = rem_ge ? rem_sub[31:0] : rem_s[31:0];
+    wire [31:0] w_prod  = {16'd0, t_val} * recip;
+
+    exp_lut u_lut_t (
+        .clk(clk),
+        .reset(reset),
+        .index({1'b0, tab_i[3:0]}),
+        .value(t_val)
+    );
+
+    /* --- Context stage: 4 channels per cycle, one >>> 15 per term --- */
+    wire [15:0]        p_wt = w_tab[idx_mem[p_j]];
+    wire signed [16:0] p_ws = {1'b0, p_wt};
+    reg  signed [31:0] c_acc [0:3];
+    wire signed [31:0] c_sum [0:3];
+    wire [7:0]         c_sat [0:3];
+    genvar l;
+    generate
+        for (l = 0; l < 4; l = l + 1) begin : g_ctx
+            wire signed [24:0] prod = p_ws * $signed(v_q[8*l +: 8]);
+            assign c_sum[l] = c_acc[l] + (prod >>> 15);
+            assign c_sat[l] = (c_sum[l] > 127)  ? 8'sd127 :
+                              (c_sum[l] < -128) ? -8'sd128 : c_sum[l][7:0];
+        end
+    endgenerate
+
+    integer e;
+    always @(posedge clk) begin
+        if (reset) begin
+            state     <= S_IDLE;
+            busy      <= 1'b0;
+            done      <= 1'b0;
+            cycles    <= 32'd0;
+            qi        <= 0;
+            h0w       <= 8'd0;
+            j         <= 0;
+            w         <= 8'd0;
+            iss_done  <= 1'b0;
+            p_vld     <= 1'b0;
+            p_last    <= 1'b0;
+            p_j       <= 0;
+            p_w       <= 8'd0;
+            s_acc     <= 32'sd0;
+            max_score <= 32'sd0;
+            sum_exp   <= 32'd0;
+            used      <= 16'd0;
+            div_rem   <= 32'd0;
+            div_num   <= 32'd0;
+            div_q     <= 32'd0;
+            div_cnt   <= 6'd0;
+            tab_i     <= 5'd0;
+            recip     <= 32'd0;
+            for (e = 0; e < 4; e = e + 1) c_acc[e] <= 32'sd0;
+        end else begin
+            if (busy)
+                cycles <= cycles + 32'd1;
+
+            case (state)
+                S_IDLE, S_DONE: begin
+                    if (start && !busy) begin
+                        busy     <= 1'b1;
+                        done     <= 1'b0;
+                        cycles   <= 32'd0;
+                        qi       <= 0;
+                        h0w      <= 8'd0;
+                        j        <= 0;
+                        w        <= 8'd0;
+                        iss_done <= 1'b0;
+                        s_acc    <= 32'sd0;
+                        state    <= S_SCORE;
+                    end else if (clear) begin
+                        done  <= 1'b0;
+                        state <= S_IDLE;
+                    end
+                end
+
+                /* Issue Q[qi] / K[j] word w; accumulate the word issued last cycle */
+                S_SCORE: begin
+                    p_vld  <= !iss_done;
+                    p_last <= iss_last_w;
+                    p_j    <= j;
+                    if (!iss_done) begin
+                        if (iss_last_w) begin
+                            w <= 8'd0;
+                            if (iss_last_j) iss_done <= 1'b1;
+                            else j <= j + 1'b1;
+                        end else
+                            w <= w + 8'd1;
+                    end
+                    if (p_vld) begin
+                        if (p_last) begin
+                            s_mem[p_j] <= s_shr;
+                            if (p_j == 0 || s_shr > max_score)
+                                max_score <= s_shr;
+                            s_acc <= 32'sd0;
+                        end else
+                            s_acc <= s_sum;
+                    end else if (iss_done) begin
+                        j       <= 0;
+                        sum_exp <= 32'd0;
+                        used    <= 16'd0;
+                        state   <= S_EXP;
+                    end
+                end
+
+                S_EXP: begin
+                    if (j < n_keys) begin
+                        idx_mem[j]    <= e_idx;
+                        sum_exp       <= sum_exp + {16'd0, e_val};
+                        used[e_idx]   <= 1'b1;
+                        j             <= j + 1'b1;
+                    end else begin
+                        tab_i <= 5'd0;
+                        div_q <= 32'd0;
+                        if (fast) begin
+                            div_rem <= 32'd0;
+                            div_num <= 32'h80000000;
+                            div_cnt <= 6'd32;
+                            state   <= S_RECIP;
+                        end else
+                            state   <= S_LOAD;
+                    end
+                end
+
+                /* (e << 15) / sum, 16 quotient bits from e >> 1; unused entries skip */
+                S_LOAD: begin
+                    if (tab_i == 5'd16) begin
+                        j        <= 0;
+                        w        <= 8'd0;
+                        iss_done <= 1'b0;
+                        state    <= S_CTX;
+                    end else if (used[tab_i[3:0]]) begin
+                        div_rem <= {17'd0, t_val[15:1]};
+                        div_num <= {t_val[0], 31'd0};
+                        div_q   <= 32'd0;
+                        div_cnt <= 6'd16;
+                        state   <= S_DIV;
+                    end else
+                        tab_i <= tab_i + 1'b1;
+                end
+
+                S_DIV: begin
+                    if (div_cnt != 6'd0) begin
+                        div_rem <= rem_nx;
+                        div_num <= {div_num[30:0], 1'b0};
+                        div_q   <= {div_q[30:0], rem_ge};
+                        div_cnt <= div_cnt - 1'b1;
+                    end else begin
+                        w_tab[tab_i[3:0]] <= div_q[15:0];
+                        tab_i <= tab_i + 1'b1;
+                        state <= S_LOAD;
+                    end
+                end
+
+                S_RECIP: begin
+                    if (div_cnt != 6'd0) begin
+                        div_rem <= rem_nx;
+                        div_num <= {div_num[30:0], 1'b0};
+                        div_q   <= {div_q[30:0], rem_ge};
+                        div_cnt <= div_cnt - 1'b1;
+                    end else begin
+                        recip <= div_q;
+                        tab_i <= 5'd0;
+                        state <= S_MUL;
+                    end
+                end
+
+                S_MUL: begin
+                    w_tab[tab_i[3:0]] <= w_prod[31:16];
+                    if (tab_i == 5'd15) begin
+                        j        <= 0;
+                        w        <= 8'd0;
+                        iss_done <= 1'b0;
+                        state    <= S_CTX;
+                    end else
+                        tab_i <= tab_i + 1'b1;
+                end
+
+                /* Issue V[j] word w (keys inner); accumulate the word issued last cycle */
+                S_CTX: begin
+                    p_vld  <= !iss_done;
+                    p_last <= iss_last_j;
+                    p_j    <= j;
+                    p_w    <= w;
+                    if (!iss_done) begin
+                        if (iss_last_j) begin
+                            j <= 0;
+                            if (iss_last_w) iss_done <= 1'b1;
+                            else w <= w + 8'd1;
+                        end else
+                            j <= j + 1'b1;
+                    end
+                    if (p_vld) begin
+                        if (p_last) begin
+                            ctx_mem[qi * DW + h0w + p_w] <= {c_sat[3], c_sat[2], c_sat[1], c_sat[0]};
+                            for (e = 0; e < 4; e = e + 1) c_acc[e] <= 32'sd0;
+                        end else
+                            for (e = 0; e < 4; e = e + 1) c_acc[e] <= c_sum[e];
+                    end else if (iss_done)
+                        state <= S_NEXT;
+                end
+
+                /* Next head, else next query, else done */
+                S_NEXT: begin
+                    j        <= 0;
+                    w        <= 8'd0;
+                    iss_done <= 1'b0;
+                    s_acc    <= 32'sd0;
+                    if (h0w + hd_words < d_words) begin
+                        h0w   <= h0w + hd_words;
+                        state <= S_SCORE;
+                    end else if (qi + 1'b1 < s_dim) begin
+                        h0w   <= 8'd0;
+                        qi    <= qi + 1'b1;
+                        state <= S_SCORE;
+                    end else begin
+                        busy  <= 1'b0;
+                        done  <= 1'b1;
+                        state <= S_DONE;
+                    end
+                end
+
+                default: state <= S_IDLE;
+            endcase
+        end
+    end
+
+endmodule
@@ -0,0 +1,246 @@
+/*
+ * Attention engine driver. Polling only.
+ * USE_ATTN_HW: ATTN_USE_LITEX_CSR + generated/csr.h, or ATTN_BASE / attn_init() for raw
+ * MMIO. Without USE_ATTN_HW the calls run the C reference below, the two-pass attention
+ * of tinyformer.c (same results as the block).
+ */
+
+#include "attn.h"
+#if defined(USE_ATTN_HW) && defined(ATTN_USE_LITEX_CSR)
+#  include <generated/csr.h>
+#endif
+
+#if defined(USE_ATTN_HW)
+#  if defined(ATTN_USE_LITEX_CSR)
+#    define ATTN_WRITE_CTRL(v)      attn_ctrl_write((uint32_t)(v))
+#    define ATTN_WRITE_SHAPE(v)     attn_shape_write((uint32_t)(v))
+#    define ATTN_WRITE_CFG(v)       attn_cfg_write((uint32_t)(v))
+#    define ATTN_READ_STATUS()      attn_status_read()
+#    define ATTN_WRITE_Q4(v)        attn_q_in4_write((uint32_t)(v))
+#    define ATTN_WRITE_K4(v)        attn_k_in4_write((uint32_t)(v))
+#    define ATTN_WRITE_V4(v)        attn_v_in4_write((uint32_t)(v))
+#    define ATTN_READ_CTX()         attn_ctx_out_read()
+#    define ATTN_WRITE_CTX_NEXT()   attn_ctx_next_write(1u)
+#    define ATTN_READ_CYCLES()      attn_cycles_read()
+#    if ATTN_CLOCK_GATE
+#      define ATTN_WRITE_CLK_EN(v)  attn_clk_en_write((uint32_t)(v))
+#    endif
+#  else
+#    ifndef ATTN_BASE
+#      define ATTN_BASE  s_attn_base
+#    endif
+#    define ATTN_REG(off)           (*(volatile uint32_t *)(ATTN_BASE + (off)))
+#    define ATTN_WRITE_CTRL(v)      (ATTN_REG(ATTN_CTRL) = (uint32_t)(v))
+#    define ATTN_WRITE_SHAPE(v)     (ATTN_REG(ATTN_SHAPE) = (uint32_t)(v))
+#    define ATTN_WRITE_CFG(v)       (ATTN_REG(ATTN_CFG) = (uint32_t)(v))
+#    define ATTN_READ_STATUS()      ATTN_REG(ATTN_STATUS)
+#    define ATTN_WRITE_Q4(v)        (ATTN_REG(ATTN_Q_IN4) = (uint32_t)(v))
+#    define ATTN_WRITE_K4(v)        (ATTN_REG(ATTN_K_IN4) = (uint32_t)(v))
+#    define ATTN_WRITE_V4(v)        (ATTN_REG(ATTN_V_IN4) = (uint32_t)(v))
+#    define ATTN_READ_CTX()         ATTN_REG(ATTN_CTX_OUT)
+#    define ATTN_WRITE_CTX_NEXT()   (ATTN_REG(ATTN_CTX_NEXT) = 1u)
+#    define ATTN_READ_CYCLES()      ATTN_REG(ATTN_CYCLES)
+#    define ATTN_WRITE_CLK_EN(v)    (ATTN_REG(ATTN_CLK_EN) = (uint32_t)(v))
+#  endif
+#endif
+
+#if ATTN_CLOCK_GATE
+#  define ATTN_POWER_GET()  attn_power_get()
+#  define ATTN_POWER_PUT()  attn_power_put()
+#else
+#  define ATTN_POWER_GET()  ((void)0)
+#  define ATTN_POWER_PUT()  ((void)0)
+#endif
+
+static uintptr_t s_attn_base;
+
+/* CTRL.fast / CTRL.causal as last configured (kept in every CTRL write) */
+static uint32_t s_ctrl_cfg;
+
+#if ATTN_CLOCK_GATE
+/* attn_power_get() references held, and the wake-ups they took */
+static int                s_power_refs;
+static attn_power_stats_t s_power_stats;
+#endif
+
+#if defined(USE_ATTN_HW)
+/* Little-endian word of 4 int8 (dot8_pack order); p need not be aligned */
+static uint32_t attn_pack4(const int8_t *p)
+{
+    return (uint32_t)(uint8_t)p[0] | ((uint32_t)(uint8_t)p[1] << 8) |
+           ((uint32_t)(uint8_t)p[2] << 16) | ((uint32_t)(uint8_t)p[3] << 24);
+}
+#else
+/* Reference: attention_multi_head() of tinyformer.c (two-pass softmax). */
+static const uint16_t attn_exp_lut[16] = {
+    1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12
+};
+static int8_t   s_ctx[ATTN_MAX_S * ATTN_MAX_D];
+static int      s_ctx_idx;
+static unsigned s_shift = 5;
+
+static int8_t attn_sat8(int32_t x)
+{
+    if (x > 127) return 127;
+    if (x < -128) return -128;
+    return (int8_t)x;
+}
+
+static void attn_ref(const int8_t *q, const int8_t *k, const int8_t *v, int S, int D, int hd)
+{
+    int32_t  s[ATTN_MAX_S];
+    uint16_t w[ATTN_MAX_S];
+    int i, h0, j, d, n;
+
+    for (i = 0; i < S; i++) {
+        n = (s_ctrl_cfg & ATTN_CTRL_CAUSAL) ? i + 1 : S;
+        for (h0 = 0; h0 < D; h0 += hd) {
+            int32_t mx = -2147483647;
+            uint32_t sum = 0;
+            for (j = 0; j < n; j++) {
+                int32_t acc = 0;
+                for (d = 0; d < hd; d++)
+                    acc += (int32_t)q[i * D + h0 + d] * (int32_t)k[j * D + h0 + d];
+                s[j] = acc >> s_shift;
+                if (s[j] > mx) mx = s[j];
+            }
+            for (j = 0; j < n; j++) {
+                int32_t idx = -((s[j] - mx) >> 3);
+                if (idx > 15) idx = 15;
+                w[j] = attn_exp_lut[idx];
+                sum += w[j];
+            }
+            if (sum == 0u) sum = 1u;
+            if (s_ctrl_cfg & ATTN_CTRL_FAST) {
+                const uint32_t recip = 0x80000000u / sum;
+                for (j = 0; j < n; j++) w[j] = (uint16_t)(((uint32_t)w[j] * recip) >> 16);
+            } else {
+                for (j = 0; j < n; j++) w[j] = (uint16_t)(((uint32_t)w[j] << 15) / sum);
+            }
+            for (d = h0; d < h0 + hd; d++) {
+                int32_t acc = 0;
+                for (j = 0; j < n; j++)
+                    acc += ((int32_t)w[j] * (int32_t)v[j * D + d]) >> 15;
+                s_ctx[i * D + d] = attn_sat8(acc);
+            }
+        }
+    }
+}
+#endif
+
+void attn_init(uintptr_t base_addr)
+{
+    s_attn_base = base_addr;
+    (void)s_attn_base; /* unused when using LiteX CSRs or a fixed ATTN_BASE */
+#if ATTN_CLOCK_GATE
+    s_power_refs = 0;
+#  if defined(USE_ATTN_HW)
+    ATTN_WRITE_CLK_EN(0u);
+#  endif
+#endif
+}
+
+#if ATTN_CLOCK_GATE
+void attn_power_get(void)
+{
+    uint32_t polls = 0;
+    if (s_power_refs++ > 0) return;
+#  if defined(USE_ATTN_HW)
+    ATTN_WRITE_CLK_EN(1u);
+    while ((ATTN_READ_STATUS() & ATTN_STATUS_CLK_ON) == 0u && polls < ATTN_WAKE_SPINS) {
+        polls++;
+    }
+#  endif
+    s_power_stats.wakes++;
+    s_power_stats.last_polls = polls;
+    if (polls > s_power_stats.max_polls) s_power_stats.max_polls = polls;
+}
+
+void attn_power_put(void)
+{
+    /* The gateware keeps the clock on until a run in flight is done */
+    if (s_power_refs > 0 && --s_power_refs == 0) {
+#  if defined(USE_ATTN_HW)
+        ATTN_WRITE_CLK_EN(0u);
+#  endif
+    }
+}
+
+void attn_power_stats(attn_power_stats_t *s)
+{
+    if (s != 0) *s = s_power_stats;
+}
+#endif
+
+void attn_config(unsigned score_shift, int fast, int causal)
+{
+    s_ctrl_cfg = (fast ? ATTN_CTRL_FAST : 0u) | (causal ? ATTN_CTRL_CAUSAL : 0u);
+#if defined(USE_ATTN_HW)
+    ATTN_WRITE_CFG(score_shift & 0x1Fu);
+    ATTN_WRITE_CTRL(s_ctrl_cfg);
+#else
+    s_shift = score_shift & 0x1Fu;
+#endif
+}
+
+int attn_fits(int S, int D, int hd)
+{
+    return S > 0 && S <= ATTN_MAX_S && D > 0 && D <= ATTN_MAX_D &&
+           hd > 0 && (hd % 4) == 0 && (D % hd) == 0;
+}
+
+void attn_run(const int8_t *q, const int8_t *k, const int8_t *v, int S, int D, int hd)
+{
+#if defined(USE_ATTN_HW)
+    int i;
+
+    ATTN_POWER_GET();
+    ATTN_WRITE_SHAPE((uint32_t)S | ((uint32_t)D << 8) | ((uint32_t)hd << 16));
+    ATTN_WRITE_CTRL(s_ctrl_cfg | ATTN_CTRL_CLEAR);
+    for (i = 0; i < S * D; i += 4) {
+        ATTN_WRITE_Q4(attn_pack4(&q[i]));
+        ATTN_WRITE_K4(attn_pack4(&k[i]));
+        ATTN_WRITE_V4(attn_pack4(&v[i]));
+    }
+    ATTN_WRITE_CTRL(s_ctrl_cfg | ATTN_CTRL_START);
+    while ((ATTN_READ_STATUS() & ATTN_STATUS_DONE) == 0u) {
+        /* busy-wait */
+    }
+    ATTN_POWER_PUT();
+#else
+    attn_ref(q, k, v, S, D, hd);
+    s_ctx_idx = 0;
+#endif
+}
+
+void attn_read_ctx(int8_t *ctx, int count)
+{
+    int i;
+    ATTN_POWER_GET();
+    for (i = 0; i < count; i += 4) {
+#if defined(USE_ATTN_HW)
+        const uint32_t x = ATTN_READ_CTX();
+        ATTN_WRITE_CTX_NEXT();
+        ctx[i]     = (int8_t)x;
+        ctx[i + 1] = (int8_t)(x >> 8);
+        ctx[i + 2] = (int8_t)(x >> 16);
+        ctx[i + 3] = (int8_t)(x >> 24);
+#else
+        ctx[i]     = s_ctx[s_ctx_idx];
+        ctx[i + 1] = s_ctx[s_ctx_idx + 1];
+        ctx[i + 2] = s_ctx[s_ctx_idx + 2];
+        ctx[i + 3] = s_ctx[s_ctx_idx + 3];
+        s_ctx_idx += 4;
+#endif
+    }
+    ATTN_POWER_PUT();
+}
+
+uint32_t attn_cycles(void)
+{
+#if defined(USE_ATTN_HW)
+    return ATTN_READ_CYCLES();
+#else
+    return 0u;
+#endif
+}
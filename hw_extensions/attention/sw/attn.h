@@ -0,0 +1,118 @@
+/*
+ * Attention engine — C driver API.
+ *
+ * Defining USE_ATTN_HW (in the firmware that uses this driver) requires the SoC to include
+ * the corresponding HW block; otherwise the same calls run the C reference in attn.c.
+ *
+ * Use with LiteX-generated CSR accessors (ATTN_USE_LITEX_CSR: attn_ctrl_write(),
+ * attn_q_in4_write(), ...) or with ATTN_BASE / attn_init() and the offsets below.
+ *
+ * One run computes the attention of a whole encoder block: for every query i and head,
+ * context[i] = softmax(Q[i] K^T >> shift) V over the head's channels, from Q, K and V
+ * [S][D] (attn_run()). The context is read back with attn_read_ctx(). Results are
+ * bit-exact with the two-pass softmax of tinyformer.c. Polling only.
+ *
+ * ATTN_CLOCK_GATE=1 (gateware built with AttnPeripheral(clock_gate=True)): the core runs on
+ * a gated clock (CLK_EN, on from reset). attn_run() and attn_read_ctx() take an
+ * attn_power_get() reference for their duration, so the block is clocked only while the
+ * driver uses it (and, in hardware, until a started run is done).
+ */
+
+#ifndef ATTN_H
+#define ATTN_H
+
+#include <stdint.h>
+
+/* Optional: set base address when not using LiteX generated/csr.h */
+#ifndef ATTN_BASE
+/* #define ATTN_BASE  0x00000000 */
+#endif
+
+/* Register offsets (bytes) — must match attn_spec.md and LiteX wrapper */
+#define ATTN_CTRL      0x00
+#define ATTN_SHAPE     0x04   /* [5:0]=S, [15:8]=D, [23:16]=head_dim */
+#define ATTN_CFG       0x08   /* [4:0] score shift, reset 5 */
+#define ATTN_STATUS    0x0C
+#define ATTN_Q_IN4     0x10   /* write 4 packed int8 Q values, row-major (lane 0 = bits 7:0) */
+#define ATTN_K_IN4     0x14
+#define ATTN_V_IN4     0x18
+#define ATTN_CTX_OUT   0x1C   /* 4 int8 context values at the read index, row-major */
+#define ATTN_CTX_NEXT  0x20   /* write any value to advance the read index by one word */
+#define ATTN_CYCLES    0x24   /* busy cycles of the last run */
+#define ATTN_CLK_EN    0x28   /* ATTN_CLOCK_GATE: 1 = core clock on */
+
+/* CTRL bits: START and CLEAR are pulses; FAST and CAUSAL are stored */
+#define ATTN_CTRL_START   (1u << 0)
+#define ATTN_CTRL_CLEAR   (1u << 1)   /* clear done, rewind the Q/K/V write and context read pointers */
+#define ATTN_CTRL_FAST    (1u << 2)   /* reciprocal-multiply normalize (TINYFORMER_FAST_SOFTMAX) */
+#define ATTN_CTRL_CAUSAL  (1u << 3)   /* query i attends keys 0 .. i (TINYFORMER_CAUSAL) */
+
+/* STATUS: [0]=busy, [1]=done, [2]=clk_on (ATTN_CLOCK_GATE gateware only) */
+#define ATTN_STATUS_BUSY  (1u << 0)
+#define ATTN_STATUS_DONE  (1u << 1)
+#define ATTN_STATUS_CLK_ON (1u << 2)
+
+/* Gateware sizes (AttnPeripheral(s_max, d_max)); override to match */
+#ifndef ATTN_MAX_S
+#define ATTN_MAX_S 16       /* tokens */
+#endif
+#ifndef ATTN_MAX_D
+#define ATTN_MAX_D 64       /* channels (multiple of 4) */
+#endif
+
+#ifndef ATTN_CLOCK_GATE
+#define ATTN_CLOCK_GATE 0
+#endif
+/* STATUS polls a wake-up waits for clk_on before it gives up (gateware without the gate) */
+#ifndef ATTN_WAKE_SPINS
+#define ATTN_WAKE_SPINS 1000u
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initialize driver (set base address if using ATTN_BASE). No-op when using LiteX CSRs,
+ * except that ATTN_CLOCK_GATE turns the core clock off until the first call needs it. */
+void attn_init(uintptr_t base_addr);
+
+#if ATTN_CLOCK_GATE
+/* Reference-counted core clock: the first get turns it on and waits for STATUS.clk_on,
+ * the last put turns it off. The context and CYCLES are kept while it is off. Wrap
+ * attn_run() and its attn_read_ctx() in get / put to wake the core once for both. */
+void attn_power_get(void);
+void attn_power_put(void);
+
+/* Wake-ups so far, and the STATUS polls of the last and slowest one until clk_on was
+ * seen (ATTN_WAKE_SPINS: never seen; 0 for the C reference). */
+typedef struct {
+    uint32_t wakes;
+    uint32_t last_polls;
+    uint32_t max_polls;
+} attn_power_stats_t;
+void attn_power_stats(attn_power_stats_t *s);
+#endif
+
+/* Score shift (TinyFormer: TINYFORMER_SCORE_SHIFT), normalize mode (fast != 0:
+ * w = (e * (2^31 / sum)) >> 16, else (e << 15) / sum) and causal masking for the next runs. */
+void attn_config(unsigned score_shift, int fast, int causal);
+
+/* Nonzero if the block runs S tokens of D channels in heads of hd: S up to ATTN_MAX_S,
+ * D up to ATTN_MAX_D, hd a multiple of 4 that divides D. */
+int attn_fits(int S, int D, int hd);
+
+/* Load Q, K, V ([S][D] int8, rows D bytes apart), run every query and head (head_dim hd)
+ * and wait for done. Rewinds the context read pointer. */
+void attn_run(const int8_t *q, const int8_t *k, const int8_t *v, int S, int D, int hd);
+
+/* Read the next count (a multiple of 4) context values of the last run (row-major [S][D]). */
+void attn_read_ctx(int8_t *ctx, int count);
+
+/* Busy cycles of the last run (0 for the C reference). */
+uint32_t attn_cycles(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATTN_H */
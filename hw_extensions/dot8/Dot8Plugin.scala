@@ -5,20 +5,56 @@
  * rs1, rs2 = packed int8 (lane 0 = LSB .. lane 3 = MSB); rd = int32 result.
  * rd = sum_{i=0..3} signext8(rs1.byte[i]) * signext8(rs2.byte[i])
  *
- * Single-cycle execute; no multi-cycle stalls. Matches hw_extensions/dot8/sw/dot8.c and encoding.md.
+ * funct7 = 0x02 (DOT8.MAC): rd = rd + dot(rs1, rs2). The old rd value is a third source
+ * operand; RegFilePlugin only has two read ports, so this plugin keeps a shadow copy of the
+ * register file (written with the same writeback data) and forwards in-flight results
+ * from memory/writeback the way HazardSimplePlugin does for rs1/rs2.
+ *
+ * funct7 = 0x03 / 0x04 (DOT8U, DOT8U.MAC): rs1 lanes are unsigned u8 (ReLU outputs), rs2 signed.
+ * funct7 = 0x05 / 0x06 (DOT8.MAC8, DOT8U.MAC8): 8 lanes from register pairs,
+ *   rd = rd + dot(rs1, rs2) + dot(x[rs1 + 1], x[rs2 + 1]); rs1, rs2 must not be x31.
+ * The pair registers come from the same shadow copy.
+ *
+ * Requant / activation helpers (SIMD within a register, like PULP clips8 / maxs4 / pack):
+ * funct7 = 0x0A (SAT8):    rd = clip8(rs1 >>a rs2[4:0])                   (truncating, as ">> 7")
+ * funct7 = 0x0B (SAT8R):   rd = clip8((rs1 + 2^(sh-1)) >>a sh), sh = rs2[4:0] (round half up; sh = 0: none)
+ * funct7 = 0x0C (MAX4):    rd.byte[i] = max(rs1.byte[i], rs2.byte[i])    (signed int8 lanes)
+ * funct7 = 0x0D (PACK2.SAT): rd = clip8(rs2) << 24 | clip8(rs1) << 16 | rd >> 16
+ *   (rd is a source, read like DOT8.MAC; two in a row pack four lanes in order)
+ * funct7 = 0x0E (MAX):     rd = max(rs1, rs2)                            (signed int32)
+ * clip8 saturates to -128..127; SAT8/SAT8R return it sign-extended to 32 bits.
+ * funct7 0x07..0x09 under the same opcode belong to ExpLutPlugin.
+ *
+ * Single-cycle execute; the MAC forms stall only behind a load/mul still producing a source.
+ * Matches hw_extensions/dot8/sw/dot8.h and encoding.md.
  */
 
 package vexriscv.plugin
 
 import spinal.core._
 import spinal.lib._
-import vexriscv.{DecoderService, Stageable, VexRiscv}
+import vexriscv.{DecoderService, Stage, Stageable, VexRiscv}
 
 object Dot8Plugin {
-  val DOT8_FUNCT7 = B(0x01, 7 bits)
-  val DOT8_OPCODE = B(0x0B, 7 bits)
+  val DOT8_FUNCT7       = B(0x01, 7 bits)
+  val DOT8_MAC_FUNCT7   = B(0x02, 7 bits)
+  val DOT8U_FUNCT7      = B(0x03, 7 bits)
+  val DOT8U_MAC_FUNCT7  = B(0x04, 7 bits)
+  val DOT8_MAC8_FUNCT7  = B(0x05, 7 bits)
+  val DOT8U_MAC8_FUNCT7 = B(0x06, 7 bits)
+  val SAT8_FUNCT7       = B(0x0A, 7 bits)
+  val SAT8R_FUNCT7      = B(0x0B, 7 bits)
+  val MAX4_FUNCT7       = B(0x0C, 7 bits)
+  val PACK2_SAT_FUNCT7  = B(0x0D, 7 bits)
+  val MAX_FUNCT7        = B(0x0E, 7 bits)
+  val DOT8_OPCODE       = B(0x0B, 7 bits)
 
   object DOT8_OPCODE_STAGEABLE extends Stageable(Bool())
+  object DOT8_MAC extends Stageable(Bool())
+  object DOT8_U extends Stageable(Bool())
+  object DOT8_PAIR extends Stageable(Bool())
+  object DOT8_SIMD extends Stageable(Bool())
+  object DOT8_PACK extends Stageable(Bool())
   object DOT8_RD extends Stageable(SInt(32 bits))
 }
 
@@ -29,6 +65,11 @@ class Dot8Plugin extends Plugin[VexRiscv] {
     import Dot8Plugin._
     val decoder = pipeline.service(classOf[DecoderService])
     decoder.addDefault(DOT8_OPCODE_STAGEABLE, False)
+    decoder.addDefault(DOT8_MAC, False)
+    decoder.addDefault(DOT8_U, False)
+    decoder.addDefault(DOT8_PAIR, False)
+    decoder.addDefault(DOT8_SIMD, False)
+    decoder.addDefault(DOT8_PACK, False)
   }
 
   override def build(pipeline: VexRiscv): Unit = {
@@ -38,30 +79,114 @@ class Dot8Plugin extends Plugin[VexRiscv] {
 
     val decode = pipeline.decode
     val execute = pipeline.execute
+    val memory = pipeline.memory
     val writeback = pipeline.writeback
 
     val instr = decode.input(INSTRUCTION)
-    val isDot8 = (instr(6 downto 0) === DOT8_OPCODE) && (instr(31 downto 25) === DOT8_FUNCT7)
+    val funct7 = instr(31 downto 25)
+    val isCustom0 = instr(6 downto 0) === DOT8_OPCODE
+    val isSimd = isCustom0 && (funct7 === SAT8_FUNCT7 || funct7 === SAT8R_FUNCT7 ||
+                               funct7 === MAX4_FUNCT7 || funct7 === PACK2_SAT_FUNCT7 ||
+                               funct7 === MAX_FUNCT7)
+    val isDot8 = isSimd || isCustom0 && (funct7 === DOT8_FUNCT7 || funct7 === DOT8_MAC_FUNCT7 ||
+                               funct7 === DOT8U_FUNCT7 || funct7 === DOT8U_MAC_FUNCT7 ||
+                               funct7 === DOT8_MAC8_FUNCT7 || funct7 === DOT8U_MAC8_FUNCT7)
 
     decode.insert(DOT8_OPCODE_STAGEABLE) := isDot8
+    decode.insert(DOT8_MAC) := isDot8 && !isSimd && (funct7 =/= DOT8_FUNCT7 && funct7 =/= DOT8U_FUNCT7)
+    decode.insert(DOT8_U) := isDot8 && (funct7 === DOT8U_FUNCT7 || funct7 === DOT8U_MAC_FUNCT7 ||
+                                        funct7 === DOT8U_MAC8_FUNCT7)
+    decode.insert(DOT8_PAIR) := isDot8 && (funct7 === DOT8_MAC8_FUNCT7 || funct7 === DOT8U_MAC8_FUNCT7)
+    decode.insert(DOT8_SIMD) := isSimd
+    decode.insert(DOT8_PACK) := isSimd && funct7 === PACK2_SAT_FUNCT7
     when(isDot8) {
       decode.insert(REGFILE_WRITE_VALID) := True
     }
 
-    val rs1Bits = execute.input(RS1).asBits
-    val rs2Bits = execute.input(RS2).asBits
+    /* 4 lanes of a (signed, or unsigned when aUnsigned) times 4 signed lanes of b */
+    def dot4(a: Bits, b: Bits, aUnsigned: Bool): SInt = {
+      val lanes = for (i <- 0 until 4) yield {
+        val aByte = a(8 * i + 7 downto 8 * i)
+        val aLane = (aUnsigned ? (B"0" ## aByte) | (aByte.msb ## aByte)).asSInt
+        (aLane * b(8 * i + 7 downto 8 * i).asSInt).resize(32)
+      }
+      lanes.reduce(_ + _)
+    }
+
+    /* Saturate to int8 (-128..127) */
+    def clip8(x: SInt): Bits = {
+      val r = Bits(8 bits)
+      r := x(7 downto 0).asBits
+      when(x > S(127, x.getWidth bits)) { r := B(0x7F, 8 bits) }
+      when(x < S(-128, x.getWidth bits)) { r := B(0x80, 8 bits) }
+      r
+    }
+
+    /* Extra source operands (rd for the MAC and PACK forms, rs1 + 1 and rs2 + 1 for the
+     * 8-lane forms). RegFilePlugin has two read ports, so this plugin keeps a
+     * shadow copy of the register file that mirrors its write (same rd, data and
+     * enable at writeback) and forwards results still in memory/writeback. */
+    def rdOf(stage: Stage): UInt = stage.input(INSTRUCTION)(11 downto 7).asUInt
+    val shadowRegs = Mem(Bits(32 bits), 32)
+    shadowRegs.write(
+      address = rdOf(writeback),
+      data    = writeback.output(REGFILE_WRITE_DATA),
+      enable  = writeback.arbitration.isFiring && writeback.output(REGFILE_WRITE_VALID)
+    )
+    val memData = Mux(memory.input(DOT8_OPCODE_STAGEABLE), memory.input(DOT8_RD).asBits, memory.output(REGFILE_WRITE_DATA))
+
+    /* Returns (value, stall): stall while a load/mul in memory still produces the register. */
+    def readExtra(addr: UInt): (Bits, Bool) = {
+      val memHit = memory.arbitration.isValid && memory.input(REGFILE_WRITE_VALID) && rdOf(memory) === addr
+      val wbHit = writeback.arbitration.isValid && writeback.input(REGFILE_WRITE_VALID) && rdOf(writeback) === addr
+      val value = Bits(32 bits)
+      value := shadowRegs.readAsync(addr)
+      when(wbHit) { value := writeback.output(REGFILE_WRITE_DATA) }
+      when(memHit) { value := memData }
+      when(addr === 0) { value := 0 }
+      (value, memHit && !memory.input(BYPASSABLE_MEMORY_STAGE) && !memory.input(DOT8_OPCODE_STAGEABLE))
+    }
+
+    val exInstr = execute.input(INSTRUCTION)
+    val (acc, accStall) = readExtra(rdOf(execute))
+    val (rs1Hi, rs1HiStall) = readExtra(exInstr(19 downto 15).asUInt + 1)
+    val (rs2Hi, rs2HiStall) = readExtra(exInstr(24 downto 20).asUInt + 1)
+
+    when(execute.arbitration.isValid && execute.input(DOT8_OPCODE_STAGEABLE) &&
+         (((execute.input(DOT8_MAC) || execute.input(DOT8_PACK)) && accStall) ||
+          (execute.input(DOT8_PAIR) && (rs1HiStall || rs2HiStall)))) {
+      execute.arbitration.haltByOther := True
+    }
+
+    val aUnsigned = execute.input(DOT8_U)
+    val dotLo = dot4(execute.input(RS1).asBits, execute.input(RS2).asBits, aUnsigned)
+    val dotHi = dot4(rs1Hi, rs2Hi, aUnsigned)
+
+    val dotRd = dotLo +
+      Mux(execute.input(DOT8_PAIR), dotHi, S(0, 32 bits)) +
+      Mux(execute.input(DOT8_MAC), acc.asSInt, S(0, 32 bits))
 
-    val a0 = rs1Bits(7 downto 0).asSInt.resize(32)
-    val a1 = rs1Bits(15 downto 8).asSInt.resize(32)
-    val a2 = rs1Bits(23 downto 16).asSInt.resize(32)
-    val a3 = rs1Bits(31 downto 24).asSInt.resize(32)
-    val b0 = rs2Bits(7 downto 0).asSInt.resize(32)
-    val b1 = rs2Bits(15 downto 8).asSInt.resize(32)
-    val b2 = rs2Bits(23 downto 16).asSInt.resize(32)
-    val b3 = rs2Bits(31 downto 24).asSInt.resize(32)
+    /* SIMD helpers: one of SAT8 / SAT8R / MAX4 / PACK2.SAT / MAX by funct7 */
+    val a = execute.input(RS1).asSInt
+    val b = execute.input(RS2).asSInt
+    val sh = execute.input(RS2)(4 downto 0).asUInt
+    val half = Mux(sh === 0, S(0, 33 bits), S(1, 33 bits) |<< (sh - 1))
+    val sat8 = clip8(a >> sh)
+    val sat8r = clip8((a.resize(33) + half) >> sh)
+    val max4 = Cat((0 until 4).map { i =>
+      val x = a(8 * i + 7 downto 8 * i)
+      val y = b(8 * i + 7 downto 8 * i)
+      Mux(x > y, x, y).asBits
+    }.reverse)
+    val simdRd = exInstr(31 downto 25).mux(
+      SAT8_FUNCT7      -> (B(24 bits, default -> sat8.msb) ## sat8),
+      SAT8R_FUNCT7     -> (B(24 bits, default -> sat8r.msb) ## sat8r),
+      MAX4_FUNCT7      -> max4,
+      PACK2_SAT_FUNCT7 -> (clip8(b) ## clip8(a) ## acc(31 downto 16)),
+      default          -> Mux(a > b, a, b).asBits
+    )
 
-    val dotResult = (a0 * b0) + (a1 * b1) + (a2 * b2) + (a3 * b3)
-    execute.insert(DOT8_RD) := dotResult
+    execute.insert(DOT8_RD) := Mux(execute.input(DOT8_SIMD), simdRd.asSInt, dotRd)
 
     when(writeback.input(DOT8_OPCODE_STAGEABLE)) {
       writeback.output(REGFILE_WRITE_DATA) := writeback.input(DOT8_RD).asBits
@@ -0,0 +1,80 @@
+/*
+ * VexRiscv plugin: one-level hardware loop (LP.SETUP), for the DOT8 MAC loops.
+ *
+ * Opcode: custom-1 = 0x2B, I-type, funct3 = 0.
+ * LP.SETUP rs1, imm: count = rs1 (>= 1), start = pc + 4, end = pc + imm.
+ *   The body is start..end inclusive (imm = 4 * body instructions, 8..2044): after the
+ *   instruction at end, fetch goes back to start until the body has run count times.
+ *   rd must be x0; nothing is written to the register file.
+ *
+ * The redirect is a jump from decode when the instruction at end fires there with
+ * count > 1, so the loop costs no instruction (no counter update, no branch) and the
+ * refetch bubble of a decode-stage jump, instead of an addi + bne and their taken-branch
+ * penalty. A late flush (branch in execute, trap) kills the decode instruction before it
+ * fires, so the count only moves for the end instruction that really executes.
+ *
+ * Restrictions (as with PULP lp.setup): the body has at least two instructions; its
+ * last one is not a branch, jump or LP.SETUP; no nesting (a second LP.SETUP replaces
+ * the loop). Trap handlers must not use LP.SETUP; a trap inside the body returns into
+ * it and the loop continues.
+ * Matches hw_extensions/dot8/sw/dot8.c (DOT8_HWLOOP) and encoding.md.
+ */
+
+package vexriscv.plugin
+
+import spinal.core._
+import spinal.lib._
+import vexriscv.{DecoderService, JumpService, Stageable, VexRiscv}
+
+object HwLoopPlugin {
+  object LP_SETUP extends Stageable(Bool())
+}
+
+class HwLoopPlugin extends Plugin[VexRiscv] {
+  var jumpInterface: Flow[UInt] = null
+
+  override def setup(pipeline: VexRiscv): Unit = {
+    import pipeline.config._
+    import HwLoopPlugin._
+    val decoder = pipeline.service(classOf[DecoderService])
+    decoder.addDefault(LP_SETUP, False)
+    /* imm | rs1 | funct3 0 | rd x0 | custom-1; rs1 is hazard-checked like any source */
+    decoder.add(M"-----------------000000000101011", List(LP_SETUP -> True, RS1_USE -> True))
+    jumpInterface = pipeline.service(classOf[JumpService]).createJumpInterface(pipeline.decode)
+  }
+
+  override def build(pipeline: VexRiscv): Unit = {
+    import pipeline._
+    import pipeline.config._
+    import HwLoopPlugin._
+
+    val decode = pipeline.decode
+    val execute = pipeline.execute
+
+    val instr = decode.input(INSTRUCTION)
+    val isSetup = decode.input(LP_SETUP)
+
+    val lpStart = Reg(UInt(32 bits))
+    val lpEnd   = Reg(UInt(32 bits))
+    val lpCount = Reg(UInt(32 bits)) init(0)
+
+    /* start / end are known in decode (pc + imm); the count arrives from execute,
+     * at least one cycle before the earliest possible end instruction reaches decode. */
+    when(decode.arbitration.isFiring && isSetup) {
+      lpStart := decode.input(PC) + 4
+      lpEnd   := decode.input(PC) + instr(31 downto 20).asSInt.resize(32).asUInt
+    }
+
+    val atEnd = decode.arbitration.isFiring && !isSetup && lpCount > 1 && decode.input(PC) === lpEnd
+    jumpInterface.valid   := atEnd
+    jumpInterface.payload := lpStart
+    when(atEnd) {
+      lpCount := lpCount - 1
+      decode.arbitration.flushNext := True
+    }
+
+    when(execute.arbitration.isFiring && execute.input(LP_SETUP)) {
+      lpCount := execute.input(RS1).asUInt
+    }
+  }
+}
@@ -1,39 +1,149 @@
 /*
  * DOT8 — 4-lane signed int8 dot-product.
  * Defining USE_DOT8_HW requires the SoC to include the corresponding HW block; otherwise keep macro off.
- * Opcode custom-0 (0x0B), funct7=0x01. rs1/rs2 = packed int8, rd = int32.
+ * Opcode custom-0 (0x0B), funct7=0x01 (dot) / 0x02 (MAC, rd += dot). rs1/rs2 = packed int8, rd = int32.
  * Packing: byte0=LSB (lane 0) .. byte3=MSB (lane 3). Signed lanes.
  */
 
 #include "dot8.h"
 
-/* Software reference: signed int8 lanes, int32 result. */
-static int32_t dot8_sw(uint32_t a_packed, uint32_t b_packed)
+int32_t dot8_4_lanes(uint32_t a_packed, uint32_t b_packed)
 {
-    int32_t a0 = (int32_t)(int8_t)(a_packed >> 0);
-    int32_t a1 = (int32_t)(int8_t)(a_packed >> 8);
-    int32_t a2 = (int32_t)(int8_t)(a_packed >> 16);
-    int32_t a3 = (int32_t)(int8_t)(a_packed >> 24);
-    int32_t b0 = (int32_t)(int8_t)(b_packed >> 0);
-    int32_t b1 = (int32_t)(int8_t)(b_packed >> 8);
-    int32_t b2 = (int32_t)(int8_t)(b_packed >> 16);
-    int32_t b3 = (int32_t)(int8_t)(b_packed >> 24);
-    return a0 * b0 + a1 * b1 + a2 * b2 + a3 * b3;
+    return dot8_op(a_packed, b_packed);
 }
 
-int32_t dot8_4_lanes(uint32_t a_packed, uint32_t b_packed)
+#if DOT8_USE_ASM
+static volatile int s_probe_armed;
+static volatile int s_probe_fault;
+
+int dot8_probe(void)
+{
+    int32_t r;
+    s_probe_fault = 0;
+    s_probe_armed = 1;
+    r = dot8_op(0x04030201u, 0xFF010101u);   /* 1 + 2 + 3 - 4 */
+    s_probe_armed = 0;
+    return !s_probe_fault && r == 2;
+}
+
+int dot8_trap(void)
+{
+    uint32_t mcause, mepc;
+    __asm__ volatile ("csrr %0, mcause" : "=r"(mcause));
+    if (!s_probe_armed || mcause != 2u)   /* 2: illegal instruction */
+        return 0;
+    __asm__ volatile ("csrr %0, mepc" : "=r"(mepc));
+    __asm__ volatile ("csrw mepc, %0" :: "r"(mepc + 4u));
+    s_probe_fault = 1;
+    return 1;
+}
+#else
+int dot8_probe(void)
+{
+    return dot8_op(0x04030201u, 0xFF010101u) == 2;
+}
+
+int dot8_trap(void)
 {
-#if defined(USE_DOT8_HW)
-    int32_t result;
-    /* custom-0 opcode 0x0B, funct7=0x01; rd = dot-product of rs1/rs2 (4x signed int8). */
+    return 0;
+}
+#endif
+
+#if DOT8_USE_ASM && DOT8_HWLOOP
+/* y[0..3] += four rows of `words` (even, >= 2) words from w0 against x. One LP.SETUP
+ * loop of words / 2 iterations; each one loads two x words and the matching two words
+ * of every row at immediate offsets, issues 8 DOT8.MAC and then moves the five pointers:
+ * 23 instructions per 8 MAC groups and no loop branch. */
+static void dot8_block4_hwloop(const uint32_t *w0, const uint32_t *x, int32_t *y, int words)
+{
+    const uint32_t *w1 = w0 + words;
+    const uint32_t *w2 = w1 + words;
+    const uint32_t *w3 = w2 + words;
+    int32_t a0 = y[0], a1 = y[1], a2 = y[2], a3 = y[3];
+    uint32_t xv, v0, v1, v2, v3;
+
     __asm__ volatile (
-        "custom0 1, %0, %1, %2"
-        : "=r"(result)
-        : "r"(a_packed), "r"(b_packed)
-        /* no clobbers: instruction uses only reg operands */
+        ".option push\n\t"
+        ".option norelax\n"
+        "1:\n\t"
+        ".insn i 0x2B, 0, x0, %[n], 2f - 1b\n\t"   /* LP.SETUP n, end = label 2 */
+        "lw %[xv], 0(%[x])\n\t"
+        "lw %[v0], 0(%[w0])\n\t"
+        "lw %[v1], 0(%[w1])\n\t"
+        "lw %[v2], 0(%[w2])\n\t"
+        "lw %[v3], 0(%[w3])\n\t"
+        "custom0 2, %[a0], %[v0], %[xv]\n\t"
+        "custom0 2, %[a1], %[v1], %[xv]\n\t"
+        "custom0 2, %[a2], %[v2], %[xv]\n\t"
+        "custom0 2, %[a3], %[v3], %[xv]\n\t"
+        "lw %[xv], 4(%[x])\n\t"
+        "lw %[v0], 4(%[w0])\n\t"
+        "lw %[v1], 4(%[w1])\n\t"
+        "lw %[v2], 4(%[w2])\n\t"
+        "lw %[v3], 4(%[w3])\n\t"
+        "custom0 2, %[a0], %[v0], %[xv]\n\t"
+        "custom0 2, %[a1], %[v1], %[xv]\n\t"
+        "custom0 2, %[a2], %[v2], %[xv]\n\t"
+        "custom0 2, %[a3], %[v3], %[xv]\n\t"
+        "addi %[x], %[x], 8\n\t"
+        "addi %[w0], %[w0], 8\n\t"
+        "addi %[w1], %[w1], 8\n\t"
+        "addi %[w2], %[w2], 8\n"
+        "2:\n\t"
+        "addi %[w3], %[w3], 8\n\t"
+        ".option pop"
+        : [a0] "+r"(a0), [a1] "+r"(a1), [a2] "+r"(a2), [a3] "+r"(a3),
+          [x] "+r"(x), [w0] "+r"(w0), [w1] "+r"(w1), [w2] "+r"(w2), [w3] "+r"(w3),
+          [xv] "=&r"(xv), [v0] "=&r"(v0), [v1] "=&r"(v1), [v2] "=&r"(v2), [v3] "=&r"(v3)
+        : [n] "r"(words / 2)
+        : "memory"
     );
-    return result;
-#else
-    return dot8_sw(a_packed, b_packed);
+    y[0] = a0;
+    y[1] = a1;
+    y[2] = a2;
+    y[3] = a3;
+}
+#endif
+
+void dot8_matvec_4x1(const uint32_t *w, const uint32_t *x, int32_t *y, int rows, int words)
+{
+    int r = 0;
+    int i;
+
+#if DOT8_USE_ASM && DOT8_HWLOOP
+    if (words >= 2 && (words % 2) == 0) {
+        for (; r + 4 <= rows; r += 4)
+            dot8_block4_hwloop(&w[r * words], x, &y[r], words);
+    }
 #endif
+    for (; r + 4 <= rows; r += 4) {
+        const uint32_t *w0 = &w[r * words];
+        const uint32_t *w1 = w0 + words;
+        const uint32_t *w2 = w1 + words;
+        const uint32_t *w3 = w2 + words;
+        int32_t acc0 = y[r + 0];
+        int32_t acc1 = y[r + 1];
+        int32_t acc2 = y[r + 2];
+        int32_t acc3 = y[r + 3];
+        for (i = 0; i < words; i++) {
+            uint32_t xv = x[i];   /* loaded once, used by 4 rows */
+            acc0 = dot8_mac(acc0, w0[i], xv);
+            acc1 = dot8_mac(acc1, w1[i], xv);
+            acc2 = dot8_mac(acc2, w2[i], xv);
+            acc3 = dot8_mac(acc3, w3[i], xv);
+        }
+        y[r + 0] = acc0;
+        y[r + 1] = acc1;
+        y[r + 2] = acc2;
+        y[r + 3] = acc3;
+    }
+
+    /* Remainder rows */
+    for (; r < rows; r++) {
+        const uint32_t *w_row = &w[r * words];
+        int32_t acc = y[r];
+        for (i = 0; i < words; i++)
+            acc = dot8_mac(acc, w_row[i], x[i]);
+        y[r] = acc;
+    }
 }
@@ -8,6 +8,18 @@
  * All lanes are signed int8; result is signed int32.
  * When USE_DOT8_HW is defined and the VexRiscv DOT8 plugin is present, uses inline asm.
  * Otherwise uses software fallback (so tests can run without hardware).
+ *
+ * Hot loops should use the static inline intrinsics dot8_op() and dot8_mac() below: each
+ * is one custom-0 instruction with no call, and dot8_mac() also folds the accumulate
+ * (funct7=0x02, rd += dot). dot8_4_lanes() stays as the out-of-line entry point.
+ *
+ * Variants: dot8u_op()/dot8u_mac() take unsigned u8 lanes in a (ReLU outputs, 0..255)
+ * against signed int8 b; dot8_mac8()/dot8u_mac8() do 8 lanes (two words of each
+ * operand) per instruction.
+ *
+ * Requant helpers (funct7 0x0A..0x0E, SIMD within a register): dot8_sat8() / dot8_sat8r()
+ * shift-(round-)clip an int32 to int8, dot8_max4() is a 4-lane int8 max, dot8_pack2_sat()
+ * saturates two int32s into the next two bytes of a packed word, dot8_max() an int32 max.
  */
 
 #ifndef DOT8_H
@@ -28,11 +40,274 @@ static inline uint32_t dot8_pack(const int8_t a[4])
          | ((uint32_t)(uint8_t)a[3] << 24);
 }
 
+/* Software reference: signed int8 lanes, int32 result. */
+static inline int32_t dot8_sw(uint32_t a_packed, uint32_t b_packed)
+{
+    int32_t a0 = (int32_t)(int8_t)(a_packed >> 0);
+    int32_t a1 = (int32_t)(int8_t)(a_packed >> 8);
+    int32_t a2 = (int32_t)(int8_t)(a_packed >> 16);
+    int32_t a3 = (int32_t)(int8_t)(a_packed >> 24);
+    int32_t b0 = (int32_t)(int8_t)(b_packed >> 0);
+    int32_t b1 = (int32_t)(int8_t)(b_packed >> 8);
+    int32_t b2 = (int32_t)(int8_t)(b_packed >> 16);
+    int32_t b3 = (int32_t)(int8_t)(b_packed >> 24);
+    return a0 * b0 + a1 * b1 + a2 * b2 + a3 * b3;
+}
+
+/* Software reference, unsigned u8 lanes in a, signed int8 lanes in b. */
+static inline int32_t dot8u_sw(uint32_t a_packed, uint32_t b_packed)
+{
+    int32_t a0 = (int32_t)(uint8_t)(a_packed >> 0);
+    int32_t a1 = (int32_t)(uint8_t)(a_packed >> 8);
+    int32_t a2 = (int32_t)(uint8_t)(a_packed >> 16);
+    int32_t a3 = (int32_t)(uint8_t)(a_packed >> 24);
+    int32_t b0 = (int32_t)(int8_t)(b_packed >> 0);
+    int32_t b1 = (int32_t)(int8_t)(b_packed >> 8);
+    int32_t b2 = (int32_t)(int8_t)(b_packed >> 16);
+    int32_t b3 = (int32_t)(int8_t)(b_packed >> 24);
+    return a0 * b0 + a1 * b1 + a2 * b2 + a3 * b3;
+}
+
+/* The custom instructions are only emitted for RISC-V; host builds of the same
+ * sources with USE_DOT8_HW fall back to dot8_sw(). */
+#if defined(USE_DOT8_HW) && defined(__riscv)
+#  define DOT8_USE_ASM 1
+#else
+#  define DOT8_USE_ASM 0
+#endif
+
+/* DOT8_HWLOOP=1 (with USE_DOT8_HW): dot8_matvec_4x1() runs each 4-row block as one
+ * LP.SETUP hardware loop (HwLoopPlugin.scala, custom-1) over pairs of x words, with
+ * immediate-offset loads, so the loop has no counter update and no branch. The CPU
+ * must include HwLoopPlugin. Off by default. */
+#ifndef DOT8_HWLOOP
+#  define DOT8_HWLOOP 0
+#endif
+
+/* One DOT8: rd = dot(a, b). custom-0, funct7=0x01. */
+static inline int32_t dot8_op(uint32_t a_packed, uint32_t b_packed)
+{
+#if DOT8_USE_ASM
+    int32_t result;
+    __asm__ volatile (
+        "custom0 1, %0, %1, %2"
+        : "=r"(result)
+        : "r"(a_packed), "r"(b_packed)
+    );
+    return result;
+#else
+    return dot8_sw(a_packed, b_packed);
+#endif
+}
+
+/* DOT8 MAC: returns acc + dot(a, b). custom-0, funct7=0x02; rd is read as the
+ * accumulator and overwritten with the sum, so acc lives in rd ("+r"). */
+static inline int32_t dot8_mac(int32_t acc, uint32_t a_packed, uint32_t b_packed)
+{
+#if DOT8_USE_ASM
+    __asm__ volatile (
+        "custom0 2, %0, %1, %2"
+        : "+r"(acc)
+        : "r"(a_packed), "r"(b_packed)
+    );
+    return acc;
+#else
+    return acc + dot8_sw(a_packed, b_packed);
+#endif
+}
+
+/* DOT8U: u8 lanes of a times int8 lanes of b. custom-0, funct7=0x03. */
+static inline int32_t dot8u_op(uint32_t a_packed, uint32_t b_packed)
+{
+#if DOT8_USE_ASM
+    int32_t result;
+    __asm__ volatile (
+        "custom0 3, %0, %1, %2"
+        : "=r"(result)
+        : "r"(a_packed), "r"(b_packed)
+    );
+    return result;
+#else
+    return dot8u_sw(a_packed, b_packed);
+#endif
+}
+
+/* DOT8U.MAC: acc + dot8u(a, b). custom-0, funct7=0x04. */
+static inline int32_t dot8u_mac(int32_t acc, uint32_t a_packed, uint32_t b_packed)
+{
+#if DOT8_USE_ASM
+    __asm__ volatile (
+        "custom0 4, %0, %1, %2"
+        : "+r"(acc)
+        : "r"(a_packed), "r"(b_packed)
+    );
+    return acc;
+#else
+    return acc + dot8u_sw(a_packed, b_packed);
+#endif
+}
+
+/* 8-lane MACs: acc + dot(a_lo, b_lo) + dot(a_hi, b_hi). The instruction reads the
+ * high words from the registers after rs1 and rs2, so the operands are pinned to
+ * the pairs a2/a3 (a) and a4/a5 (b). custom-0, funct7=0x05 (signed a), 0x06 (u8 a). */
+#if DOT8_USE_ASM
+#  define DOT8_MAC8_ASM(insn, acc, a_lo, a_hi, b_lo, b_hi) do {       \
+        register uint32_t dot8_a_lo __asm__("a2") = (a_lo);             \
+        register uint32_t dot8_a_hi __asm__("a3") = (a_hi);             \
+        register uint32_t dot8_b_lo __asm__("a4") = (b_lo);             \
+        register uint32_t dot8_b_hi __asm__("a5") = (b_hi);             \
+        __asm__ volatile (                                              \
+            insn ", %0, %1, %2"                                         \
+            : "+r"(acc)                                                 \
+            : "r"(dot8_a_lo), "r"(dot8_b_lo), "r"(dot8_a_hi), "r"(dot8_b_hi)); \
+    } while (0)
+#endif
+
+static inline int32_t dot8_mac8(int32_t acc, uint32_t a_lo, uint32_t a_hi, uint32_t b_lo, uint32_t b_hi)
+{
+#if DOT8_USE_ASM
+    DOT8_MAC8_ASM("custom0 5", acc, a_lo, a_hi, b_lo, b_hi);
+    return acc;
+#else
+    return acc + dot8_sw(a_lo, b_lo) + dot8_sw(a_hi, b_hi);
+#endif
+}
+
+static inline int32_t dot8u_mac8(int32_t acc, uint32_t a_lo, uint32_t a_hi, uint32_t b_lo, uint32_t b_hi)
+{
+#if DOT8_USE_ASM
+    DOT8_MAC8_ASM("custom0 6", acc, a_lo, a_hi, b_lo, b_hi);
+    return acc;
+#else
+    return acc + dot8u_sw(a_lo, b_lo) + dot8u_sw(a_hi, b_hi);
+#endif
+}
+
+/* Software reference: saturate to int8 (-128..127). */
+static inline int32_t dot8_clip8_sw(int32_t x)
+{
+    return x > 127 ? 127 : (x < -128 ? -128 : x);
+}
+
+/* SAT8: clip8(x >> sh) (arithmetic, truncating; sh 0..31), sign-extended.
+ * custom-0, funct7=0x0A. saturate(acc >> 7) in one instruction. */
+static inline int32_t dot8_sat8(int32_t x, uint32_t sh)
+{
+#if DOT8_USE_ASM
+    int32_t result;
+    __asm__ volatile (
+        "custom0 10, %0, %1, %2"
+        : "=r"(result)
+        : "r"(x), "r"(sh)
+    );
+    return result;
+#else
+    return dot8_clip8_sw(x >> (sh & 31u));
+#endif
+}
+
+/* SAT8R: clip8((x + 2^(sh-1)) >> sh), rounding half up (no rounding for sh = 0).
+ * The add does not wrap. custom-0, funct7=0x0B. */
+static inline int32_t dot8_sat8r(int32_t x, uint32_t sh)
+{
+#if DOT8_USE_ASM
+    int32_t result;
+    __asm__ volatile (
+        "custom0 11, %0, %1, %2"
+        : "=r"(result)
+        : "r"(x), "r"(sh)
+    );
+    return result;
+#else
+    sh &= 31u;
+    if (sh == 0u) return dot8_clip8_sw(x);
+    return dot8_clip8_sw((int32_t)(((int64_t)x + ((int64_t)1 << (sh - 1))) >> sh));
+#endif
+}
+
+/* MAX4: lane-wise signed int8 max of two packed words; dot8_max4(v, 0) is a 4-lane ReLU.
+ * custom-0, funct7=0x0C. */
+static inline uint32_t dot8_max4(uint32_t a_packed, uint32_t b_packed)
+{
+#if DOT8_USE_ASM
+    uint32_t result;
+    __asm__ volatile (
+        "custom0 12, %0, %1, %2"
+        : "=r"(result)
+        : "r"(a_packed), "r"(b_packed)
+    );
+    return result;
+#else
+    uint32_t r = 0;
+    int i;
+    for (i = 0; i < 4; i++) {
+        int8_t x = (int8_t)(a_packed >> (8 * i));
+        int8_t y = (int8_t)(b_packed >> (8 * i));
+        r |= (uint32_t)(uint8_t)(x > y ? x : y) << (8 * i);
+    }
+    return r;
+#endif
+}
+
+/* PACK2.SAT: (w >> 16) | clip8(x) << 16 | clip8(y) << 24, with w as an in/out operand:
+ * w = dot8_pack2_sat(w, x0, x1); w = dot8_pack2_sat(w, x2, x3) leaves x0..x3 in lanes 0..3
+ * (dot8_pack order). custom-0, funct7=0x0D. */
+static inline uint32_t dot8_pack2_sat(uint32_t w, int32_t x, int32_t y)
+{
+#if DOT8_USE_ASM
+    __asm__ volatile (
+        "custom0 13, %0, %1, %2"
+        : "+r"(w)
+        : "r"(x), "r"(y)
+    );
+    return w;
+#else
+    return (w >> 16)
+         | ((uint32_t)(uint8_t)dot8_clip8_sw(x) << 16)
+         | ((uint32_t)(uint8_t)dot8_clip8_sw(y) << 24);
+#endif
+}
+
+/* MAX: signed int32 max without a branch. custom-0, funct7=0x0E. */
+static inline int32_t dot8_max(int32_t a, int32_t b)
+{
+#if DOT8_USE_ASM
+    int32_t result;
+    __asm__ volatile (
+        "custom0 14, %0, %1, %2"
+        : "=r"(result)
+        : "r"(a), "r"(b)
+    );
+    return result;
+#else
+    return a > b ? a : b;
+#endif
+}
+
 /* 4-lane signed int8 dot-product: sum_i (a_i * b_i), result int32.
  * When USE_DOT8_HW: uses custom-0 instruction (opcode 0x0B, funct7=0x01).
  * Otherwise: software reference. */
 int32_t dot8_4_lanes(uint32_t a_packed, uint32_t b_packed);
 
+/* Register-blocked matvec over packed operands (4 output rows x 1 input vector):
+ *   y[r] += sum_i dot8(w[r * words + i], x[i])   for r in [0, rows)
+ * w: [rows][words] packed weight rows, x: [words] packed input, y: int32 (pre-set
+ * to the bias). Each x word is loaded once per 4-row block and reused for all four
+ * rows; rows need not be a multiple of 4 (remainder rows run one at a time).
+ * With DOT8_HWLOOP and an even words count, the block loop is a hardware loop. */
+void dot8_matvec_4x1(const uint32_t *w, const uint32_t *x, int32_t *y, int rows, int words);
+
+/* Presence check for images that run on cores with and without the plugin: executes one
+ * DOT8 and returns 1 if it gave the right result, 0 if it trapped as an illegal
+ * instruction or gave a wrong one. The trap handler must call dot8_trap() for exceptions
+ * (litex_port/isr.c does), otherwise a core without DOT8 re-traps forever. Always 1 for
+ * the software fallback. */
+int dot8_probe(void);
+
+/* Exception hook: if a dot8_probe() instruction raised the pending illegal-instruction
+ * trap, steps mepc over it, notes the fault and returns 1; otherwise returns 0. */
+int dot8_trap(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,97 @@
+/*
+ * VexRiscv plugin: exp LUT custom instructions (Q10 exp(0)..exp(-15), same table as exp_lut.v).
+ *
+ * Opcode: custom-0 = 0x0B, shared with Dot8Plugin (funct7 0x01..0x06, 0x0A..0x0E).
+ * funct7 = 0x07 (EXP):    rd = lut[min(rs1, 15)]                       rs1 unsigned index
+ * funct7 = 0x08 (EXP2):   rd = lut[idx[8p+7:8p+4]] << 16 | lut[idx[8p+3:8p]]
+ *                         with idx = rs1 (8 packed 4-bit indices, as exp_lut_hw_row) and
+ *                         p = rs2[1:0]: lanes 2p and 2p+1, the same halves as VAL0..VAL3.
+ * funct7 = 0x09 (EXP.Q3): rd = lut[i] - ((lut[i] - lut[i + 1]) * f) >> 3,
+ *                         q = min(rs1, 120), i = q >> 3, f = q & 7 (lut[16] reads as lut[15]).
+ *
+ * Single-cycle execute, two ordinary sources (no shadow registers, no stalls of its own).
+ * Matches hw_extensions/exp_lut/sw/exp_lut.h and exp_lut_spec.md.
+ */
+
+package vexriscv.plugin
+
+import spinal.core._
+import spinal.lib._
+import vexriscv.{DecoderService, Stageable, VexRiscv}
+
+object ExpLutPlugin {
+  val EXP_FUNCT7    = B(0x07, 7 bits)
+  val EXP2_FUNCT7   = B(0x08, 7 bits)
+  val EXP_Q3_FUNCT7 = B(0x09, 7 bits)
+  val EXP_OPCODE    = B(0x0B, 7 bits)
+
+  /* Must match exp_lut.v and tinyformer.c exp_lut[16] */
+  val TABLE = Seq(1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12)
+
+  object EXP_LUT_OP extends Stageable(Bool())
+  object EXP_LUT_RD extends Stageable(Bits(32 bits))
+}
+
+class ExpLutPlugin extends Plugin[VexRiscv] {
+
+  override def setup(pipeline: VexRiscv): Unit = {
+    import pipeline.config._
+    import ExpLutPlugin._
+    val decoder = pipeline.service(classOf[DecoderService])
+    decoder.addDefault(EXP_LUT_OP, False)
+  }
+
+  override def build(pipeline: VexRiscv): Unit = {
+    import pipeline._
+    import pipeline.config._
+    import ExpLutPlugin._
+
+    val decode = pipeline.decode
+    val execute = pipeline.execute
+    val writeback = pipeline.writeback
+
+    val instr = decode.input(INSTRUCTION)
+    val funct7 = instr(31 downto 25)
+    val isExp = instr(6 downto 0) === EXP_OPCODE &&
+                (funct7 === EXP_FUNCT7 || funct7 === EXP2_FUNCT7 || funct7 === EXP_Q3_FUNCT7)
+
+    decode.insert(EXP_LUT_OP) := isExp
+    when(isExp) {
+      decode.insert(REGFILE_WRITE_VALID) := True
+    }
+
+    val lut = Vec(TABLE.map(v => U(v, 16 bits)))
+    def exp4(i: Bits): UInt = lut(i.asUInt)
+
+    val rs1 = execute.input(RS1).asUInt
+    val rs2 = execute.input(RS2)
+    val exFunct7 = execute.input(INSTRUCTION)(31 downto 25)
+
+    /* EXP: clamp, then one table read */
+    val expIdx = Mux(rs1 > 15, U(15, 4 bits), rs1(3 downto 0))
+    val expOne = exp4(expIdx.asBits)
+
+    /* EXP2: byte p of rs1 holds lanes 2p (low nibble) and 2p+1 (high nibble) */
+    val pairByte = execute.input(RS1).subdivideIn(8 bits)(rs2(1 downto 0).asUInt)
+    val expPair = exp4(pairByte(7 downto 4)) ## exp4(pairByte(3 downto 0))
+
+    /* EXP.Q3: interpolate between entry i and the next one by f / 8 */
+    val q = Mux(rs1 > 120, U(120, 7 bits), rs1(6 downto 0))
+    val qi = q(6 downto 3)
+    val qf = q(2 downto 0)
+    val qa = lut(qi)
+    val qb = lut(Mux(qi === 15, qi, qi + 1))
+    val expQ3 = qa - ((qa - qb) * qf >> 3).resize(16)
+
+    execute.insert(EXP_LUT_RD) := exFunct7.mux(
+      EXP_FUNCT7    -> expOne.resize(32).asBits,
+      EXP2_FUNCT7   -> expPair,
+      default       -> expQ3.resize(32).asBits
+    )
+
+    when(writeback.input(EXP_LUT_OP)) {
+      writeback.output(REGFILE_WRITE_DATA) := writeback.input(EXP_LUT_RD)
+    }
+    /* As with Dot8Plugin: if your build muxes REGFILE_WRITE_DATA from several plugins, add EXP_LUT_RD to that mux when EXP_LUT_OP. */
+  }
+}
@@ -6,6 +6,10 @@
  *
  * Standalone module; no LiteX CSR glue yet. For use as MMIO peripheral:
  * - Register: write index → latch; read data → LUT output.
+ *
+ * exp_lut_vec (below) evaluates eight packed indices at once for the
+ * row-at-a-time softmax path (see exp_lut_spec.md, "Vector mode");
+ * exp_lut_interp interpolates between entries for a Q3 fractional index.
  */
 
 module exp_lut (
@@ -49,3 +53,76 @@ module exp_lut (
     assign value = lut[addr];
 
 endmodule
+
+/*
+ * Vector form: eight 4-bit indices per 32-bit word (lane k = idx[4k+3:4k],
+ * 0 = exp(0) .. 15 = exp(-15)) give eight Q10 values, lane k in
+ * values[16k+15:16k], and their sum. Combinational, one exp_lut per lane.
+ */
+module exp_lut_vec (
+    input  wire         clk,
+    input  wire         reset,
+
+    input  wire [31:0]  idx,
+
+    output wire [127:0] values,
+    /* Sum of the eight lanes (<= 8 * 1024). */
+    output wire [15:0]  lane_sum
+);
+
+    genvar k;
+    generate
+        for (k = 0; k < 8; k = k + 1) begin : g_lane
+            exp_lut u_lut (
+                .clk(clk),
+                .reset(reset),
+                .index({1'b0, idx[4 * k + 3 : 4 * k]}),
+                .value(values[16 * k + 15 : 16 * k])
+            );
+        end
+    endgenerate
+
+    assign lane_sum = (values[15:0]    + values[31:16])
+                    + (values[47:32]   + values[63:48])
+                    + (values[79:64]   + values[95:80])
+                    + (values[111:96]  + values[127:112]);
+
+endmodule
+
+/*
+ * Interpolating form: index_q3 = -x in Q3 (0..120 = exp(0)..exp(-15); larger
+ * values clamp to exp(-15)). value = lut[i] - ((lut[i] - lut[i+1]) * f) >> 3
+ * with i = index_q3[6:3], f = index_q3[2:0]; matches exp_lut_hw_interp().
+ */
+module exp_lut_interp (
+    input  wire        clk,
+    input  wire        reset,
+
+    input  wire [6:0]  index_q3,
+    output wire [15:0] value
+);
+
+    wire        sat = (index_q3 >= 7'd120);
+    wire [3:0]  i   = sat ? 4'd15 : index_q3[6:3];
+    wire [2:0]  f   = sat ? 3'd0  : index_q3[2:0];
+    wire [15:0] v_lo;
+    wire [15:0] v_hi;
+
+    /* v_hi = lut[i + 1]; unused (f = 0) when i = 15 */
+    exp_lut u_lo (
+        .clk(clk),
+        .reset(reset),
+        .index({1'b0, i}),
+        .value(v_lo)
+    );
+    exp_lut u_hi (
+        .clk(clk),
+        .reset(reset),
+        .index({1'b0, i + 4'd1}),
+        .value(v_hi)
+    );
+
+    wire [18:0] step = (v_lo - v_hi) * f;
+    assign value = v_lo - step[18:3];
+
+endmodule
@@ -1,5 +1,8 @@
 # Exp LUT — LiteX CSR wrapper.
 # Index 0..15 (write); value Q10 16-bit (read). Uses .re for strobes where applicable.
+# Vector mode: idx_first/idx_next take 8 packed 4-bit indices; val0..val3 return
+# the 8 Q10 results (2 per word) and sum the running row sum.
+# index_q3/value_q3: interpolated exp for a Q3 fractional index (exp_lut_interp).
 
 from migen import *
 from litex.soc.interconnect.csr import AutoCSR, CSRStorage, CSRStatus
@@ -30,3 +33,67 @@ class ExpLUTPeripheral(Module, AutoCSR):
             o_value=self.value_data,
         )
         self.comb += self.value.status.eq(self.value_data)
+
+        self._add_vector()
+        self._add_interp()
+
+    def _add_interp(self):
+        self.index_q3 = CSRStorage(7, name="index_q3", description="Q3 fractional index 0..120 (write)")
+        self.value_q3 = CSRStatus(16, name="value_q3", description="Interpolated Q10 exp value (read)")
+        self.specials += Instance(
+            "exp_lut_interp",
+            i_clk=ClockSignal(),
+            i_reset=ResetSignal(),
+            i_index_q3=self.index_q3.storage,
+            o_value=self.value_q3.status,
+        )
+
+    def _add_vector(self):
+        self.idx_first = CSRStorage(32, name="idx_first",
+            description="8 packed indices (lane k = bits 4k+3:4k); restarts the row sum")
+        self.idx_next = CSRStorage(32, name="idx_next",
+            description="8 packed indices; added to the row sum")
+        self.val0 = CSRStatus(32, name="val0", description="Q10 of lanes 0 (low) and 1 (high)")
+        self.val1 = CSRStatus(32, name="val1", description="Q10 of lanes 2 (low) and 3 (high)")
+        self.val2 = CSRStatus(32, name="val2", description="Q10 of lanes 4 (low) and 5 (high)")
+        self.val3 = CSRStatus(32, name="val3", description="Q10 of lanes 6 (low) and 7 (high)")
+        self.sum = CSRStatus(32, name="sum", description="Sum of all lanes since idx_first")
+
+        # Last written word; its lane sum is folded into the row sum on the
+        # following cycle, well before the CPU can read sum back.
+        vec_idx = Signal(32)
+        vec_first = Signal()
+        vec_pending = Signal()
+        vec_values = Signal(128)
+        vec_lane_sum = Signal(16)
+        vec_sum = Signal(32)
+
+        self.sync += [
+            vec_pending.eq(self.idx_first.re | self.idx_next.re),
+            If(self.idx_first.re,
+                vec_idx.eq(self.idx_first.storage),
+                vec_first.eq(1),
+            ).Elif(self.idx_next.re,
+                vec_idx.eq(self.idx_next.storage),
+                vec_first.eq(0),
+            ),
+            If(vec_pending,
+                vec_sum.eq(Mux(vec_first, 0, vec_sum) + vec_lane_sum),
+            ),
+        ]
+
+        self.specials += Instance(
+            "exp_lut_vec",
+            i_clk=ClockSignal(),
+            i_reset=ResetSignal(),
+            i_idx=vec_idx,
+            o_values=vec_values,
+            o_lane_sum=vec_lane_sum,
+        )
+        self.comb += [
+            self.val0.status.eq(vec_values[0:32]),
+            self.val1.status.eq(vec_values[32:64]),
+            self.val2.status.eq(vec_values[64:96]),
+            self.val3.status.eq(vec_values[96:128]),
+            self.sum.status.eq(vec_sum),
+        ]
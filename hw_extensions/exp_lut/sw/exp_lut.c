@@ -2,10 +2,18 @@
  * Exp LUT driver. Golden table matches litex_port/tinyformer.c exp_lut[16] (Q10).
  * Defining USE_EXP_LUT_HW requires the SoC to include the corresponding HW block; otherwise keep macro off.
  * USE_EXP_LUT_HW: use MMIO. EXP_LUT_USE_LITEX_CSR + generated/csr.h, or EXP_LUT_BASE for raw MMIO.
+ * USE_EXP_LUT_INSN: use the ExpLutPlugin instructions (exp_lut.h); off target, the golden table.
  */
 
 #include "exp_lut.h"
-#if defined(USE_EXP_LUT_HW) && defined(EXP_LUT_USE_LITEX_CSR)
+
+#if defined(USE_EXP_LUT_HW) && !defined(USE_EXP_LUT_INSN)
+#  define EXP_LUT_MMIO 1
+#else
+#  define EXP_LUT_MMIO 0
+#endif
+
+#if EXP_LUT_MMIO && defined(EXP_LUT_USE_LITEX_CSR)
 #  include <generated/csr.h>
 #endif
 
@@ -14,9 +22,10 @@ static const uint16_t exp_lut_golden[16] = {
     1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12
 };
 
+#if !EXP_LUT_USE_ASM
 uint16_t exp_lut_hw(unsigned idx)
 {
-#if defined(USE_EXP_LUT_HW)
+#if EXP_LUT_MMIO
     if (idx > 15u) return exp_lut_golden[15];
 #  if defined(EXP_LUT_USE_LITEX_CSR)
     exp_lut_index_write((uint32_t)idx);
@@ -31,3 +40,111 @@ uint16_t exp_lut_hw(unsigned idx)
     return exp_lut_golden[idx];
 #endif
 }
+
+uint32_t exp_lut_op2_sw(uint32_t packed, unsigned pair)
+{
+    unsigned lanes = (packed >> (8u * (pair & 3u))) & 0xFFu;
+    return (uint32_t)exp_lut_golden[lanes & 0xFu] | ((uint32_t)exp_lut_golden[lanes >> 4] << 16);
+}
+#endif
+
+int exp_lut_probe(void)
+{
+    unsigned i;
+    for (i = 0; i < 16u; i++) {
+        if (exp_lut_hw(i) != exp_lut_golden[i]) return 0;
+    }
+    return 1;
+}
+
+#if !EXP_LUT_USE_ASM
+uint16_t exp_lut_hw_interp(unsigned idx_q3)
+{
+    if (idx_q3 > EXP_LUT_Q3_MAX) idx_q3 = EXP_LUT_Q3_MAX;
+#if EXP_LUT_MMIO
+#  if defined(EXP_LUT_USE_LITEX_CSR)
+    exp_lut_index_q3_write((uint32_t)idx_q3);
+    return (uint16_t)exp_lut_value_q3_read();
+#  else
+    /* Raw MMIO: INDEX_Q3 at 0x24, VALUE_Q3 at 0x28 */
+    *(volatile uint32_t *)(EXP_LUT_BASE + 0x24) = (uint32_t)idx_q3;
+    return (uint16_t)(*(volatile uint32_t *)(EXP_LUT_BASE + 0x28) & 0xFFFFu);
+#  endif
+#else
+    {
+        unsigned i = idx_q3 >> 3, f = idx_q3 & 7u;
+        if (i == 15u) return exp_lut_golden[15];
+        return (uint16_t)(exp_lut_golden[i] -
+                          (((uint32_t)(exp_lut_golden[i] - exp_lut_golden[i + 1]) * f) >> 3));
+    }
+#endif
+}
+#endif
+
+#if EXP_LUT_MMIO
+#  if defined(EXP_LUT_USE_LITEX_CSR)
+#    define EXP_LUT_IDX_FIRST(v) exp_lut_idx_first_write(v)
+#    define EXP_LUT_IDX_NEXT(v)  exp_lut_idx_next_write(v)
+#    define EXP_LUT_VAL0()       exp_lut_val0_read()
+#    define EXP_LUT_VAL1()       exp_lut_val1_read()
+#    define EXP_LUT_VAL2()       exp_lut_val2_read()
+#    define EXP_LUT_VAL3()       exp_lut_val3_read()
+#    define EXP_LUT_SUM()        exp_lut_sum_read()
+#  else
+/* Raw MMIO: IDX_FIRST 0x08, IDX_NEXT 0x0C, VAL0..VAL3 0x10..0x1C, SUM 0x20 */
+#    define EXP_LUT_REG(off)     (*(volatile uint32_t *)(EXP_LUT_BASE + (off)))
+#    define EXP_LUT_IDX_FIRST(v) (EXP_LUT_REG(0x08) = (v))
+#    define EXP_LUT_IDX_NEXT(v)  (EXP_LUT_REG(0x0C) = (v))
+#    define EXP_LUT_VAL0()       EXP_LUT_REG(0x10)
+#    define EXP_LUT_VAL1()       EXP_LUT_REG(0x14)
+#    define EXP_LUT_VAL2()       EXP_LUT_REG(0x18)
+#    define EXP_LUT_VAL3()       EXP_LUT_REG(0x1C)
+#    define EXP_LUT_SUM()        EXP_LUT_REG(0x20)
+#  endif
+#endif
+
+uint32_t exp_lut_hw_row(const uint32_t *idx, uint16_t *out, int n)
+{
+    uint32_t sum = 0;
+    int w, k;
+    int full = n / 8;
+
+#if EXP_LUT_USE_ASM
+    for (w = 0; w < full; w++) {
+        for (k = 0; k < 4; k++) {
+            uint32_t v = exp_lut_op2(idx[w], (unsigned)k);
+            out[2 * k]     = (uint16_t)v;
+            out[2 * k + 1] = (uint16_t)(v >> 16);
+            sum += (v & 0xFFFFu) + (v >> 16);
+        }
+        out += 8;
+    }
+#elif EXP_LUT_MMIO
+    for (w = 0; w < full; w++) {
+        uint32_t v;
+        if (w == 0) EXP_LUT_IDX_FIRST(idx[0]);
+        else        EXP_LUT_IDX_NEXT(idx[w]);
+        v = EXP_LUT_VAL0(); out[0] = (uint16_t)v; out[1] = (uint16_t)(v >> 16);
+        v = EXP_LUT_VAL1(); out[2] = (uint16_t)v; out[3] = (uint16_t)(v >> 16);
+        v = EXP_LUT_VAL2(); out[4] = (uint16_t)v; out[5] = (uint16_t)(v >> 16);
+        v = EXP_LUT_VAL3(); out[6] = (uint16_t)v; out[7] = (uint16_t)(v >> 16);
+        out += 8;
+    }
+    if (full > 0) sum = EXP_LUT_SUM();
+#else
+    for (w = 0; w < full; w++) {
+        for (k = 0; k < 8; k++) {
+            uint16_t e = exp_lut_golden[(idx[w] >> (4 * k)) & 0xFu];
+            out[k] = e;
+            sum += e;
+        }
+        out += 8;
+    }
+#endif
+    for (k = 0; k < n - 8 * full; k++) {
+        uint16_t e = exp_lut_hw((idx[full] >> (4 * k)) & 0xFu);
+        out[k] = e;
+        sum += e;
+    }
+    return sum;
+}
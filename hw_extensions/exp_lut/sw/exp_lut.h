@@ -3,6 +3,12 @@
  * Defining USE_EXP_LUT_HW requires the SoC to include the corresponding HW block; otherwise keep macro off.
  * When USE_EXP_LUT_HW: read from MMIO (write index, read value).
  * Otherwise: return software golden table (matches tinyformer.c exp_lut[]).
+ * exp_lut_hw_row() evaluates a whole packed row through the vector registers.
+ *
+ * USE_EXP_LUT_INSN (with USE_EXP_LUT_HW) replaces the MMIO peripheral by the ExpLutPlugin
+ * custom-0 instructions (funct7 0x07..0x09, see ExpLutPlugin.scala): exp_lut_hw() and
+ * exp_lut_hw_interp() become static inline single instructions and exp_lut_hw_row() returns
+ * two lanes per instruction. The CPU must include the plugin; without it they trap.
  */
 
 #ifndef EXP_LUT_H
@@ -10,15 +16,113 @@
 
 #include <stdint.h>
 
+#if defined(USE_EXP_LUT_INSN) && defined(__riscv)
+#  define EXP_LUT_USE_ASM 1
+#else
+#  define EXP_LUT_USE_ASM 0
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* Index 0..15 → exp(0)..exp(-15) in Q10 (value/1024). Returns 16-bit. */
+#if !EXP_LUT_USE_ASM
 uint16_t exp_lut_hw(unsigned idx);
+#endif
+
+/* Fractional index 0..EXP_LUT_Q3_MAX in Q3 (idx_q3 / 8 = -x): linear interpolation
+ * between golden[idx_q3 >> 3] and the next entry by (idx_q3 & 7) / 8, truncated; larger
+ * indices clamp to exp(-15). TINYFORMER_EXP_INTERP feeds it the unshifted max-subtracted score. */
+#define EXP_LUT_Q3_MAX (15u * 8u)
+#if !EXP_LUT_USE_ASM
+uint16_t exp_lut_hw_interp(unsigned idx_q3);
+#endif
+
+/* Packs 8 LUT indices per word: lane k of word w (bits 4k+3:4k) is element 8w+k. */
+#define EXP_LUT_ROW_WORDS(n) (((n) + 7) / 8)
+
+/* Row of n indices 0..15 packed as above → n Q10 values in out; returns their sum.
+ * With USE_EXP_LUT_HW each full word costs one CSR write and four reads (plus one
+ * sum read per row) instead of 8 writes and 8 reads; the n % 8 tail uses exp_lut_hw().
+ * With USE_EXP_LUT_INSN each full word is four exp_lut_op2() and the sum is done in software. */
+uint32_t exp_lut_hw_row(const uint32_t *idx, uint16_t *out, int n);
+
+/* Presence check: 1 if exp_lut_hw() returns the golden table for every index
+ * (an absent peripheral in the CSR map reads as 0). Always 1 without USE_EXP_LUT_HW.
+ * With USE_EXP_LUT_INSN it checks the plugin's table, but cannot detect a missing
+ * plugin: the instruction traps as illegal instead. */
+int exp_lut_probe(void);
+
+#if !EXP_LUT_USE_ASM
+/* Software fallback of exp_lut_op2(), for hosts and builds without USE_EXP_LUT_INSN. */
+uint32_t exp_lut_op2_sw(uint32_t packed, unsigned pair);
+#endif
 
 #ifdef __cplusplus
 }
 #endif
 
+/* One EXP: rd = exp(-min(idx, 15)) in Q10. custom-0, funct7=0x07. */
+static inline uint32_t exp_lut_op(uint32_t idx)
+{
+#if EXP_LUT_USE_ASM
+    uint32_t result;
+    __asm__ volatile (
+        "custom0 7, %0, %1, x0"
+        : "=r"(result)
+        : "r"(idx)
+    );
+    return result;
+#else
+    return exp_lut_hw(idx);
+#endif
+}
+
+/* One EXP2: lanes 2*pair and 2*pair+1 of a packed index word (pair 0..3) →
+ * exp(lane 2*pair) | exp(lane 2*pair+1) << 16. custom-0, funct7=0x08. Two Q10 values
+ * per instruction: 1024 needs 11 bits, so four of them do not fit one register. */
+static inline uint32_t exp_lut_op2(uint32_t packed, unsigned pair)
+{
+#if EXP_LUT_USE_ASM
+    uint32_t result;
+    __asm__ volatile (
+        "custom0 8, %0, %1, %2"
+        : "=r"(result)
+        : "r"(packed), "r"(pair)
+    );
+    return result;
+#else
+    return exp_lut_op2_sw(packed, pair);
+#endif
+}
+
+/* One EXP.Q3: interpolated exp of a Q3 index, as exp_lut_hw_interp(). custom-0, funct7=0x09. */
+static inline uint32_t exp_lut_op_q3(uint32_t idx_q3)
+{
+#if EXP_LUT_USE_ASM
+    uint32_t result;
+    __asm__ volatile (
+        "custom0 9, %0, %1, x0"
+        : "=r"(result)
+        : "r"(idx_q3)
+    );
+    return result;
+#else
+    return exp_lut_hw_interp(idx_q3);
+#endif
+}
+
+#if EXP_LUT_USE_ASM
+static inline uint16_t exp_lut_hw(unsigned idx)
+{
+    return (uint16_t)exp_lut_op(idx);
+}
+
+static inline uint16_t exp_lut_hw_interp(unsigned idx_q3)
+{
+    return (uint16_t)exp_lut_op_q3(idx_q3);
+}
+#endif
+
 #endif /* EXP_LUT_H */
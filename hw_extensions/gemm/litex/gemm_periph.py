@@ -0,0 +1,121 @@
+# GEMM peripheral — LiteX CSR wrapper.
+#
+# Integrates gemm_core (Verilog) into a LiteX SoC via the CSR bus.
+# START, CLEAR and W_REWIND are one-cycle pulses (derived from CTRL write + dat_w bits);
+# BIAS is stored config. SHAPE holds M (tokens), N (channels) and K (inputs) of the next run
+# and the row length of the X_IN4 / W_IN4 streams, so write it before loading.
+# W_BASE is the first resident W row of the next run; W_REWIND points the W_IN4 / B_IN
+# streams at it, so every layer of the encoder can be loaded once.
+# Y_OUT / Y8_OUT read Y[m][n] row-major at the read pointer; writing Y_NEXT advances it by one,
+# or by four when the value is 4 (after a Y8_OUT read), as GEMV's Y_NEXT.
+# RQ_CFG configures the core's requant stage ([5:0]=shift, [6]=round, [7]=relu).
+# clock_gate=True (or "bufgce"; "latch" for simulation and other targets) clocks the core from
+# a gated copy of sys_clk (gemv/rtl/clk_gate.v), as GEMVPeripheral: CLK_EN (reset 1) turns it
+# on, 0 stops it once no run is busy, STATUS[2] (clk_on) reads whether it runs. The resident W/b
+# and Y are kept while it is off (GEMM_CLOCK_GATE firmware).
+#
+# Usage (in your SoC target):
+#   self.submodules.gemm = GEMMPeripheral()           # or GEMMPeripheral(pe=8)
+#   self.add_csr("gemm")
+#   self.add_source("path/to/rtl/gemm_core.v")
+#   self.add_source("path/to/gemv/rtl/clk_gate.v")    # clock_gate only
+
+from migen import *
+from litex.soc.interconnect.csr import AutoCSR, CSRStorage, CSRStatus
+
+
+class GEMMPeripheral(Module, AutoCSR):
+    """LiteX peripheral for gemm_core. CTRL, SHAPE, W_BASE, STATUS, X_IN4, W_IN4, B_IN, Y_OUT,
+    Y8_OUT, Y_NEXT, RQ_CFG (+ CLK_EN with clock_gate)."""
+
+    def __init__(self, pe=4, m_max=16, n_max=64, k_max=64, w_rows=256, clock_gate=False):
+        assert pe in (4, 8), "gemm_core: the PE array is 4x4 or 8x8"
+        assert m_max % pe == 0 and n_max % pe == 0 and w_rows % pe == 0 and w_rows <= 256
+        assert k_max % 4 == 0 and max(m_max, n_max, k_max) <= 128
+        assert clock_gate in (False, True, "bufgce", "latch")
+
+        # --- CTRL: [0]=start (pulse), [1]=clear (pulse), [2]=enable_bias (stored config),
+        #           [3]=w_rewind (pulse) ---
+        self.ctrl = CSRStorage(4, name="ctrl")
+        # --- SHAPE: [7:0]=M, [15:8]=N, [23:16]=K ---
+        self.shape = CSRStorage(24, name="shape", description="M tokens, N channels, K inputs of the next run")
+        self.w_base = CSRStorage(8, name="w_base", description="First W row of the next run and the W_IN4 / B_IN streams")
+        self.status = CSRStatus(3 if clock_gate else 2, name="status")  # [0]=busy, [1]=done — combinational from core, [2]=clk_on
+
+        # --- Packed stream registers: 4 int8 lanes per write, lane 0 in bits [7:0] ---
+        self.x_in4 = CSRStorage(32, name="x_in4", description="Write next 4 int8 X values, row-major (lane 0 = LSB)")
+        self.w_in4 = CSRStorage(32, name="w_in4", description="Write next 4 int8 W values, row-major (lane 0 = LSB)")
+        self.b_in = CSRStorage(32, name="b_in", description="Write next int32 bias value")
+
+        # --- Y: reads have no side effects; Y_NEXT advances the pointer ---
+        self.y_out = CSRStatus(32, name="y_out", description="Read int32 Y at current index")
+        self.y8_out = CSRStatus(32, name="y8_out", description="Read 4 requantized int8 Y at current index (lane 0 = LSB)")
+        self.y_next = CSRStorage(3, name="y_next", description="Write 1 to advance Y read pointer by one, 4 to advance by four (pulse)")
+
+        # --- Requant stage: RQ_CFG [5:0]=shift, [6]=round, [7]=relu ---
+        self.rq_cfg = CSRStorage(8, reset=7, name="rq_cfg", description="Requant: shift, round, relu")
+
+        # --- Core signals ---
+        self.busy = Signal()
+        self.done = Signal()
+        y_rd_data = Signal(32)
+        y8_rd_data = Signal(32)
+
+        # --- Core clock: sys_clk, or its gated copy (CLK_EN, held on while a run is busy) ---
+        core_clk = ClockSignal()
+        clk_on = Signal()
+        if clock_gate:
+            self.clk_en = CSRStorage(1, reset=1, name="clk_en",
+                description="1: core clock on; 0: off once no run is busy")
+            core_clk = Signal()
+            self.specials += Instance(
+                "clk_gate",
+                p_BUFGCE=int(clock_gate != "latch"),
+                i_clk=ClockSignal(),
+                i_reset=ResetSignal(),
+                i_en=self.clk_en.storage | self.busy,
+                o_gclk=core_clk,
+                o_on=clk_on,
+            )
+
+        self.comb += [
+            self.status.status.eq(Cat(self.busy, self.done, clk_on)),
+            self.y_out.status.eq(y_rd_data),
+            self.y8_out.status.eq(y8_rd_data),
+        ]
+
+        # --- Instantiate Verilog GEMM core ---
+        self.specials += Instance(
+            "gemm_core",
+            p_P=pe,                                         # P x P int8 PEs
+            p_M_MAX=m_max,
+            p_N_MAX=n_max,
+            p_K_MAX=k_max,
+            p_W_ROWS=w_rows,                                # resident W rows of k_max bytes
+            i_clk=core_clk,
+            i_reset=ResetSignal(),
+            i_x_wr_en=self.x_in4.re,
+            i_x_wr_data=self.x_in4.dat_w,
+            i_w_wr_en=self.w_in4.re,
+            i_w_wr_data=self.w_in4.dat_w,
+            i_b_wr_en=self.b_in.re,
+            i_b_wr_data=self.b_in.dat_w,
+            i_m_dim=self.shape.storage[0:8],
+            i_n_dim=self.shape.storage[8:16],
+            i_k_dim=self.shape.storage[16:24],
+            i_w_base=self.w_base.storage,
+            # START, CLEAR and W_REWIND: one-cycle pulses when CTRL is written with the bit set
+            i_start=self.ctrl.re & self.ctrl.dat_w[0],
+            i_clear=self.ctrl.re & self.ctrl.dat_w[1],
+            i_w_rewind=self.ctrl.re & self.ctrl.dat_w[3],
+            i_bias_en=self.ctrl.storage[2],
+            i_rq_shift=self.rq_cfg.storage[0:6],
+            i_rq_round=self.rq_cfg.storage[6],
+            i_rq_relu=self.rq_cfg.storage[7],
+            o_busy=self.busy,
+            o_done=self.done,
+            i_y_rd_en=self.y_next.re & self.y_next.dat_w[0],
+            i_y_rd4_en=self.y_next.re & self.y_next.dat_w[2],
+            o_y_rd_data=y_rd_data,
+            o_y8_rd_data=y8_rd_data,
+        )
@@ -0,0 +1,377 @@
+/*
+ * GEMM core: Y[m][n] = sum_k X[m][k] * W[n][k] + b[n] (b optional).
+ * int8 X, W; int32 b, Y. One run computes a whole projection of up to
+ * M_MAX tokens x N_MAX channels x K_MAX inputs from resident W and one X
+ * tile, instead of one GEMV start per token.
+ * Output-stationary systolic array of P x P int8 PEs: PE (i, j) owns
+ * Y[m0 + i][n0 + j] and accumulates one product per cycle. X row m0 + i
+ * enters the left edge of array row i delayed by i cycles, W row n0 + j
+ * the top of array column j delayed by j cycles; every PE passes its X
+ * byte right and its W byte down, so PE (i, j) sees X[.][k] and W[.][k]
+ * together at cycle k + i + j + 1. A P x P output tile takes
+ * K + 2P - 1 feed cycles and P store cycles (one array row per cycle).
+ * CSR-fed: the wrapper pushes X, W and b through packed write ports
+ * (4 int8 lanes per write, lane 0 = bits 7:0, as dot8_pack) and reads Y
+ * and the requantized Y8 back through a read pointer, as gemv_core.
+ * W (W_ROWS rows of K_MAX bytes) and b (one int32 per W row) stay
+ * resident: a run reads its N rows from row w_base on (latched at start),
+ * w_rewind points the W/b write ports at w_base, so several layers can be
+ * loaded once. clear rewinds the X write and Y read pointers only.
+ * Each Y is also requantized as it is stored:
+ *   y8 = sat8(relu?(acc + round) >>> shift)
+ * Memories are split in P banks so each cycle reads one word per array
+ * row/column: X by token (m % P), W and b by row (n % P), Y and Y8 by
+ * channel (n % P).
+ */
+
+module gemm_core #(
+    parameter P      = 4,     /* PE array is P x P: 4 or 8 */
+    parameter M_MAX  = 16,    /* tokens (X rows) per run, multiple of P */
+    parameter N_MAX  = 64,    /* output channels (W rows) per run, multiple of P */
+    parameter K_MAX  = 64,    /* inputs (X / W row bytes), multiple of 4 */
+    parameter W_ROWS = 256    /* resident W rows, multiple of P, at most 256 */
+) (
+    input  wire         clk,
+    input  wire         reset,
+
+    /* Packed write ports (driven by wrapper when CPU writes X_IN4, W_IN4, B_IN).
+     * X goes to X[m][k..k+3] in row-major order (row length k_dim), W to
+     * W[r][k..k+3] from row w_base on, b to b[r] from row w_base on. */
+    input  wire         x_wr_en,
+    input  wire [31:0]  x_wr_data,
+    input  wire         w_wr_en,
+    input  wire [31:0]  w_wr_data,
+    input  wire         b_wr_en,
+    input  wire [31:0]  b_wr_data,
+
+    /* Shape (from SHAPE; set before loading X / W and hold while busy) */
+    input  wire [7:0]   m_dim,       /* 1..M_MAX tokens */
+    input  wire [7:0]   n_dim,       /* P..N_MAX channels, multiple of P */
+    input  wire [7:0]   k_dim,       /* 4..K_MAX inputs, multiple of 4 */
+    /* First W row of the next run and of the W/b write ports (multiple of P) */
+    input  wire [7:0]   w_base,
+
+    /* Control (from CTRL) */
+    input  wire         start,
+    input  wire         clear,       /* clear done, rewind X write and Y read pointers */
+    input  wire         w_rewind,    /* point the W/b write pointers at w_base */
+    input  wire         bias_en,
+
+    /* Requant stage (from RQ_CFG; hold while busy) */
+    input  wire [5:0]   rq_shift,    /* arithmetic right shift, 0..32 */
+    input  wire         rq_round,    /* add 1 << (shift - 1) before the shift */
+    input  wire         rq_relu,     /* clamp negatives to 0 */
+
+    /* Status */
+    output reg          busy,
+    output reg          done,
+
+    /* Y read port, row-major Y[m][n]: y_rd_en advances the pointer by one,
+     * y_rd4_en by four (after a y8_rd_data read; n is a multiple of 4) */
+    input  wire         y_rd_en,
+    input  wire         y_rd4_en,
+    output wire [31:0]  y_rd_data,
+    output wire [31:0]  y8_rd_data
+);
+
+    localparam P_BITS  = $clog2(P);
+    localparam KW      = K_MAX / 4;            /* words per X / W row */
+    localparam NT      = N_MAX / P;            /* Y words per token and bank */
+    localparam XB_WORDS = (M_MAX / P) * KW;    /* words per X bank */
+    localparam WB_WORDS = (W_ROWS / P) * KW;   /* words per W bank */
+    localparam BB_WORDS = W_ROWS / P;          /* words per b bank */
+    localparam YB_WORDS = M_MAX * NT;          /* words per Y / Y8 bank */
+
+    /* --- Write pointers --- */
+    reg [7:0]  x_wr_m;     /* token */
+    reg [7:0]  x_wr_k;     /* byte in row, multiple of 4 */
+    reg [8:0]  w_wr_r;     /* absolute W row */
+    reg [7:0]  w_wr_k;
+    reg [8:0]  b_wr_r;     /* absolute b row */
+    wire       x_wr_ok = x_wr_en && !busy && x_wr_m < M_MAX;
+    wire       w_wr_ok = w_wr_en && !busy && w_wr_r < W_ROWS;
+    wire       b_wr_ok = b_wr_en && !busy && b_wr_r < W_ROWS;
+    wire [31:0] x_wr_addr = (x_wr_m >> P_BITS) * KW + (x_wr_k >> 2);
+    wire [31:0] w_wr_addr = (w_wr_r >> P_BITS) * KW + (w_wr_k >> 2);
+    wire [31:0] b_wr_addr = b_wr_r >> P_BITS;
+
+    always @(posedge clk) begin
+        if (reset) begin
+            x_wr_m <= 0;
+            x_wr_k <= 0;
+            w_wr_r <= 0;
+            w_wr_k <= 0;
+            b_wr_r <= 0;
+        end else begin
+            if (clear) begin
+                x_wr_m <= 0;
+                x_wr_k <= 0;
+            end else if (x_wr_ok) begin
+                if (x_wr_k + 8'd4 >= k_dim) begin
+                    x_wr_k <= 0;
+                    x_wr_m <= x_wr_m + 1;
+                end else
+                    x_wr_k <= x_wr_k + 4;
+            end
+            if (w_rewind) begin
+                w_wr_r <= {1'b0, w_base};
+                w_wr_k <= 0;
+                b_wr_r <= {1'b0, w_base};
+            end else begin
+                if (w_wr_ok) begin
+                    if (w_wr_k + 8'd4 >= k_dim) begin
+                        w_wr_k <= 0;
+                        w_wr_r <= w_wr_r + 1;
+                    end else
+                        w_wr_k <= w_wr_k + 4;
+                end
+                if (b_wr_ok)
+                    b_wr_r <= b_wr_r + 1;
+            end
+        end
+    end
+
+    /* --- Tile walk: tile (mt, nt) covers Y[mt*P ..][nt*P ..] --- */
+    localparam [1:0] S_IDLE  = 2'd0,
+                     S_FEED  = 2'd1,
+                     S_STORE = 2'd2,
+                     S_DONE  = 2'd3;
+    reg [1:0]  state;
+    reg [7:0]  mt;
+    reg [7:0]  nt;
+    reg [8:0]  t;          /* feed cycle, 0 .. K + 2P - 2 */
+    reg [7:0]  s;          /* store row, 0 .. P - 1 */
+    reg [7:0]  wb;         /* w_base / P, latched at start */
+
+    wire [8:0] feed_last = {1'b0, k_dim} + 2 * P - 2;
+    wire       last_nt   = (nt + 1) * P >= n_dim;
+    wire       last_mt   = (mt + 1) * P >= m_dim;
+    wire [7:0] m_store   = mt * P + s;
+
+    /* Array reset: entering the feed of a tile (start or after a store) */
+    wire       go        = (state == S_IDLE || state == S_DONE) && start && !busy;
+    wire       next_tile = (state == S_STORE) && (s == P - 1) && !(last_nt && last_mt);
+    wire       arr_clr   = go || next_tile;
+
+    /* Read addresses: the same word in every bank (token mt*P + i, row wb + nt, ..) */
+    wire [31:0] x_rd_addr = mt * KW + (t >> 2);
+    wire [31:0] w_rd_addr = (wb + nt) * KW + (t >> 2);
+    wire [31:0] b_rd_addr = wb + nt;
+    reg        rd_vld;     /* feed cycle t - 1 was a data cycle (t - 1 < K) */
+    reg [1:0]  rd_sel;     /* byte of the word read in cycle t - 1 */
+
+    always @(posedge clk) begin
+        if (reset) begin
+            rd_vld <= 0;
+            rd_sel <= 0;
+        end else begin
+            rd_vld <= (state == S_FEED) && (t < k_dim);
+            rd_sel <= t[1:0];
+        end
+    end
+
+    /* --- Banks, skew registers and PE array --- */
+    wire signed [7:0]  a_feed [0:P-1];      /* left edge of array row i, before skew */
+    wire signed [7:0]  b_feed [0:P-1];      /* top of array column j, before skew */
+    wire signed [7:0]  a_skew [0:P-1];
+    wire signed [7:0]  b_skew [0:P-1];
+    wire signed [31:0] bias   [0:P-1];      /* b of column j of the tile */
+    reg  signed [7:0]  a_dly  [0:P*P-1];    /* row i delay line: a_dly[i*P + d] */
+    reg  signed [7:0]  b_dly  [0:P*P-1];
+    reg  signed [7:0]  a_reg  [0:P*P-1];    /* PE (i, j) = index i*P + j */
+    reg  signed [7:0]  b_reg  [0:P*P-1];
+    reg  signed [31:0] acc    [0:P*P-1];
+    wire signed [7:0]  a_in   [0:P*P-1];
+    wire signed [7:0]  b_in   [0:P*P-1];
+    wire signed [31:0] y_col  [0:P-1];      /* Y of store row s, column j */
+    wire signed [7:0]  y8_col [0:P-1];
+    wire [31:0]        y_rd_bank  [0:P-1];
+    wire [7:0]         y8_rd_bank [0:P-1];
+
+    /* Y read pointer: token y_m, channel y_n (bank y_n % P, word y_m*NT + y_n/P) */
+    reg [7:0]  y_m;
+    reg [7:0]  y_n;
+    wire [31:0] y_rd_addr = y_m * NT + (y_n >> P_BITS);
+    wire [P_BITS-1:0] y_rd_b = y_n[P_BITS-1:0];
+    assign y_rd_data  = y_rd_bank[y_rd_b];
+    /* y_n is a multiple of 4 and P of 4, so the four banks share the word */
+    assign y8_rd_data = {y8_rd_bank[y_rd_b + 2'd3], y8_rd_bank[y_rd_b + 2'd2],
+                         y8_rd_bank[y_rd_b + 2'd1], y8_rd_bank[y_rd_b]};
+
+    genvar i, j;
+    generate
+        for (i = 0; i < P; i = i + 1) begin : g_bank
+            /* --- X bank i (tokens m % P == i), W and b bank i (rows r % P == i) --- */
+            reg [31:0] x_mem [0:XB_WORDS-1];
+            reg [31:0] w_mem [0:WB_WORDS-1];
+            reg [31:0] b_mem [0:BB_WORDS-1];
+            reg [31:0] x_q;
+            reg [31:0] w_q;
+            reg [31:0] b_q;
+            always @(posedge clk) begin
+                if (x_wr_ok && x_wr_m[P_BITS-1:0] == i)
+                    x_mem[x_wr_addr] <= x_wr_data;
+                if (w_wr_ok && w_wr_r[P_BITS-1:0] == i)
+                    w_mem[w_wr_addr] <= w_wr_data;
+                if (b_wr_ok && b_wr_r[P_BITS-1:0] == i)
+                    b_mem[b_wr_addr] <= b_wr_data;
+                x_q <= x_mem[x_rd_addr];
+                w_q <= w_mem[w_rd_addr];
+                b_q <= b_mem[b_rd_addr];
+            end
+            assign a_feed[i] = rd_vld ? x_q[8*rd_sel +: 8] : 8'sd0;
+            assign b_feed[i] = rd_vld ? w_q[8*rd_sel +: 8] : 8'sd0;
+            assign bias[i]   = bias_en ? b_q : 32'sd0;
+
+            /* --- Skew: row / column i enters i cycles late --- */
+            if (i == 0) begin : g_edge0
+                assign a_skew[i] = a_feed[i];
+                assign b_skew[i] = b_feed[i];
+            end else begin : g_edge
+                assign a_skew[i] = a_dly[i*P + i - 1];
+                assign b_skew[i] = b_dly[i*P + i - 1];
+            end
+
+            /* --- Y and Y8 bank i (channels n % P == i) --- */
+            reg signed [31:0] y_mem  [0:YB_WORDS-1];
+            reg signed [7:0]  y8_mem [0:YB_WORDS-1];
+            always @(posedge clk) begin
+                if (state == S_STORE && m_store < m_dim) begin
+                    y_mem[m_store * NT + nt]  <= y_col[i];
+                    y8_mem[m_store * NT + nt] <= y8_col[i];
+                end
+            end
+            assign y_rd_bank[i]  = y_mem[y_rd_addr];
+            assign y8_rd_bank[i] = y8_mem[y_rd_addr];
+
+            /* --- Store row s, column i: bias and requant --- */
+            wire signed [32:0] rq_in;
+            wire signed [32:0] rq_shr;
+            assign y_col[i] = acc[s[P_BITS-1:0]*P + i] + bias[i];
+            assign rq_in    = {y_col[i][31], y_col[i]} +
+                              ((rq_round && rq_shift != 6'd0) ? (33'sd1 <<< (rq_shift - 6'd1)) : 33'sd0);
+            assign rq_shr   = rq_in >>> rq_shift;
+            assign y8_col[i] = (rq_relu && rq_shr < 0) ? 8'sd0 :
+                               (rq_shr > 127)          ? 8'sd127 :
+                               (rq_shr < -128)         ? -8'sd128 :
+                                                         rq_shr[7:0];
+
+            /* --- PE inputs: X from the left, W from above --- */
+            for (j = 0; j < P; j = j + 1) begin : g_pe
+                if (j == 0) begin : g_a0
+                    assign a_in[i*P + j] = a_skew[i];
+                end else begin : g_a
+                    assign a_in[i*P + j] = a_reg[i*P + j - 1];
+                end
+                if (i == 0) begin : g_b0
+                    assign b_in[i*P + j] = b_skew[j];
+                end else begin : g_b
+                    assign b_in[i*P + j] = b_reg[(i - 1)*P + j];
+                end
+            end
+        end
+    endgenerate
+
+    /* --- Array: delay lines, PE registers and accumulators (feed cycles
+     * only; cleared when a tile starts, held through its store) --- */
+    integer e, d;
+    always @(posedge clk) begin
+        if (reset || arr_clr) begin
+            for (e = 0; e < P*P; e = e + 1) begin
+                a_dly[e] <= 0;
+                b_dly[e] <= 0;
+                a_reg[e] <= 0;
+                b_reg[e] <= 0;
+                acc[e]   <= 0;
+            end
+        end else if (state == S_FEED) begin
+            for (e = 0; e < P; e = e + 1) begin
+                a_dly[e*P] <= a_feed[e];
+                b_dly[e*P] <= b_feed[e];
+                for (d = 1; d < P; d = d + 1) begin
+                    a_dly[e*P + d] <= a_dly[e*P + d - 1];
+                    b_dly[e*P + d] <= b_dly[e*P + d - 1];
+                end
+            end
+            for (e = 0; e < P*P; e = e + 1) begin
+                a_reg[e] <= a_in[e];
+                b_reg[e] <= b_in[e];
+                acc[e]   <= acc[e] + a_in[e] * b_in[e];
+            end
+        end
+    end
+
+    /* --- Y read pointer: advance on read, reset on clear --- */
+    always @(posedge clk) begin
+        if (reset || clear) begin
+            y_m <= 0;
+            y_n <= 0;
+        end else if (y_rd_en || y_rd4_en) begin
+            if (y_n + (y_rd4_en && !y_rd_en ? 8'd4 : 8'd1) >= n_dim) begin
+                y_n <= 0;
+                y_m <= y_m + 1;
+            end else
+                y_n <= y_n + (y_rd4_en && !y_rd_en ? 8'd4 : 8'd1);
+        end
+    end
+
+    /* --- FSM: IDLE -> (FEED -> STORE) per tile -> DONE --- */
+    always @(posedge clk) begin
+        if (reset) begin
+            state <= S_IDLE;
+            busy  <= 0;
+            done  <= 0;
+            mt    <= 0;
+            nt    <= 0;
+            t     <= 0;
+            s     <= 0;
+            wb    <= 0;
+        end else begin
+            case (state)
+                S_IDLE, S_DONE: begin
+                    if (start) begin
+                        state <= S_FEED;
+                        busy  <= 1;
+                        done  <= 0;
+                        mt    <= 0;
+                        nt    <= 0;
+                        t     <= 0;
+                        wb    <= w_base >> P_BITS;
+                    end else if (clear) begin
+                        state <= S_IDLE;
+                        done  <= 0;
+                    end
+                end
+
+                S_FEED: begin
+                    if (t == feed_last) begin
+                        state <= S_STORE;
+                        s     <= 0;
+                    end else
+                        t <= t + 1;
+                end
+
+                S_STORE: begin
+                    if (s != P - 1)
+                        s <= s + 1;
+                    else if (last_nt && last_mt) begin
+                        state <= S_DONE;
+                        busy  <= 0;
+                        done  <= 1;
+                    end else begin
+                        state <= S_FEED;
+                        t     <= 0;
+                        if (last_nt) begin
+                            nt <= 0;
+                            mt <= mt + 1;
+                        end else
+                            nt <= nt + 1;
+                    end
+                end
+
+                default: state <= S_IDLE;
+            endcase
+        end
+    end
+
+endmodule
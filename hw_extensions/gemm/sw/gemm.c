@@ -0,0 +1,328 @@
+/*
+ * GEMM accelerator driver. Polling only.
+ * USE_GEMM_HW: GEMM_USE_LITEX_CSR + generated/csr.h, or GEMM_BASE / gemm_init() for raw
+ * MMIO. Without USE_GEMM_HW the calls run the C reference below, which keeps the block's
+ * resident W/b, X and Y memories in RAM (same results as the block).
+ */
+
+#include "gemm.h"
+#if defined(USE_GEMM_HW) && defined(GEMM_USE_LITEX_CSR)
+#  include <generated/csr.h>
+#endif
+
+#if GEMM_P != 4 && GEMM_P != 8
+#error "GEMM_P must be 4 or 8 (GEMMPeripheral(pe=...))"
+#endif
+
+#if defined(USE_GEMM_HW)
+#  if defined(GEMM_USE_LITEX_CSR)
+#    define GEMM_WRITE_CTRL(v)    gemm_ctrl_write((uint32_t)(v))
+#    define GEMM_WRITE_SHAPE(v)   gemm_shape_write((uint32_t)(v))
+#    define GEMM_WRITE_W_BASE(v)  gemm_w_base_write((uint32_t)(v))
+#    define GEMM_READ_STATUS()    gemm_status_read()
+#    define GEMM_WRITE_X4(v)      gemm_x_in4_write((uint32_t)(v))
+#    define GEMM_WRITE_W4(v)      gemm_w_in4_write((uint32_t)(v))
+#    define GEMM_WRITE_B(v)       gemm_b_in_write((uint32_t)(v))
+#    define GEMM_READ_Y()         gemm_y_out_read()
+#    define GEMM_READ_Y8()        gemm_y8_out_read()
+#    define GEMM_WRITE_Y_NEXT(v)  gemm_y_next_write((uint32_t)(v))
+#    define GEMM_WRITE_RQ(v)      gemm_rq_cfg_write((uint32_t)(v))
+#    if GEMM_CLOCK_GATE
+#      define GEMM_WRITE_CLK_EN(v) gemm_clk_en_write((uint32_t)(v))
+#    endif
+#  else
+#    ifndef GEMM_BASE
+#      define GEMM_BASE  s_gemm_base
+#    endif
+#    define GEMM_REG(off)         (*(volatile uint32_t *)(GEMM_BASE + (off)))
+#    define GEMM_WRITE_CTRL(v)    (GEMM_REG(GEMM_CTRL) = (uint32_t)(v))
+#    define GEMM_WRITE_SHAPE(v)   (GEMM_REG(GEMM_SHAPE) = (uint32_t)(v))
+#    define GEMM_WRITE_W_BASE(v)  (GEMM_REG(GEMM_W_BASE) = (uint32_t)(v))
+#    define GEMM_READ_STATUS()    GEMM_REG(GEMM_STATUS)
+#    define GEMM_WRITE_X4(v)      (GEMM_REG(GEMM_X_IN4) = (uint32_t)(v))
+#    define GEMM_WRITE_W4(v)      (GEMM_REG(GEMM_W_IN4) = (uint32_t)(v))
+#    define GEMM_WRITE_B(v)       (GEMM_REG(GEMM_B_IN) = (uint32_t)(v))
+#    define GEMM_READ_Y()         GEMM_REG(GEMM_Y_OUT)
+#    define GEMM_READ_Y8()        GEMM_REG(GEMM_Y8_OUT)
+#    define GEMM_WRITE_Y_NEXT(v)  (GEMM_REG(GEMM_Y_NEXT) = (uint32_t)(v))
+#    define GEMM_WRITE_RQ(v)      (GEMM_REG(GEMM_RQ_CFG) = (uint32_t)(v))
+#    define GEMM_WRITE_CLK_EN(v)  (GEMM_REG(GEMM_CLK_EN) = (uint32_t)(v))
+#  endif
+#endif
+
+#if GEMM_CLOCK_GATE
+#  define GEMM_POWER_GET()  gemm_power_get()
+#  define GEMM_POWER_PUT()  gemm_power_put()
+#else
+#  define GEMM_POWER_GET()  ((void)0)
+#  define GEMM_POWER_PUT()  ((void)0)
+#endif
+
+static uintptr_t s_gemm_base;
+
+#if defined(USE_GEMM_HW)
+/* SHAPE word */
+#define GEMM_SHAPE_WORD(m, n, k) \
+    ((uint32_t)(m) | ((uint32_t)(n) << 8) | ((uint32_t)(k) << 16))
+
+/* Little-endian word of 4 int8 (dot8_pack order); p need not be aligned */
+static uint32_t gemm_pack4(const int8_t *p)
+{
+    return (uint32_t)(uint8_t)p[0] | ((uint32_t)(uint8_t)p[1] << 8) |
+           ((uint32_t)(uint8_t)p[2] << 16) | ((uint32_t)(uint8_t)p[3] << 24);
+}
+#else
+/* Reference: the block's memories */
+static int8_t  s_w[GEMM_W_ROWS][GEMM_K_MAX];
+static int32_t s_b[GEMM_W_ROWS];
+static int32_t s_y[GEMM_M_MAX * GEMM_N_MAX];
+static int8_t  s_y8[GEMM_M_MAX * GEMM_N_MAX];
+static int     s_y_idx;
+static uint32_t s_rq = GEMM_RQ_SHIFT(7);
+
+static int8_t gemm_ref_requant(int32_t y)
+{
+    const unsigned sh = s_rq & 0x3Fu;
+    int64_t p = y;
+    if ((s_rq & GEMM_RQ_ROUND) && sh != 0u) p += (int64_t)1 << (sh - 1u);
+    p >>= sh;
+    if ((s_rq & GEMM_RQ_RELU) && p < 0) p = 0;
+    if (p > 127) return 127;
+    if (p < -128) return -128;
+    return (int8_t)p;
+}
+#endif
+
+/* gemm_bind() cache: resident layers and the next free row */
+typedef struct {
+    const int8_t *W;
+    const int8_t *b8;
+    int           n;
+    int           k;
+    int           row;
+} gemm_slot_t;
+
+static gemm_slot_t s_slot[GEMM_BIND_SLOTS];
+static int         s_slots;
+static int         s_next_row;
+
+#if GEMM_CLOCK_GATE
+/* gemm_power_get() references held, and the wake-ups they took */
+static int                s_power_refs;
+static gemm_power_stats_t s_power_stats;
+#endif
+
+void gemm_init(uintptr_t base_addr)
+{
+    s_gemm_base = base_addr;
+    (void)s_gemm_base; /* unused when using LiteX CSRs or a fixed GEMM_BASE */
+#if GEMM_CLOCK_GATE
+    s_power_refs = 0;
+#  if defined(USE_GEMM_HW)
+    GEMM_WRITE_CLK_EN(0u);
+#  endif
+#endif
+}
+
+#if GEMM_CLOCK_GATE
+void gemm_power_get(void)
+{
+    uint32_t polls = 0;
+    if (s_power_refs++ > 0) return;
+#  if defined(USE_GEMM_HW)
+    GEMM_WRITE_CLK_EN(1u);
+    while ((GEMM_READ_STATUS() & GEMM_STATUS_CLK_ON) == 0u && polls < GEMM_WAKE_SPINS) {
+        polls++;
+    }
+#  endif
+    s_power_stats.wakes++;
+    s_power_stats.last_polls = polls;
+    if (polls > s_power_stats.max_polls) s_power_stats.max_polls = polls;
+}
+
+void gemm_power_put(void)
+{
+    /* The gateware keeps the clock on until a run in flight is done */
+    if (s_power_refs > 0 && --s_power_refs == 0) {
+#  if defined(USE_GEMM_HW)
+        GEMM_WRITE_CLK_EN(0u);
+#  endif
+    }
+}
+
+void gemm_power_stats(gemm_power_stats_t *s)
+{
+    if (s != 0) *s = s_power_stats;
+}
+#endif
+
+void gemm_set_requant(uint32_t rq_cfg)
+{
+#if defined(USE_GEMM_HW)
+    GEMM_WRITE_RQ(rq_cfg);
+#else
+    s_rq = rq_cfg;
+#endif
+}
+
+int gemm_fits(int n, int k)
+{
+    return n > 0 && n <= GEMM_N_MAX && (n % GEMM_P) == 0 &&
+           k > 0 && k <= GEMM_K_MAX && (k % 4) == 0;
+}
+
+void gemm_load_w(int w_row, const int8_t *W, const int32_t *b32, const int8_t *b8, int n, int k)
+{
+    int i, c;
+
+    for (i = 0; i < s_slots; i++) {
+        if (s_slot[i].row < w_row + n && w_row < s_slot[i].row + s_slot[i].n) {
+            s_slot[i] = s_slot[--s_slots];
+            i--;
+        }
+    }
+#if defined(USE_GEMM_HW)
+    GEMM_POWER_GET();
+    GEMM_WRITE_W_BASE(w_row);
+    GEMM_WRITE_SHAPE(GEMM_SHAPE_WORD(1, n, k));
+    GEMM_WRITE_CTRL(GEMM_CTRL_W_REWIND);
+    for (i = 0; i < n * k; i += 4) {
+        GEMM_WRITE_W4(gemm_pack4(&W[i]));
+    }
+    for (i = 0; i < n; i++) {
+        GEMM_WRITE_B(b32 != 0 ? b32[i] : b8 != 0 ? (int32_t)b8[i] : 0);
+    }
+    GEMM_POWER_PUT();
+#else
+    for (i = 0; i < n; i++) {
+        for (c = 0; c < k; c++) s_w[w_row + i][c] = W[i * k + c];
+        s_b[w_row + i] = b32 != 0 ? b32[i] : b8 != 0 ? (int32_t)b8[i] : 0;
+    }
+#endif
+    (void)c;
+}
+
+int gemm_bind(const int8_t *W, const int8_t *b8, int n, int k)
+{
+    int i;
+
+    if (!gemm_fits(n, k)) return -1;
+    for (i = 0; i < s_slots; i++) {
+        const gemm_slot_t *e = &s_slot[i];
+        if (e->W == W && e->b8 == b8 && e->n == n && e->k == k) return e->row;
+    }
+    if (s_next_row + n > GEMM_W_ROWS || s_slots == GEMM_BIND_SLOTS) {
+        gemm_invalidate();
+    }
+    i = s_next_row;
+    gemm_load_w(i, W, 0, b8, n, k);
+    s_slot[s_slots].W = W;
+    s_slot[s_slots].b8 = b8;
+    s_slot[s_slots].n = n;
+    s_slot[s_slots].k = k;
+    s_slot[s_slots].row = i;
+    s_slots++;
+    s_next_row = i + n;
+    return i;
+}
+
+void gemm_invalidate(void)
+{
+    s_slots = 0;
+    s_next_row = 0;
+}
+
+void gemm_run(int w_row, const int8_t *x, int x_stride, int m, int n, int k, int bias)
+{
+#if defined(USE_GEMM_HW)
+    const uint32_t cfg = bias ? GEMM_CTRL_ENABLE_BIAS : 0u;
+    int i, c;
+
+    GEMM_POWER_GET();
+    GEMM_WRITE_SHAPE(GEMM_SHAPE_WORD(m, n, k));
+    GEMM_WRITE_W_BASE(w_row);
+    GEMM_WRITE_CTRL(cfg | GEMM_CTRL_CLEAR);
+    for (i = 0; i < m; i++) {
+        const int8_t *row = &x[i * x_stride];
+        for (c = 0; c < k; c += 4) {
+            GEMM_WRITE_X4(gemm_pack4(&row[c]));
+        }
+    }
+    GEMM_WRITE_CTRL(cfg | GEMM_CTRL_START);
+    while ((GEMM_READ_STATUS() & GEMM_STATUS_DONE) == 0u) {
+        /* busy-wait */
+    }
+    GEMM_POWER_PUT();
+#else
+    int i, j, c;
+
+    for (i = 0; i < m; i++) {
+        const int8_t *row = &x[i * x_stride];
+        for (j = 0; j < n; j++) {
+            const int8_t *w = s_w[w_row + j];
+            int32_t acc = bias ? s_b[w_row + j] : 0;
+            for (c = 0; c < k; c++) acc += (int32_t)row[c] * (int32_t)w[c];
+            s_y[i * n + j] = acc;
+            s_y8[i * n + j] = gemm_ref_requant(acc);
+        }
+    }
+    s_y_idx = 0;
+#endif
+}
+
+void gemm_read_y(int32_t *y, int count)
+{
+    int i;
+    GEMM_POWER_GET();
+    for (i = 0; i < count; i++) {
+#if defined(USE_GEMM_HW)
+        y[i] = (int32_t)GEMM_READ_Y();
+        GEMM_WRITE_Y_NEXT(1u);
+#else
+        y[i] = s_y[s_y_idx++];
+#endif
+    }
+    GEMM_POWER_PUT();
+}
+
+void gemm_read_y8(int8_t *y8, int count)
+{
+    int i;
+    GEMM_POWER_GET();
+    for (i = 0; i < count; i += 4) {
+#if defined(USE_GEMM_HW)
+        const uint32_t v = GEMM_READ_Y8();
+        GEMM_WRITE_Y_NEXT(4u);
+        y8[i]     = (int8_t)v;
+        y8[i + 1] = (int8_t)(v >> 8);
+        y8[i + 2] = (int8_t)(v >> 16);
+        y8[i + 3] = (int8_t)(v >> 24);
+#else
+        y8[i]     = s_y8[s_y_idx];
+        y8[i + 1] = s_y8[s_y_idx + 1];
+        y8[i + 2] = s_y8[s_y_idx + 2];
+        y8[i + 3] = s_y8[s_y_idx + 3];
+        s_y_idx += 4;
+#endif
+    }
+    GEMM_POWER_PUT();
+}
+
+int gemm_project8(const int8_t *W, const int8_t *b8, const int8_t *x, int x_stride,
+                  int8_t *y8, int y8_stride, int m, int n, int k)
+{
+    const int row = gemm_bind(W, b8, n, k);
+    int m0, i;
+
+    if (row < 0) return 0;
+    GEMM_POWER_GET();
+    for (m0 = 0; m0 < m; m0 += GEMM_M_MAX) {
+        const int mm = (m - m0 < GEMM_M_MAX) ? m - m0 : GEMM_M_MAX;
+        gemm_run(row, &x[m0 * x_stride], x_stride, mm, n, k, 1);
+        for (i = 0; i < mm; i++) {
+            gemm_read_y8(&y8[(m0 + i) * y8_stride], n);
+        }
+    }
+    GEMM_POWER_PUT();
+    return 1;
+}
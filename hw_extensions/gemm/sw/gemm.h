@@ -0,0 +1,159 @@
+/*
+ * GEMM accelerator — C driver API.
+ *
+ * Defining USE_GEMM_HW (in the firmware that uses this driver) requires the SoC to include
+ * the corresponding HW block; otherwise the same calls run the C reference in gemm.c.
+ *
+ * Use with LiteX-generated CSR accessors (GEMM_USE_LITEX_CSR: gemm_ctrl_write(),
+ * gemm_x_in4_write(), ...) or with GEMM_BASE / gemm_init() and the offsets below.
+ *
+ * One run computes Y[m][n] = sum_k X[m][k] * W[n][k] + b[n] for up to GEMM_M_MAX tokens,
+ * i.e. a whole [S][D] x [D][D]^T projection in one start: W and b are loaded once at a
+ * resident row (gemm_load_w(), or gemm_bind() with its resident-layer cache), then each
+ * run streams only X (gemm_run()) and reads Y (gemm_read_y()) or Y8 (gemm_read_y8()).
+ * Polling only.
+ *
+ * GEMM_CLOCK_GATE=1 (gateware built with GEMMPeripheral(clock_gate=True)): the core runs on
+ * a gated clock (CLK_EN, on from reset). Every call that streams to the core or reads Y takes
+ * a gemm_power_get() reference for its duration, so the block is clocked only while the
+ * driver uses it (and, in hardware, until a started run is done).
+ */
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <stdint.h>
+
+/* Optional: set base address when not using LiteX generated/csr.h */
+#ifndef GEMM_BASE
+/* #define GEMM_BASE  0x00000000 */
+#endif
+
+/* Register offsets (bytes) — must match gemm_spec.md and LiteX wrapper */
+#define GEMM_CTRL    0x00
+#define GEMM_SHAPE   0x04   /* [7:0]=M, [15:8]=N, [23:16]=K */
+#define GEMM_W_BASE  0x08   /* first W row of the next run and of the W_IN4 / B_IN streams */
+#define GEMM_STATUS  0x0C
+#define GEMM_X_IN4   0x10   /* write 4 packed int8 X values, row-major (lane 0 = bits 7:0) */
+#define GEMM_W_IN4   0x14   /* write 4 packed int8 W values, row-major */
+#define GEMM_B_IN    0x18   /* write the int32 bias of the next W row */
+#define GEMM_Y_OUT   0x1C   /* int32 Y at the read index (row-major [M][N]) */
+#define GEMM_Y8_OUT  0x20   /* 4 requantized int8 Y at the read index (lane 0 = bits 7:0) */
+#define GEMM_Y_NEXT  0x24   /* write 1 to advance the read index by one, 4 by four */
+#define GEMM_RQ_CFG  0x28   /* requant stage config (GEMM_RQ_*) */
+#define GEMM_CLK_EN  0x2C   /* GEMM_CLOCK_GATE: 1 = core clock on */
+
+/* CTRL bits: START, CLEAR and W_REWIND are pulses; ENABLE_BIAS is stored */
+#define GEMM_CTRL_START       (1u << 0)
+#define GEMM_CTRL_CLEAR       (1u << 1)   /* clear done, rewind the X write / Y read pointers */
+#define GEMM_CTRL_ENABLE_BIAS (1u << 2)
+#define GEMM_CTRL_W_REWIND    (1u << 3)   /* point the W_IN4 / B_IN streams at W_BASE */
+
+/* STATUS: [0]=busy, [1]=done, [2]=clk_on (GEMM_CLOCK_GATE gateware only) */
+#define GEMM_STATUS_BUSY  (1u << 0)
+#define GEMM_STATUS_DONE  (1u << 1)
+#define GEMM_STATUS_CLK_ON (1u << 2)
+
+/* RQ_CFG fields: Y8 = sat8(relu?(Y + round) >>> shift); reset value is SHIFT(7) */
+#define GEMM_RQ_SHIFT(s)  ((uint32_t)(s) & 0x3Fu)
+#define GEMM_RQ_ROUND     (1u << 6)
+#define GEMM_RQ_RELU      (1u << 7)
+
+/* Gateware sizes (GEMMPeripheral(pe, m_max, n_max, k_max, w_rows)); override to match */
+#ifndef GEMM_P
+#define GEMM_P 4            /* PE array is GEMM_P x GEMM_P; N and W rows go by GEMM_P */
+#endif
+#ifndef GEMM_M_MAX
+#define GEMM_M_MAX 16       /* tokens per run */
+#endif
+#ifndef GEMM_N_MAX
+#define GEMM_N_MAX 64       /* output channels per run */
+#endif
+#ifndef GEMM_K_MAX
+#define GEMM_K_MAX 64       /* inputs per run (multiple of 4) */
+#endif
+#ifndef GEMM_W_ROWS
+#define GEMM_W_ROWS 256     /* resident W rows (of GEMM_K_MAX bytes each) */
+#endif
+
+#ifndef GEMM_CLOCK_GATE
+#define GEMM_CLOCK_GATE 0
+#endif
+/* STATUS polls a wake-up waits for clk_on before it gives up (gateware without the gate) */
+#ifndef GEMM_WAKE_SPINS
+#define GEMM_WAKE_SPINS 1000u
+#endif
+
+/* Resident layers gemm_bind() keeps track of */
+#ifndef GEMM_BIND_SLOTS
+#define GEMM_BIND_SLOTS 8
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initialize driver (set base address if using GEMM_BASE). No-op when using LiteX CSRs,
+ * except that GEMM_CLOCK_GATE turns the core clock off until the first call needs it. */
+void gemm_init(uintptr_t base_addr);
+
+#if GEMM_CLOCK_GATE
+/* Reference-counted core clock: the first get turns it on and waits for STATUS.clk_on,
+ * the last put turns it off. W, b and Y are kept while it is off. Wrap a sequence of
+ * calls (an encoder pass) in get / put to wake the core once for all of them. */
+void gemm_power_get(void);
+void gemm_power_put(void);
+
+/* Wake-ups so far, and the STATUS polls of the last and slowest one until clk_on was
+ * seen (GEMM_WAKE_SPINS: never seen; 0 for the C reference). */
+typedef struct {
+    uint32_t wakes;
+    uint32_t last_polls;
+    uint32_t max_polls;
+} gemm_power_stats_t;
+void gemm_power_stats(gemm_power_stats_t *s);
+#endif
+
+/* Requant stage config (GEMM_RQ_SHIFT(s) | GEMM_RQ_ROUND | GEMM_RQ_RELU) for the next runs. */
+void gemm_set_requant(uint32_t rq_cfg);
+
+/* Nonzero if the block runs an n x k matrix: n a multiple of GEMM_P up to GEMM_N_MAX,
+ * k a multiple of 4 up to GEMM_K_MAX. */
+int gemm_fits(int n, int k);
+
+/* Load W[n][k] (row-major int8) and its bias to the resident rows [w_row, w_row + n):
+ * b32 (int32) if non-null, else b8 (int8) if non-null, else zeros. w_row is a multiple
+ * of GEMM_P with w_row + n <= GEMM_W_ROWS; gemm_fits(n, k). Drops the gemm_bind() cache
+ * entries the rows overlap. */
+void gemm_load_w(int w_row, const int8_t *W, const int32_t *b32, const int8_t *b8, int n, int k);
+
+/* Resident row of W[n][k] with int8 bias b8 (may be null: zeros), loading it on the first
+ * call: layers are placed one after another and the cache restarts from row 0 when the W
+ * memory is full. Returns -1 if !gemm_fits(n, k). */
+int gemm_bind(const int8_t *W, const int8_t *b8, int n, int k);
+
+/* Forget every resident layer (e.g. after the weights changed in place). */
+void gemm_invalidate(void);
+
+/* Run Y = X * W^T (+ b if bias) for the m <= GEMM_M_MAX rows of X (row i at
+ * x + i * x_stride, k bytes each) against the n rows at w_row, and wait
+ * for done. Rewinds the Y read pointer. */
+void gemm_run(int w_row, const int8_t *x, int x_stride, int m, int n, int k, int bias);
+
+/* Read the next count Y values of the last run (row-major [m][n]) into y. */
+void gemm_read_y(int32_t *y, int count);
+
+/* Read the next count (a multiple of 4) requantized Y8 values into y8. */
+void gemm_read_y8(int8_t *y8, int count);
+
+/* Whole projection y8[i][0..n) = requant(W * x[i] + b8) for i < m, any m: runs of
+ * GEMM_M_MAX tokens against the gemm_bind() row of W (y8 rows y8_stride bytes apart).
+ * Returns 0, doing nothing, if !gemm_fits(n, k). */
+int gemm_project8(const int8_t *W, const int8_t *b8, const int8_t *x, int x_stride,
+                  int8_t *y8, int y8_stride, int m, int n, int k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEMM_H */
@@ -1,26 +1,93 @@
 # GEMV peripheral — LiteX CSR wrapper.
 #
 # Integrates gemv_core (Verilog) into a LiteX SoC via the CSR bus.
-# START and CLEAR_DONE are one-cycle pulses (derived from CTRL write + dat_w bits).
+# START, CLEAR_DONE and CLEAR_X are one-cycle pulses (derived from CTRL write + dat_w bits).
+# CLEAR_X keeps the loaded W/b so the next run streams only X (weight-stationary).
 # Y read pointer is advanced by writing to Y_NEXT (pulse), not by Y_OUT read-enable.
+# CTRL.bank selects the X/Y bank the CSR side loads and reads (the core computes in the bank
+# latched at start); REWIND resets the X/Y pointers only, for pipelined token runs.
+# RQ_CFG configures the core's requant stage; Y8_OUT reads four requantized int8 rows and
+# writing 4 to Y_NEXT advances the read pointer by four.
+#
+# with_dma=True adds a Wishbone bus master: software writes DMA_W_ADDR / DMA_X_ADDR /
+# DMA_Y_ADDR and DMA_CTRL, the wrapper fetches W (optional) and X from memory into the
+# packed write ports, runs the core and stores Y (int32) back to DMA_Y_ADDR.
+#
+# with_mem=True adds a Wishbone slave (mem_bus, mem_size bytes) mapping the W and X memories
+# as a write-only window: W bytes at [0, 2^w_addr_bits) in row-major order, X bank b at
+# 2^w_addr_bits + 64 * b. Word, byte (sel) and burst writes store directly, so software can
+# memcpy whole matrices or overwrite single rows; reads return 0. W_BASE selects the W region
+# (byte offset, multiple of 32 * rows) the next run computes with and the W_IN streams fill,
+# so w_addr_bits > 12 holds several layers at once.
+#
+# attn=True builds the core with X16 for attention offload: CTRL.out_dim_16 runs 16 rows (the
+# scores of 16 keys) and CTRL.x_u16 takes X as 32 unsigned 16-bit values, low bytes in X[0..31]
+# and high bytes in X[32..63] (Q15 softmax weights against V^T, LEN 32). It also adds W_BASE
+# (without with_mem), so K and V^T can stay resident at two W regions.
+#
+# w_banks=2 doubles the core's W and b memories: CTRL.w_bank selects the bank the W_IN / B_IN
+# streams fill and the next run computes with, and W_PF4 / B_PF fill the other bank at their own
+# pointers (CTRL.pf_rewind rewinds them; clear_done does not), so the next layer is written while
+# a run computes and one CTRL write switches to it. Not with with_dma.
+#
+# pipeline=True builds the core with its registered datapath (PIPELINE=1: W/X read, DSP
+# multiply, adder tree and Y stages) for a higher Fmax. Runs take OUT_DIM * LEN / lanes + 5
+# cycles (rows=1) instead of OUT_DIM * (LEN / lanes + 1); the CSRs and the drivers are the same.
+#
+# clock_gate=True (or "bufgce", the Xilinx BUFGCE; "latch" for simulation and other targets)
+# clocks the core from a gated copy of sys_clk (rtl/clk_gate.v). CLK_EN (reset 1) turns it on;
+# 0 stops it once no run or DMA job is in flight, and STATUS[2] (clk_on) reads whether it runs.
+# W, b, X and Y are kept while it is off, but stream writes and pulses to the core are lost, so
+# GEMV_CLOCK_GATE firmware (gemv_power_get/put) turns the clock on around every call.
+#
+# ev.done is an interrupt on every finished CSR run (core done rising outside a DMA job) and,
+# with_dma, every finished DMA job (one pulse as STORE_Y returns to IDLE); EV_ENABLE gates it
+# and writing 1 to EV_PENDING acknowledges it.
+#
+# add_gemv_instances() adds more GEMV instances next to the first, as CSR regions gemv1,
+# gemv2, ... (plain CSR wrappers, no DMA/mem/interrupt) for firmware built with
+# GEMV_DEVICES=n, whose gemv_dev_* handles run them side by side.
 #
 # Usage (in your SoC target):
-#   self.submodules.gemv = GEMVPeripheral()
+#   self.submodules.gemv = GEMVPeripheral()           # or GEMVPeripheral(with_dma=True, attn=True), (w_banks=2)
 #   self.add_csr("gemv")
+#   self.irq.add("gemv", use_loc_if_exists=True)     # done interrupt (GEMV_IRQ=1 firmware)
+#   self.bus.add_master(name="gemv", master=self.gemv.bus)   # with_dma=True only
+#   self.bus.add_slave("gemv_mem", self.gemv.mem_bus,         # with_mem=True only
+#       SoCRegion(origin=0x90000000, size=self.gemv.mem_size, cached=False))
+#   add_gemv_instances(self, 2)                        # + gemv1 (GEMV_DEVICES=2 firmware)
 #   self.add_source("path/to/rtl/gemv_core.v")
+#   self.add_source("path/to/rtl/clk_gate.v")          # clock_gate only
 
 from migen import *
+from litex.soc.interconnect import wishbone
 from litex.soc.interconnect.csr import AutoCSR, CSRStorage, CSRStatus
+from litex.soc.interconnect.csr_eventmanager import EventManager, EventSourcePulse
 
 
 class GEMVPeripheral(Module, AutoCSR):
-    """LiteX peripheral for GEMV core. CTRL, X_IN, W_IN, B_IN, Y_OUT, Y_NEXT, STATUS."""
+    """LiteX peripheral for GEMV core. CTRL, X_IN, W_IN, B_IN, Y_OUT, Y_NEXT, STATUS, X_IN4, W_IN4
+    (+ DMA_W_ADDR, DMA_X_ADDR, DMA_Y_ADDR, DMA_CTRL, DMA_STATUS with with_dma=True),
+    RQ_CFG, Y8_OUT, the ev (done interrupt) registers (+ W_BASE and mem_bus with with_mem=True,
+    W_BASE with attn=True, W_PF4 and B_PF with w_banks=2, CLK_EN with clock_gate)."""
 
-    def __init__(self):
+    def __init__(self, with_dma=False, lanes=1, rows=1, with_mem=False, w_addr_bits=12, attn=False,
+                 w_banks=1, pipeline=False, clock_gate=False):
+        if w_banks not in (1, 2):
+            raise ValueError("w_banks must be 1 or 2")
+        if w_banks == 2 and with_dma:
+            raise ValueError("w_banks=2 does not support with_dma")
+        if clock_gate not in (False, True, "bufgce", "latch"):
+            raise ValueError("clock_gate must be False, True, \"bufgce\" or \"latch\"")
         # --- CTRL: [0]=start (pulse on write with bit0), [3]=clear_done (pulse on write with bit3),
-        #           [4]=len_64, [5]=out_dim_64, [6]=enable_bias (stored config)
-        self.ctrl = CSRStorage(7, name="ctrl")
-        self.status = CSRStatus(2, name="status")  # [0]=busy, [1]=done — combinational from core
+        #           [4]=len_64, [5]=out_dim_64, [6]=enable_bias (stored config),
+        #           [7]=clear_x (pulse on write with bit7), [8]=bank (stored config),
+        #           [9]=rewind (pulse on write with bit9),
+        #           [10]=out_dim_16, [11]=x_u16 (stored config; x_u16 needs attn=True),
+        #           [12]=w_bank (stored config), [13]=pf_rewind (pulse on write with bit13);
+        #           both need w_banks=2
+        self.ctrl = CSRStorage(14, name="ctrl")
+        self.status = CSRStatus(3 if clock_gate else 2, name="status")  # [0]=busy, [1]=done — combinational from core, [2]=clk_on
 
         # --- Stream registers ---
         self.x_in = CSRStorage(8, name="x_in", description="Write next int8 X value")
@@ -29,24 +96,73 @@ class GEMVPeripheral(Module, AutoCSR):
 
         # --- Y: read Y_OUT returns current y_rd_data; write Y_NEXT pulses y_rd_en to advance ---
         self.y_out = CSRStatus(32, name="y_out", description="Read int32 Y at current index")
-        self.y_next = CSRStorage(1, name="y_next", description="Write any value to advance Y read pointer (pulse)")
+        self.y_next = CSRStorage(3, name="y_next", description="Write 1 to advance Y read pointer by one, 4 to advance by four (pulse)")
+
+        # --- Packed stream registers: 4 int8 lanes per write, lane 0 in bits [7:0] ---
+        self.x_in4 = CSRStorage(32, name="x_in4", description="Write next 4 int8 X values (lane 0 = LSB)")
+        self.w_in4 = CSRStorage(32, name="w_in4", description="Write next 4 int8 W values, row-major (lane 0 = LSB)")
+
+        # --- Requant stage: RQ_CFG [5:0]=shift, [6]=round, [7]=relu, [8]=mul_en, [31:16]=mul (signed) ---
+        self.rq_cfg = CSRStorage(32, reset=7, name="rq_cfg", description="Requant: shift, round, relu, mul_en, mul")
+        self.y8_out = CSRStatus(32, name="y8_out", description="Read 4 requantized int8 Y at current index (lane 0 = LSB)")
 
         # --- Core signals ---
         self.x_wr_en   = Signal()
         self.x_wr_data = Signal(8)
         self.w_wr_en   = Signal()
         self.w_wr_data = Signal(8)
+        self.x_wr4_en  = Signal()
+        self.x_wr4_data = Signal(32)
+        self.w_wr4_en  = Signal()
+        self.w_wr4_data = Signal(32)
         self.b_wr_en   = Signal()
         self.b_wr_data = Signal(32)
         self.start     = Signal()
         self.len_64    = Signal()
         self.out_dim_64 = Signal()
+        self.out_dim_16 = Signal()
+        self.x_u16     = Signal()
         self.bias_en   = Signal()
         self.clear_done = Signal()
+        self.clear_x   = Signal()
+        self.rewind    = Signal()
+        self.bank      = Signal()
+        self.w_bank    = Signal()
+        self.pf_rewind = Signal()
         self.busy      = Signal()
         self.done      = Signal()
         self.y_rd_en   = Signal()
         self.y_rd_data = Signal(32)
+        self.y_rd4_en  = Signal()
+        self.y8_rd_data = Signal(32)
+
+        # --- Memory window drives and W region (stay 0 without with_mem / attn) ---
+        self.w_mem_we  = Signal()
+        self.w_mem_adr = Signal(w_addr_bits - 2)
+        self.x_mem_we  = Signal()
+        self.x_mem_adr = Signal(5)
+        self.mem_sel   = Signal(4)
+        self.mem_dat   = Signal(32)
+        self.w_base_q  = Signal(w_addr_bits)
+
+        # --- Prefetch ports (stay 0 without w_banks=2) ---
+        self.w_pf4_en  = Signal()
+        self.w_pf4_data = Signal(32)
+        self.b_pf_en   = Signal()
+        self.b_pf_data = Signal(32)
+
+        # --- DMA-side drives (stay 0 without with_dma); OR-ed / muxed with the CSR side ---
+        dma_active     = Signal()   # DMA owns the core config while a job runs
+        dma_x_wr4_en   = Signal()
+        dma_w_wr4_en   = Signal()
+        dma_wr4_data   = Signal(32)
+        dma_start      = Signal()
+        dma_clear_done = Signal()
+        dma_clear_x    = Signal()
+        dma_y_rd_en    = Signal()
+        dma_len_64     = Signal()
+        dma_out_dim_64 = Signal()
+        dma_finish     = Signal()   # one cycle as a DMA job ends (STORE_Y -> IDLE)
 
         # --- Stream writes: .re strobe (portable/idiomatic) and .dat_w ---
         self.comb += [
@@ -54,51 +170,287 @@ class GEMVPeripheral(Module, AutoCSR):
             self.x_wr_data.eq(self.x_in.dat_w[:8]),
             self.w_wr_en.eq(self.w_in.re),
             self.w_wr_data.eq(self.w_in.dat_w[:8]),
+            self.x_wr4_en.eq(self.x_in4.re | dma_x_wr4_en),
+            self.x_wr4_data.eq(Mux(dma_x_wr4_en, dma_wr4_data, self.x_in4.dat_w)),
+            self.w_wr4_en.eq(self.w_in4.re | dma_w_wr4_en),
+            self.w_wr4_data.eq(Mux(dma_w_wr4_en, dma_wr4_data, self.w_in4.dat_w)),
             self.b_wr_en.eq(self.b_in.re),
             self.b_wr_data.eq(self.b_in.dat_w),
         ]
-        # --- START and CLEAR_DONE: one-cycle pulses when CTRL is written with corresponding bit set ---
+        # --- START, CLEAR_DONE and CLEAR_X: one-cycle pulses when CTRL is written with corresponding bit set ---
         self.comb += [
-            self.start.eq(self.ctrl.re & self.ctrl.dat_w[0]),
-            self.clear_done.eq(self.ctrl.re & self.ctrl.dat_w[3]),
+            self.start.eq((self.ctrl.re & self.ctrl.dat_w[0]) | dma_start),
+            self.clear_done.eq((self.ctrl.re & self.ctrl.dat_w[3]) | dma_clear_done),
+            self.clear_x.eq((self.ctrl.re & self.ctrl.dat_w[7]) | dma_clear_x),
+            self.rewind.eq(self.ctrl.re & self.ctrl.dat_w[9]),
+            self.pf_rewind.eq(self.ctrl.re & self.ctrl.dat_w[13]),
         ]
-        # --- Config: stored levels (from ctrl.storage, updated on write) ---
+        # --- Config: stored levels (from ctrl.storage, updated on write; DMA_CTRL while a job runs) ---
         self.comb += [
-            self.len_64.eq(self.ctrl.storage[4]),
-            self.out_dim_64.eq(self.ctrl.storage[5]),
-            self.bias_en.eq(self.ctrl.storage[6]),
+            self.len_64.eq(Mux(dma_active, dma_len_64, self.ctrl.storage[4])),
+            self.out_dim_64.eq(Mux(dma_active, dma_out_dim_64, self.ctrl.storage[5])),
+            self.out_dim_16.eq(~dma_active & self.ctrl.storage[10]),
+            self.x_u16.eq(~dma_active & self.ctrl.storage[11]),
+            self.bias_en.eq(~dma_active & self.ctrl.storage[6]),
+            self.bank.eq(~dma_active & self.ctrl.storage[8]),   # DMA jobs use bank 0
+            self.w_bank.eq(self.ctrl.storage[12]),
         ]
+        # --- Core clock: sys_clk, or its gated copy (CLK_EN, held on while a run or DMA job is busy) ---
+        core_clk = ClockSignal()
+        clk_on = Signal()
+        if clock_gate:
+            self.clk_en = CSRStorage(1, reset=1, name="clk_en",
+                description="1: core clock on; 0: off once no run or DMA job is in flight")
+            core_clk = Signal()
+            self.specials += Instance(
+                "clk_gate",
+                p_BUFGCE=int(clock_gate != "latch"),
+                i_clk=ClockSignal(),
+                i_reset=ResetSignal(),
+                i_en=self.clk_en.storage | self.busy | dma_active,
+                o_gclk=core_clk,
+                o_on=clk_on,
+            )
         # --- STATUS: combinational from core (no sync) ---
         self.comb += [
-            self.status.status.eq(Cat(self.busy, self.done)),
+            self.status.status.eq(Cat(self.busy, self.done, clk_on)),
         ]
         # --- Y: y_out returns y_rd_data; y_rd_en = pulse when Y_NEXT is written (optionally gated by dat_w[0]) ---
         self.comb += [
             self.y_out.status.eq(self.y_rd_data),
-            self.y_rd_en.eq(self.y_next.re & self.y_next.dat_w[0]),
+            self.y_rd_en.eq((self.y_next.re & self.y_next.dat_w[0]) | dma_y_rd_en),
+            self.y8_out.status.eq(self.y8_rd_data),
+            self.y_rd4_en.eq(self.y_next.re & self.y_next.dat_w[2]),
         ]
 
+        # --- IRQ: pulse on core done rising outside a DMA job, or as a DMA job ends ---
+        # done_last follows core done inside jobs too, so the done a job leaves set
+        # raises no second pulse once dma_active drops; the sticky DMA_STATUS.done
+        # is not an interrupt source (it would mask the edges of later CSR runs).
+        self.submodules.ev = EventManager()
+        self.ev.done = EventSourcePulse(description="GEMV run or DMA job finished")
+        self.ev.finalize()
+        done_last = Signal()
+        self.sync += done_last.eq(self.done)
+        self.comb += self.ev.done.trigger.eq((self.done & ~done_last & ~dma_active) | dma_finish)
+
+        if with_dma:
+            self._add_dma(dma_active, dma_x_wr4_en, dma_w_wr4_en, dma_wr4_data, dma_start,
+                          dma_clear_done, dma_clear_x, dma_y_rd_en, dma_len_64, dma_out_dim_64,
+                          dma_finish)
+        if with_mem or attn:
+            # --- W_BASE: W region byte offset (multiple of 32 * rows) ---
+            self.w_base = CSRStorage(w_addr_bits, name="w_base", description="W region of the next run and the W_IN streams")
+            self.comb += self.w_base_q.eq(self.w_base.storage)
+        if with_mem:
+            self._add_mem(w_addr_bits)
+        if w_banks == 2:
+            # --- Prefetch streams into the W/b bank CTRL.w_bank does not select ---
+            self.w_pf4 = CSRStorage(32, name="w_pf4", description="Write next 4 int8 W values of the other W bank (lane 0 = LSB)")
+            self.b_pf = CSRStorage(32, name="b_pf", description="Write next int32 bias of the other W bank")
+            self.comb += [
+                self.w_pf4_en.eq(self.w_pf4.re),
+                self.w_pf4_data.eq(self.w_pf4.dat_w),
+                self.b_pf_en.eq(self.b_pf.re),
+                self.b_pf_data.eq(self.b_pf.dat_w),
+            ]
+
         # --- Instantiate Verilog GEMV core ---
         self.specials += Instance(
             "gemv_core",
-            # Parameters if needed
-            # p_MAX_LEN=64, p_MAX_OUT=64, p_W_ADDR_BITS=12,
-            i_clk=ClockSignal(),
+            # p_MAX_LEN=64, p_MAX_OUT=64 are the defaults
+            p_W_ADDR_BITS=w_addr_bits,                      # W memory bytes = 2^w_addr_bits
+            p_LANES=lanes,                                  # int8 MACs per cycle and row
+            p_ROWS=rows,                                    # rows computed in parallel
+            p_X16=int(attn),                                # x_u16 mode (attention)
+            p_W_BANKS=w_banks,                              # W/b banks (prefetch)
+            p_PIPELINE=int(pipeline),                       # registered datapath (Fmax)
+            i_clk=core_clk,
             i_reset=ResetSignal(),
             i_x_wr_en=self.x_wr_en,
             i_x_wr_data=self.x_wr_data,
             i_w_wr_en=self.w_wr_en,
             i_w_wr_data=self.w_wr_data,
+            i_x_wr4_en=self.x_wr4_en,
+            i_x_wr4_data=self.x_wr4_data,
+            i_w_wr4_en=self.w_wr4_en,
+            i_w_wr4_data=self.w_wr4_data,
             i_b_wr_en=self.b_wr_en,
             i_b_wr_data=self.b_wr_data,
+            i_w_mem_we=self.w_mem_we,
+            i_w_mem_adr=self.w_mem_adr,
+            i_w_mem_sel=self.mem_sel,
+            i_w_mem_dat=self.mem_dat,
+            i_x_mem_we=self.x_mem_we,
+            i_x_mem_adr=self.x_mem_adr,
+            i_x_mem_sel=self.mem_sel,
+            i_x_mem_dat=self.mem_dat,
+            i_w_base=self.w_base_q,
+            i_w_pf4_en=self.w_pf4_en,
+            i_w_pf4_data=self.w_pf4_data,
+            i_b_pf_en=self.b_pf_en,
+            i_b_pf_data=self.b_pf_data,
             i_start=self.start,
             i_len_64=self.len_64,
             i_out_dim_64=self.out_dim_64,
+            i_out_dim_16=self.out_dim_16,
+            i_x_u16=self.x_u16,
             i_bias_en=self.bias_en,
+            i_bank=self.bank,
+            i_w_bank=self.w_bank,
             o_busy=self.busy,
             o_done=self.done,
             i_clear_done=self.clear_done,
+            i_clear_x=self.clear_x,
+            i_rewind=self.rewind,
+            i_pf_rewind=self.pf_rewind,
             i_y_rd_en=self.y_rd_en,
             o_y_rd_data=self.y_rd_data,
+            i_rq_shift=self.rq_cfg.storage[0:6],
+            i_rq_round=self.rq_cfg.storage[6],
+            i_rq_relu=self.rq_cfg.storage[7],
+            i_rq_mul_en=self.rq_cfg.storage[8],
+            i_rq_mul=self.rq_cfg.storage[16:32],
+            i_y_rd4_en=self.y_rd4_en,
+            o_y8_rd_data=self.y8_rd_data,
+        )
+
+    def _add_mem(self, w_addr_bits):
+        # --- Window: word address bit w_addr_bits - 2 selects X ({bank, word} in the low 5 bits) ---
+        self.mem_bus = bus = wishbone.Interface(data_width=32)
+        self.mem_size = 2 << w_addr_bits
+        wa = w_addr_bits - 2
+        wr = Signal()
+        self.comb += [
+            wr.eq(bus.cyc & bus.stb & bus.we & ~bus.ack),
+            self.w_mem_we.eq(wr & ~bus.adr[wa]),
+            self.x_mem_we.eq(wr & bus.adr[wa]),
+            self.w_mem_adr.eq(bus.adr[:wa]),
+            self.x_mem_adr.eq(bus.adr[:5]),
+            self.mem_sel.eq(bus.sel),
+            self.mem_dat.eq(bus.dat_w),
+            bus.dat_r.eq(0),
+        ]
+        # One-cycle ack; the write happens in the cycle before it
+        self.sync += bus.ack.eq(bus.cyc & bus.stb & ~bus.ack)
+
+    def _add_dma(self, active, x_wr4_en, w_wr4_en, wr4_data, start, clear_done, clear_x,
+                 y_rd_en, len_64, out_dim_64, finish):
+        # --- DMA CSRs: byte addresses (4-byte aligned) of W, X (int8, row-major) and Y (int32) ---
+        self.dma_w_addr = CSRStorage(32, name="dma_w_addr", description="W source byte address")
+        self.dma_x_addr = CSRStorage(32, name="dma_x_addr", description="X source byte address")
+        self.dma_y_addr = CSRStorage(32, name="dma_y_addr", description="Y destination byte address")
+        # DMA_CTRL: [0]=start (pulse on write with bit0), [1]=load_w (0: keep resident W),
+        #           [2]=len_64, [3]=out_dim_64
+        self.dma_ctrl = CSRStorage(4, name="dma_ctrl")
+        self.dma_status = CSRStatus(2, name="dma_status")  # [0]=busy, [1]=done (sticky until next start)
+
+        self.bus = bus = wishbone.Interface(data_width=32)
+
+        adr    = Signal(30)   # word address of the next bus access
+        count  = Signal(11)   # words left in the current phase (W: up to 64*64/4 = 1024)
+        load_w = Signal()
+        done   = Signal()
+
+        n_x = Mux(len_64, 16, 8)                                  # LEN / 4
+        n_w = Mux(out_dim_64, Mux(len_64, 1024, 512), Mux(len_64, 512, 256))
+        n_y = Mux(out_dim_64, 64, 32)
+
+        go = Signal()
+        self.comb += go.eq(self.dma_ctrl.re & self.dma_ctrl.dat_w[0])
+
+        self.submodules.dma_fsm = fsm = FSM(reset_state="IDLE")
+        fsm.act("IDLE",
+            If(go,
+                NextValue(load_w, self.dma_ctrl.dat_w[1]),
+                NextValue(len_64, self.dma_ctrl.dat_w[2]),
+                NextValue(out_dim_64, self.dma_ctrl.dat_w[3]),
+                NextValue(done, 0),
+                NextState("CLEAR"),
+            )
+        )
+        # Rewind the core: clear_done (W reload) or clear_x (weight-stationary)
+        fsm.act("CLEAR",
+            active.eq(1),
+            If(load_w,
+                clear_done.eq(1),
+                NextValue(adr, self.dma_w_addr.storage[2:]),
+                NextValue(count, n_w),
+                NextState("FETCH_W"),
+            ).Else(
+                clear_x.eq(1),
+                NextValue(adr, self.dma_x_addr.storage[2:]),
+                NextValue(count, n_x),
+                NextState("FETCH_X"),
+            )
         )
+        fsm.act("FETCH_W",
+            active.eq(1),
+            bus.cyc.eq(1), bus.stb.eq(1), bus.we.eq(0), bus.sel.eq(0xf), bus.adr.eq(adr),
+            If(bus.ack,
+                w_wr4_en.eq(1),
+                NextValue(adr, adr + 1),
+                NextValue(count, count - 1),
+                If(count == 1,
+                    NextValue(adr, self.dma_x_addr.storage[2:]),
+                    NextValue(count, n_x),
+                    NextState("FETCH_X"),
+                )
+            )
+        )
+        fsm.act("FETCH_X",
+            active.eq(1),
+            bus.cyc.eq(1), bus.stb.eq(1), bus.we.eq(0), bus.sel.eq(0xf), bus.adr.eq(adr),
+            If(bus.ack,
+                x_wr4_en.eq(1),
+                NextValue(adr, adr + 1),
+                NextValue(count, count - 1),
+                If(count == 1, NextState("START"))
+            )
+        )
+        fsm.act("START",
+            active.eq(1),
+            start.eq(1),
+            NextState("WAIT"),
+        )
+        fsm.act("WAIT",
+            active.eq(1),
+            If(self.done,
+                NextValue(adr, self.dma_y_addr.storage[2:]),
+                NextValue(count, n_y),
+                NextState("STORE_Y"),
+            )
+        )
+        # y_rd_data is combinational at the core's Y read index; advance it on each ack
+        fsm.act("STORE_Y",
+            active.eq(1),
+            bus.cyc.eq(1), bus.stb.eq(1), bus.we.eq(1), bus.sel.eq(0xf), bus.adr.eq(adr),
+            bus.dat_w.eq(self.y_rd_data),
+            If(bus.ack,
+                y_rd_en.eq(1),
+                NextValue(adr, adr + 1),
+                NextValue(count, count - 1),
+                If(count == 1,
+                    finish.eq(1),
+                    NextValue(done, 1),
+                    NextState("IDLE"),
+                )
+            )
+        )
+        self.comb += [
+            wr4_data.eq(bus.dat_r),
+            self.dma_status.status.eq(Cat(~fsm.ongoing("IDLE"), done)),
+        ]
+
 
+def add_gemv_instances(soc, n, lanes=1, rows=1, pipeline=False):
+    """Add GEMV instances 1 .. n-1 to soc (instance 0 is soc.gemv, added as usual) as CSR
+    regions gemv1, gemv2, ...: plain CSR wrappers with the same core build. Returns them."""
+    periphs = []
+    for i in range(1, n):
+        name = "gemv{}".format(i)
+        periph = GEMVPeripheral(lanes=lanes, rows=rows, pipeline=pipeline)
+        setattr(soc.submodules, name, periph)
+        soc.add_csr(name)
+        periphs.append(periph)
+    return periphs
@@ -0,0 +1,53 @@
+/*
+ * Clock gate of an idle accelerator core (GEMVPeripheral, GEMMPeripheral
+ * and AttnPeripheral with clock_gate set).
+ * gclk follows clk while en is high and stays low otherwise. en is taken
+ * while clk is low, so gclk has no glitches and only full high phases: a
+ * clk edge passes to gclk iff en was high just before it. The core's
+ * registers and memories keep their contents while gclk is stopped (clock
+ * gating, not power gating), so resident weights survive.
+ * BUFGCE = 1 is the Xilinx 7-series global buffer with clock enable (the
+ * Nexys4DDR build); BUFGCE = 0 is the latch + AND of a standard-cell
+ * integrated clock gate, for simulation (iverilog, Verilator co-simulation)
+ * and other targets.
+ * on is set by the first clk edge that passes after en rises and cleared by
+ * the first one held back: software polls it (STATUS.clk_on) to see that the
+ * core is clocked again. It follows en by one clk cycle in both forms.
+ */
+
+module clk_gate #(
+    parameter BUFGCE = 0
+) (
+    input  wire clk,
+    input  wire reset,
+    input  wire en,
+    output wire gclk,
+    output reg  on
+);
+
+    generate
+        if (BUFGCE) begin : g_bufgce
+            BUFGCE u_bufgce (
+                .I(clk),
+                .CE(en),
+                .O(gclk)
+            );
+        end else begin : g_latch
+            reg en_latch;
+            /* verilator lint_off LATCH */
+            always @(clk or en)
+                if (!clk)
+                    en_latch <= en;
+            /* verilator lint_on LATCH */
+            assign gclk = clk & en_latch;
+        end
+    endgenerate
+
+    always @(posedge clk) begin
+        if (reset)
+            on <= 1'b0;
+        else
+            on <= en;
+    end
+
+endmodule
@@ -1,14 +1,63 @@
 /*
  * GEMV core: Y = W * X + b (optional).
- * int8 W, X; int32 b, Y. LEN and OUT_DIM configurable 32 or 64.
+ * int8 W, X; int32 b, Y. LEN configurable 32 or 64, OUT_DIM 16, 32 or 64.
  * CSR-fed: external logic (LiteX wrapper) pushes X, W, b via write ports;
  * core computes on start; external logic reads Y via read port.
+ * X and W also have word ports taking 4 int8 lanes per write (lane 0 =
+ * bits 7:0, as dot8_pack), so a CSR load moves 4 elements per bus access.
+ * W and b stay resident across runs: clear_x restarts with a new X only
+ * (weight-stationary), clear_done also rewinds the W/b write pointers.
+ * X and Y are double-buffered: the write/read ports use bank `bank`, a run
+ * computes in the bank latched at start, so the next X can be loaded and
+ * the previous Y read while a run is busy. rewind resets the X write and Y
+ * read pointers without touching done; start is also accepted in DONE.
+ * Each Y row is also requantized to int8 as it is stored:
+ *   y8 = sat8(relu?((acc * mul) + round) >>> shift)   (mul = 1 without rq_mul_en)
+ * and y8_rd_data returns four of them packed (lane 0 = bits 7:0).
+ * LANES multipliers run in parallel: X and W are stored as LANES-byte words,
+ * each compute cycle reads one word of each and adds the LANES products to
+ * acc through an adder tree, so a row takes LEN/LANES + 1 cycles. LANES is a
+ * power of two from 1 to 32; 1 is the sequential v1 datapath.
+ * ROWS rows are computed concurrently (output-stationary): W is split in ROWS
+ * banks, each cycle the X word at col is broadcast to all of them and each
+ * bank feeds its own LANES-wide tree and accumulator. A run takes
+ * OUT_DIM * LEN / (32 * ROWS) groups of 32/LANES + 1 cycles for ROWS > 1
+ * (ROWS a power of two up to 32), OUT_DIM rows of LEN/LANES + 1 for ROWS = 1.
+ * W memory holds 2^W_ADDR_BITS bytes, addressed as one row-major byte space;
+ * a run reads its matrix from byte offset w_base (latched at start), and the
+ * W_IN streams write from w_base on, so several layers can stay resident.
+ * w_mem_* / x_mem_* are random-access word writes (the wrapper's memory
+ * window) with per-byte enables, alongside the stream ports.
+ * X16 = 1 adds the x_u16 mode for attention's softmax * V: X is 32 unsigned
+ * 16-bit values (Q15 weights up to 2^15), low bytes in X[0..31] and high
+ * bytes in X[32..63] (the two halves, read in the same cycle), and each lane
+ * multiplies {hi, lo} by its int8 W byte. LEN must be 32 (len_64 = 0); Y is
+ * the exact int32 sum (|Y| < 2^22 for weights summing to 2^15).
+ * W_BANKS = 2 doubles the W and b memories: w_bank selects the bank the
+ * streams, the window and the next run use (w_bank is latched at start), and
+ * the prefetch ports w_pf4 / b_pf fill the other bank at their own pointers
+ * (from w_base on, rewound by pf_rewind, untouched by clear_done). The next
+ * layer's weights can so be written while a run computes, and flipping
+ * w_bank selects them without a reload.
+ * PIPELINE = 1 registers the datapath for Fmax: the W/X word read (a BRAM
+ * read), the lane products (one DSP48 each, use_dsp), the adder tree sum and
+ * the finished Y ahead of requant and store. Word pairs enter one per cycle
+ * tagged with their group (first/last column), the accumulators take the sum
+ * in stage 3 and restart from the bias on a first column, so groups follow
+ * each other without a bubble and only the end of the run drains: a run takes
+ * OUT_DIM * LEN / LANES + 5 cycles for ROWS = 1, and for ROWS > 1 its groups
+ * of 32/LANES cycles plus 5. PIPELINE = 0 is the combinational datapath above.
  */
 
 module gemv_core #(
     parameter MAX_LEN     = 64,
     parameter MAX_OUT    = 64,
-    parameter W_ADDR_BITS = 12    /* MAX_OUT * MAX_LEN = 4096 */
+    parameter W_ADDR_BITS = 12,   /* W bytes = 2^W_ADDR_BITS (4096: one 64 x 64 matrix) */
+    parameter LANES       = 1,    /* MACs per cycle and row: 1, 2, 4, 8, 16 or 32 */
+    parameter ROWS        = 1,    /* rows in parallel: 1, 2, 4, 8, 16 or 32 */
+    parameter X16         = 0,    /* 1: x_u16 mode (16-bit unsigned X, 17 x 8-bit multipliers) */
+    parameter W_BANKS     = 1,    /* W/b banks: 1, or 2 to prefetch the next layer (w_bank) */
+    parameter PIPELINE    = 0     /* 1: registered read / multiply / sum / store stages */
 ) (
     input  wire         clk,
     input  wire         reset,
@@ -18,14 +67,50 @@ module gemv_core #(
     input  wire [7:0]   x_wr_data,
     input  wire         w_wr_en,
     input  wire [7:0]   w_wr_data,
+    /* Packed write ports (X_IN4, W_IN4): lanes go to idx..idx+3, idx += 4 */
+    input  wire         x_wr4_en,
+    input  wire [31:0]  x_wr4_data,
+    input  wire         w_wr4_en,
+    input  wire [31:0]  w_wr4_data,
     input  wire         b_wr_en,
     input  wire [31:0]  b_wr_data,
+    /* Word writes at an address (memory window), byte k enabled by sel[k]:
+     * W bytes 4*w_mem_adr..+3 of the row-major W space, X bytes 4*word..+3 of
+     * bank x_mem_adr[4] (x_mem_adr = {bank, word}); no pointer moves */
+    input  wire         w_mem_we,
+    input  wire [W_ADDR_BITS-3:0] w_mem_adr,
+    input  wire [3:0]   w_mem_sel,
+    input  wire [31:0]  w_mem_dat,
+    input  wire         x_mem_we,
+    input  wire [4:0]   x_mem_adr,
+    input  wire [3:0]   x_mem_sel,
+    input  wire [31:0]  x_mem_dat,
+    /* W region (byte offset, multiple of 32 * ROWS) of the W_IN streams and,
+     * latched at start, of the next run */
+    input  wire [W_ADDR_BITS-1:0] w_base,
+    /* Prefetch ports (W_BANKS = 2): 4 packed int8 W / one int32 bias into the
+     * bank w_bank does not select, at their own pointers */
+    input  wire         w_pf4_en,
+    input  wire [31:0]  w_pf4_data,
+    input  wire         b_pf_en,
+    input  wire [31:0]  b_pf_data,
 
     /* Config and start (from CTRL) */
     input  wire         start,
     input  wire         len_64,      /* 0: LEN=32, 1: LEN=64 */
     input  wire         out_dim_64,   /* 0: OUT_DIM=32, 1: OUT_DIM=64 */
+    input  wire         out_dim_16,   /* 1: OUT_DIM=16 (overrides out_dim_64) */
+    input  wire         x_u16,       /* X16 only: X = unsigned {X[32+i], X[i]}, LEN=32 */
     input  wire         bias_en,
+    input  wire         bank,        /* X write / Y read bank (latched for compute at start) */
+    input  wire         w_bank,      /* W_BANKS = 2: W/b bank of the streams, the window and the next run */
+
+    /* Requant stage (from RQ_CFG; hold while busy) */
+    input  wire [5:0]   rq_shift,    /* arithmetic right shift, 0..47 */
+    input  wire         rq_round,    /* add 1 << (shift - 1) before the shift */
+    input  wire         rq_relu,     /* clamp negatives to 0 */
+    input  wire         rq_mul_en,   /* multiply by rq_mul before rounding */
+    input  wire [15:0]  rq_mul,      /* signed multiplier */
 
     /* Status */
     output reg          busy,
@@ -33,33 +118,116 @@ module gemv_core #(
 
     /* Clear done / reset Y read pointer (from CTRL clear_done) */
     input  wire         clear_done,
+    /* Clear done / reset X write and Y read pointers, keep W/b (from CTRL clear_x) */
+    input  wire         clear_x,
+    /* Reset X write and Y read pointers only (from CTRL rewind) */
+    input  wire         rewind,
+    /* Reset the prefetch pointers (from CTRL pf_rewind) */
+    input  wire         pf_rewind,
 
     /* Read port for Y (wrapper asserts when CPU reads Y_OUT) */
     input  wire         y_rd_en,
-    output wire [31:0]  y_rd_data
+    output wire [31:0]  y_rd_data,
+    /* Packed int8 Y: 4 requantized rows at the read index; y_rd4_en advances it by 4 */
+    input  wire         y_rd4_en,
+    output wire [31:0]  y8_rd_data
 );
 
     localparam LEN_BITS   = 6;
     localparam OUT_BITS   = 6;
+    localparam LANE_BITS  = $clog2(LANES);
+    localparam CHUNK      = 32;                                 /* W bank interleave, bytes */
+    localparam XH_WORDS   = MAX_LEN / 2 / LANES;                /* words per X half and bank */
+    localparam WB_WORDS   = (1 << W_ADDR_BITS) / ROWS / LANES;  /* words per W row bank */
 
-    /* Internal memories */
-    reg signed [7:0]    x_mem [0:MAX_LEN-1];
-    reg signed [7:0]    w_mem [0:(MAX_OUT*MAX_LEN)-1];
-    reg signed [31:0]   b_mem [0:MAX_OUT-1];
-    reg signed [31:0]   y_mem [0:MAX_OUT-1];
+    /* Internal memories; X and Y hold two banks, indexed {bank, idx}.
+     * X and W are LANES bytes wide: element i is byte i % LANES of word i / LANES.
+     * X is split in halves X[0..31] / X[32..63] so both can be read per cycle.
+     * W (g_row[r].w_mem) is split in ROWS banks, 32-byte chunk c of the row-major
+     * matrix going to bank c % ROWS, so the layout does not depend on len_64. */
+    reg [8*LANES-1:0]   x_lo [0:2*XH_WORDS-1];
+    reg [8*LANES-1:0]   x_hi [0:2*XH_WORDS-1];
+    reg signed [31:0]   b_mem [0:W_BANKS*MAX_OUT-1];
+    reg signed [31:0]   y_mem [0:2*MAX_OUT-1];
+    reg signed [7:0]    y8_mem [0:2*MAX_OUT-1];
 
-    /* Write indices (reset on clear_done) */
+    /* Write indices (X on clear_done or clear_x; W/b on clear_done only) */
     reg [LEN_BITS-1:0]  x_wr_idx;
     reg [W_ADDR_BITS-1:0] w_wr_idx;
     reg [OUT_BITS-1:0] b_wr_idx;
+    /* Prefetch write indices (pf_rewind only) */
+    reg [W_ADDR_BITS-1:0] w_pf_idx;
+    reg [OUT_BITS-1:0]  b_pf_idx;
     /* Read index for Y */
     reg [OUT_BITS-1:0]  y_rd_idx;
 
+    /* Bank of the running computation (latched at start) */
+    reg                 cbank;
+    wire [LEN_BITS-1:0] x_wr_off;    /* {bank, idx} within the X half */
+    assign x_wr_off = {bank, x_wr_idx[LEN_BITS-2:0]};
+
+    /* W/b banks: wsel takes the streams and the window, the prefetch ports
+     * write the other one; the run reads cwsel (wsel latched at start). Each
+     * bank is WB_WORDS words of every W row bank and MAX_OUT biases. */
+    wire                wsel;
+    reg                 cwsel;
+    wire [31:0]         wb_wr;       /* first W word / bias of the stream bank */
+    wire [31:0]         wb_pf;       /* ... of the prefetch bank */
+    wire [31:0]         wb_rd;       /* ... of the running bank */
+    wire [31:0]         bb_wr;
+    wire [31:0]         bb_pf;
+    assign wsel    = (W_BANKS > 1) && w_bank;
+    assign wb_wr   = wsel  ? WB_WORDS : 0;
+    assign wb_pf   = wsel  ? 0 : WB_WORDS;
+    assign wb_rd   = cwsel ? WB_WORDS : 0;
+    assign bb_wr   = wsel  ? MAX_OUT : 0;
+    assign bb_pf   = wsel  ? 0 : MAX_OUT;
+
+    /* W write: bank and word offset of byte w_base + w_wr_idx */
+    wire                w_wr_ok;
+    wire [W_ADDR_BITS-1:0] w_wr_addr;
+    wire [W_ADDR_BITS-6:0] w_wr_chunk;
+    wire [W_ADDR_BITS-1:0] w_wr_off;
+    assign w_wr_ok    = !reset && !clear_done && !clear_x && !rewind;
+    assign w_wr_addr  = w_base + w_wr_idx;
+    assign w_wr_chunk = w_wr_addr[W_ADDR_BITS-1:5];
+    assign w_wr_off   = (w_wr_chunk / ROWS) * CHUNK + w_wr_addr[4:0];
+
+    /* W prefetch write: same mapping for byte w_base + w_pf_idx */
+    wire                w_pf_ok;
+    wire [W_ADDR_BITS-1:0] w_pf_addr;
+    wire [W_ADDR_BITS-6:0] w_pf_chunk;
+    wire [W_ADDR_BITS-1:0] w_pf_off;
+    assign w_pf_ok    = (W_BANKS > 1) && !reset && !pf_rewind;
+    assign w_pf_addr  = w_base + w_pf_idx;
+    assign w_pf_chunk = w_pf_addr[W_ADDR_BITS-1:5];
+    assign w_pf_off   = (w_pf_chunk / ROWS) * CHUNK + w_pf_addr[4:0];
+
+    /* W window write: same mapping for byte 4 * w_mem_adr */
+    wire [W_ADDR_BITS-6:0] w_mem_chunk;
+    wire [W_ADDR_BITS-1:0] w_mem_off;
+    assign w_mem_chunk = w_mem_adr[W_ADDR_BITS-3:3];
+    assign w_mem_off   = (w_mem_chunk / ROWS) * CHUNK + {w_mem_adr[2:0], 2'b00};
+
+    /* X window write: {bank, byte} within the half selected by word bit 3 */
+    wire [LEN_BITS-1:0] x_mem_off;
+    assign x_mem_off = {x_mem_adr[4], x_mem_adr[2:0], 2'b00};
+
     /* Effective dimensions */
     wire [LEN_BITS:0]   LEN;      /* 32 or 64 */
     wire [OUT_BITS:0]  OUT_DIM;
     assign LEN     = len_64     ? 64 : 32;
-    assign OUT_DIM = out_dim_64 ? 64 : 32;
+    assign OUT_DIM = out_dim_16 ? 16 : out_dim_64 ? 64 : 32;
+
+    /* Row groups: ROWS = 1 walks each row over LEN columns. Otherwise a group
+     * walks 32 columns of ROWS banks: ROWS rows for LEN=32, or ROWS/2 rows for
+     * LEN=64 with the halves of row j in banks 2j and 2j+1 (split). */
+    wire                split;
+    wire [LEN_BITS:0]   SWEEP;    /* columns per group */
+    wire [OUT_BITS:0]   RPG;      /* rows per group */
+    assign split = len_64 && (ROWS > 1);
+    assign SWEEP = (ROWS > 1) ? CHUNK : LEN;
+    assign RPG   = split ? ROWS / 2 : ROWS;
 
     /* FSM */
     localparam [2:0] S_IDLE   = 3'd0,
@@ -67,20 +235,156 @@ module gemv_core #(
                      S_DONE   = 3'd2;
     reg [2:0] state;
 
-    /* Compute indices (current row, current column in row); col must reach LEN (64) so use LEN_BITS+1 */
+    /* Bias bank the accumulators load from: the next run's at start */
+    wire [31:0]         bb_init;
+    assign bb_init = ((state == S_COMPUTE) ? cwsel : wsel) ? MAX_OUT : 0;
+
+    /* PIPELINE = 1: tags of the word pair in each stage (1 read, 2 multiply,
+     * 3 sum into acc), 4 = group finished in acc, 5 = its Y in row_fin. iss is
+     * set while groups are still issued (row wraps at OUT_DIM = 64). */
+    reg                 iss;
+    reg [5:1]           pv;
+    reg [3:1]           pfirst;
+    reg [3:1]           plast;
+    reg                 phi;         /* stage 1: col was in the upper X half */
+    reg [OUT_BITS-1:0]  prow [1:5];
+
+    /* Compute indices (first row of the group, current column); col must reach LEN (64) so use LEN_BITS+1 */
     reg [OUT_BITS-1:0] row;
     reg [LEN_BITS:0]   col;  /* 0..LEN inclusive so col < LEN works for LEN=64 */
-    reg signed [31:0]  acc;
-    /* Explicitly sized row_base to avoid implicit-width bugs: row_base = row * LEN (32 or 64) */
-    wire [W_ADDR_BITS-1:0] row_base;
+    /* Offset of the group in each W bank (w_base + row * LEN for ROWS = 1) */
+    reg [W_ADDR_BITS-1:0] row_base;
     wire [W_ADDR_BITS-1:0] w_addr;
-    assign row_base = len_64 ? ({6'd0, row} * 12'd64) : ({6'd0, row} * 12'd32);
-    assign w_addr   = row_base + {5'd0, col};
+    assign w_addr = row_base + {5'd0, col};
+    /* One accumulator per W bank */
+    reg signed [31:0]  acc [0:ROWS-1];
 
     /* Y read output: combinatorial */
-    assign y_rd_data = y_mem[y_rd_idx];
+    assign y_rd_data = y_mem[{bank, y_rd_idx}];
+    /* y_rd_idx is a multiple of 4 for packed reads, so +1..+3 stay in the bank */
+    wire [OUT_BITS:0] y8_rd_addr;
+    assign y8_rd_addr = {bank, y_rd_idx};
+    assign y8_rd_data = {y8_mem[y8_rd_addr + 7'd3], y8_mem[y8_rd_addr + 7'd2],
+                         y8_mem[y8_rd_addr + 7'd1], y8_mem[y8_rd_addr]};
 
-    /* --- Write path: X, W, B --- */
+    /* X words at col: both halves, the split banks take one each
+     * (PIPELINE: registered, one cycle behind col) */
+    wire [8*LANES-1:0]  x_lo_word;
+    wire [8*LANES-1:0]  x_hi_word;
+    wire                x_half;      /* upper half for ROWS = 1 */
+    reg  [8*LANES-1:0]  x_lo_q;
+    reg  [8*LANES-1:0]  x_hi_q;
+    always @(posedge clk) begin
+        x_lo_q <= x_lo[{cbank, col[LEN_BITS-2:0]} >> LANE_BITS];
+        x_hi_q <= x_hi[{cbank, col[LEN_BITS-2:0]} >> LANE_BITS];
+    end
+    assign x_lo_word = PIPELINE ? x_lo_q : x_lo[{cbank, col[LEN_BITS-2:0]} >> LANE_BITS];
+    assign x_hi_word = PIPELINE ? x_hi_q : x_hi[{cbank, col[LEN_BITS-2:0]} >> LANE_BITS];
+    assign x_half    = PIPELINE ? phi : col[LEN_BITS-1];
+
+    /* First row of the group the accumulators are loaded for (PIPELINE: the
+     * group of the first column in stage 3) */
+    wire [OUT_BITS:0]   init_row;
+    assign init_row = PIPELINE ? {1'b0, prow[3]} : (state == S_COMPUTE) ? row + RPG : 7'd0;
+
+    wire signed [31:0]  row_sum  [0:ROWS-1];   /* products of bank r this cycle */
+    wire signed [31:0]  acc_init [0:ROWS-1];   /* bias (or 0) of bank r for init_row */
+    wire signed [31:0]  row_out  [0:ROWS-1];   /* Y of row row + r */
+    wire signed [31:0]  row_fin  [0:ROWS-1];   /* Y stored (PIPELINE: row_out a cycle later) */
+    wire signed [7:0]   row_y8   [0:ROWS-1];   /* Y8 of row row + r */
+
+    genvar g, r;
+    generate
+        for (r = 0; r < ROWS; r = r + 1) begin : g_row
+            /* --- W bank r --- */
+            reg [8*LANES-1:0] w_mem [0:W_BANKS*WB_WORDS-1];
+            integer k;
+            always @(posedge clk) begin
+                if (w_wr_ok && (w_wr_chunk % ROWS) == r) begin
+                    if (w_wr_en)
+                        w_mem[wb_wr + w_wr_off / LANES][8*(w_wr_off % LANES) +: 8] <= w_wr_data;
+                    else if (w_wr4_en)
+                        /* w_wr_idx is a multiple of 4 here, so +1..+3 stay in the chunk */
+                        for (k = 0; k < 4; k = k + 1)
+                            w_mem[wb_wr + (w_wr_off + k) / LANES][8*((w_wr_off + k) % LANES) +: 8] <= w_wr4_data[8*k +: 8];
+                end
+                /* The window is on the CPU bus, so it never writes in the same cycle as a CSR stream */
+                if (w_mem_we && (w_mem_chunk % ROWS) == r) begin
+                    for (k = 0; k < 4; k = k + 1)
+                        if (w_mem_sel[k])
+                            w_mem[wb_wr + (w_mem_off + k) / LANES][8*((w_mem_off + k) % LANES) +: 8] <= w_mem_dat[8*k +: 8];
+                end
+                /* W_PF4 is a CSR too (and W_BANKS = 2 excludes DMA W fetches) */
+                if (w_pf_ok && w_pf4_en && (w_pf_chunk % ROWS) == r) begin
+                    for (k = 0; k < 4; k = k + 1)
+                        w_mem[wb_pf + (w_pf_off + k) / LANES][8*((w_pf_off + k) % LANES) +: 8] <= w_pf4_data[8*k +: 8];
+                end
+            end
+
+            /* --- MAC lanes: heap-ordered adder tree (node n = node 2n+1 +
+             * node 2n+2, leaves are the products) --- */
+            wire [8*LANES-1:0] w_word;
+            wire [8*LANES-1:0] x_word;
+            reg  [8*LANES-1:0] w_q;      /* PIPELINE: synchronous (BRAM) read */
+            always @(posedge clk)
+                w_q <= w_mem[wb_rd + (w_addr >> LANE_BITS)];
+            assign w_word = PIPELINE ? w_q : w_mem[wb_rd + (w_addr >> LANE_BITS)];
+            assign x_word = (split ? (r % 2 == 1) : x_half) ? x_hi_word : x_lo_word;
+            wire signed [31:0] mac_tree [0:2*LANES-2];
+            for (g = 0; g < LANES; g = g + 1) begin : g_lane
+                (* use_dsp = "yes" *) wire signed [31:0] prod;
+                if (X16) begin : g_x16
+                    /* x_u16: zero-extended {hi, lo} * int8; LEN=32 keeps col in the lo/hi word */
+                    assign prod = x_u16
+                        ? $signed({1'b0, x_hi_word[8*g +: 8], x_lo_word[8*g +: 8]}) * $signed(w_word[8*g +: 8])
+                        : $signed(x_word[8*g +: 8]) * $signed(w_word[8*g +: 8]);
+                end else begin : g_x8
+                    /* Signed int8 * int8 -> int32; explicit $signed for clarity */
+                    assign prod = $signed(x_word[8*g +: 8]) * $signed(w_word[8*g +: 8]);
+                end
+                /* PIPELINE: the DSP output register */
+                reg signed [31:0] prod_q;
+                always @(posedge clk)
+                    prod_q <= prod;
+                assign mac_tree[LANES-1+g] = PIPELINE ? prod_q : prod;
+            end
+            for (g = 0; g < LANES-1; g = g + 1) begin : g_add
+                assign mac_tree[g] = mac_tree[2*g+1] + mac_tree[2*g+2];
+            end
+            reg signed [31:0] sum_q;
+            always @(posedge clk)
+                sum_q <= mac_tree[0];
+            assign row_sum[r] = PIPELINE ? sum_q : mac_tree[0];
+
+            /* Split rows: bank 2j+1 holds the upper half and starts from 0 */
+            assign acc_init[r] = (bias_en && !(split && r % 2 == 1))
+                               ? b_mem[bb_init + init_row + (split ? r / 2 : r)] : 32'sd0;
+            if (2*r+1 < ROWS) begin : g_pair
+                assign row_out[r] = split ? acc[2*r] + acc[2*r+1] : acc[r];
+            end else begin : g_one
+                assign row_out[r] = acc[r];
+            end
+            reg signed [31:0] out_q;
+            always @(posedge clk)
+                out_q <= row_out[r];
+            assign row_fin[r] = PIPELINE ? out_q : row_out[r];
+
+            /* --- Requant of the finished row --- */
+            wire signed [47:0] rq_prod;
+            wire signed [47:0] rq_rnd;
+            wire signed [47:0] rq_shr;
+            assign rq_prod = rq_mul_en ? (row_fin[r] * $signed(rq_mul)) : {{16{row_fin[r][31]}}, row_fin[r]};
+            assign rq_rnd  = (rq_round && rq_shift != 6'd0) ? (48'sd1 <<< (rq_shift - 6'd1)) : 48'sd0;
+            assign rq_shr  = (rq_prod + rq_rnd) >>> rq_shift;
+            assign row_y8[r] = (rq_relu && rq_shr < 0) ? 8'sd0 :
+                               (rq_shr > 127)          ? 8'sd127 :
+                               (rq_shr < -128)         ? -8'sd128 :
+                                                         rq_shr[7:0];
+        end
+    endgenerate
+
+    /* --- Write path: X, B (W is written in g_row) --- */
+    integer k;
     always @(posedge clk) begin
         if (reset) begin
             x_wr_idx <= 0;
@@ -90,39 +394,96 @@ module gemv_core #(
             x_wr_idx <= 0;
             w_wr_idx <= 0;
             b_wr_idx <= 0;
+        end else if (clear_x || rewind) begin
+            x_wr_idx <= 0;
         end else begin
             if (x_wr_en) begin
-                x_mem[x_wr_idx[LEN_BITS-1:0]] <= x_wr_data;
+                if (x_wr_idx[LEN_BITS-1])
+                    x_hi[x_wr_off / LANES][8*(x_wr_off % LANES) +: 8] <= x_wr_data;
+                else
+                    x_lo[x_wr_off / LANES][8*(x_wr_off % LANES) +: 8] <= x_wr_data;
                 x_wr_idx <= x_wr_idx + 1;
+            end else if (x_wr4_en) begin
+                /* x_wr_idx is a multiple of 4 here, so +1..+3 stay in the half */
+                for (k = 0; k < 4; k = k + 1)
+                    if (x_wr_idx[LEN_BITS-1])
+                        x_hi[(x_wr_off + k) / LANES][8*((x_wr_off + k) % LANES) +: 8] <= x_wr4_data[8*k +: 8];
+                    else
+                        x_lo[(x_wr_off + k) / LANES][8*((x_wr_off + k) % LANES) +: 8] <= x_wr4_data[8*k +: 8];
+                x_wr_idx <= x_wr_idx + 4;
             end
-            if (w_wr_en) begin
-                w_mem[w_wr_idx] <= w_wr_data;
-                w_wr_idx <= w_wr_idx + 1;
+            if (x_mem_we) begin
+                for (k = 0; k < 4; k = k + 1)
+                    if (x_mem_sel[k])
+                        if (x_mem_adr[3])
+                            x_hi[(x_mem_off + k) / LANES][8*((x_mem_off + k) % LANES) +: 8] <= x_mem_dat[8*k +: 8];
+                        else
+                            x_lo[(x_mem_off + k) / LANES][8*((x_mem_off + k) % LANES) +: 8] <= x_mem_dat[8*k +: 8];
             end
+            if (w_wr_en)
+                w_wr_idx <= w_wr_idx + 1;
+            else if (w_wr4_en)
+                w_wr_idx <= w_wr_idx + 4;
             if (b_wr_en) begin
-                b_mem[b_wr_idx[OUT_BITS-1:0]] <= b_wr_data;
+                b_mem[bb_wr + b_wr_idx[OUT_BITS-1:0]] <= b_wr_data;
                 b_wr_idx <= b_wr_idx + 1;
             end
         end
+        /* Prefetch pointers: clear_done / clear_x / rewind leave them alone */
+        if (reset || pf_rewind) begin
+            w_pf_idx <= 0;
+            b_pf_idx <= 0;
+        end else if (W_BANKS > 1) begin
+            if (w_pf4_en)
+                w_pf_idx <= w_pf_idx + 4;
+            if (b_pf_en) begin
+                b_mem[bb_pf + b_pf_idx] <= b_pf_data;
+                b_pf_idx <= b_pf_idx + 1;
+            end
+        end
     end
 
-    /* --- Y read index: advance on read, reset on clear_done --- */
+    /* --- Y read index: advance on read, reset on clear_done / clear_x / rewind --- */
     always @(posedge clk) begin
-        if (reset || clear_done)
+        if (reset || clear_done || clear_x || rewind)
             y_rd_idx <= 0;
         else if (y_rd_en)
             y_rd_idx <= y_rd_idx + 1;
+        else if (y_rd4_en)
+            y_rd_idx <= y_rd_idx + 4;
+    end
+
+    /* --- PIPELINE tags: a word pair is issued per cycle while iss --- */
+    always @(posedge clk) begin
+        if (reset)
+            pv <= 0;
+        else
+            pv <= {pv[4], pv[3] && plast[3], pv[2], pv[1], (state == S_COMPUTE) && iss};
+        pfirst <= {pfirst[2:1], col == 0};
+        plast  <= {plast[2:1], col + LANES >= SWEEP};
+        phi    <= col[LEN_BITS-1];
+        prow[1] <= row;
+        prow[2] <= prow[1];
+        prow[3] <= prow[2];
+        prow[4] <= prow[3];
+        prow[5] <= prow[4];
     end
 
     /* --- FSM: IDLE -> COMPUTE -> DONE --- */
+    integer j;
     always @(posedge clk) begin
         if (reset) begin
-            state <= S_IDLE;
-            busy  <= 0;
-            done  <= 0;
-            row   <= 0;
-            col   <= 0;
-            acc   <= 0;
+            state    <= S_IDLE;
+            busy     <= 0;
+            done     <= 0;
+            row      <= 0;
+            col      <= 0;
+            row_base <= 0;
+            iss      <= 0;
+            for (j = 0; j < ROWS; j = j + 1)
+                acc[j] <= 0;
+            cbank <= 0;
+            cwsel <= 0;
         end else begin
             case (state)
                 S_IDLE: begin
@@ -132,32 +493,87 @@ module gemv_core #(
                         done  <= 0;   /* clear stale DONE at start of new run */
                         row   <= 0;
                         col   <= 0;
-                        acc   <= bias_en ? b_mem[0] : 32'sd0;
+                        row_base <= w_base / ROWS;
+                        iss      <= 1;
+                        for (j = 0; j < ROWS; j = j + 1)
+                            acc[j] <= acc_init[j];
+                        cbank <= bank;
+                        cwsel <= wsel;
                     end
                 end
 
-                S_COMPUTE: begin
-                    if (col < LEN) begin
-                        /* Signed int8 * int8 -> int32; explicit $signed for clarity */
-                        acc <= acc + ($signed(x_mem[col[LEN_BITS-1:0]]) * $signed(w_mem[w_addr]));
-                        col <= col + 1;
+                S_COMPUTE: if (PIPELINE) begin
+                    /* Issue: LANES columns per cycle, the next group right after */
+                    if (iss) begin
+                        if (col + LANES < SWEEP)
+                            col <= col + LANES;
+                        else begin
+                            col <= 0;
+                            row <= row + RPG;
+                            row_base <= row_base + SWEEP;
+                            if (row + RPG >= OUT_DIM)
+                                iss <= 0;
+                        end
+                    end
+                    /* Stage 3: a first column restarts the accumulators */
+                    if (pv[3])
+                        for (j = 0; j < ROWS; j = j + 1)
+                            acc[j] <= (pfirst[3] ? acc_init[j] : acc[j]) + row_sum[j];
+                    /* Stage 5: store the group's rows from row_fin */
+                    if (pv[5]) begin
+                        for (j = 0; j < ROWS; j = j + 1)
+                            if (j < RPG && prow[5] + j < OUT_DIM) begin
+                                y_mem[{cbank, prow[5] + j[OUT_BITS-1:0]}]  <= row_fin[j];
+                                y8_mem[{cbank, prow[5] + j[OUT_BITS-1:0]}] <= row_y8[j];
+                            end
+                        if (prow[5] + RPG >= OUT_DIM) begin
+                            state <= S_DONE;
+                            busy  <= 0;
+                        end
+                    end
+                end else begin
+                    if (col < SWEEP) begin
+                        /* LANES columns per cycle in every bank; LANES divides SWEEP */
+                        for (j = 0; j < ROWS; j = j + 1)
+                            acc[j] <= acc[j] + row_sum[j];
+                        col <= col + LANES;
                     end else begin
-                        y_mem[row] <= acc;
-                        row <= row + 1;
+                        /* Store the RPG rows of the group (fewer if OUT_DIM=16 < RPG) */
+                        for (j = 0; j < ROWS; j = j + 1)
+                            if (j < RPG && row + j < OUT_DIM) begin
+                                y_mem[{cbank, row + j[OUT_BITS-1:0]}]  <= row_out[j];
+                                y8_mem[{cbank, row + j[OUT_BITS-1:0]}] <= row_y8[j];
+                            end
+                        row <= row + RPG;
                         col <= 0;
-                        if (row + 1 >= OUT_DIM) begin
+                        row_base <= row_base + SWEEP;
+                        if (row + RPG >= OUT_DIM) begin
                             state <= S_DONE;
                             busy  <= 0;
                         end else
-                            acc <= bias_en ? b_mem[row + 1] : 32'sd0;
+                            for (j = 0; j < ROWS; j = j + 1)
+                                acc[j] <= acc_init[j];
                     end
                 end
 
                 S_DONE: begin
                     done <= 1;
-                    if (clear_done) begin
+                    if (clear_done || clear_x) begin
                         state <= S_IDLE;
                         done  <= 0;
+                    end else if (start) begin
+                        /* Back-to-back run (pipelined tokens): no clear needed */
+                        state <= S_COMPUTE;
+                        busy  <= 1;
+                        done  <= 0;
+                        row   <= 0;
+                        col   <= 0;
+                        row_base <= w_base / ROWS;
+                        iss      <= 1;
+                        for (j = 0; j < ROWS; j = j + 1)
+                            acc[j] <= acc_init[j];
+                        cbank <= bank;
+                        cwsel <= wsel;
                     end else
                         state <= S_DONE;
                 end
@@ -7,97 +7,1127 @@
  * for one cycle. Y read pointer is advanced by writing to Y_NEXT (not by reading Y_OUT).
  *
  * Two backends: GEMV_USE_LITEX_CSR (generated/csr.h) or GEMV_BASE (raw MMIO).
+ *
+ * GEMV_DMA: the block writes Y to memory behind the CPU's D-cache, so gemv_poll()
+ * flushes it (LiteX flush_cpu_dcache(), or GEMV_DCACHE_FLUSH() with raw MMIO).
+ *
+ * GEMV_MEM: window stores go straight to GEMV_MEM_BASE, which must be an uncached
+ * (I/O) region.
+ *
+ * GEMV_ATTN: W_BASE is latched at start, so the attention runs switch it to the
+ * K or V^T region for the start write only; between driver calls it always
+ * holds the region of gemv_set_w_base() (0 without GEMV_MEM).
+ *
+ * GEMV_IRQ: the CPU-side hooks below (WFI, mstatus.MIE, IRQ controller mask)
+ * default to RV32 / LiteX VexRiscv; override them for other CPUs.
+ *
+ * GEMV_W_BANKS=2: every CTRL write carries the W bank of the resident matrix
+ * (GEMV_CTRL_W_SEL), so the pulses and config writes above never switch banks
+ * by themselves; gemv_w_resident() flips it when it takes the prefetched one.
+ *
+ * GEMV_DEVICES: the gemv_dev_* calls reach each instance through the addresses in
+ * its handle, with GEMV_DEV_WRITE() / GEMV_DEV_READ() (LiteX csr_write_simple() /
+ * csr_read_simple(), or plain volatile accesses with raw MMIO); override both for
+ * other buses.
+ *
+ * GEMV_CLOCK_GATE: every call that pulses or streams to the core, or reads Y,
+ * runs between GEMV_POWER_GET() and GEMV_POWER_PUT(). Nested calls only count
+ * the reference; STATUS (busy, done) reads correctly with the clock off, so
+ * gemv_wait_done() and gemv_poll() need none.
+ *
+ * TINYFORMER_TRACE=1 (firmware built with make TRACE=1): job starts and done
+ * events go to the firmware's trace ring (litex_port/common/tf_trace.h).
  */
 
 #include "gemv.h"
 #include <stddef.h>
+#if TINYFORMER_TRACE
+#  include "tf_trace.h"
+#  define GEMV_TRACE(ev, arg)  TF_TRACE(ev, arg)
+#else
+#  define GEMV_TRACE(ev, arg)  ((void)0)
+#endif
 
 /* --- CSR access: LiteX generated or raw MMIO --- */
 #if defined(GEMV_USE_LITEX_CSR)
 #  include <generated/csr.h>
 #  define GEMV_READ_CTRL()     gemv_ctrl_read()
-#  define GEMV_WRITE_CTRL(v)   gemv_ctrl_write(v)
+#  define GEMV_WRITE_CTRL(v)   gemv_ctrl_write((v) | GEMV_CTRL_W_SEL)
 #  define GEMV_READ_STATUS()   gemv_status_read()
 #  define GEMV_WRITE_X(v)      gemv_x_in_write((uint32_t)(uint8_t)(v))
 #  define GEMV_WRITE_W(v)      gemv_w_in_write((uint32_t)(uint8_t)(v))
 #  define GEMV_WRITE_B(v)      gemv_b_in_write((uint32_t)(v))
 #  define GEMV_READ_Y()        gemv_y_out_read()
 #  define GEMV_WRITE_Y_NEXT()  gemv_y_next_write(1u)
+#  define GEMV_WRITE_X4(v)     gemv_x_in4_write((uint32_t)(v))
+#  define GEMV_WRITE_W4(v)     gemv_w_in4_write((uint32_t)(v))
+#  define GEMV_WRITE_RQ(v)     gemv_rq_cfg_write((uint32_t)(v))
+#  define GEMV_READ_Y8()       gemv_y8_out_read()
+#  define GEMV_WRITE_Y_NEXT4() gemv_y_next_write(4u)
+#  define GEMV_WRITE_EV_PENDING(v) gemv_ev_pending_write(v)
+#  define GEMV_WRITE_EV_ENABLE(v)  gemv_ev_enable_write(v)
+#  if GEMV_IRQ
+#    include <generated/soc.h>   /* GEMV_INTERRUPT */
+#  endif
+#  if GEMV_DMA
+#    include <system.h>
+#    define GEMV_WRITE_DMA_W(a)   gemv_dma_w_addr_write(a)
+#    define GEMV_WRITE_DMA_X(a)   gemv_dma_x_addr_write(a)
+#    define GEMV_WRITE_DMA_Y(a)   gemv_dma_y_addr_write(a)
+#    define GEMV_WRITE_DMA_CTRL(v) gemv_dma_ctrl_write(v)
+#    define GEMV_READ_DMA_STATUS() gemv_dma_status_read()
+#    ifndef GEMV_DCACHE_FLUSH
+#      define GEMV_DCACHE_FLUSH()  flush_cpu_dcache()
+#    endif
+#  endif
+#  if GEMV_MEM
+#    include <generated/mem.h>   /* GEMV_MEM_BASE */
+#  endif
+#  if GEMV_MEM || GEMV_ATTN
+#    define GEMV_WRITE_W_BASE(v)  gemv_w_base_write((uint32_t)(v))
+#  endif
+#  if GEMV_W_BANKS == 2
+#    define GEMV_WRITE_W_PF4(v)   gemv_w_pf4_write((uint32_t)(v))
+#    define GEMV_WRITE_B_PF(v)    gemv_b_pf_write((uint32_t)(v))
+#  endif
+#  if GEMV_CLOCK_GATE
+#    define GEMV_WRITE_CLK_EN(v)  gemv_clk_en_write((uint32_t)(v))
+#  endif
 #else
 #  ifndef GEMV_BASE
 #    error "Define GEMV_BASE or GEMV_USE_LITEX_CSR"
 #  endif
 #  define GEMV_REG(off)   (*(volatile uint32_t *)(GEMV_BASE + (off)))
 #  define GEMV_READ_CTRL()    GEMV_REG(GEMV_CTRL)
-#  define GEMV_WRITE_CTRL(v) (GEMV_REG(GEMV_CTRL) = (uint32_t)(v))
+#  define GEMV_WRITE_CTRL(v) (GEMV_REG(GEMV_CTRL) = (uint32_t)(v) | GEMV_CTRL_W_SEL)
 #  define GEMV_READ_STATUS() GEMV_REG(GEMV_STATUS)
 #  define GEMV_WRITE_X(v)    (GEMV_REG(GEMV_X_IN) = (uint32_t)(uint8_t)(v))
 #  define GEMV_WRITE_W(v)    (GEMV_REG(GEMV_W_IN) = (uint32_t)(uint8_t)(v))
 #  define GEMV_WRITE_B(v)    (GEMV_REG(GEMV_B_IN) = (uint32_t)(v))
 #  define GEMV_READ_Y()      GEMV_REG(GEMV_Y_OUT)
 #  define GEMV_WRITE_Y_NEXT() (GEMV_REG(GEMV_Y_NEXT) = 1u)
+#  define GEMV_WRITE_X4(v)   (GEMV_REG(GEMV_X_IN4) = (uint32_t)(v))
+#  define GEMV_WRITE_W4(v)   (GEMV_REG(GEMV_W_IN4) = (uint32_t)(v))
+#  define GEMV_WRITE_RQ(v)   (GEMV_REG(GEMV_RQ_CFG) = (uint32_t)(v))
+#  define GEMV_READ_Y8()     GEMV_REG(GEMV_Y8_OUT)
+#  define GEMV_WRITE_Y_NEXT4() (GEMV_REG(GEMV_Y_NEXT) = 4u)
+#  define GEMV_WRITE_EV_PENDING(v) (GEMV_REG(GEMV_EV_PENDING) = (uint32_t)(v))
+#  define GEMV_WRITE_EV_ENABLE(v)  (GEMV_REG(GEMV_EV_ENABLE) = (uint32_t)(v))
+#  define GEMV_WRITE_DMA_W(a)    (GEMV_REG(GEMV_DMA_W_ADDR) = (uint32_t)(a))
+#  define GEMV_WRITE_DMA_X(a)    (GEMV_REG(GEMV_DMA_X_ADDR) = (uint32_t)(a))
+#  define GEMV_WRITE_DMA_Y(a)    (GEMV_REG(GEMV_DMA_Y_ADDR) = (uint32_t)(a))
+#  define GEMV_WRITE_DMA_CTRL(v) (GEMV_REG(GEMV_DMA_CTRL) = (uint32_t)(v))
+#  define GEMV_READ_DMA_STATUS() GEMV_REG(GEMV_DMA_STATUS)
+#  define GEMV_WRITE_W_BASE(v)   (GEMV_REG(GEMV_W_BASE) = (uint32_t)(v))
+#  define GEMV_WRITE_W_PF4(v)    (GEMV_REG(GEMV_W_PF4) = (uint32_t)(v))
+#  define GEMV_WRITE_B_PF(v)     (GEMV_REG(GEMV_B_PF) = (uint32_t)(v))
+#  define GEMV_WRITE_CLK_EN(v)   (GEMV_REG(GEMV_CLK_EN) = (uint32_t)(v))
+#  ifndef GEMV_DCACHE_FLUSH
+#    define GEMV_DCACHE_FLUSH()  ((void)0)   /* define for a CPU with a write-back / non-snooping D-cache */
+#  endif
+#endif
+
+#if GEMV_MEM
+#  ifndef GEMV_MEM_BASE
+#    error "Define GEMV_MEM_BASE (W/X window address) for GEMV_MEM"
+#  endif
+#  define GEMV_MEM_WORD(off)  (((volatile uint32_t *)(uintptr_t)(GEMV_MEM_BASE))[(off) >> 2])
+#endif
+
+#if GEMV_IRQ
+#  ifndef GEMV_WFI
+#    define GEMV_WFI()            __asm__ volatile ("wfi")
+#  endif
+/* Mask machine interrupts (mstatus.MIE) / restore the saved mstatus */
+#  ifndef GEMV_IRQ_SAVE
+#    define GEMV_IRQ_SAVE(s)      __asm__ volatile ("csrrci %0, mstatus, 8" : "=r"(s))
+#    define GEMV_IRQ_RESTORE(s)   __asm__ volatile ("csrw mstatus, %0" :: "r"(s))
+#  endif
+/* Unmask the GEMV line in the VexRiscv IRQ controller (CSR 0xBC0), enable MIE */
+#  ifndef GEMV_CPU_IRQ_ENABLE
+#    ifndef GEMV_INTERRUPT
+#      error "Define GEMV_INTERRUPT (IRQ line) or GEMV_CPU_IRQ_ENABLE() for GEMV_IRQ"
+#    endif
+#    define GEMV_CPU_IRQ_ENABLE() do {                                            \
+         __asm__ volatile ("csrs 0xBC0, %0" :: "r"(1u << GEMV_INTERRUPT));      \
+         __asm__ volatile ("csrsi mstatus, 8");                                  \
+     } while (0)
+#  endif
 #endif
 
 static uintptr_t s_gemv_base;
 
+/* Matrix currently held in the block's W memory (see gemv_w_resident). */
+static const int8_t *s_w_src;
+static int s_w_out_dim;
+static int s_w_len;
+#if GEMV_MEM || GEMV_ATTN
+/* W region selected with gemv_set_w_base() (0 without GEMV_MEM) */
+static uint32_t s_w_base;
+#endif
+
+#if GEMV_CLOCK_GATE
+/* gemv_power_get() references held, and the wake-ups they took */
+static int s_power_refs;
+static gemv_power_stats_t s_power_stats;
+#  define GEMV_POWER_GET()  gemv_power_get()
+#  define GEMV_POWER_PUT()  gemv_power_put()
+#else
+#  define GEMV_POWER_GET()  ((void)0)
+#  define GEMV_POWER_PUT()  ((void)0)
+#endif
+
+#if GEMV_W_BANKS == 2
+/* CTRL.w_bank of the resident matrix, OR-ed into every CTRL write */
+static uint32_t s_w_ctrl;
+#  define GEMV_CTRL_W_SEL  s_w_ctrl
+/* CTRL bits a prefetch or bank switch writes back unchanged */
+#  define GEMV_CTRL_STORED (GEMV_CTRL_LEN_64 | GEMV_CTRL_OUT_DIM_64 | GEMV_CTRL_ENABLE_BIAS | \
+                            GEMV_CTRL_BANK | GEMV_CTRL_OUT_DIM_16 | GEMV_CTRL_X_U16)
+
+/* Matrix of the other bank (see gemv_w_resident), and what is left of its
+ * stream: s_pf_rows rows of s_pf_hw / 4 words, s_pf_cols of them from the
+ * source (int8 rows s_pf_w, else the words s_pf_words), then the biases */
+static const int8_t   *s_pf_src;
+static int             s_pf_out_dim;
+static int             s_pf_len;
+static const int8_t   *s_pf_w;
+static const uint32_t *s_pf_words;
+static const int8_t   *s_pf_b8;
+static const int32_t  *s_pf_b32;
+static int             s_pf_cols, s_pf_hw, s_pf_row, s_pf_col, s_pf_bias;
+static int             s_pf_left;   /* W_PF4 + B_PF writes still to do */
+
+static void gemv_pf_step(int n);
+static void gemv_pf_swap(void);
+#else
+#  define GEMV_CTRL_W_SEL  0u
+#endif
+
 void gemv_init(uintptr_t base_addr)
 {
     s_gemv_base = base_addr;
 #if !defined(GEMV_USE_LITEX_CSR)
     (void)s_gemv_base; /* unused when using LiteX CSRs */
 #endif
+#if GEMV_CLOCK_GATE
+    s_power_refs = 0;
+    GEMV_WRITE_CLK_EN(0u);
+#endif
+}
+
+#if GEMV_CLOCK_GATE
+void gemv_power_get(void)
+{
+    uint32_t polls = 0;
+    if (s_power_refs++ > 0) return;
+    GEMV_WRITE_CLK_EN(1u);
+    /* One core clock edge after CLK_EN (clk_gate.v); the polls are bus turnaround */
+    while (!(GEMV_READ_STATUS() & GEMV_STATUS_CLK_ON) && polls < GEMV_WAKE_SPINS)
+        polls++;
+    s_power_stats.wakes++;
+    s_power_stats.last_polls = polls;
+    if (polls > s_power_stats.max_polls)
+        s_power_stats.max_polls = polls;
 }
 
+void gemv_power_put(void)
+{
+    /* The gateware keeps the clock on until a run or DMA job in flight is done */
+    if (s_power_refs > 0 && --s_power_refs == 0)
+        GEMV_WRITE_CLK_EN(0u);
+}
+
+void gemv_power_stats(gemv_power_stats_t *s)
+{
+    if (s != NULL) *s = s_power_stats;
+}
+#endif
+
 void gemv_clear_done(void)
 {
     /* Single write with clear_done bit = pulse on LiteX wrapper */
+    GEMV_POWER_GET();
     GEMV_WRITE_CTRL(GEMV_CTRL_CLEAR_DONE);
+    GEMV_POWER_PUT();
+}
+
+void gemv_clear_x(void)
+{
+    GEMV_POWER_GET();
+    GEMV_WRITE_CTRL(GEMV_CTRL_CLEAR_X);
+    GEMV_POWER_PUT();
+}
+
+int gemv_w_resident(const int8_t *w, int out_dim, int len)
+{
+    if (w == NULL) return 0;
+    if (w == s_w_src && out_dim == s_w_out_dim && len == s_w_len) return 1;
+#if GEMV_W_BANKS == 2
+    if (w == s_pf_src && out_dim == s_pf_out_dim && len == s_pf_len) {
+        GEMV_POWER_GET();
+        gemv_pf_swap();
+        GEMV_POWER_PUT();
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+void gemv_invalidate_w(void)
+{
+    s_w_src = NULL;
+#if GEMV_W_BANKS == 2
+    s_pf_src  = NULL;
+    s_pf_left = 0;
+#endif
 }
 
+int gemv_probe(void)
+{
+    int8_t x[32];
+    int32_t y[32];
+    uint32_t spins = 0;
+    int i;
+
+    /* W all ones: every row sums X = 1..32 */
+    for (i = 0; i < 32; i++)
+        x[i] = (int8_t)(i + 1);
+    gemv_invalidate_w();
+    GEMV_POWER_GET();
+    gemv_clear_done();
+#if GEMV_PACKED_WRITES
+    for (i = 0; i < 32 * 32; i += 4)
+        GEMV_WRITE_W4(0x01010101u);
+#else
+    for (i = 0; i < 32 * 32; i++)
+        GEMV_WRITE_W(1);
+#endif
+    gemv_load_x(x, 32);
+    gemv_start(32, 32, 0);
+    while (!(GEMV_READ_STATUS() & GEMV_STATUS_DONE)) {
+        if (++spins >= GEMV_PROBE_SPINS) {
+            GEMV_POWER_PUT();
+            return 0;
+        }
+    }
+    gemv_read_y(y, 32);
+    gemv_clear_done();
+    GEMV_POWER_PUT();
+    for (i = 0; i < 32; i++) {
+        if (y[i] != 32 * 33 / 2) return 0;
+    }
+    return 1;
+}
+
+#if GEMV_PACKED_WRITES || GEMV_MEM
+/* 4 int8 -> one packed word, lane 0 in the LSB (same as dot8_pack). */
+static inline uint32_t gemv_pack4(const int8_t *p)
+{
+    return (uint32_t)(uint8_t)p[0]
+         | ((uint32_t)(uint8_t)p[1] << 8)
+         | ((uint32_t)(uint8_t)p[2] << 16)
+         | ((uint32_t)(uint8_t)p[3] << 24);
+}
+#endif
+
 void gemv_load_x(const int8_t *x, int len)
 {
     if (x == NULL) return;
+    GEMV_POWER_GET();
+#if GEMV_PACKED_WRITES
+    /* LEN is 32 or 64, so always a whole number of words */
+    for (int i = 0; i < len; i += 4)
+        GEMV_WRITE_X4(gemv_pack4(&x[i]));
+#else
     for (int i = 0; i < len; i++)
         GEMV_WRITE_X(x[i]);
+#endif
+    GEMV_POWER_PUT();
 }
 
 void gemv_load_w(const int8_t *w, int out_dim, int len)
 {
     if (w == NULL) return;
+    GEMV_POWER_GET();
+#if GEMV_PACKED_WRITES
+    for (int i = 0; i < out_dim * len; i += 4)
+        GEMV_WRITE_W4(gemv_pack4(&w[i]));
+#else
     for (int i = 0; i < out_dim * len; i++)
         GEMV_WRITE_W(w[i]);
+#endif
+    GEMV_POWER_PUT();
+    s_w_src     = w;
+    s_w_out_dim = out_dim;
+    s_w_len     = len;
+}
+
+#if GEMV_PACKED_WRITES
+void gemv_load_w_packed(const uint32_t *w, int out_dim, int len)
+{
+    if (w == NULL) return;
+    GEMV_POWER_GET();
+    for (int i = 0; i < out_dim * len / 4; i++)
+        GEMV_WRITE_W4(w[i]);
+    GEMV_POWER_PUT();
+    s_w_src     = (const int8_t *)w;
+    s_w_out_dim = out_dim;
+    s_w_len     = len;
 }
+#endif
 
 void gemv_load_b(const int32_t *b, int out_dim)
 {
     if (b == NULL) return;
+    GEMV_POWER_GET();
     for (int i = 0; i < out_dim; i++)
         GEMV_WRITE_B(b[i]);
+    GEMV_POWER_PUT();
+}
+
+void gemv_load_b_i8(const int8_t *b, int out_dim)
+{
+    if (b == NULL) return;
+    GEMV_POWER_GET();
+    for (int i = 0; i < out_dim; i++)
+        GEMV_WRITE_B((int32_t)b[i]);
+    GEMV_POWER_PUT();
+}
+
+#if GEMV_REQUANT
+void gemv_set_requant(uint32_t rq_cfg)
+{
+    GEMV_WRITE_RQ(rq_cfg);
+}
+
+void gemv_read_y8(int8_t *y, int out_dim)
+{
+    if (y == NULL) return;
+    GEMV_POWER_GET();
+    for (int i = 0; i < out_dim; i += 4) {
+        uint32_t v = GEMV_READ_Y8();
+        y[i]     = (int8_t)v;
+        y[i + 1] = (int8_t)(v >> 8);
+        y[i + 2] = (int8_t)(v >> 16);
+        y[i + 3] = (int8_t)(v >> 24);
+        GEMV_WRITE_Y_NEXT4();  /* advance Y read pointer by four */
+    }
+    GEMV_POWER_PUT();
+}
+#endif
+
+/* CTRL config bits of a len x out_dim run */
+static uint32_t gemv_cfg(int len, int out_dim, int enable_bias)
+{
+    uint32_t cfg = 0;
+    if (len == 64)     cfg |= GEMV_CTRL_LEN_64;
+    if (out_dim == 64) cfg |= GEMV_CTRL_OUT_DIM_64;
+    if (out_dim == 16) cfg |= GEMV_CTRL_OUT_DIM_16;
+    if (enable_bias)   cfg |= GEMV_CTRL_ENABLE_BIAS;
+    return cfg;
 }
 
 void gemv_start(int len, int out_dim, int enable_bias)
 {
     /* Set config bits and start; one write generates start pulse on LiteX wrapper */
-    uint32_t ctrl = GEMV_CTRL_START;
-    if (len == 64)     ctrl |= GEMV_CTRL_LEN_64;
-    if (out_dim == 64) ctrl |= GEMV_CTRL_OUT_DIM_64;
-    if (enable_bias)   ctrl |= GEMV_CTRL_ENABLE_BIAS;
-    GEMV_WRITE_CTRL(ctrl);
+    GEMV_TRACE(TF_EV_GEMV_SUBMIT, out_dim);
+    GEMV_POWER_GET();
+    GEMV_WRITE_CTRL(gemv_cfg(len, out_dim, enable_bias) | GEMV_CTRL_START);
+    GEMV_POWER_PUT();   /* the run keeps the clock on until done */
 }
 
 void gemv_wait_done(void)
 {
+#if GEMV_W_BANKS == 2
+    /* The other bank's words go out while the run computes */
+    GEMV_POWER_GET();
+    while (s_pf_left > 0 && !(GEMV_READ_STATUS() & GEMV_STATUS_DONE))
+        gemv_pf_step(GEMV_PF_BURST);
+    GEMV_POWER_PUT();
+#endif
+#if GEMV_WAIT_WFI
+    gemv_wait_done_wfi();
+#else
     while (1) {
         uint32_t s = GEMV_READ_STATUS();
         if (s & GEMV_STATUS_DONE) break;
     }
+#endif
+    GEMV_TRACE(TF_EV_GEMV_DONE, 0);
+}
+
+#if GEMV_IRQ
+/* Shared with gemv_isr() */
+static volatile gemv_done_fn s_done_fn;
+static void *volatile s_done_ctx;
+
+void gemv_irq_init(void)
+{
+    GEMV_WRITE_EV_PENDING(GEMV_EV_DONE);
+    GEMV_WRITE_EV_ENABLE(GEMV_EV_DONE);
+    GEMV_CPU_IRQ_ENABLE();
 }
 
+void gemv_set_done_callback(gemv_done_fn fn, void *ctx)
+{
+    s_done_fn  = NULL;   /* the ISR never sees fn with the old ctx */
+    s_done_ctx = ctx;
+    s_done_fn  = fn;
+}
+
+void gemv_isr(void)
+{
+    gemv_done_fn fn = s_done_fn;
+    GEMV_WRITE_EV_PENDING(GEMV_EV_DONE);
+    GEMV_TRACE(TF_EV_GEMV_DONE, 1);
+    if (fn != NULL)
+        fn(s_done_ctx);
+}
+
+void gemv_wait_done_wfi(void)
+{
+    uint32_t mstatus;
+    while (1) {
+        GEMV_IRQ_SAVE(mstatus);
+        if (GEMV_READ_STATUS() & GEMV_STATUS_DONE) {
+            GEMV_IRQ_RESTORE(mstatus);
+            break;
+        }
+        /* A pending interrupt ends WFI even while MIE is clear */
+        GEMV_WFI();
+        GEMV_IRQ_RESTORE(mstatus);   /* gemv_isr() runs here */
+    }
+}
+#endif
+
 void gemv_read_y(int32_t *y, int out_dim)
 {
     if (y == NULL) return;
+    GEMV_POWER_GET();
     for (int i = 0; i < out_dim; i++) {
         y[i] = (int32_t)GEMV_READ_Y();
         GEMV_WRITE_Y_NEXT();  /* advance Y read pointer for next element */
     }
+    GEMV_POWER_PUT();
 }
+
+/* --- Tiled products: any out_dim, len a multiple of 4 --- */
+#define GEMV_TILE 64
+
+static int8_t  s_x_tile[GEMV_TILE];
+static int32_t s_part[GEMV_TILE];     /* partial Y carried into the next column tile */
+#if GEMV_REQUANT
+static int8_t  s_y8_tile[GEMV_TILE];
+#endif
+
+/* Core dimension (32 or 64) holding n <= 64 rows or columns */
+static inline int gemv_tile_dim(int n)
+{
+    return (n <= 32) ? 32 : 64;
+}
+
+/* Core OUT_DIM (16, 32 or 64) holding n <= 64 rows; gateware without
+ * OUT_DIM_16 runs 32, whose extra rows are never read back */
+static inline int gemv_out_dim(int n)
+{
+    return (n <= 16) ? 16 : gemv_tile_dim(n);
+}
+
+/* rows rows of cols weights (row stride len), each zero-padded to hw_len */
+static void load_w_tile(const int8_t *w, int len, int rows, int cols, int hw_len)
+{
+    for (int r = 0; r < rows; r++) {
+        const int8_t *row = &w[r * len];
+        int c;
+#if GEMV_PACKED_WRITES
+        for (c = 0; c < cols; c += 4)
+            GEMV_WRITE_W4(gemv_pack4(&row[c]));
+        for (; c < hw_len; c += 4)
+            GEMV_WRITE_W4(0u);
+#else
+        for (c = 0; c < cols; c++)
+            GEMV_WRITE_W(row[c]);
+        for (; c < hw_len; c++)
+            GEMV_WRITE_W(0);
+#endif
+    }
+}
+
+/* w: row-major int8, or NULL with tiles: the words load_w_tile() would
+ * write, tile after tile (gemv_matvec_tiles()); b32 replaces b if not NULL */
+static void matvec_tiled(const int8_t *w, const uint32_t *tiles,
+                         const int8_t *x, const int8_t *b, const int32_t *b32,
+                         int32_t *y, int8_t *y8, int out_dim, int len)
+{
+    const int8_t *src = (w != NULL) ? w : (const int8_t *)tiles;
+    int has_bias = (b != NULL || b32 != NULL);
+    for (int r0 = 0; r0 < out_dim; r0 += GEMV_TILE) {
+        int rows   = (out_dim - r0 < GEMV_TILE) ? out_dim - r0 : GEMV_TILE;
+        int hw_out = gemv_out_dim(rows);
+        for (int c0 = 0; c0 < len; c0 += GEMV_TILE) {
+            int cols   = (len - c0 < GEMV_TILE) ? len - c0 : GEMV_TILE;
+            int hw_len = gemv_tile_dim(cols);
+            int last   = (c0 + cols == len);
+            int whole  = (r0 == 0 && c0 == 0 && last && rows == out_dim);
+            int i;
+
+            /* Pad rows are never read back; pad columns multiply zero X lanes */
+            for (i = 0; i < cols; i++)
+                s_x_tile[i] = x[c0 + i];
+            for (; i < hw_len; i++)
+                s_x_tile[i] = 0;
+
+            if (whole && gemv_w_resident(src, out_dim, len)) {
+                gemv_clear_x();
+            } else {
+                gemv_clear_done();
+#if GEMV_PACKED_WRITES
+                if (w == NULL) {
+                    for (i = 0; i < rows * hw_len / 4; i++)
+                        GEMV_WRITE_W4(tiles[i]);
+                } else
+#endif
+                load_w_tile(&w[r0 * len + c0], len, rows, cols, hw_len);
+                if (c0 > 0)
+                    gemv_load_b(s_part, rows);      /* continue the row sums */
+                else if (b32 != NULL)
+                    gemv_load_b(&b32[r0], rows);
+                else
+                    gemv_load_b_i8(b != NULL ? &b[r0] : NULL, rows);
+                /* Only a single-tile matrix stays resident */
+                s_w_src     = whole ? src : NULL;
+                s_w_out_dim = out_dim;
+                s_w_len     = len;
+            }
+            if (tiles != NULL)
+                tiles += rows * hw_len / 4;
+            gemv_load_x(s_x_tile, hw_len);
+            gemv_start(hw_len, hw_out, c0 > 0 || has_bias);
+            gemv_wait_done();
+
+            if (!last) {
+                gemv_read_y(s_part, rows);
+#if GEMV_REQUANT
+            } else if (y8 != NULL) {
+                gemv_read_y8(s_y8_tile, (rows + 3) & ~3);
+                for (i = 0; i < rows; i++)
+                    y8[r0 + i] = s_y8_tile[i];
+#endif
+            } else {
+                gemv_read_y(&y[r0], rows);
+            }
+        }
+    }
+#if !GEMV_REQUANT
+    (void)y8;
+#endif
+}
+
+void gemv_matvec(const int8_t *w, const int8_t *x, const int8_t *b,
+                 int32_t *y, int out_dim, int len)
+{
+    GEMV_POWER_GET();
+    matvec_tiled(w, NULL, x, b, NULL, y, NULL, out_dim, len);
+    GEMV_POWER_PUT();
+}
+
+#if GEMV_PACKED_WRITES
+void gemv_matvec_tiles(const uint32_t *tiles, const int8_t *x, const int32_t *b,
+                       int32_t *y, int out_dim, int len)
+{
+    if (tiles == NULL) return;
+    GEMV_POWER_GET();
+    matvec_tiled(NULL, tiles, x, NULL, b, y, NULL, out_dim, len);
+    GEMV_POWER_PUT();
+}
+#endif
+
+#if GEMV_REQUANT
+void gemv_matvec8(const int8_t *w, const int8_t *x, const int8_t *b,
+                  int8_t *y, int out_dim, int len)
+{
+    GEMV_POWER_GET();
+    matvec_tiled(w, NULL, x, b, NULL, NULL, y, out_dim, len);
+    GEMV_POWER_PUT();
+}
+#endif
+
+#if GEMV_DOUBLE_BUFFER
+static int32_t s_y_buf[64];
+
+/* Y of token t: int32 to y_fn, or (y8 != NULL) requantized int8 to y8 + t * y8_stride */
+static void run_tokens_y(int t, int out_dim, gemv_y_fn y_fn, void *ctx,
+                         int8_t *y8, int y8_stride)
+{
+#if GEMV_REQUANT
+    if (y8 != NULL) {
+        gemv_read_y8(&y8[t * y8_stride], out_dim);
+        return;
+    }
+#else
+    (void)y8;
+    (void)y8_stride;
+#endif
+    gemv_read_y(s_y_buf, out_dim);
+    y_fn(ctx, t, s_y_buf);
+}
+
+static void run_tokens(const int8_t *x, int x_stride, int n_tokens,
+                       int len, int out_dim, int enable_bias,
+                       gemv_y_fn y_fn, void *ctx, int8_t *y8, int y8_stride)
+{
+    uint32_t cfg = gemv_cfg(len, out_dim, enable_bias);
+    if (n_tokens <= 0) return;
+    GEMV_POWER_GET();
+
+    /* Token 0: bank 0 */
+    GEMV_WRITE_CTRL(cfg | GEMV_CTRL_REWIND);
+    gemv_load_x(x, len);
+    GEMV_WRITE_CTRL(cfg | GEMV_CTRL_START);
+
+    for (int t = 0; t < n_tokens; t++) {
+        /* Token t computes in bank t&1; the other bank takes X(t+1) and holds Y(t-1) */
+        uint32_t other = ((t + 1) & 1) ? GEMV_CTRL_BANK : 0u;
+        GEMV_WRITE_CTRL(cfg | other | GEMV_CTRL_REWIND);
+        if (t + 1 < n_tokens)
+            gemv_load_x(&x[(t + 1) * x_stride], len);
+        if (t > 0)
+            run_tokens_y(t - 1, out_dim, y_fn, ctx, y8, y8_stride);
+        gemv_wait_done();
+        if (t + 1 < n_tokens)
+            GEMV_WRITE_CTRL(cfg | other | GEMV_CTRL_START);   /* accepted in DONE */
+    }
+
+    /* Drain: Y of the last token */
+    GEMV_WRITE_CTRL(cfg | (((n_tokens - 1) & 1) ? GEMV_CTRL_BANK : 0u) | GEMV_CTRL_REWIND);
+    run_tokens_y(n_tokens - 1, out_dim, y_fn, ctx, y8, y8_stride);
+    GEMV_WRITE_CTRL(cfg | GEMV_CTRL_REWIND);
+    GEMV_POWER_PUT();
+}
+
+void gemv_run_tokens(const int8_t *x, int x_stride, int n_tokens,
+                     int len, int out_dim, int enable_bias,
+                     gemv_y_fn y_fn, void *ctx)
+{
+    run_tokens(x, x_stride, n_tokens, len, out_dim, enable_bias, y_fn, ctx, NULL, 0);
+}
+
+#if GEMV_REQUANT
+void gemv_run_tokens8(const int8_t *x, int x_stride, int n_tokens,
+                      int len, int out_dim, int enable_bias,
+                      int8_t *y, int y_stride)
+{
+    run_tokens(x, x_stride, n_tokens, len, out_dim, enable_bias, NULL, NULL, y, y_stride);
+}
+#endif
+#endif
+
+#if GEMV_ATTN
+/* Keys, head_dim and core LEN of the head held in the K / V^T regions */
+static int s_attn_n;
+static int s_attn_hd;
+static int s_attn_len;
+
+void gemv_attn_load(const int8_t *k, const int8_t *v, int n, int hd, int stride)
+{
+    int d, j;
+    if (k == NULL || v == NULL) return;
+    GEMV_POWER_GET();
+    s_w_src = NULL;   /* the regions overwrite the resident W, not the other bank */
+    s_attn_n   = n;
+    s_attn_hd  = hd;
+    s_attn_len = gemv_tile_dim(hd);
+
+    /* K: the n key rows, zero-padded to LEN */
+    GEMV_WRITE_W_BASE(GEMV_ATTN_K_BASE);
+    gemv_clear_done();
+    load_w_tile(k, stride, n, hd, s_attn_len);
+
+    /* V^T: row d holds V[j][d] for the 32 key slots, zero past n */
+    GEMV_WRITE_W_BASE(GEMV_ATTN_V_BASE);
+    gemv_clear_done();
+    for (d = 0; d < hd; d++) {
+        for (j = 0; j < GEMV_ATTN_MAX_KEYS; j++)
+            s_x_tile[j] = (j < n) ? v[j * stride + d] : 0;
+        load_w_tile(s_x_tile, GEMV_ATTN_MAX_KEYS, 1, GEMV_ATTN_MAX_KEYS, GEMV_ATTN_MAX_KEYS);
+    }
+    GEMV_WRITE_W_BASE(s_w_base);
+    GEMV_POWER_PUT();
+}
+
+void gemv_attn_scores(const int8_t *q, int32_t *s)
+{
+    int d;
+    if (q == NULL || s == NULL) return;
+    GEMV_POWER_GET();
+    for (d = 0; d < s_attn_hd; d++)
+        s_x_tile[d] = q[d];
+    for (; d < s_attn_len; d++)
+        s_x_tile[d] = 0;
+    gemv_clear_x();
+    gemv_load_x(s_x_tile, s_attn_len);
+    GEMV_WRITE_W_BASE(GEMV_ATTN_K_BASE);
+    gemv_start(s_attn_len, gemv_out_dim(s_attn_n), 0);
+    GEMV_WRITE_W_BASE(s_w_base);
+    gemv_wait_done();
+    gemv_read_y(s, s_attn_n);
+    GEMV_POWER_PUT();
+}
+
+void gemv_attn_context(const uint16_t *w, int32_t *ctx)
+{
+    int out_dim = gemv_out_dim(s_attn_hd);
+    int j;
+    if (w == NULL || ctx == NULL) return;
+    GEMV_POWER_GET();
+    /* Low bytes to X[0..31], high bytes to X[32..63] */
+    for (j = 0; j < GEMV_ATTN_MAX_KEYS; j++) {
+        uint32_t wj = (j < s_attn_n) ? w[j] : 0u;
+        s_x_tile[j]                      = (int8_t)(uint8_t)wj;
+        s_x_tile[GEMV_ATTN_MAX_KEYS + j] = (int8_t)(uint8_t)(wj >> 8);
+    }
+    gemv_clear_x();
+    gemv_load_x(s_x_tile, 2 * GEMV_ATTN_MAX_KEYS);
+    GEMV_WRITE_W_BASE(GEMV_ATTN_V_BASE);
+    GEMV_TRACE(TF_EV_GEMV_SUBMIT, out_dim);
+    GEMV_WRITE_CTRL(gemv_cfg(32, out_dim, 0) | GEMV_CTRL_X_U16 | GEMV_CTRL_START);
+    GEMV_WRITE_W_BASE(s_w_base);
+    gemv_wait_done();
+    gemv_read_y(ctx, s_attn_hd);
+    GEMV_POWER_PUT();
+}
+#endif
+
+#if GEMV_MEM
+void gemv_set_w_base(uint32_t offset)
+{
+    if (offset != s_w_base)
+        gemv_invalidate_w();   /* the resident matrix is tracked for one region */
+    s_w_base = offset;
+    GEMV_WRITE_W_BASE(offset);
+}
+
+void gemv_write_w(uint32_t offset, const int8_t *w, int n)
+{
+    if (w == NULL) return;
+    /* Rewriting the tracked region makes its source pointer stale */
+    if (s_w_src != NULL && offset < s_w_base + (uint32_t)(s_w_out_dim * s_w_len)
+        && offset + (uint32_t)n > s_w_base)
+        gemv_invalidate_w();
+    GEMV_POWER_GET();
+    for (int i = 0; i < n; i += 4)
+        GEMV_MEM_WORD(offset + (uint32_t)i) = gemv_pack4(&w[i]);
+    GEMV_POWER_PUT();
+}
+
+void gemv_write_x(int bank, const int8_t *x, int len)
+{
+    uint32_t off = GEMV_MEM_W_SIZE + 64u * (uint32_t)(bank & 1);
+    if (x == NULL) return;
+    GEMV_POWER_GET();
+    for (int i = 0; i < len; i += 4)
+        GEMV_MEM_WORD(off + (uint32_t)i) = gemv_pack4(&x[i]);
+    GEMV_POWER_PUT();
+}
+#endif
+
+#if GEMV_W_BANKS == 2
+/* Up to n writes of the queued prefetch */
+static void gemv_pf_step(int n)
+{
+    for (; n > 0 && s_pf_left > 0; n--, s_pf_left--) {
+        if (s_pf_row < s_pf_out_dim) {
+            uint32_t v = 0u;   /* pad columns */
+            if (s_pf_col < s_pf_cols)
+                v = (s_pf_w != NULL) ? gemv_pack4(&s_pf_w[s_pf_row * s_pf_len + s_pf_col])
+                                     : *s_pf_words++;
+            GEMV_WRITE_W_PF4(v);
+            s_pf_col += 4;
+            if (s_pf_col == s_pf_hw) {
+                s_pf_col = 0;
+                s_pf_row++;
+            }
+        } else {
+            GEMV_WRITE_B_PF(s_pf_b32 != NULL ? s_pf_b32[s_pf_bias] : (int32_t)s_pf_b8[s_pf_bias]);
+            s_pf_bias++;
+        }
+    }
+}
+
+/* Finish the prefetch and make it the resident matrix; the other bank then
+ * holds the previous one, complete */
+static void gemv_pf_swap(void)
+{
+    const int8_t *src = s_w_src;
+    const int out_dim = s_w_out_dim, len = s_w_len;
+
+    while (s_pf_left > 0)
+        gemv_pf_step(GEMV_PF_BURST);
+    s_w_src      = s_pf_src;
+    s_w_out_dim  = s_pf_out_dim;
+    s_w_len      = s_pf_len;
+    s_pf_src     = src;
+    s_pf_out_dim = out_dim;
+    s_pf_len     = len;
+    s_w_ctrl ^= GEMV_CTRL_W_BANK;
+    GEMV_WRITE_CTRL(GEMV_READ_CTRL() & GEMV_CTRL_STORED);
+}
+
+static void gemv_pf_queue(const int8_t *src, const int8_t *w, const uint32_t *words,
+                          const int8_t *b8, const int32_t *b32, int out_dim, int len)
+{
+    if (src == NULL || out_dim < 1 || out_dim > GEMV_TILE || len < 4 || len > GEMV_TILE ||
+        (len % 4) != 0)
+        return;
+    if ((src == s_w_src && out_dim == s_w_out_dim && len == s_w_len) ||
+        (src == s_pf_src && out_dim == s_pf_out_dim && len == s_pf_len))
+        return;
+    s_pf_src     = src;
+    s_pf_out_dim = out_dim;
+    s_pf_len     = len;
+    s_pf_w       = w;
+    s_pf_words   = words;
+    s_pf_b8      = b8;
+    s_pf_b32     = b32;
+    s_pf_hw      = gemv_tile_dim(len);
+    s_pf_cols    = (w != NULL) ? len : s_pf_hw;
+    s_pf_row = s_pf_col = s_pf_bias = 0;
+    s_pf_left = out_dim * s_pf_hw / 4 + ((b8 != NULL || b32 != NULL) ? out_dim : 0);
+    /* Keeps the config of a run in flight */
+    GEMV_POWER_GET();
+    GEMV_WRITE_CTRL((GEMV_READ_CTRL() & GEMV_CTRL_STORED) | GEMV_CTRL_PF_REWIND);
+    GEMV_POWER_PUT();
+}
+
+void gemv_prefetch_w(const int8_t *w, const int8_t *b, int out_dim, int len)
+{
+    gemv_pf_queue(w, w, NULL, b, NULL, out_dim, len);
+}
+
+void gemv_prefetch_tiles(const uint32_t *tiles, const int32_t *b, int out_dim, int len)
+{
+    gemv_pf_queue((const int8_t *)tiles, NULL, tiles, NULL, b, out_dim, len);
+}
+#endif
+
+#if GEMV_DMA
+void gemv_submit(const void *w, const int8_t *x, int32_t *y, int len, int out_dim)
+{
+    uint32_t ctrl = GEMV_DMA_CTRL_START;
+    if (len == 64)     ctrl |= GEMV_DMA_CTRL_LEN_64;
+    if (out_dim == 64) ctrl |= GEMV_DMA_CTRL_OUT_DIM_64;
+    if (w != NULL && !gemv_w_resident((const int8_t *)w, out_dim, len)) {
+        GEMV_WRITE_DMA_W((uint32_t)(uintptr_t)w);
+        ctrl |= GEMV_DMA_CTRL_LOAD_W;
+        s_w_src     = (const int8_t *)w;
+        s_w_out_dim = out_dim;
+        s_w_len     = len;
+    }
+    GEMV_WRITE_DMA_X((uint32_t)(uintptr_t)x);
+    GEMV_WRITE_DMA_Y((uint32_t)(uintptr_t)y);
+    GEMV_TRACE(TF_EV_GEMV_SUBMIT, out_dim);
+    GEMV_WRITE_DMA_CTRL(ctrl);
+}
+
+int gemv_poll(void)
+{
+    if ((GEMV_READ_DMA_STATUS() & GEMV_DMA_STATUS_DONE) == 0)
+        return 0;
+    GEMV_DCACHE_FLUSH();
+    GEMV_TRACE(TF_EV_GEMV_DONE, 2);
+    return 1;
+}
+#endif
+
+#if GEMV_PACKED_WRITES
+/* --- Instance handles --- */
+#ifndef GEMV_DEV_WRITE
+#  if defined(GEMV_USE_LITEX_CSR)
+#    define GEMV_DEV_WRITE(a, v)  csr_write_simple((unsigned long)(uint32_t)(v), (unsigned long)(a))
+#    define GEMV_DEV_READ(a)      ((uint32_t)csr_read_simple((unsigned long)(a)))
+#  else
+#    define GEMV_DEV_WRITE(a, v)  (*(volatile uint32_t *)(a) = (uint32_t)(v))
+#    define GEMV_DEV_READ(a)      (*(volatile uint32_t *)(a))
+#  endif
+#endif
+
+#if defined(GEMV_USE_LITEX_CSR)
+/* Register addresses of the LiteX CSR region P (GEMV, GEMV1, ...) */
+#define GEMV_DEV_CSRS(d, P) do {                 \
+        (d)->ctrl   = CSR_##P##_CTRL_ADDR;       \
+        (d)->status = CSR_##P##_STATUS_ADDR;     \
+        (d)->x_in4  = CSR_##P##_X_IN4_ADDR;      \
+        (d)->w_in4  = CSR_##P##_W_IN4_ADDR;      \
+        (d)->b_in   = CSR_##P##_B_IN_ADDR;       \
+        (d)->y_out  = CSR_##P##_Y_OUT_ADDR;      \
+        (d)->y_next = CSR_##P##_Y_NEXT_ADDR;     \
+        (d)->rq_cfg = CSR_##P##_RQ_CFG_ADDR;     \
+        (d)->y8_out = CSR_##P##_Y8_OUT_ADDR;     \
+    } while (0)
+#endif
+
+int gemv_dev_open(gemv_dev_t *d, int index)
+{
+    if (d == NULL || index < 0 || index >= GEMV_DEVICES) return 0;
+#if defined(GEMV_USE_LITEX_CSR)
+    switch (index) {
+    case 0: GEMV_DEV_CSRS(d, GEMV); break;
+#  ifdef CSR_GEMV1_BASE
+    case 1: GEMV_DEV_CSRS(d, GEMV1); break;
+#  endif
+#  ifdef CSR_GEMV2_BASE
+    case 2: GEMV_DEV_CSRS(d, GEMV2); break;
+#  endif
+#  ifdef CSR_GEMV3_BASE
+    case 3: GEMV_DEV_CSRS(d, GEMV3); break;
+#  endif
+    default: return 0;
+    }
+    gemv_dev_invalidate_w(d);
+#else
+    gemv_dev_init(d, (uintptr_t)(GEMV_BASE) + (uintptr_t)index * GEMV_DEV_STRIDE);
+#endif
+    return 1;
+}
+
+void gemv_dev_init(gemv_dev_t *d, uintptr_t base)
+{
+    d->ctrl   = base + GEMV_CTRL;
+    d->status = base + GEMV_STATUS;
+    d->x_in4  = base + GEMV_X_IN4;
+    d->w_in4  = base + GEMV_W_IN4;
+    d->b_in   = base + GEMV_B_IN;
+    d->y_out  = base + GEMV_Y_OUT;
+    d->y_next = base + GEMV_Y_NEXT;
+    d->rq_cfg = base + GEMV_RQ_CFG;
+    d->y8_out = base + GEMV_Y8_OUT;
+    gemv_dev_invalidate_w(d);
+}
+
+void gemv_dev_clear_done(gemv_dev_t *d)
+{
+    GEMV_DEV_WRITE(d->ctrl, GEMV_CTRL_CLEAR_DONE);
+}
+
+void gemv_dev_clear_x(gemv_dev_t *d)
+{
+    GEMV_DEV_WRITE(d->ctrl, GEMV_CTRL_CLEAR_X);
+}
+
+void gemv_dev_load_w(gemv_dev_t *d, const int8_t *w, int out_dim, int len)
+{
+    const int hw_len = gemv_tile_dim(len);
+    if (w == NULL) return;
+    for (int r = 0; r < out_dim; r++) {
+        int c;
+        for (c = 0; c < len; c += 4)
+            GEMV_DEV_WRITE(d->w_in4, gemv_pack4(&w[r * len + c]));
+        for (; c < hw_len; c += 4)
+            GEMV_DEV_WRITE(d->w_in4, 0u);
+    }
+    d->w_src     = w;
+    d->w_out_dim = out_dim;
+    d->w_len     = len;
+}
+
+void gemv_dev_load_w_packed(gemv_dev_t *d, const uint32_t *w, int out_dim, int len)
+{
+    const int hw_len = gemv_tile_dim(len);
+    if (w == NULL) return;
+    for (int r = 0; r < out_dim; r++) {
+        int c;
+        for (c = 0; c < len; c += 4)
+            GEMV_DEV_WRITE(d->w_in4, w[(r * len + c) / 4]);
+        for (; c < hw_len; c += 4)
+            GEMV_DEV_WRITE(d->w_in4, 0u);
+    }
+    d->w_src     = w;
+    d->w_out_dim = out_dim;
+    d->w_len     = len;
+}
+
+void gemv_dev_load_b(gemv_dev_t *d, const int32_t *b, int out_dim)
+{
+    if (b == NULL) return;
+    for (int i = 0; i < out_dim; i++)
+        GEMV_DEV_WRITE(d->b_in, b[i]);
+}
+
+void gemv_dev_load_b_i8(gemv_dev_t *d, const int8_t *b, int out_dim)
+{
+    if (b == NULL) return;
+    for (int i = 0; i < out_dim; i++)
+        GEMV_DEV_WRITE(d->b_in, (int32_t)b[i]);
+}
+
+void gemv_dev_load_x(gemv_dev_t *d, const int8_t *x, int len)
+{
+    const int hw_len = gemv_tile_dim(len);
+    int i;
+    if (x == NULL) return;
+    for (i = 0; i < len; i += 4)
+        GEMV_DEV_WRITE(d->x_in4, gemv_pack4(&x[i]));
+    for (; i < hw_len; i += 4)
+        GEMV_DEV_WRITE(d->x_in4, 0u);
+}
+
+void gemv_dev_start(gemv_dev_t *d, int len, int out_dim, int enable_bias)
+{
+    GEMV_TRACE(TF_EV_GEMV_SUBMIT, out_dim);
+    GEMV_DEV_WRITE(d->ctrl, gemv_cfg(gemv_tile_dim(len), gemv_out_dim(out_dim), enable_bias)
+                            | GEMV_CTRL_START);
+}
+
+int gemv_dev_poll(const gemv_dev_t *d)
+{
+    return (GEMV_DEV_READ(d->status) & GEMV_STATUS_DONE) != 0u;
+}
+
+void gemv_dev_wait_done(const gemv_dev_t *d)
+{
+    while (!gemv_dev_poll(d)) {
+        /* busy-wait */
+    }
+    GEMV_TRACE(TF_EV_GEMV_DONE, 0);
+}
+
+void gemv_dev_read_y(gemv_dev_t *d, int32_t *y, int out_dim)
+{
+    if (y == NULL) return;
+    for (int i = 0; i < out_dim; i++) {
+        y[i] = (int32_t)GEMV_DEV_READ(d->y_out);
+        GEMV_DEV_WRITE(d->y_next, 1u);
+    }
+}
+
+#if GEMV_REQUANT
+void gemv_dev_set_requant(gemv_dev_t *d, uint32_t rq_cfg)
+{
+    GEMV_DEV_WRITE(d->rq_cfg, rq_cfg);
+}
+
+void gemv_dev_read_y8(gemv_dev_t *d, int8_t *y, int out_dim)
+{
+    if (y == NULL) return;
+    for (int i = 0; i < out_dim; i += 4) {
+        uint32_t v = GEMV_DEV_READ(d->y8_out);
+        y[i]     = (int8_t)v;
+        y[i + 1] = (int8_t)(v >> 8);
+        y[i + 2] = (int8_t)(v >> 16);
+        y[i + 3] = (int8_t)(v >> 24);
+        GEMV_DEV_WRITE(d->y_next, 4u);
+    }
+}
+#endif
+
+int gemv_dev_w_resident(const gemv_dev_t *d, const void *w, int out_dim, int len)
+{
+    return w != NULL && w == d->w_src && out_dim == d->w_out_dim && len == d->w_len;
+}
+
+void gemv_dev_invalidate_w(gemv_dev_t *d)
+{
+    d->w_src = NULL;
+}
+#endif
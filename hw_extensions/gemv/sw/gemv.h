@@ -7,7 +7,10 @@
  * Use with LiteX-generated CSR accessors when integrated (e.g. gemv_ctrl_read(),
  * gemv_x_in_write(), etc.), or with a base address and the macros below.
  *
- * Polling only; no interrupts.
+ * Polling only; no interrupts. With GEMV_DMA the block can also fetch W/X and store Y
+ * itself (gemv_submit / gemv_poll); with GEMV_MEM its W/X memories are also a
+ * memory-mapped window (gemv_write_w / gemv_write_x / gemv_set_w_base); with GEMV_ATTN it
+ * also runs attention's scores and softmax * V (gemv_attn_*).
  */
 
 #ifndef GEMV_H
@@ -28,6 +31,34 @@
 #define GEMV_Y_OUT   0x10
 #define GEMV_STATUS  0x14
 #define GEMV_Y_NEXT  0x18   /* write any value to advance Y read pointer (pulse) */
+#define GEMV_X_IN4   0x1C   /* write 4 packed int8 X values (lane 0 = bits 7:0) */
+#define GEMV_W_IN4   0x20   /* write 4 packed int8 W values, row-major */
+#define GEMV_DMA_W_ADDR  0x24   /* bus-master mode (GEMV_DMA): W source byte address */
+#define GEMV_DMA_X_ADDR  0x28   /* X source byte address */
+#define GEMV_DMA_Y_ADDR  0x2C   /* Y (int32) destination byte address */
+#define GEMV_DMA_CTRL    0x30
+#define GEMV_DMA_STATUS  0x34
+#define GEMV_RQ_CFG      0x38   /* requant stage config (GEMV_RQ_*) */
+#define GEMV_Y8_OUT      0x3C   /* 4 requantized int8 Y at the read index (lane 0 = bits 7:0) */
+#define GEMV_EV_STATUS   0x40   /* done interrupt: raw event */
+#define GEMV_EV_PENDING  0x44   /* pending; write GEMV_EV_DONE to acknowledge */
+#define GEMV_EV_ENABLE   0x48
+#define GEMV_W_BASE      0x4C   /* GEMV_MEM / GEMV_ATTN: W region byte offset */
+#define GEMV_W_PF4       0x50   /* GEMV_W_BANKS=2: 4 packed int8 W into the other W bank */
+#define GEMV_B_PF        0x54   /* GEMV_W_BANKS=2: one int32 bias into the other W bank */
+#define GEMV_CLK_EN      0x58   /* GEMV_CLOCK_GATE: 1 = core clock on */
+
+/* GEMV_PACKED_WRITES=1 (default): gemv_load_x()/gemv_load_w() pack 4 int8 per
+ * X_IN4/W_IN4 write. Set 0 for gateware without the packed registers. */
+#ifndef GEMV_PACKED_WRITES
+#define GEMV_PACKED_WRITES 1
+#endif
+
+/* GEMV_DOUBLE_BUFFER=1 (default): the block has two X/Y banks (CTRL.bank) and
+ * gemv_run_tokens() is available. Set 0 for gateware without them. */
+#ifndef GEMV_DOUBLE_BUFFER
+#define GEMV_DOUBLE_BUFFER 1
+#endif
 
 /* CTRL bits: START and CLEAR_DONE are pulses (one write triggers a one-cycle pulse in hardware).
  * busy/done are read from STATUS, not CTRL. */
@@ -38,10 +69,152 @@
 #define GEMV_CTRL_LEN_64      (1u << 4)
 #define GEMV_CTRL_OUT_DIM_64  (1u << 5)
 #define GEMV_CTRL_ENABLE_BIAS (1u << 6)
+#define GEMV_CTRL_CLEAR_X     (1u << 7)   /* pulse: clear done, rewind X/Y, keep W/b */
+#define GEMV_CTRL_BANK        (1u << 8)   /* X load / Y read bank; compute uses the bank at start */
+#define GEMV_CTRL_REWIND      (1u << 9)   /* pulse: rewind X/Y pointers, done untouched */
+#define GEMV_CTRL_OUT_DIM_16  (1u << 10)  /* OUT_DIM=16 (ignored by older gateware: 32 rows) */
+#define GEMV_CTRL_X_U16       (1u << 11)  /* GEMV_ATTN: X = 32 unsigned 16-bit values, LEN 32 */
+#define GEMV_CTRL_W_BANK      (1u << 12)  /* GEMV_W_BANKS=2: W/b bank of loads and runs; compute uses the bank at start */
+#define GEMV_CTRL_PF_REWIND   (1u << 13)  /* pulse: rewind the W_PF4/B_PF pointers */
+
+/* DMA_CTRL bits: START is a pulse; LOAD_W=0 keeps the resident W (weight-stationary) */
+#define GEMV_DMA_CTRL_START      (1u << 0)
+#define GEMV_DMA_CTRL_LOAD_W     (1u << 1)
+#define GEMV_DMA_CTRL_LEN_64     (1u << 2)
+#define GEMV_DMA_CTRL_OUT_DIM_64 (1u << 3)
+
+/* DMA_STATUS: [0]=busy, [1]=done (sticky until the next DMA start) */
+#define GEMV_DMA_STATUS_BUSY  (1u << 0)
+#define GEMV_DMA_STATUS_DONE  (1u << 1)
+
+/* GEMV_DMA=1: gateware built with GEMVPeripheral(with_dma=True); enables
+ * gemv_submit()/gemv_poll(). Default 0. */
+#ifndef GEMV_DMA
+#define GEMV_DMA 0
+#endif
+
+/* GEMV_MEM=1: gateware built with GEMVPeripheral(with_mem=True), whose W and X
+ * memories are also a write-only window at GEMV_MEM_BASE (LiteX generated/mem.h
+ * for a region named gemv_mem, or define it): W bytes at [0, GEMV_MEM_W_SIZE)
+ * row-major, X bank b at GEMV_MEM_W_SIZE + 64 * b. Enables gemv_write_w(),
+ * gemv_write_x() and gemv_set_w_base(). Default 0. */
+#ifndef GEMV_MEM
+#define GEMV_MEM 0
+#endif
+#ifndef GEMV_MEM_W_SIZE
+#define GEMV_MEM_W_SIZE 4096u   /* 1 << w_addr_bits of the wrapper */
+#endif
+/* W_BASE alignment that fits every ROWS (32 * ROWS, ROWS <= 32) */
+#define GEMV_W_BASE_ALIGN 1024u
+
+/* GEMV_ATTN=1: gateware built with GEMVPeripheral(attn=True) (X16 core and
+ * W_BASE). Enables gemv_attn_load(), gemv_attn_scores() and
+ * gemv_attn_context(): K and V^T of one head are written once to the W
+ * regions at GEMV_ATTN_K_BASE / GEMV_ATTN_V_BASE and stay resident for all
+ * its queries. Up to 32 keys, head_dim up to 64 (a multiple of 4). The
+ * regions overwrite whatever W was resident there. Default 0. */
+#ifndef GEMV_ATTN
+#define GEMV_ATTN 0
+#endif
+#ifndef GEMV_ATTN_K_BASE
+#define GEMV_ATTN_K_BASE 0u      /* K: n rows x 32 or 64 bytes */
+#endif
+#ifndef GEMV_ATTN_V_BASE
+#define GEMV_ATTN_V_BASE 2048u   /* V^T: head_dim rows x 32 bytes */
+#endif
+#define GEMV_ATTN_MAX_KEYS 32
+#define GEMV_ATTN_MAX_HD   64
+
+/* RQ_CFG: y8 = sat8(relu?((y * mul) + round) >> shift); mul = 1 without MUL_EN */
+#define GEMV_RQ_SHIFT(s)      ((uint32_t)(s) & 0x3Fu)
+#define GEMV_RQ_ROUND         (1u << 6)
+#define GEMV_RQ_RELU          (1u << 7)
+#define GEMV_RQ_MUL_EN        (1u << 8)
+#define GEMV_RQ_MUL(m)        (((uint32_t)(m) & 0xFFFFu) << 16)
+
+/* GEMV_REQUANT=1 (default): the block has the int8 requant stage (RQ_CFG,
+ * Y8_OUT). Set 0 for gateware without it. */
+#ifndef GEMV_REQUANT
+#define GEMV_REQUANT 1
+#endif
 
-/* STATUS register: [0]=busy, [1]=done (only source for status bits) */
+/* GEMV_IRQ=1: gateware with the done interrupt wired to the CPU
+ * (self.irq.add("gemv")); enables gemv_irq_init(), gemv_isr() and
+ * gemv_wait_done_wfi(). GEMV_WAIT_WFI=1 also makes gemv_wait_done() sleep in
+ * WFI instead of spinning on STATUS. Both default 0. */
+#ifndef GEMV_IRQ
+#define GEMV_IRQ 0
+#endif
+#ifndef GEMV_WAIT_WFI
+#define GEMV_WAIT_WFI 0
+#endif
+#if GEMV_WAIT_WFI && !GEMV_IRQ
+#error "GEMV_WAIT_WFI requires GEMV_IRQ"
+#endif
+
+/* EV_* bit of the done event */
+#define GEMV_EV_DONE          (1u << 0)
+
+/* STATUS register: [0]=busy, [1]=done (only source for status bits),
+ * [2]=clk_on (GEMV_CLOCK_GATE gateware only) */
 #define GEMV_STATUS_DONE      (1u << 1)
 #define GEMV_STATUS_BUSY      (1u << 0)
+#define GEMV_STATUS_CLK_ON    (1u << 2)
+
+/* GEMV_DEVICES: GEMV instances in the gateware (add_gemv_instances() in
+ * gemv_periph.py: LiteX CSR regions gemv, gemv1, gemv2, ...). The calls above
+ * drive instance 0; the gemv_dev_* calls drive any instance through its own
+ * handle (gemv_dev_open()), so several run at once. With raw MMIO instance i
+ * is at GEMV_BASE + i * GEMV_DEV_STRIDE. Default 1. */
+#ifndef GEMV_DEVICES
+#define GEMV_DEVICES 1
+#endif
+#define GEMV_MAX_DEVICES 4
+#if GEMV_DEVICES < 1 || GEMV_DEVICES > GEMV_MAX_DEVICES
+#error "GEMV_DEVICES must be 1 to 4"
+#endif
+#if GEMV_DEVICES > 1 && !GEMV_PACKED_WRITES
+#error "GEMV_DEVICES > 1 requires GEMV_PACKED_WRITES"
+#endif
+#ifndef GEMV_DEV_STRIDE
+#define GEMV_DEV_STRIDE 0x800u   /* one LiteX CSR region */
+#endif
+
+/* GEMV_W_BANKS=2: gateware built with GEMVPeripheral(w_banks=2), whose W and b
+ * memories have a second bank (CTRL.w_bank). gemv_prefetch_w() queues the next
+ * matrix for the bank the runs do not use; gemv_wait_done() streams it
+ * (W_PF4 / B_PF, GEMV_PF_BURST words per STATUS poll) while a run computes,
+ * and gemv_w_resident() switches the runs to that bank when the matrix is
+ * asked for. Default 1. */
+#ifndef GEMV_W_BANKS
+#define GEMV_W_BANKS 1
+#endif
+#if GEMV_W_BANKS != 1 && GEMV_W_BANKS != 2
+#error "GEMV_W_BANKS must be 1 or 2"
+#endif
+#if GEMV_W_BANKS == 2 && (GEMV_DMA || GEMV_DEVICES > 1 || !GEMV_PACKED_WRITES)
+#error "GEMV_W_BANKS=2 requires GEMV_PACKED_WRITES, without GEMV_DMA or GEMV_DEVICES > 1"
+#endif
+#ifndef GEMV_PF_BURST
+#define GEMV_PF_BURST 8
+#endif
+
+/* GEMV_CLOCK_GATE=1: gateware built with GEMVPeripheral(clock_gate=True), whose
+ * core runs on a gated clock (CLK_EN, on from reset). Every call below that
+ * streams to the core or reads Y takes a gemv_power_get() reference for its
+ * duration, so after gemv_init() or the first such call the block is clocked
+ * only while the driver uses it (and, in hardware, until a started run or DMA
+ * job is done). Default 0. */
+#ifndef GEMV_CLOCK_GATE
+#define GEMV_CLOCK_GATE 0
+#endif
+#if GEMV_CLOCK_GATE && GEMV_DEVICES > 1
+#error "GEMV_CLOCK_GATE: the gemv_dev_* handles do not turn the clock on; drop GEMV_DEVICES"
+#endif
+/* STATUS polls a wake-up waits for clk_on before it gives up (gateware without the gate) */
+#ifndef GEMV_WAKE_SPINS
+#define GEMV_WAKE_SPINS 1000u
+#endif
 
 /* Dimensions: 0 = 32, 1 = 64 */
 #define GEMV_LEN_32      0
@@ -49,11 +222,24 @@
 #define GEMV_OUT_DIM_32 0
 #define GEMV_OUT_DIM_64 1
 
+#if GEMV_PACKED_WRITES
+/* One GEMV instance: its register addresses and the W it holds (as
+ * gemv_w_resident() tracks it for the calls above). Fill with gemv_dev_open()
+ * or gemv_dev_init(). */
+typedef struct {
+    uintptr_t   ctrl, status, x_in4, w_in4, b_in, y_out, y_next, rq_cfg, y8_out;
+    const void *w_src;
+    int         w_out_dim;
+    int         w_len;
+} gemv_dev_t;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Initialize driver (set base address if using GEMV_BASE). No-op when using LiteX CSRs. */
+/* Initialize driver (set base address if using GEMV_BASE). No-op when using LiteX CSRs,
+ * except that GEMV_CLOCK_GATE turns the core clock off until the first call needs it. */
 void gemv_init(uintptr_t base_addr);
 
 /* Load vector X (int8), len = 32 or 64. */
@@ -62,21 +248,262 @@ void gemv_load_x(const int8_t *x, int len);
 /* Load matrix W (int8, row-major), out_dim rows × len cols. */
 void gemv_load_w(const int8_t *w, int out_dim, int len);
 
+#if GEMV_PACKED_WRITES
+/* Load W from word-packed rows (dot8_pack lane order: W[4j] in bits 7:0 of
+ * word j), out_dim × len/4 words, one W_IN4 write each. */
+void gemv_load_w_packed(const uint32_t *w, int out_dim, int len);
+#endif
+
 /* Optional: load bias (int32), out_dim elements. Call only if enable_bias will be 1. */
 void gemv_load_b(const int32_t *b, int out_dim);
 
-/* Start GEMV: len and out_dim must be 32 or 64; enable_bias 0 or 1. */
+/* Same from int8 biases (sign-extended). */
+void gemv_load_b_i8(const int8_t *b, int out_dim);
+
+/* Start GEMV: len must be 32 or 64, out_dim 16, 32 or 64; enable_bias 0 or 1. */
 void gemv_start(int len, int out_dim, int enable_bias);
 
 /* Block until done. */
 void gemv_wait_done(void);
 
+#if GEMV_IRQ
+/* Completion callback, called from gemv_isr() (interrupt context) once per
+ * finished run or DMA job. */
+typedef void (*gemv_done_fn)(void *ctx);
+
+/* Acknowledge any stale event, enable the done interrupt and unmask it at the
+ * CPU (LiteX VexRiscv: IRQ mask CSR bit GEMV_INTERRUPT, mstatus.MIE). */
+void gemv_irq_init(void);
+
+/* fn == NULL removes the callback. */
+void gemv_set_done_callback(gemv_done_fn fn, void *ctx);
+
+/* Done ISR: acknowledges the event and runs the callback. Call from isr(). */
+void gemv_isr(void);
+
+/* Wait for done, sleeping in WFI between checks; the done interrupt wakes
+ * the core. Machine interrupts are masked from each check to its WFI so the
+ * wake-up cannot be lost. Needs gemv_irq_init(). */
+void gemv_wait_done_wfi(void);
+#endif
+
 /* Read result Y (int32) into buffer; out_dim = 32 or 64. */
 void gemv_read_y(int32_t *y, int out_dim);
 
+#if GEMV_REQUANT
+/* Configure the requant stage: GEMV_RQ_SHIFT(s) | GEMV_RQ_ROUND | GEMV_RQ_RELU |
+ * GEMV_RQ_MUL_EN | GEMV_RQ_MUL(m). Applies to runs started afterwards. */
+void gemv_set_requant(uint32_t rq_cfg);
+
+/* Read requantized Y as int8, out_dim (multiple of 4) values, one Y8_OUT read
+ * per four. Use instead of gemv_read_y() for the same run. */
+void gemv_read_y8(int8_t *y, int out_dim);
+#endif
+
 /* Clear done flag and reset Y read pointer (call before next run). */
 void gemv_clear_done(void);
 
+/* Weight-stationary restart: clear done and rewind the X/Y pointers but keep
+ * the loaded W (and b), so the next run only needs gemv_load_x(). */
+void gemv_clear_x(void);
+
+/* 1 if the block still holds the out_dim x len matrix last passed to
+ * gemv_load_w() from address w. The driver tracks the source pointer only:
+ * call gemv_invalidate_w() after rewriting a buffer that may be resident.
+ * GEMV_W_BANKS=2: also 1 for the matrix of the last gemv_prefetch_w*(),
+ * which is then finished and becomes the W of the next runs (the other bank
+ * keeps the previous one); call it between runs only. */
+int gemv_w_resident(const int8_t *w, int out_dim, int len);
+
+/* Forget the resident W (next gemv_w_resident() returns 0), and with
+ * GEMV_W_BANKS=2 the prefetched one. */
+void gemv_invalidate_w(void);
+
+/* Presence check for images that run on SoCs with and without the block:
+ * a 32 x 32 run against a known W/X, polled at most GEMV_PROBE_SPINS times
+ * (an absent block in the CSR map reads as 0 and never reports done).
+ * Returns 1 if Y is right, 0 otherwise. Clobbers the resident W. */
+#ifndef GEMV_PROBE_SPINS
+#define GEMV_PROBE_SPINS 100000u
+#endif
+int gemv_probe(void);
+
+#if GEMV_CLOCK_GATE
+/* Reference-counted core clock: the first get turns it on and waits for
+ * STATUS.clk_on, the last put turns it off. W, b, X and Y are kept while it is
+ * off. The calls above take a reference of their own; wrap a sequence of them
+ * (an encoder pass) in get / put to wake the core once for all of them. Not
+ * from gemv_isr() or its callback. */
+void gemv_power_get(void);
+void gemv_power_put(void);
+
+/* Wake-ups so far, and the STATUS polls of the last and slowest one until
+ * clk_on was seen (GEMV_WAKE_SPINS: never seen). */
+typedef struct {
+    uint32_t wakes;
+    uint32_t last_polls;
+    uint32_t max_polls;
+} gemv_power_stats_t;
+void gemv_power_stats(gemv_power_stats_t *s);
+#endif
+
+/* Y = W * x (+ b) for shapes the core does not take directly: any out_dim
+ * >= 1, len a multiple of 4 (W row-major [out_dim][len], b int8 or NULL).
+ * W is split into tiles of up to 64 x 64, zero-padded to 32 or 64; column
+ * tiles after the first get the previous partial Y through B_IN, so each row
+ * tile's last run holds the whole sum. Only a single-tile W (with its b)
+ * stays resident; pass the same b whenever W is resident. Plain CSR runs,
+ * bank 0. */
+void gemv_matvec(const int8_t *w, const int8_t *x, const int8_t *b,
+                 int32_t *y, int out_dim, int len);
+
+#if GEMV_PACKED_WRITES
+/* gemv_matvec() from a pre-tiled W, so no tile is padded or packed at run
+ * time (tools/export_weights.py --gemv-native): the W_IN4 words of each tile
+ * in run order, row tiles of up to 64 rows outer, column tiles of up to 64
+ * inner, each rows x (32 or 64) / 4 words with the pad columns zero. b is
+ * int32 or NULL. Residency is tracked by the tiles pointer. */
+void gemv_matvec_tiles(const uint32_t *tiles, const int8_t *x, const int32_t *b,
+                       int32_t *y, int out_dim, int len);
+#endif
+
+#if GEMV_REQUANT
+/* Same, reading Y requantized to int8 (see gemv_set_requant()). */
+void gemv_matvec8(const int8_t *w, const int8_t *x, const int8_t *b,
+                  int8_t *y, int out_dim, int len);
+#endif
+
+#if GEMV_DOUBLE_BUFFER
+/* Called by gemv_run_tokens() with token t's result y[out_dim] (driver buffer,
+ * valid during the call only). Runs while token t+1 computes. */
+typedef void (*gemv_y_fn)(void *ctx, int token, const int32_t *y);
+
+/* Pipelined products of n_tokens X vectors (token t at x + t * x_stride)
+ * against the resident W (and b, with enable_bias): load it first
+ * (gemv_clear_done + gemv_load_w* / gemv_load_b*). While token t computes in
+ * one bank, X(t+1) is loaded into the other bank and Y(t-1) read out and
+ * passed to y_fn. Leaves bank 0 selected. */
+void gemv_run_tokens(const int8_t *x, int x_stride, int n_tokens,
+                     int len, int out_dim, int enable_bias,
+                     gemv_y_fn y_fn, void *ctx);
+
+#if GEMV_REQUANT
+/* As gemv_run_tokens(), reading the requantized int8 Y of token t straight
+ * into y + t * y_stride (see gemv_set_requant()). */
+void gemv_run_tokens8(const int8_t *x, int x_stride, int n_tokens,
+                      int len, int out_dim, int enable_bias,
+                      int8_t *y, int y_stride);
+#endif
+#endif
+
+#if GEMV_MEM
+/* Select the W region (byte offset, multiple of GEMV_W_BASE_ALIGN) that the
+ * next runs compute with and that gemv_load_w* / DMA W loads fill after
+ * gemv_clear_done(). */
+void gemv_set_w_base(uint32_t offset);
+
+/* Copy n int8 weights (n a multiple of 4, row-major) to byte offset `offset`
+ * (4-aligned) of the W memory, one word write each; the rest of W is left
+ * as is. Load several layers at distinct regions once, or rewrite only the
+ * rows that changed (offset + row * len). A run computing from another
+ * region is not disturbed. */
+void gemv_write_w(uint32_t offset, const int8_t *w, int n);
+
+/* Write X (len 32 or 64) into X bank `bank` directly; the X_IN pointer does
+ * not move. */
+void gemv_write_x(int bank, const int8_t *x, int len);
+#endif
+
+#if GEMV_W_BANKS == 2
+/* Queue W (out_dim <= 64 x len int8 row-major, len a multiple of 4 up to 64)
+ * and its int8 bias b (NULL: none) for the other W bank, laid out as the
+ * single-tile gemv_matvec() / gemv_load_w() of the same matrix loads it. The
+ * words go out while later runs compute (gemv_wait_done()), the rest when
+ * gemv_w_resident() asks for w. Replaces a pending prefetch; does nothing if
+ * w is already in either bank. */
+void gemv_prefetch_w(const int8_t *w, const int8_t *b, int out_dim, int len);
+
+/* Same for the pre-tiled words of a single-tile gemv_matvec_tiles() matrix
+ * and its int32 bias. */
+void gemv_prefetch_tiles(const uint32_t *tiles, const int32_t *b, int out_dim, int len);
+#endif
+
+#if GEMV_ATTN
+/* Write one head's K (n keys x hd int8, row j at k + j * stride) and V^T
+ * (V the same layout at v) to their W regions. n <= GEMV_ATTN_MAX_KEYS,
+ * hd <= GEMV_ATTN_MAX_HD, a multiple of 4. Forgets the resident W. */
+void gemv_attn_load(const int8_t *k, const int8_t *v, int n, int hd, int stride);
+
+/* s[j] = q . K[j] (int32) for the n keys of the last gemv_attn_load(). */
+void gemv_attn_scores(const int8_t *q, int32_t *s);
+
+/* ctx[d] = sum_j w[j] * V[j][d] (exact int32) for the hd channels, w the n
+ * unsigned Q15 softmax weights (<= 32768). */
+void gemv_attn_context(const uint16_t *w, int32_t *ctx);
+#endif
+
+#if GEMV_DMA
+/* Bus-master run, returns at once: the block fetches W (out_dim x len int8,
+ * row-major; packed rows hold the same bytes) and X from memory, computes
+ * Y = W * X (no bias) and stores out_dim int32 to y. w == NULL, or a w that
+ * is still resident, skips the W fetch. w, x and y must be 4-byte aligned and
+ * stay untouched until gemv_poll() returns 1. CSR-side calls (gemv_load_*,
+ * gemv_start, ...) must not be used while a submit is in flight. */
+void gemv_submit(const void *w, const int8_t *x, int32_t *y, int len, int out_dim);
+
+/* 1 once the last gemv_submit() has stored Y (the D-cache is flushed so the
+ * CPU sees it), 0 while it is running. */
+int gemv_poll(void);
+#endif
+
+#if GEMV_PACKED_WRITES
+/* --- Instance handles (GEMV_DEVICES). Plain CSR runs with packed writes,
+ * bank 0; no DMA, MEM, ATTN or IRQ through a handle. Each call touches only
+ * its own instance, so gemv_dev_start() on several handles followed by
+ * gemv_dev_wait_done() on each overlaps their runs. The calls above and a
+ * handle of instance 0 share the block but not the residency tracking: call
+ * gemv_invalidate_w() after loading W through the handle, and
+ * gemv_dev_invalidate_w() after loading it with gemv_load_w*(). Needs CSRs
+ * of 32 bits (csr_data_width=32) with LiteX. --- */
+
+/* Fill d for instance index < GEMV_DEVICES. Returns 0 if the SoC has no such
+ * instance (LiteX: no CSR region gemv<index> in generated/csr.h). */
+int  gemv_dev_open(gemv_dev_t *d, int index);
+
+/* Fill d for raw-MMIO gateware at base, with the offsets above. */
+void gemv_dev_init(gemv_dev_t *d, uintptr_t base);
+
+/* Same as gemv_clear_done() / gemv_clear_x() / gemv_load_*() / gemv_start(),
+ * except that len may be any multiple of 4 up to 64 and out_dim up to 64:
+ * W rows and X are zero-padded to the core LEN (32 or 64) and the run takes
+ * the OUT_DIM (16, 32 or 64) that holds out_dim rows. */
+void gemv_dev_clear_done(gemv_dev_t *d);
+void gemv_dev_clear_x(gemv_dev_t *d);
+void gemv_dev_load_w(gemv_dev_t *d, const int8_t *w, int out_dim, int len);
+void gemv_dev_load_w_packed(gemv_dev_t *d, const uint32_t *w, int out_dim, int len);
+void gemv_dev_load_b(gemv_dev_t *d, const int32_t *b, int out_dim);
+void gemv_dev_load_b_i8(gemv_dev_t *d, const int8_t *b, int out_dim);
+void gemv_dev_load_x(gemv_dev_t *d, const int8_t *x, int len);
+void gemv_dev_start(gemv_dev_t *d, int len, int out_dim, int enable_bias);
+
+/* 1 once the run started last on d is done, 0 while it is running. */
+int  gemv_dev_poll(const gemv_dev_t *d);
+
+/* Block until d is done. */
+void gemv_dev_wait_done(const gemv_dev_t *d);
+
+/* Same as gemv_read_y() / gemv_set_requant() / gemv_read_y8(). */
+void gemv_dev_read_y(gemv_dev_t *d, int32_t *y, int out_dim);
+#if GEMV_REQUANT
+void gemv_dev_set_requant(gemv_dev_t *d, uint32_t rq_cfg);
+void gemv_dev_read_y8(gemv_dev_t *d, int8_t *y, int out_dim);
+#endif
+
+/* Same as gemv_w_resident() / gemv_invalidate_w() for the W of d. */
+int  gemv_dev_w_resident(const gemv_dev_t *d, const void *w, int out_dim, int len);
+void gemv_dev_invalidate_w(gemv_dev_t *d);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
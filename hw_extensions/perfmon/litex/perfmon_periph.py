@@ -0,0 +1,88 @@
+# Performance monitor — LiteX CSR wrapper.
+#
+# Integrates perfmon_core (Verilog) into a LiteX SoC via the CSR bus.
+# The wrapper taps the CPU's instruction and data Wishbone buses (it never drives them) and
+# turns their handshakes into one event line per counter (see perfmon_spec.md):
+#   CYCLE     every cycle
+#   IMISS     I-bus transactions (VexRiscv issues one cache-line refill per I-cache miss)
+#   DMISS     D-bus reads outside the I/O region (one refill per D-cache miss)
+#   IWAIT     I-bus wait states (cyc & stb & ~ack)
+#   DWAIT     D-bus wait states on memory (SDRAM, SRAM, ROM)
+#   CSR       D-bus transactions in the I/O region (CSR / peripheral accesses)
+#   CSR_WAIT  D-bus wait states in the I/O region
+#   GEMV      GEMV busy cycles (gemv_busy, 0 when no GEMV block is given)
+# A transaction ends on its last acked beat: cti 0 (classic) or 7 (end of burst).
+# CTRL.enable is stored; CLEAR and SNAP are one-cycle pulses (CTRL write with the bit set).
+# SNAP copies all counters to SNAP0..SNAP7 at once; INFO identifies the block for probing.
+#
+# Usage (in your SoC target, after the CPU and the optional GEMV peripheral):
+#   self.submodules.perfmon = PerfmonPeripheral(self.cpu.ibus, self.cpu.dbus,
+#                                               gemv_busy=self.gemv.busy)
+#   self.add_csr("perfmon")
+#   self.add_source("path/to/rtl/perfmon_core.v")
+
+from migen import *
+from litex.soc.interconnect.csr import AutoCSR, CSRStorage, CSRStatus
+
+PERFMON_EVENTS = ["cycle", "imiss", "dmiss", "iwait", "dwait", "csr", "csr_wait", "gemv"]
+PERFMON_MAGIC = 0x504D   # "PM"
+
+
+class PerfmonPeripheral(Module, AutoCSR):
+    """LiteX peripheral for perfmon_core. CTRL, INFO, SNAP0..SNAP7."""
+
+    def __init__(self, ibus, dbus, gemv_busy=None, io_base=0x80000000, io_size=0x80000000):
+        n = len(PERFMON_EVENTS)
+
+        # --- CTRL: [0]=enable (stored config), [1]=clear (pulse), [2]=snap (pulse) ---
+        self.ctrl = CSRStorage(3, name="ctrl")
+        # --- INFO: [7:0]=counter count, [31:16]=magic 0x504D (absent block reads 0) ---
+        self.info = CSRStatus(32, reset=(PERFMON_MAGIC << 16) | n, name="info")
+        self._snaps = []
+        for i, ev in enumerate(PERFMON_EVENTS):
+            snap = CSRStatus(32, name=f"snap{i}", description=f"Snapshot of the {ev} counter")
+            setattr(self, f"snap{i}", snap)
+            self._snaps.append(snap)
+
+        # --- Bus taps (Wishbone adr is a word address) ---
+        def handshake(bus):
+            beat = Signal()
+            wait = Signal()
+            last = Signal()
+            self.comb += [
+                beat.eq(bus.cyc & bus.stb & bus.ack),
+                wait.eq(bus.cyc & bus.stb & ~bus.ack),
+                last.eq(beat & ((bus.cti == 0) | (bus.cti == 7))),
+            ]
+            return wait, last
+
+        i_wait, i_last = handshake(ibus)
+        d_wait, d_last = handshake(dbus)
+        d_io = Signal()
+        self.comb += d_io.eq((dbus.adr >= (io_base >> 2)) & (dbus.adr < ((io_base + io_size) >> 2)))
+
+        ev = Signal(n)
+        self.comb += ev.eq(Cat(
+            1,                              # cycle
+            i_last,                         # imiss
+            d_last & ~dbus.we & ~d_io,      # dmiss
+            i_wait,                         # iwait
+            d_wait & ~d_io,                 # dwait
+            d_last & d_io,                  # csr
+            d_wait & d_io,                  # csr_wait
+            gemv_busy if gemv_busy is not None else 0,  # gemv
+        ))
+
+        snap_data = Signal(32 * n)
+        self.specials += Instance(
+            "perfmon_core",
+            p_N=n,
+            i_clk=ClockSignal(),
+            i_reset=ResetSignal(),
+            i_enable=self.ctrl.storage[0],
+            i_clear=self.ctrl.re & self.ctrl.storage[1],
+            i_snap=self.ctrl.re & self.ctrl.storage[2],
+            i_ev=ev,
+            o_snap_data=snap_data,
+        )
+        self.comb += [snap.status.eq(snap_data[32 * i:32 * (i + 1)]) for i, snap in enumerate(self._snaps)]
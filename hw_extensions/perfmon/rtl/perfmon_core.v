@@ -0,0 +1,72 @@
+/*
+ * Performance-monitor core: N free-running 32-bit event counters with a
+ * coherent snapshot.
+ *
+ * Each cycle, counter i increments by one when enable is set and event
+ * ev[i] was high in the previous cycle (the events are registered once so
+ * the bus taps in the wrapper stay off the counter carry chains). Counters
+ * wrap at 2^32; software takes differences with uint32_t arithmetic, like
+ * the cycle CSR.
+ *
+ * snap copies all N counters into the snapshot registers in the same cycle,
+ * so one stage's values belong to the same instant however long the CPU
+ * takes to read them back. clear zeroes the counters (not the snapshots).
+ *
+ * The event sources (I/D-bus refills, Wishbone wait states, CSR accesses,
+ * GEMV busy) are derived in litex/perfmon_periph.py; this core only counts.
+ */
+
+module perfmon_core #(
+    parameter N = 8
+) (
+    input  wire             clk,
+    input  wire             reset,
+
+    /* Control (from CTRL) */
+    input  wire             enable,     /* count while set */
+    input  wire             clear,      /* zero the counters (pulse) */
+    input  wire             snap,       /* copy counters -> snapshots (pulse) */
+
+    /* One event line per counter, high for each cycle to be counted */
+    input  wire [N-1:0]     ev,
+
+    /* Snapshot i in bits [32*i+31 : 32*i] */
+    output wire [32*N-1:0]  snap_data
+);
+
+    reg [N-1:0]  ev_q;
+    reg [31:0]   cnt [0:N-1];
+    reg [31:0]   snp [0:N-1];
+
+    always @(posedge clk) begin
+        if (reset) begin
+            ev_q <= {N{1'b0}};
+        end else begin
+            ev_q <= ev;
+        end
+    end
+
+    genvar i;
+    generate
+        for (i = 0; i < N; i = i + 1) begin : g_cnt
+            always @(posedge clk) begin
+                if (reset || clear) begin
+                    cnt[i] <= 32'd0;
+                end else if (enable && ev_q[i]) begin
+                    cnt[i] <= cnt[i] + 32'd1;
+                end
+            end
+
+            always @(posedge clk) begin
+                if (reset) begin
+                    snp[i] <= 32'd0;
+                end else if (snap) begin
+                    snp[i] <= cnt[i];
+                end
+            end
+
+            assign snap_data[32*i +: 32] = snp[i];
+        end
+    endgenerate
+
+endmodule
@@ -0,0 +1,83 @@
+/*
+ * Performance monitor driver.
+ * USE_PERFMON_HW: PERFMON_USE_LITEX_CSR + generated/csr.h (32-bit CSR data width), or
+ * PERFMON_BASE / perfmon_init() for raw MMIO. Without USE_PERFMON_HW every read is zero.
+ */
+
+#include "perfmon.h"
+#if defined(USE_PERFMON_HW) && defined(PERFMON_USE_LITEX_CSR)
+#  include <generated/csr.h>
+#endif
+
+#if defined(USE_PERFMON_HW)
+#  if defined(PERFMON_USE_LITEX_CSR)
+#    define PERFMON_WRITE_CTRL(v)   perfmon_ctrl_write((uint32_t)(v))
+#    define PERFMON_READ_INFO()     perfmon_info_read()
+#    define PERFMON_READ_SNAP(i)    csr_read_simple(CSR_PERFMON_SNAP0_ADDR + 4u * (unsigned)(i))
+#  else
+#    ifndef PERFMON_BASE
+#      define PERFMON_BASE  s_perfmon_base
+#    endif
+#    define PERFMON_REG(off)        (*(volatile uint32_t *)(PERFMON_BASE + (off)))
+#    define PERFMON_WRITE_CTRL(v)   (PERFMON_REG(PERFMON_CTRL) = (uint32_t)(v))
+#    define PERFMON_READ_INFO()     PERFMON_REG(PERFMON_INFO)
+#    define PERFMON_READ_SNAP(i)    PERFMON_REG(PERFMON_SNAP0 + 4u * (unsigned)(i))
+#  endif
+#endif
+
+static uintptr_t s_perfmon_base;
+
+/* CTRL.enable as last set (kept in every CTRL write) */
+static uint32_t s_ctrl_enable;
+
+void perfmon_init(uintptr_t base_addr)
+{
+    s_perfmon_base = base_addr;
+    (void)s_perfmon_base; /* unused when using LiteX CSRs or a fixed PERFMON_BASE */
+}
+
+int perfmon_probe(void)
+{
+#if defined(USE_PERFMON_HW)
+    uint32_t info = PERFMON_READ_INFO();
+    return (info >> 16) == PERFMON_MAGIC && (info & 0xFFu) == PERFMON_COUNT;
+#else
+    return 0;
+#endif
+}
+
+void perfmon_start(void)
+{
+    s_ctrl_enable = PERFMON_CTRL_ENABLE;
+#if defined(USE_PERFMON_HW)
+    PERFMON_WRITE_CTRL(PERFMON_CTRL_CLEAR);
+    PERFMON_WRITE_CTRL(s_ctrl_enable);
+#endif
+}
+
+void perfmon_stop(void)
+{
+    s_ctrl_enable = 0u;
+#if defined(USE_PERFMON_HW)
+    PERFMON_WRITE_CTRL(0u);
+#endif
+}
+
+void perfmon_read(uint32_t v[PERFMON_COUNT])
+{
+    int i;
+#if defined(USE_PERFMON_HW)
+    PERFMON_WRITE_CTRL(s_ctrl_enable | PERFMON_CTRL_SNAP);
+    for (i = 0; i < PERFMON_COUNT; i++) v[i] = PERFMON_READ_SNAP(i);
+#else
+    for (i = 0; i < PERFMON_COUNT; i++) v[i] = 0u;
+#endif
+}
+
+const char *perfmon_name(int counter)
+{
+    static const char *const names[PERFMON_COUNT] = {
+        "cycle", "imiss", "dmiss", "iwait", "dwait", "csr", "csr_wait", "gemv"
+    };
+    return (counter >= 0 && counter < PERFMON_COUNT) ? names[counter] : "?";
+}
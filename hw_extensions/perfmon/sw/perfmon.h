@@ -0,0 +1,74 @@
+/*
+ * Performance monitor — C driver API.
+ *
+ * Defining USE_PERFMON_HW (in the firmware that uses this driver) requires the SoC to include
+ * the corresponding HW block; otherwise the calls read zeros and perfmon_probe() fails.
+ *
+ * Use with LiteX-generated CSR accessors (PERFMON_USE_LITEX_CSR: perfmon_ctrl_write(),
+ * CSR_PERFMON_SNAP0_ADDR, ...) or with PERFMON_BASE / perfmon_init() and the offsets below.
+ *
+ * Usage: perfmon_start() once, then perfmon_read(v) around the code to measure; the counts of
+ * the interval are the differences of two reads (uint32_t wrap-around arithmetic).
+ */
+
+#ifndef PERFMON_H
+#define PERFMON_H
+
+#include <stdint.h>
+
+/* Optional: set base address when not using LiteX generated/csr.h */
+#ifndef PERFMON_BASE
+/* #define PERFMON_BASE  0x00000000 */
+#endif
+
+/* Register offsets (bytes) — must match perfmon_spec.md and LiteX wrapper */
+#define PERFMON_CTRL      0x00
+#define PERFMON_INFO      0x04   /* [7:0] counter count, [31:16] PERFMON_MAGIC */
+#define PERFMON_SNAP0     0x08   /* SNAP<i> at PERFMON_SNAP0 + 4 * i */
+
+/* CTRL bits: ENABLE is stored; CLEAR and SNAP are pulses */
+#define PERFMON_CTRL_ENABLE  (1u << 0)
+#define PERFMON_CTRL_CLEAR   (1u << 1)
+#define PERFMON_CTRL_SNAP    (1u << 2)   /* copy every counter to its SNAP register at once */
+
+#define PERFMON_MAGIC 0x504Du
+
+/* Counters (SNAP register index) — must match PERFMON_EVENTS in perfmon_periph.py */
+#define PERFMON_CYCLE     0   /* cycles while enabled */
+#define PERFMON_IMISS     1   /* I-cache refills (I-bus transactions) */
+#define PERFMON_DMISS     2   /* D-cache refills (D-bus reads outside the I/O region) */
+#define PERFMON_IWAIT     3   /* I-bus wait states */
+#define PERFMON_DWAIT     4   /* D-bus wait states on memory */
+#define PERFMON_CSR       5   /* D-bus accesses in the I/O region (CSRs) */
+#define PERFMON_CSR_WAIT  6   /* D-bus wait states in the I/O region */
+#define PERFMON_GEMV      7   /* GEMV busy cycles */
+#define PERFMON_COUNT     8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initialize driver (set base address if using PERFMON_BASE). No-op when using LiteX CSRs. */
+void perfmon_init(uintptr_t base_addr);
+
+/* 1 if INFO identifies a perfmon block with PERFMON_COUNT counters, else 0. */
+int perfmon_probe(void);
+
+/* Zero the counters and start counting. */
+void perfmon_start(void);
+
+/* Stop counting (the counters keep their values). */
+void perfmon_stop(void);
+
+/* Snapshot all counters at once and copy them to v[0..PERFMON_COUNT-1] (zeros without HW).
+ * The snapshot costs one CSR write and PERFMON_COUNT reads, which the next read counts. */
+void perfmon_read(uint32_t v[PERFMON_COUNT]);
+
+/* Short lower-case counter name ("cycle", "imiss", ...), or "?" for an invalid index. */
+const char *perfmon_name(int counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERFMON_H */
@@ -0,0 +1,146 @@
+# Sensor capture DMA — LiteX wrapper.
+#
+# A Wishbone bus master that writes the words of a sensor front-end's stream straight into a
+# ring of records in main memory (SRAM), so the CPU never touches the samples before
+# inference. One record is REC_WORDS consecutive words of the stream (TinyFormer: one
+# quantized frame, D int8 = 8 words, lane 0 = bits 7:0); the ring holds FRAMES records
+# (power of two) from byte address BASE.
+#
+# HEAD counts the records written (free-running, updated after a record's last word is acked,
+# so the CPU never sees a partial record); the CPU frees records by writing its own free-running
+# count to TAIL. A record that starts while HEAD - TAIL == FRAMES is consumed from the stream
+# and counted in DROPPED instead, as the firmware's stream_ring_push() does.
+# CTRL.enable is stored; CTRL.reset is a one-cycle pulse (CTRL write with the bit set) that zeros
+# HEAD, DROPPED and the hop counter and rewinds the write slot to BASE; write it with enable
+# clear, after TAIL = 0 and the ring configuration.
+#
+# ev.hop is an interrupt every HOP records written; EV_ENABLE gates it and writing 1 to
+# EV_PENDING acknowledges it. INFO identifies the block for probing.
+#
+# The stream source (sink: valid / ready / data[31:0], one word per beat) is board specific,
+# e.g. an SPI or I2C poller that reads the IMU at its sample rate and packs the quantized
+# features of one frame; the block backpressures it only while a word waits for its ack.
+#
+# Usage (in your SoC target):
+#   self.submodules.sensor_dma = SensorDMAPeripheral()
+#   self.add_csr("sensor_dma")
+#   self.irq.add("sensor_dma", use_loc_if_exists=True)
+#   self.bus.add_master(name="sensor_dma", master=self.sensor_dma.bus)
+#   self.comb += imu_frontend.source.connect(self.sensor_dma.sink)
+
+from migen import *
+from litex.soc.interconnect import stream, wishbone
+from litex.soc.interconnect.csr import AutoCSR, CSRStorage, CSRStatus
+from litex.soc.interconnect.csr_eventmanager import EventManager, EventSourcePulse
+
+SENSOR_DMA_MAGIC = 0x5344   # "SD"
+SENSOR_DMA_VERSION = 1
+
+
+class SensorDMAPeripheral(Module, AutoCSR):
+    """Sensor stream to SRAM ring. CTRL, INFO, BASE, REC_WORDS, FRAMES, HOP, HEAD, TAIL, DROPPED."""
+
+    def __init__(self):
+        # --- CTRL: [0]=enable (stored config), [1]=reset (pulse) ---
+        self.ctrl = CSRStorage(2, name="ctrl")
+        # --- INFO: [7:0]=version, [31:16]=magic 0x5344 (absent block reads 0) ---
+        self.info = CSRStatus(32, reset=(SENSOR_DMA_MAGIC << 16) | SENSOR_DMA_VERSION, name="info")
+        self.base = CSRStorage(32, name="base", description="Ring byte address (4-byte aligned)")
+        self.rec_words = CSRStorage(8, reset=8, name="rec_words", description="Words per record (1..255)")
+        self.frames = CSRStorage(16, reset=32, name="frames", description="Records in the ring (power of two)")
+        self.hop = CSRStorage(16, reset=8, name="hop", description="Records per hop event (>= 1)")
+        self.head = CSRStatus(32, name="head", description="Records written (free-running)")
+        self.tail = CSRStorage(32, name="tail", description="Records released by the CPU (free-running)")
+        self.dropped = CSRStatus(32, name="dropped", description="Records dropped on a full ring")
+
+        self.sink = sink = stream.Endpoint([("data", 32)])
+        self.bus = bus = wishbone.Interface(data_width=32)
+
+        # --- IRQ: pulse every HOP records ---
+        self.submodules.ev = EventManager()
+        self.ev.hop = EventSourcePulse(description="HOP records written")
+        self.ev.finalize()
+
+        enable  = self.ctrl.storage[0]
+        reset   = Signal()
+        head    = Signal(32)
+        dropped = Signal(32)
+        hop_cnt = Signal(16)
+        rec_adr = Signal(30)   # word address of the next record's slot
+        adr     = Signal(30)   # word address of the next word
+        count   = Signal(8)    # words left in the current record
+        used    = Signal(32)   # records the CPU still holds (HEAD - TAIL, mod 2^32)
+        full    = Signal()
+        wrap    = Signal()     # the current record fills the ring's last slot
+        commit  = Signal()     # last word of a written record acked
+        drop    = Signal()     # last word of a dropped record taken
+
+        self.comb += [
+            reset.eq(self.ctrl.re & self.ctrl.dat_w[1]),
+            used.eq(head - self.tail.storage),
+            full.eq(used >= self.frames.storage),
+            wrap.eq(((head + 1) & (self.frames.storage - 1)) == 0),
+            self.head.status.eq(head),
+            self.dropped.status.eq(dropped),
+        ]
+
+        self.submodules.fsm = fsm = FSM(reset_state="IDLE")
+        fsm.act("IDLE",
+            If(enable & sink.valid & ~reset,
+                NextValue(count, self.rec_words.storage),
+                If(full,
+                    NextState("DROP"),
+                ).Else(
+                    NextValue(adr, rec_adr),
+                    NextState("WRITE"),
+                )
+            )
+        )
+        # One classic single-word write per stream word; the word is taken on its ack
+        fsm.act("WRITE",
+            bus.cyc.eq(sink.valid), bus.stb.eq(sink.valid), bus.we.eq(1), bus.sel.eq(0xf),
+            bus.adr.eq(adr), bus.dat_w.eq(sink.data),
+            sink.ready.eq(bus.ack),
+            If(bus.ack,
+                NextValue(adr, adr + 1),
+                NextValue(count, count - 1),
+                If(count == 1,
+                    commit.eq(1),
+                    NextState("IDLE"),
+                )
+            ),
+            If(reset, NextState("IDLE")),
+        )
+        fsm.act("DROP",
+            sink.ready.eq(1),
+            If(sink.valid,
+                NextValue(count, count - 1),
+                If(count == 1,
+                    drop.eq(1),
+                    NextState("IDLE"),
+                )
+            ),
+            If(reset, NextState("IDLE")),
+        )
+
+        # HEAD, DROPPED and the hop count advance at the end of a record; reset also rewinds
+        # the write slot to BASE (a record in progress is abandoned)
+        self.sync += [
+            If(reset,
+                head.eq(0),
+                dropped.eq(0),
+                hop_cnt.eq(0),
+                rec_adr.eq(self.base.storage[2:]),
+            ).Elif(commit,
+                head.eq(head + 1),
+                rec_adr.eq(Mux(wrap, self.base.storage[2:], adr + 1)),
+                If(hop_cnt == self.hop.storage - 1,
+                    hop_cnt.eq(0),
+                ).Else(
+                    hop_cnt.eq(hop_cnt + 1),
+                )
+            ).Elif(drop,
+                dropped.eq(dropped + 1),
+            )
+        ]
+        self.comb += self.ev.hop.trigger.eq(commit & (hop_cnt == self.hop.storage - 1))
@@ -0,0 +1,208 @@
+/*
+ * Sensor capture DMA driver.
+ * USE_SENSOR_DMA_HW: SENSOR_DMA_USE_LITEX_CSR + generated/csr.h (32-bit CSR data width), or
+ * SENSOR_DMA_BASE / sensor_dma_init() for raw MMIO. Without USE_SENSOR_DMA_HW nothing is
+ * captured: HEAD reads 0 and sensor_dma_wait() returns at once.
+ *
+ * The block writes the ring behind the CPU's D-cache, so sensor_dma_head() flushes it when
+ * new records have arrived (LiteX flush_cpu_dcache(), or SENSOR_DMA_DCACHE_FLUSH() with raw
+ * MMIO). The records must not be written by the CPU.
+ *
+ * SENSOR_DMA_IRQ: the CPU-side hooks below (WFI, mstatus.MIE, IRQ controller mask) default
+ * to RV32 / LiteX VexRiscv; override them for other CPUs.
+ */
+
+#include "sensor_dma.h"
+#if defined(USE_SENSOR_DMA_HW) && defined(SENSOR_DMA_USE_LITEX_CSR)
+#  include <generated/csr.h>
+#  include <system.h>
+#  if SENSOR_DMA_IRQ
+#    include <generated/soc.h>   /* SENSOR_DMA_INTERRUPT */
+#  endif
+#endif
+
+#if defined(USE_SENSOR_DMA_HW)
+#  if defined(SENSOR_DMA_USE_LITEX_CSR)
+#    define SENSOR_DMA_WRITE_CTRL(v)       sensor_dma_ctrl_write((uint32_t)(v))
+#    define SENSOR_DMA_READ_INFO()         sensor_dma_info_read()
+#    define SENSOR_DMA_WRITE_RING(a)       sensor_dma_base_write((uint32_t)(a))
+#    define SENSOR_DMA_WRITE_REC_WORDS(v)  sensor_dma_rec_words_write((uint32_t)(v))
+#    define SENSOR_DMA_WRITE_FRAMES(v)     sensor_dma_frames_write((uint32_t)(v))
+#    define SENSOR_DMA_WRITE_HOP(v)        sensor_dma_hop_write((uint32_t)(v))
+#    define SENSOR_DMA_READ_HEAD()         sensor_dma_head_read()
+#    define SENSOR_DMA_WRITE_TAIL(v)       sensor_dma_tail_write((uint32_t)(v))
+#    define SENSOR_DMA_READ_DROPPED()      sensor_dma_dropped_read()
+#    define SENSOR_DMA_WRITE_EV_PENDING(v) sensor_dma_ev_pending_write((uint32_t)(v))
+#    define SENSOR_DMA_WRITE_EV_ENABLE(v)  sensor_dma_ev_enable_write((uint32_t)(v))
+#    ifndef SENSOR_DMA_DCACHE_FLUSH
+#      define SENSOR_DMA_DCACHE_FLUSH()    flush_cpu_dcache()
+#    endif
+#  else
+#    ifndef SENSOR_DMA_BASE
+#      define SENSOR_DMA_BASE  s_sensor_dma_base
+#    endif
+#    define SENSOR_DMA_REG(off)            (*(volatile uint32_t *)(SENSOR_DMA_BASE + (off)))
+#    define SENSOR_DMA_WRITE_CTRL(v)       (SENSOR_DMA_REG(SENSOR_DMA_CTRL) = (uint32_t)(v))
+#    define SENSOR_DMA_READ_INFO()         SENSOR_DMA_REG(SENSOR_DMA_INFO)
+#    define SENSOR_DMA_WRITE_RING(a)       (SENSOR_DMA_REG(SENSOR_DMA_RING_BASE) = (uint32_t)(a))
+#    define SENSOR_DMA_WRITE_REC_WORDS(v)  (SENSOR_DMA_REG(SENSOR_DMA_REC_WORDS) = (uint32_t)(v))
+#    define SENSOR_DMA_WRITE_FRAMES(v)     (SENSOR_DMA_REG(SENSOR_DMA_FRAMES) = (uint32_t)(v))
+#    define SENSOR_DMA_WRITE_HOP(v)        (SENSOR_DMA_REG(SENSOR_DMA_HOP) = (uint32_t)(v))
+#    define SENSOR_DMA_READ_HEAD()         SENSOR_DMA_REG(SENSOR_DMA_HEAD)
+#    define SENSOR_DMA_WRITE_TAIL(v)       (SENSOR_DMA_REG(SENSOR_DMA_TAIL) = (uint32_t)(v))
+#    define SENSOR_DMA_READ_DROPPED()      SENSOR_DMA_REG(SENSOR_DMA_DROPPED)
+#    define SENSOR_DMA_WRITE_EV_PENDING(v) (SENSOR_DMA_REG(SENSOR_DMA_EV_PENDING) = (uint32_t)(v))
+#    define SENSOR_DMA_WRITE_EV_ENABLE(v)  (SENSOR_DMA_REG(SENSOR_DMA_EV_ENABLE) = (uint32_t)(v))
+#    ifndef SENSOR_DMA_DCACHE_FLUSH
+#      define SENSOR_DMA_DCACHE_FLUSH()    ((void)0)   /* define for a CPU with a D-cache */
+#    endif
+#  endif
+#endif
+
+#if SENSOR_DMA_IRQ
+#  ifndef SENSOR_DMA_WFI
+#    define SENSOR_DMA_WFI()            __asm__ volatile ("wfi")
+#  endif
+/* Mask machine interrupts (mstatus.MIE) / restore the saved mstatus */
+#  ifndef SENSOR_DMA_IRQ_SAVE
+#    define SENSOR_DMA_IRQ_SAVE(s)      __asm__ volatile ("csrrci %0, mstatus, 8" : "=r"(s))
+#    define SENSOR_DMA_IRQ_RESTORE(s)   __asm__ volatile ("csrw mstatus, %0" :: "r"(s))
+#  endif
+/* Unmask the sensor DMA line in the VexRiscv IRQ controller (CSR 0xBC0), enable MIE */
+#  ifndef SENSOR_DMA_CPU_IRQ_ENABLE
+#    ifndef SENSOR_DMA_INTERRUPT
+#      error "Define SENSOR_DMA_INTERRUPT (IRQ line) or SENSOR_DMA_CPU_IRQ_ENABLE() for SENSOR_DMA_IRQ"
+#    endif
+#    define SENSOR_DMA_CPU_IRQ_ENABLE() do {                                          \
+         __asm__ volatile ("csrs 0xBC0, %0" :: "r"(1u << SENSOR_DMA_INTERRUPT));    \
+         __asm__ volatile ("csrsi mstatus, 8");                                      \
+     } while (0)
+#  endif
+#endif
+
+static uintptr_t s_sensor_dma_base;
+
+/* HEAD at the last D-cache flush */
+static uint32_t s_seen_head;
+
+void sensor_dma_init(uintptr_t base_addr)
+{
+    s_sensor_dma_base = base_addr;
+    (void)s_sensor_dma_base; /* unused when using LiteX CSRs or a fixed SENSOR_DMA_BASE */
+}
+
+int sensor_dma_probe(void)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    uint32_t info = SENSOR_DMA_READ_INFO();
+    return (info >> 16) == SENSOR_DMA_MAGIC && (info & 0xFFu) == SENSOR_DMA_VERSION;
+#else
+    return 0;
+#endif
+}
+
+void sensor_dma_start(void *ring, uint32_t frames, uint32_t rec_bytes, uint32_t hop)
+{
+    s_seen_head = 0u;
+#if defined(USE_SENSOR_DMA_HW)
+    SENSOR_DMA_WRITE_CTRL(0u);
+    SENSOR_DMA_WRITE_TAIL(0u);
+    SENSOR_DMA_WRITE_RING((uint32_t)(uintptr_t)ring);
+    SENSOR_DMA_WRITE_REC_WORDS(rec_bytes / 4u);
+    SENSOR_DMA_WRITE_FRAMES(frames);
+    SENSOR_DMA_WRITE_HOP(hop);
+    SENSOR_DMA_WRITE_CTRL(SENSOR_DMA_CTRL_RESET);
+    SENSOR_DMA_WRITE_CTRL(SENSOR_DMA_CTRL_ENABLE);
+#else
+    (void)ring;
+    (void)frames;
+    (void)rec_bytes;
+    (void)hop;
+#endif
+}
+
+void sensor_dma_stop(void)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    SENSOR_DMA_WRITE_CTRL(0u);
+#endif
+}
+
+uint32_t sensor_dma_head(void)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    uint32_t head = SENSOR_DMA_READ_HEAD();
+    if (head != s_seen_head) {
+        SENSOR_DMA_DCACHE_FLUSH();
+        s_seen_head = head;
+    }
+    return head;
+#else
+    return 0u;
+#endif
+}
+
+void sensor_dma_release(uint32_t tail)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    SENSOR_DMA_WRITE_TAIL(tail);
+#else
+    (void)tail;
+#endif
+}
+
+uint32_t sensor_dma_dropped(void)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    return SENSOR_DMA_READ_DROPPED();
+#else
+    return 0u;
+#endif
+}
+
+uint32_t sensor_dma_wait(uint32_t tail, uint32_t n)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    uint32_t head;
+    while (1) {
+#if SENSOR_DMA_IRQ
+        uint32_t mstatus;
+        SENSOR_DMA_IRQ_SAVE(mstatus);
+        head = sensor_dma_head();
+        if (head - tail >= n) {
+            SENSOR_DMA_IRQ_RESTORE(mstatus);
+            break;
+        }
+        /* WFI wakes on the pending line even with MIE clear; the ISR runs after the restore */
+        SENSOR_DMA_WFI();
+        SENSOR_DMA_IRQ_RESTORE(mstatus);
+#else
+        head = sensor_dma_head();
+        if (head - tail >= n) break;
+#endif
+    }
+    return head;
+#else
+    (void)tail;
+    (void)n;
+    return 0u;
+#endif
+}
+
+#if SENSOR_DMA_IRQ
+void sensor_dma_irq_init(void)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    SENSOR_DMA_WRITE_EV_PENDING(SENSOR_DMA_EV_HOP);
+    SENSOR_DMA_WRITE_EV_ENABLE(SENSOR_DMA_EV_HOP);
+#endif
+    SENSOR_DMA_CPU_IRQ_ENABLE();
+}
+
+void sensor_dma_isr(void)
+{
+#if defined(USE_SENSOR_DMA_HW)
+    SENSOR_DMA_WRITE_EV_PENDING(SENSOR_DMA_EV_HOP);
+#endif
+}
+#endif
@@ -0,0 +1,104 @@
+/*
+ * Sensor capture DMA — C driver API.
+ *
+ * Defining USE_SENSOR_DMA_HW (in the firmware that uses this driver) requires the SoC to
+ * include the corresponding HW block; otherwise the calls do nothing, HEAD stays 0 and
+ * sensor_dma_probe() fails.
+ *
+ * Use with LiteX-generated CSR accessors (SENSOR_DMA_USE_LITEX_CSR: sensor_dma_ctrl_write(),
+ * ...) or with SENSOR_DMA_BASE / sensor_dma_init() and the offsets below.
+ *
+ * The block writes whole records (e.g. one quantized TinyFormer frame each) into a ring in
+ * memory. Usage: sensor_dma_start(ring, frames, rec_bytes, hop) once; then the records
+ * [tail, sensor_dma_head()) are valid in place (slot n % frames) until
+ * sensor_dma_release(tail + k) hands the oldest k back. Indices are free-running uint32_t.
+ */
+
+#ifndef SENSOR_DMA_H
+#define SENSOR_DMA_H
+
+#include <stdint.h>
+
+/* Optional: set base address when not using LiteX generated/csr.h */
+#ifndef SENSOR_DMA_BASE
+/* #define SENSOR_DMA_BASE  0x00000000 */
+#endif
+
+/* Register offsets (bytes) — must match sensor_dma_spec.md and LiteX wrapper */
+#define SENSOR_DMA_CTRL        0x00
+#define SENSOR_DMA_INFO        0x04   /* [7:0] version, [31:16] SENSOR_DMA_MAGIC */
+#define SENSOR_DMA_RING_BASE   0x08   /* ring byte address (4-byte aligned) */
+#define SENSOR_DMA_REC_WORDS   0x0C   /* words per record */
+#define SENSOR_DMA_FRAMES      0x10   /* records in the ring (power of two) */
+#define SENSOR_DMA_HOP         0x14   /* records per hop event */
+#define SENSOR_DMA_HEAD        0x18   /* records written (free-running) */
+#define SENSOR_DMA_TAIL        0x1C   /* records released (free-running) */
+#define SENSOR_DMA_DROPPED     0x20   /* records dropped on a full ring */
+#define SENSOR_DMA_EV_STATUS   0x24   /* hop interrupt: raw event */
+#define SENSOR_DMA_EV_PENDING  0x28   /* pending; write SENSOR_DMA_EV_HOP to acknowledge */
+#define SENSOR_DMA_EV_ENABLE   0x2C
+
+/* CTRL bits: ENABLE is stored; RESET is a pulse */
+#define SENSOR_DMA_CTRL_ENABLE  (1u << 0)
+#define SENSOR_DMA_CTRL_RESET   (1u << 1)   /* zero HEAD / DROPPED, rewind to the ring base */
+
+/* EV_* bit of the hop event */
+#define SENSOR_DMA_EV_HOP       (1u << 0)
+
+#define SENSOR_DMA_MAGIC   0x5344u
+#define SENSOR_DMA_VERSION 1u
+
+/* SENSOR_DMA_IRQ=1: gateware with the hop interrupt wired to the CPU
+ * (self.irq.add("sensor_dma")); enables sensor_dma_irq_init(), sensor_dma_isr() and
+ * lets sensor_dma_wait() sleep in WFI between hops. Default 0 (sensor_dma_wait() polls). */
+#ifndef SENSOR_DMA_IRQ
+#define SENSOR_DMA_IRQ 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initialize driver (set base address if using SENSOR_DMA_BASE). No-op when using LiteX CSRs. */
+void sensor_dma_init(uintptr_t base_addr);
+
+/* 1 if INFO identifies a sensor DMA block of SENSOR_DMA_VERSION, else 0. */
+int sensor_dma_probe(void);
+
+/* Stop the block, point it at ring (4-byte aligned, frames * rec_bytes bytes; frames a power
+ * of two, rec_bytes a multiple of 4 up to 1020), zero HEAD, TAIL and DROPPED and start
+ * capturing, with a hop event every hop records. */
+void sensor_dma_start(void *ring, uint32_t frames, uint32_t rec_bytes, uint32_t hop);
+
+/* Stop capturing; a record in progress is still finished. */
+void sensor_dma_stop(void);
+
+/* Records written so far. When it has moved on since the last call the D-cache is flushed,
+ * so the CPU reads the new records from memory (SENSOR_DMA_DCACHE_FLUSH()). */
+uint32_t sensor_dma_head(void);
+
+/* Hand every record before tail (free-running) back to the block. */
+void sensor_dma_release(uint32_t tail);
+
+/* Records dropped since sensor_dma_start() because the ring was full. */
+uint32_t sensor_dma_dropped(void);
+
+/* Wait until HEAD - tail >= n and return HEAD (sensor_dma_head()); with SENSOR_DMA_IRQ the
+ * core sleeps in WFI until each hop event. */
+uint32_t sensor_dma_wait(uint32_t tail, uint32_t n);
+
+#if SENSOR_DMA_IRQ
+/* Acknowledge any stale event, enable the hop interrupt and unmask it at the CPU
+ * (LiteX VexRiscv: IRQ mask CSR bit SENSOR_DMA_INTERRUPT, mstatus.MIE). */
+void sensor_dma_irq_init(void);
+
+/* Hop ISR: acknowledges the event (the WFI in sensor_dma_wait() has already woken). Call
+ * from isr(). */
+void sensor_dma_isr(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_DMA_H */
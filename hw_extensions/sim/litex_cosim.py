@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+# Firmware co-simulation: boots litex_port/firmware.bin on a Verilated VexRiscv + LiteX SoC
+# with the TinyFormer extensions and captures the demo_run() UART output (ENC_CKSUM, pred,
+# PROF / PERF per-stage cycles), so perf and regression checks run without a board.
+#
+# Per TARGET (litex_port/Makefile):
+#   1. Generate the SoC headers (generated/csr.h, regions.ld, ...) and copy them to
+#      litex_port/generated, as setup_build.sh does for the board build.
+#   2. make TARGET=<target> PROFILE=1 [--make_args] in litex_port.
+#   3. Rebuild the simulator with firmware.bin preloaded in main_ram (the BIOS boots it through
+#      ROM_BOOT_ADDRESS), run it, answer the baseline's "Ready" prompt and stop once the
+#      "PROF total" line was followed by idle_s of silence (or after timeout_s).
+#   4. Write <logs>/<target>.log. --bench then runs scripts/run_baseline_and_measure.py
+#      --bench --from_logs <logs>: the ENC_CKSUM / pred gate, per-stage speedups and history.
+#
+# SoC: VexRiscv (--cpu-variant, default standard) with the GEMV, exp LUT, softmax and perfmon
+# peripherals, integrated ROM (BIOS) and SRAM, and either integrated main_ram (one-cycle,
+# default) or an SDRAM model behind the L2 cache (--sdram-module, e.g. MT47H64M16 of the
+# Nexys4DDR), whose refill latency is closer to the board. DOT8 is a CPU plugin:
+# the stock VexRiscv netlists lack it, so the DOT8 targets need --cpu-verilog, a VexRiscv.v
+# generated with Dot8Plugin in the same LiteX variant; without it they are skipped.
+#
+# Usage (from litex_port: make cosim TARGET=accel_gemv, make cosim-bench):
+#   python3 ../hw_extensions/sim/litex_cosim.py --targets baseline,accel_gemv
+#   python3 ../hw_extensions/sim/litex_cosim.py --bench --cpu-verilog VexRiscv_Dot8.v \
+#       --sdram-module MT47H64M16 --make_args "PERFMON=1"
+
+import argparse
+import os
+import select
+import shutil
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+from migen import *
+from migen.genlib.io import CRG
+
+from litex.build.generic_platform import Pins, Subsignal
+from litex.build.sim import SimPlatform
+from litex.build.sim.config import SimConfig
+from litex.soc.integration.builder import Builder
+from litex.soc.integration.common import get_mem_data
+from litex.soc.integration.soc import SoCRegion
+from litex.soc.integration.soc_core import SoCCore
+
+SIM_DIR = Path(__file__).resolve().parent
+HW_DIR = SIM_DIR.parent
+REPO_ROOT = HW_DIR.parent
+LITEX_DIR = REPO_ROOT / "litex_port"
+
+sys.path.insert(0, str(HW_DIR / "gemv" / "litex"))
+sys.path.insert(0, str(HW_DIR / "exp_lut" / "litex"))
+sys.path.insert(0, str(HW_DIR / "softmax" / "litex"))
+sys.path.insert(0, str(HW_DIR / "perfmon" / "litex"))
+sys.path.insert(0, str(HW_DIR / "gemm" / "litex"))
+sys.path.insert(0, str(HW_DIR / "attention" / "litex"))
+from gemv_periph import GEMVPeripheral, add_gemv_instances  # noqa: E402
+from exp_lut_periph import ExpLUTPeripheral   # noqa: E402
+from softmax_periph import SoftmaxPeripheral  # noqa: E402
+from perfmon_periph import PerfmonPeripheral  # noqa: E402
+from gemm_periph import GEMMPeripheral        # noqa: E402
+from attn_periph import AttnPeripheral        # noqa: E402
+
+TARGETS = ["baseline", "accel_dot8", "accel_lut", "accel_gemv", "accel_dot8_lut", "accel_all"]
+DOT8_TARGETS = {"accel_dot8", "accel_dot8_lut", "accel_all"}
+
+_io = [
+    ("sys_clk", 0, Pins(1)),
+    ("sys_rst", 0, Pins(1)),
+    ("serial", 0,
+        Subsignal("source_valid", Pins(1)),
+        Subsignal("source_ready", Pins(1)),
+        Subsignal("source_data",  Pins(8)),
+        Subsignal("sink_valid",   Pins(1)),
+        Subsignal("sink_ready",   Pins(1)),
+        Subsignal("sink_data",    Pins(8)),
+    ),
+]
+
+
+class Platform(SimPlatform):
+    def __init__(self):
+        SimPlatform.__init__(self, "SIM", _io)
+
+
+class CosimSoC(SoCCore):
+    """VexRiscv + LiteX sim SoC with the hw_extensions peripherals; ram_init preloads main_ram."""
+
+    def __init__(self, args, ram_init=None):
+        platform = Platform()
+        sys_clk_freq = int(args.sys_clk_freq)
+        use_sdram = args.sdram_module is not None
+
+        SoCCore.__init__(self, platform, sys_clk_freq,
+            cpu_type             = "vexriscv",
+            cpu_variant          = args.cpu_variant,
+            uart_name            = "sim",
+            integrated_rom_size  = 0x10000,
+            integrated_sram_size = args.sram_size,
+            integrated_main_ram_size = 0 if use_sdram else args.main_ram_size,
+            integrated_main_ram_init = [] if use_sdram else (ram_init or []),
+            ident                = "TinyFormer co-simulation SoC")
+        self.submodules.crg = CRG(platform.request("sys_clk"))
+
+        if use_sdram:
+            from litedram import modules as litedram_modules
+            from litedram.phy.model import SDRAMPHYModel, get_sdram_phy_settings, sdram_module_nphases
+            module_cls = getattr(litedram_modules, args.sdram_module)
+            module = module_cls(sys_clk_freq, "1:{}".format(sdram_module_nphases[module_cls.memtype]))
+            settings = get_sdram_phy_settings(memtype=module.memtype, data_width=args.sdram_data_width,
+                                              clk_freq=sys_clk_freq)
+            self.submodules.sdrphy = SDRAMPHYModel(module=module, settings=settings, clk_freq=sys_clk_freq,
+                                        init=ram_init or [])
+            self.add_sdram("sdram", phy=self.sdrphy, module=module, l2_cache_size=args.l2_size)
+            if ram_init:
+                self.add_constant("SDRAM_TEST_DISABLE")
+        if ram_init:
+            self.add_constant("ROM_BOOT_ADDRESS", self.mem_map["main_ram"])
+
+        # --- TinyFormer extensions (CSR names as the drivers expect) ---
+        # --clock-gate: the latch form of clk_gate.v (Verilator has no BUFGCE)
+        clock_gate = "latch" if args.clock_gate else False
+        if clock_gate:
+            platform.add_source(str(HW_DIR / "gemv" / "rtl" / "clk_gate.v"))
+        self.submodules.gemv = GEMVPeripheral(with_dma=args.gemv_dma, lanes=args.gemv_lanes, rows=args.gemv_rows,
+                                              with_mem=args.gemv_mem, attn=args.gemv_attn,
+                                              w_banks=args.gemv_w_banks, pipeline=args.gemv_pipeline,
+                                              clock_gate=clock_gate)
+        self.add_csr("gemv")
+        self.irq.add("gemv", use_loc_if_exists=True)
+        if args.gemv_dma:
+            self.bus.add_master(name="gemv", master=self.gemv.bus)
+        if args.gemv_mem:
+            self.bus.add_slave("gemv_mem", self.gemv.mem_bus,
+                               SoCRegion(origin=0x90000000, size=self.gemv.mem_size, cached=False))
+        add_gemv_instances(self, args.gemv_devices, lanes=args.gemv_lanes, rows=args.gemv_rows,
+                           pipeline=args.gemv_pipeline)
+        platform.add_source(str(HW_DIR / "gemv" / "rtl" / "gemv_core.v"))
+
+        self.submodules.exp_lut = ExpLUTPeripheral()
+        self.add_csr("exp_lut")
+        platform.add_source(str(HW_DIR / "exp_lut" / "exp_lut.v"))
+
+        self.submodules.softmax = SoftmaxPeripheral()
+        self.add_csr("softmax")
+        platform.add_source(str(HW_DIR / "softmax" / "rtl" / "softmax_core.v"))
+
+        self.submodules.perfmon = PerfmonPeripheral(self.cpu.ibus, self.cpu.dbus, gemv_busy=self.gemv.busy)
+        self.add_csr("perfmon")
+        platform.add_source(str(HW_DIR / "perfmon" / "rtl" / "perfmon_core.v"))
+
+        if args.gemm_pe:
+            self.submodules.gemm = GEMMPeripheral(pe=args.gemm_pe, clock_gate=clock_gate)
+            self.add_csr("gemm")
+            platform.add_source(str(HW_DIR / "gemm" / "rtl" / "gemm_core.v"))
+
+        if args.attn:
+            # exp_lut.v is already a source (ExpLUTPeripheral)
+            self.submodules.attn = AttnPeripheral(clock_gate=clock_gate)
+            self.add_csr("attn")
+            platform.add_source(str(HW_DIR / "attention" / "rtl" / "attn_core.v"))
+
+
+def use_cpu_verilog(path):
+    """Build with a custom VexRiscv netlist (top module VexRiscv, e.g. with Dot8Plugin)."""
+    from litex.soc.cores.cpu.vexriscv.core import VexRiscv
+    VexRiscv.add_sources = staticmethod(lambda platform, variant="standard": platform.add_source(str(path)))
+
+
+def sim_config(args):
+    cfg = SimConfig()
+    cfg.add_clocker("sys_clk", freq_hz=int(args.sys_clk_freq))
+    cfg.add_module("serial2console", "serial")
+    return cfg
+
+
+def build_soc(args, ram_init=None, compile_gateware=False):
+    """Generate headers (and the BIOS); with compile_gateware also Verilate the simulator."""
+    soc = CosimSoC(args, ram_init=ram_init)
+    builder = Builder(soc, output_dir=str(args.build_dir), compile_gateware=compile_gateware)
+    builder.build(sim_config=sim_config(args), run=False, threads=args.threads)
+    return soc
+
+
+def copy_headers(args):
+    src = Path(args.build_dir) / "software" / "include" / "generated"
+    dst = LITEX_DIR / "generated"
+    dst.mkdir(exist_ok=True)
+    for f in src.iterdir():
+        if f.is_file():
+            shutil.copy(f, dst / f.name)
+
+
+def build_firmware(target, make_args):
+    subprocess.run(["make", "-C", str(LITEX_DIR), "clean"], check=True)
+    subprocess.run(["make", "-C", str(LITEX_DIR), f"TARGET={target}", "PROFILE=1"] + make_args, check=True)
+    return LITEX_DIR / "firmware.bin"
+
+
+def run_sim(args, log_path):
+    """Run the Verilated SoC; returns the captured UART lines (also written to log_path)."""
+    gateware = Path(args.build_dir) / "gateware"
+    proc = subprocess.Popen([str(gateware / "obj_dir" / "Vsim")], cwd=str(gateware),
+                            stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    lines, buf = [], b""
+    seen_total = False
+    last_rx = time.time()
+    end_time = last_rx + args.timeout_s
+    try:
+        with open(log_path, "w", encoding="utf-8") as log:
+            while time.time() < end_time:
+                ready, _, _ = select.select([proc.stdout], [], [], 0.2)
+                if not ready:
+                    if proc.poll() is not None or (seen_total and time.time() - last_rx > args.idle_s):
+                        break
+                    continue
+                chunk = os.read(proc.stdout.fileno(), 4096)
+                if not chunk:
+                    break
+                last_rx = time.time()
+                buf += chunk
+                while b"\n" in buf:
+                    raw, buf = buf.split(b"\n", 1)
+                    line = raw.decode("utf-8", errors="replace").strip()
+                    if not line:
+                        continue
+                    lines.append(line)
+                    log.write(line + "\n")
+                    if args.verbose:
+                        print(f"  SIM: {line}")
+                    if line == "Ready" and not seen_total:
+                        proc.stdin.write(b"s")
+                        proc.stdin.flush()
+                    if line.startswith("PROF total"):
+                        seen_total = True
+    finally:
+        proc.kill()
+        proc.wait()
+    if not seen_total:
+        print(f"  warning: no PROF total line within {args.timeout_s}s")
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Co-simulate litex_port firmware on a Verilated LiteX SoC.")
+    parser.add_argument("--targets", default=",".join(TARGETS), help="Comma-separated Makefile TARGETs")
+    parser.add_argument("--make_args", default="", help='Extra make arguments, e.g. "PERFMON=1 FAST_MEM=sram"')
+    parser.add_argument("--logs", default=str(SIM_DIR / "cosim_logs"), help="Directory for <target>.log")
+    parser.add_argument("--build_dir", default=str(SIM_DIR / "cosim_build"), help="LiteX build directory")
+    parser.add_argument("--bench", action="store_true", help="Run run_baseline_and_measure.py --bench on the logs")
+    parser.add_argument("--bench_args", default="", help="Extra arguments for the bench driver")
+    parser.add_argument("--cpu-variant", dest="cpu_variant", default="standard", help="VexRiscv variant")
+    parser.add_argument("--cpu-verilog", dest="cpu_verilog", default=None,
+                        help="VexRiscv netlist with Dot8Plugin (needed for the DOT8 targets)")
+    parser.add_argument("--sys-clk-freq", dest="sys_clk_freq", type=float, default=100e6)
+    parser.add_argument("--main-ram-size", dest="main_ram_size", type=lambda x: int(x, 0), default=0x400000)
+    parser.add_argument("--sram-size", dest="sram_size", type=lambda x: int(x, 0), default=0x10000)
+    parser.add_argument("--sdram-module", dest="sdram_module", default=None,
+                        help="litedram module for an SDRAM model instead of integrated main_ram")
+    parser.add_argument("--sdram-data-width", dest="sdram_data_width", type=int, default=16)
+    parser.add_argument("--l2-size", dest="l2_size", type=lambda x: int(x, 0), default=8192)
+    parser.add_argument("--gemv-dma", dest="gemv_dma", action="store_true", help="GEMVPeripheral(with_dma=True)")
+    parser.add_argument("--gemv-mem", dest="gemv_mem", action="store_true", help="GEMVPeripheral(with_mem=True)")
+    parser.add_argument("--gemv-attn", dest="gemv_attn", action="store_true", help="GEMVPeripheral(attn=True)")
+    parser.add_argument("--gemv-lanes", dest="gemv_lanes", type=int, default=1)
+    parser.add_argument("--gemv-rows", dest="gemv_rows", type=int, default=1)
+    parser.add_argument("--gemv-w-banks", dest="gemv_w_banks", type=int, default=1, choices=(1, 2),
+                        help="GEMVPeripheral(w_banks=2) for firmware built with GEMV_W_BANKS=2")
+    parser.add_argument("--gemv-pipeline", dest="gemv_pipeline", action="store_true",
+                        help="GEMVPeripheral(pipeline=True): registered datapath for a higher Fmax")
+    parser.add_argument("--gemv-devices", dest="gemv_devices", type=int, default=1, choices=(1, 2, 3, 4),
+                        help="GEMV instances (gemv, gemv1, ...) for firmware built with GEMV_DEVICES=n")
+    parser.add_argument("--gemm", dest="gemm_pe", type=int, nargs="?", const=4, default=0, choices=(4, 8),
+                        help="Add GEMMPeripheral(pe=4, or the given 4/8) for firmware built with GEMM=1")
+    parser.add_argument("--attn", action="store_true", help="Add AttnPeripheral for firmware built with ATTN=1")
+    parser.add_argument("--clock-gate", dest="clock_gate", action="store_true",
+                        help="Clock-gate the GEMV / GEMM / attention cores, for firmware built with CLOCK_GATE=1")
+    parser.add_argument("--threads", type=int, default=1, help="Verilator threads")
+    parser.add_argument("--timeout_s", type=float, default=1800.0, help="Wall-clock limit per target")
+    parser.add_argument("--idle_s", type=float, default=2.0, help='Quiet time that ends a run after "PROF total"')
+    parser.add_argument("--verbose", action="store_true")
+    args = parser.parse_args()
+
+    if args.cpu_verilog:
+        use_cpu_verilog(Path(args.cpu_verilog).resolve())
+    logs = Path(args.logs)
+    logs.mkdir(parents=True, exist_ok=True)
+    make_args = args.make_args.split()
+
+    ran = []
+    for target in args.targets.split(","):
+        print(f"\n--- {target} ---")
+        if target in DOT8_TARGETS and not args.cpu_verilog:
+            print("  skipped: DOT8 needs --cpu-verilog (VexRiscv with Dot8Plugin)")
+            continue
+        build_soc(args)
+        copy_headers(args)
+        firmware = build_firmware(target, make_args)
+        build_soc(args, ram_init=get_mem_data(str(firmware), endianness="little"), compile_gateware=True)
+        lines = run_sim(args, logs / f"{target}.log")
+        total = next((l for l in lines if l.startswith("PROF total")), "no PROF total")
+        print(f"  {sum(l.startswith('ENC_CKSUM') for l in lines)} ENC_CKSUM lines, {total}")
+        ran.append(target)
+
+    if args.bench and ran:
+        cmd = [sys.executable, str(REPO_ROOT / "scripts" / "run_baseline_and_measure.py"), "--bench",
+               "--from_logs", str(logs), "--targets", ",".join(ran)] + args.bench_args.split()
+        sys.exit(subprocess.run(cmd).returncode)
+
+
+if __name__ == "__main__":
+    main()
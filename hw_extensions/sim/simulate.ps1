@@ -8,7 +8,7 @@
     (xvlog, xelab, xsim). It reproduces the functionality of the Makefile for Windows PowerShell users.
 
 .PARAMETER Target
-    The simulation target to run. Options: "gemv", "lut", "all". Default is "all".
+    The simulation target to run. Options: "gemv", "lut", "softmax", "perfmon", "gemm", "attn", "clkgate", "all". Default is "all".
 
 .PARAMETER Clean
     If set, removes simulation artifacts and exits.
@@ -23,7 +23,7 @@
 #>
 
 param (
-    [ValidateSet("gemv", "lut", "all")]
+    [ValidateSet("gemv", "lut", "softmax", "perfmon", "gemm", "attn", "clkgate", "all")]
     [string]$Target = "all",
 
     [switch]$Clean
@@ -75,6 +75,56 @@ function Run-Lut {
     Run-Command "xsim tb_lut_sim -runall"
 }
 
+function Run-Softmax {
+    Write-Host "`n=== Running Softmax Simulation ===" -ForegroundColor Magenta
+    # Compile
+    Run-Command "xvlog -sv tb_softmax.sv softmax_core.v"
+    # Elaborate
+    Run-Command "xelab -debug typical tb_softmax -s tb_softmax_sim"
+    # Simulate
+    Run-Command "xsim tb_softmax_sim -runall"
+}
+
+function Run-Perfmon {
+    Write-Host "`n=== Running Performance Monitor Simulation ===" -ForegroundColor Magenta
+    # Compile
+    Run-Command "xvlog -sv tb_perfmon.sv perfmon_core.v"
+    # Elaborate
+    Run-Command "xelab -debug typical tb_perfmon -s tb_perfmon_sim"
+    # Simulate
+    Run-Command "xsim tb_perfmon_sim -runall"
+}
+
+function Run-Gemm {
+    Write-Host "`n=== Running GEMM Simulation ===" -ForegroundColor Magenta
+    # Compile
+    Run-Command "xvlog -sv tb_gemm.sv gemm_core.v"
+    # Elaborate
+    Run-Command "xelab -debug typical tb_gemm -s tb_gemm_sim"
+    # Simulate
+    Run-Command "xsim tb_gemm_sim -runall"
+}
+
+function Run-Attn {
+    Write-Host "`n=== Running Attention Engine Simulation ===" -ForegroundColor Magenta
+    # Compile
+    Run-Command "xvlog -sv tb_attn.sv attn_core.v exp_lut.v"
+    # Elaborate
+    Run-Command "xelab -debug typical tb_attn -s tb_attn_sim"
+    # Simulate
+    Run-Command "xsim tb_attn_sim -runall"
+}
+
+function Run-ClkGate {
+    Write-Host "`n=== Running Clock Gate Simulation ===" -ForegroundColor Magenta
+    # Compile
+    Run-Command "xvlog -sv tb_clk_gate.sv clk_gate.v"
+    # Elaborate
+    Run-Command "xelab -debug typical tb_clk_gate -s tb_clk_gate_sim"
+    # Simulate
+    Run-Command "xsim tb_clk_gate_sim -runall"
+}
+
 # --- Main Execution ---
 
 if ($Clean) {
@@ -97,4 +147,24 @@ if ($Target -eq "lut" -or $Target -eq "all") {
     Run-Lut
 }
 
+if ($Target -eq "softmax" -or $Target -eq "all") {
+    Run-Softmax
+}
+
+if ($Target -eq "perfmon" -or $Target -eq "all") {
+    Run-Perfmon
+}
+
+if ($Target -eq "gemm" -or $Target -eq "all") {
+    Run-Gemm
+}
+
+if ($Target -eq "attn" -or $Target -eq "all") {
+    Run-Attn
+}
+
+if ($Target -eq "clkgate" -or $Target -eq "all") {
+    Run-ClkGate
+}
+
 Write-Host "`nSimulation sequence finished." -ForegroundColor Green
@@ -0,0 +1,277 @@
+`timescale 1ns/1ps
+
+/*
+ * Standalone testbench for the attention engine.
+ *
+ * DUT (in this repo): hw_extensions/attention/rtl/attn_core.v : module attn_core
+ *                     (with hw_extensions/exp_lut/exp_lut.v)
+ *
+ * Goals:
+ *  - Compare the int8 context of every query and head against a golden model of
+ *    attention_multi_head() (two-pass softmax: scores >>> shift, LUT exp, divide
+ *    or reciprocal-multiply normalize, weighted sum of V >> 15, sat8).
+ *  - Cover TinyFormer's block (S=16, D=32, one and four heads), causal masking,
+ *    both normalize paths, the S_MAX x D_MAX corner, S=1, flat and saturating
+ *    score rows, and random shapes.
+ *  - Check that writes while busy are ignored and that clear rewinds the pointers.
+ */
+
+module tb_attn;
+  localparam int CLK_PERIOD_NS = 10;
+  localparam int S_MAX = 16;
+  localparam int D_MAX = 64;
+
+  logic clk = 1'b0;
+  logic reset = 1'b1;
+
+  logic        q_wr_en;
+  logic [31:0] q_wr_data;
+  logic        k_wr_en;
+  logic [31:0] k_wr_data;
+  logic        v_wr_en;
+  logic [31:0] v_wr_data;
+  logic [5:0]  s_dim;
+  logic [7:0]  d_dim;
+  logic [7:0]  hd_dim;
+  logic [4:0]  score_shift;
+  logic        fast;
+  logic        causal;
+  logic        start;
+  logic        clear;
+  wire         busy;
+  wire         done;
+  wire  [31:0] cycles;
+  logic        ctx_rd_en;
+  wire  [31:0] ctx_rd_data;
+
+  attn_core #(
+    .S_MAX(S_MAX),
+    .D_MAX(D_MAX)
+  ) dut (
+    .clk(clk),
+    .reset(reset),
+    .q_wr_en(q_wr_en),
+    .q_wr_data(q_wr_data),
+    .k_wr_en(k_wr_en),
+    .k_wr_data(k_wr_data),
+    .v_wr_en(v_wr_en),
+    .v_wr_data(v_wr_data),
+    .s_dim(s_dim),
+    .d_dim(d_dim),
+    .hd_dim(hd_dim),
+    .score_shift(score_shift),
+    .fast(fast),
+    .causal(causal),
+    .start(start),
+    .clear(clear),
+    .busy(busy),
+    .done(done),
+    .cycles(cycles),
+    .ctx_rd_en(ctx_rd_en),
+    .ctx_rd_data(ctx_rd_data)
+  );
+
+  always #(CLK_PERIOD_NS/2) clk = ~clk;
+
+  // Operands of the block under test and the golden context.
+  byte q [0:S_MAX-1][0:D_MAX-1];
+  byte k [0:S_MAX-1][0:D_MAX-1];
+  byte v [0:S_MAX-1][0:D_MAX-1];
+  byte gold [0:S_MAX-1][0:D_MAX-1];
+
+  // Q10 exp LUT (exp_lut.v / expected_lut.mem)
+  const int lut [0:15] = '{1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12};
+
+  task automatic cycle();
+    @(posedge clk);
+  endtask
+
+  task automatic reset_dut();
+    q_wr_en     = 1'b0;
+    q_wr_data   = '0;
+    k_wr_en     = 1'b0;
+    k_wr_data   = '0;
+    v_wr_en     = 1'b0;
+    v_wr_data   = '0;
+    s_dim       = 6'd1;
+    d_dim       = 8'd4;
+    hd_dim      = 8'd4;
+    score_shift = 5'd5;
+    fast        = 1'b0;
+    causal      = 1'b0;
+    start       = 1'b0;
+    clear       = 1'b0;
+    ctx_rd_en   = 1'b0;
+    reset = 1'b1;
+    repeat (5) cycle();
+    reset = 1'b0;
+    repeat (2) cycle();
+  endtask
+
+  // Random operands in [-range, range]
+  task automatic fill(input int s, input int d, input int range);
+    for (int i = 0; i < s; i++) begin
+      for (int c = 0; c < d; c++) begin
+        q[i][c] = byte'($urandom_range(2 * range) - range);
+        k[i][c] = byte'($urandom_range(2 * range) - range);
+        v[i][c] = byte'($urandom_range(2 * range) - range);
+      end
+    end
+  endtask
+
+  // Golden: attention_multi_head() of tinyformer.c for every query and head.
+  task automatic compute_golden(input int s, input int d, input int hd);
+    int sc [0:S_MAX-1];
+    int w  [0:S_MAX-1];
+    for (int i = 0; i < s; i++) begin
+      int n;
+      n = causal ? i + 1 : s;
+      for (int h0 = 0; h0 < d; h0 += hd) begin
+        int mx;
+        int unsigned sum;
+        mx = -2147483647;
+        sum = 0;
+        for (int j = 0; j < n; j++) begin
+          int acc;
+          acc = 0;
+          for (int c = h0; c < h0 + hd; c++) acc += int'(q[i][c]) * int'(k[j][c]);
+          sc[j] = acc >>> score_shift;
+          if (sc[j] > mx) mx = sc[j];
+        end
+        for (int j = 0; j < n; j++) begin
+          int idx;
+          idx = -((sc[j] - mx) >>> 3);
+          if (idx > 15) idx = 15;
+          w[j] = lut[idx];
+          sum += w[j];
+        end
+        if (sum == 0) sum = 1;
+        for (int j = 0; j < n; j++) begin
+          if (fast) w[j] = int'((longint'(w[j]) * longint'(32'h80000000 / sum)) >> 16) & 16'hFFFF;
+          else      w[j] = int'((longint'(w[j]) << 15) / sum) & 16'hFFFF;
+        end
+        for (int c = h0; c < h0 + hd; c++) begin
+          int acc;
+          acc = 0;
+          for (int j = 0; j < n; j++) acc += (w[j] * int'(v[j][c])) >>> 15;
+          if (acc > 127) acc = 127;
+          if (acc < -128) acc = -128;
+          gold[i][c] = byte'(acc);
+        end
+      end
+    end
+  endtask
+
+  // Q, K and V through the packed write ports, word by word interleaved (as attn_run()).
+  task automatic load(input int s, input int d);
+    clear = 1'b1;
+    cycle();
+    clear = 1'b0;
+    for (int i = 0; i < s; i++) begin
+      for (int c = 0; c < d; c += 4) begin
+        q_wr_en   = 1'b1;
+        q_wr_data = {q[i][c + 3], q[i][c + 2], q[i][c + 1], q[i][c]};
+        k_wr_en   = 1'b1;
+        k_wr_data = {k[i][c + 3], k[i][c + 2], k[i][c + 1], k[i][c]};
+        v_wr_en   = 1'b1;
+        v_wr_data = {v[i][c + 3], v[i][c + 2], v[i][c + 1], v[i][c]};
+        cycle();
+      end
+    end
+    q_wr_en = 1'b0;
+    k_wr_en = 1'b0;
+    v_wr_en = 1'b0;
+  endtask
+
+  // Start, wait for done; optionally hammer the write ports while busy.
+  task automatic run(input int s, input int d, input int hd, input bit poke);
+    int n;
+    start = 1'b1;
+    cycle();
+    start = 1'b0;
+    n = 0;
+    while (!done) begin
+      if (poke) begin
+        q_wr_en   = 1'b1;
+        q_wr_data = $urandom;
+        k_wr_en   = 1'b1;
+        k_wr_data = $urandom;
+        v_wr_en   = 1'b1;
+        v_wr_data = $urandom;
+      end
+      cycle();
+      n++;
+      if (n > 200000) begin
+        $display("TB_ATTN: FAIL timeout S=%0d D=%0d hd=%0d", s, d, hd);
+        $fatal(1);
+      end
+    end
+    q_wr_en = 1'b0;
+    k_wr_en = 1'b0;
+    v_wr_en = 1'b0;
+    #1;
+  endtask
+
+  task automatic check(input string what, input int s, input int d, input int hd);
+    for (int i = 0; i < s; i++) begin
+      for (int c = 0; c < d; c += 4) begin
+        for (int l = 0; l < 4; l++) begin
+          if ($signed(ctx_rd_data[8*l +: 8]) !== gold[i][c + l]) begin
+            $display("TB_ATTN: FAIL %s S=%0d D=%0d hd=%0d fast=%0d causal=%0d i=%0d c=%0d dut=%0d gold=%0d",
+                     what, s, d, hd, fast, causal, i, c + l, $signed(ctx_rd_data[8*l +: 8]), gold[i][c + l]);
+            $fatal(1);
+          end
+        end
+        ctx_rd_en = 1'b1;
+        cycle();
+        ctx_rd_en = 1'b0;
+        #1;
+      end
+    end
+  endtask
+
+  task automatic test_one(input int s, input int d, input int hd, input int sh,
+                          input bit caus, input int range, input bit poke = 1'b0);
+    s_dim       = s[5:0];
+    d_dim       = d[7:0];
+    hd_dim      = hd[7:0];
+    score_shift = sh[4:0];
+    causal      = caus;
+    fill(s, d, range);
+    for (int f = 0; f < 2; f++) begin
+      fast = f[0];
+      load(s, d);
+      run(s, d, hd, poke);
+      compute_golden(s, d, hd);
+      check(poke ? "busy_wr" : "ctx", s, d, hd);
+    end
+  endtask
+
+  initial begin
+    $dumpfile("tb_attn.vcd");
+    $dumpvars(0, tb_attn);
+
+    reset_dut();
+
+    test_one(16, 32, 32, 5, 1'b0, 127);      // TinyFormer block, one head
+    test_one(16, 32, 32, 5, 1'b1, 127);      // causal
+    test_one(16, 32, 8, 4, 1'b0, 127);       // four heads
+    test_one(16, 32, 16, 5, 1'b1, 127);
+    test_one(S_MAX, D_MAX, D_MAX, 5, 1'b0, 127);
+    test_one(7, 12, 4, 5, 1'b0, 127);
+    test_one(1, 32, 32, 5, 1'b0, 127);       // one key: w = 1.0
+    test_one(16, 32, 32, 5, 1'b0, 3);        // flat scores
+    test_one(16, 32, 32, 0, 1'b0, 127);      // saturating scores, idx clamps at 15
+    test_one(16, 32, 32, 5, 1'b1, 127, 1'b1); // writes while busy are ignored
+    for (int r = 0; r < 8; r++) begin
+      int hd;
+      hd = 4 * ($urandom_range(3) + 1);
+      test_one($urandom_range(S_MAX - 1) + 1, hd * ($urandom_range(D_MAX / hd - 1) + 1), hd,
+               $urandom_range(7), $urandom_range(1), 127);
+    end
+
+    $display("TB_ATTN: ALL TESTS PASS (last run %0d cycles)", cycles);
+    $finish;
+  end
+
+endmodule
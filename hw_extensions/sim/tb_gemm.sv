@@ -0,0 +1,324 @@
+`timescale 1ns/1ps
+
+/*
+ * Standalone testbench for the GEMM systolic array.
+ *
+ * DUT (in this repo): hw_extensions/gemm/rtl/gemm_core.v : module gemm_core
+ *
+ * Goals:
+ *  - Compare Y[m][n] = sum_k X[m][k] * W[n][k] (+ b[n]) against a golden matmul
+ *    for TinyFormer's projection shapes and random ones, with and without bias.
+ *  - Compare the requantized Y8 (shift, round, relu, saturation).
+ *  - Cover a partial token tile (M not a multiple of P), two layers resident at
+ *    once (W_BASE) and reading Y one by one and Y8 four by four.
+ *  - P (PE array size) is a parameter: make gemm GEMM_PE=8.
+ */
+
+module tb_gemm;
+  parameter int P = 4;
+
+  localparam int CLK_PERIOD_NS = 10;
+  localparam int M_MAX  = 16;
+  localparam int N_MAX  = 64;
+  localparam int K_MAX  = 64;
+  localparam int W_ROWS = 256;
+
+  logic clk = 1'b0;
+  logic reset = 1'b1;
+
+  logic        x_wr_en;
+  logic [31:0] x_wr_data;
+  logic        w_wr_en;
+  logic [31:0] w_wr_data;
+  logic        b_wr_en;
+  logic [31:0] b_wr_data;
+  logic [7:0]  m_dim;
+  logic [7:0]  n_dim;
+  logic [7:0]  k_dim;
+  logic [7:0]  w_base;
+  logic        start;
+  logic        clear;
+  logic        w_rewind;
+  logic        bias_en;
+  logic [5:0]  rq_shift;
+  logic        rq_round;
+  logic        rq_relu;
+  wire         busy;
+  wire         done;
+  logic        y_rd_en;
+  logic        y_rd4_en;
+  wire  [31:0] y_rd_data;
+  wire  [31:0] y8_rd_data;
+
+  gemm_core #(
+    .P(P),
+    .M_MAX(M_MAX),
+    .N_MAX(N_MAX),
+    .K_MAX(K_MAX),
+    .W_ROWS(W_ROWS)
+  ) dut (
+    .clk(clk),
+    .reset(reset),
+    .x_wr_en(x_wr_en),
+    .x_wr_data(x_wr_data),
+    .w_wr_en(w_wr_en),
+    .w_wr_data(w_wr_data),
+    .b_wr_en(b_wr_en),
+    .b_wr_data(b_wr_data),
+    .m_dim(m_dim),
+    .n_dim(n_dim),
+    .k_dim(k_dim),
+    .w_base(w_base),
+    .start(start),
+    .clear(clear),
+    .w_rewind(w_rewind),
+    .bias_en(bias_en),
+    .rq_shift(rq_shift),
+    .rq_round(rq_round),
+    .rq_relu(rq_relu),
+    .busy(busy),
+    .done(done),
+    .y_rd_en(y_rd_en),
+    .y_rd4_en(y_rd4_en),
+    .y_rd_data(y_rd_data),
+    .y8_rd_data(y8_rd_data)
+  );
+
+  always #(CLK_PERIOD_NS/2) clk = ~clk;
+
+  // Operands of the layer under test (w[layer][n][k]) and the golden results.
+  byte x   [0:M_MAX-1][0:K_MAX-1];
+  byte w   [0:1][0:N_MAX-1][0:K_MAX-1];
+  int  b   [0:1][0:N_MAX-1];
+  int  gold_y  [0:M_MAX-1][0:N_MAX-1];
+  byte gold_y8 [0:M_MAX-1][0:N_MAX-1];
+
+  task automatic cycle();
+    @(posedge clk);
+  endtask
+
+  task automatic reset_dut();
+    x_wr_en   = 1'b0;
+    x_wr_data = '0;
+    w_wr_en   = 1'b0;
+    w_wr_data = '0;
+    b_wr_en   = 1'b0;
+    b_wr_data = '0;
+    m_dim     = 8'd1;
+    n_dim     = P;
+    k_dim     = 8'd4;
+    w_base    = 8'd0;
+    start     = 1'b0;
+    clear     = 1'b0;
+    w_rewind  = 1'b0;
+    bias_en   = 1'b0;
+    rq_shift  = 6'd7;
+    rq_round  = 1'b0;
+    rq_relu   = 1'b0;
+    y_rd_en   = 1'b0;
+    y_rd4_en  = 1'b0;
+    reset = 1'b1;
+    repeat (5) cycle();
+    reset = 1'b0;
+    repeat (2) cycle();
+  endtask
+
+  function automatic byte requant(input int y, input int sh, input bit rnd, input bit relu);
+    longint p;
+    p = y;
+    if (rnd && sh != 0) p += longint'(1) << (sh - 1);
+    p = p >>> sh;
+    if (relu && p < 0) p = 0;
+    if (p > 127) return 8'sd127;
+    if (p < -128) return -8'sd128;
+    return byte'(p);
+  endfunction
+
+  // Golden: Y[i][j] = sum_c X[i][c] * W[j][c] (+ b[j]), then the requant stage.
+  task automatic compute_golden(input int layer, input int m, input int n, input int k, input bit bias);
+    for (int i = 0; i < m; i++) begin
+      for (int j = 0; j < n; j++) begin
+        int acc;
+        acc = bias ? b[layer][j] : 0;
+        for (int c = 0; c < k; c++) acc += int'(x[i][c]) * int'(w[layer][j][c]);
+        gold_y[i][j]  = acc;
+        gold_y8[i][j] = requant(acc, rq_shift, rq_round, rq_relu);
+      end
+    end
+  endtask
+
+  task automatic fill_layer(input int layer, input int n, input int k);
+    for (int j = 0; j < n; j++) begin
+      for (int c = 0; c < k; c++) w[layer][j][c] = byte'($urandom);
+      b[layer][j] = $urandom_range(200000) - 100000;
+    end
+  endtask
+
+  task automatic fill_x(input int m, input int k);
+    for (int i = 0; i < m; i++)
+      for (int c = 0; c < k; c++) x[i][c] = byte'($urandom);
+  endtask
+
+  // W rows [row, row + n) and their bias through W_IN4 / B_IN.
+  task automatic load_w(input int layer, input int row, input int n, input int k);
+    w_base = row[7:0];
+    n_dim  = n[7:0];
+    k_dim  = k[7:0];
+    w_rewind = 1'b1;
+    cycle();
+    w_rewind = 1'b0;
+    for (int j = 0; j < n; j++) begin
+      for (int c = 0; c < k; c += 4) begin
+        w_wr_en   = 1'b1;
+        w_wr_data = {w[layer][j][c + 3], w[layer][j][c + 2], w[layer][j][c + 1], w[layer][j][c]};
+        cycle();
+      end
+    end
+    w_wr_en = 1'b0;
+    for (int j = 0; j < n; j++) begin
+      b_wr_en   = 1'b1;
+      b_wr_data = b[layer][j];
+      cycle();
+    end
+    b_wr_en = 1'b0;
+  endtask
+
+  // One run: X through X_IN4, start, wait for done.
+  task automatic run(input int row, input int m, input int n, input int k, input bit bias);
+    int cycles;
+    m_dim   = m[7:0];
+    n_dim   = n[7:0];
+    k_dim   = k[7:0];
+    w_base  = row[7:0];
+    bias_en = bias;
+    clear = 1'b1;
+    cycle();
+    clear = 1'b0;
+    for (int i = 0; i < m; i++) begin
+      for (int c = 0; c < k; c += 4) begin
+        x_wr_en   = 1'b1;
+        x_wr_data = {x[i][c + 3], x[i][c + 2], x[i][c + 1], x[i][c]};
+        cycle();
+      end
+    end
+    x_wr_en = 1'b0;
+    start = 1'b1;
+    cycle();
+    start = 1'b0;
+    cycles = 0;
+    while (!done) begin
+      cycle();
+      cycles++;
+      if (cycles > 100000) begin
+        $display("TB_GEMM: FAIL timeout m=%0d n=%0d k=%0d", m, n, k);
+        $fatal(1);
+      end
+    end
+    #1;
+  endtask
+
+  task automatic check_y(input string what, input int m, input int n, input int k);
+    for (int i = 0; i < m; i++) begin
+      for (int j = 0; j < n; j++) begin
+        if ($signed(y_rd_data) !== gold_y[i][j]) begin
+          $display("TB_GEMM: FAIL %s P=%0d m=%0d n=%0d k=%0d i=%0d j=%0d dut=%0d gold=%0d",
+                   what, P, m, n, k, i, j, $signed(y_rd_data), gold_y[i][j]);
+          $fatal(1);
+        end
+        y_rd_en = 1'b1;
+        cycle();
+        y_rd_en = 1'b0;
+        #1;
+      end
+    end
+  endtask
+
+  task automatic check_y8(input string what, input int m, input int n, input int k);
+    for (int i = 0; i < m; i++) begin
+      for (int j = 0; j < n; j += 4) begin
+        for (int l = 0; l < 4; l++) begin
+          if ($signed(y8_rd_data[8*l +: 8]) !== gold_y8[i][j + l]) begin
+            $display("TB_GEMM: FAIL %s P=%0d m=%0d n=%0d k=%0d i=%0d j=%0d dut=%0d gold=%0d",
+                     what, P, m, n, k, i, j + l, $signed(y8_rd_data[8*l +: 8]), gold_y8[i][j + l]);
+            $fatal(1);
+          end
+        end
+        y_rd4_en = 1'b1;
+        cycle();
+        y_rd4_en = 1'b0;
+        #1;
+      end
+    end
+  endtask
+
+  task automatic test_one(input int m, input int n, input int k, input int row);
+    fill_layer(0, n, k);
+    fill_x(m, k);
+    load_w(0, row, n, k);
+
+    run(row, m, n, k, 1'b1);
+    compute_golden(0, m, n, k, 1'b1);
+    check_y("bias", m, n, k);
+
+    run(row, m, n, k, 1'b0);
+    compute_golden(0, m, n, k, 1'b0);
+    check_y("nobias", m, n, k);
+  endtask
+
+  task automatic test_requant(input int m, input int n, input int k, input int sh, input bit rnd, input bit relu);
+    rq_shift = sh[5:0];
+    rq_round = rnd;
+    rq_relu  = relu;
+    fill_layer(0, n, k);
+    fill_x(m, k);
+    load_w(0, 0, n, k);
+    run(0, m, n, k, 1'b1);
+    compute_golden(0, m, n, k, 1'b1);
+    check_y8("y8", m, n, k);
+    rq_shift = 6'd7;
+    rq_round = 1'b0;
+    rq_relu  = 1'b0;
+  endtask
+
+  // Two layers resident at once: loading the second must not touch the first.
+  task automatic test_resident(input int m, input int n, input int k);
+    fill_layer(1, n, k);
+    load_w(1, W_ROWS - n, n, k);
+    fill_layer(0, n, k);
+    load_w(0, 0, n, k);
+    fill_x(m, k);
+
+    run(W_ROWS - n, m, n, k, 1'b1);
+    compute_golden(1, m, n, k, 1'b1);
+    check_y("resident1", m, n, k);
+
+    run(0, m, n, k, 1'b1);
+    compute_golden(0, m, n, k, 1'b1);
+    check_y("resident0", m, n, k);
+  endtask
+
+  initial begin
+    $dumpfile("tb_gemm.vcd");
+    $dumpvars(0, tb_gemm);
+
+    reset_dut();
+
+    test_one(16, 32, 32, 0);          // Q/K/V/O projection, S=16
+    test_one(16, 64, 32, P);          // FF1 shape at an offset row
+    test_one(16, 32, 64, 0);          // FF2 shape
+    test_one(5, 8, 4, 0);             // partial token tile, minimal K
+    test_one(1, N_MAX, K_MAX, 0);
+    test_one(M_MAX, P, 12, 0);
+    for (int r = 0; r < 8; r++)
+      test_one($urandom_range(M_MAX - 1) + 1, P * ($urandom_range(N_MAX / P - 1) + 1),
+               4 * ($urandom_range(K_MAX / 4 - 1) + 1), 0);
+    test_resident(16, 32, 32);
+    test_requant(16, 32, 32, 7, 1'b0, 1'b0);
+    test_requant(11, 64, 64, 12, 1'b1, 1'b1);
+    test_requant(16, 16, 32, 0, 1'b0, 1'b0);    // saturation
+
+    $display("TB_GEMM: ALL TESTS PASS (P=%0d)", P);
+    $finish;
+  end
+
+endmodule
@@ -6,21 +6,41 @@
  * DUT (in this repo): hw_extensions/gemv/rtl/gemv_core.v : module gemv_core
  *
  * Computes: Y = W*X + b (optional), with signed int8 W/X and signed int32 b/Y.
- * Dimensions are configured by len_64/out_dim_64: {32,64} each.
+ * Dimensions are configured by len_64/out_dim_64: {32,64} each (out_dim_16: 16 rows).
  *
- * This TB uses LEN=32 and OUT_DIM=32 (len_64=0, out_dim_64=0) and tests:
+ * This TB uses LEN=32 and OUT_DIM=32 (len_64=0, out_dim_64=0) unless noted and tests:
  *  - 1 deterministic test
  *  - 1 randomized test (fixed seed)
  *  - 1 boundary/extremes test (min/max int8)
+ *  - 1 packed-write test (X/W loaded 4 lanes per write)
+ *  - 1 weight-stationary test (W/b loaded once, several X runs via clear_x)
+ *  - 1 double-buffer test (X of the next run loaded into the other bank while busy,
+ *    back-to-back start from DONE, both Y banks read back)
+ *  - 1 requant test (int8 Y through shift/round/ReLU and the multiplier, read
+ *    4 lanes per y8_rd_data access)
+ *  - 1 LEN=64, OUT_DIM=64 test (split rows when ROWS > 1)
+ *  - 1 memory-window test (three W regions selected by w_base, loaded through
+ *    the window and the streams, X written to a bank by address, one row
+ *    rewritten with byte enables)
+ *  - 1 attention test (OUT_DIM=16 scores against a resident K, a 16-bit X
+ *    context run against V^T at a second W region, then a second query on K)
+ *  - 1 W-bank test (W_BANKS=2: the next W/b prefetched into the other bank
+ *    while a run computes, then runs alternating between the two banks)
+ *
+ * LANES, ROWS and PIPELINE are passed to the DUT (make gemv GEMV_LANES=8
+ * GEMV_ROWS=4 GEMV_PIPELINE=1, or make gemv-lanes / gemv-pipe); the
+ * deterministic and 64x64 tests also check the run length against
+ * expected_cycles().
  *
  * Note: If your top-level GEMV module is named `gemv` or `gemv16` with different ports,
  * add a small adapter wrapper and map to the gemv_core-style signals. (TODO in that case.)
  */
 
-module tb_gemv;
+module tb_gemv #(parameter int LANES = 1, parameter int ROWS = 1, parameter int PIPELINE = 0);
   localparam int CLK_PERIOD_NS = 10;
-  localparam int LEN           = 32;
-  localparam int OUT_DIM       = 32;
+  localparam int MAX_DIM       = 64;
+  int LEN                      = 32; // Current run shape (len_64/out_dim_64)
+  int OUT_DIM                  = 32;
   localparam int ACTIVE_N      = 16; // We load only first 16 cols with data; remaining are 0.
   localparam int ACTIVE_M      = 4;  // We check first 4 rows; remaining rows are 0.
 
@@ -33,40 +53,103 @@ module tb_gemv;
   logic [7:0]  x_wr_data;
   logic        w_wr_en;
   logic [7:0]  w_wr_data;
+  logic        x_wr4_en;
+  logic [31:0] x_wr4_data;
+  logic        w_wr4_en;
+  logic [31:0] w_wr4_data;
   logic        b_wr_en;
   logic [31:0] b_wr_data;
+  logic        w_mem_we;
+  logic [9:0]  w_mem_adr;
+  logic [3:0]  w_mem_sel;
+  logic [31:0] w_mem_dat;
+  logic        x_mem_we;
+  logic [4:0]  x_mem_adr;
+  logic [3:0]  x_mem_sel;
+  logic [31:0] x_mem_dat;
+  logic [11:0] w_base;
 
   logic start;
   logic len_64;
   logic out_dim_64;
+  logic out_dim_16;
+  logic x_u16;
   logic bias_en;
   logic clear_done;
+  logic clear_x;
+  logic bank;
+  logic rewind;
+  logic w_bank;
+  logic pf_rewind;
+  logic        w_pf4_en;
+  logic [31:0] w_pf4_data;
+  logic        b_pf_en;
+  logic [31:0] b_pf_data;
 
   logic busy;
   logic done;
 
   logic        y_rd_en;
   wire [31:0]  y_rd_data;
+  logic        y_rd4_en;
+  wire [31:0]  y8_rd_data;
+
+  logic [5:0]  rq_shift;
+  logic        rq_round;
+  logic        rq_relu;
+  logic        rq_mul_en;
+  logic [15:0] rq_mul;
 
   // Instantiate DUT
-  gemv_core dut (
+  gemv_core #(.LANES(LANES), .ROWS(ROWS), .X16(1), .W_BANKS(2), .PIPELINE(PIPELINE)) dut (
     .clk(clk),
     .reset(reset),
     .x_wr_en(x_wr_en),
     .x_wr_data(x_wr_data),
     .w_wr_en(w_wr_en),
     .w_wr_data(w_wr_data),
+    .x_wr4_en(x_wr4_en),
+    .x_wr4_data(x_wr4_data),
+    .w_wr4_en(w_wr4_en),
+    .w_wr4_data(w_wr4_data),
     .b_wr_en(b_wr_en),
     .b_wr_data(b_wr_data),
+    .w_mem_we(w_mem_we),
+    .w_mem_adr(w_mem_adr),
+    .w_mem_sel(w_mem_sel),
+    .w_mem_dat(w_mem_dat),
+    .x_mem_we(x_mem_we),
+    .x_mem_adr(x_mem_adr),
+    .x_mem_sel(x_mem_sel),
+    .x_mem_dat(x_mem_dat),
+    .w_base(w_base),
+    .w_pf4_en(w_pf4_en),
+    .w_pf4_data(w_pf4_data),
+    .b_pf_en(b_pf_en),
+    .b_pf_data(b_pf_data),
     .start(start),
     .len_64(len_64),
     .out_dim_64(out_dim_64),
+    .out_dim_16(out_dim_16),
+    .x_u16(x_u16),
     .bias_en(bias_en),
+    .bank(bank),
+    .w_bank(w_bank),
+    .rq_shift(rq_shift),
+    .rq_round(rq_round),
+    .rq_relu(rq_relu),
+    .rq_mul_en(rq_mul_en),
+    .rq_mul(rq_mul),
     .busy(busy),
     .done(done),
     .clear_done(clear_done),
+    .clear_x(clear_x),
+    .rewind(rewind),
+    .pf_rewind(pf_rewind),
     .y_rd_en(y_rd_en),
-    .y_rd_data(y_rd_data)
+    .y_rd_data(y_rd_data),
+    .y_rd4_en(y_rd4_en),
+    .y8_rd_data(y8_rd_data)
   );
 
   // Clock generation
@@ -78,10 +161,11 @@ module tb_gemv;
   typedef byte signed i8_t;
   typedef int  signed i32_t;
 
-  i8_t x_ref   [0:LEN-1];
-  i8_t w_ref   [0:OUT_DIM-1][0:LEN-1];
-  i32_t b_ref  [0:OUT_DIM-1];
-  i32_t y_gold [0:OUT_DIM-1];
+  i8_t x_ref   [0:MAX_DIM-1];
+  i8_t w_ref   [0:MAX_DIM-1][0:MAX_DIM-1];
+  i32_t b_ref  [0:MAX_DIM-1];
+  i32_t y_gold [0:MAX_DIM-1];
+  i8_t  y8_gold[0:MAX_DIM-1];
 
   task automatic cycle();
     @(posedge clk);
@@ -92,14 +176,44 @@ module tb_gemv;
     x_wr_data   = '0;
     w_wr_en     = 1'b0;
     w_wr_data   = '0;
+    x_wr4_en    = 1'b0;
+    x_wr4_data  = '0;
+    w_wr4_en    = 1'b0;
+    w_wr4_data  = '0;
     b_wr_en     = 1'b0;
     b_wr_data   = '0;
+    w_mem_we    = 1'b0;
+    w_mem_adr   = '0;
+    w_mem_sel   = '0;
+    w_mem_dat   = '0;
+    x_mem_we    = 1'b0;
+    x_mem_adr   = '0;
+    x_mem_sel   = '0;
+    x_mem_dat   = '0;
+    w_base      = '0;
     start       = 1'b0;
     len_64      = 1'b0;
     out_dim_64  = 1'b0;
+    out_dim_16  = 1'b0;
+    x_u16       = 1'b0;
     bias_en     = 1'b0;
     clear_done  = 1'b0;
+    clear_x     = 1'b0;
+    bank        = 1'b0;
+    rewind      = 1'b0;
+    w_bank      = 1'b0;
+    pf_rewind   = 1'b0;
+    w_pf4_en    = 1'b0;
+    w_pf4_data  = '0;
+    b_pf_en     = 1'b0;
+    b_pf_data   = '0;
     y_rd_en     = 1'b0;
+    y_rd4_en    = 1'b0;
+    rq_shift    = 6'd7;
+    rq_round    = 1'b0;
+    rq_relu     = 1'b0;
+    rq_mul_en   = 1'b0;
+    rq_mul      = '0;
 
     reset = 1'b1;
     repeat (5) cycle();
@@ -114,6 +228,27 @@ module tb_gemv;
     cycle();
   endtask
 
+  task automatic pulse_clear_x();
+    clear_x = 1'b1;
+    cycle();
+    clear_x = 1'b0;
+    cycle();
+  endtask
+
+  task automatic pulse_rewind();
+    rewind = 1'b1;
+    cycle();
+    rewind = 1'b0;
+    cycle();
+  endtask
+
+  task automatic pulse_pf_rewind();
+    pf_rewind = 1'b1;
+    cycle();
+    pf_rewind = 1'b0;
+    cycle();
+  endtask
+
   task automatic pulse_start();
     start = 1'b1;
     cycle();
@@ -144,6 +279,49 @@ module tb_gemv;
     end
   endtask
 
+  task automatic load_x_packed();
+    // 4 lanes per write, lane 0 in bits [7:0] (dot8_pack order).
+    for (int c = 0; c < LEN; c += 4) begin
+      x_wr4_data = {x_ref[c+3], x_ref[c+2], x_ref[c+1], x_ref[c]};
+      x_wr4_en   = 1'b1;
+      cycle();
+      x_wr4_en   = 1'b0;
+      cycle();
+    end
+  endtask
+
+  task automatic load_w_packed();
+    for (int r = 0; r < OUT_DIM; r++) begin
+      for (int c = 0; c < LEN; c += 4) begin
+        w_wr4_data = {w_ref[r][c+3], w_ref[r][c+2], w_ref[r][c+1], w_ref[r][c]};
+        w_wr4_en   = 1'b1;
+        cycle();
+        w_wr4_en   = 1'b0;
+        cycle();
+      end
+    end
+  endtask
+
+  task automatic load_pf();
+    // w_ref and b_ref through the prefetch ports (the bank w_bank does not select).
+    for (int r = 0; r < OUT_DIM; r++) begin
+      for (int c = 0; c < LEN; c += 4) begin
+        w_pf4_data = {w_ref[r][c+3], w_ref[r][c+2], w_ref[r][c+1], w_ref[r][c]};
+        w_pf4_en   = 1'b1;
+        cycle();
+        w_pf4_en   = 1'b0;
+        cycle();
+      end
+    end
+    for (int r = 0; r < OUT_DIM; r++) begin
+      b_pf_data = b_ref[r];
+      b_pf_en   = 1'b1;
+      cycle();
+      b_pf_en   = 1'b0;
+      cycle();
+    end
+  endtask
+
   task automatic load_b();
     // Assumes clear_done was pulsed so b write index is 0. OUT_DIM entries.
     for (int r = 0; r < OUT_DIM; r++) begin
@@ -155,6 +333,33 @@ module tb_gemv;
     end
   endtask
 
+  task automatic win_write_w(input int byte_off, input logic [31:0] dat, input logic [3:0] sel);
+    w_mem_adr = byte_off >> 2;
+    w_mem_dat = dat;
+    w_mem_sel = sel;
+    w_mem_we  = 1'b1;
+    cycle();
+    w_mem_we  = 1'b0;
+  endtask
+
+  task automatic win_load_w(input int base);
+    // w_ref row-major at byte offset base of the W space, one word per write.
+    for (int r = 0; r < OUT_DIM; r++)
+      for (int c = 0; c < LEN; c += 4)
+        win_write_w(base + r*LEN + c, {w_ref[r][c+3], w_ref[r][c+2], w_ref[r][c+1], w_ref[r][c]}, 4'hF);
+  endtask
+
+  task automatic win_load_x(input logic b);
+    for (int c = 0; c < LEN; c += 4) begin
+      x_mem_adr = {b, 4'(c >> 2)};
+      x_mem_dat = {x_ref[c+3], x_ref[c+2], x_ref[c+1], x_ref[c]};
+      x_mem_sel = 4'hF;
+      x_mem_we  = 1'b1;
+      cycle();
+      x_mem_we  = 1'b0;
+    end
+  endtask
+
   task automatic compute_golden();
     for (int r = 0; r < OUT_DIM; r++) begin
       i32_t acc = (bias_en) ? b_ref[r] : 0;
@@ -165,6 +370,24 @@ module tb_gemv;
     end
   endtask
 
+  int last_run_cycles;
+
+  // Compute cycles of the current shape: rows of LEN/LANES+1 cycles for ROWS=1,
+  // groups of 32 columns (32/LANES+1 cycles) over ROWS W banks otherwise
+  // (at least one group when OUT_DIM=16 has fewer rows than a group).
+  // PIPELINE=1 issues the groups back to back and drains 5 stages once.
+  function automatic int expected_cycles();
+    int groups;
+    if (PIPELINE != 0) begin
+      if (ROWS == 1) return OUT_DIM*LEN/LANES + 5;
+      groups = OUT_DIM*LEN/(32*ROWS);
+      return ((groups > 0) ? groups : 1)*(32/LANES) + 5;
+    end
+    if (ROWS == 1) return OUT_DIM*(LEN/LANES+1);
+    groups = OUT_DIM*LEN/(32*ROWS);
+    return ((groups > 0) ? groups : 1)*(32/LANES+1);
+  endfunction
+
   task automatic wait_done_with_timeout(input int max_cycles);
     int cyc = 0;
     // The core sets busy when start is accepted; done becomes 1 in DONE state.
@@ -176,6 +399,7 @@ module tb_gemv;
         $fatal(1);
       end
     end
+    last_run_cycles = cyc;
   endtask
 
   task automatic read_and_check_y(input string name);
@@ -198,6 +422,37 @@ module tb_gemv;
     end
   endtask
 
+  task automatic compute_golden8();
+    // Requant of y_gold with the current rq_* settings.
+    for (int r = 0; r < OUT_DIM; r++) begin
+      longint v = rq_mul_en ? longint'(y_gold[r]) * longint'($signed(rq_mul)) : longint'(y_gold[r]);
+      if (rq_round && rq_shift != 0) v += longint'(1) << (rq_shift - 1);
+      v = v >>> rq_shift;
+      if (rq_relu && v < 0) v = 0;
+      y8_gold[r] = (v > 127) ? 8'sd127 : (v < -128) ? -8'sd128 : i8_t'(v);
+    end
+  endtask
+
+  task automatic read_and_check_y8(input string name);
+    // Four int8 rows per read (lane 0 = bits 7:0); y_rd4_en advances by four.
+    i8_t y_dut;
+    for (int r = 0; r < OUT_DIM; r += 4) begin
+      #1;
+      for (int k = 0; k < 4; k++) begin
+        y_dut = i8_t'(y8_rd_data[8*k +: 8]);
+        if (y_dut !== y8_gold[r+k]) begin
+          $display("TB_GEMV: FAIL (%s) row=%0d  dut=%0d  gold=%0d (acc=%0d)",
+                   name, r+k, y_dut, y8_gold[r+k], y_gold[r+k]);
+          $fatal(1);
+        end
+      end
+      y_rd4_en = 1'b1;
+      cycle();
+      y_rd4_en = 1'b0;
+      cycle();
+    end
+  endtask
+
   task automatic init_zero_all();
     for (int c = 0; c < LEN; c++) x_ref[c] = 0;
     for (int r = 0; r < OUT_DIM; r++) begin
@@ -233,8 +488,13 @@ module tb_gemv;
     compute_golden();
 
     pulse_start();
-    // Expected compute cycles: OUT_DIM*(LEN+1) ~= 32*33=1056, plus a few overhead cycles.
+    // Expected compute cycles: expected_cycles(), 32*33=1056 for LANES=ROWS=1, plus a few overhead cycles.
     wait_done_with_timeout(5000);
+    if (last_run_cycles > expected_cycles() + 4) begin
+      $display("TB_GEMV: FAIL deterministic: %0d cycles for LANES=%0d ROWS=%0d, expected <= %0d",
+               last_run_cycles, LANES, ROWS, expected_cycles() + 4);
+      $fatal(1);
+    end
 
     // done should stay asserted until clear_done
     if (done !== 1'b1) begin
@@ -246,7 +506,8 @@ module tb_gemv;
     pulse_clear_done();
     read_and_check_y("deterministic");
 
-    $display("TB_GEMV: PASS deterministic");
+    $display("TB_GEMV: PASS deterministic (LANES=%0d ROWS=%0d PIPELINE=%0d, %0d cycles)",
+             LANES, ROWS, PIPELINE, last_run_cycles);
   endtask
 
   task automatic run_randomized();
@@ -326,6 +587,527 @@ module tb_gemv;
     $display("TB_GEMV: PASS boundary/extremes");
   endtask
 
+  task automatic run_packed_writes();
+    int unsigned seed;
+    int unsigned r;
+    init_zero_all();
+    seed = 32'hA5A50002;
+
+    // Fill every column so all four lanes of each packed word carry data.
+    for (int c = 0; c < LEN; c++) begin
+      r = $urandom(seed);
+      x_ref[c] = i8_t'(r[7:0]);
+    end
+    for (int r_i = 0; r_i < ACTIVE_M; r_i++) begin
+      for (int c = 0; c < LEN; c++) begin
+        r = $urandom(seed);
+        w_ref[r_i][c] = i8_t'(r[7:0]);
+      end
+    end
+
+    bias_en    = 1'b0;
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+
+    pulse_clear_done();
+    load_x_packed();
+    load_w_packed();
+    compute_golden();
+
+    pulse_start();
+    wait_done_with_timeout(5000);
+
+    pulse_clear_done();
+    read_and_check_y("packed");
+
+    $display("TB_GEMV: PASS packed writes");
+  endtask
+
+  task automatic run_weight_stationary();
+    int unsigned seed;
+    int unsigned r;
+    init_zero_all();
+    seed = 32'h5EED0003;
+
+    for (int r_i = 0; r_i < ACTIVE_M; r_i++) begin
+      b_ref[r_i] = i32_t'(r_i * 1000 - 1500);
+      for (int c = 0; c < ACTIVE_N; c++) begin
+        r = $urandom(seed);
+        w_ref[r_i][c] = i8_t'(r[7:0]);
+      end
+    end
+
+    bias_en    = 1'b1;
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+
+    // Load W and b once ...
+    pulse_clear_done();
+    load_w();
+    load_b();
+
+    // ... then run several X vectors against them, restarting with clear_x only.
+    for (int run = 0; run < 3; run++) begin
+      for (int c = 0; c < ACTIVE_N; c++) begin
+        r = $urandom(seed);
+        x_ref[c] = i8_t'(r[7:0]);
+      end
+      pulse_clear_x();
+      load_x();
+      compute_golden();
+
+      pulse_start();
+      wait_done_with_timeout(5000);
+
+      pulse_clear_x();
+      read_and_check_y($sformatf("weight-stationary run %0d", run));
+    end
+
+    $display("TB_GEMV: PASS weight-stationary (3 X runs, 1 W load)");
+  endtask
+
+  task automatic run_double_buffer();
+    int unsigned seed;
+    int unsigned r;
+    i8_t  x_b   [0:MAX_DIM-1];
+    i32_t y_a   [0:MAX_DIM-1];
+    init_zero_all();
+    seed = 32'hDB0000A4;
+
+    for (int r_i = 0; r_i < ACTIVE_M; r_i++) begin
+      for (int c = 0; c < ACTIVE_N; c++) begin
+        r = $urandom(seed);
+        w_ref[r_i][c] = i8_t'(r[7:0]);
+      end
+    end
+    for (int c = 0; c < LEN; c++) x_b[c] = 0;
+    for (int c = 0; c < ACTIVE_N; c++) begin
+      r = $urandom(seed);
+      x_b[c] = i8_t'(r[7:0]);
+    end
+
+    bias_en    = 1'b0;
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+
+    pulse_clear_done();
+    load_w();
+
+    // Run A in bank 0.
+    for (int c = 0; c < ACTIVE_N; c++) begin
+      r = $urandom(seed);
+      x_ref[c] = i8_t'(r[7:0]);
+    end
+    bank = 1'b0;
+    pulse_rewind();
+    load_x();
+    compute_golden();
+    for (int i = 0; i < OUT_DIM; i++) y_a[i] = y_gold[i];
+    pulse_start();
+
+    // While A computes: bank 1 takes X of run B.
+    bank = 1'b1;
+    pulse_rewind();
+    // Wide LANES x ROWS configurations may finish within the rewind pulse.
+    if (busy !== 1'b1 && expected_cycles() > 4) begin
+      $display("TB_GEMV: FAIL double-buffer: run A finished before X(B) load");
+      $fatal(1);
+    end
+    for (int c = 0; c < LEN; c++) x_ref[c] = x_b[c];
+    load_x();
+    wait_done_with_timeout(5000);
+
+    // Back-to-back start from DONE, computing in bank 1.
+    pulse_start();
+
+    // Meanwhile read Y(A) from bank 0.
+    for (int i = 0; i < OUT_DIM; i++) y_gold[i] = y_a[i];
+    bank = 1'b0;
+    pulse_rewind();
+    read_and_check_y("double-buffer A (bank 0)");
+
+    wait_done_with_timeout(5000);
+    compute_golden();   // x_ref holds X(B)
+    bank = 1'b1;
+    pulse_rewind();
+    read_and_check_y("double-buffer B (bank 1)");
+    bank = 1'b0;
+
+    $display("TB_GEMV: PASS double-buffer banks");
+  endtask
+
+  task automatic run_requant();
+    int unsigned seed;
+    int unsigned r;
+    init_zero_all();
+    seed = 32'h8EC40018;
+
+    // Every row and column active so the int8 outputs span both saturation ends.
+    for (int c = 0; c < LEN; c++) begin
+      r = $urandom(seed);
+      x_ref[c] = i8_t'(r[7:0]);
+    end
+    for (int r_i = 0; r_i < OUT_DIM; r_i++) begin
+      r = $urandom(seed);
+      b_ref[r_i] = i32_t'($signed(r[15:0]));
+      for (int c = 0; c < LEN; c++) begin
+        r = $urandom(seed);
+        w_ref[r_i][c] = i8_t'(r[7:0]);
+      end
+    end
+
+    bias_en    = 1'b1;
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+
+    pulse_clear_done();
+    load_w();
+    load_b();
+    load_x();
+    compute_golden();
+
+    // Pass 1: floor shift by 7 with ReLU (the encoder's FFN1 requant).
+    rq_shift  = 6'd7;
+    rq_round  = 1'b0;
+    rq_relu   = 1'b1;
+    rq_mul_en = 1'b0;
+    compute_golden8();
+    pulse_start();
+    wait_done_with_timeout(5000);
+    pulse_clear_x();
+    read_and_check_y8("requant shift/relu");
+    // int32 Y of the same run is unaffected by the requant stage.
+    pulse_clear_x();
+    read_and_check_y("requant int32");
+
+    // Pass 2: rounding multiply-shift with a negative multiplier.
+    rq_shift  = 6'd12;
+    rq_round  = 1'b1;
+    rq_relu   = 1'b0;
+    rq_mul_en = 1'b1;
+    rq_mul    = 16'hA5C3;
+    compute_golden8();
+    pulse_clear_x();
+    load_x();
+    pulse_start();
+    wait_done_with_timeout(5000);
+    pulse_clear_x();
+    read_and_check_y8("requant mul/round");
+
+    rq_shift  = 6'd7;
+    rq_round  = 1'b0;
+    rq_mul_en = 1'b0;
+    rq_mul    = '0;
+
+    $display("TB_GEMV: PASS requant (int8 Y, 4 per read)");
+  endtask
+
+  task automatic run_len64();
+    int unsigned seed;
+    int unsigned r;
+    seed = 32'h64640040;
+    LEN     = 64;
+    OUT_DIM = 64;
+
+    for (int c = 0; c < LEN; c++) begin
+      r = $urandom(seed);
+      x_ref[c] = i8_t'(r[7:0]);
+    end
+    for (int r_i = 0; r_i < OUT_DIM; r_i++) begin
+      r = $urandom(seed);
+      b_ref[r_i] = i32_t'($signed(r[15:0]));
+      for (int c = 0; c < LEN; c++) begin
+        r = $urandom(seed);
+        w_ref[r_i][c] = i8_t'(r[7:0]);
+      end
+    end
+
+    bias_en    = 1'b1;
+    // W is written before len_64 is set, as the driver does: the core's W
+    // layout must not depend on it.
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+
+    pulse_clear_done();
+    load_w_packed();
+    load_b();
+    load_x();
+    compute_golden();
+    compute_golden8();
+
+    len_64     = 1'b1;
+    out_dim_64 = 1'b1;
+    pulse_start();
+    wait_done_with_timeout(10000);
+    if (last_run_cycles > expected_cycles() + 4) begin
+      $display("TB_GEMV: FAIL 64x64: %0d cycles for LANES=%0d ROWS=%0d, expected <= %0d",
+               last_run_cycles, LANES, ROWS, expected_cycles() + 4);
+      $fatal(1);
+    end
+    pulse_clear_x();
+    read_and_check_y("64x64");
+    pulse_clear_x();
+    read_and_check_y8("64x64 int8");
+
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+    LEN        = 32;
+    OUT_DIM    = 32;
+
+    $display("TB_GEMV: PASS 64x64 (%0d cycles)", last_run_cycles);
+  endtask
+
+  task automatic run_mem_window();
+    int unsigned seed;
+    int unsigned r;
+    i8_t w_reg [0:2][0:MAX_DIM-1][0:MAX_DIM-1];
+    int  base  [0:2];
+    seed = 32'h3E3A0069;
+    base[0] = 0;      // window
+    base[1] = 1024;   // W_IN4 stream from w_base
+    base[2] = 2048;   // window
+    bias_en    = 1'b0;
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+
+    for (int m = 0; m < 3; m++)
+      for (int r_i = 0; r_i < OUT_DIM; r_i++)
+        for (int c = 0; c < LEN; c++) begin
+          r = $urandom(seed);
+          w_reg[m][r_i][c] = i8_t'(r[7:0]);
+        end
+    for (int c = 0; c < LEN; c++) begin
+      r = $urandom(seed);
+      x_ref[c] = i8_t'(r[7:0]);
+    end
+
+    pulse_clear_done();
+    for (int m = 0; m < 3; m++) begin
+      for (int r_i = 0; r_i < OUT_DIM; r_i++)
+        for (int c = 0; c < LEN; c++) w_ref[r_i][c] = w_reg[m][r_i][c];
+      if (m == 1) begin
+        w_base = base[m];
+        pulse_clear_done();
+        load_w_packed();
+      end else begin
+        win_load_w(base[m]);
+      end
+    end
+    bank = 1'b0;
+    win_load_x(1'b0);
+
+    // Every region computes against the same X; runs start back to back from DONE.
+    for (int pass = 0; pass < 2; pass++) begin
+      if (pass == 1) begin
+        // Rewrite bytes 0 and 2 of row 3, word 0 of region 2 only.
+        win_write_w(base[2] + 3*LEN, 32'h00_81_00_7F, 4'b0101);
+        w_reg[2][3][0] = 8'sh7F;
+        w_reg[2][3][2] = -8'sd127;
+      end
+      for (int m = 0; m < 3; m++) begin
+        for (int r_i = 0; r_i < OUT_DIM; r_i++)
+          for (int c = 0; c < LEN; c++) w_ref[r_i][c] = w_reg[m][r_i][c];
+        compute_golden();
+        w_base = base[m];
+        pulse_start();
+        w_base = '0;   // latched at start
+        wait_done_with_timeout(5000);
+        pulse_rewind();
+        read_and_check_y($sformatf("mem window region %0d pass %0d", m, pass));
+      end
+    end
+    pulse_clear_done();
+
+    $display("TB_GEMV: PASS memory window (3 W regions, byte-enable row update)");
+  endtask
+
+  // Attention offload (X16): K (16 keys x 32) at W region 0 gives the scores
+  // of a query with OUT_DIM=16; V^T (32 channels x 32 keys) at region 2048
+  // gives the context of 32 unsigned Q15 weights in x_u16 mode (low bytes in
+  // X[0..31], high bytes in X[32..63]). K stays resident for a second query.
+  task automatic run_attn();
+    int unsigned seed;
+    int unsigned r;
+    i8_t k_reg [0:15][0:31];
+    i8_t vt_reg [0:31][0:31];
+    int unsigned wq [0:31];
+    seed = 32'hA77E4700;
+    bias_en    = 1'b0;
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+    LEN        = 32;
+
+    // K region
+    OUT_DIM = 16;
+    for (int r_i = 0; r_i < 16; r_i++)
+      for (int c = 0; c < 32; c++) begin
+        r = $urandom(seed);
+        k_reg[r_i][c] = i8_t'(r[7:0]);
+        w_ref[r_i][c] = k_reg[r_i][c];
+      end
+    w_base = 0;
+    pulse_clear_done();
+    load_w_packed();
+
+    // V^T region
+    OUT_DIM = 32;
+    for (int r_i = 0; r_i < 32; r_i++)
+      for (int c = 0; c < 32; c++) begin
+        r = $urandom(seed);
+        vt_reg[r_i][c] = i8_t'(r[7:0]);
+        w_ref[r_i][c]  = vt_reg[r_i][c];
+      end
+    w_base = 2048;
+    pulse_clear_done();
+    load_w_packed();
+    w_base = 0;
+
+    for (int q = 0; q < 2; q++) begin
+      // Scores: K * q, 16 rows
+      OUT_DIM = 16;
+      for (int r_i = 0; r_i < 16; r_i++)
+        for (int c = 0; c < 32; c++) w_ref[r_i][c] = k_reg[r_i][c];
+      for (int c = 0; c < 32; c++) begin
+        r = $urandom(seed);
+        x_ref[c] = i8_t'(r[7:0]);
+      end
+      compute_golden();
+      pulse_clear_x();
+      load_x_packed();
+      out_dim_16 = 1'b1;
+      pulse_start();
+      wait_done_with_timeout(5000);
+      if (last_run_cycles > expected_cycles() + 4) begin
+        $display("TB_GEMV: FAIL attn scores: %0d cycles for LANES=%0d ROWS=%0d, expected <= %0d",
+                 last_run_cycles, LANES, ROWS, expected_cycles() + 4);
+        $fatal(1);
+      end
+      pulse_rewind();
+      read_and_check_y($sformatf("attn scores q%0d", q));
+      out_dim_16 = 1'b0;
+
+      if (q == 1) break;
+
+      // Context: V^T * w, 32 rows, 16-bit X (w[0] = 1.0 sets the top bit)
+      OUT_DIM = 32;
+      for (int j = 0; j < 32; j++) begin
+        r = $urandom(seed);
+        wq[j] = (j == 0) ? 32768 : r[14:0];
+      end
+      pulse_clear_x();
+      for (int h = 0; h < 2; h++)
+        for (int j = 0; j < 32; j += 4) begin
+          x_wr4_data = {wq[j+3][8*h +: 8], wq[j+2][8*h +: 8], wq[j+1][8*h +: 8], wq[j][8*h +: 8]};
+          x_wr4_en   = 1'b1;
+          cycle();
+          x_wr4_en   = 1'b0;
+          cycle();
+        end
+      x_u16  = 1'b1;
+      w_base = 2048;
+      pulse_start();
+      w_base = 0;   // latched at start
+      wait_done_with_timeout(5000);
+      x_u16  = 1'b0;
+      pulse_rewind();
+      for (int r_i = 0; r_i < 32; r_i++) begin
+        i32_t acc = 0;
+        for (int j = 0; j < 32; j++) acc += i32_t'(wq[j]) * i32_t'(vt_reg[r_i][j]);
+        y_gold[r_i] = acc;
+      end
+      read_and_check_y("attn context");
+    end
+    pulse_clear_done();
+    OUT_DIM = 32;
+
+    $display("TB_GEMV: PASS attention (OUT_DIM=16 scores, x_u16 context, resident K)");
+  endtask
+
+  // W_BANKS=2: while a run computes from bank 0, the next layer's W and b go
+  // through the prefetch ports into bank 1; flipping w_bank then runs them with
+  // no reload, and bank 0 still holds the first layer.
+  task automatic run_w_banks();
+    int unsigned seed;
+    int unsigned r;
+    i8_t  w_a [0:MAX_DIM-1][0:MAX_DIM-1];
+    i32_t b_a [0:MAX_DIM-1];
+    i8_t  w_b [0:MAX_DIM-1][0:MAX_DIM-1];
+    i32_t b_b [0:MAX_DIM-1];
+    int   busy_pf;
+    init_zero_all();
+    seed = 32'hB4A2C0DE;
+
+    bias_en    = 1'b1;
+    len_64     = 1'b0;
+    out_dim_64 = 1'b0;
+    for (int r_i = 0; r_i < OUT_DIM; r_i++) begin
+      b_a[r_i] = i32_t'(r_i * 77 - 900);
+      b_b[r_i] = i32_t'(1200 - r_i * 31);
+      for (int c = 0; c < LEN; c++) begin
+        r = $urandom(seed);
+        w_a[r_i][c] = i8_t'(r[7:0]);
+        w_b[r_i][c] = i8_t'(r[15:8]);
+      end
+    end
+    for (int c = 0; c < LEN; c++) begin
+      r = $urandom(seed);
+      x_ref[c] = i8_t'(r[7:0]);
+    end
+
+    // Layer A into bank 0 through the streams, and a run on it.
+    for (int r_i = 0; r_i < OUT_DIM; r_i++) begin
+      b_ref[r_i] = b_a[r_i];
+      for (int c = 0; c < LEN; c++) w_ref[r_i][c] = w_a[r_i][c];
+    end
+    w_bank = 1'b0;
+    pulse_clear_done();
+    load_w_packed();
+    load_b();
+    load_x_packed();
+    compute_golden();
+    pulse_start();
+
+    // Meanwhile layer B into bank 1.
+    for (int r_i = 0; r_i < OUT_DIM; r_i++) begin
+      b_ref[r_i] = b_b[r_i];
+      for (int c = 0; c < LEN; c++) w_ref[r_i][c] = w_b[r_i][c];
+    end
+    pulse_pf_rewind();
+    busy_pf = busy;
+    load_pf();
+    wait_done_with_timeout(5000);
+    pulse_clear_x();
+    read_and_check_y("w-banks A (bank 0, prefetch running)");
+
+    // Run B from bank 1, then A again from bank 0.
+    compute_golden();
+    w_bank = 1'b1;
+    pulse_clear_x();
+    load_x_packed();
+    pulse_start();
+    wait_done_with_timeout(5000);
+    pulse_clear_x();
+    read_and_check_y("w-banks B (bank 1)");
+
+    for (int r_i = 0; r_i < OUT_DIM; r_i++) begin
+      b_ref[r_i] = b_a[r_i];
+      for (int c = 0; c < LEN; c++) w_ref[r_i][c] = w_a[r_i][c];
+    end
+    compute_golden();
+    w_bank = 1'b0;
+    pulse_clear_x();
+    load_x_packed();
+    pulse_start();
+    // Flipping w_bank while busy leaves the run on its latched bank.
+    w_bank = 1'b1;
+    wait_done_with_timeout(5000);
+    w_bank = 1'b0;
+    pulse_clear_x();
+    read_and_check_y("w-banks A again (bank 0)");
+
+    $display("TB_GEMV: PASS W banks (prefetch %0s a run)", busy_pf ? "under" : "after");
+  endtask
+
   // -----------------------
   // Main
   // -----------------------
@@ -344,6 +1126,14 @@ module tb_gemv;
     run_deterministic();
     run_randomized();
     run_boundary();
+    run_packed_writes();
+    run_weight_stationary();
+    run_double_buffer();
+    run_requant();
+    run_len64();
+    run_mem_window();
+    run_attn();
+    run_w_banks();
 
     $display("TB_GEMV: ALL TESTS PASS");
     $finish;
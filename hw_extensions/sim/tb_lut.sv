@@ -4,10 +4,13 @@
  * Standalone LUT testbench for TinyML softmax/exp lookup table.
  *
  * DUT (in this repo): hw_extensions/exp_lut/exp_lut.v : module exp_lut
+ * (and module exp_lut_vec, the 8-lane packed-index form)
  *
  * Goals:
  *  - Verify address-to-data mapping across full LUT range.
  *  - Handle either combinational output or 1-cycle registered output.
+ *  - Verify exp_lut_vec lane order and lane_sum on packed index words.
+ *  - Verify exp_lut_interp over every Q3 fractional index.
  *
  * Expected values are read from expected_lut.mem using $readmemh.
  *
@@ -33,6 +36,28 @@ module tb_lut;
     .value(value)
   );
 
+  logic [31:0]  vec_idx;
+  wire  [127:0] vec_values;
+  wire  [15:0]  vec_lane_sum;
+
+  exp_lut_vec dut_vec (
+    .clk(clk),
+    .reset(reset),
+    .idx(vec_idx),
+    .values(vec_values),
+    .lane_sum(vec_lane_sum)
+  );
+
+  logic [6:0]   q3_idx;
+  wire  [15:0]  q3_value;
+
+  exp_lut_interp dut_interp (
+    .clk(clk),
+    .reset(reset),
+    .index_q3(q3_idx),
+    .value(q3_value)
+  );
+
   always #(CLK_PERIOD_NS/2) clk = ~clk;
 
   logic [15:0] exp_ref [0:LUT_DEPTH-1];
@@ -49,6 +74,8 @@ module tb_lut;
 
   task automatic reset_dut();
     index = '0;
+    vec_idx = '0;
+    q3_idx = '0;
     reset = 1'b1;
     repeat (5) cycle();
     reset = 1'b0;
@@ -97,6 +124,52 @@ module tb_lut;
     end
   endtask
 
+  // Packed word: lane k = w[4k+3:4k]; values lane k = [16k+15:16k].
+  task automatic check_vec_word(input logic [31:0] w);
+    logic [15:0] gold_sum;
+    gold_sum = '0;
+    vec_idx = w;
+    #1;
+    for (int k = 0; k < 8; k++) begin
+      if (vec_values[16*k +: 16] !== exp_ref[w[4*k +: 4]]) begin
+        $display("TB_LUT: FAIL vec word=0x%08x lane=%0d dut=0x%04x gold=0x%04x",
+                 w, k, vec_values[16*k +: 16], exp_ref[w[4*k +: 4]]);
+        $fatal(1);
+      end
+      gold_sum = gold_sum + exp_ref[w[4*k +: 4]];
+    end
+    if (vec_lane_sum !== gold_sum) begin
+      $display("TB_LUT: FAIL vec word=0x%08x lane_sum dut=%0d gold=%0d", w, vec_lane_sum, gold_sum);
+      $fatal(1);
+    end
+  endtask
+
+  task automatic check_vec();
+    check_vec_word(32'h00000000);   // all exp(0): sum 8192
+    check_vec_word(32'hFFFFFFFF);
+    check_vec_word(32'h76543210);
+    check_vec_word(32'hFEDCBA98);
+    for (int t = 0; t < 32; t++) begin
+      check_vec_word($urandom);
+    end
+  endtask
+
+  // Q3 index: lut[i] - ((lut[i] - lut[i+1]) * f) >> 3, clamped at 120 (exp(-15)).
+  task automatic check_interp();
+    int unsigned i, f, gold;
+    for (int q = 0; q < 128; q++) begin
+      q3_idx = q[6:0];
+      i = (q >= 120) ? 15 : q / 8;
+      f = (q >= 120) ? 0 : q % 8;
+      gold = (i == 15) ? exp_ref[15] : exp_ref[i] - (((exp_ref[i] - exp_ref[i + 1]) * f) >> 3);
+      #1;
+      if (q3_value !== gold[15:0]) begin
+        $display("TB_LUT: FAIL interp q3=%0d dut=%0d gold=%0d", q, q3_value, gold);
+        $fatal(1);
+      end
+    end
+  endtask
+
   initial begin
     $dumpfile("tb_lut.vcd");
     $dumpvars(0, tb_lut);
@@ -114,6 +187,12 @@ module tb_lut;
     // Sweep full LUT range.
     check_sweep();
 
+    // Vector form: 8 packed lanes and their sum.
+    check_vec();
+
+    // Interpolating form: every Q3 index.
+    check_interp();
+
     // Optional sanity: demonstrate signed index behavior.
     // NOTE: current RTL maps addr = index[3:0]. A true signed mapping (0,-1..-15) would need logic.
     // TODO: If the intended interface is signed 0,-1..-15, update RTL or add a signed-to-addr mapping,
@@ -0,0 +1,177 @@
+`timescale 1ns/1ps
+
+/*
+ * Standalone testbench for the softmax unit.
+ *
+ * DUT (in this repo): hw_extensions/softmax/rtl/softmax_core.v : module softmax_core
+ *
+ * Goals:
+ *  - Compare the Q15 weights against the two-pass softmax of tinyformer.c
+ *    (scores >>> 5, max, >>> 3, clamp, exp LUT, sum, Q15 normalize).
+ *  - Cover both normalize modes (fast=0 division, fast=1 reciprocal).
+ *  - Cover odd lengths, a single score, a full MAX_N row and equal scores.
+ */
+
+module tb_softmax;
+  localparam int CLK_PERIOD_NS = 10;
+  localparam int MAX_N         = 64;
+
+  logic clk = 1'b0;
+  logic reset = 1'b1;
+
+  logic        score_wr_en;
+  logic [31:0] score_wr_data;
+  logic [4:0]  score_shift;
+  logic        fast;
+  logic        start;
+  logic        clear;
+  wire         busy;
+  wire         done;
+  wire  [6:0]  count;
+  wire  [31:0] max_score;
+  wire  [31:0] sum_exp;
+  logic        w_rd_en;
+  wire  [31:0] w_rd_data;
+
+  softmax_core #(
+    .MAX_N(MAX_N),
+    .N_BITS(6)
+  ) dut (
+    .clk(clk),
+    .reset(reset),
+    .score_wr_en(score_wr_en),
+    .score_wr_data(score_wr_data),
+    .score_shift(score_shift),
+    .fast(fast),
+    .start(start),
+    .clear(clear),
+    .busy(busy),
+    .done(done),
+    .count(count),
+    .max_score(max_score),
+    .sum_exp(sum_exp),
+    .w_rd_en(w_rd_en),
+    .w_rd_data(w_rd_data)
+  );
+
+  always #(CLK_PERIOD_NS/2) clk = ~clk;
+
+  int unsigned exp_lut [0:15] = '{1024, 754, 556, 410, 302, 223, 165, 122,
+                                  90, 67, 50, 37, 28, 21, 16, 12};
+
+  int          scores [0:MAX_N-1];
+  int unsigned gold_w [0:MAX_N-1];
+
+  task automatic cycle();
+    @(posedge clk);
+  endtask
+
+  task automatic reset_dut();
+    score_wr_en   = 1'b0;
+    score_wr_data = '0;
+    score_shift   = 5'd5;
+    fast          = 1'b0;
+    start         = 1'b0;
+    clear         = 1'b0;
+    w_rd_en       = 1'b0;
+    reset = 1'b1;
+    repeat (5) cycle();
+    reset = 1'b0;
+    repeat (2) cycle();
+  endtask
+
+  // Golden: steps 1-3 of attention_single_head() in tinyformer.c.
+  task automatic compute_golden(input int n, input bit f);
+    int s [0:MAX_N-1];
+    int mx;
+    int idx;
+    int unsigned sum;
+    int unsigned recip;
+    mx = -2147483647;
+    sum = 0;
+    for (int j = 0; j < n; j++) begin
+      s[j] = scores[j] >>> 5;
+      if (s[j] > mx) mx = s[j];
+    end
+    for (int j = 0; j < n; j++) begin
+      idx = -((s[j] - mx) >>> 3);
+      if (idx > 15) idx = 15;
+      gold_w[j] = exp_lut[idx];
+      sum += gold_w[j];
+    end
+    if (sum == 0) sum = 1;
+    if (f) begin
+      recip = 32'h80000000 / sum;
+      for (int j = 0; j < n; j++) gold_w[j] = ((gold_w[j] * recip) >> 16) & 16'hFFFF;
+    end else begin
+      for (int j = 0; j < n; j++) gold_w[j] = ((gold_w[j] << 15) / sum) & 16'hFFFF;
+    end
+  endtask
+
+  task automatic run_row(input int n, input bit f);
+    compute_golden(n, f);
+    fast = f;
+
+    clear = 1'b1;
+    cycle();
+    clear = 1'b0;
+    for (int j = 0; j < n; j++) begin
+      score_wr_en   = 1'b1;
+      score_wr_data = scores[j];
+      cycle();
+    end
+    score_wr_en = 1'b0;
+    cycle();
+    if (count !== n[6:0]) begin
+      $display("TB_SOFTMAX: FAIL count=%0d expected %0d", count, n);
+      $fatal(1);
+    end
+
+    start = 1'b1;
+    cycle();
+    start = 1'b0;
+    while (!done) cycle();
+    #1;
+
+    for (int j = 0; j < n; j += 2) begin
+      if (w_rd_data[15:0] !== gold_w[j][15:0]) begin
+        $display("TB_SOFTMAX: FAIL n=%0d fast=%0d j=%0d dut=%0d gold=%0d", n, f, j, w_rd_data[15:0], gold_w[j]);
+        $fatal(1);
+      end
+      if (j + 1 < n && w_rd_data[31:16] !== gold_w[j + 1][15:0]) begin
+        $display("TB_SOFTMAX: FAIL n=%0d fast=%0d j=%0d dut=%0d gold=%0d", n, f, j + 1, w_rd_data[31:16], gold_w[j + 1]);
+        $fatal(1);
+      end
+      w_rd_en = 1'b1;
+      cycle();
+      w_rd_en = 1'b0;
+      #1;
+    end
+  endtask
+
+  task automatic random_row(input int n, input int range, input bit f);
+    for (int j = 0; j < n; j++) scores[j] = $urandom_range(2 * range) - range;
+    run_row(n, f);
+  endtask
+
+  initial begin
+    $dumpfile("tb_softmax.vcd");
+    $dumpvars(0, tb_softmax);
+
+    reset_dut();
+
+    for (int f = 0; f <= 1; f++) begin
+      random_row(16, 1000, f);
+      random_row(16, 20000, f);
+      random_row(7, 20000, f);
+      random_row(1, 1000, f);
+      random_row(MAX_N, 1 << 20, f);
+      for (int j = 0; j < 16; j++) scores[j] = 1234;
+      run_row(16, f);
+    end
+
+    $display("TB_SOFTMAX: ALL TESTS PASS");
+    $finish;
+  end
+
+endmodule
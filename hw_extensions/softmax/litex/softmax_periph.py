@@ -0,0 +1,64 @@
+# Softmax unit — LiteX CSR wrapper.
+#
+# Integrates softmax_core (Verilog) into a LiteX SoC via the CSR bus.
+# START and CLEAR are one-cycle pulses (CTRL write with the bit set); FAST is stored config.
+# SCORE_IN pushes one raw int32 score per write; the core tracks the running max.
+# W_OUT returns two Q15 weights (lane 0 = bits 15:0); writing W_NEXT advances by two,
+# as GEMV's Y_NEXT (reads have no side effects).
+#
+# Usage (in your SoC target):
+#   self.submodules.softmax = SoftmaxPeripheral()
+#   self.add_csr("softmax")
+#   self.add_source("path/to/rtl/softmax_core.v")
+
+from migen import *
+from litex.soc.interconnect.csr import AutoCSR, CSRStorage, CSRStatus
+
+
+class SoftmaxPeripheral(Module, AutoCSR):
+    """LiteX peripheral for softmax_core. CTRL, CFG, STATUS, SCORE_IN, W_OUT, W_NEXT, COUNT, MAX, SUM."""
+
+    def __init__(self, max_n=64):
+        # --- CTRL: [0]=start (pulse), [1]=clear (pulse), [2]=fast (stored config) ---
+        self.ctrl = CSRStorage(3, name="ctrl")
+        # --- CFG: [4:0]=score_shift (arithmetic right shift of each score on entry) ---
+        self.cfg = CSRStorage(5, reset=5, name="cfg", description="Score pre-shift (TinyFormer: 5)")
+        self.status = CSRStatus(2, name="status")  # [0]=busy, [1]=done — combinational from core
+
+        self.score_in = CSRStorage(32, name="score_in", description="Write next raw int32 score")
+        self.w_out = CSRStatus(32, name="w_out", description="Read two Q15 weights at current index (lane 0 = LSB)")
+        self.w_next = CSRStorage(1, name="w_next", description="Write to advance the weight read pointer by two (pulse)")
+
+        self.count = CSRStatus(8, name="count", description="Scores written since clear")
+        self.max = CSRStatus(32, name="max", description="Running max of the shifted scores")
+        self.sum = CSRStatus(32, name="sum", description="Sum of the Q10 exp values (valid when done)")
+
+        # --- Core signals ---
+        self.busy = Signal()
+        self.done = Signal()
+        count = Signal(8)
+
+        self.specials += Instance(
+            "softmax_core",
+            p_MAX_N=max_n,
+            p_N_BITS=log2_int(max_n),
+            i_clk=ClockSignal(),
+            i_reset=ResetSignal(),
+            i_score_wr_en=self.score_in.re,
+            i_score_wr_data=self.score_in.storage,
+            i_score_shift=self.cfg.storage,
+            i_fast=self.ctrl.storage[2],
+            i_start=self.ctrl.re & self.ctrl.storage[0],
+            i_clear=self.ctrl.re & self.ctrl.storage[1],
+            o_busy=self.busy,
+            o_done=self.done,
+            o_count=count[:log2_int(max_n) + 1],
+            o_max_score=self.max.status,
+            o_sum_exp=self.sum.status,
+            i_w_rd_en=self.w_next.re,
+            o_w_rd_data=self.w_out.status,
+        )
+        self.comb += [
+            self.status.status.eq(Cat(self.busy, self.done)),
+            self.count.status.eq(count),
+        ]
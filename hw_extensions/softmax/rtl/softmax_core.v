@@ -0,0 +1,227 @@
+/*
+ * Softmax core: S raw attention scores in, S Q15 softmax weights out.
+ * Bit-exact with attention_single_head() in litex_port/common/tinyformer.c:
+ *   s_j   = score_j >>> score_shift                  (TinyFormer: 5)
+ *   idx_j = min(-((s_j - max_j s_j) >>> 3), 15)
+ *   e_j   = lut[idx_j]                                (Q10, as exp_lut.v)
+ *   sum   = sum_j e_j
+ *   w_j   = (e_j << 15) / sum                         (fast = 0)
+ *   w_j   = (e_j * (2^31 / sum)) >> 16                (fast = 1, FAST_SOFTMAX)
+ * CSR-fed: the wrapper pushes scores through the write port (the running
+ * max is tracked as they arrive), pulses start, and reads weights back two
+ * per word. e_j takes only 16 values, so the core divides once per LUT
+ * entry (16-step restoring divider) or once for the reciprocal, and each
+ * w_j is a table read: about n + 16*17 cycles (fast: n + 50) per row.
+ * Scores must keep (s_j - max) within int32, as in the C code.
+ */
+
+module softmax_core #(
+    parameter MAX_N  = 64,
+    parameter N_BITS = 6     /* log2(MAX_N) */
+) (
+    input  wire         clk,
+    input  wire         reset,
+
+    /* Score write port (driven by wrapper when CPU writes SCORE_IN) */
+    input  wire         score_wr_en,
+    input  wire [31:0]  score_wr_data,
+    input  wire [4:0]   score_shift,   /* arithmetic right shift on entry */
+
+    /* Config and control (from CTRL) */
+    input  wire         fast,          /* reciprocal-multiply normalize */
+    input  wire         start,
+    input  wire         clear,         /* rewind score and weight pointers, clear done */
+
+    /* Status */
+    output reg          busy,
+    output reg          done,
+    output wire [N_BITS:0] count,      /* scores written since clear */
+    output reg  [31:0]  max_score,     /* running max of s_j */
+    output reg  [31:0]  sum_exp,       /* sum of e_j, valid when done */
+
+    /* Read port: weights rd, rd+1 (lane 0 = bits 15:0); w_rd_en advances by two */
+    input  wire         w_rd_en,
+    output wire [31:0]  w_rd_data
+);
+
+    reg signed [31:0]   s_mem [0:MAX_N-1];
+    reg [3:0]           idx_mem [0:MAX_N-1];
+    reg [15:0]          w_tab [0:15];
+    reg [15:0]          lut [0:15];
+
+    initial begin
+        lut[0]  = 1024;
+        lut[1]  = 754;
+        lut[2]  = 556;
+        lut[3]  = 410;
+        lut[4]  = 302;
+        lut[5]  = 223;
+        lut[6]  = 165;
+        lut[7]  = 122;
+        lut[8]  = 90;
+        lut[9]  = 67;
+        lut[10] = 50;
+        lut[11] = 37;
+        lut[12] = 28;
+        lut[13] = 21;
+        lut[14] = 16;
+        lut[15] = 12;
+    end
+
+    reg [N_BITS:0]      n;        /* scores written */
+    reg [N_BITS:0]      j;        /* EXP pass index */
+    reg [N_BITS-1:0]    rd_idx;   /* even */
+    assign count = n;
+
+    wire signed [31:0]  s_in = $signed(score_wr_data) >>> score_shift;
+
+    /* LUT index of score j: min(-((s_j - max) >>> 3), 15), s_j <= max */
+    wire signed [31:0]  s_diff = s_mem[j[N_BITS-1:0]] - $signed(max_score);
+    wire signed [31:0]  s_neg  = -(s_diff >>> 3);
+    wire [3:0]          e_idx  = (s_neg > 15) ? 4'd15 : s_neg[3:0];
+
+    /* Restoring divider: quotient bit per cycle, numerator shifted out of div_num */
+    reg [31:0]          div_rem;
+    reg [31:0]          div_num;
+    reg [31:0]          div_q;
+    reg [5:0]           div_cnt;
+    reg [4:0]           tab_i;    /* LUT entry being normalized */
+    reg [31:0]          recip;
+    wire [31:0]         div_den = (sum_exp == 32'd0) ? 32'd1 : sum_exp;
+    wire [32:0]         rem_s   = {div_rem, div_num[31]};
+    wire                rem_ge  = (rem_s >= {1'b0, div_den});
+    wire [32:0]         rem_sub = rem_s - {1'b0, div_den};
+    wire [31:0]         rem_nx  = rem_ge ? rem_sub[31:0] : rem_s[31:0];
+    /* (e << 15) / sum with 16 quotient bits: start from (e << 15) >> 16 = e >> 1 */
+    wire [15:0]         lut_next = lut[tab_i[3:0] + 4'd1];
+    /* Fast path: (e * recip) truncated to 32 bits, as in C */
+    wire [31:0]         w_prod  = {16'd0, lut[tab_i[3:0]]} * recip;
+
+    assign w_rd_data = {w_tab[idx_mem[rd_idx + 1'b1]], w_tab[idx_mem[rd_idx]]};
+
+    localparam [2:0] S_IDLE  = 3'd0,
+                     S_EXP   = 3'd1,
+                     S_DIV   = 3'd2,
+                     S_RECIP = 3'd3,
+                     S_MUL   = 3'd4,
+                     S_DONE  = 3'd5;
+    reg [2:0] state;
+
+    always @(posedge clk) begin
+        if (reset) begin
+            state     <= S_IDLE;
+            busy      <= 1'b0;
+            done      <= 1'b0;
+            n         <= 0;
+            j         <= 0;
+            rd_idx    <= 0;
+            max_score <= 32'd0;
+            sum_exp   <= 32'd0;
+            div_rem   <= 32'd0;
+            div_num   <= 32'd0;
+            div_q     <= 32'd0;
+            div_cnt   <= 6'd0;
+            tab_i     <= 5'd0;
+            recip     <= 32'd0;
+        end else begin
+            if (clear && !busy) begin
+                n      <= 0;
+                rd_idx <= 0;
+                done   <= 1'b0;
+            end else if (score_wr_en && !busy && n < MAX_N) begin
+                s_mem[n[N_BITS-1:0]] <= s_in;
+                if (n == 0 || s_in > $signed(max_score))
+                    max_score <= s_in;
+                n <= n + 1'b1;
+            end
+
+            if (w_rd_en && !busy)
+                rd_idx <= rd_idx + 2'd2;
+
+            case (state)
+                S_IDLE: begin
+                    if (start && !busy) begin
+                        busy    <= 1'b1;
+                        done    <= 1'b0;
+                        j       <= 0;
+                        rd_idx  <= 0;
+                        sum_exp <= 32'd0;
+                        state   <= S_EXP;
+                    end
+                end
+
+                S_EXP: begin
+                    if (j < n) begin
+                        idx_mem[j[N_BITS-1:0]] <= e_idx;
+                        sum_exp <= sum_exp + {16'd0, lut[e_idx]};
+                        j       <= j + 1'b1;
+                    end else begin
+                        tab_i <= 5'd0;
+                        div_q <= 32'd0;
+                        if (fast) begin
+                            div_rem <= 32'd0;
+                            div_num <= 32'h80000000;
+                            div_cnt <= 6'd32;
+                            state   <= S_RECIP;
+                        end else begin
+                            div_rem <= {17'd0, lut[0][15:1]};
+                            div_num <= {lut[0][0], 31'd0};
+                            div_cnt <= 6'd16;
+                            state   <= S_DIV;
+                        end
+                    end
+                end
+
+                S_DIV: begin
+                    if (div_cnt != 6'd0) begin
+                        div_rem <= rem_nx;
+                        div_num <= {div_num[30:0], 1'b0};
+                        div_q   <= {div_q[30:0], rem_ge};
+                        div_cnt <= div_cnt - 1'b1;
+                    end else begin
+                        w_tab[tab_i[3:0]] <= div_q[15:0];
+                        if (tab_i == 5'd15) begin
+                            state <= S_DONE;
+                        end else begin
+                            tab_i   <= tab_i + 1'b1;
+                            div_rem <= {17'd0, lut_next[15:1]};
+                            div_num <= {lut_next[0], 31'd0};
+                            div_q   <= 32'd0;
+                            div_cnt <= 6'd16;
+                        end
+                    end
+                end
+
+                S_RECIP: begin
+                    if (div_cnt != 6'd0) begin
+                        div_rem <= rem_nx;
+                        div_num <= {div_num[30:0], 1'b0};
+                        div_q   <= {div_q[30:0], rem_ge};
+                        div_cnt <= div_cnt - 1'b1;
+                    end else begin
+                        recip <= div_q;
+                        tab_i <= 5'd0;
+                        state <= S_MUL;
+                    end
+                end
+
+                S_MUL: begin
+                    w_tab[tab_i[3:0]] <= w_prod[31:16];
+                    if (tab_i == 5'd15)
+                        state <= S_DONE;
+                    else
+                        tab_i <= tab_i + 1'b1;
+                end
+
+                S_DONE: begin
+                    busy  <= 1'b0;
+                    done  <= 1'b1;
+                    state <= S_IDLE;
+                end
+
+                default: state <= S_IDLE;
+            endcase
+        end
+    end
+
+endmodule
@@ -0,0 +1,131 @@
+/*
+ * Softmax unit driver. Polling only.
+ * USE_SOFTMAX_HW: SOFTMAX_USE_LITEX_CSR + generated/csr.h, or SOFTMAX_BASE / softmax_init() for
+ * raw MMIO. Without USE_SOFTMAX_HW the calls run the C reference (same results as the block).
+ */
+
+#include "softmax.h"
+#if defined(USE_SOFTMAX_HW) && defined(SOFTMAX_USE_LITEX_CSR)
+#  include <generated/csr.h>
+#endif
+
+#if defined(USE_SOFTMAX_HW)
+#  if defined(SOFTMAX_USE_LITEX_CSR)
+#    define SOFTMAX_WRITE_CTRL(v)   softmax_ctrl_write((uint32_t)(v))
+#    define SOFTMAX_WRITE_CFG(v)    softmax_cfg_write((uint32_t)(v))
+#    define SOFTMAX_READ_STATUS()   softmax_status_read()
+#    define SOFTMAX_WRITE_SCORE(v)  softmax_score_in_write((uint32_t)(v))
+#    define SOFTMAX_READ_W()        softmax_w_out_read()
+#    define SOFTMAX_WRITE_W_NEXT()  softmax_w_next_write(1u)
+#  else
+#    ifndef SOFTMAX_BASE
+#      define SOFTMAX_BASE  s_softmax_base
+#    endif
+#    define SOFTMAX_REG(off)        (*(volatile uint32_t *)(SOFTMAX_BASE + (off)))
+#    define SOFTMAX_WRITE_CTRL(v)   (SOFTMAX_REG(SOFTMAX_CTRL) = (uint32_t)(v))
+#    define SOFTMAX_WRITE_CFG(v)    (SOFTMAX_REG(SOFTMAX_CFG) = (uint32_t)(v))
+#    define SOFTMAX_READ_STATUS()   SOFTMAX_REG(SOFTMAX_STATUS)
+#    define SOFTMAX_WRITE_SCORE(v)  (SOFTMAX_REG(SOFTMAX_SCORE_IN) = (uint32_t)(v))
+#    define SOFTMAX_READ_W()        SOFTMAX_REG(SOFTMAX_W_OUT)
+#    define SOFTMAX_WRITE_W_NEXT()  (SOFTMAX_REG(SOFTMAX_W_NEXT) = 1u)
+#  endif
+#endif
+
+static uintptr_t s_softmax_base;
+
+/* CTRL.fast as last configured (kept in every CTRL write) */
+static uint32_t s_ctrl_fast;
+
+#if !defined(USE_SOFTMAX_HW)
+/* Reference: the two-pass softmax of tinyformer.c attention_single_head(). */
+static const uint16_t softmax_exp_lut[16] = {
+    1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12
+};
+static int32_t  s_scores[SOFTMAX_MAX_N];
+static int      s_count;
+static unsigned s_shift = 5;
+#endif
+
+void softmax_init(uintptr_t base_addr)
+{
+    s_softmax_base = base_addr;
+    (void)s_softmax_base; /* unused when using LiteX CSRs or a fixed SOFTMAX_BASE */
+}
+
+void softmax_config(unsigned score_shift, int fast)
+{
+    s_ctrl_fast = fast ? SOFTMAX_CTRL_FAST : 0u;
+#if defined(USE_SOFTMAX_HW)
+    SOFTMAX_WRITE_CFG(score_shift & 0x1Fu);
+    SOFTMAX_WRITE_CTRL(s_ctrl_fast);
+#else
+    s_shift = score_shift & 0x1Fu;
+#endif
+}
+
+void softmax_begin(void)
+{
+#if defined(USE_SOFTMAX_HW)
+    SOFTMAX_WRITE_CTRL(s_ctrl_fast | SOFTMAX_CTRL_CLEAR);
+#else
+    s_count = 0;
+#endif
+}
+
+void softmax_push(int32_t score)
+{
+#if defined(USE_SOFTMAX_HW)
+    SOFTMAX_WRITE_SCORE(score);
+#else
+    if (s_count < SOFTMAX_MAX_N) s_scores[s_count++] = score;
+#endif
+}
+
+void softmax_finish(uint16_t *w, int n)
+{
+#if defined(USE_SOFTMAX_HW)
+    int j;
+    SOFTMAX_WRITE_CTRL(s_ctrl_fast | SOFTMAX_CTRL_START);
+    while ((SOFTMAX_READ_STATUS() & SOFTMAX_STATUS_DONE) == 0u) {
+        /* busy-wait */
+    }
+    for (j = 0; j + 1 < n; j += 2) {
+        uint32_t v = SOFTMAX_READ_W();
+        SOFTMAX_WRITE_W_NEXT();
+        w[j]     = (uint16_t)v;
+        w[j + 1] = (uint16_t)(v >> 16);
+    }
+    if (j < n) w[j] = (uint16_t)SOFTMAX_READ_W();
+#else
+    int32_t  max_score = -2147483647;
+    uint32_t sum_exp = 0;
+    int j;
+
+    if (n > s_count) n = s_count;
+    for (j = 0; j < n; j++) {
+        s_scores[j] >>= s_shift;
+        if (s_scores[j] > max_score) max_score = s_scores[j];
+    }
+    for (j = 0; j < n; j++) {
+        int32_t idx = -((s_scores[j] - max_score) >> 3);
+        if (idx > 15) idx = 15;
+        w[j] = softmax_exp_lut[idx];
+        sum_exp += w[j];
+    }
+    if (sum_exp == 0u) sum_exp = 1u;
+    if (s_ctrl_fast) {
+        uint32_t recip = 0x80000000u / sum_exp;
+        for (j = 0; j < n; j++) w[j] = (uint16_t)(((uint32_t)w[j] * recip) >> 16);
+    } else {
+        for (j = 0; j < n; j++) w[j] = (uint16_t)(((uint32_t)w[j] << 15) / sum_exp);
+    }
+#endif
+}
+
+void softmax_row(const int32_t *scores, uint16_t *w, int n)
+{
+    int j;
+    softmax_begin();
+    for (j = 0; j < n; j++) softmax_push(scores[j]);
+    softmax_finish(w, n);
+}
@@ -0,0 +1,74 @@
+/*
+ * Softmax unit — C driver API.
+ *
+ * Defining USE_SOFTMAX_HW (in the firmware that uses this driver) requires the SoC to include
+ * the corresponding HW block; otherwise the same calls run the C reference below.
+ *
+ * Use with LiteX-generated CSR accessors (SOFTMAX_USE_LITEX_CSR: softmax_ctrl_write(),
+ * softmax_score_in_write(), ...) or with SOFTMAX_BASE / softmax_init() and the offsets below.
+ *
+ * Usage per row: softmax_begin(); softmax_push(score) for each key; softmax_finish(w, n).
+ * Weights are Q15 and bit-exact with the two-pass softmax in tinyformer.c.
+ */
+
+#ifndef SOFTMAX_H
+#define SOFTMAX_H
+
+#include <stdint.h>
+
+/* Optional: set base address when not using LiteX generated/csr.h */
+#ifndef SOFTMAX_BASE
+/* #define SOFTMAX_BASE  0x00000000 */
+#endif
+
+/* Register offsets (bytes) — must match softmax_spec.md and LiteX wrapper */
+#define SOFTMAX_CTRL      0x00
+#define SOFTMAX_CFG       0x04   /* [4:0] score pre-shift, reset 5 */
+#define SOFTMAX_STATUS    0x08
+#define SOFTMAX_SCORE_IN  0x0C   /* write next raw int32 score */
+#define SOFTMAX_W_OUT     0x10   /* two Q15 weights at the read index (lane 0 = bits 15:0) */
+#define SOFTMAX_W_NEXT    0x14   /* write any value to advance the read index by two */
+#define SOFTMAX_COUNT     0x18
+#define SOFTMAX_MAX       0x1C
+#define SOFTMAX_SUM       0x20
+
+/* CTRL bits: START and CLEAR are pulses; FAST is stored */
+#define SOFTMAX_CTRL_START  (1u << 0)
+#define SOFTMAX_CTRL_CLEAR  (1u << 1)
+#define SOFTMAX_CTRL_FAST   (1u << 2)   /* reciprocal-multiply normalize (TINYFORMER_FAST_SOFTMAX) */
+
+/* STATUS: [0]=busy, [1]=done */
+#define SOFTMAX_STATUS_BUSY  (1u << 0)
+#define SOFTMAX_STATUS_DONE  (1u << 1)
+
+/* Longest row the block holds (softmax_core MAX_N) */
+#define SOFTMAX_MAX_N 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initialize driver (set base address if using SOFTMAX_BASE). No-op when using LiteX CSRs. */
+void softmax_init(uintptr_t base_addr);
+
+/* Score pre-shift (scores are >> score_shift on entry; TinyFormer uses 5) and
+ * normalize mode (fast != 0: w = (e * (2^31 / sum)) >> 16, else (e << 15) / sum). */
+void softmax_config(unsigned score_shift, int fast);
+
+/* Start a new row: rewind the score and weight pointers. */
+void softmax_begin(void);
+
+/* Append one raw score to the row (at most SOFTMAX_MAX_N per row). */
+void softmax_push(int32_t score);
+
+/* Normalize the n pushed scores and store their Q15 weights in w[0..n-1]. */
+void softmax_finish(uint16_t *w, int n);
+
+/* softmax_begin(), push scores[0..n-1], softmax_finish(w, n). */
+void softmax_row(const int32_t *scores, uint16_t *w, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOFTMAX_H */
@@ -0,0 +1,44 @@
+/*
+ * Cycle counter for on-target profiling (RV32 `cycle` CSR).
+ *
+ * Reads the low 32 bits of the RISC-V cycle counter (and of the retired
+ * instruction counter, instret_counter_read); the VexRiscv CsrPlugin
+ * must expose it (LiteX "standard" and larger variants do). Encoded with
+ * .insn so -march=rv32im builds do not need the Zicsr/Zicntr extensions.
+ * x86 host builds (litex_port/host) read the TSC for cycles and 0 for
+ * instret; other builds read 0.
+ *
+ * Elapsed cycles: (end - start) with uint32_t wrap-around arithmetic.
+ */
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <stdint.h>
+
+static inline uint32_t cycle_counter_read(void)
+{
+#if defined(__riscv)
+    uint32_t c;
+    /* csrrs c, cycle (0xC00), x0 */
+    __asm__ volatile (".insn i 0x73, 2, %0, x0, -1024" : "=r"(c));
+    return c;
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    return 0u;
+#endif
+}
+
+static inline uint32_t instret_counter_read(void)
+{
+#if defined(__riscv)
+    uint32_t n;
+    /* csrrs n, instret (0xC02), x0 */
+    __asm__ volatile (".insn i 0x73, 2, %0, x0, -1022" : "=r"(n));
+    return n;
+#else
+    return 0u;
+#endif
+}
+
+#endif /* CYCLE_COUNTER_H */
@@ -11,3 +11,25 @@ const int8_t cls_W[DEMO_NUM_CLASSES][DEMO_D] = {
 };
 
 const int8_t cls_b[DEMO_NUM_CLASSES] = { -6, -2, -3, 1, -3, 2 };
+
+const int8_t exit_in_W[DEMO_NUM_CLASSES][DEMO_D] = {
+    { -11, 10, 2, -9, -11, 0, 7, -1, -5, -9, 7, -4, -4, 7, 7, 3, -1, 6, -4, 1, -5, -11, -3, -1, 5, -10, -8, -2, 10, -12, -2, -6 },
+    { -6, 1, 6, 8, 3, -7, -6, 1, -4, -8, 5, 0, 8, -1, 0, -5, 3, -12, -2, 6, -5, 1, 8, 3, 1, 8, -3, -6, 5, 1, 7, -4 },
+    { 9, 5, -3, -4, 5, -10, -1, 6, -2, 2, -4, 10, -2, -2, 6, -4, -2, -3, -5, -4, 0, 3, 4, 3, 7, 7, 5, 5, 2, 7, 1, 1 },
+    { 0, -3, 1, -9, 3, 5, -3, -3, 1, 5, -7, -2, -6, -8, -7, -2, 6, 5, -4, -9, 8, 3, 3, 0, -5, -4, 1, -11, -7, 5, -4, 3 },
+    { 4, -4, -5, -5, -8, 1, 7, -2, 6, -2, 0, -8, -2, 2, -6, 9, 4, 5, 8, 3, 1, 5, 8, -9, -3, 1, -2, -12, -5, -8, 1, 5 },
+    { 2, -8, 2, 7, -3, 4, -3, 1, 7, 6, -3, 5, -2, -10, 4, 6, 5, 7, 4, 4, 6, -3, -1, -4, 0, -5, 2, 8, -5, 1, -6, 4 },
+};
+
+const int8_t exit_in_b[DEMO_NUM_CLASSES] = { -6, -2, -3, 1, -3, 2 };
+
+const int8_t exit_attn_W[DEMO_NUM_CLASSES][DEMO_D] = {
+    { -11, 10, 2, -9, -11, 0, 7, -1, -5, -9, 7, -4, -4, 7, 7, 3, -1, 6, -4, 1, -5, -11, -3, -1, 5, -10, -8, -2, 10, -12, -2, -6 },
+    { -6, 1, 6, 8, 3, -7, -6, 1, -4, -8, 5, 0, 8, -1, 0, -5, 3, -12, -2, 6, -5, 1, 8, 3, 1, 8, -3, -6, 5, 1, 7, -4 },
+    { 9, 5, -3, -4, 5, -10, -1, 6, -2, 2, -4, 10, -2, -2, 6, -4, -2, -3, -5, -4, 0, 3, 4, 3, 7, 7, 5, 5, 2, 7, 1, 1 },
+    { 0, -3, 1, -9, 3, 5, -3, -3, 1, 5, -7, -2, -6, -8, -7, -2, 6, 5, -4, -9, 8, 3, 3, 0, -5, -4, 1, -11, -7, 5, -4, 3 },
+    { 4, -4, -5, -5, -8, 1, 7, -2, 6, -2, 0, -8, -2, 2, -6, 9, 4, 5, 8, 3, 1, 5, 8, -9, -3, 1, -2, -12, -5, -8, 1, 5 },
+    { 2, -8, 2, 7, -3, 4, -3, 1, 7, 6, -3, 5, -2, -10, 4, 6, 5, 7, 4, 4, 6, -3, -1, -4, 0, -5, 2, 8, -5, 1, -6, 4 },
+};
+
+const int8_t exit_attn_b[DEMO_NUM_CLASSES] = { -6, -2, -3, 1, -3, 2 };
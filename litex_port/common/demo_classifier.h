@@ -6,7 +6,20 @@
 #define DEMO_NUM_CLASSES 6
 #define DEMO_D 32
 
+// Early-exit heads (tinyformer_classify_early): a head exits when its
+// top-1 logit leads the runner-up by at least its margin (int32 max: off).
+#ifndef DEMO_EXIT_IN_MARGIN
+#define DEMO_EXIT_IN_MARGIN 2147483647
+#endif
+#ifndef DEMO_EXIT_ATTN_MARGIN
+#define DEMO_EXIT_ATTN_MARGIN 2147483647
+#endif
+
 extern const int8_t cls_W[DEMO_NUM_CLASSES][DEMO_D];
 extern const int8_t cls_b[DEMO_NUM_CLASSES];
+extern const int8_t exit_in_W[DEMO_NUM_CLASSES][DEMO_D];
+extern const int8_t exit_in_b[DEMO_NUM_CLASSES];
+extern const int8_t exit_attn_W[DEMO_NUM_CLASSES][DEMO_D];
+extern const int8_t exit_attn_b[DEMO_NUM_CLASSES];
 
 #endif // DEMO_CLASSIFIER_H
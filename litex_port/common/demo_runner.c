@@ -1,11 +1,49 @@
 // Shared demo flow implementation.
 // Uses tinyformer_encode(), demo samples, classifier; prints via uart_litex.
 
+#include "cycle_counter.h"
 #include "demo_classifier.h"
+#include "demo_runner.h"
 #include "demo_samples.h"
+#include "stream_gate.h"
+#include "stream_ring.h"
+#include "tf_trace.h"
 #include "tinyformer.h"
+#include "uart_frame.h"
 #include "uart_litex.h"
 #include <stdint.h>
+#if defined(USE_GEMV_HW)
+#include "gemv.h"
+#endif
+#if TINYFORMER_PROFILE && defined(USE_PERFMON_HW)
+#include "perfmon.h"
+#endif
+#if defined(DEMO_MODEL_BLOB)
+#include "model_blob.h"
+#if TINYFORMER_TIERS
+#include "model_tiers.h"
+#endif
+#endif
+#if TINYFORMER_SMP
+#include "smp_runtime.h"
+#endif
+#if DEMO_STREAM_DMA
+#include "sensor_dma.h"
+#endif
+#if TINYFORMER_SHADOW && DEMO_STREAM
+#include "tf_shadow.h"
+#include TF_SHADOW_REF_H
+#endif
+#if DEMO_DUTY_CYCLE
+#include <generated/csr.h>
+#include <generated/soc.h>
+#endif
+#if TINYFORMER_POWER_MODES && DEMO_DUTY_CYCLE
+#include "power_modes.h"
+#endif
+#if TINYFORMER_STACK_PAINT
+#include "tf_stack.h"
+#endif
 
 
 #include "uart_litex.h"
@@ -32,8 +70,19 @@ static void uart_write_uint32(uint32_t value) {
   uart_write_string(&buf[i + 1]);
 }
 
-/* Print 32-bit value as 8 hex digits (for ENC_CKSUM). */
-static void uart_write_hex32(uint32_t value) {
+#if ((DEMO_EARLY_EXIT || defined(DEMO_MODEL_BLOB)) && !DEMO_STREAM) || TINYFORMER_RANGE_STATS
+static void uart_write_int32(int32_t value) {
+  if (value < 0) {
+    uart_write_char('-');
+    uart_write_uint32(0u - (uint32_t)value);
+  } else {
+    uart_write_uint32((uint32_t)value);
+  }
+}
+#endif
+
+/* Print 32-bit value as 8 hex digits (for ENC_CKSUM; unused with DEMO_STREAM). */
+static __attribute__((unused)) void uart_write_hex32(uint32_t value) {
   static const char hex[] = "0123456789ABCDEF";
   for (int shift = 28; shift >= 0; shift -= 4) {
     uart_write_char(hex[(value >> shift) & 0xFu]);
@@ -62,6 +111,11 @@ static void mean_pool_tokens(const int8_t tokens[TINYFORMER_S][TINYFORMER_D],
 
 static void classifier_forward(const int8_t pooled[TINYFORMER_D],
                                int32_t logits[DEMO_NUM_CLASSES]) {
+#if defined(USE_GEMV_HW) && !TINYFORMER_AUTOTUNE
+  /* DEMO_NUM_CLASSES x D: one padded tile, W stays resident across samples. */
+  gemv_matvec(&cls_W[0][0], pooled, cls_b, logits, DEMO_NUM_CLASSES,
+              TINYFORMER_D);
+#else
   for (int c = 0; c < DEMO_NUM_CLASSES; ++c) {
     int32_t acc = (int32_t)cls_b[c];
     const int8_t *w_row = &cls_W[c][0];
@@ -70,48 +124,1706 @@ static void classifier_forward(const int8_t pooled[TINYFORMER_D],
     }
     logits[c] = acc;
   }
+#endif
 }
 
-void demo_run(void) {
+/* Mean-pool, classifier head and argmax over one encoded window. */
+static uint32_t classify_encoded(const int8_t encoded[TINYFORMER_S][TINYFORMER_D]) {
+  static int8_t pooled[TINYFORMER_D];
+  int32_t logits[DEMO_NUM_CLASSES];
+
+  mean_pool_tokens(encoded, pooled);
+  classifier_forward(pooled, logits);
+
+  int32_t best_val = logits[0];
+  uint32_t best_idx = 0;
+  for (uint32_t c = 1; c < (uint32_t)DEMO_NUM_CLASSES; ++c) {
+    if (logits[c] > best_val) {
+      best_val = logits[c];
+      best_idx = c;
+    }
+  }
+  return best_idx;
+}
+
+/* One-line encoder SRAM report (static .bss bytes). */
+static void print_sram_usage(void) {
+  tinyformer_sram_t u;
+  tinyformer_sram_usage(&u);
+  uart_write_string("TF_SRAM arena=");
+  uart_write_uint32(u.arena);
+  uart_write_string(" pingpong=");
+  uart_write_uint32(u.pingpong);
+  uart_write_string(" scratch=");
+  uart_write_uint32(u.scratch);
+  uart_write_string(" total=");
+  uart_write_uint32(u.total);
+  uart_write_string("\r\n");
+}
+
+#if TINYFORMER_STACK_PAINT
+/* Stack high-water mark since reset against the painted free SRAM. */
+static void print_stack(void) {
+  uart_write_string("STACK high_water=");
+  uart_write_uint32(tf_stack_high_water());
+  uart_write_string(" size=");
+  uart_write_uint32(tf_stack_size());
+  uart_write_string("\r\n");
+}
+#endif
+
+#if TINYFORMER_PROFILE
+/* Per-stage totals since tinyformer_profile_reset(): one "PROF <stage>
+ * cycles=C instret=N" line per stage, then the sum. With the perfmon block
+ * each is followed by "PERF <stage> cycle=.. imiss=.. ... gemv=..". Last,
+ * "PROF ffn_units total=U live=L": FFN hidden units after the ReLU and the
+ * non-zero ones among them (TINYFORMER_FFN_GATHER skips the others). */
+static void print_profile(void) {
+  static const char *const stage_name[TINYFORMER_PROF_COUNT] = {
+      "qkv", "attn", "oproj", "ffn", "head"};
+  tinyformer_profile_t p;
+  uint32_t cycles = 0, instret = 0;
+#if defined(USE_PERFMON_HW)
+  uint32_t perf[TINYFORMER_PERF_EVENTS] = {0};
+#endif
+  tinyformer_profile_read(&p);
+  uart_write_string("PROF samples=");
+  uart_write_uint32(p.samples);
+  uart_write_string("\r\n");
+  for (int st = 0; st <= TINYFORMER_PROF_COUNT; ++st) {
+    uint32_t c = (st < TINYFORMER_PROF_COUNT) ? p.cycles[st] : cycles;
+    uint32_t n = (st < TINYFORMER_PROF_COUNT) ? p.instret[st] : instret;
+    uart_write_string("PROF ");
+    uart_write_string((st < TINYFORMER_PROF_COUNT) ? stage_name[st] : "total");
+    uart_write_string(" cycles=");
+    uart_write_uint32(c);
+    uart_write_string(" instret=");
+    uart_write_uint32(n);
+    uart_write_string("\r\n");
+    cycles += c;
+    instret += n;
+#if defined(USE_PERFMON_HW)
+    uart_write_string("PERF ");
+    uart_write_string((st < TINYFORMER_PROF_COUNT) ? stage_name[st] : "total");
+    for (int e = 0; e < TINYFORMER_PERF_EVENTS; ++e) {
+      uint32_t v = (st < TINYFORMER_PROF_COUNT) ? p.perf[st][e] : perf[e];
+      uart_write_char(' ');
+      uart_write_string(perfmon_name(e));
+      uart_write_char('=');
+      uart_write_uint32(v);
+      perf[e] += v;
+    }
+    uart_write_string("\r\n");
+#endif
+  }
+  uart_write_string("PROF ffn_units total=");
+  uart_write_uint32(p.ffn_units);
+  uart_write_string(" live=");
+  uart_write_uint32(p.ffn_live);
+  uart_write_string("\r\n");
+}
+#endif
+
+#if TINYFORMER_LATENCY
+/* Tail latencies since tinyformer_profile_reset(): one "LAT <stage> n=N
+ * p50=C p95=C p99=C max=C" line per histogram with entries, the stages of
+ * print_profile() and then "call" (tinyformer_latency_record). */
+static void print_latency(void) {
+  static const char *const lat_name[TINYFORMER_LAT_COUNT] = {
+      "qkv", "attn", "oproj", "ffn", "head", "call"};
+  for (int l = 0; l < TINYFORMER_LAT_COUNT; ++l) {
+    tinyformer_latency_t t;
+    tinyformer_latency_read(l, &t);
+    if (t.count == 0) {
+      continue;
+    }
+    uart_write_string("LAT ");
+    uart_write_string(lat_name[l]);
+    uart_write_string(" n=");
+    uart_write_uint32(t.count);
+    uart_write_string(" p50=");
+    uart_write_uint32(t.p50);
+    uart_write_string(" p95=");
+    uart_write_uint32(t.p95);
+    uart_write_string(" p99=");
+    uart_write_uint32(t.p99);
+    uart_write_string(" max=");
+    uart_write_uint32(t.max);
+    uart_write_string("\r\n");
+  }
+}
+#endif
+
+#if TINYFORMER_RANGE_STATS
+/* Saturation and range counters since tinyformer_profile_reset(): one
+ * "RANGE <stage> n=N clip_hi=H clip_lo=L min=A max=B bits=W" line per stage
+ * with values, W being the signed width that holds [A, B]. */
+static void print_range(void) {
+  static const char *const rng_name[TINYFORMER_RNG_COUNT] = {
+      "q", "k", "v", "scores", "ctx", "o", "res1", "ff1", "ff2", "res2"};
+  for (int r = 0; r < TINYFORMER_RNG_COUNT; ++r) {
+    tinyformer_range_t t;
+    uint32_t bits = 1;
+    tinyformer_range_read(r, &t);
+    if (t.count == 0) {
+      continue;
+    }
+    while (bits < 32 && (t.min < -(int32_t)(1u << (bits - 1)) ||
+                         t.max > (int32_t)((1u << (bits - 1)) - 1u))) {
+      ++bits;
+    }
+    uart_write_string("RANGE ");
+    uart_write_string(rng_name[r]);
+    uart_write_string(" n=");
+    uart_write_uint32(t.count);
+    uart_write_string(" clip_hi=");
+    uart_write_uint32(t.clip_hi);
+    uart_write_string(" clip_lo=");
+    uart_write_uint32(t.clip_lo);
+    uart_write_string(" min=");
+    uart_write_int32(t.min);
+    uart_write_string(" max=");
+    uart_write_int32(t.max);
+    uart_write_string(" bits=");
+    uart_write_uint32(bits);
+    uart_write_string("\r\n");
+  }
+}
+#endif
+
+#if TINYFORMER_TRACE
+/* Dump the trace rings, oldest record first, and leave tracing off:
+ * "TRACE BEGIN harts=H", per hart "TRACE hart=h n=N lost=L" and one
+ * "T <hart> <cycle> <event> <arg>" line (hex) per record, then "TRACE END"
+ * (scripts/trace_to_chrome.py). */
+static void print_trace(void) {
+  tf_trace_enable(0);
+  uart_write_string("TRACE BEGIN harts=");
+  uart_write_uint32(TF_TRACE_HARTS);
+  uart_write_string("\r\n");
+  for (int h = 0; h < TF_TRACE_HARTS; ++h) {
+    uint32_t lost;
+    uint32_t n = tf_trace_count(h, &lost);
+    uart_write_string("TRACE hart=");
+    uart_write_uint32((uint32_t)h);
+    uart_write_string(" n=");
+    uart_write_uint32(n);
+    uart_write_string(" lost=");
+    uart_write_uint32(lost);
+    uart_write_string("\r\n");
+    for (uint32_t k = 0; k < n; ++k) {
+      const tf_trace_rec_t *r = tf_trace_at(h, k);
+      uart_write_string("T ");
+      uart_write_uint32((uint32_t)h);
+      uart_write_char(' ');
+      uart_write_hex32(r->cycle);
+      uart_write_char(' ');
+      uart_write_hex32(r->ev);
+      uart_write_char(' ');
+      uart_write_hex32(r->arg);
+      uart_write_string("\r\n");
+    }
+  }
+  uart_write_string("TRACE END\r\n");
+}
+#endif
+
+#if TINYFORMER_SHADOW && DEMO_STREAM
+/* "SHADOW windows=N compared=C label_mm=L cksum_mm=K max_diff=M
+ * fallback_at=F" (-1: still on the fast path). */
+static void print_shadow(const tf_shadow_t *sh) {
+  uart_write_string("SHADOW windows=");
+  uart_write_uint32(sh->st.windows);
+  uart_write_string(" compared=");
+  uart_write_uint32(sh->st.compared);
+  uart_write_string(" label_mm=");
+  uart_write_uint32(sh->st.label_mismatch);
+  uart_write_string(" cksum_mm=");
+  uart_write_uint32(sh->st.cksum_mismatch);
+  uart_write_string(" max_diff=");
+  uart_write_uint32(sh->st.logit_max_diff);
+  uart_write_string(" fallback_at=");
+  if (sh->st.fallback_at < 0) {
+    uart_write_string("-1");
+  } else {
+    uart_write_uint32((uint32_t)sh->st.fallback_at);
+  }
+  uart_write_string("\r\n");
+}
+#endif
+
+#if TINYFORMER_SMP
+/* The first sample on all harts (tinyformer_encode_smp) against one:
+ * "SMP harts=N single_cycles=C smp_cycles=C match=0|1". */
+static void demo_smp_report(void) {
+  static int8_t single[TINYFORMER_S][TINYFORMER_D], split[TINYFORMER_S][TINYFORMER_D];
+  uint32_t t0 = cycle_counter_read();
+  tinyformer_encode(demo_inputs[0], single);
+  uint32_t t1 = cycle_counter_read();
+  tinyformer_encode_smp(demo_inputs[0], split);
+  uint32_t t2 = cycle_counter_read();
+  int match = 1;
+  for (int s = 0; s < TINYFORMER_S; ++s) {
+    for (int d = 0; d < TINYFORMER_D; ++d) {
+      match &= single[s][d] == split[s][d];
+    }
+  }
+  uart_write_string("SMP harts=");
+  uart_write_uint32(TF_SMP_HARTS);
+  uart_write_string(" single_cycles=");
+  uart_write_uint32(t1 - t0);
+  uart_write_string(" smp_cycles=");
+  uart_write_uint32(t2 - t1);
+  uart_write_string(match ? " match=1\r\n" : " match=0\r\n");
+}
+#endif
+
+#if TINYFORMER_AUTOTUNE
+static tinyformer_tune_t s_tune; /* the dispatch table in use */
+
+/* "TUNE hw=0x<mask> exp=lut|sw", then one "TUNE <layer> <kernel> cycles=C"
+ * line per tuned layer. */
+static void print_tune(const tinyformer_tune_t *t) {
+  static const char *const layer_name[TINYFORMER_RQ_COUNT] = {
+      "q", "k", "v", "o", "ff1", "ff2", "qkv"};
+  static const char *const kernel_name[TINYFORMER_KERNEL_COUNT] = {
+      "cpu", "dot8", "gemv"};
+  uart_write_string("TUNE hw=");
+  uart_write_hex32(t->hw);
+  uart_write_string(t->exp_lut ? " exp=lut\r\n" : " exp=sw\r\n");
+  for (int l = 0; l < TINYFORMER_RQ_COUNT; ++l) {
+    if (l == TINYFORMER_RQ_QKV && !TINYFORMER_FUSED_QKV) {
+      continue;
+    }
+    uart_write_string("TUNE ");
+    uart_write_string(layer_name[l]);
+    uart_write_char(' ');
+    uart_write_string(kernel_name[t->kernel[l]]);
+    uart_write_string(" cycles=");
+    uart_write_uint32(t->cycles[l]);
+    uart_write_string("\r\n");
+  }
+}
+
+/* Boot-time backend pick (tinyformer_autotune), printed by print_tune(). */
+static void demo_autotune(void) {
+  tinyformer_autotune(0, &s_tune);
+  print_tune(&s_tune);
+}
+#endif
+
+#if defined(DEMO_MODEL_BLOB) && !DEMO_STREAM && TINYFORMER_TIERS
+static tf_tier_t model_tier;
+static int model_tier_loaded;
+
+/* Load tier DEMO_MODEL_TIER from the tier pack at DEMO_MODEL_BLOB. Returns
+ * its model, or 0 (the compiled-in model runs) if no blob of the pack loads. */
+static const tf_model_t *load_model_blob(void) {
+  int err = tf_tier_load(&model_tier, (const void *)(uintptr_t)(DEMO_MODEL_BLOB),
+                         DEMO_MODEL_BLOB_BYTES, DEMO_MODEL_TIER);
+  if (err == TF_BLOB_OK && model_tier.model.head.n_classes != DEMO_NUM_CLASSES) {
+    err = 100;
+  }
+  if (err != TF_BLOB_OK) {
+    uart_write_string("MODEL: built-in blob_error=");
+    uart_write_int32(err);
+    uart_write_string("\r\n");
+    return 0;
+  }
+  model_tier_loaded = 1;
+  uart_write_string("MODEL: tier=");
+  uart_write_string(model_tier.shape->name);
+  uart_write_string(" S=");
+  uart_write_uint32(model_tier.shape->S);
+  uart_write_string(" D=");
+  uart_write_uint32(model_tier.shape->D);
+  uart_write_string(" FFN=");
+  uart_write_uint32(model_tier.shape->FFN);
+  uart_write_string(" bytes=");
+  uart_write_uint32(model_tier.model.header->total_bytes);
+  uart_write_string("\r\n");
+  return &model_tier.model;
+}
+
+/* tinyformer_classify() on the loaded tier (head is its classifier then). */
+static int demo_tier_classify(const tinyformer_head_t *head,
+                              const int8_t input[TINYFORMER_S][TINYFORMER_D],
+                              int32_t *logits, uint32_t *cksum) {
+  if (model_tier_loaded) {
+    return tf_tier_classify(&model_tier, input, logits, cksum);
+  }
+  return tinyformer_classify(head, input, logits, cksum);
+}
+
+#define DEMO_CLASSIFY demo_tier_classify
+#elif defined(DEMO_MODEL_BLOB) && !DEMO_STREAM
+static uint8_t model_ws[TINYFORMER_WORKSPACE_BYTES] TINYFORMER_NOINIT __attribute__((aligned(8)));
+static tinyformer_ctx_t model_ctx;
+static tf_model_t model;
+
+/* Point model_ctx at the blob at DEMO_MODEL_BLOB. Returns the model, or 0
+ * (model_ctx keeps the compiled-in weights) if the blob does not load. */
+static const tf_model_t *load_model_blob(void) {
+  int err = tf_blob_load(&model, (const void *)(uintptr_t)(DEMO_MODEL_BLOB), DEMO_MODEL_BLOB_BYTES);
+  tinyformer_ctx_init(&model_ctx, model_ws, sizeof(model_ws));
+  if (err == TF_BLOB_OK && model.head.n_classes != DEMO_NUM_CLASSES) {
+    err = 100;
+  }
+  if (err != TF_BLOB_OK) {
+    uart_write_string("MODEL: built-in blob_error=");
+    uart_write_int32(err);
+    uart_write_string("\r\n");
+    return 0;
+  }
+  /* Heads missing from the blob: exits off on its classifier. */
+  if (model.exit_in.head.n_classes != DEMO_NUM_CLASSES) {
+    model.exit_in.head = model.head;
+    model.exit_in.margin = INT32_MAX;
+  }
+  if (model.exit_attn.head.n_classes != DEMO_NUM_CLASSES) {
+    model.exit_attn.head = model.head;
+    model.exit_attn.margin = INT32_MAX;
+  }
+  model_ctx.weights = &model.weights;
+  uart_write_string("MODEL: blob bytes=");
+  uart_write_uint32(model.header->total_bytes);
+  uart_write_string("\r\n");
+  return &model;
+}
+
+#define DEMO_CLASSIFY(...) tinyformer_classify_ctx(&model_ctx, __VA_ARGS__)
+#define DEMO_CLASSIFY_EARLY(...) tinyformer_classify_early_ctx(&model_ctx, __VA_ARGS__)
+#else
+#define DEMO_CLASSIFY tinyformer_classify
+#define DEMO_CLASSIFY_EARLY tinyformer_classify_early
+#endif
+
+#if !DEMO_STREAM && !DEMO_DUTY_CYCLE && !DEMO_UART_PROTO
+/* Replay the compiled-in samples: ENC_CKSUM and "Sample i" lines, then the
+ * EARLY_EXIT summary. boot adds the BOOT line (and the DEMO_FAST_BOOT
+ * reports) after the first sample and the PROF totals at the end. */
+static void demo_samples_run(int boot) {
+  static const tinyformer_head_t cls_head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+  const tinyformer_head_t *head = &cls_head;
+#if DEMO_EARLY_EXIT
+  static const tinyformer_exit_t exit_in_head = {
+      {&exit_in_W[0][0], exit_in_b, DEMO_NUM_CLASSES}, DEMO_EXIT_IN_MARGIN};
+  static const tinyformer_exit_t exit_attn_head = {
+      {&exit_attn_W[0][0], exit_attn_b, DEMO_NUM_CLASSES}, DEMO_EXIT_ATTN_MARGIN};
+  const tinyformer_exit_t *exit_in = &exit_in_head, *exit_attn = &exit_attn_head;
+  static const char *const stage_name[] = {"in", "attn", "full"};
+  uint32_t n_stage[3] = {0, 0, 0};
+  uint32_t n_agree = 0;
+  uint32_t full_cycles = 0;
+  int32_t saved_cycles = 0;
+#endif
+#if defined(DEMO_MODEL_BLOB)
+  const tf_model_t *blob = load_model_blob();
+  if (blob) {
+    head = &blob->head;
+#if DEMO_EARLY_EXIT
+    exit_in = &blob->exit_in;
+    exit_attn = &blob->exit_attn;
+#endif
+  }
+#endif
+  uint32_t first_pred_cycles = 0;
   for (uint32_t i = 0; i < (uint32_t)DEMO_NUM_SAMPLES; ++i) {
-    static int8_t encoded[TINYFORMER_S][TINYFORMER_D];
-    static int8_t pooled[TINYFORMER_D];
     int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum;
 
-    tinyformer_encode(demo_inputs[i], encoded);
+#if DEMO_EARLY_EXIT
+    int stage;
+    TF_TRACE(TF_EV_SAMPLE, i);
+    uint32_t t0 = cycle_counter_read();
+    uint32_t best_idx = (uint32_t)DEMO_CLASSIFY_EARLY(
+        head, exit_in, exit_attn, demo_inputs[i], logits, &cksum, &stage);
+    uint32_t t1 = cycle_counter_read();
+    uint32_t full_idx = (uint32_t)DEMO_CLASSIFY(head, demo_inputs[i], logits, &cksum);
+    uint32_t t2 = cycle_counter_read();
+    n_stage[stage]++;
+    n_agree += (best_idx == full_idx);
+    full_cycles += t2 - t1;
+    saved_cycles += (int32_t)((t2 - t1) - (t1 - t0));
+    tinyformer_latency_record(t1 - t0);
+    TF_TRACE(TF_EV_SAMPLE_END, i);
+#else
+    /* Encoder, mean pool and head in one pass; no [S][D] output buffer. */
+    TF_TRACE(TF_EV_SAMPLE, i);
+    uint32_t t0 = cycle_counter_read();
+    uint32_t best_idx = (uint32_t)DEMO_CLASSIFY(head, demo_inputs[i], logits, &cksum);
+    tinyformer_latency_record(cycle_counter_read() - t0);
+    TF_TRACE(TF_EV_SAMPLE_END, i);
+#endif
+    if (i == 0) {
+      first_pred_cycles = cycle_counter_read();
+    }
 
     /* Shared correctness checksum: must match baseline and all accelerated
      * modes. */
+    uart_write_string("ENC_CKSUM=0x");
+    uart_write_hex32(cksum);
+    uart_write_string("\r\n");
+
+    uart_write_string("Sample ");
+    uart_write_uint32(i);
+    uart_write_string(": pred=");
+    uart_write_uint32(best_idx);
+    uart_write_string(" exp=");
+    uart_write_uint32((uint32_t)demo_labels[i]);
+#if DEMO_EARLY_EXIT
+    uart_write_string(" exit=");
+    uart_write_string(stage_name[stage]);
+#endif
+    uart_write_string("\r\n");
+    if (i == 0 && boot) {
+      uart_write_string("BOOT first_pred_cycles=");
+      uart_write_uint32(first_pred_cycles);
+      uart_write_string("\r\n");
+#if DEMO_FAST_BOOT
+      print_sram_usage();
+#if TINYFORMER_AUTOTUNE
+      demo_autotune();
+      tinyformer_profile_reset();
+#endif
+#endif
+    }
+  }
+#if DEMO_EARLY_EXIT
+  /* Saved = full-path cycles minus early-exit cycles (exit-check overhead
+   * included, so it is negative when nothing exits). */
+  uart_write_string("EARLY_EXIT in=");
+  uart_write_uint32(n_stage[TINYFORMER_EXIT_INPUT]);
+  uart_write_string(" attn=");
+  uart_write_uint32(n_stage[TINYFORMER_EXIT_ATTN]);
+  uart_write_string(" full=");
+  uart_write_uint32(n_stage[TINYFORMER_EXIT_NONE]);
+  uart_write_string(" rate_pct=");
+  uart_write_uint32((n_stage[TINYFORMER_EXIT_INPUT] + n_stage[TINYFORMER_EXIT_ATTN]) * 100u /
+                    (uint32_t)DEMO_NUM_SAMPLES);
+  uart_write_string(" agree=");
+  uart_write_uint32(n_agree);
+  uart_write_string(" avg_full_cycles=");
+  uart_write_uint32(full_cycles / (uint32_t)DEMO_NUM_SAMPLES);
+  uart_write_string(" avg_saved_cycles=");
+  uart_write_int32(saved_cycles / (int32_t)DEMO_NUM_SAMPLES);
+  uart_write_string("\r\n");
+#endif
+#if TINYFORMER_PROFILE
+  if (boot) {
+    print_profile();
+#if TINYFORMER_LATENCY
+    print_latency();
+#endif
+  }
+#endif
+#if TINYFORMER_RANGE_STATS
+  if (boot) {
+    print_range();
+  }
+#endif
+#if TINYFORMER_TRACE
+  if (boot) {
+    print_trace();
+  }
+#endif
+}
+#endif
+
+#if TINYFORMER_BENCH_SUITE
+/* ---- Benchmark suite ---- */
+#define SUITE_W_BYTES (4 * TINYFORMER_MAX_D * TINYFORMER_MAX_D + 2 * TINYFORMER_MAX_D * TINYFORMER_MAX_FFN)
+#define SUITE_B_BYTES (5 * TINYFORMER_MAX_D + TINYFORMER_MAX_FFN)
+
+typedef void (*suite_encode_fn)(const tinyformer_weights_t *w, const int8_t *in, int8_t *out);
+
+/* The instances take [S][D] arrays; the table takes their rows flat. */
+#define SUITE_ENCODE(name, S, D, FFN)                                              \
+  static void name##_suite(const tinyformer_weights_t *w, const int8_t *in,       \
+                           int8_t *out) {                                          \
+    name(w, (const int8_t(*)[D])(const void *)in, (int8_t(*)[D])(void *)out);     \
+  }
+SUITE_ENCODE(tinyformer_encode_with, TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN)
+TINYFORMER_SHAPES(SUITE_ENCODE)
+#undef SUITE_ENCODE
+
+/* Models: har first, then the TINYFORMER_SHAPES entries named after their
+ * instance without the "tinyformer_encode_" prefix. */
+#define SUITE_MODEL(name, S, D, FFN) \
+  {#name + sizeof("tinyformer_encode_") - 1, S, D, FFN, name##_suite},
+static const struct {
+  const char *name;
+  int32_t S, D, FFN;
+  suite_encode_fn encode;
+} s_suite_model[] = {
+    {"har", TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN, tinyformer_encode_with_suite},
+    TINYFORMER_SHAPES(SUITE_MODEL)};
+#undef SUITE_MODEL
+
+#define SUITE_MODELS (sizeof(s_suite_model) / sizeof(s_suite_model[0]))
+
+static const char *const suite_backend_name[] = {"cpu", "dot8", "gemv", "lut", "all"};
+static const uint32_t suite_backend[] = {
+    0, TINYFORMER_HW_DOT8, TINYFORMER_HW_GEMV, TINYFORMER_HW_EXP_LUT,
+    TINYFORMER_HW_DOT8 | TINYFORMER_HW_GEMV | TINYFORMER_HW_EXP_LUT};
+
+/* Synthetic weight set and input of the models other than har. */
+static int8_t s_suite_w[SUITE_W_BYTES];
+static int8_t s_suite_b[SUITE_B_BYTES];
+static int8_t s_suite_in[TINYFORMER_MAX_S * TINYFORMER_MAX_D] __attribute__((aligned(4)));
+static int8_t s_suite_out[TINYFORMER_MAX_S * TINYFORMER_MAX_D] __attribute__((aligned(4)));
+
+static int8_t suite_rand(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  return (int8_t)((int32_t)(*seed >> 24) % 8);
+}
+
+/* Fill the pools from seed and point w at a D / FFN model in them. */
+static void suite_synth(tinyformer_weights_t *w, int32_t S, int32_t D, int32_t FFN, uint32_t seed) {
+  static const tinyformer_weights_t none = {0};
+  const int8_t *p = s_suite_w, *b = s_suite_b;
+  int32_t i;
+  for (i = 0; i < 4 * D * D + 2 * D * FFN; ++i) {
+    s_suite_w[i] = suite_rand(&seed);
+  }
+  for (i = 0; i < 5 * D + FFN; ++i) {
+    s_suite_b[i] = suite_rand(&seed);
+  }
+  for (i = 0; i < S * D; ++i) {
+    s_suite_in[i] = suite_rand(&seed);
+  }
+  *w = none;
+  w->W_q = p;
+  w->W_k = p + D * D;
+  w->W_v = p + 2 * D * D;
+  w->W_o = p + 3 * D * D;
+  w->W_ff1 = p + 4 * D * D;
+  w->W_ff2 = p + 4 * D * D + FFN * D;
+  w->b_q = b;
+  w->b_k = b + D;
+  w->b_v = b + 2 * D;
+  w->b_o = b + 3 * D;
+  w->b_ff1 = b + 4 * D;
+  w->b_ff2 = b + 4 * D + FFN;
+}
+
+/* "SUITE model=.." line of model k on backend set j: the median and best of
+ * DEMO_SUITE_RUNS encoder passes. */
+static void suite_bench(uint32_t k, uint32_t j, const tinyformer_weights_t *w, const int8_t *in) {
+  static const char *const kernel_name[TINYFORMER_KERNEL_COUNT] = {"cpu", "dot8", "gemv"};
+  const int32_t S = s_suite_model[k].S, D = s_suite_model[k].D, FFN = s_suite_model[k].FFN;
+  const int32_t d_in = (w->d_in > 0 && w->d_in < D) ? w->d_in : D;
+  const int32_t mv[4][2] = {{d_in, D}, {D, D}, {D, FFN}, {FFN, D}};
+  static const char *const mv_name[4] = {" qkv=", " o=", " ff1=", " ff2="};
+  uint32_t c[DEMO_SUITE_RUNS];
+  uint32_t cksum = 0;
+  int32_t r, i;
+
+  for (r = 0; r < DEMO_SUITE_RUNS; ++r) {
+    uint32_t t0 = cycle_counter_read();
+    s_suite_model[k].encode(w, in, s_suite_out);
+    uint32_t t = cycle_counter_read() - t0;
+    for (i = r; i > 0 && c[i - 1] > t; --i) {
+      c[i] = c[i - 1];
+    }
+    c[i] = t;
+  }
+  for (i = 0; i < S * D; ++i) {
+    cksum += (uint8_t)s_suite_out[i];
+  }
+
+  uart_write_string("SUITE model=");
+  uart_write_string(s_suite_model[k].name);
+  uart_write_string(" S=");
+  uart_write_uint32((uint32_t)S);
+  uart_write_string(" D=");
+  uart_write_uint32((uint32_t)D);
+  uart_write_string(" FFN=");
+  uart_write_uint32((uint32_t)FFN);
+  uart_write_string(" backend=");
+  uart_write_string(suite_backend_name[j]);
+  uart_write_string(" cycles=");
+  uart_write_uint32(c[DEMO_SUITE_RUNS / 2]);
+  uart_write_string(" best=");
+  uart_write_uint32(c[0]);
+  uart_write_string(" macs=");
+  uart_write_uint32((uint32_t)(S * (3 * d_in * D + D * D + 2 * D * FFN) + 2 * S * S * D));
+  uart_write_string(" sram=");
+  uart_write_uint32((uint32_t)TINYFORMER_INSTANCE_BYTES(S, D, FFN));
+  uart_write_string(" weights=");
+  uart_write_uint32((uint32_t)(3 * d_in * D + D * D + 2 * D * FFN + 5 * D + FFN));
+  for (i = 0; i < 4; ++i) {
+    uart_write_string(mv_name[i]);
+    uart_write_string(kernel_name[tinyformer_kernel_for(mv[i][0], mv[i][1])]);
+  }
+  uart_write_string(s_tune.exp_lut ? " exp=lut" : " exp=sw");
+  uart_write_string(" cksum=0x");
+  uart_write_hex32(cksum);
+  uart_write_string("\r\n");
+}
+
+void demo_suite_run(void) {
+  uint32_t n_backends = 0, j, k;
+  int n_hw = ((s_tune.hw & TINYFORMER_HW_DOT8) != 0) + ((s_tune.hw & TINYFORMER_HW_GEMV) != 0) +
+             ((s_tune.hw & TINYFORMER_HW_EXP_LUT) != 0);
+  uint32_t use[sizeof(suite_backend) / sizeof(suite_backend[0])];
+
+  /* Backend sets the probes found; "all" only if it differs from each one. */
+  for (j = 0; j < sizeof(suite_backend) / sizeof(suite_backend[0]); ++j) {
+    use[j] = j + 1 == sizeof(suite_backend) / sizeof(suite_backend[0])
+                 ? n_hw >= 2
+                 : (suite_backend[j] & ~s_tune.hw) == 0;
+    n_backends += use[j];
+  }
+  uart_write_string("SUITE BEGIN models=");
+  uart_write_uint32((uint32_t)SUITE_MODELS);
+  uart_write_string(" backends=");
+  uart_write_uint32(n_backends);
+  uart_write_string(" runs=");
+  uart_write_uint32((uint32_t)DEMO_SUITE_RUNS);
+  uart_write_string(" hw=");
+  uart_write_hex32(s_tune.hw);
+  uart_write_string("\r\n");
+  for (j = 0; j < sizeof(suite_backend) / sizeof(suite_backend[0]); ++j) {
+    if (!use[j]) {
+      continue;
+    }
+    tinyformer_select_backends(0, suite_backend[j], &s_tune);
+    for (k = 0; k < SUITE_MODELS; ++k) {
+      tinyformer_weights_t synth;
+      if (k == 0) {
+        suite_bench(k, j, &tinyformer_default_weights, &demo_inputs[0][0][0]);
+      } else {
+        suite_synth(&synth, s_suite_model[k].S, s_suite_model[k].D, s_suite_model[k].FFN,
+                    0x9E3779B9u + k);
+        suite_bench(k, j, &synth, s_suite_in);
+      }
+    }
+  }
+  uart_write_string("SUITE END\r\n");
+  demo_autotune();
+}
+#endif
+
+void demo_run(void) {
+#if UART_TX_IRQ
+  uart_tx_irq_init();
+#endif
+#if defined(USE_GEMV_HW) && GEMV_IRQ
+  gemv_irq_init();
+#endif
+  tf_trace_reset();
+#if !DEMO_FAST_BOOT || DEMO_STREAM || DEMO_UART_PROTO || DEMO_CONSOLE || TINYFORMER_BENCH_SUITE
+#if TINYFORMER_AUTOTUNE
+  demo_autotune();
+#endif
+  print_sram_usage();
+#if TINYFORMER_SMP
+  demo_smp_report();
+#endif
+#endif
+  tinyformer_profile_reset();
+#if DEMO_STREAM_PIPE
+  demo_stream_pipe_run(0);
+#elif DEMO_STREAM
+  demo_stream_run(0);
+#elif DEMO_DUTY_CYCLE
+  demo_duty_run(0);
+#elif DEMO_UART_PROTO
+  demo_proto_run();
+#elif DEMO_CONSOLE
+  demo_console_run();
+#elif TINYFORMER_BENCH_SUITE
+  demo_suite_run();
+  tinyformer_profile_reset();
+  demo_samples_run(0);
+#else
+  demo_samples_run(1);
+#endif
+#if TINYFORMER_STACK_PAINT
+  print_stack();
+#endif
+  uart_tx_flush();
+}
+
+/* ---- Binary protocol server ---- */
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+void demo_proto_run(void) {
+  static const tinyformer_head_t cls_head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+  static uf_rx_t rx;
+  static int8_t window[TINYFORMER_S][TINYFORMER_D] __attribute__((aligned(4)));
+  static uint8_t reply[12 + 4 * DEMO_NUM_CLASSES];
+  const tinyformer_head_t *head = &cls_head;
+  uint8_t model = 0;
+
+#if defined(DEMO_MODEL_BLOB) && !DEMO_STREAM
+  const tf_model_t *blob = load_model_blob();
+  if (blob) {
+    head = &blob->head;
+    model = 1;
+  }
+#endif
+  uf_rx_reset(&rx);
+  for (;;) {
+    int n = uf_recv(&rx);
+    uint8_t code;
+    if (n < 0) {
+      code = (uint8_t)-n;
+      uf_send(UF_T_ERROR, 0, &code, 1);
+      continue;
+    }
+    uint8_t type = rx.buf[0], seq = rx.buf[1];
+    uint32_t body = (uint32_t)n - 2u;
+
+    if (type == UF_T_WINDOW && body == (uint32_t)(TINYFORMER_S * TINYFORMER_D)) {
+      int32_t logits[DEMO_NUM_CLASSES];
+      uint32_t cksum;
+      /* payload + 2 is only 2-byte aligned; the kernels may load words */
+      for (uint32_t k = 0; k < body; ++k) {
+        window[k / TINYFORMER_D][k % TINYFORMER_D] = (int8_t)rx.buf[2 + k];
+      }
+      uint32_t t0 = cycle_counter_read();
+      int pred = DEMO_CLASSIFY(head, window, logits, &cksum);
+      uint32_t t1 = cycle_counter_read();
+      reply[0] = (uint8_t)pred;
+      reply[1] = DEMO_NUM_CLASSES;
+      reply[2] = 0;
+      reply[3] = 0;
+      put_u32(&reply[4], cksum);
+      put_u32(&reply[8], t1 - t0);
+      for (int c = 0; c < DEMO_NUM_CLASSES; ++c) {
+        put_u32(&reply[12 + 4 * c], (uint32_t)logits[c]);
+      }
+      uf_send(UF_T_RESULT, seq, reply, sizeof(reply));
+    } else if (type == UF_T_HELLO && body == 0) {
+      uint8_t info[8] = {UF_VERSION, TINYFORMER_S, TINYFORMER_D, DEMO_NUM_CLASSES,
+                         (uint8_t)UF_MAX_BODY, (uint8_t)(UF_MAX_BODY >> 8), model, 0};
+      uf_send(UF_T_INFO, seq, info, sizeof(info));
+    } else if (type == UF_T_STOP && body == 0) {
+      uf_send(UF_T_ACK, seq, 0, 0);
+      return;
+    } else {
+      code = (type == UF_T_WINDOW || type == UF_T_HELLO || type == UF_T_STOP) ? UF_E_LENGTH
+                                                                           : UF_E_TYPE;
+      uf_send(UF_T_ERROR, seq, &code, 1);
+    }
+  }
+}
+
+/* ---- Streaming classifier ---- */
+
+#if DEMO_STREAM_HOP < 1 || DEMO_STREAM_HOP > TINYFORMER_S
+#error "DEMO_STREAM_HOP must be in 1..TINYFORMER_S"
+#endif
+#if STREAM_RING_FRAMES < TINYFORMER_S + DEMO_STREAM_HOP
+#error "STREAM_RING_FRAMES must hold at least one window plus one hop"
+#endif
+
+static stream_ring_t s_stream_ring;
+
+int demo_stream_push(const int8_t frame[TINYFORMER_D]) {
+  return stream_ring_push(&s_stream_ring, frame);
+}
+
+uint32_t demo_stream_room(void) {
+  return (uint32_t)STREAM_RING_FRAMES - stream_ring_count(&s_stream_ring);
+}
+
+#if DEMO_STREAM_IMU
+static imu_feat_t s_stream_feat;
+
+/* One raw sample into the feature stage; queues the frame it completes. */
+static void stream_push_sample(const int16_t sample[IMU_FEAT_CHANNELS]) {
+  int8_t frame[TINYFORMER_D];
+  if (imu_feat_push(&s_stream_feat, sample, frame)) {
+    (void)demo_stream_push(frame);
+  }
+}
+#endif
+
+#if DEMO_STREAM_DMA
+#if TINYFORMER_D % 4 != 0
+#error "DEMO_STREAM_DMA writes whole words: TINYFORMER_D must be a multiple of 4"
+#endif
+
+/* Written by the capture block only; frame n in slot n % STREAM_RING_FRAMES. */
+static int8_t s_dma_frames[STREAM_RING_FRAMES][TINYFORMER_D] __attribute__((aligned(4)));
+static uint32_t s_dma_tail; /* frames released to the block */
+
+static void stream_src_start(void) {
+  s_dma_tail = 0;
+  sensor_dma_start(s_dma_frames, STREAM_RING_FRAMES, TINYFORMER_D, DEMO_STREAM_HOP);
+#if SENSOR_DMA_IRQ
+  sensor_dma_irq_init();
+#endif
+}
+
+/* View of the oldest S captured frames, in place; 0 if fewer have arrived. */
+static int stream_src_window(tinyformer_input_t *v) {
+  if (sensor_dma_head() - s_dma_tail < TINYFORMER_S) {
+    return 0;
+  }
+  v->base = &s_dma_frames[0][0];
+  v->stride = TINYFORMER_D;
+  v->rows = STREAM_RING_FRAMES;
+  v->first = (int32_t)(s_dma_tail & (STREAM_RING_FRAMES - 1));
+  return 1;
+}
+
+/* Single-hart idle: sleep until the block has a window. */
+static void stream_src_wait(void) {
+  (void)sensor_dma_wait(s_dma_tail, TINYFORMER_S);
+}
+
+static void stream_src_release(uint32_t n) {
+  s_dma_tail += n;
+  sensor_dma_release(s_dma_tail);
+}
+
+static uint32_t stream_src_dropped(void) {
+  return sensor_dma_dropped();
+}
+#elif DEMO_STREAM_SENSOR_IRQ
+void demo_stream_sensor_isr(void) {
+#if DEMO_STREAM_IMU
+  int16_t sample[IMU_FEAT_CHANNELS];
+  demo_stream_sensor_read_imu(sample);
+  stream_push_sample(sample);
+#else
+  int8_t frame[TINYFORMER_D];
+  demo_stream_sensor_read(frame);
+  (void)demo_stream_push(frame);
+#endif
+}
+#elif DEMO_STREAM_IMU
+/* Drain the UART RX FIFO into the feature stage, IMU_FEAT_CHANNELS int16 Q12
+ * little-endian per sample. */
+static void stream_poll_uart(void) {
+  static uint8_t bytes[2 * IMU_FEAT_CHANNELS];
+  static int fill;
+  while (uart_read_ready()) {
+    bytes[fill++] = (uint8_t)uart_read_char();
+    if (fill == (int)sizeof(bytes)) {
+      int16_t sample[IMU_FEAT_CHANNELS];
+      for (int c = 0; c < IMU_FEAT_CHANNELS; ++c) {
+        sample[c] = (int16_t)(uint16_t)(bytes[2 * c] | (bytes[2 * c + 1] << 8));
+      }
+      stream_push_sample(sample);
+      fill = 0;
+    }
+  }
+}
+#else
+/* Drain the UART RX FIFO into the ring, TINYFORMER_D bytes per frame. Bytes
+ * that arrive while a window is being encoded wait in the UART FIFO; a FIFO
+ * overrun there is not visible to the ring's drop counter. */
+static void stream_poll_uart(void) {
+  static int8_t frame[TINYFORMER_D];
+  static int fill;
+  while (uart_read_ready()) {
+    frame[fill++] = (int8_t)uart_read_char();
+    if (fill == TINYFORMER_D) {
+      (void)demo_stream_push(frame);
+      fill = 0;
+    }
+  }
+}
+#endif
+
+#if !DEMO_STREAM_DMA
+static void stream_src_start(void) {
+#if DEMO_STREAM_SENSOR_IRQ
+  demo_stream_sensor_init();
+#endif
+}
+
+/* View of the oldest S ring frames, in place; 0 if fewer are queued. */
+static int stream_src_window(tinyformer_input_t *v) {
+#if !DEMO_STREAM_SENSOR_IRQ
+  stream_poll_uart();
+#endif
+  if (stream_ring_count(&s_stream_ring) < TINYFORMER_S) {
+    return 0;
+  }
+  stream_ring_window(&s_stream_ring, v);
+  return 1;
+}
+
+static void stream_src_wait(void) {}
+
+static void stream_src_release(uint32_t n) {
+  stream_ring_release(&s_stream_ring, n);
+}
+
+static uint32_t stream_src_dropped(void) {
+  return s_stream_ring.dropped;
+}
+#endif
+
+#if DEMO_STREAM_GATE
+/* "GATE windows=N skipped=K cycles_per_window=C" over the last n windows. */
+static void print_gate(const stream_gate_t *g, uint32_t cycles, uint32_t n) {
+  uart_write_string("GATE windows=");
+  uart_write_uint32(g->windows);
+  uart_write_string(" skipped=");
+  uart_write_uint32(g->skipped);
+  uart_write_string(" cycles_per_window=");
+  uart_write_uint32(cycles / n);
+  uart_write_string("\r\n");
+}
+#endif
+
+void demo_stream_run(uint32_t max_windows) {
+  static int8_t encoded[TINYFORMER_S][TINYFORMER_D];
+  uint32_t need = TINYFORMER_S; /* first window fills all S rows */
+  uint32_t pred = 0;
+#if DEMO_STREAM_GATE
+  static stream_gate_t gate;
+  uint32_t gate_cycles = 0;
+  int gated;
+  stream_gate_init(&gate, DEMO_GATE_THRESHOLD, DEMO_GATE_MAX_SKIP);
+#endif
+#if TINYFORMER_SHADOW && DEMO_STREAM
+  static const tinyformer_head_t cls_head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+  static tf_shadow_t shadow;
+  (void)tf_shadow_init(&shadow, 0, TF_SHADOW_REF, &cls_head);
+#endif
+
+  stream_src_start();
+  uart_write_string("STREAM hop=");
+  uart_write_uint32(DEMO_STREAM_HOP);
+  uart_write_string("\r\n");
+
+  for (uint32_t n = 0; max_windows == 0 || n < max_windows;) {
+    /* The window is read in place from the ring; only the new frames get
+     * K/V projections. The oldest hop frames are then freed for the
+     * producer, the rest stay for the next window. */
+    tinyformer_input_t view;
+    if (!stream_src_window(&view)) {
+#if TINYFORMER_SHADOW && DEMO_STREAM
+      /* idle: check the sampled window before sleeping */
+      if (tf_shadow_idle(&shadow)) {
+        continue;
+      }
+#endif
+      stream_src_wait();
+      continue;
+    }
+    TF_TRACE(TF_EV_SAMPLE, n);
+    uint32_t t0 = cycle_counter_read();
+#if DEMO_STREAM_GATE
+    gated = stream_gate_check(&gate, &view);
+    if (gated) {
+      /* pred stands; the next encode also projects this window's new rows */
+      stream_src_release(DEMO_STREAM_HOP);
+      need = (need + DEMO_STREAM_HOP < TINYFORMER_S) ? need + DEMO_STREAM_HOP : TINYFORMER_S;
+    } else
+#endif
+    {
+#if TINYFORMER_SHADOW && DEMO_STREAM
+      (void)tf_shadow_encode_view(&shadow, &view, (int)need, encoded);
+#else
+      (void)tinyformer_encode_view(&view, (int)need, encoded);
+#endif
+      stream_src_release(DEMO_STREAM_HOP);
+      need = DEMO_STREAM_HOP;
+      pred = classify_encoded(encoded);
+    }
+    uint32_t dt = cycle_counter_read() - t0;
+    tinyformer_latency_record(dt);
+    TF_TRACE(TF_EV_SAMPLE_END, n);
+
+    uart_write_string("Window ");
+    uart_write_uint32(n);
+    uart_write_string(": pred=");
+    uart_write_uint32(pred);
+    uart_write_string(" dropped=");
+    uart_write_uint32(stream_src_dropped());
+#if DEMO_STREAM_GATE
+    if (gated) {
+      uart_write_string(" gated");
+    }
+#endif
+    uart_write_string("\r\n");
+    ++n;
+#if TINYFORMER_LATENCY
+    if (n % DEMO_LAT_REPORT == 0) {
+      print_latency();
+    }
+#endif
+#if TINYFORMER_TRACE
+    if (n == DEMO_TRACE_WINDOWS) {
+      print_trace();
+    }
+#endif
+#if TINYFORMER_SHADOW && DEMO_STREAM
+    if (n % DEMO_SHADOW_REPORT == 0) {
+      print_shadow(&shadow);
+    }
+#endif
+#if DEMO_STREAM_GATE
+    gate_cycles += dt;
+    if (n % DEMO_GATE_REPORT == 0) {
+      print_gate(&gate, gate_cycles, DEMO_GATE_REPORT);
+      gate_cycles = 0;
+    }
+#endif
+  }
+}
+
+#if TINYFORMER_SMP
+/* ---- Stage-pipelined streaming classifier (two harts) ---- */
+
+#if TF_SMP_HARTS < 2
+#error "demo_stream_pipe_run needs TF_SMP_HARTS >= 2"
+#endif
+
+/* One window in flight: filled by the front half on hart 0, finished by the
+ * back half on hart 1, its line printed and the slot reused by hart 0. */
+typedef struct {
+  tinyformer_stage_t stage;
+  int32_t pred;
+  uint32_t back_cycles; /* hart 1: back half */
+  uint32_t back_wait;   /* hart 1: waiting for this slot to be filled */
+} pipe_slot_t;
+
+static pipe_slot_t s_pipe_slot[DEMO_PIPE_SLOTS];
+/* Windows filled (written by hart 0) and finished (by hart 1); slot of
+ * window n is n % DEMO_PIPE_SLOTS. */
+static tf_smp_word_t s_pipe_filled, s_pipe_done;
+
+/* Per-window averages and busy shares since the last report. */
+typedef struct {
+  uint32_t windows, start, front, back, front_full, back_empty;
+} pipe_stats_t;
+
+static void pipe_report(pipe_stats_t *st, uint32_t total) {
+  uint32_t elapsed = (cycle_counter_read() - st->start) / 100u;
+  uint32_t n = st->windows;
+  if (n == 0) {
+    return;
+  }
+  if (elapsed == 0) {
+    elapsed = 1;
+  }
+  uart_write_string("PIPE windows=");
+  uart_write_uint32(total);
+  uart_write_string(" front=");
+  uart_write_uint32(st->front / n);
+  uart_write_string(" back=");
+  uart_write_uint32(st->back / n);
+  uart_write_string(" front_full=");
+  uart_write_uint32(st->front_full / n);
+  uart_write_string(" back_empty=");
+  uart_write_uint32(st->back_empty / n);
+  uart_write_string(" front_pct=");
+  uart_write_uint32(st->front / elapsed);
+  uart_write_string(" back_pct=");
+  uart_write_uint32(st->back / elapsed);
+  uart_write_string("\r\n");
+  st->windows = st->front = st->back = st->front_full = st->back_empty = 0;
+  st->start = cycle_counter_read();
+}
+
+/* Hart 0: poll the ring, run the front half into a free slot, print the
+ * finished windows in order. */
+static void pipe_front(uint32_t max_windows) {
+  uint32_t filled = 0, freed = 0, need = TINYFORMER_S;
+  uint32_t full_since = 0;
+  int full = 0;
+  pipe_stats_t st = {0, 0, 0, 0, 0, 0};
+
+  st.start = cycle_counter_read();
+  while (max_windows == 0 || freed < max_windows) {
+    while (freed != s_pipe_done.v) {
+      const pipe_slot_t *slot = &s_pipe_slot[freed % DEMO_PIPE_SLOTS];
+      TF_SMP_FENCE();
+      uart_write_string("Window ");
+      uart_write_uint32(freed);
+      uart_write_string(": pred=");
+      uart_write_uint32((uint32_t)slot->pred);
+      uart_write_string(" dropped=");
+      uart_write_uint32(stream_src_dropped());
+      uart_write_string("\r\n");
+      st.back += slot->back_cycles;
+      st.back_empty += slot->back_wait;
+      st.windows++;
+      ++freed;
+      if (st.windows == DEMO_PIPE_REPORT) {
+        pipe_report(&st, freed);
+      }
+#if TINYFORMER_TRACE
+      if (freed == DEMO_TRACE_WINDOWS) {
+        print_trace();
+      }
+#endif
+    }
+    if (max_windows != 0 && filled == max_windows) {
+      TF_SMP_RELAX();
+      continue;
+    }
+    tinyformer_input_t view;
+    if (!stream_src_window(&view)) {
+      TF_SMP_RELAX();
+      continue;
+    }
+    if (filled - freed >= (uint32_t)DEMO_PIPE_SLOTS) {
+      if (!full) {
+        full_since = cycle_counter_read();
+        full = 1;
+      }
+      TF_SMP_RELAX();
+      continue;
+    }
+    uint32_t t0 = cycle_counter_read();
+    if (full) {
+      st.front_full += t0 - full_since;
+      full = 0;
+    }
+    TF_TRACE(TF_EV_SAMPLE, filled);
+    (void)tinyformer_encode_front(&view, (int)need, &s_pipe_slot[filled % DEMO_PIPE_SLOTS].stage);
+    stream_src_release(DEMO_STREAM_HOP);
+    need = DEMO_STREAM_HOP;
+    st.front += cycle_counter_read() - t0;
+    TF_TRACE(TF_EV_SAMPLE_END, filled);
+    TF_SMP_FENCE();
+    s_pipe_filled.v = ++filled;
+  }
+  if (st.windows != 0) {
+    pipe_report(&st, freed);
+  }
+}
+
+/* Hart 1: the back half of every filled slot, in order. */
+static void pipe_back(uint32_t max_windows) {
+  static const tinyformer_head_t cls_head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+  int32_t logits[DEMO_NUM_CLASSES];
+
+  for (uint32_t n = 0; max_windows == 0 || n < max_windows; ++n) {
+    pipe_slot_t *slot = &s_pipe_slot[n % DEMO_PIPE_SLOTS];
+    uint32_t t0 = cycle_counter_read();
+    while (s_pipe_filled.v == n) {
+      TF_SMP_RELAX();
+    }
+    TF_SMP_FENCE();
+    uint32_t t1 = cycle_counter_read();
+    TF_TRACE(TF_EV_SAMPLE, n);
+    slot->pred = tinyformer_classify_back(1, &cls_head, &slot->stage, logits, 0);
+    TF_TRACE(TF_EV_SAMPLE_END, n);
+    slot->back_wait = t1 - t0;
+    slot->back_cycles = cycle_counter_read() - t1;
+    TF_SMP_FENCE();
+    s_pipe_done.v = n + 1u;
+  }
+}
+
+static void pipe_job(void *arg, int hart) {
+  uint32_t max_windows = *(const uint32_t *)arg;
+  if (hart == 0) {
+    pipe_front(max_windows);
+  } else if (hart == 1) {
+    pipe_back(max_windows);
+  }
+}
+
+void demo_stream_pipe_run(uint32_t max_windows) {
+  stream_src_start();
+  uart_write_string("STREAM hop=");
+  uart_write_uint32(DEMO_STREAM_HOP);
+  uart_write_string(" pipe slots=");
+  uart_write_uint32(DEMO_PIPE_SLOTS);
+  uart_write_string("\r\n");
+  s_pipe_filled.v = 0;
+  s_pipe_done.v = 0;
+  tf_smp_run(pipe_job, &max_windows);
+}
+#endif
+
+/* ---- Duty-cycled classifier ---- */
+
+#if DEMO_DUTY_CYCLE
+/* timer0 (LiteX Timer): periodic zero event every `cycles` system clocks. */
+#ifndef DEMO_DUTY_TIMER_START
+#define DEMO_DUTY_TIMER_START(cycles)                                                              \
+  do {                                                                                             \
+    timer0_en_write(0);                                                                            \
+    timer0_load_write(cycles);                                                                     \
+    timer0_reload_write(cycles);                                                                   \
+    timer0_ev_pending_write(timer0_ev_pending_read());                                             \
+    timer0_ev_enable_write(1);                                                                     \
+    timer0_en_write(1);                                                                            \
+  } while (0)
+#define DEMO_DUTY_TIMER_ACK() timer0_ev_pending_write(timer0_ev_pending_read())
+#define DEMO_DUTY_TIMER_STOP() timer0_en_write(0)
+#endif
+/* Unmask the timer0 line in the VexRiscv IRQ controller (CSR 0xBC0), enable MIE */
+#ifndef DEMO_DUTY_CPU_IRQ_ENABLE
+#define DEMO_DUTY_CPU_IRQ_ENABLE()                                                                 \
+  do {                                                                                             \
+    __asm__ volatile("csrs 0xBC0, %0" ::"r"(1u << TIMER0_INTERRUPT));                              \
+    __asm__ volatile("csrsi mstatus, 8");                                                          \
+  } while (0)
+#endif
+/* Mask machine interrupts (mstatus.MIE) / restore the saved mstatus */
+#define DEMO_DUTY_IRQ_SAVE(s) __asm__ volatile("csrrci %0, mstatus, 8" : "=r"(s))
+#define DEMO_DUTY_IRQ_RESTORE(s) __asm__ volatile("csrw mstatus, %0" ::"r"(s))
+
+#define DEMO_DUTY_CYCLES_PER_US (CONFIG_CLOCK_FREQUENCY / 1000000u)
+#define DEMO_DUTY_PERIOD_CYCLES (s_duty_period_us * DEMO_DUTY_CYCLES_PER_US)
+
+static volatile uint32_t s_duty_ticks; /* timer0 ticks (free-running) */
+static uint32_t s_duty_period_us = DEMO_DUTY_PERIOD_US; /* of the power mode */
+
+void demo_duty_timer_isr(void) {
+  DEMO_DUTY_TIMER_ACK();
+  s_duty_ticks++;
+}
+
+/* Sleep until s_duty_ticks differs from seen. MIE is masked around the check,
+ * so a tick between the check and WFI still ends the WFI. */
+static uint32_t duty_sleep(uint32_t seen) {
+  uint32_t mstatus, ticks;
+  for (;;) {
+    DEMO_DUTY_IRQ_SAVE(mstatus);
+    ticks = s_duty_ticks;
+    if (ticks != seen) {
+      DEMO_DUTY_IRQ_RESTORE(mstatus);
+      return ticks;
+    }
+    __asm__ volatile("wfi");
+    DEMO_DUTY_IRQ_RESTORE(mstatus); /* demo_duty_timer_isr() runs here */
+  }
+}
+
+/* "DUTY ..." summary of n windows that started on `periods` ticks. */
+static void duty_report(uint32_t n, uint32_t periods, uint32_t active, uint32_t active_max) {
+  uint32_t avg = active / n;
+  /* permille of the elapsed periods; period / 1000 keeps the product in 32 bits */
+  uint32_t permille = active / (periods * (DEMO_DUTY_PERIOD_CYCLES / 1000u));
+  uart_write_string("DUTY windows=");
+  uart_write_uint32(n);
+  uart_write_string(" active_avg=");
+  uart_write_uint32(avg);
+  uart_write_string(" active_max=");
+  uart_write_uint32(active_max);
+  uart_write_string(" period=");
+  uart_write_uint32(DEMO_DUTY_PERIOD_CYCLES);
+  uart_write_string(" duty_pct=");
+  uart_write_uint32(permille / 10u);
+  uart_write_char('.');
+  uart_write_uint32(permille % 10u);
+  uart_write_string(" misses=");
+  uart_write_uint32(periods - n);
+#if DEMO_DUTY_ACTIVE_UW > 0
+  {
+    /* uW * us = pJ; active and sleep time of one average window */
+    uint32_t active_us = avg / DEMO_DUTY_CYCLES_PER_US;
+    uint32_t sleep_us = active_us < s_duty_period_us ? s_duty_period_us - active_us : 0u;
+    uint32_t nj = (DEMO_DUTY_ACTIVE_UW * active_us) / 1000u +
+                  (DEMO_DUTY_SLEEP_UW * (sleep_us / 1000u));
+    uart_write_string(" energy_nj=");
+    uart_write_uint32(nj);
+  }
+#endif
+  uart_write_string("\r\n");
+}
+
+#if TINYFORMER_POWER_MODES
+#define DEMO_PMODE_ALL_HW (TINYFORMER_HW_DOT8 | TINYFORMER_HW_GEMV | TINYFORMER_HW_EXP_LUT)
+
+static const tf_pmode_t s_pmodes[] = {
+    {"perf", DEMO_PMODE_ALL_HW, INT32_MAX, DEMO_DUTY_PERIOD_US},
+    {"balanced", DEMO_PMODE_ALL_HW, DEMO_PMODE_MARGIN_BALANCED, 2u * DEMO_DUTY_PERIOD_US},
+    {"saver", TINYFORMER_HW_DOT8, DEMO_PMODE_MARGIN_SAVER, 4u * DEMO_DUTY_PERIOD_US},
+};
+static tf_pmode_ctl_t s_pmode;
+
+int demo_power_mode_request(int mode) {
+  return tf_pmode_request(&s_pmode, mode);
+}
+
+/* "mode <name>" lines from UART RX (the FIFO holds one between ticks). */
+static void pmode_poll_uart(void) {
+  static char line[24];
+  static int fill;
+  while (uart_read_ready()) {
+    char c = uart_read_char();
+    if (c != '\r' && c != '\n') {
+      if (fill < (int)sizeof(line)) {
+        line[fill++] = c;
+      }
+      continue;
+    }
+    if (fill > 0) {
+      int m = -1;
+      if (fill > 5 && line[0] == 'm' && line[1] == 'o' && line[2] == 'd' && line[3] == 'e' &&
+          line[4] == ' ') {
+        m = tf_pmode_find(&s_pmode, &line[5], fill - 5);
+      }
+      if (m < 0 || tf_pmode_request(&s_pmode, m) != 0) {
+        uart_write_string("PMODE ERR\r\n");
+      }
+    }
+    fill = 0;
+  }
+}
+
+/* "PMODE from=A to=B windows=N cycles_per_window=C" of one switch. */
+static void pmode_report(const tf_pmode_switch_t *sw) {
+  uart_write_string("PMODE from=");
+  uart_write_string(s_pmodes[sw->from].name);
+  uart_write_string(" to=");
+  uart_write_string(s_pmodes[sw->to].name);
+  uart_write_string(" windows=");
+  uart_write_uint32(sw->windows);
+  uart_write_string(" cycles_per_window=");
+  uart_write_uint32(sw->cycles_avg);
+  uart_write_string("\r\n");
+}
+#endif
+
+void demo_duty_run(uint32_t max_windows) {
+  static const tinyformer_head_t cls_head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+  const tinyformer_head_t *head = &cls_head;
+  uint32_t seen = 0, first = 0;
+  uint32_t n = 0, active = 0, active_max = 0;
+#if TINYFORMER_POWER_MODES
+  tinyformer_exit_t exit_in = {{&exit_in_W[0][0], exit_in_b, DEMO_NUM_CLASSES}, INT32_MAX};
+  tinyformer_exit_t exit_attn = {{&exit_attn_W[0][0], exit_attn_b, DEMO_NUM_CLASSES}, INT32_MAX};
+  const tinyformer_weights_t *weights = 0;
+#endif
+
+#if defined(DEMO_MODEL_BLOB)
+  const tf_model_t *blob = load_model_blob();
+  if (blob) {
+    head = &blob->head;
+#if TINYFORMER_POWER_MODES
+    exit_in = blob->exit_in;
+    exit_attn = blob->exit_attn;
+    weights = &blob->weights;
+#endif
+  }
+#endif
+#if TINYFORMER_POWER_MODES
+  if (tf_pmode_init(&s_pmode, s_pmodes, (int)(sizeof(s_pmodes) / sizeof(s_pmodes[0])),
+                    DEMO_PMODE_START, weights) != 0) {
+    (void)tf_pmode_init(&s_pmode, s_pmodes, 1, 0, weights);
+  }
+  s_duty_period_us = tf_pmode_current(&s_pmode)->period_us;
+  uart_write_string("PMODE start=");
+  uart_write_string(tf_pmode_current(&s_pmode)->name);
+  uart_write_string("\r\n");
+#endif
+  uart_write_string("DUTY period_us=");
+  uart_write_uint32(s_duty_period_us);
+  uart_write_string("\r\n");
+  uart_tx_flush();
+
+  s_duty_ticks = 0;
+  DEMO_DUTY_TIMER_START(DEMO_DUTY_PERIOD_CYCLES);
+  DEMO_DUTY_CPU_IRQ_ENABLE();
+  for (uint32_t w = 0; max_windows == 0 || w < max_windows; ++w) {
+    int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum;
+
+    seen = duty_sleep(seen);
+    uint32_t t0 = cycle_counter_read();
+#if TINYFORMER_POWER_MODES
     {
-      uint32_t cksum = 0;
-      for (int s = 0; s < TINYFORMER_S; ++s) {
-        for (int d = 0; d < TINYFORMER_D; ++d) {
-          cksum += (uint32_t)(uint8_t)encoded[s][d];
-        }
+      /* Between windows: a switch takes the whole mode at once. */
+      tf_pmode_switch_t sw;
+      pmode_poll_uart();
+      if (tf_pmode_poll(&s_pmode, &sw)) {
+        pmode_report(&sw);
+        s_duty_period_us = tf_pmode_current(&s_pmode)->period_us;
+        DEMO_DUTY_TIMER_START(DEMO_DUTY_PERIOD_CYCLES);
+        seen = s_duty_ticks;
+        n = 0;
+        active = 0;
+        active_max = 0;
+        t0 = cycle_counter_read();
       }
-      uart_write_string("ENC_CKSUM=0x");
-      uart_write_hex32(cksum);
+    }
+#endif
+    if (n == DEMO_DUTY_REPORT) {
+      /* Counted in this window's active time. Ticks that fired while a
+       * window was still running are the misses. */
+      duty_report(n, seen - first, active, active_max);
+#if TINYFORMER_LATENCY
+      print_latency();
+#endif
+      n = 0;
+      active = 0;
+      active_max = 0;
+    }
+    if (n == 0) {
+      first = seen;
+    }
+    TF_TRACE(TF_EV_SAMPLE, w);
+    uint32_t t1 = cycle_counter_read();
+#if TINYFORMER_POWER_MODES
+    if (tf_pmode_current(&s_pmode)->exit_margin != INT32_MAX) {
+      exit_in.margin = exit_attn.margin = tf_pmode_current(&s_pmode)->exit_margin;
+      (void)DEMO_CLASSIFY_EARLY(head, &exit_in, &exit_attn,
+                                demo_inputs[w % (uint32_t)DEMO_NUM_SAMPLES], logits, &cksum, 0);
+    } else
+#endif
+    (void)DEMO_CLASSIFY(head, demo_inputs[w % (uint32_t)DEMO_NUM_SAMPLES], logits, &cksum);
+    uint32_t t2 = cycle_counter_read();
+    TF_TRACE(TF_EV_SAMPLE_END, w);
+    tinyformer_latency_record(t2 - t1);
+    uint32_t a = t2 - t0;
+#if TINYFORMER_POWER_MODES
+    tf_pmode_account(&s_pmode, a);
+#endif
+    active += a;
+    if (a > active_max) {
+      active_max = a;
+    }
+    ++n;
+#if TINYFORMER_TRACE
+    if (w + 1u == DEMO_TRACE_WINDOWS) {
+      print_trace();
+    }
+#endif
+  }
+  DEMO_DUTY_TIMER_STOP();
+}
+#endif
+
+/* ---- Command console ---- */
+
+#if DEMO_CONSOLE
+#define CONSOLE_LINE 64
+#define CONSOLE_AUTO 8u /* s_bench[] slot of "auto"; the others are hw masks */
+
+static const char *const console_backend[3] = {"dot8", "gemv", "lut"};
+
+static uint32_t s_mode = CONSOLE_AUTO; /* TINYFORMER_HW_* mask or CONSOLE_AUTO */
+
+/* Bench history per mode */
+static struct {
+  uint32_t runs, last, best;
+} s_bench[CONSOLE_AUTO + 1];
+
+/* Echoed line input with backspace; returns the length (0 for an empty
+ * line, the '\n' of a "\r\n" pair is not a second one). */
+static uint32_t console_read_line(char *buf, uint32_t size) {
+  static char prev;
+  uint32_t n = 0;
+  for (;;) {
+    char c = uart_read_char();
+    if (c == '\n' && prev == '\r') {
+      prev = 0;
+      continue;
+    }
+    prev = c;
+    if (c == '\r' || c == '\n') {
       uart_write_string("\r\n");
+      return n;
     }
+    if (c == '\b' || c == 0x7f) {
+      if (n > 0) {
+        --n;
+        uart_write_string("\b \b");
+      }
+    } else if (c >= ' ' && n + 1 < size) {
+      buf[n++] = c;
+      uart_write_char(c);
+    }
+  }
+}
 
-    mean_pool_tokens(encoded, pooled);
-    classifier_forward(pooled, logits);
+/* 1 if s[0..n) is the word w */
+static int console_is(const char *s, uint32_t n, const char *w) {
+  uint32_t i = 0;
+  while (i < n && w[i] != '\0' && s[i] == w[i]) {
+    ++i;
+  }
+  return i == n && w[i] == '\0';
+}
+
+/* "auto", or backends from cpu, dot8, gemv, lut and all joined by '+'.
+ * Returns 0 and the mode in *mode, or -1. */
+static int console_parse_mode(const char *s, uint32_t n, uint32_t *mode) {
+  uint32_t m = 0;
+  if (console_is(s, n, "auto")) {
+    *mode = CONSOLE_AUTO;
+    return 0;
+  }
+  while (n > 0) {
+    uint32_t k = 0;
+    while (k < n && s[k] != '+') {
+      ++k;
+    }
+    if (console_is(s, k, "all")) {
+      m |= TINYFORMER_HW_DOT8 | TINYFORMER_HW_GEMV | TINYFORMER_HW_EXP_LUT;
+    } else if (console_is(s, k, "dot8")) {
+      m |= TINYFORMER_HW_DOT8;
+    } else if (console_is(s, k, "gemv")) {
+      m |= TINYFORMER_HW_GEMV;
+    } else if (console_is(s, k, "lut")) {
+      m |= TINYFORMER_HW_EXP_LUT;
+    } else if (!console_is(s, k, "cpu")) {
+      return -1;
+    }
+    if (k == n || k + 1 == n) {
+      break;
+    }
+    s += k + 1;
+    n -= k + 1;
+  }
+  *mode = m;
+  return 0;
+}
 
-    int32_t best_val = logits[0];
-    uint32_t best_idx = 0;
-    for (uint32_t c = 1; c < (uint32_t)DEMO_NUM_CLASSES; ++c) {
-      if (logits[c] > best_val) {
-        best_val = logits[c];
-        best_idx = c;
+static void console_write_mode(uint32_t mode) {
+  int first = 1;
+  if (mode == CONSOLE_AUTO) {
+    uart_write_string("auto");
+    return;
+  }
+  if (mode == 0) {
+    uart_write_string("cpu");
+  }
+  for (uint32_t b = 0; b < 3; ++b) {
+    if (mode & (1u << b)) {
+      if (!first) {
+        uart_write_char('+');
       }
+      uart_write_string(console_backend[b]);
+      first = 0;
     }
+  }
+}
 
-    uart_write_string("Sample ");
-    uart_write_uint32(i);
-    uart_write_string(": pred=");
-    uart_write_uint32(best_idx);
-    uart_write_string(" exp=");
-    uart_write_uint32((uint32_t)demo_labels[i]);
+/* Rebuild the dispatch table for mode and print it, with "WARN missing=.."
+ * for requested backends the probes did not find. */
+static void console_select(uint32_t mode) {
+  if (mode == CONSOLE_AUTO) {
+    tinyformer_autotune(0, &s_tune);
+  } else {
+    tinyformer_select_backends(0, mode, &s_tune);
+  }
+  s_mode = mode;
+  print_tune(&s_tune);
+  if (mode != CONSOLE_AUTO && (mode & ~s_tune.hw) != 0) {
+    uart_write_string("WARN missing=");
+    console_write_mode(mode & ~s_tune.hw);
     uart_write_string("\r\n");
   }
 }
+
+static void console_bench(void) {
+  tinyformer_profile_reset();
+  tf_trace_reset();
+  uint32_t t0 = cycle_counter_read();
+  demo_samples_run(0);
+  uint32_t cycles = cycle_counter_read() - t0;
+  uart_write_string("BENCH mode=");
+  console_write_mode(s_mode);
+  uart_write_string(" samples=");
+  uart_write_uint32((uint32_t)DEMO_NUM_SAMPLES);
+  uart_write_string(" cycles=");
+  uart_write_uint32(cycles);
+  uart_write_string(" per_sample=");
+  uart_write_uint32(cycles / (uint32_t)DEMO_NUM_SAMPLES);
+  uart_write_string("\r\n");
+  s_bench[s_mode].last = cycles;
+  if (s_bench[s_mode].runs++ == 0 || cycles < s_bench[s_mode].best) {
+    s_bench[s_mode].best = cycles;
+  }
+}
+
+static void console_stats(void) {
+  print_sram_usage();
+#if TINYFORMER_STACK_PAINT
+  print_stack();
+#endif
+  print_tune(&s_tune);
+#if TINYFORMER_PROFILE
+  print_profile();
+#endif
+#if TINYFORMER_LATENCY
+  print_latency();
+#endif
+#if TINYFORMER_RANGE_STATS
+  print_range();
+#endif
+  for (uint32_t m = 0; m <= CONSOLE_AUTO; ++m) {
+    if (s_bench[m].runs == 0) {
+      continue;
+    }
+    uart_write_string("STATS mode=");
+    console_write_mode(m);
+    uart_write_string(" runs=");
+    uart_write_uint32(s_bench[m].runs);
+    uart_write_string(" last=");
+    uart_write_uint32(s_bench[m].last);
+    uart_write_string(" best=");
+    uart_write_uint32(s_bench[m].best);
+    uart_write_string("\r\n");
+  }
+}
+
+void demo_console_run(void) {
+  static char line[CONSOLE_LINE];
+  for (;;) {
+    uart_write_string("> ");
+    uart_tx_flush();
+    uint32_t n = console_read_line(line, sizeof(line));
+    uint32_t i = 0, cmd, cmd_n, arg, arg_n;
+    while (i < n && line[i] == ' ') {
+      ++i;
+    }
+    for (cmd = i; i < n && line[i] != ' '; ++i) {
+    }
+    cmd_n = i - cmd;
+    while (i < n && line[i] == ' ') {
+      ++i;
+    }
+    for (arg = i; i < n && line[i] != ' '; ++i) {
+    }
+    arg_n = i - arg;
+    while (i < n && line[i] == ' ') {
+      ++i;
+    }
+    if (cmd_n == 0) {
+      continue;
+    }
+
+    uint32_t mode = s_mode;
+    if (i < n || (arg_n > 0 && console_parse_mode(&line[arg], arg_n, &mode) != 0)) {
+      uart_write_string("ERR args\r\n");
+    } else if (console_is(&line[cmd], cmd_n, "mode") && arg_n > 0) {
+      console_select(mode);
+    } else if (console_is(&line[cmd], cmd_n, "bench")) {
+      if (arg_n > 0) {
+        console_select(mode);
+      }
+      console_bench();
+    } else if (console_is(&line[cmd], cmd_n, "stats") && arg_n == 0) {
+      console_stats();
+#if TINYFORMER_TRACE
+    } else if (console_is(&line[cmd], cmd_n, "trace") && arg_n == 0) {
+      print_trace();
+#endif
+    } else if (console_is(&line[cmd], cmd_n, "help") && arg_n == 0) {
+      uart_write_string("mode <b>[+<b>..] | bench [<b>[+<b>..]] | stats | help\r\n"
+                        "b: cpu dot8 gemv lut all, or auto\r\n");
+#if TINYFORMER_TRACE
+      uart_write_string("trace: dump the trace rings of the last bench\r\n");
+#endif
+    } else {
+      uart_write_string("ERR command\r\n");
+    }
+  }
+}
+#endif
@@ -4,6 +4,328 @@
 #ifndef DEMO_RUNNER_H
 #define DEMO_RUNNER_H
 
+#include "tinyformer.h"
+#include <stdint.h>
+
+// DEMO_STREAM=1: demo_run() runs the streaming classifier (demo_stream_run)
+// instead of replaying the compiled-in samples.
+#ifndef DEMO_STREAM
+#define DEMO_STREAM 0
+#endif
+
+// Tokens between consecutive stream windows (1..S; S/2 = 50% overlap as in UCI HAR).
+#ifndef DEMO_STREAM_HOP
+#define DEMO_STREAM_HOP (TINYFORMER_S / 2)
+#endif
+
+// DEMO_STREAM_SENSOR_IRQ=1: frames come from a sensor ISR (isr.c dispatches
+// line DEMO_STREAM_SENSOR_INTERRUPT to demo_stream_sensor_isr()) instead of
+// being polled from the UART.
+#ifndef DEMO_STREAM_SENSOR_IRQ
+#define DEMO_STREAM_SENSOR_IRQ 0
+#endif
+
+// DEMO_STREAM_IMU=1: the stream source delivers raw IMU samples instead of
+// frames, and the device feature stage (imu_features.h) turns every
+// IMU_FEAT_POOL of them into one frame. UART: IMU_FEAT_CHANNELS int16 Q12
+// little-endian per sample; sensor IRQ: demo_stream_sensor_read_imu().
+#ifndef DEMO_STREAM_IMU
+#define DEMO_STREAM_IMU 0
+#endif
+#if DEMO_STREAM_IMU
+#include "imu_features.h"
+#endif
+
+// DEMO_STREAM_DMA=1 (with DEMO_STREAM, make STREAM=1 SENSOR_DMA=1): frames
+// come from the sensor capture DMA block (hw_extensions/sensor_dma), which
+// writes the sensor front-end's quantized frames straight into the stream
+// ring in SRAM and raises its hop interrupt every DEMO_STREAM_HOP frames;
+// windows are encoded in place from there and the CPU sleeps in WFI between
+// hops. "dropped" counts the frames the block dropped into a full ring. Not
+// with DEMO_STREAM_SENSOR_IRQ or DEMO_STREAM_IMU (the block delivers frames).
+#ifndef DEMO_STREAM_DMA
+#define DEMO_STREAM_DMA 0
+#endif
+#if DEMO_STREAM_DMA && (DEMO_STREAM_SENSOR_IRQ || DEMO_STREAM_IMU)
+#error "DEMO_STREAM_DMA replaces the sensor IRQ / IMU feature sources"
+#endif
+#if DEMO_STREAM_DMA && !defined(USE_SENSOR_DMA_HW)
+#error "DEMO_STREAM_DMA needs USE_SENSOR_DMA_HW (make SENSOR_DMA=1)"
+#endif
+
+// DEMO_STREAM_PIPE=1 (with DEMO_STREAM and TINYFORMER_SMP, make STREAM=1
+// SMP=1 PIPE=1): demo_run() runs the streaming classifier as a two-hart
+// stage pipeline (demo_stream_pipe_run) instead of demo_stream_run. Hart 0
+// reads the ring and runs the front half of window n + 1
+// (tinyformer_encode_front: Q/K/V, attention) while hart 1 runs the back half
+// of window n (tinyformer_classify_back: output projection, FFN, head); the
+// windows are handed over through a single-producer / single-consumer queue
+// of DEMO_PIPE_SLOTS stage buffers. Same "Window" lines as demo_stream_run(),
+// and every DEMO_PIPE_REPORT windows a
+// "PIPE windows=N front=C back=C front_full=C back_empty=C front_pct=P back_pct=P"
+// line: average busy cycles per window of each half, the average cycles
+// hart 0 waited for a free slot and hart 1 for a filled one, and the busy
+// share of each half over the report period.
+#ifndef DEMO_STREAM_PIPE
+#define DEMO_STREAM_PIPE 0
+#endif
+#ifndef DEMO_PIPE_SLOTS
+#define DEMO_PIPE_SLOTS 2
+#endif
+#ifndef DEMO_PIPE_REPORT
+#define DEMO_PIPE_REPORT 16
+#endif
+#if DEMO_STREAM_PIPE && !(DEMO_STREAM && TINYFORMER_SMP)
+#error "DEMO_STREAM_PIPE needs DEMO_STREAM and TINYFORMER_SMP"
+#endif
+
+// DEMO_EARLY_EXIT=1 (sample replay, not DEMO_STREAM): demo_run() classifies each sample with the early-exit
+// heads of demo_classifier.h (tinyformer_classify_early), then re-runs it on
+// the full path for ENC_CKSUM and the cycle reference. Prints the exit stage
+// per sample and an EARLY_EXIT summary (exit rate, agreement with the full
+// path, average full cycles and average cycles saved).
+#ifndef DEMO_EARLY_EXIT
+#define DEMO_EARLY_EXIT 0
+#endif
+
+// DEMO_UART_PROTO=1: demo_run() runs the binary protocol server
+// (demo_proto_run, uart_frame.h) instead of replaying the compiled-in samples.
+#ifndef DEMO_UART_PROTO
+#define DEMO_UART_PROTO 0
+#endif
+#if DEMO_UART_PROTO && DEMO_STREAM
+#error "DEMO_UART_PROTO and DEMO_STREAM are exclusive"
+#endif
+
+// DEMO_DUTY_CYCLE=1: demo_run() runs the duty-cycled loop (demo_duty_run)
+// instead of replaying the samples back to back: LiteX timer0 ticks every
+// DEMO_DUTY_PERIOD_US, each tick classifies one window (the compiled-in
+// samples in turn, standing in for the sensor buffer), and the CPU sleeps in
+// WFI until the next tick. Every DEMO_DUTY_REPORT windows it prints
+// "DUTY windows=N active_avg=C active_max=C period=P duty_pct=X.Y misses=M":
+// active cycles per window (wake to sleep, report included), the tick period
+// in cycles, the active share of the elapsed periods and the ticks missed
+// because a window was still running. With the board's active and sleep
+// power in uW (DEMO_DUTY_ACTIVE_UW, DEMO_DUTY_SLEEP_UW) it adds the
+// estimated energy per window, "energy_nj=E".
+#ifndef DEMO_DUTY_CYCLE
+#define DEMO_DUTY_CYCLE 0
+#endif
+#ifndef DEMO_DUTY_PERIOD_US
+#define DEMO_DUTY_PERIOD_US 1280000 /* UCI HAR hop: 64 samples at 50 Hz */
+#endif
+#ifndef DEMO_DUTY_REPORT
+#define DEMO_DUTY_REPORT 16
+#endif
+#ifndef DEMO_DUTY_ACTIVE_UW
+#define DEMO_DUTY_ACTIVE_UW 0
+#endif
+#ifndef DEMO_DUTY_SLEEP_UW
+#define DEMO_DUTY_SLEEP_UW 0
+#endif
+#if DEMO_DUTY_CYCLE && (DEMO_STREAM || DEMO_UART_PROTO)
+#error "DEMO_DUTY_CYCLE excludes DEMO_STREAM and DEMO_UART_PROTO"
+#endif
+
+// TINYFORMER_POWER_MODES=1 with DEMO_DUTY_CYCLE (make DUTY=1 PMODES=1,
+// common/power_modes.h): the duty loop runs one of three modes, starting in
+// DEMO_PMODE_START:
+//   perf      all backends, exits off, DEMO_DUTY_PERIOD_US
+//   balanced  all backends, exit margin DEMO_PMODE_MARGIN_BALANCED, 2x period
+//   saver     DOT8 only, exit margin DEMO_PMODE_MARGIN_SAVER, 4x period
+// The margins apply to both early-exit heads of demo_classifier.h (or of the
+// model blob). A "mode <name>" line on UART RX, or
+// demo_power_mode_request() from board code (e.g. a battery or thermal
+// monitor), switches before the next window: the timer is rearmed with the
+// new period, the DUTY report restarts, and "PMODE from=A to=B windows=N
+// cycles_per_window=C" reports the mode left (active cycles per window).
+// Unknown commands get "PMODE ERR". With TINYFORMER_AUTOTUNE for the
+// backends.
+#ifndef DEMO_PMODE_START
+#define DEMO_PMODE_START 0
+#endif
+#ifndef DEMO_PMODE_MARGIN_BALANCED
+#define DEMO_PMODE_MARGIN_BALANCED 8192
+#endif
+#ifndef DEMO_PMODE_MARGIN_SAVER
+#define DEMO_PMODE_MARGIN_SAVER 2048
+#endif
+#if TINYFORMER_POWER_MODES && DEMO_DUTY_CYCLE && TINYFORMER_TIERS && defined(DEMO_MODEL_BLOB)
+#error "TINYFORMER_POWER_MODES runs default-shape exit heads; not with a TINYFORMER_TIERS model blob"
+#endif
+
+// TINYFORMER_LATENCY=1 (make LATENCY=1, with TINYFORMER_PROFILE): each
+// classify call of the sample replay, stream window (encode and head) and
+// duty-cycled window also goes into the "call" histogram
+// (tinyformer_latency_record), and the demo prints
+// "LAT <stage> n=N p50=C p95=C p99=C max=C" lines for the profiled stages
+// and "call": after the sample replay's PROF table, every DEMO_LAT_REPORT
+// stream windows, after each DUTY line and with the console's stats. A
+// deployment fits if the call p99 stays below the window period.
+#ifndef DEMO_LAT_REPORT
+#define DEMO_LAT_REPORT 64
+#endif
+
+// TINYFORMER_RANGE_STATS=1 (make RANGE=1): the sample replay ends with
+// "RANGE <stage> n=N clip_hi=H clip_lo=L min=A max=B bits=W" lines, the
+// saturation and range counters of each encoder stage over all samples
+// (tinyformer_range_read), and the console prints them with its stats.
+
+// TINYFORMER_TRACE=1 (make TRACE=1, common/tf_trace.h): demo_run() clears
+// the trace rings at boot and each sample / window is a SAMPLE span in them.
+// The sample replay dumps them at its end ("TRACE BEGIN" ... "TRACE END"),
+// the stream, stage pipeline and duty-cycled loops once after
+// DEMO_TRACE_WINDOWS windows (the dump stalls that window), and the console
+// on "trace" (for its last bench). Recording stops at each dump.
+#ifndef DEMO_TRACE_WINDOWS
+#define DEMO_TRACE_WINDOWS 8
+#endif
+
+// TINYFORMER_STACK_PAINT=1 (make STACK_PAINT=1, common/tf_stack.h):
+// demo_run() ends with "STACK high_water=N size=S", the deepest the stack
+// has been since reset (crt0.S paints it) against the free SRAM it may grow
+// into, and the console prints it with its stats. The stream, protocol and
+// duty-cycled loops do not return, so they print no STACK line.
+
+// TINYFORMER_SHADOW=1 with DEMO_STREAM (make SHADOW=1 STREAM=1 AOT_MODEL=...,
+// common/tf_shadow.h): the stream encodes through tf_shadow_encode_view(),
+// runs the reference TF_SHADOW_REF (declared in TF_SHADOW_REF_H) on the
+// sampled window while no window is ready, and prints "SHADOW windows=N
+// compared=C label_mm=L cksum_mm=K max_diff=M fallback_at=F" every
+// DEMO_SHADOW_REPORT windows. The sample replay and the stage pipeline are
+// not guarded.
+#ifndef DEMO_SHADOW_REPORT
+#define DEMO_SHADOW_REPORT 64
+#endif
+#if TINYFORMER_SHADOW && DEMO_STREAM && !defined(TF_SHADOW_REF)
+#error "TINYFORMER_SHADOW with DEMO_STREAM needs TF_SHADOW_REF and TF_SHADOW_REF_H (make SHADOW=1 AOT_MODEL=...)"
+#endif
+
+// DEMO_STREAM_GATE=1 (make STREAM=1 GATE=1,
+// common/stream_gate.h): demo_stream_run() keeps the prediction of the last
+// encoded window while a new window is within an L1 distance of
+// DEMO_GATE_THRESHOLD of it, for at most DEMO_GATE_MAX_SKIP windows in a row
+// (0: no limit), and prints those as "Window n: pred=P dropped=D gated".
+// The next encoded window projects K/V for all rows new since the last one.
+// Every DEMO_GATE_REPORT windows it prints "GATE windows=N skipped=K
+// cycles_per_window=C", C averaged over those windows, gate included. The
+// default threshold is one LSB per feature of the 16 live input channels.
+// Not with the stage pipeline.
+#ifndef DEMO_STREAM_GATE
+#define DEMO_STREAM_GATE 0
+#endif
+#ifndef DEMO_GATE_THRESHOLD
+#define DEMO_GATE_THRESHOLD (TINYFORMER_S * 16)
+#endif
+#ifndef DEMO_GATE_MAX_SKIP
+#define DEMO_GATE_MAX_SKIP 16
+#endif
+#ifndef DEMO_GATE_REPORT
+#define DEMO_GATE_REPORT 64
+#endif
+#if DEMO_STREAM_GATE && DEMO_STREAM_PIPE
+#error "DEMO_STREAM_GATE gates demo_stream_run(), not the DEMO_STREAM_PIPE pipeline"
+#endif
+
+// DEMO_CONSOLE=1 (make CONSOLE=1, with TINYFORMER_AUTOTUNE; e.g.
+// TARGET=accel_all for every driver): demo_run() runs a line console on the
+// UART (demo_console_run) instead of replaying the samples once, so the
+// backends can be compared in one boot:
+//   mode <b>[+<b>...]   dispatch on the listed backends, b = cpu, dot8,
+//                       gemv, lut or all (tinyformer_select_backends), or
+//                       auto (tinyformer_autotune); prints the TUNE table
+//   bench [<b>[+...]]   optionally switch, then replay the samples as
+//                       demo_run() does and print
+//                       "BENCH mode=M samples=N cycles=C per_sample=C"
+//   stats               TF_SRAM, the current TUNE table, the PROF totals of
+//                       the last bench (TINYFORMER_PROFILE), its RANGE
+//                       lines (TINYFORMER_RANGE_STATS) and one
+//                       "STATS mode=M runs=R last=C best=C" line per mode
+//   trace               the trace rings of the last bench (TINYFORMER_TRACE)
+//   help
+// Each reply ends with a "> " prompt; unknown input gets "ERR ...".
+#ifndef DEMO_CONSOLE
+#define DEMO_CONSOLE 0
+#endif
+#if DEMO_CONSOLE && !TINYFORMER_AUTOTUNE
+#error "DEMO_CONSOLE switches backends through TINYFORMER_AUTOTUNE's dispatch table"
+#endif
+#if DEMO_CONSOLE && (DEMO_STREAM || DEMO_UART_PROTO || DEMO_DUTY_CYCLE)
+#error "DEMO_CONSOLE excludes DEMO_STREAM, DEMO_UART_PROTO and DEMO_DUTY_CYCLE"
+#endif
+
+// TINYFORMER_BENCH_SUITE=1 (make BENCH=1, with TINYFORMER_AUTOTUNE; e.g.
+// TARGET=accel_all for every driver, common/tinyformer_shapes.h): demo_run()
+// runs a fixed benchmark suite (demo_suite_run) instead of the sample
+// replay, for comparing releases:
+//   har          the default shape with the built-in weights, demo sample 0
+//   eeg, ecg     EEGFormer S=81 D=32 and ECGFormer S=66 D=16 shapes
+//   s32_d32 ..   scaling sweep over S (16, 32, 64 at D=32) and D (16, 32,
+//                64 at S=32)
+// The models other than har run synthetic weights and inputs. Each model is
+// encoded DEMO_SUITE_RUNS times on every backend set the probes find (cpu,
+// dot8, gemv, lut, all; tinyformer_select_backends), printing per pair
+//   "SUITE model=M S=.. D=.. FFN=.. backend=B cycles=C best=C macs=N
+//    sram=B weights=B qkv=K o=K ff1=K ff2=K exp=lut|sw cksum=0x.."
+// between "SUITE BEGIN" and "SUITE END" lines: median and best cycles of
+// one encoder pass (no head), its MACs, the instance activation SRAM
+// (TINYFORMER_INSTANCE_BYTES, scratch on the TF_SRAM line), the weight and
+// bias bytes, the kernel each matvec ran on (the dispatch table is tuned for
+// the default shape; other shapes take its entries where the matvec shape
+// matches, else DOT8 or the CPU) and the output's byte checksum, which must
+// agree across backends. The CPU is busy for the whole pass, so the cycles
+// are also its active cycles, the energy proxy. tools/bench_suite.py turns
+// the lines into a results table. Plain int8 weights only.
+#ifndef DEMO_SUITE_RUNS
+#define DEMO_SUITE_RUNS 5
+#endif
+#if TINYFORMER_BENCH_SUITE && !TINYFORMER_AUTOTUNE
+#error "TINYFORMER_BENCH_SUITE switches backends through TINYFORMER_AUTOTUNE's dispatch table"
+#endif
+#if TINYFORMER_BENCH_SUITE && (DEMO_STREAM || DEMO_UART_PROTO || DEMO_DUTY_CYCLE || DEMO_CONSOLE)
+#error "TINYFORMER_BENCH_SUITE excludes DEMO_STREAM, DEMO_UART_PROTO, DEMO_DUTY_CYCLE and DEMO_CONSOLE"
+#endif
+#if TINYFORMER_BENCH_SUITE && (TINYFORMER_PACKED_WEIGHTS || TINYFORMER_INT4_WEIGHTS)
+#error "TINYFORMER_BENCH_SUITE fills plain int8 weights"
+#endif
+#if DEMO_SUITE_RUNS < 1
+#error "DEMO_SUITE_RUNS must be at least 1"
+#endif
+
+// DEMO_MODEL_BLOB=<address> (sample replay, not DEMO_STREAM): demo_run() loads
+// the model blob mapped there (model_blob.h, e.g. SPIFLASH_BASE + an offset
+// after the bitstream; make MODEL_BLOB=...) in place and classifies with its
+// weights and heads, so a new model needs no firmware rebuild. Prints
+// "MODEL: blob bytes=N" or, keeping the compiled-in model, "MODEL: built-in
+// blob_error=E" (tf_blob_load() code, or 100 for a class count other than
+// DEMO_NUM_CLASSES). DEMO_MODEL_BLOB_BYTES bounds the mapped size.
+#ifndef DEMO_MODEL_BLOB_BYTES
+#define DEMO_MODEL_BLOB_BYTES 0x10000
+#endif
+
+// With TINYFORMER_TIERS (make TIERS=1), DEMO_MODEL_BLOB is a tier pack
+// (model_tiers.h) and the demo runs tier DEMO_MODEL_TIER of it
+// (make MODEL_TIER=small; default TF_TIER_ANY, the pack's first blob of a
+// compiled-in shape), printing "MODEL: tier=T S=.. D=.. FFN=.. bytes=N".
+// The early exits are default-shape heads and stay off.
+#ifndef DEMO_MODEL_TIER
+#define DEMO_MODEL_TIER TF_TIER_ANY
+#endif
+#if TINYFORMER_TIERS && defined(DEMO_MODEL_BLOB) && DEMO_EARLY_EXIT
+#error "DEMO_EARLY_EXIT runs default-shape exit heads; not with a TINYFORMER_TIERS model blob"
+#endif
+
+// The sample replay prints "BOOT first_pred_cycles=N" after the first sample:
+// cycles from reset (the cycle CSR starts at 0) until its prediction is known.
+// DEMO_FAST_BOOT=1 (make FAST_BOOT=1, with TINYFORMER_NOINIT_SCRATCH) moves
+// the setup the first prediction does not need behind it: the TF_SRAM line
+// and, with TINYFORMER_AUTOTUNE, the backend calibration (the first sample
+// then runs on the CPU kernels). The model blob is still loaded and checked
+// before its first use.
+#ifndef DEMO_FAST_BOOT
+#define DEMO_FAST_BOOT 0
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,6 +337,75 @@ void demo_print_banner(const char *line);
 // classifier, argmax; print "Sample i: pred=X exp=Y" per sample via UART.
 void demo_run(void);
 
+// Streaming classifier: frames (TINYFORMER_D int8 features each) arrive in a
+// lock-free SPSC ring; every DEMO_STREAM_HOP new frames the last S frames are
+// encoded and classified, printing "Window n: pred=X dropped=Y" (Y = frames
+// lost to a full ring so far). UART source: raw bytes, D per frame (raw
+// samples with DEMO_STREAM_IMU).
+// Frames pushed before the call are kept (DEMO_STREAM_DMA restarts the
+// capture). max_windows = 0 runs forever.
+void demo_stream_run(uint32_t max_windows);
+
+// Producer entry (ISR-safe): queue one frame. Returns 0, or -1 if dropped.
+// Unused with DEMO_STREAM_DMA, whose frames bypass it.
+int demo_stream_push(const int8_t frame[TINYFORMER_D]);
+
+// Producer side: frames the ring takes before demo_stream_push() drops.
+uint32_t demo_stream_room(void);
+
+#if DEMO_CONSOLE
+// The DEMO_CONSOLE command loop; returns only if the UART source ends (host).
+void demo_console_run(void);
+#endif
+
+#if TINYFORMER_BENCH_SUITE
+// The TINYFORMER_BENCH_SUITE run: every model on every backend set found,
+// then back to the boot dispatch table.
+void demo_suite_run(void);
+#endif
+
+#if TINYFORMER_SMP
+// demo_stream_run() as the two-hart stage pipeline of DEMO_STREAM_PIPE, from
+// hart 0 with the smp_runtime.h workers running (TF_SMP_HARTS >= 2; harts
+// past 1 stay idle). Stops after max_windows windows (0: forever).
+void demo_stream_pipe_run(uint32_t max_windows);
+#endif
+
+// Binary protocol server (uart_frame.h): classifies every UF_T_WINDOW
+// request and replies with the prediction, ENC_CKSUM, cycles and logits,
+// with no text formatting per window. Returns after UF_T_STOP.
+void demo_proto_run(void);
+
+#if DEMO_DUTY_CYCLE
+// Duty-cycled classifier (see DEMO_DUTY_CYCLE): arms timer0, then per tick
+// classifies one window and sleeps. max_windows = 0 runs forever.
+void demo_duty_run(uint32_t max_windows);
+
+// Called from isr.c on the timer0 line: acknowledges the tick.
+void demo_duty_timer_isr(void);
+
+#if TINYFORMER_POWER_MODES
+// Switch the duty loop to power mode (0 perf, 1 balanced, 2 saver) before
+// its next window; callable from an ISR. Returns 0, or -1 for no such mode.
+int demo_power_mode_request(int mode);
+#endif
+#endif
+
+#if DEMO_STREAM_SENSOR_IRQ
+// Called from isr.c on the sensor line: reads one frame and queues it.
+void demo_stream_sensor_isr(void);
+
+// Board-provided: start the sensor and unmask its IRQ line (called once by
+// demo_stream_run), and read one quantized frame (with DEMO_STREAM_IMU one
+// raw Q12 sample) while servicing the IRQ.
+void demo_stream_sensor_init(void);
+#if DEMO_STREAM_IMU
+void demo_stream_sensor_read_imu(int16_t sample[IMU_FEAT_CHANNELS]);
+#else
+void demo_stream_sensor_read(int8_t frame[TINYFORMER_D]);
+#endif
+#endif
+
 #ifdef __cplusplus
 }
 #endif
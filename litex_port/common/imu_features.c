@@ -0,0 +1,88 @@
+// Streaming fixed-point UCI HAR feature stage (imu_features.h).
+
+#include "imu_features.h"
+#include <stdint.h>
+
+// floor(sqrt(n)), bit by bit (no divider or FPU needed).
+static uint32_t isqrt64(uint64_t n) {
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+  while (bit > n) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+static int8_t norm_feature(int32_t f, int k) {
+  int64_t q = (int64_t)(f - imu_norm_off[k]) * imu_norm_mul[k];
+  q = (q + ((int64_t)1 << (IMU_FEAT_NORM_SHIFT - 1))) >> IMU_FEAT_NORM_SHIFT;
+  if (q > 127) {
+    q = 127;
+  } else if (q < -127) {
+    q = -127;
+  }
+  return (int8_t)q;
+}
+
+void imu_feat_reset(imu_feat_t *st) {
+  for (int c = 0; c < IMU_FEAT_CHANNELS; ++c) {
+    st->sum[c] = 0;
+    st->prev[c] = 0;
+  }
+  st->count = 0;
+  st->tokens = 0;
+}
+
+int imu_feat_push(imu_feat_t *st, const int16_t sample[IMU_FEAT_CHANNELS],
+                  int8_t token[TINYFORMER_D]) {
+  for (int c = 0; c < IMU_FEAT_CHANNELS; ++c) {
+    st->sum[c] += sample[c];
+  }
+  if (++st->count < IMU_FEAT_POOL) {
+    return 0;
+  }
+
+  int32_t f[IMU_FEAT_FEATURES];
+  uint64_t acc2 = 0, gyro2 = 0;
+  for (int c = 0; c < IMU_FEAT_CHANNELS; ++c) {
+    f[c] = st->sum[c];
+    f[8 + c] = st->tokens ? st->sum[c] - st->prev[c] : 0;
+    st->prev[c] = st->sum[c];
+    st->sum[c] = 0;
+  }
+  for (int c = 0; c < 3; ++c) {
+    acc2 += (uint64_t)((int64_t)f[c] * f[c]);
+    gyro2 += (uint64_t)((int64_t)f[3 + c] * f[3 + c]);
+  }
+  f[6] = (int32_t)isqrt64(acc2);
+  f[7] = (int32_t)isqrt64(gyro2);
+  st->count = 0;
+  st->tokens++;
+
+  for (int k = 0; k < IMU_FEAT_FEATURES; ++k) {
+    token[k] = norm_feature(f[k], k);
+  }
+  for (int d = IMU_FEAT_FEATURES; d < TINYFORMER_D; ++d) {
+    token[d] = 0;
+  }
+  return 1;
+}
+
+void imu_feat_window(const int16_t raw[IMU_FEAT_WINDOW][IMU_FEAT_CHANNELS],
+                     int8_t out[TINYFORMER_S][TINYFORMER_D]) {
+  imu_feat_t st;
+  int s = 0;
+  imu_feat_reset(&st);
+  for (int t = 0; t < IMU_FEAT_WINDOW; ++t) {
+    s += imu_feat_push(&st, raw[t], out[s]);
+  }
+}
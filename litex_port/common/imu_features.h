@@ -0,0 +1,73 @@
+// Streaming fixed-point UCI HAR feature stage: raw 50 Hz IMU samples in,
+// TinyFormer input tokens out, so the firmware can classify straight from the
+// sensors. Bit-exact with features_fixed() in training/preprocess_uci_har.py,
+// the integer model of its float downsample_and_features() + normalization.
+//
+// A raw sample is body accel x/y/z (g) and gyro x/y/z (rad/s) as int16 Q12
+// (IMU_FEAT_FRAC_BITS; the board driver converts its sensor counts). Every
+// IMU_FEAT_POOL samples the running channel sums become one token:
+//
+//   0..5   pooled ax, ay, az, gx, gy, gz  (sum of 8 Q12 samples = Q15 mean)
+//   6, 7   accel / gyro magnitude         (integer square root, Q15)
+//   8..13  pooled channels minus those of the previous token (0 for the
+//          first token after imu_feat_reset)
+//   14..   zero padding
+//
+// and each feature f is normalized to the int8 input scale as
+// clamp(((f - imu_norm_off[k]) * imu_norm_mul[k] + 2^23) >> 24, -127, 127),
+// i.e. (f - mean) / std * 32 of export_and_make_fpga_demo.py. The tables are
+// imu_features_norm.c, generated from the training mean/std.
+//
+// imu_feat_window() resets, so a 128-sample window gives the tokens of the
+// offline pipeline. A stream (DEMO_STREAM_IMU) pushes continuously: there the
+// deltas continue across window boundaries, where training zeroed them.
+
+#ifndef IMU_FEATURES_H
+#define IMU_FEATURES_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+#define IMU_FEAT_CHANNELS 6
+#define IMU_FEAT_FEATURES 14
+#define IMU_FEAT_POOL 8
+#define IMU_FEAT_WINDOW (TINYFORMER_S * IMU_FEAT_POOL)
+#define IMU_FEAT_FRAC_BITS 12
+#define IMU_FEAT_NORM_SHIFT 24
+
+#if TINYFORMER_D < IMU_FEAT_FEATURES
+#error "TINYFORMER_D must hold the IMU_FEAT_FEATURES features"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-feature normalization (imu_features_norm.c): offset in Q15, multiplier
+// 32 / std in 2^-(IMU_FEAT_NORM_SHIFT - 15) steps.
+extern const int32_t imu_norm_off[IMU_FEAT_FEATURES];
+extern const int32_t imu_norm_mul[IMU_FEAT_FEATURES];
+
+typedef struct {
+  int32_t sum[IMU_FEAT_CHANNELS];  // channel sums of the current token
+  int32_t prev[IMU_FEAT_CHANNELS]; // pooled channels of the previous token
+  uint32_t count;                  // samples in the current token
+  uint32_t tokens;                 // tokens emitted since the reset
+} imu_feat_t;
+
+void imu_feat_reset(imu_feat_t *st);
+
+// Adds one raw sample. Returns 1 and writes `token` when it completes a
+// token (every IMU_FEAT_POOL samples), 0 otherwise.
+int imu_feat_push(imu_feat_t *st, const int16_t sample[IMU_FEAT_CHANNELS],
+                  int8_t token[TINYFORMER_D]);
+
+// One window of IMU_FEAT_WINDOW samples -> S tokens, from a fresh state.
+void imu_feat_window(const int16_t raw[IMU_FEAT_WINDOW][IMU_FEAT_CHANNELS],
+                     int8_t out[TINYFORMER_S][TINYFORMER_D]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IMU_FEATURES_H */
@@ -0,0 +1,6 @@
+#include <stdint.h>
+#include "imu_features.h"
+
+// Training mean / std of the UCI HAR features (imu_features.h)
+const int32_t imu_norm_off[IMU_FEAT_FEATURES] = { -21, -10, -9, 17, -27, 4, 4127, 10316, 4, 2, -7, -7, -5, -1 };
+const int32_t imu_norm_mul[IMU_FEAT_FEATURES] = { 109381, 186622, 196366, 45821, 59280, 80658, 112406, 42816, 71802, 140525, 167007, 59083, 50300, 67627 };
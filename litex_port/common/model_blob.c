@@ -0,0 +1,266 @@
+// TinyFormer model blob loader (model_blob.h).
+
+#include "model_blob.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "model_blob: blobs are little-endian"
+#endif
+
+_Static_assert(sizeof(tf_blob_header_t) == 28, "model_blob: header layout");
+_Static_assert(sizeof(tf_blob_tensor_t) == 20, "model_blob: directory layout");
+
+#define TF_BLOB_CRC_AT offsetof(tf_blob_header_t, crc32)
+
+uint32_t tf_blob_crc32(uint32_t crc, const void *data, uint32_t n)
+{
+    // Nibble table of the reflected polynomial 0xEDB88320.
+    static const uint32_t t[16] = {
+        0x00000000u, 0x1DB71064u, 0x3B6E20C8u, 0x26D930ACu,
+        0x76DC4190u, 0x6B6B51F4u, 0x4DB26158u, 0x5005713Cu,
+        0xEDB88320u, 0xF00F9344u, 0xD6D6A3E8u, 0xCB61B38Cu,
+        0x9B64C2B0u, 0x86D3D2D4u, 0xA00AE278u, 0xBDBDF21Cu,
+    };
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t i;
+    crc = ~crc;
+    for (i = 0; i < n; ++i) {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ t[crc & 15u];
+        crc = (crc >> 4) ^ t[crc & 15u];
+    }
+    return ~crc;
+}
+
+static uint32_t tf_blob_crc_of(const uint8_t *b, uint32_t total)
+{
+    static const uint8_t zero[4] = {0, 0, 0, 0};
+    uint32_t crc = tf_blob_crc32(0, b, TF_BLOB_CRC_AT);
+    crc = tf_blob_crc32(crc, zero, 4);
+    return tf_blob_crc32(crc, b + TF_BLOB_CRC_AT + 4, total - TF_BLOB_CRC_AT - 4);
+}
+
+// Output rows of the layer of matrix / bias / requant index l (W_q ... W_ff2).
+static uint16_t tf_blob_rows(const tf_blob_header_t *h, int l)
+{
+    return (l == TINYFORMER_RQ_FF1) ? h->FFN : h->D;
+}
+
+// Expected dtype and shape of tensor id; 0 if id is not valid in blob h.
+static int tf_blob_expect(const tf_blob_header_t *h, uint16_t id,
+                          uint8_t *dtype, uint16_t *rows, uint16_t *cols)
+{
+    const uint16_t flags = h->flags, n_classes = h->n_classes;
+
+    *cols = 1;
+    if (id >= TF_BLOB_T_W_Q && id <= TF_BLOB_T_W_FF2) {
+        int l = id - TF_BLOB_T_W_Q;
+        *dtype = (flags & TF_BLOB_F_INT4) ? TF_BLOB_INT4 : TF_BLOB_INT8;
+        *rows = tf_blob_rows(h, l);
+        *cols = (l == TINYFORMER_RQ_FF2) ? h->FFN : h->D;
+        return 1;
+    }
+    if (id >= TF_BLOB_T_B_Q && id <= TF_BLOB_T_B_FF2) {
+        *dtype = TF_BLOB_INT8;
+        *rows = tf_blob_rows(h, id - TF_BLOB_T_B_Q);
+        return 1;
+    }
+    if ((flags & TF_BLOB_F_PER_CHANNEL) && (id & 0x0Fu) <= TINYFORMER_RQ_FF2 &&
+        (id & ~0x0Fu) >= TF_BLOB_T_RQ_BIAS && (id & ~0x0Fu) <= TF_BLOB_T_RQ_SHIFT) {
+        *dtype = ((id & ~0x0Fu) == TF_BLOB_T_RQ_SHIFT) ? TF_BLOB_UINT8 : TF_BLOB_INT32;
+        *rows = tf_blob_rows(h, id & 0x0Fu);
+        return 1;
+    }
+    if (n_classes != 0 && id >= TF_BLOB_T_CLS_W && id < TF_BLOB_T_END) {
+        if (id == TF_BLOB_T_EXIT_IN_MARGIN || id == TF_BLOB_T_EXIT_ATTN_MARGIN) {
+            *dtype = TF_BLOB_INT32;
+            *rows = 1;
+        } else if (id == TF_BLOB_T_CLS_W || id == TF_BLOB_T_EXIT_IN_W ||
+                   id == TF_BLOB_T_EXIT_ATTN_W) {
+            *dtype = TF_BLOB_INT8;
+            *rows = n_classes;
+            *cols = h->D;
+        } else {
+            *dtype = TF_BLOB_INT8;
+            *rows = n_classes;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static uint32_t tf_blob_data_bytes(uint8_t dtype, uint16_t rows, uint16_t cols)
+{
+    uint32_t n = (uint32_t)rows * cols;
+    switch (dtype) {
+    case TF_BLOB_INT4:  return n / 2u;
+    case TF_BLOB_INT32: return n * 4u;
+    default:            return n;
+    }
+}
+
+// a is immediately followed by b (both present).
+static int tf_blob_follows(const uint8_t *const *slot, const uint32_t *size,
+                           int a, int b)
+{
+    return slot[a] != 0 && slot[b] != 0 && slot[a] + size[a] == slot[b];
+}
+
+static int tf_blob_head(tinyformer_head_t *h, const uint8_t *const *slot,
+                        int w, int b, uint16_t n_classes)
+{
+    h->W = (const int8_t *)slot[w];
+    h->b = (const int8_t *)slot[b];
+    h->n_classes = (h->W != 0 && h->b != 0) ? n_classes : 0;
+    return (h->W != 0) == (h->b != 0);
+}
+
+int tf_blob_load(tf_model_t *m, const void *blob, uint32_t bytes)
+{
+    return tf_blob_load_shape(m, blob, bytes, TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN);
+}
+
+int tf_blob_load_shape(tf_model_t *m, const void *blob, uint32_t bytes,
+                       int S, int D, int FFN)
+{
+    const uint8_t *b = (const uint8_t *)blob;
+    const tf_blob_header_t *h = (const tf_blob_header_t *)blob;
+    const tf_blob_tensor_t *dir;
+    const uint8_t *slot[TF_BLOB_T_END];
+    uint32_t size[TF_BLOB_T_END];
+    uint32_t dir_end;
+    uint16_t flags;
+    int i, l, fused = 1;
+
+    if (b == 0 || ((uintptr_t)b & 3u) != 0 || bytes < sizeof(*h)) {
+        return TF_BLOB_E_SIZE;
+    }
+    if (h->magic != TF_BLOB_MAGIC) {
+        return TF_BLOB_E_MAGIC;
+    }
+    if (h->version != TF_BLOB_VERSION) {
+        return TF_BLOB_E_VERSION;
+    }
+    dir_end = h->header_bytes + (uint32_t)h->n_tensors * sizeof(tf_blob_tensor_t);
+    if (h->header_bytes < sizeof(*h) || (h->header_bytes & 3u) != 0 ||
+        h->total_bytes > bytes || h->total_bytes < dir_end) {
+        return TF_BLOB_E_SIZE;
+    }
+    if (h->S != S || h->D != D || h->FFN != FFN) {
+        return TF_BLOB_E_SHAPE;
+    }
+    flags = h->flags;
+    if ((flags & ~(TF_BLOB_F_PER_CHANNEL | TF_BLOB_F_INT4 | TF_BLOB_F_HEADS_MASK)) != 0 ||
+        (flags & TF_BLOB_F_HEADS_MASK) >> TF_BLOB_F_HEADS_SHIFT != TINYFORMER_HEADS - 1 ||
+        ((flags & TF_BLOB_F_INT4) != 0) != (TINYFORMER_INT4_WEIGHTS != 0) ||
+        ((flags & TF_BLOB_F_INT4) && !(flags & TF_BLOB_F_PER_CHANNEL)) ||
+        ((flags & TF_BLOB_F_PER_CHANNEL) && !TINYFORMER_PER_CHANNEL_REQUANT)) {
+        return TF_BLOB_E_FORMAT;
+    }
+    if (tf_blob_crc_of(b, h->total_bytes) != h->crc32) {
+        return TF_BLOB_E_CRC;
+    }
+
+    for (i = 0; i < TF_BLOB_T_END; ++i) {
+        slot[i] = 0;
+        size[i] = 0;
+    }
+    dir = (const tf_blob_tensor_t *)(const void *)&b[h->header_bytes];
+    for (i = 0; i < h->n_tensors; ++i) {
+        const tf_blob_tensor_t *t = &dir[i];
+        uint8_t dtype;
+        uint16_t rows, cols;
+        if (!tf_blob_expect(h, t->id, &dtype, &rows, &cols) ||
+            slot[t->id] != 0 || t->dtype != dtype || t->rows != rows ||
+            t->cols != cols || t->bytes != tf_blob_data_bytes(dtype, rows, cols) ||
+            (t->offset & (TF_BLOB_ALIGN - 1u)) != 0 || t->offset < dir_end ||
+            t->offset > h->total_bytes || t->bytes > h->total_bytes - t->offset) {
+            return TF_BLOB_E_TENSOR;
+        }
+        slot[t->id] = &b[t->offset];
+        size[t->id] = t->bytes;
+    }
+
+    for (l = 0; l <= TINYFORMER_RQ_FF2; ++l) {
+        if (slot[TF_BLOB_T_W_Q + l] == 0 || slot[TF_BLOB_T_B_Q + l] == 0) {
+            return TF_BLOB_E_MISSING;
+        }
+        if ((flags & TF_BLOB_F_PER_CHANNEL) &&
+            (slot[TF_BLOB_T_RQ_BIAS + l] == 0 || slot[TF_BLOB_T_RQ_MUL + l] == 0 ||
+             slot[TF_BLOB_T_RQ_SHIFT + l] == 0)) {
+            return TF_BLOB_E_MISSING;
+        }
+    }
+    if (h->n_classes != 0 && (slot[TF_BLOB_T_CLS_W] == 0 || slot[TF_BLOB_T_CLS_B] == 0)) {
+        return TF_BLOB_E_MISSING;
+    }
+
+#define TF_BLOB_W(id) ((const tinyformer_wword_t *)(const void *)slot[id])
+#define TF_BLOB_B(id) ((const int8_t *)slot[id])
+    m->header = h;
+    m->weights.W_q   = TF_BLOB_W(TF_BLOB_T_W_Q);
+    m->weights.W_k   = TF_BLOB_W(TF_BLOB_T_W_K);
+    m->weights.W_v   = TF_BLOB_W(TF_BLOB_T_W_V);
+    m->weights.W_o   = TF_BLOB_W(TF_BLOB_T_W_O);
+    m->weights.W_ff1 = TF_BLOB_W(TF_BLOB_T_W_FF1);
+    m->weights.W_ff2 = TF_BLOB_W(TF_BLOB_T_W_FF2);
+    m->weights.b_q   = TF_BLOB_B(TF_BLOB_T_B_Q);
+    m->weights.b_k   = TF_BLOB_B(TF_BLOB_T_B_K);
+    m->weights.b_v   = TF_BLOB_B(TF_BLOB_T_B_V);
+    m->weights.b_o   = TF_BLOB_B(TF_BLOB_T_B_O);
+    m->weights.b_ff1 = TF_BLOB_B(TF_BLOB_T_B_FF1);
+    m->weights.b_ff2 = TF_BLOB_B(TF_BLOB_T_B_FF2);
+    m->weights.W_qkv = 0;
+    m->weights.b_qkv = 0;
+    m->weights.rq    = 0;
+    m->weights.sparse = 0;
+    m->weights.lowrank = 0;
+    m->weights.d_in  = 0;
+    m->weights.W_qk  = 0;
+    m->weights.b_qk  = 0;
+    m->weights.qk_shift = 0;
+    m->weights.W_ff2_cols = 0;
+#undef TF_BLOB_W
+#undef TF_BLOB_B
+
+    // Q, K, V back to back form the fused [3D] block.
+    for (l = TINYFORMER_RQ_Q; l < TINYFORMER_RQ_V; ++l) {
+        fused &= tf_blob_follows(slot, size, TF_BLOB_T_W_Q + l, TF_BLOB_T_W_Q + l + 1);
+        fused &= tf_blob_follows(slot, size, TF_BLOB_T_B_Q + l, TF_BLOB_T_B_Q + l + 1);
+        if (flags & TF_BLOB_F_PER_CHANNEL) {
+            fused &= tf_blob_follows(slot, size, TF_BLOB_T_RQ_BIAS + l, TF_BLOB_T_RQ_BIAS + l + 1);
+            fused &= tf_blob_follows(slot, size, TF_BLOB_T_RQ_MUL + l, TF_BLOB_T_RQ_MUL + l + 1);
+            fused &= tf_blob_follows(slot, size, TF_BLOB_T_RQ_SHIFT + l, TF_BLOB_T_RQ_SHIFT + l + 1);
+        }
+    }
+
+    if (flags & TF_BLOB_F_PER_CHANNEL) {
+        for (l = 0; l <= TINYFORMER_RQ_FF2; ++l) {
+            m->rq[l].bias  = (const int32_t *)(const void *)slot[TF_BLOB_T_RQ_BIAS + l];
+            m->rq[l].mul   = (const int32_t *)(const void *)slot[TF_BLOB_T_RQ_MUL + l];
+            m->rq[l].shift = slot[TF_BLOB_T_RQ_SHIFT + l];
+        }
+        m->rq[TINYFORMER_RQ_QKV] = m->rq[TINYFORMER_RQ_Q];
+        m->weights.rq = m->rq;
+    }
+    if (TINYFORMER_FUSED_QKV && fused) {
+        m->weights.W_qkv = m->weights.W_q;
+        m->weights.b_qkv = m->weights.b_q;
+    }
+
+    if (!tf_blob_head(&m->head, slot, TF_BLOB_T_CLS_W, TF_BLOB_T_CLS_B, h->n_classes) ||
+        !tf_blob_head(&m->exit_in.head, slot, TF_BLOB_T_EXIT_IN_W, TF_BLOB_T_EXIT_IN_B,
+                      h->n_classes) ||
+        !tf_blob_head(&m->exit_attn.head, slot, TF_BLOB_T_EXIT_ATTN_W, TF_BLOB_T_EXIT_ATTN_B,
+                      h->n_classes)) {
+        return TF_BLOB_E_MISSING;
+    }
+    m->exit_in.margin = slot[TF_BLOB_T_EXIT_IN_MARGIN]
+                            ? *(const int32_t *)(const void *)slot[TF_BLOB_T_EXIT_IN_MARGIN]
+                            : INT32_MAX;
+    m->exit_attn.margin = slot[TF_BLOB_T_EXIT_ATTN_MARGIN]
+                              ? *(const int32_t *)(const void *)slot[TF_BLOB_T_EXIT_ATTN_MARGIN]
+                              : INT32_MAX;
+    return TF_BLOB_OK;
+}
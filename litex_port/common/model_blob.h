@@ -0,0 +1,139 @@
+// TinyFormer model blob: one binary image holding the encoder weights and
+// the classifier heads, loaded in place (no copy) from flash, SDRAM or a
+// UART receive buffer.
+//
+// Layout (little‑endian, written by tools/export_weights.py --blob):
+//   tf_blob_header_t                         header_bytes
+//   tf_blob_tensor_t [n_tensors]             tensor directory
+//   tensor data                              each at a TF_BLOB_ALIGN offset
+// Offsets are from the start of the blob, and crc32 (CRC‑32/IEEE, as
+// zlib.crc32) covers bytes [0, total_bytes) with the crc32 field read as 0.
+// W_q, W_k and W_v (and their biases and requant tensors) are written back
+// to back, so TINYFORMER_FUSED_QKV builds use them as the [3D] block.
+//
+// Matrices are row‑major int8 (also the TINYFORMER_PACKED_WEIGHTS words on
+// a little‑endian target) or, with TF_BLOB_F_INT4, the 8‑nibble words of
+// TINYFORMER_INT4_WEIGHTS. TF_BLOB_F_PER_CHANNEL blobs carry the
+// tinyformer_requant_t tensors of every layer.
+//
+// Usage:
+//   tf_model_t m;
+//   if (tf_blob_load(&m, blob, blob_bytes) == TF_BLOB_OK) {
+//       ctx.weights = &m.weights;
+//       tinyformer_classify_ctx(&ctx, &m.head, input, logits, &cksum);
+//   }
+// The blob must stay mapped and unchanged while m is in use.
+
+#ifndef MODEL_BLOB_H
+#define MODEL_BLOB_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+#define TF_BLOB_MAGIC   0x424D4654u  // "TFMB"
+#define TF_BLOB_VERSION 1u
+#define TF_BLOB_ALIGN   16u          // tensor data alignment (DOT8 / GEMV word loads)
+
+// tf_blob_header_t.flags
+#define TF_BLOB_F_PER_CHANNEL 0x0001u  // requant tensors (--per-channel / --int4)
+#define TF_BLOB_F_INT4        0x0002u  // int4 matrices (--int4)
+#define TF_BLOB_F_HEADS_SHIFT 8        // attention heads - 1 (TINYFORMER_HEADS)
+#define TF_BLOB_F_HEADS_MASK  0xFF00u
+
+typedef struct {
+    uint32_t magic;         // TF_BLOB_MAGIC
+    uint16_t version;       // TF_BLOB_VERSION
+    uint16_t header_bytes;  // offset of the tensor directory
+    uint16_t S, D, FFN;     // encoder shape
+    uint16_t n_classes;     // classifier classes, 0 if no heads
+    uint16_t n_tensors;     // directory entries
+    uint16_t flags;         // TF_BLOB_F_*
+    uint32_t total_bytes;   // whole blob, header included
+    uint32_t crc32;         // over [0, total_bytes), this field as 0
+} tf_blob_header_t;
+
+typedef struct {
+    uint16_t id;            // TF_BLOB_T_*
+    uint8_t  dtype;         // TF_BLOB_INT8 ...
+    uint8_t  reserved;      // 0
+    uint16_t rows, cols;    // logical shape ([n][1] for vectors)
+    uint32_t offset;        // from the start of the blob, TF_BLOB_ALIGN aligned
+    uint32_t bytes;         // data bytes (no padding)
+    uint32_t scale;         // float32 bits: real = q / scale (0: per channel)
+} tf_blob_tensor_t;
+
+// tf_blob_tensor_t.dtype
+enum {
+    TF_BLOB_INT8 = 1,
+    TF_BLOB_INT4 = 2,       // uint32 words of 8 nibbles, [rows][cols / 8]
+    TF_BLOB_INT32 = 3,
+    TF_BLOB_UINT8 = 4
+};
+
+// tf_blob_tensor_t.id. Requant tensors are TF_BLOB_T_RQ_* + TINYFORMER_RQ_Q
+// ... TINYFORMER_RQ_FF2 (the fused block is not stored).
+enum {
+    TF_BLOB_T_W_Q = 1,
+    TF_BLOB_T_W_K,
+    TF_BLOB_T_W_V,
+    TF_BLOB_T_W_O,
+    TF_BLOB_T_W_FF1,
+    TF_BLOB_T_W_FF2,
+    TF_BLOB_T_B_Q,
+    TF_BLOB_T_B_K,
+    TF_BLOB_T_B_V,
+    TF_BLOB_T_B_O,
+    TF_BLOB_T_B_FF1,
+    TF_BLOB_T_B_FF2,
+    TF_BLOB_T_RQ_BIAS = 0x20,      // int32 [rows]
+    TF_BLOB_T_RQ_MUL = 0x30,       // int32 [rows]
+    TF_BLOB_T_RQ_SHIFT = 0x40,     // uint8 [rows]
+    TF_BLOB_T_CLS_W = 0x50,        // int8 [n_classes][D]
+    TF_BLOB_T_CLS_B,               // int8 [n_classes]
+    TF_BLOB_T_EXIT_IN_W,
+    TF_BLOB_T_EXIT_IN_B,
+    TF_BLOB_T_EXIT_IN_MARGIN,      // int32 [1]
+    TF_BLOB_T_EXIT_ATTN_W,
+    TF_BLOB_T_EXIT_ATTN_B,
+    TF_BLOB_T_EXIT_ATTN_MARGIN,
+    TF_BLOB_T_END                  // first unused id
+};
+
+// tf_blob_load() results.
+enum {
+    TF_BLOB_OK = 0,
+    TF_BLOB_E_SIZE = -1,     // null, misaligned, truncated or inconsistent sizes
+    TF_BLOB_E_MAGIC = -2,
+    TF_BLOB_E_VERSION = -3,
+    TF_BLOB_E_SHAPE = -4,    // S / D / FFN differ from this build (or the instance)
+    TF_BLOB_E_FORMAT = -5,   // flags not supported by this build
+    TF_BLOB_E_CRC = -6,
+    TF_BLOB_E_TENSOR = -7,   // unknown, duplicate, misplaced or misshapen tensor
+    TF_BLOB_E_MISSING = -8   // a required tensor is absent
+};
+
+// Model viewed in place in a blob. head / exit_in.head / exit_attn.head have
+// n_classes 0 when the blob has no such head.
+typedef struct {
+    const tf_blob_header_t *header;
+    tinyformer_weights_t    weights;
+    tinyformer_requant_t    rq[TINYFORMER_RQ_COUNT];
+    tinyformer_head_t       head;
+    tinyformer_exit_t       exit_in, exit_attn;
+} tf_model_t;
+
+// Validate blob (4‑byte aligned, bytes available) and point m into it.
+// Returns TF_BLOB_OK or a TF_BLOB_E_* code (m is then unusable).
+int tf_blob_load(tf_model_t *m, const void *blob, uint32_t bytes);
+
+// tf_blob_load() for an encoder instance of shape S / D / FFN (a
+// TINYFORMER_SHAPES entry, e.g. a model tier of model_tiers.h) instead of
+// the default shape: TF_BLOB_E_SHAPE unless the blob has exactly that shape.
+// m->weights and the heads are then [D]‑ and [FFN]‑sized for the instance.
+int tf_blob_load_shape(tf_model_t *m, const void *blob, uint32_t bytes,
+                       int S, int D, int FFN);
+
+// CRC‑32/IEEE of n bytes continuing from crc (0 to start), as zlib.crc32.
+uint32_t tf_blob_crc32(uint32_t crc, const void *data, uint32_t n);
+
+#endif // MODEL_BLOB_H
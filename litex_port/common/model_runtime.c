@@ -0,0 +1,134 @@
+// Multi‑model runtime: shared‑encoder heads and a model scheduler (model_runtime.h).
+
+#include "model_runtime.h"
+#include "cycle_counter.h"
+#include <stdint.h>
+
+#define TF_RT_BARRIER() __asm__ volatile("" ::: "memory")
+
+void tf_rt_init(tf_rt_t *rt, int policy)
+{
+    rt->n_models = 0;
+    rt->policy = policy;
+    rt->last = -1;
+}
+
+int tf_rt_add_model(tf_rt_t *rt, const tinyformer_weights_t *w, void *ws, uint32_t ws_bytes,
+                    int priority)
+{
+    tf_rt_model_t *m;
+
+    if (rt->n_models >= TF_RT_MAX_MODELS) {
+        return -1;
+    }
+    m = &rt->model[rt->n_models];
+    if (tinyformer_ctx_init(&m->ctx, ws, ws_bytes) != 0) {
+        return -1;
+    }
+    m->ctx.weights = w;
+    m->blob.header = 0;
+    m->n_heads = 0;
+    m->n_logits = 0;
+    m->priority = priority;
+    m->input = 0;
+    m->pending = 0;
+    m->submitted = 0;
+    return rt->n_models++;
+}
+
+int tf_rt_add_blob(tf_rt_t *rt, const void *blob, uint32_t bytes, void *ws, uint32_t ws_bytes,
+                   int priority, int *err)
+{
+    tf_rt_model_t *m;
+    int code, id;
+
+    if (err != 0) {
+        *err = TF_BLOB_OK;
+    }
+    if (rt->n_models >= TF_RT_MAX_MODELS) {
+        return -1;
+    }
+    // The context reads the weights of the blob view held by the model.
+    id = tf_rt_add_model(rt, &rt->model[rt->n_models].blob.weights, ws, ws_bytes, priority);
+    if (id < 0) {
+        return id;
+    }
+    m = &rt->model[id];
+    code = tf_blob_load(&m->blob, blob, bytes);
+    if (err != 0) {
+        *err = code;
+    }
+    if (code != TF_BLOB_OK) {
+        rt->n_models--;
+        return -1;
+    }
+    if (m->blob.head.n_classes > 0 && tf_rt_add_head(rt, id, &m->blob.head) < 0) {
+        rt->n_models--;
+        return -1;
+    }
+    return id;
+}
+
+int tf_rt_add_head(tf_rt_t *rt, int model, const tinyformer_head_t *head)
+{
+    tf_rt_model_t *m = &rt->model[model];
+
+    if (m->n_heads >= TF_RT_MAX_HEADS || head->n_classes < 1 ||
+        m->n_logits + head->n_classes > TF_RT_MAX_LOGITS) {
+        return -1;
+    }
+    m->head[m->n_heads] = *head;
+    m->n_logits += head->n_classes;
+    return m->n_heads++;
+}
+
+int tf_rt_submit(tf_rt_t *rt, int model, const int8_t window[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_rt_model_t *m = &rt->model[model];
+
+    if (m->pending || m->n_heads == 0) {
+        return -1;
+    }
+    m->input = window;
+    TF_RT_BARRIER();
+    m->pending = 1;
+    return 0;
+}
+
+int tf_rt_step(tf_rt_t *rt)
+{
+    tf_rt_model_t *m;
+    int best = -1;
+    int i;
+    uint32_t t0;
+
+    for (i = 1; i <= rt->n_models; ++i) {
+        int k = (rt->last + i) % rt->n_models;
+        if (!rt->model[k].pending) {
+            continue;
+        }
+        if (best < 0 ||
+            (rt->policy == TF_RT_PRIORITY && rt->model[k].priority > rt->model[best].priority)) {
+            best = k;
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+    m = &rt->model[best];
+    TF_RT_BARRIER();
+    t0 = cycle_counter_read();
+    tinyformer_classify_heads_ctx(&m->ctx, m->head, m->n_heads, m->input, m->result.logits,
+                                  m->result.label, &m->result.cksum);
+    m->result.cycles = cycle_counter_read() - t0;
+    m->result.window = m->submitted++;
+    rt->last = best;
+    TF_RT_BARRIER();
+    m->pending = 0;
+    return best;
+}
+
+const tf_rt_result_t *tf_rt_result(const tf_rt_t *rt, int model)
+{
+    return &rt->model[model].result;
+}
@@ -0,0 +1,118 @@
+// Multi‑model runtime: several TinyFormer models on one device, each with
+// its own reentrant context (tinyformer_ctx_t) and any number of classifier
+// heads on its encoder.
+//
+// A model's encoder runs once per window and the pooled output fans out to
+// every head registered on it (tinyformer_classify_heads_ctx), e.g. activity
+// classes and a fall / anomaly score on the same windows. Models are weight
+// sets or model blobs (model_blob.h) of their own and run on separate
+// workspaces, so they never clobber each other's buffers. Windows are
+// submitted per model; tf_rt_step() runs one pending model, picked
+// round‑robin or by priority (TF_RT_PRIORITY, ties round‑robin).
+//
+// Usage:
+//   static uint8_t ws_har[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+//   static uint8_t ws_aux[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+//   tf_rt_t rt;
+//   tf_rt_init(&rt, TF_RT_PRIORITY);
+//   int har = tf_rt_add_model(&rt, &tinyformer_default_weights, ws_har, sizeof(ws_har), 1);
+//   tf_rt_add_head(&rt, har, &cls_head);
+//   tf_rt_add_head(&rt, har, &fall_head);
+//   int aux = tf_rt_add_blob(&rt, blob, blob_bytes, ws_aux, sizeof(ws_aux), 0, &err);
+//   tf_rt_submit(&rt, har, window);
+//   tf_rt_submit(&rt, aux, window);
+//   while ((m = tf_rt_step(&rt)) >= 0) { const tf_rt_result_t *r = tf_rt_result(&rt, m); ... }
+//
+// The DOT8 / GEMV / exp LUT peripherals stay shared (see tinyformer_ctx_t),
+// so all models of a runtime must run from one thread.
+
+#ifndef MODEL_RUNTIME_H
+#define MODEL_RUNTIME_H
+
+#include "model_blob.h"
+#include "tinyformer.h"
+#include <stdint.h>
+
+// Models per runtime.
+#ifndef TF_RT_MAX_MODELS
+#define TF_RT_MAX_MODELS 2
+#endif
+
+// Heads per model, and their logits together.
+#ifndef TF_RT_MAX_HEADS
+#define TF_RT_MAX_HEADS 4
+#endif
+#ifndef TF_RT_MAX_LOGITS
+#define TF_RT_MAX_LOGITS 16
+#endif
+
+// tf_rt_init() scheduling policies.
+enum {
+    TF_RT_ROUND_ROBIN = 0,  // pending models in turn
+    TF_RT_PRIORITY = 1      // highest priority first (lower ones may starve)
+};
+
+// Last window a model ran.
+typedef struct {
+    uint32_t window;                     // submission count of the window (from 0)
+    uint32_t cycles;                     // encoder and heads
+    uint32_t cksum;                      // ENC_CKSUM of the encoder output
+    int      label[TF_RT_MAX_HEADS];     // argmax per head
+    int32_t  logits[TF_RT_MAX_LOGITS];   // per head, in registration order
+} tf_rt_result_t;
+
+typedef struct {
+    tinyformer_ctx_t      ctx;           // ctx.weights: the model
+    tf_model_t            blob;          // view of the model's blob, if any
+    tinyformer_head_t     head[TF_RT_MAX_HEADS];
+    int                   n_heads;
+    int                   n_logits;
+    int                   priority;
+    const int8_t        (*input)[TINYFORMER_D];  // submitted window
+    volatile int          pending;
+    uint32_t              submitted;
+    tf_rt_result_t        result;
+} tf_rt_model_t;
+
+typedef struct {
+    tf_rt_model_t model[TF_RT_MAX_MODELS];
+    int           n_models;
+    int           policy;                // TF_RT_*
+    int           last;                  // model run last (round‑robin start)
+} tf_rt_t;
+
+// Empty runtime with policy TF_RT_ROUND_ROBIN or TF_RT_PRIORITY.
+void tf_rt_init(tf_rt_t *rt, int policy);
+
+// Register a model on weights w (must stay valid) and its workspace
+// (tinyformer_ctx_init()). Returns the model index, or -1 if the runtime is
+// full or the workspace is unusable.
+int tf_rt_add_model(tf_rt_t *rt, const tinyformer_weights_t *w, void *ws, uint32_t ws_bytes,
+                    int priority);
+
+// tf_rt_add_model() for the model blob at blob (tf_blob_load(); the blob must
+// stay mapped), with the blob's classifier as head 0 if it has one. Returns
+// the model index, or -1 as tf_rt_add_model() or if the blob does not load;
+// *err (may be null) receives the tf_blob_load() code.
+int tf_rt_add_blob(tf_rt_t *rt, const void *blob, uint32_t bytes, void *ws, uint32_t ws_bytes,
+                   int priority, int *err);
+
+// Add a head (copied; its W and b must stay valid) to model. Returns the head
+// index, or -1 if the model has TF_RT_MAX_HEADS heads or its logits would
+// exceed TF_RT_MAX_LOGITS.
+int tf_rt_add_head(tf_rt_t *rt, int model, const tinyformer_head_t *head);
+
+// Queue window for model; it is read when the model runs and must not change
+// until then. Returns 0, or -1 if the model still has a window pending (or
+// has no head). Safe from an ISR while the main loop steps the runtime.
+int tf_rt_submit(tf_rt_t *rt, int model, const int8_t window[TINYFORMER_S][TINYFORMER_D]);
+
+// Run the next pending model (policy order): encode its window once, apply
+// every head and fill its result. Returns the model index, or -1 if nothing
+// is pending.
+int tf_rt_step(tf_rt_t *rt);
+
+// Result of model's last window.
+const tf_rt_result_t *tf_rt_result(const tf_rt_t *rt, int model);
+
+#endif // MODEL_RUNTIME_H
@@ -0,0 +1,118 @@
+// Model tiers: boot‑time pick of a distilled encoder from a tier pack
+// (model_tiers.h). Empty unless TINYFORMER_TIERS.
+
+#include "tinyformer.h"
+
+#if TINYFORMER_TIERS
+#include "model_tiers.h"
+#include <stdint.h>
+
+_Static_assert(TINYFORMER_S % TINYFORMER_TIER_MEDIUM_S == 0 &&
+               TINYFORMER_S % TINYFORMER_TIER_SMALL_S == 0,
+               "model_tiers: a tier's S must divide TINYFORMER_S");
+
+// The instances take [S][D] arrays; the table takes their rows flat.
+#define TF_TIER_POOL(name, S, D)                                               \
+    static void name##_tier(const tinyformer_weights_t *w, const int8_t *input,\
+                            tinyformer_pool_t *pool)                           \
+    {                                                                          \
+        name##_pool(w, (const int8_t(*)[D])(const void *)input, pool);         \
+    }
+TF_TIER_POOL(tinyformer_encode_with, TINYFORMER_S, TINYFORMER_D)
+TF_TIER_POOL(tinyformer_encode_medium, TINYFORMER_TIER_MEDIUM_S, TINYFORMER_TIER_MEDIUM_D)
+TF_TIER_POOL(tinyformer_encode_small, TINYFORMER_TIER_SMALL_S, TINYFORMER_TIER_SMALL_D)
+#undef TF_TIER_POOL
+
+const tf_tier_shape_t tf_tier_shapes[TF_TIER_COUNT] = {
+    {"large", TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN, tinyformer_encode_with_tier},
+    {"medium", TINYFORMER_TIER_MEDIUM_S, TINYFORMER_TIER_MEDIUM_D, TINYFORMER_TIER_MEDIUM_FFN,
+     tinyformer_encode_medium_tier},
+    {"small", TINYFORMER_TIER_SMALL_S, TINYFORMER_TIER_SMALL_D, TINYFORMER_TIER_SMALL_FFN,
+     tinyformer_encode_small_tier},
+};
+
+// Tier of blob header h (tier, or any tier for TF_TIER_ANY); -1 if none.
+static int tf_tier_of(const tf_blob_header_t *h, int tier)
+{
+    int k;
+    for (k = 0; k < TF_TIER_COUNT; ++k) {
+        const tf_tier_shape_t *s = &tf_tier_shapes[k];
+        if ((tier == TF_TIER_ANY || tier == k) &&
+            h->S == s->S && h->D == s->D && h->FFN == s->FFN) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+int tf_tier_load(tf_tier_t *t, const void *pack, uint32_t bytes, int tier)
+{
+    const uint8_t *p = (const uint8_t *)pack;
+    uint32_t off = 0;
+    int err = TF_BLOB_E_SHAPE;
+
+    if (p == 0 || ((uintptr_t)p & 3u) != 0) {
+        return TF_BLOB_E_SIZE;
+    }
+    // Walk the blobs by their total_bytes; the pack ends at the first
+    // offset without a blob header.
+    while (bytes - off >= sizeof(tf_blob_header_t)) {
+        const tf_blob_header_t *h = (const tf_blob_header_t *)(const void *)&p[off];
+        int k;
+        if (h->magic != TF_BLOB_MAGIC || h->total_bytes < sizeof(*h) ||
+            h->total_bytes > bytes - off) {
+            break;
+        }
+        k = tf_tier_of(h, tier);
+        if (k >= 0) {
+            const tf_tier_shape_t *s = &tf_tier_shapes[k];
+            err = tf_blob_load_shape(&t->model, h, bytes - off, s->S, s->D, s->FFN);
+            if (err == TF_BLOB_OK && t->model.head.n_classes == 0) {
+                err = TF_BLOB_E_MISSING;
+            }
+            if (err == TF_BLOB_OK) {
+                t->tier = k;
+                t->shape = s;
+                t->pool.attn_exit = 0;
+                t->pool.logits = 0;
+                return TF_BLOB_OK;
+            }
+        }
+        off += (h->total_bytes + TF_BLOB_ALIGN - 1u) & ~(TF_BLOB_ALIGN - 1u);
+        if (off >= bytes) {
+            break;
+        }
+    }
+    return err;
+}
+
+int tf_tier_classify(tf_tier_t *t, const int8_t window[TINYFORMER_S][TINYFORMER_D],
+                     int32_t *logits, uint32_t *cksum)
+{
+    const tf_tier_shape_t *s = t->shape;
+    const int32_t m = TINYFORMER_S / s->S;
+    int32_t g, d, j;
+
+    // Token pool of m frames (floor((sum + m / 2) / m) on the non‑negative
+    // sum + 128 m), first D features, zeros past TINYFORMER_D.
+    for (g = 0; g < s->S; ++g) {
+        int8_t *row = &t->input[g * s->D];
+        for (d = 0; d < s->D; ++d) {
+            int32_t sum = 128 * m + m / 2;
+            if (d >= TINYFORMER_D) {
+                row[d] = 0;
+                continue;
+            }
+            for (j = 0; j < m; ++j) {
+                sum += window[g * m + j][d];
+            }
+            row[d] = (int8_t)(sum / m - 128);
+        }
+    }
+    s->pool(&t->model.weights, t->input, &t->pool);
+    if (cksum != 0) {
+        *cksum = t->pool.cksum;
+    }
+    return tinyformer_head_apply(&t->model.head, &t->pool, s->S, s->D, logits);
+}
+#endif
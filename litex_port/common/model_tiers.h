@@ -0,0 +1,84 @@
+// Model tiers: the default (large) encoder and the distilled medium / small
+// students of training/train_tinyformer_uci_har.py --distill in one
+// firmware, one of them picked at boot from a tier pack
+// (TINYFORMER_TIERS=1, make TIERS=1).
+//
+//   tier     S    D    FFN   instance (tinyformer_shapes.h)
+//   large    16   32   64    tinyformer_encode_with (default shape)
+//   medium   8    32   64    tinyformer_encode_medium
+//   small    8    16   32    tinyformer_encode_small
+//
+// A tier pack is model blobs (model_blob.h) back to back, each starting at
+// a TF_BLOB_ALIGN offset; training/export_and_make_fpga_demo.py writes
+// artifacts/model_tiers.blob, and a single blob is a pack of one. Every blob
+// keeps its own shape in its header, and tf_tier_load() points the instance
+// of that shape at the blob's tensors in place, so the students need no
+// compiled‑in weights.
+//
+// A tier classifies the default [TINYFORMER_S][TINYFORMER_D] windows: groups
+// of TINYFORMER_S / S frames are averaged (rounded, as the token pool of
+// tinyformer_stack_encode_pooled()) and the first D features are kept, the
+// input the students are trained on.
+//
+// Usage:
+//   static tf_tier_t tier;
+//   if (tf_tier_load(&tier, pack, pack_bytes, TF_TIER_SMALL) == TF_BLOB_OK)
+//       label = tf_tier_classify(&tier, window, logits, &cksum);
+// Tiers run on the shared scratch of the non‑ctx API (one thread).
+
+#ifndef MODEL_TIERS_H
+#define MODEL_TIERS_H
+
+#include "model_blob.h"
+#include "tinyformer.h"
+#include <stdint.h>
+
+#if !TINYFORMER_TIERS
+#error "model_tiers.h needs TINYFORMER_TIERS=1 (make TIERS=1)"
+#endif
+
+// Tiers, largest first; TF_TIER_ANY takes the first blob of a pack whose
+// shape is one of them.
+enum {
+    TF_TIER_ANY = -1,
+    TF_TIER_LARGE = 0,
+    TF_TIER_MEDIUM,
+    TF_TIER_SMALL,
+    TF_TIER_COUNT
+};
+
+// Pooled encoder pass of one tier's instance over input[S][D].
+typedef void (*tf_tier_pool_fn)(const tinyformer_weights_t *w, const int8_t *input,
+                                tinyformer_pool_t *pool);
+
+typedef struct {
+    const char     *name;   // "large", "medium", "small"
+    uint16_t        S, D, FFN;
+    tf_tier_pool_fn pool;
+} tf_tier_shape_t;
+
+// Compiled‑in tiers, indexed by TF_TIER_*.
+extern const tf_tier_shape_t tf_tier_shapes[TF_TIER_COUNT];
+
+// A loaded tier. model views the blob, which must stay mapped and unchanged.
+typedef struct {
+    int                    tier;   // TF_TIER_*
+    const tf_tier_shape_t *shape;
+    tf_model_t             model;
+    tinyformer_pool_t      pool;
+    int8_t                 input[TINYFORMER_S * TINYFORMER_MAX_D] __attribute__((aligned(4)));
+} tf_tier_t;
+
+// Load the first blob of pack (bytes mapped, 4‑byte aligned) with the shape
+// of tier (TF_TIER_ANY: of any tier). Returns TF_BLOB_OK, TF_BLOB_E_SHAPE
+// if the pack has no blob of that shape, TF_BLOB_E_MISSING if it has no
+// classifier, or the tf_blob_load_shape() code of the last blob tried.
+int tf_tier_load(tf_tier_t *t, const void *pack, uint32_t bytes, int tier);
+
+// Classify window with the loaded tier and its blob's classifier. Returns
+// the label; logits: [t->model.head.n_classes]; cksum (may be null)
+// receives ENC_CKSUM of the tier's encoder output.
+int tf_tier_classify(tf_tier_t *t, const int8_t window[TINYFORMER_S][TINYFORMER_D],
+                     int32_t *logits, uint32_t *cksum);
+
+#endif // MODEL_TIERS_H
@@ -0,0 +1,89 @@
+// Run‑time power modes (power_modes.h). Empty unless TINYFORMER_POWER_MODES.
+
+#include "power_modes.h"
+
+#if TINYFORMER_POWER_MODES
+
+// Backends of mode m into the dispatch table.
+static void tf_pmode_apply(const tf_pmode_ctl_t *pm, int m)
+{
+#if TINYFORMER_AUTOTUNE
+    tinyformer_select_backends(pm->w, pm->table[m].hw, 0);
+#else
+    (void)pm;
+    (void)m;
+#endif
+}
+
+int tf_pmode_init(tf_pmode_ctl_t *pm, const tf_pmode_t *table, int n, int start,
+                  const tinyformer_weights_t *w)
+{
+    if (start < 0 || start >= n) {
+        return -1;
+    }
+    pm->table = table;
+    pm->n = n;
+    pm->cur = start;
+    pm->req = start;
+    pm->w = w;
+    pm->windows = pm->cycles = pm->switches = 0;
+    tf_pmode_apply(pm, start);
+    return 0;
+}
+
+int tf_pmode_request(tf_pmode_ctl_t *pm, int mode)
+{
+    if (mode < 0 || mode >= pm->n) {
+        return -1;
+    }
+    pm->req = mode;  // one word store; tf_pmode_poll() only reads it
+    return 0;
+}
+
+int tf_pmode_find(const tf_pmode_ctl_t *pm, const char *name, int len)
+{
+    int m, i;
+
+    for (m = 0; m < pm->n; ++m) {
+        const char *s = pm->table[m].name;
+        for (i = 0; (len < 0 || i < len) && name[i] != '\0' && s[i] == name[i]; ++i) {
+        }
+        if (s[i] == '\0' && (len >= 0 ? i == len : name[i] == '\0')) {
+            return m;
+        }
+    }
+    return -1;
+}
+
+int tf_pmode_poll(tf_pmode_ctl_t *pm, tf_pmode_switch_t *sw)
+{
+    const int to = pm->req;
+
+    if (to == pm->cur) {
+        return 0;
+    }
+    if (sw != 0) {
+        sw->from = pm->cur;
+        sw->to = to;
+        sw->windows = pm->windows;
+        sw->cycles_avg = pm->windows ? pm->cycles / pm->windows : 0;
+    }
+    tf_pmode_apply(pm, to);
+    pm->cur = to;
+    pm->windows = pm->cycles = 0;
+    pm->switches++;
+    return 1;
+}
+
+void tf_pmode_account(tf_pmode_ctl_t *pm, uint32_t cycles)
+{
+    pm->windows++;
+    pm->cycles = (pm->cycles + cycles < pm->cycles) ? UINT32_MAX : pm->cycles + cycles;
+}
+
+const tf_pmode_t *tf_pmode_current(const tf_pmode_ctl_t *pm)
+{
+    return &pm->table[pm->cur];
+}
+
+#endif // TINYFORMER_POWER_MODES
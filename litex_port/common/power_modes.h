@@ -0,0 +1,98 @@
+// Power modes: a table of operating points switched at run time, e.g. on
+// battery level or thermal state, without reflashing
+// (TINYFORMER_POWER_MODES=1, make DUTY=1 PMODES=1).
+//
+// A mode sets what one firmware can change between two windows: the matvec
+// backends of the dispatch table (tinyformer_select_backends(), with
+// TINYFORMER_AUTOTUNE), the margin of the early‑exit heads and the period
+// of the duty‑cycled loop. The numeric variants (TINYFORMER_FAST_SOFTMAX,
+// int4 weights, sparse attention, ...) are compile‑time options and are not
+// part of a mode.
+//
+// tf_pmode_request() only records the wanted mode, so it may be called from
+// an ISR or a UART command handler at any time; the latest request wins.
+// The runner calls tf_pmode_poll() between windows, which switches to it in
+// one step (the dispatch table included), so no window runs on a mix of two
+// modes. Each switch reports the windows and the average cycles per window
+// measured in the mode it leaves (tf_pmode_account()).
+//
+// Usage:
+//   static const tf_pmode_t modes[] = {{"perf", ...}, {"saver", ...}};
+//   static tf_pmode_ctl_t pm;
+//   tf_pmode_init(&pm, modes, 2, 0, 0);
+//   for (;;) {
+//       if (tf_pmode_poll(&pm, &sw)) log(sw);
+//       ... classify with tf_pmode_current(&pm)->exit_margin ...;
+//       tf_pmode_account(&pm, cycles);
+//   }
+// Off by default: the functions are then not built.
+
+#ifndef POWER_MODES_H
+#define POWER_MODES_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+#ifndef TINYFORMER_POWER_MODES
+#define TINYFORMER_POWER_MODES 0
+#endif
+
+typedef struct {
+    const char *name;         // e.g. "perf", "balanced", "saver"
+    uint32_t    hw;           // TINYFORMER_HW_* backends (0: all on the CPU)
+    int32_t     exit_margin;  // early‑exit head margin; INT32_MAX: exits off
+    uint32_t    period_us;    // duty‑cycle period
+} tf_pmode_t;
+
+// One switch, as tf_pmode_poll() reports it.
+typedef struct {
+    int      from, to;        // mode indices
+    uint32_t windows;         // windows run in mode from
+    uint32_t cycles_avg;      // their average cycles (0 without windows)
+} tf_pmode_switch_t;
+
+typedef struct {
+    const tf_pmode_t           *table;
+    int                         n;
+    int                         cur;
+    volatile int                req;      // mode asked for (cur once switched)
+    const tinyformer_weights_t *w;        // weights the backends are timed on
+    uint32_t                    windows;  // since the last switch
+    uint32_t                    cycles;   // ... their sum (saturates)
+    uint32_t                    switches;
+} tf_pmode_ctl_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set up pm with table[0 .. n) and apply mode start; w (null: the default
+// weights) is what tinyformer_select_backends() times. Returns 0, or -1 if
+// start is out of range.
+int tf_pmode_init(tf_pmode_ctl_t *pm, const tf_pmode_t *table, int n, int start,
+                  const tinyformer_weights_t *w);
+
+// Ask for mode at the next tf_pmode_poll(). Returns 0, or -1 if mode is out
+// of range (nothing changes).
+int tf_pmode_request(tf_pmode_ctl_t *pm, int mode);
+
+// Index of the mode called name (the first len characters of it; len < 0:
+// NUL‑terminated), or -1.
+int tf_pmode_find(const tf_pmode_ctl_t *pm, const char *name, int len);
+
+// Between windows: switch to a pending request. Returns 1 and fills *sw
+// (may be null) if the mode changed, 0 otherwise; requesting the current
+// mode changes nothing.
+int tf_pmode_poll(tf_pmode_ctl_t *pm, tf_pmode_switch_t *sw);
+
+// Count one window of the current mode that took cycles.
+void tf_pmode_account(tf_pmode_ctl_t *pm, uint32_t cycles);
+
+// The mode in effect.
+const tf_pmode_t *tf_pmode_current(const tf_pmode_ctl_t *pm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POWER_MODES_H
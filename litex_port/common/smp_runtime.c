@@ -0,0 +1,94 @@
+// SMP runtime: spin barrier and per‑hart job mailboxes (smp_runtime.h).
+
+#include "smp_runtime.h"
+#include <stdint.h>
+
+// Mailbox of a secondary hart: fn / arg are written by hart 0 before it
+// bumps seq; the hart answers with done = seq once the job has returned.
+typedef struct {
+    tf_smp_fn         fn;
+    void             *arg;
+    volatile uint32_t seq;
+} __attribute__((aligned(TF_SMP_LINE))) tf_smp_mbox_t;
+
+static tf_smp_word_t tf_smp_epoch[TF_SMP_HARTS];  // barriers passed, per hart
+static tf_smp_mbox_t tf_smp_mbox[TF_SMP_HARTS];  // [0] unused
+static tf_smp_word_t tf_smp_done[TF_SMP_HARTS];
+
+void tf_smp_worker(int hart)
+{
+    tf_smp_mbox_t *m = &tf_smp_mbox[hart];
+    uint32_t seen = tf_smp_done[hart].v;
+
+    for (;;) {
+        uint32_t seq;
+        tf_smp_fn fn;
+        while ((seq = m->seq) == seen) {
+            TF_SMP_RELAX();
+        }
+        TF_SMP_FENCE();
+        fn = m->fn;
+        if (fn != 0) {
+            fn(m->arg, hart);
+        }
+        TF_SMP_FENCE();
+        tf_smp_done[hart].v = seen = seq;
+        if (fn == 0) {
+            return;
+        }
+    }
+}
+
+// Post fn / arg to every secondary and wait until all have answered,
+// running fn(arg, 0) in between.
+static void tf_smp_post(tf_smp_fn fn, void *arg)
+{
+    int h;
+
+    for (h = 1; h < TF_SMP_HARTS; ++h) {
+        tf_smp_mbox[h].fn = fn;
+        tf_smp_mbox[h].arg = arg;
+    }
+    TF_SMP_FENCE();
+    for (h = 1; h < TF_SMP_HARTS; ++h) {
+        tf_smp_mbox[h].seq = tf_smp_mbox[h].seq + 1u;
+    }
+    if (fn != 0) {
+        fn(arg, 0);
+    }
+    for (h = 1; h < TF_SMP_HARTS; ++h) {
+        while (tf_smp_done[h].v != tf_smp_mbox[h].seq) {
+            TF_SMP_RELAX();
+        }
+    }
+    TF_SMP_FENCE();
+}
+
+void tf_smp_run(tf_smp_fn fn, void *arg)
+{
+    if (fn != 0) {
+        tf_smp_post(fn, arg);
+    }
+}
+
+void tf_smp_stop(void)
+{
+    tf_smp_post(0, 0);
+}
+
+void tf_smp_barrier(int hart)
+{
+    const uint32_t e = tf_smp_epoch[hart].v + 1u;
+    int h;
+
+    TF_SMP_FENCE();
+    tf_smp_epoch[hart].v = e;
+    for (h = 0; h < TF_SMP_HARTS; ++h) {
+        // Every hart passes the same barriers, so a peer is at most one
+        // epoch ahead; the difference is taken mod 2^32.
+        while ((int32_t)(tf_smp_epoch[h].v - e) < 0) {
+            TF_SMP_RELAX();
+        }
+    }
+    TF_SMP_FENCE();
+}
@@ -0,0 +1,98 @@
+// SMP runtime for multi‑hart VexRiscv SoCs (LiteX --cpu-type vexriscv_smp
+// --cpu-count N): a spin barrier and one lock‑free mailbox per secondary
+// hart, enough to split one encoder call across the harts
+// (tinyformer_encode_smp, TINYFORMER_SMP=1).
+//
+// Boot (crt0.S with TINYFORMER_SMP=1): hart 0 runs crt_init and main as
+// before. Every other hart parks in WFI on its own stack (linker.ld
+// .smp_stacks, TF_SMP_STACK_BYTES each) until hart 0 has initialized memory
+// and raised its CLINT software interrupt, then enters tf_smp_worker(hart)
+// and waits for jobs. The secondaries must start at _start, i.e. the
+// firmware is the boot image or the loader releases them there.
+//
+// Usage (hart 0):
+//   static void job(void *arg, int hart) { ... tf_smp_barrier(hart); ... }
+//   tf_smp_run(job, &args);   // job(&args, h) on harts 0 ... TF_SMP_HARTS - 1
+//
+// Only plain word loads / stores and fences are used (no A extension): the
+// barrier has one epoch word per hart and each mailbox one writer per word,
+// each on its own TF_SMP_LINE bytes so the harts' L1 lines do not
+// ping‑pong. The D‑caches must be coherent (the VexRiscv SMP cluster is).
+// Peripherals on the bus (GEMV, exp LUT, softmax, perfmon) are single
+// ported; per‑core plugins such as DOT8 are not shared.
+//
+// On the host the workers are threads that call tf_smp_worker() and return
+// after tf_smp_stop().
+
+#ifndef SMP_RUNTIME_H
+#define SMP_RUNTIME_H
+
+// Harts taking part, hart 0 included.
+#ifndef TF_SMP_HARTS
+#define TF_SMP_HARTS 2
+#endif
+
+// Stack of each secondary hart (hart 0 keeps _fstack).
+#ifndef TF_SMP_STACK_BYTES
+#define TF_SMP_STACK_BYTES 4096
+#endif
+
+// CLINT of the LiteX VexRiscv SMP cluster; msip of hart h at + 4 h.
+#ifndef TF_SMP_CLINT_BASE
+#define TF_SMP_CLINT_BASE 0xF0010000
+#endif
+
+// Padding of every shared word (at least the D‑cache line).
+#ifndef TF_SMP_LINE
+#define TF_SMP_LINE 64
+#endif
+
+#if TF_SMP_HARTS < 1 || TF_SMP_HARTS > 8
+#error "TF_SMP_HARTS must be 1 ... 8"
+#endif
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+// Full fence (RV32: fence rw,rw), also a compiler barrier.
+#define TF_SMP_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Spin‑wait body: nothing on the harts; host threads yield, so the checks
+// also run on machines with fewer cores than TF_SMP_HARTS.
+#ifndef TF_SMP_RELAX
+#if defined(__riscv)
+#define TF_SMP_RELAX() ((void)0)
+#else
+#include <sched.h>
+#define TF_SMP_RELAX() sched_yield()
+#endif
+#endif
+
+// One shared word alone on its line.
+typedef struct {
+    volatile uint32_t v;
+} __attribute__((aligned(TF_SMP_LINE))) tf_smp_word_t;
+
+// One hart's share of a job.
+typedef void (*tf_smp_fn)(void *arg, int hart);
+
+// Job loop of secondary hart hart (1 ... TF_SMP_HARTS - 1), entered from
+// crt0.S. Returns only after tf_smp_stop().
+void tf_smp_worker(int hart);
+
+// Run fn(arg, h) on every hart h, fn(arg, 0) on the caller (hart 0), and
+// return when all have. Jobs must not call tf_smp_run() themselves.
+void tf_smp_run(tf_smp_fn fn, void *arg);
+
+// Wait until every hart of the running job has reached its n‑th call;
+// passing it orders the stores before it on every hart before the loads
+// after it on every other.
+void tf_smp_barrier(int hart);
+
+// Make the workers return from tf_smp_worker() (host threads).
+void tf_smp_stop(void);
+
+#endif // __ASSEMBLER__
+
+#endif // SMP_RUNTIME_H
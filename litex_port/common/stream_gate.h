@@ -0,0 +1,84 @@
+// Delta gate of the streaming classifier (DEMO_STREAM_GATE): while the input
+// barely changes (a stationary activity), the result of the last encoded
+// window is reused instead of running the encoder again.
+//
+// stream_gate_check() sums |x - last| over the S x D features of the new
+// window against a copy of the last encoded one, and stops as soon as the
+// sum passes the threshold. At or below it the window is skipped: the caller
+// keeps the previous prediction. Above it, or after max_skip skips in a row,
+// the window becomes the new reference and the caller encodes it. The
+// distance is always taken to the last encoded window, so a slow drift adds
+// up until it is encoded.
+//
+// The gate does not touch the encoder's slide K/V cache. To keep it exact
+// the caller encodes with the rows new since the last encoded window: after
+// k skipped windows of `hop` frames, (k + 1) * hop (at most TINYFORMER_S).
+
+#ifndef STREAM_GATE_H
+#define STREAM_GATE_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+typedef struct {
+  int8_t last[TINYFORMER_S][TINYFORMER_D]; // last encoded window
+  uint32_t threshold; // skip while sum |x - last| <= threshold
+  uint32_t max_skip;  // encode after this many skips in a row; 0: no limit
+  uint32_t run;       // skips since the last encoded window
+  int valid;          // last holds a window
+  uint32_t windows;   // windows checked
+  uint32_t skipped;   // ... of them within the threshold
+} stream_gate_t;
+
+static inline void stream_gate_init(stream_gate_t *g, uint32_t threshold,
+                                    uint32_t max_skip) {
+  g->threshold = threshold;
+  g->max_skip = max_skip;
+  g->run = 0;
+  g->valid = 0;
+  g->windows = 0;
+  g->skipped = 0;
+}
+
+// L1 distance of the window v to the last encoded one, or some value above
+// limit once the sum exceeds it.
+static inline uint32_t stream_gate_distance(const stream_gate_t *g,
+                                            const tinyformer_input_t *v,
+                                            uint32_t limit) {
+  uint32_t sum = 0;
+  for (int s = 0; s < TINYFORMER_S; ++s) {
+    const int8_t *row = v->base + (int32_t)((v->first + s) % v->rows) * v->stride;
+    for (int d = 0; d < TINYFORMER_D; ++d) {
+      int32_t diff = (int32_t)row[d] - (int32_t)g->last[s][d];
+      sum += (uint32_t)(diff < 0 ? -diff : diff);
+    }
+    if (sum > limit) {
+      break;
+    }
+  }
+  return sum;
+}
+
+// 1 if the window v is to be skipped (the previous result stands), 0 if it
+// is to be encoded; it is then kept as the reference of the next checks.
+static inline int stream_gate_check(stream_gate_t *g,
+                                    const tinyformer_input_t *v) {
+  g->windows++;
+  if (g->valid && (g->max_skip == 0 || g->run < g->max_skip) &&
+      stream_gate_distance(g, v, g->threshold) <= g->threshold) {
+    g->run++;
+    g->skipped++;
+    return 1;
+  }
+  for (int s = 0; s < TINYFORMER_S; ++s) {
+    const int8_t *row = v->base + (int32_t)((v->first + s) % v->rows) * v->stride;
+    for (int d = 0; d < TINYFORMER_D; ++d) {
+      g->last[s][d] = row[d];
+    }
+  }
+  g->valid = 1;
+  g->run = 0;
+  return 0;
+}
+
+#endif // STREAM_GATE_H
@@ -0,0 +1,100 @@
+// Lock-free single-producer / single-consumer ring of TinyFormer input frames.
+//
+// One frame is one token row (TINYFORMER_D int8 features, e.g. one IMU sample
+// after quantization). The producer (UART poll loop or a sensor ISR) calls
+// stream_ring_push(); the consumer (demo_stream_run) calls stream_ring_pop(),
+// or reads the oldest frames in place through stream_ring_window() and frees
+// them with stream_ring_release().
+// head is written only by the producer and tail only by the consumer, so no
+// lock or IRQ masking is needed on a single-hart core: each side publishes its
+// index after the frame copy, behind a compiler barrier.
+//
+// Pushing into a full ring drops the new frame and counts it in `dropped`.
+
+#ifndef STREAM_RING_H
+#define STREAM_RING_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+// Capacity in frames; power of two, at least one window plus one hop.
+#ifndef STREAM_RING_FRAMES
+#define STREAM_RING_FRAMES 32
+#endif
+
+#if (STREAM_RING_FRAMES & (STREAM_RING_FRAMES - 1)) != 0
+#error "STREAM_RING_FRAMES must be a power of two"
+#endif
+
+#define STREAM_RING_BARRIER() __asm__ volatile("" ::: "memory")
+
+typedef struct {
+  int8_t frames[STREAM_RING_FRAMES][TINYFORMER_D];
+  volatile uint32_t head;    // frames pushed (free-running)
+  volatile uint32_t tail;    // frames popped (free-running)
+  volatile uint32_t dropped; // frames lost to a full ring
+} stream_ring_t;
+
+static inline void stream_ring_reset(stream_ring_t *r) {
+  r->head = 0;
+  r->tail = 0;
+  r->dropped = 0;
+}
+
+// Frames ready for the consumer.
+static inline uint32_t stream_ring_count(const stream_ring_t *r) {
+  return r->head - r->tail;
+}
+
+// Producer side. Returns 0, or -1 if the ring was full and the frame dropped.
+static inline int stream_ring_push(stream_ring_t *r,
+                                   const int8_t frame[TINYFORMER_D]) {
+  uint32_t head = r->head;
+  if (head - r->tail >= (uint32_t)STREAM_RING_FRAMES) {
+    r->dropped++;
+    return -1;
+  }
+  int8_t *dst = r->frames[head & (STREAM_RING_FRAMES - 1)];
+  for (int d = 0; d < TINYFORMER_D; ++d) {
+    dst[d] = frame[d];
+  }
+  STREAM_RING_BARRIER();
+  r->head = head + 1;
+  return 0;
+}
+
+// Consumer side. Copies the oldest frame to `frame`; returns 0, or -1 if empty.
+static inline int stream_ring_pop(stream_ring_t *r, int8_t frame[TINYFORMER_D]) {
+  uint32_t tail = r->tail;
+  if (r->head == tail) {
+    return -1;
+  }
+  STREAM_RING_BARRIER();
+  const int8_t *src = r->frames[tail & (STREAM_RING_FRAMES - 1)];
+  for (int d = 0; d < TINYFORMER_D; ++d) {
+    frame[d] = src[d];
+  }
+  STREAM_RING_BARRIER();
+  r->tail = tail + 1;
+  return 0;
+}
+
+// Consumer side. Zero-copy view of the oldest TINYFORMER_S frames for
+// tinyformer_encode_view(), wrapping at the end of the ring. Only valid once
+// stream_ring_count() >= TINYFORMER_S; the frames stay owned by the consumer
+// until stream_ring_release().
+static inline void stream_ring_window(const stream_ring_t *r, tinyformer_input_t *v) {
+  v->base = &r->frames[0][0];
+  v->stride = TINYFORMER_D;
+  v->rows = STREAM_RING_FRAMES;
+  v->first = (int32_t)(r->tail & (STREAM_RING_FRAMES - 1));
+  STREAM_RING_BARRIER();
+}
+
+// Consumer side. Frees the oldest n frames (n <= stream_ring_count()).
+static inline void stream_ring_release(stream_ring_t *r, uint32_t n) {
+  STREAM_RING_BARRIER();
+  r->tail = r->tail + n;
+}
+
+#endif /* STREAM_RING_H */
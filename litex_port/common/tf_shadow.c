@@ -0,0 +1,195 @@
+// Shadow verification of the fast paths against an exact reference encoder
+// (tf_shadow.h). Empty unless TINYFORMER_SHADOW.
+
+#include "tf_shadow.h"
+
+#if TINYFORMER_SHADOW
+#include <stdint.h>
+
+int tf_shadow_init(tf_shadow_t *sh, const tf_shadow_cfg_t *cfg, tf_shadow_ref_fn ref,
+                   const tinyformer_head_t *head)
+{
+    static const tf_shadow_cfg_t defaults = {
+        TF_SHADOW_EVERY, TF_SHADOW_MAX_LABEL_PM, TF_SHADOW_MAX_CKSUM_PM, TF_SHADOW_MIN_COMPARED};
+
+    if (cfg == 0) {
+        cfg = &defaults;
+    }
+    if (head->n_classes > TF_SHADOW_MAX_CLASSES || cfg->every == 0) {
+        return -1;
+    }
+    sh->cfg = *cfg;
+    sh->ref = ref;
+    sh->head = head;
+    sh->st.windows = sh->st.sampled = sh->st.skipped = sh->st.compared = 0;
+    sh->st.label_mismatch = sh->st.cksum_mismatch = 0;
+    sh->st.logit_max_diff = sh->st.logit_diff_sum = 0;
+    sh->st.fallback_at = -1;
+    sh->exact = 0;
+    sh->pending = 0;
+    sh->due = 1;  // the first window is sampled
+    return 0;
+}
+
+int tf_shadow_exact(const tf_shadow_t *sh)
+{
+    return sh->exact;
+}
+
+// Pool, checksum and head of an encoder output, as tinyformer_classify().
+static int tf_shadow_head(const tf_shadow_t *sh, const int8_t out[TINYFORMER_S][TINYFORMER_D],
+                          int32_t *logits, uint32_t *cksum)
+{
+    tinyformer_pool_t pool;
+    uint32_t ck = 0;
+    int s, d;
+
+    for (d = 0; d < TINYFORMER_D; ++d) {
+        pool.sum[d] = 0;
+    }
+    for (s = 0; s < TINYFORMER_S; ++s) {
+        for (d = 0; d < TINYFORMER_D; ++d) {
+            pool.sum[d] += out[s][d];
+            ck += (uint8_t)out[s][d];
+        }
+    }
+    pool.cksum = ck;
+    pool.attn_exit = 0;
+    pool.logits = 0;
+    pool.exit_label = -1;
+    if (cksum != 0) {
+        *cksum = ck;
+    }
+    return tinyformer_head_apply(sh->head, &pool, TINYFORMER_S, TINYFORMER_D, logits);
+}
+
+// Reference encoder and head on input; the output lands in sh->out.
+static int tf_shadow_ref_classify(tf_shadow_t *sh, const int8_t input[TINYFORMER_S][TINYFORMER_D],
+                                  int32_t *logits, uint32_t *cksum)
+{
+    sh->ref(input, sh->out);
+    return tf_shadow_head(sh, sh->out, logits, cksum);
+}
+
+// Count one fast window; 1 if it is to be copied for the reference.
+static int tf_shadow_take(tf_shadow_t *sh)
+{
+    sh->st.windows++;
+    if (--sh->due != 0) {
+        return 0;
+    }
+    sh->due = sh->cfg.every;
+    if (sh->pending) {
+        sh->st.skipped++;
+        return 0;
+    }
+    sh->pending = 1;
+    sh->st.sampled++;
+    return 1;
+}
+
+// Rows of a view into sh->in; 0 for an invalid view (see tinyformer_input_t).
+static int tf_shadow_copy_view(tf_shadow_t *sh, const tinyformer_input_t *in)
+{
+    int s, d;
+
+    if (in == 0 || in->base == 0 || in->stride < TINYFORMER_D || in->rows < TINYFORMER_S ||
+        in->first < 0 || in->first >= in->rows) {
+        return 0;
+    }
+    for (s = 0; s < TINYFORMER_S; ++s) {
+        const int8_t *row = in->base + (int32_t)((in->first + s) % in->rows) * in->stride;
+        for (d = 0; d < TINYFORMER_D; ++d) {
+            sh->in[s][d] = row[d];
+        }
+    }
+    return 1;
+}
+
+int tf_shadow_classify(tf_shadow_t *sh, const int8_t input[TINYFORMER_S][TINYFORMER_D],
+                       int32_t *logits, uint32_t *cksum)
+{
+    uint32_t ck;
+    int label, c, s, d;
+
+    if (sh->exact) {
+        sh->st.windows++;
+        return tf_shadow_ref_classify(sh, input, logits, cksum);
+    }
+    label = tinyformer_classify(sh->head, input, logits, &ck);
+    if (tf_shadow_take(sh)) {
+        for (s = 0; s < TINYFORMER_S; ++s) {
+            for (d = 0; d < TINYFORMER_D; ++d) {
+                sh->in[s][d] = input[s][d];
+            }
+        }
+        for (c = 0; c < sh->head->n_classes; ++c) {
+            sh->logits[c] = logits[c];
+        }
+        sh->label = label;
+        sh->cksum = ck;
+    }
+    if (cksum != 0) {
+        *cksum = ck;
+    }
+    return label;
+}
+
+int tf_shadow_encode_view(tf_shadow_t *sh, const tinyformer_input_t *in, int n_new,
+                          int8_t output[TINYFORMER_S][TINYFORMER_D])
+{
+    if (sh->exact) {
+        if (!tf_shadow_copy_view(sh, in)) {
+            return -1;
+        }
+        sh->st.windows++;
+        sh->ref((const int8_t(*)[TINYFORMER_D])sh->in, output);
+        return 0;
+    }
+    if (tinyformer_encode_view(in, n_new, output) != 0) {
+        return -1;
+    }
+    if (tf_shadow_take(sh)) {
+        (void)tf_shadow_copy_view(sh, in);
+        sh->label = tf_shadow_head(sh, (const int8_t(*)[TINYFORMER_D])output, sh->logits,
+                                   &sh->cksum);
+    }
+    return 0;
+}
+
+int tf_shadow_idle(tf_shadow_t *sh)
+{
+    tf_shadow_stats_t *st = &sh->st;
+    int32_t logits[TF_SHADOW_MAX_CLASSES];
+    uint32_t ck;
+    int label, c;
+
+    if (!sh->pending) {
+        return 0;
+    }
+    label = tf_shadow_ref_classify(sh, (const int8_t(*)[TINYFORMER_D])sh->in, logits, &ck);
+    sh->pending = 0;
+    st->compared++;
+    st->label_mismatch += (label != sh->label);
+    st->cksum_mismatch += (ck != sh->cksum);
+    for (c = 0; c < sh->head->n_classes; ++c) {
+        const uint32_t diff = (sh->logits[c] > logits[c])
+                                  ? (uint32_t)sh->logits[c] - (uint32_t)logits[c]
+                                  : (uint32_t)logits[c] - (uint32_t)sh->logits[c];
+        if (diff > st->logit_max_diff) {
+            st->logit_max_diff = diff;
+        }
+        st->logit_diff_sum = (st->logit_diff_sum + diff < st->logit_diff_sum)
+                                 ? UINT32_MAX
+                                 : st->logit_diff_sum + diff;
+    }
+    if (st->compared >= sh->cfg.min_compared &&
+        (st->label_mismatch * 1000u > sh->cfg.max_label_pm * st->compared ||
+         st->cksum_mismatch * 1000u > sh->cfg.max_cksum_pm * st->compared)) {
+        sh->exact = 1;
+        st->fallback_at = (int32_t)st->windows;
+    }
+    return 1;
+}
+
+#endif // TINYFORMER_SHADOW
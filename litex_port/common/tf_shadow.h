@@ -0,0 +1,134 @@
+// Shadow verification: one in every N windows that a bit‑inexact build
+// (TINYFORMER_FAST_SOFTMAX, _EXP_INTERP, _EXP2_SOFTMAX, _SPARSE_SOFTMAX,
+// int4 or pruned weights, ...) classifies is recomputed in idle time by an
+// exact baseline encoder, and the logits and ENC_CKSUM of both are compared
+// (TINYFORMER_SHADOW=1, make SHADOW=1 AOT_MODEL=...).
+//
+// The reference is any encoder with the tinyformer_encode() signature
+// bit‑identical to the baseline firmware, normally the scalar encoder that
+// tools/compile_model.py --backend scalar generates for the same weights
+// (it does not depend on the TINYFORMER_* options of the build). Its output
+// is pooled and put through the same head (tinyformer_head_apply()), and
+// its byte checksum is ENC_CKSUM.
+//
+// tf_shadow_classify() / tf_shadow_encode_view() run the fast path and keep
+// a copy of every cfg.every‑th window with its logits and checksum; at most
+// one window waits, later due windows are skipped while it does.
+// tf_shadow_idle() (e.g. while the stream waits for frames) runs the
+// reference on it and updates the statistics. Once cfg.min_compared
+// windows are compared and the label (or checksum) mismatches exceed
+// cfg.max_label_pm (max_cksum_pm) per mille of them, the guard falls back
+// for good: from then on both calls run the reference, so the results are
+// the baseline's, and nothing is sampled.
+//
+// Usage:
+//   static tf_shadow_t sh;
+//   tf_shadow_init(&sh, 0, tinyformer_ref_encode, &head);   // default cfg
+//   label = tf_shadow_classify(&sh, window, logits, &cksum);
+//   ...
+//   while (no window ready) tf_shadow_idle(&sh);
+// Runs on the shared scratch of the non‑ctx API (one thread). Off by
+// default: the functions are then not built.
+
+#ifndef TF_SHADOW_H
+#define TF_SHADOW_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+#ifndef TINYFORMER_SHADOW
+#define TINYFORMER_SHADOW 0
+#endif
+
+// Defaults of tf_shadow_cfg_t (tf_shadow_init() with a null cfg).
+#ifndef TF_SHADOW_EVERY
+#define TF_SHADOW_EVERY 16
+#endif
+#ifndef TF_SHADOW_MAX_LABEL_PM
+#define TF_SHADOW_MAX_LABEL_PM 20      // 2 % of the compared predictions
+#endif
+#ifndef TF_SHADOW_MAX_CKSUM_PM
+#define TF_SHADOW_MAX_CKSUM_PM 1000    // never: inexact paths move ENC_CKSUM
+#endif
+#ifndef TF_SHADOW_MIN_COMPARED
+#define TF_SHADOW_MIN_COMPARED 8
+#endif
+
+// Largest head the guard compares (tinyformer_head_t.n_classes).
+#ifndef TF_SHADOW_MAX_CLASSES
+#define TF_SHADOW_MAX_CLASSES 16
+#endif
+
+// Exact baseline encoder (the signature of tinyformer_encode()).
+typedef void (*tf_shadow_ref_fn)(const int8_t input[TINYFORMER_S][TINYFORMER_D],
+                                 int8_t       output[TINYFORMER_S][TINYFORMER_D]);
+
+typedef struct {
+    uint32_t every;          // sample 1 in every windows, >= 1
+    uint32_t max_label_pm;   // fall back above this label mismatch rate (per mille)
+    uint32_t max_cksum_pm;   // ... or ENC_CKSUM mismatch rate; 1000: never
+    uint32_t min_compared;   // windows compared before a rate counts
+} tf_shadow_cfg_t;
+
+typedef struct {
+    uint32_t windows;         // windows classified through the guard
+    uint32_t sampled;         // copied for the reference
+    uint32_t skipped;         // due while another one was still waiting
+    uint32_t compared;        // recomputed by tf_shadow_idle()
+    uint32_t label_mismatch;  // argmax differs
+    uint32_t cksum_mismatch;  // ENC_CKSUM differs
+    uint32_t logit_max_diff;  // largest |fast - ref| logit over all compared
+    uint32_t logit_diff_sum;  // sum of |fast - ref| over all logits (saturates)
+    int32_t  fallback_at;     // windows when the guard fell back, -1 if not
+} tf_shadow_stats_t;
+
+typedef struct {
+    tf_shadow_cfg_t          cfg;
+    tf_shadow_ref_fn         ref;
+    const tinyformer_head_t *head;
+    tf_shadow_stats_t        st;
+    int                      exact;     // 1 once fallen back
+    int                      pending;   // a sampled window waits for the reference
+    uint32_t                 due;       // windows until the next sample
+    int32_t                  label;     // fast results of the waiting window
+    uint32_t                 cksum;
+    int32_t                  logits[TF_SHADOW_MAX_CLASSES];
+    int8_t                   in[TINYFORMER_S][TINYFORMER_D] __attribute__((aligned(4)));
+    int8_t                   out[TINYFORMER_S][TINYFORMER_D] __attribute__((aligned(4)));
+} tf_shadow_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set up sh with cfg (null: the TF_SHADOW_* defaults), the reference
+// encoder and the head both paths are compared through. Returns 0, or -1 if
+// head has more than TF_SHADOW_MAX_CLASSES classes or cfg->every is 0.
+int tf_shadow_init(tf_shadow_t *sh, const tf_shadow_cfg_t *cfg, tf_shadow_ref_fn ref,
+                   const tinyformer_head_t *head);
+
+// tinyformer_classify(sh->head, ...) through the guard: the label, logits
+// ([head->n_classes]) and ENC_CKSUM (cksum may be null) of the fast path,
+// or of the reference once the guard has fallen back.
+int tf_shadow_classify(tf_shadow_t *sh, const int8_t input[TINYFORMER_S][TINYFORMER_D],
+                       int32_t *logits, uint32_t *cksum);
+
+// tinyformer_encode_view(in, n_new, output) through the guard; a sampled
+// window's logits and checksum come from output. After a fallback the view
+// is copied and encoded by the reference (n_new is then ignored). Returns
+// 0, or -1 (nothing written) for an invalid view.
+int tf_shadow_encode_view(tf_shadow_t *sh, const tinyformer_input_t *in, int n_new,
+                          int8_t output[TINYFORMER_S][TINYFORMER_D]);
+
+// Recompute the waiting window with the reference and compare. Returns 1 if
+// it ran, 0 if no window was waiting.
+int tf_shadow_idle(tf_shadow_t *sh);
+
+// 1 once the guard has fallen back to the reference.
+int tf_shadow_exact(const tf_shadow_t *sh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TF_SHADOW_H
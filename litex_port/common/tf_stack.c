@@ -0,0 +1,66 @@
+// Stack high‑water mark (tf_stack.h). Empty unless TINYFORMER_STACK_PAINT.
+
+#include "tf_stack.h"
+
+#if TINYFORMER_STACK_PAINT
+
+// Painted region: the one tf_stack_attach() set, else the firmware's free
+// SRAM that crt0.S painted.
+static const volatile uint32_t *tf_stack_lo;
+static const volatile uint32_t *tf_stack_hi;
+
+#if defined(__riscv)
+extern uint32_t _end[];
+extern uint32_t _fstack[];
+#endif
+
+static int tf_stack_region(const volatile uint32_t **lo, const volatile uint32_t **hi)
+{
+    if (tf_stack_hi != 0) {
+        *lo = tf_stack_lo;
+        *hi = tf_stack_hi;
+        return 1;
+    }
+#if defined(__riscv)
+    *lo = _end;
+    *hi = _fstack;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void tf_stack_attach(uint32_t *lo, uint32_t *hi)
+{
+    volatile uint32_t *p;
+
+    for (p = lo; p < hi; ++p) {
+        *p = TF_STACK_PAINT_WORD;
+    }
+    tf_stack_lo = lo;
+    tf_stack_hi = hi;
+}
+
+uint32_t tf_stack_high_water(void)
+{
+    const volatile uint32_t *lo, *hi, *p;
+
+    if (!tf_stack_region(&lo, &hi)) {
+        return 0;
+    }
+    for (p = lo; p < hi && *p == TF_STACK_PAINT_WORD; ++p) {
+    }
+    return (uint32_t)((const volatile char *)hi - (const volatile char *)p);
+}
+
+uint32_t tf_stack_size(void)
+{
+    const volatile uint32_t *lo, *hi;
+
+    if (!tf_stack_region(&lo, &hi)) {
+        return 0;
+    }
+    return (uint32_t)((const volatile char *)hi - (const volatile char *)lo);
+}
+
+#endif // TINYFORMER_STACK_PAINT
@@ -0,0 +1,56 @@
+// Stack high‑water mark by painting (TINYFORMER_STACK_PAINT=1, make
+// STACK_PAINT=1).
+//
+// crt0.S fills the free SRAM between the end of the static sections and the
+// initial stack pointer, [_end, _fstack) in linker.ld, with
+// TF_STACK_PAINT_WORD before main() runs. The stack grows down from
+// _fstack, so the lowest word that no longer holds the pattern marks the
+// deepest the stack (ISR frames included) has been since reset;
+// tf_stack_high_water() reports the bytes from there to the top. The scan
+// may undercount by the words a frame reserved but never wrote, and a
+// frame that happened to store the pattern itself; it cannot see an
+// overflow past _end into .bss.
+//
+// The demo prints "STACK high_water=N size=S" after demo_run()
+// (demo_runner.h). Host builds and threads measure their own stack:
+// tf_stack_attach() paints a region and makes it the one reported.
+// Off by default: the functions are then not built.
+
+#ifndef TF_STACK_H
+#define TF_STACK_H
+
+#ifndef TINYFORMER_STACK_PAINT
+#define TINYFORMER_STACK_PAINT 0
+#endif
+
+// Fill word of the unused stack ("STAK").
+#ifndef TF_STACK_PAINT_WORD
+#define TF_STACK_PAINT_WORD 0x5354414B
+#endif
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Paint the words [lo, hi) and measure that region from now on instead of
+// [_end, _fstack); call it before the code to measure runs on the region.
+void tf_stack_attach(uint32_t *lo, uint32_t *hi);
+
+// Bytes between the top of the stack and the lowest word written since it
+// was painted (0: an unused stack).
+uint32_t tf_stack_high_water(void);
+
+// Bytes of the measured region (the free SRAM the stack may grow into).
+uint32_t tf_stack_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ASSEMBLER__
+
+#endif // TF_STACK_H
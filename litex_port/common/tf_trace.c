@@ -0,0 +1,117 @@
+// Event trace rings (tf_trace.h).
+
+#include "tf_trace.h"
+#include "cycle_counter.h"
+
+#if TINYFORMER_TRACE
+
+// Mask machine interrupts (mstatus.MIE) / restore the saved mstatus; the
+// hart id picks the ring. Host: nothing to mask, one ring.
+#ifndef TF_TRACE_IRQ_SAVE
+#if defined(__riscv)
+#define TF_TRACE_IRQ_SAVE(s)    __asm__ volatile ("csrrci %0, mstatus, 8" : "=r"(s))
+#define TF_TRACE_IRQ_RESTORE(s) __asm__ volatile ("csrw mstatus, %0" :: "r"(s))
+#else
+#define TF_TRACE_IRQ_SAVE(s)    ((s) = 0)
+#define TF_TRACE_IRQ_RESTORE(s) ((void)(s))
+#endif
+#endif
+#if TF_TRACE_HARTS > 1 && defined(__riscv)
+static inline uint32_t tf_trace_hart(void)
+{
+    uint32_t h;
+    __asm__ volatile ("csrr %0, mhartid" : "=r"(h));
+    return h;
+}
+#else
+#define tf_trace_hart() 0u
+#endif
+
+typedef struct {
+    tf_trace_rec_t    rec[TF_TRACE_RECORDS];
+    volatile uint32_t head;     // records written (free‑running)
+} tf_trace_ring_t;
+
+static tf_trace_ring_t tf_trace_ring[TF_TRACE_HARTS];
+static volatile int tf_trace_on;
+
+void tf_trace_emit(uint32_t ev, uint32_t arg)
+{
+    uint32_t s;
+    if (!tf_trace_on) {
+        return;
+    }
+    tf_trace_ring_t *r = &tf_trace_ring[tf_trace_hart()];
+    TF_TRACE_IRQ_SAVE(s);
+    const uint32_t i = r->head;
+    tf_trace_rec_t *e = &r->rec[i & (TF_TRACE_RECORDS - 1)];
+    e->cycle = cycle_counter_read();
+    e->ev = (uint16_t)ev;
+    e->arg = (uint16_t)arg;
+    r->head = i + 1u;
+    TF_TRACE_IRQ_RESTORE(s);
+}
+
+void tf_trace_reset(void)
+{
+    tf_trace_on = 0;
+    for (int h = 0; h < TF_TRACE_HARTS; ++h) {
+        tf_trace_ring[h].head = 0;
+    }
+    tf_trace_on = 1;
+}
+
+void tf_trace_enable(int on)
+{
+    tf_trace_on = on;
+}
+
+uint32_t tf_trace_count(int hart, uint32_t *lost)
+{
+    const uint32_t head = tf_trace_ring[hart].head;
+    const uint32_t n = head < TF_TRACE_RECORDS ? head : TF_TRACE_RECORDS;
+    if (lost != 0) {
+        *lost = head - n;
+    }
+    return n;
+}
+
+const tf_trace_rec_t *tf_trace_at(int hart, uint32_t k)
+{
+    const tf_trace_ring_t *r = &tf_trace_ring[hart];
+    const uint32_t n = r->head < TF_TRACE_RECORDS ? r->head : TF_TRACE_RECORDS;
+    return &r->rec[(r->head - n + k) & (TF_TRACE_RECORDS - 1)];
+}
+
+#else
+
+void tf_trace_emit(uint32_t ev, uint32_t arg)
+{
+    (void)ev;
+    (void)arg;
+}
+
+void tf_trace_reset(void) {}
+
+void tf_trace_enable(int on)
+{
+    (void)on;
+}
+
+uint32_t tf_trace_count(int hart, uint32_t *lost)
+{
+    (void)hart;
+    if (lost != 0) {
+        *lost = 0;
+    }
+    return 0;
+}
+
+const tf_trace_rec_t *tf_trace_at(int hart, uint32_t k)
+{
+    (void)hart;
+    (void)k;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,93 @@
+// Event trace: a ring of {cycle, event, arg} records in SRAM per hart, for
+// timelines of the encoder stages against the GEMV block, the ISR and the
+// UART drain (TINYFORMER_TRACE=1, make TRACE=1).
+//
+// TF_TRACE(ev, arg) appends one record: the cycle counter (cycle_counter.h),
+// a TF_EV_* id and a 16‑bit argument. The ring keeps the newest
+// TF_TRACE_RECORDS records of each hart; older ones are overwritten and
+// counted as lost. Writers mask mstatus.MIE around the slot update, so the
+// ISR can trace too; each hart writes only its own ring (mhartid).
+// Host builds trace into hart 0's ring, from one thread only.
+//
+// The demo dumps the rings as text ("TRACE ...", demo_runner.h), and
+// scripts/trace_to_chrome.py turns a capture into Chrome / Perfetto JSON.
+// Off by default: TF_TRACE() is then empty and the functions are stubs.
+
+#ifndef TF_TRACE_H
+#define TF_TRACE_H
+
+#include <stdint.h>
+
+#ifndef TINYFORMER_TRACE
+#define TINYFORMER_TRACE 0
+#endif
+
+// Records per hart ring (8 bytes each); power of two.
+#ifndef TF_TRACE_RECORDS
+#define TF_TRACE_RECORDS 512
+#endif
+#if (TF_TRACE_RECORDS & (TF_TRACE_RECORDS - 1)) != 0
+#error "TF_TRACE_RECORDS must be a power of two"
+#endif
+
+// One ring per hart taking part in TINYFORMER_SMP.
+#if TINYFORMER_SMP
+#include "smp_runtime.h"
+#define TF_TRACE_HARTS TF_SMP_HARTS
+#else
+#define TF_TRACE_HARTS 1
+#endif
+
+// Event ids; the converter pairs the span ends with their begins.
+enum {
+    TF_EV_MARK = 1,         // encoder stage timing (re)starts
+    TF_EV_STAGE,            // stage arg (TINYFORMER_PROF_*) ends; it began
+                            // at this hart's previous MARK / STAGE
+    TF_EV_GEMV_SUBMIT,      // GEMV job started, arg = out_dim
+    TF_EV_GEMV_DONE,        // GEMV done seen, arg = 0 wait, 1 ISR, 2 poll
+    TF_EV_IRQ_ENTER,        // isr() entered, arg = active lines
+    TF_EV_IRQ_EXIT,
+    TF_EV_UART_DRAIN,       // uart_tx_isr() moved arg bytes to the TX FIFO
+    TF_EV_UART_FLUSH,       // uart_tx_flush() waits ...
+    TF_EV_UART_FLUSHED,     // ... and returns
+    TF_EV_SAMPLE,           // demo sample / window arg starts
+    TF_EV_SAMPLE_END,
+    TF_EV_COUNT
+};
+
+typedef struct {
+    uint32_t cycle;
+    uint16_t ev;
+    uint16_t arg;
+} tf_trace_rec_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if TINYFORMER_TRACE
+#define TF_TRACE(ev, arg) tf_trace_emit((uint32_t)(ev), (uint32_t)(arg))
+#else
+#define TF_TRACE(ev, arg) ((void)0)
+#endif
+
+// Append one record to the calling hart's ring (no‑op while disabled).
+void tf_trace_emit(uint32_t ev, uint32_t arg);
+
+// Empty all rings and enable tracing.
+void tf_trace_reset(void);
+
+// Stop / resume recording, e.g. while the rings are dumped over the UART.
+void tf_trace_enable(int on);
+
+// Records of hart still in its ring, oldest first; *lost = overwritten ones.
+uint32_t tf_trace_count(int hart, uint32_t *lost);
+
+// k‑th oldest record of hart, k < tf_trace_count(hart, ...).
+const tf_trace_rec_t *tf_trace_at(int hart, uint32_t k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TF_TRACE_H
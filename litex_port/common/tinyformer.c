@@ -1,17 +1,78 @@
 // TinyFormer encoder block implementation for RV32IM bare‑metal.
 //
 // Constraints:
-//  - Sequence length S = 16
-//  - Model dimension D = 32
-//  - Single attention head
+//  - Default shape S = 16, D = 32, FFN = 64; further shapes are compiled in
+//    from tinyformer_shapes.h (TINYFORMER_DEFINE)
+//  - TINYFORMER_HEADS attention heads (default 1) of D / TINYFORMER_HEADS
+//    channels each
 //  - int8 weights & activations, int32 accumulators
 //  - Streaming/tiled attention: NEVER allocate an SxS matrix
-//  - No dynamic allocation, no OS, no threads, no SIMD, no PULP intrinsics
+//  - No dynamic allocation, no OS, no threads, no PULP intrinsics (SIMD only
+//    in the optional host replay backend, TINYFORMER_HOST_SIMD)
 //
 // This file is intentionally self‑contained and uses only fixed‑size arrays.
+//
+// Backends (compile‑time, same macros as the Makefile targets):
+//  - USE_DOT8_HW    : inner int8 dot products use the DOT8 custom instruction
+//  - USE_GEMV_HW    : Q/K/V/O and FFN matvecs are offloaded to the GEMV block
+//                     (bus‑master fetch/store when the driver has GEMV_DMA=1)
+//  - USE_EXP_LUT_HW : softmax exp lookups read the exp LUT peripheral (a whole
+//                     score row per call, 8 packed indices per CSR write);
+//                     with USE_EXP_LUT_INSN the lookups are ExpLutPlugin
+//                     custom‑0 instructions instead (no bus access)
+//  - USE_SOFTMAX_HW : the two‑pass softmax (max, exp, sum, Q15 normalize) runs
+//                     in the softmax unit; takes precedence over USE_EXP_LUT_HW
+//  - USE_GEMM_HW    : the Q/K/V/O projections of all S tokens run on the GEMM
+//                     block (systolic array, W resident); takes precedence over
+//                     the GEMV block for them
+//  - USE_ATTN_HW    : the whole two‑pass attention (scores, softmax, context)
+//                     of every query and head runs in the attention engine
+//  - TINYFORMER_HOST_SIMD : host replay builds only; int8 dot products and the
+//                     attention context use AVX2 / SSE4.1 / NEON
+// Every backend produces the same int32 accumulators as the scalar loops, so
+// ENC_CKSUM is identical to the baseline build. With TINYFORMER_AUTOTUNE the
+// DOT8 / GEMV / exp LUT paths are picked at run time (tinyformer_autotune()).
 
 #include "tinyformer.h"
 
+#if defined(USE_DOT8_HW) || TINYFORMER_PACKED_WEIGHTS || TINYFORMER_BLOCK_SPARSE
+#include "dot8.h"
+#endif
+#if defined(USE_GEMV_HW)
+#include "gemv.h"
+#if TINYFORMER_GEMV_ATTN && !GEMV_ATTN
+#error "TINYFORMER_GEMV_ATTN needs the attention gateware: GEMV_ATTN=1 (GEMVPeripheral(attn=True))"
+#endif
+#endif
+#if defined(USE_EXP_LUT_HW)
+#include "exp_lut.h"
+#endif
+#if defined(USE_SOFTMAX_HW)
+#include "softmax.h"
+#endif
+#if defined(USE_GEMM_HW)
+#include "gemm.h"
+#endif
+#if defined(USE_ATTN_HW)
+#include "attn.h"
+#endif
+#if TINYFORMER_PROFILE || TINYFORMER_AUTOTUNE
+#include "cycle_counter.h"
+#endif
+#if TINYFORMER_PROFILE && defined(USE_PERFMON_HW)
+#include "perfmon.h"
+#if PERFMON_COUNT != TINYFORMER_PERF_EVENTS
+#error "perfmon.h PERFMON_COUNT must match TINYFORMER_PERF_EVENTS"
+#endif
+#endif
+#if TINYFORMER_HOST_SIMD && !defined(USE_DOT8_HW)
+#include "tinyformer_simd.h"
+#endif
+#if TINYFORMER_SMP
+#include "smp_runtime.h"
+#endif
+#include "tf_trace.h"
+
 #ifndef USE_TRAINED_WEIGHTS
 // By default, keep placeholder weights unless explicitly enabled.
 #define USE_TRAINED_WEIGHTS 0
@@ -19,62 +80,468 @@
 
 #if USE_TRAINED_WEIGHTS
 #include "trained_weights.h"
+#if defined(TRAINED_WEIGHTS_HEADS) && TRAINED_WEIGHTS_HEADS != TINYFORMER_HEADS
+#error "trained_weights.h was exported for another TINYFORMER_HEADS"
+#endif
+#if defined(TRAINED_WEIGHTS_LINEAR_ATTN) && !TINYFORMER_LINEAR_ATTN
+#error "trained_weights.h was trained with linear attention: build with TINYFORMER_LINEAR_ATTN=1"
+#endif
 #else
 
 // --- Dummy weights (placeholders) -----------------------------------------
 // Real deployments should replace these with trained parameters.
 // Using partial initializers so that the remaining elements are zero‑filled
-// by the C compiler.
+// by the C compiler. Marked unused: which layouts are read depends on the
+// TINYFORMER_* options.
+
+#define TF_PLACEHOLDER static const __attribute__((unused))
 
 // Linear projections: [D_out][D_in] with D_out = D_in = TINYFORMER_D
-static const int8_t W_q[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
-static const int8_t W_k[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
-static const int8_t W_v[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
-static const int8_t W_o[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
+TF_PLACEHOLDER int8_t W_q[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
+TF_PLACEHOLDER int8_t W_k[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
+TF_PLACEHOLDER int8_t W_v[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
+TF_PLACEHOLDER int8_t W_o[TINYFORMER_D][TINYFORMER_D] = { { 0 } };
 
 // Feed‑forward: D -> FFN -> D
-static const int8_t W_ff1[TINYFORMER_FFN][TINYFORMER_D] = { { 0 } };
-static const int8_t W_ff2[TINYFORMER_D][TINYFORMER_FFN] = { { 0 } };
+TF_PLACEHOLDER int8_t W_ff1[TINYFORMER_FFN][TINYFORMER_D] = { { 0 } };
+TF_PLACEHOLDER int8_t W_ff2[TINYFORMER_D][TINYFORMER_FFN] = { { 0 } };
 
 // Optional biases (all zeros by default).
-static const int8_t b_q[TINYFORMER_D] = { 0 };
-static const int8_t b_k[TINYFORMER_D] = { 0 };
-static const int8_t b_v[TINYFORMER_D] = { 0 };
-static const int8_t b_o[TINYFORMER_D] = { 0 };
-static const int8_t b_ff1[TINYFORMER_FFN] = { 0 };
-static const int8_t b_ff2[TINYFORMER_D] = { 0 };
+TF_PLACEHOLDER int8_t b_q[TINYFORMER_D] = { 0 };
+TF_PLACEHOLDER int8_t b_k[TINYFORMER_D] = { 0 };
+TF_PLACEHOLDER int8_t b_v[TINYFORMER_D] = { 0 };
+TF_PLACEHOLDER int8_t b_o[TINYFORMER_D] = { 0 };
+TF_PLACEHOLDER int8_t b_ff1[TINYFORMER_FFN] = { 0 };
+TF_PLACEHOLDER int8_t b_ff2[TINYFORMER_D] = { 0 };
+
+// Fused QKV block (TINYFORMER_FUSED_QKV).
+TF_PLACEHOLDER int8_t W_qkv[3 * TINYFORMER_D][TINYFORMER_D] = { { 0 } };
+TF_PLACEHOLDER int8_t b_qkv[3 * TINYFORMER_D] = { 0 };
+
+// Word‑packed copies (4 int8 lanes per word, dot8_pack lane order).
+TF_PLACEHOLDER uint32_t W_q_packed[TINYFORMER_D][TINYFORMER_D / 4] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_k_packed[TINYFORMER_D][TINYFORMER_D / 4] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_v_packed[TINYFORMER_D][TINYFORMER_D / 4] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_o_packed[TINYFORMER_D][TINYFORMER_D / 4] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_ff1_packed[TINYFORMER_FFN][TINYFORMER_D / 4] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_ff2_packed[TINYFORMER_D][TINYFORMER_FFN / 4] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_qkv_packed[3 * TINYFORMER_D][TINYFORMER_D / 4] = { { 0 } };
+
+// int4 copies (8 nibbles per word, see TINYFORMER_INT4_WEIGHTS).
+TF_PLACEHOLDER uint32_t W_q_int4[TINYFORMER_D][TINYFORMER_D / 8] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_k_int4[TINYFORMER_D][TINYFORMER_D / 8] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_v_int4[TINYFORMER_D][TINYFORMER_D / 8] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_o_int4[TINYFORMER_D][TINYFORMER_D / 8] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_ff1_int4[TINYFORMER_FFN][TINYFORMER_D / 8] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_ff2_int4[TINYFORMER_D][TINYFORMER_FFN / 8] = { { 0 } };
+TF_PLACEHOLDER uint32_t W_qkv_int4[3 * TINYFORMER_D][TINYFORMER_D / 8] = { { 0 } };
 
 #endif  // USE_TRAINED_WEIGHTS
 
+// --- Weight views ---------------------------------------------------------
+// TF_W(name) yields the flattened row‑major matrix the kernels consume:
+// int8 elements, or uint32 words of 4 int8 (8 int4) lanes when packed.
+// TF_W_BYTES(rows, cols) is the size of one such matrix.
+typedef tinyformer_wword_t tf_wword_t;
+#if TINYFORMER_INT4_WEIGHTS
+#define TF_W(name) (&name##_int4[0][0])
+#define TF_W_BYTES(rows, cols) ((uint32_t)(rows) * (uint32_t)(cols) / 2u)
+#elif TINYFORMER_PACKED_WEIGHTS
+#define TF_W(name) (&name##_packed[0][0])
+#define TF_W_BYTES(rows, cols) ((uint32_t)(rows) * (uint32_t)(cols))
+#else
+#define TF_W(name) (&name[0][0])
+#define TF_W_BYTES(rows, cols) ((uint32_t)(rows) * (uint32_t)(cols))
+#endif
+
 // --- Helper macros for saturation ---
 
-static int8_t saturate_int32_to_int8(int32_t x)
+#if defined(USE_DOT8_HW) && TINYFORMER_DOT8_SIMD
+#define TF_DOT8_SIMD 1
+#if TINYFORMER_AUTOTUNE
+#error "TINYFORMER_AUTOTUNE: the DOT8 requant instructions are not probed; drop TINYFORMER_DOT8_SIMD"
+#endif
+#endif
+
+// --- Range counters (TINYFORMER_RANGE_STATS) ------------------------------
+// TF_RNG_STAGE(stage) selects the TINYFORMER_RNG_* stage the following
+// TF_RNG_NOTE(v, clip) calls count into: v is the value before a clip, clip
+// TF_RNG_CLIP() of the clipped result (1 high, -1 low, 0 in range). Both are
+// empty in normal builds, which evaluate neither argument.
+#if TINYFORMER_RANGE_STATS
+#if defined(TF_DOT8_SIMD)
+#error "TINYFORMER_RANGE_STATS counts the CPU requant; drop TINYFORMER_DOT8_SIMD"
+#endif
+#if defined(USE_GEMV_HW) && GEMV_REQUANT
+#error "TINYFORMER_RANGE_STATS counts the CPU requant; build with GEMV_REQUANT=0"
+#endif
+#if TINYFORMER_SMP
+#error "TINYFORMER_RANGE_STATS: the counters are not per hart; drop TINYFORMER_SMP"
+#endif
+#if defined(USE_GEMM_HW) || defined(USE_ATTN_HW)
+#error "TINYFORMER_RANGE_STATS counts the CPU requant and scores; drop USE_GEMM_HW / USE_ATTN_HW"
+#endif
+#if defined(USE_GEMV_HW) && GEMV_DEVICES > 1
+#error "TINYFORMER_RANGE_STATS counts Q, K and V one after the other; build with GEMV_DEVICES=1"
+#endif
+static tinyformer_range_t tf_rng[TINYFORMER_RNG_COUNT];
+static int tf_rng_stage;
+
+static inline void tf_rng_note(int32_t v, int clip)
 {
+    tinyformer_range_t *r = &tf_rng[tf_rng_stage];
+    if (r->count == 0 || v < r->min) {
+        r->min = v;
+    }
+    if (r->count == 0 || v > r->max) {
+        r->max = v;
+    }
+    ++r->count;
+    r->clip_hi += (clip > 0);
+    r->clip_lo += (clip < 0);
+}
+
+#define TF_RNG_STAGE(stage)  (tf_rng_stage = (stage))
+#define TF_RNG_NOTE(v, clip) tf_rng_note((int32_t)(v), (clip))
+#else
+#define TF_RNG_STAGE(stage)  ((void)0)
+#define TF_RNG_NOTE(v, clip) ((void)0)
+#endif
+#define TF_RNG_CLIP(x, lo, hi) ((x) > (hi) ? 1 : (x) < (lo) ? -1 : 0)
+
+static TINYFORMER_FAST_TEXT int8_t tf_sat8(int32_t x)
+{
+#if defined(TF_DOT8_SIMD)
+    return (int8_t)dot8_sat8(x, 0u);
+#else
     if (x > 127) return 127;
     if (x < -128) return -128;
     return (int8_t)x;
+#endif
+}
+
+// Counted int8 clip (residuals, context, intermediate projections).
+static TINYFORMER_FAST_TEXT int8_t saturate_int32_to_int8(int32_t x)
+{
+    TF_RNG_NOTE(x, TF_RNG_CLIP(x, -128, 127));
+    return tf_sat8(x);
+}
+
+// --- Requantization ------------------------------------------------------
+// TF_RQ(w, layer) is the layer's per‑channel requant entry, or null for the
+// fixed >> 7. Without TINYFORMER_PER_CHANNEL_REQUANT it folds to null.
+#if TINYFORMER_PER_CHANNEL_REQUANT
+#define TF_RQ(w, layer) ((w)->rq != 0 ? &(w)->rq[layer] : 0)
+#else
+#define TF_RQ(w, layer) ((const tinyformer_requant_t *)0)
+#endif
+
+// TF_SP(w, layer) is the layer's block‑sparse table, or null for the dense
+// matrix.
+#if TINYFORMER_BLOCK_SPARSE
+#define TF_SP(w, layer) \
+    ((w)->sparse != 0 && (w)->sparse[layer].row_start != 0 ? &(w)->sparse[layer] : 0)
+#else
+#define TF_SP(w, layer) ((const tinyformer_sparse_t *)0)
+#endif
+
+// TF_LR(w, layer) is the layer's low‑rank factors, or null for the full
+// matrix.
+#if TINYFORMER_LOW_RANK
+#define TF_LR(w, layer) \
+    ((w)->lowrank != 0 && (w)->lowrank[layer].rank != 0 ? &(w)->lowrank[layer] : 0)
+#else
+#define TF_LR(w, layer) ((const tinyformer_lowrank_t *)0)
+#endif
+
+// Requantize accumulator acc of output channel c to int8.
+static inline int8_t requant(int32_t acc, const tinyformer_requant_t *rq, int32_t c)
+{
+#if TINYFORMER_PER_CHANNEL_REQUANT
+    if (rq != 0) {
+        // One fused multiply‑shift‑round‑clip; the 64‑bit product is a
+        // mul/mulh pair on RV32IM.
+        const int32_t sh = (int32_t)rq->shift[c];
+        int64_t x = (int64_t)(acc + rq->bias[c]) * (int64_t)rq->mul[c];
+        x = (x + ((int64_t)1 << (sh - 1))) >> sh;
+        TF_RNG_NOTE(acc + rq->bias[c], TF_RNG_CLIP(x, -128, 127));
+        if (x > 127) return 127;
+        if (x < -128) return -128;
+        return (int8_t)x;
+    }
+#else
+    (void)rq;
+    (void)c;
+#endif
+#if defined(TF_DOT8_SIMD)
+    return (int8_t)dot8_sat8(acc, 7u);
+#else
+    TF_RNG_NOTE(acc, TF_RNG_CLIP(acc >> 7, -128, 127));
+    return tf_sat8(acc >> 7); // crude scaling to keep in int8 range
+#endif
+}
+
+#if defined(TF_DOT8_SIMD)
+// Word view of int8 buffers for the packed stores below.
+typedef uint32_t __attribute__((may_alias)) tf_word_alias_t;
+
+// out[0 .. n) = sat(acc >> 7), ReLU'd with relu: four lanes per two PACK2.SAT
+// (and one MAX4 against 0), one word store. n % 4 == 0, out word‑aligned.
+static TINYFORMER_FAST_TEXT void tf_requant7_packed(
+    const int32_t *acc, int8_t *out, int32_t n, int relu)
+{
+    tf_word_alias_t *w = (tf_word_alias_t *)(void *)out;
+    int32_t i;
+    for (i = 0; i < n; i += 4) {
+        uint32_t v = dot8_pack2_sat(0u, acc[i] >> 7, acc[i + 1] >> 7);
+        v = dot8_pack2_sat(v, acc[i + 2] >> 7, acc[i + 3] >> 7);
+        if (relu) {
+            v = dot8_max4(v, 0u);
+        }
+        w[i / 4] = v;
+    }
+}
+
+#define TF_PACKED_OK(p, n) ((((uintptr_t)(p)) & 3u) == 0 && ((n) % 4) == 0)
+#endif
+
+#if TINYFORMER_FFN_U8_HIDDEN
+// FFN hidden of TINYFORMER_FFN_U8_HIDDEN: the uint8 ReLU output of FF1 is at
+// half the int8 step (one bit less of shift), and the FF2 accumulator against
+// it at twice the scale: its bias is doubled and it takes one bit more.
+typedef uint8_t tf_hidden_t;
+
+static inline uint8_t requant_relu_u8(int32_t acc, const tinyformer_requant_t *rq, int32_t c)
+{
+    int32_t x;
+#if TINYFORMER_PER_CHANNEL_REQUANT
+    if (rq != 0) {
+        const int32_t sh = (int32_t)rq->shift[c] - 1;
+        int64_t y = (int64_t)(acc + rq->bias[c]) * (int64_t)rq->mul[c];
+        if (sh > 0) {
+            y = (y + ((int64_t)1 << (sh - 1))) >> sh;
+        }
+        TF_RNG_NOTE(acc + rq->bias[c], TF_RNG_CLIP(y, 0, 255));
+        if (y > 255) return 255;
+        if (y < 0) return 0;
+        return (uint8_t)y;
+    }
+#else
+    (void)rq;
+    (void)c;
+#endif
+    x = acc >> 6;
+    TF_RNG_NOTE(acc, TF_RNG_CLIP(x, 0, 255));
+    if (x > 255) return 255;
+    if (x < 0) return 0;
+    return (uint8_t)x;
+}
+
+// acc already holds 2 * b[c] on the fixed path (matvec_u8_i32).
+static inline int8_t requant_ff2_u8(int32_t acc, const tinyformer_requant_t *rq, int32_t c)
+{
+#if TINYFORMER_PER_CHANNEL_REQUANT
+    if (rq != 0) {
+        const int32_t sh = (int32_t)rq->shift[c] + 1;
+        int64_t x = (int64_t)(acc + 2 * rq->bias[c]) * (int64_t)rq->mul[c];
+        x = (x + ((int64_t)1 << (sh - 1))) >> sh;
+        TF_RNG_NOTE(acc + 2 * rq->bias[c], TF_RNG_CLIP(x, -128, 127));
+        if (x > 127) return 127;
+        if (x < -128) return -128;
+        return (int8_t)x;
+    }
+#else
+    (void)rq;
+    (void)c;
+#endif
+    TF_RNG_NOTE(acc, TF_RNG_CLIP(acc >> 8, -128, 127));
+    return tf_sat8(acc >> 8);
 }
+#define requant_ff2 requant_ff2_u8
+#else
+typedef int8_t tf_hidden_t;
+#define requant_ff2 requant
+#endif
+
+// --- Kernel scratch -------------------------------------------------------
+// Only live inside one kernel call, so every encoder instance shares one
+// tf_scratch_t; sized by TINYFORMER_MAX_* (see tinyformer_shapes.h). The
+// kernels take it as ws: the global tf_scratch for the static entry points,
+// or the start of a caller's workspace (tinyformer_ctx_t).
+
+#define TF_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define TF_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Keys attended by query i: all S, or j <= i with TINYFORMER_CAUSAL.
+#if TINYFORMER_CAUSAL
+#define TF_KEYS(i, S) ((i) + 1)
+#else
+#define TF_KEYS(i, S) (S)
+#endif
+
+#if TINYFORMER_GEMV_ATTN && (TINYFORMER_MAX_S > GEMV_ATTN_MAX_KEYS || \
+                             TINYFORMER_MAX_D / TINYFORMER_HEADS > GEMV_ATTN_MAX_HD)
+#error "TINYFORMER_GEMV_ATTN: the block holds up to 32 keys of a head_dim up to 64"
+#endif
+
+// The attention engine runs the two‑pass softmax with the integer LUT
+// index, bit for bit; it takes precedence over USE_SOFTMAX_HW and
+// USE_EXP_LUT_HW for the attention.
+#if defined(USE_ATTN_HW)
+#if TINYFORMER_ONLINE_SOFTMAX || TINYFORMER_LINEAR_ATTN || TINYFORMER_EXP2_SOFTMAX || \
+    TINYFORMER_SPARSE_SOFTMAX || TINYFORMER_EXP_INTERP || TINYFORMER_GEMV_ATTN
+#error "USE_ATTN_HW runs the two‑pass LUT softmax: drop ONLINE_SOFTMAX / LINEAR_ATTN / EXP2_SOFTMAX / SPARSE_SOFTMAX / EXP_INTERP / GEMV_ATTN"
+#endif
+#if TINYFORMER_MAX_S > ATTN_MAX_S || TINYFORMER_MAX_D > ATTN_MAX_D || \
+    (TINYFORMER_MAX_D / TINYFORMER_HEADS) % 4 != 0
+#error "USE_ATTN_HW: the engine holds ATTN_MAX_S tokens of ATTN_MAX_D channels, head_dim a multiple of 4"
+#endif
+#define TF_ATTN_HW 1
+#endif
+
+// Two‑pass softmax backends: the softmax unit, the exp LUT's row mode
+// (integer indices only), or scalar shifted_to_exp() lookups. Linear
+// attention has no softmax and needs none of them, nor does the base‑2
+// softmax (tf_exp2_row()).
+#if TINYFORMER_LINEAR_ATTN
+#if TINYFORMER_ONLINE_SOFTMAX || defined(USE_SOFTMAX_HW) || defined(USE_EXP_LUT_HW)
+#error "TINYFORMER_LINEAR_ATTN has no softmax: drop TINYFORMER_ONLINE_SOFTMAX, USE_SOFTMAX_HW and USE_EXP_LUT_HW"
+#endif
+#if TINYFORMER_EXP2_SOFTMAX || TINYFORMER_SPARSE_SOFTMAX
+#error "TINYFORMER_LINEAR_ATTN has no softmax: drop TINYFORMER_EXP2_SOFTMAX and TINYFORMER_SPARSE_SOFTMAX"
+#endif
+#if TINYFORMER_FWA
+#error "TINYFORMER_LINEAR_ATTN: relu(Q) and relu(K) do not fold into W_qk; drop TINYFORMER_FWA"
+#endif
+#elif TINYFORMER_EXP2_SOFTMAX
+// No LUT (the combinations are refused in tinyformer.h).
+#elif !TINYFORMER_ONLINE_SOFTMAX && defined(USE_SOFTMAX_HW)
+#if TINYFORMER_EXP_INTERP
+#error "TINYFORMER_EXP_INTERP is not supported by the softmax unit (USE_SOFTMAX_HW)"
+#endif
+#if TINYFORMER_MAX_S > SOFTMAX_MAX_N
+#error "USE_SOFTMAX_HW: TINYFORMER_MAX_S exceeds SOFTMAX_MAX_N"
+#endif
+#elif !TINYFORMER_ONLINE_SOFTMAX && defined(USE_EXP_LUT_HW) && !TINYFORMER_EXP_INTERP
+#define TF_EXP_LUT_ROW 1
+#if TINYFORMER_AUTOTUNE
+#define TF_SCORE_TO_EXP 1  // while the LUT is off
+#endif
+#else
+#define TF_SCORE_TO_EXP 1
+#endif
+
+#if TINYFORMER_AUTOTUNE && TINYFORMER_BLOCK_SPARSE
+#error "TINYFORMER_AUTOTUNE: block‑sparse tables always run on DOT8; drop TINYFORMER_BLOCK_SPARSE"
+#endif
+
+// Raw int32 accumulators for one matvec (largest output dim: FFN, or 3D
+// for the fused QKV projection).
+#if TINYFORMER_FUSED_QKV
+#define TINYFORMER_ACC_MAX TF_MAX(3 * TINYFORMER_MAX_D, TINYFORMER_MAX_FFN)
+#else
+#define TINYFORMER_ACC_MAX TF_MAX(TINYFORMER_MAX_D, TINYFORMER_MAX_FFN)
+#endif
+
+#if TINYFORMER_PACKED_WEIGHTS || TINYFORMER_BLOCK_SPARSE || \
+    (TINYFORMER_INT4_WEIGHTS && defined(USE_DOT8_HW))
+#define TF_IN_PACKED 1
+#endif
+
+typedef struct {
+    int32_t acc_buf[TINYFORMER_ACC_MAX];
+    // FFN hidden activations of the current token. Word‑aligned (as are the
+    // arenas) so the GEMV bus master can fetch it.
+    tf_hidden_t ffn_hidden_tok[TINYFORMER_MAX_FFN] __attribute__((aligned(4)));
+#if defined(TF_IN_PACKED)
+    // Input vector of the current matvec, packed once and reused for every row.
+    uint32_t in_packed[TF_MAX(TINYFORMER_MAX_D, TINYFORMER_MAX_FFN) / 4];
+#endif
+#if TINYFORMER_LOW_RANK
+    // Bottleneck of a low‑rank layer (rank < D_in, D_out).
+    int8_t lr_mid[TINYFORMER_MAX_D] __attribute__((aligned(4)));
+#endif
+#if TINYFORMER_FFN_GATHER
+    // Indices of the non‑zero FFN hidden units of the current token.
+    uint8_t ffn_live[TINYFORMER_MAX_FFN];
+#endif
+#if TINYFORMER_LINEAR_ATTN
+    // Running sums of linear attention for all heads: lin_kv[h][a][e] =
+    // sum_j relu(K[j][h0 + a]) * V[j][h0 + e], lin_z[h0 + a] = sum_j
+    // relu(K[j][h0 + a]) over the first lin_keys keys. O(D * D / heads), no
+    // per‑query buffer over S.
+    int32_t lin_kv[TINYFORMER_MAX_D * TINYFORMER_MAX_D / TINYFORMER_HEADS];
+    int32_t lin_z[TINYFORMER_MAX_D];
+    int32_t lin_keys;
+#elif TINYFORMER_ONLINE_SOFTMAX
+    // K transposed ([D][S]) and the running context for one query.
+    int8_t kT_buf[TINYFORMER_MAX_D * TINYFORMER_MAX_S];
+    int32_t ctx_acc[TINYFORMER_MAX_D];
+#else
+    // Attention over a single query position.
+    uint16_t exp_buf[TINYFORMER_MAX_S];  // approximate exp values for softmax
+#if TINYFORMER_SPARSE_SOFTMAX
+    uint16_t sparse_idx[TINYFORMER_MAX_S];  // keys kept by tf_sparse_keys()
+#endif
+#if !defined(USE_SOFTMAX_HW)
+    int32_t scores[TINYFORMER_MAX_S];    // raw dot‑products for a given query
+#if defined(TF_EXP_LUT_ROW)
+    // LUT indices of one score row, packed 8 per word for exp_lut_hw_row().
+    uint32_t exp_idx[EXP_LUT_ROW_WORDS(TINYFORMER_MAX_S)];
+#endif
+#endif
+#endif
+    // Classifier heads: mean‑pooled tokens and per‑channel sums.
+    int8_t pooled[TINYFORMER_MAX_D] __attribute__((aligned(4)));
+    int32_t exit_sum[TINYFORMER_MAX_D];
+#if TINYFORMER_PREFETCH
+    // Weight lines still to warm: warm_left bytes from warm_p, warm_step
+    // per tf_warm_step() call.
+    const uint8_t *warm_p;
+    uint32_t warm_left;
+    uint32_t warm_step;
+#endif
+} tf_scratch_t;
 
-// --- Internal working buffers (global, not on stack) ----------------------
-// Layout: [S][D] or [S][FFN] as specified.
+#if TINYFORMER_NOINIT_SCRATCH
+#define TF_SCRATCH_DATA TINYFORMER_NOINIT
+#else
+#define TF_SCRATCH_DATA TINYFORMER_FAST_DATA
+#endif
 
-static int8_t q_buf[TINYFORMER_S][TINYFORMER_D];
-static int8_t k_buf[TINYFORMER_S][TINYFORMER_D];
-static int8_t v_buf[TINYFORMER_S][TINYFORMER_D];
+static tf_scratch_t tf_scratch TF_SCRATCH_DATA;
 
-static int8_t attn_out[TINYFORMER_S][TINYFORMER_D];     // after attention + output proj
-static int8_t ffn_hidden[TINYFORMER_S][TINYFORMER_FFN]; // after first FFN layer (ReLU)
-static int8_t ffn_out[TINYFORMER_S][TINYFORMER_D];      // after second FFN + residual
+#if TINYFORMER_AUTOTUNE
+// Set by tinyformer_autotune(): TINYFORMER_HW_* found by the probes, and
+// whether the softmax exps read the LUT. Zero (all CPU) until it runs.
+static uint32_t tf_hw;
+static uint8_t tf_exp_on_lut;
+#define TF_HW_ON(bit) ((tf_hw & (bit)) != 0u)
+#else
+#define TF_HW_ON(bit) 1
+#endif
 
-// Temporary buffers for attention over a single query position.
-static int32_t scores[TINYFORMER_S];    // raw dot‑products for a given query
-static uint16_t exp_buf[TINYFORMER_S];  // approximate exp values for softmax
+#if TINYFORMER_PER_CHANNEL_REQUANT || TINYFORMER_FWA || TINYFORMER_LOW_RANK
+// Passed as the int8 bias of layers whose bias lives in their requant entry
+// (and of W_qk, whose int32 b_qk is added after the matvec, and of the V
+// pass of a low‑rank layer).
+static const int8_t tf_zero_bias[TF_MAX(3 * TINYFORMER_MAX_D, TINYFORMER_MAX_FFN)]
+    TINYFORMER_WEIGHTS(VEC, shared);
+#endif
+#if TINYFORMER_PER_CHANNEL_REQUANT
+#define TF_BIAS(rq, b) ((rq) != 0 ? tf_zero_bias : (b))
+#else
+#define TF_BIAS(rq, b) (b)
+#endif
 
 // --- Approximate exponential LUT for softmax ------------------------------
 // We use a simple integer LUT for exp(x) over x in [-15, 0], scaled by 2^10.
 // Index = -clamped_x where clamped_x is in [-15, 0].
+// With USE_EXP_LUT_HW the same table is read from the exp_lut peripheral.
+// shifted_to_exp() serves the online softmax and the scalar two‑pass softmax.
 
-static const uint16_t exp_lut[16] = {
+#if defined(TF_SCORE_TO_EXP) && (!defined(USE_EXP_LUT_HW) || TINYFORMER_AUTOTUNE)
+static const uint16_t exp_lut[16] TINYFORMER_WEIGHTS(VEC, attn) = {
     1024, // e^0   ~ 1.0  * 2^10
      754, // e^-1  ~ 0.74
      556, // e^-2  ~ 0.55
@@ -92,227 +559,4087 @@ static const uint16_t exp_lut[16] = {
       16, // e^-14
       12  // e^-15
 };
+#endif
 
+#if defined(TF_SCORE_TO_EXP)
+#if !TINYFORMER_EXP_INTERP
 // Convert a scaled score to an index into exp_lut.
 // Input: int16_t x, we clamp x to [-15, 0] and return -x as index.
-static uint16_t score_to_exp(int16_t x)
+static TINYFORMER_FAST_TEXT uint16_t score_to_exp(int16_t x)
 {
     if (x > 0) {
         x = 0;
     } else if (x < -15) {
         x = -15;
     }
+#if defined(USE_EXP_LUT_HW) && TINYFORMER_AUTOTUNE
+    if (tf_exp_on_lut) {
+        return exp_lut_hw((unsigned)(-x));
+    }
     return exp_lut[(uint16_t)(-x)];
+#elif defined(USE_EXP_LUT_HW)
+    return exp_lut_hw((unsigned)(-x));
+#else
+    return exp_lut[(uint16_t)(-x)];
+#endif
 }
+#endif
 
-// --- Small helpers --------------------------------------------------------
-
-// Matrix‑vector product for one token:
-//   out[d_out] = sum_i W[d_out][i] * in[i] + b[d_out]
-// Shapes:
-//   in:  [D]
-//   out: [D_out]
-//   W:   [D_out][D]
-static void matvec_i8_i32_acc(
-    const int8_t *in,
-    int8_t       *out,
-    const int8_t *W,   // flattened [D_out][D_in]
-    const int8_t *b,
-    int32_t       d_in,
-    int32_t       d_out)
-{
-    int32_t od, id;
-    for (od = 0; od < d_out; ++od) {
-        const int8_t *w_row = &W[od * d_in];
-        int32_t acc = (int32_t)b[od];
-        for (id = 0; id < d_in; ++id) {
-            acc += (int32_t)w_row[id] * (int32_t)in[id];
+// exp of a max‑subtracted score (shifted <= 0) through the >> 3 compress.
+// TINYFORMER_EXP_INTERP reads -shifted as Q3: the integer part indexes
+// exp_lut, the 3 fraction bits interpolate towards the next entry.
+static TINYFORMER_FAST_TEXT uint16_t shifted_to_exp(int32_t shifted)
+{
+#if TINYFORMER_EXP_INTERP
+    uint32_t neg = (uint32_t)(-shifted);
+    if (neg > 15u * 8u) {
+        neg = 15u * 8u;
+    }
+#if defined(USE_EXP_LUT_HW) && TINYFORMER_AUTOTUNE
+    if (tf_exp_on_lut) {
+        return exp_lut_hw_interp(neg);
+    }
+#elif defined(USE_EXP_LUT_HW)
+    return exp_lut_hw_interp(neg);
+#endif
+#if !defined(USE_EXP_LUT_HW) || TINYFORMER_AUTOTUNE
+    {
+        uint32_t i = neg >> 3;
+        uint32_t f = neg & 7u;
+        if (i == 15u) {
+            return exp_lut[15];
         }
-        out[od] = saturate_int32_to_int8(acc >> 7); // crude scaling to keep in int8 range
+        return (uint16_t)(exp_lut[i] - (((uint32_t)(exp_lut[i] - exp_lut[i + 1]) * f) >> 3));
     }
+#endif
+#else
+    return score_to_exp((int16_t)(shifted >> 3));
+#endif
 }
+#endif
 
-// Linear projection for all tokens:
-//   dst[s][D_out] = W[D_out][D_in] * src[s][D_in] + b[D_out]
-static void linear_projection_all(
-    const int8_t src[TINYFORMER_S][TINYFORMER_D],
-    int8_t       dst[TINYFORMER_S][TINYFORMER_D],
-    const int8_t W[TINYFORMER_D][TINYFORMER_D],
-    const int8_t b[TINYFORMER_D])
+// --- Small helpers --------------------------------------------------------
+//
+// Kernels take flattened row‑major tensors and their dimensions. Every call
+// site passes compile‑time shape constants (via TINYFORMER_DEFINE), so GCC
+// specializes the loops per shape.
+
+// Dot product of two int8 vectors of length n, on the CPU.
+static TINYFORMER_FAST_TEXT __attribute__((unused))
+int32_t dot_i8_cpu(const int8_t *a, const int8_t *b, int32_t n)
 {
-    int32_t s;
-    for (s = 0; s < TINYFORMER_S; ++s) {
-        matvec_i8_i32_acc(
-            &src[s][0],
-            &dst[s][0],
-            &W[0][0],
-            b,
-            TINYFORMER_D,
-            TINYFORMER_D);
+    int32_t acc = 0;
+    int32_t i;
+#if TINYFORMER_HOST_SIMD && !defined(USE_DOT8_HW)
+    (void)i;
+    acc = tf_simd_dot_i8(a, b, n);
+#else
+    for (i = 0; i < n; ++i) {
+        acc += (int32_t)a[i] * (int32_t)b[i];
     }
+#endif
+    return acc;
 }
 
-// --- Scaled dot‑product attention (streaming) -----------------------------
-//
-// For each query position i:
-//   1. Compute scores[i][j] = dot(Q[i], K[j]) for all j
-//   2. Subtract max over j for numerical stability
-//   3. Approximate softmax with integer LUT (no floats)
-//   4. Compute context[i] = sum_j softmax_ij * V[j]
-//
-// We never allocate an SxS matrix; we reuse the 1D scores/exp_buf arrays.
-
-static void attention_single_head(
-    const int8_t q[TINYFORMER_S][TINYFORMER_D],
-    const int8_t k[TINYFORMER_S][TINYFORMER_D],
-    const int8_t v[TINYFORMER_S][TINYFORMER_D],
-    int8_t       context[TINYFORMER_S][TINYFORMER_D])
+#if defined(USE_DOT8_HW)
+// Same with DOT8; n must be a multiple of 4 (true for D, FFN and head_dim).
+static TINYFORMER_FAST_TEXT __attribute__((unused))
+int32_t dot_i8_dot8(const int8_t *a, const int8_t *b, int32_t n)
 {
-    int32_t i, j, d;
+    int32_t acc = 0;
+    int32_t i;
+    for (i = 0; i < n; i += 4) {
+        acc = dot8_mac(acc, dot8_pack(&a[i]), dot8_pack(&b[i]));
+    }
+    return acc;
+}
+#endif
 
-    // For each sequence position i (query index)
-    for (i = 0; i < TINYFORMER_S; ++i) {
-        // 1. Compute raw dot‑product scores with all keys.
-        int32_t max_score = -2147483647;
-        for (j = 0; j < TINYFORMER_S; ++j) {
-            int32_t acc = 0;
-            for (d = 0; d < TINYFORMER_D; ++d) {
-                acc += (int32_t)q[i][d] * (int32_t)k[j][d];
-            }
+// Dot product of two int8 vectors of length n: DOT8 when built with
+// USE_DOT8_HW (and found, with TINYFORMER_AUTOTUNE), else dot_i8_cpu().
+// Unused when both the matvecs and attention take other paths.
+static TINYFORMER_FAST_TEXT __attribute__((unused))
+int32_t dot_i8(const int8_t *a, const int8_t *b, int32_t n)
+{
+#if defined(USE_DOT8_HW)
+    if (TF_HW_ON(TINYFORMER_HW_DOT8)) {
+        return dot_i8_dot8(a, b, n);
+    }
+#endif
+    return dot_i8_cpu(a, b, n);
+}
 
-            // Approximate scaling by 1/sqrt(D) ≈ 1/6 using a shift.
-            // With D=32, scores can be large; we right‑shift by 5 bits
-            // to reduce magnitude before softmax (empirical choice).
-            acc >>= 5;
+#if defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS
+#if TINYFORMER_SHARED_LAYERS
+// Bias loaded with the resident W: layers of a shared stack run one W under
+// different biases.
+static const int8_t *tf_gemv_b;
+#endif
 
-            scores[j] = acc;
-            if (acc > max_score) {
-                max_score = acc;
-            }
-        }
+#if TINYFORMER_GEMV_NATIVE && !GEMV_PACKED_WRITES
+#error "TINYFORMER_GEMV_NATIVE loads W_IN4 words; build with GEMV_PACKED_WRITES=1"
+#endif
+#if TINYFORMER_GEMV_NATIVE && defined(TRAINED_WEIGHTS_GEMV_NATIVE)
+#define TF_GEMV_LAYOUTS 1
+// Block layouts of the compiled‑in matrices (--gemv-native): a matrix, the
+// int8 bias it is passed with, that bias as int32 and, for shapes the block
+// does not take (Q/K/V narrowed to TRAINED_WEIGHTS_D_IN), its pre‑tiled
+// words. Layers whose bias lives in their requant entry pass tf_zero_bias.
+typedef struct {
+    const tf_wword_t *W;
+    const int8_t     *b;
+    const int32_t    *b32;
+    const uint32_t   *tiles;  // null: W is in run order already
+} tf_gemv_layout_t;
 
-        // 2. Subtract max for numerical stability, convert to small range
-        //    and look up approximate exp values.
-        uint32_t sum_exp = 0;
-        for (j = 0; j < TINYFORMER_S; ++j) {
-            int32_t shifted = scores[j] - max_score; // <= 0
+#if defined(TRAINED_WEIGHTS_D_IN)
+#define TF_GEMV_TILES(l) gemv_w_##l
+#else
+#define TF_GEMV_TILES(l) 0
+#endif
+#if TINYFORMER_PER_CHANNEL_REQUANT || TINYFORMER_FWA || TINYFORMER_LOW_RANK
+static const int32_t tf_zero_bias32[TF_MAX(3 * TINYFORMER_MAX_D, TINYFORMER_MAX_FFN)];
+#endif
 
-            // Further compress dynamic range to int16 by shifting.
-            // This keeps values in a rough [-32, 0] range typically.
-            int16_t scaled = (int16_t)(shifted >> 3);
+static const tf_gemv_layout_t tf_gemv_layouts[] = {
+    { TF_W(W_q), b_q, gemv_b_q, TF_GEMV_TILES(q) },
+    { TF_W(W_k), b_k, gemv_b_k, TF_GEMV_TILES(k) },
+    { TF_W(W_v), b_v, gemv_b_v, TF_GEMV_TILES(v) },
+    { TF_W(W_o), b_o, gemv_b_o, 0 },
+    { TF_W(W_ff1), b_ff1, gemv_b_ff1, 0 },
+    { TF_W(W_ff2), b_ff2, gemv_b_ff2, 0 },
+#if TINYFORMER_FUSED_QKV
+    { TF_W(W_qkv), b_qkv, gemv_b_qkv, TF_GEMV_TILES(qkv) },
+#endif
+#if TINYFORMER_FWA && defined(TRAINED_WEIGHTS_FWA)
+    { TF_W(W_qk), tf_zero_bias, tf_zero_bias32, TF_GEMV_TILES(qk) },
+#endif
+};
 
-            uint16_t e = score_to_exp(scaled);
-            exp_buf[j] = e;
-            sum_exp += (uint32_t)e;
+// Layout of W run under bias b, or null (weights from elsewhere, or a bias
+// other than the exported one); *b32 receives the int32 bias.
+static TINYFORMER_FAST_TEXT const tf_gemv_layout_t *tf_gemv_layout(
+    const tf_wword_t *W, const int8_t *b, const int32_t **b32)
+{
+    uint32_t k;
+    for (k = 0; k < sizeof(tf_gemv_layouts) / sizeof(tf_gemv_layouts[0]); ++k) {
+        const tf_gemv_layout_t *e = &tf_gemv_layouts[k];
+        if (e->W != W) {
+            continue;
         }
-
-        // Guard against division by zero (degenerate case).
-        if (sum_exp == 0u) {
-            sum_exp = 1u;
+        if (b == e->b) {
+            *b32 = e->b32;
+            return e;
+        }
+#if TINYFORMER_PER_CHANNEL_REQUANT || TINYFORMER_FWA || TINYFORMER_LOW_RANK
+        if (b == tf_zero_bias) {
+            *b32 = tf_zero_bias32;
+            return e;
         }
+#endif
+        return 0;
+    }
+    return 0;
+}
+#endif
 
-        // 3. Compute context[i][d] = sum_j softmax_ij * V[j][d]
-        //    We represent softmax_ij as Q15 fixed‑point:
-        //      w_ij_q15 = (exp_buf[j] << 15) / sum_exp
-        //    and then:
-        //      context[i][d] = sum_j (w_ij_q15 * V[j][d]) >> 15
+// Load the biases of rows [r0, r0 + rows): the exported int32 copy when W
+// has a block layout, else sign‑extended from b.
+static TINYFORMER_FAST_TEXT void tf_gemv_load_b(
+    const tf_wword_t *W,
+    const int8_t     *b,
+    int32_t           r0,
+    int32_t           rows)
+{
+#if defined(TF_GEMV_LAYOUTS)
+    const int32_t *b32;
+    if (tf_gemv_layout(W, b, &b32) != 0) {
+        gemv_load_b(&b32[r0], (int)rows);
+        return;
+    }
+#else
+    (void)W;
+#endif
+    gemv_load_b_i8(&b[r0], (int)rows);
+}
 
-        for (d = 0; d < TINYFORMER_D; ++d) {
-            int32_t acc = 0;
-            for (j = 0; j < TINYFORMER_S; ++j) {
-                uint16_t w_q15 = (uint16_t)(((uint32_t)exp_buf[j] << 15) / sum_exp);
-                acc += ((int32_t)w_q15 * (int32_t)v[j][d]) >> 15;
-            }
-            context[i][d] = saturate_int32_to_int8(acc);
+// Rewind the GEMV block for a new X against rows [r0, r0 + rows) of W,
+// loading those rows and their biases unless they are still resident
+// (weights are const and, without TINYFORMER_SHARED_LAYERS, each W always
+// comes with the same b). Packed words hold the same bytes as the int8 rows
+// (RV32 is little‑endian).
+static TINYFORMER_FAST_TEXT void tf_gemv_select_w(
+    const tf_wword_t *W,
+    const int8_t     *b,
+    int32_t           r0,
+    int32_t           rows,
+    int32_t           d_in)
+{
+    const int8_t *w_run = &((const int8_t *)W)[r0 * d_in];
+    if (gemv_w_resident(w_run, (int)rows, (int)d_in)) {
+#if TINYFORMER_SHARED_LAYERS
+        if (b != tf_gemv_b) {
+            // Rewinding keeps the W memory: reload the biases only.
+            gemv_clear_done();
+            tf_gemv_load_b(W, b, r0, rows);
+            tf_gemv_b = b;
+            return;
         }
+#endif
+        gemv_clear_x();
+        return;
     }
+#if TINYFORMER_SHARED_LAYERS
+    tf_gemv_b = b;
+#endif
+    gemv_clear_done();
+    tf_gemv_load_b(W, b, r0, rows);
+#if TINYFORMER_PACKED_WEIGHTS && GEMV_PACKED_WRITES
+    // Already in W_IN4 lane order: one CSR write per word, no repacking.
+    gemv_load_w_packed(&W[r0 * d_in / 4], (int)rows, (int)d_in);
+#else
+    gemv_load_w(w_run, (int)rows, (int)d_in);
+#endif
 }
+#endif
 
-// --- Feed‑forward network (FFN) -------------------------------------------
-//
-// For each token x (dimension D):
-//   h = ReLU(W_ff1 * x + b_ff1)   // h in R^FFN
-//   y = W_ff2 * h + b_ff2        // y in R^D
-
-static void ffn_apply(
-    const int8_t in[TINYFORMER_S][TINYFORMER_D],
-    int8_t       hidden[TINYFORMER_S][TINYFORMER_FFN],
-    int8_t       out[TINYFORMER_S][TINYFORMER_D])
+#if TINYFORMER_BLOCK_SPARSE
+// matvec_i8_i32 over the stored blocks of a block‑sparse table only: the
+// input is packed once, then each row sums DOT8 of its surviving weight words
+// against the input words they index. d_in must be a multiple of 4.
+static TINYFORMER_FAST_TEXT void matvec_sparse_i32(
+    tf_scratch_t              *ws,
+    const int8_t              *in,
+    int32_t                   *acc,
+    const tinyformer_sparse_t *sp,
+    const int8_t              *b,
+    int32_t                    d_in,
+    int32_t                    d_out)
 {
-    int32_t s, d;
+    const uint16_t *row_start = sp->row_start;
+    const uint8_t *block = sp->block;
+    const uint32_t *w = sp->w;
+    int32_t i, od;
+    for (i = 0; i < d_in / 4; ++i) {
+        ws->in_packed[i] = dot8_pack(&in[4 * i]);
+    }
+    for (od = 0; od < d_out; ++od) {
+        int32_t sum = (int32_t)b[od];
+        int32_t e = row_start[od];
+        const int32_t end = row_start[od + 1];
+        for (; e + 2 <= end; e += 2) {
+            sum = dot8_mac8(sum, w[e], w[e + 1],
+                            ws->in_packed[block[e]], ws->in_packed[block[e + 1]]);
+        }
+        if (e < end) {
+            sum = dot8_mac(sum, w[e], ws->in_packed[block[e]]);
+        }
+        acc[od] = sum;
+    }
+}
+#endif
 
-    // First layer + ReLU
-    for (s = 0; s < TINYFORMER_S; ++s) {
-        // h = W_ff1 * in[s] + b_ff1
-        // W_ff1: [FFN][D]
-        for (d = 0; d < TINYFORMER_FFN; ++d) {
-            const int8_t *w_row = &W_ff1[d][0];
-            int32_t acc = (int32_t)b_ff1[d];
-            int32_t k;
-            for (k = 0; k < TINYFORMER_D; ++k) {
-                acc += (int32_t)w_row[k] * (int32_t)in[s][k];
-            }
-            // Simple scaling then ReLU in int8 space.
-            acc >>= 7;
-            if (acc < 0) {
-                hidden[s][d] = 0;
-            } else {
-                hidden[s][d] = saturate_int32_to_int8(acc);
+#if defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS
+// acc[d_out] = W * in + b on the GEMV block: shapes the block supports
+// (d_in 32 or 64, d_out a multiple of 32) in runs of 64 (or 32) rows, other
+// d_in that are multiples of 4 through the driver's tiled gemv_matvec().
+// Returns 0, doing nothing, for any other d_in.
+static TINYFORMER_FAST_TEXT int tf_gemv_matvec_i32(
+    const int8_t     *in,
+    int32_t          *acc,
+    const tf_wword_t *W,
+    const int8_t     *b,
+    int32_t           d_in,
+    int32_t           d_out)
+{
+#if GEMV_DMA
+    int32_t od;
+#endif
+    if ((d_in == 32 || d_in == 64) && (d_out % 32) == 0) {
+        // The bias is loaded with W and added by the block (on the CPU for
+        // bus‑master runs, which fetch no bias).
+        int32_t r0;
+        for (r0 = 0; r0 < d_out; ) {
+            int32_t rows = ((d_out - r0) >= 64) ? 64 : 32;
+#if GEMV_DMA
+            const int8_t *w_run = &((const int8_t *)W)[r0 * d_in];
+            // The block fetches W/X and stores Y itself; unaligned operands
+            // (e.g. a caller's input tokens) take the CSR path below.
+            if ((((uintptr_t)in | (uintptr_t)w_run) & 3u) == 0) {
+                gemv_submit(w_run, in, &acc[r0], (int)d_in, (int)rows);
+                while (!gemv_poll()) {
+                }
+                for (od = r0; od < r0 + rows; ++od) {
+                    acc[od] += (int32_t)b[od];
+                }
+                r0 += rows;
+                continue;
             }
+#endif
+            // Each projection runs all S tokens against one resident W.
+            tf_gemv_select_w(W, b, r0, rows, d_in);
+            gemv_load_x(in, (int)d_in);
+            gemv_start((int)d_in, (int)rows, 1);
+            gemv_wait_done();
+            gemv_read_y(&acc[r0], (int)rows);
+            r0 += rows;
         }
+        return 1;
     }
-
-    // Second layer
-    for (s = 0; s < TINYFORMER_S; ++s) {
-        for (d = 0; d < TINYFORMER_D; ++d) {
-            const int8_t *w_row = &W_ff2[d][0];
-            int32_t acc = (int32_t)b_ff2[d];
-            int32_t k;
-            for (k = 0; k < TINYFORMER_FFN; ++k) {
-                acc += (int32_t)w_row[k] * (int32_t)hidden[s][k];
+    if ((d_in % 4) == 0) {
+#if TINYFORMER_SHARED_LAYERS
+        // The driver keeps a single‑tile W resident with the bias it came with.
+        if (b != tf_gemv_b) {
+            gemv_invalidate_w();
+            tf_gemv_b = b;
+        }
+#endif
+#if defined(TF_GEMV_LAYOUTS)
+        {
+            // Pre‑tiled: the tiles stream as they are, no padding or packing.
+            const int32_t *b32;
+            const tf_gemv_layout_t *e = tf_gemv_layout(W, b, &b32);
+            if (e != 0 && e->tiles != 0) {
+                gemv_matvec_tiles(e->tiles, in, b32, acc, (int)d_out, (int)d_in);
+                return 1;
             }
-            acc >>= 7;
-            out[s][d] = saturate_int32_to_int8(acc);
         }
+#endif
+        gemv_matvec((const int8_t *)W, in, b, acc, (int)d_out, (int)d_in);
+        return 1;
     }
+    return 0;
 }
+#endif
 
-// --- Public entry point ---------------------------------------------------
+#if TINYFORMER_AUTOTUNE
+// Candidate kernels of the dispatch table: acc[d_out] = W * in + b, the
+// same int32 sums as matvec_i8_i32().
+typedef void (*tf_matvec_fn)(const int8_t *in, int32_t *acc, const int8_t *W,
+                             const int8_t *b, int32_t d_in, int32_t d_out);
 
-void tinyformer_encode(
-    const int8_t input[TINYFORMER_S][TINYFORMER_D],
-    int8_t       output[TINYFORMER_S][TINYFORMER_D])
+static TINYFORMER_FAST_TEXT void tf_mv_cpu(
+    const int8_t *in, int32_t *acc, const int8_t *W, const int8_t *b,
+    int32_t d_in, int32_t d_out)
 {
-    int32_t s, d;
-
-    // 1. Linear projections: Q = X * W_q, K = X * W_k, V = X * W_v
-    linear_projection_all(input, q_buf, W_q, b_q);
-    linear_projection_all(input, k_buf, W_k, b_k);
-    linear_projection_all(input, v_buf, W_v, b_v);
-
-    // 2. Scaled dot‑product attention (streaming) to compute context.
-    attention_single_head(q_buf, k_buf, v_buf, attn_out);
+    int32_t od;
+    for (od = 0; od < d_out; ++od) {
+        acc[od] = (int32_t)b[od] + dot_i8_cpu(&W[od * d_in], in, d_in);
+    }
+}
 
-    // 3. Output projection + residual:
+#if defined(USE_DOT8_HW)
+static TINYFORMER_FAST_TEXT void tf_mv_dot8(
+    const int8_t *in, int32_t *acc, const int8_t *W, const int8_t *b,
+    int32_t d_in, int32_t d_out)
+{
+    int32_t od;
+    for (od = 0; od < d_out; ++od) {
+        acc[od] = (int32_t)b[od] + dot_i8_dot8(&W[od * d_in], in, d_in);
+    }
+}
+#endif
+
+#if defined(USE_GEMV_HW)
+static TINYFORMER_FAST_TEXT void tf_mv_gemv(
+    const int8_t *in, int32_t *acc, const int8_t *W, const int8_t *b,
+    int32_t d_in, int32_t d_out)
+{
+    if (!tf_gemv_matvec_i32(in, acc, W, b, d_in, d_out)) {
+        tf_mv_cpu(in, acc, W, b, d_in, d_out);
+    }
+}
+#endif
+
+// Dispatch table, one entry per distinct layer shape of the tuned weight set.
+typedef struct {
+    int32_t      d_in;
+    int32_t      d_out;
+    tf_matvec_fn fn;
+} tf_tune_entry_t;
+
+static tf_tune_entry_t tf_tune[TINYFORMER_RQ_COUNT];
+static int32_t tf_tune_n;
+
+// Kernel for a d_out x d_in matvec: the tuned one, else DOT8 if present.
+static TINYFORMER_FAST_TEXT tf_matvec_fn tf_kernel_for(int32_t d_in, int32_t d_out)
+{
+    int32_t k;
+    for (k = 0; k < tf_tune_n; ++k) {
+        if (tf_tune[k].d_in == d_in && tf_tune[k].d_out == d_out) {
+            return tf_tune[k].fn;
+        }
+    }
+#if defined(USE_DOT8_HW)
+    if (TF_HW_ON(TINYFORMER_HW_DOT8) && (d_in % 4) == 0) {
+        return tf_mv_dot8;
+    }
+#endif
+    return tf_mv_cpu;
+}
+#endif
+
+// The GEMV fast paths below (requant on the block, pipelined and overlapped
+// projections) are taken for a shape only where the table picked GEMV.
+#if TINYFORMER_AUTOTUNE && defined(USE_GEMV_HW)
+#define TF_ON_GEMV(d_in, d_out) (tf_kernel_for((d_in), (d_out)) == tf_mv_gemv)
+#else
+#define TF_ON_GEMV(d_in, d_out) 1
+#endif
+
+// Raw matrix‑vector product for one token (no requantization):
+//   acc[d_out] = sum_i W[d_out][i] * in[i] + b[d_out]
+// sp, if not null, replaces W by its block‑sparse table, and lr by its
+// low‑rank factors (two dense passes of this function). With USE_GEMV_HW
+// the GEMV block takes it (tf_gemv_matvec_i32()) if d_in is a multiple of 4;
+// int4 weights fall back to the CPU path. With packed weights, d_in must be
+// a multiple of 4 (8 for int4). TINYFORMER_AUTOTUNE: the tf_kernel_for()
+// kernel.
+static TINYFORMER_FAST_TEXT void matvec_i8_i32(
+    tf_scratch_t     *ws,
+    const int8_t     *in,
+    int32_t          *acc,
+    const tf_wword_t *W,   // flattened [D_out][D_in] (see TF_W)
+    const int8_t     *b,
+    const tinyformer_sparse_t  *sp,  // null: dense W
+    const tinyformer_lowrank_t *lr,  // null: full‑rank W
+    int32_t           d_in,
+    int32_t           d_out)
+{
+    int32_t od;
+#if TINYFORMER_BLOCK_SPARSE
+    if (sp != 0) {
+        matvec_sparse_i32(ws, in, acc, sp, b, d_in, d_out);
+        return;
+    }
+#else
+    (void)sp;
+#endif
+#if TINYFORMER_LOW_RANK
+    if (lr != 0) {
+        // t = sat8((V in) >> shift) into the bottleneck, then acc = U t + b.
+        const int32_t r = lr->rank;
+        matvec_i8_i32(ws, in, acc, lr->V, tf_zero_bias, 0, 0, d_in, r);
+        for (od = 0; od < r; ++od) {
+            ws->lr_mid[od] = saturate_int32_to_int8(acc[od] >> lr->shift);
+        }
+        matvec_i8_i32(ws, ws->lr_mid, acc, lr->U, b, 0, 0, r, d_out);
+        return;
+    }
+#else
+    (void)lr;
+#endif
+#if TINYFORMER_AUTOTUNE
+    (void)ws;
+    (void)od;
+    tf_kernel_for(d_in, d_out)(in, acc, W, b, d_in, d_out);
+#else
+#if defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS
+    if (tf_gemv_matvec_i32(in, acc, W, b, d_in, d_out)) {
+        return;
+    }
+#endif
+#if TINYFORMER_INT4_WEIGHTS
+    int32_t j;
+    const int32_t n_words = d_in / 8;
+#if defined(USE_DOT8_HW)
+    for (j = 0; j < d_in / 4; ++j) {
+        ws->in_packed[j] = dot8_pack(&in[4 * j]);
+    }
+    for (od = 0; od < d_out; ++od) {
+        const uint32_t *w_row = &W[od * n_words];
+        int32_t sum = 0;
+        for (j = 0; j < n_words; ++j) {
+            const uint32_t w = w_row[j];
+            // Low nibbles -> lanes 8j..8j+3, high nibbles -> 8j+4..8j+7, each
+            // as a signed byte of 16*W.
+            sum = dot8_mac(sum, (w << 4) & 0xF0F0F0F0u, ws->in_packed[2 * j]);
+            sum = dot8_mac(sum, w & 0xF0F0F0F0u, ws->in_packed[2 * j + 1]);
+        }
+        acc[od] = (int32_t)b[od] + (sum >> 4);  // exact: every product is 16*W*x
+    }
+#else
+    for (od = 0; od < d_out; ++od) {
+        const uint32_t *w_row = &W[od * n_words];
+        const int8_t *x = in;
+        int32_t sum = (int32_t)b[od];
+        for (j = 0; j < n_words; ++j, x += 8) {
+            const uint32_t w = w_row[j];
+            int32_t k;
+            for (k = 0; k < 4; ++k) {
+                const int8_t byte = (int8_t)(w >> (8 * k));
+                sum += (int32_t)((int8_t)(byte << 4) >> 4) * (int32_t)x[k];
+                sum += (int32_t)(byte >> 4) * (int32_t)x[k + 4];
+            }
+        }
+        acc[od] = sum;
+    }
+#endif
+#elif TINYFORMER_PACKED_WEIGHTS
+    int32_t i;
+    const int32_t n_words = d_in / 4;
+    for (i = 0; i < n_words; ++i) {
+        ws->in_packed[i] = dot8_pack(&in[4 * i]);
+    }
+#if TINYFORMER_DOT8_BLOCKED
+    for (od = 0; od < d_out; ++od) {
+        acc[od] = (int32_t)b[od];
+    }
+    dot8_matvec_4x1(W, ws->in_packed, acc, (int)d_out, (int)n_words);
+#else
+    for (od = 0; od < d_out; ++od) {
+        const uint32_t *w_row = &W[od * n_words];
+        int32_t sum = (int32_t)b[od];
+        for (i = 0; i + 2 <= n_words; i += 2) {
+            sum = dot8_mac8(sum, w_row[i], w_row[i + 1], ws->in_packed[i], ws->in_packed[i + 1]);
+        }
+        if (i < n_words) {
+            sum = dot8_mac(sum, w_row[i], ws->in_packed[i]);
+        }
+        acc[od] = sum;
+    }
+#endif
+#else
+    for (od = 0; od < d_out; ++od) {
+        acc[od] = (int32_t)b[od] + dot_i8(&W[od * d_in], in, d_in);
+    }
+#endif
+#endif  // TINYFORMER_AUTOTUNE
+}
+
+#if TINYFORMER_FFN_U8_HIDDEN
+// dot_i8 with an unsigned first operand (DOT8U on the DOT8 path).
+static TINYFORMER_FAST_TEXT __attribute__((unused))
+int32_t dot_u8_i8(const uint8_t *a, const int8_t *b, int32_t n)
+{
+    int32_t acc = 0;
+    int32_t i;
+#if defined(USE_DOT8_HW)
+    if (TF_HW_ON(TINYFORMER_HW_DOT8)) {
+        for (i = 0; i < n; i += 4) {
+            acc = dot8u_mac(acc, dot8_pack((const int8_t *)&a[i]), dot8_pack(&b[i]));
+        }
+        return acc;
+    }
+#endif
+    for (i = 0; i < n; ++i) {
+        acc += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return acc;
+}
+
+// matvec_i8_i32 against the uint8 FFN hidden, on the CPU:
+//   acc[d_out] = sum_i W[d_out][i] * in[i] + 2 * b[d_out]
+// (the bias at the doubled scale of in, see requant_ff2_u8).
+static TINYFORMER_FAST_TEXT void matvec_u8_i32(
+    tf_scratch_t     *ws,
+    const uint8_t    *in,
+    int32_t          *acc,
+    const tf_wword_t *W,   // flattened [D_out][D_in] (see TF_W)
+    const int8_t     *b,
+    int32_t           d_in,
+    int32_t           d_out)
+{
+    int32_t od;
+#if TINYFORMER_INT4_WEIGHTS
+    int32_t j;
+    const int32_t n_words = d_in / 8;
+#if defined(USE_DOT8_HW)
+    for (j = 0; j < d_in / 4; ++j) {
+        ws->in_packed[j] = dot8_pack((const int8_t *)&in[4 * j]);
+    }
+    for (od = 0; od < d_out; ++od) {
+        const uint32_t *w_row = &W[od * n_words];
+        int32_t sum = 0;
+        for (j = 0; j < n_words; ++j) {
+            const uint32_t w = w_row[j];
+            sum = dot8u_mac(sum, ws->in_packed[2 * j], (w << 4) & 0xF0F0F0F0u);
+            sum = dot8u_mac(sum, ws->in_packed[2 * j + 1], w & 0xF0F0F0F0u);
+        }
+        acc[od] = 2 * (int32_t)b[od] + (sum >> 4);
+    }
+#else
+    (void)ws;
+    for (od = 0; od < d_out; ++od) {
+        const uint32_t *w_row = &W[od * n_words];
+        const uint8_t *x = in;
+        int32_t sum = 2 * (int32_t)b[od];
+        for (j = 0; j < n_words; ++j, x += 8) {
+            const uint32_t w = w_row[j];
+            int32_t k;
+            for (k = 0; k < 4; ++k) {
+                const int8_t byte = (int8_t)(w >> (8 * k));
+                sum += (int32_t)((int8_t)(byte << 4) >> 4) * (int32_t)x[k];
+                sum += (int32_t)(byte >> 4) * (int32_t)x[k + 4];
+            }
+        }
+        acc[od] = sum;
+    }
+#endif
+#elif TINYFORMER_PACKED_WEIGHTS
+    int32_t i;
+    const int32_t n_words = d_in / 4;
+    for (i = 0; i < n_words; ++i) {
+        ws->in_packed[i] = dot8_pack((const int8_t *)&in[4 * i]);
+    }
+    for (od = 0; od < d_out; ++od) {
+        const uint32_t *w_row = &W[od * n_words];
+        int32_t sum = 2 * (int32_t)b[od];
+        for (i = 0; i + 2 <= n_words; i += 2) {
+            sum = dot8u_mac8(sum, ws->in_packed[i], ws->in_packed[i + 1], w_row[i], w_row[i + 1]);
+        }
+        if (i < n_words) {
+            sum = dot8u_mac(sum, ws->in_packed[i], w_row[i]);
+        }
+        acc[od] = sum;
+    }
+#else
+    (void)ws;
+    for (od = 0; od < d_out; ++od) {
+        acc[od] = 2 * (int32_t)b[od] + dot_u8_i8(in, &W[od * d_in], d_in);
+    }
+#endif
+}
+#endif
+
+#if defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS && GEMV_REQUANT && !GEMV_DMA
+#define TF_GEMV_REQUANT 1
+// Matvec requantized on the GEMV block, for layers without per‑channel
+// parameters: out[d_out] = sat((W * in + b) >> 7), ReLU'd first with relu
+// (same as ReLU after the int8 requant), read back four outputs per word.
+// Shapes other than d_in 32/64 with d_out a multiple of 32 are tiled by
+// gemv_matvec8(). Returns 0, doing nothing, if d_in is not a multiple of 4.
+static TINYFORMER_FAST_TEXT int tf_gemv_matvec_i8(
+    const int8_t     *in,
+    int8_t           *out,
+    const tf_wword_t *W,
+    const int8_t     *b,
+    int32_t           d_in,
+    int32_t           d_out,
+    int               relu)
+{
+    int32_t r0;
+    if ((d_in % 4) != 0) {
+        return 0;
+    }
+    gemv_set_requant(GEMV_RQ_SHIFT(7) | (relu ? GEMV_RQ_RELU : 0u));
+    if (!((d_in == 32 || d_in == 64) && (d_out % 32) == 0)) {
+        gemv_matvec8((const int8_t *)W, in, b, out, (int)d_out, (int)d_in);
+        return 1;
+    }
+    for (r0 = 0; r0 < d_out; ) {
+        int32_t rows = ((d_out - r0) >= 64) ? 64 : 32;
+        tf_gemv_select_w(W, b, r0, rows, d_in);
+        gemv_load_x(in, (int)d_in);
+        gemv_start((int)d_in, (int)rows, 1);
+        gemv_wait_done();
+        gemv_read_y8(&out[r0], (int)rows);
+        r0 += rows;
+    }
+    return 1;
+}
+#endif
+
+// Matrix‑vector product for one token:
+//   out[d_out] = requant(sum_i W[d_out][i] * in[i] + b[d_out])
+// Shapes:
+//   in:  [D]
+//   out: [D_out]
+//   W:   [D_out][D]
+static TINYFORMER_FAST_TEXT void matvec_i8_i32_acc(
+    tf_scratch_t     *ws,
+    const int8_t     *in,
+    int8_t           *out,
+    const tf_wword_t *W,   // flattened [D_out][D_in] (see TF_W)
+    const int8_t     *b,
+    const tinyformer_requant_t *rq,  // null: >> 7
+    const tinyformer_sparse_t  *sp,  // null: dense W
+    const tinyformer_lowrank_t *lr,  // null: full‑rank W
+    int32_t           d_in,
+    int32_t           d_out)
+{
+    int32_t od;
+#if defined(TF_GEMV_REQUANT)
+    if (rq == 0 && sp == 0 && lr == 0 && TF_ON_GEMV(d_in, d_out) &&
+        tf_gemv_matvec_i8(in, out, W, b, d_in, d_out, 0)) {
+        return;
+    }
+#endif
+    matvec_i8_i32(ws, in, ws->acc_buf, W, TF_BIAS(rq, b), sp, lr, d_in, d_out);
+#if defined(TF_DOT8_SIMD)
+    if (rq == 0 && TF_PACKED_OK(out, d_out)) {
+        tf_requant7_packed(ws->acc_buf, out, d_out, 0);
+        return;
+    }
+#endif
+    for (od = 0; od < d_out; ++od) {
+        out[od] = requant(ws->acc_buf[od], rq, od);
+    }
+}
+
+#if defined(USE_GEMM_HW) && !TINYFORMER_INT4_WEIGHTS
+#define TF_GEMM 1
+// Whole projection on the GEMM block: src[S][0 .. d_in) against W, kept
+// resident by gemm_bind(), GEMM_M_MAX tokens per run. Without per‑channel
+// requant the block also adds b and applies the >> 7 (Y8); with it, Y is
+// read back as int32 one token at a time for requant(). Returns 0, doing
+// nothing, for a shape the block does not take.
+static TINYFORMER_FAST_TEXT int tf_gemm_projection(
+    tf_scratch_t     *ws,
+    const int8_t     *src,
+    int32_t           src_stride,
+    int8_t           *dst,
+    const tf_wword_t *W,
+    const int8_t     *b,
+    const tinyformer_requant_t *rq,
+    int32_t           S,
+    int32_t           D,
+    int32_t           d_in)
+{
+    const int8_t *w8 = (const int8_t *)W;
+    int32_t s0, s, od;
+    int row;
+
+    if (!gemm_fits((int)D, (int)d_in)) {
+        return 0;
+    }
+    if (rq == 0) {
+        gemm_set_requant(GEMM_RQ_SHIFT(7));
+        return gemm_project8(w8, b, src, (int)src_stride, dst, (int)D, (int)S, (int)D,
+                             (int)d_in);
+    }
+    row = gemm_bind(w8, TF_BIAS(rq, b), (int)D, (int)d_in);
+    for (s0 = 0; s0 < S; s0 += GEMM_M_MAX) {
+        const int32_t m = (S - s0 < GEMM_M_MAX) ? S - s0 : GEMM_M_MAX;
+        gemm_run(row, &src[s0 * src_stride], (int)src_stride, (int)m, (int)D, (int)d_in, 1);
+        for (s = s0; s < s0 + m; ++s) {
+            gemm_read_y(ws->acc_buf, (int)D);
+            for (od = 0; od < D; ++od) {
+                dst[s * D + od] = requant(ws->acc_buf[od], rq, od);
+            }
+        }
+    }
+    return 1;
+}
+#endif
+
+#if defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS && GEMV_W_BANKS == 2 && \
+    !TINYFORMER_SHARED_LAYERS
+#define TF_GEMV_W_BANKS 1
+// Layer l (TINYFORMER_RQ_Q .. TINYFORMER_RQ_FF2) as the GEMV path loads it
+// for a single run or tile: the key the driver tracks it by (W, or its
+// pre‑tiled words with tiles != 0) and the bias that comes with it. Returns
+// 0 for a layer that does not run on the block as one resident matrix.
+typedef struct {
+    const tf_wword_t *W;
+    const uint32_t   *tiles;
+    const int8_t     *b;
+    const int32_t    *b32;
+    int32_t           rows;
+    int32_t           cols;
+} tf_gemv_bank_t;
+
+static TINYFORMER_FAST_TEXT int tf_gemv_bank_layer(
+    tf_gemv_bank_t             *e,
+    const tinyformer_weights_t *w,
+    int                         l,
+    int32_t                     D,
+    int32_t                     FFN,
+    int32_t                     d_in)
+{
+    const tinyformer_requant_t *rq = TF_RQ(w, l);
+    const int8_t *b;
+    (void)rq;
+    switch (l) {
+    case TINYFORMER_RQ_Q: e->W = w->W_q; b = w->b_q; e->rows = D; e->cols = d_in; break;
+    case TINYFORMER_RQ_K: e->W = w->W_k; b = w->b_k; e->rows = D; e->cols = d_in; break;
+    case TINYFORMER_RQ_V: e->W = w->W_v; b = w->b_v; e->rows = D; e->cols = d_in; break;
+    case TINYFORMER_RQ_O: e->W = w->W_o; b = w->b_o; e->rows = D; e->cols = D; break;
+    case TINYFORMER_RQ_FF1: e->W = w->W_ff1; b = w->b_ff1; e->rows = FFN; e->cols = D; break;
+    default: e->W = w->W_ff2; b = w->b_ff2; e->rows = D; e->cols = FFN; break;
+    }
+#if defined(USE_GEMM_HW)
+    if (l <= TINYFORMER_RQ_O) {
+        return 0;  // tf_gemm_projection()
+    }
+#endif
+#if TINYFORMER_FFN_U8_HIDDEN
+    if (l == TINYFORMER_RQ_FF2) {
+        return 0;  // matvec_u8_i32()
+    }
+#endif
+    if (e->W == 0 || TF_SP(w, l) != 0 || TF_LR(w, l) != 0 || e->rows > 64 || e->cols > 64 ||
+        (e->cols % 4) != 0 || !TF_ON_GEMV(e->cols, e->rows)) {
+        return 0;
+    }
+    e->b = TF_BIAS(rq, b);
+    e->tiles = 0;
+    e->b32 = 0;
+#if defined(TF_GEMV_LAYOUTS)
+    // Tiled shapes outside gemv_matvec8() run from their pre‑tiled words.
+    if (!((e->cols == 32 || e->cols == 64) && (e->rows % 32) == 0)
+#if defined(TF_GEMV_REQUANT)
+        && !(rq == 0 && l != TINYFORMER_RQ_FF2)
+#endif
+    ) {
+        const tf_gemv_layout_t *g = tf_gemv_layout(e->W, e->b, &e->b32);
+        if (g != 0 && g->tiles != 0) {
+            e->tiles = g->tiles;
+        }
+    }
+#endif
+    return 1;
+}
+
+// Layer transition on the block's two W banks: layer cur becomes the
+// resident matrix if it was prefetched, and layer next streams into the
+// other bank while cur's runs compute.
+static TINYFORMER_FAST_TEXT void tf_gemv_next_w(
+    const tinyformer_weights_t *w,
+    int                         cur,
+    int                         next,
+    int32_t                     D,
+    int32_t                     FFN,
+    int32_t                     d_in)
+{
+    tf_gemv_bank_t e;
+    if (tf_gemv_bank_layer(&e, w, cur, D, FFN, d_in)) {
+        (void)gemv_w_resident(e.tiles != 0 ? (const int8_t *)e.tiles : (const int8_t *)e.W,
+                              (int)e.rows, (int)e.cols);
+    }
+    if (!tf_gemv_bank_layer(&e, w, next, D, FFN, d_in)) {
+        return;
+    }
+    if (e.tiles != 0) {
+        gemv_prefetch_tiles(e.tiles, e.b32, (int)e.rows, (int)e.cols);
+    } else {
+        gemv_prefetch_w((const int8_t *)e.W, e.b, (int)e.rows, (int)e.cols);
+    }
+}
+#endif
+
+#if defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS && GEMV_DOUBLE_BUFFER && !GEMV_DMA
+#define TF_GEMV_PIPELINED 1
+// gemv_run_tokens() callback: requant of one token's Y (bias already added
+// by the block) into dst, overlapped with the next token's GEMV run.
+typedef struct {
+    int8_t                     *dst;  // [S][D]
+    const tinyformer_requant_t *rq;
+    int32_t                     D;
+} tf_gemv_rows_t;
+
+static TINYFORMER_FAST_TEXT void tf_gemv_requant_row(
+    void *ctx, int token, const int32_t *y)
+{
+    const tf_gemv_rows_t *c = (const tf_gemv_rows_t *)ctx;
+    int8_t *out = &c->dst[token * c->D];
+    int32_t od;
+    for (od = 0; od < c->D; ++od) {
+        out[od] = requant(y[od], c->rq, od);
+    }
+}
+#endif
+
+// Input rows of one sample of an encoder tile: row s at p0 + s * stride below
+// split, at p1 + (s - split) * stride from split on. Contiguous [S][D] input
+// is p0 with split S and stride D; a wrapped tinyformer_input_t view has its
+// second run at the start of the buffer.
+typedef struct {
+    const int8_t *p0;
+    const int8_t *p1;
+    int32_t       split;
+    int32_t       stride;
+} tf_rows_t;
+
+static inline const int8_t *tf_row(const tf_rows_t *x, int32_t s)
+{
+    return (s < x->split) ? &x->p0[s * x->stride] : &x->p1[(s - x->split) * x->stride];
+}
+
+// Rows from r on that are contiguous in x, at most n.
+static inline int32_t tf_rows_run(const tf_rows_t *x, int32_t r, int32_t n)
+{
+    return (r < x->split && n > x->split - r) ? x->split - r : n;
+}
+
+// Linear projection for all tokens:
+//   dst[s][D] = W[D][d_in] * src[s][0 .. d_in) + b[D]
+// (src rows src_stride bytes apart).
+// With the GEMM block, all S tokens run as one matrix product per
+// GEMM_M_MAX tokens (tf_gemm_projection()). With the double‑buffered GEMV
+// block, all S tokens are pipelined through one resident W (d_in = D of 32
+// or 64); the >> 7 requant also runs on the block. Layers with a
+// block‑sparse table sp stay on the CPU; low‑rank ones (lr) run their two
+// passes token by token.
+static TINYFORMER_FAST_TEXT void linear_projection_all(
+    tf_scratch_t     *ws,
+    const int8_t     *src,  // [S][src_stride]
+    int32_t           src_stride,
+    int8_t           *dst,  // [S][D]
+    const tf_wword_t *W,    // [D][d_in] (see TF_W)
+    const int8_t     *b,    // [D]
+    const tinyformer_requant_t *rq,
+    const tinyformer_sparse_t  *sp,
+    const tinyformer_lowrank_t *lr,
+    int32_t           S,
+    int32_t           D,
+    int32_t           d_in)  // input channels read, <= D
+{
+    int32_t s;
+#if defined(TF_GEMM)
+    if (sp == 0 && lr == 0 &&
+        tf_gemm_projection(ws, src, src_stride, dst, W, b, rq, S, D, d_in)) {
+        return;
+    }
+#endif
+#if defined(TF_GEMV_PIPELINED)
+    if (sp == 0 && lr == 0 && d_in == D && (D == 32 || D == 64) && TF_ON_GEMV(D, D)) {
+        tf_gemv_rows_t ctx;
+        tf_gemv_select_w(W, TF_BIAS(rq, b), 0, D, D);
+#if defined(TF_GEMV_REQUANT)
+        if (rq == 0) {
+            gemv_set_requant(GEMV_RQ_SHIFT(7));
+            gemv_run_tokens8(src, (int)src_stride, (int)S, (int)D, (int)D, 1, dst, (int)D);
+            return;
+        }
+#endif
+        ctx.dst = dst;
+        ctx.rq  = rq;
+        ctx.D   = D;
+        gemv_run_tokens(src, (int)src_stride, (int)S, (int)D, (int)D, 1, tf_gemv_requant_row,
+                        &ctx);
+        return;
+    }
+#endif
+    for (s = 0; s < S; ++s) {
+        matvec_i8_i32_acc(ws, &src[s * src_stride], &dst[s * D], W, b, rq, sp, lr, d_in, D);
+    }
+}
+
+// linear_projection_all() of rows [r0, r0 + n) of x into dst[0 .. n).
+static TINYFORMER_FAST_TEXT void linear_projection_rows(
+    tf_scratch_t     *ws,
+    const tf_rows_t  *x,
+    int32_t           r0,
+    int32_t           n,
+    int8_t           *dst,
+    const tf_wword_t *W,
+    const int8_t     *b,
+    const tinyformer_requant_t *rq,
+    const tinyformer_sparse_t  *sp,
+    const tinyformer_lowrank_t *lr,
+    int32_t           D,
+    int32_t           d_in)
+{
+    while (n > 0) {
+        const int32_t m = tf_rows_run(x, r0, n);
+        linear_projection_all(ws, tf_row(x, r0), x->stride, dst, W, b, rq, sp, lr, m, D, d_in);
+        dst += m * D;
+        r0 += m;
+        n -= m;
+    }
+}
+
+#if defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS && GEMV_DEVICES > 1 && !GEMV_DMA
+#define TF_GEMV_DEVICES 1
+// Q, K and V of one sample on up to GEMV_DEVICES instances at once:
+// projection p (Q, K, V) runs on instance p % n of the n found, so two
+// instances take Q and K together and then V, three or more all three. Each
+// instance keeps its W resident; per token the same X goes to every instance
+// of the pass, all start, and then each Y is read back (>> 7 on the block,
+// or int32 for requant()). All instances go through gemv_dev_t handles. The
+// other paths drive instance 0 with the gemv_* calls, so its handle forgets
+// its W at each call and the gemv_* tracking forgets it afterwards. The
+// per‑token work is that of matvec_i8_i32_acc(), so the output is
+// bit‑identical.
+static gemv_dev_t tf_gemv_dev[GEMV_DEVICES];
+static const int8_t *tf_gemv_dev_b[GEMV_DEVICES];  // bias loaded with the resident W
+static int tf_gemv_devs;  // instances in use, 0 until opened
+
+// Instances found in the SoC (1 if only the first one is).
+static int tf_gemv_dev_count(void)
+{
+    if (tf_gemv_devs == 0) {
+        int k;
+        gemv_dev_open(&tf_gemv_dev[0], 0);
+        tf_gemv_devs = 1;
+        for (k = 1; k < GEMV_DEVICES && gemv_dev_open(&tf_gemv_dev[k], k); ++k) {
+            tf_gemv_devs = k + 1;
+        }
+    }
+    return tf_gemv_devs;
+}
+
+// Rewind instance k for a new X against W[D][d_in] under bias b, loading
+// both unless they are still resident.
+static TINYFORMER_FAST_TEXT void tf_gemv_dev_select_w(
+    int k, const tf_wword_t *W, const int8_t *b, int32_t D, int32_t d_in)
+{
+    gemv_dev_t *dev = &tf_gemv_dev[k];
+#if defined(TF_GEMV_LAYOUTS)
+    const int32_t *b32;
+#endif
+    if (gemv_dev_w_resident(dev, W, (int)D, (int)d_in) && b == tf_gemv_dev_b[k]) {
+        gemv_dev_clear_x(dev);
+        return;
+    }
+    tf_gemv_dev_b[k] = b;
+    gemv_dev_clear_done(dev);
+#if defined(TF_GEMV_LAYOUTS)
+    if (tf_gemv_layout(W, b, &b32) != 0) {
+        gemv_dev_load_b(dev, b32, (int)D);
+    } else
+#endif
+    gemv_dev_load_b_i8(dev, b, (int)D);
+#if TINYFORMER_PACKED_WEIGHTS
+    gemv_dev_load_w_packed(dev, W, (int)D, (int)d_in);
+#else
+    gemv_dev_load_w(dev, W, (int)D, (int)d_in);
+#endif
+}
+
+// The three projections dst[p][S][D] = W[p][D][d_in] * x + b[p]. Returns 0,
+// doing nothing, unless they all fit the block (dense and full‑rank, D 32 or
+// 64, d_in a multiple of 4 up to 64, tuned to GEMV) and a second instance is
+// there.
+static TINYFORMER_FAST_TEXT int tf_gemv_qkv(
+    tf_scratch_t               *ws,
+    const tf_rows_t            *x,
+    int8_t *const               dst[3],
+    const tf_wword_t *const     W[3],
+    const int8_t *const         b[3],
+    const tinyformer_requant_t *const rq[3],
+    int                         dense,  // no sparse / low‑rank layer
+    int32_t                     S,
+    int32_t                     D,
+    int32_t                     d_in)
+{
+    int n_dev, p0, k, m;
+    int32_t s, od;
+
+    if (!dense || (D != 32 && D != 64) || (d_in % 4) != 0 || d_in > 64 ||
+        !TF_ON_GEMV(d_in, D) || tf_gemv_dev_count() < 2) {
+        return 0;
+    }
+    n_dev = tf_gemv_devs;
+    gemv_dev_invalidate_w(&tf_gemv_dev[0]);
+    for (p0 = 0; p0 < 3; p0 += n_dev) {
+        m = (3 - p0 < n_dev) ? 3 - p0 : n_dev;
+        for (k = 0; k < m; ++k) {
+            tf_gemv_dev_select_w(k, W[p0 + k], TF_BIAS(rq[p0 + k], b[p0 + k]), D, d_in);
+#if defined(TF_GEMV_REQUANT)
+            if (rq[p0 + k] == 0) {
+                gemv_dev_set_requant(&tf_gemv_dev[k], GEMV_RQ_SHIFT(7));
+            }
+#endif
+        }
+        for (s = 0; s < S; ++s) {
+            const int8_t *in = tf_row(x, s);
+            for (k = 0; k < m; ++k) {
+                if (s > 0) {
+                    gemv_dev_clear_x(&tf_gemv_dev[k]);
+                }
+                gemv_dev_load_x(&tf_gemv_dev[k], in, (int)d_in);
+                gemv_dev_start(&tf_gemv_dev[k], (int)d_in, (int)D, 1);
+            }
+            for (k = 0; k < m; ++k) {
+                const tinyformer_requant_t *r = rq[p0 + k];
+                int8_t *out = &dst[p0 + k][s * D];
+                gemv_dev_wait_done(&tf_gemv_dev[k]);
+#if defined(TF_GEMV_REQUANT)
+                if (r == 0) {
+                    gemv_dev_read_y8(&tf_gemv_dev[k], out, (int)D);
+                    continue;
+                }
+#endif
+                gemv_dev_read_y(&tf_gemv_dev[k], ws->acc_buf, (int)D);
+                for (od = 0; od < D; ++od) {
+                    out[od] = requant(ws->acc_buf[od], r, od);
+                }
+            }
+        }
+    }
+    // Instance 0 now holds the last W loaded through its handle.
+    gemv_invalidate_w();
+#if TINYFORMER_SHARED_LAYERS
+    tf_gemv_b = 0;
+#endif
+    return 1;
+}
+#endif
+
+#if TINYFORMER_OVERLAP && defined(USE_GEMV_HW) && !TINYFORMER_INT4_WEIGHTS && !GEMV_DMA
+#define TF_OVERLAP 1
+// Cooperative schedule of stages 2 and 3 on two lanes (TINYFORMER_OVERLAP):
+// the CPU runs the attention of query row i while the GEMV block projects
+// context row i - 1 through the resident W_o. Two row counters carry the
+// dependencies: a row is issued to the block only once its context is
+// complete (tf_overlap_step(ready)), and with one X/Y bank its Y is
+// collected (requant, then the residual Y = X + O on the CPU) before the
+// next row is loaded. The per‑row work is that of linear_projection_all()
+// and stage 3, so the output is bit‑identical.
+typedef struct {
+    const int8_t               *ctx;       // [S][D] context rows
+    const tf_rows_t            *x;         // block input rows
+    int8_t                     *attn_out;  // [S][D] X + O(ctx)
+    const tinyformer_requant_t *rq;
+    int32_t                     D;
+    int32_t                     issued;    // rows started on the block
+    int32_t                     done;      // rows collected
+} tf_overlap_t;
+
+// Load W_o onto the block. Returns 0, doing nothing, for an output
+// projection the block does not take (block‑sparse, low‑rank, D not 32 or
+// 64, or not tuned to GEMV).
+static TINYFORMER_FAST_TEXT int tf_overlap_begin(
+    tf_overlap_t               *o,
+    const tf_wword_t           *W,
+    const int8_t               *b,
+    const tinyformer_requant_t *rq,
+    const tinyformer_sparse_t  *sp,
+    const tinyformer_lowrank_t *lr,
+    const int8_t               *ctx,
+    const tf_rows_t            *x,
+    int8_t                     *attn_out,
+    int32_t                     D)
+{
+    if (sp != 0 || lr != 0 || (D != 32 && D != 64) || !TF_ON_GEMV(D, D)) {
+        return 0;
+    }
+    tf_gemv_select_w(W, TF_BIAS(rq, b), 0, D, D);
+#if defined(TF_GEMV_REQUANT)
+    if (rq == 0) {
+        gemv_set_requant(GEMV_RQ_SHIFT(7));
+    }
+#endif
+    o->ctx = ctx;
+    o->x = x;
+    o->attn_out = attn_out;
+    o->rq = rq;
+    o->D = D;
+    o->issued = 0;
+    o->done = 0;
+    return 1;
+}
+
+// Wait for the row in flight and write its attn_out row.
+static TINYFORMER_FAST_TEXT void tf_overlap_collect(tf_scratch_t *ws, tf_overlap_t *o)
+{
+    const int32_t D = o->D;
+    const int8_t *x = tf_row(o->x, o->done);
+    int8_t *out = &o->attn_out[o->done * D];
+    int32_t od;
+
+    gemv_wait_done();
+#if defined(TF_GEMV_REQUANT)
+    if (o->rq == 0) {
+        int8_t y8[TINYFORMER_MAX_D] __attribute__((aligned(4)));
+        gemv_read_y8(y8, (int)D);
+        for (od = 0; od < D; ++od) {
+            out[od] = saturate_int32_to_int8((int32_t)x[od] + (int32_t)y8[od]);
+        }
+        o->done++;
+        return;
+    }
+#endif
+    gemv_read_y(ws->acc_buf, (int)D);
+    for (od = 0; od < D; ++od) {
+        int32_t y;
+        TF_RNG_STAGE(TINYFORMER_RNG_O);
+        y = (int32_t)requant(ws->acc_buf[od], o->rq, od);
+        TF_RNG_STAGE(TINYFORMER_RNG_RES1);
+        out[od] = saturate_int32_to_int8((int32_t)x[od] + y);
+    }
+    o->done++;
+}
+
+// Issue every context row below `ready` (rows whose context is complete).
+static TINYFORMER_FAST_TEXT void tf_overlap_step(
+    tf_scratch_t *ws, tf_overlap_t *o, int32_t ready)
+{
+    while (o->issued < ready) {
+        if (o->done < o->issued) {
+            tf_overlap_collect(ws, o);
+        }
+        gemv_clear_x();
+        gemv_load_x(&o->ctx[o->issued * o->D], (int)o->D);
+        gemv_start((int)o->D, (int)o->D, 1);
+        o->issued++;
+    }
+}
+
+static TINYFORMER_FAST_TEXT void tf_overlap_finish(tf_scratch_t *ws, tf_overlap_t *o)
+{
+    while (o->done < o->issued) {
+        tf_overlap_collect(ws, o);
+    }
+}
+#endif
+
+#if TINYFORMER_FUSED_QKV
+// Fused Q/K/V projection: one pass over the input tokens.
+//   [q|k|v][s] = W_qkv[3D][d_in] * src[s][0 .. d_in) + b_qkv[3D]
+// Each token is read once and the three outputs are split from acc_buf.
+static TINYFORMER_FAST_TEXT void qkv_projection_fused(
+    tf_scratch_t     *ws,
+    const int8_t     *src,  // [S][src_stride]
+    int32_t           src_stride,
+    int8_t           *q,    // [S][D]
+    int8_t           *k,    // [S][D]
+    int8_t           *v,    // [S][D]
+    const tf_wword_t *W_qkv,
+    const int8_t     *b_qkv,
+    const tinyformer_requant_t *rq,  // [3D] channels
+    const tinyformer_sparse_t  *sp,  // [3D] rows
+    const tinyformer_lowrank_t *lr,  // [3D] rows
+    int32_t           S,
+    int32_t           D,
+    int32_t           d_in)
+{
+    int32_t s, d;
+    for (s = 0; s < S; ++s) {
+        const int32_t *acc = ws->acc_buf;
+        matvec_i8_i32(ws, &src[s * src_stride], ws->acc_buf, W_qkv, TF_BIAS(rq, b_qkv), sp, lr,
+                      d_in, 3 * D);
+        for (d = 0; d < D; ++d) {
+            TF_RNG_STAGE(TINYFORMER_RNG_Q);
+            q[s * D + d] = requant(acc[d], rq, d);
+            TF_RNG_STAGE(TINYFORMER_RNG_K);
+            k[s * D + d] = requant(acc[D + d], rq, D + d);
+            TF_RNG_STAGE(TINYFORMER_RNG_V);
+            v[s * D + d] = requant(acc[2 * D + d], rq, 2 * D + d);
+        }
+    }
+}
+#endif
+
+#if TINYFORMER_FWA
+// Fused‑weight attention queries (TINYFORMER_FWA), for all tokens:
+//   g[s] = sat((W_qk[d_in][d_in] * src[s][0 .. d_in) + b_qk) >> qk_shift)
+// Channels d_in .. D of g are zero: the keys are the block input itself,
+// whose other channels W_k does not read.
+static TINYFORMER_FAST_TEXT void fwa_projection_all(
+    tf_scratch_t     *ws,
+    const int8_t     *src,  // [S][src_stride]
+    int32_t           src_stride,
+    int8_t           *g,    // [S][D]
+    const tf_wword_t *W_qk,
+    const int32_t    *b_qk,
+    int32_t           qk_shift,
+    int32_t           S,
+    int32_t           D,
+    int32_t           d_in)
+{
+    const int32_t *acc = ws->acc_buf;
+    int32_t s, d;
+    for (s = 0; s < S; ++s) {
+        matvec_i8_i32(ws, &src[s * src_stride], ws->acc_buf, W_qk, tf_zero_bias, 0, 0, d_in, d_in);
+        for (d = 0; d < d_in; ++d) {
+            g[s * D + d] = saturate_int32_to_int8((acc[d] + b_qk[d]) >> qk_shift);
+        }
+        for (; d < D; ++d) {
+            g[s * D + d] = 0;
+        }
+    }
+}
+#endif
+
+// --- Weight cache warm‑up (TINYFORMER_PREFETCH) ---------------------------
+// tf_warm_begin() spreads the lines of one weight range over `steps` calls
+// of TF_WARM_STEP(), made once per query row and head of the attention.
+
+#if TINYFORMER_PREFETCH
+static void tf_warm_begin(tf_scratch_t *ws, const void *p, uint32_t bytes, int32_t steps)
+{
+    const uint32_t line = TINYFORMER_CACHE_LINE;
+    uintptr_t lead = (uintptr_t)p & (uintptr_t)(line - 1u);
+    uint32_t step;
+
+    ws->warm_p = (const uint8_t *)p - lead;
+    ws->warm_left = bytes + (uint32_t)lead;
+    step = (ws->warm_left + (uint32_t)steps - 1u) / (uint32_t)steps;
+    ws->warm_step = (step + line - 1u) & ~(line - 1u);
+}
+
+static TINYFORMER_FAST_TEXT void tf_warm_step(tf_scratch_t *ws)
+{
+    uint32_t n = (ws->warm_left < ws->warm_step) ? ws->warm_left : ws->warm_step;
+    uint32_t off;
+    for (off = 0; off < n; off += TINYFORMER_CACHE_LINE) {
+#if TINYFORMER_PREFETCH == 1
+        __builtin_prefetch(ws->warm_p + off, 0, 3);
+#else
+        (void)*(const volatile uint8_t *)(ws->warm_p + off);
+#endif
+    }
+    ws->warm_p += n;
+    ws->warm_left -= n;
+}
+#define TF_WARM_STEP(ws) tf_warm_step(ws)
+#else
+#define TF_WARM_STEP(ws) ((void)0)
+#endif
+
+#if TINYFORMER_LINEAR_ATTN
+// --- Linear attention -----------------------------------------------------
+//
+// Kernelized attention with the feature map phi(x) = relu(x) on the int8
+// Q and K, per head (channels h0 .. h0 + hd):
+//   context[i][e] = sum_a phi(Q[i][a]) * KV[a][e] / sum_a phi(Q[i][a]) * z[a]
+//   KV[a][e] = sum_j phi(K[j][a]) * V[j][e],   z[a] = sum_j phi(K[j][a])
+// over the attended keys j. KV and z are int32 running sums in the scratch,
+// extended key by key up to TF_KEYS(i, S) before query i, so causal rows
+// reuse the sums of the rows before them. Cost is O(S * D * hd) instead of
+// O(S^2 * D), and there are no scores or exp buffers.
+//
+// The numerator is accumulated in int64 (|KV| can reach 127 * 128 * S). As
+// it is a weighted mean of V, |num| <= 128 * den, so numerator and
+// denominator are shifted until den < 2^24 and the division is int32 (no
+// 64‑bit divide on RV32IM without libgcc). A query with den == 0 (no
+// positive feature in common with any key) gets a zero context.
+// Only query rows [i0, i1) are computed; i0 == 0 restarts the sums.
+
+static TINYFORMER_FAST_TEXT void linear_attn_add_keys(
+    tf_scratch_t *ws,
+    const int8_t *k,   // [S][D]
+    const int8_t *v,   // [S][D]
+    int32_t       n,   // keys to cover
+    int32_t       D)
+{
+    const int32_t hd = D / TINYFORMER_HEADS;
+    int32_t j, h0, a, e;
+
+    for (j = ws->lin_keys; j < n; ++j) {
+        for (h0 = 0; h0 < D; h0 += hd) {
+            int32_t *kv = &ws->lin_kv[h0 * hd];
+            for (a = 0; a < hd; ++a) {
+                const int32_t ka = (int32_t)k[j * D + h0 + a];
+                if (ka <= 0) {
+                    continue;  // phi(k) = 0
+                }
+                ws->lin_z[h0 + a] += ka;
+                for (e = 0; e < hd; ++e) {
+                    kv[a * hd + e] += ka * (int32_t)v[j * D + h0 + e];
+                }
+            }
+        }
+    }
+    if (n > ws->lin_keys) {
+        ws->lin_keys = n;
+    }
+}
+
+static TINYFORMER_FAST_TEXT void attention_linear(
+    tf_scratch_t *ws,
+    const int8_t *q,        // [S][D]
+    const int8_t *k,        // [S][D]
+    const int8_t *v,        // [S][D]
+    int8_t       *context,  // [S][D]
+    int32_t       i0,       // query rows [i0, i1)
+    int32_t       i1,
+    int32_t       S,
+    int32_t       D)
+{
+    const int32_t hd = D / TINYFORMER_HEADS;  // head_dim
+    int32_t i, h0, a, e;
+
+    if (i0 == 0) {
+        for (a = 0; a < D * hd; ++a) {
+            ws->lin_kv[a] = 0;
+        }
+        for (a = 0; a < D; ++a) {
+            ws->lin_z[a] = 0;
+        }
+        ws->lin_keys = 0;
+    }
+
+    TF_RNG_STAGE(TINYFORMER_RNG_CTX);
+    for (i = i0; i < i1; ++i) {
+        linear_attn_add_keys(ws, k, v, TF_KEYS(i, S), D);
+
+        for (h0 = 0; h0 < D; h0 += hd) {
+            const int32_t *kv = &ws->lin_kv[h0 * hd];
+            const int8_t *q_i = &q[i * D + h0];
+            int64_t num[TINYFORMER_MAX_D / TINYFORMER_HEADS];
+            int32_t den = 0;
+            int32_t sh = 0;
+
+            for (e = 0; e < hd; ++e) {
+                num[e] = 0;
+            }
+            for (a = 0; a < hd; ++a) {
+                const int32_t qa = (int32_t)q_i[a];
+                if (qa <= 0) {
+                    continue;  // phi(q) = 0
+                }
+                den += qa * ws->lin_z[h0 + a];
+                for (e = 0; e < hd; ++e) {
+                    num[e] += (int64_t)qa * kv[a * hd + e];
+                }
+            }
+            while ((den >> sh) >= (1 << 24)) {
+                ++sh;
+            }
+            for (e = 0; e < hd; ++e) {
+                int32_t c = 0;
+                if (den > 0) {
+                    c = (int32_t)(num[e] >> sh) / (den >> sh);
+                }
+                context[i * D + h0 + e] = saturate_int32_to_int8(c);
+            }
+            TF_WARM_STEP(ws);
+        }
+    }
+}
+
+#elif !TINYFORMER_ONLINE_SOFTMAX
+#if !defined(USE_SOFTMAX_HW)
+#if defined(TF_EXP_LUT_ROW)
+// exp_buf[j] = exp of scores[j] - max_score for one score row, returns the
+// sum. Same mapping as score_to_exp(), but the clamped indices are packed 8
+// per word and the peripheral returns the whole row and its sum.
+static TINYFORMER_FAST_TEXT uint32_t tf_exp_row_lut(
+    tf_scratch_t *ws, const int32_t *scores, int32_t max_score, uint16_t *exp_buf, int32_t n)
+{
+    uint32_t word = 0;
+    int32_t j;
+    for (j = 0; j < n; ++j) {
+        int32_t idx = -((scores[j] - max_score) >> 3);  // >= 0
+        if (idx > 15) {
+            idx = 15;
+        }
+        word |= (uint32_t)idx << ((j & 7) * 4);
+        if ((j & 7) == 7 || j == n - 1) {
+            ws->exp_idx[j >> 3] = word;
+            word = 0;
+        }
+    }
+    return exp_lut_hw_row(ws->exp_idx, exp_buf, n);
+}
+#endif
+
+#if defined(TF_SCORE_TO_EXP)
+// Same through shifted_to_exp(), one score at a time.
+static TINYFORMER_FAST_TEXT uint32_t tf_exp_row(
+    const int32_t *scores, int32_t max_score, uint16_t *exp_buf, int32_t n)
+{
+    uint32_t sum_exp = 0;
+    int32_t j;
+    for (j = 0; j < n; ++j) {
+        int32_t shifted = scores[j] - max_score; // <= 0
+
+        // Further compress dynamic range by shifting (inside
+        // shifted_to_exp). This keeps values in a rough [-32, 0] range
+        // typically.
+        uint16_t e = shifted_to_exp(shifted);
+        exp_buf[j] = e;
+        sum_exp += (uint32_t)e;
+    }
+    return sum_exp;
+}
+#endif
+#endif
+
+#if TINYFORMER_EXP2_SOFTMAX
+// Base‑2 softmax of one score row (TINYFORMER_EXP2_SOFTMAX), shifts and
+// adds only. With t = max_score - scores[j] >= 0,
+//   n_j = min(15, (t + (t >> 1) - (t >> 4)) >> 3)
+// is the exp LUT index scaled by log2(e) ~ 1.4375, so 2^-n_j ~ exp(-t / 8).
+// The sum of e_j = 2^(15 - n_j) is rounded to 2^L (L = floor(log2(sum)),
+// plus one when the next bit is set), and exp_buf[j] receives the shift
+// n_j + L - 15 of the Q15 weight 2^(15 - n_j) / 2^(L - 15).
+static TINYFORMER_FAST_TEXT void tf_exp2_row(
+    const int32_t *scores, int32_t max_score, uint16_t *exp_buf, int32_t n)
+{
+    uint32_t sum_exp = 0;
+    uint32_t L = 15;
+    int32_t j;
+    for (j = 0; j < n; ++j) {
+        uint32_t t = (uint32_t)(max_score - scores[j]);
+        uint32_t e = (t + (t >> 1) - (t >> 4)) >> 3;
+        if (e > 15u) {
+            e = 15u;
+        }
+        exp_buf[j] = (uint16_t)e;
+        sum_exp += 1u << (15u - e);
+    }
+    // The max key alone gives 2^15, so L >= 15 and every shift is >= 0.
+    while ((sum_exp >> L) > 1u) {
+        ++L;
+    }
+    L += (sum_exp >> (L - 1u)) & 1u;
+    for (j = 0; j < n; ++j) {
+        exp_buf[j] = (uint16_t)(exp_buf[j] + L - 15u);
+    }
+}
+#endif
+
+#if TINYFORMER_SPARSE_SOFTMAX
+// Keys of one Q15 weight row w[0 .. n) that enter the context
+// (TINYFORMER_SPARSE_SOFTMAX): w[j] >= TINYFORMER_SPARSE_MIN_W and, with
+// TINYFORMER_SPARSE_TOPK, among the k largest. The top‑k list is kept
+// sorted by weight by insertion, a key going after the equal ones, so ties
+// keep the lower key. Returns the count; the keys are in idx.
+static TINYFORMER_FAST_TEXT int32_t tf_sparse_keys(const uint16_t *w, uint16_t *idx, int32_t n)
+{
+    int32_t m = 0;
+    int32_t j;
+    for (j = 0; j < n; ++j) {
+        if (w[j] < TINYFORMER_SPARSE_MIN_W) {
+            continue;
+        }
+#if TINYFORMER_SPARSE_TOPK > 0
+        {
+            int32_t p = m;
+            while (p > 0 && w[idx[p - 1]] < w[j]) {
+                if (p < TINYFORMER_SPARSE_TOPK) {
+                    idx[p] = idx[p - 1];
+                }
+                --p;
+            }
+            if (p < TINYFORMER_SPARSE_TOPK) {
+                idx[p] = (uint16_t)j;
+                if (m < TINYFORMER_SPARSE_TOPK) {
+                    ++m;
+                }
+            }
+        }
+#else
+        idx[m++] = (uint16_t)j;
+#endif
+    }
+    return m;
+}
+#endif
+
+// --- Scaled dot‑product attention (streaming) -----------------------------
+//
+// For each query position i and head h (channels h0 .. h0 + hd of Q, K, V
+// and the context, hd = D / TINYFORMER_HEADS):
+//   1. Compute scores[i][j] = dot(Q[i][h], K[j][h]) for all j (j <= i with
+//      TINYFORMER_CAUSAL; the keys after i are never touched)
+//   2. Subtract max over j for numerical stability
+//   3. Approximate softmax with integer LUT (no floats)
+//   4. Compute context[i][h] = sum_j softmax_ij * V[j][h]
+//
+// We never allocate an SxS matrix; we reuse the 1D scores/exp_buf arrays,
+// one head after the other (the scratch does not grow with the heads).
+// Only query rows [i0, i1) are computed, so a caller can interleave other
+// work between rows (TINYFORMER_OVERLAP).
+
+static TINYFORMER_FAST_TEXT void attention_multi_head(
+    tf_scratch_t *ws,
+    const int8_t *q,        // [S][D]
+    const int8_t *k,        // [S][D]
+    const int8_t *v,        // [S][D]
+    int8_t       *context,  // [S][D]
+    int32_t       i0,       // first query row
+    int32_t       i1,       // end of the query rows
+    int32_t       S,
+    int32_t       D)
+{
+    const int32_t hd = D / TINYFORMER_HEADS;  // head_dim
+    uint16_t *exp_buf = ws->exp_buf;
+#if !defined(USE_SOFTMAX_HW)
+    int32_t *scores = ws->scores;
+#endif
+    int32_t ih, j, d;
+
+#if defined(TF_ATTN_HW)
+    // The attention engine computes every query row and head from Q, K
+    // and V on the first call of a block (i0 == 0); the rows are then read
+    // back in order.
+    if (attn_fits((int)S, (int)D, (int)hd)) {
+        if (i0 == 0) {
+            attn_config(TINYFORMER_SCORE_SHIFT, TINYFORMER_FAST_SOFTMAX, TINYFORMER_CAUSAL);
+            attn_run(q, k, v, (int)S, (int)D, (int)hd);
+        }
+        attn_read_ctx(&context[i0 * D], (int)((i1 - i0) * D));
+        return;
+    }
+#endif
+#if defined(USE_SOFTMAX_HW)
+    softmax_config(TINYFORMER_SCORE_SHIFT, TINYFORMER_FAST_SOFTMAX);
+#endif
+
+#if TINYFORMER_GEMV_ATTN
+    // Head by head: the GEMV block keeps the head's K and V^T for all its
+    // query rows.
+    const int32_t rows = i1 - i0;
+    for (ih = 0; ih < rows * TINYFORMER_HEADS; ++ih) {
+        const int32_t i = i0 + ih % rows;
+        const int32_t h0 = (ih / rows) * hd;  // first head channel
+#else
+    // For each sequence position i (query index) and head
+    for (ih = i0 * TINYFORMER_HEADS; ih < i1 * TINYFORMER_HEADS; ++ih) {
+        const int32_t i = ih / TINYFORMER_HEADS;
+        const int32_t h0 = (ih % TINYFORMER_HEADS) * hd;  // first head channel
+#endif
+        const int32_t n = TF_KEYS(i, S);  // keys attended by query i
+        const int8_t *q_i = &q[i * D + h0];
+#if defined(USE_SOFTMAX_HW)
+        // 1.-3. Raw scores go straight to the softmax unit, which applies the
+        //    >> TINYFORMER_SCORE_SHIFT, the max, the exp LUT, the sum and the
+        //    Q15 normalize below bit for bit and returns the weights into
+        //    exp_buf.
+        softmax_begin();
+        TF_RNG_STAGE(TINYFORMER_RNG_SCORES);
+        for (j = 0; j < n; ++j) {
+            const int32_t acc = dot_i8(q_i, &k[j * D + h0], hd);
+            TF_RNG_NOTE(acc >> TINYFORMER_SCORE_SHIFT, 0);
+            softmax_push(acc);
+        }
+        TF_WARM_STEP(ws);  // while the unit normalizes
+        softmax_finish(exp_buf, n);
+#else
+        // 1. Compute raw dot‑product scores with all attended keys.
+        int32_t max_score = -2147483647;
+#if TINYFORMER_GEMV_ATTN
+        //    On the GEMV block: K * q_i for all S keys at once.
+        if (ih % rows == 0) {
+            gemv_attn_load(&k[h0], &v[h0], (int)S, (int)hd, (int)D);
+        }
+        gemv_attn_scores(q_i, scores);
+#endif
+        TF_RNG_STAGE(TINYFORMER_RNG_SCORES);
+        for (j = 0; j < n; ++j) {
+#if TINYFORMER_GEMV_ATTN
+            int32_t acc = scores[j];
+#else
+            int32_t acc = dot_i8(q_i, &k[j * D + h0], hd);
+#endif
+
+            // Approximate scaling by 1/sqrt(head_dim) using a shift.
+            // With head_dim 32, scores can be large; we right‑shift by 5
+            // bits to reduce magnitude before softmax (empirical choice,
+            // see TINYFORMER_SCORE_SHIFT).
+            acc >>= TINYFORMER_SCORE_SHIFT;
+            TF_RNG_NOTE(acc, 0);
+
+            scores[j] = acc;
+#if defined(TF_DOT8_SIMD)
+            max_score = dot8_max(max_score, acc);
+#else
+            if (acc > max_score) {
+                max_score = acc;
+            }
+#endif
+        }
+
+#if TINYFORMER_EXP2_SOFTMAX
+        // 2.-3. Base‑2 exps, power‑of‑two sum: exp_buf[j] is the shift of
+        //    the weight of key j.
+        tf_exp2_row(scores, max_score, exp_buf, n);
+#else
+        // 2. Subtract max for numerical stability, convert to small range
+        //    and look up approximate exp values.
+#if defined(TF_EXP_LUT_ROW) && defined(TF_SCORE_TO_EXP)
+        uint32_t sum_exp = tf_exp_on_lut ? tf_exp_row_lut(ws, scores, max_score, exp_buf, n)
+                                         : tf_exp_row(scores, max_score, exp_buf, n);
+#elif defined(TF_EXP_LUT_ROW)
+        uint32_t sum_exp = tf_exp_row_lut(ws, scores, max_score, exp_buf, n);
+#else
+        uint32_t sum_exp = tf_exp_row(scores, max_score, exp_buf, n);
+#endif
+
+        // Guard against division by zero (degenerate case).
+        if (sum_exp == 0u) {
+            sum_exp = 1u;
+        }
+
+        // 3. Softmax weights, once per query (not per output element).
+        //    We represent softmax_ij as Q15 fixed‑point:
+        //      w_ij_q15 = (exp_buf[j] << 15) / sum_exp
+        //    stored in place in exp_buf (w_ij_q15 <= 32768 fits uint16_t).
+#if TINYFORMER_FAST_SOFTMAX
+        {
+            // One division per query, then a multiply per key:
+            //   w ~= (exp * (2^31 / sum_exp)) >> 16   (may be 1 LSB low)
+            // exp <= sum_exp, so the product stays below 2^32.
+            uint32_t recip = 0x80000000u / sum_exp;
+            for (j = 0; j < n; ++j) {
+                exp_buf[j] = (uint16_t)(((uint32_t)exp_buf[j] * recip) >> 16);
+            }
+        }
+#else
+        for (j = 0; j < n; ++j) {
+            exp_buf[j] = (uint16_t)(((uint32_t)exp_buf[j] << 15) / sum_exp);
+        }
+#endif
+#endif  // TINYFORMER_EXP2_SOFTMAX
+        TF_WARM_STEP(ws);
+#endif  // USE_SOFTMAX_HW
+
+        // 4. Compute context[i][d] = sum_j softmax_ij * V[j][d] over the
+        //    head's channels d:
+        //      context[i][d] = sum_j (w_ij_q15 * V[j][d]) >> 15
+        TF_RNG_STAGE(TINYFORMER_RNG_CTX);
+#if TINYFORMER_GEMV_ATTN
+        //    as V^T * w on the GEMV block, with one >> 15 of each exact int32
+        //    sum; keys past n weigh 0.
+        {
+            int32_t ctx[TINYFORMER_MAX_D];
+            for (j = n; j < S; ++j) {
+                exp_buf[j] = 0;
+            }
+            gemv_attn_context(exp_buf, ctx);
+            for (d = 0; d < hd; ++d) {
+                context[i * D + h0 + d] = saturate_int32_to_int8(ctx[d] >> 15);
+            }
+        }
+#elif TINYFORMER_SPARSE_SOFTMAX
+        //    over the kept keys only, with one >> 15 of the int32 sum
+        //    (the weights sum to at most 2^15, so |sum| <= 2^22).
+        {
+            uint16_t *idx = ws->sparse_idx;
+            const int32_t m = tf_sparse_keys(exp_buf, idx, n);
+            int32_t r;
+            for (d = h0; d < h0 + hd; ++d) {
+                int32_t acc = 0;
+                for (r = 0; r < m; ++r) {
+                    acc += (int32_t)exp_buf[idx[r]] * (int32_t)v[idx[r] * D + d];
+                }
+                context[i * D + d] = saturate_int32_to_int8(acc >> 15);
+            }
+        }
+#elif TINYFORMER_EXP2_SOFTMAX
+        //    with w_ij_q15 = 2^(15 - shift): (w * V) >> 15 is V >> shift.
+        for (d = h0; d < h0 + hd; ++d) {
+            int32_t acc = 0;
+            for (j = 0; j < n; ++j) {
+                acc += (int32_t)v[j * D + d] >> exp_buf[j];
+            }
+            context[i * D + d] = saturate_int32_to_int8(acc);
+        }
+#elif TINYFORMER_HOST_SIMD && !defined(USE_DOT8_HW)
+        int32_t ctx[TINYFORMER_MAX_D];
+        tf_simd_context(exp_buf, &v[h0], ctx, n, hd, D);
+        for (d = 0; d < hd; ++d) {
+            context[i * D + h0 + d] = saturate_int32_to_int8(ctx[d]);
+        }
+#else
+        for (d = h0; d < h0 + hd; ++d) {
+            int32_t acc = 0;
+            for (j = 0; j < n; ++j) {
+                acc += ((int32_t)exp_buf[j] * (int32_t)v[j * D + d]) >> 15;
+            }
+            context[i * D + d] = saturate_int32_to_int8(acc);
+        }
+#endif
+    }
+}
+
+#else  // TINYFORMER_ONLINE_SOFTMAX
+// --- One‑pass attention (online softmax) ----------------------------------
+//
+// Same heads, score scaling and exp LUT as attention_multi_head, but keys are
+// consumed in blocks of TINYFORMER_ATTN_BLOCK with a running max m:
+//   - when a block raises m, ctx_acc and sum_exp are scaled by exp(m_old - m)
+//   - ctx_acc[d] += e_j * V[j][d],  sum_exp += e_j   (e_j in Q10)
+//   - context[i][d] = ctx_acc[d] / sum_exp
+// Working state is O(D + block) per query and head instead of O(S).
+
+static TINYFORMER_FAST_TEXT void transpose_k(
+    const int8_t *k,   // [S][D]
+    int8_t       *kT,  // [D][S]
+    int32_t       S,
+    int32_t       D)
+{
+    int32_t j, d;
+    for (j = 0; j < S; ++j) {
+        for (d = 0; d < D; ++d) {
+            kT[d * S + j] = k[j * D + d];
+        }
+    }
+}
+
+static TINYFORMER_FAST_TEXT void attention_online(
+    tf_scratch_t *ws,
+    const int8_t *q,        // [S][D]
+    const int8_t *kT,       // [D][S]
+    const int8_t *v,        // [S][D]
+    int8_t       *context,  // [S][D]
+    int32_t       i0,       // query rows [i0, i1)
+    int32_t       i1,
+    int32_t       S,
+    int32_t       D)
+{
+    const int32_t hd = D / TINYFORMER_HEADS;  // head_dim
+    int32_t *ctx_acc = ws->ctx_acc;
+    int32_t ih, j0, b, d;
+
+    for (ih = i0 * TINYFORMER_HEADS; ih < i1 * TINYFORMER_HEADS; ++ih) {
+        const int32_t i = ih / TINYFORMER_HEADS;
+        const int32_t h0 = (ih % TINYFORMER_HEADS) * hd;  // first head channel
+        const int32_t n = TF_KEYS(i, S);  // keys attended by query i
+        int32_t m = 0;
+        uint32_t sum_exp = 0;
+
+        for (d = 0; d < hd; ++d) {
+            ctx_acc[d] = 0;
+        }
+
+        for (j0 = 0; j0 < n; j0 += TINYFORMER_ATTN_BLOCK) {
+            // 1. Scores for this block: kT rows are contiguous over keys.
+#if TINYFORMER_CAUSAL
+            const int32_t nb = TF_MIN(TINYFORMER_ATTN_BLOCK, n - j0);
+#else
+            const int32_t nb = TINYFORMER_ATTN_BLOCK;
+#endif
+            int32_t sc[TINYFORMER_ATTN_BLOCK];
+            int32_t block_max;
+            for (b = 0; b < nb; ++b) {
+                sc[b] = 0;
+            }
+            for (d = h0; d < h0 + hd; ++d) {
+                const int32_t qd = (int32_t)q[i * D + d];
+                const int8_t *row = &kT[d * S + j0];
+                for (b = 0; b < nb; ++b) {
+                    sc[b] += qd * (int32_t)row[b];
+                }
+            }
+            block_max = -2147483647;
+            TF_RNG_STAGE(TINYFORMER_RNG_SCORES);
+            for (b = 0; b < nb; ++b) {
+                sc[b] >>= TINYFORMER_SCORE_SHIFT;  // same 1/sqrt(head_dim) as the two‑pass path
+                TF_RNG_NOTE(sc[b], 0);
+                if (sc[b] > block_max) {
+                    block_max = sc[b];
+                }
+            }
+
+            // 2. New running max: rescale what has been accumulated so far.
+            if (j0 == 0) {
+                m = block_max;
+            } else if (block_max > m) {
+                uint16_t f = shifted_to_exp(m - block_max);
+                if (f != 1024u) {
+                    for (d = 0; d < hd; ++d) {
+                        ctx_acc[d] = (int32_t)(((int64_t)ctx_acc[d] * f) >> 10);
+                    }
+                    sum_exp = (sum_exp * f) >> 10;
+                }
+                m = block_max;
+            }
+
+            // 3. Accumulate exp‑weighted values.
+            for (b = 0; b < nb; ++b) {
+                int32_t e = (int32_t)shifted_to_exp(sc[b] - m);
+                const int8_t *v_row = &v[(j0 + b) * D + h0];
+                sum_exp += (uint32_t)e;
+                for (d = 0; d < hd; ++d) {
+                    ctx_acc[d] += e * (int32_t)v_row[d];
+                }
+            }
+        }
+
+        TF_WARM_STEP(ws);
+
+        // 4. Normalize (sum_exp >= the LUT floor of the max key, never 0).
+        if (sum_exp == 0u) {
+            sum_exp = 1u;
+        }
+        TF_RNG_STAGE(TINYFORMER_RNG_CTX);
+        for (d = 0; d < hd; ++d) {
+            context[i * D + h0 + d] = saturate_int32_to_int8(ctx_acc[d] / (int32_t)sum_exp);
+        }
+    }
+}
+#endif
+
+// --- Feed‑forward network (FFN) -------------------------------------------
+//
+// For each token x (dimension D):
+//   h = ReLU(W_ff1 * x + b_ff1)   // h in R^FFN
+//   y = W_ff2 * h + b_ff2        // y in R^D
+//   out = x + y                  // residual
+//
+// The FFN is per token, so it is streamed: h for one token lives in
+// ffn_hidden_tok and is consumed by W_ff2 right away; no [S][FFN] tensor.
+
+// With TINYFORMER_FFN_GATHER the ReLU also lists the non‑zero units of h in
+// ws->ffn_live, and W_ff2 * h only visits their columns (ffn_gather_i32).
+
+#if TINYFORMER_FFN_GATHER
+#if TINYFORMER_MAX_FFN > 256
+#error "TINYFORMER_FFN_GATHER lists hidden units as uint8: TINYFORMER_MAX_FFN must be <= 256"
+#endif
+#define TF_FFN_LIVE_START(n)      ((n) = 0)
+#define TF_FFN_LIVE_ADD(n, k, on) (ws->ffn_live[n] = (uint8_t)(k), (n) += (on))
+
+// The live list of a hidden vector the ReLU loop did not list (packed
+// requant, GEMV); returns its length.
+static TINYFORMER_FAST_TEXT int32_t ffn_live_units(const tf_hidden_t *h, uint8_t *live, int32_t FFN)
+{
+    int32_t k, n = 0;
+    for (k = 0; k < FFN; ++k) {
+        live[n] = (uint8_t)k;
+        n += (h[k] != 0);
+    }
+    return n;
+}
+
+// W_ff2 * h over the live units only, from the column‑major W_ff2_cols:
+//   acc[d] = b[d] + sum_{k in live} h[k] * W_cols[k][d]
+// (2 * b[d] against the uint8 hidden, as matvec_u8_i32). The dense matvec's
+// sums in another order, so bit‑identical.
+static TINYFORMER_FAST_TEXT void ffn_gather_i32(
+    int32_t           *acc,
+    const tf_hidden_t *h,
+    const uint8_t     *live,
+    int32_t            n_live,
+    const int8_t      *W_cols,  // [FFN][D]
+    const int8_t      *b,
+    int32_t            D)
+{
+    int32_t d, k;
+    for (d = 0; d < D; ++d) {
+        acc[d] = (TINYFORMER_FFN_U8_HIDDEN ? 2 : 1) * (int32_t)b[d];
+    }
+    for (k = 0; k < n_live; ++k) {
+        const int32_t hk = (int32_t)h[live[k]];
+        const int8_t *col = &W_cols[(int32_t)live[k] * D];
+        for (d = 0; d < D; ++d) {
+            acc[d] += hk * (int32_t)col[d];
+        }
+    }
+}
+#else
+#define TF_FFN_LIVE_START(n)      ((void)0)
+#define TF_FFN_LIVE_ADD(n, k, on) ((void)0)
+#endif
+
+#if TINYFORMER_PROFILE
+// Hidden units through the FF1 ReLU and the non‑zero ones among them
+// (tinyformer_profile_t.ffn_units / .ffn_live).
+static uint32_t tf_ffn_units, tf_ffn_live;
+#endif
+
+// pool != 0: out is not written; the output tokens are summed per channel
+// into pool->sum and their bytes into pool->cksum instead.
+static TINYFORMER_FAST_TEXT void ffn_apply(
+    tf_scratch_t              *ws,
+    const int8_t              *in,      // [S][D]
+    int8_t                    *out,     // [S][D], in + FFN(in)
+    tinyformer_pool_t         *pool,
+    const tinyformer_weights_t *w,
+    int32_t                    S,
+    int32_t                    D,
+    int32_t                    FFN)
+{
+    const tinyformer_requant_t *rq1 = TF_RQ(w, TINYFORMER_RQ_FF1);
+    const tinyformer_requant_t *rq2 = TF_RQ(w, TINYFORMER_RQ_FF2);
+    const tinyformer_sparse_t *sp1 = TF_SP(w, TINYFORMER_RQ_FF1);
+    const tinyformer_lowrank_t *lr1 = TF_LR(w, TINYFORMER_RQ_FF1);
+    int32_t *acc_buf = ws->acc_buf;
+    tf_hidden_t *ffn_hidden_tok = ws->ffn_hidden_tok;
+    int32_t s, d;
+
+    for (s = 0; s < S; ++s) {
+#if TINYFORMER_FFN_GATHER
+        int32_t n_live = -1;  // not listed yet
+#endif
+        // First layer + ReLU: h = W_ff1 * in[s] + b_ff1, W_ff1: [FFN][D]
+        TF_RNG_STAGE(TINYFORMER_RNG_FF1);
+#if TINYFORMER_FFN_U8_HIDDEN
+        matvec_i8_i32(ws, &in[s * D], acc_buf, w->W_ff1, TF_BIAS(rq1, w->b_ff1), sp1, lr1, D, FFN);
+        TF_FFN_LIVE_START(n_live);
+        for (d = 0; d < FFN; ++d) {
+            ffn_hidden_tok[d] = requant_relu_u8(acc_buf[d], rq1, d);
+            TF_FFN_LIVE_ADD(n_live, d, ffn_hidden_tok[d] != 0);
+        }
+#else
+#if defined(TF_GEMV_REQUANT)
+        if (rq1 != 0 || sp1 != 0 || lr1 != 0 || !TF_ON_GEMV(D, FFN) ||
+            !tf_gemv_matvec_i8(&in[s * D], ffn_hidden_tok, w->W_ff1, w->b_ff1, D, FFN, 1))
+#endif
+        {
+            matvec_i8_i32(ws, &in[s * D], acc_buf, w->W_ff1, TF_BIAS(rq1, w->b_ff1), sp1, lr1, D, FFN);
+#if defined(TF_DOT8_SIMD)
+            if (rq1 == 0 && TF_PACKED_OK(ffn_hidden_tok, FFN)) {
+                tf_requant7_packed(acc_buf, ffn_hidden_tok, FFN, 1);
+            } else
+#endif
+            {
+                TF_FFN_LIVE_START(n_live);
+                for (d = 0; d < FFN; ++d) {
+                    // Requantize then ReLU in int8 space.
+                    int8_t h = requant(acc_buf[d], rq1, d);
+                    ffn_hidden_tok[d] = (h < 0) ? 0 : h;
+                    TF_FFN_LIVE_ADD(n_live, d, h > 0);
+                }
+            }
+        }
+#endif
+#if TINYFORMER_FFN_GATHER
+        if (n_live < 0) {
+            n_live = ffn_live_units(ffn_hidden_tok, ws->ffn_live, FFN);
+        }
+#endif
+#if TINYFORMER_PROFILE
+        tf_ffn_units += (uint32_t)FFN;
+#if TINYFORMER_FFN_GATHER
+        tf_ffn_live += (uint32_t)n_live;
+#else
+        for (d = 0; d < FFN; ++d) {
+            tf_ffn_live += (ffn_hidden_tok[d] != 0);
+        }
+#endif
+#endif
+
+        // Second layer + residual
+#if TINYFORMER_FFN_GATHER
+        if (w->W_ff2_cols != 0) {
+            ffn_gather_i32(acc_buf, ffn_hidden_tok, ws->ffn_live, n_live, w->W_ff2_cols,
+                           TF_BIAS(rq2, w->b_ff2), D);
+        } else
+#endif
+        {
+#if TINYFORMER_FFN_U8_HIDDEN
+            matvec_u8_i32(ws, ffn_hidden_tok, acc_buf, w->W_ff2, TF_BIAS(rq2, w->b_ff2), FFN, D);
+#else
+            matvec_i8_i32(ws, ffn_hidden_tok, acc_buf, w->W_ff2, TF_BIAS(rq2, w->b_ff2),
+                          TF_SP(w, TINYFORMER_RQ_FF2), TF_LR(w, TINYFORMER_RQ_FF2), FFN, D);
+#endif
+        }
+        for (d = 0; d < D; ++d) {
+            int32_t acc;
+            int8_t y;
+            TF_RNG_STAGE(TINYFORMER_RNG_FF2);
+            acc = (int32_t)in[s * D + d] + (int32_t)requant_ff2(acc_buf[d], rq2, d);
+            TF_RNG_STAGE(TINYFORMER_RNG_RES2);
+            y = saturate_int32_to_int8(acc);
+            if (pool != 0) {
+                pool->sum[d] += y;
+                pool->cksum += (uint8_t)y;
+            } else {
+                out[s * D + d] = y;
+            }
+        }
+    }
+}
+
+// --- Profiling ------------------------------------------------------------
+
+// TF_PROF_START() sets the mark; TF_PROF_MARK(stage) charges the cycles and
+// instructions since the last mark to stage and moves the mark. With the
+// perfmon block its event counters are snapshotted and charged the same way
+// (the snapshot's own CSR accesses land in the next stage). With
+// TINYFORMER_TRACE each mark is also a MARK / STAGE trace event.
+#if TINYFORMER_PROFILE
+static tinyformer_profile_t tf_prof;
+static uint32_t tf_prof_cycle, tf_prof_instret;
+#if defined(USE_PERFMON_HW)
+static uint32_t tf_prof_perf[TINYFORMER_PERF_EVENTS];
+#endif
+
+static inline void tf_prof_start(void)
+{
+    tf_prof_cycle = cycle_counter_read();
+    tf_prof_instret = instret_counter_read();
+#if defined(USE_PERFMON_HW)
+    perfmon_read(tf_prof_perf);
+#endif
+}
+
+#if TINYFORMER_LATENCY
+static uint32_t tf_lat_hist[TINYFORMER_LAT_COUNT][TINYFORMER_LAT_BUCKETS];
+static uint32_t tf_lat_max[TINYFORMER_LAT_COUNT];
+
+// floor(log2(v)) (0 for v < 2) in five steps: rv32im has no clz and the
+// firmware links no libgcc.
+static inline void tf_lat_add(int lat, uint32_t v)
+{
+    uint32_t b = 0;
+    if (v >= 1u << 16) { b += 16; }
+    if ((v >> b) >= 1u << 8) { b += 8; }
+    if ((v >> b) >= 1u << 4) { b += 4; }
+    if ((v >> b) >= 1u << 2) { b += 2; }
+    if ((v >> b) >= 1u << 1) { b += 1; }
+    ++tf_lat_hist[lat][b];
+    if (v > tf_lat_max[lat]) {
+        tf_lat_max[lat] = v;
+    }
+}
+#endif
+
+static inline void tf_prof_mark(int stage)
+{
+    uint32_t c = cycle_counter_read();
+    uint32_t n = instret_counter_read();
+#if TINYFORMER_LATENCY
+    tf_lat_add(stage, c - tf_prof_cycle);
+#endif
+    tf_prof.cycles[stage] += c - tf_prof_cycle;
+    tf_prof.instret[stage] += n - tf_prof_instret;
+    tf_prof_cycle = c;
+    tf_prof_instret = n;
+#if defined(USE_PERFMON_HW)
+    uint32_t ev[TINYFORMER_PERF_EVENTS];
+    perfmon_read(ev);
+    for (int e = 0; e < TINYFORMER_PERF_EVENTS; ++e) {
+        tf_prof.perf[stage][e] += ev[e] - tf_prof_perf[e];
+        tf_prof_perf[e] = ev[e];
+    }
+#endif
+}
+
+#define TF_PROF_START()      do { tf_prof_start(); TF_TRACE(TF_EV_MARK, 0); } while (0)
+#define TF_PROF_MARK(stage)  do { tf_prof_mark(stage); TF_TRACE(TF_EV_STAGE, stage); } while (0)
+#define TF_PROF_SAMPLES(n)   (tf_prof.samples += (uint32_t)(n))
+#else
+// Without the profile the marks still feed the trace (TINYFORMER_TRACE).
+#define TF_PROF_START()      TF_TRACE(TF_EV_MARK, 0)
+#define TF_PROF_MARK(stage)  TF_TRACE(TF_EV_STAGE, stage)
+#define TF_PROF_SAMPLES(n)   ((void)0)
+#endif
+
+void tinyformer_profile_reset(void)
+{
+#if TINYFORMER_RANGE_STATS
+    for (int r = 0; r < TINYFORMER_RNG_COUNT; ++r) {
+        tinyformer_range_t zero = {0, 0, 0, 0, 0};
+        tf_rng[r] = zero;
+    }
+#endif
+#if TINYFORMER_PROFILE
+    tinyformer_profile_t zero = {{0}, {0}, 0, {{0}}, 0, 0};
+    tf_prof = zero;
+    tf_ffn_units = tf_ffn_live = 0;
+#if TINYFORMER_LATENCY
+    for (int l = 0; l < TINYFORMER_LAT_COUNT; ++l) {
+        for (int b = 0; b < TINYFORMER_LAT_BUCKETS; ++b) {
+            tf_lat_hist[l][b] = 0;
+        }
+        tf_lat_max[l] = 0;
+    }
+#endif
+#if defined(USE_PERFMON_HW)
+    perfmon_start();
+#endif
+#endif
+}
+
+void tinyformer_profile_read(tinyformer_profile_t *out)
+{
+#if TINYFORMER_PROFILE
+    *out = tf_prof;
+    out->ffn_units = tf_ffn_units;
+    out->ffn_live = tf_ffn_live;
+#else
+    tinyformer_profile_t zero = {{0}, {0}, 0, {{0}}, 0, 0};
+    *out = zero;
+#endif
+}
+
+void tinyformer_range_read(int stage, tinyformer_range_t *out)
+{
+#if TINYFORMER_RANGE_STATS
+    *out = tf_rng[stage];
+#else
+    tinyformer_range_t zero = {0, 0, 0, 0, 0};
+    (void)stage;
+    *out = zero;
+#endif
+}
+
+void tinyformer_latency_record(uint32_t cycles)
+{
+#if TINYFORMER_LATENCY
+    tf_lat_add(TINYFORMER_LAT_CALL, cycles);
+#else
+    (void)cycles;
+#endif
+}
+
+void tinyformer_latency_read(int lat, tinyformer_latency_t *out)
+{
+    tinyformer_latency_t r = {0, 0, 0, 0, 0};
+#if TINYFORMER_LATENCY
+    static const uint32_t pct[3] = {50, 95, 99};
+    uint32_t *const dst[3] = {&r.p50, &r.p95, &r.p99};
+    const uint32_t *h = tf_lat_hist[lat];
+    int b;
+    for (b = 0; b < TINYFORMER_LAT_BUCKETS; ++b) {
+        r.count += h[b];
+    }
+    r.max = tf_lat_max[lat];
+    for (int p = 0; p < 3 && r.count > 0; ++p) {
+        // rank = ceil(count * pct / 100) without a 64‑bit product
+        const uint32_t rank = (r.count / 100u) * pct[p] + ((r.count % 100u) * pct[p] + 99u) / 100u;
+        uint32_t seen = 0;
+        for (b = 0; seen + h[b] < rank; ++b) {
+            seen += h[b];
+        }
+        const uint32_t top = (2u << b) - 1u;   // b = 31: wraps to 2^32 - 1
+        *dst[p] = top < r.max ? top : r.max;
+    }
+#else
+    (void)lat;
+#endif
+    *out = r;
+}
+
+#if TINYFORMER_AUTOTUNE
+// Timed runs per candidate; the fastest counts (interrupts, cache misses).
+#define TF_TUNE_RUNS 3
+
+// One layer as tinyformer_autotune() times it. reuse: the encoder runs all
+// S tokens against the layer's W (projections), so the GEMV block keeps it
+// resident; FF1/FF2 alternate on the block every token.
+typedef struct {
+    const int8_t *W;
+    const int8_t *b;
+    int32_t       d_in;
+    int32_t       d_out;
+    int           reuse;
+} tf_tune_layer_t;
+
+static uint32_t tf_tune_time(tf_matvec_fn fn, const tf_tune_layer_t *l,
+                             const int8_t *x, int32_t *acc)
+{
+    uint32_t best = 0xFFFFFFFFu;
+    int r;
+    for (r = 0; r < TF_TUNE_RUNS; ++r) {
+        uint32_t t0, t;
+#if defined(USE_GEMV_HW)
+        if (!l->reuse) {
+            gemv_invalidate_w();
+        }
+#endif
+        t0 = cycle_counter_read();
+        fn(x, acc, l->W, l->b, l->d_in, l->d_out);
+        t = cycle_counter_read() - t0;
+        if (t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+#if defined(USE_EXP_LUT_HW)
+// Cycles of one S‑score row of softmax exps with the LUT on or off; *sum
+// receives the row sum (which must not depend on the mode).
+static uint32_t tf_tune_exp(tf_scratch_t *ws, int lut, uint32_t *sum)
+{
+    int32_t scores[TINYFORMER_MAX_S];
+    uint16_t e[TINYFORMER_MAX_S];
+    uint32_t best = 0xFFFFFFFFu;
+    int32_t j;
+    int r;
+    for (j = 0; j < TINYFORMER_S; ++j) {
+        scores[j] = -8 * j;  // every LUT index
+    }
+    tf_exp_on_lut = (uint8_t)lut;
+    for (r = 0; r < TF_TUNE_RUNS; ++r) {
+        uint32_t t0 = cycle_counter_read(), t;
+        uint32_t acc = 0;
+#if defined(TF_EXP_LUT_ROW)
+        if (lut) {
+            acc = tf_exp_row_lut(ws, scores, 0, e, TINYFORMER_S);
+        } else
+#endif
+        {
+            for (j = 0; j < TINYFORMER_S; ++j) {
+                e[j] = shifted_to_exp(scores[j]);
+                acc += e[j];
+            }
+        }
+        t = cycle_counter_read() - t0;
+        if (t < best) {
+            best = t;
+        }
+        *sum = acc;
+    }
+    (void)ws;
+    return best;
+}
+#endif
+#endif
+
+// allow: TF_TUNE_FASTEST times the candidates and keeps the fastest
+// (tinyformer_autotune()); otherwise a TINYFORMER_HW_* mask whose present
+// backends are used by priority (tinyformer_select_backends()).
+#define TF_TUNE_FASTEST 0xFFFFFFFFu
+
+static void tf_autotune(const tinyformer_weights_t *w, uint32_t allow, tinyformer_tune_t *out)
+{
+    tinyformer_tune_t t = {0, {0}, {0}, 0};
+#if TINYFORMER_AUTOTUNE
+    const int32_t D = TINYFORMER_D;
+    const int32_t FFN = TINYFORMER_FFN;
+    tf_tune_layer_t layer[TINYFORMER_RQ_COUNT];
+    int8_t x[TF_MAX(TINYFORMER_MAX_D, TINYFORMER_MAX_FFN)] __attribute__((aligned(4)));
+    int32_t acc[TINYFORMER_ACC_MAX];
+    int32_t *ref = tf_scratch.acc_buf;
+    int32_t d_in, k, l;
+
+    if (w == 0) {
+        w = &tinyformer_default_weights;
+    }
+    d_in = (w->d_in > 0 && w->d_in < D) ? w->d_in : D;
+    {
+        const tf_tune_layer_t q   = {w->W_q, w->b_q, d_in, D, 1};
+        const tf_tune_layer_t kk  = {w->W_k, w->b_k, d_in, D, 1};
+        const tf_tune_layer_t v   = {w->W_v, w->b_v, d_in, D, 1};
+        const tf_tune_layer_t o   = {w->W_o, w->b_o, D, D, 1};
+        const tf_tune_layer_t ff1 = {w->W_ff1, w->b_ff1, D, FFN, 0};
+        const tf_tune_layer_t ff2 = {w->W_ff2, w->b_ff2, FFN, D, 0};
+        const tf_tune_layer_t qkv = {TINYFORMER_FUSED_QKV ? w->W_qkv : 0, w->b_qkv, d_in, 3 * D, 1};
+        layer[TINYFORMER_RQ_Q] = q;
+        layer[TINYFORMER_RQ_K] = kk;
+        layer[TINYFORMER_RQ_V] = v;
+        layer[TINYFORMER_RQ_O] = o;
+        layer[TINYFORMER_RQ_FF1] = ff1;
+        layer[TINYFORMER_RQ_FF2] = ff2;
+        layer[TINYFORMER_RQ_QKV] = qkv;
+    }
+    for (k = 0; k < (int32_t)sizeof(x); ++k) {
+        x[k] = (int8_t)(k * 37 - 100);
+    }
+
+    // Everything on the CPU until the table is filled.
+    tf_hw = 0;
+    tf_exp_on_lut = 0;
+    tf_tune_n = 0;
+#if defined(USE_DOT8_HW)
+    if (dot8_probe()) {
+        t.hw |= TINYFORMER_HW_DOT8;
+    }
+#endif
+#if defined(USE_GEMV_HW)
+    if (gemv_probe()) {
+        t.hw |= TINYFORMER_HW_GEMV;
+    }
+#endif
+#if defined(USE_EXP_LUT_HW)
+    if (exp_lut_probe()) {
+        t.hw |= TINYFORMER_HW_EXP_LUT;
+    }
+#endif
+
+    for (l = 0; l < TINYFORMER_RQ_COUNT; ++l) {
+        const tf_tune_layer_t *ly = &layer[l];
+        const tf_matvec_fn cand[TINYFORMER_KERNEL_COUNT] = {
+            tf_mv_cpu,
+#if defined(USE_DOT8_HW)
+            (t.hw & allow & TINYFORMER_HW_DOT8) ? tf_mv_dot8 : 0,
+#else
+            0,
+#endif
+#if defined(USE_GEMV_HW)
+            (t.hw & allow & TINYFORMER_HW_GEMV) ? tf_mv_gemv : 0,
+#else
+            0,
+#endif
+        };
+        int32_t best = TINYFORMER_KERNEL_CPU;
+        int32_t prev;
+        if (ly->W == 0) {
+            continue;
+        }
+        // Layers of an already tuned shape share its entry.
+        for (prev = 0; prev < l; ++prev) {
+            if (layer[prev].W != 0 && layer[prev].d_in == ly->d_in &&
+                layer[prev].d_out == ly->d_out) {
+                break;
+            }
+        }
+        if (prev < l) {
+            t.kernel[l] = t.kernel[prev];
+            t.cycles[l] = t.cycles[prev];
+            continue;
+        }
+        t.cycles[l] = tf_tune_time(tf_mv_cpu, ly, x, ref);
+        for (k = TINYFORMER_KERNEL_CPU + 1; k < TINYFORMER_KERNEL_COUNT; ++k) {
+            uint32_t c;
+            int32_t od;
+            if (cand[k] == 0 || (ly->d_in % 4) != 0) {
+                continue;
+            }
+            c = tf_tune_time(cand[k], ly, x, acc);
+            // A block that computes wrong sums does not count as present;
+            // a selected one wins over the CPU and over the kernels before it.
+            for (od = 0; od < ly->d_out && acc[od] == ref[od]; ++od) {
+            }
+            if (od == ly->d_out && (c < t.cycles[l] || allow != TF_TUNE_FASTEST)) {
+                t.cycles[l] = c;
+                best = k;
+            }
+        }
+        t.kernel[l] = (uint8_t)best;
+        tf_tune[tf_tune_n].d_in = ly->d_in;
+        tf_tune[tf_tune_n].d_out = ly->d_out;
+        tf_tune[tf_tune_n].fn = cand[best];
+        tf_tune_n++;
+    }
+
+#if defined(USE_EXP_LUT_HW)
+    if (t.hw & allow & TINYFORMER_HW_EXP_LUT) {
+        uint32_t sum_sw, sum_lut;
+        const uint32_t c_sw = tf_tune_exp(&tf_scratch, 0, &sum_sw);
+        const uint32_t c_lut = tf_tune_exp(&tf_scratch, 1, &sum_lut);
+        t.exp_lut = (uint8_t)(sum_lut == sum_sw && (c_lut < c_sw || allow != TF_TUNE_FASTEST));
+    }
+#endif
+    tf_exp_on_lut = t.exp_lut;
+    tf_hw = t.hw & allow;
+#else
+    (void)w;
+    (void)allow;
+#if defined(USE_DOT8_HW)
+    t.hw |= TINYFORMER_HW_DOT8;
+#endif
+#if defined(USE_GEMV_HW)
+    t.hw |= TINYFORMER_HW_GEMV;
+#endif
+#if defined(USE_EXP_LUT_HW)
+    t.hw |= TINYFORMER_HW_EXP_LUT;
+#endif
+#endif
+    if (out != 0) {
+        *out = t;
+    }
+}
+
+void tinyformer_autotune(const tinyformer_weights_t *w, tinyformer_tune_t *out)
+{
+    tf_autotune(w, TF_TUNE_FASTEST, out);
+}
+
+void tinyformer_select_backends(const tinyformer_weights_t *w, uint32_t hw, tinyformer_tune_t *out)
+{
+    tf_autotune(w, hw & (TINYFORMER_HW_DOT8 | TINYFORMER_HW_GEMV | TINYFORMER_HW_EXP_LUT), out);
+}
+
+int tinyformer_kernel_for(int32_t d_in, int32_t d_out)
+{
+#if TINYFORMER_AUTOTUNE
+    const tf_matvec_fn fn = tf_kernel_for(d_in, d_out);
+#if defined(USE_DOT8_HW)
+    if (fn == tf_mv_dot8) {
+        return TINYFORMER_KERNEL_DOT8;
+    }
+#endif
+#if defined(USE_GEMV_HW)
+    if (fn == tf_mv_gemv) {
+        return TINYFORMER_KERNEL_GEMV;
+    }
+#endif
+    (void)fn;
+    return TINYFORMER_KERNEL_CPU;
+#else
+    (void)d_in;
+    (void)d_out;
+    return -1;
+#endif
+}
+
+// --- Classifier heads -----------------------------------------------------
+
+// logits = head(mean‑pool(sum)): sum holds per‑channel sums over S tokens,
+// pooled with round half up and saturation (as demo_runner.c). Returns the
+// argmax; *margin (may be null) receives top‑1 minus runner‑up.
+static TINYFORMER_FAST_TEXT int tf_head_apply(
+    tf_scratch_t            *ws,
+    const tinyformer_head_t *head,
+    const int32_t           *sum,
+    int32_t                  S,
+    int32_t                  D,
+    int32_t                 *logits,
+    int32_t                 *margin)
+{
+    int8_t *pooled = ws->pooled;
+    int32_t d, c;
+    int best = 0;
+    int32_t second = INT32_MIN;
+
+    for (d = 0; d < D; ++d) {
+        pooled[d] = tf_sat8((sum[d] + S / 2) / S);
+    }
+
+#if defined(USE_GEMV_HW)
+    if (TF_ON_GEMV(D, head->n_classes)) {
+        gemv_matvec(head->W, pooled, head->b, logits, head->n_classes, D);
+    } else
+#endif
+    {
+        for (c = 0; c < head->n_classes; ++c) {
+            logits[c] = (int32_t)head->b[c] + dot_i8(&head->W[c * D], pooled, D);
+        }
+    }
+    for (c = 1; c < head->n_classes; ++c) {
+        if (logits[c] > logits[best]) {
+            second = logits[best];
+            best = (int)c;
+        } else if (logits[c] > second) {
+            second = logits[c];
+        }
+    }
+    if (margin != 0) {
+        *margin = (head->n_classes > 1) ? logits[best] - second : INT32_MAX;
+    }
+    TF_PROF_MARK(TINYFORMER_PROF_HEAD);
+    return best;
+}
+
+// Early‑exit check on tokens [S][D]: the class of ex->head if its margin is
+// reached (logits filled either way), else -1.
+static TINYFORMER_FAST_TEXT int tf_exit_check(
+    tf_scratch_t            *ws,
+    const tinyformer_exit_t *ex,
+    const int8_t            *tokens,
+    int32_t                  S,
+    int32_t                  D,
+    int32_t                 *logits)
+{
+    int32_t *sum = ws->exit_sum;
+    int32_t s, d, margin;
+    int label;
+
+    TF_PROF_START();
+    for (d = 0; d < D; ++d) {
+        sum[d] = 0;
+    }
+    for (s = 0; s < S; ++s) {
+        for (d = 0; d < D; ++d) {
+            sum[d] += tokens[s * D + d];
+        }
+    }
+    label = tf_head_apply(ws, &ex->head, sum, S, D, logits, &margin);
+    return (margin >= ex->margin) ? label : -1;
+}
+
+// --- Encoder block --------------------------------------------------------
+
+// Activation buffers of one encoder instance (see TINYFORMER_DEFINE), carved
+// out of a single arena by stage lifetime (X = block input, owned by caller):
+//   1 QKV proj : X -> q, k, v
+//   2 attention: q, k, v -> attn_out (context)
+//   3 out proj : attn_out -> q (projection), X + q -> attn_out (in place)
+//   4 FFN      : attn_out -> output (token‑streamed, residual included)
+// Every buffer is live through stage 3 and none afterwards:
+//   [ attn_out | q | k | v ]   4*S*D bytes = TINYFORMER_ARENA_BYTES
+// With TINYFORMER_FWA the keys are X itself, attention writes the context
+// over q (row i of q is last read before context row i is written) and the
+// out proj goes to attn_out, the residual then being added in place:
+//   [ attn_out | q | v ]       3*S*D bytes
+// Weight sets without W_qk keep their K in attn_out through stage 2.
+#if TINYFORMER_FWA
+#define TF_ARENA_ATTN_OUT(S, D, FFN)   0
+#define TF_ARENA_Q(S, D, FFN)          ((S) * (D))
+#define TF_ARENA_K(S, D, FFN)          0
+#define TF_ARENA_V(S, D, FFN)          (2 * (S) * (D))
+#define TF_ARENA_CTX(S, D, FFN)        TF_ARENA_Q(S, D, FFN)
+#define TF_ARENA_OPROJ(S, D, FFN)      TF_ARENA_ATTN_OUT(S, D, FFN)
+#else
+#define TF_ARENA_ATTN_OUT(S, D, FFN)   0
+#define TF_ARENA_Q(S, D, FFN)          ((S) * (D))
+#define TF_ARENA_K(S, D, FFN)          (2 * (S) * (D))
+#define TF_ARENA_V(S, D, FFN)          (3 * (S) * (D))
+#define TF_ARENA_CTX(S, D, FFN)        TF_ARENA_ATTN_OUT(S, D, FFN)
+#define TF_ARENA_OPROJ(S, D, FFN)      TF_ARENA_Q(S, D, FFN)
+#endif
+
+// Move rows [by, by + rows) of an [.][D] buffer to [0, rows).
+static TINYFORMER_FAST_TEXT void tf_shift_rows(
+    int8_t *buf, int32_t by, int32_t rows, int32_t D)
+{
+    int32_t i;
+    for (i = 0; i < rows * D; ++i) {
+        buf[i] = buf[i + by * D];
+    }
+}
+
+#if TINYFORMER_TOKEN_POOL
+// Token pooling of tinyformer_stack_encode_pooled(): for each group of k
+// adjacent rows of src ([n][D]; the last group may be shorter, m rows), one
+// row of dst with the rounded means floor((sum + m / 2) / m), computed on the
+// non‑negative sum + 128 m so the division truncates like a floor. Returns
+// the rows written, ceil(n / k).
+static int32_t tf_token_pool(
+    const int8_t *src, int8_t *dst, int32_t n, int32_t k, int32_t D)
+{
+    int32_t g, d, j;
+    for (g = 0; g * k < n; ++g) {
+        const int32_t m = (n - g * k < k) ? (n - g * k) : k;
+        const int8_t *row = &src[g * k * D];
+        for (d = 0; d < D; ++d) {
+            int32_t sum = 128 * m + m / 2;
+            for (j = 0; j < m; ++j) {
+                sum += row[j * D + d];
+            }
+            dst[g * D + d] = (int8_t)(sum / m - 128);
+        }
+    }
+    return g;
+}
+#endif
+
+// Clock‑gated blocks (GEMV_CLOCK_GATE, GEMM_CLOCK_GATE, ATTN_CLOCK_GATE; make
+// CLOCK_GATE=1): each driver call takes a clock reference of its own, so one
+// more around a tile makes its block wake once per pass instead of on every
+// call and stop again when the pass is done.
+static inline void tf_accel_power_get(void)
+{
+#if defined(USE_GEMV_HW) && GEMV_CLOCK_GATE
+    gemv_power_get();
+#endif
+#if defined(USE_GEMM_HW) && GEMM_CLOCK_GATE
+    gemm_power_get();
+#endif
+#if defined(USE_ATTN_HW) && ATTN_CLOCK_GATE
+    attn_power_get();
+#endif
+}
+
+static inline void tf_accel_power_put(void)
+{
+#if defined(USE_ATTN_HW) && ATTN_CLOCK_GATE
+    attn_power_put();
+#endif
+#if defined(USE_GEMM_HW) && GEMM_CLOCK_GATE
+    gemm_power_put();
+#endif
+#if defined(USE_GEMV_HW) && GEMV_CLOCK_GATE
+    gemv_power_put();
+#endif
+}
+
+// Encode a tile of n samples (n <= TINYFORMER_BATCH), sample i using
+// input[i*S*D], output[i*S*D] and arena[i*TINYFORMER_ARENA_BYTES]. Stages run
+// sample‑major inside each stage, so every weight matrix is streamed from
+// main_ram once per tile instead of once per sample.
+// pool != 0 (n == 1): output is not written; *pool is zeroed and the
+// FFN‑residual pass adds the output tokens into it instead (see ffn_apply). If pool->attn_exit fires
+// after stage 3 the FFN is skipped (pool->exit_label >= 0).
+// n_new < S (sliding window, n == 1): the first S - n_new input rows are the
+// previous window's last rows and arena 0 still holds their K/V, so K/V are
+// shifted up and projected only for the n_new new tokens (with TINYFORMER_FWA
+// only V is kept; K of a weight set without W_qk is projected for all rows).
+// rows != 0 (n == 1): the input rows are read in place from rows instead
+// (tinyformer_encode_view()); input is then rows->p0. Under TINYFORMER_FWA
+// rows must be contiguous for a W_qk weight set, whose keys are the input.
+// Forced inline so each TINYFORMER_DEFINE instance passes its own constant
+// S/D/FFN into the kernels.
+static inline __attribute__((always_inline)) void tf_encode_tile(
+    tf_scratch_t               *ws,
+    const tinyformer_weights_t *w,
+    const int8_t               *input,   // [n][S][D]
+    const tf_rows_t            *rows,    // 0, or the rows of a view (n == 1)
+    int8_t                     *output,  // [n][S][D]
+    int8_t                     *arena,   // [n][TINYFORMER_ARENA_BYTES]
+    int32_t                     n,
+    int32_t                     n_new,   // S, or new tokens of a slide (n == 1)
+    tinyformer_pool_t          *pool,    // 0, or pooled output (n == 1)
+    int32_t                     S,
+    int32_t                     D,
+    int32_t                     FFN)
+{
+    const int32_t arena_bytes = TINYFORMER_ARENA_BYTES(S, D, FFN);
+    const int32_t kv0 = S - n_new;  // first row whose K/V is projected
+    const int32_t d_in = (w->d_in > 0 && w->d_in < D) ? w->d_in : D;  // Q/K/V columns
+    int32_t oproj_done = 0;  // step 3 ran overlapped with step 2
+    int32_t i, s, d;
+    tf_rows_t xin;
+#if defined(TF_OVERLAP)
+    tf_overlap_t ov;
+#endif
+#if defined(TF_GEMV_DEVICES)
+    int qkv_dev = 0;  // Q/K/V ran on the GEMV instances
+#endif
+
+#define TF_SAMPLE_IN(i)   (&input[(i) * S * D])
+#define TF_SAMPLE_OUT(i)  (&output[(i) * S * D])
+#define TF_SAMPLE_BUF(i, which) (&arena[(i) * arena_bytes + TF_ARENA_##which(S, D, FFN)])
+// xin = the input rows of sample i.
+#define TF_SAMPLE_ROWS(i)                                                      \
+    do {                                                                       \
+        if (rows != 0) {                                                       \
+            xin = *rows;                                                       \
+        } else {                                                               \
+            xin.p0 = xin.p1 = TF_SAMPLE_IN(i);                                 \
+            xin.split = S;                                                     \
+            xin.stride = D;                                                    \
+        }                                                                      \
+    } while (0)
+
+
+    if (pool != 0) {
+        for (d = 0; d < D; ++d) {
+            pool->sum[d] = 0;
+        }
+        pool->cksum = 0;
+        pool->exit_label = -1;
+    }
+
+    TF_PROF_SAMPLES(n);
+    TF_PROF_START();
+
+    // 1. Linear projections: Q = X * W_q, K = X * W_k, V = X * W_v
+    //    (K/V only for rows kv0.. when sliding; Q always for all rows).
+    //    TINYFORMER_FWA: G = X * W_qk in place of Q, and no K.
+    if (kv0 > 0) {
+#if !TINYFORMER_FWA
+        tf_shift_rows(TF_SAMPLE_BUF(0, K), n_new, kv0, D);
+#endif
+        tf_shift_rows(TF_SAMPLE_BUF(0, V), n_new, kv0, D);
+    }
+#if TINYFORMER_FUSED_QKV
+    if (w->W_qkv != 0) {
+        for (i = 0; i < n; ++i) {
+            int32_t m;
+            TF_SAMPLE_ROWS(i);
+            // Old rows: Q only, from the first D rows of W_qkv.
+            if (kv0 > 0) {
+                TF_RNG_STAGE(TINYFORMER_RNG_Q);
+                linear_projection_rows(ws, &xin, 0, kv0, TF_SAMPLE_BUF(i, Q),
+                                       w->W_qkv, w->b_qkv, TF_RQ(w, TINYFORMER_RQ_QKV),
+                                       TF_SP(w, TINYFORMER_RQ_QKV), TF_LR(w, TINYFORMER_RQ_QKV),
+                                       D, d_in);
+            }
+            for (s = kv0; s < S; s += m) {
+                m = tf_rows_run(&xin, s, S - s);
+                qkv_projection_fused(ws, tf_row(&xin, s), xin.stride, TF_SAMPLE_BUF(i, Q) + s * D,
+                                     TF_SAMPLE_BUF(i, K) + s * D, TF_SAMPLE_BUF(i, V) + s * D,
+                                     w->W_qkv, w->b_qkv, TF_RQ(w, TINYFORMER_RQ_QKV),
+                                     TF_SP(w, TINYFORMER_RQ_QKV), TF_LR(w, TINYFORMER_RQ_QKV),
+                                     m, D, d_in);
+            }
+        }
+    } else
+#endif
+    {
+#if TINYFORMER_FWA
+        if (w->W_qk != 0) {
+            // Contiguous (see above): the keys are the input itself.
+            TF_RNG_STAGE(TINYFORMER_RNG_Q);
+            for (i = 0; i < n; ++i) {
+                TF_SAMPLE_ROWS(i);
+                fwa_projection_all(ws, xin.p0, xin.stride, TF_SAMPLE_BUF(i, Q), w->W_qk,
+                                   w->b_qk, w->qk_shift, S, D, d_in);
+            }
+        } else {
+            TF_RNG_STAGE(TINYFORMER_RNG_Q);
+            for (i = 0; i < n; ++i) {
+                TF_SAMPLE_ROWS(i);
+                linear_projection_rows(ws, &xin, 0, S, TF_SAMPLE_BUF(i, Q), w->W_q, w->b_q,
+                                       TF_RQ(w, TINYFORMER_RQ_Q), TF_SP(w, TINYFORMER_RQ_Q),
+                                       TF_LR(w, TINYFORMER_RQ_Q), D, d_in);
+            }
+            TF_RNG_STAGE(TINYFORMER_RNG_K);
+            for (i = 0; i < n; ++i) {
+                TF_SAMPLE_ROWS(i);
+                linear_projection_rows(ws, &xin, 0, S, TF_SAMPLE_BUF(i, K), w->W_k, w->b_k,
+                                       TF_RQ(w, TINYFORMER_RQ_K), TF_SP(w, TINYFORMER_RQ_K),
+                                       TF_LR(w, TINYFORMER_RQ_K), D, d_in);
+            }
+        }
+#else
+#if defined(TF_GEMV_DEVICES)
+        // Q, K and V side by side on the GEMV instances (whole windows only)
+        if (kv0 == 0) {
+            const tf_wword_t *const W3[3] = { w->W_q, w->W_k, w->W_v };
+            const int8_t *const b3[3] = { w->b_q, w->b_k, w->b_v };
+            const tinyformer_requant_t *const rq3[3] = {
+                TF_RQ(w, TINYFORMER_RQ_Q), TF_RQ(w, TINYFORMER_RQ_K), TF_RQ(w, TINYFORMER_RQ_V)
+            };
+            const int dense =
+                TF_SP(w, TINYFORMER_RQ_Q) == 0 && TF_SP(w, TINYFORMER_RQ_K) == 0 &&
+                TF_SP(w, TINYFORMER_RQ_V) == 0 && TF_LR(w, TINYFORMER_RQ_Q) == 0 &&
+                TF_LR(w, TINYFORMER_RQ_K) == 0 && TF_LR(w, TINYFORMER_RQ_V) == 0;
+            for (i = 0; i < n; ++i) {
+                int8_t *const dst3[3] = {
+                    TF_SAMPLE_BUF(i, Q), TF_SAMPLE_BUF(i, K), TF_SAMPLE_BUF(i, V)
+                };
+                TF_SAMPLE_ROWS(i);
+                qkv_dev = tf_gemv_qkv(ws, &xin, dst3, W3, b3, rq3, dense, S, D, d_in);
+                if (!qkv_dev) {
+                    break;  // same answer for every sample
+                }
+            }
+        }
+        if (!qkv_dev)
+#endif
+        {
+#if defined(TF_GEMV_W_BANKS)
+            tf_gemv_next_w(w, TINYFORMER_RQ_Q, TINYFORMER_RQ_K, D, FFN, d_in);
+#endif
+            TF_RNG_STAGE(TINYFORMER_RNG_Q);
+            for (i = 0; i < n; ++i) {
+                TF_SAMPLE_ROWS(i);
+                linear_projection_rows(ws, &xin, 0, S, TF_SAMPLE_BUF(i, Q), w->W_q, w->b_q,
+                                       TF_RQ(w, TINYFORMER_RQ_Q), TF_SP(w, TINYFORMER_RQ_Q),
+                                       TF_LR(w, TINYFORMER_RQ_Q), D, d_in);
+            }
+#if defined(TF_GEMV_W_BANKS)
+            tf_gemv_next_w(w, TINYFORMER_RQ_K, TINYFORMER_RQ_V, D, FFN, d_in);
+#endif
+            TF_RNG_STAGE(TINYFORMER_RNG_K);
+            for (i = 0; i < n; ++i) {
+                TF_SAMPLE_ROWS(i);
+                linear_projection_rows(ws, &xin, kv0, n_new, TF_SAMPLE_BUF(i, K) + kv0 * D,
+                                       w->W_k, w->b_k, TF_RQ(w, TINYFORMER_RQ_K),
+                                       TF_SP(w, TINYFORMER_RQ_K), TF_LR(w, TINYFORMER_RQ_K),
+                                       D, d_in);
+            }
+        }
+#endif
+#if defined(TF_GEMV_DEVICES)
+        if (!qkv_dev)
+#endif
+        {
+#if defined(TF_GEMV_W_BANKS)
+            tf_gemv_next_w(w, TINYFORMER_RQ_V, TINYFORMER_RQ_O, D, FFN, d_in);
+#endif
+            TF_RNG_STAGE(TINYFORMER_RNG_V);
+            for (i = 0; i < n; ++i) {
+                TF_SAMPLE_ROWS(i);
+                linear_projection_rows(ws, &xin, kv0, n_new, TF_SAMPLE_BUF(i, V) + kv0 * D,
+                                       w->W_v, w->b_v, TF_RQ(w, TINYFORMER_RQ_V),
+                                       TF_SP(w, TINYFORMER_RQ_V), TF_LR(w, TINYFORMER_RQ_V),
+                                       D, d_in);
+            }
+        }
+    }
+    TF_PROF_MARK(TINYFORMER_PROF_QKV);
+
+    // 2. Scaled dot‑product attention (streaming) to compute context,
+    //    warming W_o for step 3 one slice per query row.
+    //    TINYFORMER_OVERLAP: step 3 runs on the GEMV block row by row,
+    //    one query row behind the attention (see tf_overlap_t).
+#if TINYFORMER_PREFETCH
+    tf_warm_begin(ws, w->W_o, TF_W_BYTES(D, D), n * S * TINYFORMER_HEADS);
+#endif
+#if TINYFORMER_LINEAR_ATTN
+#define TF_ATTENTION_ROWS(i0, i1) \
+    attention_linear(ws, TF_SAMPLE_BUF(i, Q), keys, TF_SAMPLE_BUF(i, V), \
+                     TF_SAMPLE_BUF(i, CTX), i0, i1, S, D)
+#elif TINYFORMER_ONLINE_SOFTMAX
+#define TF_ATTENTION_ROWS(i0, i1) \
+    attention_online(ws, TF_SAMPLE_BUF(i, Q), ws->kT_buf, TF_SAMPLE_BUF(i, V), \
+                     TF_SAMPLE_BUF(i, CTX), i0, i1, S, D)
+#else
+#define TF_ATTENTION_ROWS(i0, i1) \
+    attention_multi_head(ws, TF_SAMPLE_BUF(i, Q), keys, TF_SAMPLE_BUF(i, V), \
+                         TF_SAMPLE_BUF(i, CTX), i0, i1, S, D)
+#endif
+    for (i = 0; i < n; ++i) {
+#if TINYFORMER_FWA
+        const int8_t *keys;
+        TF_SAMPLE_ROWS(i);
+        keys = (w->W_qk != 0) ? xin.p0 : TF_SAMPLE_BUF(i, K);
+#else
+        const int8_t *keys = TF_SAMPLE_BUF(i, K);
+        TF_SAMPLE_ROWS(i);
+#endif
+#if TINYFORMER_ONLINE_SOFTMAX
+        transpose_k(keys, ws->kT_buf, S, D);
+#endif
+#if defined(TF_OVERLAP)
+        // Not when the keys live in attn_out (TINYFORMER_FWA without W_qk):
+        // the block's rows would overwrite keys still to be scored.
+        oproj_done = keys != TF_SAMPLE_BUF(i, ATTN_OUT) &&
+                     tf_overlap_begin(&ov, w->W_o, w->b_o, TF_RQ(w, TINYFORMER_RQ_O),
+                                      TF_SP(w, TINYFORMER_RQ_O), TF_LR(w, TINYFORMER_RQ_O),
+                                      TF_SAMPLE_BUF(i, CTX), &xin,
+                                      TF_SAMPLE_BUF(i, ATTN_OUT), D);
+        if (oproj_done) {
+            for (s = 0; s < S; ++s) {
+                TF_ATTENTION_ROWS(s, s + 1);
+                tf_overlap_step(ws, &ov, s + 1);
+            }
+            tf_overlap_finish(ws, &ov);
+            continue;
+        }
+#endif
+        TF_ATTENTION_ROWS(0, S);
+    }
+#undef TF_ATTENTION_ROWS
+    TF_PROF_MARK(TINYFORMER_PROF_ATTN);
+
+    // 3. Output projection + residual:
     //      Y = X + (Attn(X) * W_o + b_o)
-    //    We reuse q_buf as a temporary for projected attention.
-    linear_projection_all(attn_out, q_buf, W_o, b_o);
-    for (s = 0; s < TINYFORMER_S; ++s) {
-        for (d = 0; d < TINYFORMER_D; ++d) {
-            int32_t acc = (int32_t)input[s][d] + (int32_t)q_buf[s][d];
-            attn_out[s][d] = saturate_int32_to_int8(acc);
+    //    We reuse q as a temporary for projected attention (TINYFORMER_FWA:
+    //    the context is in q and is projected into attn_out). Already done
+    //    under step 2 when overlapped.
+#if defined(TF_GEMV_W_BANKS)
+    tf_gemv_next_w(w, TINYFORMER_RQ_O, TINYFORMER_RQ_FF1, D, FFN, d_in);
+#endif
+    for (i = 0; i < n && !oproj_done; ++i) {
+        int8_t *proj = TF_SAMPLE_BUF(i, OPROJ);
+        int8_t *attn_out = TF_SAMPLE_BUF(i, ATTN_OUT);
+        TF_SAMPLE_ROWS(i);
+        TF_RNG_STAGE(TINYFORMER_RNG_O);
+        linear_projection_all(ws, TF_SAMPLE_BUF(i, CTX), D, proj, w->W_o, w->b_o,
+                              TF_RQ(w, TINYFORMER_RQ_O), TF_SP(w, TINYFORMER_RQ_O),
+                              TF_LR(w, TINYFORMER_RQ_O), S, D, D);
+        TF_RNG_STAGE(TINYFORMER_RNG_RES1);
+        for (s = 0; s < S; ++s) {
+            const int8_t *x = tf_row(&xin, s);
+            for (d = 0; d < D; ++d) {
+                int32_t acc = (int32_t)x[d] + (int32_t)proj[s * D + d];
+                attn_out[s * D + d] = saturate_int32_to_int8(acc);
+            }
+        }
+    }
+    TF_PROF_MARK(TINYFORMER_PROF_OPROJ);
+
+    // 3b. Early exit on the mean‑pooled Y (pool->attn_exit, n == 1).
+    if (pool != 0 && pool->attn_exit != 0) {
+        pool->exit_label = tf_exit_check(ws, pool->attn_exit, TF_SAMPLE_BUF(0, ATTN_OUT),
+                                         S, D, pool->logits);
+        if (pool->exit_label >= 0) {
+            return;
+        }
+    }
+
+    // 4. Feed‑forward network + residual:
+    //      Z = Y + FFN(Y)
+    //    With two W banks the tokens alternate between W_ff1 and W_ff2
+    //    without reloading either.
+#if defined(TF_GEMV_W_BANKS)
+    tf_gemv_next_w(w, TINYFORMER_RQ_FF1, TINYFORMER_RQ_FF2, D, FFN, d_in);
+#endif
+    for (i = 0; i < n; ++i) {
+        ffn_apply(ws, TF_SAMPLE_BUF(i, ATTN_OUT), TF_SAMPLE_OUT(i), pool, w, S, D, FFN);
+    }
+    TF_PROF_MARK(TINYFORMER_PROF_FFN);
+
+#undef TF_SAMPLE_ROWS
+#undef TF_SAMPLE_IN
+#undef TF_SAMPLE_OUT
+#undef TF_SAMPLE_BUF
+}
+
+#if TINYFORMER_TOKEN_POOL || TINYFORMER_MASKED
+// name##_tile_n runs the block of an instance on the first n_tok <= S tokens
+// (runtime count): the rows from n_tok on are neither read nor written.
+#define TF_DEFINE_TILE_N(name, S, D, FFN)                                      \
+    static TINYFORMER_FAST_TEXT __attribute__((noinline)) void name##_tile_n(  \
+        tf_scratch_t *ws, name##_state_t *st, const tinyformer_weights_t *w,   \
+        const int8_t *input, int8_t *output, int32_t n_tok)                    \
+    {                                                                          \
+        st->kv_w = 0;                                                          \
+        tf_accel_power_get();                                                  \
+        tf_encode_tile(ws, w, input, 0, output, &st->arena[0][0], 1, n_tok, 0, \
+                       n_tok, D, FFN);                                         \
+        tf_accel_power_put();                                                  \
+    }
+#else
+#define TF_DEFINE_TILE_N(name, S, D, FFN)
+#endif
+
+#if TINYFORMER_TOKEN_POOL
+// Pooled stack of an instance (name##_stack_pooled; TINYFORMER_DEFINE expands
+// this): name##_stack_pooled_on runs the stack, pooling into the ping‑pong
+// half the current tokens are not in and running shortened layers on
+// name##_tile_n. The schedule is checked before any layer runs.
+#define TF_DEFINE_POOLED(name, S, D, FFN)                                      \
+    static int name##_stack_pooled_on(                                         \
+        tf_scratch_t *ws, name##_state_t *st,                                  \
+        const tinyformer_weights_t *layers, int n_layers, const uint8_t *pool, \
+        const int8_t *input, int8_t *output)                                   \
+    {                                                                          \
+        const int8_t *src = input;                                             \
+        int32_t n = (S);                                                       \
+        int l, i;                                                              \
+        for (l = 0; l < n_layers; ++l) {                                       \
+            const int32_t k = (pool != 0) ? pool[l] : 1;                       \
+            if (k < 1) {                                                       \
+                return -1;                                                     \
+            }                                                                  \
+            n = (n + k - 1) / k;                                               \
+            if (TINYFORMER_ONLINE_SOFTMAX && n % TINYFORMER_ATTN_BLOCK != 0) { \
+                return -1;                                                     \
+            }                                                                  \
+        }                                                                      \
+        n = (S);                                                               \
+        if (n_layers <= 0) {                                                   \
+            for (i = 0; i < (S) * (D); ++i) {                                  \
+                output[i] = src[i];                                            \
+            }                                                                  \
+            return n;                                                          \
+        }                                                                      \
+        for (l = 0; l < n_layers; ++l) {                                       \
+            int8_t *dst;                                                       \
+            if (pool != 0 && pool[l] > 1) {                                    \
+                int8_t *pooled = st->pingpong[src == st->pingpong[0]];         \
+                n = tf_token_pool(src, pooled, n, pool[l], D);                 \
+                src = pooled;                                                  \
+            }                                                                  \
+            dst = (l == n_layers - 1) ? output                                 \
+                                      : st->pingpong[src == st->pingpong[0]];  \
+            if (n == (S)) {                                                    \
+                name##_tile(ws, st, &layers[l], src, dst, 1, S, 0);            \
+            } else {                                                           \
+                name##_tile_n(ws, st, &layers[l], src, dst, n);                \
+            }                                                                  \
+            src = dst;                                                         \
+        }                                                                      \
+        return n;                                                              \
+    }                                                                          \
+    int name##_stack_pooled(const tinyformer_weights_t *layers,                \
+                            int                         n_layers,              \
+                            const uint8_t              *pool,                  \
+                            const int8_t                input[S][D],           \
+                            int8_t                      output[S][D])          \
+    {                                                                          \
+        return name##_stack_pooled_on(&tf_scratch, &name##_state, layers,      \
+                                      n_layers, pool, &input[0][0],            \
+                                      &output[0][0]);                          \
+    }
+#else
+#define TF_DEFINE_POOLED(name, S, D, FFN)
+#endif
+
+#if TINYFORMER_MASKED
+// Padded window of an instance (name##_masked; TINYFORMER_DEFINE expands
+// this): the valid_tokens real rows run on name##_tile_n, so padded tokens
+// get no projections and are no keys (no scores, exp lookups or V sums);
+// their output rows are zeroed. valid_features is checked against the Q/K/V
+// columns the weight set reads (d_in), which is where dead inputs are
+// trimmed.
+#define TF_DEFINE_MASKED(name, S, D, FFN)                                      \
+    static int name##_masked_on(                                               \
+        tf_scratch_t *ws, name##_state_t *st, const tinyformer_weights_t *w,   \
+        const int8_t *input, int valid_tokens, int valid_features,             \
+        int8_t *output)                                                        \
+    {                                                                          \
+        const int32_t d_in = (w->d_in > 0 && w->d_in < (D)) ? w->d_in : (D);   \
+        int32_t i;                                                             \
+        if (valid_tokens < 1 || valid_tokens > (S) || valid_features < 1 ||    \
+            valid_features > d_in ||                                           \
+            (TINYFORMER_ONLINE_SOFTMAX &&                                      \
+             valid_tokens % TINYFORMER_ATTN_BLOCK != 0)) {                     \
+            return -1;                                                         \
+        }                                                                      \
+        if (valid_tokens == (S)) {                                             \
+            name##_tile(ws, st, w, input, output, 1, S, 0);                    \
+            return 0;                                                          \
+        }                                                                      \
+        name##_tile_n(ws, st, w, input, output, valid_tokens);                 \
+        for (i = valid_tokens * (D); i < (S) * (D); ++i) {                     \
+            output[i] = 0;                                                     \
+        }                                                                      \
+        return 0;                                                              \
+    }                                                                          \
+    int name##_masked(const tinyformer_weights_t *w,                           \
+                      const int8_t                input[S][D],                 \
+                      int                         valid_tokens,                \
+                      int                         valid_features,              \
+                      int8_t                      output[S][D])                \
+    {                                                                          \
+        return name##_masked_on(&tf_scratch, &name##_state, w, &input[0][0],   \
+                                valid_tokens, valid_features, &output[0][0]);  \
+    }
+#else
+#define TF_DEFINE_MASKED(name, S, D, FFN)
+#endif
+
+#if TINYFORMER_NOINIT_SCRATCH
+// name##_state is not cleared at boot: its kv_w (the only field read before
+// it is written, by name##_slide) is reset once, gated by a .bss flag.
+#define TF_STATE_READY_DECL(name) static uint8_t name##_state_ready;
+#define TF_STATE_READY(name)                                                   \
+    do {                                                                       \
+        if (!name##_state_ready) {                                             \
+            name##_state.kv_w = 0;                                             \
+            name##_state_ready = 1;                                            \
+        }                                                                      \
+    } while (0)
+#else
+#define TF_STATE_READY_DECL(name)
+#define TF_STATE_READY(name) ((void)0)
+#endif
+
+// Define one encoder instance: its state type, the static name##_state
+// (TINYFORMER_BATCH activation arenas, the stack ping‑pong buffers and the
+// slide K/V owner) and
+//   void name(const tinyformer_weights_t *w,
+//             const int8_t input[S][D], int8_t output[S][D]);
+//   void name##_stack(const tinyformer_weights_t *layers, int n_layers,
+//                     const int8_t input[S][D], int8_t output[S][D]);
+//   void name##_batch(const tinyformer_weights_t *w,
+//                     const int8_t inputs[][S][D], int8_t outputs[][S][D], int n);
+//   void name##_slide(const tinyformer_weights_t *w, const int8_t input[S][D],
+//                     int n_new, int8_t output[S][D]);
+//   void name##_pool(const tinyformer_weights_t *w, const int8_t input[S][D],
+//                    tinyformer_pool_t *pool);
+// which run on the shared tf_scratch and name##_state. The static
+// name##_tile / _slide_on / _stack_on / _batch_on take the scratch and state
+// explicitly; tinyformer_ctx_t workspaces pass their own (default shape).
+// name##_tile holds the one inlined copy of the block for the shape (plus
+// name##_tile_n, with runtime S, under TINYFORMER_TOKEN_POOL or
+// TINYFORMER_MASKED).
+// All layers of a stack run on the first arena; intermediate layer outputs
+// alternate between the two halves of pingpong. kv_w is the weight set whose
+// K/V for the last slide input are still in arena 0 (0: none; every other
+// entry point overwrites them).
+#define TINYFORMER_DEFINE(name, S, D, FFN)                                     \
+    _Static_assert((S) <= TINYFORMER_MAX_S && (D) <= TINYFORMER_MAX_D &&       \
+                   (FFN) <= TINYFORMER_MAX_FFN,                                \
+                   #name ": shape exceeds TINYFORMER_MAX_S/D/FFN");            \
+    _Static_assert((D) % 4 == 0 && (FFN) % 4 == 0,                             \
+                   #name ": D and FFN must be multiples of 4");                \
+    _Static_assert((D) % (4 * TINYFORMER_HEADS) == 0,                          \
+                   #name ": D / TINYFORMER_HEADS must be a multiple of 4");    \
+    _Static_assert(!TINYFORMER_INT4_WEIGHTS ||                                 \
+                   ((D) % 8 == 0 && (FFN) % 8 == 0),                           \
+                   #name ": int4 weights need D and FFN multiples of 8");      \
+    _Static_assert(!TINYFORMER_ONLINE_SOFTMAX ||                               \
+                   (S) % TINYFORMER_ATTN_BLOCK == 0,                           \
+                   #name ": S must be a multiple of TINYFORMER_ATTN_BLOCK");   \
+    typedef struct {                                                           \
+        int8_t arena[TINYFORMER_BATCH][TINYFORMER_ARENA_BYTES(S, D, FFN)]      \
+            __attribute__((aligned(4)));                                       \
+        int8_t pingpong[2][(S) * (D)] __attribute__((aligned(4)));             \
+        const tinyformer_weights_t *kv_w;                                      \
+    } name##_state_t;                                                          \
+    static name##_state_t name##_state TF_SCRATCH_DATA;                       \
+    TF_STATE_READY_DECL(name)                                                  \
+    static TINYFORMER_FAST_TEXT __attribute__((noinline)) void                 \
+    name##_tile_rows(                                                          \
+        tf_scratch_t *ws, name##_state_t *st, const tinyformer_weights_t *w,   \
+        const int8_t *input, const tf_rows_t *rows, int8_t *output,            \
+        int32_t n, int32_t n_new, tinyformer_pool_t *pool)                     \
+    {                                                                          \
+        st->kv_w = 0;                                                          \
+        tf_accel_power_get();                                                  \
+        tf_encode_tile(ws, w, input, rows, output, &st->arena[0][0], n,        \
+                       n_new, pool, S, D, FFN);                                \
+        tf_accel_power_put();                                                  \
+    }                                                                          \
+    static inline void name##_tile(                                            \
+        tf_scratch_t *ws, name##_state_t *st, const tinyformer_weights_t *w,   \
+        const int8_t *input, int8_t *output, int32_t n, int32_t n_new,         \
+        tinyformer_pool_t *pool)                                               \
+    {                                                                          \
+        name##_tile_rows(ws, st, w, input, 0, output, n, n_new, pool);         \
+    }                                                                          \
+    static void name##_slide_on(                                               \
+        tf_scratch_t *ws, name##_state_t *st, const tinyformer_weights_t *w,   \
+        const int8_t *input, const tf_rows_t *rows, int n_new,                 \
+        int8_t *output)                                                        \
+    {                                                                          \
+        if (w != st->kv_w || n_new < 1 || n_new > (S)) {                       \
+            n_new = (S);                                                       \
+        }                                                                      \
+        name##_tile_rows(ws, st, w, input, rows, output, 1, n_new, 0);         \
+        st->kv_w = w;                                                          \
+    }                                                                          \
+    static void name##_stack_on(                                               \
+        tf_scratch_t *ws, name##_state_t *st,                                  \
+        const tinyformer_weights_t *layers, tinyformer_layer_fn fetch,         \
+        void *user, int n_layers, const int8_t *input, int8_t *output)         \
+    {                                                                          \
+        const int8_t *src = input;                                             \
+        int l, i;                                                              \
+        if (n_layers <= 0) {                                                   \
+            for (i = 0; i < (S) * (D); ++i) {                                  \
+                output[i] = src[i];                                            \
+            }                                                                  \
+            return;                                                            \
+        }                                                                      \
+        for (l = 0; l < n_layers; ++l) {                                       \
+            int8_t *dst = (l == n_layers - 1) ? output : st->pingpong[l & 1];  \
+            const tinyformer_weights_t *w =                                    \
+                (fetch != 0) ? fetch(user, l) : &layers[l];                    \
+            name##_tile(ws, st, w, src, dst, 1, S, 0);                         \
+            src = dst;                                                         \
+        }                                                                      \
+    }                                                                          \
+    static void name##_batch_on(                                               \
+        tf_scratch_t *ws, name##_state_t *st, const tinyformer_weights_t *w,   \
+        const int8_t *inputs, int8_t *outputs, int n)                          \
+    {                                                                          \
+        int i;                                                                 \
+        for (i = 0; i < n; i += TINYFORMER_BATCH) {                            \
+            int m = (n - i < TINYFORMER_BATCH) ? (n - i) : TINYFORMER_BATCH;   \
+            name##_tile(ws, st, w, &inputs[i * (S) * (D)],                     \
+                        &outputs[i * (S) * (D)], m, S, 0);                     \
+        }                                                                      \
+    }                                                                          \
+    void name##_pool(const tinyformer_weights_t *w,                            \
+                     const int8_t                input[S][D],                  \
+                     tinyformer_pool_t          *pool)                         \
+    {                                                                          \
+        name##_tile(&tf_scratch, &name##_state, w, &input[0][0], 0, 1, S,      \
+                    pool);                                                     \
+    }                                                                          \
+    void name##_slide(const tinyformer_weights_t *w,                           \
+                      const int8_t                input[S][D],                 \
+                      int                         n_new,                       \
+                      int8_t                      output[S][D])                \
+    {                                                                          \
+        TF_STATE_READY(name);                                                  \
+        name##_slide_on(&tf_scratch, &name##_state, w, &input[0][0], 0, n_new, \
+                        &output[0][0]);                                        \
+    }                                                                          \
+    void name##_stack(const tinyformer_weights_t *layers,                      \
+                      int                         n_layers,                    \
+                      const int8_t                input[S][D],                 \
+                      int8_t                      output[S][D])                \
+    {                                                                          \
+        name##_stack_on(&tf_scratch, &name##_state, layers, 0, 0, n_layers,    \
+                        &input[0][0], &output[0][0]);                          \
+    }                                                                          \
+    void name##_batch(const tinyformer_weights_t *w,                           \
+                      const int8_t                inputs[][S][D],              \
+                      int8_t                      outputs[][S][D],             \
+                      int                         n)                           \
+    {                                                                          \
+        name##_batch_on(&tf_scratch, &name##_state, w, &inputs[0][0][0],       \
+                        &outputs[0][0][0], n);                                 \
+    }                                                                          \
+    void name(const tinyformer_weights_t *w,                                   \
+              const int8_t input[S][D],                                        \
+              int8_t       output[S][D])                                       \
+    {                                                                          \
+        name##_tile(&tf_scratch, &name##_state, w, &input[0][0],               \
+                    &output[0][0], 1, S, 0);                                   \
+    }                                                                          \
+    TF_DEFINE_TILE_N(name, S, D, FFN)                                          \
+    TF_DEFINE_POOLED(name, S, D, FFN)                                          \
+    TF_DEFINE_MASKED(name, S, D, FFN)
+
+// --- Public entry points --------------------------------------------------
+
+// Requant parameters exported alongside per‑channel (or int4) trained weights.
+#if TINYFORMER_INT4_WEIGHTS && defined(TRAINED_WEIGHTS_INT4)
+#define TF_RQ_ENTRY(l) { rq4_bias_##l, rq4_mul_##l, rq4_shift_##l }
+#elif !TINYFORMER_INT4_WEIGHTS && TINYFORMER_PER_CHANNEL_REQUANT && \
+    defined(TRAINED_WEIGHTS_PER_CHANNEL)
+#define TF_RQ_ENTRY(l) { rq_bias_##l, rq_mul_##l, rq_shift_##l }
+#endif
+
+#if defined(TF_RQ_ENTRY)
+static const tinyformer_requant_t default_rq[TINYFORMER_RQ_COUNT] = {
+    TF_RQ_ENTRY(q),
+    TF_RQ_ENTRY(k),
+    TF_RQ_ENTRY(v),
+    TF_RQ_ENTRY(o),
+    TF_RQ_ENTRY(ff1),
+    TF_RQ_ENTRY(ff2),
+#if TINYFORMER_FUSED_QKV
+    TF_RQ_ENTRY(qkv),
+#else
+    { 0, 0, 0 },
+#endif
+};
+#define TF_DEFAULT_RQ default_rq
+#else
+#define TF_DEFAULT_RQ 0
+#endif
+
+// Block‑sparse tables exported alongside the trained weights (--block-sparse).
+#if TINYFORMER_BLOCK_SPARSE && defined(TRAINED_WEIGHTS_BLOCK_SPARSE)
+#define TF_SP_ENTRY(l) { sp_row_##l, sp_block_##l, sp_w_##l }
+static const tinyformer_sparse_t default_sparse[TINYFORMER_RQ_COUNT] = {
+    TF_SP_ENTRY(q),
+    TF_SP_ENTRY(k),
+    TF_SP_ENTRY(v),
+    TF_SP_ENTRY(o),
+    TF_SP_ENTRY(ff1),
+    TF_SP_ENTRY(ff2),
+#if TINYFORMER_FUSED_QKV
+    TF_SP_ENTRY(qkv),
+#else
+    { 0, 0, 0 },
+#endif
+};
+#define TF_DEFAULT_SPARSE default_sparse
+#else
+#define TF_DEFAULT_SPARSE 0
+#endif
+
+// Low‑rank factors exported alongside the trained weights (--low-rank).
+#if TINYFORMER_LOW_RANK && defined(TRAINED_WEIGHTS_LOW_RANK)
+#define TF_LR_ENTRY(l) \
+    { TF_W(lr_v_##l), TF_W(lr_u_##l), TRAINED_WEIGHTS_LOW_RANK, TRAINED_WEIGHTS_LR_SHIFT_##l }
+static const tinyformer_lowrank_t default_lowrank[TINYFORMER_RQ_COUNT] = {
+    TF_LR_ENTRY(q),
+    TF_LR_ENTRY(k),
+    TF_LR_ENTRY(v),
+    TF_LR_ENTRY(o),
+    TF_LR_ENTRY(ff1),
+    TF_LR_ENTRY(ff2),
+#if TINYFORMER_FUSED_QKV
+    TF_LR_ENTRY(qkv),
+#else
+    { 0, 0, 0, 0 },
+#endif
+};
+#define TF_DEFAULT_LOWRANK default_lowrank
+#else
+#define TF_DEFAULT_LOWRANK 0
+#endif
+
+const tinyformer_weights_t tinyformer_default_weights = {
+    TF_W(W_q), TF_W(W_k), TF_W(W_v), TF_W(W_o),
+    TF_W(W_ff1), TF_W(W_ff2),
+    b_q, b_k, b_v, b_o, b_ff1, b_ff2,
+#if TINYFORMER_FUSED_QKV
+    TF_W(W_qkv), b_qkv,
+#else
+    0, 0,
+#endif
+    TF_DEFAULT_RQ,
+    TF_DEFAULT_SPARSE,
+    TF_DEFAULT_LOWRANK,
+#if defined(TRAINED_WEIGHTS_D_IN)
+    TRAINED_WEIGHTS_D_IN,
+#else
+    0,
+#endif
+#if TINYFORMER_FWA && defined(TRAINED_WEIGHTS_FWA)
+    TF_W(W_qk), b_qk, TRAINED_WEIGHTS_QK_SHIFT,
+#else
+    0, 0, 0,
+#endif
+#if TINYFORMER_FFN_GATHER && defined(TRAINED_WEIGHTS_FF2_COLS)
+    &W_ff2_cols[0][0],
+#else
+    0,
+#endif
+};
+
+TINYFORMER_DEFINE(tinyformer_encode_with,
+                  TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN)
+
+TINYFORMER_SHAPES(TINYFORMER_DEFINE)
+
+void tinyformer_encode(
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int8_t       output[TINYFORMER_S][TINYFORMER_D])
+{
+    tinyformer_encode_with(&tinyformer_default_weights, input, output);
+}
+
+void tinyformer_encode_slide(
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int          n_new,
+    int8_t       output[TINYFORMER_S][TINYFORMER_D])
+{
+    tinyformer_encode_with_slide(&tinyformer_default_weights, input, n_new, output);
+}
+
+#if TINYFORMER_SMP
+// Scratch of harts 1 ... TF_SMP_HARTS - 1 (hart 0 runs on tf_scratch).
+static tf_scratch_t tf_smp_scratch[TF_SMP_HARTS - 1] TF_SCRATCH_DATA;
+
+// Kernel scratch of hart.
+static inline tf_scratch_t *tf_smp_ws(int hart)
+{
+    return (hart == 0) ? &tf_scratch : &tf_smp_scratch[hart - 1];
+}
+
+typedef struct {
+    const tinyformer_weights_t *w;
+    const int8_t               *input;   // [S][D]
+    int8_t                     *output;  // [S][D]
+    int8_t                     *arena;   // TINYFORMER_ARENA_BYTES, shared
+} tf_smp_job_t;
+
+// Hart hart's share of one tinyformer_encode_smp_with() call: the stages of
+// tf_encode_tile() (n == 1, all rows new) on tokens / query rows [t0, t1).
+// Q/K/V rows are written by their owner only; after the barrier K/V are
+// read by every hart, while the context, out‑proj and residual rows of
+// [t0, t1) (over attn_out and q, see the arena layout) are private: q row i
+// is last read by the attention of query i.
+static TINYFORMER_FAST_TEXT void tf_smp_encode_share(void *arg, int hart)
+{
+    const tf_smp_job_t *job = (const tf_smp_job_t *)arg;
+    const tinyformer_weights_t *w = job->w;
+    tf_scratch_t *ws = tf_smp_ws(hart);
+    const int32_t S = TINYFORMER_S, D = TINYFORMER_D, FFN = TINYFORMER_FFN;
+    const int32_t t0 = hart * S / TF_SMP_HARTS;
+    const int32_t t1 = (hart + 1) * S / TF_SMP_HARTS;
+    const int32_t d_in = (w->d_in > 0 && w->d_in < D) ? w->d_in : D;
+    int8_t *q = &job->arena[TF_ARENA_Q(S, D, FFN)];
+    int8_t *k = &job->arena[TF_ARENA_K(S, D, FFN)];
+    int8_t *v = &job->arena[TF_ARENA_V(S, D, FFN)];
+    int8_t *ctx = &job->arena[TF_ARENA_CTX(S, D, FFN)];
+    int8_t *proj = &job->arena[TF_ARENA_OPROJ(S, D, FFN)];
+    int8_t *attn_out = &job->arena[TF_ARENA_ATTN_OUT(S, D, FFN)];
+    int32_t s, d;
+    tf_rows_t xin;
+
+    xin.p0 = xin.p1 = job->input;
+    xin.split = S;
+    xin.stride = D;
+    if (hart == 0) {
+        TF_PROF_SAMPLES(1);
+        TF_PROF_START();
+    }
+
+    // 1. Q/K/V of the own tokens.
+    if (t1 > t0) {
+        linear_projection_rows(ws, &xin, t0, t1 - t0, q + t0 * D, w->W_q, w->b_q,
+                               TF_RQ(w, TINYFORMER_RQ_Q), TF_SP(w, TINYFORMER_RQ_Q),
+                               TF_LR(w, TINYFORMER_RQ_Q), D, d_in);
+        linear_projection_rows(ws, &xin, t0, t1 - t0, k + t0 * D, w->W_k, w->b_k,
+                               TF_RQ(w, TINYFORMER_RQ_K), TF_SP(w, TINYFORMER_RQ_K),
+                               TF_LR(w, TINYFORMER_RQ_K), D, d_in);
+        linear_projection_rows(ws, &xin, t0, t1 - t0, v + t0 * D, w->W_v, w->b_v,
+                               TF_RQ(w, TINYFORMER_RQ_V), TF_SP(w, TINYFORMER_RQ_V),
+                               TF_LR(w, TINYFORMER_RQ_V), D, d_in);
+    }
+    tf_smp_barrier(hart);
+    if (hart == 0) {
+        TF_PROF_MARK(TINYFORMER_PROF_QKV);
+    }
+    if (t1 == t0) {
+        return;
+    }
+
+    // 2. Attention for the own query rows over all keys.
+#if TINYFORMER_ONLINE_SOFTMAX
+    transpose_k(k, ws->kT_buf, S, D);
+    attention_online(ws, q, ws->kT_buf, v, ctx, t0, t1, S, D);
+#else
+    attention_multi_head(ws, q, k, v, ctx, t0, t1, S, D);
+#endif
+    if (hart == 0) {
+        TF_PROF_MARK(TINYFORMER_PROF_ATTN);
+    }
+
+    // 3. Output projection + residual of the own rows.
+    linear_projection_all(ws, ctx + t0 * D, D, proj + t0 * D, w->W_o, w->b_o,
+                          TF_RQ(w, TINYFORMER_RQ_O), TF_SP(w, TINYFORMER_RQ_O),
+                          TF_LR(w, TINYFORMER_RQ_O), t1 - t0, D, D);
+    for (s = t0; s < t1; ++s) {
+        for (d = 0; d < D; ++d) {
+            int32_t acc = (int32_t)job->input[s * D + d] + (int32_t)proj[s * D + d];
+            attn_out[s * D + d] = saturate_int32_to_int8(acc);
         }
     }
+    if (hart == 0) {
+        TF_PROF_MARK(TINYFORMER_PROF_OPROJ);
+    }
 
-    // 4. Feed‑forward network + residual:
-    //      Z = Y + FFN(Y)
-    ffn_apply(attn_out, ffn_hidden, ffn_out);
+    // 4. FFN + residual of the own rows.
+    ffn_apply(ws, attn_out + t0 * D, job->output + t0 * D, 0, w, t1 - t0, D, FFN);
+    if (hart == 0) {
+        TF_PROF_MARK(TINYFORMER_PROF_FFN);
+    }
+}
+
+void tinyformer_encode_smp_with(
+    const tinyformer_weights_t *w,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_smp_job_t job;
+
+    job.w = w;
+    job.input = &input[0][0];
+    job.output = &output[0][0];
+    job.arena = &tinyformer_encode_with_state.arena[0][0];
+    tinyformer_encode_with_state.kv_w = 0;
+    tf_smp_run(tf_smp_encode_share, &job);
+}
+
+void tinyformer_encode_smp(
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int8_t       output[TINYFORMER_S][TINYFORMER_D])
+{
+    tinyformer_encode_smp_with(&tinyformer_default_weights, input, output);
+}
+#endif
+
+#if TINYFORMER_MASKED
+int tinyformer_encode_masked(
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int          valid_tokens,
+    int          valid_features,
+    int8_t       output[TINYFORMER_S][TINYFORMER_D])
+{
+    return tinyformer_encode_with_masked(&tinyformer_default_weights, input, valid_tokens,
+                                         valid_features, output);
+}
+#endif
+
+int tinyformer_classify(
+    const tinyformer_head_t *head,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum)
+{
+    return tinyformer_classify_early(head, 0, 0, input, logits, cksum, 0);
+}
+
+int tinyformer_head_apply(
+    const tinyformer_head_t *head,
+    const tinyformer_pool_t *pool,
+    int32_t                  S,
+    int32_t                  D,
+    int32_t                 *logits)
+{
+    TF_PROF_START();
+    return tf_head_apply(&tf_scratch, head, pool->sum, S, D, logits, 0);
+}
+
+// tinyformer_classify_early() with weights w on scratch ws, default‑shape
+// state st and pool.
+static int tf_classify(
+    tf_scratch_t                   *ws,
+    tinyformer_encode_with_state_t *st,
+    tinyformer_pool_t              *pool,
+    const tinyformer_weights_t     *w,
+    const tinyformer_head_t        *head,
+    const tinyformer_exit_t        *exit_in,
+    const tinyformer_exit_t        *exit_attn,
+    const int8_t                   *input,
+    int32_t                        *logits,
+    uint32_t                       *cksum,
+    int                            *exit_stage)
+{
+    int stage = TINYFORMER_EXIT_NONE;
+    int label = -1;
+
+    if (exit_in != 0) {
+        label = tf_exit_check(ws, exit_in, input, TINYFORMER_S, TINYFORMER_D, logits);
+        stage = TINYFORMER_EXIT_INPUT;
+    }
+    if (label < 0) {
+        pool->attn_exit = exit_attn;
+        pool->logits = logits;
+        tinyformer_encode_with_tile(ws, st, w, input, 0, 1, TINYFORMER_S, pool);
+        label = pool->exit_label;
+        stage = TINYFORMER_EXIT_ATTN;
+    }
+    if (label < 0) {
+        if (cksum != 0) {
+            *cksum = pool->cksum;
+        }
+        TF_PROF_START();
+        label = tf_head_apply(ws, head, pool->sum, TINYFORMER_S, TINYFORMER_D, logits, 0);
+        stage = TINYFORMER_EXIT_NONE;
+    }
+    if (exit_stage != 0) {
+        *exit_stage = stage;
+    }
+    return label;
+}
+
+// tinyformer_classify_heads() with weights w on scratch ws, default‑shape
+// state st and pool (rows: see tf_encode_tile()).
+static int tf_classify_heads(
+    tf_scratch_t                   *ws,
+    tinyformer_encode_with_state_t *st,
+    tinyformer_pool_t              *pool,
+    const tinyformer_weights_t     *w,
+    const tinyformer_head_t        *heads,
+    int                             n_heads,
+    const int8_t                   *input,
+    const tf_rows_t                *rows,
+    int32_t                        *logits,
+    int                            *labels,
+    uint32_t                       *cksum)
+{
+    int h;
+
+    pool->attn_exit = 0;
+    pool->logits = logits;
+    tinyformer_encode_with_tile_rows(ws, st, w, input, rows, 0, 1, TINYFORMER_S, pool);
+    if (cksum != 0) {
+        *cksum = pool->cksum;
+    }
+    TF_PROF_START();
+    for (h = 0; h < n_heads; ++h) {
+        labels[h] = tf_head_apply(ws, &heads[h], pool->sum, TINYFORMER_S, TINYFORMER_D,
+                                  logits, 0);
+        logits += heads[h].n_classes;
+    }
+    return labels[0];
+}
+
+int tinyformer_classify_heads(
+    const tinyformer_head_t *heads,
+    int                      n_heads,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    int                     *labels,
+    uint32_t                *cksum)
+{
+    static tinyformer_pool_t pool;
+
+    return tf_classify_heads(&tf_scratch, &tinyformer_encode_with_state, &pool,
+                             &tinyformer_default_weights, heads, n_heads, &input[0][0], 0,
+                             logits, labels, cksum);
+}
+
+// Rows x of view in (default shape) for weights w. A TINYFORMER_FWA W_qk
+// set needs its input contiguous: a wrapped or strided view is copied to
+// flat ([S][D]). Returns 0, or -1 for an invalid view.
+static int tf_view_rows(
+    const tinyformer_input_t   *in,
+    const tinyformer_weights_t *w,
+    int8_t                     *flat,
+    tf_rows_t                  *x)
+{
+    if (in == 0 || in->base == 0 || ((uintptr_t)in->base & 3u) != 0 ||
+        in->stride < TINYFORMER_D || (in->stride & 3) != 0 || in->rows < TINYFORMER_S ||
+        in->first < 0 || in->first >= in->rows) {
+        return -1;
+    }
+    x->p0 = &in->base[in->first * in->stride];
+    x->p1 = in->base;
+    x->split = in->rows - in->first;
+    if (x->split > TINYFORMER_S) {
+        x->split = TINYFORMER_S;
+    }
+    x->stride = in->stride;
+#if TINYFORMER_FWA
+    if (w->W_qk != 0 && (x->split < TINYFORMER_S || x->stride != TINYFORMER_D)) {
+        int32_t s, d;
+        for (s = 0; s < TINYFORMER_S; ++s) {
+            const int8_t *row = tf_row(x, s);
+            for (d = 0; d < TINYFORMER_D; ++d) {
+                flat[s * TINYFORMER_D + d] = row[d];
+            }
+        }
+        x->p0 = x->p1 = flat;
+        x->split = TINYFORMER_S;
+        x->stride = TINYFORMER_D;
+    }
+#else
+    (void)w;
+    (void)flat;
+#endif
+    return 0;
+}
+
+int tinyformer_encode_view(
+    const tinyformer_input_t *in,
+    int                       n_new,
+    int8_t                    output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_rows_t x;
+
+    if (tf_view_rows(in, &tinyformer_default_weights,
+                     tinyformer_encode_with_state.pingpong[0], &x) != 0) {
+        return -1;
+    }
+    TF_STATE_READY(tinyformer_encode_with);
+    tinyformer_encode_with_slide_on(&tf_scratch, &tinyformer_encode_with_state,
+                                    &tinyformer_default_weights, x.p0, &x, n_new,
+                                    &output[0][0]);
+    return 0;
+}
+
+int tinyformer_classify_view(
+    const tinyformer_head_t  *head,
+    const tinyformer_input_t *in,
+    int32_t                  *logits,
+    uint32_t                 *cksum)
+{
+    static tinyformer_pool_t pool;
+    tf_rows_t x;
+    int label;
+
+    if (tf_view_rows(in, &tinyformer_default_weights,
+                     tinyformer_encode_with_state.pingpong[0], &x) != 0) {
+        return -1;
+    }
+    return tf_classify_heads(&tf_scratch, &tinyformer_encode_with_state, &pool,
+                             &tinyformer_default_weights, head, 1, x.p0, &x, logits, &label,
+                             cksum);
+}
+
+#if TINYFORMER_SMP
+// Steps 1 and 2 of tf_encode_tile() (n == 1) on the state of
+// tinyformer_encode_with(), with the context written to st->ctx.
+int tinyformer_encode_front(
+    const tinyformer_input_t *in,
+    int                       n_new,
+    tinyformer_stage_t       *st)
+{
+    const tinyformer_weights_t *w = &tinyformer_default_weights;
+    tinyformer_encode_with_state_t *es = &tinyformer_encode_with_state;
+    const int32_t S = TINYFORMER_S, D = TINYFORMER_D;
+    const int32_t d_in = (w->d_in > 0 && w->d_in < D) ? w->d_in : D;
+    int8_t *q = &es->arena[0][TF_ARENA_Q(S, D, TINYFORMER_FFN)];
+    int8_t *k = &es->arena[0][TF_ARENA_K(S, D, TINYFORMER_FFN)];
+    int8_t *v = &es->arena[0][TF_ARENA_V(S, D, TINYFORMER_FFN)];
+    int32_t kv0, s, d;
+    tf_rows_t x;
+
+    if (tf_view_rows(in, w, es->pingpong[0], &x) != 0) {
+        return -1;
+    }
+    TF_STATE_READY(tinyformer_encode_with);
+    if (w != es->kv_w || n_new < 1 || n_new > S) {
+        n_new = S;
+    }
+    kv0 = S - n_new;
+    if (kv0 > 0) {
+        tf_shift_rows(k, n_new, kv0, D);
+        tf_shift_rows(v, n_new, kv0, D);
+    }
+    linear_projection_rows(&tf_scratch, &x, 0, S, q, w->W_q, w->b_q, TF_RQ(w, TINYFORMER_RQ_Q),
+                           TF_SP(w, TINYFORMER_RQ_Q), TF_LR(w, TINYFORMER_RQ_Q), D, d_in);
+    linear_projection_rows(&tf_scratch, &x, kv0, n_new, k + kv0 * D, w->W_k, w->b_k,
+                           TF_RQ(w, TINYFORMER_RQ_K), TF_SP(w, TINYFORMER_RQ_K),
+                           TF_LR(w, TINYFORMER_RQ_K), D, d_in);
+    linear_projection_rows(&tf_scratch, &x, kv0, n_new, v + kv0 * D, w->W_v, w->b_v,
+                           TF_RQ(w, TINYFORMER_RQ_V), TF_SP(w, TINYFORMER_RQ_V),
+                           TF_LR(w, TINYFORMER_RQ_V), D, d_in);
+    es->kv_w = w;
+#if TINYFORMER_ONLINE_SOFTMAX
+    transpose_k(k, tf_scratch.kT_buf, S, D);
+    attention_online(&tf_scratch, q, tf_scratch.kT_buf, v, &st->ctx[0][0], 0, S, S, D);
+#else
+    attention_multi_head(&tf_scratch, q, k, v, &st->ctx[0][0], 0, S, S, D);
+#endif
+    for (s = 0; s < S; ++s) {
+        const int8_t *row = tf_row(&x, s);
+        for (d = 0; d < D; ++d) {
+            st->x[s][d] = row[d];
+        }
+    }
+    return 0;
+}
+
+// Steps 3 and 4 of tf_encode_tile() into a pool, then the head.
+int tinyformer_classify_back(
+    int                      hart,
+    const tinyformer_head_t *head,
+    tinyformer_stage_t      *st,
+    int32_t                 *logits,
+    uint32_t                *cksum)
+{
+    const tinyformer_weights_t *w = &tinyformer_default_weights;
+    tf_scratch_t *ws = tf_smp_ws(hart);
+    const int32_t S = TINYFORMER_S, D = TINYFORMER_D, FFN = TINYFORMER_FFN;
+    tinyformer_pool_t pool;
+    int32_t s, d;
+
+    linear_projection_all(ws, &st->ctx[0][0], D, &st->y[0][0], w->W_o, w->b_o,
+                          TF_RQ(w, TINYFORMER_RQ_O), TF_SP(w, TINYFORMER_RQ_O),
+                          TF_LR(w, TINYFORMER_RQ_O), S, D, D);
+    for (s = 0; s < S; ++s) {
+        for (d = 0; d < D; ++d) {
+            st->y[s][d] = saturate_int32_to_int8((int32_t)st->x[s][d] + (int32_t)st->y[s][d]);
+        }
+    }
+    for (d = 0; d < D; ++d) {
+        pool.sum[d] = 0;
+    }
+    pool.cksum = 0;
+    pool.attn_exit = 0;
+    pool.logits = logits;
+    pool.exit_label = -1;
+    ffn_apply(ws, &st->y[0][0], 0, &pool, w, S, D, FFN);
+    if (cksum != 0) {
+        *cksum = pool.cksum;
+    }
+    return tf_head_apply(ws, head, pool.sum, S, D, logits, 0);
+}
+#endif
+
+int tinyformer_classify_early(
+    const tinyformer_head_t *head,
+    const tinyformer_exit_t *exit_in,
+    const tinyformer_exit_t *exit_attn,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum,
+    int                     *exit_stage)
+{
+    static tinyformer_pool_t pool;
+
+    return tf_classify(&tf_scratch, &tinyformer_encode_with_state, &pool,
+                       &tinyformer_default_weights, head, exit_in, exit_attn,
+                       &input[0][0], logits, cksum, exit_stage);
+}
+
+void tinyformer_stack_encode(
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D])
+{
+    tinyformer_encode_with_stack(layers, n_layers, input, output);
+}
+
+void tinyformer_stack_encode_src(
+    tinyformer_layer_fn fetch,
+    void               *user,
+    int                 n_layers,
+    const int8_t        input[TINYFORMER_S][TINYFORMER_D],
+    int8_t              output[TINYFORMER_S][TINYFORMER_D])
+{
+    tinyformer_encode_with_stack_on(&tf_scratch, &tinyformer_encode_with_state, 0, fetch,
+                                    user, n_layers, &input[0][0], &output[0][0]);
+}
 
-    for (s = 0; s < TINYFORMER_S; ++s) {
-        for (d = 0; d < TINYFORMER_D; ++d) {
-            int32_t acc = (int32_t)attn_out[s][d] + (int32_t)ffn_out[s][d];
-            output[s][d] = saturate_int32_to_int8(acc);
+#if TINYFORMER_SHARED_LAYERS
+void tinyformer_share_layers(
+    tinyformer_weights_t          *layers,
+    int                            n_layers,
+    const tinyformer_weights_t    *base,
+    const tinyformer_layer_bias_t *own)
+{
+    int l;
+    for (l = 0; l < n_layers; ++l) {
+        tinyformer_weights_t *w = &layers[l];
+        *w = *base;
+        if (own == 0) {
+            continue;
         }
+#define TF_OWN(field) if (own[l].field) w->field = own[l].field
+        TF_OWN(b_q);
+        TF_OWN(b_k);
+        TF_OWN(b_v);
+        TF_OWN(b_o);
+        TF_OWN(b_ff1);
+        TF_OWN(b_ff2);
+        TF_OWN(b_qkv);
+        TF_OWN(b_qk);
+        TF_OWN(rq);
+#undef TF_OWN
+    }
+}
+#endif
+
+#if TINYFORMER_TOKEN_POOL
+int tinyformer_stack_encode_pooled(
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const uint8_t              *pool,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D])
+{
+    return tinyformer_encode_with_stack_pooled(layers, n_layers, pool, input, output);
+}
+#endif
+
+void tinyformer_encode_batch(
+    const int8_t inputs[][TINYFORMER_S][TINYFORMER_D],
+    int8_t       outputs[][TINYFORMER_S][TINYFORMER_D],
+    int          n)
+{
+    tinyformer_encode_with_batch(&tinyformer_default_weights, inputs, outputs, n);
+}
+
+// --- Context API ----------------------------------------------------------
+
+// Layout of a tinyformer_ctx_t workspace: kernel scratch, default‑shape
+// instance state (arenas, ping‑pong, slide K/V owner) and pooled output.
+typedef struct {
+    tf_scratch_t                   scratch;
+    tinyformer_encode_with_state_t state;
+    tinyformer_pool_t              pool;
+} tf_workspace_t;
+
+_Static_assert(sizeof(tf_workspace_t) <= TINYFORMER_WORKSPACE_BYTES,
+               "TINYFORMER_WORKSPACE_BYTES is below the workspace size");
+
+#define TF_CTX_WS(ctx) ((tf_workspace_t *)(ctx)->ws)
+
+uint32_t tinyformer_workspace_size(void)
+{
+    return (uint32_t)sizeof(tf_workspace_t);
+}
+
+int tinyformer_ctx_init(tinyformer_ctx_t *ctx, void *workspace, uint32_t bytes)
+{
+    ctx->weights = &tinyformer_default_weights;
+    if (workspace == 0 || bytes < (uint32_t)sizeof(tf_workspace_t) ||
+        ((uintptr_t)workspace & (_Alignof(tf_workspace_t) - 1u)) != 0) {
+        ctx->ws = 0;
+        return -1;
+    }
+    ctx->ws = workspace;
+    TF_CTX_WS(ctx)->state.kv_w = 0;
+    return 0;
+}
+
+void tinyformer_encode_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      input[TINYFORMER_S][TINYFORMER_D],
+    int8_t            output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    tinyformer_encode_with_tile(&ws->scratch, &ws->state, ctx->weights, &input[0][0],
+                                &output[0][0], 1, TINYFORMER_S, 0);
+}
+
+void tinyformer_encode_slide_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      input[TINYFORMER_S][TINYFORMER_D],
+    int               n_new,
+    int8_t            output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    tinyformer_encode_with_slide_on(&ws->scratch, &ws->state, ctx->weights, &input[0][0], 0,
+                                    n_new, &output[0][0]);
+}
+
+#if TINYFORMER_MASKED
+int tinyformer_encode_masked_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      input[TINYFORMER_S][TINYFORMER_D],
+    int               valid_tokens,
+    int               valid_features,
+    int8_t            output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    return tinyformer_encode_with_masked_on(&ws->scratch, &ws->state, ctx->weights,
+                                            &input[0][0], valid_tokens, valid_features,
+                                            &output[0][0]);
+}
+#endif
+
+int tinyformer_classify_ctx(
+    tinyformer_ctx_t        *ctx,
+    const tinyformer_head_t *head,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum)
+{
+    return tinyformer_classify_early_ctx(ctx, head, 0, 0, input, logits, cksum, 0);
+}
+
+int tinyformer_classify_heads_ctx(
+    tinyformer_ctx_t        *ctx,
+    const tinyformer_head_t *heads,
+    int                      n_heads,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    int                     *labels,
+    uint32_t                *cksum)
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    return tf_classify_heads(&ws->scratch, &ws->state, &ws->pool, ctx->weights, heads, n_heads,
+                             &input[0][0], 0, logits, labels, cksum);
+}
+
+int tinyformer_encode_view_ctx(
+    tinyformer_ctx_t         *ctx,
+    const tinyformer_input_t *in,
+    int                       n_new,
+    int8_t                    output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+    tf_rows_t x;
+
+    if (tf_view_rows(in, ctx->weights, ws->state.pingpong[0], &x) != 0) {
+        return -1;
+    }
+    tinyformer_encode_with_slide_on(&ws->scratch, &ws->state, ctx->weights, x.p0, &x, n_new,
+                                    &output[0][0]);
+    return 0;
+}
+
+int tinyformer_classify_view_ctx(
+    tinyformer_ctx_t         *ctx,
+    const tinyformer_head_t  *head,
+    const tinyformer_input_t *in,
+    int32_t                  *logits,
+    uint32_t                 *cksum)
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+    tf_rows_t x;
+    int label;
+
+    if (tf_view_rows(in, ctx->weights, ws->state.pingpong[0], &x) != 0) {
+        return -1;
     }
+    return tf_classify_heads(&ws->scratch, &ws->state, &ws->pool, ctx->weights, head, 1, x.p0,
+                             &x, logits, &label, cksum);
+}
+
+int tinyformer_classify_early_ctx(
+    tinyformer_ctx_t        *ctx,
+    const tinyformer_head_t *head,
+    const tinyformer_exit_t *exit_in,
+    const tinyformer_exit_t *exit_attn,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum,
+    int                     *exit_stage)
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    return tf_classify(&ws->scratch, &ws->state, &ws->pool, ctx->weights, head, exit_in,
+                       exit_attn, &input[0][0], logits, cksum, exit_stage);
+}
+
+void tinyformer_stack_encode_ctx(
+    tinyformer_ctx_t           *ctx,
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    tinyformer_encode_with_stack_on(&ws->scratch, &ws->state, layers, 0, 0, n_layers,
+                                    &input[0][0], &output[0][0]);
+}
+
+void tinyformer_stack_encode_src_ctx(
+    tinyformer_ctx_t   *ctx,
+    tinyformer_layer_fn fetch,
+    void               *user,
+    int                 n_layers,
+    const int8_t        input[TINYFORMER_S][TINYFORMER_D],
+    int8_t              output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    tinyformer_encode_with_stack_on(&ws->scratch, &ws->state, 0, fetch, user, n_layers,
+                                    &input[0][0], &output[0][0]);
+}
+
+#if TINYFORMER_TOKEN_POOL
+int tinyformer_stack_encode_pooled_ctx(
+    tinyformer_ctx_t           *ctx,
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const uint8_t              *pool,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D])
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    return tinyformer_encode_with_stack_pooled_on(&ws->scratch, &ws->state, layers, n_layers,
+                                                  pool, &input[0][0], &output[0][0]);
+}
+#endif
+
+void tinyformer_encode_batch_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      inputs[][TINYFORMER_S][TINYFORMER_D],
+    int8_t            outputs[][TINYFORMER_S][TINYFORMER_D],
+    int               n)
+{
+    tf_workspace_t *ws = TF_CTX_WS(ctx);
+
+    tinyformer_encode_with_batch_on(&ws->scratch, &ws->state, ctx->weights,
+                                    &inputs[0][0][0], &outputs[0][0][0], n);
 }
 
+#define TF_INSTANCE_BYTES_X(name, S, D, FFN) + TINYFORMER_INSTANCE_BYTES(S, D, FFN)
+
+void tinyformer_sram_usage(tinyformer_sram_t *out)
+{
+    uint32_t scratch = (uint32_t)sizeof(tf_scratch_t);
+#if TINYFORMER_SMP
+    scratch += (uint32_t)sizeof(tf_smp_scratch);
+#endif
+    out->arena = TINYFORMER_BATCH *
+                 TINYFORMER_ARENA_BYTES(TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN);
+    out->pingpong = 2u * TINYFORMER_S * TINYFORMER_D;
+    out->instances = TINYFORMER_INSTANCE_BYTES(TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN)
+                     TINYFORMER_SHAPES(TF_INSTANCE_BYTES_X);
+    out->scratch = scratch;
+    out->total = out->instances + scratch;
+}
@@ -3,7 +3,9 @@
 //
 // Sequence length: S = 16
 // Model dimension: D = 32
-// Single attention head, int8 weights/activations, int32 accumulators.
+// TINYFORMER_HEADS attention heads (default 1), int8 weights/activations,
+// int32 accumulators.
+// Extra fixed shapes can be compiled in via tinyformer_shapes.h.
 
 #ifndef TINYFORMER_H
 #define TINYFORMER_H
@@ -15,6 +17,814 @@
 #define TINYFORMER_D   32
 #define TINYFORMER_FFN 64
 
+// --- Weight storage ---
+// TINYFORMER_PACKED_WEIGHTS=1: the encoder reads word‑packed copies of the
+// weight matrices (W_q_packed, ...), 4 int8 lanes per uint32_t in dot8_pack()
+// lane order, so the DOT8 path needs no byte shuffling per MAC group.
+// Defaults to on for DOT8 builds (except TINYFORMER_AUTOTUNE ones, which may
+// run without DOT8) and with TINYFORMER_GEMV_NATIVE; override with
+// -DTINYFORMER_PACKED_WEIGHTS=0.
+#ifndef TINYFORMER_PACKED_WEIGHTS
+#if (defined(USE_DOT8_HW) && !TINYFORMER_AUTOTUNE) || TINYFORMER_GEMV_NATIVE
+#define TINYFORMER_PACKED_WEIGHTS 1
+#else
+#define TINYFORMER_PACKED_WEIGHTS 0
+#endif
+#endif
+
+// TINYFORMER_INT4_WEIGHTS=1: the encoder reads 4‑bit copies of the weight
+// matrices (W_q_int4, ..., exported with --int4): uint32 words [D_out][D_in / 8]
+// where byte k of word j holds W[8j+k] in its low nibble and W[8j+k+4] in its
+// high nibble. (w << 4) & 0xF0F0F0F0 and w & 0xF0F0F0F0 are then two DOT8
+// operands holding 16*W against the ordinary 4‑lane input words, so unpacking
+// costs a shift and two ANDs per 8 weights. Halves weight bytes vs int8.
+// int4 needs per‑channel scales, so this implies TINYFORMER_PER_CHANNEL_REQUANT
+// (rq4_* parameters). GEMV takes int8 rows only and is bypassed.
+// D and FFN must be multiples of 8.
+#ifndef TINYFORMER_INT4_WEIGHTS
+#define TINYFORMER_INT4_WEIGHTS 0
+#endif
+
+// TINYFORMER_GEMV_NATIVE=1 (with USE_GEMV_HW): the GEMV path loads the
+// compiled‑in weights in the block's own layouts (exported with
+// --gemv-native), so no weight is converted at run time: the int32 biases
+// gemv_b_* go to B_IN as they are, matrices of the block's shapes stream
+// their word‑packed copies (W_*_packed, one W_IN4 write per word) and the
+// others, e.g. W_q/W_k/W_v narrowed to TRAINED_WEIGHTS_D_IN columns, their
+// pre‑tiled words gemv_w_* through gemv_matvec_tiles() instead of being
+// padded and packed tile by tile. Weight sets without these layouts (model
+// blobs, shared‑layer biases) keep the converting loads. Implies
+// TINYFORMER_PACKED_WEIGHTS; needs GEMV_PACKED_WRITES. Bit‑identical.
+// Default 0.
+#ifndef TINYFORMER_GEMV_NATIVE
+#define TINYFORMER_GEMV_NATIVE 0
+#endif
+#if TINYFORMER_GEMV_NATIVE && (TINYFORMER_INT4_WEIGHTS || !TINYFORMER_PACKED_WEIGHTS)
+#error "TINYFORMER_GEMV_NATIVE streams the int8 packed copies; drop TINYFORMER_INT4_WEIGHTS, keep TINYFORMER_PACKED_WEIGHTS"
+#endif
+
+// TINYFORMER_DOT8_BLOCKED=1 (default): packed matvecs (Q/K/V/O, FFN1, FFN2)
+// use the 4x1 register‑blocked dot8_matvec_4x1() kernel; 0 selects the plain
+// one‑row‑at‑a‑time DOT8 loop. Only meaningful with packed weights.
+#ifndef TINYFORMER_DOT8_BLOCKED
+#define TINYFORMER_DOT8_BLOCKED 1
+#endif
+
+// TINYFORMER_DOT8_SIMD=1 (with USE_DOT8_HW): the int8 saturations, the fixed
+// >> 7 requant, the packed FFN1 ReLU and the softmax max scan use the Dot8Plugin
+// SAT8 / PACK2.SAT / MAX4 / MAX instructions (dot8.h). Bit‑exact, so ENC_CKSUM
+// is unchanged; the CPU needs a Dot8Plugin with funct7 0x0A..0x0E.
+#ifndef TINYFORMER_DOT8_SIMD
+#define TINYFORMER_DOT8_SIMD 0
+#endif
+
+// TINYFORMER_FUSED_QKV=1: Q/K/V are produced in one pass over the input tokens
+// from the concatenated W_qkv[3D][D] / b_qkv[3D] block emitted by the exporter,
+// so each input token is read once instead of three times. Bit‑identical.
+#ifndef TINYFORMER_FUSED_QKV
+#define TINYFORMER_FUSED_QKV 0
+#endif
+
+// TINYFORMER_FWA=1: fused‑weight attention. The exporter (--fwa) folds the
+// query and key projections into one bilinear form, W_qk = W_k^T W_q and
+// b_qk = W_k^T b_q over the d_in input channels, requantized by 2^qk_shift,
+// and a score is g_i . x_j against the block input itself with
+//   g_i = sat((W_qk x_i + b_qk) >> qk_shift)
+// so the K projection and its [S][D] buffer go (TINYFORMER_ARENA_BYTES is
+// 3*S*D). Approximate: the terms of b_k add one constant per query row, which
+// the softmax cancels, and W_qk is rounded once instead of q and k, so
+// ENC_CKSUM can differ from baseline. Weight sets without W_qk (weight store,
+// model blobs) run the separate K projection, bit‑identical. int8 weights
+// only; not with TINYFORMER_FUSED_QKV. Default 0.
+#ifndef TINYFORMER_FWA
+#define TINYFORMER_FWA 0
+#endif
+#if TINYFORMER_FWA && TINYFORMER_INT4_WEIGHTS
+#error "TINYFORMER_FWA folds int8 Q/K weights; drop TINYFORMER_INT4_WEIGHTS"
+#endif
+#if TINYFORMER_FWA && TINYFORMER_FUSED_QKV
+#error "TINYFORMER_FWA has no K projection to fuse; drop TINYFORMER_FUSED_QKV"
+#endif
+
+// TINYFORMER_HEADS=H: multi‑head attention. Q, K, V and the context split
+// into H heads of head_dim = D / H channels (a multiple of 4, so a head is
+// whole DOT8 words); each head runs its own score, softmax and context pass
+// over the shared scores/exp scratch, one head after the other, while the
+// projections and W_o stay [D][D]. The model must be trained with the same
+// head count (train_tinyformer_uci_har.py --heads). Not with TINYFORMER_FWA
+// (one bilinear form per block). Default 1 (single head).
+#ifndef TINYFORMER_HEADS
+#define TINYFORMER_HEADS 1
+#endif
+#if TINYFORMER_HEADS > 1 && TINYFORMER_FWA
+#error "TINYFORMER_FWA folds a single head; drop TINYFORMER_HEADS"
+#endif
+
+// TINYFORMER_SCORE_SHIFT: right shift of the q.k scores before the softmax,
+// the integer 1/sqrt(head_dim) temperature. 5 for the single 32‑wide head;
+// multi‑head defaults to 4 (head_dim 8: 1/sqrt(8) is twice 1/sqrt(32)).
+// Must match the training (train_tinyformer_uci_har.py uses the same rule).
+#ifndef TINYFORMER_SCORE_SHIFT
+#if TINYFORMER_HEADS > 1
+#define TINYFORMER_SCORE_SHIFT 4
+#else
+#define TINYFORMER_SCORE_SHIFT 5
+#endif
+#endif
+
+// TINYFORMER_FAST_SOFTMAX=1: normalize softmax weights with one reciprocal per
+// query and a multiply per key instead of one division per key. Weights may be
+// 1 LSB (Q15) lower than the exact path, so ENC_CKSUM can differ from baseline.
+// Default 0 (bit‑exact; the division is still hoisted out of the V loop).
+#ifndef TINYFORMER_FAST_SOFTMAX
+#define TINYFORMER_FAST_SOFTMAX 0
+#endif
+
+// TINYFORMER_EXP_INTERP=1: the softmax exp keeps the 3 bits that the >> 3
+// compress used to drop as a fraction and interpolates linearly between
+// adjacent exp LUT entries (Q10, 8 steps per unit of the exponent), so close
+// scores no longer collapse onto one entry. Works with both softmax variants
+// and USE_EXP_LUT_HW (scalar interpolating register, not the row mode); not
+// with USE_SOFTMAX_HW. ENC_CKSUM differs from baseline. Default 0.
+#ifndef TINYFORMER_EXP_INTERP
+#define TINYFORMER_EXP_INTERP 0
+#endif
+
+// TINYFORMER_EXP2_SOFTMAX=1: shift‑only base‑2 softmax, no exp LUT. The
+// max‑subtracted score t (>> 3 compressed, times log2(e) as a shift‑add)
+// gives e = 2^(15 - n) with n clamped to [0, 15], the row sum is rounded to
+// a power of two, and each weight is kept as the shift of 2^15 / sum: the
+// context adds V >> shift per key, without a multiply or a divide. Two‑pass
+// CPU softmax only: not with TINYFORMER_ONLINE_SOFTMAX, USE_SOFTMAX_HW,
+// USE_EXP_LUT_HW, TINYFORMER_EXP_INTERP, TINYFORMER_FAST_SOFTMAX or
+// TINYFORMER_LINEAR_ATTN. ENC_CKSUM differs from baseline; the accuracy cost
+// is measured with tools/tinyformer_sim.py --exp2-softmax. Default 0.
+#ifndef TINYFORMER_EXP2_SOFTMAX
+#define TINYFORMER_EXP2_SOFTMAX 0
+#endif
+#if TINYFORMER_EXP2_SOFTMAX && \
+    (TINYFORMER_ONLINE_SOFTMAX || defined(USE_SOFTMAX_HW) || defined(USE_EXP_LUT_HW))
+#error "TINYFORMER_EXP2_SOFTMAX has no exp LUT: drop TINYFORMER_ONLINE_SOFTMAX, USE_SOFTMAX_HW and USE_EXP_LUT_HW"
+#endif
+#if TINYFORMER_EXP2_SOFTMAX && (TINYFORMER_EXP_INTERP || TINYFORMER_FAST_SOFTMAX)
+#error "TINYFORMER_EXP2_SOFTMAX replaces the LUT exp and the Q15 normalize: drop TINYFORMER_EXP_INTERP and TINYFORMER_FAST_SOFTMAX"
+#endif
+
+// TINYFORMER_SPARSE_SOFTMAX=1: the context sums only over the keys whose Q15
+// weight is at least TINYFORMER_SPARSE_MIN_W (default 256: smaller weights
+// move the context by less than 1 LSB), and with TINYFORMER_SPARSE_TOPK = k
+// > 0 only over the k largest of them (ties: the lower key). Each query
+// builds the index list of its kept keys once, and the context accumulates
+// the w * V products in int32 with one >> 15 at the end instead of one per
+// term. Two‑pass softmax (CPU or USE_SOFTMAX_HW); not with
+// TINYFORMER_ONLINE_SOFTMAX, TINYFORMER_EXP2_SOFTMAX or
+// TINYFORMER_LINEAR_ATTN. ENC_CKSUM differs from baseline; modelled by
+// tools/tinyformer_sim.py --sparse-softmax (--sparse-min-w, --sparse-topk).
+// Default 0.
+#ifndef TINYFORMER_SPARSE_SOFTMAX
+#define TINYFORMER_SPARSE_SOFTMAX 0
+#endif
+#ifndef TINYFORMER_SPARSE_MIN_W
+#define TINYFORMER_SPARSE_MIN_W 256
+#endif
+#ifndef TINYFORMER_SPARSE_TOPK
+#define TINYFORMER_SPARSE_TOPK 0
+#endif
+#if TINYFORMER_SPARSE_SOFTMAX && (TINYFORMER_ONLINE_SOFTMAX || TINYFORMER_EXP2_SOFTMAX)
+#error "TINYFORMER_SPARSE_SOFTMAX selects keys from a Q15 weight row: drop TINYFORMER_ONLINE_SOFTMAX and TINYFORMER_EXP2_SOFTMAX"
+#endif
+#if TINYFORMER_SPARSE_TOPK < 0 || TINYFORMER_SPARSE_MIN_W < 0 || TINYFORMER_SPARSE_MIN_W > 32768
+#error "TINYFORMER_SPARSE_TOPK must be >= 0 and TINYFORMER_SPARSE_MIN_W in [0, 32768]"
+#endif
+
+// TINYFORMER_ONLINE_SOFTMAX=1: one‑pass (flash‑attention style) attention.
+// K is stored transposed ([D][S]) so scores for a block of keys are read
+// sequentially; a running max/sum rescales the context accumulators with the
+// same exp LUT, so no per‑query scores/exp buffers over S are needed. The
+// rescale is approximate: ENC_CKSUM differs from the two‑pass path. Default 0.
+#ifndef TINYFORMER_ONLINE_SOFTMAX
+#define TINYFORMER_ONLINE_SOFTMAX 0
+#endif
+
+// TINYFORMER_CAUSAL=1: causal attention, query i attends to keys j <= i only.
+// The masked keys are skipped, not masked after scoring: no score, exp or
+// context work is done for j > i, which about halves the attention MACs.
+// Works with both softmax variants and the softmax / exp LUT units; the
+// sliding‑window K/V of tinyformer_encode_slide is unchanged. For models
+// trained causally; ENC_CKSUM differs from baseline. Default 0.
+#ifndef TINYFORMER_CAUSAL
+#define TINYFORMER_CAUSAL 0
+#endif
+
+// TINYFORMER_LINEAR_ATTN=1: linear (kernelized) attention with a ReLU feature
+// map, context = relu(Q) (relu(K)^T V) / relu(Q) sum_j relu(K_j), from int32
+// running K^T V and normalizer sums in the kernel scratch. Cost O(S * D^2 /
+// TINYFORMER_HEADS) instead of O(S^2 * D); no scores or exp buffers, so long
+// windows (S = 100..200) fit. With TINYFORMER_CAUSAL the sums grow key by key
+// with the queries. No softmax: not with TINYFORMER_ONLINE_SOFTMAX,
+// USE_SOFTMAX_HW or USE_EXP_LUT_HW, nor TINYFORMER_FWA. For models trained with
+// train_tinyformer_uci_har.py --linear-attn; ENC_CKSUM differs from baseline.
+// Default 0.
+#ifndef TINYFORMER_LINEAR_ATTN
+#define TINYFORMER_LINEAR_ATTN 0
+#endif
+
+// TINYFORMER_PER_CHANNEL_REQUANT=1: layers whose weight set carries requant
+// parameters (tinyformer_weights_t.rq, exported with --per-channel) requantize
+// each output channel with an accumulator‑domain bias and a rounding
+// multiply‑shift, out = sat(round((acc + bias[c]) * mul[c] / 2^shift[c])),
+// instead of sat((acc + b[c]) >> 7). Weight sets without rq keep the >> 7.
+#ifndef TINYFORMER_PER_CHANNEL_REQUANT
+#define TINYFORMER_PER_CHANNEL_REQUANT TINYFORMER_INT4_WEIGHTS
+#endif
+#if TINYFORMER_INT4_WEIGHTS && !TINYFORMER_PER_CHANNEL_REQUANT
+#error "TINYFORMER_INT4_WEIGHTS requires TINYFORMER_PER_CHANNEL_REQUANT"
+#endif
+
+// TINYFORMER_FFN_U8_HIDDEN=1: the FFN hidden activations (ReLU outputs) are
+// kept as uint8 at half the int8 step, one bit more than the [0, 127] of the
+// int8 ReLU over the same range. FF1 requantizes with one bit less of shift
+// and clips to [0, 255]; W_ff2 runs as a u8 x s8 matvec (DOT8U.MAC8 with
+// USE_DOT8_HW, as pulp_nn_linear_u8_i8_i8 on PULP) whose bias and requant
+// shift absorb the factor 2. Same weights and requant parameters; ENC_CKSUM
+// differs from baseline. GEMV takes signed X, so W_ff2 bypasses it. Default 0.
+#ifndef TINYFORMER_FFN_U8_HIDDEN
+#define TINYFORMER_FFN_U8_HIDDEN 0
+#endif
+
+// TINYFORMER_BLOCK_SPARSE=1: layers whose weight set carries a block‑sparse
+// table (tinyformer_weights_t.sparse, exported with --block-sparse) skip the
+// all‑zero 4‑wide blocks of each row: the surviving blocks are listed per row
+// with their input block index and run through DOT8 against the packed input
+// words (dead input channels pruned with --dead-inputs drop out whole). The
+// dense matrices stay the fallback of layers without a table. Bit‑identical.
+// Bypasses GEMV for those layers; int8 only (not with int4), and W_ff2 stays
+// dense with TINYFORMER_FFN_U8_HIDDEN. Default 0.
+#ifndef TINYFORMER_BLOCK_SPARSE
+#define TINYFORMER_BLOCK_SPARSE 0
+#endif
+#if TINYFORMER_BLOCK_SPARSE && TINYFORMER_INT4_WEIGHTS
+#error "TINYFORMER_BLOCK_SPARSE tables hold int8 blocks; drop TINYFORMER_INT4_WEIGHTS"
+#endif
+
+// TINYFORMER_LOW_RANK=1: layers whose weight set carries rank‑r factors
+// (tinyformer_weights_t.lowrank, exported with --low-rank R) run W x as two
+// thin matvecs, t = sat8((V x) >> shift) into an int8 bottleneck of r
+// channels, then U t + b with the layer's usual requant: r * (D_in + D_out)
+// MACs instead of D_in * D_out. Each pass takes the dense path of its shape
+// (GEMV, DOT8 packed words or the CPU loop). An approximation of W: ENC_CKSUM
+// differs from baseline (tinyformer_sim.py --low-rank measures the accuracy).
+// int8 only (not with int4), and W_ff2 stays dense with
+// TINYFORMER_FFN_U8_HIDDEN. Default 0.
+#ifndef TINYFORMER_LOW_RANK
+#define TINYFORMER_LOW_RANK 0
+#endif
+#if TINYFORMER_LOW_RANK && TINYFORMER_INT4_WEIGHTS
+#error "TINYFORMER_LOW_RANK factors are int8; drop TINYFORMER_INT4_WEIGHTS"
+#endif
+
+// TINYFORMER_FFN_GATHER=1: W_ff2 skips the hidden units that the FF1 ReLU
+// zeroed. The ReLU lists the non‑zero units of each token, and W_ff2 runs
+// as a sum over their columns only, acc += h[k] * W_ff2[:, k], read from the
+// column‑major copy W_ff2_cols ([FFN][D], tinyformer_weights_t.W_ff2_cols,
+// exported with --ff2-cols): L live units cost L * D MACs instead of
+// FFN * D. Runs on the CPU in place of the DOT8 / GEMV matvec of W_ff2;
+// weight sets without the copy (model blobs, tier students) keep it.
+// Bit‑identical. int8 only (not with int4). Default 0.
+#ifndef TINYFORMER_FFN_GATHER
+#define TINYFORMER_FFN_GATHER 0
+#endif
+#if TINYFORMER_FFN_GATHER && TINYFORMER_INT4_WEIGHTS
+#error "TINYFORMER_FFN_GATHER reads int8 W_ff2 columns; drop TINYFORMER_INT4_WEIGHTS"
+#endif
+
+// TINYFORMER_SHARED_LAYERS=1: cross‑layer weight sharing (ALBERT‑style).
+// tinyformer_share_layers() fills the descriptors of a stack whose layers
+// all point at one set of matrices (with its sparse / low‑rank tables), each
+// layer optionally keeping its own biases and requant (tinyformer_layer_bias_t,
+// exported with --shared-layers from train_tinyformer_uci_har.py
+// --share-layers). Every layer then walks the same weight working set, which
+// stays in the D‑cache across layers, and the model stores one copy of the
+// matrices. The GEMV path also tracks the bias loaded with a resident W, so a
+// W shared under another bias reloads just the biases. Default 0.
+#ifndef TINYFORMER_SHARED_LAYERS
+#define TINYFORMER_SHARED_LAYERS 0
+#endif
+
+// TINYFORMER_BATCH: samples encoded together by the *_batch entry points.
+// Each stage runs over the whole tile before the next, so every weight matrix
+// is fetched from main_ram once per tile; costs one activation arena
+// (TINYFORMER_ARENA_BYTES) of SRAM per sample. Default 1 (no extra SRAM;
+// batch calls then encode one sample at a time).
+#ifndef TINYFORMER_BATCH
+#define TINYFORMER_BATCH 1
+#endif
+
+// TINYFORMER_TOKEN_POOL=1: tinyformer_stack_encode_pooled() and its *_ctx()
+// variant, stacks whose layers can average groups of adjacent tokens first,
+// so later layers run on S/2, S/4, ... tokens (attention cost falls
+// quadratically, the projections and FFN linearly). Compiles one more copy
+// of the block per instance, with a runtime token count. For stacks trained
+// with train_tinyformer_uci_har.py --token-pool. Default 0.
+#ifndef TINYFORMER_TOKEN_POOL
+#define TINYFORMER_TOKEN_POOL 0
+#endif
+
+// TINYFORMER_MASKED=1: tinyformer_encode_masked() and its *_ctx() variant,
+// for windows shorter than S (e.g. at session boundaries): only the valid
+// tokens are projected and attended to, so a partial window costs about its
+// share of a full one. Compiles one more copy of the block per instance (the
+// one of TINYFORMER_TOKEN_POOL, if also set). Default 0.
+#ifndef TINYFORMER_MASKED
+#define TINYFORMER_MASKED 0
+#endif
+
+// Keys processed per online‑softmax block (TINYFORMER_S must be a multiple).
+#ifndef TINYFORMER_ATTN_BLOCK
+#define TINYFORMER_ATTN_BLOCK 4
+#endif
+
+// Host replay builds: dot products and the attention context use AVX2,
+// SSE4.1 or NEON (whichever the compiler targets, see tinyformer_simd.h),
+// bit‑identical to the scalar loops. Not for RV32; ignored with USE_DOT8_HW
+// and TINYFORMER_PACKED_WEIGHTS / TINYFORMER_INT4_WEIGHTS kernels.
+#ifndef TINYFORMER_HOST_SIMD
+#define TINYFORMER_HOST_SIMD 0
+#endif
+
+// Per‑stage profiling: cycle and retired‑instruction counters (the cycle /
+// instret CSRs, see cycle_counter.h) around each encoder stage and the
+// classifier heads, accumulated across calls (tinyformer_profile_read).
+// With USE_PERFMON_HW the perfmon event counters are snapshotted at the same
+// marks (cache refills, bus wait states, CSR accesses, GEMV busy).
+// Off by default: the counter reads are not free.
+#ifndef TINYFORMER_PROFILE
+#define TINYFORMER_PROFILE 0
+#endif
+
+// TINYFORMER_LATENCY=1 (with TINYFORMER_PROFILE): every profiled stage also
+// lands in a log2‑bucketed cycle histogram, one per stage plus one for whole
+// calls (tinyformer_latency_record()), for tail percentiles at constant
+// memory (tinyformer_latency_read()). Default 0.
+#ifndef TINYFORMER_LATENCY
+#define TINYFORMER_LATENCY 0
+#endif
+#if TINYFORMER_LATENCY && !TINYFORMER_PROFILE
+#error "TINYFORMER_LATENCY needs TINYFORMER_PROFILE"
+#endif
+
+// TINYFORMER_RANGE_STATS=1: instrumentation build that counts, per encoder
+// stage, the values that reach an int8 clip, the clipped ones and the range
+// of the value before the clip (tinyformer_range_read()), to pick shifts and
+// narrower types from data. Counts are taken in the CPU requant, so the
+// saturating DOT8 / GEMV requant shortcuts and the SMP harts are excluded.
+// Default 0.
+#ifndef TINYFORMER_RANGE_STATS
+#define TINYFORMER_RANGE_STATS 0
+#endif
+
+// TINYFORMER_TRACE=1 (tf_trace.h): the same stage marks, with or without
+// TINYFORMER_PROFILE, are also events in the per‑hart trace ring.
+
+// TINYFORMER_FAST_SECTIONS=1: the encoder inner loops go to .fast_text, the
+// kernel scratch and activation arenas to .fast_data and the weight set the
+// kernels read (see TINYFORMER_WEIGHTS) to .weights. linker.ld places them
+// (make FAST_MEM=sram|rom) and crt0.S copies them there at boot, so the hot
+// path does not run out of SDRAM through the caches. Default 0: ordinary
+// .text / .bss / .rodata.
+#ifndef TINYFORMER_FAST_SECTIONS
+#define TINYFORMER_FAST_SECTIONS 0
+#endif
+
+#if TINYFORMER_FAST_SECTIONS
+#define TINYFORMER_FAST_TEXT __attribute__((section(".fast_text")))
+#define TINYFORMER_FAST_DATA __attribute__((section(".fast_data")))
+#define TF_WEIGHTS_PREFIX    ".weights."
+#else
+#define TINYFORMER_FAST_TEXT
+#define TINYFORMER_FAST_DATA
+#define TF_WEIGHTS_PREFIX    ".rodata.tfw."
+#endif
+
+// TINYFORMER_NOINIT_SCRATCH=1: the kernel scratch and the activation arenas
+// (the static ones, and workspaces tagged TINYFORMER_NOINIT) go to .noinit,
+// which crt0.S neither loads nor clears, so boot does not spend cycles
+// zeroing buffers the encoder always writes before it reads them. The slide
+// K/V owner is reset on first use. Takes precedence over .fast_data (both
+// are SRAM). Default 0: .bss / .fast_data.
+#ifndef TINYFORMER_NOINIT_SCRATCH
+#define TINYFORMER_NOINIT_SCRATCH 0
+#endif
+
+#if TINYFORMER_NOINIT_SCRATCH
+#define TINYFORMER_NOINIT    __attribute__((section(".noinit")))
+#else
+#define TINYFORMER_NOINIT
+#endif
+
+// Placement of one exported weight array (trained_weights.c):
+// TINYFORMER_WEIGHTS(kind, layer), kind I8 | PACKED | INT4 | VEC | RQ | RQ4 |
+// SPARSE | COLS. Arrays the kernels read (the active matrix format, the bias
+// / LUT vectors, the active requant set, the block‑sparse tables and, with
+// TINYFORMER_FFN_GATHER, W_ff2_cols) go to
+// TF_WEIGHTS_PREFIX<n>, n the position of layer in the encoder's read order.
+// linker.ld sorts these sections by name, so the weight set is one contiguous
+// run in consumption order (GCC alone emits it in reverse) and the D‑cache
+// refills stream through SDRAM bursts.
+// The other formats stay in ordinary .rodata.
+#define TINYFORMER_WEIGHTS(kind, layer) TF_WEIGHTS_##kind(TF_WSEQ_##layer)
+#define TF_WEIGHTS_ON(n)  TF_WEIGHTS_ON_(n)
+#define TF_WEIGHTS_ON_(n) __attribute__((section(TF_WEIGHTS_PREFIX #n)))
+#define TF_WEIGHTS_OFF(n)
+#define TF_WEIGHTS_VEC TF_WEIGHTS_ON
+#define TF_WEIGHTS_SPARSE TF_WEIGHTS_ON
+#if TINYFORMER_FFN_GATHER
+#define TF_WEIGHTS_COLS   TF_WEIGHTS_ON
+#else
+#define TF_WEIGHTS_COLS   TF_WEIGHTS_OFF
+#endif
+#if TINYFORMER_INT4_WEIGHTS
+#define TF_WEIGHTS_INT4   TF_WEIGHTS_ON
+#define TF_WEIGHTS_PACKED TF_WEIGHTS_OFF
+#define TF_WEIGHTS_I8     TF_WEIGHTS_OFF
+#define TF_WEIGHTS_RQ     TF_WEIGHTS_OFF
+#define TF_WEIGHTS_RQ4    TF_WEIGHTS_ON
+#elif TINYFORMER_PACKED_WEIGHTS
+#define TF_WEIGHTS_INT4   TF_WEIGHTS_OFF
+#define TF_WEIGHTS_PACKED TF_WEIGHTS_ON
+#define TF_WEIGHTS_I8     TF_WEIGHTS_OFF
+#define TF_WEIGHTS_RQ     TF_WEIGHTS_ON
+#define TF_WEIGHTS_RQ4    TF_WEIGHTS_OFF
+#else
+#define TF_WEIGHTS_INT4   TF_WEIGHTS_OFF
+#define TF_WEIGHTS_PACKED TF_WEIGHTS_OFF
+#define TF_WEIGHTS_I8     TF_WEIGHTS_ON
+#define TF_WEIGHTS_RQ     TF_WEIGHTS_ON
+#define TF_WEIGHTS_RQ4    TF_WEIGHTS_OFF
+#endif
+
+// Read order: shared vectors, Q/K/V (the fused block when it is built; the
+// separate projections are then only a fallback and go last; W_qk of
+// TINYFORMER_FWA takes the place of W_q and W_k), the softmax
+// LUT, W_o, W_ff1, W_ff2. Bias and requant vectors sit with their matrix.
+#define TF_WSEQ_shared 0
+#define TF_WSEQ_qkv    1
+#define TF_WSEQ_qk     1
+#define TF_WSEQ_attn   4
+#define TF_WSEQ_o      5
+#define TF_WSEQ_ff1    6
+#define TF_WSEQ_ff2    7
+#if TINYFORMER_FUSED_QKV
+#define TF_WSEQ_q      8
+#define TF_WSEQ_k      8
+#define TF_WSEQ_v      8
+#else
+#define TF_WSEQ_q      1
+#define TF_WSEQ_k      2
+#define TF_WSEQ_v      3
+#endif
+
+// TINYFORMER_PREFETCH: warm the D‑cache with the next weight matrix while
+// attention runs. Each query row of the softmax touches the next slice of
+// W_o, so the output projection starts on resident lines.
+//   0  off (default)
+//   1  __builtin_prefetch (cores with a prefetch instruction, the host build;
+//      a no‑op on RV32IM)
+//   2  one volatile load per TINYFORMER_CACHE_LINE bytes (blocking caches
+//      such as VexRiscv: the refills move ahead of the GEMV loop)
+#ifndef TINYFORMER_PREFETCH
+#define TINYFORMER_PREFETCH 0
+#endif
+
+// D‑cache line in bytes (LiteX VexRiscv default: 32).
+#ifndef TINYFORMER_CACHE_LINE
+#define TINYFORMER_CACHE_LINE 32
+#endif
+
+// TINYFORMER_OVERLAP=1: with USE_GEMV_HW, run the output projection on the
+// GEMV block one query row behind the attention, so the block's W/X loads and
+// compute hide under the CPU's scores, softmax and context (DOT8, exp LUT or
+// softmax unit) of the next row; row dependencies keep ENC_CKSUM
+// bit‑identical. W_o stays resident for all rows and the residual add runs
+// on the CPU as each row is collected. Q/K/V still finish first: every query
+// row needs all keys. CSR mode only (not GEMV_DMA), int8 weights; a
+// block‑sparse W_o, D other than 32/64 or TINYFORMER_FWA without W_qk run the
+// stages in sequence. TINYFORMER_PROFILE then books the output projection
+// under attention. No effect without USE_GEMV_HW. Default 0.
+#ifndef TINYFORMER_OVERLAP
+#define TINYFORMER_OVERLAP 0
+#endif
+
+// TINYFORMER_GEMV_ATTN=1: with USE_GEMV_HW and gateware built with
+// GEMVPeripheral(attn=True) (GEMV_ATTN=1), the attention's two matmuls run
+// on the GEMV block too: each head's K and V^T are written to their W
+// regions once and stay resident for all its query rows (the rows run head by
+// head), the scores of query i are K * q_i (OUT_DIM 16 for S = 16), and the
+// context is V^T * w with the Q15 weights as 16‑bit X. The scores are
+// bit‑identical; the context takes one >> 15 of each exact int32 sum instead
+// of one per term, so ENC_CKSUM differs from baseline, matching
+// TINYFORMER_SPARSE_SOFTMAX with TINYFORMER_SPARSE_MIN_W=0 (tools/
+// tinyformer_sim.py --sparse-softmax --sparse-min-w 0). Up to 32 keys and a
+// head_dim up to 64. Two‑pass CPU softmax only (not with
+// TINYFORMER_ONLINE_SOFTMAX, _LINEAR_ATTN, _EXP2_SOFTMAX, _SPARSE_SOFTMAX
+// or USE_SOFTMAX_HW), and not with TINYFORMER_OVERLAP (W_o would evict K)
+// or TINYFORMER_AUTOTUNE (the block is not probed). Default 0.
+#ifndef TINYFORMER_GEMV_ATTN
+#define TINYFORMER_GEMV_ATTN 0
+#endif
+#if TINYFORMER_GEMV_ATTN && !defined(USE_GEMV_HW)
+#error "TINYFORMER_GEMV_ATTN needs USE_GEMV_HW"
+#endif
+#if TINYFORMER_GEMV_ATTN && (TINYFORMER_ONLINE_SOFTMAX || TINYFORMER_LINEAR_ATTN ||      \
+                             TINYFORMER_EXP2_SOFTMAX || TINYFORMER_SPARSE_SOFTMAX ||     \
+                             defined(USE_SOFTMAX_HW))
+#error "TINYFORMER_GEMV_ATTN takes the two‑pass CPU softmax: drop ONLINE_SOFTMAX / LINEAR_ATTN / EXP2_SOFTMAX / SPARSE_SOFTMAX / USE_SOFTMAX_HW"
+#endif
+#if TINYFORMER_GEMV_ATTN && (TINYFORMER_OVERLAP || TINYFORMER_AUTOTUNE)
+#error "TINYFORMER_GEMV_ATTN keeps K / V^T resident through the attention; drop TINYFORMER_OVERLAP and TINYFORMER_AUTOTUNE"
+#endif
+
+// TINYFORMER_AUTOTUNE=1: one image for every SoC variant. The DOT8, GEMV and
+// exp LUT backends compiled in (USE_DOT8_HW / USE_GEMV_HW / USE_EXP_LUT_HW,
+// e.g. the accel_all flags) are only used once tinyformer_autotune() has
+// found them: it probes each block (dot8_probe(), gemv_probe(),
+// exp_lut_probe()), times every candidate matvec kernel on the shape of
+// each layer with the cycle counter and keeps the fastest per layer in a
+// dispatch table; the softmax exps go to the LUT only if it beats the
+// software table. Until then (and for blocks that are absent) everything
+// runs on the CPU. All kernels are exact, so ENC_CKSUM does not depend on
+// the choice. Int8 weights without TINYFORMER_PACKED_WEIGHTS, and not with
+// USE_SOFTMAX_HW, USE_GEMM_HW or USE_ATTN_HW (not probed). Default 0.
+#ifndef TINYFORMER_AUTOTUNE
+#define TINYFORMER_AUTOTUNE 0
+#endif
+#if TINYFORMER_AUTOTUNE && (TINYFORMER_PACKED_WEIGHTS || TINYFORMER_INT4_WEIGHTS)
+#error "TINYFORMER_AUTOTUNE times the int8 row kernels; drop TINYFORMER_PACKED_WEIGHTS / TINYFORMER_INT4_WEIGHTS"
+#endif
+#if TINYFORMER_AUTOTUNE && defined(USE_SOFTMAX_HW)
+#error "TINYFORMER_AUTOTUNE does not probe the softmax unit; drop USE_SOFTMAX_HW"
+#endif
+#if TINYFORMER_AUTOTUNE && (defined(USE_GEMM_HW) || defined(USE_ATTN_HW))
+#error "TINYFORMER_AUTOTUNE does not probe the GEMM / attention blocks; drop USE_GEMM_HW / USE_ATTN_HW"
+#endif
+
+// TINYFORMER_SMP=1: tinyformer_encode_smp() splits one encoder call over the
+// TF_SMP_HARTS harts of an SMP VexRiscv (smp_runtime.h, make SMP=1). Hart h
+// projects Q/K/V for its share of the tokens; after one barrier (every
+// query needs all keys) it scores the same share of query rows and runs
+// their output projection, residual and FFN, which need no other hart's
+// rows. Each hart has its own kernel scratch, the arena is shared, and
+// ENC_CKSUM is bit‑identical. The GEMV, exp LUT, softmax, GEMM and
+// attention blocks sit on the single‑ported bus, so not with USE_GEMV_HW /
+// USE_EXP_LUT_HW / USE_SOFTMAX_HW / USE_GEMM_HW / USE_ATTN_HW (DOT8 is a
+// per‑core plugin), nor with the stage layouts of
+// TINYFORMER_FUSED_QKV, _FWA, _LINEAR_ATTN, _OVERLAP or _AUTOTUNE.
+// TINYFORMER_PROFILE books hart 0's stages, barrier wait included.
+// Default 0.
+#ifndef TINYFORMER_SMP
+#define TINYFORMER_SMP 0
+#endif
+#if TINYFORMER_SMP && (defined(USE_GEMV_HW) || defined(USE_EXP_LUT_HW) || defined(USE_SOFTMAX_HW) || \
+                       defined(USE_GEMM_HW) || defined(USE_ATTN_HW))
+#error "TINYFORMER_SMP: the GEMV / exp LUT / softmax / GEMM / attention blocks are shared by all harts; drop USE_*_HW (DOT8 is fine)"
+#endif
+#if TINYFORMER_SMP && (TINYFORMER_FUSED_QKV || TINYFORMER_FWA || TINYFORMER_LINEAR_ATTN || \
+                       TINYFORMER_OVERLAP || TINYFORMER_AUTOTUNE)
+#error "TINYFORMER_SMP splits the default stage order; drop FUSED_QKV / FWA / LINEAR_ATTN / OVERLAP / AUTOTUNE"
+#endif
+
+#include "tinyformer_shapes.h"
+
+// --- Weights ---
+// Matrix element type seen by the kernels: flattened row‑major int8, or
+// uint32 words of 4 int8 lanes with TINYFORMER_PACKED_WEIGHTS (8 int4 lanes
+// with TINYFORMER_INT4_WEIGHTS).
+#if TINYFORMER_PACKED_WEIGHTS || TINYFORMER_INT4_WEIGHTS
+typedef uint32_t tinyformer_wword_t;
+#else
+typedef int8_t tinyformer_wword_t;
+#endif
+
+// Per‑output‑channel requantization of one layer (TINYFORMER_PER_CHANNEL_REQUANT).
+typedef struct {
+    const int32_t *bias;   // [D_out] bias in the accumulator domain (replaces b_*)
+    const int32_t *mul;    // [D_out] multiplier
+    const uint8_t *shift;  // [D_out] rounding right shift, >= 1
+} tinyformer_requant_t;
+
+// Block‑sparse rows of one layer (TINYFORMER_BLOCK_SPARSE): row r holds the
+// entries row_start[r] .. row_start[r + 1] - 1, entry e being the 4 weights
+// of input channels 4 * block[e] .. 4 * block[e] + 3 as one dot8_pack() word.
+// A null row_start keeps the layer dense.
+typedef struct {
+    const uint16_t *row_start;  // [D_out + 1]
+    const uint8_t  *block;      // [nnz] input block index
+    const uint32_t *w;          // [nnz] packed weights
+} tinyformer_sparse_t;
+
+// Rank‑r factors of one layer (TINYFORMER_LOW_RANK): W ~= U V / 2^shift, both
+// int8 in the layout of the dense matrices (see tinyformer_wword_t). A zero
+// rank keeps the layer dense.
+typedef struct {
+    const tinyformer_wword_t *V;  // [rank][D_in]
+    const tinyformer_wword_t *U;  // [D_out][rank]
+    int32_t rank;                 // multiple of 4, < D_in and D_out
+    int32_t shift;                // bottleneck t = sat8((V x) >> shift)
+} tinyformer_lowrank_t;
+
+// Index of each layer in tinyformer_weights_t.rq, .sparse and .lowrank.
+enum {
+    TINYFORMER_RQ_Q,
+    TINYFORMER_RQ_K,
+    TINYFORMER_RQ_V,
+    TINYFORMER_RQ_O,
+    TINYFORMER_RQ_FF1,
+    TINYFORMER_RQ_FF2,
+    TINYFORMER_RQ_QKV,     // fused [3D] block, only read with TINYFORMER_FUSED_QKV
+    TINYFORMER_RQ_COUNT
+};
+
+// Weight set of one encoder block. Matrices are [D_out][D_in] for the shape
+// the block is run with. W_qkv/b_qkv (fused [3D][D] block) are only read with
+// TINYFORMER_FUSED_QKV and may be null, selecting the separate projections.
+// d_in > 0 narrows the Q/K/V projections to the first d_in input channels:
+// W_q/W_k/W_v (and W_qkv) are then stored as [D][d_in], their other columns
+// being zero (input features padded to D, exported with --dead-inputs), so
+// the padding costs no MACs. A multiple of 4 (8 with int4 weights); 0 is D.
+// W_qk/b_qk/qk_shift (fused‑weight attention, [d_in][d_in]) are only read with
+// TINYFORMER_FWA and may be null, selecting the W_q/W_k projections.
+// W_ff2_cols (W_ff2 transposed) is only read with TINYFORMER_FFN_GATHER and
+// may be null, selecting the dense W_ff2 matvec.
+typedef struct {
+    const tinyformer_wword_t *W_q, *W_k, *W_v;        // [D][d_in]
+    const tinyformer_wword_t *W_o;                    // [D][D]
+    const tinyformer_wword_t *W_ff1;                  // [FFN][D]
+    const tinyformer_wword_t *W_ff2;                  // [D][FFN]
+    const int8_t *b_q, *b_k, *b_v, *b_o;              // [D]
+    const int8_t *b_ff1;                              // [FFN]
+    const int8_t *b_ff2;                              // [D]
+    const tinyformer_wword_t *W_qkv;                  // [3D][d_in] or null
+    const int8_t *b_qkv;                              // [3D]
+    const tinyformer_requant_t *rq;                   // [TINYFORMER_RQ_COUNT] or null
+    const tinyformer_sparse_t *sparse;                // [TINYFORMER_RQ_COUNT] or null
+    const tinyformer_lowrank_t *lowrank;              // [TINYFORMER_RQ_COUNT] or null
+    int32_t d_in;                                     // Q/K/V input channels, 0: D
+    const tinyformer_wword_t *W_qk;                   // [d_in][d_in] or null
+    const int32_t *b_qk;                              // [d_in]
+    int32_t qk_shift;                                 // g = (W_qk x + b_qk) >> qk_shift
+    const int8_t *W_ff2_cols;                         // [FFN][D] or null
+} tinyformer_weights_t;
+
+// Built‑in weights (trained_weights.c or placeholders) for the default shape.
+extern const tinyformer_weights_t tinyformer_default_weights;
+
+#if TINYFORMER_SHARED_LAYERS
+// Own biases / requant of one layer of a shared stack (TINYFORMER_SHARED_LAYERS);
+// null fields keep the shared weight set's.
+typedef struct {
+    const int8_t *b_q, *b_k, *b_v, *b_o;              // [D]
+    const int8_t *b_ff1;                              // [FFN]
+    const int8_t *b_ff2;                              // [D]
+    const int8_t *b_qkv;                              // [3D]
+    const int32_t *b_qk;                              // [d_in]
+    const tinyformer_requant_t *rq;                   // [TINYFORMER_RQ_COUNT]
+} tinyformer_layer_bias_t;
+
+// Fills layers[0 .. n_layers) with copies of base, so all of them share its
+// matrices, then applies the non‑null fields of own[l] to layer l (own may be
+// null: an n_layers‑deep stack of base). The result is a plain layer array
+// for tinyformer_stack_encode() and the other stack entry points.
+void tinyformer_share_layers(
+    tinyformer_weights_t          *layers,
+    int                            n_layers,
+    const tinyformer_weights_t    *base,
+    const tinyformer_layer_bias_t *own);
+#endif
+
+// --- SRAM footprint ---
+// Activation arena of one instance: Q/K/V and the attention output (the FFN
+// is streamed per token and only needs shared scratch); no K with
+// TINYFORMER_FWA.
+#if TINYFORMER_FWA
+#define TINYFORMER_ARENA_BYTES(S, D, FFN) (3 * (S) * (D))
+#else
+#define TINYFORMER_ARENA_BYTES(S, D, FFN) (4 * (S) * (D))
+#endif
+// TINYFORMER_BATCH arenas plus the 2 x [S][D] stack ping‑pong buffers.
+#define TINYFORMER_INSTANCE_BYTES(S, D, FFN)                                   \
+    (TINYFORMER_BATCH * TINYFORMER_ARENA_BYTES(S, D, FFN) + 2 * (S) * (D))
+
+// Static encoder SRAM (.bss) in bytes, filled by tinyformer_sram_usage().
+typedef struct {
+    uint32_t arena;      // default‑shape activation arenas (TINYFORMER_BATCH)
+    uint32_t pingpong;   // default‑shape stack ping‑pong buffers
+    uint32_t instances;  // arena + ping‑pong of every instance (incl. default)
+    uint32_t scratch;    // kernel scratch of all instances (one per hart: SMP)
+    uint32_t total;      // instances + scratch: peak encoder SRAM
+} tinyformer_sram_t;
+
+void tinyformer_sram_usage(tinyformer_sram_t *out);
+
+// Linear classifier head over the mean‑pooled tokens.
+typedef struct {
+    const int8_t *W;          // [n_classes][D] int8, row‑major
+    const int8_t *b;          // [n_classes]
+    int           n_classes;
+} tinyformer_head_t;
+
+// Early‑exit head: fires when its top‑1 logit leads the runner‑up by at
+// least margin (int32 logit units of head).
+typedef struct {
+    tinyformer_head_t head;
+    int32_t           margin;
+} tinyformer_exit_t;
+
+// Encoder output reduced in the final FFN‑residual pass (name##_pool):
+// per‑channel sums over the S tokens and the byte checksum of the output
+// (sum of every output byte as uint8, the demo's ENC_CKSUM).
+// attn_exit (set by the caller, may be null) is checked on the mean‑pooled
+// tokens after the attention residual; if it fires the FFN is skipped,
+// exit_label is its class and logits[] its scores (sum/cksum are then not
+// valid). Otherwise exit_label is -1.
+typedef struct {
+    int32_t                  sum[TINYFORMER_MAX_D];
+    uint32_t                 cksum;
+    const tinyformer_exit_t *attn_exit;
+    int32_t                 *logits;     // [attn_exit->head.n_classes]
+    int32_t                  exit_label;
+} tinyformer_pool_t;
+
+#if TINYFORMER_TOKEN_POOL
+#define TF_DECLARE_POOLED(name, S, D)                                          \
+    int name##_stack_pooled(const tinyformer_weights_t *layers,                \
+                            int                         n_layers,              \
+                            const uint8_t              *pool,                  \
+                            const int8_t                input[S][D],           \
+                            int8_t                      output[S][D]);
+#else
+#define TF_DECLARE_POOLED(name, S, D)
+#endif
+
+#if TINYFORMER_MASKED
+#define TF_DECLARE_MASKED(name, S, D)                                          \
+    int name##_masked(const tinyformer_weights_t *w,                           \
+                      const int8_t                input[S][D],                 \
+                      int                         valid_tokens,                \
+                      int                         valid_features,              \
+                      int8_t                      output[S][D]);
+#else
+#define TF_DECLARE_MASKED(name, S, D)
+#endif
+
+// Declare one fixed‑shape encoder instance (defined in tinyformer.c):
+//   void name(const tinyformer_weights_t *w,
+//             const int8_t input[S][D], int8_t output[S][D]);
+//   void name##_stack(const tinyformer_weights_t *layers, int n_layers,
+//                     const int8_t input[S][D], int8_t output[S][D]);
+//   void name##_batch(const tinyformer_weights_t *w,
+//                     const int8_t inputs[][S][D], int8_t outputs[][S][D], int n);
+//   void name##_slide(const tinyformer_weights_t *w, const int8_t input[S][D],
+//                     int n_new, int8_t output[S][D]);
+//   void name##_pool(const tinyformer_weights_t *w, const int8_t input[S][D],
+//                    tinyformer_pool_t *pool);
+// and, with TINYFORMER_TOKEN_POOL (see tinyformer_stack_encode_pooled()),
+//   int name##_stack_pooled(const tinyformer_weights_t *layers, int n_layers,
+//                           const uint8_t *pool, const int8_t input[S][D],
+//                           int8_t output[S][D]);
+// and, with TINYFORMER_MASKED (see tinyformer_encode_masked()),
+//   int name##_masked(const tinyformer_weights_t *w, const int8_t input[S][D],
+//                     int valid_tokens, int valid_features, int8_t output[S][D]);
+// Each instance has its own activation arenas and constant‑trip‑count loops.
+// input and output must not overlap.
+#define TINYFORMER_DECLARE(name, S, D, FFN)                                    \
+    void name(const tinyformer_weights_t *w,                                   \
+              const int8_t input[S][D],                                        \
+              int8_t       output[S][D]);                                      \
+    void name##_stack(const tinyformer_weights_t *layers,                      \
+                      int                         n_layers,                    \
+                      const int8_t                input[S][D],                 \
+                      int8_t                      output[S][D]);               \
+    void name##_batch(const tinyformer_weights_t *w,                           \
+                      const int8_t                inputs[][S][D],              \
+                      int8_t                      outputs[][S][D],             \
+                      int                         n);                          \
+    void name##_slide(const tinyformer_weights_t *w,                           \
+                      const int8_t                input[S][D],                 \
+                      int                         n_new,                       \
+                      int8_t                      output[S][D]);               \
+    void name##_pool(const tinyformer_weights_t *w,                            \
+                     const int8_t                input[S][D],                  \
+                     tinyformer_pool_t          *pool);                        \
+    TF_DECLARE_POOLED(name, S, D)                                              \
+    TF_DECLARE_MASKED(name, S, D)
+
+// Default shape with caller‑supplied weights.
+TINYFORMER_DECLARE(tinyformer_encode_with,
+                   TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN)
+
+// Extra shapes listed in tinyformer_shapes.h.
+TINYFORMER_SHAPES(TINYFORMER_DECLARE)
+
 // Public API: encode a single TinyFormer block.
 //
 //  - input  : [TINYFORMER_S][TINYFORMER_D] int8_t tokens
@@ -26,11 +836,502 @@
 //  3. Applies output projection + residual
 //  4. Applies feed‑forward network (ReLU) + residual
 //
-// Weights are stored as global const int8_t arrays in tinyformer.c
-// and can be replaced by real trained parameters later.
+// Uses tinyformer_default_weights (global const arrays in tinyformer.c or
+// trained_weights.c).
 void tinyformer_encode(
     const int8_t input[TINYFORMER_S][TINYFORMER_D],
     int8_t       output[TINYFORMER_S][TINYFORMER_D]);
 
-#endif // TINYFORMER_H
+// Sliding‑window encoder (default weights) for overlapping windows: input is
+// the previous slide input shifted up by n_new rows with n_new new tokens
+// appended. K/V of the S - n_new kept tokens are reused from the previous
+// call and only the new tokens are projected (Q, attention, output projection
+// and FFN still run over all S). Bit‑identical to tinyformer_encode(input).
+// The first call, n_new outside 1..S, or any other encode call in between
+// (they reuse the same buffers) falls back to projecting all S tokens.
+void tinyformer_encode_slide(
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int          n_new,
+    int8_t       output[TINYFORMER_S][TINYFORMER_D]);
+
+#if TINYFORMER_SMP
+// tinyformer_encode() / tinyformer_encode_with(w, ...) split over the
+// TF_SMP_HARTS harts (TINYFORMER_SMP): the calling hart takes share 0 and
+// tf_smp_run() posts the others to the workers of smp_runtime.h, which
+// must be running. Call from hart 0 only; uses the buffers of
+// tinyformer_encode_with() (the next tinyformer_encode_slide() projects all
+// rows).
+void tinyformer_encode_smp(
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int8_t       output[TINYFORMER_S][TINYFORMER_D]);
+void tinyformer_encode_smp_with(
+    const tinyformer_weights_t *w,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D]);
+#endif
+
+#if TINYFORMER_MASKED
+// tinyformer_encode() of a padded window: only the first valid_tokens rows
+// of input are real tokens and only its first valid_features columns can be
+// non‑zero. Padded tokens get no Q/K/V projections and are excluded as keys
+// (no scores, exp lookups or V accumulation); their output rows are zero.
+// The valid rows match an unpadded encoder that attends over valid_tokens
+// keys; with TINYFORMER_CAUSAL they equal the first rows of
+// tinyformer_encode(). valid_features must not exceed the Q/K/V columns the
+// weights read (d_in, see tinyformer_weights_t): dead trailing features are
+// trimmed by exporting the model with --dead-inputs. Returns 0, or -1
+// (nothing written) if a count is out of range or, with
+// TINYFORMER_ONLINE_SOFTMAX, valid_tokens is not a multiple of
+// TINYFORMER_ATTN_BLOCK.
+int tinyformer_encode_masked(
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int          valid_tokens,
+    int          valid_features,
+    int8_t       output[TINYFORMER_S][TINYFORMER_D]);
+#endif
+
+// Zero‑copy input window for tinyformer_encode_view() / _classify_view():
+// token s is row (first + s) % rows of base, rows stride bytes apart, e.g.
+// the last S frames of a ring buffer read in place. base and stride must be
+// 4‑byte aligned (the kernels and the GEMV block load words).
+typedef struct {
+    const int8_t *base;    // row 0 of the buffer
+    int32_t       stride;  // bytes from one row to the next, >= TINYFORMER_D
+    int32_t       rows;    // rows in the buffer (wrap point), >= TINYFORMER_S
+    int32_t       first;   // row of token 0, 0 .. rows - 1
+} tinyformer_input_t;
+
+// tinyformer_encode_slide() on a view: the Q/K/V projections and the
+// attention residual read the window in place, so no [S][D] input copy is
+// needed and overlapping windows share the buffer (n_new = the rows new
+// since the last call, TINYFORMER_S for an unrelated window). Bit‑identical
+// to tinyformer_encode() of the same tokens. Returns 0, or -1 (nothing
+// written) for an invalid view. Under TINYFORMER_FWA a W_qk weight set
+// scores the input itself, so a wrapped or strided window is first copied
+// into the state's ping‑pong buffer.
+int tinyformer_encode_view(
+    const tinyformer_input_t *in,
+    int                       n_new,
+    int8_t                    output[TINYFORMER_S][TINYFORMER_D]);
+
+// Encode and classify in one pass (default weights): the pooled sums and the
+// output checksum are accumulated inside the final FFN‑residual loop, so no
+// [S][D] output is stored and no separate pooling/checksum passes run. Then
+// mean‑pools (round half up, saturate), applies head and returns the argmax
+// class. logits: [head->n_classes]. cksum (may be null) receives ENC_CKSUM.
+// Same label and checksum as tinyformer_encode() + demo_runner's mean pool
+// and classifier.
+int tinyformer_classify(
+    const tinyformer_head_t *head,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum);
+
+// tinyformer_classify() with several heads on one encoder pass: the pooled
+// output goes through heads[0 .. n_heads) (e.g. activity classes and an
+// anomaly score), head h writing its logits right after those of head h - 1
+// (logits: the sum of their n_classes) and its argmax to labels[h].
+// Returns labels[0]; n_heads >= 1.
+int tinyformer_classify_heads(
+    const tinyformer_head_t *heads,
+    int                      n_heads,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    int                     *labels,
+    uint32_t                *cksum);
+
+// The head stage of tinyformer_classify() on the pool of any instance
+// (name##_pool()): mean‑pools pool->sum over S tokens of width D (round half
+// up, saturate), applies head and returns the argmax class. logits:
+// [head->n_classes]. Runs on the shared scratch, like the non‑ctx API.
+int tinyformer_head_apply(
+    const tinyformer_head_t *head,
+    const tinyformer_pool_t *pool,
+    int32_t                  S,
+    int32_t                  D,
+    int32_t                 *logits);
+
+// tinyformer_classify() on a view (see tinyformer_encode_view()). Returns
+// the label, or -1 for an invalid view.
+int tinyformer_classify_view(
+    const tinyformer_head_t  *head,
+    const tinyformer_input_t *in,
+    int32_t                  *logits,
+    uint32_t                 *cksum);
+
+#if TINYFORMER_SMP
+// Stage pipeline of tinyformer_classify_view() over two harts: the front
+// half (Q/K/V and attention) of window n + 1 runs on one hart while the back
+// half (output projection, residual, FFN, pool and head) of window n runs on
+// another. A tinyformer_stage_t carries one window between them: its input
+// tokens for the residual and the attention context; the back half works in
+// y. Throughput approaches the slower half; a window's latency does not drop.
+typedef struct {
+    int8_t x[TINYFORMER_S][TINYFORMER_D] __attribute__((aligned(4)));
+    int8_t ctx[TINYFORMER_S][TINYFORMER_D] __attribute__((aligned(4)));
+    int8_t y[TINYFORMER_S][TINYFORMER_D] __attribute__((aligned(4)));
+} tinyformer_stage_t;
+
+// Front half of tinyformer_classify_view(head, in) into *st. It runs on
+// the buffers of tinyformer_encode_with(), so K/V of the rows kept from the
+// last front call are reused as by tinyformer_encode_view(in, n_new). Call
+// from one hart only. Returns 0, or -1 (nothing written) for an invalid
+// view.
+int tinyformer_encode_front(
+    const tinyformer_input_t *in,
+    int                       n_new,
+    tinyformer_stage_t       *st);
+
+// Back half on hart's kernel scratch (a hart other than the front's, or the
+// same one between front calls): the label, logits and ENC_CKSUM of
+// tinyformer_classify_view() of the window st was filled from.
+int tinyformer_classify_back(
+    int                      hart,
+    const tinyformer_head_t *head,
+    tinyformer_stage_t      *st,
+    int32_t                 *logits,
+    uint32_t                *cksum);
+#endif
+
+// Profiled stages (TINYFORMER_PROFILE).
+enum {
+    TINYFORMER_PROF_QKV,    // Q/K/V projections
+    TINYFORMER_PROF_ATTN,   // scores, softmax, context
+    TINYFORMER_PROF_OPROJ,  // output projection + residual
+    TINYFORMER_PROF_FFN,    // FFN + residual (incl. pooling in name##_pool)
+    TINYFORMER_PROF_HEAD,   // mean pool + classifier / early‑exit heads
+    TINYFORMER_PROF_COUNT
+};
+
+// Hardware event counters per stage (USE_PERFMON_HW, hw_extensions/perfmon:
+// cycle, imiss, dmiss, iwait, dwait, csr, csr_wait, gemv; PERFMON_COUNT).
+#define TINYFORMER_PERF_EVENTS 8
+
+// Totals since the last tinyformer_profile_reset(); 32‑bit, wrapping.
+typedef struct {
+    uint32_t cycles[TINYFORMER_PROF_COUNT];
+    uint32_t instret[TINYFORMER_PROF_COUNT];
+    uint32_t samples;       // encoder samples (one per window, batch or layer)
+    uint32_t perf[TINYFORMER_PROF_COUNT][TINYFORMER_PERF_EVENTS];  // 0 without perfmon
+    uint32_t ffn_units;     // FFN hidden units through the FF1 ReLU
+    uint32_t ffn_live;      // ... and left non‑zero (W_ff2 columns that count)
+} tinyformer_profile_t;
+
+// Zero the totals / copy them to *out (all zero without TINYFORMER_PROFILE).
+// The reset also clears the TINYFORMER_LATENCY histograms and the
+// TINYFORMER_RANGE_STATS counters.
+void tinyformer_profile_reset(void);
+void tinyformer_profile_read(tinyformer_profile_t *out);
+
+// Latency histograms (TINYFORMER_LATENCY): TINYFORMER_PROF_* stages, each
+// entry one stage of one layer pass, and TINYFORMER_LAT_CALL, the cycles the
+// caller passes to tinyformer_latency_record() (e.g. one classify call).
+// Bucket b counts [2^b, 2^(b+1)) cycles (bucket 0: 0..1).
+#define TINYFORMER_LAT_CALL     TINYFORMER_PROF_COUNT
+#define TINYFORMER_LAT_COUNT    (TINYFORMER_PROF_COUNT + 1)
+#define TINYFORMER_LAT_BUCKETS  32
+
+// Percentiles are the top of the bucket that holds them, capped at max, so
+// they over‑estimate by less than 2x and never under‑estimate.
+typedef struct {
+    uint32_t count;         // entries since tinyformer_profile_reset()
+    uint32_t p50, p95, p99; // cycles
+    uint32_t max;
+} tinyformer_latency_t;
+
+// Add one whole‑call latency to the TINYFORMER_LAT_CALL histogram.
+void tinyformer_latency_record(uint32_t cycles);
+
+// Percentiles of histogram lat (TINYFORMER_PROF_* or TINYFORMER_LAT_CALL);
+// all zero without TINYFORMER_LATENCY or entries.
+void tinyformer_latency_read(int lat, tinyformer_latency_t *out);
+
+// Range stages (TINYFORMER_RANGE_STATS). Linear layers count the int32
+// accumulator (bias included) before its requant, so min / max show the
+// headroom of the accumulator and clips the requant's saturation; the
+// residuals count the int32 sum of the two int8 terms and the context its
+// value before the int8 clip. Scores are the shifted int32 softmax inputs,
+// which are never clipped (their range bounds TINYFORMER_SCORE_SHIFT).
+// With TINYFORMER_FUSED_QKV the fused block's channels count as Q, K and V;
+// TINYFORMER_FWA's G = X W_qk counts as Q.
+enum {
+    TINYFORMER_RNG_Q,
+    TINYFORMER_RNG_K,
+    TINYFORMER_RNG_V,
+    TINYFORMER_RNG_SCORES,
+    TINYFORMER_RNG_CTX,
+    TINYFORMER_RNG_O,
+    TINYFORMER_RNG_RES1,    // X + O
+    TINYFORMER_RNG_FF1,     // clip_lo is what the ReLU zeroes anyway
+    TINYFORMER_RNG_FF2,
+    TINYFORMER_RNG_RES2,    // Y + FFN(Y)
+    TINYFORMER_RNG_COUNT
+};
+
+// Counters since the last tinyformer_profile_reset(); 32‑bit, wrapping.
+typedef struct {
+    uint32_t count;         // values seen
+    uint32_t clip_hi;       // clipped to the top of the output range
+    uint32_t clip_lo;       // clipped to the bottom
+    int32_t  min, max;      // of the value before the clip (0, 0 if none)
+} tinyformer_range_t;
+
+// Counters of stage (TINYFORMER_RNG_*); all zero without
+// TINYFORMER_RANGE_STATS. tinyformer_profile_reset() clears them.
+void tinyformer_range_read(int stage, tinyformer_range_t *out);
+
+// Backends found by tinyformer_autotune() (TINYFORMER_AUTOTUNE).
+#define TINYFORMER_HW_DOT8     (1u << 0)
+#define TINYFORMER_HW_GEMV     (1u << 1)
+#define TINYFORMER_HW_EXP_LUT  (1u << 2)
 
+// Matvec kernels of the dispatch table.
+enum {
+    TINYFORMER_KERNEL_CPU,   // scalar (or TINYFORMER_HOST_SIMD) dot products
+    TINYFORMER_KERNEL_DOT8,  // DOT8 custom instruction
+    TINYFORMER_KERNEL_GEMV,  // GEMV block
+    TINYFORMER_KERNEL_COUNT
+};
+
+// Result of tinyformer_autotune(): per layer (TINYFORMER_RQ_*; QKV only with
+// TINYFORMER_FUSED_QKV, otherwise kernel CPU and 0 cycles) the kernel picked
+// and the cycles of one matvec with it.
+typedef struct {
+    uint32_t hw;                                 // TINYFORMER_HW_* present
+    uint8_t  kernel[TINYFORMER_RQ_COUNT];        // TINYFORMER_KERNEL_*
+    uint32_t cycles[TINYFORMER_RQ_COUNT];
+    uint8_t  exp_lut;                            // 1: softmax exps on the LUT
+} tinyformer_tune_t;
+
+// Probe the backends and fill the dispatch table for the default shape,
+// timing the matrices of w (null: tinyformer_default_weights). Layers
+// sharing a shape share a table entry, and shapes not in the table (other
+// TINYFORMER_DEFINE instances, heads) take DOT8 when present. Call once at
+// boot, before the first encode; may be called again (e.g. after a model
+// blob is loaded). *out may be null. Without TINYFORMER_AUTOTUNE it only
+// reports the compiled‑in backends in out->hw, the rest zero.
+void tinyformer_autotune(const tinyformer_weights_t *w, tinyformer_tune_t *out);
+
+// tinyformer_autotune() with the backends chosen by hand, e.g. to compare
+// them in one boot: only the TINYFORMER_HW_* backends in hw that the probes
+// find are used (hw = 0: all on the CPU), each layer on the last of them in
+// TINYFORMER_KERNEL_* order that computes it right, the softmax exps on the
+// LUT if it is in hw. out->cycles are those of the kernels picked; out->hw
+// still reports every backend found.
+void tinyformer_select_backends(const tinyformer_weights_t *w, uint32_t hw, tinyformer_tune_t *out);
+
+// TINYFORMER_KERNEL_* the dispatch table runs a d_out x d_in matvec on: the
+// tuned kernel of that shape, else the fallback of shapes not in the table
+// (e.g. of another instance). -1 without TINYFORMER_AUTOTUNE.
+int tinyformer_kernel_for(int32_t d_in, int32_t d_out);
+
+// Where tinyformer_classify_early() produced its label.
+#define TINYFORMER_EXIT_INPUT  0  // exit_in, before the encoder
+#define TINYFORMER_EXIT_ATTN   1  // exit_attn, FFN skipped
+#define TINYFORMER_EXIT_NONE   2  // full encoder and head
+
+// tinyformer_classify() with confidence‑gated early exits (either may be
+// null): exit_in classifies the mean‑pooled input tokens before the encoder
+// runs, exit_attn the mean‑pooled tokens after the attention residual (the
+// FFN is skipped). The first head that fires gives the label and logits; the
+// exit heads must have head->n_classes classes. *exit_stage (may be null)
+// receives TINYFORMER_EXIT_*; cksum is only written for TINYFORMER_EXIT_NONE.
+// With both exits null this is tinyformer_classify().
+int tinyformer_classify_early(
+    const tinyformer_head_t *head,
+    const tinyformer_exit_t *exit_in,
+    const tinyformer_exit_t *exit_attn,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum,
+    int                     *exit_stage);
+
+// Multi‑layer encoder: runs n_layers blocks back to back, layer l using
+// layers[l] (default shape). All layers share one set of block buffers and a
+// 2 x [S][D] ping‑pong arena for the intermediate activations, so SRAM use
+// does not grow with depth. n_layers == 0 copies input to output.
+void tinyformer_stack_encode(
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D]);
+
+// Layer source of a stack whose weights are not one resident array (e.g.
+// streamed from flash, see weight_store.h): returns the weights of layer l.
+// Called once per layer, in order, right before the layer runs; the result
+// must stay valid until the next call.
+typedef const tinyformer_weights_t *(*tinyformer_layer_fn)(void *user, int layer);
+
+// tinyformer_stack_encode() with layer l's weights from fetch(user, l).
+void tinyformer_stack_encode_src(
+    tinyformer_layer_fn fetch,
+    void               *user,
+    int                 n_layers,
+    const int8_t        input[TINYFORMER_S][TINYFORMER_D],
+    int8_t              output[TINYFORMER_S][TINYFORMER_D]);
+
+#if TINYFORMER_TOKEN_POOL
+// tinyformer_stack_encode() with token pooling: before layer l, if
+// pool[l] > 1, every pool[l] adjacent tokens are replaced by their rounded
+// mean floor((sum + m / 2) / m) (the last group may hold fewer, m, tokens),
+// and layer l and the later ones run on the ceil(n / pool[l]) tokens left.
+// pool == 0 pools nothing. Returns the token count of output; its rows from
+// there on are not written. Returns -1, writing nothing, if some pool[l] is 0
+// or, with TINYFORMER_ONLINE_SOFTMAX, a layer's token count is not a multiple
+// of TINYFORMER_ATTN_BLOCK. n_layers == 0 copies input to output.
+int tinyformer_stack_encode_pooled(
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const uint8_t              *pool,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D]);
+#endif
+
+// Batched encoder: encodes n independent samples (default shape and weights),
+// TINYFORMER_BATCH at a time, so each weight row fetched from main_ram is
+// reused across the windows of a tile. Bit‑identical to n tinyformer_encode()
+// calls.
+void tinyformer_encode_batch(
+    const int8_t inputs[][TINYFORMER_S][TINYFORMER_D],
+    int8_t       outputs[][TINYFORMER_S][TINYFORMER_D],
+    int          n);
+
+// --- Reentrant context API ---
+// The entry points above share one static set of kernel scratch and
+// activation buffers, so they must not run concurrently (two models, an ISR
+// and the main loop, threads). A context runs the same default‑shape encoder
+// on a workspace the caller supplies and places (e.g. a .bss array in
+// linker.ld's sram region, a TCM, or heap memory on the host):
+//
+//   static uint8_t ws[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+//   tinyformer_ctx_t ctx;
+//   if (tinyformer_ctx_init(&ctx, ws, sizeof(ws)) == 0) ...
+//
+// Contexts on separate workspaces never share encoder state; each call is
+// bit‑identical to the static entry point. The DOT8 / GEMV / exp LUT /
+// softmax peripherals and the TINYFORMER_PROFILE totals are still global, so
+// with those backends only the software kernels are reentrant.
+typedef struct {
+    void                       *ws;       // workspace, set by tinyformer_ctx_init()
+    const tinyformer_weights_t *weights;  // model; tinyformer_ctx_init() sets
+                                          // &tinyformer_default_weights
+} tinyformer_ctx_t;
+
+// Workspace bytes per context: kernel scratch, TINYFORMER_BATCH activation
+// arenas, the stack ping‑pong buffers and the pooled classifier output.
+uint32_t tinyformer_workspace_size(void);
+
+// Compile‑time upper bound of tinyformer_workspace_size() for statically
+// placed workspaces (every backend's scratch counted; checked in tinyformer.c).
+#define TINYFORMER_WORKSPACE_BYTES                                             \
+    (4 * (3 * TINYFORMER_MAX_D + TINYFORMER_MAX_FFN) +   /* accumulators */    \
+     2 * TINYFORMER_MAX_FFN + TINYFORMER_MAX_D +         /* FFN, packed in */  \
+     TINYFORMER_MAX_D * TINYFORMER_MAX_S + 10 * TINYFORMER_MAX_S +             \
+     9 * TINYFORMER_MAX_D + 4 +                          /* attention, head */ \
+     (TINYFORMER_LINEAR_ATTN ?                           /* linear K^T V */    \
+      4 * TINYFORMER_MAX_D * TINYFORMER_MAX_D / TINYFORMER_HEADS : 0) +        \
+     (TINYFORMER_LOW_RANK ? TINYFORMER_MAX_D : 0) +      /* bottleneck */      \
+     (TINYFORMER_FFN_GATHER ? TINYFORMER_MAX_FFN : 0) +  /* live units */      \
+     TINYFORMER_INSTANCE_BYTES(TINYFORMER_S, TINYFORMER_D, TINYFORMER_FFN) +   \
+     4 * TINYFORMER_MAX_D + 96)                          /* pool, pointers */
+
+// Attach workspace (at least tinyformer_workspace_size() bytes, 8‑byte
+// aligned) to ctx and reset its slide cache. Returns 0, or -1 if it is too
+// small or misaligned (ctx->ws is then null).
+int tinyformer_ctx_init(tinyformer_ctx_t *ctx, void *workspace, uint32_t bytes);
+
+// Same as tinyformer_encode(), _encode_slide(), _encode_masked(), _encode_view(), _classify(),
+// _classify_heads(), _classify_view(), _classify_early(), _stack_encode(), _stack_encode_src(),
+// _stack_encode_pooled() and _encode_batch(), with ctx->weights instead of the default weights (stack:
+// layers or fetch). The slide K/V cache is per context.
+void tinyformer_encode_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      input[TINYFORMER_S][TINYFORMER_D],
+    int8_t            output[TINYFORMER_S][TINYFORMER_D]);
+
+void tinyformer_encode_slide_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      input[TINYFORMER_S][TINYFORMER_D],
+    int               n_new,
+    int8_t            output[TINYFORMER_S][TINYFORMER_D]);
+
+#if TINYFORMER_MASKED
+int tinyformer_encode_masked_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      input[TINYFORMER_S][TINYFORMER_D],
+    int               valid_tokens,
+    int               valid_features,
+    int8_t            output[TINYFORMER_S][TINYFORMER_D]);
+#endif
+
+int tinyformer_encode_view_ctx(
+    tinyformer_ctx_t         *ctx,
+    const tinyformer_input_t *in,
+    int                       n_new,
+    int8_t                    output[TINYFORMER_S][TINYFORMER_D]);
+
+int tinyformer_classify_ctx(
+    tinyformer_ctx_t        *ctx,
+    const tinyformer_head_t *head,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum);
+
+int tinyformer_classify_heads_ctx(
+    tinyformer_ctx_t        *ctx,
+    const tinyformer_head_t *heads,
+    int                      n_heads,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    int                     *labels,
+    uint32_t                *cksum);
+
+int tinyformer_classify_view_ctx(
+    tinyformer_ctx_t         *ctx,
+    const tinyformer_head_t  *head,
+    const tinyformer_input_t *in,
+    int32_t                  *logits,
+    uint32_t                 *cksum);
+
+int tinyformer_classify_early_ctx(
+    tinyformer_ctx_t        *ctx,
+    const tinyformer_head_t *head,
+    const tinyformer_exit_t *exit_in,
+    const tinyformer_exit_t *exit_attn,
+    const int8_t             input[TINYFORMER_S][TINYFORMER_D],
+    int32_t                 *logits,
+    uint32_t                *cksum,
+    int                     *exit_stage);
+
+void tinyformer_stack_encode_ctx(
+    tinyformer_ctx_t           *ctx,
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D]);
+
+void tinyformer_stack_encode_src_ctx(
+    tinyformer_ctx_t   *ctx,
+    tinyformer_layer_fn fetch,
+    void               *user,
+    int                 n_layers,
+    const int8_t        input[TINYFORMER_S][TINYFORMER_D],
+    int8_t              output[TINYFORMER_S][TINYFORMER_D]);
+
+#if TINYFORMER_TOKEN_POOL
+int tinyformer_stack_encode_pooled_ctx(
+    tinyformer_ctx_t           *ctx,
+    const tinyformer_weights_t *layers,
+    int                         n_layers,
+    const uint8_t              *pool,
+    const int8_t                input[TINYFORMER_S][TINYFORMER_D],
+    int8_t                      output[TINYFORMER_S][TINYFORMER_D]);
+#endif
+
+void tinyformer_encode_batch_ctx(
+    tinyformer_ctx_t *ctx,
+    const int8_t      inputs[][TINYFORMER_S][TINYFORMER_D],
+    int8_t            outputs[][TINYFORMER_S][TINYFORMER_D],
+    int               n);
+
+#endif // TINYFORMER_H
@@ -0,0 +1,99 @@
+// Extra TinyFormer encoder shapes compiled into tinyformer.c.
+//
+// Each X(name, S, D, FFN) entry in TINYFORMER_SHAPES becomes
+//   void name(const tinyformer_weights_t *w,
+//             const int8_t input[S][D], int8_t output[S][D]);
+// with its own static activation buffers. D and FFN must be multiples of 4;
+// with USE_GEMV_HW, matvecs the block cannot run (D or FFN not 32/64) use the
+// CPU path. Scratch shared by all instances is sized by TINYFORMER_MAX_*,
+// which must cover every listed shape (checked at compile time).
+//
+// Example (EEGFormer‑sized single head):
+//   #define TINYFORMER_SHAPES(X) X(tinyformer_encode_eeg, 81, 32, 64)
+//   #define TINYFORMER_MAX_S 81
+
+#ifndef TINYFORMER_SHAPES_H
+#define TINYFORMER_SHAPES_H
+
+// Distilled model tiers (TINYFORMER_TIERS=1, make TIERS=1; model_tiers.h):
+// the medium and small students of train_tinyformer_uci_har.py --distill
+// become the instances tinyformer_encode_medium / tinyformer_encode_small
+// next to the default (large) shape. The tier list takes the place of a
+// TINYFORMER_SHAPES list; a student's shape must match its training.
+#ifndef TINYFORMER_TIERS
+#define TINYFORMER_TIERS 0
+#endif
+#if TINYFORMER_TIERS
+#ifdef TINYFORMER_SHAPES
+#error "TINYFORMER_TIERS defines TINYFORMER_SHAPES itself"
+#endif
+#ifndef TINYFORMER_TIER_MEDIUM_S
+#define TINYFORMER_TIER_MEDIUM_S   8
+#endif
+#ifndef TINYFORMER_TIER_MEDIUM_D
+#define TINYFORMER_TIER_MEDIUM_D   32
+#endif
+#ifndef TINYFORMER_TIER_MEDIUM_FFN
+#define TINYFORMER_TIER_MEDIUM_FFN 64
+#endif
+#ifndef TINYFORMER_TIER_SMALL_S
+#define TINYFORMER_TIER_SMALL_S    8
+#endif
+#ifndef TINYFORMER_TIER_SMALL_D
+#define TINYFORMER_TIER_SMALL_D    16
+#endif
+#ifndef TINYFORMER_TIER_SMALL_FFN
+#define TINYFORMER_TIER_SMALL_FFN  32
+#endif
+#define TINYFORMER_SHAPES(X)                                                   \
+    X(tinyformer_encode_medium, TINYFORMER_TIER_MEDIUM_S,                      \
+      TINYFORMER_TIER_MEDIUM_D, TINYFORMER_TIER_MEDIUM_FFN)                    \
+    X(tinyformer_encode_small, TINYFORMER_TIER_SMALL_S,                        \
+      TINYFORMER_TIER_SMALL_D, TINYFORMER_TIER_SMALL_FFN)
+#endif
+
+// Benchmark suite (TINYFORMER_BENCH_SUITE=1, make BENCH=1; demo_runner.h):
+// the EEGFormer (S=81, E=32) and ECGFormer (S=66, E=16) shapes of
+// pulp‑transformer/testConfig.yml and a synthetic sweep over S (at D=32)
+// and D (at S=32), next to the default (HAR) shape. The suite takes the
+// place of a TINYFORMER_SHAPES list.
+#ifndef TINYFORMER_BENCH_SUITE
+#define TINYFORMER_BENCH_SUITE 0
+#endif
+#if TINYFORMER_BENCH_SUITE
+#if TINYFORMER_TIERS || defined(TINYFORMER_SHAPES)
+#error "TINYFORMER_BENCH_SUITE defines TINYFORMER_SHAPES itself"
+#endif
+#define TINYFORMER_SHAPES(X)                                                   \
+    X(tinyformer_encode_eeg, 81, 32, 64)                                       \
+    X(tinyformer_encode_ecg, 66, 16, 32)                                       \
+    X(tinyformer_encode_s32_d32, 32, 32, 64)                                   \
+    X(tinyformer_encode_s64_d32, 64, 32, 64)                                   \
+    X(tinyformer_encode_s32_d16, 32, 16, 32)                                   \
+    X(tinyformer_encode_s32_d64, 32, 64, 128)
+#ifndef TINYFORMER_MAX_S
+#define TINYFORMER_MAX_S   81
+#endif
+#ifndef TINYFORMER_MAX_D
+#define TINYFORMER_MAX_D   64
+#endif
+#ifndef TINYFORMER_MAX_FFN
+#define TINYFORMER_MAX_FFN 128
+#endif
+#endif
+
+#ifndef TINYFORMER_SHAPES
+#define TINYFORMER_SHAPES(X)
+#endif
+
+#ifndef TINYFORMER_MAX_S
+#define TINYFORMER_MAX_S   TINYFORMER_S
+#endif
+#ifndef TINYFORMER_MAX_D
+#define TINYFORMER_MAX_D   TINYFORMER_D
+#endif
+#ifndef TINYFORMER_MAX_FFN
+#define TINYFORMER_MAX_FFN TINYFORMER_FFN
+#endif
+
+#endif // TINYFORMER_SHAPES_H
@@ -0,0 +1,128 @@
+// Host SIMD kernels for TinyFormer replay builds (TINYFORMER_HOST_SIMD).
+//
+// Included by tinyformer.c only. One backend is picked from what the compiler
+// targets: AVX2 (-mavx2), SSE4.1 (-msse4.1) or NEON (AArch64 / ARMv7 NEON).
+// All arithmetic is exact integer math in the same widths as the scalar
+// loops, so results are bit‑identical to the RV32 reference:
+//   - int8 products are formed in int16 (|a*b| <= 2^14) and pair‑summed into
+//     int32 (_mm*_madd_epi16, vpadalq_s16). _mm256_maddubs_epi16 is not used:
+//     its int16 pair sums saturate for (-128 * -128) * 2.
+//   - the attention context keeps the per‑term >> 15 of the scalar loop.
+// Integer addition is associative, so lane order does not matter.
+
+#ifndef TINYFORMER_SIMD_H
+#define TINYFORMER_SIMD_H
+
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TF_SIMD_AVX2 1
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define TF_SIMD_SSE41 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TF_SIMD_NEON 1
+#else
+#error "TINYFORMER_HOST_SIMD needs AVX2, SSE4.1 or NEON (e.g. -march=native)"
+#endif
+
+// sum_i a[i] * b[i], any n.
+static inline int32_t tf_simd_dot_i8(const int8_t *a, const int8_t *b, int32_t n)
+{
+    int32_t i = 0;
+    int32_t acc;
+#if defined(TF_SIMD_AVX2)
+    __m256i vacc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&a[i]));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&b[i]));
+        vacc = _mm256_add_epi32(vacc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(vacc), _mm256_extracti128_si256(vacc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    acc = _mm_cvtsi128_si32(s);
+#elif defined(TF_SIMD_SSE41)
+    __m128i vacc = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        __m128i va = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i *)&a[i]));
+        __m128i vb = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i *)&b[i]));
+        vacc = _mm_add_epi32(vacc, _mm_madd_epi16(va, vb));
+    }
+    vacc = _mm_add_epi32(vacc, _mm_shuffle_epi32(vacc, _MM_SHUFFLE(1, 0, 3, 2)));
+    vacc = _mm_add_epi32(vacc, _mm_shuffle_epi32(vacc, _MM_SHUFFLE(2, 3, 0, 1)));
+    acc = _mm_cvtsi128_si32(vacc);
+#else
+    int32x4_t vacc = vdupq_n_s32(0);
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(&a[i]);
+        int8x16_t vb = vld1q_s8(&b[i]);
+        vacc = vpadalq_s16(vacc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        vacc = vpadalq_s16(vacc, vmull_s8(vget_high_s8(va), vget_high_s8(vb)));
+    }
+    acc = vgetq_lane_s32(vacc, 0) + vgetq_lane_s32(vacc, 1) +
+          vgetq_lane_s32(vacc, 2) + vgetq_lane_s32(vacc, 3);
+#endif
+    for (; i < n; ++i) {
+        acc += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return acc;
+}
+
+// Attention context of one query and head (step 4 of attention_multi_head):
+//   acc[d] = sum_j (w[j] * v[j][d]) >> 15,  d < D (the head's channels), v
+// rows ld apart
+// w are Q15 weights <= 32768, so each product fits int32 and the shift is
+// applied per term as in the scalar loop.
+static inline void tf_simd_context(
+    const uint16_t *w,    // [S]
+    const int8_t   *v,    // [S][ld]
+    int32_t        *acc,  // [D]
+    int32_t         S,
+    int32_t         D,
+    int32_t         ld)
+{
+    int32_t j, d;
+    for (d = 0; d < D; ++d) {
+        acc[d] = 0;
+    }
+    for (j = 0; j < S; ++j) {
+        const int8_t *v_row = &v[j * ld];
+        d = 0;
+#if defined(TF_SIMD_AVX2)
+        const __m256i wj = _mm256_set1_epi32((int32_t)w[j]);
+        for (; d + 8 <= D; d += 8) {
+            __m256i vv = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&v_row[d]));
+            __m256i t = _mm256_srai_epi32(_mm256_mullo_epi32(wj, vv), 15);
+            __m256i a = _mm256_loadu_si256((const __m256i *)&acc[d]);
+            _mm256_storeu_si256((__m256i *)&acc[d], _mm256_add_epi32(a, t));
+        }
+#elif defined(TF_SIMD_SSE41)
+        const __m128i wj = _mm_set1_epi32((int32_t)w[j]);
+        for (; d + 4 <= D; d += 4) {
+            int32_t v4;
+            __builtin_memcpy(&v4, &v_row[d], 4);
+            __m128i vv = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(v4));
+            __m128i t = _mm_srai_epi32(_mm_mullo_epi32(wj, vv), 15);
+            __m128i a = _mm_loadu_si128((const __m128i *)&acc[d]);
+            _mm_storeu_si128((__m128i *)&acc[d], _mm_add_epi32(a, t));
+        }
+#else
+        const int32x4_t wj = vdupq_n_s32((int32_t)w[j]);
+        for (; d + 8 <= D; d += 8) {
+            int16x8_t vv = vmovl_s8(vld1_s8(&v_row[d]));
+            int32x4_t lo = vshrq_n_s32(vmulq_s32(wj, vmovl_s16(vget_low_s16(vv))), 15);
+            int32x4_t hi = vshrq_n_s32(vmulq_s32(wj, vmovl_s16(vget_high_s16(vv))), 15);
+            vst1q_s32(&acc[d], vaddq_s32(vld1q_s32(&acc[d]), lo));
+            vst1q_s32(&acc[d + 4], vaddq_s32(vld1q_s32(&acc[d + 4]), hi));
+        }
+#endif
+        for (; d < D; ++d) {
+            acc[d] += ((int32_t)w[j] * (int32_t)v_row[d]) >> 15;
+        }
+    }
+}
+
+#endif // TINYFORMER_SIMD_H
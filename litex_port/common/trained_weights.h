@@ -5,9 +5,28 @@
 
 // Trained TinyFormer encoder weights (generated by tools/export_weights.py)
 
-extern const int8_t W_q[TINYFORMER_D][TINYFORMER_D];
-extern const int8_t W_k[TINYFORMER_D][TINYFORMER_D];
-extern const int8_t W_v[TINYFORMER_D][TINYFORMER_D];
+// Block-sparse tables are available (TINYFORMER_BLOCK_SPARSE).
+#define TRAINED_WEIGHTS_BLOCK_SPARSE 1
+
+// W_q/W_k/W_v keep their first input channels only; the others are dead.
+#define TRAINED_WEIGHTS_D_IN 16
+
+// Fused-weight attention arrays are available (TINYFORMER_FWA).
+#define TRAINED_WEIGHTS_FWA 1
+#define TRAINED_WEIGHTS_QK_SHIFT 14
+
+// GEMV block layouts are available (TINYFORMER_GEMV_NATIVE).
+#define TRAINED_WEIGHTS_GEMV_NATIVE 1
+
+// Column-major W_ff2 is available (TINYFORMER_FFN_GATHER).
+#define TRAINED_WEIGHTS_FF2_COLS 1
+
+// Attention heads of the trained model (must match TINYFORMER_HEADS).
+#define TRAINED_WEIGHTS_HEADS 1
+
+extern const int8_t W_q[TINYFORMER_D][TRAINED_WEIGHTS_D_IN];
+extern const int8_t W_k[TINYFORMER_D][TRAINED_WEIGHTS_D_IN];
+extern const int8_t W_v[TINYFORMER_D][TRAINED_WEIGHTS_D_IN];
 extern const int8_t W_o[TINYFORMER_D][TINYFORMER_D];
 
 extern const int8_t W_ff1[TINYFORMER_FFN][TINYFORMER_D];
@@ -21,4 +40,84 @@ extern const int8_t b_o[TINYFORMER_D];
 extern const int8_t b_ff1[TINYFORMER_FFN];
 extern const int8_t b_ff2[TINYFORMER_D];
 
+#if TINYFORMER_PACKED_WEIGHTS
+// Word-packed copies: 4 int8 lanes per word, dot8_pack() lane order.
+extern const uint32_t W_q_packed[TINYFORMER_D][TRAINED_WEIGHTS_D_IN / 4];
+extern const uint32_t W_k_packed[TINYFORMER_D][TRAINED_WEIGHTS_D_IN / 4];
+extern const uint32_t W_v_packed[TINYFORMER_D][TRAINED_WEIGHTS_D_IN / 4];
+extern const uint32_t W_o_packed[TINYFORMER_D][TINYFORMER_D / 4];
+extern const uint32_t W_ff1_packed[TINYFORMER_FFN][TINYFORMER_D / 4];
+extern const uint32_t W_ff2_packed[TINYFORMER_D][TINYFORMER_FFN / 4];
+#endif
+
+#if TINYFORMER_FUSED_QKV
+// Fused QKV block: rows [0,D) = W_q, [D,2D) = W_k, [2D,3D) = W_v.
+extern const int8_t W_qkv[3 * TINYFORMER_D][TRAINED_WEIGHTS_D_IN];
+extern const int8_t b_qkv[3 * TINYFORMER_D];
+#if TINYFORMER_PACKED_WEIGHTS
+extern const uint32_t W_qkv_packed[3 * TINYFORMER_D][TRAINED_WEIGHTS_D_IN / 4];
+#endif
+#endif
+
+#if TINYFORMER_FWA
+// Fused-weight attention: g = (W_qk x + b_qk) >> TRAINED_WEIGHTS_QK_SHIFT.
+extern const int8_t W_qk[TRAINED_WEIGHTS_D_IN][TRAINED_WEIGHTS_D_IN];
+extern const int32_t b_qk[TRAINED_WEIGHTS_D_IN];
+#if TINYFORMER_PACKED_WEIGHTS
+extern const uint32_t W_qk_packed[TRAINED_WEIGHTS_D_IN][TRAINED_WEIGHTS_D_IN / 4];
+#endif
+#endif
+
+#if TINYFORMER_FFN_GATHER
+// W_ff2 transposed: row k holds the weights of hidden unit k.
+extern const int8_t W_ff2_cols[TINYFORMER_FFN][TINYFORMER_D];
+#endif
+
+#if TINYFORMER_BLOCK_SPARSE
+// Block-sparse rows: non-zero 4-wide blocks, see tinyformer_sparse_t.
+extern const uint16_t sp_row_q[TINYFORMER_D + 1];
+extern const uint8_t sp_block_q[];
+extern const uint32_t sp_w_q[];
+extern const uint16_t sp_row_k[TINYFORMER_D + 1];
+extern const uint8_t sp_block_k[];
+extern const uint32_t sp_w_k[];
+extern const uint16_t sp_row_v[TINYFORMER_D + 1];
+extern const uint8_t sp_block_v[];
+extern const uint32_t sp_w_v[];
+extern const uint16_t sp_row_o[TINYFORMER_D + 1];
+extern const uint8_t sp_block_o[];
+extern const uint32_t sp_w_o[];
+extern const uint16_t sp_row_ff1[TINYFORMER_FFN + 1];
+extern const uint8_t sp_block_ff1[];
+extern const uint32_t sp_w_ff1[];
+extern const uint16_t sp_row_ff2[TINYFORMER_D + 1];
+extern const uint8_t sp_block_ff2[];
+extern const uint32_t sp_w_ff2[];
+#if TINYFORMER_FUSED_QKV
+extern const uint16_t sp_row_qkv[3 * TINYFORMER_D + 1];
+extern const uint8_t sp_block_qkv[];
+extern const uint32_t sp_w_qkv[];
+#endif
+#endif
+
+#if TINYFORMER_GEMV_NATIVE
+// GEMV layouts: int32 B_IN biases, pre-tiled W_IN4 words (gemv_matvec_tiles()).
+extern const int32_t gemv_b_q[TINYFORMER_D];
+extern const uint32_t gemv_w_q[];
+extern const int32_t gemv_b_k[TINYFORMER_D];
+extern const uint32_t gemv_w_k[];
+extern const int32_t gemv_b_v[TINYFORMER_D];
+extern const uint32_t gemv_w_v[];
+extern const int32_t gemv_b_o[TINYFORMER_D];
+extern const int32_t gemv_b_ff1[TINYFORMER_FFN];
+extern const int32_t gemv_b_ff2[TINYFORMER_D];
+#if TINYFORMER_FUSED_QKV
+extern const int32_t gemv_b_qkv[3 * TINYFORMER_D];
+extern const uint32_t gemv_w_qkv[];
+#endif
+#if TINYFORMER_FWA
+extern const uint32_t gemv_w_qk[];
+#endif
+#endif
+
 #endif // TRAINED_WEIGHTS_H
@@ -0,0 +1,120 @@
+/*
+ * Framed binary UART protocol (uart_frame.h): COBS framing and CRC-16 on
+ * top of the blocking byte API of uart_litex.h.
+ */
+#include "uart_frame.h"
+#include "uart_litex.h"
+#include <stdint.h>
+
+uint16_t uf_crc16(uint16_t crc, const void *data, uint32_t n) {
+  const uint8_t *p = (const uint8_t *)data;
+  for (uint32_t i = 0; i < n; ++i) {
+    crc ^= (uint16_t)((uint16_t)p[i] << 8);
+    for (int k = 0; k < 8; ++k) {
+      crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+void uf_rx_reset(uf_rx_t *rx) {
+  rx->len = 0;
+  rx->code = 0xFF; /* no zero before the first block */
+  rx->left = 0;
+  rx->overflow = 0;
+}
+
+static void rx_put(uf_rx_t *rx, uint8_t b) {
+  if (rx->len < sizeof(rx->buf)) {
+    rx->buf[rx->len++] = b;
+  } else {
+    rx->overflow = 1;
+  }
+}
+
+int uf_rx_byte(uf_rx_t *rx, uint8_t b) {
+  if (b != 0) {
+    if (rx->left == 0) {
+      /* Code byte: a block shorter than 254 bytes ended in a zero. */
+      if (rx->code != 0xFF) {
+        rx_put(rx, 0);
+      }
+      rx->code = b;
+      rx->left = (uint8_t)(b - 1);
+    } else {
+      rx_put(rx, b);
+      rx->left--;
+    }
+    return 0;
+  }
+
+  /* Delimiter: the frame ends (its last block has no trailing zero). */
+  uint32_t len = rx->len;
+  int truncated = rx->left != 0;
+  int overflow = rx->overflow;
+  uf_rx_reset(rx);
+  if (len == 0 && !truncated && !overflow) {
+    return 0;
+  }
+  if (overflow) {
+    return -UF_E_OVERFLOW;
+  }
+  if (truncated || len < 4) {
+    return -UF_E_LENGTH;
+  }
+  uint16_t crc = (uint16_t)(rx->buf[len - 2] | (rx->buf[len - 1] << 8));
+  if (uf_crc16(0xFFFFu, rx->buf, len - 2) != crc) {
+    return -UF_E_CRC;
+  }
+  return (int)(len - 2);
+}
+
+int uf_recv(uf_rx_t *rx) {
+  for (;;) {
+    int n = uf_rx_byte(rx, (uint8_t)uart_read_char());
+    if (n != 0) {
+      return n;
+    }
+  }
+}
+
+/* COBS-encode p[0..n) to the UART: blocks of up to 254 non-zero bytes, each
+ * led by its length + 1; a shorter block stands for its data and a zero. */
+static void tx_cobs(const uint8_t *p, uint32_t n) {
+  uint32_t i = 0;
+  for (;;) {
+    uint32_t run = 0;
+    while (i + run < n && p[i + run] != 0 && run < 254) {
+      run++;
+    }
+    uart_write_char((char)(run + 1));
+    for (uint32_t k = 0; k < run; ++k) {
+      uart_write_char((char)p[i + k]);
+    }
+    i += run;
+    if (i == n) {
+      break;
+    }
+    if (run < 254) {
+      i++; /* the zero this block stands for */
+    }
+  }
+}
+
+void uf_send(uint8_t type, uint8_t seq, const void *body, uint32_t n) {
+  static uint8_t tx[UF_MAX_PAYLOAD + 2];
+  const uint8_t *b = (const uint8_t *)body;
+  if (n > UF_MAX_BODY) {
+    n = UF_MAX_BODY;
+  }
+  tx[0] = type;
+  tx[1] = seq;
+  for (uint32_t i = 0; i < n; ++i) {
+    tx[2 + i] = b[i];
+  }
+  uint16_t crc = uf_crc16(0xFFFFu, tx, n + 2);
+  tx[n + 2] = (uint8_t)crc;
+  tx[n + 3] = (uint8_t)(crc >> 8);
+  tx_cobs(tx, n + 4);
+  uart_write_char(0);
+}
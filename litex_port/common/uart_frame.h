@@ -0,0 +1,78 @@
+// Framed binary UART protocol: window tensors in, predictions and logits out.
+//
+// Each frame on the wire is COBS(payload || CRC-16) followed by a 0x00
+// delimiter, so a receiver resynchronises at the next 0x00 after a lost or
+// corrupted byte. payload = type (UF_T_*), seq (echoed in the reply), body.
+// The CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of the payload,
+// sent little-endian; multi-byte body fields are little-endian too.
+//
+// Requests (host -> board) and replies (board -> host):
+//   UF_T_HELLO   (empty)                 UF_T_INFO   version u8, S u8, D u8,
+//                                                    n_classes u8, max_body u16,
+//                                                    model u8 (1: blob), 0 u8
+//   UF_T_WINDOW  int8 [S][D]             UF_T_RESULT pred u8, n_classes u8, 0 u16,
+//                                                    enc_cksum u32, cycles u32,
+//                                                    logits int32 [n_classes]
+//   UF_T_STOP    (empty)                 UF_T_ACK    (empty), then demo_proto_run()
+//                                                    returns
+// A bad frame or request is answered with UF_T_ERROR, body = UF_E_* code
+// (seq 0 if the frame did not decode). The host driver is
+// scripts/uart_frame_host.py.
+
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+#define UF_VERSION 1
+
+// Largest request / reply body: one window.
+#ifndef UF_MAX_BODY
+#define UF_MAX_BODY (TINYFORMER_S * TINYFORMER_D)
+#endif
+#define UF_MAX_PAYLOAD (2 + UF_MAX_BODY)
+
+enum {
+  UF_T_HELLO = 0x01,
+  UF_T_WINDOW = 0x02,
+  UF_T_STOP = 0x03,
+  UF_T_INFO = 0x81,
+  UF_T_RESULT = 0x82,
+  UF_T_ACK = 0x83,
+  UF_T_ERROR = 0xFF
+};
+
+enum {
+  UF_E_CRC = 1,      // CRC mismatch
+  UF_E_LENGTH = 2,   // frame too short, or wrong body size for its type
+  UF_E_TYPE = 3,     // unknown request type
+  UF_E_OVERFLOW = 4  // frame longer than UF_MAX_PAYLOAD
+};
+
+// Incremental COBS decoder of one frame.
+typedef struct {
+  uint8_t buf[UF_MAX_PAYLOAD + 2]; // decoded payload and CRC
+  uint32_t len;                    // decoded bytes so far
+  uint8_t code;                    // code byte of the current block
+  uint8_t left;                    // data bytes left in the current block
+  uint8_t overflow;                // frame exceeded buf
+} uf_rx_t;
+
+void uf_rx_reset(uf_rx_t *rx);
+
+// Feed one received byte. Returns the payload length (>= 2; payload in
+// rx->buf) when a frame with a good CRC ends, -UF_E_* when a bad one ends,
+// 0 otherwise (empty frames are skipped).
+int uf_rx_byte(uf_rx_t *rx, uint8_t b);
+
+// Blocking receive with uart_read_char(); same results as uf_rx_byte().
+int uf_recv(uf_rx_t *rx);
+
+// Send one frame (n <= UF_MAX_BODY) with uart_write_char().
+void uf_send(uint8_t type, uint8_t seq, const void *body, uint32_t n);
+
+// CRC-16/CCITT-FALSE over n bytes, continuing from crc (0xFFFF to start).
+uint16_t uf_crc16(uint16_t crc, const void *data, uint32_t n);
+
+#endif /* UART_FRAME_H */
@@ -0,0 +1,119 @@
+// Compressed weight images: streaming canonical‑Huffman decoder (weight_codec.h).
+
+#include "weight_codec.h"
+#include "model_blob.h"
+#include <stdint.h>
+
+_Static_assert(sizeof(tf_wz_header_t) == 48, "weight_codec: header layout");
+
+int tf_wz_open(tf_wz_t *z, const void *image, uint32_t bytes)
+{
+    const tf_wz_header_t *h = (const tf_wz_header_t *)image;
+    uint32_t n = 0;
+    int32_t left = 1;
+    int len;
+
+    if (h == 0 || ((uintptr_t)h & 3u) != 0 || bytes < sizeof(*h) ||
+        h->magic != TF_WZ_MAGIC || h->version != TF_WZ_VERSION ||
+        h->mode > TF_WZ_DELTA || h->row_bytes == 0 || h->total_bytes > bytes ||
+        h->n_symbols == 0 || h->n_symbols > 256u ||
+        h->total_bytes < sizeof(*h) + h->n_symbols) {
+        return -1;
+    }
+    // The lengths must not over‑subscribe the code space (Kraft); a single
+    // symbol may leave it incomplete.
+    for (len = 0; len < TF_WZ_MAX_LEN; ++len) {
+        left = 2 * left - (int32_t)h->count[len];
+        n += h->count[len];
+        if (left < 0) {
+            return -1;
+        }
+    }
+    if (n != h->n_symbols) {
+        return -1;
+    }
+    z->header = h;
+    z->symbol = (const uint8_t *)image + sizeof(*h);
+    z->p = z->symbol + h->n_symbols;
+    z->end = (const uint8_t *)image + h->total_bytes;
+    z->bits = 0;
+    z->n_bits = 0;
+    z->left = h->raw_bytes;
+    z->error = 0;
+    return 0;
+}
+
+// Next symbol: the code is walked bit by bit against the first code of
+// each length, so no table is built. Returns -1 past the code bits or on an
+// unused code.
+static int tf_wz_symbol(tf_wz_t *z)
+{
+    const uint16_t *count = z->header->count;
+    int32_t code = 0, first = 0, index = 0;
+    int len;
+
+    for (len = 0; len < TF_WZ_MAX_LEN; ++len) {
+        if (z->n_bits == 0) {
+            while (z->n_bits <= 24 && z->p < z->end) {
+                z->bits |= (uint32_t)*z->p++ << z->n_bits;
+                z->n_bits += 8;
+            }
+            if (z->n_bits == 0) {
+                return -1;
+            }
+        }
+        code |= (int32_t)(z->bits & 1u);
+        z->bits >>= 1;
+        z->n_bits--;
+        if (code - (int32_t)count[len] < first) {
+            return z->symbol[index + (code - first)];
+        }
+        index += count[len];
+        first = (first + count[len]) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+uint32_t tf_wz_row(tf_wz_t *z, uint8_t *dst)
+{
+    const uint32_t n = (z->left < z->header->row_bytes) ? z->left : z->header->row_bytes;
+    const int delta = z->header->mode == TF_WZ_DELTA;
+    uint8_t prev = 0;
+    uint32_t i;
+
+    if (z->error) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        int s = tf_wz_symbol(z);
+        if (s < 0) {
+            z->error = 1;
+            return 0;
+        }
+        prev = delta ? (uint8_t)(prev + (uint8_t)s) : (uint8_t)s;
+        dst[i] = prev;
+    }
+    z->left -= n;
+    return n;
+}
+
+int32_t tf_wz_decode(const void *image, uint32_t bytes, void *dst, uint32_t dst_bytes)
+{
+    uint8_t *out = (uint8_t *)dst;
+    tf_wz_t z;
+    uint32_t n;
+
+    if (tf_wz_open(&z, image, bytes) != 0 || z.header->raw_bytes > dst_bytes ||
+        z.header->raw_bytes > 0x7FFFFFFFu) {
+        return -1;
+    }
+    while ((n = tf_wz_row(&z, out)) != 0) {
+        out += n;
+    }
+    if (z.error || z.left != 0 ||
+        tf_blob_crc32(0, dst, z.header->raw_bytes) != z.header->crc32) {
+        return -1;
+    }
+    return (int32_t)z.header->raw_bytes;
+}
@@ -0,0 +1,84 @@
+// Compressed weight images: canonical Huffman over the bytes of a weight
+// image (optionally delta‑coded per row), expanded one row at a time.
+//
+// SPI‑flash reads and UART updates move bytes, not MACs: trained int8
+// weights are far from uniform (the checked‑in layer is mostly zeros), so
+// an entropy‑coded image is several times smaller than the raw one. The
+// decoder streams it sequentially with a 32‑bit bit buffer and writes each
+// row straight into its destination: the word‑packed layer buffers of the
+// weight store (weight_store.h, tf_store_init_compressed), which the DOT8
+// and packed kernels read as is, or the GEMV W port, e.g.
+//   tf_wz_t z;
+//   uint8_t row[32] __attribute__((aligned(4)));
+//   tf_wz_open(&z, image, bytes);                    // row_bytes 32
+//   gemv_clear_done();
+//   for (r = 0; r < TINYFORMER_D; ++r) {             // W_q, first in a layer image
+//       tf_wz_row(&z, row);
+//       gemv_load_w((const int8_t *)row, 1, 32);     // W_IN keeps advancing
+//   }
+//   gemv_invalidate_w();                             // row is not the matrix
+//
+// Layout (little‑endian, written by tools/weight_codec.py):
+//   tf_wz_header_t
+//   uint8_t symbol[n_symbols]      byte values in canonical code order
+//   code bits                      up to total_bytes (a multiple of 4)
+// Codes are canonical (shorter first, then by symbol order) with count[n]
+// codes of n + 1 bits, and are read MSB first, from the LSB of each byte up.
+// In TF_WZ_DELTA images a code is the byte minus the previous byte of its
+// row (mod 256); every row_bytes bytes start from 0.
+
+#ifndef WEIGHT_CODEC_H
+#define WEIGHT_CODEC_H
+
+#include <stdint.h>
+
+#define TF_WZ_MAGIC   0x5A574654u  // "TFWZ"
+#define TF_WZ_VERSION 1u
+#define TF_WZ_MAX_LEN 12           // longest code in bits
+
+// tf_wz_header_t.mode
+enum {
+    TF_WZ_PLAIN = 0,  // codes are the bytes
+    TF_WZ_DELTA = 1   // codes are per‑row byte differences
+};
+
+typedef struct {
+    uint32_t magic;                  // TF_WZ_MAGIC
+    uint16_t version;                // TF_WZ_VERSION
+    uint8_t  mode;                   // TF_WZ_PLAIN / TF_WZ_DELTA
+    uint8_t  reserved;               // 0
+    uint32_t raw_bytes;              // decoded size
+    uint32_t total_bytes;            // whole image, header included
+    uint32_t crc32;                  // of the decoded bytes (tf_blob_crc32)
+    uint16_t row_bytes;              // tf_wz_row() chunk and delta row, >= 1
+    uint16_t n_symbols;              // sum of count[], 1 ... 256
+    uint16_t count[TF_WZ_MAX_LEN];   // codes of 1 ... TF_WZ_MAX_LEN bits
+} tf_wz_header_t;
+
+// Decoder state of one image.
+typedef struct {
+    const tf_wz_header_t *header;
+    const uint8_t        *symbol;
+    const uint8_t        *p, *end;   // next code byte, end of the image
+    uint32_t              bits;      // buffered code bits, next in bit 0
+    int                   n_bits;
+    uint32_t              left;      // raw bytes not yet decoded
+    int                   error;     // corrupt code bits seen
+} tf_wz_t;
+
+// Validate the header and code table of image (bytes available, 4‑byte
+// aligned) and rewind z to its first row. Returns 0, or -1 if image is not
+// a consistent compressed image. The code bits and crc32 are not checked.
+int tf_wz_open(tf_wz_t *z, const void *image, uint32_t bytes);
+
+// Decode the next row (row_bytes, fewer for the last one) into dst. Returns
+// the bytes written, or 0 at the end of the image or on corrupt code bits
+// (z->error set; dst then holds garbage).
+uint32_t tf_wz_row(tf_wz_t *z, uint8_t *dst);
+
+// Decode the whole image into dst (dst_bytes available) and check its
+// crc32. Returns raw_bytes, or -1 for a bad image, a short dst, corrupt code
+// bits or a CRC mismatch.
+int32_t tf_wz_decode(const void *image, uint32_t bytes, void *dst, uint32_t dst_bytes);
+
+#endif // WEIGHT_CODEC_H
@@ -0,0 +1,214 @@
+// SPI‑flash weight store: double‑buffered layer streaming (weight_store.h).
+
+#include "weight_store.h"
+#include "weight_codec.h"
+#include <stdint.h>
+
+#if !TINYFORMER_INT4_WEIGHTS
+
+// Offsets inside one layer image.
+#define TF_STORE_DD   (TINYFORMER_D * TINYFORMER_D)
+#define TF_STORE_FD   (TINYFORMER_FFN * TINYFORMER_D)
+#define TF_STORE_OFF_W_Q   0
+#define TF_STORE_OFF_W_K   (TF_STORE_OFF_W_Q + TF_STORE_DD)
+#define TF_STORE_OFF_W_V   (TF_STORE_OFF_W_K + TF_STORE_DD)
+#define TF_STORE_OFF_W_O   (TF_STORE_OFF_W_V + TF_STORE_DD)
+#define TF_STORE_OFF_W_FF1 (TF_STORE_OFF_W_O + TF_STORE_DD)
+#define TF_STORE_OFF_W_FF2 (TF_STORE_OFF_W_FF1 + TF_STORE_FD)
+#define TF_STORE_OFF_B_Q   (TF_STORE_OFF_W_FF2 + TF_STORE_FD)
+#define TF_STORE_OFF_B_K   (TF_STORE_OFF_B_Q + TINYFORMER_D)
+#define TF_STORE_OFF_B_V   (TF_STORE_OFF_B_K + TINYFORMER_D)
+#define TF_STORE_OFF_B_O   (TF_STORE_OFF_B_V + TINYFORMER_D)
+#define TF_STORE_OFF_B_FF1 (TF_STORE_OFF_B_O + TINYFORMER_D)
+#define TF_STORE_OFF_B_FF2 (TF_STORE_OFF_B_FF1 + TINYFORMER_FFN)
+
+_Static_assert(TF_STORE_OFF_B_FF2 + TINYFORMER_D <= TF_STORE_LAYER_BYTES,
+               "weight_store: layer image layout exceeds TF_STORE_LAYER_BYTES");
+
+void tf_store_copy(void *dst, const void *src, uint32_t bytes)
+{
+    uint32_t *d = (uint32_t *)dst;
+    const uint32_t *s = (const uint32_t *)src;
+    uint32_t i;
+    for (i = 0; i < bytes / 4u; ++i) {
+        d[i] = s[i];
+    }
+}
+
+static void tf_store_view(tinyformer_weights_t *w, const uint8_t *b)
+{
+#define TF_STORE_W(off) ((const tinyformer_wword_t *)(const void *)&b[off])
+#define TF_STORE_B(off) ((const int8_t *)&b[off])
+    w->W_q   = TF_STORE_W(TF_STORE_OFF_W_Q);
+    w->W_k   = TF_STORE_W(TF_STORE_OFF_W_K);
+    w->W_v   = TF_STORE_W(TF_STORE_OFF_W_V);
+    w->W_o   = TF_STORE_W(TF_STORE_OFF_W_O);
+    w->W_ff1 = TF_STORE_W(TF_STORE_OFF_W_FF1);
+    w->W_ff2 = TF_STORE_W(TF_STORE_OFF_W_FF2);
+    w->b_q   = TF_STORE_B(TF_STORE_OFF_B_Q);
+    w->b_k   = TF_STORE_B(TF_STORE_OFF_B_K);
+    w->b_v   = TF_STORE_B(TF_STORE_OFF_B_V);
+    w->b_o   = TF_STORE_B(TF_STORE_OFF_B_O);
+    w->b_ff1 = TF_STORE_B(TF_STORE_OFF_B_FF1);
+    w->b_ff2 = TF_STORE_B(TF_STORE_OFF_B_FF2);
+    w->W_qkv = 0;
+    w->b_qkv = 0;
+    w->rq    = 0;
+    w->sparse = 0;
+    w->lowrank = 0;
+    w->d_in  = 0;
+    w->W_qk  = 0;
+    w->b_qk  = 0;
+    w->qk_shift = 0;
+    w->W_ff2_cols = 0;
+#undef TF_STORE_W
+#undef TF_STORE_B
+}
+
+int tf_store_init(tf_store_t *st, const void *image, int n_layers,
+                  void *buf0, void *buf1)
+{
+    int i;
+    if (image == 0 || n_layers < 1 || buf0 == 0 || buf1 == 0 ||
+        (((uintptr_t)buf0 | (uintptr_t)buf1 | (uintptr_t)image) & 3u) != 0) {
+        return -1;
+    }
+    st->image = (const uint8_t *)image;
+    st->n_layers = n_layers;
+    st->compressed = 0;
+    st->buf[0] = (uint8_t *)buf0;
+    st->buf[1] = (uint8_t *)buf1;
+    for (i = 0; i < 2; ++i) {
+        tf_store_view(&st->w[i], st->buf[i]);
+        st->held[i] = -1;
+    }
+    return 0;
+}
+
+int tf_store_init_compressed(tf_store_t *st, const void *image, uint32_t bytes, int n_layers,
+                             void *buf0, void *buf1)
+{
+    const uint8_t *p = (const uint8_t *)image;
+    uint32_t off = 0;
+    int l;
+
+    if (tf_store_init(st, image, n_layers, buf0, buf1) != 0) {
+        return -1;
+    }
+    for (l = 0; l < n_layers; ++l) {
+        const tf_wz_header_t *h;
+        if (off >= bytes) {
+            return -1;
+        }
+        h = (const tf_wz_header_t *)(const void *)&p[off];
+        if (tf_wz_decode(h, bytes - off, buf0, TF_STORE_LAYER_BYTES) != TF_STORE_LAYER_BYTES) {
+            return -1;
+        }
+        off += h->total_bytes;
+    }
+    st->compressed = 1;
+    return 0;
+}
+
+// Compressed layer: walk the (validated) image headers to the layer and
+// expand its rows into dst.
+static void tf_store_expand(const tf_store_t *st, uint8_t *dst, int layer)
+{
+    const uint8_t *p = st->image;
+    tf_wz_t z;
+    uint32_t n;
+    int l;
+
+    for (l = 0; l < layer; ++l) {
+        p += ((const tf_wz_header_t *)(const void *)p)->total_bytes;
+    }
+    tf_wz_open(&z, p, ((const tf_wz_header_t *)(const void *)p)->total_bytes);
+    while ((n = tf_wz_row(&z, dst)) != 0) {
+        dst += n;
+    }
+}
+
+static void tf_store_load(tf_store_t *st, int layer)
+{
+    int i = layer & 1;
+    if (st->held[i] != layer) {
+        if (st->compressed) {
+            tf_store_expand(st, st->buf[i], layer);
+        } else {
+            TF_STORE_COPY_BEGIN(st->buf[i],
+                                &st->image[(uint32_t)layer * TF_STORE_LAYER_BYTES],
+                                TF_STORE_LAYER_BYTES);
+        }
+        st->held[i] = layer;
+    }
+}
+
+const tinyformer_weights_t *tf_store_layer(void *store, int layer)
+{
+    tf_store_t *st = (tf_store_t *)store;
+
+    tf_store_load(st, layer);  // no‑op unless layer 0 or a skipped prefetch
+    TF_STORE_COPY_WAIT();
+    // buf[(layer + 1) & 1] ran layer - 1, which is done.
+    if (layer + 1 < st->n_layers) {
+        tf_store_load(st, layer + 1);
+    }
+    return &st->w[layer & 1];
+}
+
+const tinyformer_weights_t *tf_store_layer_xip(void *store, int layer)
+{
+    tf_store_t *st = (tf_store_t *)store;
+
+    if (st->compressed) {
+        return tf_store_layer(store, layer);
+    }
+    tf_store_view(&st->xip, &st->image[(uint32_t)layer * TF_STORE_LAYER_BYTES]);
+    return &st->xip;
+}
+
+void tf_store_stack_encode(
+    tf_store_t  *st,
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int8_t       output[TINYFORMER_S][TINYFORMER_D])
+{
+    tinyformer_stack_encode_src(tf_store_layer, st, st->n_layers, input, output);
+}
+
+void tf_store_pack_layer(uint8_t dst[TF_STORE_LAYER_BYTES], const tinyformer_weights_t *w)
+{
+    static const struct {
+        uint32_t off, bytes;
+    } part[] = {
+        {TF_STORE_OFF_W_Q, TF_STORE_DD},      {TF_STORE_OFF_W_K, TF_STORE_DD},
+        {TF_STORE_OFF_W_V, TF_STORE_DD},      {TF_STORE_OFF_W_O, TF_STORE_DD},
+        {TF_STORE_OFF_W_FF1, TF_STORE_FD},    {TF_STORE_OFF_W_FF2, TF_STORE_FD},
+        {TF_STORE_OFF_B_Q, TINYFORMER_D},     {TF_STORE_OFF_B_K, TINYFORMER_D},
+        {TF_STORE_OFF_B_V, TINYFORMER_D},     {TF_STORE_OFF_B_O, TINYFORMER_D},
+        {TF_STORE_OFF_B_FF1, TINYFORMER_FFN}, {TF_STORE_OFF_B_FF2, TINYFORMER_D},
+    };
+    const void *src[12] = {w->W_q, w->W_k, w->W_v, w->W_o, w->W_ff1, w->W_ff2,
+                           w->b_q, w->b_k, w->b_v, w->b_o, w->b_ff1, w->b_ff2};
+    // Narrowed Q/K/V rows (w->d_in) are zero‑padded back to D columns.
+    const uint32_t d_in = (w->d_in > 0 && w->d_in < TINYFORMER_D) ? (uint32_t)w->d_in
+                                                                   : TINYFORMER_D;
+    uint32_t i, j;
+
+    for (i = 0; i < TF_STORE_LAYER_BYTES; ++i) {
+        dst[i] = 0;
+    }
+    for (i = 0; i < 12; ++i) {
+        const uint8_t *s = (const uint8_t *)src[i];
+        for (j = 0; j < part[i].bytes; ++j) {
+            if (i < 3) {
+                if (j % TINYFORMER_D < d_in) {
+                    dst[part[i].off + j] = s[j / TINYFORMER_D * d_in + j % TINYFORMER_D];
+                }
+                continue;
+            }
+            dst[part[i].off + j] = s[j];
+        }
+    }
+}
+
+#endif // !TINYFORMER_INT4_WEIGHTS
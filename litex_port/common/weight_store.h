@@ -0,0 +1,123 @@
+// SPI‑flash weight store for multi‑layer TinyFormer stacks.
+//
+// The layers stay in the board's SPI flash, which LiteX memory‑maps at
+// SPIFLASH_BASE (execute‑in‑place reads). A store streams them through two
+// layer buffers in SRAM: while layer l runs from one buffer, layer l + 1 is
+// loaded into the other. Every matvec then reads SRAM instead of issuing XIP
+// refills (each weight matrix is read once per token), and the model is
+// never copied into SDRAM at boot.
+//
+// Image layout (tools/export_weights.py --flash-image): n_layers back‑to‑back
+// layer images of TF_STORE_LAYER_BYTES, each
+//   W_q, W_k, W_v, W_o [D][D], W_ff1 [FFN][D], W_ff2 [D][FFN]   int8
+//   b_q, b_k, b_v, b_o [D], b_ff1 [FFN], b_ff2 [D]             int8
+// in default‑shape row‑major order. On little‑endian RV32 the int8 rows are
+// byte‑identical to the packed uint32 words, so one image serves the int8 and
+// TINYFORMER_PACKED_WEIGHTS kernels. Fused QKV and per‑channel requant are
+// not stored (the layers use the separate projections and >> 7 requant).
+//
+// A compressed image (tools/weight_codec.py, export_weights.py --compress)
+// holds the layer images as back‑to‑back weight_codec.h images instead:
+// tf_store_init_compressed() attaches it and every layer load expands the
+// layer row by row into its buffer, so the flash delivers only the
+// compressed bytes. The CPU decodes, so with a DMA TF_STORE_COPY_BEGIN the
+// load of a compressed layer still does not overlap compute.
+//
+// Usage:
+//   static uint8_t buf[2][TF_STORE_LAYER_BYTES] __attribute__((aligned(4)));
+//   tf_store_t st;
+//   tf_store_init(&st, TF_STORE_FLASH_IMAGE, n_layers, buf[0], buf[1]);
+//   tf_store_stack_encode(&st, input, output);
+
+#ifndef WEIGHT_STORE_H
+#define WEIGHT_STORE_H
+
+#include "tinyformer.h"
+#include <stdint.h>
+
+// The layer images hold int8 matrices, so int4 builds compile the store out:
+// this header then declares nothing and weight_store.c builds to nothing.
+#if !TINYFORMER_INT4_WEIGHTS
+
+#if TINYFORMER_PACKED_WEIGHTS && defined(__BYTE_ORDER__) &&                  \
+    __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "weight_store: packed kernels need a little-endian target"
+#endif
+
+#define TF_STORE_MATRIX_BYTES                                                  \
+    (4 * TINYFORMER_D * TINYFORMER_D + 2 * TINYFORMER_FFN * TINYFORMER_D)
+#define TF_STORE_BIAS_BYTES (5 * TINYFORMER_D + TINYFORMER_FFN)
+
+// One layer image, padded to a word.
+#define TF_STORE_LAYER_BYTES                                                   \
+    ((TF_STORE_MATRIX_BYTES + TF_STORE_BIAS_BYTES + 3) & ~3)
+
+// Offset of the weight image in the SPI flash (after the bitstream).
+#ifndef TF_STORE_FLASH_OFFSET
+#define TF_STORE_FLASH_OFFSET 0x00400000
+#endif
+
+#if defined(SPIFLASH_BASE)
+#define TF_STORE_FLASH_IMAGE                                                   \
+    ((const void *)(SPIFLASH_BASE + TF_STORE_FLASH_OFFSET))
+#endif
+
+// Split‑phase flash → SRAM copy of one layer. The default copies with the
+// CPU inside TF_STORE_COPY_BEGIN, so the load does not overlap compute; a
+// SoC with a DMA master (LiteX WishboneDMAReader/Writer) can define both to
+// start the transfer and wait for it.
+#ifndef TF_STORE_COPY_BEGIN
+#define TF_STORE_COPY_BEGIN(dst, src, bytes) tf_store_copy((dst), (src), (bytes))
+#define TF_STORE_COPY_WAIT() ((void)0)
+#endif
+
+typedef struct {
+    const uint8_t       *image;        // layer 0 (memory‑mapped flash)
+    int                  n_layers;
+    int                  compressed;   // image of weight_codec.h layer images
+    uint8_t             *buf[2];       // TF_STORE_LAYER_BYTES each, word aligned
+    tinyformer_weights_t w[2];         // views of buf[]
+    int                  held[2];      // layer loaded into buf[i], or -1
+    tinyformer_weights_t xip;          // view of the layer read in place
+} tf_store_t;
+
+// Attach image (n_layers layer images) and the two SRAM layer buffers.
+// Returns 0, or -1 for a null/misaligned buffer or n_layers < 1.
+int tf_store_init(tf_store_t *st, const void *image, int n_layers,
+                  void *buf0, void *buf1);
+
+// Same for a compressed image of bytes bytes holding n_layers layer images.
+// Every layer is expanded once into buf0 and checked (size, CRC), and buf0 is
+// left holding no layer. Returns 0, or -1 as tf_store_init() or if a layer
+// does not decode to TF_STORE_LAYER_BYTES.
+int tf_store_init_compressed(tf_store_t *st, const void *image, uint32_t bytes, int n_layers,
+                             void *buf0, void *buf1);
+
+// tinyformer_layer_fn over a store: waits for layer l, starts loading l + 1
+// into the other buffer and returns the weights of l. A layer still held by
+// its buffer is not loaded again, so stacks of one or two layers stay
+// resident across calls.
+const tinyformer_weights_t *tf_store_layer(void *store, int layer);
+
+// tinyformer_layer_fn reading layer l in place from the image (no SRAM
+// copy; every weight access is a flash read through the D‑cache). A
+// compressed store cannot be read in place and loads the layer as
+// tf_store_layer() does.
+const tinyformer_weights_t *tf_store_layer_xip(void *store, int layer);
+
+// Run the whole stored stack (tinyformer_stack_encode_src over tf_store_layer).
+void tf_store_stack_encode(
+    tf_store_t  *st,
+    const int8_t input[TINYFORMER_S][TINYFORMER_D],
+    int8_t       output[TINYFORMER_S][TINYFORMER_D]);
+
+// Serialize w (default shape, int8 or packed matrices) into one layer image,
+// e.g. to build a flash image on the host or in a self‑test.
+void tf_store_pack_layer(uint8_t dst[TF_STORE_LAYER_BYTES], const tinyformer_weights_t *w);
+
+// Word copy used by the default TF_STORE_COPY_BEGIN.
+void tf_store_copy(void *dst, const void *src, uint32_t bytes);
+
+#endif // !TINYFORMER_INT4_WEIGHTS
+
+#endif // WEIGHT_STORE_H
@@ -0,0 +1,380 @@
+// Host models of the accelerator blocks (make accel-check): the LiteX CSR
+// accessors of host/csr_model/generated/csr.h, computed the way the RTL
+// computes them, so a host build of a hw_extensions driver with its *_HW and
+// *_USE_LITEX_CSR options runs the driver's register sequence against the
+// block's arithmetic rather than the driver's C reference. A run completes
+// when START is written: STATUS reads done right away.
+
+#include "generated/csr.h"
+
+// Q10 exp LUT of exp_lut.v, softmax_core.v and attn_core.v
+static const uint16_t model_exp_lut[16] = {
+    1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12,
+};
+
+// Restoring divider of softmax_core.v / attn_core.v: steps quotient bits,
+// the partial remainder starting at rem and the numerator bits shifted in
+// from the top of num.
+static uint32_t model_div(uint32_t rem, uint32_t num, uint32_t den, int steps) {
+  uint32_t q = 0;
+  for (int i = 0; i < steps; ++i) {
+    uint64_t r = ((uint64_t)rem << 1) | (num >> 31);
+    uint32_t ge = r >= den;
+    rem = (uint32_t)(ge ? r - den : r);
+    num <<= 1;
+    q = (q << 1) | ge;
+  }
+  return q;
+}
+
+// Q15 weight of each LUT entry (w_tab of softmax_core.v): fast, the
+// reciprocal 2^31 / sum times the entry, bits 31:16 of the 32-bit product;
+// else (e << 15) / sum with 16 quotient bits from e >> 1. used: the entries
+// the row takes (attn_core.v divides only those, softmax_core.v all 16).
+static void model_w_tab(uint16_t *w_tab, uint32_t sum, int fast, uint32_t used) {
+  uint32_t den = sum ? sum : 1u;
+  if (fast) {
+    uint32_t recip = model_div(0, 0x80000000u, den, 32);
+    for (int e = 0; e < 16; ++e) {
+      w_tab[e] = (uint16_t)(((uint32_t)model_exp_lut[e] * recip) >> 16);
+    }
+    return;
+  }
+  for (int e = 0; e < 16; ++e) {
+    if (used & (1u << e)) {
+      w_tab[e] = (uint16_t)model_div(model_exp_lut[e] >> 1,
+                                     (uint32_t)(model_exp_lut[e] & 1u) << 31, den, 16);
+    }
+  }
+}
+
+// LUT index of a score below the row max: min(-((s - max) >>> 3), 15)
+static int model_exp_idx(int32_t s, int32_t max) {
+  int32_t neg = -((int32_t)((uint32_t)s - (uint32_t)max) >> 3);
+  return neg > 15 ? 15 : neg;
+}
+
+// --- softmax_core.v (SoftmaxPeripheral, MAX_N 64) ---
+
+#define SM_MAX_N 64
+
+static struct {
+  uint32_t fast, shift, done;
+  uint32_t n, rd;  // scores written, weight read index (even)
+  int32_t max;
+  uint32_t sum;
+  int32_t s[SM_MAX_N];
+  uint8_t idx[SM_MAX_N];
+  uint16_t w_tab[16];
+} sm = {.shift = 5};
+
+void softmax_ctrl_write(uint32_t v) {
+  sm.fast = (v >> 2) & 1u;
+  if (v & 2u) {
+    sm.n = 0;
+    sm.rd = 0;
+    sm.done = 0;
+  }
+  if (v & 1u) {
+    sm.rd = 0;
+    sm.sum = 0;
+    for (uint32_t j = 0; j < sm.n; ++j) {
+      sm.idx[j] = (uint8_t)model_exp_idx(sm.s[j], sm.max);
+      sm.sum += model_exp_lut[sm.idx[j]];
+    }
+    model_w_tab(sm.w_tab, sm.sum, (int)sm.fast, 0xFFFFu);
+    sm.done = 1;
+  }
+}
+
+void softmax_cfg_write(uint32_t v) { sm.shift = v & 31u; }
+
+uint32_t softmax_status_read(void) { return sm.done << 1; }
+
+void softmax_score_in_write(uint32_t v) {
+  if (sm.n < SM_MAX_N) {
+    int32_t s = (int32_t)v >> sm.shift;
+    sm.s[sm.n] = s;
+    if (sm.n == 0 || s > sm.max) {
+      sm.max = s;
+    }
+    sm.n++;
+  }
+}
+
+uint32_t softmax_w_out_read(void) {
+  return (uint32_t)sm.w_tab[sm.idx[(sm.rd + 1) % SM_MAX_N]] << 16 | sm.w_tab[sm.idx[sm.rd]];
+}
+
+void softmax_w_next_write(uint32_t v) {
+  (void)v;
+  sm.rd = (sm.rd + 2) % SM_MAX_N;
+}
+
+uint32_t softmax_count_read(void) { return sm.n; }
+uint32_t softmax_max_read(void) { return (uint32_t)sm.max; }
+uint32_t softmax_sum_read(void) { return sm.sum; }
+
+// --- attn_core.v (AttnPeripheral, S_MAX 16, D_MAX 64) ---
+
+#define AT_S_MAX 16
+#define AT_DW (64 / 4)  // words per row
+
+typedef struct {
+  uint32_t r, w;  // row, word (wrapping at D / 4)
+} at_ptr_t;
+
+static struct {
+  uint32_t ctrl, shape, shift, done, cycles;
+  at_ptr_t q_wr, k_wr, v_wr, ctx_rd;
+  uint32_t q[AT_S_MAX * AT_DW], k[AT_S_MAX * AT_DW], v[AT_S_MAX * AT_DW];
+  uint32_t ctx[AT_S_MAX * AT_DW];
+} at = {.shift = 5};
+
+static uint32_t at_d_words(void) { return ((at.shape >> 8) & 0xFFu) >> 2; }
+
+static void at_advance(at_ptr_t *p) {
+  if (p->w + 1 >= at_d_words()) {
+    p->w = 0;
+    p->r++;
+  } else {
+    p->w++;
+  }
+}
+
+static void at_write(at_ptr_t *p, uint32_t *mem, uint32_t v) {
+  if (p->r < AT_S_MAX) {
+    mem[p->r * AT_DW + p->w] = v;
+    at_advance(p);
+  }
+}
+
+static int32_t at_lane(uint32_t word, int l) { return (int8_t)(word >> (8 * l)); }
+
+// Every query and head: scores 4 MACs per word, exps and normalize as
+// softmax_core.v (only the LUT entries the row uses are divided), then
+// ctx[d] = sat8(sum_j (w_j * V[j][d]) >>> 15), one shift per term. cycles
+// counts the issue slots of attn_core.v per phase.
+static void at_run(void) {
+  const uint32_t S = at.shape & 0x3Fu, d_words = at_d_words();
+  const uint32_t hd_words = ((at.shape >> 16) & 0xFFu) >> 2;
+  const int fast = (at.ctrl >> 2) & 1u, causal = (at.ctrl >> 3) & 1u;
+
+  at.cycles = 0;
+  for (uint32_t qi = 0; qi < S; ++qi) {
+    const uint32_t n = causal ? qi + 1 : S;
+    for (uint32_t h0w = 0; h0w < d_words; h0w += hd_words) {
+      int32_t s[AT_S_MAX], max = 0;
+      uint8_t idx[AT_S_MAX];
+      uint16_t w_tab[16];
+      uint32_t sum = 0, used = 0, n_used = 0;
+
+      for (uint32_t j = 0; j < n; ++j) {
+        int32_t acc = 0;
+        for (uint32_t w = 0; w < hd_words; ++w) {
+          const uint32_t qw = at.q[qi * AT_DW + h0w + w], kw = at.k[j * AT_DW + h0w + w];
+          for (int l = 0; l < 4; ++l) {
+            acc += at_lane(qw, l) * at_lane(kw, l);
+          }
+        }
+        s[j] = acc >> at.shift;
+        if (j == 0 || s[j] > max) {
+          max = s[j];
+        }
+      }
+      for (uint32_t j = 0; j < n; ++j) {
+        idx[j] = (uint8_t)model_exp_idx(s[j], max);
+        sum += model_exp_lut[idx[j]];
+        n_used += !(used & (1u << idx[j]));
+        used |= 1u << idx[j];
+      }
+      model_w_tab(w_tab, sum, fast, used);
+      for (uint32_t w = 0; w < hd_words; ++w) {
+        uint32_t word = 0;
+        for (int l = 0; l < 4; ++l) {
+          int32_t acc = 0;
+          for (uint32_t j = 0; j < n; ++j) {
+            acc += ((int32_t)w_tab[idx[j]] * at_lane(at.v[j * AT_DW + h0w + w], l)) >> 15;
+          }
+          acc = acc > 127 ? 127 : acc < -128 ? -128 : acc;
+          word |= (uint32_t)(uint8_t)acc << (8 * l);
+        }
+        at.ctx[qi * AT_DW + h0w + w] = word;
+      }
+      at.cycles += 2 * (n * hd_words + 2) + (n + 1) + (fast ? 33 + 16 : 17 + 17 * n_used) + 1;
+    }
+  }
+  at.done = 1;
+}
+
+void attn_ctrl_write(uint32_t v) {
+  at.ctrl = v;
+  if (v & 2u) {
+    at.q_wr = at.k_wr = at.v_wr = at.ctx_rd = (at_ptr_t){0, 0};
+    at.done = 0;
+  }
+  if (v & 1u) {
+    at_run();
+  }
+}
+
+void attn_shape_write(uint32_t v) { at.shape = v & 0xFFFFFFu; }
+void attn_cfg_write(uint32_t v) { at.shift = v & 31u; }
+uint32_t attn_status_read(void) { return at.done << 1; }
+void attn_q_in4_write(uint32_t v) { at_write(&at.q_wr, at.q, v); }
+void attn_k_in4_write(uint32_t v) { at_write(&at.k_wr, at.k, v); }
+void attn_v_in4_write(uint32_t v) { at_write(&at.v_wr, at.v, v); }
+uint32_t attn_ctx_out_read(void) { return at.ctx[(at.ctx_rd.r * AT_DW + at.ctx_rd.w) % (AT_S_MAX * AT_DW)]; }
+
+void attn_ctx_next_write(uint32_t v) {
+  (void)v;
+  at_advance(&at.ctx_rd);
+}
+
+uint32_t attn_cycles_read(void) { return at.cycles; }
+
+// --- gemv_core.v (GEMVPeripheral(attn=True), W_ADDR_BITS 12, one W bank) ---
+
+#define GV_W_BYTES 4096
+
+static struct {
+  uint32_t ctrl, rq, w_base, done;
+  uint32_t x_idx, w_idx, b_idx, y_idx;  // 6-bit X / b / Y, 12-bit W pointers
+  int8_t w[GV_W_BYTES];
+  uint8_t x[2][64];  // per bank: X[0..31] the low half, X[32..63] the high one
+  int32_t b[64];
+  int32_t y[2][64];
+  int8_t y8[2][64];
+} gv = {.rq = 7};
+
+// y8 = sat8(relu?((acc * mul) + round) >>> shift) (mul = 1 without mul_en)
+static int8_t gv_requant(int32_t acc) {
+  const uint32_t shift = gv.rq & 63u;
+  int64_t v = (gv.rq & 256u) ? (int64_t)acc * (int16_t)(gv.rq >> 16) : acc;
+  if ((gv.rq & 64u) && shift != 0) {
+    v += (int64_t)1 << (shift - 1);
+  }
+  v >>= shift;
+  if ((gv.rq & 128u) && v < 0) {
+    v = 0;
+  }
+  return (int8_t)(v > 127 ? 127 : v < -128 ? -128 : v);
+}
+
+// Y[r] = b[r] + sum_k X[k] * W[w_base + r * LEN + k] in the X / Y bank and
+// from the W region latched at start; x_u16 takes X[k] = {X[32 + k], X[k]}
+// unsigned over LEN 32.
+static void gv_run(void) {
+  const uint32_t len = (gv.ctrl & (1u << 4)) ? 64 : 32;
+  const uint32_t out = (gv.ctrl & (1u << 10)) ? 16 : (gv.ctrl & (1u << 5)) ? 64 : 32;
+  const uint32_t bank = (gv.ctrl >> 8) & 1u, bias = (gv.ctrl >> 6) & 1u;
+  const uint32_t x_u16 = (gv.ctrl >> 11) & 1u;
+
+  for (uint32_t r = 0; r < out; ++r) {
+    int32_t acc = bias ? gv.b[r] : 0;
+    for (uint32_t k = 0; k < len; ++k) {
+      const int32_t x = x_u16 ? (int32_t)(gv.x[bank][k] | (uint32_t)gv.x[bank][32 + k] << 8)
+                              : (int8_t)gv.x[bank][k];
+      acc += x * gv.w[(gv.w_base + r * len + k) % GV_W_BYTES];
+    }
+    gv.y[bank][r] = acc;
+    gv.y8[bank][r] = gv_requant(acc);
+  }
+  gv.done = 1;
+}
+
+void gemv_ctrl_write(uint32_t v) {
+  gv.ctrl = v & 0x3FFFu;
+  if (v & (1u << 3)) {  // clear_done
+    gv.x_idx = gv.w_idx = gv.b_idx = gv.y_idx = 0;
+    gv.done = 0;
+  }
+  if (v & (1u << 7)) {  // clear_x
+    gv.x_idx = gv.y_idx = 0;
+    gv.done = 0;
+  }
+  if (v & (1u << 9)) {  // rewind
+    gv.x_idx = gv.y_idx = 0;
+  }
+  if (v & 1u) {
+    gv_run();
+  }
+}
+
+uint32_t gemv_ctrl_read(void) { return gv.ctrl; }
+uint32_t gemv_status_read(void) { return gv.done << 1; }
+
+void gemv_x_in_write(uint32_t v) {
+  gv.x[(gv.ctrl >> 8) & 1u][gv.x_idx] = (uint8_t)v;
+  gv.x_idx = (gv.x_idx + 1) % 64;
+}
+
+void gemv_x_in4_write(uint32_t v) {
+  for (uint32_t k = 0; k < 4; ++k) {
+    gv.x[(gv.ctrl >> 8) & 1u][gv.x_idx + k] = (uint8_t)(v >> (8 * k));
+  }
+  gv.x_idx = (gv.x_idx + 4) % 64;
+}
+
+void gemv_w_in_write(uint32_t v) {
+  gv.w[(gv.w_base + gv.w_idx) % GV_W_BYTES] = (int8_t)v;
+  gv.w_idx = (gv.w_idx + 1) % GV_W_BYTES;
+}
+
+void gemv_w_in4_write(uint32_t v) {
+  for (uint32_t k = 0; k < 4; ++k) {
+    gv.w[(gv.w_base + gv.w_idx + k) % GV_W_BYTES] = (int8_t)(v >> (8 * k));
+  }
+  gv.w_idx = (gv.w_idx + 4) % GV_W_BYTES;
+}
+
+void gemv_b_in_write(uint32_t v) {
+  gv.b[gv.b_idx] = (int32_t)v;
+  gv.b_idx = (gv.b_idx + 1) % 64;
+}
+
+uint32_t gemv_y_out_read(void) { return (uint32_t)gv.y[(gv.ctrl >> 8) & 1u][gv.y_idx]; }
+
+uint32_t gemv_y8_out_read(void) {
+  const int8_t *y8 = gv.y8[(gv.ctrl >> 8) & 1u];
+  uint32_t v = 0;
+  for (uint32_t k = 0; k < 4; ++k) {
+    v |= (uint32_t)(uint8_t)y8[(gv.y_idx + k) % 64] << (8 * k);
+  }
+  return v;
+}
+
+void gemv_y_next_write(uint32_t v) {
+  if (v & 1u) {
+    gv.y_idx = (gv.y_idx + 1) % 64;
+  } else if (v & 4u) {
+    gv.y_idx = (gv.y_idx + 4) % 64;
+  }
+}
+
+void gemv_rq_cfg_write(uint32_t v) { gv.rq = v; }
+void gemv_w_base_write(uint32_t v) { gv.w_base = v % GV_W_BYTES; }
+void gemv_ev_pending_write(uint32_t v) { (void)v; }
+void gemv_ev_enable_write(uint32_t v) { (void)v; }
+
+// The gemv_dev_* handles of gemv.c (CSR_GEMV_*_ADDR of instance 0)
+void csr_write_simple(unsigned long v, unsigned long a) {
+  switch (a) {
+    case CSR_GEMV_CTRL_ADDR: gemv_ctrl_write((uint32_t)v); break;
+    case CSR_GEMV_X_IN4_ADDR: gemv_x_in4_write((uint32_t)v); break;
+    case CSR_GEMV_W_IN4_ADDR: gemv_w_in4_write((uint32_t)v); break;
+    case CSR_GEMV_B_IN_ADDR: gemv_b_in_write((uint32_t)v); break;
+    case CSR_GEMV_Y_NEXT_ADDR: gemv_y_next_write((uint32_t)v); break;
+    case CSR_GEMV_RQ_CFG_ADDR: gemv_rq_cfg_write((uint32_t)v); break;
+    default: break;
+  }
+}
+
+unsigned long csr_read_simple(unsigned long a) {
+  switch (a) {
+    case CSR_GEMV_STATUS_ADDR: return gemv_status_read();
+    case CSR_GEMV_Y_OUT_ADDR: return gemv_y_out_read();
+    case CSR_GEMV_Y8_OUT_ADDR: return gemv_y8_out_read();
+    default: return 0;
+  }
+}
@@ -0,0 +1,64 @@
+// LiteX CSR accessors of the accelerator blocks for the host build (make
+// accel-check): generated/csr.h of a SoC with the blocks, implemented by the
+// block models of host/csr_model.c instead of the CSR bus.
+
+#ifndef TF_HOST_CSR_MODEL_H
+#define TF_HOST_CSR_MODEL_H
+
+#include <stdint.h>
+
+// SoftmaxPeripheral (hw_extensions/softmax)
+void softmax_ctrl_write(uint32_t v);
+void softmax_cfg_write(uint32_t v);
+uint32_t softmax_status_read(void);
+void softmax_score_in_write(uint32_t v);
+uint32_t softmax_w_out_read(void);
+void softmax_w_next_write(uint32_t v);
+uint32_t softmax_count_read(void);
+uint32_t softmax_max_read(void);
+uint32_t softmax_sum_read(void);
+
+// AttnPeripheral (hw_extensions/attention)
+void attn_ctrl_write(uint32_t v);
+void attn_shape_write(uint32_t v);
+void attn_cfg_write(uint32_t v);
+uint32_t attn_status_read(void);
+void attn_q_in4_write(uint32_t v);
+void attn_k_in4_write(uint32_t v);
+void attn_v_in4_write(uint32_t v);
+uint32_t attn_ctx_out_read(void);
+void attn_ctx_next_write(uint32_t v);
+uint32_t attn_cycles_read(void);
+
+// GEMVPeripheral(attn=True) (hw_extensions/gemv), as region gemv; register
+// addresses at the offsets of gemv.h for csr_write_simple() / csr_read_simple()
+#define CSR_GEMV_BASE 0x1000L
+#define CSR_GEMV_CTRL_ADDR (CSR_GEMV_BASE + 0x00L)
+#define CSR_GEMV_B_IN_ADDR (CSR_GEMV_BASE + 0x0CL)
+#define CSR_GEMV_Y_OUT_ADDR (CSR_GEMV_BASE + 0x10L)
+#define CSR_GEMV_STATUS_ADDR (CSR_GEMV_BASE + 0x14L)
+#define CSR_GEMV_Y_NEXT_ADDR (CSR_GEMV_BASE + 0x18L)
+#define CSR_GEMV_X_IN4_ADDR (CSR_GEMV_BASE + 0x1CL)
+#define CSR_GEMV_W_IN4_ADDR (CSR_GEMV_BASE + 0x20L)
+#define CSR_GEMV_RQ_CFG_ADDR (CSR_GEMV_BASE + 0x38L)
+#define CSR_GEMV_Y8_OUT_ADDR (CSR_GEMV_BASE + 0x3CL)
+
+void gemv_ctrl_write(uint32_t v);
+uint32_t gemv_ctrl_read(void);
+uint32_t gemv_status_read(void);
+void gemv_x_in_write(uint32_t v);
+void gemv_x_in4_write(uint32_t v);
+void gemv_w_in_write(uint32_t v);
+void gemv_w_in4_write(uint32_t v);
+void gemv_b_in_write(uint32_t v);
+uint32_t gemv_y_out_read(void);
+uint32_t gemv_y8_out_read(void);
+void gemv_y_next_write(uint32_t v);
+void gemv_rq_cfg_write(uint32_t v);
+void gemv_w_base_write(uint32_t v);
+void gemv_ev_pending_write(uint32_t v);
+void gemv_ev_enable_write(uint32_t v);
+void csr_write_simple(unsigned long v, unsigned long a);
+unsigned long csr_read_simple(unsigned long a);
+
+#endif
@@ -0,0 +1,1787 @@
+// Native host build of the TinyFormer core (make host): golden ENC_CKSUM
+// check and micro-benchmark, no FPGA needed.
+//
+//   tinyformer_host          golden and context checks, then the benchmark
+//                            (2000 iterations)
+//   tinyformer_host <iters>  same, benchmark with <iters>
+//   tinyformer_host demo     demo_run() to stdout (same lines as the UART demo,
+//                            usable as a run_baseline_and_measure.py --from_logs capture)
+//                            or, built with DEMO_CONSOLE, the command console on
+//                            stdin (make console-check); built with
+//                            TINYFORMER_STACK_PAINT on a painted thread stack,
+//                            ending with its STACK line (make stack-check)
+//                            or, built with TINYFORMER_BENCH_SUITE, the
+//                            benchmark suite (make suite-check)
+//   tinyformer_host serve    demo_proto_run() on stdin/stdout (binary frames of
+//                            uart_frame.h, e.g. for scripts/uart_frame_host.py --exec)
+//   tinyformer_host features <raw.bin> <out.bin>
+//                            imu_feat_window() over raw int16 [n][128][6] windows,
+//                            int8 [n][S][D] tokens out (make feat-check)
+//   tinyformer_host store-image <out.bin>
+//                            the weight-store check image (STORE_LAYERS layers)
+//   tinyformer_host store-wz <in.tfwz>
+//                            the same image compressed by tools/weight_codec.py,
+//                            expanded by the store and run (make wz-check);
+//                            neither in TINYFORMER_INT4_WEIGHTS builds
+//   tinyformer_host rand     the synthetic-weight check alone, printing every
+//                            sample's ENC_CKSUM (to regenerate rand_cksum[])
+//   tinyformer_host aot [iters]  generated tinyformer_aot_encode() against
+//                            tinyformer_encode(), then both benchmarked
+//                            (TINYFORMER_AOT_CHECK builds, make aot-check)
+//   tinyformer_host smp [iters]  tinyformer_encode_smp() on TF_SMP_HARTS - 1
+//                            worker threads plus the caller against
+//                            tinyformer_encode(), then both benchmarked
+//                            (TINYFORMER_SMP builds, make smp-check); also
+//                            the front / back halves against
+//                            tinyformer_classify_view()
+//   tinyformer_host tiers    tier pack of the default model and synthetic
+//                            medium / small students: each tier against its
+//                            instance run directly (TINYFORMER_TIERS builds,
+//                            make tiers-check)
+//   tinyformer_host shadow   tf_shadow.h guard of this build against the
+//                            generated scalar tinyformer_ref_encode():
+//                            sampling, statistics and both fallbacks
+//                            (TINYFORMER_SHADOW builds, make shadow-check)
+//   tinyformer_host pmode    power_modes.h switching between the modes of
+//                            a table: requests, names, the switch reports
+//                            and each mode's kernel set and exits on the
+//                            demo samples (TINYFORMER_POWER_MODES builds,
+//                            make pmode-check)
+//   tinyformer_host stream <n> | stream-pipe <n>
+//                            demo_stream_run() / demo_stream_pipe_run() for n
+//                            windows on the demo samples, fed from a thread
+//                            (TINYFORMER_SMP builds, make smp-check; with
+//                            DEMO_STREAM_GATE make gate-check)
+//
+// Exit status: 0 if every sample matches golden_cksum[] and rand_cksum[] and
+// the context API, weight store, model blob and multi-model runtime match the
+// static encoder and the feature stage streams as it windows, 1 otherwise.
+// Kernels run the software paths (dot8.c / exp_lut.c fallbacks); the UART is
+// redirected to stdout. Cycles come from cycle_counter.h (TSC on x86).
+
+#include "cycle_counter.h"
+#include "demo_classifier.h"
+#include "demo_runner.h"
+#include "demo_samples.h"
+#include "imu_features.h"
+#include "model_blob.h"
+#include "model_runtime.h"
+#if TINYFORMER_TIERS
+#include "model_tiers.h"
+#endif
+#include "tinyformer.h"
+#include "uart_frame.h"
+#include "uart_litex.h"
+#include "weight_codec.h"
+#include "weight_store.h"
+#if TINYFORMER_AOT_CHECK
+#include "tinyformer_aot.h"
+#endif
+#if TINYFORMER_SMP
+#include "smp_runtime.h"
+#include <pthread.h>
+#endif
+#if TINYFORMER_SHADOW
+#include "tf_shadow.h"
+#include "tinyformer_ref.h"
+#endif
+#if TINYFORMER_POWER_MODES
+#include "power_modes.h"
+#endif
+#if TINYFORMER_STACK_PAINT
+#include "tf_stack.h"
+#include <pthread.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ENC_CKSUM of the baseline firmware (USE_TRAINED_WEIGHTS=1, checked-in
+// trained_weights.c and demo_samples.c). Regenerate with `tinyformer_host demo`
+// after re-exporting the weights or samples.
+static const uint32_t golden_cksum[DEMO_NUM_SAMPLES] = {
+    0x00005CE7, 0x00006557, 0x000068B6, 0x00006469, 0x000062A1,
+    0x000063A6, 0x0000627B, 0x00006ACF, 0x0000719B, 0x00007185,
+};
+
+// uart_write_char() capture for the frame check.
+static uint8_t frame_wire[4 * UF_MAX_PAYLOAD];
+static uint32_t frame_wire_len;
+static int frame_capture;
+
+void uart_write_char(char c) {
+  if (frame_capture) {
+    frame_wire[frame_wire_len++] = (uint8_t)c;
+  } else {
+    putchar(c);
+  }
+}
+void uart_write_string(const char *s) { fputs(s, stdout); }
+char uart_read_char(void) {
+  int c = getchar();
+  if (c == EOF) {
+    exit(0); /* serve: host closed the pipe */
+  }
+  return (char)c;
+}
+int uart_read_ready(void) { return 0; }
+int uart_write_string_async(const char *s) {
+  fputs(s, stdout);
+  return (int)strlen(s);
+}
+void uart_tx_flush(void) { fflush(stdout); }
+
+static const tinyformer_head_t head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int golden_check(void) {
+  int fails = 0;
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum;
+    int pred = tinyformer_classify(&head, demo_inputs[i], logits, &cksum);
+    if (cksum != golden_cksum[i]) {
+      printf("GOLDEN FAIL sample=%d ENC_CKSUM=0x%08X expected=0x%08X pred=%d\n", i,
+             (unsigned)cksum, (unsigned)golden_cksum[i], pred);
+      fails++;
+    }
+  }
+  if (fails == 0) {
+    printf("GOLDEN OK samples=%d\n", DEMO_NUM_SAMPLES);
+  }
+  return fails;
+}
+
+// ENC_CKSUM of the synthetic weights of rand_build() on the demo samples. The
+// checked-in W_q and W_k are zero, so every score of golden_check() is 0 and
+// the attention is a plain mean of V; these weights are nonzero everywhere.
+// Regenerate with `tinyformer_host rand` after changing the encoder math.
+#if TINYFORMER_GEMV_ATTN || \
+    (TINYFORMER_SPARSE_SOFTMAX && TINYFORMER_SPARSE_MIN_W == 0 && !TINYFORMER_SPARSE_TOPK)
+// One >> 15 of each exact context sum rather than one per term: the GEMV
+// attention and the sparse softmax keeping every key (make accel-check;
+// tools/tinyformer_sim.py --sparse-softmax --sparse-min-w 0).
+static const uint32_t rand_cksum[DEMO_NUM_SAMPLES] = {
+    0x00011C08, 0x00011857, 0x00011AD5, 0x00016179, 0x00015EA6,
+    0x000157A7, 0x000158AA, 0x00016903, 0x00017BA9, 0x0001827C,
+};
+#else
+static const uint32_t rand_cksum[DEMO_NUM_SAMPLES] = {
+    0x0000E856, 0x0000DECE, 0x0000E268, 0x00014DDA, 0x000119CA,
+    0x0001190A, 0x00011CCB, 0x00013308, 0x000142DF, 0x00014427,
+};
+#endif
+
+// Every matrix and bias of one encoder block, uniform in [-7, 7]: int4 range,
+// so a TINYFORMER_INT4_WEIGHTS build packs the same model into its nibbles
+// and must match the same table (make int4-check).
+#define RAND_W_MAX (TINYFORMER_FFN * TINYFORMER_D)
+
+static uint32_t rand_W[6][RAND_W_MAX / 4];
+static int8_t rand_b[6][TINYFORMER_FFN];
+static uint8_t ws_rand[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+
+static int8_t rand_int4(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  return (int8_t)((int32_t)(*seed >> 24) % 15 - 7);
+}
+
+static void rand_build(tinyformer_weights_t *w) {
+  const tinyformer_wword_t **mat[6] = {&w->W_q, &w->W_k, &w->W_v, &w->W_o, &w->W_ff1, &w->W_ff2};
+  const int8_t **bias[6] = {&w->b_q, &w->b_k, &w->b_v, &w->b_o, &w->b_ff1, &w->b_ff2};
+  const uint32_t rows[6] = {TINYFORMER_D, TINYFORMER_D, TINYFORMER_D,
+                            TINYFORMER_D, TINYFORMER_FFN, TINYFORMER_D};
+  const uint32_t cols[6] = {TINYFORMER_D, TINYFORMER_D, TINYFORMER_D,
+                            TINYFORMER_D, TINYFORMER_D, TINYFORMER_FFN};
+  uint32_t seed = 0x2545F491u;
+
+  memset(w, 0, sizeof(*w));
+  memset(rand_W, 0, sizeof(rand_W));
+  for (int l = 0; l < 6; ++l) {
+    for (uint32_t i = 0; i < rows[l] * cols[l]; ++i) {
+      int8_t v = rand_int4(&seed);
+#if TINYFORMER_INT4_WEIGHTS
+      // Byte k of word j: W[8j + k] low nibble, W[8j + k + 4] high nibble
+      rand_W[l][i / 8] |= ((uint32_t)v & 0xFu) << (8u * (i % 4u) + 4u * (i % 8u / 4u));
+#else
+      ((int8_t *)rand_W[l])[i] = v;
+#endif
+    }
+    for (uint32_t i = 0; i < rows[l]; ++i) {
+      rand_b[l][i] = rand_int4(&seed);
+    }
+    *mat[l] = (const tinyformer_wword_t *)rand_W[l];
+    *bias[l] = rand_b[l];
+  }
+}
+
+// The synthetic model through the context API against rand_cksum[]; with
+// print, every sample's ENC_CKSUM line too.
+static int rand_check(int print) {
+  tinyformer_weights_t w;
+  tinyformer_ctx_t ctx;
+  int fails = 0;
+
+  rand_build(&w);
+  if (tinyformer_ctx_init(&ctx, ws_rand, sizeof(ws_rand)) != 0) {
+    printf("RAND FAIL ctx\n");
+    return 1;
+  }
+  ctx.weights = &w;
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum;
+    int pred = tinyformer_classify_ctx(&ctx, &head, demo_inputs[i], logits, &cksum);
+    if (print) {
+      printf("RAND sample=%d ENC_CKSUM=0x%08X pred=%d\n", i, (unsigned)cksum, pred);
+    }
+    if (cksum != rand_cksum[i]) {
+      printf("RAND FAIL sample=%d ENC_CKSUM=0x%08X expected=0x%08X\n", i, (unsigned)cksum,
+             (unsigned)rand_cksum[i]);
+      fails++;
+    }
+  }
+  if (fails == 0) {
+    printf("RAND OK samples=%d\n", DEMO_NUM_SAMPLES);
+  }
+  return fails;
+}
+
+#if TINYFORMER_AUTOTUNE
+// golden_check() runs before the tuner, on the CPU paths; the goldens must
+// still match on the kernels tinyformer_autotune() picks (the later checks
+// and the benchmark also run on them).
+static int tune_check(void) {
+  static const char *const layer_name[TINYFORMER_RQ_COUNT] = {
+      "q", "k", "v", "o", "ff1", "ff2", "qkv"};
+  static const char *const kernel_name[TINYFORMER_KERNEL_COUNT] = {
+      "cpu", "dot8", "gemv"};
+  tinyformer_tune_t t;
+  int fails = 0;
+  tinyformer_autotune(0, &t);
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum;
+    tinyformer_classify(&head, demo_inputs[i], logits, &cksum);
+    if (cksum != golden_cksum[i]) {
+      printf("TUNE FAIL sample=%d ENC_CKSUM=0x%08X expected=0x%08X\n", i, (unsigned)cksum,
+             (unsigned)golden_cksum[i]);
+      fails++;
+    }
+  }
+  if (fails == 0) {
+    printf("TUNE OK hw=0x%X exp=%s", (unsigned)t.hw, t.exp_lut ? "lut" : "sw");
+    for (int l = 0; l < TINYFORMER_RQ_COUNT; ++l) {
+      if (l != TINYFORMER_RQ_QKV || TINYFORMER_FUSED_QKV) {
+        printf(" %s=%s", layer_name[l], kernel_name[t.kernel[l]]);
+      }
+    }
+    printf("\n");
+  }
+  return fails;
+}
+#endif
+
+#if TINYFORMER_LATENCY
+// Percentiles of a known call distribution (90 x 100, 9 x 1000, 1 x 20000
+// cycles: the tops of their buckets, max exact), then one entry per stage
+// and sample from the profiled encoder, in order p50 <= p95 <= p99 <= max.
+static int lat_check(void) {
+  static const char *const name[TINYFORMER_LAT_COUNT] = {"qkv", "attn", "oproj", "ffn", "head",
+                                                         "call"};
+  tinyformer_latency_t t;
+  int fails = 0;
+  tinyformer_profile_reset();
+  for (int i = 0; i < 100; ++i) {
+    tinyformer_latency_record(i < 90 ? 100u : i < 99 ? 1000u : 20000u);
+  }
+  tinyformer_latency_read(TINYFORMER_LAT_CALL, &t);
+  if (t.count != 100 || t.p50 != 127 || t.p95 != 1023 || t.p99 != 1023 || t.max != 20000) {
+    printf("LAT FAIL call n=%u p50=%u p95=%u p99=%u max=%u\n", (unsigned)t.count, (unsigned)t.p50,
+           (unsigned)t.p95, (unsigned)t.p99, (unsigned)t.max);
+    fails++;
+  }
+  tinyformer_profile_reset();
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum;
+    tinyformer_classify(&head, demo_inputs[i], logits, &cksum);
+  }
+  for (int l = 0; l < TINYFORMER_PROF_COUNT; ++l) {
+    tinyformer_latency_read(l, &t);
+    if (t.count != DEMO_NUM_SAMPLES || t.p50 > t.p95 || t.p95 > t.p99 || t.p99 > t.max) {
+      printf("LAT FAIL %s n=%u p50=%u p95=%u p99=%u max=%u\n", name[l], (unsigned)t.count,
+             (unsigned)t.p50, (unsigned)t.p95, (unsigned)t.p99, (unsigned)t.max);
+      fails++;
+    }
+  }
+  tinyformer_profile_reset();
+  if (fails == 0) {
+    printf("LAT OK stages=%d samples=%d\n", TINYFORMER_PROF_COUNT, DEMO_NUM_SAMPLES);
+  }
+  return fails;
+}
+#endif
+
+// Two contexts on static workspaces, interleaved with each other and with the
+// static entry points; every result must match the static API.
+static uint8_t ws_a[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+static uint8_t ws_b[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+
+static int ctx_check(void) {
+  static int8_t ref[DEMO_NUM_SAMPLES][TINYFORMER_S][TINYFORMER_D];
+  static int8_t out[DEMO_NUM_SAMPLES][TINYFORMER_S][TINYFORMER_D];
+  static int8_t win[TINYFORMER_S][TINYFORMER_D];
+  const tinyformer_weights_t layers[2] = {tinyformer_default_weights, tinyformer_default_weights};
+  tinyformer_ctx_t a, b;
+  int fails = 0;
+
+  if (tinyformer_workspace_size() > TINYFORMER_WORKSPACE_BYTES ||
+      tinyformer_ctx_init(&a, ws_a, sizeof(ws_a)) != 0 ||
+      tinyformer_ctx_init(&b, ws_b, sizeof(ws_b)) != 0 ||
+      tinyformer_ctx_init(&b, ws_b + 1, sizeof(ws_b) - 1) == 0 ||
+      tinyformer_ctx_init(&b, ws_b, tinyformer_workspace_size() - 1) == 0 ||
+      tinyformer_ctx_init(&b, ws_b, tinyformer_workspace_size()) != 0) {
+    printf("CTX FAIL init\n");
+    return 1;
+  }
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    tinyformer_encode(demo_inputs[i], ref[i]);
+  }
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum = 0;
+    // Slide b over the stream of samples (hop S/2) while a and the static
+    // API encode full windows in between.
+    int hop = (i == 0) ? TINYFORMER_S : TINYFORMER_S / 2;
+    memmove(win, win[hop], (size_t)(TINYFORMER_S - hop) * TINYFORMER_D);
+    memcpy(win[TINYFORMER_S - hop], demo_inputs[i], (size_t)hop * TINYFORMER_D);
+    tinyformer_encode_slide_ctx(&b, win, hop, out[0]);
+    tinyformer_encode_ctx(&a, demo_inputs[i], out[1]);
+    tinyformer_encode(win, out[2]);
+    fails += memcmp(out[0], out[2], sizeof(out[0])) != 0;
+    fails += memcmp(out[1], ref[i], sizeof(out[1])) != 0;
+    tinyformer_classify_ctx(&a, &head, demo_inputs[i], logits, &cksum);
+    fails += cksum != golden_cksum[i];
+  }
+  // Zero-copy views of a wrapping ring with padded rows, sliding as above:
+  // the static encoder reads the window in place, a encodes a copy of it.
+  {
+    enum { VIEW_ROWS = TINYFORMER_S + TINYFORMER_S / 2, VIEW_STRIDE = TINYFORMER_D + 4 };
+    static int8_t ring[VIEW_ROWS][VIEW_STRIDE] __attribute__((aligned(4)));
+    tinyformer_input_t v = {&ring[0][0], VIEW_STRIDE, VIEW_ROWS, 0};
+    uint32_t rows = 0;
+    memset(ring, 0x55, sizeof(ring));
+    for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+      int32_t logits[DEMO_NUM_CLASSES];
+      uint32_t cksum = 0, cksum_ref = 1;
+      int hop = (i == 0) ? TINYFORMER_S : TINYFORMER_S / 2;
+      for (int k = 0; k < hop; ++k, ++rows) {
+        memcpy(ring[rows % VIEW_ROWS], demo_inputs[i][k], TINYFORMER_D);
+      }
+      v.first = (int32_t)((rows - TINYFORMER_S) % VIEW_ROWS);
+      for (int s = 0; s < TINYFORMER_S; ++s) {
+        memcpy(win[s], ring[(v.first + s) % VIEW_ROWS], TINYFORMER_D);
+      }
+      fails += tinyformer_encode_view(&v, hop, out[0]) != 0;
+      tinyformer_encode_ctx(&a, win, out[1]);
+      fails += memcmp(out[0], out[1], sizeof(out[0])) != 0;
+      fails += tinyformer_classify_view_ctx(&a, &head, &v, logits, &cksum) !=
+               tinyformer_classify_ctx(&a, &head, win, logits, &cksum_ref);
+      fails += cksum != cksum_ref;
+    }
+    v.stride = TINYFORMER_D - 4;
+    fails += tinyformer_encode_view(&v, TINYFORMER_S, out[0]) != -1;
+    v.stride = VIEW_STRIDE;
+    v.first = VIEW_ROWS;
+    fails += tinyformer_classify_view(&head, &v, 0, 0) != -1;
+  }
+  tinyformer_encode_batch_ctx(&a, demo_inputs, out, DEMO_NUM_SAMPLES);
+  fails += memcmp(out, ref, sizeof(out)) != 0;
+  tinyformer_stack_encode(layers, 2, demo_inputs[0], out[0]);
+  tinyformer_stack_encode_ctx(&b, layers, 2, demo_inputs[0], out[1]);
+  fails += memcmp(out[0], out[1], sizeof(out[0])) != 0;
+#if TINYFORMER_TOKEN_POOL
+  // Stride 1 everywhere is the plain stack; S/2 after layer 0 on both APIs.
+  {
+    static const uint8_t flat[2] = {1, 1}, half[2] = {1, 2};
+    fails += tinyformer_stack_encode_pooled(layers, 2, flat, demo_inputs[0], out[2]) != TINYFORMER_S;
+    fails += memcmp(out[0], out[2], sizeof(out[0])) != 0;
+    fails += tinyformer_stack_encode_pooled(layers, 2, half, demo_inputs[0], out[2]) != TINYFORMER_S / 2;
+    fails += tinyformer_stack_encode_pooled_ctx(&b, layers, 2, half, demo_inputs[0], out[3]) != TINYFORMER_S / 2;
+    fails += memcmp(out[2], out[3], (size_t)(TINYFORMER_S / 2) * TINYFORMER_D) != 0;
+  }
+#endif
+#if TINYFORMER_MASKED
+  // A full window is tinyformer_encode(); a half one ignores whatever is in
+  // its padding, zeroes those output rows and (causal) keeps the first rows.
+  {
+    const int n_feat = (tinyformer_default_weights.d_in > 0) ? tinyformer_default_weights.d_in
+                                                             : TINYFORMER_D;
+    const int half = TINYFORMER_S / 2;
+    static int8_t pad[TINYFORMER_S][TINYFORMER_D];
+    memcpy(pad, demo_inputs[1], sizeof(pad));
+    fails += tinyformer_encode_masked(demo_inputs[1], TINYFORMER_S, n_feat, out[0]) != 0;
+    fails += memcmp(out[0], ref[1], sizeof(out[0])) != 0;
+    fails += tinyformer_encode_masked(pad, half, n_feat, out[1]) != 0;
+    memset(pad[half], 0x7f, (size_t)(TINYFORMER_S - half) * TINYFORMER_D);
+    fails += tinyformer_encode_masked_ctx(&b, pad, half, n_feat, out[2]) != 0;
+    fails += memcmp(out[1], out[2], sizeof(out[1])) != 0;
+    for (int k = half * TINYFORMER_D; k < TINYFORMER_S * TINYFORMER_D; ++k) {
+      fails += out[1][k / TINYFORMER_D][k % TINYFORMER_D] != 0;
+    }
+#if TINYFORMER_CAUSAL
+    fails += memcmp(out[1], ref[1], (size_t)half * TINYFORMER_D) != 0;
+#endif
+    fails += tinyformer_encode_masked(pad, 0, n_feat, out[1]) != -1;
+    fails += tinyformer_encode_masked(pad, half, n_feat + 1, out[1]) != -1;
+  }
+#endif
+#if TINYFORMER_SHARED_LAYERS
+  // A shared stack without overrides is the plain one; with its own FFN output
+  // bias on layer 1 it is that stack spelled out by hand.
+  {
+    static int8_t b_ff2[TINYFORMER_D];
+    tinyformer_layer_bias_t own[2];
+    tinyformer_weights_t shared[2], manual[2] = {tinyformer_default_weights, tinyformer_default_weights};
+    memset(own, 0, sizeof(own));
+    for (int d = 0; d < TINYFORMER_D; ++d) {
+      b_ff2[d] = (int8_t)(tinyformer_default_weights.b_ff2[d] + 3 * d - 40);
+    }
+    own[1].b_ff2 = b_ff2;
+    manual[1].b_ff2 = b_ff2;
+    tinyformer_share_layers(shared, 2, &tinyformer_default_weights, 0);
+    tinyformer_stack_encode(shared, 2, demo_inputs[0], out[2]);
+    fails += memcmp(out[0], out[2], sizeof(out[0])) != 0;
+    tinyformer_share_layers(shared, 2, &tinyformer_default_weights, own);
+    tinyformer_stack_encode(shared, 2, demo_inputs[0], out[2]);
+    tinyformer_stack_encode_ctx(&b, manual, 2, demo_inputs[0], out[3]);
+    fails += memcmp(out[2], out[3], sizeof(out[2])) != 0;
+  }
+#endif
+  if (fails == 0) {
+    printf("CTX OK workspace=%u bound=%u\n", (unsigned)tinyformer_workspace_size(),
+           (unsigned)TINYFORMER_WORKSPACE_BYTES);
+  } else {
+    printf("CTX FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+
+#if !TINYFORMER_INT4_WEIGHTS
+// Weight store over a host "flash" image of STORE_LAYERS distinct layers
+// (layer 0 = default weights, later ones synthetic): streamed through
+// the two buffers, read in place, and the unpermuted layer against the
+// static encoder.
+#define STORE_LAYERS 3
+
+static uint8_t store_image[STORE_LAYERS][TF_STORE_LAYER_BYTES] __attribute__((aligned(4)));
+static uint8_t store_buf[2][TF_STORE_LAYER_BYTES] __attribute__((aligned(4)));
+
+static void store_build(void) {
+  tf_store_pack_layer(store_image[0], &tinyformer_default_weights);
+  for (int l = 1; l < STORE_LAYERS; ++l) {
+    for (uint32_t i = 0; i < TF_STORE_LAYER_BYTES; ++i) {
+      store_image[l][i] = (i < TF_STORE_MATRIX_BYTES)
+                              ? (uint8_t)((i * 37u + (uint32_t)l * 11u) % 255u)
+                              : store_image[0][i];
+    }
+  }
+}
+
+static int store_check(void) {
+  static int8_t ref[TINYFORMER_S][TINYFORMER_D];
+  static int8_t out[TINYFORMER_S][TINYFORMER_D];
+  tf_store_t st;
+  int fails = 0;
+
+  store_build();
+  if (tf_store_init(&st, store_image, 1, store_buf[0], store_buf[1] + 1) == 0 ||
+      tf_store_init(&st, store_image, 1, store_buf[0], store_buf[1]) != 0) {
+    printf("STORE FAIL init\n");
+    return 1;
+  }
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    tinyformer_encode(demo_inputs[i], ref);
+    tf_store_stack_encode(&st, demo_inputs[i], out);
+    fails += memcmp(out, ref, sizeof(out)) != 0;
+  }
+  tf_store_init(&st, store_image, STORE_LAYERS, store_buf[0], store_buf[1]);
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    tinyformer_stack_encode_src(tf_store_layer_xip, &st, STORE_LAYERS, demo_inputs[i], ref);
+    tf_store_stack_encode(&st, demo_inputs[i], out);
+    fails += memcmp(out, ref, sizeof(out)) != 0;
+  }
+  if (fails == 0) {
+    printf("STORE OK layers=%d layer_bytes=%u\n", STORE_LAYERS, (unsigned)TF_STORE_LAYER_BYTES);
+  } else {
+    printf("STORE FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+
+static int store_image_file(const char *path) {
+  FILE *f = fopen(path, "wb");
+  store_build();
+  if (f == 0 || fwrite(store_image, sizeof(store_image), 1, f) != 1) {
+    fprintf(stderr, "%s: write failed\n", path);
+    return 1;
+  }
+  fclose(f);
+  return 0;
+}
+
+// Compressed store_image[] (make wz-check): the store must expand every
+// layer to the raw image and run the stack as the raw store does; damaged
+// images must be rejected. Prints the decode cycles per layer.
+static int store_wz_file(const char *path) {
+  static uint32_t wz[2 * sizeof(store_image) / 4 + 64];
+  static uint8_t raw_buf[2][TF_STORE_LAYER_BYTES] __attribute__((aligned(4)));
+  static int8_t ref[TINYFORMER_S][TINYFORMER_D];
+  static int8_t out[TINYFORMER_S][TINYFORMER_D];
+  tf_store_t st, raw;
+  int fails = 0;
+  FILE *f = fopen(path, "rb");
+  uint32_t bytes = f ? (uint32_t)fread(wz, 1, sizeof(wz), f) : 0;
+
+  if (f != 0) {
+    fclose(f);
+  }
+  store_build();
+  if (tf_store_init_compressed(&st, wz, bytes, STORE_LAYERS + 1, store_buf[0], store_buf[1]) == 0 ||
+      tf_store_init_compressed(&st, wz, bytes - 4, STORE_LAYERS, store_buf[0], store_buf[1]) == 0 ||
+      tf_store_init_compressed(&st, wz, bytes, STORE_LAYERS, store_buf[0], store_buf[1]) != 0) {
+    printf("WZ FAIL init %s (%u bytes)\n", path, (unsigned)bytes);
+    return 1;
+  }
+  uint32_t c0 = cycle_counter_read();
+  for (int l = 0; l < STORE_LAYERS; ++l) {
+    fails += memcmp(tf_store_layer(&st, l)->W_q, store_image[l], TF_STORE_LAYER_BYTES) != 0;
+  }
+  uint32_t cycles = (uint32_t)(cycle_counter_read() - c0) / STORE_LAYERS;
+  tf_store_init(&raw, store_image, STORE_LAYERS, raw_buf[0], raw_buf[1]);
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    tf_store_stack_encode(&raw, demo_inputs[i], ref);
+    tf_store_stack_encode(&st, demo_inputs[i], out);
+    fails += memcmp(out, ref, sizeof(out)) != 0;
+    tinyformer_stack_encode_src(tf_store_layer_xip, &st, STORE_LAYERS, demo_inputs[i], out);
+    fails += memcmp(out, ref, sizeof(out)) != 0;
+  }
+  // A flipped code bit must fail the CRC at init.
+  ((uint8_t *)wz)[bytes / 2] ^= 0x10u;
+  fails += tf_store_init_compressed(&st, wz, bytes, STORE_LAYERS, store_buf[0], store_buf[1]) == 0;
+  if (fails == 0) {
+    printf("WZ OK layers=%d raw=%u compressed=%u cycles_per_layer=%u\n", STORE_LAYERS,
+           (unsigned)sizeof(store_image), (unsigned)bytes, (unsigned)cycles);
+  } else {
+    printf("WZ FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+#endif // !TINYFORMER_INT4_WEIGHTS
+
+// Model blob built from the default weights and the demo heads, loaded in
+// place: must reproduce the static classifier, and damaged or mismatched
+// blobs must be rejected.
+#define BLOB_BYTES   16384
+#define BLOB_MAX_DIR 40
+
+static uint8_t blob[BLOB_BYTES] __attribute__((aligned(16)));
+static uint8_t blob_bad[BLOB_BYTES] __attribute__((aligned(16)));
+static uint8_t ws_blob[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+
+// Append one tensor at the next TF_BLOB_ALIGN offset after the reserved
+// directory.
+static void blob_put(uint16_t id, uint8_t dtype, uint16_t rows, uint16_t cols,
+                     const void *data, uint32_t bytes) {
+  tf_blob_header_t *h = (tf_blob_header_t *)blob;
+  tf_blob_tensor_t *t = (tf_blob_tensor_t *)(blob + h->header_bytes) + h->n_tensors++;
+  uint32_t off = (h->total_bytes + TF_BLOB_ALIGN - 1u) & ~(TF_BLOB_ALIGN - 1u);
+
+  memset(t, 0, sizeof(*t));
+  t->id = id;
+  t->dtype = dtype;
+  t->rows = rows;
+  t->cols = cols;
+  t->offset = off;
+  t->bytes = bytes;
+  memcpy(blob + off, data, bytes);
+  h->total_bytes = off + bytes;
+}
+
+static void blob_seal(uint8_t *b) {
+  tf_blob_header_t *h = (tf_blob_header_t *)b;
+  h->crc32 = 0;
+  h->crc32 = tf_blob_crc32(0, b, h->total_bytes);
+}
+
+// W_q/W_k/W_v as [D][D] blob tensors when w narrows them (w->d_in).
+static uint8_t blob_qkv[3][TINYFORMER_D * TINYFORMER_D];
+
+static uint32_t blob_build(const tinyformer_weights_t *w) {
+  static const int32_t margin[2] = {DEMO_EXIT_IN_MARGIN, DEMO_EXIT_ATTN_MARGIN};
+  const tinyformer_wword_t *mat[6] = {w->W_q, w->W_k, w->W_v, w->W_o, w->W_ff1, w->W_ff2};
+  const int8_t *bias[6] = {w->b_q, w->b_k, w->b_v, w->b_o, w->b_ff1, w->b_ff2};
+  const uint16_t rows[6] = {TINYFORMER_D, TINYFORMER_D, TINYFORMER_D,
+                            TINYFORMER_D, TINYFORMER_FFN, TINYFORMER_D};
+  const uint16_t cols[6] = {TINYFORMER_D, TINYFORMER_D, TINYFORMER_D,
+                            TINYFORMER_D, TINYFORMER_D, TINYFORMER_FFN};
+  const uint8_t mtype = TINYFORMER_INT4_WEIGHTS ? TF_BLOB_INT4 : TF_BLOB_INT8;
+  tf_blob_header_t *h = (tf_blob_header_t *)blob;
+
+  memset(blob, 0, sizeof(blob));
+  h->magic = TF_BLOB_MAGIC;
+  h->version = TF_BLOB_VERSION;
+  h->header_bytes = sizeof(*h);
+  h->S = TINYFORMER_S;
+  h->D = TINYFORMER_D;
+  h->FFN = TINYFORMER_FFN;
+  h->n_classes = DEMO_NUM_CLASSES;
+  h->flags = (w->rq ? TF_BLOB_F_PER_CHANNEL : 0) | (TINYFORMER_INT4_WEIGHTS ? TF_BLOB_F_INT4 : 0) |
+             (TINYFORMER_HEADS - 1) << TF_BLOB_F_HEADS_SHIFT;
+  h->total_bytes = sizeof(*h) + BLOB_MAX_DIR * sizeof(tf_blob_tensor_t);
+  for (int l = 0; l < 6; ++l) {
+    uint32_t n = (uint32_t)rows[l] * cols[l];
+    uint32_t bytes = TINYFORMER_INT4_WEIGHTS ? n / 2u : n;
+    const void *data = mat[l];
+    if (l < 3 && w->d_in > 0 && w->d_in < TINYFORMER_D) {
+      // Zero-pad the narrowed rows (a prefix of each full row) back to D columns
+      uint32_t row = bytes / rows[l], narrow = row * (uint32_t)w->d_in / TINYFORMER_D;
+      memset(blob_qkv[l], 0, bytes);
+      for (uint32_t r = 0; r < rows[l]; ++r) {
+        memcpy(&blob_qkv[l][r * row], (const uint8_t *)mat[l] + r * narrow, narrow);
+      }
+      data = blob_qkv[l];
+    }
+    blob_put((uint16_t)(TF_BLOB_T_W_Q + l), mtype, rows[l], cols[l], data, bytes);
+  }
+  for (int l = 0; l < 6; ++l) {
+    blob_put((uint16_t)(TF_BLOB_T_B_Q + l), TF_BLOB_INT8, rows[l], 1, bias[l], rows[l]);
+  }
+  for (int l = 0; w->rq && l < 6; ++l) {
+    blob_put((uint16_t)(TF_BLOB_T_RQ_BIAS + l), TF_BLOB_INT32, rows[l], 1, w->rq[l].bias, 4u * rows[l]);
+  }
+  for (int l = 0; w->rq && l < 6; ++l) {
+    blob_put((uint16_t)(TF_BLOB_T_RQ_MUL + l), TF_BLOB_INT32, rows[l], 1, w->rq[l].mul, 4u * rows[l]);
+  }
+  for (int l = 0; w->rq && l < 6; ++l) {
+    blob_put((uint16_t)(TF_BLOB_T_RQ_SHIFT + l), TF_BLOB_UINT8, rows[l], 1, w->rq[l].shift, rows[l]);
+  }
+  blob_put(TF_BLOB_T_CLS_W, TF_BLOB_INT8, DEMO_NUM_CLASSES, TINYFORMER_D, cls_W, sizeof(cls_W));
+  blob_put(TF_BLOB_T_CLS_B, TF_BLOB_INT8, DEMO_NUM_CLASSES, 1, cls_b, sizeof(cls_b));
+  blob_put(TF_BLOB_T_EXIT_IN_W, TF_BLOB_INT8, DEMO_NUM_CLASSES, TINYFORMER_D, exit_in_W, sizeof(exit_in_W));
+  blob_put(TF_BLOB_T_EXIT_IN_B, TF_BLOB_INT8, DEMO_NUM_CLASSES, 1, exit_in_b, sizeof(exit_in_b));
+  blob_put(TF_BLOB_T_EXIT_IN_MARGIN, TF_BLOB_INT32, 1, 1, &margin[0], 4);
+  blob_put(TF_BLOB_T_EXIT_ATTN_W, TF_BLOB_INT8, DEMO_NUM_CLASSES, TINYFORMER_D, exit_attn_W, sizeof(exit_attn_W));
+  blob_put(TF_BLOB_T_EXIT_ATTN_B, TF_BLOB_INT8, DEMO_NUM_CLASSES, 1, exit_attn_b, sizeof(exit_attn_b));
+  blob_put(TF_BLOB_T_EXIT_ATTN_MARGIN, TF_BLOB_INT32, 1, 1, &margin[1], 4);
+  blob_seal(blob);
+  return h->total_bytes;
+}
+
+// Load a copy of the blob after mutate(); sealed again if reseal.
+static int blob_try(uint32_t bytes, int reseal, void (*mutate)(uint8_t *)) {
+  tf_model_t m;
+  memcpy(blob_bad, blob, sizeof(blob));
+  mutate(blob_bad);
+  if (reseal) {
+    blob_seal(blob_bad);
+  }
+  return tf_blob_load(&m, blob_bad, bytes);
+}
+
+static void mut_data(uint8_t *b) { b[((tf_blob_header_t *)b)->total_bytes - 5] ^= 0x01; }
+static void mut_magic(uint8_t *b) { b[0] ^= 0x20; }
+static void mut_version(uint8_t *b) { ((tf_blob_header_t *)b)->version = TF_BLOB_VERSION + 1; }
+static void mut_shape(uint8_t *b) { ((tf_blob_header_t *)b)->D = TINYFORMER_D / 2; }
+static void mut_flags(uint8_t *b) { ((tf_blob_header_t *)b)->flags ^= TF_BLOB_F_INT4; }
+static void mut_align(uint8_t *b) { ((tf_blob_tensor_t *)(b + sizeof(tf_blob_header_t)))[3].offset += 4; }
+static void mut_dup(uint8_t *b) { ((tf_blob_tensor_t *)(b + sizeof(tf_blob_header_t)))[1].id = TF_BLOB_T_W_Q; }
+static void mut_dims(uint8_t *b) { ((tf_blob_tensor_t *)(b + sizeof(tf_blob_header_t)))[4].rows = TINYFORMER_D; }
+static void mut_missing(uint8_t *b) { ((tf_blob_header_t *)b)->n_tensors = 11; }
+static void mut_none(uint8_t *b) { (void)b; }
+
+static int blob_check(void) {
+  uint32_t bytes = blob_build(&tinyformer_default_weights);
+  const tf_blob_header_t *h = (const tf_blob_header_t *)blob;
+  tinyformer_ctx_t ctx;
+  tf_model_t m;
+  int fails = 0;
+
+  if (tf_blob_load(&m, blob, bytes) != TF_BLOB_OK ||
+      tinyformer_ctx_init(&ctx, ws_blob, sizeof(ws_blob)) != 0) {
+    printf("BLOB FAIL load\n");
+    return 1;
+  }
+  ctx.weights = &m.weights;
+  fails += (m.weights.W_qkv != 0) != (TINYFORMER_FUSED_QKV != 0);
+  fails += m.head.n_classes != DEMO_NUM_CLASSES || m.exit_attn.head.n_classes != DEMO_NUM_CLASSES;
+  for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+    static const tinyformer_exit_t exit_in = {
+        {&exit_in_W[0][0], exit_in_b, DEMO_NUM_CLASSES}, DEMO_EXIT_IN_MARGIN};
+    static const tinyformer_exit_t exit_attn = {
+        {&exit_attn_W[0][0], exit_attn_b, DEMO_NUM_CLASSES}, DEMO_EXIT_ATTN_MARGIN};
+    int32_t logits[DEMO_NUM_CLASSES];
+    uint32_t cksum = 0, ref_cksum;
+    int stage, ref_stage;
+    int ref = tinyformer_classify(&head, demo_inputs[i], logits, &ref_cksum);
+    fails += tinyformer_classify_ctx(&ctx, &m.head, demo_inputs[i], logits, &cksum) != ref;
+    fails += cksum != golden_cksum[i];
+    ref = tinyformer_classify_early(&head, &exit_in, &exit_attn, demo_inputs[i], logits,
+                                    &ref_cksum, &ref_stage);
+    fails += tinyformer_classify_early_ctx(&ctx, &m.head, &m.exit_in, &m.exit_attn,
+                                           demo_inputs[i], logits, &cksum, &stage) != ref;
+    fails += stage != ref_stage;
+  }
+  fails += blob_try(bytes, 0, mut_none) != TF_BLOB_OK;
+  fails += blob_try(bytes, 0, mut_data) != TF_BLOB_E_CRC;
+  fails += blob_try(bytes, 0, mut_magic) != TF_BLOB_E_MAGIC;
+  fails += blob_try(bytes, 1, mut_version) != TF_BLOB_E_VERSION;
+  fails += blob_try(bytes, 1, mut_shape) != TF_BLOB_E_SHAPE;
+  fails += blob_try(bytes, 1, mut_flags) != TF_BLOB_E_FORMAT;
+  fails += blob_try(bytes - 1, 0, mut_none) != TF_BLOB_E_SIZE;
+  fails += blob_try(bytes, 1, mut_align) != TF_BLOB_E_TENSOR;
+  fails += blob_try(bytes, 1, mut_dup) != TF_BLOB_E_TENSOR;
+  fails += blob_try(bytes, 1, mut_dims) != TF_BLOB_E_TENSOR;
+  fails += blob_try(bytes, 1, mut_missing) != TF_BLOB_E_MISSING;
+  fails += tf_blob_load(&m, blob + 4, bytes - 4) != TF_BLOB_E_MAGIC;
+  fails += tf_blob_load(&m, blob + 1, bytes - 1) != TF_BLOB_E_SIZE;
+  if (fails == 0) {
+    printf("BLOB OK bytes=%u tensors=%u\n", (unsigned)bytes, (unsigned)h->n_tensors);
+  } else {
+    printf("BLOB FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+
+// Multi-model runtime: the built-in model with two heads on one encoder pass
+// and the blob of blob_check() as a second model, under both policies; every
+// head must match tinyformer_classify() with that head alone.
+static uint8_t ws_rt[TINYFORMER_WORKSPACE_BYTES] __attribute__((aligned(8)));
+
+static int rt_check(void) {
+  static const tinyformer_head_t aux = {&exit_attn_W[0][0], exit_attn_b, DEMO_NUM_CLASSES};
+  uint32_t bytes = blob_build(&tinyformer_default_weights);
+  tf_rt_t rt;
+  int fails = 0;
+
+  for (int policy = TF_RT_ROUND_ROBIN; policy <= TF_RT_PRIORITY; ++policy) {
+    tf_rt_init(&rt, policy);
+    int har = tf_rt_add_model(&rt, &tinyformer_default_weights, ws_rt, sizeof(ws_rt), 0);
+    int alt = tf_rt_add_blob(&rt, blob, bytes, ws_blob, sizeof(ws_blob), 1, 0);
+    if (har != 0 || alt != 1 || tf_rt_add_head(&rt, har, &head) != 0 ||
+        tf_rt_add_head(&rt, har, &aux) != 1 || tf_rt_add_head(&rt, alt, &aux) != 1 ||
+        tf_rt_add_model(&rt, &tinyformer_default_weights, ws_a, sizeof(ws_a), 0) >= 0) {
+      printf("RT FAIL init\n");
+      return 1;
+    }
+    fails += tf_rt_step(&rt) != -1;
+    for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+      int32_t logits[2][DEMO_NUM_CLASSES];
+      uint32_t cksum;
+      int ref[2];
+      ref[0] = tinyformer_classify(&head, demo_inputs[i], logits[0], &cksum);
+      ref[1] = tinyformer_classify(&aux, demo_inputs[i], logits[1], &cksum);
+      fails += tf_rt_submit(&rt, har, demo_inputs[i]) != 0;
+      fails += tf_rt_submit(&rt, har, demo_inputs[i]) != -1;
+      fails += tf_rt_submit(&rt, alt, demo_inputs[i]) != 0;
+      // Priority runs the blob model first; round-robin resumes after alt.
+      int first = (policy == TF_RT_PRIORITY) ? alt : har;
+      fails += tf_rt_step(&rt) != first;
+      fails += tf_rt_step(&rt) != (first == har ? alt : har);
+      fails += tf_rt_step(&rt) != -1;
+      for (int m = 0; m < 2; ++m) {
+        const tf_rt_result_t *r = tf_rt_result(&rt, m);
+        fails += r->window != (uint32_t)i || r->cksum != golden_cksum[i];
+        fails += r->label[0] != ref[0] || r->label[1] != ref[1];
+        fails += memcmp(r->logits, logits, sizeof(logits)) != 0;
+      }
+    }
+  }
+  if (fails == 0) {
+    printf("RT OK models=%d heads=2\n", rt.n_models);
+  } else {
+    printf("RT FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+
+#if TINYFORMER_TIERS
+// Model tiers: a pack of the student blobs and the default-model blob of
+// blob_check(), each tier loaded from it and checked against its encoder
+// instance run straight on the synthetic weights (and the large tier against
+// tinyformer_classify()); missing, damaged and misplaced blobs must fail.
+#define TIER_MAX_W (TINYFORMER_MAX_FFN * TINYFORMER_MAX_D)
+
+typedef struct {
+  int8_t W[6][TIER_MAX_W];
+  int8_t b[6][TINYFORMER_MAX_FFN];
+  int8_t cls_W[DEMO_NUM_CLASSES * TINYFORMER_MAX_D];
+  int8_t cls_b[DEMO_NUM_CLASSES];
+  tinyformer_weights_t w;
+  tinyformer_head_t head;
+} tier_model_t;
+
+static tier_model_t tier_ref[TF_TIER_COUNT];
+static uint8_t tier_pack[3 * BLOB_BYTES] __attribute__((aligned(16)));
+
+static int8_t tier_rand(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  return (int8_t)((int32_t)(*seed >> 24) % 32);
+}
+
+// Synthetic int8 weights of tier k and its classifier.
+static void tier_fill(int k) {
+  const tf_tier_shape_t *s = &tf_tier_shapes[k];
+  tier_model_t *m = &tier_ref[k];
+  uint32_t seed = 0x7F4A7C15u + (uint32_t)k;
+  for (int l = 0; l < 6; ++l) {
+    for (int i = 0; i < TIER_MAX_W; ++i) {
+      m->W[l][i] = tier_rand(&seed);
+    }
+    for (int i = 0; i < TINYFORMER_MAX_FFN; ++i) {
+      m->b[l][i] = tier_rand(&seed);
+    }
+  }
+  for (int i = 0; i < DEMO_NUM_CLASSES * s->D; ++i) {
+    m->cls_W[i] = tier_rand(&seed);
+  }
+  for (int i = 0; i < DEMO_NUM_CLASSES; ++i) {
+    m->cls_b[i] = tier_rand(&seed);
+  }
+  memset(&m->w, 0, sizeof(m->w));
+  m->w.W_q = m->W[0];
+  m->w.W_k = m->W[1];
+  m->w.W_v = m->W[2];
+  m->w.W_o = m->W[3];
+  m->w.W_ff1 = m->W[4];
+  m->w.W_ff2 = m->W[5];
+  m->w.b_q = m->b[0];
+  m->w.b_k = m->b[1];
+  m->w.b_v = m->b[2];
+  m->w.b_o = m->b[3];
+  m->w.b_ff1 = m->b[4];
+  m->w.b_ff2 = m->b[5];
+  m->head.W = m->cls_W;
+  m->head.b = m->cls_b;
+  m->head.n_classes = DEMO_NUM_CLASSES;
+}
+
+// Blob of student k in blob[]; returns its size.
+static uint32_t tier_blob_build(int k) {
+  const tf_tier_shape_t *s = &tf_tier_shapes[k];
+  const tier_model_t *m = &tier_ref[k];
+  tf_blob_header_t *h = (tf_blob_header_t *)blob;
+  memset(blob, 0, sizeof(blob));
+  h->magic = TF_BLOB_MAGIC;
+  h->version = TF_BLOB_VERSION;
+  h->header_bytes = sizeof(*h);
+  h->S = s->S;
+  h->D = s->D;
+  h->FFN = s->FFN;
+  h->n_classes = DEMO_NUM_CLASSES;
+  h->flags = (TINYFORMER_HEADS - 1) << TF_BLOB_F_HEADS_SHIFT;
+  h->total_bytes = sizeof(*h) + BLOB_MAX_DIR * sizeof(tf_blob_tensor_t);
+  for (int l = 0; l < 6; ++l) {
+    uint16_t rows = (l == TINYFORMER_RQ_FF1) ? s->FFN : s->D;
+    uint16_t cols = (l == TINYFORMER_RQ_FF2) ? s->FFN : s->D;
+    blob_put((uint16_t)(TF_BLOB_T_W_Q + l), TF_BLOB_INT8, rows, cols, m->W[l], (uint32_t)rows * cols);
+  }
+  for (int l = 0; l < 6; ++l) {
+    uint16_t rows = (l == TINYFORMER_RQ_FF1) ? s->FFN : s->D;
+    blob_put((uint16_t)(TF_BLOB_T_B_Q + l), TF_BLOB_INT8, rows, 1, m->b[l], rows);
+  }
+  blob_put(TF_BLOB_T_CLS_W, TF_BLOB_INT8, DEMO_NUM_CLASSES, s->D, m->cls_W, DEMO_NUM_CLASSES * s->D);
+  blob_put(TF_BLOB_T_CLS_B, TF_BLOB_INT8, DEMO_NUM_CLASSES, 1, m->cls_b, DEMO_NUM_CLASSES);
+  blob_seal(blob);
+  return h->total_bytes;
+}
+
+// Append blob[0 .. bytes) to the pack at the next TF_BLOB_ALIGN offset.
+static uint32_t tier_pack_add(uint32_t at, uint32_t bytes) {
+  at = (at + TF_BLOB_ALIGN - 1u) & ~(TF_BLOB_ALIGN - 1u);
+  memcpy(tier_pack + at, blob, bytes);
+  return at + bytes;
+}
+
+// Reference run of student k: pooled window, its instance, mean pool and
+// head written out here.
+static int tier_reference(int k, const int8_t in[TINYFORMER_S][TINYFORMER_D], int32_t *logits,
+                          uint32_t *cksum) {
+  static int8_t x[TINYFORMER_S * TINYFORMER_MAX_D], y[TINYFORMER_S * TINYFORMER_MAX_D];
+  const tf_tier_shape_t *s = &tf_tier_shapes[k];
+  const tier_model_t *m = &tier_ref[k];
+  const int f = TINYFORMER_S / s->S;
+  int best = 0;
+
+  for (int t = 0; t < s->S; ++t) {
+    for (int d = 0; d < s->D; ++d) {
+      int32_t sum = 0;
+      for (int j = 0; j < f; ++j) {
+        sum += (d < TINYFORMER_D) ? in[t * f + j][d] : 0;
+      }
+      // floor((sum + f / 2) / f)
+      int32_t q = sum + f / 2;
+      x[t * s->D + d] = (int8_t)((q >= 0) ? q / f : -((-q + f - 1) / f));
+    }
+  }
+  if (k == TF_TIER_MEDIUM) {
+    tinyformer_encode_medium(&m->w, (const int8_t(*)[TINYFORMER_TIER_MEDIUM_D])x,
+                             (int8_t(*)[TINYFORMER_TIER_MEDIUM_D])y);
+  } else {
+    tinyformer_encode_small(&m->w, (const int8_t(*)[TINYFORMER_TIER_SMALL_D])x,
+                            (int8_t(*)[TINYFORMER_TIER_SMALL_D])y);
+  }
+  *cksum = 0;
+  for (int i = 0; i < s->S * s->D; ++i) {
+    *cksum += (uint8_t)y[i];
+  }
+  for (int c = 0; c < DEMO_NUM_CLASSES; ++c) {
+    logits[c] = m->cls_b[c];
+  }
+  for (int d = 0; d < s->D; ++d) {
+    int32_t sum = 0;
+    for (int t = 0; t < s->S; ++t) {
+      sum += y[t * s->D + d];
+    }
+    int32_t p = (sum + s->S / 2) / s->S;
+    p = p > 127 ? 127 : (p < -128 ? -128 : p);
+    for (int c = 0; c < DEMO_NUM_CLASSES; ++c) {
+      logits[c] += m->cls_W[c * s->D + d] * p;
+    }
+  }
+  for (int c = 1; c < DEMO_NUM_CLASSES; ++c) {
+    best = logits[c] > logits[best] ? c : best;
+  }
+  return best;
+}
+
+static int tiers_check(void) {
+  static tf_tier_t tier;
+  uint32_t at[TF_TIER_COUNT], size[TF_TIER_COUNT], cycles[TF_TIER_COUNT];
+  uint32_t end = 0;
+  tf_model_t m;
+  int fails = 0;
+
+  // Pack order small, large, medium: tiers are found by shape, not position.
+  static const int order[TF_TIER_COUNT] = {TF_TIER_SMALL, TF_TIER_LARGE, TF_TIER_MEDIUM};
+  for (int i = 0; i < TF_TIER_COUNT; ++i) {
+    int k = order[i];
+    if (k == TF_TIER_LARGE) {
+      size[k] = blob_build(&tinyformer_default_weights);
+    } else {
+      tier_fill(k);
+      size[k] = tier_blob_build(k);
+      fails += tf_blob_load(&m, blob, size[k]) != TF_BLOB_E_SHAPE;
+    }
+    at[k] = (end + TF_BLOB_ALIGN - 1u) & ~(TF_BLOB_ALIGN - 1u);
+    end = tier_pack_add(end, size[k]);
+  }
+
+  fails += tf_tier_load(&tier, tier_pack, end, TF_TIER_ANY) != TF_BLOB_OK || tier.tier != TF_TIER_SMALL;
+  for (int k = 0; k < TF_TIER_COUNT; ++k) {
+    if (tf_tier_load(&tier, tier_pack, end, k) != TF_BLOB_OK || tier.tier != k ||
+        (const uint8_t *)tier.model.header != tier_pack + at[k]) {
+      printf("TIERS FAIL load tier=%s\n", tf_tier_shapes[k].name);
+      return fails + 1;
+    }
+    cycles[k] = 0;
+    for (int i = 0; i < DEMO_NUM_SAMPLES; ++i) {
+      int32_t logits[DEMO_NUM_CLASSES], ref_logits[DEMO_NUM_CLASSES];
+      uint32_t cksum, ref_cksum;
+      int ref = (k == TF_TIER_LARGE)
+                    ? tinyformer_classify(&head, demo_inputs[i], ref_logits, &ref_cksum)
+                    : tier_reference(k, demo_inputs[i], ref_logits, &ref_cksum);
+      uint32_t t0 = cycle_counter_read();
+      int label = tf_tier_classify(&tier, demo_inputs[i], logits, &cksum);
+      cycles[k] += cycle_counter_read() - t0;
+      fails += label != ref || cksum != ref_cksum;
+      fails += memcmp(logits, ref_logits, sizeof(logits)) != 0;
+      fails += k == TF_TIER_LARGE && cksum != golden_cksum[i];
+    }
+    cycles[k] /= DEMO_NUM_SAMPLES;
+  }
+
+  // Without the medium blob (a pack of two), with a damaged one, misaligned.
+  fails += tf_tier_load(&tier, tier_pack, at[TF_TIER_MEDIUM], TF_TIER_MEDIUM) != TF_BLOB_E_SHAPE;
+  tier_pack[at[TF_TIER_MEDIUM] + size[TF_TIER_MEDIUM] - 3] ^= 0x01;
+  fails += tf_tier_load(&tier, tier_pack, end, TF_TIER_MEDIUM) != TF_BLOB_E_CRC;
+  tier_pack[at[TF_TIER_MEDIUM] + size[TF_TIER_MEDIUM] - 3] ^= 0x01;
+  fails += tf_tier_load(&tier, tier_pack + 2, end - 2, TF_TIER_ANY) != TF_BLOB_E_SIZE;
+  fails += tf_tier_load(&tier, tier_pack + 4, end - 4, TF_TIER_ANY) != TF_BLOB_E_SHAPE;
+  if (fails == 0) {
+    printf("TIERS OK tiers=%d pack=%u cycles large=%u medium=%u small=%u\n", TF_TIER_COUNT,
+           (unsigned)end, (unsigned)cycles[TF_TIER_LARGE], (unsigned)cycles[TF_TIER_MEDIUM],
+           (unsigned)cycles[TF_TIER_SMALL]);
+  } else {
+    printf("TIERS FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+#endif
+
+// COBS framing round trip through uf_send() into a capture buffer and back
+// through uf_rx_byte(), including zero runs and 254-byte blocks; a flipped
+// byte must fail the CRC and the decoder must resynchronise at the next
+// frame.
+static int frame_check(void) {
+  static uint8_t body[UF_MAX_BODY];
+  static const uint32_t sizes[] = {0, 1, 253, 254, 255, 300, UF_MAX_BODY};
+  static uf_rx_t rx;
+  int fails = 0;
+
+  for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    for (int pattern = 0; pattern < 3; ++pattern) {
+      uint32_t n = sizes[s];
+      for (uint32_t i = 0; i < n; ++i) {
+        body[i] = (pattern == 0) ? 0 : (pattern == 1) ? (uint8_t)(1 + i % 255) : (uint8_t)(i * 7 % 5);
+      }
+      frame_wire_len = 0;
+      frame_capture = 1;
+      uf_send(UF_T_WINDOW, (uint8_t)s, body, n);
+      uf_send(UF_T_HELLO, 0x5A, 0, 0);
+      frame_capture = 0;
+      for (int corrupt = 0; corrupt < 2; ++corrupt) {
+        int got = 0, bad = 0, hello = 0;
+        if (corrupt) {
+          /* a byte inside the first frame, never turned into a delimiter */
+          uint8_t *p = &frame_wire[1 + n / 2];
+          *p = (uint8_t)((*p == 0xFF) ? 0x01 : *p + 1);
+        }
+        uf_rx_reset(&rx);
+        for (uint32_t i = 0; i < frame_wire_len; ++i) {
+          int r = uf_rx_byte(&rx, frame_wire[i]);
+          if (r == (int)(n + 2) && rx.buf[0] == UF_T_WINDOW && rx.buf[1] == (uint8_t)s &&
+              memcmp(&rx.buf[2], body, n) == 0) {
+            got++;
+          } else if (r == 2 && rx.buf[0] == UF_T_HELLO && rx.buf[1] == 0x5A) {
+            hello++;
+          } else if (r != 0) {
+            bad++;
+          }
+        }
+        fails += corrupt ? (got != 0 || bad != 1 || hello != 1) : (got != 1 || bad != 0 || hello != 1);
+      }
+    }
+  }
+  if (fails == 0) {
+    printf("FRAME OK max_body=%u\n", (unsigned)UF_MAX_BODY);
+  } else {
+    printf("FRAME FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+
+// Synthetic raw IMU stream (Q12): per-channel sines plus a slow drift.
+static void feat_sample(uint32_t t, int16_t sample[IMU_FEAT_CHANNELS]) {
+  for (int c = 0; c < IMU_FEAT_CHANNELS; ++c) {
+    int32_t phase = (int32_t)((t * (uint32_t)(3 + 2 * c)) % 64) - 32;
+    int32_t tri = (phase < 0 ? -phase : phase) - 16; /* triangle, -16..16 */
+    sample[c] = (int16_t)(tri * (c < 3 ? 96 : 320) + (int32_t)(t % 512) - 256);
+  }
+}
+
+// imu_feat_push() one sample at a time must give imu_feat_window() of each
+// window (reset per window), and the padding features must stay zero.
+static int feat_check(void) {
+  static int16_t raw[IMU_FEAT_WINDOW][IMU_FEAT_CHANNELS];
+  static int8_t want[TINYFORMER_S][TINYFORMER_D];
+  int8_t token[TINYFORMER_D];
+  imu_feat_t st;
+  int fails = 0, tokens = 0;
+
+  for (uint32_t w = 0; w < 4; ++w) {
+    for (int t = 0; t < IMU_FEAT_WINDOW; ++t) {
+      feat_sample(w * IMU_FEAT_WINDOW + (uint32_t)t, raw[t]);
+    }
+    imu_feat_window(raw, want);
+    imu_feat_reset(&st);
+    int s = 0;
+    for (int t = 0; t < IMU_FEAT_WINDOW; ++t) {
+      if (imu_feat_push(&st, raw[t], token)) {
+        fails += memcmp(token, want[s++], TINYFORMER_D) != 0;
+      }
+    }
+    fails += s != TINYFORMER_S;
+    tokens += s;
+    for (s = 0; s < TINYFORMER_S; ++s) {
+      for (int d = IMU_FEAT_FEATURES; d < TINYFORMER_D; ++d) {
+        fails += want[s][d] != 0;
+      }
+    }
+  }
+  if (fails == 0) {
+    printf("FEAT OK tokens=%d window=%d\n", tokens, IMU_FEAT_WINDOW);
+  } else {
+    printf("FEAT FAIL mismatches=%d\n", fails);
+  }
+  return fails;
+}
+
+// tinyformer_host features: raw windows file -> token windows file.
+static int features_file(const char *in_path, const char *out_path) {
+  static int16_t raw[IMU_FEAT_WINDOW][IMU_FEAT_CHANNELS];
+  static uint8_t bytes[sizeof(raw)];
+  static int8_t out[TINYFORMER_S][TINYFORMER_D];
+  FILE *in = fopen(in_path, "rb");
+  FILE *out_f = fopen(out_path, "wb");
+  if (!in || !out_f) {
+    fprintf(stderr, "features: cannot open %s\n", !in ? in_path : out_path);
+    return 2;
+  }
+  size_t n = 0;
+  while (fread(bytes, sizeof(bytes), 1, in) == 1) {
+    for (int t = 0; t < IMU_FEAT_WINDOW; ++t) {
+      for (int c = 0; c < IMU_FEAT_CHANNELS; ++c) {
+        const uint8_t *b = &bytes[2 * (t * IMU_FEAT_CHANNELS + c)];
+        raw[t][c] = (int16_t)(uint16_t)(b[0] | (b[1] << 8)); /* little-endian */
+      }
+    }
+    imu_feat_window(raw, out);
+    fwrite(out, sizeof(out), 1, out_f);
+    ++n;
+  }
+  fclose(in);
+  fclose(out_f);
+  printf("FEATURES windows=%zu\n", n);
+  return 0;
+}
+
+// Sink for encoder outputs so the calls are not optimized away.
+static volatile uint32_t bench_sink;
+
+#define BENCH_ENCODE   0
+#define BENCH_CLASSIFY 1
+#define BENCH_SLIDE    2
+#define BENCH_COUNT    3
+
+static void bench_call(int which, int i) {
+  static int8_t out[TINYFORMER_S][TINYFORMER_D];
+  int32_t logits[DEMO_NUM_CLASSES];
+  uint32_t cksum = 0;
+
+  switch (which) {
+  case BENCH_ENCODE:
+    tinyformer_encode(demo_inputs[i], out);
+    cksum = (uint8_t)out[0][0];
+    break;
+  case BENCH_CLASSIFY:
+    bench_sink += (uint32_t)tinyformer_classify(&head, demo_inputs[i], logits, &cksum);
+    break;
+  default:
+    // Same window every call, so after the first the K/V of S - S/2 rows are
+    // reused (cost of a 50% hop; the output itself is not meaningful).
+    tinyformer_encode_slide(demo_inputs[0], TINYFORMER_S / 2, out);
+    cksum = (uint8_t)out[0][0];
+    break;
+  }
+  bench_sink += cksum;
+}
+
+static void bench(long iters) {
+  static const char *const name[BENCH_COUNT] = {"encode", "classify", "slide"};
+  static const char *const stage_name[TINYFORMER_PROF_COUNT] = {
+      "qkv", "attn", "oproj", "ffn", "head"};
+
+  printf("BENCH iters=%ld (ns and TSC cycles per call)\n", iters);
+  for (int which = 0; which < BENCH_COUNT; ++which) {
+    double cycles = 0.0, stage[TINYFORMER_PROF_COUNT] = {0};
+    tinyformer_profile_t p;
+    int profiled = 0;
+
+    bench_call(which, 0); /* warm-up; also primes the slide cache */
+    tinyformer_profile_reset();
+    double t0 = now_ns();
+    for (long n = 0; n < iters;) {
+      /* Chunks keep the 32-bit counters from wrapping. */
+      long end = (iters - n > 256) ? n + 256 : iters;
+      uint32_t c0 = cycle_counter_read();
+      for (; n < end; ++n) {
+        bench_call(which, (int)(n % DEMO_NUM_SAMPLES));
+      }
+      cycles += (double)(uint32_t)(cycle_counter_read() - c0);
+      tinyformer_profile_read(&p);
+      tinyformer_profile_reset();
+      profiled |= (p.samples != 0);
+      for (int st = 0; st < TINYFORMER_PROF_COUNT; ++st) {
+        stage[st] += (double)p.cycles[st];
+      }
+    }
+    double t1 = now_ns();
+    printf("BENCH %-8s ns=%.0f cycles=%.0f\n", name[which], (t1 - t0) / (double)iters,
+           cycles / (double)iters);
+    for (int st = 0; profiled && st < TINYFORMER_PROF_COUNT; ++st) {
+      printf("BENCH %-8s %-5s cycles=%.0f\n", name[which], stage_name[st],
+             stage[st] / (double)iters);
+    }
+  }
+}
+
+#if TINYFORMER_AOT_CHECK
+// tools/compile_model.py output (host/tinyformer_aot.c) against the generic
+// encoder: the demo samples and AOT_RANDOM full-range windows (saturating
+// paths), bit for bit; then ns per window of each.
+#define AOT_RANDOM 64
+
+static int aot_check(long iters) {
+  static int8_t win[TINYFORMER_S][TINYFORMER_D];
+  static int8_t want[TINYFORMER_S][TINYFORMER_D], got[TINYFORMER_S][TINYFORMER_D];
+  uint32_t seed = 0x2545F491u;
+  int fails = 0;
+
+  for (int n = 0; n < DEMO_NUM_SAMPLES + AOT_RANDOM; ++n) {
+    if (n < DEMO_NUM_SAMPLES) {
+      memcpy(win, demo_inputs[n], sizeof(win));
+    } else {
+      for (int s = 0; s < TINYFORMER_S; ++s) {
+        for (int d = 0; d < TINYFORMER_D; ++d) {
+          seed = seed * 1664525u + 1013904223u;
+          win[s][d] = (int8_t)(seed >> 24);
+        }
+      }
+    }
+    tinyformer_encode(win, want);
+    tinyformer_aot_encode(win, got);
+    if (memcmp(want, got, sizeof(want)) != 0) {
+      printf("AOT window %d MISMATCH\n", n);
+      fails++;
+    }
+  }
+  if (fails == 0) {
+    printf("AOT OK windows=%d\n", DEMO_NUM_SAMPLES + AOT_RANDOM);
+  }
+  for (int which = 0; which < 2; ++which) {
+    double t0 = now_ns();
+    for (long n = 0; n < iters; ++n) {
+      if (which == 0) {
+        tinyformer_encode(demo_inputs[n % DEMO_NUM_SAMPLES], got);
+      } else {
+        tinyformer_aot_encode(demo_inputs[n % DEMO_NUM_SAMPLES], got);
+      }
+      bench_sink += (uint8_t)got[0][0];
+    }
+    printf("BENCH %-8s ns=%.0f\n", which == 0 ? "encode" : "aot", (now_ns() - t0) / (double)iters);
+  }
+  return fails;
+}
+#endif
+
+#if TINYFORMER_SHADOW
+// tf_shadow.h on this build (make shadow-check: the inexact options of
+// SHADOW_DEFS) with the generated scalar encoder (host/tinyformer_ref.c) as
+// the reference: the demo samples and SHADOW_RANDOM full-range windows.
+#define SHADOW_RANDOM 64
+#define SHADOW_WINDOWS (DEMO_NUM_SAMPLES + SHADOW_RANDOM)
+
+static int8_t shadow_win[SHADOW_WINDOWS][TINYFORMER_S][TINYFORMER_D] __attribute__((aligned(4)));
+
+// A broken reference: all-zero output, so every checksum differs.
+static void shadow_zero_ref(const int8_t in[TINYFORMER_S][TINYFORMER_D],
+                            int8_t out[TINYFORMER_S][TINYFORMER_D]) {
+  (void)in;
+  memset(out, 0, TINYFORMER_S * TINYFORMER_D);
+}
+
+static uint32_t shadow_cksum(const int8_t out[TINYFORMER_S][TINYFORMER_D]) {
+  uint32_t ck = 0;
+  for (int s = 0; s < TINYFORMER_S; ++s) {
+    for (int d = 0; d < TINYFORMER_D; ++d) {
+      ck += (uint8_t)out[s][d];
+    }
+  }
+  return ck;
+}
+
+static void shadow_print(const char *what, const tf_shadow_stats_t *st) {
+  printf("SHADOW %-6s windows=%u sampled=%u skipped=%u compared=%u label_mm=%u cksum_mm=%u "
+         "max_diff=%u fallback_at=%d\n",
+         what, st->windows, st->sampled, st->skipped, st->compared, st->label_mismatch,
+         st->cksum_mismatch, st->logit_max_diff, st->fallback_at);
+}
+
+static int shadow_check(void) {
+  static tf_shadow_t sh;
+  static int8_t want[TINYFORMER_S][TINYFORMER_D], got[TINYFORMER_S][TINYFORMER_D];
+  int32_t logits[DEMO_NUM_CLASSES], want_logits[DEMO_NUM_CLASSES];
+  uint32_t seed = 0x2545F491u, ck, want_ck;
+  int fails = 0;
+
+  for (int n = 0; n < SHADOW_WINDOWS; ++n) {
+    if (n < DEMO_NUM_SAMPLES) {
+      memcpy(shadow_win[n], demo_inputs[n], sizeof(shadow_win[n]));
+      continue;
+    }
+    for (int s = 0; s < TINYFORMER_S; ++s) {
+      for (int d = 0; d < TINYFORMER_D; ++d) {
+        seed = seed * 1664525u + 1013904223u;
+        shadow_win[n][s][d] = (int8_t)(seed >> 24);
+      }
+    }
+  }
+
+  // The reference is the baseline encoder whatever this build's options.
+  for (int n = 0; n < DEMO_NUM_SAMPLES; ++n) {
+    tinyformer_ref_encode(shadow_win[n], got);
+    if (shadow_cksum(got) != golden_cksum[n]) {
+      printf("SHADOW ref sample %d cksum=%u MISMATCH golden=%u\n", n, shadow_cksum(got),
+             golden_cksum[n]);
+      fails++;
+    }
+  }
+
+  // Every window compared, thresholds off: the fast path's results pass
+  // through unchanged.
+  const tf_shadow_cfg_t all = {1, 1000, 1000, 1};
+  tf_shadow_init(&sh, &all, tinyformer_ref_encode, &head);
+  for (int n = 0; n < SHADOW_WINDOWS; ++n) {
+    int label = tf_shadow_classify(&sh, shadow_win[n], logits, &ck);
+    int want_label = tinyformer_classify(&head, shadow_win[n], want_logits, &want_ck);
+    if (label != want_label || ck != want_ck || memcmp(logits, want_logits, sizeof(logits)) != 0) {
+      printf("SHADOW window %d MISMATCH with tinyformer_classify()\n", n);
+      fails++;
+    }
+    if (tf_shadow_idle(&sh) != 1 || tf_shadow_idle(&sh) != 0) {
+      printf("SHADOW window %d idle FAIL\n", n);
+      fails++;
+    }
+  }
+  if (sh.st.compared != SHADOW_WINDOWS || sh.st.skipped != 0 || tf_shadow_exact(&sh)) {
+    printf("SHADOW all FAIL\n");
+    fails++;
+  }
+  shadow_print("all", &sh.st);
+
+  // 1 in 4 without idle time: the first window waits, the later due ones
+  // are skipped.
+  const tf_shadow_cfg_t quarter = {4, 1000, 1000, 1};
+  tf_shadow_init(&sh, &quarter, tinyformer_ref_encode, &head);
+  for (int n = 0; n < 16; ++n) {
+    (void)tf_shadow_classify(&sh, shadow_win[n], logits, 0);
+  }
+  if (sh.st.sampled != 1 || sh.st.skipped != 3 || tf_shadow_idle(&sh) != 1 ||
+      sh.st.compared != 1) {
+    printf("SHADOW sampling FAIL\n");
+    fails++;
+  }
+  shadow_print("every4", &sh.st);
+
+  // Views, one of them wrapped: the output is tinyformer_encode_view()'s.
+  tf_shadow_init(&sh, &all, tinyformer_ref_encode, &head);
+  for (int n = 0; n < 8; ++n) {
+    const int32_t rows = SHADOW_WINDOWS * TINYFORMER_S;
+    const tinyformer_input_t view = {&shadow_win[0][0][0], TINYFORMER_D, rows,
+                                     n == 7 ? rows - 3 : n * TINYFORMER_S};
+    if (tf_shadow_encode_view(&sh, &view, TINYFORMER_S, got) != 0 ||
+        tinyformer_encode_view(&view, TINYFORMER_S, want) != 0 ||
+        memcmp(got, want, sizeof(want)) != 0 || tf_shadow_idle(&sh) != 1) {
+      printf("SHADOW view %d FAIL\n", n);
+      fails++;
+    }
+  }
+  const tinyformer_input_t bad = {&shadow_win[0][0][0], TINYFORMER_D, TINYFORMER_S - 1, 0};
+  if (tf_shadow_encode_view(&sh, &bad, TINYFORMER_S, got) != -1 || sh.st.compared != 8) {
+    printf("SHADOW view FAIL\n");
+    fails++;
+  }
+
+  // Checksum threshold 0: the guard falls back at the first window whose
+  // fast checksum differs (never in an exact build); the second pass then
+  // gives the baseline's ENC_CKSUM.
+  const tf_shadow_cfg_t cksum0 = {1, 1000, 0, 1};
+  tf_shadow_init(&sh, &cksum0, tinyformer_ref_encode, &head);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int n = 0; n < DEMO_NUM_SAMPLES; ++n) {
+      (void)tf_shadow_classify(&sh, shadow_win[n], logits, &ck);
+      (void)tf_shadow_idle(&sh);
+      if (pass == 1 && ck != golden_cksum[n]) {
+        printf("SHADOW fallback sample %d cksum=%u MISMATCH golden=%u\n", n, ck, golden_cksum[n]);
+        fails++;
+      }
+    }
+  }
+  if (tf_shadow_exact(&sh) != (sh.st.fallback_at >= 0) ||
+      (sh.st.cksum_mismatch != 0) != tf_shadow_exact(&sh)) {
+    printf("SHADOW cksum fallback FAIL\n");
+    fails++;
+  }
+  shadow_print("cksum0", &sh.st);
+
+  // A broken reference: below min_compared nothing happens, then label
+  // threshold 0 falls back at the first label it gets wrong, and from then
+  // on its (zero) output is what the guard returns.
+  const tf_shadow_cfg_t late = {1, 0, 0, SHADOW_WINDOWS + 1};
+  tf_shadow_init(&sh, &late, shadow_zero_ref, &head);
+  for (int n = 0; n < SHADOW_WINDOWS; ++n) {
+    (void)tf_shadow_classify(&sh, shadow_win[n], logits, 0);
+    (void)tf_shadow_idle(&sh);
+  }
+  if (tf_shadow_exact(&sh) || sh.st.cksum_mismatch != SHADOW_WINDOWS) {
+    printf("SHADOW min_compared FAIL\n");
+    fails++;
+  }
+  const tf_shadow_cfg_t label0 = {1, 0, 1000, 1};
+  tf_shadow_init(&sh, &label0, shadow_zero_ref, &head);
+  for (int n = 0; n < SHADOW_WINDOWS && !tf_shadow_exact(&sh); ++n) {
+    (void)tf_shadow_classify(&sh, shadow_win[n], logits, 0);
+    (void)tf_shadow_idle(&sh);
+  }
+  (void)tf_shadow_classify(&sh, shadow_win[0], logits, &ck);
+  if (!tf_shadow_exact(&sh) || sh.st.label_mismatch != 1 ||
+      sh.st.fallback_at != (int32_t)sh.st.compared || ck != 0 || tf_shadow_idle(&sh) != 0) {
+    printf("SHADOW label fallback FAIL\n");
+    fails++;
+  }
+  shadow_print("label0", &sh.st);
+
+  const tf_shadow_cfg_t never = {0, 0, 0, 0};
+  if (tf_shadow_init(&sh, &never, tinyformer_ref_encode, &head) != -1) {
+    printf("SHADOW init FAIL\n");
+    fails++;
+  }
+  if (fails == 0) {
+    printf("SHADOW OK windows=%d\n", SHADOW_WINDOWS);
+  }
+  return fails;
+}
+#endif
+
+#if TINYFORMER_SMP
+// The secondary harts of an SMP SoC as threads, in tf_smp_worker() as
+// crt0.S leaves them.
+#define SMP_RANDOM 64
+
+static pthread_t smp_thread[TF_SMP_HARTS];
+
+static void *smp_hart(void *arg) {
+  tf_smp_worker((int)(intptr_t)arg);
+  return 0;
+}
+
+static void smp_start(void) {
+  for (int h = 1; h < TF_SMP_HARTS; ++h) {
+    if (pthread_create(&smp_thread[h], 0, smp_hart, (void *)(intptr_t)h) != 0) {
+      fprintf(stderr, "smp: no thread for hart %d\n", h);
+      exit(2);
+    }
+  }
+}
+
+static void smp_join(void) {
+  tf_smp_stop();
+  for (int h = 1; h < TF_SMP_HARTS; ++h) {
+    pthread_join(smp_thread[h], 0);
+  }
+}
+
+// tinyformer_encode_smp() against tinyformer_encode() on the demo samples and
+// SMP_RANDOM full-range windows, bit for bit, then a slide call after it
+// (its K/V cache must have been dropped); then ns per window of each.
+static int smp_check(long iters) {
+  static int8_t win[TINYFORMER_S][TINYFORMER_D];
+  static int8_t want[TINYFORMER_S][TINYFORMER_D], got[TINYFORMER_S][TINYFORMER_D];
+  uint32_t seed = 0x9E3779B9u;
+  int fails = 0;
+
+  for (int n = 0; n < DEMO_NUM_SAMPLES + SMP_RANDOM; ++n) {
+    if (n < DEMO_NUM_SAMPLES) {
+      memcpy(win, demo_inputs[n], sizeof(win));
+    } else {
+      for (int s = 0; s < TINYFORMER_S; ++s) {
+        for (int d = 0; d < TINYFORMER_D; ++d) {
+          seed = seed * 1664525u + 1013904223u;
+          win[s][d] = (int8_t)(seed >> 24);
+        }
+      }
+    }
+    tinyformer_encode(win, want);
+    memset(got, 0x5A, sizeof(got));
+    tinyformer_encode_smp(win, got);
+    if (memcmp(want, got, sizeof(want)) != 0) {
+      printf("SMP window %d MISMATCH\n", n);
+      fails++;
+    }
+  }
+  tinyformer_encode_slide(demo_inputs[0], 1, got);
+  tinyformer_encode(demo_inputs[0], want);
+  if (memcmp(want, got, sizeof(want)) != 0) {
+    printf("SMP slide after split MISMATCH\n");
+    fails++;
+  }
+  // Front on this thread, back on hart 1's scratch as in the pipeline.
+  {
+    static const tinyformer_head_t head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+    static tinyformer_stage_t st;
+    int32_t want_logits[DEMO_NUM_CLASSES], got_logits[DEMO_NUM_CLASSES];
+    uint32_t want_cksum, got_cksum;
+    for (int n = 0; n < DEMO_NUM_SAMPLES; ++n) {
+      const tinyformer_input_t in = {&demo_inputs[n][0][0], TINYFORMER_D, TINYFORMER_S, 0};
+      int want_label = tinyformer_classify_view(&head, &in, want_logits, &want_cksum);
+      if (tinyformer_encode_front(&in, TINYFORMER_S, &st) != 0 ||
+          tinyformer_classify_back(1, &head, &st, got_logits, &got_cksum) != want_label ||
+          got_cksum != want_cksum || memcmp(want_logits, got_logits, sizeof(want_logits)) != 0) {
+        printf("SMP front/back sample %d MISMATCH\n", n);
+        fails++;
+      }
+    }
+  }
+  if (fails == 0) {
+    printf("SMP OK harts=%d windows=%d\n", TF_SMP_HARTS, DEMO_NUM_SAMPLES + SMP_RANDOM);
+  }
+  for (int which = 0; which < 2; ++which) {
+    double t0 = now_ns();
+    for (long n = 0; n < iters; ++n) {
+      if (which == 0) {
+        tinyformer_encode(demo_inputs[n % DEMO_NUM_SAMPLES], got);
+      } else {
+        tinyformer_encode_smp(demo_inputs[n % DEMO_NUM_SAMPLES], got);
+      }
+      bench_sink += (uint8_t)got[0][0];
+    }
+    printf("BENCH %-8s ns=%.0f\n", which == 0 ? "encode" : "smp", (now_ns() - t0) / (double)iters);
+  }
+  return fails;
+}
+#endif
+
+#if TINYFORMER_SMP
+// The sensor of a stream run: the demo samples' rows, cyclically, pushed
+// only while the ring has room (no drops) until stream_stop is set.
+static volatile int stream_stop;
+
+static void *stream_feed(void *arg) {
+  (void)arg;
+  for (uint32_t r = 0; !stream_stop;) {
+    if (demo_stream_room() == 0) {
+      TF_SMP_RELAX();
+      continue;
+    }
+    uint32_t n = r / TINYFORMER_S % DEMO_NUM_SAMPLES;
+    (void)demo_stream_push(demo_inputs[n][r % TINYFORMER_S]);
+    ++r;
+  }
+  return 0;
+}
+
+// demo_stream_run() (pipe 0) or demo_stream_pipe_run() over windows windows.
+static void stream_run(int pipe, uint32_t windows) {
+  pthread_t feeder;
+  if (pthread_create(&feeder, 0, stream_feed, 0) != 0) {
+    fprintf(stderr, "stream: no feeder thread\n");
+    exit(2);
+  }
+  if (pipe) {
+    demo_stream_pipe_run(windows);
+  } else {
+    demo_stream_run(windows);
+  }
+  stream_stop = 1;
+  pthread_join(feeder, 0);
+}
+#endif
+
+#if TINYFORMER_POWER_MODES
+// power_modes.h on this build (make pmode-check, with TINYFORMER_AUTOTUNE):
+// a walk through three modes. Each must keep golden ENC_CKSUM with exits off,
+// and with margin 0 every window leaves at the input exit.
+#define PMODE_ALL_HW (TINYFORMER_HW_DOT8 | TINYFORMER_HW_GEMV | TINYFORMER_HW_EXP_LUT)
+
+static const tf_pmode_t pmode_table[] = {
+    {"perf", PMODE_ALL_HW, INT32_MAX, 1000},
+    {"balanced", PMODE_ALL_HW, 0, 2000},
+    {"saver", 0, 0, 4000},
+};
+
+// The demo samples in the current mode; returns the failures.
+static int pmode_windows(tf_pmode_ctl_t *pm) {
+  const tinyformer_exit_t ex = {{&exit_in_W[0][0], exit_in_b, DEMO_NUM_CLASSES},
+                                tf_pmode_current(pm)->exit_margin};
+  int32_t logits[DEMO_NUM_CLASSES];
+  uint32_t ck;
+  int stage, fails = 0;
+
+  for (int n = 0; n < DEMO_NUM_SAMPLES; ++n) {
+    uint32_t t0 = cycle_counter_read();
+    if (ex.margin == INT32_MAX) {
+      (void)tinyformer_classify(&head, demo_inputs[n], logits, &ck);
+      stage = TINYFORMER_EXIT_NONE;
+    } else {
+      ck = golden_cksum[n];  // not written on an exit
+      (void)tinyformer_classify_early(&head, &ex, &ex, demo_inputs[n], logits, &ck, &stage);
+    }
+    tf_pmode_account(pm, cycle_counter_read() - t0);
+    if (ck != golden_cksum[n] || stage != (ex.margin == INT32_MAX ? TINYFORMER_EXIT_NONE
+                                                                  : TINYFORMER_EXIT_INPUT)) {
+      printf("PMODE %s sample %d cksum=%u stage=%d FAIL\n", tf_pmode_current(pm)->name, n, ck,
+             stage);
+      fails++;
+    }
+  }
+  return fails;
+}
+
+static int pmode_check(void) {
+  static tf_pmode_ctl_t pm;
+  static const int walk[] = {2, 1, 0};
+  tf_pmode_switch_t sw;
+  int fails = 0;
+
+  if (tf_pmode_init(&pm, pmode_table, 3, 3, 0) != -1 || tf_pmode_init(&pm, pmode_table, 3, 0, 0) != 0 ||
+      tf_pmode_find(&pm, "saver", -1) != 2 || tf_pmode_find(&pm, "saverX", 5) != 2 ||
+      tf_pmode_find(&pm, "sav", 3) != -1 || tf_pmode_find(&pm, "perfx", -1) != -1 ||
+      tf_pmode_request(&pm, 3) != -1 || tf_pmode_request(&pm, -1) != -1) {
+    printf("PMODE api FAIL\n");
+    fails++;
+  }
+  fails += pmode_windows(&pm);
+  for (int i = 0; i < 3; ++i) {
+    const int from = pm.cur;
+    // Until the poll the mode stays; the latest request wins.
+    if (tf_pmode_request(&pm, (walk[i] + 1) % 3) != 0 || tf_pmode_request(&pm, walk[i]) != 0 ||
+        pm.cur != from || tf_pmode_poll(&pm, &sw) != 1 || sw.from != from || sw.to != walk[i] ||
+        sw.windows != DEMO_NUM_SAMPLES || sw.cycles_avg == 0 || pm.windows != 0 ||
+        tf_pmode_poll(&pm, &sw) != 0) {
+      printf("PMODE switch %d FAIL\n", i);
+      fails++;
+    }
+    printf("PMODE from=%s to=%s windows=%u cycles_per_window=%u\n", pmode_table[sw.from].name,
+           pmode_table[sw.to].name, sw.windows, sw.cycles_avg);
+    fails += pmode_windows(&pm);
+  }
+  if (tf_pmode_request(&pm, pm.cur) != 0 || tf_pmode_poll(&pm, &sw) != 0 || pm.switches != 3) {
+    printf("PMODE same mode FAIL\n");
+    fails++;
+  }
+  if (fails == 0) {
+    printf("PMODE OK modes=3 switches=%u\n", pm.switches);
+  }
+  return fails;
+}
+#endif
+
+#if TINYFORMER_STACK_PAINT
+// `demo` on a thread whose stack is a painted buffer (tf_stack.h), so the
+// STACK line of demo_run() is the host high-water mark (make stack-check).
+// glibc keeps the thread descriptor and TLS at the top of that stack; they
+// count as used.
+#define HOST_STACK_BYTES (256 * 1024)
+static uint32_t host_stack[HOST_STACK_BYTES / 4] __attribute__((aligned(64)));
+
+static void *stack_demo(void *arg) {
+  (void)arg;
+  demo_run();
+  return 0;
+}
+
+static int stack_demo_run(void) {
+  pthread_attr_t attr;
+  pthread_t t;
+
+  tf_stack_attach(host_stack, host_stack + HOST_STACK_BYTES / 4);
+  if (pthread_attr_init(&attr) != 0 ||
+      pthread_attr_setstack(&attr, host_stack, sizeof(host_stack)) != 0 ||
+      pthread_create(&t, &attr, stack_demo, 0) != 0) {
+    fprintf(stderr, "stack: cannot start the demo thread\n");
+    return 1;
+  }
+  pthread_join(t, 0);
+  pthread_attr_destroy(&attr);
+  return 0;
+}
+#endif
+
+int main(int argc, char **argv) {
+#if TINYFORMER_SMP
+  smp_start();
+  if (argc > 1 && strcmp(argv[1], "smp") == 0) {
+    int fails = smp_check((argc > 2 && atol(argv[2]) > 0) ? atol(argv[2]) : 2000);
+    smp_join();
+    return fails ? 1 : 0;
+  }
+  if (argc == 3 && (strcmp(argv[1], "stream") == 0 || strcmp(argv[1], "stream-pipe") == 0)) {
+    stream_run(strcmp(argv[1], "stream-pipe") == 0, (uint32_t)strtoul(argv[2], 0, 10));
+    smp_join();
+    return 0;
+  }
+#endif
+  if (argc > 1 && strcmp(argv[1], "demo") == 0) {
+    demo_print_banner("MODE: HOST\r\n");
+#if TINYFORMER_STACK_PAINT
+    return stack_demo_run();
+#else
+    demo_run();
+    return 0;
+#endif
+  }
+  if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+    setvbuf(stdout, 0, _IONBF, 0); /* every reply byte reaches the host */
+    demo_proto_run();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "features") == 0) {
+    if (argc != 4) {
+      fprintf(stderr, "usage: %s features <raw.bin> <out.bin>\n", argv[0]);
+      return 2;
+    }
+    return features_file(argv[2], argv[3]);
+  }
+#if !TINYFORMER_INT4_WEIGHTS
+  if (argc == 3 && strcmp(argv[1], "store-image") == 0) {
+    return store_image_file(argv[2]);
+  }
+  if (argc == 3 && strcmp(argv[1], "store-wz") == 0) {
+    return store_wz_file(argv[2]) ? 1 : 0;
+  }
+#endif
+  if (argc > 1 && strcmp(argv[1], "rand") == 0) {
+    return rand_check(1) ? 1 : 0;
+  }
+#if TINYFORMER_TIERS
+  if (argc > 1 && strcmp(argv[1], "tiers") == 0) {
+    return tiers_check() ? 1 : 0;
+  }
+#endif
+#if TINYFORMER_AOT_CHECK
+  if (argc > 1 && strcmp(argv[1], "aot") == 0) {
+    return aot_check((argc > 2 && atol(argv[2]) > 0) ? atol(argv[2]) : 2000) ? 1 : 0;
+  }
+#endif
+#if TINYFORMER_SHADOW
+  if (argc > 1 && strcmp(argv[1], "shadow") == 0) {
+    return shadow_check() ? 1 : 0;
+  }
+#endif
+#if TINYFORMER_POWER_MODES
+  if (argc > 1 && strcmp(argv[1], "pmode") == 0) {
+    return pmode_check() ? 1 : 0;
+  }
+#endif
+  long iters = (argc > 1) ? strtol(argv[1], 0, 10) : 2000;
+  if (iters < 1) {
+    iters = 1;
+  }
+  int fails = golden_check();
+  fails += rand_check(0);
+#if TINYFORMER_AUTOTUNE
+  fails += tune_check();
+#endif
+#if TINYFORMER_LATENCY
+  fails += lat_check();
+#endif
+  fails += ctx_check();
+#if !TINYFORMER_INT4_WEIGHTS
+  fails += store_check();
+#endif
+  fails += blob_check();
+  fails += rt_check();
+  fails += frame_check();
+  fails += feat_check();
+  bench(iters);
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+// Multi-threaded batch replay of recorded windows on the host build
+// (make replay): every window is classified with the bit-exact encoder and
+// its prediction and ENC_CKSUM are written as CSV.
+//
+//   tinyformer_replay [-t threads] [-o out.csv] [-c] windows.bin
+//   tinyformer_replay -g windows.bin [copies]
+//
+// windows.bin is raw int8 [n][TINYFORMER_S][TINYFORMER_D] (no header), e.g. a
+// capture of the encoder inputs; -g writes `copies` passes over demo_inputs[].
+// The file is memory-mapped and each thread runs tinyformer_classify_ctx() on
+// its own workspace. Windows are sharded into one contiguous range per thread;
+// a thread takes CHUNK windows at a time from the front of its range and, once
+// it is empty, steals the back half of the fullest other range.
+// Output rows are in window order: window,pred,enc_cksum. -c re-runs every
+// window through the static tinyformer_classify() and compares.
+//
+// Exit status: 0, 1 on a -c mismatch, 2 on a usage or I/O error.
+
+#define _GNU_SOURCE
+#include "demo_classifier.h"
+#include "demo_samples.h"
+#include "tinyformer.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WINDOW_BYTES (TINYFORMER_S * TINYFORMER_D)
+#define CHUNK 16
+#define MAX_THREADS 256
+
+typedef int8_t window_t[TINYFORMER_S][TINYFORMER_D];
+
+static const tinyformer_head_t head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+
+// Remaining windows [lo, hi) of one worker, packed as hi << 32 | lo so the
+// owner (front) and thieves (back) update it with one CAS.
+// One cache line per worker, so owners do not contend on each other's range.
+typedef struct {
+  _Alignas(64) _Atomic uint64_t range;
+  uint32_t steals; // successful steals by this worker
+  pthread_t tid;
+} worker_t;
+
+static worker_t workers[MAX_THREADS];
+static int n_workers;
+static const window_t *windows;
+static uint8_t *preds;
+static uint32_t *cksums;
+
+static uint64_t pack(uint32_t lo, uint32_t hi) { return ((uint64_t)hi << 32) | lo; }
+static uint32_t range_lo(uint64_t r) { return (uint32_t)r; }
+static uint32_t range_hi(uint64_t r) { return (uint32_t)(r >> 32); }
+
+// Take up to CHUNK windows from the front of w's range.
+static int take_front(worker_t *w, uint32_t *lo, uint32_t *hi) {
+  uint64_t r = atomic_load(&w->range);
+  for (;;) {
+    uint32_t a = range_lo(r), b = range_hi(r);
+    if (a >= b) {
+      return 0;
+    }
+    uint32_t e = (b - a > CHUNK) ? a + CHUNK : b;
+    if (atomic_compare_exchange_weak(&w->range, &r, pack(e, b))) {
+      *lo = a;
+      *hi = e;
+      return 1;
+    }
+  }
+}
+
+// Move the back half of the fullest other range into self's (empty) range.
+static int steal(int self) {
+  for (;;) {
+    int victim = -1;
+    uint32_t best = 0;
+    for (int i = 0; i < n_workers; ++i) {
+      uint64_t r = atomic_load(&workers[i].range);
+      uint32_t left = range_hi(r) - range_lo(r);
+      if (i != self && range_lo(r) < range_hi(r) && left > best) {
+        best = left;
+        victim = i;
+      }
+    }
+    if (victim < 0) {
+      return 0;
+    }
+    uint64_t r = atomic_load(&workers[victim].range);
+    uint32_t a = range_lo(r), b = range_hi(r);
+    if (a >= b) {
+      continue;
+    }
+    uint32_t mid = a + (b - a) / 2; // b - a == 1: the thief takes the last window
+    if (atomic_compare_exchange_strong(&workers[victim].range, &r, pack(a, mid))) {
+      // Only the owner refills its own range, and only once it is empty.
+      atomic_store(&workers[self].range, pack(mid, b));
+      workers[self].steals++;
+      return 1;
+    }
+  }
+}
+
+static void *worker_main(void *arg) {
+  int self = (int)(intptr_t)arg;
+  worker_t *w = &workers[self];
+  uint32_t bytes = tinyformer_workspace_size();
+  size_t alloc = ((size_t)bytes + 63u) & ~(size_t)63u;
+  void *mem = aligned_alloc(64, alloc);
+  tinyformer_ctx_t ctx;
+
+  if (mem == 0 || tinyformer_ctx_init(&ctx, mem, bytes) != 0) {
+    fprintf(stderr, "replay: no workspace for thread %d\n", self);
+    exit(2);
+  }
+  for (;;) {
+    uint32_t lo, hi;
+    if (!take_front(w, &lo, &hi)) {
+      if (!steal(self)) {
+        break;
+      }
+      continue;
+    }
+    for (uint32_t i = lo; i < hi; ++i) {
+      int32_t logits[DEMO_NUM_CLASSES];
+      preds[i] = (uint8_t)tinyformer_classify_ctx(&ctx, &head, windows[i], logits, &cksums[i]);
+    }
+  }
+  free(mem);
+  return 0;
+}
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int generate(const char *path, long copies) {
+  FILE *f = fopen(path, "wb");
+  if (f == 0) {
+    perror(path);
+    return 2;
+  }
+  for (long c = 0; c < copies; ++c) {
+    if (fwrite(demo_inputs, WINDOW_BYTES, DEMO_NUM_SAMPLES, f) != DEMO_NUM_SAMPLES) {
+      perror(path);
+      fclose(f);
+      return 2;
+    }
+  }
+  fclose(f);
+  printf("REPLAY wrote %ld windows to %s\n", copies * DEMO_NUM_SAMPLES, path);
+  return 0;
+}
+
+static int usage(void) {
+  fprintf(stderr, "usage: tinyformer_replay [-t threads] [-o out.csv] [-c] windows.bin\n"
+                  "       tinyformer_replay -g windows.bin [copies]\n");
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  const char *in_path = 0, *out_path = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int check = 0;
+
+  if (argc >= 3 && strcmp(argv[1], "-g") == 0) {
+    return generate(argv[2], (argc > 3) ? strtol(argv[3], 0, 10) : 1);
+  }
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      threads = strtol(argv[++i], 0, 10);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (strcmp(argv[i], "-c") == 0) {
+      check = 1;
+    } else if (argv[i][0] != '-' && in_path == 0) {
+      in_path = argv[i];
+    } else {
+      return usage();
+    }
+  }
+  if (in_path == 0) {
+    return usage();
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+  if (threads > MAX_THREADS) {
+    threads = MAX_THREADS;
+  }
+
+  int fd = open(in_path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror(in_path);
+    return 2;
+  }
+  if (st.st_size == 0 || st.st_size % WINDOW_BYTES != 0 ||
+      st.st_size / WINDOW_BYTES > (off_t)UINT32_MAX) {
+    fprintf(stderr, "replay: %s: size %lld is not a multiple of %d-byte windows\n", in_path,
+            (long long)st.st_size, WINDOW_BYTES);
+    return 2;
+  }
+  uint32_t n = (uint32_t)(st.st_size / WINDOW_BYTES);
+  void *map = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    return 2;
+  }
+  close(fd);
+  windows = (const window_t *)map;
+  preds = malloc(n);
+  cksums = malloc((size_t)n * sizeof(cksums[0]));
+  if (preds == 0 || cksums == 0) {
+    fprintf(stderr, "replay: out of memory\n");
+    return 2;
+  }
+
+  n_workers = (int)threads;
+  for (int i = 0; i < n_workers; ++i) {
+    uint32_t lo = (uint32_t)((uint64_t)n * (uint64_t)i / (uint64_t)n_workers);
+    uint32_t hi = (uint32_t)((uint64_t)n * (uint64_t)(i + 1) / (uint64_t)n_workers);
+    atomic_init(&workers[i].range, pack(lo, hi));
+  }
+  double t0 = now_s();
+  for (int i = 0; i < n_workers; ++i) {
+    if (pthread_create(&workers[i].tid, 0, worker_main, (void *)(intptr_t)i) != 0) {
+      fprintf(stderr, "replay: pthread_create failed\n");
+      return 2;
+    }
+  }
+  uint32_t steals = 0;
+  for (int i = 0; i < n_workers; ++i) {
+    pthread_join(workers[i].tid, 0);
+    steals += workers[i].steals;
+  }
+  double dt = now_s() - t0;
+
+  FILE *out = (out_path != 0) ? fopen(out_path, "w") : stdout;
+  if (out == 0) {
+    perror(out_path);
+    return 2;
+  }
+  fprintf(out, "window,pred,enc_cksum\n");
+  for (uint32_t i = 0; i < n; ++i) {
+    fprintf(out, "%u,%u,0x%08X\n", (unsigned)i, (unsigned)preds[i], (unsigned)cksums[i]);
+  }
+  if (out != stdout) {
+    fclose(out);
+  }
+  fprintf(stderr, "REPLAY windows=%u threads=%d steals=%u ms=%.1f windows_per_s=%.0f\n",
+          (unsigned)n, n_workers, (unsigned)steals, dt * 1e3, (double)n / dt);
+
+  int fails = 0;
+  if (check) {
+    for (uint32_t i = 0; i < n; ++i) {
+      int32_t logits[DEMO_NUM_CLASSES];
+      uint32_t cksum;
+      int pred = tinyformer_classify(&head, windows[i], logits, &cksum);
+      if (pred != preds[i] || cksum != cksums[i]) {
+        if (fails++ < 8) {
+          fprintf(stderr, "REPLAY CHECK FAIL window=%u pred=%u/%d ENC_CKSUM=0x%08X/0x%08X\n",
+                  (unsigned)i, (unsigned)preds[i], pred, (unsigned)cksums[i], (unsigned)cksum);
+        }
+      }
+    }
+    if (fails == 0) {
+      fprintf(stderr, "REPLAY CHECK OK\n");
+    }
+  }
+  munmap(map, (size_t)st.st_size);
+  free(preds);
+  free(cksums);
+  return fails ? 1 : 0;
+}
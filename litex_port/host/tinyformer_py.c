@@ -0,0 +1,108 @@
+// Shared-library entry points of the host build for Python (make pylib):
+// tools/tinyformer_c.py loads host/libtinyformer.so with cffi and passes
+// NumPy int8 batches to these functions without copying them.
+//
+// Every batch is [n][TINYFORMER_S][TINYFORMER_D] int8, C order. Each call
+// classifies on its own tinyformer_ctx_t workspace, so calls from several
+// Python threads (cffi releases the GIL) may run at once. The kernels are
+// the software paths of the host build (dot8.c / exp_lut.c fallbacks) and
+// the head is the demo's (demo_classifier.c): the labels and ENC_CKSUM are
+// the firmware's, bit for bit.
+//
+// Calls return 0, or -1 if no workspace could be allocated (nothing is
+// written then).
+
+#include "demo_classifier.h"
+#include "demo_samples.h"
+#include "tinyformer.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TFPY_API __attribute__((visibility("default")))
+
+// Version of this interface; tools/tinyformer_c.py refuses another one.
+#define TFPY_ABI 1
+
+typedef int8_t window_t[TINYFORMER_S][TINYFORMER_D];
+
+static const tinyformer_head_t cls_head = {&cls_W[0][0], cls_b, DEMO_NUM_CLASSES};
+
+static void *tfpy_ctx(tinyformer_ctx_t *ctx) {
+  uint32_t bytes = tinyformer_workspace_size();
+  void *mem = aligned_alloc(64, ((size_t)bytes + 63u) & ~(size_t)63u);
+
+  if (mem != 0 && tinyformer_ctx_init(ctx, mem, bytes) != 0) {
+    free(mem);
+    mem = 0;
+  }
+  return mem;
+}
+
+// Shape of this build; returns TFPY_ABI.
+TFPY_API int tfpy_shape(int32_t *s, int32_t *d, int32_t *n_classes) {
+  *s = TINYFORMER_S;
+  *d = TINYFORMER_D;
+  *n_classes = DEMO_NUM_CLASSES;
+  return TFPY_ABI;
+}
+
+// The built-in demo samples (demo_samples.c): *inputs [n][S][D] and *labels
+// [n]; returns n.
+TFPY_API int tfpy_demo_samples(const int8_t **inputs, const uint8_t **labels) {
+  *inputs = &demo_inputs[0][0][0];
+  *labels = demo_labels;
+  return DEMO_NUM_SAMPLES;
+}
+
+// tinyformer_encode() of n windows, in to out.
+TFPY_API int tfpy_encode(const int8_t *in, int8_t *out, uint32_t n) {
+  tinyformer_ctx_t ctx;
+  void *mem = tfpy_ctx(&ctx);
+
+  if (mem == 0) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    tinyformer_encode_ctx(&ctx, ((const window_t *)in)[i], ((window_t *)out)[i]);
+  }
+  free(mem);
+  return 0;
+}
+
+// tinyformer_classify() with the demo head over n windows: pred[n],
+// cksum[n] (ENC_CKSUM) and, unless null, logits [n][DEMO_NUM_CLASSES].
+// early: the exit heads of DEMO_EARLY_EXIT at the DEMO_EXIT_*_MARGIN of this
+// build (tinyformer_classify_early()); stage[n] (may be null) then receives
+// TINYFORMER_EXIT_*, and a window that exits has cksum 0.
+TFPY_API int tfpy_classify(const int8_t *in, uint32_t n, int early, int32_t *pred,
+                           uint32_t *cksum, int32_t *logits, int32_t *stage) {
+  static const tinyformer_exit_t exit_in = {
+      {&exit_in_W[0][0], exit_in_b, DEMO_NUM_CLASSES}, DEMO_EXIT_IN_MARGIN};
+  static const tinyformer_exit_t exit_attn = {
+      {&exit_attn_W[0][0], exit_attn_b, DEMO_NUM_CLASSES}, DEMO_EXIT_ATTN_MARGIN};
+  tinyformer_ctx_t ctx;
+  void *mem = tfpy_ctx(&ctx);
+
+  if (mem == 0) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    const window_t *x = &((const window_t *)in)[i];
+    int32_t scratch[DEMO_NUM_CLASSES];
+    int32_t *lg = logits ? &logits[i * DEMO_NUM_CLASSES] : scratch;
+    int st = TINYFORMER_EXIT_NONE;
+
+    cksum[i] = 0;
+    if (early) {
+      pred[i] = tinyformer_classify_early_ctx(&ctx, &cls_head, &exit_in, &exit_attn, *x, lg,
+                                              &cksum[i], &st);
+    } else {
+      pred[i] = tinyformer_classify_ctx(&ctx, &cls_head, *x, lg, &cksum[i]);
+    }
+    if (stage) {
+      stage[i] = st;
+    }
+  }
+  free(mem);
+  return 0;
+}
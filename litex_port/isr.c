@@ -1,10 +1,111 @@
 // Interrupt Service Routine (ISR)
 // Required by crt0.S
+//
+// Dispatches the pending, unmasked lines of the LiteX VexRiscv interrupt
+// controller to their drivers; each driver unmasks its own line (e.g.
+// gemv_irq_init(), demo_stream_sensor_init(), sensor_dma_irq_init(),
+// uart_tx_irq_init(), timer0 in demo_duty_run()). With no
+// interrupt-driven driver built in, it does nothing. With USE_DOT8_HW it
+// also steps over the illegal-instruction trap of dot8_probe() on cores
+// without the DOT8 plugin (TINYFORMER_AUTOTUNE). With TINYFORMER_TRACE the
+// dispatch is an IRQ_ENTER / IRQ_EXIT span in the trace ring.
+
+#if defined(USE_DOT8_HW)
+#include "dot8.h"
+#endif
+
+#if defined(USE_GEMV_HW)
+#include "gemv.h"
+#if GEMV_IRQ
+#include <generated/soc.h>
+#define ISR_GEMV 1
+#endif
+#endif
+
+#include "demo_runner.h"
+#if DEMO_STREAM_SENSOR_IRQ
+#ifndef DEMO_STREAM_SENSOR_INTERRUPT
+#error "Define DEMO_STREAM_SENSOR_INTERRUPT (sensor IRQ line) for DEMO_STREAM_SENSOR_IRQ"
+#endif
+#define ISR_STREAM_SENSOR 1
+#endif
+#if DEMO_STREAM_DMA
+#include "sensor_dma.h"
+#if SENSOR_DMA_IRQ
+#include <generated/soc.h>
+#define ISR_SENSOR_DMA 1
+#endif
+#endif
+#if DEMO_DUTY_CYCLE
+#include <generated/soc.h>
+#define ISR_DUTY_TIMER 1
+#endif
+
+#include "tf_trace.h"
+#include "uart_litex.h"
+#if UART_TX_IRQ
+#include <generated/soc.h>
+#define ISR_UART_TX 1
+#endif
 
 void isr(void);
 
+#if defined(ISR_GEMV) || defined(ISR_STREAM_SENSOR) || defined(ISR_UART_TX) || \
+    defined(ISR_DUTY_TIMER) || defined(ISR_SENSOR_DMA)
+#define ISR_LINES 1
+#endif
+
+#if defined(ISR_LINES)
+// VexRiscv IRQ controller CSRs (as in the CPU's irq.h): mask 0xBC0, pending 0xFC0.
+static inline unsigned int isr_active_lines(void)
+{
+    unsigned int mask, pending;
+    __asm__ volatile ("csrr %0, 0xBC0" : "=r"(mask));
+    __asm__ volatile ("csrr %0, 0xFC0" : "=r"(pending));
+    return mask & pending;
+}
+#endif
+
 void isr(void)
 {
-    // Default ISR: do nothing
-    // In a real application, this would handle UART interrupts, timer ticks, etc.
+#if defined(ISR_LINES)
+    unsigned int lines;
+#endif
+#if defined(USE_DOT8_HW)
+    if (dot8_trap()) {
+        return;
+    }
+#endif
+#if defined(ISR_LINES)
+    lines = isr_active_lines();
+    TF_TRACE(TF_EV_IRQ_ENTER, lines);
+#endif
+#if defined(ISR_GEMV)
+    if (lines & (1u << GEMV_INTERRUPT)) {
+        gemv_isr();
+    }
+#endif
+#if defined(ISR_STREAM_SENSOR)
+    if (lines & (1u << DEMO_STREAM_SENSOR_INTERRUPT)) {
+        demo_stream_sensor_isr();
+    }
+#endif
+#if defined(ISR_SENSOR_DMA)
+    if (lines & (1u << SENSOR_DMA_INTERRUPT)) {
+        sensor_dma_isr();
+    }
+#endif
+#if defined(ISR_UART_TX)
+    if (lines & (1u << UART_INTERRUPT)) {
+        uart_tx_isr();
+    }
+#endif
+#if defined(ISR_DUTY_TIMER)
+    if (lines & (1u << TIMER0_INTERRUPT)) {
+        demo_duty_timer_isr();
+    }
+#endif
+#if defined(ISR_LINES)
+    TF_TRACE(TF_EV_IRQ_EXIT, 0);
+#endif
 }
@@ -0,0 +1,280 @@
+/*
+ * Attention engine on-target self-test: the two-pass attention of tinyformer.c vs attn_run().
+ * Deterministic Q, K, V (LCG) over several shapes and head counts, both normalize modes,
+ * causal masking and saturating inputs. No printf/malloc; uses uart_write_char for output.
+ * After the checks, one TinyFormer block (S=16, D=32, one head) is timed end to end and
+ * against the software loop (cycle_counter.h); engine= is the block's own busy count.
+ *
+ * Link with: attn.c, and code providing uart_write_char (e.g. uart_litex.c).
+ * Define ATTN_USE_LITEX_CSR or ATTN_BASE as for the driver.
+ */
+
+#include <stdint.h>
+#include "tests_attn.h"
+#include "attn.h"
+#include "cycle_counter.h"
+
+extern void uart_write_char(char c);
+
+static void uart_write_string(const char *s)
+{
+    while (*s != '\0') {
+        uart_write_char(*s);
+        s++;
+    }
+}
+
+static void uart_print_dec(uint32_t v)
+{
+    char buf[10];
+    int n = 0;
+    do { buf[n++] = (char)('0' + v % 10u); v /= 10u; } while (v != 0u);
+    while (n > 0) uart_write_char(buf[--n]);
+}
+
+static void uart_print_int(int32_t v)
+{
+    if (v < 0) {
+        uart_write_char('-');
+        uart_print_dec((uint32_t)(-v));
+    } else {
+        uart_print_dec((uint32_t)v);
+    }
+}
+
+/* Deterministic LCG (no libc rand) */
+static uint32_t lcg = 1u;
+static uint32_t lcg_next(void)
+{
+    lcg = lcg * 1664525u + 1013904223u;
+    return lcg;
+}
+
+/* Same table as tinyformer.c exp_lut[16] */
+static const uint16_t golden_exp[16] = {
+    1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12
+};
+
+static int8_t q[ATTN_MAX_S * ATTN_MAX_D];
+static int8_t k[ATTN_MAX_S * ATTN_MAX_D];
+static int8_t v[ATTN_MAX_S * ATTN_MAX_D];
+static int8_t ref_ctx[ATTN_MAX_S * ATTN_MAX_D];
+static int8_t hw_ctx[ATTN_MAX_S * ATTN_MAX_D];
+
+static int8_t sat8(int32_t x)
+{
+    if (x > 127) return 127;
+    if (x < -128) return -128;
+    return (int8_t)x;
+}
+
+/* Reference: attention_multi_head() in tinyformer.c (scores >> shift, two-pass softmax). */
+static void attn_ref_ctx(int S, int D, int hd, int shift, int fast, int causal)
+{
+    int32_t  s[ATTN_MAX_S];
+    uint16_t w[ATTN_MAX_S];
+    int i, h0, j, d;
+
+    for (i = 0; i < S; i++) {
+        const int n = causal ? i + 1 : S;
+        for (h0 = 0; h0 < D; h0 += hd) {
+            int32_t  max_score = -2147483647;
+            uint32_t sum_exp = 0;
+            for (j = 0; j < n; j++) {
+                int32_t acc = 0;
+                for (d = 0; d < hd; d++)
+                    acc += (int32_t)q[i * D + h0 + d] * (int32_t)k[j * D + h0 + d];
+                s[j] = acc >> shift;
+                if (s[j] > max_score) max_score = s[j];
+            }
+            for (j = 0; j < n; j++) {
+                int32_t idx = -((s[j] - max_score) >> 3);
+                if (idx > 15) idx = 15;
+                w[j] = golden_exp[idx];
+                sum_exp += w[j];
+            }
+            if (sum_exp == 0u) sum_exp = 1u;
+            for (j = 0; j < n; j++) {
+                if (fast)
+                    w[j] = (uint16_t)(((uint32_t)w[j] * (0x80000000u / sum_exp)) >> 16);
+                else
+                    w[j] = (uint16_t)(((uint32_t)w[j] << 15) / sum_exp);
+            }
+            for (d = h0; d < h0 + hd; d++) {
+                int32_t acc = 0;
+                for (j = 0; j < n; j++)
+                    acc += ((int32_t)w[j] * (int32_t)v[j * D + d]) >> 15;
+                ref_ctx[i * D + d] = sat8(acc);
+            }
+        }
+    }
+}
+
+/* range 0: full int8; otherwise values in [-range, range] */
+static void fill(int S, int D, int range)
+{
+    int i;
+    for (i = 0; i < S * D; i++) {
+        if (range == 0) {
+            q[i] = (int8_t)(lcg_next() >> 24);
+            k[i] = (int8_t)(lcg_next() >> 24);
+            v[i] = (int8_t)(lcg_next() >> 24);
+        } else {
+            q[i] = (int8_t)((int32_t)(lcg_next() >> 16) % (2 * range + 1) - range);
+            k[i] = (int8_t)((int32_t)(lcg_next() >> 16) % (2 * range + 1) - range);
+            v[i] = (int8_t)((int32_t)(lcg_next() >> 16) % (2 * range + 1) - range);
+        }
+    }
+}
+
+static int run_block(int S, int D, int hd, int shift, int fast, int causal, int range)
+{
+    int i;
+
+    fill(S, D, range);
+    attn_ref_ctx(S, D, hd, shift, fast, causal);
+    attn_config((unsigned)shift, fast, causal);
+    attn_run(q, k, v, S, D, hd);
+    attn_read_ctx(hw_ctx, S * D);
+    for (i = 0; i < S * D; i++) {
+        if (hw_ctx[i] != ref_ctx[i]) {
+            uart_write_string("ATTN FAIL S=");
+            uart_print_dec((uint32_t)S);
+            uart_write_string(" D=");
+            uart_print_dec((uint32_t)D);
+            uart_write_string(" hd=");
+            uart_print_dec((uint32_t)hd);
+            uart_write_string(" fast=");
+            uart_print_dec((uint32_t)fast);
+            uart_write_string(" causal=");
+            uart_print_dec((uint32_t)causal);
+            uart_write_string(" i=");
+            uart_print_dec((uint32_t)i);
+            uart_write_string(" ref=");
+            uart_print_int(ref_ctx[i]);
+            uart_write_string(" hw=");
+            uart_print_int(hw_ctx[i]);
+            uart_write_string("\r\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void print_field(const char *name, uint32_t val)
+{
+    uart_write_string(" ");
+    uart_write_string(name);
+    uart_write_string("=");
+    uart_print_dec(val);
+}
+
+/* One TinyFormer block: run (Q/K/V in, compute), read_ctx, then the software loop. */
+static int bench_attn(int S, int D, int hd)
+{
+    uint32_t t0, t1, t2, t_sw, engine;
+    int i;
+
+    fill(S, D, 0);
+    t0 = cycle_counter_read();
+    attn_ref_ctx(S, D, hd, 5, 0, 0);
+    t_sw = cycle_counter_read() - t0;
+
+    attn_config(5u, 0, 0);
+    t0 = cycle_counter_read();
+    attn_run(q, k, v, S, D, hd);
+    t1 = cycle_counter_read();
+    attn_read_ctx(hw_ctx, S * D);
+    t2 = cycle_counter_read();
+    engine = attn_cycles();
+    for (i = 0; i < S * D; i++)
+        if (hw_ctx[i] != ref_ctx[i]) return -1;
+
+    uart_write_string("ATTN BENCH S=");
+    uart_print_dec((uint32_t)S);
+    print_field("D", (uint32_t)D);
+    print_field("hd", (uint32_t)hd);
+    print_field("run", t1 - t0);
+    print_field("engine", engine);
+    print_field("read_ctx", t2 - t1);
+    print_field("total", t2 - t0);
+    print_field("sw", t_sw);
+    uart_write_string("\r\n");
+    return 0;
+}
+
+#if ATTN_CLOCK_GATE
+/* Clock gating: wake = one attn_power_get() from off, then the block with
+ * the clock off between run and read_ctx and inside one held reference. */
+static int bench_clock_gate(int S, int D, int hd)
+{
+    uint32_t t0, t1, t2, t3;
+    attn_power_stats_t st;
+    int i;
+
+    fill(S, D, 0);
+    attn_ref_ctx(S, D, hd, 5, 0, 0);
+    attn_config(5u, 0, 0);
+
+    t0 = cycle_counter_read();
+    attn_power_get();
+    t1 = cycle_counter_read();
+    attn_power_put();
+    attn_power_stats(&st);
+    if (st.last_polls >= ATTN_WAKE_SPINS) {
+        uart_write_string("ATTN CLKGATE: clk_on never set\r\n");
+        return -1;
+    }
+
+    t2 = cycle_counter_read();
+    attn_run(q, k, v, S, D, hd);
+    attn_read_ctx(hw_ctx, S * D);
+    t3 = cycle_counter_read();
+    for (i = 0; i < S * D; i++)
+        if (hw_ctx[i] != ref_ctx[i]) return -1;
+
+    uart_write_string("ATTN CLKGATE BENCH S=");
+    uart_print_dec((uint32_t)S);
+    print_field("D", (uint32_t)D);
+    print_field("hd", (uint32_t)hd);
+    print_field("wake", t1 - t0);
+    print_field("polls", st.last_polls);
+    print_field("gated", t3 - t2);
+
+    attn_power_get();
+    t2 = cycle_counter_read();
+    attn_run(q, k, v, S, D, hd);
+    attn_read_ctx(hw_ctx, S * D);
+    t3 = cycle_counter_read();
+    attn_power_put();
+    for (i = 0; i < S * D; i++)
+        if (hw_ctx[i] != ref_ctx[i]) return -1;
+
+    print_field("held", t3 - t2);
+    uart_write_string("\r\n");
+    return 0;
+}
+#endif
+
+int test_attn(void)
+{
+    int fast;
+
+    for (fast = 0; fast <= 1; fast++) {
+        if (run_block(16, 32, 32, 5, fast, 0, 0) != 0) return -1;     /* TinyFormer, one head */
+        if (run_block(16, 32, 32, 5, fast, 1, 0) != 0) return -1;     /* causal */
+        if (run_block(16, 32, 8, 4, fast, 0, 0) != 0) return -1;      /* 4 heads, >> 4 */
+        if (run_block(16, 32, 16, 5, fast, 1, 0) != 0) return -1;     /* 2 heads, causal */
+        if (run_block(ATTN_MAX_S, ATTN_MAX_D, ATTN_MAX_D, 5, fast, 0, 0) != 0) return -1;
+        if (run_block(7, 12, 4, 5, fast, 0, 0) != 0) return -1;       /* odd S, one word per head */
+        if (run_block(1, 32, 32, 5, fast, 0, 0) != 0) return -1;      /* single key */
+        if (run_block(16, 32, 32, 5, fast, 0, 3) != 0) return -1;     /* flat scores */
+        if (run_block(16, 32, 32, 0, fast, 0, 0) != 0) return -1;     /* no shift: peaked rows */
+    }
+    if (bench_attn(16, 32, 32) != 0) return -1;
+#if ATTN_CLOCK_GATE
+    if (bench_clock_gate(16, 32, 32) != 0) return -1;
+#endif
+    uart_write_string("ATTN PASS\r\n");
+    return 0;
+}
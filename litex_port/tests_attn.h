@@ -0,0 +1,20 @@
+/*
+ * Attention engine on-target self-test.
+ *
+ * Link with code that provides uart_write_char(char) (e.g. uart_litex.c or main stub).
+ * Returns 0 on PASS, nonzero on FAIL.
+ */
+#ifndef TESTS_ATTN_H
+#define TESTS_ATTN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int test_attn(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TESTS_ATTN_H */
@@ -1,11 +1,24 @@
 /*
  * DOT8 on-target self-test: SW reference vs dot8_4_lanes (HW or SW).
+ * The MAC form dot8_mac() (funct7=0x02) is checked as a running sum over the
+ * same iterations, starting from a non-zero accumulator. The u8 x int8 forms
+ * (dot8u_op, dot8u_mac) and the 8-lane forms (dot8_mac8, dot8u_mac8, fed the
+ * current and previous word pairs) are checked the same way.
  * Deterministic LCG; ~1000 iterations; UART on fail. No printf/libc.
+ * Also checks dot8_matvec_4x1 against a scalar matvec on a 32x32 block and
+ * prints the cycle count of both (cycle_counter.h), then on other shapes of
+ * the same packed buffer (remainder rows, odd and minimal word counts, the
+ * DOT8_HWLOOP edge cases) with a non-zero bias, then the sustained rate
+ * of dot8_mac / dot8_mac8 in a tight loop against dot8_sw().
+ * The requant helpers (dot8_sat8, dot8_sat8r, dot8_max4, dot8_pack2_sat,
+ * dot8_max) are checked against open-coded references on LCG words with every
+ * shift 0..31, plus the int32 extremes.
  */
 
 #include <stdint.h>
 #include "tests_dot8.h"
 #include "dot8.h"
+#include "cycle_counter.h"
 
 extern void uart_write_char(char c);
 
@@ -23,6 +36,20 @@ static void uart_print_hex(uint32_t v)
     }
 }
 
+static void uart_print_dec(uint32_t v)
+{
+    char buf[10];
+    int n = 0;
+    do { buf[n++] = (char)('0' + v % 10u); v /= 10u; } while (v != 0u);
+    while (n > 0) uart_write_char(buf[--n]);
+}
+
+/* n operations in `cycles` -> operations per 1000 cycles (0 without a cycle counter) */
+static uint32_t per_kcycle(uint32_t n, uint32_t cycles)
+{
+    return cycles ? (n * 1000u) / cycles : 0u;
+}
+
 static uint32_t lcg_state = 1u;
 static int8_t lcg_next_int8(void)
 {
@@ -32,11 +59,263 @@ static int8_t lcg_next_int8(void)
 
 #define NITER 1000
 
+static uint32_t lcg_next_word(void)
+{
+    lcg_state = lcg_state * 1664525u + 1013904223u;
+    return lcg_state;
+}
+
+static int32_t ref_clip8(int64_t x)
+{
+    return x > 127 ? 127 : (x < -128 ? -128 : (int32_t)x);
+}
+
+static int simd_fail(const char *name, uint32_t iter, uint32_t expected, uint32_t got)
+{
+    uart_write_string("DOT8 SIMD FAIL ");
+    uart_write_string(name);
+    uart_write_string(" iter=");
+    uart_print_hex(iter);
+    uart_write_string(" sw=");
+    uart_print_hex(expected);
+    uart_write_string(" hw=");
+    uart_print_hex(got);
+    uart_write_string("\r\n");
+    return -1;
+}
+
+static int test_dot8_simd(void)
+{
+    static const uint32_t edge[4] = { 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu, 0x00000080u };
+    uint32_t iter, w = 0, w_ref = 0;
+    int i;
+
+    for (iter = 0; iter < NITER; iter++) {
+        uint32_t a = lcg_next_word(), b = lcg_next_word();
+        uint32_t sh = iter & 31u;
+        int32_t x, e, got;
+        uint32_t m, mr;
+
+        /* Mix magnitudes so that both clip bounds and the linear range are hit */
+        if (iter < 4u) a = edge[iter];
+        else if ((iter & 3u) == 1u) a = (uint32_t)((int32_t)a >> 20);
+        x = (int32_t)a;
+
+        e = ref_clip8((int64_t)x >> sh);
+        got = dot8_sat8(x, sh);
+        if (got != e) return simd_fail("sat8", iter, (uint32_t)e, (uint32_t)got);
+
+        e = ref_clip8(sh ? ((int64_t)x + ((int64_t)1 << (sh - 1))) >> sh : (int64_t)x);
+        got = dot8_sat8r(x, sh);
+        if (got != e) return simd_fail("sat8r", iter, (uint32_t)e, (uint32_t)got);
+
+        mr = 0;
+        for (i = 0; i < 4; i++) {
+            int8_t p = (int8_t)(a >> (8 * i)), q = (int8_t)(b >> (8 * i));
+            mr |= (uint32_t)(uint8_t)(p > q ? p : q) << (8 * i);
+        }
+        m = dot8_max4(a, b);
+        if (m != mr) return simd_fail("max4", iter, mr, m);
+
+        e = (int32_t)a > (int32_t)b ? (int32_t)a : (int32_t)b;
+        got = dot8_max((int32_t)a, (int32_t)b);
+        if (got != e) return simd_fail("max", iter, (uint32_t)e, (uint32_t)got);
+
+        /* Running pack: lanes of w are the last four saturated inputs */
+        w_ref = (w_ref >> 16) | ((uint32_t)(uint8_t)ref_clip8(x) << 16)
+              | ((uint32_t)(uint8_t)ref_clip8((int32_t)b >> 22) << 24);
+        w = dot8_pack2_sat(w, x, (int32_t)b >> 22);
+        if (w != w_ref) return simd_fail("pack2_sat", iter, w_ref, w);
+    }
+    return 0;
+}
+
+/* Matvec block: same shape as the TinyFormer Q/K/V/O projections. */
+#define MV_ROWS  32
+#define MV_LEN   32
+#define MV_WORDS (MV_LEN / 4)
+
+static int8_t   mv_w[MV_ROWS][MV_LEN];
+static int8_t   mv_x[MV_LEN];
+static uint32_t mv_w_packed[MV_ROWS][MV_WORDS];
+static uint32_t mv_x_packed[MV_WORDS];
+static int32_t  mv_ref[MV_ROWS];
+static int32_t  mv_dot8[MV_ROWS];
+
+static int test_dot8_matvec(void)
+{
+    uint32_t t0, t_scalar, t_dot8;
+    int r, k;
+
+    for (r = 0; r < MV_ROWS; r++)
+        for (k = 0; k < MV_LEN; k++)
+            mv_w[r][k] = lcg_next_int8();
+    for (k = 0; k < MV_LEN; k++)
+        mv_x[k] = lcg_next_int8();
+    for (r = 0; r < MV_ROWS; r++)
+        for (k = 0; k < MV_WORDS; k++)
+            mv_w_packed[r][k] = dot8_pack(&mv_w[r][4 * k]);
+    for (k = 0; k < MV_WORDS; k++)
+        mv_x_packed[k] = dot8_pack(&mv_x[4 * k]);
+
+    /* Scalar loop, as in tinyformer.c without DOT8 */
+    t0 = cycle_counter_read();
+    for (r = 0; r < MV_ROWS; r++) {
+        int32_t acc = 0;
+        for (k = 0; k < MV_LEN; k++)
+            acc += (int32_t)mv_w[r][k] * (int32_t)mv_x[k];
+        mv_ref[r] = acc;
+    }
+    t_scalar = cycle_counter_read() - t0;
+
+    for (r = 0; r < MV_ROWS; r++)
+        mv_dot8[r] = 0;
+    t0 = cycle_counter_read();
+    dot8_matvec_4x1(&mv_w_packed[0][0], mv_x_packed, mv_dot8, MV_ROWS, MV_WORDS);
+    t_dot8 = cycle_counter_read() - t0;
+
+    for (r = 0; r < MV_ROWS; r++) {
+        if (mv_dot8[r] != mv_ref[r]) {
+            uart_write_string("DOT8 MATVEC FAIL row=");
+            uart_print_hex((uint32_t)r);
+            uart_write_string(" ref=");
+            uart_print_hex((uint32_t)mv_ref[r]);
+            uart_write_string(" hw=");
+            uart_print_hex((uint32_t)mv_dot8[r]);
+            uart_write_string("\r\n");
+            return -1;
+        }
+    }
+
+    uart_write_string("DOT8 MATVEC 32x32 cycles scalar=");
+    uart_print_hex(t_scalar);
+    uart_write_string(" dot8_4x1=");
+    uart_print_hex(t_dot8);
+    uart_write_string("\r\n");
+    return 0;
+}
+
+/* dot8_matvec_4x1 on mv_w_packed read as [rows][words], y pre-set to a bias. */
+static int test_dot8_matvec_shape(int rows, int words)
+{
+    const uint32_t *w = &mv_w_packed[0][0];
+    int r, k;
+
+    for (r = 0; r < rows; r++) {
+        int32_t acc = 1000 * r - 7000;
+        for (k = 0; k < words; k++)
+            acc += dot8_sw(w[r * words + k], mv_x_packed[k]);
+        mv_ref[r] = acc;
+        mv_dot8[r] = 1000 * r - 7000;
+    }
+    dot8_matvec_4x1(w, mv_x_packed, mv_dot8, rows, words);
+    for (r = 0; r < rows; r++) {
+        if (mv_dot8[r] != mv_ref[r]) {
+            uart_write_string("DOT8 MATVEC FAIL rows=");
+            uart_print_hex((uint32_t)rows);
+            uart_write_string(" words=");
+            uart_print_hex((uint32_t)words);
+            uart_write_string(" row=");
+            uart_print_hex((uint32_t)r);
+            uart_write_string(" ref=");
+            uart_print_hex((uint32_t)mv_ref[r]);
+            uart_write_string(" hw=");
+            uart_print_hex((uint32_t)mv_dot8[r]);
+            uart_write_string("\r\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Throughput: BENCH_REPS passes over BENCH_WORDS word pairs, one dot8_mac
+ * (4 MACs) per pair, one dot8_mac8 per two pairs, and dot8_sw() for the
+ * software rate. All three sums must agree. */
+#define BENCH_WORDS 256
+#define BENCH_REPS  4
+#define BENCH_OPS   (BENCH_WORDS * BENCH_REPS)
+
+static uint32_t bench_a[BENCH_WORDS];
+static uint32_t bench_b[BENCH_WORDS];
+
+static void print_rate(const char *name, uint32_t cycles)
+{
+    uart_write_string(" ");
+    uart_write_string(name);
+    uart_write_string("_cycles=");
+    uart_print_dec(cycles);
+    uart_write_string(" ");
+    uart_write_string(name);
+    uart_write_string("_ops_per_kcycle=");
+    uart_print_dec(per_kcycle(BENCH_OPS, cycles));
+}
+
+static int bench_dot8(void)
+{
+    uint32_t t0, t_mac, t_mac8, t_sw;
+    int32_t acc_mac = 0, acc_mac8 = 0, acc_sw = 0;
+    int i, rep;
+
+    for (i = 0; i < BENCH_WORDS; i++) {
+        int8_t a[4], b[4];
+        int k;
+        for (k = 0; k < 4; k++) {
+            a[k] = lcg_next_int8();
+            b[k] = lcg_next_int8();
+        }
+        bench_a[i] = dot8_pack(a);
+        bench_b[i] = dot8_pack(b);
+    }
+
+    t0 = cycle_counter_read();
+    for (rep = 0; rep < BENCH_REPS; rep++)
+        for (i = 0; i < BENCH_WORDS; i++)
+            acc_mac = dot8_mac(acc_mac, bench_a[i], bench_b[i]);
+    t_mac = cycle_counter_read() - t0;
+
+    t0 = cycle_counter_read();
+    for (rep = 0; rep < BENCH_REPS; rep++)
+        for (i = 0; i < BENCH_WORDS; i += 2)
+            acc_mac8 = dot8_mac8(acc_mac8, bench_a[i], bench_a[i + 1], bench_b[i], bench_b[i + 1]);
+    t_mac8 = cycle_counter_read() - t0;
+
+    t0 = cycle_counter_read();
+    for (rep = 0; rep < BENCH_REPS; rep++)
+        for (i = 0; i < BENCH_WORDS; i++)
+            acc_sw += dot8_sw(bench_a[i], bench_b[i]);
+    t_sw = cycle_counter_read() - t0;
+
+    if (acc_mac != acc_sw || acc_mac8 != acc_sw) {
+        uart_write_string("DOT8 BENCH FAIL sw=");
+        uart_print_hex((uint32_t)acc_sw);
+        uart_write_string(" mac=");
+        uart_print_hex((uint32_t)acc_mac);
+        uart_write_string(" mac8=");
+        uart_print_hex((uint32_t)acc_mac8);
+        uart_write_string("\r\n");
+        return -1;
+    }
+
+    uart_write_string("DOT8 BENCH ops=");
+    uart_print_dec(BENCH_OPS);
+    print_rate("mac", t_mac);
+    print_rate("mac8", t_mac8);
+    print_rate("sw", t_sw);
+    uart_write_string("\r\n");
+    return 0;
+}
+
 int test_dot8(void)
 {
     int8_t a[4], b[4];
     uint32_t a_packed, b_packed;
     int32_t sw_dot, hw_dot;
+    int32_t sw_acc = -0x12345, hw_acc = -0x12345;
+    int32_t sw_u, hw_u;
+    int32_t sw_u_acc = 0x4321, hw_u_acc = 0x4321;
+    int32_t sw_acc8 = 0, hw_acc8 = 0, sw_u_acc8 = 0, hw_u_acc8 = 0;
+    uint32_t a_prev = 0, b_prev = 0;
+    int32_t sw_prev = 0, sw_u_prev = 0;
     int i, iter;
 
     for (iter = 0; iter < NITER; iter++) {
@@ -63,7 +342,61 @@ int test_dot8(void)
             uart_write_string("\r\n");
             return -1;
         }
+
+        sw_acc += sw_dot;
+        hw_acc = dot8_mac(hw_acc, a_packed, b_packed);
+        if (hw_acc != sw_acc) {
+            uart_write_string("DOT8 MAC FAIL iter=");
+            uart_print_hex((uint32_t)iter);
+            uart_write_string(" sw=");
+            uart_print_hex((uint32_t)sw_acc);
+            uart_write_string(" hw=");
+            uart_print_hex((uint32_t)hw_acc);
+            uart_write_string("\r\n");
+            return -1;
+        }
+
+        /* a as u8 lanes (0..255) */
+        sw_u = (int32_t)(uint8_t)(a[0]) * (int32_t)(int8_t)(b[0])
+             + (int32_t)(uint8_t)(a[1]) * (int32_t)(int8_t)(b[1])
+             + (int32_t)(uint8_t)(a[2]) * (int32_t)(int8_t)(b[2])
+             + (int32_t)(uint8_t)(a[3]) * (int32_t)(int8_t)(b[3]);
+        hw_u = dot8u_op(a_packed, b_packed);
+        sw_u_acc += sw_u;
+        hw_u_acc = dot8u_mac(hw_u_acc, a_packed, b_packed);
+
+        /* 8 lanes: previous word pair (lo) + this one (hi) */
+        sw_acc8 += sw_prev + sw_dot;
+        hw_acc8 = dot8_mac8(hw_acc8, a_prev, a_packed, b_prev, b_packed);
+        sw_u_acc8 += sw_u_prev + sw_u;
+        hw_u_acc8 = dot8u_mac8(hw_u_acc8, a_prev, a_packed, b_prev, b_packed);
+
+        if (hw_u != sw_u || hw_u_acc != sw_u_acc || hw_acc8 != sw_acc8 || hw_u_acc8 != sw_u_acc8) {
+            uart_write_string("DOT8 U8/MAC8 FAIL iter=");
+            uart_print_hex((uint32_t)iter);
+            uart_write_string(" u8 sw=");
+            uart_print_hex((uint32_t)sw_u);
+            uart_write_string(" hw=");
+            uart_print_hex((uint32_t)hw_u);
+            uart_write_string(" mac8 sw=");
+            uart_print_hex((uint32_t)sw_acc8);
+            uart_write_string(" hw=");
+            uart_print_hex((uint32_t)hw_acc8);
+            uart_write_string("\r\n");
+            return -1;
+        }
+        a_prev = a_packed;
+        b_prev = b_packed;
+        sw_prev = sw_dot;
+        sw_u_prev = sw_u;
     }
+    if (test_dot8_simd() != 0) return -1;
+    if (test_dot8_matvec() != 0) return -1;
+    if (test_dot8_matvec_shape(MV_ROWS - 3, MV_WORDS) != 0 ||   /* 7 blocks + 1 row */
+        test_dot8_matvec_shape(9, 3) != 0 ||                     /* odd: C loop */
+        test_dot8_matvec_shape(4, 2) != 0 ||                     /* one loop pass */
+        test_dot8_matvec_shape(8, 4) != 0) return -1;
+    if (bench_dot8() != 0) return -1;
     uart_write_string("DOT8 PASS\r\n");
     return 0;
 }
@@ -0,0 +1,330 @@
+/*
+ * GEMM on-target self-test: software reference matmul vs the block, compare Y and Y8.
+ * Deterministic inputs (LCG). No printf/malloc; uses uart_write_char for output.
+ * After the checks, a TinyFormer projection ([16][32] x [32][32]) is timed end to
+ * end, split into load_w / load_x+compute / read_y, against the software loop
+ * (cycle_counter.h).
+ *
+ * Link with: gemm.c, and code providing uart_write_char (e.g. uart_litex.c).
+ * Define GEMM_USE_LITEX_CSR or GEMM_BASE as for the driver.
+ */
+
+#include <stdint.h>
+#include "tests_gemm.h"
+#include "gemm.h"
+#include "cycle_counter.h"
+
+extern void uart_write_char(char c);
+
+static void uart_write_string(const char *s)
+{
+    while (*s != '\0') {
+        uart_write_char(*s);
+        s++;
+    }
+}
+
+static void uart_print_hex(uint32_t value)
+{
+    const char hex[] = "0123456789ABCDEF";
+    int i;
+    uart_write_char('0');
+    uart_write_char('x');
+    for (i = 7; i >= 0; i--) {
+        uint32_t n = (value >> (i * 4)) & 0xFu;
+        uart_write_char(hex[n]);
+    }
+}
+
+static void uart_print_dec(uint32_t v)
+{
+    char buf[10];
+    int n = 0;
+    do { buf[n++] = (char)('0' + v % 10u); v /= 10u; } while (v != 0u);
+    while (n > 0) uart_write_char(buf[--n]);
+}
+
+/* Deterministic LCG for int8 (no libc rand) */
+static uint32_t lcg = 1u;
+static int8_t lcg_next_int8(void)
+{
+    lcg = lcg * 1664525u + 1013904223u;
+    return (int8_t)(lcg >> 24);
+}
+
+#define MAX_M  (2 * GEMM_M_MAX + 8)   /* gemm_project8() over several runs */
+#define MAX_N  GEMM_N_MAX
+#define MAX_K  GEMM_K_MAX
+#define X_STRIDE (MAX_K + 4)          /* rows of X are not packed */
+
+static int8_t  ref_x[MAX_M * X_STRIDE];
+static int8_t  ref_w[2][MAX_N * MAX_K];
+static int32_t ref_b[MAX_N];
+static int8_t  ref_b8[MAX_N];
+static int32_t ref_y[MAX_M * MAX_N];
+static int32_t hw_y[MAX_M * MAX_N];
+static int8_t  hw_y8[MAX_M * MAX_N];
+
+static void fill(int m, int n, int k, int w)
+{
+    int i;
+    for (i = 0; i < m * X_STRIDE; i++)
+        ref_x[i] = lcg_next_int8();
+    for (i = 0; i < n * k; i++)
+        ref_w[w][i] = lcg_next_int8();
+    for (i = 0; i < n; i++) {
+        ref_b8[i] = lcg_next_int8();
+        ref_b[i] = (int32_t)ref_b8[i] * 1000;
+    }
+}
+
+/* Software reference: Y[i][j] = sum_c X[i][c] * W[j][c] (+ b[j]). */
+static void gemm_ref(const int8_t *w, const int32_t *b, int m, int n, int k)
+{
+    int i, j, c;
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++) {
+            int32_t acc = b != 0 ? b[j] : 0;
+            for (c = 0; c < k; c++)
+                acc += (int32_t)ref_x[i * X_STRIDE + c] * (int32_t)w[j * k + c];
+            ref_y[i * n + j] = acc;
+        }
+    }
+}
+
+/* sat8(relu?(y + round) >> shift), as the requant stage */
+static int8_t requant_ref(int32_t y, int shift, int round, int relu)
+{
+    int64_t p = y;
+    if (round && shift > 0) p += (int64_t)1 << (shift - 1);
+    p >>= shift;
+    if (relu && p < 0) p = 0;
+    if (p > 127) return 127;
+    if (p < -128) return -128;
+    return (int8_t)p;
+}
+
+static int report(const char *what, int m, int n, int k, int idx, int32_t ref, int32_t hw)
+{
+    uart_write_string("GEMM FAIL ");
+    uart_write_string(what);
+    uart_write_string(" m=");
+    uart_print_dec((uint32_t)m);
+    uart_write_string(" n=");
+    uart_print_dec((uint32_t)n);
+    uart_write_string(" k=");
+    uart_print_dec((uint32_t)k);
+    uart_write_string(" i=");
+    uart_print_dec((uint32_t)idx);
+    uart_write_string(" ref=");
+    uart_print_hex((uint32_t)ref);
+    uart_write_string(" hw=");
+    uart_print_hex((uint32_t)hw);
+    uart_write_string("\r\n");
+    return -1;
+}
+
+static int check_y(const char *what, int m, int n, int k)
+{
+    int i;
+    for (i = 0; i < m * n; i++)
+        if (ref_y[i] != hw_y[i]) return report(what, m, n, k, i, ref_y[i], hw_y[i]);
+    return 0;
+}
+
+/* One run at resident row w_row, with and without bias */
+static int run_one(int m, int n, int k, int w_row)
+{
+    fill(m, n, k, 0);
+    gemm_load_w(w_row, ref_w[0], ref_b, 0, n, k);
+
+    gemm_ref(ref_w[0], ref_b, m, n, k);
+    gemm_run(w_row, ref_x, X_STRIDE, m, n, k, 1);
+    gemm_read_y(hw_y, m * n);
+    if (check_y("bias", m, n, k) != 0) return -1;
+
+    gemm_ref(ref_w[0], 0, m, n, k);
+    gemm_run(w_row, ref_x, X_STRIDE, m, n, k, 0);
+    gemm_read_y(hw_y, m * n);
+    return check_y("nobias", m, n, k);
+}
+
+/* Two layers resident at once: the second load must not touch the first */
+static int run_resident(int m, int n, int k)
+{
+    const int row1 = GEMM_W_ROWS - n;
+    int32_t b1[MAX_N];
+    int i;
+
+    fill(m, n, k, 1);
+    for (i = 0; i < n; i++) b1[i] = ref_b[i];
+    gemm_load_w(row1, ref_w[1], b1, 0, n, k);
+    fill(m, n, k, 0);
+    gemm_load_w(0, ref_w[0], ref_b, 0, n, k);
+
+    gemm_ref(ref_w[1], b1, m, n, k);
+    gemm_run(row1, ref_x, X_STRIDE, m, n, k, 1);
+    gemm_read_y(hw_y, m * n);
+    if (check_y("resident1", m, n, k) != 0) return -1;
+
+    gemm_ref(ref_w[0], ref_b, m, n, k);
+    gemm_run(0, ref_x, X_STRIDE, m, n, k, 1);
+    gemm_read_y(hw_y, m * n);
+    return check_y("resident0", m, n, k);
+}
+
+/* Requantized Y8 of one run */
+static int run_requant(int m, int n, int k, int shift, int round, int relu)
+{
+    int i;
+
+    fill(m, n, k, 0);
+    gemm_load_w(0, ref_w[0], ref_b, 0, n, k);
+    gemm_ref(ref_w[0], ref_b, m, n, k);
+    gemm_set_requant(GEMM_RQ_SHIFT(shift) | (round ? GEMM_RQ_ROUND : 0u) | (relu ? GEMM_RQ_RELU : 0u));
+    gemm_run(0, ref_x, X_STRIDE, m, n, k, 1);
+    gemm_read_y8(hw_y8, m * n);
+    gemm_set_requant(GEMM_RQ_SHIFT(7));
+    for (i = 0; i < m * n; i++) {
+        const int8_t r = requant_ref(ref_y[i], shift, round, relu);
+        if (r != hw_y8[i]) return report("y8", m, n, k, i, r, hw_y8[i]);
+    }
+    return 0;
+}
+
+/* gemm_project8() over more than GEMM_M_MAX tokens: int8 bias, >> 7 */
+static int run_project8(int m, int n, int k)
+{
+    int32_t b[MAX_N];
+    int i, j;
+
+    fill(m, n, k, 0);
+    for (j = 0; j < n; j++) b[j] = ref_b8[j];
+    gemm_ref(ref_w[0], b, m, n, k);
+    gemm_invalidate();
+    gemm_set_requant(GEMM_RQ_SHIFT(7));
+    if (!gemm_project8(ref_w[0], ref_b8, ref_x, X_STRIDE, hw_y8, n, m, n, k))
+        return report("fits", m, n, k, 0, 1, 0);
+    for (i = 0; i < m * n; i++) {
+        const int8_t r = requant_ref(ref_y[i], 7, 0, 0);
+        if (r != hw_y8[i]) return report("project8", m, n, k, i, r, hw_y8[i]);
+    }
+    gemm_invalidate();
+    return 0;
+}
+
+static void print_field(const char *name, uint32_t v)
+{
+    uart_write_string(" ");
+    uart_write_string(name);
+    uart_write_string("=");
+    uart_print_dec(v);
+}
+
+/* One whole projection: each phase timed on its own, then the software loop
+ * on the same operands. run is the X stream plus the block's compute. */
+static int bench_gemm(int m, int n, int k)
+{
+    uint32_t t0, t1, t2, t3, t_sw;
+
+    fill(m, n, k, 0);
+    t0 = cycle_counter_read();
+    gemm_ref(ref_w[0], 0, m, n, k);
+    t_sw = cycle_counter_read() - t0;
+
+    t0 = cycle_counter_read();
+    gemm_load_w(0, ref_w[0], 0, 0, n, k);
+    t1 = cycle_counter_read();
+    gemm_run(0, ref_x, X_STRIDE, m, n, k, 0);
+    t2 = cycle_counter_read();
+    gemm_read_y(hw_y, m * n);
+    t3 = cycle_counter_read();
+    if (check_y("bench", m, n, k) != 0) return -1;
+
+    uart_write_string("GEMM BENCH m=");
+    uart_print_dec((uint32_t)m);
+    print_field("n", (uint32_t)n);
+    print_field("k", (uint32_t)k);
+    print_field("pe", (uint32_t)GEMM_P);
+    print_field("load_w", t1 - t0);
+    print_field("run", t2 - t1);
+    print_field("read_y", t3 - t2);
+    print_field("total", t3 - t0);
+    print_field("sw", t_sw);
+    uart_write_string("\r\n");
+    return 0;
+}
+
+#if GEMM_CLOCK_GATE
+/* Clock gating: wake = one gemm_power_get() from off, then the projection
+ * with the clock off between calls and inside one held reference. */
+static int bench_clock_gate(int m, int n, int k)
+{
+    uint32_t t0, t1, t2, t3;
+    gemm_power_stats_t st;
+
+    fill(m, n, k, 0);
+    gemm_ref(ref_w[0], 0, m, n, k);
+
+    t0 = cycle_counter_read();
+    gemm_power_get();
+    t1 = cycle_counter_read();
+    gemm_power_put();
+    gemm_power_stats(&st);
+    if (st.last_polls >= GEMM_WAKE_SPINS) {
+        uart_write_string("GEMM CLKGATE: clk_on never set\r\n");
+        return -1;
+    }
+
+    t2 = cycle_counter_read();
+    gemm_load_w(0, ref_w[0], 0, 0, n, k);
+    gemm_run(0, ref_x, X_STRIDE, m, n, k, 0);
+    gemm_read_y(hw_y, m * n);
+    t3 = cycle_counter_read();
+    if (check_y("clkgate", m, n, k) != 0) return -1;
+
+    uart_write_string("GEMM CLKGATE BENCH m=");
+    uart_print_dec((uint32_t)m);
+    print_field("n", (uint32_t)n);
+    print_field("k", (uint32_t)k);
+    print_field("wake", t1 - t0);
+    print_field("polls", st.last_polls);
+    print_field("gated", t3 - t2);
+
+    gemm_power_get();
+    t2 = cycle_counter_read();
+    gemm_load_w(0, ref_w[0], 0, 0, n, k);
+    gemm_run(0, ref_x, X_STRIDE, m, n, k, 0);
+    gemm_read_y(hw_y, m * n);
+    t3 = cycle_counter_read();
+    gemm_power_put();
+    if (check_y("clkgate", m, n, k) != 0) return -1;
+
+    print_field("held", t3 - t2);
+    uart_write_string("\r\n");
+    return 0;
+}
+#endif
+
+int test_gemm(void)
+{
+    gemm_invalidate();
+    if (run_one(16, 32, 32, 0) != 0) return -1;          /* Q/K/V/O, S=16 */
+    if (run_one(16, 64, 32, GEMM_P) != 0) return -1;     /* FF1 shape, offset row */
+    if (run_one(16, 32, 64, 0) != 0) return -1;          /* FF2 shape */
+    if (run_one(5, 8, 4, 0) != 0) return -1;             /* partial token tile, minimal K */
+    if (run_one(1, GEMM_N_MAX, GEMM_K_MAX, 0) != 0) return -1;
+    if (run_one(GEMM_M_MAX, GEMM_P, 12, 0) != 0) return -1;
+    if (run_resident(16, 32, 32) != 0) return -1;
+    if (run_requant(16, 32, 32, 7, 0, 0) != 0) return -1;
+    if (run_requant(11, 64, 64, 12, 1, 1) != 0) return -1;
+    if (run_requant(16, 16, 32, 0, 0, 0) != 0) return -1;   /* saturation */
+    if (run_project8(2 * GEMM_M_MAX + 3, 32, 32) != 0) return -1;
+    if (bench_gemm(16, 32, 32) != 0) return -1;             /* one TinyFormer projection */
+#if GEMM_CLOCK_GATE
+    if (bench_clock_gate(16, 32, 32) != 0) return -1;
+#endif
+    gemm_invalidate();
+    uart_write_string("GEMM self-test PASS\r\n");
+    return 0;
+}
@@ -1,6 +1,8 @@
 /*
  * GEMV on-target self-test: software reference GEMV vs hardware, compare Y.
  * Deterministic inputs (LCG). No printf/malloc; uses uart_write_char for output.
+ * After the checks, the TinyFormer shapes are timed end to end, split into
+ * load_w / load_x / compute / read_y, against the software GEMV (cycle_counter.h).
  *
  * Link with: gemv.c, and code providing uart_write_char (e.g. uart_litex.c).
  * Define GEMV_USE_LITEX_CSR or GEMV_BASE as for the driver.
@@ -9,6 +11,7 @@
 #include <stdint.h>
 #include "tests_gemv.h"
 #include "gemv.h"
+#include "cycle_counter.h"
 
 extern void uart_write_char(char c);
 
@@ -32,6 +35,14 @@ static void uart_print_hex(uint32_t value)
     }
 }
 
+static void uart_print_dec(uint32_t v)
+{
+    char buf[10];
+    int n = 0;
+    do { buf[n++] = (char)('0' + v % 10u); v /= 10u; } while (v != 0u);
+    while (n > 0) uart_write_char(buf[--n]);
+}
+
 /* Deterministic LCG for int8 (no libc rand) */
 static uint32_t lcg = 1u;
 static int8_t lcg_next_int8(void)
@@ -54,10 +65,41 @@ static void gemv_ref(const int8_t *w, const int8_t *x, int out_dim, int len, int
 
 #define MAX_LEN    64
 #define MAX_OUT    64
-static int8_t  ref_x[MAX_LEN];
-static int8_t  ref_w[MAX_OUT * MAX_LEN];
+/* Word-aligned so the GEMV_DMA bus master can fetch them. */
+static int8_t  ref_x[MAX_LEN] __attribute__((aligned(4)));
+static int8_t  ref_w[MAX_OUT * MAX_LEN] __attribute__((aligned(4)));
 static int32_t ref_y[MAX_OUT];
 static int32_t hw_y[MAX_OUT];
+#if GEMV_PACKED_WRITES
+static uint32_t ref_w_packed[MAX_OUT * MAX_LEN / 4];
+#endif
+
+static int check_vec(const int32_t *ref, const int32_t *hw, int len, int out_dim)
+{
+    int i;
+    for (i = 0; i < out_dim; i++) {
+        if (hw[i] != ref[i]) {
+            uart_write_string("FAIL len=");
+            uart_print_hex((uint32_t)len);
+            uart_write_string(" out_dim=");
+            uart_print_hex((uint32_t)out_dim);
+            uart_write_string(" i=");
+            uart_print_hex((uint32_t)i);
+            uart_write_string(" ref=");
+            uart_print_hex((uint32_t)ref[i]);
+            uart_write_string(" hw=");
+            uart_print_hex((uint32_t)hw[i]);
+            uart_write_string("\r\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_y(int len, int out_dim)
+{
+    return check_vec(ref_y, hw_y, len, out_dim);
+}
 
 static int run_one(int len, int out_dim)
 {
@@ -77,24 +119,596 @@ static int run_one(int len, int out_dim)
     gemv_wait_done();
     gemv_read_y(hw_y, out_dim);
 
+    return check_y(len, out_dim);
+}
+
+#if GEMV_DMA
+/* Bus-master run of the last run_one() product: W fetch, then an X-only rerun. */
+static int run_dma(int len, int out_dim)
+{
+    int i;
+    gemv_invalidate_w();
+    gemv_submit(ref_w, ref_x, hw_y, len, out_dim);
+    while (!gemv_poll()) {
+    }
+    if (check_y(len, out_dim) != 0) return -1;
+
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+    gemv_ref(ref_w, ref_x, out_dim, len, ref_y);
+    gemv_submit(ref_w, ref_x, hw_y, len, out_dim);   /* W resident: X fetch only */
+    while (!gemv_poll()) {
+    }
+    return check_y(len, out_dim);
+}
+#endif
+
+#if GEMV_MEM
+/* Memory window: two out_dim x len matrices resident at once, in the two halves
+ * of the W memory, with X written into bank 0 by address; each run selects its
+ * matrix with gemv_set_w_base(). Then one row of the second matrix is rewritten
+ * in place and both are run again. */
+static int8_t  mem_w2[MAX_OUT * MAX_LEN];
+static int32_t mem_y2[MAX_OUT];
+
+static int run_mem_pair(int len, int out_dim, uint32_t base2)
+{
+    gemv_set_w_base(0);
+    gemv_clear_x();
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done();
+    gemv_read_y(hw_y, out_dim);
+    if (check_y(len, out_dim) != 0) return -1;
+
+    gemv_set_w_base(base2);
+    gemv_clear_x();
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done();
+    gemv_read_y(hw_y, out_dim);
+    return check_vec(mem_y2, hw_y, len, out_dim);
+}
+
+static int run_mem(int len, int out_dim)
+{
+    uint32_t base2 = GEMV_MEM_W_SIZE / 2u;
+    int i, n = out_dim * len;
+    if ((uint32_t)n > base2) return -1;
+
+    lcg = 7u;
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+    for (i = 0; i < n; i++) {
+        ref_w[i]  = lcg_next_int8();
+        mem_w2[i] = lcg_next_int8();
+    }
+    gemv_ref(ref_w, ref_x, out_dim, len, ref_y);
+    gemv_ref(mem_w2, ref_x, out_dim, len, mem_y2);
+
+    gemv_clear_done();
+    gemv_write_w(0, ref_w, n);
+    gemv_write_w(base2, mem_w2, n);
+    gemv_write_x(0, ref_x, len);
+    if (run_mem_pair(len, out_dim, base2) != 0) return -1;
+
+    /* Row 1 of the second matrix only: len / 4 window writes */
+    for (i = len; i < 2 * len; i++)
+        mem_w2[i] = lcg_next_int8();
+    gemv_write_w(base2 + (uint32_t)len, &mem_w2[len], len);
+    gemv_ref(mem_w2, ref_x, out_dim, len, mem_y2);
+    if (run_mem_pair(len, out_dim, base2) != 0) return -1;
+
+    gemv_set_w_base(0);
+    gemv_clear_done();
+    return 0;
+}
+#endif
+
+#if GEMV_DOUBLE_BUFFER
+/* Pipelined tokens: TOKENS X vectors through gemv_run_tokens(), each Y checked
+ * in the callback against the software reference. */
+#define TOKENS 5
+static int8_t tok_x[TOKENS * MAX_LEN];
+static int tok_fail;
+static int tok_seen;
+
+static void check_token(void *ctx, int token, const int32_t *y)
+{
+    const int *dims = (const int *)ctx;   /* {len, out_dim} */
+    int i;
+    gemv_ref(ref_w, &tok_x[token * dims[0]], dims[1], dims[0], ref_y);
+    for (i = 0; i < dims[1]; i++)
+        hw_y[i] = y[i];
+    if (token != tok_seen++ || check_y(dims[0], dims[1]) != 0)
+        tok_fail = 1;
+}
+
+static int run_tokens(int len, int out_dim)
+{
+    int dims[2];
+    int i;
+    dims[0] = len;
+    dims[1] = out_dim;
+    for (i = 0; i < TOKENS * len; i++)
+        tok_x[i] = lcg_next_int8();
+    tok_fail = 0;
+    tok_seen = 0;
+    gemv_run_tokens(tok_x, len, TOKENS, len, out_dim, 0, check_token, dims);
+    return (tok_fail || tok_seen != TOKENS) ? -1 : 0;
+}
+#endif
+
+/* Weight-stationary: keep the W loaded by run_one(), restart with a new X only. */
+#if GEMV_PACKED_WRITES
+/* Same product as the last run_one(), W loaded from word-packed rows. */
+static int run_w_packed(int len, int out_dim)
+{
+    int i;
+    for (i = 0; i < out_dim * len / 4; i++)
+        ref_w_packed[i] = (uint32_t)(uint8_t)ref_w[4 * i]
+                        | ((uint32_t)(uint8_t)ref_w[4 * i + 1] << 8)
+                        | ((uint32_t)(uint8_t)ref_w[4 * i + 2] << 16)
+                        | ((uint32_t)(uint8_t)ref_w[4 * i + 3] << 24);
+
+    gemv_clear_done();
+    gemv_load_x(ref_x, len);
+    gemv_load_w_packed(ref_w_packed, out_dim, len);
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done();
+    gemv_read_y(hw_y, out_dim);
+
+    return check_y(len, out_dim);
+}
+#endif
+
+#if GEMV_REQUANT
+/* Requant stage: int8 bias, optional multiplier, rounding shift and ReLU on
+ * the block; Y8_OUT checked against the reference requantized on the CPU. */
+static int8_t ref_b[MAX_OUT];
+static int8_t hw_y8[MAX_OUT];
+
+static int run_requant(int len, int out_dim, int shift, int mul, int relu)
+{
+    int i;
+    uint32_t cfg = GEMV_RQ_SHIFT(shift) | GEMV_RQ_ROUND;
+    if (mul != 0) cfg |= GEMV_RQ_MUL_EN | GEMV_RQ_MUL(mul);
+    if (relu)     cfg |= GEMV_RQ_RELU;
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+    for (i = 0; i < out_dim * len; i++)
+        ref_w[i] = lcg_next_int8();
+    for (i = 0; i < out_dim; i++)
+        ref_b[i] = lcg_next_int8();
+
+    gemv_ref(ref_w, ref_x, out_dim, len, ref_y);
+
+    gemv_clear_done();
+    gemv_load_x(ref_x, len);
+    gemv_load_w(ref_w, out_dim, len);
+    gemv_load_b_i8(ref_b, out_dim);
+    gemv_set_requant(cfg);
+    gemv_start(len, out_dim, 1);
+    gemv_wait_done();
+    gemv_read_y8(hw_y8, out_dim);
+
     for (i = 0; i < out_dim; i++) {
-        if (hw_y[i] != ref_y[i]) {
-            uart_write_string("FAIL len=");
-            uart_print_hex((uint32_t)len);
-            uart_write_string(" out_dim=");
-            uart_print_hex((uint32_t)out_dim);
-            uart_write_string(" i=");
-            uart_print_hex((uint32_t)i);
-            uart_write_string(" ref=");
-            uart_print_hex((uint32_t)ref_y[i]);
-            uart_write_string(" hw=");
-            uart_print_hex((uint32_t)hw_y[i]);
-            uart_write_string("\r\n");
-            return -1;
+        int64_t v = (int64_t)(ref_y[i] + ref_b[i]) * (mul != 0 ? mul : 1);
+        v = (v + ((int64_t)1 << (shift - 1))) >> shift;
+        if (relu && v < 0) v = 0;
+        ref_y[i] = (v > 127) ? 127 : (v < -128) ? -128 : (int32_t)v;
+        hw_y[i] = hw_y8[i];
+    }
+    return check_y(len, out_dim);
+}
+#endif
+
+/* Shapes the core does not take directly, through gemv_matvec(): W in ref_w
+ * (out_dim * len <= MAX_OUT * MAX_LEN), int8 bias. A single-tile W is run
+ * again with a new X to check it stayed resident. */
+#define TILE_MAX 72
+static int8_t  tile_x[TILE_MAX];
+static int8_t  tile_b[TILE_MAX];
+static int32_t tile_ref[TILE_MAX];
+static int32_t tile_hw[TILE_MAX];
+#if GEMV_REQUANT
+static int8_t  tile_hw8[TILE_MAX];
+#endif
+
+static int run_tiled(int out_dim, int len, int runs)
+{
+    int i, run;
+    gemv_invalidate_w();   /* ref_w is rewritten below */
+    for (i = 0; i < out_dim * len; i++)
+        ref_w[i] = lcg_next_int8();
+    for (i = 0; i < out_dim; i++)
+        tile_b[i] = lcg_next_int8();
+
+    for (run = 0; run < runs; run++) {
+        for (i = 0; i < len; i++)
+            tile_x[i] = lcg_next_int8();
+        gemv_ref(ref_w, tile_x, out_dim, len, tile_ref);
+        for (i = 0; i < out_dim; i++)
+            tile_ref[i] += tile_b[i];
+
+        gemv_matvec(ref_w, tile_x, tile_b, tile_hw, out_dim, len);
+        if (check_vec(tile_ref, tile_hw, len, out_dim) != 0) return -1;
+
+#if GEMV_REQUANT
+        gemv_set_requant(GEMV_RQ_SHIFT(7));
+        gemv_matvec8(ref_w, tile_x, tile_b, tile_hw8, out_dim, len);
+        for (i = 0; i < out_dim; i++) {
+            int32_t v = tile_ref[i] >> 7;
+            tile_ref[i] = (v > 127) ? 127 : (v < -128) ? -128 : v;
+            tile_hw[i] = tile_hw8[i];
+        }
+        if (check_vec(tile_ref, tile_hw, len, out_dim) != 0) return -1;
+#endif
+    }
+    return 0;
+}
+
+#if GEMV_ATTN
+/* Attention offload: one query's scores against n resident keys, then the
+ * context of n Q15 weights against the resident V^T, both checked against
+ * the CPU; a second query reuses the loaded head. K and V in ref_w (row
+ * stride MAX_LEN). */
+static uint16_t attn_w[GEMV_ATTN_MAX_KEYS];
+
+static int run_attn(int n, int hd)
+{
+    const int8_t *k = ref_w;
+    const int8_t *v = &ref_w[GEMV_ATTN_MAX_KEYS * MAX_LEN];
+    int i, j, q;
+    gemv_invalidate_w();   /* ref_w is rewritten below */
+    for (i = 0; i < 2 * GEMV_ATTN_MAX_KEYS * MAX_LEN; i++)
+        ref_w[i] = lcg_next_int8();
+    gemv_attn_load(k, v, n, hd, MAX_LEN);
+
+    for (q = 0; q < 2; q++) {
+        for (i = 0; i < hd; i++)
+            ref_x[i] = lcg_next_int8();
+        for (j = 0; j < n; j++) {
+            int32_t acc = 0;
+            for (i = 0; i < hd; i++)
+                acc += (int32_t)k[j * MAX_LEN + i] * (int32_t)ref_x[i];
+            ref_y[j] = acc;
+        }
+        gemv_attn_scores(ref_x, hw_y);
+        if (check_vec(ref_y, hw_y, hd, n) != 0) return -1;
+
+        for (j = 0; j < n; j++) {
+            (void)lcg_next_int8();
+            attn_w[j] = (uint16_t)(lcg >> 17);
+        }
+        attn_w[0] = 32768u;   /* 1.0 in Q15: top bit of the high byte */
+        for (i = 0; i < hd; i++) {
+            int32_t acc = 0;
+            for (j = 0; j < n; j++)
+                acc += (int32_t)attn_w[j] * (int32_t)v[j * MAX_LEN + i];
+            ref_y[i] = acc;
         }
+        gemv_attn_context(attn_w, hw_y);
+        if (check_vec(ref_y, hw_y, n, hd) != 0) return -1;
+    }
+    return 0;
+}
+#endif
+
+#if GEMV_IRQ
+/* Done interrupt: a run against the resident W, waited for in WFI, must
+ * raise exactly one completion callback. With GEMV_DMA a bus-master job of
+ * the same product goes first: it must raise one callback too, and the CSR
+ * run after it (DMA_STATUS.done still set) its own. */
+static volatile int irq_hits;
+
+static void count_done(void *ctx)
+{
+    (void)ctx;
+    irq_hits++;
+}
+
+/* The ISR may still be on its way when done reads set; give it a while. */
+static int check_hits(int want)
+{
+    int spin;
+    for (spin = 0; spin < 1000 && irq_hits < want; spin++) {
+    }
+    if (irq_hits != want) {
+        uart_write_string("FAIL irq hits=");
+        uart_print_hex((uint32_t)irq_hits);
+        uart_write_string("\r\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int run_irq(int len, int out_dim)
+{
+    int i;
+    if (run_one(len, out_dim) != 0) return -1;
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+    gemv_ref(ref_w, ref_x, out_dim, len, ref_y);
+
+    gemv_irq_init();
+    irq_hits = 0;
+    gemv_set_done_callback(count_done, 0);
+#if GEMV_DMA
+    gemv_submit(ref_w, ref_x, hw_y, len, out_dim);
+    while (!gemv_poll()) {
+    }
+    if (check_hits(1) != 0 || check_y(len, out_dim) != 0) {
+        gemv_set_done_callback(0, 0);
+        return -1;
+    }
+    irq_hits = 0;
+#endif
+    gemv_clear_x();
+    gemv_load_x(ref_x, len);
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done_wfi();
+    gemv_read_y(hw_y, out_dim);
+    gemv_set_done_callback(0, 0);
+
+    if (check_hits(1) != 0) return -1;
+    return check_y(len, out_dim);
+}
+#endif
+
+static int run_x_only(int len, int out_dim)
+{
+    int i;
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+
+    gemv_ref(ref_w, ref_x, out_dim, len, ref_y);
+
+    gemv_clear_x();
+    gemv_load_x(ref_x, len);
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done();
+    gemv_read_y(hw_y, out_dim);
+
+    return check_y(len, out_dim);
+}
+
+/* Throughput of one CSR-fed product: each phase timed on its own, then the
+ * software GEMV on the same operands. w_bytes_per_kcycle is the W streaming
+ * rate through the CSR bus; compute is the core's run from start to done. */
+static void print_field(const char *name, uint32_t v)
+{
+    uart_write_string(" ");
+    uart_write_string(name);
+    uart_write_string("=");
+    uart_print_dec(v);
+}
+
+static int bench_gemv(int len, int out_dim)
+{
+    uint32_t t0, t1, t2, t3, t4, t_sw;
+    int i;
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+    for (i = 0; i < out_dim * len; i++)
+        ref_w[i] = lcg_next_int8();
+
+    t0 = cycle_counter_read();
+    gemv_ref(ref_w, ref_x, out_dim, len, ref_y);
+    t_sw = cycle_counter_read() - t0;
+
+    gemv_clear_done();
+    t0 = cycle_counter_read();
+    gemv_load_x(ref_x, len);
+    t1 = cycle_counter_read();
+    gemv_load_w(ref_w, out_dim, len);
+    t2 = cycle_counter_read();
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done();
+    t3 = cycle_counter_read();
+    gemv_read_y(hw_y, out_dim);
+    t4 = cycle_counter_read();
+    if (check_y(len, out_dim) != 0) return -1;
+
+    uart_write_string("GEMV BENCH len=");
+    uart_print_dec((uint32_t)len);
+    print_field("out_dim", (uint32_t)out_dim);
+    print_field("load_w", t2 - t1);
+    print_field("load_x", t1 - t0);
+    print_field("compute", t3 - t2);
+    print_field("read_y", t4 - t3);
+    print_field("total", t4 - t0);
+    print_field("sw", t_sw);
+    print_field("w_bytes_per_kcycle",
+                (t2 - t1) ? (uint32_t)(out_dim * len) * 1000u / (t2 - t1) : 0u);
+    uart_write_string("\r\n");
+    return 0;
+}
+
+#if GEMV_CLOCK_GATE
+/* Clock gating: wake = one gemv_power_get() from off (CLK_EN write plus the
+ * STATUS.clk_on polls), then the same product with the clock off between
+ * calls (each call wakes the core on its own) and inside one held reference
+ * (one wake for the whole product, as in an encoder pass). */
+static int bench_clock_gate(int len, int out_dim)
+{
+    uint32_t t0, t1, t2, t3;
+    gemv_power_stats_t st;
+    int i;
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+    for (i = 0; i < out_dim * len; i++)
+        ref_w[i] = lcg_next_int8();
+    gemv_ref(ref_w, ref_x, out_dim, len, ref_y);
+
+    t0 = cycle_counter_read();
+    gemv_power_get();
+    t1 = cycle_counter_read();
+    gemv_power_put();
+    gemv_power_stats(&st);
+    if (st.last_polls >= GEMV_WAKE_SPINS) {
+        uart_write_string("GEMV CLKGATE: clk_on never set\r\n");
+        return -1;
     }
+
+    gemv_clear_done();
+    t2 = cycle_counter_read();
+    gemv_load_x(ref_x, len);
+    gemv_load_w(ref_w, out_dim, len);
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done();
+    gemv_read_y(hw_y, out_dim);
+    t3 = cycle_counter_read();
+    if (check_y(len, out_dim) != 0) return -1;
+
+    uart_write_string("GEMV CLKGATE BENCH len=");
+    uart_print_dec((uint32_t)len);
+    print_field("out_dim", (uint32_t)out_dim);
+    print_field("wake", t1 - t0);
+    print_field("polls", st.last_polls);
+    print_field("gated", t3 - t2);
+
+    gemv_clear_done();
+    gemv_power_get();
+    t2 = cycle_counter_read();
+    gemv_load_x(ref_x, len);
+    gemv_load_w(ref_w, out_dim, len);
+    gemv_start(len, out_dim, 0);
+    gemv_wait_done();
+    gemv_read_y(hw_y, out_dim);
+    t3 = cycle_counter_read();
+    gemv_power_put();
+    if (check_y(len, out_dim) != 0) return -1;
+
+    print_field("held", t3 - t2);
+    uart_write_string("\r\n");
     return 0;
 }
+#endif
+
+#if GEMV_W_BANKS == 2
+/* W banks, through gemv_matvec(): B (with its bias) is prefetched while A
+ * runs from the other bank, then B and A again take no load. Times the
+ * switch to B against loading it into a bank that does not hold it. */
+static int8_t  wb_w[MAX_OUT * MAX_LEN];
+static int8_t  wb_b[MAX_OUT];
+
+/* One gemv_matvec() against w, its cycles in *t */
+static int run_wb_one(const int8_t *w, const int8_t *b, int out_dim, int len, uint32_t *t)
+{
+    uint32_t t0;
+    int i;
+    for (i = 0; i < len; i++)
+        tile_x[i] = lcg_next_int8();
+    gemv_ref(w, tile_x, out_dim, len, tile_ref);
+    for (i = 0; i < out_dim; i++)
+        tile_ref[i] += b[i];
+    t0 = cycle_counter_read();
+    gemv_matvec(w, tile_x, b, tile_hw, out_dim, len);
+    *t = cycle_counter_read() - t0;
+    return check_vec(tile_ref, tile_hw, len, out_dim);
+}
+
+static int run_w_banks(int out_dim, int len)
+{
+    uint32_t t_switch, t_reload, t;
+    int i;
+    gemv_invalidate_w();
+    for (i = 0; i < out_dim * len; i++) {
+        ref_w[i] = lcg_next_int8();
+        wb_w[i] = lcg_next_int8();
+    }
+    for (i = 0; i < out_dim; i++) {
+        tile_b[i] = lcg_next_int8();
+        wb_b[i] = lcg_next_int8();
+    }
+
+    if (run_wb_one(ref_w, tile_b, out_dim, len, &t) != 0) return -1;   /* loads A */
+    gemv_prefetch_w(wb_w, wb_b, out_dim, len);
+    if (!gemv_w_resident(ref_w, out_dim, len)) return -1;
+    if (run_wb_one(ref_w, tile_b, out_dim, len, &t) != 0) return -1;   /* B streams in */
+    if (run_wb_one(wb_w, wb_b, out_dim, len, &t_switch) != 0) return -1;
+    if (run_wb_one(ref_w, tile_b, out_dim, len, &t) != 0) return -1;   /* A kept */
+
+    gemv_invalidate_w();
+    if (run_wb_one(wb_w, wb_b, out_dim, len, &t_reload) != 0) return -1;
+    gemv_invalidate_w();
+
+    uart_write_string("GEMV WBANK BENCH len=");
+    uart_print_dec((uint32_t)len);
+    print_field("out_dim", (uint32_t)out_dim);
+    print_field("switch", t_switch);
+    print_field("reload", t_reload);
+    uart_write_string("\r\n");
+    return 0;
+}
+#endif
+
+#if GEMV_DEVICES > 1
+/* Instance handles: every instance gets its own W (len may be below the core
+ * LEN: padded by the driver), then all start on one X before any is waited
+ * for, so their runs overlap. Times the parallel pass against the same runs
+ * one after another. */
+#define DEV_OUT 32
+#define DEV_LEN 32
+static int8_t  dev_w[GEMV_DEVICES][DEV_OUT * DEV_LEN];
+static int32_t dev_ref[GEMV_DEVICES][DEV_OUT];
+static gemv_dev_t dev[GEMV_DEVICES];
+
+static int run_devices(int len, int out_dim)
+{
+    uint32_t t0, t1, t2;
+    int n = 0, k, i;
+
+    while (n < GEMV_DEVICES && gemv_dev_open(&dev[n], n))
+        n++;
+    if (n < 2) {
+        uart_write_string("FAIL devices=");
+        uart_print_dec((uint32_t)n);
+        uart_write_string("\r\n");
+        return -1;
+    }
+    for (i = 0; i < len; i++)
+        ref_x[i] = lcg_next_int8();
+    for (k = 0; k < n; k++) {
+        for (i = 0; i < out_dim * len; i++)
+            dev_w[k][i] = lcg_next_int8();
+        gemv_ref(dev_w[k], ref_x, out_dim, len, dev_ref[k]);
+        gemv_dev_clear_done(&dev[k]);
+        gemv_dev_load_w(&dev[k], dev_w[k], out_dim, len);
+    }
+
+    t0 = cycle_counter_read();
+    for (k = 0; k < n; k++) {
+        gemv_dev_load_x(&dev[k], ref_x, len);
+        gemv_dev_start(&dev[k], len, out_dim, 0);
+    }
+    for (k = 0; k < n; k++) {
+        gemv_dev_wait_done(&dev[k]);
+        gemv_dev_read_y(&dev[k], hw_y, out_dim);
+        if (check_vec(dev_ref[k], hw_y, len, out_dim) != 0) return -1;
+    }
+    t1 = cycle_counter_read();
+    for (k = 0; k < n; k++) {
+        if (!gemv_dev_w_resident(&dev[k], dev_w[k], out_dim, len)) return -1;
+        gemv_dev_clear_x(&dev[k]);
+        gemv_dev_load_x(&dev[k], ref_x, len);
+        gemv_dev_start(&dev[k], len, out_dim, 0);
+        gemv_dev_wait_done(&dev[k]);
+        gemv_dev_read_y(&dev[k], hw_y, out_dim);
+        if (check_vec(dev_ref[k], hw_y, len, out_dim) != 0) return -1;
+    }
+    t2 = cycle_counter_read();
+    gemv_invalidate_w();   /* instance 0 holds dev_w[0] now */
+
+    uart_write_string("GEMV DEV BENCH devices=");
+    uart_print_dec((uint32_t)n);
+    print_field("len", (uint32_t)len);
+    print_field("out_dim", (uint32_t)out_dim);
+    print_field("parallel", t1 - t0);
+    print_field("serial", t2 - t1);
+    uart_write_string("\r\n");
+    return 0;
+}
+#endif
 
 int test_gemv(void)
 {
@@ -102,6 +716,58 @@ int test_gemv(void)
     if (run_one(64, 32) != 0) return -1;
     if (run_one(32, 64) != 0) return -1;
     if (run_one(64, 64) != 0) return -1;
+#if GEMV_PACKED_WRITES
+    if (run_w_packed(64, 64) != 0) return -1;
+#endif
+    if (run_x_only(64, 64) != 0) return -1;
+    if (run_one(32, 32) != 0) return -1;
+    if (run_x_only(32, 32) != 0) return -1;
+    if (run_one(32, 16) != 0) return -1;      /* OUT_DIM=16 */
+#if GEMV_DOUBLE_BUFFER
+    if (run_one(32, 64) != 0) return -1;
+    if (run_tokens(32, 64) != 0) return -1;
+    if (run_x_only(32, 64) != 0) return -1;   /* plain runs still use bank 0 */
+#endif
+#if GEMV_DMA
+    if (run_one(64, 32) != 0) return -1;
+    if (run_dma(64, 32) != 0) return -1;
+#endif
+#if GEMV_MEM
+    if (run_mem(64, 32) != 0) return -1;
+#endif
+#if GEMV_ATTN
+    if (run_attn(16, 32) != 0) return -1;     /* S=16, one 32-wide head */
+    if (run_attn(32, 64) != 0) return -1;
+    if (run_attn(24, 8) != 0) return -1;      /* padded keys and channels */
+#endif
+#if GEMV_IRQ
+    if (run_irq(32, 64) != 0) return -1;
+#endif
+    if (run_tiled(6, 32, 2) != 0) return -1;    /* classifier head */
+    if (run_tiled(70, 40, 1) != 0) return -1;   /* two row tiles */
+    if (run_tiled(40, 72, 1) != 0) return -1;   /* two column tiles */
+#if GEMV_REQUANT
+    if (run_requant(64, 64, 7, 0, 0) != 0) return -1;
+    if (run_requant(32, 64, 7, 0, 1) != 0) return -1;
+    if (run_requant(64, 32, 20, -23170, 0) != 0) return -1;
+#endif
+#if GEMV_W_BANKS == 2
+    if (run_w_banks(32, 32) != 0) return -1;   /* Q/K/V/O */
+    if (run_w_banks(32, 16) != 0) return -1;   /* padded columns */
+    if (run_w_banks(64, 32) != 0) return -1;   /* FF1 */
+#endif
+#if GEMV_DEVICES > 1
+    if (run_devices(16, 32) != 0) return -1;    /* Q/K/V of d_in 16, side by side */
+    if (run_devices(32, 32) != 0) return -1;
+#endif
+    gemv_invalidate_w();
+    if (bench_gemv(32, 32) != 0) return -1;    /* Q/K/V/O */
+    if (bench_gemv(32, 64) != 0) return -1;    /* FF1 */
+    if (bench_gemv(64, 32) != 0) return -1;    /* FF2 */
+#if GEMV_CLOCK_GATE
+    if (bench_clock_gate(32, 32) != 0) return -1;
+#endif
+    gemv_invalidate_w();
     uart_write_string("GEMV self-test PASS\r\n");
     return 0;
 }
@@ -1,11 +1,17 @@
 /*
- * Exp LUT on-target self-test: golden table vs exp_lut_hw; score_to_exp mapping.
+ * Exp LUT on-target self-test: golden table vs exp_lut_hw; score_to_exp mapping;
+ * exp_lut_hw_row over a packed row (two rows back to back, with a tail);
+ * exp_lut_hw_interp over every Q3 index and past the clamp; the exp_lut_op*()
+ * intrinsics (ExpLutPlugin with USE_EXP_LUT_INSN, else their fallbacks).
  * Golden matches tinyformer.c exp_lut[16]. No printf/libc.
+ * Then prints the sustained lookup rate of exp_lut_hw(), exp_lut_hw_row(),
+ * exp_lut_op2() and the software table (cycle_counter.h).
  */
 
 #include <stdint.h>
 #include "tests_lut.h"
 #include "exp_lut.h"
+#include "cycle_counter.h"
 
 extern void uart_write_char(char c);
 
@@ -21,6 +27,20 @@ static void uart_print_hex(uint32_t v)
     for (int i = 7; i >= 0; i--) uart_write_char(hex[(v >> (i * 4)) & 0xFu]);
 }
 
+static void uart_print_dec(uint32_t v)
+{
+    char buf[10];
+    int n = 0;
+    do { buf[n++] = (char)('0' + v % 10u); v /= 10u; } while (v != 0u);
+    while (n > 0) uart_write_char(buf[--n]);
+}
+
+/* n operations in `cycles` -> operations per 1000 cycles (0 without a cycle counter) */
+static uint32_t per_kcycle(uint32_t n, uint32_t cycles)
+{
+    return cycles ? (n * 1000u) / cycles : 0u;
+}
+
 /* Same as tinyformer.c: clamp x to [-15,0], return exp_lut[-x]. */
 static uint16_t score_to_exp(int16_t x)
 {
@@ -34,6 +54,213 @@ static const uint16_t golden[16] = {
     1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12
 };
 
+/* 19 indices: two full vector words plus a 3-lane tail. */
+#define ROW_N 19
+
+static int check_row(unsigned seed)
+{
+    uint32_t idx[EXP_LUT_ROW_WORDS(ROW_N)];
+    uint16_t out[ROW_N];
+    uint32_t sum = 0, got;
+    int i;
+
+    for (i = 0; i < EXP_LUT_ROW_WORDS(ROW_N); i++) idx[i] = 0;
+    for (i = 0; i < ROW_N; i++) {
+        unsigned e = (seed + 7u * (unsigned)i) & 0xFu;
+        idx[i / 8] |= (uint32_t)e << (4 * (i % 8));
+        sum += golden[e];
+    }
+
+    got = exp_lut_hw_row(idx, out, ROW_N);
+    for (i = 0; i < ROW_N; i++) {
+        uint16_t expected = golden[(idx[i / 8] >> (4 * (i % 8))) & 0xFu];
+        if (out[i] != expected) {
+            uart_write_string("LUT FAIL row i=");
+            uart_print_hex((uint32_t)i);
+            uart_write_string(" expected=");
+            uart_print_hex((uint32_t)expected);
+            uart_write_string(" got=");
+            uart_print_hex((uint32_t)out[i]);
+            uart_write_string("\r\n");
+            return -1;
+        }
+    }
+    if (got != sum) {
+        uart_write_string("LUT FAIL row sum expected=");
+        uart_print_hex(sum);
+        uart_write_string(" got=");
+        uart_print_hex(got);
+        uart_write_string("\r\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Interpolated golden: golden[i] - ((golden[i] - golden[i+1]) * f) >> 3, clamped at 15.0 */
+static uint16_t golden_interp(unsigned q3)
+{
+    unsigned i, f;
+    if (q3 > 120u) q3 = 120u;
+    i = q3 >> 3;
+    f = q3 & 7u;
+    if (i == 15u) return golden[15];
+    return (uint16_t)(golden[i] - (((unsigned)(golden[i] - golden[i + 1]) * f) >> 3));
+}
+
+static int check_interp(void)
+{
+    unsigned q3;
+    for (q3 = 0; q3 <= 130u; q3++) {
+        uint16_t expected = golden_interp(q3);
+        uint16_t v = exp_lut_hw_interp(q3);
+        if (v != expected || ((q3 & 7u) == 0u && q3 <= 120u && v != golden[q3 >> 3])) {
+            uart_write_string("LUT FAIL interp q3=");
+            uart_print_hex((uint32_t)q3);
+            uart_write_string(" expected=");
+            uart_print_hex((uint32_t)expected);
+            uart_write_string(" got=");
+            uart_print_hex((uint32_t)v);
+            uart_write_string("\r\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_fail(const char *what, uint32_t at, uint32_t expected, uint32_t got)
+{
+    uart_write_string("LUT FAIL ");
+    uart_write_string(what);
+    uart_write_string("=");
+    uart_print_hex(at);
+    uart_write_string(" expected=");
+    uart_print_hex(expected);
+    uart_write_string(" got=");
+    uart_print_hex(got);
+    uart_write_string("\r\n");
+    return -1;
+}
+
+/* exp_lut_op past the clamp, exp_lut_op2 on every pair of a few packed words
+ * (all 16 indices in both nibbles of each byte), exp_lut_op_q3 over every Q3 index. */
+static int check_ops(void)
+{
+    static const uint32_t words[4] = { 0x76543210u, 0xFEDCBA98u, 0x0F1E2D3Cu, 0x8899AA55u };
+    uint32_t i;
+    unsigned w, p;
+
+    for (i = 0; i < 20u; i++) {
+        uint32_t expected = golden[i > 15u ? 15u : i];
+        uint32_t v = exp_lut_op(i);
+        if (v != expected) return check_fail("op idx", i, expected, v);
+    }
+    if (exp_lut_op(0xFFFFFFFFu) != golden[15])
+        return check_fail("op idx", 0xFFFFFFFFu, golden[15], exp_lut_op(0xFFFFFFFFu));
+
+    for (w = 0; w < 4u; w++) {
+        for (p = 0; p < 4u; p++) {
+            uint32_t b = (words[w] >> (8u * p)) & 0xFFu;
+            uint32_t expected = (uint32_t)golden[b & 0xFu] | ((uint32_t)golden[b >> 4] << 16);
+            uint32_t v = exp_lut_op2(words[w], p);
+            if (v != expected) return check_fail("op2 word/pair", (w << 8) | p, expected, v);
+        }
+    }
+
+    for (i = 0; i <= 130u; i++) {
+        uint32_t expected = golden_interp(i);
+        uint32_t v = exp_lut_op_q3(i);
+        if (v != expected) return check_fail("op_q3", i, expected, v);
+    }
+    return 0;
+}
+
+/* Throughput: BENCH_N indices (a fixed shuffle of 0..15), looked up one by
+ * one through exp_lut_hw(), as packed rows through exp_lut_hw_row(), two per
+ * exp_lut_op2(), and in the software table. All four sums must agree. */
+#define BENCH_N    256
+#define BENCH_REPS 4
+#define BENCH_OPS  (BENCH_N * BENCH_REPS)
+
+static uint8_t  bench_idx[BENCH_N];
+static uint32_t bench_packed[EXP_LUT_ROW_WORDS(BENCH_N)];
+static uint16_t bench_out[BENCH_N];
+
+static void print_rate(const char *name, uint32_t cycles)
+{
+    uart_write_string(" ");
+    uart_write_string(name);
+    uart_write_string("_cycles=");
+    uart_print_dec(cycles);
+    uart_write_string(" ");
+    uart_write_string(name);
+    uart_write_string("_lookups_per_kcycle=");
+    uart_print_dec(per_kcycle(BENCH_OPS, cycles));
+}
+
+static int bench_lut(void)
+{
+    uint32_t t0, t_hw, t_row, t_op2, t_sw;
+    uint32_t sum_hw = 0, sum_row = 0, sum_op2 = 0, sum_sw = 0;
+    int i, rep;
+
+    for (i = 0; i < EXP_LUT_ROW_WORDS(BENCH_N); i++) bench_packed[i] = 0;
+    for (i = 0; i < BENCH_N; i++) {
+        bench_idx[i] = (uint8_t)((5u * (unsigned)i + ((unsigned)i >> 4)) & 0xFu);
+        bench_packed[i / 8] |= (uint32_t)bench_idx[i] << (4 * (i % 8));
+    }
+
+    t0 = cycle_counter_read();
+    for (rep = 0; rep < BENCH_REPS; rep++)
+        for (i = 0; i < BENCH_N; i++)
+            sum_hw += exp_lut_hw(bench_idx[i]);
+    t_hw = cycle_counter_read() - t0;
+
+    t0 = cycle_counter_read();
+    for (rep = 0; rep < BENCH_REPS; rep++)
+        sum_row += exp_lut_hw_row(bench_packed, bench_out, BENCH_N);
+    t_row = cycle_counter_read() - t0;
+
+    t0 = cycle_counter_read();
+    for (rep = 0; rep < BENCH_REPS; rep++)
+        for (i = 0; i < EXP_LUT_ROW_WORDS(BENCH_N); i++) {
+            uint32_t v0 = exp_lut_op2(bench_packed[i], 0u);
+            uint32_t v1 = exp_lut_op2(bench_packed[i], 1u);
+            uint32_t v2 = exp_lut_op2(bench_packed[i], 2u);
+            uint32_t v3 = exp_lut_op2(bench_packed[i], 3u);
+            sum_op2 += (v0 & 0xFFFFu) + (v0 >> 16) + (v1 & 0xFFFFu) + (v1 >> 16)
+                     + (v2 & 0xFFFFu) + (v2 >> 16) + (v3 & 0xFFFFu) + (v3 >> 16);
+        }
+    t_op2 = cycle_counter_read() - t0;
+
+    t0 = cycle_counter_read();
+    for (rep = 0; rep < BENCH_REPS; rep++)
+        for (i = 0; i < BENCH_N; i++)
+            sum_sw += golden[bench_idx[i]];
+    t_sw = cycle_counter_read() - t0;
+
+    if (sum_hw != sum_sw || sum_row != sum_sw || sum_op2 != sum_sw) {
+        uart_write_string("LUT BENCH FAIL sw=");
+        uart_print_hex(sum_sw);
+        uart_write_string(" hw=");
+        uart_print_hex(sum_hw);
+        uart_write_string(" row=");
+        uart_print_hex(sum_row);
+        uart_write_string(" op2=");
+        uart_print_hex(sum_op2);
+        uart_write_string("\r\n");
+        return -1;
+    }
+
+    uart_write_string("LUT BENCH lookups=");
+    uart_print_dec(BENCH_OPS);
+    print_rate("hw", t_hw);
+    print_rate("row", t_row);
+    print_rate("op2", t_op2);
+    print_rate("sw", t_sw);
+    uart_write_string("\r\n");
+    return 0;
+}
+
 int test_lut(void)
 {
     int i;
@@ -68,6 +295,15 @@ int test_lut(void)
         }
     }
 
+    /* Second row checks that idx_first restarts the hardware sum. */
+    if (check_row(0u) != 0 || check_row(5u) != 0) return -1;
+
+    if (check_interp() != 0) return -1;
+
+    if (check_ops() != 0) return -1;
+
+    if (bench_lut() != 0) return -1;
+
     uart_write_string("LUT PASS\r\n");
     return 0;
 }
@@ -0,0 +1,129 @@
+/*
+ * Softmax unit on-target self-test: the two-pass softmax of tinyformer.c vs softmax_finish().
+ * Deterministic scores (LCG) over several lengths and ranges, both normalize modes.
+ * No printf/malloc; uses uart_write_char for output.
+ *
+ * Link with: softmax.c, and code providing uart_write_char (e.g. uart_litex.c).
+ * Define SOFTMAX_USE_LITEX_CSR or SOFTMAX_BASE as for the driver.
+ */
+
+#include <stdint.h>
+#include "tests_softmax.h"
+#include "softmax.h"
+
+extern void uart_write_char(char c);
+
+static void uart_write_string(const char *s)
+{
+    while (*s != '\0') {
+        uart_write_char(*s);
+        s++;
+    }
+}
+
+static void uart_print_hex(uint32_t value)
+{
+    const char hex[] = "0123456789ABCDEF";
+    int i;
+    uart_write_char('0');
+    uart_write_char('x');
+    for (i = 7; i >= 0; i--) {
+        uint32_t n = (value >> (i * 4)) & 0xFu;
+        uart_write_char(hex[n]);
+    }
+}
+
+/* Deterministic LCG (no libc rand) */
+static uint32_t lcg = 1u;
+static uint32_t lcg_next(void)
+{
+    lcg = lcg * 1664525u + 1013904223u;
+    return lcg;
+}
+
+/* Same table as tinyformer.c exp_lut[16] */
+static const uint16_t golden_exp[16] = {
+    1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12
+};
+
+/* Reference: steps 1-3 of attention_single_head() in tinyformer.c (scores >> 5). */
+static void softmax_ref(const int32_t *raw, uint16_t *w, int n, int fast)
+{
+    int32_t  s[SOFTMAX_MAX_N];
+    int32_t  max_score = -2147483647;
+    uint32_t sum_exp = 0;
+    int j;
+
+    for (j = 0; j < n; j++) {
+        s[j] = raw[j] >> 5;
+        if (s[j] > max_score) max_score = s[j];
+    }
+    for (j = 0; j < n; j++) {
+        int16_t x = (int16_t)((s[j] - max_score) >> 3);
+        if (x > 0) x = 0;
+        else if (x < -15) x = -15;
+        w[j] = golden_exp[-x];
+        sum_exp += w[j];
+    }
+    if (sum_exp == 0u) sum_exp = 1u;
+    if (fast) {
+        uint32_t recip = 0x80000000u / sum_exp;
+        for (j = 0; j < n; j++) w[j] = (uint16_t)(((uint32_t)w[j] * recip) >> 16);
+    } else {
+        for (j = 0; j < n; j++) w[j] = (uint16_t)(((uint32_t)w[j] << 15) / sum_exp);
+    }
+}
+
+static int32_t  scores[SOFTMAX_MAX_N];
+static uint16_t ref_w[SOFTMAX_MAX_N];
+static uint16_t hw_w[SOFTMAX_MAX_N];
+
+/* One row of n scores uniform in [-range, range), optionally all equal. */
+static int run_row(int n, int32_t range, int fast, int equal)
+{
+    int j;
+    for (j = 0; j < n; j++) {
+        scores[j] = equal ? 1234 : (int32_t)(lcg_next() % (uint32_t)(2 * range)) - range;
+    }
+    softmax_ref(scores, ref_w, n, fast);
+    softmax_config(5, fast);
+    softmax_row(scores, hw_w, n);
+
+    for (j = 0; j < n; j++) {
+        if (hw_w[j] != ref_w[j]) {
+            uart_write_string("SOFTMAX FAIL n=");
+            uart_print_hex((uint32_t)n);
+            uart_write_string(" fast=");
+            uart_print_hex((uint32_t)fast);
+            uart_write_string(" j=");
+            uart_print_hex((uint32_t)j);
+            uart_write_string(" ref=");
+            uart_print_hex((uint32_t)ref_w[j]);
+            uart_write_string(" hw=");
+            uart_print_hex((uint32_t)hw_w[j]);
+            uart_write_string("\r\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int test_softmax(void)
+{
+    static const int lens[] = { 16, 8, 7, 1, SOFTMAX_MAX_N };
+    static const int32_t ranges[] = { 1000, 20000, 1 << 20 };
+    unsigned li, ri;
+    int fast;
+
+    for (fast = 0; fast <= 1; fast++) {
+        for (li = 0; li < sizeof(lens) / sizeof(lens[0]); li++) {
+            for (ri = 0; ri < sizeof(ranges) / sizeof(ranges[0]); ri++) {
+                if (run_row(lens[li], ranges[ri], fast, 0) != 0) return -1;
+            }
+        }
+        if (run_row(16, 0, fast, 1) != 0) return -1;
+    }
+
+    uart_write_string("SOFTMAX PASS\r\n");
+    return 0;
+}
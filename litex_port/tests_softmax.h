@@ -0,0 +1,20 @@
+/*
+ * Softmax unit on-target self-test.
+ *
+ * Link with code that provides uart_write_char(char) (e.g. uart_litex.c or main stub).
+ * Returns 0 on PASS, nonzero on FAIL.
+ */
+#ifndef TESTS_SOFTMAX_H
+#define TESTS_SOFTMAX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int test_softmax(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TESTS_SOFTMAX_H */
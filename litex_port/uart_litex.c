@@ -8,7 +8,17 @@
  *   - CSR_UART_RXTX_ADDR   -> uart_txfull_read() / uart_rxtx_write()
  *   - CSR_SERIAL_RXTX_ADDR -> serial_txfull_read() / serial_rxtx_write()
  * If neither is defined, falls back to stub. Blocking poll only; no libc.
+ *
+ * UART_TX_IRQ=1 (uart_* CSRs only): TX goes through a UART_TX_RING_BYTES
+ * ring drained by uart_tx_isr() on the UART "tx" event, which fires when the
+ * TX FIFO stops being full. A character is written straight to the FIFO when
+ * the ring is empty and the FIFO has room; otherwise it is queued, so
+ * uart_write_char() only waits when the ring itself is full. The ISR is the
+ * only consumer; the writers mask mstatus.MIE around each ring update, and
+ * with the ring full (or in uart_tx_flush()) they drain it by polling, which
+ * also works with interrupts disabled.
  */
+#include "uart_litex.h"
 #include <stdint.h>
 
 #if defined(USE_LITEX_UART)
@@ -16,12 +26,133 @@
 
 #if defined(CSR_UART_RXTX_ADDR)
 /* UART exposed as uart_* (e.g. default LiteX UART) */
+#if UART_TX_IRQ
+#if !defined(UART_INTERRUPT)
+#include <generated/soc.h>
+#endif
+#ifndef UART_INTERRUPT
+#error "Define UART_INTERRUPT (UART IRQ line) for UART_TX_IRQ"
+#endif
+#if (UART_TX_RING_BYTES & (UART_TX_RING_BYTES - 1)) != 0
+#error "UART_TX_RING_BYTES must be a power of two"
+#endif
+
+#define UART_EV_TX 0x1 /* LiteX UART event bits: tx, rx */
+
+/* Mask machine interrupts (mstatus.MIE) / restore the saved mstatus */
+#ifndef UART_TX_IRQ_SAVE
+#define UART_TX_IRQ_SAVE(s) __asm__ volatile("csrrci %0, mstatus, 8" : "=r"(s))
+#define UART_TX_IRQ_RESTORE(s) __asm__ volatile("csrw mstatus, %0" ::"r"(s))
+#endif
+/* Unmask the UART line in the VexRiscv IRQ controller (CSR 0xBC0), enable MIE */
+#ifndef UART_TX_CPU_IRQ_ENABLE
+#define UART_TX_CPU_IRQ_ENABLE()                                                                   \
+  do {                                                                                             \
+    __asm__ volatile("csrs 0xBC0, %0" ::"r"(1u << UART_INTERRUPT));                                \
+    __asm__ volatile("csrsi mstatus, 8");                                                          \
+  } while (0)
+#endif
+
+static uint8_t s_tx_ring[UART_TX_RING_BYTES];
+static volatile uint32_t s_tx_head; /* bytes queued (free-running) */
+static volatile uint32_t s_tx_tail; /* bytes sent to the FIFO (free-running) */
+
+/* Move queued bytes into the TX FIFO while it has room. IRQs masked or ISR. */
+static void tx_drain(void) {
+  uint32_t tail = s_tx_tail;
+  while (tail != s_tx_head && !uart_txfull_read()) {
+    uart_rxtx_write(s_tx_ring[tail & (UART_TX_RING_BYTES - 1)]);
+    ++tail;
+  }
+  s_tx_tail = tail;
+}
+
+/* Send or queue c; returns 0, or -1 (nothing done) if the ring is full. */
+static int tx_put(char c) {
+  uint32_t head = s_tx_head;
+  if (head == s_tx_tail && !uart_txfull_read()) {
+    uart_rxtx_write((uint8_t)c);
+    return 0;
+  }
+  if (head - s_tx_tail >= (uint32_t)UART_TX_RING_BYTES) {
+    return -1;
+  }
+  s_tx_ring[head & (UART_TX_RING_BYTES - 1)] = (uint8_t)c;
+  s_tx_head = head + 1;
+  return 0;
+}
+
+void uart_tx_irq_init(void) {
+  s_tx_head = 0;
+  s_tx_tail = 0;
+  uart_ev_pending_write(UART_EV_TX);
+  uart_ev_enable_write(UART_EV_TX);
+  UART_TX_CPU_IRQ_ENABLE();
+}
+
+void uart_tx_isr(void) {
+  if (uart_ev_pending_read() & UART_EV_TX) {
+    uart_ev_pending_write(UART_EV_TX);
+    tx_drain();
+  }
+}
+
+void uart_write_char(char c) {
+  uint32_t mstatus;
+  UART_TX_IRQ_SAVE(mstatus);
+  while (tx_put(c) != 0) {
+    tx_drain();
+  }
+  UART_TX_IRQ_RESTORE(mstatus);
+}
+
+int uart_write_string_async(const char *s) {
+  uint32_t mstatus;
+  int n = 0;
+  UART_TX_IRQ_SAVE(mstatus);
+  while (s[n] != '\0' && tx_put(s[n]) == 0) {
+    ++n;
+  }
+  UART_TX_IRQ_RESTORE(mstatus);
+  return n;
+}
+
+void uart_tx_flush(void) {
+  while (s_tx_head != s_tx_tail) {
+    uint32_t mstatus;
+    UART_TX_IRQ_SAVE(mstatus);
+    tx_drain();
+    UART_TX_IRQ_RESTORE(mstatus);
+  }
+#if defined(CSR_UART_TXEMPTY_ADDR)
+  while (!uart_txempty_read())
+    ;
+#endif
+}
+#else
 void uart_write_char(char c) {
   while (uart_txfull_read())
     ;
   uart_rxtx_write((uint8_t)c);
 }
 
+int uart_write_string_async(const char *s) {
+  int n = 0;
+  while (s[n] != '\0' && !uart_txfull_read()) {
+    uart_rxtx_write((uint8_t)s[n]);
+    ++n;
+  }
+  return n;
+}
+
+void uart_tx_flush(void) {
+#if defined(CSR_UART_TXEMPTY_ADDR)
+  while (!uart_txempty_read())
+    ;
+#endif
+}
+#endif /* UART_TX_IRQ */
+
 void uart_write_string(const char *s) {
   while (*s != '\0') {
     uart_write_char(*s);
@@ -35,20 +166,43 @@ char uart_read_char(void) {
   return (char)uart_rxtx_read();
 }
 
+int uart_read_ready(void) { return !uart_rxempty_read(); }
+
 #elif defined(CSR_SERIAL_RXTX_ADDR)
 /* UART exposed as serial_* (alternative LiteX naming) */
+#if UART_TX_IRQ
+#error "UART_TX_IRQ needs the uart_* CSRs (CSR_UART_RXTX_ADDR)"
+#endif
 void uart_write_char(char c) {
   while (serial_txfull_read())
     ;
   serial_rxtx_write((uint8_t)c);
 }
 
+int uart_write_string_async(const char *s) {
+  int n = 0;
+  while (s[n] != '\0' && !serial_txfull_read()) {
+    serial_rxtx_write((uint8_t)s[n]);
+    ++n;
+  }
+  return n;
+}
+
+void uart_tx_flush(void) {
+#if defined(CSR_SERIAL_TXEMPTY_ADDR)
+  while (!serial_txempty_read())
+    ;
+#endif
+}
+
 char uart_read_char(void) {
   while (serial_rxempty_read())
     ;
   return (char)serial_rxtx_read();
 }
 
+int uart_read_ready(void) { return !serial_rxempty_read(); }
+
 void uart_write_string(const char *s) {
   while (*s != '\0') {
     uart_write_char(*s);
@@ -60,7 +214,15 @@ void uart_write_string(const char *s) {
 /* No UART/serial CSR present: stub so file still links */
 void uart_write_char(char c) { (void)c; }
 char uart_read_char(void) { return 0; }
+int uart_read_ready(void) { return 0; }
 void uart_write_string(const char *s) { (void)s; }
+int uart_write_string_async(const char *s) {
+  int n = 0;
+  while (s[n] != '\0')
+    ++n;
+  return n; /* discarded, as by uart_write_string() */
+}
+void uart_tx_flush(void) {}
 
 #endif
 
@@ -68,6 +230,14 @@ void uart_write_string(const char *s) { (void)s; }
 /* Build without USE_LITEX_UART: stub for non-LiteX builds */
 void uart_write_char(char c) { (void)c; }
 char uart_read_char(void) { return 0; }
+int uart_read_ready(void) { return 0; }
 void uart_write_string(const char *s) { (void)s; }
+int uart_write_string_async(const char *s) {
+  int n = 0;
+  while (s[n] != '\0')
+    ++n;
+  return n; /* discarded, as by uart_write_string() */
+}
+void uart_tx_flush(void) {}
 
 #endif /* USE_LITEX_UART */
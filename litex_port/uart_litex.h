@@ -7,10 +7,22 @@
  * is provided by uart_litex.c.
  *
  * Without USE_LITEX_UART, use the local stubs in main.c / demo_main.c.
+ *
+ * UART_TX_IRQ=1 also needs isr() to call uart_tx_isr() on UART_INTERRUPT
+ * (isr.c does) and uart_tx_irq_init() at start-up (demo_run() does).
  */
 #ifndef UART_LITEX_H
 #define UART_LITEX_H
 
+/* UART_TX_IRQ=1: interrupt-driven TX through a ring of UART_TX_RING_BYTES
+ * (power of two); uart_write_char() then waits only when the ring is full. */
+#ifndef UART_TX_IRQ
+#define UART_TX_IRQ 0
+#endif
+#ifndef UART_TX_RING_BYTES
+#define UART_TX_RING_BYTES 512
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,9 +33,28 @@ void uart_write_char(char c);
 /* Read a single character from the LiteX UART (blocking until RX not empty). */
 char uart_read_char(void);
 
+/* Non-blocking: 1 if uart_read_char() would return without waiting. */
+int uart_read_ready(void);
+
 /* Write a null-terminated string to the LiteX UART. */
 void uart_write_string(const char *s);
 
+/* Queue as much of s as fits without waiting (TX ring, or the TX FIFO
+ * without UART_TX_IRQ); returns the number of characters taken. */
+int uart_write_string_async(const char *s);
+
+/* Barrier: wait until everything written so far has left the TX ring and,
+ * when the SoC has a txempty CSR, the TX FIFO. */
+void uart_tx_flush(void);
+
+#if UART_TX_IRQ
+/* Reset the TX ring, enable the UART tx event and its CPU interrupt line. */
+void uart_tx_irq_init(void);
+
+/* UART interrupt handler (called from isr()): refills the TX FIFO. */
+void uart_tx_isr(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
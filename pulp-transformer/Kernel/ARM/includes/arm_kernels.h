@@ -0,0 +1,142 @@
+/* ----------------------------------------------------------------------
+#
+# File: arm_kernels.h
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+// Cortex-M backend of the MHSA kernels: same names, arguments and layouts as
+// Kernel/includes/pulp_nn_kernels.h, run on a single core. The backend
+// (Helium, DSP or plain C) is selected in arm_kernels_utils.h.
+
+#ifndef __ARM_KERNELS__
+#define __ARM_KERNELS__
+
+#include <stdint.h>
+
+// Out[row*out_row_stride + col*out_col_stride] = requant(pBias[col] + Rows[row] . Cols[col]),
+// Rows [rows][in_row_stride] and Cols [cols][dim]; pBias may be 0.
+void arm_gemm_4x2(
+  const int8_t *  pRows,
+  const int8_t *  pCols,
+  const int16_t * pBias,
+  int8_t *        pOut,
+  const int       rows,
+  const int       cols,
+  const int       dim,
+  const int       in_row_stride,
+  const int       out_row_stride,
+  const int       out_col_stride,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+// arm_gemm_4x2 with uint8 rows and no bias
+void arm_gemm_u8_4x2(
+  const uint8_t * pRows,
+  const int8_t *  pCols,
+  int8_t *        pOut,
+  const int       rows,
+  const int       cols,
+  const int       dim,
+  const int       in_row_stride,
+  const int       out_row_stride,
+  const int       out_col_stride,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) linearQK_4x2_H(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) linearV_4x2_H(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) linearO_4x2_H(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) matmul_4x2_S(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) matmulSoftmax_4x2_S(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
+void iSoftmax(
+  int8_t * pInBuffer,
+  uint8_t * pOutBuffer,
+  const int32_t rowDimension,
+  const int32_t coeffA,
+  const int32_t coeffB,
+  const int32_t coeffC,
+  const int32_t log2,
+  const uint32_t n_levels
+);
+
+#endif
@@ -0,0 +1,179 @@
+/* ----------------------------------------------------------------------
+#
+# File: arm_kernels_utils.h
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+#ifndef __ARM_KERNELS_UTILS__
+#define __ARM_KERNELS_UTILS__
+
+#include <stdint.h>
+#include <string.h>
+
+// Backend of the 4x2 blocks, from the target features: Helium (MVE-I) on
+// Armv8.1-M (Cortex-M55/M85), the DSP extension (SMLAD) on Armv7E-M and
+// Armv8-M Mainline (Cortex-M4/M7/M33), plain C otherwise. Define
+// ARM_KERNELS_NO_MVE or ARM_KERNELS_NO_DSP to 1 to benchmark a narrower path
+// on the same core.
+#ifndef ARM_KERNELS_NO_MVE
+#define ARM_KERNELS_NO_MVE 0
+#endif
+#ifndef ARM_KERNELS_NO_DSP
+#define ARM_KERNELS_NO_DSP 0
+#endif
+
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1) && !ARM_KERNELS_NO_MVE
+#define ARM_KERNELS_MVE 1
+#include <arm_mve.h>
+#elif defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1) && !ARM_KERNELS_NO_DSP
+#define ARM_KERNELS_DSP 1
+#include "cmsis_compiler.h"
+#endif
+
+static inline int8_t arm_requant(const int32_t sum, const int16_t requant_div, const int16_t requant_mul)
+{
+  int32_t x = (sum * requant_mul) >> requant_div;
+#if defined(ARM_KERNELS_DSP)
+  return (int8_t)__SSAT(x, 8);
+#else
+  return (int8_t)(x > 127 ? 127 : (x < -128 ? -128 : x));
+#endif
+}
+
+#if defined(ARM_KERNELS_DSP)
+static inline uint32_t arm_read4(const void *p)
+{
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+// Bytes 0 and 2 (even) and 1 and 3 (odd) of a word, each as two halfwords.
+// Both operands of a dot product are split the same way, so the order of the
+// products within the SMLAD pairs does not matter.
+static inline void arm_split_s8(const int8_t *p, uint32_t *even, uint32_t *odd)
+{
+  uint32_t v = arm_read4(p);
+  *even = __SXTB16(v);
+  *odd = __SXTB16(__ROR(v, 8));
+}
+
+static inline void arm_split_u8(const uint8_t *p, uint32_t *even, uint32_t *odd)
+{
+  uint32_t v = arm_read4(p);
+  *even = __UXTB16(v);
+  *odd = __UXTB16(__ROR(v, 8));
+}
+#endif
+
+// sum[r][c] += a_r . b_c over n int8 elements, for two rows a0, a1 and four
+// columns b[0..3]: each input load is used four times, each weight load twice.
+static inline void arm_dot_4x2(const int8_t *a0, const int8_t *a1, const int8_t * const b[4],
+                               const int n, int32_t sum[2][4])
+{
+  int k = 0;
+#if defined(ARM_KERNELS_MVE)
+  // Tail-predicated: the inactive lanes are loaded as 0
+  for (; k < n; k += 16)
+  {
+    mve_pred16_t p = vctp8q(n - k);
+    int8x16_t va0 = vldrbq_z_s8(a0 + k, p);
+    int8x16_t va1 = vldrbq_z_s8(a1 + k, p);
+    for (int c = 0; c < 4; c++)
+    {
+      int8x16_t vb = vldrbq_z_s8(b[c] + k, p);
+      sum[0][c] = vmladavaq_s8(sum[0][c], va0, vb);
+      sum[1][c] = vmladavaq_s8(sum[1][c], va1, vb);
+    }
+  }
+#else
+#if defined(ARM_KERNELS_DSP)
+  for (; k + 4 <= n; k += 4)
+  {
+    uint32_t a0e, a0o, a1e, a1o;
+    arm_split_s8(a0 + k, &a0e, &a0o);
+    arm_split_s8(a1 + k, &a1e, &a1o);
+    for (int c = 0; c < 4; c++)
+    {
+      uint32_t be, bo;
+      arm_split_s8(b[c] + k, &be, &bo);
+      sum[0][c] = __SMLAD(a0e, be, __SMLAD(a0o, bo, sum[0][c]));
+      sum[1][c] = __SMLAD(a1e, be, __SMLAD(a1o, bo, sum[1][c]));
+    }
+  }
+#endif
+  for (; k < n; k++)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      sum[0][c] += a0[k] * b[c][k];
+      sum[1][c] += a1[k] * b[c][k];
+    }
+  }
+#endif
+}
+
+// arm_dot_4x2 with unsigned rows, for the uint8 softmax outputs
+static inline void arm_dot_u8_4x2(const uint8_t *a0, const uint8_t *a1, const int8_t * const b[4],
+                                  const int n, int32_t sum[2][4])
+{
+  int k = 0;
+#if defined(ARM_KERNELS_MVE)
+  // uint8 x int8 does not fit a signed byte product, widen to 16 bits
+  for (; k < n; k += 8)
+  {
+    mve_pred16_t p = vctp16q(n - k);
+    int16x8_t va0 = vreinterpretq_s16_u16(vldrbq_z_u16(a0 + k, p));
+    int16x8_t va1 = vreinterpretq_s16_u16(vldrbq_z_u16(a1 + k, p));
+    for (int c = 0; c < 4; c++)
+    {
+      int16x8_t vb = vldrbq_z_s16(b[c] + k, p);
+      sum[0][c] = vmladavaq_s16(sum[0][c], va0, vb);
+      sum[1][c] = vmladavaq_s16(sum[1][c], va1, vb);
+    }
+  }
+#else
+#if defined(ARM_KERNELS_DSP)
+  for (; k + 4 <= n; k += 4)
+  {
+    uint32_t a0e, a0o, a1e, a1o;
+    arm_split_u8(a0 + k, &a0e, &a0o);
+    arm_split_u8(a1 + k, &a1e, &a1o);
+    for (int c = 0; c < 4; c++)
+    {
+      uint32_t be, bo;
+      arm_split_s8(b[c] + k, &be, &bo);
+      sum[0][c] = __SMLAD(a0e, be, __SMLAD(a0o, bo, sum[0][c]));
+      sum[1][c] = __SMLAD(a1e, be, __SMLAD(a1o, bo, sum[1][c]));
+    }
+  }
+#endif
+  for (; k < n; k++)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      sum[0][c] += a0[k] * b[c][k];
+      sum[1][c] += a1[k] * b[c][k];
+    }
+  }
+#endif
+}
+
+#endif
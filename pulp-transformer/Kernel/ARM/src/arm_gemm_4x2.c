@@ -0,0 +1,114 @@
+/* ----------------------------------------------------------------------
+#
+# File: arm_gemm_4x2.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "../inc/arm_kernels_utils.h"
+#include "../inc/arm_kernels.h"
+
+// Row/column tails reuse the last valid row or column, so a single 4x2 block
+// covers them; only the valid outputs are stored.
+static inline void arm_block_cols(const int8_t *pCols, const int col, const int cols, const int dim,
+                                  const int8_t *b[4])
+{
+  for (int c = 0; c < 4; c++)
+    b[c] = pCols + (col + c < cols ? col + c : cols - 1) * dim;
+}
+
+static inline void arm_block_store(int32_t sum[2][4], int8_t *pOut, const int row, const int rows,
+                                   const int col, const int cols, const int out_row_stride,
+                                   const int out_col_stride, const int16_t requant_div, const int16_t requant_mul)
+{
+  for (int r = 0; r < 2 && row + r < rows; r++)
+    for (int c = 0; c < 4 && col + c < cols; c++)
+      pOut[(row + r) * out_row_stride + (col + c) * out_col_stride] = arm_requant(sum[r][c], requant_div, requant_mul);
+}
+
+void arm_gemm_4x2(
+  const int8_t *  pRows,
+  const int8_t *  pCols,
+  const int16_t * pBias,
+  int8_t *        pOut,
+  const int       rows,
+  const int       cols,
+  const int       dim,
+  const int       in_row_stride,
+  const int       out_row_stride,
+  const int       out_col_stride,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  for (int row = 0; row < rows; row += 2)
+  {
+    const int8_t *a0 = pRows + row * in_row_stride;
+    const int8_t *a1 = row + 1 < rows ? a0 + in_row_stride : a0;
+
+    for (int col = 0; col < cols; col += 4)
+    {
+      const int8_t *b[4];
+      int32_t sum[2][4];
+      arm_block_cols(pCols, col, cols, dim, b);
+      for (int c = 0; c < 4; c++)
+      {
+        int32_t bias = pBias != 0 && col + c < cols ? pBias[col + c] : 0;
+        sum[0][c] = bias;
+        sum[1][c] = bias;
+      }
+
+      arm_dot_4x2(a0, a1, b, dim, sum);
+      arm_block_store(sum, pOut, row, rows, col, cols, out_row_stride, out_col_stride, requant_div, requant_mul);
+    }
+  }
+}
+
+void arm_gemm_u8_4x2(
+  const uint8_t * pRows,
+  const int8_t *  pCols,
+  int8_t *        pOut,
+  const int       rows,
+  const int       cols,
+  const int       dim,
+  const int       in_row_stride,
+  const int       out_row_stride,
+  const int       out_col_stride,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  for (int row = 0; row < rows; row += 2)
+  {
+    const uint8_t *a0 = pRows + row * in_row_stride;
+    const uint8_t *a1 = row + 1 < rows ? a0 + in_row_stride : a0;
+
+    for (int col = 0; col < cols; col += 4)
+    {
+      const int8_t *b[4];
+      int32_t sum[2][4] = {{0}};
+      arm_block_cols(pCols, col, cols, dim, b);
+
+      arm_dot_u8_4x2(a0, a1, b, dim, sum);
+      arm_block_store(sum, pOut, row, rows, col, cols, out_row_stride, out_col_stride, requant_div, requant_mul);
+    }
+  }
+}
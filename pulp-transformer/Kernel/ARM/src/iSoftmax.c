@@ -0,0 +1,115 @@
+/* ----------------------------------------------------------------------
+#
+# File: iSoftmax.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "../inc/arm_kernels_utils.h"
+#include "../inc/arm_kernels.h"
+
+// Same integer softmax as Kernel/src/iSoftmax.c: the division by log2 is a
+// multiply-shift and the normalisation a reciprocal with one correction.
+// pInBuffer and pOutBuffer may alias, each output is written after its input
+// was last read.
+typedef struct {
+  uint32_t log2_mul;
+  uint32_t log2_shift;
+} iSoftmaxDiv;
+
+static inline iSoftmaxDiv iSoftmax_div(const int32_t log2)
+{
+  iSoftmaxDiv d;
+  if ((log2 & (log2 - 1)) == 0)
+  {
+    d.log2_mul = 1;
+    d.log2_shift = 31 - __builtin_clz(log2);
+  }
+  else
+  {
+    d.log2_mul = 65536 / log2 + 1;
+    d.log2_shift = 16;
+  }
+  return d;
+}
+
+static inline int8_t iSoftmax_max(const int8_t * pInBuffer, const int32_t rowDimension)
+{
+  int8_t x_max = -128;
+#if defined(ARM_KERNELS_MVE)
+  for (int i = 0; i < rowDimension; i += 16)
+  {
+    mve_pred16_t p = vctp8q(rowDimension - i);
+    x_max = vmaxvq_p_s8(x_max, vldrbq_z_s8(pInBuffer + i, p), p);
+  }
+#else
+  for (int i = 0; i < rowDimension; i++)
+    if (pInBuffer[i] > x_max)
+      x_max = pInBuffer[i];
+#endif
+  return x_max;
+}
+
+static inline uint32_t iSoftmax_exp(const int8_t x, const int8_t x_max, const int32_t coeffA, const int32_t coeffB,
+                                    const int32_t coeffC, const int32_t log2, const iSoftmaxDiv d)
+{
+  int16_t xTilde = x - x_max;
+  int8_t z = (int8_t)(((uint32_t)(-xTilde) * d.log2_mul) >> d.log2_shift);
+  int8_t p = xTilde + z * log2;
+  if (z > 31 || z < 0)
+    return 0;
+  return (coeffA*(p+coeffB)*(p+coeffB) + coeffC)>>z;
+}
+
+static inline uint8_t iSoftmax_norm(const uint32_t y, const uint32_t levels, const uint32_t y_sum, const uint32_t rcp)
+{
+  uint32_t num = y * levels;
+  uint32_t q = (uint32_t)(((uint64_t)num * rcp) >> 32);
+  if (num - q * y_sum >= y_sum)
+    q++;
+  return (uint8_t)q;
+}
+
+void iSoftmax(
+  int8_t * pInBuffer,
+  uint8_t * pOutBuffer,
+  const int32_t rowDimension,
+  const int32_t coeffA,
+  const int32_t coeffB,
+  const int32_t coeffC,
+  const int32_t log2,
+  const uint32_t n_levels )
+{
+    iSoftmaxDiv d = iSoftmax_div(log2);
+    int8_t x_max = iSoftmax_max(pInBuffer, rowDimension);
+    uint32_t y_sum = 0;
+
+    for (int i=0; i<rowDimension; i++){
+        y_sum += iSoftmax_exp(pInBuffer[i], x_max, coeffA, coeffB, coeffC, log2, d);
+    }
+
+    uint32_t rcp = 0xFFFFFFFFu / y_sum;
+    for (int i=0; i<rowDimension; i++){
+        uint32_t y = iSoftmax_exp(pInBuffer[i], x_max, coeffA, coeffB, coeffC, log2, d);
+        pOutBuffer[i] = iSoftmax_norm(y, n_levels-1, y_sum, rcp);
+    }
+
+}
@@ -0,0 +1,48 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearO_4x2_H.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "../inc/arm_kernels_utils.h"
+#include "../inc/arm_kernels.h"
+
+// In [S][H*P], W [E][H*P], Out [S][E]
+void __attribute__ ((noinline)) linearO_4x2_H(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  int S = dim_sequence;
+  int E = dim_embedding;
+  int HP = heads * projections;
+
+  arm_gemm_4x2(pInBuffer, pWeight, pBiasBuffer, pOutBuffer, S, E, HP, HP, E, 1, requant_div, requant_mul);
+}
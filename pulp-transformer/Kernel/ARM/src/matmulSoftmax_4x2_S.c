@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------
+#
+# File: matmulSoftmax_4x2_S.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "../inc/arm_kernels_utils.h"
+#include "../inc/arm_kernels.h"
+
+// Q, K [H][S][P], uint8 Out [S][H][S]. The int8 scores of each row are
+// written to its output row and the softmax runs in place there, so no score
+// buffer is needed.
+void __attribute__ ((noinline)) matmulSoftmax_4x2_S(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+)
+{
+  int S = dim_sequence;
+  int P = projections;
+  int H = heads;
+
+  for (int h = 0; h < H; h++)
+  {
+    int8_t *pOut = pOutBuffer + h * S;
+    arm_gemm_4x2(pInBuffer + h * S * P, pWeight + h * S * P, 0, pOut, S, S, P, P, H * S, 1, requant_div, requant_mul);
+    for (int i = 0; i < S; i++)
+      iSoftmax(pOut + i * H * S, (uint8_t *)pOut + i * H * S, S, coeffA, coeffB, coeffC, log2, n_levels);
+  }
+}
@@ -0,0 +1,48 @@
+/* ----------------------------------------------------------------------
+#
+# File: matmul_4x2_S.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "../inc/arm_kernels_utils.h"
+#include "../inc/arm_kernels.h"
+
+// uint8 attention [S][H][S] times V [H][P][S], Out [S][H][P]
+void __attribute__ ((noinline)) matmul_4x2_S(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  int S = dim_sequence;
+  int P = projections;
+  int H = heads;
+
+  for (int h = 0; h < H; h++)
+    arm_gemm_u8_4x2((const uint8_t *)pInBuffer + h * S, pWeight + h * P * S, pOutBuffer + h * P,
+                    S, P, S, H * S, H * P, 1, requant_div, requant_mul);
+}
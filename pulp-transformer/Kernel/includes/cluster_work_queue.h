@@ -0,0 +1,130 @@
+/* ----------------------------------------------------------------------
+#
+# File: cluster_work_queue.h
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+// Work split of the _S, _H and FWA kernels. A kernel numbers its work in
+// blocks (a (head, row pair) of the _H and FWA kernels, a row pair over all
+// heads of the _S kernels) and computes the range [start, stop) of each call
+// of work_queue_next():
+//
+//   work_queue_t wq;
+//   work_queue_init(&wq, blocks, start_block, stop_block);
+//   while (work_queue_next(&wq, &start_block, &stop_block)) { ... }
+//
+// By default that is the kernel's static share of this core, given to
+// work_queue_init() and returned once. With CLUSTER_WORK_QUEUE=1
+// (WORK_QUEUE=1 make) the cores instead take ranges from a counter in L1
+// under the cluster critical section until the blocks run out, so a core
+// with a slow or extra block no longer holds the others at the barrier.
+// The ranges are guided: a core takes 1 / (2 * NUM_CORES) of the blocks
+// left, and at least CLUSTER_WORK_QUEUE_GRAIN, so a few large ranges come
+// first and small ones even out the end.
+//
+// Every core of the team must walk the queue to the end: the last core to
+// find it empty resets it for the next walk. The kernels and their callers
+// already end a walk with pi_cl_team_barrier, so the next walk starts on a
+// reset counter.
+
+#ifndef __CLUSTER_WORK_QUEUE__
+#define __CLUSTER_WORK_QUEUE__
+
+#include "pmsis.h"
+
+#ifndef CLUSTER_WORK_QUEUE
+#define CLUSTER_WORK_QUEUE 0
+#endif
+
+// Smallest range a core takes from the queue, in blocks
+#ifndef CLUSTER_WORK_QUEUE_GRAIN
+#define CLUSTER_WORK_QUEUE_GRAIN 1
+#endif
+
+#if CLUSTER_WORK_QUEUE_GRAIN < 1
+#error "CLUSTER_WORK_QUEUE_GRAIN must be at least 1"
+#endif
+
+typedef struct
+{
+  int blocks;       // blocks of the walk
+  int start, stop;  // static share of this core
+  int taken;        // static share returned
+} work_queue_t;
+
+#if CLUSTER_WORK_QUEUE
+typedef struct
+{
+  volatile int next;  // first block not yet taken
+  volatile int done;  // cores that found the queue empty
+} work_queue_shared_t;
+
+PI_L1 static work_queue_shared_t work_queue_shared;
+#endif
+
+static inline void work_queue_init(work_queue_t *wq, int blocks, int start, int stop) {
+  wq->blocks = blocks;
+  wq->start = start;
+  wq->stop = stop;
+  wq->taken = 0;
+}
+
+// Walk the same blocks again (a second pass of the kernel after a barrier)
+static inline void work_queue_rewind(work_queue_t *wq) {
+  wq->taken = 0;
+}
+
+// Next range [*start, *stop) of this core; 0 when it has no more work.
+static inline int work_queue_next(work_queue_t *wq, int *start, int *stop) {
+#if CLUSTER_WORK_QUEUE
+  int next, left, n;
+
+  pi_cl_team_critical_enter();
+  next = work_queue_shared.next;
+  left = wq->blocks - next;
+  if (left <= 0) {
+    if (++work_queue_shared.done == NUM_CORES) {
+      work_queue_shared.next = 0;
+      work_queue_shared.done = 0;
+    }
+    pi_cl_team_critical_exit();
+    return 0;
+  }
+  n = left / (2 * NUM_CORES);
+  n = n < CLUSTER_WORK_QUEUE_GRAIN ? CLUSTER_WORK_QUEUE_GRAIN : n;
+  n = n > left ? left : n;
+  work_queue_shared.next = next + n;
+  pi_cl_team_critical_exit();
+
+  *start = next;
+  *stop = next + n;
+  return 1;
+#else
+  if (wq->taken) {
+    return 0;
+  }
+  wq->taken = 1;
+  *start = wq->start;
+  *stop = wq->stop;
+  return 1;
+#endif
+}
+
+#endif
@@ -0,0 +1,44 @@
+/* ----------------------------------------------------------------------
+#
+# File: mhsa_dispatch.h
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+// Kernel used for each MHSA stage, selected on the shape MHSA_S, MHSA_E,
+// MHSA_P and MHSA_H defined before including this file. These are the
+// defaults; AUTOTUNE=1 ./kernelTest.sh writes Test/Results/mhsa_dispatch.h with
+// the fastest measured kernel for every tuned shape, and the tests use that
+// file instead when it exists.
+
+#ifndef __MHSA_DISPATCH__
+#define __MHSA_DISPATCH__
+
+// Defaults for shapes that were not tuned
+#ifndef MHSA_MATMUL_SOFTMAX
+#define MHSA_MATMUL_SOFTMAX matmulSoftmax_4x2_S
+#endif
+#ifndef MHSA_MATMUL
+#define MHSA_MATMUL matmul_4x2_S
+#endif
+#ifndef MHSA_FWA
+#define MHSA_FWA matmulSoftmax_FWA_v3_H
+#endif
+
+#endif
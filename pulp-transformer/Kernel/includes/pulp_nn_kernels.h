@@ -38,6 +38,63 @@ void __attribute__ ((noinline)) linearQK_4x2_H(
   const int16_t   requant_mul
 );
 
+// int4 weights packed two per byte (unpackLow4 / unpackHigh4, pulp_nn_utils.h)
+void __attribute__ ((noinline)) linearQK_4x2_H_w4(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+// 4x4 blocks on the XpulpNN NN-RF MacLoad path (XPULPNN, pulp_nn_macload.h),
+// split over (head, row quad) blocks; same arguments and layouts as the 4x2
+// kernels.
+void __attribute__ ((noinline)) linearQK_4x4_H_macload(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) matmulSoftmax_4x4_H_macload(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
+void __attribute__ ((noinline)) matmul_4x4_H_macload(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
 void __attribute__ ((noinline)) linearO_4x2_H(
   const int8_t *  pInBuffer,
   const int8_t *  pWeight,
@@ -51,6 +108,52 @@ void __attribute__ ((noinline)) linearO_4x2_H(
   const int16_t   requant_mul
 );
 
+void __attribute__ ((noinline)) linearO_4x2_H_w4(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) linearO_4x2_H_LN(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  int32_t *       pNormWeight,
+  const int32_t   norm_log2D,
+  const int8_t *  pResidual
+);
+
+void __attribute__ ((noinline)) linearO_4x2_H_GELU(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   gelu_b,
+  const int32_t   gelu_one,
+  const int32_t   gelu_totScaler,
+  const int32_t   gelu_log2D
+);
+
 void __attribute__ ((noinline)) linearV_4x2_H(
   const int8_t *  pInBuffer,
   const int8_t *  pWeight,
@@ -64,6 +167,32 @@ void __attribute__ ((noinline)) linearV_4x2_H(
   const int16_t   requant_mul
 );
 
+void __attribute__ ((noinline)) linearV_4x2_H_w4(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) linearQKV_4x2_H(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
 void __attribute__ ((noinline)) matmul_4x2_S(
   const int8_t *  pInBuffer,
   const int8_t *  pWeight,
@@ -107,6 +236,36 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_H(
   const uint32_t  n_levels
 );
 
+void __attribute__ ((noinline)) matmulSoftmax_4x2_H_causal(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,  
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
+// L1 scratch of linearAttention_H in bytes: KV ([H][P][P]) and z ([H][P]), int32
+#define LINEAR_ATTENTION_L1_SIZE(P, H) (4*(H)*(P)*((P) + 1))
+
+void __attribute__ ((noinline)) linearAttention_H(
+  const int8_t *  pQ,
+  const int8_t *  pK,
+  const int8_t *  pV,
+  int8_t *        pOutBuffer,
+  int32_t *       pBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads
+);
+
 void __attribute__ ((noinline)) matmulSoftmax_FWA_v1(
   const int8_t *  pInBuffer,
   const int8_t *  pWeight,
@@ -183,6 +342,226 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H(
   const uint32_t  n_levels
 );
 
+void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H_causal(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t *  pBias,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  heads,
+  const int16_t   pre_proj_requant_div,
+  const int16_t   pre_proj_requant_mul,
+  const int16_t   post_proj_requant_div,
+  const int16_t   post_proj_requant_mul,  
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
+// L1 scratch of encoderLayer_FWA in bytes: V, A, the FWA intermediate / A
+// transposed and the attention context, reused by the FFN stages.
+#define ENCODER_LAYER_FWA_SCRATCH(S, E, P, H, F) \
+  (((H)*(P)*(S) + (H)*(S)*(S) + (H)*(S)*((E) > (S) ? (E) : (S)) + (S)*(H)*(P)) > ((S)*(E) + (S)*(F)) ? \
+   ((H)*(P)*(S) + (H)*(S)*(S) + (H)*(S)*((E) > (S) ? (E) : (S)) + (S)*(H)*(P)) : ((S)*(E) + (S)*(F)))
+
+void __attribute__ ((noinline)) encoderLayer_FWA(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeightV,
+  const int16_t * pBiasV,
+  const int8_t *  pWeightFWA,
+  const int16_t * pBiasFWA,
+  const int8_t *  pWeightO,
+  const int16_t * pBiasO,
+  int32_t *       pNormWeight1,
+  const int8_t *  pWeightFF1,
+  const int16_t * pBiasFF1,
+  const int8_t *  pWeightFF2,
+  const int16_t * pBiasFF2,
+  int32_t *       pNormWeight2,
+  int8_t *        pOutBuffer,
+  int8_t *        pScratch,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const uint16_t  dim_ffn,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   norm_log2D,
+  const int32_t   gelu_b,
+  const int32_t   gelu_one,
+  const int32_t   gelu_totScaler,
+  const int32_t   gelu_log2D
+);
+
+// L1 scratch of tinyformer_encode_pulp in bytes: Q, K, V, the scores and the
+// attention context, reused by the FFN hidden.
+#define TINYFORMER_PULP_SCRATCH(S, D, F) \
+  ((4*(S)*(D) + (S)*(S)) > ((S)*(D) + (S)*(F)) ? (4*(S)*(D) + (S)*(S)) : ((S)*(D) + (S)*(F)))
+
+void __attribute__ ((noinline)) tinyformer_encode_pulp(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeightQ,
+  const int16_t * pBiasQ,
+  const int8_t *  pWeightK,
+  const int16_t * pBiasK,
+  const int8_t *  pWeightV,
+  const int16_t * pBiasV,
+  const int8_t *  pWeightO,
+  const int16_t * pBiasO,
+  const int8_t *  pWeightFF1,
+  const int16_t * pBiasFF1,
+  const int8_t *  pWeightFF2,
+  const int16_t * pBiasFF2,
+  int8_t *        pOutBuffer,
+  int8_t *        pScratch,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  dim_ffn,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int16_t   score_div,
+  const int16_t   score_mul,
+  const int16_t   context_div,
+  const int16_t   context_mul
+);
+
+// L1 buffer of mhsaTiled_H in bytes: two Q, K, V tiles, the scores of one
+// head and two output tiles, each 4-byte aligned.
+#define MHSA_TILED_L1_SIZE(S, P) \
+  (8*((((S)*(P)) + 3) & ~3) + ((((S)*(S)) + 3) & ~3))
+
+// mhsaTiled_H_T adds the commands of its two transposing V loads (thorir_dma.h)
+#define MHSA_TILED_T_L1_SIZE(S, P) \
+  (MHSA_TILED_L1_SIZE(S, P) + 2*(P)*sizeof(thorir_dma_cmd_t))
+
+void __attribute__ ((noinline)) mhsaTiled_H(
+  const int8_t *  pQ,
+  const int8_t *  pK,
+  const int8_t *  pV,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
+// V as [H][S][P], transposed by the DMA into its L1 tiles
+void __attribute__ ((noinline)) mhsaTiled_H_T(
+  const int8_t *  pQ,
+  const int8_t *  pK,
+  const int8_t *  pV,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
+// Double-buffered L2/L1 wrappers (the *_tiled kernels): data in L2, tiles of
+// the given size in L1. Each L1_SIZE macro is the resident part plus one tile
+// buffer, or two when there is more than one tile; Test/tilingSolver.py picks
+// the tile sizes for an L1 budget.
+#define TILED_ALIGN4(x) (((x) + 3) & ~3)
+#define TILED_BUFFERS(N, T) (((N) + (T) - 1) / (T) > 1 ? 2 : 1)
+
+#define LINEAR_QK_TILED_L1_SIZE(S, E, P, H, TH) \
+  (TILED_ALIGN4((S)*(E)) + TILED_BUFFERS(H, TH) * \
+   (TILED_ALIGN4((TH)*(P)*(E)) + TILED_ALIGN4(2*(TH)*(P)) + TILED_ALIGN4((TH)*(S)*(P))))
+
+#define FWA_TILED_L1_SIZE(S, E, H, TH) \
+  (TILED_ALIGN4((S)*(E)) + TILED_BUFFERS(H, TH) * \
+   (TILED_ALIGN4((TH)*(E)*(E)) + TILED_ALIGN4(2*(TH)*(E)) + TILED_ALIGN4((TH)*(S)*((S)+(E)))))
+
+#define MATMUL_TILED_L1_SIZE(S, P, H, TH) \
+  (TILED_BUFFERS(H, TH) * \
+   (TILED_ALIGN4((S)*(TH)*(S)) + TILED_ALIGN4((TH)*(P)*(S)) + TILED_ALIGN4((S)*(TH)*(P))))
+
+#define LINEAR_O_TILED_L1_SIZE(S, E, P, H, TS) \
+  (TILED_ALIGN4((E)*(H)*(P)) + TILED_ALIGN4(2*(E)) + TILED_BUFFERS(S, TS) * \
+   (TILED_ALIGN4((TS)*(H)*(P)) + TILED_ALIGN4((TS)*(E))))
+
+void __attribute__ ((noinline)) linearQK_4x2_H_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dimSequence,
+  const uint16_t  dimEmbedding,
+  const uint16_t  dimProjections,
+  const uint16_t  heads,
+  const uint16_t  tile_heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBias,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  heads,
+  const uint16_t  tile_heads,
+  const int16_t   pre_proj_requant_div,
+  const int16_t   pre_proj_requant_mul,
+  const int16_t   post_proj_requant_div,
+  const int16_t   post_proj_requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
+void __attribute__ ((noinline)) matmul_4x2_S_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const uint16_t  tile_heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
+void __attribute__ ((noinline)) linearO_4x2_H_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const uint16_t  tile_seq,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+);
+
 void iSoftmax(
   int8_t *        pInBuffer,
   uint8_t *       pOutBuffer,
@@ -194,6 +573,18 @@ void iSoftmax(
   const uint32_t  n_levels
 );
 
+void iSoftmax_scratch(
+  int8_t *        pInBuffer,
+  uint8_t *       pOutBuffer,
+  uint32_t *      pScratch,
+  const int32_t   rowDimension,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+);
+
 void bnEmbedding (
     int8_t * Im_in, 
     int8_t * Im_out,            
@@ -223,6 +614,38 @@ void pulp_nn_linear_i8_i8_i8(
                         uint8_t flag_relu,
                         uint8_t flag_batch_norm);
 
+void pulp_nn_linear_i8_i8_i4(
+                        int8_t *pIn,
+                        int16_t *pBias,
+                        int8_t *pOut,
+                        int8_t *pWeight,
+                        int32_t *pKappa,
+                        int32_t *pLambda,
+                        uint16_t out_mult,
+                        uint16_t out_shift,
+                        uint16_t dim_vec,
+                        uint16_t num_o_neurons,
+                        uint8_t flag_relu,
+                        uint8_t flag_batch_norm);
+
+void pulp_nn_linear_gelu_i8_i8_i8(
+                        int8_t *pIn,
+                        int16_t *pBias,
+                        int8_t *pOut,
+                        int8_t *pWeight,
+                        int32_t *pKappa,
+                        int32_t *pLambda,
+                        uint16_t out_mult,
+                        uint16_t out_shift,
+                        uint16_t dim_vec,
+                        uint16_t num_o_neurons,
+                        uint8_t flag_relu,
+                        uint8_t flag_batch_norm,
+                        int32_t gelu_b,
+                        int32_t gelu_one,
+                        int32_t gelu_totScaler,
+                        int32_t gelu_log2D);
+
 void pulp_nn_linear_u8_i8_i8(
                         uint8_t *pIn,
                         int8_t *pBias,
@@ -0,0 +1,230 @@
+/* ----------------------------------------------------------------------
+#
+# File: pulp_nn_macload.h
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+// 4x4 dot-product blocks of the *_4x4_H_macload kernels: sum[4*i + j] is row
+// i of A times row j of W over len int8 elements, A rows strideA bytes apart
+// and W rows strideW bytes apart. A is uint8 when unsigned_a is set (softmax
+// output), int8 otherwise; W is always int8.
+//
+// With XPULPNN (XPULPNN=1 make) the 4x4 block runs on the NN register file:
+// the four W words and the current A words live in NN-RF, and each MacLoad
+// does one sum-of-dot-products while the address generators fetch the next
+// operand, so the 16 accumulators are the only general registers the loop
+// needs. Without it the same blocks use plain sdotp and explicit loads.
+
+#ifndef __PULP_NN_MACLOAD__
+#define __PULP_NN_MACLOAD__
+
+#include "pulp_nn_utils.h"
+
+#define PULP_NN_MACLOAD(a_update, b_update, a_reg, b_reg, ptr, sum) \
+  (unsigned_a ? MacLoad4(a_update, b_update, a_reg, b_reg, ptr, sum) : MacLoads4(a_update, b_update, a_reg, b_reg, ptr, sum))
+#define PULP_NN_DOTP(a, b, sum) \
+  (unsigned_a ? SumDotp4((v4u)(a), (v4s)(b), sum) : SumDotps4((v4s)(a), (v4s)(b), sum))
+#define PULP_NN_ELEM(p, k) (unsigned_a ? (int32_t)((const uint8_t *)(p))[k] : (int32_t)(p)[k])
+
+// Address generator setup, once per kernel and core: each generator walks the
+// four rows of its operand one word column at a time, three strides down and
+// then back to the next word of the first row.
+static inline __attribute__((always_inline)) void pulp_nn_macload_config(
+  const int32_t strideA,
+  const int32_t strideW
+)
+{
+#ifdef XPULPNN
+  A_STRIDE(strideA);
+  W_STRIDE(strideW);
+  A_ROLLBACK(4 - 3 * strideA);
+  W_ROLLBACK(4 - 3 * strideW);
+  A_SKIP("3");
+  W_SKIP("3");
+#endif
+}
+
+static inline __attribute__((always_inline)) void pulp_nn_dot_4x4(
+  const int8_t *  pA,
+  const int32_t   strideA,
+  const int8_t *  pW,
+  const int32_t   strideW,
+  const int32_t   len,
+  const int       unsigned_a,
+  int32_t *       sum
+)
+{
+  int32_t sum1 = 0, sum2 = 0, sum3 = 0, sum4 = 0;
+  int32_t sum5 = 0, sum6 = 0, sum7 = 0, sum8 = 0;
+  int32_t sum9 = 0, sum10 = 0, sum11 = 0, sum12 = 0;
+  int32_t sum13 = 0, sum14 = 0, sum15 = 0, sum16 = 0;
+  int words = len >> 2;
+  int k, i, j;
+
+#ifdef XPULPNN
+  // The generators fetch whole words: word-aligned rows only
+  if (!((strideA | strideW | (int32_t)pA | (int32_t)pW) & 3))
+  {
+    int32_t *ptrW = (int32_t *) pW;
+    uint32_t *ptrA = (uint32_t *) pA;
+
+    A_ADDRESS(ptrA);
+    W_ADDRESS(ptrW);
+
+    // NN-RF W0..W3 <- first word of the four W rows, A0 <- first word of A row 0
+    ptrW = MacLoadInit(1, 0, 0, 0, ptrW);
+    ptrW = MacLoadInit(1, 0, 1, 0, ptrW);
+    ptrW = MacLoadInit(1, 0, 2, 0, ptrW);
+    ptrW = MacLoadInit(1, 0, 3, 0, ptrW);
+    ptrA = MacLoadInit(0, 1, 0, 0, ptrA);
+
+    // A rows alternate between A0 and A1, each refilled by its last MAC; the
+    // last four MACs refill W0..W3 with the next word column
+    for (k = 0; k < words; k++)
+    {
+      ptrA = MacLoadInit(0, 1, 0, 1, ptrA);
+
+      sum1 = PULP_NN_MACLOAD(0, 0, 0, 0, ptrW, sum1);
+      sum2 = PULP_NN_MACLOAD(0, 0, 1, 0, ptrW, sum2);
+      sum3 = PULP_NN_MACLOAD(0, 0, 2, 0, ptrW, sum3);
+      sum4 = PULP_NN_MACLOAD(0, 1, 3, 0, ptrA, sum4);
+      ptrA = MacLoadUpdate(ptrA);
+
+      sum5 = PULP_NN_MACLOAD(0, 0, 0, 1, ptrW, sum5);
+      sum6 = PULP_NN_MACLOAD(0, 0, 1, 1, ptrW, sum6);
+      sum7 = PULP_NN_MACLOAD(0, 0, 2, 1, ptrW, sum7);
+      sum8 = PULP_NN_MACLOAD(0, 1, 3, 1, ptrA, sum8);
+      ptrA = MacLoadUpdate(ptrA);
+
+      sum9 = PULP_NN_MACLOAD(0, 0, 0, 0, ptrW, sum9);
+      sum10 = PULP_NN_MACLOAD(0, 0, 1, 0, ptrW, sum10);
+      sum11 = PULP_NN_MACLOAD(0, 0, 2, 0, ptrW, sum11);
+      sum12 = PULP_NN_MACLOAD(0, 1, 3, 0, ptrA, sum12);
+      ptrA = MacLoadUpdate(ptrA);
+
+      sum13 = PULP_NN_MACLOAD(1, 0, 0, 1, ptrW, sum13);
+      ptrW = MacLoadUpdate(ptrW);
+      sum14 = PULP_NN_MACLOAD(1, 0, 1, 1, ptrW, sum14);
+      ptrW = MacLoadUpdate(ptrW);
+      sum15 = PULP_NN_MACLOAD(1, 0, 2, 1, ptrW, sum15);
+      ptrW = MacLoadUpdate(ptrW);
+      sum16 = PULP_NN_MACLOAD(1, 0, 3, 1, ptrW, sum16);
+      ptrW = MacLoadUpdate(ptrW);
+    }
+  }
+  else
+#endif
+  {
+    const int8_t *pA1 = pA, *pA2 = pA + strideA, *pA3 = pA2 + strideA, *pA4 = pA3 + strideA;
+    const int8_t *pW1 = pW, *pW2 = pW + strideW, *pW3 = pW2 + strideW, *pW4 = pW3 + strideW;
+    v4s vecA, vecA2, vecA3, vecA4;
+    v4s vecW, vecW2, vecW3, vecW4;
+
+    for (k = 0; k < words; k++)
+    {
+      vecA = *((v4s*)pA1);
+      vecA2 = *((v4s*)pA2);
+      vecA3 = *((v4s*)pA3);
+      vecA4 = *((v4s*)pA4);
+      vecW = *((v4s*)pW1);
+      vecW2 = *((v4s*)pW2);
+      vecW3 = *((v4s*)pW3);
+      vecW4 = *((v4s*)pW4);
+
+      sum1 = PULP_NN_DOTP(vecA, vecW, sum1);
+      sum2 = PULP_NN_DOTP(vecA, vecW2, sum2);
+      sum3 = PULP_NN_DOTP(vecA, vecW3, sum3);
+      sum4 = PULP_NN_DOTP(vecA, vecW4, sum4);
+      sum5 = PULP_NN_DOTP(vecA2, vecW, sum5);
+      sum6 = PULP_NN_DOTP(vecA2, vecW2, sum6);
+      sum7 = PULP_NN_DOTP(vecA2, vecW3, sum7);
+      sum8 = PULP_NN_DOTP(vecA2, vecW4, sum8);
+      sum9 = PULP_NN_DOTP(vecA3, vecW, sum9);
+      sum10 = PULP_NN_DOTP(vecA3, vecW2, sum10);
+      sum11 = PULP_NN_DOTP(vecA3, vecW3, sum11);
+      sum12 = PULP_NN_DOTP(vecA3, vecW4, sum12);
+      sum13 = PULP_NN_DOTP(vecA4, vecW, sum13);
+      sum14 = PULP_NN_DOTP(vecA4, vecW2, sum14);
+      sum15 = PULP_NN_DOTP(vecA4, vecW3, sum15);
+      sum16 = PULP_NN_DOTP(vecA4, vecW4, sum16);
+
+      pA1+=4;
+      pA2+=4;
+      pA3+=4;
+      pA4+=4;
+      pW1+=4;
+      pW2+=4;
+      pW3+=4;
+      pW4+=4;
+    }
+  }
+
+  sum[0] = sum1; sum[1] = sum2; sum[2] = sum3; sum[3] = sum4;
+  sum[4] = sum5; sum[5] = sum6; sum[6] = sum7; sum[7] = sum8;
+  sum[8] = sum9; sum[9] = sum10; sum[10] = sum11; sum[11] = sum12;
+  sum[12] = sum13; sum[13] = sum14; sum[14] = sum15; sum[15] = sum16;
+
+  // len % 4 leftover elements
+  for (k = words << 2; k < len; k++)
+    for (i = 0; i < 4; i++)
+      for (j = 0; j < 4; j++)
+        sum[4*i + j] += PULP_NN_ELEM(pA + i * strideA, k) * pW[j * strideW + k];
+}
+
+// Edge blocks (rowsA or rowsW below 4): one dot product at a time, into the
+// same sum[4*i + j] slots as pulp_nn_dot_4x4
+static inline __attribute__((always_inline)) void pulp_nn_dot_rows(
+  const int8_t *  pA,
+  const int32_t   strideA,
+  const int       rowsA,
+  const int8_t *  pW,
+  const int32_t   strideW,
+  const int       rowsW,
+  const int32_t   len,
+  const int       unsigned_a,
+  int32_t *       sum
+)
+{
+  int words = len >> 2;
+  int i, j, k;
+
+  for (i = 0; i < rowsA; i++)
+  {
+    for (j = 0; j < rowsW; j++)
+    {
+      const int8_t *pA1 = pA + i * strideA;
+      const int8_t *pW1 = pW + j * strideW;
+      int32_t acc = 0;
+
+      for (k = 0; k < words; k++)
+      {
+        acc = PULP_NN_DOTP(*((v4s*)pA1), *((v4s*)pW1), acc);
+        pA1+=4;
+        pW1+=4;
+      }
+      for (k = words << 2; k < len; k++)
+        acc += PULP_NN_ELEM(pA + i * strideA, k) * pW[j * strideW + k];
+
+      sum[4*i + j] = acc;
+    }
+  }
+}
+
+#endif
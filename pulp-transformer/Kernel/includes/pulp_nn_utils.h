@@ -79,6 +79,13 @@
 #define PACK_INT4_SIZE(x)                                    ((x) >> 1)
 #define PACK_INT2_SIZE(x)                                    ((x) >> 2)
 
+// Packed int4 weights of the *_w4 / i8_i8_i4 kernels: each word holds 8
+// consecutive elements, byte k with element k in its low and element k + 4 in
+// its high nibble, so one shift pair per word gives the int8 vectors for
+// elements 0..3 and 4..7 (with sign extension) for SumDotps4
+#define unpackLow4(w)                                        (((v4s)(w) << 4) >> 4)
+#define unpackHigh4(w)                                       ((v4s)(w) >> 4)
+
 #define MemoryFence()                                        asm volatile("":::"memory")
 
 #define LEGACY_MODE(x)                                       asm volatile ("csrwi 0x010," x)
@@ -1949,4 +1956,98 @@ static void __attribute__((noinline)) xpulp_nn_avg_and_replace_u2(uint8_t * base
 }
 
 
+// i-GELU of one int8 value (I-BERT second-order erf), as pulp_nn_gelu_i8_i8;
+// shared with the kernels that apply it as an epilogue.
+static int8_t __attribute__((always_inline)) pulp_nn_i_gelu_i8(
+  int8_t in,
+  int32_t b,
+  int32_t one,
+  int32_t totScaler,
+  int32_t log2D
+  ) {
+  int16_t sign, x, x_abs, q;
+  int8_t d;
+  int32_t L, y;
+
+  x = in;
+  sign = (x > 0) - (x < 0);
+  x_abs = sign*x;
+  if (x_abs > -b) {
+    q = -b;
+  } else {
+    q = x_abs;
+  }
+  d = q + b;
+  L = sign * (-(d*d) + one);
+  y = ((x * (one + L))>>1);
+  return (int8_t) clips8((int32_t)(y*totScaler) >> log2D);
+}
+
+// floor(sqrt(number)), one result bit per iteration (shift / add only):
+// 9 iterations for the variance of an int8 row (< 2^17).
+static uint32_t __attribute__((always_inline)) pulp_nn_isqrt_u32(uint32_t number)
+{
+  uint32_t root = 0;
+  uint32_t bit;
+
+  if (number == 0) {
+    return 0;
+  }
+  bit = 1u << (log2(number) & ~1);
+
+  while (bit != 0) {
+    if (number >= root + bit) {
+      number -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// 1 if every layerNorm weight and bias ([2*n], weights then biases) is
+// within +-2^22, so (x - mean) * weight + bias fits 32 bits for int8 x.
+static int __attribute__((always_inline)) pulp_nn_layernorm_narrow(
+  int32_t *weight,
+  int32_t n
+  ) {
+  int narrow = 1;
+  for (int j = 0; j < 2*n; j++) {
+    if (weight[j] >= (1 << 22) || weight[j] <= -(1 << 22)) {
+      narrow = 0;
+    }
+  }
+  return narrow;
+}
+
+// Normalizes one row of n int8 values from its sum and sum of squares
+// (pIn may equal pOut): mean and variance truncate as in an integer
+// two-pass layerNorm, with sum((x - mean)^2) = sumSq - 2*mean*sum + n*mean^2.
+static void __attribute__((always_inline)) pulp_nn_layernorm_row_i8(
+  int8_t *pIn,
+  int8_t *pOut,
+  int32_t *weight,
+  int32_t n,
+  int32_t log2D,
+  int32_t sum,
+  int32_t sumSq,
+  int narrow
+  ) {
+  int32_t mean = sum / n;
+  int32_t var = (sumSq - 2*mean*sum + n*mean*mean) / n + 1;
+  int32_t std = pulp_nn_isqrt_u32((uint32_t)var);
+
+  if (narrow) {
+    for (int j = 0; j < n; j++) {
+      pOut[j] = ((((int32_t)pIn[j] - mean) * weight[j]) / std + weight[n + j]) >> log2D;
+    }
+  } else {
+    for (int j = 0; j < n; j++) {
+      pOut[j] = (((((int64_t)pIn[j]) - mean) * weight[j]) / std + weight[n + j]) >> log2D;
+    }
+  }
+}
+
 #endif
@@ -39,57 +39,22 @@ void __attribute__ ((noinline))  pulp_nn_bnembedding__i8_i8 (
     uint16_t  ch_im_in           // number of channels of the IFM
 )
 {
-    // int core_id = pi_core_id();
-    // int n_cores = NUM_CORES;
-    // if (dim_im_in_h < NUM_CORES)
-    // {
-    //   n_cores = dim_im_in_h;
-    // }
-    // int  Log2Core = log2(n_cores);
-    // uint8_t extra_chunk = ((dim_im_in_w & (NUM_CORES-1)) != 0);
-    // uint8_t extra_chunk_r;
-    // uint16_t dim_out_x_r;
-    // uint8_t section;
-    // int core_id_r;
-
-    // if(extra_chunk && dim_im_in_w > 1)
-    // {
-    //   Log2Core = log2(NUM_CORES >> 1);
-    //   core_id_r = (core_id >> 1);
-    //   dim_out_x_r = (dim_im_in_w >> 1);
-    //   section = (core_id & 0x1);
-    //   extra_chunk_r = ((dim_im_in_h & ((NUM_CORES >> 1) - 1)) != 0);
-    // }
-    // else
-    // {
-    //   Log2Core = log2(NUM_CORES);
-    //   core_id_r = core_id;
-    //   dim_out_x_r = dim_im_in_w;
-    //   section = 0;
-    //   extra_chunk_r = extra_chunk;
-    //   extra_chunk = 0;
-    // }
-    // int chunk = (dim_im_in_h >> Log2Core) + extra_chunk_r;
-
+    // Rows (dim_im_in_h x dim_im_in_w positions of ch_im_in channels) are
+    // split over the cores, so an [1][S][E] token map is parallel too.
     int core_id = pi_core_id();
-    int n_cores = NUM_CORES;
-
-    if (dim_im_in_h < NUM_CORES)
-    {
-      n_cores = dim_im_in_h;
-    }
+    int Log2Core = log2(NUM_CORES);
 
-    int Log2Core = log2(n_cores);
-    int chunk = (dim_im_in_h >> Log2Core) + ((dim_im_in_h & (NUM_CORES-1))!=0);
+    int rows = dim_im_in_h * dim_im_in_w;
+    int chunk = (rows >> Log2Core) + ((rows & (NUM_CORES-1))!=0);
 
-    int start = min(chunk * core_id, dim_im_in_h);
-    int stop = min(start + chunk, dim_im_in_h);
+    int start = min(chunk * core_id, rows);
+    int stop = min(start + chunk, rows);
 
-    int8_t *pOutBuffer = Im_out + (start * ch_im_in * dim_im_in_w);
-    int8_t *target =  Im_in + (start * ch_im_in * dim_im_in_w);
-    int16_t *wei = emb + (start * ch_im_in * dim_im_in_w);
+    int8_t *pOutBuffer = Im_out + (start * ch_im_in);
+    int8_t *target =  Im_in + (start * ch_im_in);
+    int16_t *wei = emb + (start * ch_im_in);
 
-    for (int spatial = 0; spatial<dim_im_in_w*ch_im_in*(stop-start); spatial++)
+    for (int spatial = 0; spatial<ch_im_in*(stop-start); spatial++)
     {
        int8_t intermediate =  pulp_nn_requantshift_i8_i8((int32_t)*target, mul1, add1, div1);
        int32_t embedded = (int32_t)intermediate + *wei;
@@ -0,0 +1,144 @@
+/* ----------------------------------------------------------------------
+#
+# File: encoderLayer_FWA.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+
+// One post-norm transformer encoder layer on the cluster, with the fused-weight
+// attention of matmulSoftmax_FWA_v3_H:
+//
+//   X1  = LN1(X + (softmax(X Wfwa_h X^T) (X Wv_h^T)) Wo^T)
+//   Out = LN2(X1 + GELU(X1 W1^T) W2^T)
+//
+// X and Out are [S][E] int8, Wv [H*P][E], Wfwa [H][E][E], Wo [E][H*P],
+// W1 [F][E] and W2 [E][F], with int16 biases and the [gamma; beta] int32 norm
+// weights of pulp_nn_layernorm_i8_i8. Every GEMM shares requant_div and
+// requant_mul, as in the MHSA tests.
+//
+// pScratch is ENCODER_LAYER_FWA_SCRATCH(S, E, P, H, F) bytes of L1, planned as
+//
+//   attention: | V [H][P][S] | A [H][S][S] | FWA intermediate / A^T | Ctx [S][H*P] |
+//   FFN:       | X1 [S][E] | G [S][F] |
+//
+// X1 and G overwrite V, A and the intermediate once the context is computed.
+// Each stage ends with one barrier; the shapes must satisfy the kernels
+// chained here (S, E, P and F multiples of 4, S/2 rows split evenly).
+void __attribute__ ((noinline)) encoderLayer_FWA(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeightV,
+  const int16_t * pBiasV,
+  const int8_t *  pWeightFWA,
+  const int16_t * pBiasFWA,
+  const int8_t *  pWeightO,
+  const int16_t * pBiasO,
+  int32_t *       pNormWeight1,
+  const int8_t *  pWeightFF1,
+  const int16_t * pBiasFF1,
+  const int8_t *  pWeightFF2,
+  const int16_t * pBiasFF2,
+  int32_t *       pNormWeight2,
+  int8_t *        pOutBuffer,
+  int8_t *        pScratch,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const uint16_t  dim_ffn,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   norm_log2D,
+  const int32_t   gelu_b,
+  const int32_t   gelu_one,
+  const int32_t   gelu_totScaler,
+  const int32_t   gelu_log2D
+)
+{
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  int S = dim_sequence;
+  int E = dim_embedding;
+  int HP = heads * projections;
+
+  // Scratch plan, see above
+  int8_t *pV = pScratch;
+  int8_t *pA = pV + HP * S;
+  int8_t *pAt = pA + heads * S * S;  // FWA_v3_H puts its intermediate right after A
+  int8_t *pCtx = pAt + heads * S * (E > S ? E : S);
+  int8_t *pX1 = pScratch;
+  int8_t *pG = pX1 + S * E;
+
+  // 1. V projection, [H][P][S]
+  linearV_4x2_H(pInBuffer, pWeightV, pBiasV, pV, S, E, projections, heads, requant_div, requant_mul);
+  pi_cl_team_barrier(0);
+
+  // 2. Fused-weight attention scores and iSoftmax, [H][S][S] (coefficients as the MHSA tests)
+  matmulSoftmax_FWA_v3_H(pInBuffer, pWeightFWA, pBiasFWA, pA, S, E, heads, requant_div, requant_mul, requant_div, requant_mul, 1, 7, 24, 5, 256);
+  pi_cl_team_barrier(0);
+
+  // 3. Head-interleave the scores for matmul_4x2_S, [H][S][S] -> [S][H][S]
+  int rows = heads * S;
+  int rows_per_core = (rows >> Log2Core) + ((rows & (NUM_CORES-1))!=0);
+  int start_row = min(rows_per_core * core_id, rows);
+  int stop_row = min(start_row + rows_per_core, rows);
+
+  for (int row = start_row; row < stop_row; row++)
+  {
+    int h = row / S;
+    int s = row - h * S;
+    int8_t *pSrc = pA + row * S;
+    int8_t *pDst = pAt + (s * heads + h) * S;
+    int i;
+    for (i = 0; i < (S>>2); i++)
+    {
+      *((v4s*)pDst) = *((v4s*)pSrc);
+      pSrc+=4;
+      pDst+=4;
+    }
+    for (i = i<<2; i < S; i++)
+    {
+      *pDst = *pSrc;
+      pSrc++;
+      pDst++;
+    }
+  }
+  pi_cl_team_barrier(0);
+
+  // 4. Attention context, [S][H*P]
+  matmul_4x2_S(pAt, pV, pCtx, S, projections, heads, requant_div, requant_mul);
+  pi_cl_team_barrier(0);
+
+  // 5. Output projection, residual and layerNorm (barrier inside)
+  linearO_4x2_H_LN(pCtx, pWeightO, pBiasO, pX1, S, E, projections, heads, requant_div, requant_mul, pNormWeight1, norm_log2D, pInBuffer);
+
+  // 6. FFN expansion with i-GELU, [S][F] (barrier inside)
+  linearO_4x2_H_GELU(pX1, pWeightFF1, pBiasFF1, pG, S, dim_ffn, E, 1, requant_div, requant_mul, gelu_b, gelu_one, gelu_totScaler, gelu_log2D);
+
+  // 7. FFN contraction, residual and layerNorm (barrier inside)
+  linearO_4x2_H_LN(pG, pWeightFF2, pBiasFF2, pOutBuffer, S, E, dim_ffn, 1, requant_div, requant_mul, pNormWeight2, norm_log2D, pX1);
+}
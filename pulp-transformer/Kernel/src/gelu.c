@@ -70,23 +70,8 @@ void __attribute__ ((noinline))  pulp_nn_gelu_i8_i8 (
     }
     int chunk = (dim_im_in_h >> Log2Core) + extra_chunk_r;
 
-    int16_t sign, x, x_abs, q;
-    int8_t d;
-    int32_t L, y;
-
     for(int i=0; i<dataSize; i++){
-      x = Im_in[i];
-      sign = (x > 0) - (x < 0); // sgn(x)
-      x_abs = sign*x; // abs(x)
-      if (x_abs > -b) {
-        q = -b;
-      } else {
-        q = x_abs;
-      }
-      d = q + b;
-      L = sign * (-(d*d) + one);
-      y = ((x * (one + L))>>1);
-      Im_out[i] = max(min(((int32_t)(y*totScaler) >> log2D), 127),-128);
+      Im_out[i] = pulp_nn_i_gelu_i8(Im_in[i], b, one, totScaler, log2D);
     }
 
     // int start_pixel = min((chunk * core_id_r), dim_im_in_h);
@@ -2,7 +2,7 @@
 #
 # File: iSoftmax.c
 #
-# Last edited: 10.10.2023
+# Last edited: 14.10.2026
 #
 # Copyright (C) 2023, ETH Zurich and University of Bologna.
 #
@@ -30,6 +30,71 @@
 #include "../inc/pulp_nn_utils.h"
 #include "../inc/pulp_nn_kernels.h"
 
+// The division by log2 is a multiply-shift: exact for the -xTilde in [0, 255]
+// of int8 inputs, and a plain shift when log2 is a power of two.
+typedef struct {
+  uint32_t log2_mul;
+  uint32_t log2_shift;
+} iSoftmaxDiv;
+
+static inline iSoftmaxDiv iSoftmax_div(const int32_t log2)
+{
+  iSoftmaxDiv d;
+  if ((log2 & (log2 - 1)) == 0)
+  {
+    d.log2_mul = 1;
+    d.log2_shift = __builtin_pulp_fl1(log2);
+  }
+  else
+  {
+    d.log2_mul = 65536 / log2 + 1;
+    d.log2_shift = 16;
+  }
+  return d;
+}
+
+static inline int8_t iSoftmax_max(const int8_t * pInBuffer, const int32_t rowDimension)
+{
+  v4s vmax = (v4s){-128, -128, -128, -128};
+  int i = 0;
+  for (; i + 4 <= rowDimension; i += 4)
+    vmax = maxs4(vmax, *((v4s *)&pInBuffer[i]));
+
+  int8_t x_max = vmax[0];
+  for (int k = 1; k < 4; k++)
+    if (vmax[k] > x_max)
+      x_max = vmax[k];
+  for (; i < rowDimension; i++)
+    if (pInBuffer[i] > x_max)
+      x_max = pInBuffer[i];
+  return x_max;
+}
+
+static inline uint32_t iSoftmax_exp(const int8_t x, const int8_t x_max, const int32_t coeffA, const int32_t coeffB,
+                                    const int32_t coeffC, const int32_t log2, const iSoftmaxDiv d)
+{
+  int16_t xTilde = x - x_max;
+  int8_t z = (int8_t)(((uint32_t)(-xTilde) * d.log2_mul) >> d.log2_shift);
+  int8_t p = xTilde + z * log2;
+  if (z > 31 || z < 0)
+    return 0;
+  return (coeffA*(p+coeffB)*(p+coeffB) + coeffC)>>z;
+}
+
+// floor(y*(n_levels-1) / y_sum) from rcp = (2^32-1) / y_sum: the high word of
+// the product is at most one below the quotient, one compare corrects it.
+static inline uint8_t iSoftmax_norm(const uint32_t y, const uint32_t levels, const uint32_t y_sum, const uint32_t rcp)
+{
+  uint32_t num = y * levels;
+  uint32_t q = (uint32_t)(((uint64_t)num * rcp) >> 32);
+  if (num - q * y_sum >= y_sum)
+    q++;
+  return (uint8_t)q;
+}
+
+// I-BERT softmax of one row. The exponentials are recomputed in the
+// normalisation pass instead of being held on the stack, see iSoftmax_scratch
+// for the buffered version.
 void iSoftmax(
   int8_t * pInBuffer,
   uint8_t * pOutBuffer,
@@ -40,29 +105,47 @@ void iSoftmax(
   const int32_t log2,
   const uint32_t n_levels )
 {
-
-    int16_t xTilde;
-    int8_t z, p;
-    int8_t x_max = -128;
+    iSoftmaxDiv d = iSoftmax_div(log2);
+    int8_t x_max = iSoftmax_max(pInBuffer, rowDimension);
     uint32_t y_sum = 0;
-    uint32_t y[rowDimension];
-    
+
     for (int i=0; i<rowDimension; i++){
-        if (pInBuffer[i] > x_max){
-            x_max = pInBuffer[i];
-        }
+        y_sum += iSoftmax_exp(pInBuffer[i], x_max, coeffA, coeffB, coeffC, log2, d);
     }
 
+    uint32_t rcp = 0xFFFFFFFFu / y_sum;
+    for (int i=0; i<rowDimension; i++){
+        uint32_t y = iSoftmax_exp(pInBuffer[i], x_max, coeffA, coeffB, coeffC, log2, d);
+        pOutBuffer[i] = iSoftmax_norm(y, n_levels-1, y_sum, rcp);
+    }
+
+}
+
+// iSoftmax with the exponentials kept in pScratch (rowDimension words, e.g. in
+// L1) between the two passes.
+void iSoftmax_scratch(
+  int8_t * pInBuffer,
+  uint8_t * pOutBuffer,
+  uint32_t * pScratch,
+  const int32_t rowDimension,
+  const int32_t coeffA,
+  const int32_t coeffB,
+  const int32_t coeffC,
+  const int32_t log2,
+  const uint32_t n_levels )
+{
+    iSoftmaxDiv d = iSoftmax_div(log2);
+    int8_t x_max = iSoftmax_max(pInBuffer, rowDimension);
+    uint32_t y_sum = 0;
+
     for (int i=0; i<rowDimension; i++){
-        xTilde = pInBuffer[i] - x_max;
-        z = -(xTilde / log2);
-        p = xTilde + z * log2;
-        y[i] = ((coeffA*(p+coeffB)*(p+coeffB) + coeffC)>>z)*(1-(z > 31 || z < 0));
-        y_sum += y[i];
+        pScratch[i] = iSoftmax_exp(pInBuffer[i], x_max, coeffA, coeffB, coeffC, log2, d);
+        y_sum += pScratch[i];
     }
 
+    uint32_t rcp = 0xFFFFFFFFu / y_sum;
     for (int i=0; i<rowDimension; i++){
-        pOutBuffer[i] = (uint8_t)((y[i]*(n_levels-1))/(y_sum));
+        pOutBuffer[i] = iSoftmax_norm(pScratch[i], n_levels-1, y_sum, rcp);
     }
 
 }
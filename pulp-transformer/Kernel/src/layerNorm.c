@@ -85,30 +85,33 @@ void __attribute__ ((noinline))  pulp_nn_layernorm_i8_i8 (
   start_row = min(row_per_core * core_id, row_dim);
   stop_row = min(start_row + row_per_core, row_dim);
   
-  int64_t mean;
-  int64_t sum;
-  int64_t std;
-  int64_t temp;
-  uint16_t biasOffset = lastDimLength; //Bias are packed in the weight variable with the actual weights
+  int32_t sum, sumSq;
+  int8_t *pIn, *pOut;
+  v4s vecA;
+  v4s ones = (v4s){1, 1, 1, 1};
+
+  // 32-bit normalization when |(x - mean) * weight| + |bias| fits: |x - mean| <= 255
+  int narrow = pulp_nn_layernorm_narrow(weight, lastDimLength);
 
   for(int i = start_row; i < stop_row; i++){
+    pIn = Im_in + i*lastDimLength;
+    pOut = Im_out + i*lastDimLength;
+
+    // Sum and sum of squares, 4 elements per SIMD dot product
     sum = 0;
-    mean = 0;
-    for (int j=0;j<lastDimLength; j++){
-      mean += Im_in[j + i*lastDimLength];
+    sumSq = 0;
+    int j = 0;
+    for (; j + 4 <= lastDimLength; j += 4){
+      vecA = *((v4s*)(pIn + j));
+      sum = SumDotps4(vecA, ones, sum);
+      sumSq = SumDotps4(vecA, vecA, sumSq);
     }
-    mean = mean / lastDimLength;
-    for (int j=0;j<lastDimLength; j++){
-      temp = (Im_in[j + i*lastDimLength] - mean);
-      sum += temp*temp;
-    }
-    sum = sum / lastDimLength;
-    sum += 1;
-    plp_sqrt_q64(&sum, 0, &std);
-    
-    for (int j=0;j<lastDimLength; j++){
-      Im_out[j + i*lastDimLength] = (((((int64_t)Im_in[j + i*lastDimLength])-mean)*weight[j])/(std) + weight[biasOffset + j]) >> log2D;
+    for (; j < lastDimLength; j++){
+      sum += pIn[j];
+      sumSq += pIn[j]*pIn[j];
     }
+
+    pulp_nn_layernorm_row_i8(pIn, pOut, weight, lastDimLength, log2D, sum, sumSq, narrow);
   }
 
   pi_cl_team_barrier(0);
@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearAttention_H.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// Linear attention with the ReLU feature map, the TINYFORMER_LINEAR_ATTN path
+// of litex_port/common/tinyformer.c: out[s] = relu(q_s) KV / relu(q_s).z with
+// KV = relu(K)^T V and z = sum_j relu(k_j), in O(S*P^2) per head instead of
+// the O(S^2*P) of the softmax scores. Q is [H][S][P] (linearQK_4x2_H), K and V
+// are [H][P][S] (linearV_4x2_H) and the output [S][H][P], as matmul_4x2_H.
+// pBuffer is LINEAR_ATTENTION_L1_SIZE(P, H) bytes of L1 for KV ([H][P][P]) and
+// z ([H][P]). The int64 numerator and the divisor are shifted right until the
+// divisor is below 2^24, so the division stays 32-bit, exactly as the C model.
+void __attribute__ ((noinline)) linearAttention_H(
+  const int8_t *  pQ,
+  const int8_t *  pK,
+  const int8_t *  pV,
+  int8_t *        pOutBuffer,
+  int32_t *       pBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads
+)
+{
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  int32_t *pKV = pBuffer;
+  int32_t *pZ = pBuffer + heads * projections * projections;
+
+  // local vars
+  int row, rows, rows_per_core, start_row, stop_row, head_out, a, e, j, sh;
+  int words = dim_sequence >> 2;
+  const int8_t *pKa, *pK1, *pV1, *pV2, *pQs;
+  int8_t *pOut;
+  int32_t sum1, sum2, z, den;
+  int64_t num[projections];
+  v4s vecK;
+  v4s zero = (v4s){0, 0, 0, 0};
+  v4s ones = (v4s){1, 1, 1, 1};
+
+  // Phase 1: KV and z, split over the (head, key projection) rows
+  rows = heads * projections;
+  rows_per_core = (rows >> Log2Core) + ((rows & (NUM_CORES-1))!=0);
+  start_row = min(rows_per_core * core_id, rows);
+  stop_row = min(start_row + rows_per_core, rows);
+
+  for (row = start_row; row < stop_row; row++)
+  {
+    head_out = row / projections;
+    pKa = pK + row * dim_sequence;
+
+    z = 0;
+    pK1 = pKa;
+    for (j = 0; j < words; j++)
+    {
+      vecK = maxs4(*((v4s*)pK1), zero);
+      z = SumDotps4(vecK, ones, z);
+      pK1 += 4;
+    }
+    for (j = words << 2; j < dim_sequence; j++)
+      z += pKa[j] > 0 ? pKa[j] : 0;
+    pZ[row] = z;
+
+    // Two V rows per pass share the ReLU'd key words
+    for (e = 0; e < projections; e += 2)
+    {
+      pV1 = pV + (head_out * projections + e) * dim_sequence;
+      pV2 = (e + 1 < projections) ? pV1 + dim_sequence : pV1;
+      sum1 = 0;
+      sum2 = 0;
+
+      pK1 = pKa;
+      for (j = 0; j < words; j++)
+      {
+        vecK = maxs4(*((v4s*)pK1), zero);
+        sum1 = SumDotps4(vecK, *((v4s*)pV1), sum1);
+        sum2 = SumDotps4(vecK, *((v4s*)pV2), sum2);
+        pK1 += 4;
+        pV1 += 4;
+        pV2 += 4;
+      }
+      for (j = words << 2; j < dim_sequence; j++)
+      {
+        if (pKa[j] > 0)
+        {
+          sum1 += pKa[j] * *pV1;
+          sum2 += pKa[j] * *pV2;
+        }
+        pV1++;
+        pV2++;
+      }
+
+      pKV[row * projections + e] = sum1;
+      if (e + 1 < projections)
+        pKV[row * projections + e + 1] = sum2;
+    }
+  }
+  pi_cl_team_barrier(0);
+
+  // Phase 2: one output row per (head, query), split over the cores
+  rows = heads * dim_sequence;
+  rows_per_core = (rows >> Log2Core) + ((rows & (NUM_CORES-1))!=0);
+  start_row = min(rows_per_core * core_id, rows);
+  stop_row = min(start_row + rows_per_core, rows);
+
+  for (row = start_row; row < stop_row; row++)
+  {
+    head_out = row / dim_sequence;
+    int seq_out = row - head_out * dim_sequence;
+    const int32_t *kv = pKV + head_out * projections * projections;
+    const int32_t *zh = pZ + head_out * projections;
+
+    pQs = pQ + row * projections;
+    pOut = pOutBuffer + seq_out * heads * projections + head_out * projections;
+
+    for (e = 0; e < projections; e++)
+      num[e] = 0;
+    den = 0;
+
+    for (a = 0; a < projections; a++)
+    {
+      int32_t q = pQs[a];
+      if (q <= 0)
+        continue;
+      // |q * KV| < 127 * 127 * 128 * S: each product fits int32 up to S = 1040
+      den += q * zh[a];
+      for (e = 0; e < projections; e++)
+        num[e] += q * kv[a * projections + e];
+    }
+
+    sh = 0;
+    while ((den >> sh) >= (1 << 24))
+      sh++;
+
+    for (e = 0; e < projections; e++)
+      pOut[e] = den > 0 ? clip8((int32_t)(num[e] >> sh) / (den >> sh)) : 0;
+  }
+  pi_cl_team_barrier(0);
+}
@@ -0,0 +1,136 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearO_4x2_H_tiled.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/thorir_dma.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+// linearO_4x2_H with the [S][H*P] context, weights, biases and [S][E] output
+// in L2. The weights and biases stay in L1 and the sequence is processed
+// tile_seq rows at a time: core 0 loads the context rows of the next tile with
+// async DMA while all cores compute the current one, and stores each output
+// tile while the next is computed. pL1 is
+// LINEAR_O_TILED_L1_SIZE(S, E, P, H, tile_seq) bytes, planned as
+//
+//   | W [E][H*P] | B [E] | In, Out tile 0 | In, Out tile 1 |
+//
+// linearO_4x2_H splits row pairs evenly over the cores, so tile_seq and the
+// last tile must be multiples of 2*NUM_CORES unless there is a single tile.
+// tile_seq comes from Test/tilingSolver.py (TILING_O_SEQ).
+void __attribute__ ((noinline)) linearO_4x2_H_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const uint16_t  tile_seq,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  int S = dim_sequence;
+  int E = dim_embedding;
+  int HP = heads * projections;
+  int tiles = (S + tile_seq - 1) / tile_seq;
+
+  // L1 plan, see above
+  int8_t *pW = pL1;
+  int16_t *pB = (int16_t *)(pW + ALIGN4(E * HP));
+  int8_t *pIn[2], *pOut[2];
+  int tile_size = ALIGN4(tile_seq * HP) + ALIGN4(tile_seq * E);
+  for (int b = 0; b < 2; b++)
+  {
+    pIn[b] = (int8_t *)pB + ALIGN4(2 * E) + b * tile_size;
+    pOut[b] = pIn[b] + ALIGN4(tile_seq * HP);
+  }
+
+  DMA_copy copy_in, copy_out;
+  thorir_dma_cmd_t cmd_w[2], cmd_in[2], cmd_out[2];
+
+  copy_in.hwc_to_chw = 0;
+  copy_in.stride_2d = 0;
+  copy_in.number_of_2d_copies = 1;
+  copy_in.stride_1d = 0;
+  copy_in.number_of_1d_copies = 1;
+  copy_in.dir = 1;
+  copy_out = copy_in;
+  copy_out.dir = 0;
+
+  copy_in.ext = (void *)pWeight;
+  copy_in.loc = pW;
+  copy_in.length_1d_copy = E * HP;
+  thorir_dma_async(&copy_in, &cmd_w[0]);
+  copy_in.ext = (void *)pBiasBuffer;
+  copy_in.loc = pB;
+  copy_in.length_1d_copy = 2 * E;
+  thorir_dma_async(&copy_in, &cmd_w[1]);
+  copy_in.ext = (void *)pInBuffer;
+  copy_in.loc = pIn[0];
+  copy_in.length_1d_copy = min(tile_seq, S) * HP;
+  thorir_dma_async(&copy_in, &cmd_in[0]);
+  thorir_dma_wait(&cmd_w[0]);
+  thorir_dma_wait(&cmd_w[1]);
+
+  for (int t = 0; t < tiles; t++)
+  {
+    int b = t & 1;
+    int seq = t * tile_seq;
+    int ns = min(tile_seq, S - seq);
+
+    thorir_dma_wait(&cmd_in[b]);
+    // Tile b^1 was last read by tile t-1, which ended with a barrier
+    if (t + 1 < tiles)
+    {
+      copy_in.ext = (void *)(pInBuffer + (seq + tile_seq) * HP);
+      copy_in.loc = pIn[b^1];
+      copy_in.length_1d_copy = min(tile_seq, S - seq - tile_seq) * HP;
+      thorir_dma_async(&copy_in, &cmd_in[b^1]);
+    }
+    // Out tile b is free once the store of tile t-2 is done
+    if (t >= 2)
+      thorir_dma_wait(&cmd_out[b]);
+    pi_cl_team_barrier(0);
+
+    // Barrier inside
+    linearO_4x2_H(pIn[b], pW, pB, pOut[b], ns, E, projections, heads, requant_div, requant_mul);
+
+    copy_out.ext = pOutBuffer + seq * E;
+    copy_out.loc = pOut[b];
+    copy_out.length_1d_copy = ns * E;
+    thorir_dma_async(&copy_out, &cmd_out[b]);
+  }
+
+  for (int t = (tiles > 2 ? tiles - 2 : 0); t < tiles; t++)
+    thorir_dma_wait(&cmd_out[t & 1]);
+  pi_cl_team_barrier(0);
+}
@@ -0,0 +1,339 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearQKV_4x2_H.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/cluster_work_queue.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "math.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define SumDotp(a, b, c) __builtin_pulp_sdotsp4(a, b, c)
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// Q, K and V projections in one pass over the input: each 4x2 block
+// (2 sequence rows, 4 projections) loads its two input words once per step
+// and feeds them to the Q, K and V weight rows, so pInBuffer is read once
+// instead of three times (linearQK_4x2_H twice, linearV_4x2_H once).
+//
+// pWeight  : stacked [Wq; Wk; Wv], each [heads * projections][dimEmbedding]
+// pBias    : stacked [bq; bk; bv], each [heads * projections]
+// pOutBuffer: Q [heads][dimSequence][projections], then K (same layout),
+//            then V transposed [heads][projections][dimSequence], i.e. the
+//            outputs of linearQK_4x2_H, linearQK_4x2_H and linearV_4x2_H.
+void __attribute__ ((noinline)) linearQKV_4x2_H(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dimSequence,
+  const uint16_t  dimEmbedding,
+  const uint16_t  dimProjections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, row pair) blocks evenly over the cores, so that fewer
+  // heads than cores still keeps every core busy (whole heads per core when
+  // heads is a multiple of NUM_CORES)
+  // or, with CLUSTER_WORK_QUEUE, take them from the shared queue of
+  // cluster_work_queue.h
+  int blocks_per_head = (dimSequence + 1) >> 1;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+  int start_head, stop_head, start_pair, stop_pair;
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+  work_queue_t wq;
+  work_queue_init(&wq, blocks, start_block, stop_block);
+
+  // Offsets between the Q, K and V parts of the stacked buffers
+  const int32_t weightStride = heads * dimProjections * dimEmbedding;
+  const int32_t biasStride = heads * dimProjections;
+  const int32_t outStride = heads * dimProjections * dimSequence;
+  const int32_t rowStride = dimEmbedding;
+  const int32_t rowStride2 = 2 * dimEmbedding;
+  const int32_t rowStride3 = 3 * dimEmbedding;
+
+  // Local variables declarations
+  int32_t head_out, proj_out, seq_out, emb, mat;
+  int8_t *pA, *pA2;
+  int8_t *pBq, *pBk, *pBv;
+  v4s vecA, vecA2, vecB;
+  int8_t *pOutQ, *pOutQ2, *pOutK, *pOutK2, *pOutV;
+  int16_t *pBias;
+  int32_t sumQ, sumQ2, sumQ3, sumQ4, sumQ5, sumQ6, sumQ7, sumQ8; // Accumulators
+  int32_t sumK, sumK2, sumK3, sumK4, sumK5, sumK6, sumK7, sumK8;
+  int32_t sumV, sumV2, sumV3, sumV4, sumV5, sumV6, sumV7, sumV8;
+  int32_t sum, sum2;
+
+  // We spatially unroll the 2 sequences and 4 projections within one GAP8 core
+  while (work_queue_next(&wq, &start_block, &stop_block))
+  {
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+  for (head_out = start_head; head_out < stop_head; head_out++)
+  {
+    start_pair = (head_out == start_head) ? start_block - head_out * blocks_per_head : 0;
+    stop_pair = (head_out == stop_head - 1) ? stop_block - head_out * blocks_per_head : blocks_per_head;
+    for (seq_out = start_pair; seq_out < min(stop_pair, dimSequence>>1); seq_out++)
+    {
+
+      pOutQ = pOutBuffer + (head_out * dimProjections * dimSequence) + (2 * seq_out * dimProjections);
+      pOutQ2 = pOutQ + dimProjections;
+      pOutK = pOutQ + outStride;
+      pOutK2 = pOutK + dimProjections;
+
+      for (proj_out = 0; proj_out < (dimProjections>>2); proj_out++)
+      {
+        pBias = pBiasBuffer + (head_out * dimProjections) + (4 * proj_out);
+        sumQ = pBias[0];
+        sumQ2 = pBias[1];
+        sumQ3 = pBias[2];
+        sumQ4 = pBias[3];
+        sumQ5 = sumQ;
+        sumQ6 = sumQ2;
+        sumQ7 = sumQ3;
+        sumQ8 = sumQ4;
+
+        sumK = pBias[biasStride];
+        sumK2 = pBias[biasStride + 1];
+        sumK3 = pBias[biasStride + 2];
+        sumK4 = pBias[biasStride + 3];
+        sumK5 = sumK;
+        sumK6 = sumK2;
+        sumK7 = sumK3;
+        sumK8 = sumK4;
+
+        sumV = pBias[2 * biasStride];
+        sumV2 = pBias[2 * biasStride + 1];
+        sumV3 = pBias[2 * biasStride + 2];
+        sumV4 = pBias[2 * biasStride + 3];
+        sumV5 = sumV;
+        sumV6 = sumV2;
+        sumV7 = sumV3;
+        sumV8 = sumV4;
+
+        pA = pInBuffer + (2 * seq_out * dimEmbedding);
+        pA2 = pA + dimEmbedding;
+
+        pBq = pWeight + (head_out * dimEmbedding * dimProjections) + (4 * proj_out * dimEmbedding);
+        pBk = pBq + weightStride;
+        pBv = pBk + weightStride;
+
+        for (emb = 0; emb < (dimEmbedding>>2); emb++)
+        {
+          // One input load per row, shared by the 12 weight rows
+          vecA = *((v4s*)pA);
+          vecA2 = *((v4s*)pA2);
+
+          vecB = *((v4s*)pBq);
+          sumQ = SumDotp(vecA, vecB, sumQ);
+          sumQ5 = SumDotp(vecA2, vecB, sumQ5);
+          vecB = *((v4s*)(pBq + rowStride));
+          sumQ2 = SumDotp(vecA, vecB, sumQ2);
+          sumQ6 = SumDotp(vecA2, vecB, sumQ6);
+          vecB = *((v4s*)(pBq + rowStride2));
+          sumQ3 = SumDotp(vecA, vecB, sumQ3);
+          sumQ7 = SumDotp(vecA2, vecB, sumQ7);
+          vecB = *((v4s*)(pBq + rowStride3));
+          sumQ4 = SumDotp(vecA, vecB, sumQ4);
+          sumQ8 = SumDotp(vecA2, vecB, sumQ8);
+
+          vecB = *((v4s*)pBk);
+          sumK = SumDotp(vecA, vecB, sumK);
+          sumK5 = SumDotp(vecA2, vecB, sumK5);
+          vecB = *((v4s*)(pBk + rowStride));
+          sumK2 = SumDotp(vecA, vecB, sumK2);
+          sumK6 = SumDotp(vecA2, vecB, sumK6);
+          vecB = *((v4s*)(pBk + rowStride2));
+          sumK3 = SumDotp(vecA, vecB, sumK3);
+          sumK7 = SumDotp(vecA2, vecB, sumK7);
+          vecB = *((v4s*)(pBk + rowStride3));
+          sumK4 = SumDotp(vecA, vecB, sumK4);
+          sumK8 = SumDotp(vecA2, vecB, sumK8);
+
+          vecB = *((v4s*)pBv);
+          sumV = SumDotp(vecA, vecB, sumV);
+          sumV5 = SumDotp(vecA2, vecB, sumV5);
+          vecB = *((v4s*)(pBv + rowStride));
+          sumV2 = SumDotp(vecA, vecB, sumV2);
+          sumV6 = SumDotp(vecA2, vecB, sumV6);
+          vecB = *((v4s*)(pBv + rowStride2));
+          sumV3 = SumDotp(vecA, vecB, sumV3);
+          sumV7 = SumDotp(vecA2, vecB, sumV7);
+          vecB = *((v4s*)(pBv + rowStride3));
+          sumV4 = SumDotp(vecA, vecB, sumV4);
+          sumV8 = SumDotp(vecA2, vecB, sumV8);
+
+          pA+=4;
+          pA2+=4;
+
+          pBq+=4;
+          pBk+=4;
+          pBv+=4;
+        }
+
+        *pOutQ = clip8((sumQ*requant_mul)>>requant_div);
+        pOutQ++;
+        *pOutQ = clip8((sumQ2*requant_mul)>>requant_div);
+        pOutQ++;
+        *pOutQ = clip8((sumQ3*requant_mul)>>requant_div);
+        pOutQ++;
+        *pOutQ = clip8((sumQ4*requant_mul)>>requant_div);
+        pOutQ++;
+        *pOutQ2 = clip8((sumQ5*requant_mul)>>requant_div);
+        pOutQ2++;
+        *pOutQ2 = clip8((sumQ6*requant_mul)>>requant_div);
+        pOutQ2++;
+        *pOutQ2 = clip8((sumQ7*requant_mul)>>requant_div);
+        pOutQ2++;
+        *pOutQ2 = clip8((sumQ8*requant_mul)>>requant_div);
+        pOutQ2++;
+        *pOutK = clip8((sumK*requant_mul)>>requant_div);
+        pOutK++;
+        *pOutK = clip8((sumK2*requant_mul)>>requant_div);
+        pOutK++;
+        *pOutK = clip8((sumK3*requant_mul)>>requant_div);
+        pOutK++;
+        *pOutK = clip8((sumK4*requant_mul)>>requant_div);
+        pOutK++;
+        *pOutK2 = clip8((sumK5*requant_mul)>>requant_div);
+        pOutK2++;
+        *pOutK2 = clip8((sumK6*requant_mul)>>requant_div);
+        pOutK2++;
+        *pOutK2 = clip8((sumK7*requant_mul)>>requant_div);
+        pOutK2++;
+        *pOutK2 = clip8((sumK8*requant_mul)>>requant_div);
+        pOutK2++;
+
+        // V is written transposed: the two sequences of a projection are adjacent
+        pOutV = pOutBuffer + 2 * outStride + (head_out * dimProjections * dimSequence) + (4 * proj_out * dimSequence) + (2 * seq_out);
+        pOutV[0] = clip8((sumV*requant_mul)>>requant_div);
+        pOutV[1] = clip8((sumV5*requant_mul)>>requant_div);
+        pOutV += dimSequence;
+        pOutV[0] = clip8((sumV2*requant_mul)>>requant_div);
+        pOutV[1] = clip8((sumV6*requant_mul)>>requant_div);
+        pOutV += dimSequence;
+        pOutV[0] = clip8((sumV3*requant_mul)>>requant_div);
+        pOutV[1] = clip8((sumV7*requant_mul)>>requant_div);
+        pOutV += dimSequence;
+        pOutV[0] = clip8((sumV4*requant_mul)>>requant_div);
+        pOutV[1] = clip8((sumV8*requant_mul)>>requant_div);
+      }
+      // Compute remaining projections temporaly
+      for (proj_out = dimProjections & ~3; proj_out < dimProjections; proj_out++)
+      {
+        for (mat = 0; mat < 3; mat++)
+        {
+          sum = pBiasBuffer[mat * biasStride + (head_out * dimProjections) + proj_out];
+          sum2 = sum;
+
+          pA = pInBuffer + (2 * seq_out * dimEmbedding);
+          pA2 = pA + dimEmbedding;
+
+          pBq = pWeight + (mat * weightStride) + (head_out * dimEmbedding * dimProjections) + (proj_out * dimEmbedding);
+
+          for (emb = 0; emb < (dimEmbedding>>2); emb++)
+          {
+            vecA = *((v4s*)pA);
+            vecA2 = *((v4s*)pA2);
+            vecB = *((v4s*)pBq);
+
+            sum = SumDotp(vecA, vecB, sum);
+            sum2 = SumDotp(vecA2, vecB, sum2);
+
+            pA+=4;
+            pA2+=4;
+
+            pBq+=4;
+          }
+
+          if (mat < 2)
+          {
+            pOutQ = pOutBuffer + (mat * outStride) + (head_out * dimProjections * dimSequence) + (2 * seq_out * dimProjections) + proj_out;
+            pOutQ[0] = clip8((sum*requant_mul)>>requant_div);
+            pOutQ[dimProjections] = clip8((sum2*requant_mul)>>requant_div);
+          }
+          else
+          {
+            pOutV = pOutBuffer + 2 * outStride + (head_out * dimProjections * dimSequence) + (proj_out * dimSequence) + (2 * seq_out);
+            pOutV[0] = clip8((sum*requant_mul)>>requant_div);
+            pOutV[1] = clip8((sum2*requant_mul)>>requant_div);
+          }
+        }
+      }
+    }
+
+    // Compute remaining sequences temporaly, on the core owning the last block
+    if ((dimSequence % 2) && stop_pair == blocks_per_head)
+    {
+      seq_out = dimSequence - 1;
+      pA = pInBuffer + (seq_out * dimEmbedding);
+
+      for (proj_out = 0; proj_out < dimProjections; proj_out++)
+      {
+        for (mat = 0; mat < 3; mat++)
+        {
+          sum = pBiasBuffer[mat * biasStride + (head_out * dimProjections) + proj_out];
+
+          pA2 = pA;
+          pBq = pWeight + (mat * weightStride) + (head_out * dimEmbedding * dimProjections) + (proj_out * dimEmbedding);
+
+          for (emb = 0; emb < (dimEmbedding>>2); emb++)
+          {
+            vecA2 = *((v4s*)pA2);
+            vecB = *((v4s*)pBq);
+
+            sum = SumDotp(vecA2, vecB, sum);
+
+            pA2+=4;
+            pBq+=4;
+          }
+
+          if (mat < 2)
+          {
+            pOutQ = pOutBuffer + (mat * outStride) + (head_out * dimProjections * dimSequence) + (seq_out * dimProjections) + proj_out;
+          }
+          else
+          {
+            pOutQ = pOutBuffer + 2 * outStride + (head_out * dimProjections * dimSequence) + (proj_out * dimSequence) + seq_out;
+          }
+          *pOutQ = clip8((sum*requant_mul)>>requant_div);
+        }
+      }
+    }
+  }
+  }
+  pi_cl_team_barrier(0);
+
+}
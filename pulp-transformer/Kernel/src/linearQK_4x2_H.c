@@ -29,6 +29,7 @@
 
 #include "pmsis.h"
 #include "../inc/pulp_nn_utils.h"
+#include "../inc/cluster_work_queue.h"
 #include "../inc/pulp_nn_kernels.h"
 #include "math.h"
 
@@ -50,13 +51,24 @@ void __attribute__ ((noinline)) linearQK_4x2_H(
 ) 
 {
 
-  // We spatially unroll the heads over the GAP8 cores
-  int8_t core_id = pi_core_id();
-  int8_t Log2Core = log2(NUM_CORES);
-  int8_t heads_per_core = (heads >> Log2Core) + ((heads & (NUM_CORES-1))!=0);
-  int8_t start_head, stop_head;
-  start_head = min(heads_per_core * core_id, heads);
-  stop_head = min(start_head + heads_per_core, heads);
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, row pair) blocks evenly over the cores, so that fewer
+  // heads than cores still keeps every core busy (whole heads per core when
+  // heads is a multiple of NUM_CORES)
+  // or, with CLUSTER_WORK_QUEUE, take them from the shared queue of
+  // cluster_work_queue.h
+  int blocks_per_head = (dimSequence + 1) >> 1;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+  int start_head, stop_head, start_pair, stop_pair;
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+  work_queue_t wq;
+  work_queue_init(&wq, blocks, start_block, stop_block);
 
   // Local variables declarations
   int32_t head_out, proj_out, seq_out, emb;
@@ -70,9 +82,15 @@ void __attribute__ ((noinline)) linearQK_4x2_H(
   int16_t *pBias;
 
   // We spatially unroll the 2 sequences and 4 projections within one GAP8 core
+  while (work_queue_next(&wq, &start_block, &stop_block))
+  {
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
   for (head_out = start_head; head_out < stop_head; head_out++)
   {
-    for (seq_out = 0; seq_out < (dimSequence>>1); seq_out++)
+    start_pair = (head_out == start_head) ? start_block - head_out * blocks_per_head : 0;
+    stop_pair = (head_out == stop_head - 1) ? stop_block - head_out * blocks_per_head : blocks_per_head;
+    for (seq_out = start_pair; seq_out < min(stop_pair, dimSequence>>1); seq_out++)
     {  
       
       pOut = pOutBuffer + (head_out * dimProjections * dimSequence) + (2 * seq_out * dimProjections);
@@ -188,11 +206,13 @@ void __attribute__ ((noinline)) linearQK_4x2_H(
       }
     }
 
-    // Compute remaining sequences temporaly
+    // Compute remaining sequences temporaly, on the core owning the last block
     seq_out = dimSequence % 2;
     
-    if(seq_out){
+    if(seq_out && stop_pair == blocks_per_head){
       
+      pA = pInBuffer + ((dimSequence - 2) * dimEmbedding);
+      pOut2 = pOutBuffer + (head_out * dimProjections * dimSequence) + ((dimSequence - 1) * dimProjections);
       pBias = pBiasBuffer + (head_out * dimProjections);
 
       for (proj_out = 0; proj_out < (dimProjections>>2); proj_out++)
@@ -245,8 +265,37 @@ void __attribute__ ((noinline)) linearQK_4x2_H(
         pOut2++;
 
       }
+      // Compute remaining projections temporaly
+      proj_out = dimProjections % 4;
+
+      while(proj_out > 0){
+
+        sum5 = *pBias;
+        pBias++;
+
+        pA2 = pA + dimEmbedding;
+
+        pB = pWeight + (head_out * dimEmbedding * dimProjections) + ((dimProjections - proj_out) * dimEmbedding);
+
+        for (emb = 0; emb < (dimEmbedding>>2); emb++)
+        {
+          vecA2 = *((v4s*)pA2);
+          vecB = *((v4s*)pB);
+
+          sum5 = SumDotp(vecA2, vecB, sum5);
+
+          pA2+=4;
+
+          pB+=4;
+        }
+        *pOut2 = clip8((sum5*requant_mul)>>requant_div);
+        pOut2++;
+
+        proj_out -= 1;
+      }
     }
   }
+  }
   pi_cl_team_barrier(0);
 
 }
@@ -0,0 +1,136 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearQK_4x2_H_tiled.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/thorir_dma.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+static void load_tile(DMA_copy *copy, thorir_dma_cmd_t *cmd, const int8_t *pWeight, const int16_t *pBias,
+                      int8_t *pW, int16_t *pB, int head, int tile_heads, int E, int P)
+{
+  copy->ext = (void *)(pWeight + head * P * E);
+  copy->loc = pW;
+  copy->length_1d_copy = tile_heads * P * E;
+  thorir_dma_async(copy, &cmd[0]);
+  copy->ext = (void *)(pBias + head * P);
+  copy->loc = pB;
+  copy->length_1d_copy = 2 * tile_heads * P;
+  thorir_dma_async(copy, &cmd[1]);
+}
+
+// linearQK_4x2_H with the input, weights, biases and output in L2. The input
+// stays in L1 and the heads are processed tile_heads at a time: core 0 loads
+// the weights and biases of the next tile with async DMA while all cores
+// compute the current one, and stores each [tile_heads][S][P] output tile
+// while the next is computed. pL1 is
+// LINEAR_QK_TILED_L1_SIZE(S, E, P, H, tile_heads) bytes, planned as
+//
+//   | X [S][E] | W, B, Out tile 0 | W, B, Out tile 1 |
+//
+// tile_heads comes from Test/tilingSolver.py (TILING_QK_HEADS).
+void __attribute__ ((noinline)) linearQK_4x2_H_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dimSequence,
+  const uint16_t  dimEmbedding,
+  const uint16_t  dimProjections,
+  const uint16_t  heads,
+  const uint16_t  tile_heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  int S = dimSequence;
+  int E = dimEmbedding;
+  int P = dimProjections;
+  int tiles = (heads + tile_heads - 1) / tile_heads;
+
+  // L1 plan, see above
+  int8_t *pX = pL1;
+  int8_t *pW[2], *pOut[2];
+  int16_t *pB[2];
+  int tile_size = ALIGN4(tile_heads * P * E) + ALIGN4(2 * tile_heads * P) + ALIGN4(tile_heads * S * P);
+  for (int b = 0; b < 2; b++)
+  {
+    pW[b] = pX + ALIGN4(S * E) + b * tile_size;
+    pB[b] = (int16_t *)(pW[b] + ALIGN4(tile_heads * P * E));
+    pOut[b] = (int8_t *)pB[b] + ALIGN4(2 * tile_heads * P);
+  }
+
+  DMA_copy copy_in, copy_out;
+  thorir_dma_cmd_t cmd_x, cmd_in[2][2], cmd_out[2];
+
+  copy_in.hwc_to_chw = 0;
+  copy_in.stride_2d = 0;
+  copy_in.number_of_2d_copies = 1;
+  copy_in.stride_1d = 0;
+  copy_in.number_of_1d_copies = 1;
+  copy_in.dir = 1;
+  copy_out = copy_in;
+  copy_out.dir = 0;
+
+  copy_in.ext = (void *)pInBuffer;
+  copy_in.loc = pX;
+  copy_in.length_1d_copy = S * E;
+  thorir_dma_async(&copy_in, &cmd_x);
+  load_tile(&copy_in, cmd_in[0], pWeight, pBiasBuffer, pW[0], pB[0], 0, min(tile_heads, heads), E, P);
+  thorir_dma_wait(&cmd_x);
+
+  for (int t = 0; t < tiles; t++)
+  {
+    int b = t & 1;
+    int head = t * tile_heads;
+    int nh = min(tile_heads, heads - head);
+
+    thorir_dma_wait(&cmd_in[b][0]);
+    thorir_dma_wait(&cmd_in[b][1]);
+    // Tile b^1 was last read by tile t-1, which ended with a barrier
+    if (t + 1 < tiles)
+      load_tile(&copy_in, cmd_in[b^1], pWeight, pBiasBuffer, pW[b^1], pB[b^1], head + tile_heads, min(tile_heads, heads - head - tile_heads), E, P);
+    // Out tile b is free once the store of tile t-2 is done
+    if (t >= 2)
+      thorir_dma_wait(&cmd_out[b]);
+    pi_cl_team_barrier(0);
+
+    linearQK_4x2_H(pX, pW[b], pB[b], pOut[b], S, E, P, nh, requant_div, requant_mul);
+    pi_cl_team_barrier(0);
+
+    copy_out.ext = pOutBuffer + head * S * P;
+    copy_out.loc = pOut[b];
+    copy_out.length_1d_copy = nh * S * P;
+    thorir_dma_async(&copy_out, &cmd_out[b]);
+  }
+
+  for (int t = (tiles > 2 ? tiles - 2 : 0); t < tiles; t++)
+    thorir_dma_wait(&cmd_out[t & 1]);
+  pi_cl_team_barrier(0);
+}
@@ -0,0 +1,310 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearQK_4x2_H_w4.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "math.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define SumDotp(a, b, c) __builtin_pulp_sdotsp4(a, b, c)
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// linearQK_4x2_H with int4 weights (W4A8): the same arguments and layouts, but every
+// weight row is packed two elements per byte (pulp_nn_utils.h, unpackLow4 /
+// unpackHigh4), so dimEmbedding must be a multiple of 8.
+void __attribute__ ((noinline)) linearQK_4x2_H_w4(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dimSequence,
+  const uint16_t  dimEmbedding,
+  const uint16_t  dimProjections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+) 
+{
+
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, row pair) blocks evenly over the cores, so that fewer
+  // heads than cores still keeps every core busy (whole heads per core when
+  // heads is a multiple of NUM_CORES)
+  int blocks_per_head = (dimSequence + 1) >> 1;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+  int start_head, stop_head, start_pair, stop_pair;
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+
+  // Local variables declarations
+  int32_t head_out, proj_out, seq_out, emb;
+  int32_t seq_leftover;
+  int8_t *pA, *pA2;
+  int8_t *pB, *pB2, *pB3, *pB4;
+  v4s vecA, vecA2;
+  v4s vecB, vecB2, vecB3, vecB4;
+  int8_t *pOut, *pOut2;
+  int32_t sum, sum2, sum3, sum4, sum5, sum6, sum7, sum8; // Accumulators
+  int16_t *pBias;
+  int32_t rowW = PACK_INT4_SIZE(dimEmbedding); // bytes per packed int4 weight row
+
+  // We spatially unroll the 2 sequences and 4 projections within one GAP8 core
+  for (head_out = start_head; head_out < stop_head; head_out++)
+  {
+    start_pair = (head_out == start_head) ? start_block - head_out * blocks_per_head : 0;
+    stop_pair = (head_out == stop_head - 1) ? stop_block - head_out * blocks_per_head : blocks_per_head;
+    for (seq_out = start_pair; seq_out < min(stop_pair, dimSequence>>1); seq_out++)
+    {  
+      
+      pOut = pOutBuffer + (head_out * dimProjections * dimSequence) + (2 * seq_out * dimProjections);
+      pOut2 = pOut + dimProjections;
+
+      pBias = pBiasBuffer + (head_out * dimProjections);
+
+      for (proj_out = 0; proj_out < (dimProjections>>2); proj_out++)
+      {  
+        sum = *pBias;
+        pBias++;
+        sum2 = *pBias;
+        pBias++;
+        sum3 = *pBias;
+        pBias++;
+        sum4 = *pBias;
+        pBias++;
+
+        sum5 = sum;
+        sum6 = sum2;
+        sum7 = sum3;
+        sum8 = sum4;
+
+        pA = pInBuffer + (2 * seq_out * dimEmbedding);
+        pA2 = pA + dimEmbedding;
+
+        pB = pWeight + (head_out * rowW * dimProjections) + (4 * proj_out * rowW);
+        pB2 = pB + rowW;
+        pB3 = pB2 + rowW;
+        pB4 = pB3 + rowW;
+
+        for (emb = 0; emb < (dimEmbedding>>3); emb++)
+        {
+          vecA = *((v4s*)pA);
+          vecA2 = *((v4s*)pA2);
+          vecB = *((v4s*)pB);
+          vecB2 = *((v4s*)pB2);
+          vecB3 = *((v4s*)pB3);
+          vecB4 = *((v4s*)pB4);
+
+          sum = SumDotp(vecA, unpackLow4(vecB), sum);
+          sum2 = SumDotp(vecA, unpackLow4(vecB2), sum2);
+          sum3 = SumDotp(vecA, unpackLow4(vecB3), sum3);
+          sum4 = SumDotp(vecA, unpackLow4(vecB4), sum4);
+          sum5 = SumDotp(vecA2, unpackLow4(vecB), sum5);
+          sum6 = SumDotp(vecA2, unpackLow4(vecB2), sum6);
+          sum7 = SumDotp(vecA2, unpackLow4(vecB3), sum7);
+          sum8 = SumDotp(vecA2, unpackLow4(vecB4), sum8);
+
+          vecA = *((v4s*)(pA + 4));
+          vecA2 = *((v4s*)(pA2 + 4));
+          sum = SumDotp(vecA, unpackHigh4(vecB), sum);
+          sum2 = SumDotp(vecA, unpackHigh4(vecB2), sum2);
+          sum3 = SumDotp(vecA, unpackHigh4(vecB3), sum3);
+          sum4 = SumDotp(vecA, unpackHigh4(vecB4), sum4);
+          sum5 = SumDotp(vecA2, unpackHigh4(vecB), sum5);
+          sum6 = SumDotp(vecA2, unpackHigh4(vecB2), sum6);
+          sum7 = SumDotp(vecA2, unpackHigh4(vecB3), sum7);
+          sum8 = SumDotp(vecA2, unpackHigh4(vecB4), sum8);
+
+          pA+=8;
+          pA2+=8;
+          pB+=4;
+          pB2+=4;
+          pB3+=4;
+          pB4+=4;
+        }
+
+        *pOut = clip8((sum*requant_mul)>>requant_div);
+        pOut++;
+        *pOut = clip8((sum2*requant_mul)>>requant_div);
+        pOut++;
+        *pOut = clip8((sum3*requant_mul)>>requant_div);
+        pOut++;
+        *pOut = clip8((sum4*requant_mul)>>requant_div);
+        pOut++;
+        *pOut2 = clip8((sum5*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum6*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum7*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum8*requant_mul)>>requant_div);
+        pOut2++;
+      }
+      // Compute remaining projections temporaly
+      proj_out = dimProjections % 4;
+
+      while(proj_out > 0){
+        
+        sum = *pBias;
+        sum2 = sum;
+        pBias++;
+
+        pA = pInBuffer + (2 * seq_out * dimEmbedding);
+        pA2 = pA + dimEmbedding;
+
+        pB = pWeight + (head_out * rowW * dimProjections) + ((dimProjections - proj_out) * rowW);
+
+        for (emb = 0; emb < (dimEmbedding>>3); emb++)
+        {
+          vecA = *((v4s*)pA);
+          vecA2 = *((v4s*)pA2);
+          vecB = *((v4s*)pB);
+
+          sum = SumDotp(vecA, unpackLow4(vecB), sum);
+          sum2 = SumDotp(vecA2, unpackLow4(vecB), sum2);
+
+          vecA = *((v4s*)(pA + 4));
+          vecA2 = *((v4s*)(pA2 + 4));
+          sum = SumDotp(vecA, unpackHigh4(vecB), sum);
+          sum2 = SumDotp(vecA2, unpackHigh4(vecB), sum2);
+
+          pA+=8;
+          pA2+=8;
+          pB+=4;
+        }
+        *pOut = clip8((sum*requant_mul)>>requant_div);
+        pOut++;
+
+        *pOut2 = clip8((sum2*requant_mul)>>requant_div);
+        pOut2++;
+
+        proj_out -= 1;
+      }
+    }
+
+    // Compute remaining sequences temporaly, on the core owning the last block
+    seq_out = dimSequence % 2;
+    
+    if(seq_out && stop_pair == blocks_per_head){
+      
+      pA = pInBuffer + ((dimSequence - 2) * dimEmbedding);
+      pOut2 = pOutBuffer + (head_out * dimProjections * dimSequence) + ((dimSequence - 1) * dimProjections);
+      pBias = pBiasBuffer + (head_out * dimProjections);
+
+      for (proj_out = 0; proj_out < (dimProjections>>2); proj_out++)
+      {
+
+        sum5 = *pBias;
+        pBias++;
+        sum6 = *pBias;
+        pBias++;
+        sum7 = *pBias;
+        pBias++;
+        sum8 = *pBias;
+        pBias++;
+
+        pA2 = pA + dimEmbedding;
+
+        pB = pWeight + (head_out * rowW * dimProjections) + (4 * proj_out * rowW);
+        pB2 = pB + rowW;
+        pB3 = pB2 + rowW;
+        pB4 = pB3 + rowW;
+
+        for (emb = 0; emb < (dimEmbedding>>3); emb++)
+        {
+          vecA2 = *((v4s*)pA2);
+          vecB = *((v4s*)pB);
+          vecB2 = *((v4s*)pB2);
+          vecB3 = *((v4s*)pB3);
+          vecB4 = *((v4s*)pB4);
+
+          sum5 = SumDotp(vecA2, unpackLow4(vecB), sum5);
+          sum6 = SumDotp(vecA2, unpackLow4(vecB2), sum6);
+          sum7 = SumDotp(vecA2, unpackLow4(vecB3), sum7);
+          sum8 = SumDotp(vecA2, unpackLow4(vecB4), sum8);
+
+          vecA2 = *((v4s*)(pA2 + 4));
+          sum5 = SumDotp(vecA2, unpackHigh4(vecB), sum5);
+          sum6 = SumDotp(vecA2, unpackHigh4(vecB2), sum6);
+          sum7 = SumDotp(vecA2, unpackHigh4(vecB3), sum7);
+          sum8 = SumDotp(vecA2, unpackHigh4(vecB4), sum8);
+
+          pA2+=8;
+          pB+=4;
+          pB2+=4;
+          pB3+=4;
+          pB4+=4;
+        }
+
+        *pOut2 = clip8((sum5*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum6*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum7*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum8*requant_mul)>>requant_div);
+        pOut2++;
+
+      }
+      // Compute remaining projections temporaly
+      proj_out = dimProjections % 4;
+
+      while(proj_out > 0){
+
+        sum5 = *pBias;
+        pBias++;
+
+        pA2 = pA + dimEmbedding;
+
+        pB = pWeight + (head_out * rowW * dimProjections) + ((dimProjections - proj_out) * rowW);
+
+        for (emb = 0; emb < (dimEmbedding>>3); emb++)
+        {
+          vecA2 = *((v4s*)pA2);
+          vecB = *((v4s*)pB);
+
+          sum5 = SumDotp(vecA2, unpackLow4(vecB), sum5);
+
+          vecA2 = *((v4s*)(pA2 + 4));
+          sum5 = SumDotp(vecA2, unpackHigh4(vecB), sum5);
+
+          pA2+=8;
+          pB+=4;
+        }
+        *pOut2 = clip8((sum5*requant_mul)>>requant_div);
+        pOut2++;
+
+        proj_out -= 1;
+      }
+    }
+  }
+  pi_cl_team_barrier(0);
+
+}
@@ -0,0 +1,99 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearQK_4x4_H_macload.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/pulp_nn_macload.h"
+#include "math.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// linearQK_4x2_H with 4 sequences x 4 projections per block, on the NN-RF
+// MacLoad path with XPULPNN (pulp_nn_macload.h). Same arguments and layouts.
+void __attribute__ ((noinline)) linearQK_4x4_H_macload(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBiasBuffer,
+  int8_t *        pOutBuffer,
+  const uint16_t  dimSequence,
+  const uint16_t  dimEmbedding,
+  const uint16_t  dimProjections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, row quad) blocks evenly over the cores
+  int blocks_per_head = (dimSequence + 3) >> 2;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+
+  // Local variables declarations
+  int32_t block, head_out, proj_out, seq_out, rows, cols, i, j;
+  const int8_t *pA, *pB;
+  const int16_t *pBias;
+  int8_t *pOut;
+  int32_t sum[16]; // Accumulators
+
+  pulp_nn_macload_config(dimEmbedding, dimEmbedding);
+
+  for (block = start_block; block < stop_block; block++)
+  {
+    head_out = block / blocks_per_head;
+    seq_out = 4 * (block - head_out * blocks_per_head);
+    rows = min(4, dimSequence - seq_out);
+
+    pA = pInBuffer + (seq_out * dimEmbedding);
+    pB = pWeight + (head_out * dimEmbedding * dimProjections);
+    pBias = pBiasBuffer + (head_out * dimProjections);
+    pOut = pOutBuffer + (head_out * dimProjections * dimSequence) + (seq_out * dimProjections);
+
+    for (proj_out = 0; proj_out < dimProjections; proj_out += 4)
+    {
+      cols = min(4, dimProjections - proj_out);
+
+      if (rows == 4 && cols == 4)
+        pulp_nn_dot_4x4(pA, dimEmbedding, pB, dimEmbedding, dimEmbedding, 0, sum);
+      else
+        pulp_nn_dot_rows(pA, dimEmbedding, rows, pB, dimEmbedding, cols, dimEmbedding, 0, sum);
+
+      for (i = 0; i < rows; i++)
+        for (j = 0; j < cols; j++)
+          pOut[i * dimProjections + j] = clip8(((sum[4*i + j] + pBias[j])*requant_mul)>>requant_div);
+
+      pB += 4 * dimEmbedding;
+      pBias += 4;
+      pOut += 4;
+    }
+  }
+  pi_cl_team_barrier(0);
+
+}
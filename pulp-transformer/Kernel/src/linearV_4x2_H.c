@@ -29,6 +29,7 @@
 
 #include "pmsis.h"
 #include "../inc/pulp_nn_utils.h"
+#include "../inc/cluster_work_queue.h"
 #include "../inc/pulp_nn_kernels.h"
 #include "math.h"
 
@@ -60,13 +61,24 @@ void __attribute__ ((noinline)) linearV_4x2_H(
   // printf("\n");
   // printf("Requant div and mul: %d %d\n", requant_div, requant_mul);
 
-  // We spatially unroll the heads over the GAP8 cores
-  int8_t core_id = pi_core_id();
-  int8_t Log2Core = log2(NUM_CORES);
-  int8_t heads_per_core = (heads >> Log2Core) + ((heads & (NUM_CORES-1))!=0);
-  int8_t start_head, stop_head;
-  start_head = min(heads_per_core * core_id, heads);
-  stop_head = min(start_head + heads_per_core, heads);
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, projection pair) blocks evenly over the cores, so that fewer
+  // heads than cores still keeps every core busy (whole heads per core when
+  // heads is a multiple of NUM_CORES)
+  // or, with CLUSTER_WORK_QUEUE, take them from the shared queue of
+  // cluster_work_queue.h
+  int blocks_per_head = (projections + 1) >> 1;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+  int start_head, stop_head, start_pair, stop_pair;
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+  work_queue_t wq;
+  work_queue_init(&wq, blocks, start_block, stop_block);
 
   // local vars
   int32_t head_out, proj_out, seq_out, emb;
@@ -85,9 +97,15 @@ void __attribute__ ((noinline)) linearV_4x2_H(
   // }
 
   // We spatially unroll the 2 sequences and 4 projections within one GAP8 core
+  while (work_queue_next(&wq, &start_block, &stop_block))
+  {
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
   for (head_out = start_head; head_out < stop_head; head_out++)
   {
-    for (proj_out = 0; proj_out < (projections>>1); proj_out++)
+    start_pair = (head_out == start_head) ? start_block - head_out * blocks_per_head : 0;
+    stop_pair = (head_out == stop_head - 1) ? stop_block - head_out * blocks_per_head : blocks_per_head;
+    for (proj_out = start_pair; proj_out < min(stop_pair, projections>>1); proj_out++)
     {  
       pA = pInBuffer;
       pOut = pOutBuffer + (head_out * projections * dim_sequence) + (2 * proj_out * dim_sequence);
@@ -193,11 +211,13 @@ void __attribute__ ((noinline)) linearV_4x2_H(
       }
     }
 
-    // Compute remaining projections temporally
+    // Compute remaining projections temporally, on the core owning the last block
     proj_out = projections % 2;
     
-    if(proj_out){
+    if(proj_out && stop_pair == blocks_per_head){
       
+      pA = pInBuffer;
+      pOut2 = pOutBuffer + (head_out * projections * dim_sequence) + ((projections - 1) * dim_sequence);
       pBias = pBiasBuffer + (head_out * projections) + projections - proj_out; //point to last bias
 
       for (seq_out = 0; seq_out < (dim_sequence>>2); seq_out++)
@@ -241,10 +261,34 @@ void __attribute__ ((noinline)) linearV_4x2_H(
         pOut2++;
         *pOut2 = clip8((sum4*requant_mul)>>requant_div);
         pOut2++;
+        pA = pA + (3 * dim_embedding);
+      }
+
+      // Compute remaining sequence temporally
+      seq_out = dim_sequence % 4;
+
+      while(seq_out > 0){
 
+        sum = *pBias;
+        pB = pWeight + (head_out * dim_embedding * projections) + ((projections - proj_out) * dim_embedding); //last projection
+
+        for (emb = 0; emb < (dim_embedding>>2); emb++)
+        {
+          vecA = *((v4s*)pA);
+          vecB = *((v4s*)pB);
+          sum = SumDotp(vecA, vecB, sum);
+          pA+=4;
+          pB+=4;
+        }
+
+        *pOut2 = clip8((sum*requant_mul)>>requant_div);
+        pOut2++;
+
+        seq_out -= 1;
       }
     }
   }
+  }
   // for(int i=0; i<81*256; i++) {
   //   printf("%d ", pOutBuffer[i]);
   // }
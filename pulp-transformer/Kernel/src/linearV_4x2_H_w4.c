@@ -0,0 +1,319 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearV_4x2_H_w4.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "math.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define SumDotp(a, b, c) __builtin_pulp_sdotsp4(a, b, c)
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// linearV_4x2_H with int4 weights (W4A8): the same arguments and layouts, but every
+// weight row is packed two elements per byte (pulp_nn_utils.h, unpackLow4 /
+// unpackHigh4), so dim_embedding must be a multiple of 8.
+void __attribute__ ((noinline)) linearV_4x2_H_w4(
+  const int8_t * pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t *  pBiasBuffer,
+  int8_t *       pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+) 
+{
+  // printf("Weights Qlinear:\n");
+  // for(int i = 0; i < 10; i++){
+  //   printf("%d \t", pWeight[i]);
+  // }
+  // printf("\n");
+  // for(int i = 256-10; i < 256; i++){
+  //   printf("%d \t", pBias[i]);
+  // }
+  // printf("\n");
+  // printf("Requant div and mul: %d %d\n", requant_div, requant_mul);
+
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, projection pair) blocks evenly over the cores, so that fewer
+  // heads than cores still keeps every core busy (whole heads per core when
+  // heads is a multiple of NUM_CORES)
+  int blocks_per_head = (projections + 1) >> 1;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+  int start_head, stop_head, start_pair, stop_pair;
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+
+  // local vars
+  int32_t head_out, proj_out, seq_out, emb;
+  int32_t seq_leftover;
+  int8_t *pA, *pA2, *pA3, *pA4;
+  int8_t *pB, *pB2;
+  int8_t *pOut = pOutBuffer + start_head * projections * dim_sequence;
+  int8_t *pOut2 = pOut + dim_sequence;
+  v4s vecA, vecA2, vecA3, vecA4;
+  v4s vecB, vecB2;
+  int32_t sum, sum2, sum3, sum4, sum5, sum6, sum7, sum8; // Accumulators
+  int16_t *pBias;
+  int32_t rowW = PACK_INT4_SIZE(dim_embedding); // bytes per packed int4 weight row
+
+  // for(int i = 0; i < 256; i++){
+  //   printf("%d \t", pBiasBuffer[i]);
+  // }
+
+  // We spatially unroll the 2 sequences and 4 projections within one GAP8 core
+  for (head_out = start_head; head_out < stop_head; head_out++)
+  {
+    start_pair = (head_out == start_head) ? start_block - head_out * blocks_per_head : 0;
+    stop_pair = (head_out == stop_head - 1) ? stop_block - head_out * blocks_per_head : blocks_per_head;
+    for (proj_out = start_pair; proj_out < min(stop_pair, projections>>1); proj_out++)
+    {  
+      pA = pInBuffer;
+      pOut = pOutBuffer + (head_out * projections * dim_sequence) + (2 * proj_out * dim_sequence);
+      pOut2 = pOut + dim_sequence;
+
+      for (seq_out = 0; seq_out < (dim_sequence>>2); seq_out++)
+      { 
+
+        pBias = pBiasBuffer + (head_out * projections) + proj_out*2; 
+        sum = *pBias;
+        sum2 = sum;
+        sum3 = sum;
+        sum4 = sum;
+        pBias++;
+
+        sum5 = *pBias;
+        sum6 = sum5;
+        sum7 = sum5;
+        sum8 = sum5;
+
+        pA2 = pA + dim_embedding;
+        pA3 = pA2 + dim_embedding;
+        pA4 = pA3 + dim_embedding;
+        pB = pWeight + (head_out * rowW * projections) + (rowW * proj_out * 2);
+        pB2 = pB + rowW;
+        for (emb = 0; emb < (dim_embedding>>3); emb++)
+        { 
+          vecA = *((v4s*)pA);
+          vecA2 = *((v4s*)pA2);
+          vecA3 = *((v4s*)pA3);
+          vecA4 = *((v4s*)pA4);
+          vecB = *((v4s*)pB);
+          vecB2 = *((v4s*)pB2);
+
+          sum = SumDotp(vecA, unpackLow4(vecB), sum);
+          sum2 = SumDotp(vecA2, unpackLow4(vecB), sum2);
+          sum3 = SumDotp(vecA3, unpackLow4(vecB), sum3);
+          sum4 = SumDotp(vecA4, unpackLow4(vecB), sum4);
+          sum5 = SumDotp(vecA, unpackLow4(vecB2), sum5);
+          sum6 = SumDotp(vecA2, unpackLow4(vecB2), sum6);
+          sum7 = SumDotp(vecA3, unpackLow4(vecB2), sum7);
+          sum8 = SumDotp(vecA4, unpackLow4(vecB2), sum8);
+
+          vecA = *((v4s*)(pA + 4));
+          vecA2 = *((v4s*)(pA2 + 4));
+          vecA3 = *((v4s*)(pA3 + 4));
+          vecA4 = *((v4s*)(pA4 + 4));
+          sum = SumDotp(vecA, unpackHigh4(vecB), sum);
+          sum2 = SumDotp(vecA2, unpackHigh4(vecB), sum2);
+          sum3 = SumDotp(vecA3, unpackHigh4(vecB), sum3);
+          sum4 = SumDotp(vecA4, unpackHigh4(vecB), sum4);
+          sum5 = SumDotp(vecA, unpackHigh4(vecB2), sum5);
+          sum6 = SumDotp(vecA2, unpackHigh4(vecB2), sum6);
+          sum7 = SumDotp(vecA3, unpackHigh4(vecB2), sum7);
+          sum8 = SumDotp(vecA4, unpackHigh4(vecB2), sum8);
+
+          pA+=8;
+          pA2+=8;
+          pA3+=8;
+          pA4+=8;
+          pB+=4;
+          pB2+=4;
+        }
+        
+        *pOut = clip8((sum*requant_mul)>>requant_div);
+        pOut++;
+        *pOut = clip8((sum2*requant_mul)>>requant_div);
+        pOut++;
+        *pOut = clip8((sum3*requant_mul)>>requant_div);
+        pOut++;
+        *pOut = clip8((sum4*requant_mul)>>requant_div);
+        pOut++;
+        *pOut2 = clip8((sum5*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum6*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum7*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum8*requant_mul)>>requant_div);
+        pOut2++;
+        pA = pA + (3 * dim_embedding);
+      }
+      
+      // Compute remaining sequence temporally
+      seq_out = dim_sequence % 4;
+
+      while(seq_out > 0){
+        
+        pBias = pBiasBuffer + (head_out * projections) + proj_out*2; 
+        pB = pWeight + (head_out * rowW * projections) + (rowW * proj_out * 2);
+        pB2 = pB + rowW;
+        
+        sum = *pBias;
+        pBias++;
+        sum5 = *pBias;
+        
+        for (emb = 0; emb < (dim_embedding>>3); emb++)
+        {
+          vecA = *((v4s*)pA);
+          vecB = *((v4s*)pB);
+          vecB2 = *((v4s*)pB2);
+
+          sum = SumDotp(vecA, unpackLow4(vecB), sum);
+          sum5 = SumDotp(vecA, unpackLow4(vecB2), sum5);
+
+          vecA = *((v4s*)(pA + 4));
+          sum = SumDotp(vecA, unpackHigh4(vecB), sum);
+          sum5 = SumDotp(vecA, unpackHigh4(vecB2), sum5);
+
+          pA+=8;
+          pB+=4;
+          pB2+=4;
+        }
+
+        *pOut = clip8((sum*requant_mul)>>requant_div);
+        pOut++;
+        *pOut2 = clip8((sum5*requant_mul)>>requant_div);
+        pOut2++;
+        
+        seq_out -= 1;
+      }
+    }
+
+    // Compute remaining projections temporally, on the core owning the last block
+    proj_out = projections % 2;
+    
+    if(proj_out && stop_pair == blocks_per_head){
+      
+      pA = pInBuffer;
+      pOut2 = pOutBuffer + (head_out * projections * dim_sequence) + ((projections - 1) * dim_sequence);
+      pBias = pBiasBuffer + (head_out * projections) + projections - proj_out; //point to last bias
+
+      for (seq_out = 0; seq_out < (dim_sequence>>2); seq_out++)
+      {
+
+        sum = *pBias;
+        sum2 = sum;
+        sum3 = sum;
+        sum4 = sum;
+
+        pA2 = pA + dim_embedding;
+        pA3 = pA2 + dim_embedding;
+        pA4 = pA3 + dim_embedding;
+        pB = pWeight + (head_out * rowW * projections) + ((projections - proj_out) * rowW); //last projection
+
+
+        for (emb = 0; emb < (dim_embedding>>3); emb++)
+        {
+          vecA = *((v4s*)pA);
+          vecA2 = *((v4s*)pA2);
+          vecA3 = *((v4s*)pA3);
+          vecA4 = *((v4s*)pA4);
+          vecB = *((v4s*)pB);
+
+          sum = SumDotp(vecA, unpackLow4(vecB), sum);
+          sum2 = SumDotp(vecA2, unpackLow4(vecB), sum2);
+          sum3 = SumDotp(vecA3, unpackLow4(vecB), sum3);
+          sum4 = SumDotp(vecA4, unpackLow4(vecB), sum4);
+
+          vecA = *((v4s*)(pA + 4));
+          vecA2 = *((v4s*)(pA2 + 4));
+          vecA3 = *((v4s*)(pA3 + 4));
+          vecA4 = *((v4s*)(pA4 + 4));
+          sum = SumDotp(vecA, unpackHigh4(vecB), sum);
+          sum2 = SumDotp(vecA2, unpackHigh4(vecB), sum2);
+          sum3 = SumDotp(vecA3, unpackHigh4(vecB), sum3);
+          sum4 = SumDotp(vecA4, unpackHigh4(vecB), sum4);
+
+          pA+=8;
+          pA2+=8;
+          pA3+=8;
+          pA4+=8;
+          pB+=4;
+        }
+
+        *pOut2 = clip8((sum*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum2*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum3*requant_mul)>>requant_div);
+        pOut2++;
+        *pOut2 = clip8((sum4*requant_mul)>>requant_div);
+        pOut2++;
+        pA = pA + (3 * dim_embedding);
+      }
+
+      // Compute remaining sequence temporally
+      seq_out = dim_sequence % 4;
+
+      while(seq_out > 0){
+
+        sum = *pBias;
+        pB = pWeight + (head_out * rowW * projections) + ((projections - proj_out) * rowW); //last projection
+
+        for (emb = 0; emb < (dim_embedding>>3); emb++)
+        {
+          vecA = *((v4s*)pA);
+          vecB = *((v4s*)pB);
+
+          sum = SumDotp(vecA, unpackLow4(vecB), sum);
+
+          vecA = *((v4s*)(pA + 4));
+          sum = SumDotp(vecA, unpackHigh4(vecB), sum);
+
+          pA+=8;
+          pB+=4;
+        }
+
+        *pOut2 = clip8((sum*requant_mul)>>requant_div);
+        pOut2++;
+
+        seq_out -= 1;
+      }
+    }
+  }
+  // for(int i=0; i<81*256; i++) {
+  //   printf("%d ", pOutBuffer[i]);
+  // }
+  // printf("\n");
+}
@@ -27,6 +27,7 @@
 
 #include "pmsis.h"
 #include "../inc/pulp_nn_utils.h"
+#include "../inc/cluster_work_queue.h"
 #include "../inc/pulp_nn_kernels.h"
 
 #define min(a,b) ((a)<(b)?(a):(b))
@@ -52,11 +53,21 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_H(
   int core_id = pi_core_id();
   int Log2Core = log2(NUM_CORES);
 
-  int head_per_core = ((heads>>1) >> Log2Core) + (((heads>>1) & (NUM_CORES-1))!=0);
-
-  int start_head, stop_head;
-  start_head = min(head_per_core * core_id, heads);
-  stop_head = min(start_head + head_per_core, heads);
+  // Split the (head, row pair) blocks evenly over the cores, so that fewer
+  // heads than cores still keeps every core busy (whole heads per core when
+  // heads is a multiple of NUM_CORES)
+  // or, with CLUSTER_WORK_QUEUE, take them from the shared queue of
+  // cluster_work_queue.h
+  int blocks_per_head = (dim_sequence + 1) >> 1;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+  int start_head, stop_head, start_pair, stop_pair;
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+  work_queue_t wq;
+  work_queue_init(&wq, blocks, start_block, stop_block);
 
   // local vars
   int seq_out, proj_out, seq_out_internal, head_out;
@@ -72,9 +83,15 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_H(
   v4s vecA, vecA2;
   v4s vecB, vecB2, vecB3, vecB4;
 
+  while (work_queue_next(&wq, &start_block, &stop_block))
+  {
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
   for (head_out = start_head; head_out < stop_head; head_out++)
   {  
-    for (seq_out = 0; seq_out < (dim_sequence>>1); seq_out++)
+    start_pair = (head_out == start_head) ? start_block - head_out * blocks_per_head : 0;
+    stop_pair = (head_out == stop_head - 1) ? stop_block - head_out * blocks_per_head : blocks_per_head;
+    for (seq_out = start_pair; seq_out < min(stop_pair, dim_sequence>>1); seq_out++)
     {
       pB = pWeight + (head_out * dim_sequence * projections);
       pOut = pOutBuffer + head_out * dim_sequence + seq_out * heads * dim_sequence * 2;
@@ -214,9 +231,11 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_H(
     }
     seq_out_left = dim_sequence % 2;
     
-    if(seq_out_left){
+    // Last row of an odd sequence, on the core owning the last block
+    if(seq_out_left && stop_pair == blocks_per_head){
+      seq_out = dim_sequence >> 1;
       pB = pWeight + (head_out * dim_sequence * projections);
-      pOut = pOut2 + heads * dim_sequence;//point to the last row in the sequence
+      pOut = pOutBuffer + head_out * dim_sequence + (dim_sequence - 1) * heads * dim_sequence;//point to the last row in the sequence
       softmax_buffer_1 = softmax_buffer_1_base;
     
       for (seq_out_internal = 0; seq_out_internal < (dim_sequence>>2); seq_out_internal++)
@@ -289,5 +308,6 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_H(
       seq_out_left -= 1;
     }
   }
+  }
   pi_cl_team_barrier(0);
 }
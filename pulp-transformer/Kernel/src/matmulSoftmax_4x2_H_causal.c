@@ -0,0 +1,228 @@
+/* ----------------------------------------------------------------------
+#
+# File: matmulSoftmax_4x2_H_causal.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define SumDotp(a, b, c) __builtin_pulp_sdotsp4(a, b, c)
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// Causal matmulSoftmax_4x2_H: row i of each head attends to the keys j <= i
+// only. The scores of j > i are never computed and their softmax outputs are
+// written as 0, so the QK^T and softmax work is about halved. Same arguments
+// and layouts as matmulSoftmax_4x2_H.
+//
+// The work of a row pair grows with its index, so the (head, row pair) blocks
+// are dealt to the cores round-robin instead of in contiguous ranges.
+void __attribute__ ((noinline)) matmulSoftmax_4x2_H_causal(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,  
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+) 
+{
+  int core_id = pi_core_id();
+
+  int blocks_per_head = (dim_sequence + 1) >> 1;
+  int blocks = heads * blocks_per_head;
+
+  // local vars
+  int proj_out, seq_out_internal, head_out, row, keys, two_rows;
+  int8_t *pA, *pA2, *pRow, *pRow2;
+  int8_t *pB, *pB2, *pB3, *pB4;
+  uint8_t *pOut, *pOut2;
+  int8_t softmax_buffer_1_base[dim_sequence];
+  int8_t softmax_buffer_2_base[dim_sequence];
+  int8_t *softmax_buffer_1; int8_t *softmax_buffer_2;
+  int8_t seq_internal_left;
+  v4s vecA, vecA2;
+  v4s vecB, vecB2, vecB3, vecB4;
+
+  for (int block = core_id; block < blocks; block += NUM_CORES)
+  {
+    head_out = block / blocks_per_head;
+    row = 2 * (block - head_out * blocks_per_head);
+    two_rows = (row + 1) < dim_sequence;
+    // Keys of the second row of the pair, the first row uses one less
+    keys = row + 1 + two_rows;
+
+    // The last row of an odd sequence is computed as a pair with itself
+    pRow = pInBuffer + (head_out * dim_sequence + row) * projections;
+    pRow2 = two_rows ? pRow + projections : pRow;
+    pB = pWeight + (head_out * dim_sequence * projections);
+    pOut = pOutBuffer + head_out * dim_sequence + row * heads * dim_sequence;
+    pOut2 = pOut + heads * dim_sequence;
+    softmax_buffer_1 = softmax_buffer_1_base;
+    softmax_buffer_2 = softmax_buffer_2_base;
+
+    for (seq_out_internal = 0; seq_out_internal < (keys>>2); seq_out_internal++)
+    { 
+      int sum = 0;
+      int sum2 = 0;
+      int sum3 = 0;
+      int sum4 = 0;
+      int sum5 = 0;
+      int sum6 = 0;
+      int sum7 = 0;
+      int sum8 = 0;
+
+      pB2 = pB + projections;
+      pB3 = pB2 + projections;
+      pB4 = pB3 + projections;
+      
+      pA = pRow;
+      pA2 = pRow2;
+      
+      for (proj_out = 0; proj_out < (projections>>2); proj_out++)
+      { 
+        vecA = *((v4s*)pA);
+        vecA2 = *((v4s*)pA2);
+        vecB = *((v4s*)pB);
+        vecB2 = *((v4s*)pB2);
+        vecB3 = *((v4s*)pB3);
+        vecB4 = *((v4s*)pB4);
+      
+        sum = SumDotp(vecA, vecB, sum);
+        sum2 = SumDotp(vecA, vecB2, sum2);
+        sum3 = SumDotp(vecA, vecB3, sum3);
+        sum4 = SumDotp(vecA, vecB4, sum4);
+        sum5 = SumDotp(vecA2, vecB, sum5);
+        sum6 = SumDotp(vecA2, vecB2, sum6);
+        sum7 = SumDotp(vecA2, vecB3, sum7);
+        sum8 = SumDotp(vecA2, vecB4, sum8);
+      
+        pA+=4;
+        pA2+=4;
+        pB+=4;
+        pB2+=4;
+        pB3+=4;
+        pB4+=4;
+      }
+      proj_out = projections % 4;
+
+      while(proj_out > 0){
+        sum += *pA * *pB;
+        sum2 += *pA * *pB2;
+        sum3 += *pA * *pB3;
+        sum4 += *pA * *pB4;
+        sum5 += *pA2 * *pB;
+        sum6 += *pA2 * *pB2;
+        sum7 += *pA2 * *pB3;
+        sum8 += *pA2 * *pB4;
+
+        pA++;
+        pA2++;
+        pB++;
+        pB2++;
+        pB3++;
+        pB4++;
+
+        proj_out--;
+      }
+      
+      *softmax_buffer_1 = clip8((sum*requant_mul)>>requant_div);
+      softmax_buffer_1++;
+      *softmax_buffer_1 = clip8((sum2*requant_mul)>>requant_div);
+      softmax_buffer_1++;
+      *softmax_buffer_1 = clip8((sum3*requant_mul)>>requant_div);
+      softmax_buffer_1++;
+      *softmax_buffer_1 = clip8((sum4*requant_mul)>>requant_div);
+      softmax_buffer_1++;
+      *softmax_buffer_2 = clip8((sum5*requant_mul)>>requant_div);
+      softmax_buffer_2++;
+      *softmax_buffer_2 = clip8((sum6*requant_mul)>>requant_div);
+      softmax_buffer_2++;
+      *softmax_buffer_2 = clip8((sum7*requant_mul)>>requant_div);
+      softmax_buffer_2++;
+      *softmax_buffer_2 = clip8((sum8*requant_mul)>>requant_div);
+      softmax_buffer_2++;
+      
+      pB = pB + (3 * projections);
+    }
+    seq_internal_left = keys % 4;
+    
+    while(seq_internal_left > 0){
+      pA = pRow;
+      pA2 = pRow2;
+      
+      int sum = 0;
+      int sum5 = 0;
+      
+      for (proj_out = 0; proj_out < (projections>>2); proj_out++)
+      { 
+        vecA = *((v4s*)pA);
+        vecA2 = *((v4s*)pA2);
+        vecB = *((v4s*)pB);
+    
+        sum = SumDotp(vecA, vecB, sum);
+        sum5 = SumDotp(vecA2, vecB, sum5);
+    
+        pA+=4;
+        pA2+=4;
+        pB+=4;
+      }
+      proj_out = projections % 4;
+
+      while(proj_out > 0){
+        sum += *pA * *pB;
+        sum5 += *pA2 * *pB;
+
+        pA++;
+        pA2++;
+        pB++;
+
+        proj_out--;
+      }
+    
+      *softmax_buffer_1 = clip8((sum*requant_mul)>>requant_div);
+      softmax_buffer_1++;
+      *softmax_buffer_2 = clip8((sum5*requant_mul)>>requant_div);
+      softmax_buffer_2++;
+    
+      seq_internal_left -= 1;
+    }
+
+    // Masked keys get probability 0
+    iSoftmax(softmax_buffer_1_base, pOut, row + 1,  coeffA, coeffB, coeffC, log2, n_levels);
+    for (int j = row + 1; j < dim_sequence; j++)
+      pOut[j] = 0;
+    if (two_rows)
+    {
+      iSoftmax(softmax_buffer_2_base, pOut2, keys,  coeffA, coeffB, coeffC, log2, n_levels);
+      for (int j = keys; j < dim_sequence; j++)
+        pOut2[j] = 0;
+    }
+  }
+  pi_cl_team_barrier(0);
+}
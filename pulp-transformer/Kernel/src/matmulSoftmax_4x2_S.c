@@ -37,6 +37,7 @@
 
 #include "pmsis.h"
 #include "../inc/pulp_nn_utils.h"
+#include "../inc/cluster_work_queue.h"
 #include "../inc/pulp_nn_kernels.h"
 
 #define min(a,b) ((a)<(b)?(a):(b))
@@ -69,6 +70,10 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_S(
   int start_seq, stop_seq;
   start_seq = min(seq_per_core * core_id, dim_sequence);
   stop_seq = min(start_seq + seq_per_core, dim_sequence);
+  // Row pairs of all heads: this static share, or ranges from the shared
+  // queue with CLUSTER_WORK_QUEUE (cluster_work_queue.h)
+  work_queue_t wq;
+  work_queue_init(&wq, dim_sequence >> 1, start_seq, stop_seq);
 
   // local vars
   int seq_out, proj_out, seq_out_internal, head_out;
@@ -84,6 +89,12 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_S(
   v4s vecA, vecA2;
   v4s vecB, vecB2, vecB3, vecB4;
 
+  while (work_queue_next(&wq, &start_seq, &stop_seq))
+  {
+  if (CLUSTER_WORK_QUEUE) {
+    // The odd last row goes with the range that ends the sequence
+    leftover_seq = (dim_sequence & 1) && stop_seq == (dim_sequence >> 1);
+  }
   for (head_out = 0; head_out < heads; head_out++)
   {  
     for (seq_out = start_seq; seq_out < stop_seq; seq_out++)
@@ -311,5 +322,6 @@ void __attribute__ ((noinline)) matmulSoftmax_4x2_S(
       seq_out_left -= 1;
     }
   }
+  }
   pi_cl_team_barrier(0);
 }
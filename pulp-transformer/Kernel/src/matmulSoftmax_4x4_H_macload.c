@@ -0,0 +1,104 @@
+/* ----------------------------------------------------------------------
+#
+# File: matmulSoftmax_4x4_H_macload.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/pulp_nn_macload.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// matmulSoftmax_4x2_S / matmulSoftmax_4x2_H with 4 queries x 4 keys per block,
+// on the NN-RF MacLoad path with XPULPNN (pulp_nn_macload.h), split over
+// (head, row quad) blocks. Same arguments and layouts; the 4 score rows of a
+// block are kept on the stack (4 * dim_sequence bytes) until their softmax.
+void __attribute__ ((noinline)) matmulSoftmax_4x4_H_macload(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+)
+{
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, row quad) blocks evenly over the cores
+  int blocks_per_head = (dim_sequence + 3) >> 2;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+
+  // local vars
+  int block, seq_out, seq_out_internal, head_out, rows, cols, i, j;
+  const int8_t *pA, *pB;
+  uint8_t *pOut;
+  int8_t softmax_buffer_base[4 * dim_sequence];
+  int32_t sum[16];
+
+  pulp_nn_macload_config(projections, projections);
+
+  for (block = start_block; block < stop_block; block++)
+  {
+    head_out = block / blocks_per_head;
+    seq_out = 4 * (block - head_out * blocks_per_head);
+    rows = min(4, dim_sequence - seq_out);
+
+    pA = pInBuffer + head_out * dim_sequence * projections + seq_out * projections;
+    pB = pWeight + (head_out * dim_sequence * projections);
+
+    for (seq_out_internal = 0; seq_out_internal < dim_sequence; seq_out_internal += 4)
+    {
+      cols = min(4, dim_sequence - seq_out_internal);
+
+      if (rows == 4 && cols == 4)
+        pulp_nn_dot_4x4(pA, projections, pB, projections, projections, 0, sum);
+      else
+        pulp_nn_dot_rows(pA, projections, rows, pB, projections, cols, projections, 0, sum);
+
+      for (i = 0; i < rows; i++)
+        for (j = 0; j < cols; j++)
+          softmax_buffer_base[i * dim_sequence + seq_out_internal + j] = clip8((sum[4*i + j]*requant_mul)>>requant_div);
+
+      pB += 4 * projections;
+    }
+
+    pOut = pOutBuffer + seq_out * heads * dim_sequence + head_out * dim_sequence;
+    for (i = 0; i < rows; i++)
+    {
+      iSoftmax(softmax_buffer_base + i * dim_sequence, pOut, dim_sequence,  coeffA, coeffB, coeffC, log2, n_levels);
+      pOut += heads * dim_sequence;
+    }
+  }
+  pi_cl_team_barrier(0);
+}
@@ -27,6 +27,7 @@
 
 #include "pmsis.h"
 #include "../inc/pulp_nn_utils.h"
+#include "../inc/cluster_work_queue.h"
 #include "../inc/pulp_nn_kernels.h"
 
 #define min(a,b) ((a)<(b)?(a):(b))
@@ -66,7 +67,7 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H(
   int8_t *pW1, *pW2;
   int8_t *pOut1, *pOut2;
 
-  int8_t *intermediateBuffer = pOutBufferOriginal + 100000;
+  int8_t *intermediateBuffer = pOutBufferOriginal + dim_sequence*dim_sequence*heads;
   int8_t *intermediateBufferOriginal = intermediateBuffer;
 
   int8_t *pInter1, *pInter2;
@@ -76,15 +77,36 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H(
   int8_t softmax_buffer2[dim_sequence];
   int8_t *softmax_buffer2_ptr = softmax_buffer2;
 
-  int head_per_core = (heads >> log2(NUM_CORES)) + ((heads & (NUM_CORES-1)) != 0);
-  start_head = min(head_per_core * pi_core_id(), heads);
-  stop_head = min(start_head + head_per_core, heads);
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, row pair) blocks evenly over the cores, so that fewer
+  // heads than cores still keeps every core busy (whole heads per core when
+  // heads is a multiple of NUM_CORES)
+  // or, with CLUSTER_WORK_QUEUE, take them from the shared queue of
+  // cluster_work_queue.h
+  int blocks_per_head = dim_sequence >> 1;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+  int start_pair, stop_pair;
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
+  work_queue_t wq;
+  work_queue_init(&wq, blocks, start_block, stop_block);
     
+  while (work_queue_next(&wq, &start_block, &stop_block))
+  {
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
   for (int h = start_head; h < stop_head; h++){
-    pInter1 = intermediateBufferOriginal + h*dim_sequence*dim_embedding;
+    start_pair = (h == start_head) ? start_block - h * blocks_per_head : 0;
+    stop_pair = (h == stop_head - 1) ? stop_block - h * blocks_per_head : blocks_per_head;
+    pInter1 = intermediateBufferOriginal + h*dim_sequence*dim_embedding + 2*start_pair*dim_embedding;
     pInter2 = pInter1 + dim_embedding;
 
-    for (int s = 0; s < (dim_sequence >> 1); s++){
+    for (int s = start_pair; s < stop_pair; s++){
       pW1 = pWeightOriginal + h*dim_embedding*dim_embedding;
       pW2 = pW1 + dim_embedding;
       pBias = pBiasOriginal + h*dim_embedding;
@@ -133,13 +155,21 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H(
       pInter2 += dim_embedding;
     }
   }
+  }
   pi_cl_team_barrier(0); 
 
+  work_queue_rewind(&wq);
+  while (work_queue_next(&wq, &start_block, &stop_block))
+  {
+  start_head = start_block / blocks_per_head;
+  stop_head = (stop_block + blocks_per_head - 1) / blocks_per_head;
   for (int h = start_head; h < stop_head; h++){
-    pOut1 = pOutBufferOriginal + h*dim_sequence*dim_sequence;
+    start_pair = (h == start_head) ? start_block - h * blocks_per_head : 0;
+    stop_pair = (h == stop_head - 1) ? stop_block - h * blocks_per_head : blocks_per_head;
+    pOut1 = pOutBufferOriginal + h*dim_sequence*dim_sequence + 2*start_pair*dim_sequence;
     pOut2 = pOut1 + dim_sequence;
 
-    for (int s0 = 0; s0 < (dim_sequence >> 1); s0++){
+    for (int s0 = start_pair; s0 < stop_pair; s0++){
       pIn1 = pInOriginal;
       pIn2 = pIn1 + dim_embedding;
 
@@ -191,5 +221,6 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H(
       pOut2 = pOut1 + dim_sequence;
     }
   }
+  }
 }
 
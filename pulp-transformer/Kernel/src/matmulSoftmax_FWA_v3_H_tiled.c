@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------
+#
+# File: matmulSoftmax_FWA_v3_H_tiled.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/thorir_dma.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+static void load_tile(DMA_copy *copy, thorir_dma_cmd_t *cmd, const int8_t *pWeight, const int16_t *pBias,
+                      int8_t *pW, int16_t *pB, int head, int tile_heads, int E)
+{
+  copy->ext = (void *)(pWeight + head * E * E);
+  copy->loc = pW;
+  copy->length_1d_copy = tile_heads * E * E;
+  thorir_dma_async(copy, &cmd[0]);
+  copy->ext = (void *)(pBias + head * E);
+  copy->loc = pB;
+  copy->length_1d_copy = 2 * tile_heads * E;
+  thorir_dma_async(copy, &cmd[1]);
+}
+
+// matmulSoftmax_FWA_v3_H with the input, fused weights, biases and scores in
+// L2. The input stays in L1 and the heads are processed tile_heads at a time:
+// core 0 loads the weights and biases of the next tile with async DMA while
+// all cores compute the current one, and stores each [tile_heads][S][S] score
+// tile while the next is computed. Each Out tile is followed by the
+// [tile_heads][S][E] intermediate of the kernel. pL1 is
+// FWA_TILED_L1_SIZE(S, E, H, tile_heads) bytes, planned as
+//
+//   | X [S][E] | W, B, Out tile 0 | W, B, Out tile 1 |
+//
+// tile_heads comes from Test/tilingSolver.py (TILING_FWA_HEADS).
+void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_H_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  const int16_t * pBias,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  heads,
+  const uint16_t  tile_heads,
+  const int16_t   pre_proj_requant_div,
+  const int16_t   pre_proj_requant_mul,
+  const int16_t   post_proj_requant_div,
+  const int16_t   post_proj_requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+)
+{
+  int S = dim_sequence;
+  int E = dim_embedding;
+  int tiles = (heads + tile_heads - 1) / tile_heads;
+
+  // L1 plan, see above
+  int8_t *pX = pL1;
+  int8_t *pW[2], *pOut[2];
+  int16_t *pB[2];
+  int tile_size = ALIGN4(tile_heads * E * E) + ALIGN4(2 * tile_heads * E) + ALIGN4(tile_heads * S * (S + E));
+  for (int b = 0; b < 2; b++)
+  {
+    pW[b] = pX + ALIGN4(S * E) + b * tile_size;
+    pB[b] = (int16_t *)(pW[b] + ALIGN4(tile_heads * E * E));
+    pOut[b] = (int8_t *)pB[b] + ALIGN4(2 * tile_heads * E);
+  }
+
+  DMA_copy copy_in, copy_out;
+  thorir_dma_cmd_t cmd_x, cmd_in[2][2], cmd_out[2];
+
+  copy_in.hwc_to_chw = 0;
+  copy_in.stride_2d = 0;
+  copy_in.number_of_2d_copies = 1;
+  copy_in.stride_1d = 0;
+  copy_in.number_of_1d_copies = 1;
+  copy_in.dir = 1;
+  copy_out = copy_in;
+  copy_out.dir = 0;
+
+  copy_in.ext = (void *)pInBuffer;
+  copy_in.loc = pX;
+  copy_in.length_1d_copy = S * E;
+  thorir_dma_async(&copy_in, &cmd_x);
+  load_tile(&copy_in, cmd_in[0], pWeight, pBias, pW[0], pB[0], 0, min(tile_heads, heads), E);
+  thorir_dma_wait(&cmd_x);
+
+  for (int t = 0; t < tiles; t++)
+  {
+    int b = t & 1;
+    int head = t * tile_heads;
+    int nh = min(tile_heads, heads - head);
+
+    thorir_dma_wait(&cmd_in[b][0]);
+    thorir_dma_wait(&cmd_in[b][1]);
+    // Tile b^1 was last read by tile t-1, which ended with a barrier
+    if (t + 1 < tiles)
+      load_tile(&copy_in, cmd_in[b^1], pWeight, pBias, pW[b^1], pB[b^1], head + tile_heads, min(tile_heads, heads - head - tile_heads), E);
+    // Out tile b is free once the store of tile t-2 is done
+    if (t >= 2)
+      thorir_dma_wait(&cmd_out[b]);
+    pi_cl_team_barrier(0);
+
+    matmulSoftmax_FWA_v3_H(pX, pW[b], pB[b], pOut[b], S, E, nh, pre_proj_requant_div, pre_proj_requant_mul,
+                           post_proj_requant_div, post_proj_requant_mul, coeffA, coeffB, coeffC, log2, n_levels);
+    pi_cl_team_barrier(0);
+
+    copy_out.ext = pOutBuffer + head * S * S;
+    copy_out.loc = pOut[b];
+    copy_out.length_1d_copy = nh * S * S;
+    thorir_dma_async(&copy_out, &cmd_out[b]);
+  }
+
+  for (int t = (tiles > 2 ? tiles - 2 : 0); t < tiles; t++)
+    thorir_dma_wait(&cmd_out[t & 1]);
+  pi_cl_team_barrier(0);
+}
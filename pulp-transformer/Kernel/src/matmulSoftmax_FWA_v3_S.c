@@ -27,6 +27,7 @@
 
 #include "pmsis.h"
 #include "../inc/pulp_nn_utils.h"
+#include "../inc/cluster_work_queue.h"
 #include "../inc/pulp_nn_kernels.h"
 
 #define min(a,b) ((a)<(b)?(a):(b))
@@ -79,7 +80,13 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_S(
   int seq_per_core = ((dim_sequence >> 1) >> log2(NUM_CORES)) + (((dim_sequence >> 1) & (NUM_CORES-1)) != 0);
   start_seq = min(seq_per_core * pi_core_id(), dim_sequence);
   stop_seq = min(start_seq + seq_per_core, dim_sequence);
+  // Row pairs of all heads: this static share, or ranges from the shared
+  // queue with CLUSTER_WORK_QUEUE (cluster_work_queue.h)
+  work_queue_t wq;
+  work_queue_init(&wq, dim_sequence >> 1, start_seq, stop_seq);
     
+  while (work_queue_next(&wq, &start_seq, &stop_seq))
+  {
   for (int h = 0; h < heads; h++){
     pInter1 = intermediateBufferOriginal + h*dim_sequence*dim_embedding + 2*start_seq*dim_embedding;
     pInter2 = pInter1 + dim_embedding;
@@ -133,8 +140,12 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_S(
       pInter2 += dim_embedding;
     }
   }
+  }
   pi_cl_team_barrier(0); 
 
+  work_queue_rewind(&wq);
+  while (work_queue_next(&wq, &start_seq, &stop_seq))
+  {
   for (int h = 0; h < heads; h++){
     pOut1 = pOutBufferOriginal + h*dim_sequence*dim_sequence + 2*start_seq*dim_sequence;
     pOut2 = pOut1 + dim_sequence;
@@ -191,5 +202,6 @@ void __attribute__ ((noinline)) matmulSoftmax_FWA_v3_S(
       pOut2 = pOut1 + dim_sequence;
     }
   }
+  }
 }
 
@@ -0,0 +1,135 @@
+/* ----------------------------------------------------------------------
+#
+# File: matmul_4x2_S_tiled.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/thorir_dma.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+static void load_tile(DMA_copy *copy, thorir_dma_cmd_t *cmd, const int8_t *pInBuffer, const int8_t *pWeight,
+                      int8_t *pA, int8_t *pV, int head, int tile_heads, int S, int P, int H)
+{
+  // Columns [head*S, (head+tile_heads)*S) of the [S][H*S] scores
+  copy->ext = (void *)(pInBuffer + head * S);
+  copy->loc = pA;
+  copy->stride_1d = H * S;
+  copy->number_of_1d_copies = S;
+  copy->length_1d_copy = tile_heads * S;
+  thorir_dma_async(copy, &cmd[0]);
+  copy->ext = (void *)(pWeight + head * P * S);
+  copy->loc = pV;
+  copy->stride_1d = 0;
+  copy->number_of_1d_copies = 1;
+  copy->length_1d_copy = tile_heads * P * S;
+  thorir_dma_async(copy, &cmd[1]);
+}
+
+// matmul_4x2_S with the [S][H][S] scores, the [H][P][S] values and the
+// [S][H*P] context in L2, processed tile_heads heads at a time: core 0 loads
+// the scores (2D) and values of the next tile with async DMA while all cores
+// compute the current one, and stores each [S][tile_heads*P] context tile (2D)
+// while the next is computed. pL1 is MATMUL_TILED_L1_SIZE(S, P, H, tile_heads)
+// bytes, planned as
+//
+//   | A, V, Out tile 0 | A, V, Out tile 1 |
+//
+// tile_heads comes from Test/tilingSolver.py (TILING_MATMUL_HEADS).
+void __attribute__ ((noinline)) matmul_4x2_S_tiled(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const uint16_t  tile_heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  int S = dim_sequence;
+  int P = projections;
+  int tiles = (heads + tile_heads - 1) / tile_heads;
+
+  // L1 plan, see above
+  int8_t *pA[2], *pV[2], *pOut[2];
+  int tile_size = ALIGN4(S * tile_heads * S) + ALIGN4(tile_heads * P * S) + ALIGN4(S * tile_heads * P);
+  for (int b = 0; b < 2; b++)
+  {
+    pA[b] = pL1 + b * tile_size;
+    pV[b] = pA[b] + ALIGN4(S * tile_heads * S);
+    pOut[b] = pV[b] + ALIGN4(tile_heads * P * S);
+  }
+
+  DMA_copy copy_in, copy_out;
+  thorir_dma_cmd_t cmd_in[2][2], cmd_out[2];
+
+  copy_in.hwc_to_chw = 0;
+  copy_in.stride_2d = 0;
+  copy_in.number_of_2d_copies = 1;
+  copy_in.dir = 1;
+
+  // Out tile t goes to columns [t*tile_heads*P, ...) of the [S][H*P] context
+  copy_out.hwc_to_chw = 0;
+  copy_out.stride_2d = 0;
+  copy_out.number_of_2d_copies = 1;
+  copy_out.stride_1d = heads * P;
+  copy_out.number_of_1d_copies = S;
+  copy_out.dir = 0;
+
+  load_tile(&copy_in, cmd_in[0], pInBuffer, pWeight, pA[0], pV[0], 0, min(tile_heads, heads), S, P, heads);
+
+  for (int t = 0; t < tiles; t++)
+  {
+    int b = t & 1;
+    int head = t * tile_heads;
+    int nh = min(tile_heads, heads - head);
+
+    thorir_dma_wait(&cmd_in[b][0]);
+    thorir_dma_wait(&cmd_in[b][1]);
+    // Tile b^1 was last read by tile t-1, which ended with a barrier
+    if (t + 1 < tiles)
+      load_tile(&copy_in, cmd_in[b^1], pInBuffer, pWeight, pA[b^1], pV[b^1], head + tile_heads, min(tile_heads, heads - head - tile_heads), S, P, heads);
+    // Out tile b is free once the store of tile t-2 is done
+    if (t >= 2)
+      thorir_dma_wait(&cmd_out[b]);
+    pi_cl_team_barrier(0);
+
+    matmul_4x2_S(pA[b], pV[b], pOut[b], S, P, nh, requant_div, requant_mul);
+    pi_cl_team_barrier(0);
+
+    copy_out.ext = pOutBuffer + head * P;
+    copy_out.loc = pOut[b];
+    copy_out.length_1d_copy = nh * P;
+    thorir_dma_async(&copy_out, &cmd_out[b]);
+  }
+
+  for (int t = (tiles > 2 ? tiles - 2 : 0); t < tiles; t++)
+    thorir_dma_wait(&cmd_out[t & 1]);
+  pi_cl_team_barrier(0);
+}
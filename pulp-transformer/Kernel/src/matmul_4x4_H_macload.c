@@ -0,0 +1,94 @@
+/* ----------------------------------------------------------------------
+#
+# File: matmul_4x4_H_macload.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/pulp_nn_macload.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define clip8(x) __builtin_pulp_clip_r(x, 127)
+
+// matmul_4x2_S / matmul_4x2_H with 4 sequences x 4 projections per block, on
+// the NN-RF MacLoad path with XPULPNN (pulp_nn_macload.h), split over (head,
+// row quad) blocks. Same arguments and layouts: A (uint8) is [S][H][S], V is
+// [H][P][S] and the output [S][H][P].
+void __attribute__ ((noinline)) matmul_4x4_H_macload(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeight,
+  int8_t *        pOutBuffer,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul
+)
+{
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+
+  // Split the (head, row quad) blocks evenly over the cores
+  int blocks_per_head = (dim_sequence + 3) >> 2;
+  int blocks = heads * blocks_per_head;
+  int blocks_per_core = (blocks >> Log2Core) + ((blocks & (NUM_CORES-1))!=0);
+  int start_block = min(blocks_per_core * core_id, blocks);
+  int stop_block = min(start_block + blocks_per_core, blocks);
+
+  // local vars
+  int block, seq_out, proj_out, head_out, rows, cols, i, j;
+  const int8_t *pA, *pB;
+  int8_t *pOut;
+  int32_t strideA = heads * dim_sequence;
+  int32_t sum[16];
+
+  pulp_nn_macload_config(strideA, dim_sequence);
+
+  for (block = start_block; block < stop_block; block++)
+  {
+    head_out = block / blocks_per_head;
+    seq_out = 4 * (block - head_out * blocks_per_head);
+    rows = min(4, dim_sequence - seq_out);
+
+    pA = pInBuffer + seq_out * strideA + head_out * dim_sequence;
+    pB = pWeight + (head_out * dim_sequence * projections);
+    pOut = pOutBuffer + seq_out * heads * projections + head_out * projections;
+
+    for (proj_out = 0; proj_out < projections; proj_out += 4)
+    {
+      cols = min(4, projections - proj_out);
+
+      if (rows == 4 && cols == 4)
+        pulp_nn_dot_4x4(pA, strideA, pB, dim_sequence, dim_sequence, 1, sum);
+      else
+        pulp_nn_dot_rows(pA, strideA, rows, pB, dim_sequence, cols, dim_sequence, 1, sum);
+
+      for (i = 0; i < rows; i++)
+        for (j = 0; j < cols; j++)
+          pOut[i * heads * projections + j] = clip8((sum[4*i + j]*requant_mul)>>requant_div);
+
+      pB += 4 * dim_sequence;
+      pOut += 4;
+    }
+  }
+  pi_cl_team_barrier(0);
+}
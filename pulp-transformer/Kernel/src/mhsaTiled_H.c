@@ -0,0 +1,224 @@
+/* ----------------------------------------------------------------------
+#
+# File: mhsaTiled_H.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/thorir_dma.h"
+
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+// Attention of Q, K and V held in L2, streamed into L1 one head at a time:
+//
+//   Out[:, h, :] = softmax(Q_h K_h^T) V_h
+//
+// Q and K are [H][S][P] and V [H][P][S] (the linearQK_4x2_H / linearV_4x2_H
+// layouts), Out is the [S][H*P] context read by linearO_4x2_H. pL1 is
+// MHSA_TILED_L1_SIZE(S, P) bytes of L1, planned as
+//
+//   | Q, K, V tile 0 | Q, K, V tile 1 | A [S][S] | Out tile 0 | Out tile 1 |
+//
+// mhsaTiled_H_T takes V as [H][S][P] too, so all three projections can come
+// from linearQK_4x2_H. Its V tiles are transposed to [P][S] by the DMA while
+// they are loaded (thorir_dma_async_hwc_to_chw); the P commands of each V
+// tile follow the Out tiles in L1, MHSA_TILED_T_L1_SIZE(S, P) bytes in all.
+//
+// Core 0 loads the tiles of head h+1 with async DMA while all cores compute
+// head h, and stores each Out tile back with a 2D transfer while the next head
+// is computed, so only the first load and the last store are not overlapped.
+// The working set is one head instead of H, which lets shapes whose scores and
+// Q/K/V do not fit L1 together (e.g. S=81, P=32, H=8) run from L2.
+static inline __attribute__((always_inline)) void mhsaTiled(
+  const int8_t *  pQ,
+  const int8_t *  pK,
+  const int8_t *  pV,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels,
+  const int       transpose_v
+)
+{
+  int SP = dim_sequence * projections;
+  int tile_size = ALIGN4(SP);
+
+  // L1 plan, see above
+  int8_t *pTile[2][3];
+  int8_t *pOutTile[2];
+  for (int b = 0; b < 2; b++)
+  {
+    pTile[b][0] = pL1 + (3 * b + 0) * tile_size;
+    pTile[b][1] = pL1 + (3 * b + 1) * tile_size;
+    pTile[b][2] = pL1 + (3 * b + 2) * tile_size;
+  }
+  int8_t *pA = pL1 + 6 * tile_size;
+  pOutTile[0] = pA + ALIGN4(dim_sequence * dim_sequence);
+  pOutTile[1] = pOutTile[0] + tile_size;
+  thorir_dma_cmd_t *cmd_v[2];
+  cmd_v[0] = (thorir_dma_cmd_t *)(pOutTile[1] + tile_size);
+  cmd_v[1] = cmd_v[0] + projections;
+
+  const int8_t *pSrc[3] = {pQ, pK, pV};
+  DMA_copy copy_in, copy_out;
+  thorir_dma_cmd_t cmd_in[2][3], cmd_out[2];
+
+  copy_in.hwc_to_chw = 0;
+  copy_in.stride_2d = 0;
+  copy_in.number_of_2d_copies = 1;
+  copy_in.stride_1d = SP;
+  copy_in.number_of_1d_copies = 1;
+  copy_in.length_1d_copy = SP;
+  copy_in.dir = 1;
+
+  // [S][P] V tile in, [P][S] in L1
+  DMA_copy copy_v = copy_in;
+  copy_v.hwc_to_chw = 1;
+  copy_v.stride_1d = projections;
+  copy_v.number_of_1d_copies = dim_sequence;
+  copy_v.length_1d_copy = projections;
+
+  // Out tile h goes to columns [h*P, (h+1)*P) of the [S][H*P] context
+  copy_out.hwc_to_chw = 0;
+  copy_out.stride_2d = 0;
+  copy_out.number_of_2d_copies = 1;
+  copy_out.stride_1d = heads * projections;
+  copy_out.number_of_1d_copies = dim_sequence;
+  copy_out.length_1d_copy = projections;
+  copy_out.dir = 0;
+
+  for (int t = 0; t < 3; t++)
+  {
+    copy_in.ext = (void *)pSrc[t];
+    copy_in.loc = pTile[0][t];
+    if (transpose_v && t == 2)
+    {
+      copy_v.ext = copy_in.ext;
+      copy_v.loc = copy_in.loc;
+      thorir_dma_async_hwc_to_chw(&copy_v, cmd_v[0]);
+    }
+    else
+      thorir_dma_async(&copy_in, &cmd_in[0][t]);
+  }
+
+  for (int h = 0; h < heads; h++)
+  {
+    int b = h & 1;
+
+    for (int t = 0; t < 3; t++)
+    {
+      if (transpose_v && t == 2)
+        thorir_dma_wait_hwc_to_chw(&copy_v, cmd_v[b]);
+      else
+        thorir_dma_wait(&cmd_in[b][t]);
+    }
+    // Tile b^1 was last read by head h-1, which ended with a barrier
+    if (h + 1 < heads)
+    {
+      for (int t = 0; t < 3; t++)
+      {
+        copy_in.ext = (void *)(pSrc[t] + (h + 1) * SP);
+        copy_in.loc = pTile[b^1][t];
+        if (transpose_v && t == 2)
+        {
+          copy_v.ext = copy_in.ext;
+          copy_v.loc = copy_in.loc;
+          thorir_dma_async_hwc_to_chw(&copy_v, cmd_v[b^1]);
+        }
+        else
+          thorir_dma_async(&copy_in, &cmd_in[b^1][t]);
+      }
+    }
+    // Out tile b is free once the store of head h-2 is done
+    if (h >= 2)
+      thorir_dma_wait(&cmd_out[b]);
+    pi_cl_team_barrier(0);
+
+    matmulSoftmax_4x2_H(pTile[b][0], pTile[b][1], pA, dim_sequence, projections, 1, requant_div, requant_mul, coeffA, coeffB, coeffC, log2, n_levels);
+    pi_cl_team_barrier(0);
+
+    matmul_4x2_H(pA, pTile[b][2], pOutTile[b], dim_sequence, projections, 1, requant_div, requant_mul);
+    pi_cl_team_barrier(0);
+
+    copy_out.ext = pOutBuffer + h * projections;
+    copy_out.loc = pOutTile[b];
+    thorir_dma_async(&copy_out, &cmd_out[b]);
+  }
+
+  for (int h = (heads > 2 ? heads - 2 : 0); h < heads; h++)
+    thorir_dma_wait(&cmd_out[h & 1]);
+  pi_cl_team_barrier(0);
+}
+
+void __attribute__ ((noinline)) mhsaTiled_H(
+  const int8_t *  pQ,
+  const int8_t *  pK,
+  const int8_t *  pV,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+)
+{
+  mhsaTiled(pQ, pK, pV, pOutBuffer, pL1, dim_sequence, projections, heads, requant_div, requant_mul,
+            coeffA, coeffB, coeffC, log2, n_levels, 0);
+}
+
+void __attribute__ ((noinline)) mhsaTiled_H_T(
+  const int8_t *  pQ,
+  const int8_t *  pK,
+  const int8_t *  pV,
+  int8_t *        pOutBuffer,
+  int8_t *        pL1,
+  const uint16_t  dim_sequence,
+  const uint16_t  projections,
+  const uint16_t  heads,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int32_t   coeffA,
+  const int32_t   coeffB,
+  const int32_t   coeffC,
+  const int32_t   log2,
+  const uint32_t  n_levels
+)
+{
+  mhsaTiled(pQ, pK, pV, pOutBuffer, pL1, dim_sequence, projections, heads, requant_div, requant_mul,
+            coeffA, coeffB, coeffC, log2, n_levels, 1);
+}
@@ -0,0 +1,159 @@
+/* ----------------------------------------------------------------------
+#
+# File: tinyformerEncoder.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+#include "pmsis.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+
+#define min(a,b) ((a)<(b)?(a):(b))
+
+// pOut[i] = clip8(pA[i] + pB[i]) over n elements, split over the cores
+static void tinyformer_residual(const int8_t *pA, const int8_t *pB, int8_t *pOut, int n)
+{
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+  int chunk = (n >> Log2Core) + ((n & (NUM_CORES-1))!=0);
+  int start = min(chunk * core_id, n);
+  int stop = min(start + chunk, n);
+
+  for (int i = start; i < stop; i++)
+    pOut[i] = (int8_t)clips8((int32_t)pA[i] + (int32_t)pB[i]);
+  pi_cl_team_barrier(0);
+}
+
+// In-place ReLU over n elements (n a multiple of 4), split over the cores
+static void tinyformer_relu(int8_t *pInOut, int n)
+{
+  int core_id = pi_core_id();
+  int Log2Core = log2(NUM_CORES);
+  int words = n >> 2;
+  int chunk = (words >> Log2Core) + ((words & (NUM_CORES-1))!=0);
+  int start = min(chunk * core_id, words);
+  int stop = min(start + chunk, words);
+
+  v4s zero = (v4s){0, 0, 0, 0};
+  for (int i = start; i < stop; i++)
+    ((v4s *)pInOut)[i] = maxs4(((v4s *)pInOut)[i], zero);
+  pi_cl_team_barrier(0);
+}
+
+// The single-head TinyFormer encoder block of litex_port/common/tinyformer.c
+// on the cluster, from the existing 4x2 kernels:
+//
+//   X1  = X + ((softmax(Q K^T) V) Wo^T + bo),   Q/K/V = X Wq/Wk/Wv^T + b
+//   Out = X1 + (ReLU(X1 W1^T + b1) W2^T + b2)
+//
+// X and Out are [S][D] int8, Wq/Wk/Wv/Wo [D][D], W1 [F][D] and W2 [D][F]
+// (the row-major trained_weights.c arrays) with int16 biases. The
+// projections and the FFN use requant_div / requant_mul, the scores
+// score_div / score_mul before the iSoftmax (coefficients as the MHSA tests)
+// and the context, a product with the uint8 probabilities, context_div /
+// context_mul. No layerNorm, as in the RISC-V encoder.
+//
+// pScratch is TINYFORMER_PULP_SCRATCH(S, D, F) bytes of L1, planned as
+//
+//   attention: | Q [S][D] | K [S][D] | V [D][S] | A [S][S] | Ctx [S][D] |
+//   FFN:       | X1 [S][D] | G [S][F] |
+//
+// The output projection lands in Q and the residual is added in place; G
+// overwrites K, V and A once the context is consumed. The FFN runs token by
+// token through pulp_nn_linear_i8_i8_i8 (barrier inside), the FF2 output goes
+// straight to pOutBuffer and takes its residual there. S, D and F must be
+// multiples of 2*NUM_CORES (whole row pairs and even neuron chunks per core).
+void __attribute__ ((noinline)) tinyformer_encode_pulp(
+  const int8_t *  pInBuffer,
+  const int8_t *  pWeightQ,
+  const int16_t * pBiasQ,
+  const int8_t *  pWeightK,
+  const int16_t * pBiasK,
+  const int8_t *  pWeightV,
+  const int16_t * pBiasV,
+  const int8_t *  pWeightO,
+  const int16_t * pBiasO,
+  const int8_t *  pWeightFF1,
+  const int16_t * pBiasFF1,
+  const int8_t *  pWeightFF2,
+  const int16_t * pBiasFF2,
+  int8_t *        pOutBuffer,
+  int8_t *        pScratch,
+  const uint16_t  dim_sequence,
+  const uint16_t  dim_embedding,
+  const uint16_t  dim_ffn,
+  const int16_t   requant_div,
+  const int16_t   requant_mul,
+  const int16_t   score_div,
+  const int16_t   score_mul,
+  const int16_t   context_div,
+  const int16_t   context_mul
+)
+{
+  int S = dim_sequence;
+  int D = dim_embedding;
+  int F = dim_ffn;
+
+  // Scratch plan, see above
+  int8_t *pQ = pScratch;
+  int8_t *pK = pQ + S * D;
+  int8_t *pV = pK + S * D;
+  int8_t *pA = pV + D * S;
+  int8_t *pCtx = pA + S * S;
+  int8_t *pX1 = pScratch;
+  int8_t *pG = pX1 + S * D;
+
+  // 1. Q and K, [1][S][D], and V, [1][D][S]
+  linearQK_4x2_H(pInBuffer, pWeightQ, pBiasQ, pQ, S, D, D, 1, requant_div, requant_mul);
+  pi_cl_team_barrier(0);
+  linearQK_4x2_H(pInBuffer, pWeightK, pBiasK, pK, S, D, D, 1, requant_div, requant_mul);
+  pi_cl_team_barrier(0);
+  linearV_4x2_H(pInBuffer, pWeightV, pBiasV, pV, S, D, D, 1, requant_div, requant_mul);
+  pi_cl_team_barrier(0);
+
+  // 2. Scores and iSoftmax, [S][1][S] uint8
+  matmulSoftmax_4x2_S(pQ, pK, pA, S, D, 1, score_div, score_mul, 1, 7, 24, 5, 256);
+  pi_cl_team_barrier(0);
+
+  // 3. Attention context, [S][D]
+  matmul_4x2_S(pA, pV, pCtx, S, D, 1, context_div, context_mul);
+  pi_cl_team_barrier(0);
+
+  // 4. Output projection into Q, then the residual in place (barrier inside)
+  linearO_4x2_H(pCtx, pWeightO, pBiasO, pQ, S, D, D, 1, requant_div, requant_mul);
+  pi_cl_team_barrier(0);
+  tinyformer_residual(pInBuffer, pQ, pX1, S * D);
+
+  // 5. FFN expansion and ReLU, [S][F]. flag_relu only selects the
+  //    (mul * acc) >> div requant of pulp_nn_linear_i8_i8_i8, the clamp at 0
+  //    is tinyformer_relu.
+  for (int s = 0; s < S; s++)
+    pulp_nn_linear_i8_i8_i8(pX1 + s * D, (int16_t *)pBiasFF1, pG + s * F, (int8_t *)pWeightFF1,
+                            NULL, NULL, requant_mul, requant_div, D, F, 1, 0);
+  tinyformer_relu(pG, S * F);
+
+  // 6. FFN contraction and residual, [S][D] (barriers inside)
+  for (int s = 0; s < S; s++)
+    pulp_nn_linear_i8_i8_i8(pG + s * F, (int16_t *)pBiasFF2, pOutBuffer + s * D, (int8_t *)pWeightFF2,
+                            NULL, NULL, requant_mul, requant_div, F, D, 1, 0);
+  tinyformer_residual(pX1, pOutBuffer, pOutBuffer, S * D);
+}
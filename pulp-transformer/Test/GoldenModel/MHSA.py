@@ -2,7 +2,7 @@
 #
 # File: MHSA.py
 #
-# Last edited: 06.11.2023
+# Last edited: 14.10.2026
 #
 # Copyright (C) 2023, ETH Zurich and University of Bologna.
 #
@@ -28,9 +28,12 @@ from typing import Dict
 from collections import OrderedDict
 from mako.template import Template
 from mako import exceptions
+from .iGELU import GELU_PARAMS
+from .iLayerNorm import LN_LOG2D
+from tilingSolver import solve_mhsa_tiling, write_tiling_header, solve_l3_schedule, mhsa_weights, mhsa_l2_activations, L2_BUDGET_DEFAULT
 
 
-def generateTemplateMHSA(MHSAParams: Dict, requantParams: Dict, args):
+def generateTemplateMHSA(MHSAParams: Dict, requantParams: Dict, args, fusedQKV=False, pipelinedWindows=0):
 
     # Unpack params
     S = MHSAParams["S"]
@@ -70,6 +73,12 @@ def generateTemplateMHSA(MHSAParams: Dict, requantParams: Dict, args):
     templateDict['requantDiv'] = requantDiv
     templateDict['requantMul'] = requantMul
 
+    templateDict['fusedQKV'] = fusedQKV
+
+    # FC / cluster pipeline over pipelinedWindows windows (0: one run)
+    templateDict['pipelined'] = pipelinedWindows > 0
+    templateDict['windows'] = pipelinedWindows
+
     l = ""
     tmpl = Template(filename=f"./TestTemplate/MHSATemplate.c")
 
@@ -81,6 +90,14 @@ def generateTemplateMHSA(MHSAParams: Dict, requantParams: Dict, args):
     with open(f"{args.app_folder}/src/MHSA.c", "w") as f:
         f.write(s)
 
+def generateTemplateMHSAFusedQKV(MHSAParams: Dict, requantParams: Dict, args):
+    # Q, K and V projections from linearQKV_4x2_H instead of three passes
+    generateTemplateMHSA(MHSAParams, requantParams, args, fusedQKV=True)
+
+def generateTemplateMHSAPipelined(MHSAParams: Dict, requantParams: Dict, args):
+    # FC prepares window n+1 in L2 while the cluster runs window n
+    generateTemplateMHSA(MHSAParams, requantParams, args, pipelinedWindows=8)
+
 def generateTemplateMHSAFWA(MHSAParams: Dict, requantParams: Dict, args):
 
     # Unpack params
@@ -182,4 +199,272 @@ def generateTemplateMHSAPULPNN(MHSAParams: Dict, requantParams: Dict, args):
         print(exceptions.text_error_template().render())
 
     with open(f"{args.app_folder}/src/MHSAPULPNN.c", "w") as f:
-        f.write(s)
\ No newline at end of file
+        f.write(s)
+
+def generateTemplateEncoderLayerFWA(MHSAParams: Dict, requantParams: Dict, args):
+
+    # Unpack params
+    S = MHSAParams["S"]
+    E = MHSAParams["E"]
+    P = MHSAParams["P"]
+    H = MHSAParams["H"]
+    F = 4*E # FFN hidden dimension
+    requantDiv = requantParams["div"]
+    requantMul = requantParams["mul"]
+
+    templateDict = OrderedDict()
+
+    templateDict["kernelName"] = args.kernel_name
+    templateDict["testInputHeaderName"] = "testInput"
+
+    templateDict['fcFrequency'] = 370*1000*1000
+    templateDict['clFrequency'] = 370*1000*1000
+    templateDict['l2BufferSize'] = 700000
+
+    templateDict['S'] = S
+    templateDict['E'] = E
+    templateDict['P'] = P
+    templateDict['H'] = H
+    templateDict['F'] = F
+
+    # Weights, activations and the encoderLayer_FWA scratch (ENCODER_LAYER_FWA_SCRATCH), all in L1
+    sizes = OrderedDict()
+    sizes['X'] = S*E
+    sizes['WeightV'] = H*P*E
+    sizes['BiasV'] = 2*H*P # 16b bias
+    sizes['WeightFWA'] = H*E*E
+    sizes['BiasFWA'] = 2*H*E
+    sizes['WeightO'] = E*H*P
+    sizes['BiasO'] = 2*E
+    sizes['Norm1'] = 4*2*E # 32b weights and biases
+    sizes['WeightFF1'] = F*E
+    sizes['BiasFF1'] = 2*F
+    sizes['WeightFF2'] = E*F
+    sizes['BiasFF2'] = 2*E
+    sizes['Norm2'] = 4*2*E
+    sizes['Output'] = S*E
+    sizes['Scratch'] = max(H*P*S + H*S*S + H*S*max(E, S) + S*H*P, S*E + S*F)
+
+    offsets = OrderedDict()
+    offset = 0
+    for name, size in sizes.items():
+        offsets[name] = offset
+        offset += 4*math.ceil(size/4)
+    templateDict['offsets'] = offsets
+    templateDict['l1BufferSize'] = offset
+
+    templateDict['requantDiv'] = requantDiv
+    templateDict['requantMul'] = requantMul
+
+    templateDict['normLog2D'] = LN_LOG2D
+    templateDict['geluB'] = GELU_PARAMS["b"]
+    templateDict['geluOne'] = GELU_PARAMS["one"]
+    templateDict['geluTotScaler'] = GELU_PARAMS["totScaler"]
+    templateDict['geluLog2D'] = GELU_PARAMS["log2D"]
+
+    l = ""
+    tmpl = Template(filename=f"./TestTemplate/encoderLayerFWATemplate.c")
+
+    try:
+        s = tmpl.render(verbose_log=l, **templateDict)
+    except:
+        print(exceptions.text_error_template().render())
+
+    with open(f"{args.app_folder}/src/encoderLayerFWA.c", "w") as f:
+        f.write(s)
+
+def generateTemplateMHSATiled(MHSAParams: Dict, requantParams: Dict, args, transposeV=False):
+
+    # Unpack params
+    S = MHSAParams["S"]
+    E = MHSAParams["E"]
+    P = MHSAParams["P"]
+    H = MHSAParams["H"]
+    requantDiv = requantParams["div"]
+    requantMul = requantParams["mul"]
+
+    templateDict = OrderedDict()
+
+    templateDict["kernelName"] = args.kernel_name
+    templateDict["testInputHeaderName"] = "testInput"
+
+    templateDict['fcFrequency'] = 370*1000*1000
+    templateDict['clFrequency'] = 370*1000*1000
+
+    templateDict['S'] = S
+    templateDict['E'] = E
+    templateDict['P'] = P
+    templateDict['H'] = H
+
+    # Q, K, V and the attention context in L2
+    sizes = OrderedDict()
+    sizes['Q'] = H*S*P
+    sizes['K'] = H*S*P
+    sizes['V'] = H*P*S
+    sizes['Output'] = S*H*P
+
+    offsets = OrderedDict()
+    offset = 0
+    for name, size in sizes.items():
+        offsets[name] = offset
+        offset += 4*math.ceil(size/4)
+    templateDict['offsets'] = offsets
+    templateDict['l2BufferSize'] = offset
+
+    if transposeV:
+        # V as [H][S][P], transposed by the V tile DMA (mhsaTiled_H_T); its DMA
+        # commands depend on the SDK, so the C macro sizes L1
+        templateDict['runnerName'] = "mhsaTiled_H_T"
+        templateDict['l1BufferSize'] = f"MHSA_TILED_T_L1_SIZE({S}, {P})"
+    else:
+        # Two Q/K/V tiles, the scores of one head and two output tiles (MHSA_TILED_L1_SIZE)
+        templateDict['runnerName'] = "mhsaTiled_H"
+        templateDict['l1BufferSize'] = 8*4*math.ceil(S*P/4) + 4*math.ceil(S*S/4)
+
+    templateDict['requantDiv'] = requantDiv
+    templateDict['requantMul'] = requantMul
+
+    l = ""
+    tmpl = Template(filename=f"./TestTemplate/MHSATiledTemplate.c")
+
+    try:
+        s = tmpl.render(verbose_log=l, **templateDict)
+    except:
+        print(exceptions.text_error_template().render())
+
+    with open(f"{args.app_folder}/src/MHSATiled.c", "w") as f:
+        f.write(s)
+
+
+def generateTemplateMHSATiledT(MHSAParams: Dict, requantParams: Dict, args):
+    generateTemplateMHSATiled(MHSAParams, requantParams, args, transposeV=True)
+
+
+def generateTemplateMHSATiledLayers(MHSAParams: Dict, requantParams: Dict, args, l1Budget=120000):
+
+    # Unpack params
+    S = MHSAParams["S"]
+    E = MHSAParams["E"]
+    P = MHSAParams["P"]
+    H = MHSAParams["H"]
+    requantDiv = requantParams["div"]
+    requantMul = requantParams["mul"]
+
+    templateDict = OrderedDict()
+
+    templateDict["kernelName"] = args.kernel_name
+    templateDict["testInputHeaderName"] = "testInput"
+
+    templateDict['fcFrequency'] = 370*1000*1000
+    templateDict['clFrequency'] = 370*1000*1000
+
+    templateDict['S'] = S
+    templateDict['E'] = E
+    templateDict['P'] = P
+    templateDict['H'] = H
+
+    # Operands of the four layers in L2
+    sizes = OrderedDict()
+    sizes['X'] = S*E
+    sizes['Wqk'] = H*P*E
+    sizes['Bqk'] = 2*H*P # 16b bias
+    sizes['V'] = H*S*P
+    sizes['Wfwa'] = H*E*E
+    sizes['Bfwa'] = 2*H*E # 16b bias
+    sizes['A'] = H*S*S
+    sizes['Context'] = S*H*P
+    sizes['Wo'] = E*H*P
+    sizes['Bo'] = 2*E # 16b bias
+    sizes['Output'] = S*E
+
+    offsets = OrderedDict()
+    offset = 0
+    for name, size in sizes.items():
+        offsets[name] = offset
+        offset += 4*math.ceil(size/4)
+    templateDict['offsets'] = offsets
+    templateDict['l2BufferSize'] = offset
+
+    # Tile sizes and the L1 buffer they need (mhsa_tiling.h)
+    tiling = solve_mhsa_tiling(S, E, P, H, l1Budget)
+    write_tiling_header(tiling, S, E, P, H, l1Budget, f"{args.app_folder}/inc/mhsa_tiling.h")
+
+    templateDict['requantDiv'] = requantDiv
+    templateDict['requantMul'] = requantMul
+
+    l = ""
+    tmpl = Template(filename=f"./TestTemplate/MHSATiledLayersTemplate.c")
+
+    try:
+        s = tmpl.render(verbose_log=l, **templateDict)
+    except:
+        print(exceptions.text_error_template().render())
+
+    with open(f"{args.app_folder}/src/MHSATiledLayers.c", "w") as f:
+        f.write(s)
+
+
+def generateTemplateMHSALayersL3(MHSAParams: Dict, requantParams: Dict, args, layers=8, l1Budget=120000, l2Budget=L2_BUDGET_DEFAULT):
+
+    # Unpack params
+    S = MHSAParams["S"]
+    E = MHSAParams["E"]
+    P = MHSAParams["P"]
+    H = MHSAParams["H"]
+    requantDiv = requantParams["div"]
+    requantMul = requantParams["mul"]
+
+    templateDict = OrderedDict()
+
+    templateDict["kernelName"] = args.kernel_name
+    templateDict["testInputHeaderName"] = "testInput"
+
+    templateDict['fcFrequency'] = 370*1000*1000
+    templateDict['clFrequency'] = 370*1000*1000
+
+    templateDict['S'] = S
+    templateDict['E'] = E
+    templateDict['P'] = P
+    templateDict['H'] = H
+
+    # L1 tiles as MHSATiledLayers, then the weight prefetch from L3 for the
+    # activations and the two weight slots in L2 (mhsa_tiling.h)
+    tiling = solve_mhsa_tiling(S, E, P, H, l1Budget)
+    l3 = solve_l3_schedule(S, E, P, H, layers, tiling, mhsa_l2_activations(S, E, P, H), l2Budget)
+    write_tiling_header(tiling, S, E, P, H, l1Budget, f"{args.app_folder}/inc/mhsa_tiling.h", l3, layers)
+
+    # Activations and the two weight slots in L2; the weights of every layer in L3
+    weights = mhsa_weights(E, P, H)
+    templateDict['weights'] = weights
+    templateDict['layerWeights'] = sum(4*math.ceil(size/4) for _, size in weights.values())
+
+    sizes = OrderedDict()
+    sizes['X'] = S*E
+    sizes['V'] = H*S*P
+    sizes['A'] = H*S*S
+    sizes['Context'] = S*H*P
+    sizes['Output'] = S*E
+    sizes['Slot0'] = l3['slot']
+    sizes['Slot1'] = l3['slot']
+
+    offsets = OrderedDict()
+    offset = 0
+    for name, size in sizes.items():
+        offsets[name] = offset
+        offset += 4*math.ceil(size/4)
+    templateDict['offsets'] = offsets
+    templateDict['l2BufferSize'] = offset
+
+    templateDict['requantDiv'] = requantDiv
+    templateDict['requantMul'] = requantMul
+
+    l = ""
+    tmpl = Template(filename=f"./TestTemplate/MHSALayersL3Template.c")
+
+    try:
+        s = tmpl.render(verbose_log=l, **templateDict)
+    except:
+        print(exceptions.text_error_template().render())
+
+    with open(f"{args.app_folder}/src/MHSALayersL3.c", "w") as f:
+        f.write(s)
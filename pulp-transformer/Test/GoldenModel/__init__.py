@@ -1,6 +1,11 @@
 from .linearProjection import *
 from .matmulSoftmaxM1 import *
 from .matmulM2 import *
+from .linearAttention import *
 from .iSoftmax import *
+from .iGELU import *
+from .iLayerNorm import *
 from .fusedWeightAttention import *
-from .MHSA import *
\ No newline at end of file
+from .MHSA import *
+from .armKernels import *
+from .tinyformer import *
\ No newline at end of file
@@ -0,0 +1,75 @@
+# ----------------------------------------------------------------------
+#
+# File: armKernels.py
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from collections import OrderedDict
+from mako.template import Template
+from mako import exceptions
+from typing import Dict
+
+
+def armKernelCall(kernelName, MHSAParams: Dict, requantParams: Dict):
+
+    # Arguments (after the output), output size and type of each Kernel/ARM kernel
+    S = MHSAParams["S"]
+    E = MHSAParams["E"]
+    P = MHSAParams["P"]
+    H = MHSAParams["H"]
+    requant = f"{requantParams['div']}, {requantParams['mul']}"
+
+    linear = "testInputVectorInput, testInputVectorWeight, testInputVectorBias, (int8_t *)O"
+    matmul = "testInputVectorA, testInputVectorB, (int8_t *)O"
+
+    kernels = {
+        "linearQK_4x2_H": (f"{linear}, {S}, {E}, {P}, {H}, {requant}", S*P*H, "int8_t"),
+        "linearV_4x2_H": (f"{linear}, {S}, {E}, {P}, {H}, {requant}", S*P*H, "int8_t"),
+        "linearO_4x2_H": (f"{linear}, {S}, {E}, {P}, {H}, {requant}", S*E, "int8_t"),
+        "matmulSoftmax_4x2_S": (f"{matmul}, {S}, {P}, {H}, {requant}, 1, 7, 24, 5, 256", H*S*S, "uint8_t"),
+        "matmul_4x2_S": (f"{matmul}, {S}, {P}, {H}, {requant}", H*S*P, "int8_t"),
+    }
+
+    if kernelName not in kernels:
+        raise ValueError(f"{kernelName} has no Cortex-M version in Kernel/ARM")
+
+    return kernels[kernelName]
+
+def generateTemplateARM(MHSAParams: Dict, requantParams: Dict, args):
+
+    kernelArgs, outputSize, outputType = armKernelCall(args.kernel_name, MHSAParams, requantParams)
+
+    templateDict = OrderedDict()
+
+    templateDict["kernelName"] = args.kernel_name
+    templateDict["testInputHeaderName"] = "testInput"
+    templateDict["kernelArgs"] = kernelArgs
+    templateDict["outputSize"] = outputSize
+    templateDict["outputType"] = outputType
+
+    l = ""
+    tmpl = Template(filename=f"./TestTemplate/ARMKernelTemplate.c")
+
+    try:
+        s = tmpl.render(verbose_log=l, **templateDict)
+    except:
+        print(exceptions.text_error_template().render())
+
+    with open(f"{args.app_folder}/src/armKernelTest.c", "w") as f:
+        f.write(s)
@@ -2,7 +2,7 @@
 #
 # File: fusedWeightAttention.py
 #
-# Last edited: 23.10.2023
+# Last edited: 14.10.2026
 #
 # Copyright (C) 2023, ETH Zurich and University of Bologna.
 #
@@ -27,7 +27,7 @@
 
 import torch
 import math
-from .iSoftmax import ibertSoftmax
+from .iSoftmax import ibertSoftmax, ibertSoftmaxCausal
 from typing import Dict
 from collections import OrderedDict
 from mako.template import Template
@@ -99,7 +99,7 @@ def generateTemplateFWA(MHSAParams: Dict, requantParams: Dict, args):
     with open(f"{args.app_folder}/src/matmulSoftmaxFWA.c", "w") as f:
         f.write(s)
 
-def matmulSoftmaxFWA(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+def matmulSoftmaxFWA(inputDict: Dict, requantParams: Dict, MHSAParams: Dict, causal=False):
 
     # Unpack inputs and parameters
     I = inputDict["I"]["data"]
@@ -114,20 +114,16 @@ def matmulSoftmaxFWA(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
 
     W = W.transpose(1, 2)
 
-    output = []
-    for i in range(H):
-        I_star = torch.matmul(I, W[i, :, :])
-        for s in range(S):
-            I_star[s][:] += B[i][:]
+    # All heads in one pass: I [S][E] broadcast against W [H][E][P]
+    I_star = torch.matmul(I, W)
+    I_star += B.unsqueeze(1)
 
-        I_star = torch.floor((I_star * pre_proj_requant_mul)/(2**pre_proj_requant_div))
-        I_star = torch.clip(I_star, -128, 127).type(torch.LongTensor)
-        A = torch.matmul( I_star, I.transpose(0, 1))
-        A = torch.floor((A * post_proj_requant_mul)/(2**post_proj_requant_div))
-        A = torch.clip(A, -128, 127)
-        output.append(ibertSoftmax(A))
-
-    A = torch.stack(output)
+    I_star = torch.floor((I_star * pre_proj_requant_mul)/(2**pre_proj_requant_div))
+    I_star = torch.clip(I_star, -128, 127).type(torch.LongTensor)
+    A = torch.matmul( I_star, I.transpose(0, 1))
+    A = torch.floor((A * post_proj_requant_mul)/(2**post_proj_requant_div))
+    A = torch.clip(A, -128, 127)
+    A = ibertSoftmaxCausal(A) if causal else ibertSoftmax(A)
 
     # Special layout for the output: head interleaved fashioned
     # out = torch.zeros((H*S, S), dtype=torch.int8)
@@ -136,4 +132,7 @@ def matmulSoftmaxFWA(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
     #         out[s*H + h, :] = A[h, s, :]
 
     out = A
-    return out.to(torch.uint8)
\ No newline at end of file
+    return out.to(torch.uint8)
+
+def matmulSoftmaxFWACausal(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+    return matmulSoftmaxFWA(inputDict, requantParams, MHSAParams, causal=True)
\ No newline at end of file
@@ -0,0 +1,20 @@
+import torch
+
+# i-GELU constants of the fused-epilogue tests (pulp_nn_i_gelu_i8): input
+# scale 1/32, I-BERT a = -0.2888 and b = -1.769 for erf(x/sqrt(2)), output
+# in the input scale
+GELU_PARAMS = {"b": -81, "one": 7091, "totScaler": 37, "log2D": 18}
+
+
+def iGELU(x, b, one, totScaler, log2D):
+
+    # Integer arithmetic of pulp_nn_gelu_i8_i8 (shifts are arithmetic)
+    x = x.type(torch.int64)
+    sign = torch.sign(x)
+    q = torch.clip(torch.abs(x), max=-b)
+    d = q + b
+    L = sign * (-(d*d) + one)
+    y = (x * (one + L)) >> 1
+    out = torch.clip((y * totScaler) >> log2D, -128, 127)
+
+    return out
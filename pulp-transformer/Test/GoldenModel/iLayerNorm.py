@@ -0,0 +1,19 @@
+import torch
+
+# Output shift of the fused-epilogue layerNorm test (pulp_nn_layernorm_i8_i8)
+LN_LOG2D = 8
+
+
+def iLayerNorm(x, weight, bias, log2D):
+
+    # Integer layerNorm over the last dimension as pulp_nn_layernorm_i8_i8:
+    # C divisions truncate toward zero and the int8 store wraps
+    x = x.type(torch.int64)
+    n = x.shape[-1]
+    mean = torch.div(torch.sum(x, -1, keepdim=True), n, rounding_mode='trunc')
+    var = torch.div(torch.sum((x - mean)**2, -1, keepdim=True), n, rounding_mode='trunc') + 1
+    std = torch.floor(torch.sqrt(var.type(torch.float64))).type(torch.int64)
+    y = (torch.div((x - mean) * weight, std, rounding_mode='trunc') + bias) >> log2D
+    out = ((y + 128) % 256) - 128
+
+    return out
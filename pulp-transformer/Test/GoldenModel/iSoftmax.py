@@ -1,7 +1,7 @@
 import torch
 
 
-def ibertSoftmax(x):
+def ibertSoftmax(x, mask=None):
 
     coeffA = 1
     coeffB = 7
@@ -10,12 +10,28 @@ def ibertSoftmax(x):
     n_levels = torch.Tensor((256,))
     zero = torch.Tensor((0.,))
 
+    # Masked keys (mask False) are held at the row max, so they stay finite,
+    # and then dropped from the sum; each row needs one unmasked key
+    if mask is not None:
+        x = torch.where(mask, x, x.min())
+        x = torch.where(mask, x, torch.max(x, dim=-1, keepdim=True)[0])
+
     xTilde = (x - torch.max(x, dim=-1, keepdim=True)[0])
     z = torch.floor(-xTilde / log2)
     p = xTilde + z * log2
     y = torch.floor(((coeffA*(p + coeffB)**2 + coeffC)) // (2**z))
+    if mask is not None:
+        y = torch.where(mask, y, torch.zeros_like(y))
     ysum = torch.sum(y, -1, keepdim=True)
     norm = torch.floor(y*(n_levels-1)/(ysum))
     out = torch.clip(norm, zero, n_levels-1)
 
-    return out
\ No newline at end of file
+    return out
+
+
+def ibertSoftmaxCausal(x):
+
+    # Row i over the keys j <= i only, the masked keys get 0; all rows (and
+    # heads) in one pass
+    mask = torch.ones(x.shape[-2], x.shape[-1], dtype=torch.bool).tril()
+    return ibertSoftmax(x, mask)
@@ -0,0 +1,125 @@
+# ----------------------------------------------------------------------
+#
+# File: linearAttention.py
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+ 
+
+import torch
+import math
+from typing import Dict
+from collections import OrderedDict
+from mako.template import Template
+from mako import exceptions
+
+
+def generateInputsLinearAttention(S, E, P, H):
+
+    # Q as linearQK_4x2_H writes it ([H][S][P]), K and V as linearV_4x2_H ([H][P][S])
+    Q = torch.randint(low=-128, high=127, size=(H, S, P))
+    K = torch.randint(low=-128, high=127, size=(H, P, S))
+    V = torch.randint(low=-128, high=127, size=(H, P, S))
+
+    return {"Q": {"data": Q, "type": "int8_t"},
+            "K": {"data": K, "type": "int8_t"},
+            "V": {"data": V, "type": "int8_t"}}
+
+def generateTemplateLinearAttention(MHSAParams: Dict, requantParams: Dict, args):
+
+    # Unpack params
+    S = MHSAParams["S"]
+    E = MHSAParams["E"]
+    P = MHSAParams["P"]
+    H = MHSAParams["H"]
+
+    templateDict = OrderedDict()
+
+    templateDict["kernelName"] = args.kernel_name
+    templateDict["testInputHeaderName"] = "testInput"
+
+    templateDict['fcFrequency'] = 100000000
+    templateDict['clFrequency'] = 100000000
+    templateDict['l2BufferSize'] = 700000
+    templateDict['l1BufferSize'] = 400000
+
+    templateDict['S'] = S
+    templateDict['E'] = E
+    templateDict['P'] = P
+    templateDict['H'] = H
+
+    templateDict['sizeQ'] = H*S*P
+    templateDict['outputSize'] = H*S*P
+    templateDict['scratchSize'] = 4*H*P*(P + 1) # LINEAR_ATTENTION_L1_SIZE(P, H)
+
+    templateDict['dmaTransferSize'] = 64
+    templateDict['numberOfTransferQ'] = math.ceil(templateDict['sizeQ']/templateDict['dmaTransferSize'])
+
+    templateDict['vectorNameQ'] = "testInputVectorQ"
+    templateDict['vectorNameK'] = "testInputVectorK"
+    templateDict['vectorNameV'] = "testInputVectorV"
+
+    if args.perf_cnt is None:
+        templateDict['perf_counter'] = 'PI_PERF_ACTIVE_CYCLES'
+    else:
+        templateDict['perf_counter'] = args.perf_cnt
+
+    l = ""
+    tmpl = Template(filename=f"./TestTemplate/linearAttentionTemplate.c")
+
+    try:
+        s = tmpl.render(verbose_log=l, **templateDict)
+    except:
+        print(exceptions.text_error_template().render())
+
+    with open(f"{args.app_folder}/src/linearAttention.c", "w") as f:
+        f.write(s)
+
+def linearAttention(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+
+    # Unpack inputs and parameters
+    Q = inputDict["Q"]["data"].to(torch.int64)
+    K = inputDict["K"]["data"].to(torch.int64)
+    V = inputDict["V"]["data"].to(torch.int64)
+    S = MHSAParams["S"]
+    P = MHSAParams["P"]
+    H = MHSAParams["H"]
+
+    # ReLU feature map: KV = relu(K)^T V and z = sum_j relu(k_j), per head
+    Q = torch.clamp(Q, min=0)
+    K = torch.clamp(K, min=0)
+    KV = torch.matmul(K, V.transpose(1, 2))
+    z = K.sum(dim=2)
+
+    num = torch.matmul(Q, KV)
+    den = (Q * z.unsqueeze(1)).sum(dim=2, keepdim=True)
+
+    # Both shifted right until den < 2^24, then a truncating division
+    sh = torch.zeros_like(den)
+    for t in range(40):
+        sh += (den >= 2**(24 + t)).to(torch.int64)
+    num = num >> sh
+    den = den >> sh
+    out = torch.div(num, torch.clamp(den, min=1), rounding_mode='trunc')
+    out = torch.where(den > 0, out, torch.zeros_like(out))
+    out = torch.clip(out, -128, 127)
+
+    # Special layout for the output: head interleaved fashioned, [S*H][P]
+    out = out.permute(1, 0, 2).reshape(S*H, P).to(torch.int8)
+
+    return out
@@ -29,6 +29,8 @@ from collections import OrderedDict
 from mako.template import Template
 from mako import exceptions
 from typing import Dict
+from .iGELU import iGELU, GELU_PARAMS
+from .iLayerNorm import iLayerNorm, LN_LOG2D
 
 def generateInputsQKV(S, E, P, H):
 
@@ -43,6 +45,20 @@ def generateInputsQKV(S, E, P, H):
             "Weight": {"data": W, "type": "int8_t"}, 
             "Bias": {"data": B, "type": "int16_t"}}
 
+def generateInputsQKVFused(S, E, P, H):
+
+    bias_low = -2**15
+    bias_high = 2**15 - 1
+
+    # Stacked projections: rows [0, P*H) are Q, then K, then V
+    I = torch.randint(low=-128, high=127, size=(S, E))
+    W = torch.randint(low=-128, high=127, size=(3*P*H, E))
+    B = torch.randint(low=bias_low, high=bias_high, size=(3*P*H,))
+
+    return {"Input": {"data": I, "type": "int8_t"}, 
+            "Weight": {"data": W, "type": "int8_t"}, 
+            "Bias": {"data": B, "type": "int16_t"}}
+
 def generateInputsO(S, E, P, H):
 
     bias_low = -2**15
@@ -56,7 +72,47 @@ def generateInputsO(S, E, P, H):
             "Weight": {"data": W, "type": "int8_t"}, 
             "Bias": {"data": B, "type": "int16_t"}}
 
-def generateTemplateQKV(MHSAParams: Dict, requantParams: Dict, args):
+def packInt4(W):
+    # Rows of int4 values, 8 per word: byte k of a word holds element k in its
+    # low nibble and element k + 4 in its high nibble (unpackLow4 / unpackHigh4)
+    R, L = W.shape
+    W = W.reshape(R, L // 8, 2, 4)
+    packed = (W[:, :, 0, :] & 0xF) | ((W[:, :, 1, :] & 0xF) << 4)
+    packed = torch.where(packed > 127, packed - 256, packed)
+    return packed.reshape(R, L // 2)
+
+def unpackInt4(W):
+    R, L = W.shape
+    W = W.reshape(R, L // 4, 1, 4)
+    low = ((W & 0xF) ^ 8) - 8
+    high = W >> 4
+    return torch.cat((low, high), dim=2).reshape(R, 2 * L)
+
+def generateInputsInt4(inputDict: Dict):
+    # Same tensors with int4 weights, packed into the int8_t weight header
+    W = inputDict["Weight"]["data"]
+    W = torch.randint(low=-8, high=8, size=W.shape)
+    inputDict["Weight"] = {"data": packInt4(W), "type": "int8_t"}
+    return inputDict
+
+def generateInputsQKVW4(S, E, P, H):
+    return generateInputsInt4(generateInputsQKV(S, E, P, H))
+
+def generateInputsOW4(S, E, P, H):
+    return generateInputsInt4(generateInputsO(S, E, P, H))
+
+def generateInputsOLayerNorm(S, E, P, H):
+
+    inputDict = generateInputsO(S, E, P, H)
+
+    # layerNorm weights then biases, packed as pulp_nn_layernorm_i8_i8 expects
+    gamma = torch.randint(low=-2**12, high=2**12, size=(E,))
+    beta = torch.randint(low=-2**14, high=2**14, size=(E,))
+    inputDict["NormWeight"] = {"data": torch.cat((gamma, beta)), "type": "int32_t"}
+
+    return inputDict
+
+def generateTemplateQKV(MHSAParams: Dict, requantParams: Dict, args, stacked=1, weightBits=8):
 
     # Unpack params
     S = MHSAParams["S"]
@@ -82,9 +138,9 @@ def generateTemplateQKV(MHSAParams: Dict, requantParams: Dict, args):
     templateDict['H'] = H
 
     templateDict['inputSize'] = S*E
-    templateDict['weightSize'] = P*H*E
-    templateDict['biasSize'] = 2*P*H # 16b bias
-    templateDict['outputSize'] = S*P*H
+    templateDict['weightSize'] = stacked*P*H*E*weightBits//8
+    templateDict['biasSize'] = stacked*2*P*H # 16b bias
+    templateDict['outputSize'] = stacked*S*P*H
 
     templateDict['dmaTransferSize'] = 64
     templateDict['numberOfInputTransfer'] = math.ceil(templateDict['inputSize']/templateDict['dmaTransferSize'])
@@ -97,6 +153,9 @@ def generateTemplateQKV(MHSAParams: Dict, requantParams: Dict, args):
     templateDict['requantDiv'] = requantDiv
     templateDict['requantMul'] = requantMul
 
+    templateDict['normWeightSize'] = 0
+    templateDict['epilogueArgs'] = ""
+
     if args.perf_cnt is None:
         templateDict['perf_counter'] = 'PI_PERF_ACTIVE_CYCLES'
     else:
@@ -113,7 +172,11 @@ def generateTemplateQKV(MHSAParams: Dict, requantParams: Dict, args):
     with open(f"{args.app_folder}/src/linearProjQKVTest.c", "w") as f:
         f.write(s)
 
-def generateTemplateO(MHSAParams: Dict, requantParams: Dict, args):
+def generateTemplateQKVFused(MHSAParams: Dict, requantParams: Dict, args):
+    # Q, K and V weights, biases and outputs stacked in one buffer each
+    generateTemplateQKV(MHSAParams, requantParams, args, stacked=3)
+
+def generateTemplateO(MHSAParams: Dict, requantParams: Dict, args, normLog2D=None, weightBits=8):
 
     # Unpack params
     S = MHSAParams["S"]
@@ -139,7 +202,7 @@ def generateTemplateO(MHSAParams: Dict, requantParams: Dict, args):
     templateDict['H'] = H
 
     templateDict['inputSize'] = S*P*H
-    templateDict['weightSize'] = P*H*E
+    templateDict['weightSize'] = P*H*E*weightBits//8
     templateDict['biasSize'] = 2*E # 16b bias
     templateDict['outputSize'] = S*E
 
@@ -154,6 +217,15 @@ def generateTemplateO(MHSAParams: Dict, requantParams: Dict, args):
     templateDict['requantDiv'] = requantDiv
     templateDict['requantMul'] = requantMul
 
+    # Fused layerNorm epilogue (linearO_4x2_H_LN): weights DMAed after the output
+    if normLog2D is None:
+        templateDict['normWeightSize'] = 0
+        templateDict['epilogueArgs'] = ""
+    else:
+        templateDict['normWeightSize'] = 4*2*E # 32b weights and biases
+        templateDict['normWeightVectorName'] = "testInputVectorNormWeight"
+        templateDict['epilogueArgs'] = f", N, {normLog2D}, NULL"
+
     if args.perf_cnt is None:
         templateDict['perf_counter'] = 'PI_PERF_ACTIVE_CYCLES'
     else:
@@ -170,7 +242,16 @@ def generateTemplateO(MHSAParams: Dict, requantParams: Dict, args):
     with open(f"{args.app_folder}/src/linearProjQKVTest.c", "w") as f:
         f.write(s)
 
-def generateTemplateProjPULPNN(MHSAParams: Dict, requantParams: Dict, args):
+def generateTemplateOLayerNorm(MHSAParams: Dict, requantParams: Dict, args):
+    generateTemplateO(MHSAParams, requantParams, args, normLog2D=LN_LOG2D)
+
+def generateTemplateQKVW4(MHSAParams: Dict, requantParams: Dict, args):
+    generateTemplateQKV(MHSAParams, requantParams, args, weightBits=4)
+
+def generateTemplateOW4(MHSAParams: Dict, requantParams: Dict, args):
+    generateTemplateO(MHSAParams, requantParams, args, weightBits=4)
+
+def generateTemplateProjPULPNN(MHSAParams: Dict, requantParams: Dict, args, gelu=False, weightBits=8):
 
     # Unpack params
     S = MHSAParams["S"]
@@ -196,7 +277,7 @@ def generateTemplateProjPULPNN(MHSAParams: Dict, requantParams: Dict, args):
     templateDict['H'] = H
 
     templateDict['inputSize'] = S*E
-    templateDict['weightSize'] = P*H*E
+    templateDict['weightSize'] = P*H*E*weightBits//8
     templateDict['biasSize'] = 2*P*H # 16b bias
     templateDict['outputSize'] = S*P*H
 
@@ -211,6 +292,12 @@ def generateTemplateProjPULPNN(MHSAParams: Dict, requantParams: Dict, args):
     templateDict['requantDiv'] = requantDiv
     templateDict['requantMul'] = requantMul
 
+    # Fused i-GELU epilogue (pulp_nn_linear_gelu_i8_i8_i8)
+    if gelu:
+        templateDict['epilogueArgs'] = ", {b}, {one}, {totScaler}, {log2D}".format(**GELU_PARAMS)
+    else:
+        templateDict['epilogueArgs'] = ""
+
     l = ""
     tmpl = Template(filename=f"./TestTemplate/linearProjQKVTemplatePULPNN.c")
 
@@ -222,6 +309,12 @@ def generateTemplateProjPULPNN(MHSAParams: Dict, requantParams: Dict, args):
     with open(f"{args.app_folder}/src/linearProjQKVTestPULPNN.c", "w") as f:
         f.write(s)
 
+def generateTemplateProjGELUPULPNN(MHSAParams: Dict, requantParams: Dict, args):
+    generateTemplateProjPULPNN(MHSAParams, requantParams, args, gelu=True)
+
+def generateTemplateProjW4PULPNN(MHSAParams: Dict, requantParams: Dict, args):
+    generateTemplateProjPULPNN(MHSAParams, requantParams, args, weightBits=4)
+
 def linearProjection(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
 
     # Unpack inputs and parameters
@@ -237,8 +330,7 @@ def linearProjection(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
     # VJ: Our kernel takes the transpose of W as input
     O = torch.matmul(I, torch.transpose(W,0,1))
 
-    for i in range(S):
-        O[i][:] += B
+    O += B
 
     O = torch.floor((O * requantMul)/(2**requantDiv))
     O = torch.clip(O, -128, 127)
@@ -259,6 +351,21 @@ def linearProjectionV(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
         O = torch.unsqueeze(O, 0)
     return torch.transpose(O, 1, 2)
 
+def linearProjectionQKV(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+
+    # Split the stacked weights and biases, Q and K as [H][S][P], V as [H][P][S]
+    W = torch.chunk(inputDict["Weight"]["data"], 3, dim=0)
+    B = torch.chunk(inputDict["Bias"]["data"], 3, dim=0)
+
+    O = []
+    for i, goldenKernel in enumerate([linearProjectionQK, linearProjectionQK, linearProjectionV]):
+        projDict = {"Input": inputDict["Input"], 
+                    "Weight": {"data": W[i], "type": "int8_t"}, 
+                    "Bias": {"data": B[i], "type": "int16_t"}}
+        O.append(goldenKernel(projDict, requantParams, MHSAParams).flatten())
+
+    return torch.cat(O)
+
 def linearProjectionO(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
 
     # Unpack inputs and parameters
@@ -274,8 +381,7 @@ def linearProjectionO(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
     # VJ: Our kernel takes the transpose of W as input
     O = torch.matmul(I, torch.transpose(W,0,1))
 
-    for i in range(S):
-        O[i][:] += B
+    O += B
 
     O = torch.floor((O * requantMul)/(2**requantDiv))
     O = torch.clip(O, -128, 127)
@@ -297,14 +403,48 @@ def linearProjectionPULPNN(inputDict: Dict, requantParams: Dict, MHSAParams: Dic
     # VJ: Our kernel takes the transpose of W as input
     O = torch.matmul(I, torch.transpose(W,0,1))
 
-    for i in range(S):
-        O[i][:] += B
+    O += B
 
     O = torch.floor((O * requantMul)/(2**requantDiv))
     O = torch.clip(O, -128, 127)
     O = O.type(torch.IntTensor)
     return O
 
+def linearProjectionOLayerNorm(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+
+    E = MHSAParams["E"]
+    NW = inputDict["NormWeight"]["data"]
+
+    O = linearProjectionO(inputDict, requantParams, MHSAParams)
+    O = iLayerNorm(O, NW[:E], NW[E:], LN_LOG2D)
+    O = O.type(torch.IntTensor)
+    return O
+
+def unpackedWeights(inputDict: Dict):
+    # Golden models of the int4-weight kernels: the int8 ones on the unpacked weights
+    unpackedDict = dict(inputDict)
+    unpackedDict["Weight"] = {"data": unpackInt4(inputDict["Weight"]["data"]), "type": "int8_t"}
+    return unpackedDict
+
+def linearProjectionQKW4(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+    return linearProjectionQK(unpackedWeights(inputDict), requantParams, MHSAParams)
+
+def linearProjectionVW4(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+    return linearProjectionV(unpackedWeights(inputDict), requantParams, MHSAParams)
+
+def linearProjectionOW4(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+    return linearProjectionO(unpackedWeights(inputDict), requantParams, MHSAParams)
+
+def linearProjectionW4PULPNN(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+    return linearProjectionPULPNN(unpackedWeights(inputDict), requantParams, MHSAParams)
+
+def linearProjectionGELUPULPNN(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+
+    O = linearProjectionPULPNN(inputDict, requantParams, MHSAParams)
+    O = iGELU(O, **GELU_PARAMS)
+    O = O.type(torch.IntTensor)
+    return O
+
 def generateInputsOPULPNN(S, E, P, H):
 
     bias_low = -2**15
@@ -335,8 +475,7 @@ def linearProjectionOPULPNN(inputDict: Dict, requantParams: Dict, MHSAParams: Di
     # VJ: Our kernel takes the transpose of W as input
     O = torch.matmul(I, torch.transpose(W,0,1))
 
-    for i in range(S):
-        O[i][:] += B
+    O += B
 
     O = torch.floor((O * requantMul)/(2**requantDiv))
     O = torch.clip(O, -128, 127)
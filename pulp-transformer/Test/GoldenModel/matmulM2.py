@@ -112,30 +112,20 @@ def matmulM2(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
 
     V = V.transpose(1, 2)
 
-    # Special layout for the input: head interleaved fashioned
-    A2 = torch.zeros((H, S, S))
-    for s in range(S):
-        for h in range(H):
-            A2[h, s, :] = A[s*H + h, :]
-    A = A2.to(torch.int64)
+    # Special layout for the input: head interleaved fashioned, [S*H][S]
+    A = A.reshape(S, H, S).permute(1, 0, 2).to(torch.int64, copy=True)
 
     # Convert A to uint8
     mask = A < 0
     A[mask] += 256
 
-    output = []
-    for i in range(H):
-        output.append(torch.matmul(A[i, :, :], V[i, :, :]))
-        output[i] = torch.floor((output[i] * requant_mul)/(2**requant_div))
-        output[i] = torch.clip(output[i], -128, 127)
+    # All heads in one batched matmul
+    A = torch.matmul(A, V)
+    A = torch.floor((A * requant_mul)/(2**requant_div))
+    A = torch.clip(A, -128, 127)
 
-    A = torch.stack(output)
-
-    # Special layout for the output: head interleaved fashioned
-    out = torch.zeros((H*S, P), dtype=torch.int8)
-    for s in range(S):
-        for h in range(H):
-            out[s*H + h, :] = A[h, s, :]
+    # Special layout for the output: head interleaved fashioned, [S*H][P]
+    out = A.permute(1, 0, 2).reshape(S*H, P).to(torch.int8)
 
     return out
 
@@ -225,12 +215,8 @@ def matmulM2PULPNN(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
     # mask = A < 0
     # A[mask] += 256
 
-    output = []
-    for i in range(H):
-        output.append(torch.matmul(A[i, :, :], V[i, :, :]))
-        output[i] = torch.floor((output[i] * requant_mul)/(2**requant_div))
-        output[i] = torch.clip(output[i], -128, 127)
-
-    A = torch.stack(output)
+    A = torch.matmul(A, V)
+    A = torch.floor((A * requant_mul)/(2**requant_div))
+    A = torch.clip(A, -128, 127)
     
     return A
\ No newline at end of file
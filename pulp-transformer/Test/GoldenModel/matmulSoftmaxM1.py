@@ -2,7 +2,7 @@
 #
 # File: gemmSoftmax.py
 #
-# Last edited: 14.09.2023
+# Last edited: 14.10.2026
 #
 # Copyright (C) 2023, ETH Zurich and University of Bologna.
 #
@@ -26,7 +26,7 @@
 
 import torch
 import math
-from .iSoftmax import ibertSoftmax
+from .iSoftmax import ibertSoftmax, ibertSoftmaxCausal
 from typing import Dict
 from collections import OrderedDict
 from mako.template import Template
@@ -99,7 +99,7 @@ def generateTemplateM1(MHSAParams: Dict, requantParams: Dict, args):
     with open(f"{args.app_folder}/src/matmulSoftmaxM1.c", "w") as f:
         f.write(s)
 
-def matmulSoftmaxM1(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+def matmulSoftmaxM1(inputDict: Dict, requantParams: Dict, MHSAParams: Dict, causal=False):
 
     # Unpack inputs and parameters
     Q = inputDict["A"]["data"]
@@ -110,25 +110,21 @@ def matmulSoftmaxM1(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
     H = MHSAParams["H"]
 
     K = torch.transpose(K,1,2)
-    
-    output_head_list = []
-    output = []
-    for i in range(H):
-        output_head_list.append(torch.matmul(Q[i, :, :], K[i, :, :]))
-        output_head_list[i] = torch.floor((output_head_list[i] * pre_softmax_requant_mul)/(2**pre_softmax_requant_div))
-        output_head_list[i] = torch.clip(output_head_list[i], -128, 127)
-        output.append(ibertSoftmax(output_head_list[i]))
-
-    A = torch.stack(output)
-
-    # Special layout for the output: head interleaved fashioned
-    out = torch.zeros((H*S, S), dtype=torch.int8)
-    for s in range(S):
-        for h in range(H):
-            out[s*H + h, :] = A[h, s, :]
+
+    # All heads in one batched matmul
+    A = torch.matmul(Q, K)
+    A = torch.floor((A * pre_softmax_requant_mul)/(2**pre_softmax_requant_div))
+    A = torch.clip(A, -128, 127)
+    A = ibertSoftmaxCausal(A) if causal else ibertSoftmax(A)
+
+    # Special layout for the output: head interleaved fashioned, [S*H][S]
+    out = A.permute(1, 0, 2).reshape(S*H, S)
 
     return out.to(torch.uint8)
 
+def matmulSoftmaxM1Causal(inputDict: Dict, requantParams: Dict, MHSAParams: Dict):
+    return matmulSoftmaxM1(inputDict, requantParams, MHSAParams, causal=True)
+
 
 def generateInputsM1PULPNN(S, E, P, H):
 
@@ -217,14 +213,9 @@ def matmulSoftmaxM1PULPNN(inputDict: Dict, requantParams: Dict, MHSAParams: Dict
 
     K = torch.transpose(K,1,2)
 
-    output_head_list = []
-    output = []
-    for i in range(H):
-        output_head_list.append(torch.matmul(Q[i, :, :], K[i, :, :]))
-        output_head_list[i] = torch.floor((output_head_list[i] * pre_softmax_requant_mul)/(2**pre_softmax_requant_div))
-        output_head_list[i] = torch.clip(output_head_list[i], -128, 127)
-        output.append(ibertSoftmax(output_head_list[i]))
-
-    A = torch.stack(output)
+    A = torch.matmul(Q, K)
+    A = torch.floor((A * pre_softmax_requant_mul)/(2**pre_softmax_requant_div))
+    A = torch.clip(A, -128, 127)
+    A = ibertSoftmax(A)
 
     return A.to(torch.uint8)
\ No newline at end of file
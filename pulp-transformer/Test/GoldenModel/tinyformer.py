@@ -0,0 +1,130 @@
+# ----------------------------------------------------------------------
+#
+# File: tinyformer.py
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import math
+import re
+from typing import Dict
+from collections import OrderedDict
+from mako.template import Template
+from mako import exceptions
+
+# The RISC-V TinyFormer encoder (litex_port/common), whose trained weights and
+# demo inputs this benchmark runs
+TINYFORMER_DIR = "../../litex_port/common"
+
+# Requant of the cluster port, matching the fixed-point scaling of the RISC-V
+# encoder: every linear layer is acc >> 7, the scores are >> 5 before the
+# softmax (iSoftmax with log2 = 5 halves every 5 steps, the exp LUT about
+# every 5.5), and the context, a product with probabilities in 1/255 steps,
+# is >> 8 like the Q15 weights there.
+TINYFORMER_REQUANT = {"requantDiv": 7, "requantMul": 1, "scoreDiv": 5, "scoreMul": 1, "contextDiv": 8, "contextMul": 1}
+
+# Trained tensors, in tinyformer_encode_pulp argument order
+TINYFORMER_TENSORS = [("WeightQ", "W_q"), ("BiasQ", "b_q"), ("WeightK", "W_k"), ("BiasK", "b_k"),
+                      ("WeightV", "W_v"), ("BiasV", "b_v"), ("WeightO", "W_o"), ("BiasO", "b_o"),
+                      ("WeightFF1", "W_ff1"), ("BiasFF1", "b_ff1"), ("WeightFF2", "W_ff2"), ("BiasFF2", "b_ff2")]
+
+
+def readCArrays(path):
+
+    # name -> flattened values of every initialized int8/uint8 array in a C file
+    with open(path, "r") as f:
+        src = f.read()
+
+    arrays = {}
+    for name, body in re.findall(r"const u?int8_t (\w+)\[[^=]*=\s*\{(.*?)\};", src, re.S):
+        arrays[name] = [int(x) for x in re.findall(r"-?\d+", body)]
+    return arrays
+
+
+def generateTemplateTinyFormer(MHSAParams: Dict, requantParams: Dict, args):
+
+    # The shape is the one of the trained weights (S=16, D=32, FFN=64), not
+    # the sweep parameters
+    weights = readCArrays(f"{TINYFORMER_DIR}/trained_weights.c")
+    samples = readCArrays(f"{TINYFORMER_DIR}/demo_samples.c")
+    D = len(weights["b_q"])
+    F = len(weights["b_ff1"])
+    S = len(samples["demo_inputs"]) // (len(samples["demo_labels"]) * D)
+
+    # W_q/W_k/W_v narrowed to their first TRAINED_WEIGHTS_D_IN columns are
+    # zero-padded back to [D][D] for the kernels
+    for cName in ("W_q", "W_k", "W_v"):
+        dIn = len(weights[cName]) // D
+        weights[cName] = [x for r in range(D) for x in weights[cName][r*dIn:(r+1)*dIn] + [0]*(D - dIn)]
+
+    # Sample 0 as the input, 16b biases as the kernels take them
+    tensors = OrderedDict()
+    tensors["Input"] = ("int8_t", samples["demo_inputs"][:S*D])
+    for name, cName in TINYFORMER_TENSORS:
+        tensors[name] = ("int16_t" if name.startswith("Bias") else "int8_t", weights[cName])
+
+    retStr = '#include "pmsis.h"\n\n'
+    for name, (cType, values) in tensors.items():
+        retStr += f"{cType} testInputVector{name}[] = {{{', '.join(str(x) for x in values)}}};\n\n"
+
+    with open(f"{args.app_folder}/inc/testInput.h", "w") as f:
+        f.write(retStr)
+
+    templateDict = OrderedDict()
+
+    templateDict["kernelName"] = args.kernel_name
+    templateDict["testInputHeaderName"] = "testInput"
+
+    templateDict['fcFrequency'] = 370*1000*1000
+    templateDict['clFrequency'] = 370*1000*1000
+    templateDict['l2BufferSize'] = 700000
+
+    templateDict['S'] = S
+    templateDict['D'] = D
+    templateDict['F'] = F
+
+    # Input, weights, output and the tinyformer_encode_pulp scratch (TINYFORMER_PULP_SCRATCH), all in L1
+    sizes = OrderedDict()
+    for name, (cType, values) in tensors.items():
+        sizes[name] = len(values) * (2 if cType == "int16_t" else 1)
+    sizes['Output'] = S*D
+    sizes['Scratch'] = max(4*S*D + S*S, S*D + S*F)
+
+    offsets = OrderedDict()
+    offset = 0
+    for name, size in sizes.items():
+        offsets[name] = offset
+        offset += 4*math.ceil(size/4)
+    templateDict['offsets'] = offsets
+    templateDict['sizes'] = sizes
+    templateDict['tensors'] = list(tensors.keys())
+    templateDict['l1BufferSize'] = offset
+
+    for key, value in TINYFORMER_REQUANT.items():
+        templateDict[key] = value
+
+    l = ""
+    tmpl = Template(filename=f"./TestTemplate/tinyformerTemplate.c")
+
+    try:
+        s = tmpl.render(verbose_log=l, **templateDict)
+    except:
+        print(exceptions.text_error_template().render())
+
+    with open(f"{args.app_folder}/src/tinyformer.c", "w") as f:
+        f.write(s)
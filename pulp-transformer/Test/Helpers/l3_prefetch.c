@@ -0,0 +1,16 @@
+#include "../inc/l3_prefetch.h"
+#include "pmsis.h"
+
+void l3_prefetch_async(struct pi_device *ram, uint32_t ext, void *loc, uint32_t size, l3_prefetch_t *prefetch) {
+  if (pi_core_id() == 0) {
+    pi_cl_ram_read(ram, ext, loc, size, &prefetch->req);
+    prefetch->pending = 1;
+  }
+}
+
+void l3_prefetch_wait(l3_prefetch_t *prefetch) {
+  if (pi_core_id() == 0 && prefetch->pending) {
+    pi_cl_ram_read_wait(&prefetch->req);
+    prefetch->pending = 0;
+  }
+}
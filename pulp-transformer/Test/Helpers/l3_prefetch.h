@@ -0,0 +1,19 @@
+#pragma once
+#include "pmsis.h"
+
+// L3 -> L2 copies of the weights of the next layer or kernel, for models whose
+// weights do not fit L2 (MHSALayersL3, Test/tilingSolver.py). The cluster asks
+// the FC to read the L3 RAM (HyperRAM or flash behind the ram driver) into L2
+// and goes on computing; the FC serves the request while the cores run.
+//
+// As thorir_dma_async, both functions act on core 0 only: after
+// l3_prefetch_wait the caller needs a barrier before the other cores read the
+// data.
+typedef struct
+{
+  pi_cl_ram_req_t req;
+  int pending;
+} l3_prefetch_t;
+
+void l3_prefetch_async(struct pi_device *ram, uint32_t ext, void *loc, uint32_t size, l3_prefetch_t *prefetch);
+void l3_prefetch_wait(l3_prefetch_t *prefetch);
@@ -0,0 +1,67 @@
+#pragma once
+#include "pmsis.h"
+
+// Lock-free single-producer / single-consumer mailbox in L2, from the cluster
+// (producer: core 0 at the end of each window) to the fabric controller
+// (consumer). head is written only by the cluster and tail only by the FC,
+// and each side publishes its index after the slot copy behind a compiler
+// barrier. L2 is not cached on either side, so no lock, fence or event is
+// needed; the FC polls mhsa_mailbox_pop() between the windows it prepares.
+
+// Capacity in results; power of two, at least the number of windows in flight.
+#ifndef MHSA_MAILBOX_SLOTS
+#define MHSA_MAILBOX_SLOTS 4
+#endif
+
+#if (MHSA_MAILBOX_SLOTS & (MHSA_MAILBOX_SLOTS - 1)) != 0
+#error "MHSA_MAILBOX_SLOTS must be a power of two"
+#endif
+
+#define MHSA_MAILBOX_BARRIER() asm volatile("":::"memory")
+
+typedef struct
+{
+  uint32_t window;    // index of the window the result belongs to
+  uint32_t cycles;    // cluster active cycles of the window (load, MHSA, store)
+  int32_t checksum;   // sum of the output bytes, to compare with a reference run
+} mhsa_result_t;
+
+typedef struct
+{
+  mhsa_result_t slots[MHSA_MAILBOX_SLOTS];
+  volatile uint32_t head;    // results posted (free-running)
+  volatile uint32_t tail;    // results taken (free-running)
+  volatile uint32_t dropped; // results lost to a full mailbox
+} mhsa_mailbox_t;
+
+static inline void mhsa_mailbox_reset(mhsa_mailbox_t *m) {
+  m->head = 0;
+  m->tail = 0;
+  m->dropped = 0;
+}
+
+// Producer side. Returns 0, or -1 if the mailbox was full and the result dropped.
+static inline int mhsa_mailbox_post(mhsa_mailbox_t *m, const mhsa_result_t *r) {
+  uint32_t head = m->head;
+  if (head - m->tail >= (uint32_t)MHSA_MAILBOX_SLOTS) {
+    m->dropped++;
+    return -1;
+  }
+  m->slots[head & (MHSA_MAILBOX_SLOTS - 1)] = *r;
+  MHSA_MAILBOX_BARRIER();
+  m->head = head + 1;
+  return 0;
+}
+
+// Consumer side. Copies the oldest result to r; returns 0, or -1 if empty.
+static inline int mhsa_mailbox_pop(mhsa_mailbox_t *m, mhsa_result_t *r) {
+  uint32_t tail = m->tail;
+  if (m->head == tail) {
+    return -1;
+  }
+  MHSA_MAILBOX_BARRIER();
+  *r = m->slots[tail & (MHSA_MAILBOX_SLOTS - 1)];
+  MHSA_MAILBOX_BARRIER();
+  m->tail = tail + 1;
+  return 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "pmsis.h"
+
+// Per-core performance counters of a profiled region, after the
+// PI_PERF_CYCLES-only macros of Legacy/PULP_kernels/include/stats.h. With
+// CORE_STATS (default on) every core, not only core 0, counts
+// CORE_STATS_EVENTS between START_PROFILING and STOP_PROFILING and saves
+// them to L1; the templates then print one line per core:
+//
+//   CORE_STATS Kernel Execution: core=3 cycles=.. active=.. ld_stall=.. jr_stall=.. imiss=.. tcdm_cont=..
+//   CORE_STATS Kernel Execution: imbalance=1.18 max_active=.. mean_active=..
+//
+// A core that waits in pi_cl_team_barrier is clock gated and stops counting
+// active cycles, so imbalance = max / mean active cycles shows the work a
+// kernel's split leaves unshared (1.00: every core finished together).
+// extractProfilingData.py adds it and the stall / contention shares to the
+// result log and the report.
+//
+// GVSoC counts all events at once. A core with fewer hardware counters than
+// events counts only some of them: give CORE_STATS_EVENTS the ones wanted.
+
+#ifndef CORE_STATS
+#define CORE_STATS 1
+#endif
+
+#if CORE_STATS
+
+#ifndef CORE_STATS_EVENTS
+#define CORE_STATS_EVENTS ((1 << PI_PERF_CYCLES) | (1 << PI_PERF_ACTIVE_CYCLES) | (1 << PI_PERF_LD_STALL) | \
+                           (1 << PI_PERF_JR_STALL) | (1 << PI_PERF_IMISS) | (1 << PI_PERF_TCDM_CONT))
+#endif
+
+// Cores that run the profiling counters: all of them
+#define CORE_STATS_CORE() 1
+
+typedef struct
+{
+  uint32_t cycles;
+  uint32_t active;
+  uint32_t ld_stall;   // load-use stalls
+  uint32_t jr_stall;   // jump-register stalls
+  uint32_t imiss;      // instruction-cache miss cycles
+  uint32_t tcdm_cont;  // cycles lost to L1 (TCDM) bank contention
+} core_stats_t;
+
+PI_L1 static core_stats_t core_stats[NUM_CORES];
+
+// Each core, with its counters stopped
+static inline void core_stats_save(void) {
+  core_stats_t *s = &core_stats[pi_core_id()];
+  s->cycles = pi_perf_read(PI_PERF_CYCLES);
+  s->active = pi_perf_read(PI_PERF_ACTIVE_CYCLES);
+  s->ld_stall = pi_perf_read(PI_PERF_LD_STALL);
+  s->jr_stall = pi_perf_read(PI_PERF_JR_STALL);
+  s->imiss = pi_perf_read(PI_PERF_IMISS);
+  s->tcdm_cont = pi_perf_read(PI_PERF_TCDM_CONT);
+}
+
+// All cores, after core_stats_save(); core 0 prints
+static inline void core_stats_print(const char *label) {
+  pi_cl_team_barrier(0);
+  if (pi_core_id() == 0) {
+    uint32_t max_active = 0, sum_active = 0;
+    for (int c = 0; c < NUM_CORES; c++) {
+      core_stats_t *s = &core_stats[c];
+      printf("CORE_STATS %s: core=%d cycles=%d active=%d ld_stall=%d jr_stall=%d imiss=%d tcdm_cont=%d\n",
+             label, c, s->cycles, s->active, s->ld_stall, s->jr_stall, s->imiss, s->tcdm_cont);
+      max_active = s->active > max_active ? s->active : max_active;
+      sum_active += s->active;
+    }
+    uint32_t mean_active = sum_active / NUM_CORES;
+    uint32_t imbalance = mean_active ? (uint32_t)(((uint64_t)max_active * 100 + mean_active / 2) / mean_active) : 100;
+    printf("CORE_STATS %s: imbalance=%d.%02d max_active=%d mean_active=%d\n",
+           label, imbalance / 100, imbalance % 100, max_active, mean_active);
+  }
+}
+
+#define CORE_STATS_SAVE() core_stats_save()
+#define CORE_STATS_PRINT(label) core_stats_print(label)
+
+#else
+
+#define CORE_STATS_EVENTS 0
+#define CORE_STATS_CORE() (pi_core_id() == 0)
+#define CORE_STATS_SAVE()
+#define CORE_STATS_PRINT(label)
+
+#endif
@@ -146,3 +146,59 @@ void thorir_dma(DMA_copy *copy) {
   }
 }
 
+
+void thorir_dma_async(DMA_copy *copy, thorir_dma_cmd_t *cmd) {
+  if (pi_core_id() == 0) {
+    const int size = copy->length_1d_copy * copy->number_of_1d_copies;
+    const int dir = (copy->dir == 1) ? PI_CL_DMA_DIR_EXT2LOC : PI_CL_DMA_DIR_LOC2EXT;
+    if (copy->number_of_1d_copies == 1 || copy->length_1d_copy == copy->stride_1d) {
+      cmd->copy_1d.ext = copy->ext;
+      cmd->copy_1d.loc = copy->loc;
+      cmd->copy_1d.size = size;
+      cmd->copy_1d.merge = 0;
+      cmd->copy_1d.dir = dir;
+      pi_cl_dma_memcpy(&cmd->copy_1d);
+    } else {
+      cmd->copy_2d.ext = copy->ext;
+      cmd->copy_2d.loc = copy->loc;
+      cmd->copy_2d.size = size;
+      cmd->copy_2d.length = copy->length_1d_copy;
+      cmd->copy_2d.stride = copy->stride_1d;
+      cmd->copy_2d.merge = 0;
+      cmd->copy_2d.dir = dir;
+      pi_cl_dma_memcpy_2d(&cmd->copy_2d);
+    }
+  }
+}
+
+void thorir_dma_wait(thorir_dma_cmd_t *cmd) {
+  if (pi_core_id() == 0) {
+    pi_cl_dma_wait(cmd);
+  }
+}
+
+void thorir_dma_async_hwc_to_chw(DMA_copy *copy, thorir_dma_cmd_t *cmd) {
+  if (pi_core_id() == 0) {
+    void *ext = copy->ext;
+    void *loc = copy->loc;
+    for (int i = 0; i < copy->length_1d_copy; i++) {
+      cmd[i].copy_2d.ext = ext;
+      cmd[i].copy_2d.loc = loc;
+      cmd[i].copy_2d.size = copy->number_of_1d_copies;
+      cmd[i].copy_2d.length = 1;
+      cmd[i].copy_2d.stride = copy->stride_1d;
+      cmd[i].copy_2d.merge = 0;
+      cmd[i].copy_2d.dir = PI_CL_DMA_DIR_EXT2LOC;
+      pi_cl_dma_memcpy_2d(&cmd[i].copy_2d);
+      ext += 1; // next channel
+      loc += copy->number_of_1d_copies;
+    }
+  }
+}
+
+void thorir_dma_wait_hwc_to_chw(DMA_copy *copy, thorir_dma_cmd_t *cmd) {
+  if (pi_core_id() == 0) {
+    for (int i = 0; i < copy->length_1d_copy; i++)
+      pi_cl_dma_wait(&cmd[i]);
+  }
+}
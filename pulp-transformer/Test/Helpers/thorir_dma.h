@@ -1,3 +1,6 @@
+#pragma once
+#include "pmsis.h"
+
 typedef struct
 {
   void *ext;
@@ -9,4 +12,26 @@ typedef struct
   unsigned short number_of_1d_copies;
   unsigned short length_1d_copy;
   int dir; // 0 l1->l2, 1 l2->l1
-} DMA_copy;
\ No newline at end of file
+} DMA_copy;
+
+// Command of a transfer started by thorir_dma_async
+typedef union
+{
+  pi_cl_dma_copy_t copy_1d;
+  pi_cl_dma_copy_2d_t copy_2d;
+} thorir_dma_cmd_t;
+
+// Start a 1D or 2D transfer (number_of_2d_copies == 1) on core 0 without
+// waiting for it, so the cores can compute on another buffer meanwhile.
+// thorir_dma_wait blocks core 0 until it is done; the caller then needs a
+// barrier before the other cores use the data.
+void thorir_dma_async(DMA_copy *copy, thorir_dma_cmd_t *cmd);
+void thorir_dma_wait(thorir_dma_cmd_t *cmd);
+
+// HWC -> CHW as thorir_dma_async: the [number_of_1d_copies][length_1d_copy]
+// bytes at ext (rows stride_1d apart) land in loc transposed, as
+// [length_1d_copy][number_of_1d_copies]. One 2D transfer of 1-byte chunks per
+// column, so cmd holds length_1d_copy commands; the command queue may stall
+// core 0 while they are issued, but never the other cores. L2 -> L1 only.
+void thorir_dma_async_hwc_to_chw(DMA_copy *copy, thorir_dma_cmd_t *cmd);
+void thorir_dma_wait_hwc_to_chw(DMA_copy *copy, thorir_dma_cmd_t *cmd);
@@ -0,0 +1,70 @@
+/* ----------------------------------------------------------------------
+#
+# File: ARMKernelTemplate.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../inc/${testInputHeaderName}.h"
+#include "../inc/arm_kernels.h"
+
+// CMSIS device header (e.g. "ARMCM55.h"), set by the Makefile
+#ifdef CMSIS_device_header
+#include CMSIS_device_header
+#endif
+
+// Cycles from the DWT cycle counter (PROFILING=1 in the Makefile). QEMU does
+// not count cycles, the counts are only meaningful on a board or an FVP.
+#if defined(PROFILING) && defined(DWT)
+  #define START_PROFILING(){\
+      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;\
+      DWT->CYCCNT = 0;\
+      DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;\
+    }
+
+  #define STOP_PROFILING(){\
+      uint32_t cycles = DWT->CYCCNT;\
+      printf("Kernel Execution: %u\n", (unsigned int)cycles);\
+    }
+
+#else
+  #define START_PROFILING(){}
+  #define STOP_PROFILING(){}
+#endif
+
+static ${outputType} O[${outputSize}];
+
+int main(void) {
+
+  START_PROFILING();
+  ${kernelName}(${kernelArgs});
+  STOP_PROFILING();
+
+  printf("Output:\n");
+  for(int i = 0; i < ${outputSize}; i++){
+    printf("%d, ", O[i]);
+  }
+  printf("\n");
+
+  return 0;
+}
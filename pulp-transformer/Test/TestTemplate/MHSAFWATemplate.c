@@ -39,6 +39,14 @@
 #include "../inc/thorir_dma.h"
 #include "../inc/pulp_nn_utils.h"
 #include "../inc/pulp_nn_kernels.h"
+#include "../inc/stats.h"
+
+// Kernel per stage for this shape (mhsa_dispatch.h, AUTOTUNE=1 ./kernelTest.sh)
+#define MHSA_S ${S}
+#define MHSA_E ${E}
+#define MHSA_P ${P}
+#define MHSA_H ${H}
+#include "../inc/mhsa_dispatch.h"
 
 #define FLASH_BUFF_SIZE 128
 
@@ -55,8 +63,8 @@
 #endif
 
 #ifdef PROFILING
-  #define START_PROFILING()  if(pi_core_id()==0){ pi_perf_conf((1<<PI_PERF_ACTIVE_CYCLES)); pi_perf_reset(); pi_perf_stop(); pi_perf_start();}
-  #define STOP_PROFILING(str)  if(pi_core_id()==0){ pi_perf_stop(); printf("%s: %d\n", #str, pi_perf_read(PI_PERF_ACTIVE_CYCLES));}
+  #define START_PROFILING()  if(CORE_STATS_CORE()){ pi_perf_conf((1<<PI_PERF_ACTIVE_CYCLES) | CORE_STATS_EVENTS); pi_perf_reset(); pi_perf_stop(); pi_perf_start();}
+  #define STOP_PROFILING(str)  { if(CORE_STATS_CORE()){ pi_perf_stop(); CORE_STATS_SAVE(); } if(pi_core_id()==0){ printf("%s: %d\n", #str, pi_perf_read(PI_PERF_ACTIVE_CYCLES));} CORE_STATS_PRINT(#str); }
 #else
   #define START_PROFILING()
   #define STOP_PROFILING()
@@ -99,15 +107,14 @@ void cluster_fork(void *args) {
   //   matmulSoftmax_FWA_v3_S(I, W, B, O, ${S}, ${E}, 1, ${requantDiv}, ${requantMul}, ${requantDiv}, ${requantMul}, 1, 7, 24, 5, 256);
   //   pi_cl_team_barrier(0);
   // }
-  matmulSoftmax_FWA_v3_H(I, W, B, O, ${S}, ${E}, ${H}, ${requantDiv}, ${requantMul}, ${requantDiv}, ${requantMul}, 1, 7, 24, 5, 256);
+  MHSA_FWA(I, W, B, O, ${S}, ${E}, ${H}, ${requantDiv}, ${requantMul}, ${requantDiv}, ${requantMul}, 1, 7, 24, 5, 256);
+  pi_cl_team_barrier(0);
   
   I = base;
   W = base + ${S*S};
   O = base + ${S*S} + ${S*P};
-  for(int i=0; i < ${H}; i++){
-    matmul_4x2_S(I, W, O, ${S}, ${P}, 1, ${requantDiv}, ${requantMul});
-    pi_cl_team_barrier(0);
-  }
+  MHSA_MATMUL(I, W, O, ${S}, ${P}, ${H}, ${requantDiv}, ${requantMul});
+  pi_cl_team_barrier(0);
 
   I = base;
   W = base + ${H*S*P};
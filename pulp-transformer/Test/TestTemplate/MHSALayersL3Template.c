@@ -0,0 +1,247 @@
+/* ----------------------------------------------------------------------
+#
+# File: MHSALayersL3Template.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+
+
+// #include "../inc/${testInputHeaderName}.h    "
+
+#include "pmsis.h"
+#include "bsp/fs.h"
+#include "bsp/bsp.h"
+#include "bsp/ram.h"
+#include <bsp/flash/spiflash.h>
+#include <bsp/fs/readfs.h>
+
+// #include "../inc/dory.h"
+#include "../inc/thorir_dma.h"
+#include "../inc/l3_prefetch.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/stats.h"
+#include "../inc/mhsa_tiling.h"
+
+#define FLASH_BUFF_SIZE 128
+
+#define SLAVE_STACK_SIZE 2048
+#define STACK_SIZE      2048
+
+// #define TEST_INPUTS
+#define PROFILING
+#define GPIO
+
+#ifdef GPIO
+  unsigned int GPIOs = 89;
+  #define WRITE_GPIO(x) pi_gpio_pin_write(GPIOs,x)
+#endif
+
+#ifdef PROFILING
+  #define START_PROFILING()  if(CORE_STATS_CORE()){ pi_perf_conf((1<<PI_PERF_ACTIVE_CYCLES) | CORE_STATS_EVENTS); pi_perf_reset(); pi_perf_stop(); pi_perf_start();}
+  #define STOP_PROFILING(str)  { if(CORE_STATS_CORE()){ pi_perf_stop(); CORE_STATS_SAVE(); } if(pi_core_id()==0){ printf("%s: %d\n", #str, pi_perf_read(PI_PERF_ACTIVE_CYCLES));} CORE_STATS_PRINT(#str); }
+#else
+  #define START_PROFILING()
+  #define STOP_PROFILING()
+#endif
+
+struct pi_mx25u51245g_conf flash_conf;
+static struct pi_default_ram_conf ram_conf;
+static struct pi_device ram;
+static int activations_input;
+static uint8_t flashBuffer[FLASH_BUFF_SIZE];
+
+// Weights of one layer in L3 (tilingSolver.py mhsa_weights()); a layer's
+// weights follow the previous layer's, LAYER_WEIGHTS bytes apart
+#define LAYER_WEIGHTS ${layerWeights}
+
+// The L3 transfers of a layer, each prefetched into one of the two L2 slots:
+// the whole layer, or the weights of linearQK_4x2_H, matmulSoftmax_FWA_v3_H
+// and linearO_4x2_H one by one
+#if TILING_L3_PER_LAYER
+#define UNITS_PER_LAYER 1
+static const uint32_t unit_start[UNITS_PER_LAYER + 1] = {0, LAYER_WEIGHTS};
+#else
+#define UNITS_PER_LAYER 3
+static const uint32_t unit_start[UNITS_PER_LAYER + 1] = {${weights['Wqk'][0]}, ${weights['Wfwa'][0]}, ${weights['Wo'][0]}, LAYER_WEIGHTS};
+#endif
+#define UNITS (TILING_L3_LAYERS * UNITS_PER_LAYER)
+
+static void unit_prefetch(struct pi_device *ram, uint32_t l3, char **slot, l3_prefetch_t *prefetch, int unit) {
+  uint32_t start = unit_start[unit % UNITS_PER_LAYER];
+  uint32_t size = unit_start[unit % UNITS_PER_LAYER + 1] - start;
+  l3_prefetch_async(ram, l3 + (unit / UNITS_PER_LAYER) * LAYER_WEIGHTS + start, slot[unit & 1], size, &prefetch[unit & 1]);
+}
+
+// Wait for the weights of unit, start loading unit + 1 into the other slot and
+// return the layer's weights as they would lie in L2: the kernels index them by
+// their L3 offset in the layer
+static char *unit_next(struct pi_device *ram, uint32_t l3, char **slot, l3_prefetch_t *prefetch, int unit) {
+  l3_prefetch_wait(&prefetch[unit & 1]);
+  pi_cl_team_barrier(0);
+  if (unit + 1 < UNITS) {
+    unit_prefetch(ram, l3, slot, prefetch, unit + 1);
+  }
+  return slot[unit & 1] - unit_start[unit % UNITS_PER_LAYER];
+}
+
+void cluster_fork(void *args) {
+
+  // Unpack args
+  char *L2 = ((char **)args)[0];
+  char *L1 = ((char **)args)[1];
+  struct pi_device *ram = ((struct pi_device **)args)[2];
+  uint32_t l3 = ((uint32_t *)args)[3];
+
+  char *slot[2] = {L2 + ${offsets['Slot0']}, L2 + ${offsets['Slot1']}};
+  char *in = L2 + ${offsets['X']};
+  char *out = L2 + ${offsets['Output']};
+  l3_prefetch_t prefetch[2] = {0};
+  int unit = 0;
+  char *w;
+
+  START_PROFILING();
+  #ifdef GPIO
+  WRITE_GPIO(1);
+  #endif
+
+  // TILING_L3_LAYERS MHSA layers with their weights in L3. While the four
+  // layers of MHSATiledLayers tile the activations from L2 into L1, core 0
+  // has the FC read the weights of the next unit into the other L2 slot; only
+  // the first load is not hidden. Each layer's output is the next one's input,
+  // for timing only.
+  unit_prefetch(ram, l3, slot, prefetch, 0);
+  for (int layer = 0; layer < TILING_L3_LAYERS; layer++) {
+    w = unit_next(ram, l3, slot, prefetch, unit++);
+    linearQK_4x2_H_tiled(in, w + ${weights['Wqk'][0]}, (int16_t *)(w + ${weights['Bqk'][0]}), L2 + ${offsets['V']}, L1,
+                         ${S}, ${E}, ${P}, ${H}, TILING_QK_HEADS, ${requantDiv}, ${requantMul});
+
+#if !TILING_L3_PER_LAYER
+    w = unit_next(ram, l3, slot, prefetch, unit++);
+#endif
+    matmulSoftmax_FWA_v3_H_tiled(in, w + ${weights['Wfwa'][0]}, (int16_t *)(w + ${weights['Bfwa'][0]}), L2 + ${offsets['A']}, L1,
+                                 ${S}, ${E}, ${H}, TILING_FWA_HEADS, ${requantDiv}, ${requantMul}, ${requantDiv}, ${requantMul}, 1, 7, 24, 5, 256);
+
+    matmul_4x2_S_tiled(L2 + ${offsets['A']}, L2 + ${offsets['V']}, L2 + ${offsets['Context']}, L1,
+                       ${S}, ${P}, ${H}, TILING_MATMUL_HEADS, ${requantDiv}, ${requantMul});
+
+#if !TILING_L3_PER_LAYER
+    w = unit_next(ram, l3, slot, prefetch, unit++);
+#endif
+    linearO_4x2_H_tiled(L2 + ${offsets['Context']}, w + ${weights['Wo'][0]}, (int16_t *)(w + ${weights['Bo'][0]}), out, L1,
+                        ${S}, ${E}, ${P}, ${H}, TILING_O_SEQ, ${requantDiv}, ${requantMul});
+
+    char *t = in;
+    in = out;
+    out = t;
+  }
+
+  #ifdef GPIO
+  WRITE_GPIO(0);
+  #endif
+  STOP_PROFILING(Kernel Execution);
+}
+
+void kernel_task(void *task_args) {
+
+  char* L1_buffer = pi_cl_l1_malloc((void *) 0, (uint32_t) TILING_L1_SIZE);
+
+   // Build agrs to give to cluster
+  unsigned int args[4] = {
+    ((unsigned int *)task_args)[0],
+    L1_buffer,
+    ((unsigned int *)task_args)[1],
+    ((unsigned int *)task_args)[2]
+  };
+
+  pi_cl_team_fork(NUM_CORES, cluster_fork, args);
+  pi_cl_l1_free((void *) 0, L1_buffer, (uint32_t) TILING_L1_SIZE);
+}
+
+int main () {
+
+  char* L1_buffer;
+  char* L2_buffer;
+
+  printf("Configure mcu: ");
+  struct pi_device cluster_dev = {0};
+  struct pi_cluster_conf conf;
+  struct pi_cluster_task cluster_task = {0};
+  struct pi_device fs;
+  struct pi_device flash;
+
+  pi_freq_set(PI_FREQ_DOMAIN_FC, ${fcFrequency});
+  pi_time_wait_us(10000);
+  pi_freq_set(PI_FREQ_DOMAIN_CL, ${clFrequency});
+  pi_time_wait_us(10000);
+
+  #ifdef GPIO
+  pi_pad_function_set(GPIOs, 1);
+  pi_gpio_pin_configure(GPIOs, PI_GPIO_OUTPUT);
+  pi_gpio_pin_write(GPIOs, 0);
+  WRITE_GPIO(0);
+  #endif
+
+  pi_cluster_conf_init(&conf);
+  conf.id=0;
+  conf.cc_stack_size = STACK_SIZE;
+  printf("DONE\n");
+
+  printf("Allocate L2: ");
+  L2_buffer = pi_l2_malloc((uint32_t) ${l2BufferSize});
+  printf("DONE\n");
+
+  // The weights of all layers in L3, left as the RAM holds them: the runs
+  // are for timing only
+  uint32_t l3_weights;
+  printf("Allocate L3: ");
+  pi_default_ram_conf_init(&ram_conf);
+  pi_open_from_conf(&ram, &ram_conf);
+  if (pi_ram_open(&ram) || pi_ram_alloc(&ram, &l3_weights, (uint32_t) (TILING_L3_LAYERS * LAYER_WEIGHTS))) {
+    printf("Error: Can't allocate L3\n");
+    return -1;
+  }
+  printf("DONE\n");
+  unsigned int task_args[3] = {L2_buffer, &ram, l3_weights};
+
+  // Start cluster job
+  printf("Start Cluster Task");
+  // Prepare Task
+  pi_cluster_task(&cluster_task, kernel_task, task_args);
+  pi_cluster_task_stacks(&cluster_task, NULL, SLAVE_STACK_SIZE);
+
+  pi_open_from_conf(&cluster_dev, &conf);
+  if (pi_cluster_open(&cluster_dev)){
+    printf("Error: Can't open cluster\n");
+    return -1;
+  }
+
+  // Then offload an entry point, this will get executed on the cluster controller
+  // cluster_task.stack_size = 3500;
+  // cluster_task.slave_stack_size = 3400;
+  pi_cluster_send_task_to_cl(&cluster_dev, &cluster_task);
+
+  // Close the cluster
+  printf("End Cluster Task");
+  pi_cluster_close(&cluster_dev);
+  pi_ram_free(&ram, l3_weights, (uint32_t) (TILING_L3_LAYERS * LAYER_WEIGHTS));
+  pi_ram_close(&ram);
+}
\ No newline at end of file
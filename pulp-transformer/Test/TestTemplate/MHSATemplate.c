@@ -37,6 +37,17 @@
 #include "../inc/thorir_dma.h"
 #include "../inc/pulp_nn_utils.h"
 #include "../inc/pulp_nn_kernels.h"
+#include "../inc/stats.h"
+% if pipelined:
+#include "../inc/mhsa_mailbox.h"
+% endif
+
+// Kernel per stage for this shape (mhsa_dispatch.h, AUTOTUNE=1 ./kernelTest.sh)
+#define MHSA_S ${S}
+#define MHSA_E ${E}
+#define MHSA_P ${P}
+#define MHSA_H ${H}
+#include "../inc/mhsa_dispatch.h"
 
 #define FLASH_BUFF_SIZE 128
 
@@ -44,7 +55,9 @@
 #define STACK_SIZE      2048
 
 // #define TEST_INPUTS
+% if not pipelined:
 #define PROFILING
+% endif
 #define GPIO
 
 #ifdef GPIO
@@ -53,11 +66,11 @@
 #endif
 
 #ifdef PROFILING
-  #define START_PROFILING()  if(pi_core_id()==0){ pi_perf_conf((1<<PI_PERF_ACTIVE_CYCLES)); pi_perf_reset(); pi_perf_stop(); pi_perf_start();}
-  #define STOP_PROFILING(str)  if(pi_core_id()==0){ pi_perf_stop(); printf("%s: %d\n", #str, pi_perf_read(PI_PERF_ACTIVE_CYCLES));}
+  #define START_PROFILING()  if(CORE_STATS_CORE()){ pi_perf_conf((1<<PI_PERF_ACTIVE_CYCLES) | CORE_STATS_EVENTS); pi_perf_reset(); pi_perf_stop(); pi_perf_start();}
+  #define STOP_PROFILING(str)  { if(CORE_STATS_CORE()){ pi_perf_stop(); CORE_STATS_SAVE(); } if(pi_core_id()==0){ printf("%s: %d\n", #str, pi_perf_read(PI_PERF_ACTIVE_CYCLES));} CORE_STATS_PRINT(#str); }
 #else
   #define START_PROFILING()
-  #define STOP_PROFILING()
+  #define STOP_PROFILING(str)
 #endif
 
 struct pi_mx25u51245g_conf flash_conf;
@@ -87,6 +100,10 @@ void cluster_fork(void *args) {
   WRITE_GPIO(1);
   #endif
 
+% if fusedQKV:
+  linearQKV_4x2_H(I, W, B, O, ${S}, ${E}, ${P}, ${H}, ${requantDiv}, ${requantMul});
+  pi_cl_team_barrier(0);
+% else:
   for(int i=0; i < 2; i++){
     linearQK_4x2_H(I, W, B, O, ${S}, ${E}, ${P}, ${H}, ${requantDiv}, ${requantMul});
     pi_cl_team_barrier(0);
@@ -94,22 +111,19 @@ void cluster_fork(void *args) {
 
   linearV_4x2_H(I, W, B, O, ${S}, ${E}, ${P}, ${H}, ${requantDiv}, ${requantMul});
   pi_cl_team_barrier(0);
+% endif
 
   I = base;
   W = base + ${S*P};
   O = base + ${S*P} + ${S*P};
-  for(int i=0; i < ${H}; i++){
-    matmulSoftmax_4x2_S(I, W, O, ${S}, ${P}, 1, ${requantDiv}, ${requantMul}, 1, 7, 24, 5, 256);
-    pi_cl_team_barrier(0);
-  }
+  MHSA_MATMUL_SOFTMAX(I, W, O, ${S}, ${P}, ${H}, ${requantDiv}, ${requantMul}, 1, 7, 24, 5, 256);
+  pi_cl_team_barrier(0);
   
   I = base;
   W = base + ${S*S};
   O = base + ${S*S} + ${S*P};
-  for(int i=0; i < ${H}; i++){
-    matmul_4x2_S(I, W, O, ${S}, ${P}, 1, ${requantDiv}, ${requantMul});
-    pi_cl_team_barrier(0);
-  }
+  MHSA_MATMUL(I, W, O, ${S}, ${P}, ${H}, ${requantDiv}, ${requantMul});
+  pi_cl_team_barrier(0);
 
   I = base;
   W = base + ${H*S*P};
@@ -153,6 +167,96 @@ void kernel_task(void *task_args) {
   pi_cl_l1_free((void *) 0, L1_buffer, (uint32_t) ${l1BufferSize});
 }
 
+% if pipelined:
+// FC / cluster pipeline over WINDOWS windows of S x E int8 features. The FC
+// prepares window n+1 in one of two L2 input buffers while the cluster runs
+// window n from the other: each cluster task loads its window into L1, runs
+// the MHSA chain, stores the output to L2 and posts its result to the
+// mailbox. A window then costs max(FC preparation, cluster task) instead of
+// their sum.
+#define WINDOWS ${windows}
+#define WINDOW_SIZE ${S*E}
+
+typedef struct
+{
+  char *in;
+  char *out;
+  char *L1;
+  uint32_t window;
+  mhsa_mailbox_t *mailbox;
+} window_args_t;
+
+static void window_task(void *task_args) {
+
+  window_args_t *w = (window_args_t *) task_args;
+  char *L1_buffer = w->L1;
+
+  char *A = (char *) (L1_buffer + ${dmaTransferSize});
+  char *Bias = (char *) (L1_buffer + ${dmaTransferSize} + ${int(sizeBias + dmaTransferSize)});
+  char *B = (char *) (L1_buffer + ${dmaTransferSize} + ${int(sizeBias + sizeA + 2*dmaTransferSize)});
+  char *O = (char *) (L1_buffer + ${dmaTransferSize} + ${int(sizeBias + sizeA + sizeB + 3*dmaTransferSize)});
+  // linearO_4x2_H writes the S x E output here (see cluster_fork)
+  char *Out = A + ${H*S*P} + ${H*S*E};
+
+  unsigned int args[10] = {
+    A,
+    B,
+    Bias,
+    O,
+    ${S},
+    ${E},
+    ${P},
+    ${H},
+    ${requantDiv},
+    ${requantMul}
+  };
+
+  pi_perf_conf(1<<PI_PERF_CYCLES);
+  pi_perf_reset();
+  pi_perf_start();
+
+  pi_cl_dma_copy_t copy;
+  copy.ext = w->in;
+  copy.loc = A;
+  copy.size = WINDOW_SIZE;
+  copy.merge = 0;
+  copy.dir = PI_CL_DMA_DIR_EXT2LOC;
+  pi_cl_dma_memcpy(&copy);
+  pi_cl_dma_wait(&copy);
+
+  pi_cl_team_fork(NUM_CORES, cluster_fork, args);
+
+  copy.ext = w->out;
+  copy.loc = Out;
+  copy.dir = PI_CL_DMA_DIR_LOC2EXT;
+  pi_cl_dma_memcpy(&copy);
+  pi_cl_dma_wait(&copy);
+
+  pi_perf_stop();
+
+  mhsa_result_t result;
+  result.window = w->window;
+  result.cycles = pi_perf_read(PI_PERF_CYCLES);
+  result.checksum = 0;
+  for (int i = 0; i < WINDOW_SIZE; i++)
+    result.checksum += (int8_t) Out[i];
+  mhsa_mailbox_post(w->mailbox, &result);
+}
+
+// Stands in for the FC side of the application (sensor I/O and
+// preprocessing): a deterministic window n, centred to int8
+static void prepare_window(char *in, uint32_t n) {
+  for (int i = 0; i < WINDOW_SIZE; i++)
+    in[i] = (char) ((((n * 31 + i * 7) & 0xFF)) - 128);
+}
+
+static void drain_mailbox(mhsa_mailbox_t *mailbox) {
+  mhsa_result_t result;
+  while (mhsa_mailbox_pop(mailbox, &result) == 0)
+    printf("Window %d: %d cycles, checksum %d\n", result.window, result.cycles, result.checksum);
+}
+% endif
+
 int main () {
 
   char* L1_buffer;
@@ -200,6 +304,54 @@ int main () {
     return -1;
   }
 
+% if pipelined:
+  // Two input / output windows and the mailbox in L2, one L1 working set
+  char *in[2], *out[2];
+  for (int b = 0; b < 2; b++)
+  {
+    in[b] = L2_buffer + 2 * b * WINDOW_SIZE;
+    out[b] = in[b] + WINDOW_SIZE;
+  }
+  mhsa_mailbox_t *mailbox = (mhsa_mailbox_t *) pi_l2_malloc(sizeof(mhsa_mailbox_t));
+  mhsa_mailbox_reset(mailbox);
+  char *L1_window = pi_cl_l1_malloc(&cluster_dev, (uint32_t) ${l1BufferSize});
+
+  struct pi_cluster_task window_cluster_task[2];
+  window_args_t window_args[2];
+  pi_task_t window_done[2];
+
+  uint32_t start_us = pi_time_get_us();
+  prepare_window(in[0], 0);
+  for (uint32_t n = 0; n < WINDOWS; n++)
+  {
+    int b = n & 1;
+
+    window_args[b].in = in[b];
+    window_args[b].out = out[b];
+    window_args[b].L1 = L1_window;
+    window_args[b].window = n;
+    window_args[b].mailbox = mailbox;
+    pi_cluster_task(&window_cluster_task[b], window_task, &window_args[b]);
+    pi_cluster_task_stacks(&window_cluster_task[b], NULL, SLAVE_STACK_SIZE);
+    pi_cluster_send_task_to_cl_async(&cluster_dev, &window_cluster_task[b], pi_task_block(&window_done[b]));
+
+    // Window n+1 goes to the buffer window n-1 used, done since the last wait
+    if (n + 1 < WINDOWS)
+      prepare_window(in[b^1], n + 1);
+    drain_mailbox(mailbox);
+
+    pi_task_wait_on(&window_done[b]);
+  }
+  drain_mailbox(mailbox);
+  uint32_t stop_us = pi_time_get_us();
+  printf("Pipelined windows: %d in %d us, %d dropped results\n", WINDOWS, stop_us - start_us, mailbox->dropped);
+
+  pi_cl_l1_free(&cluster_dev, L1_window, (uint32_t) ${l1BufferSize});
+  pi_l2_free(mailbox, sizeof(mhsa_mailbox_t));
+  pi_cluster_close(&cluster_dev);
+  return 0;
+% endif
+
   // Then offload an entry point, this will get executed on the cluster controller
   // cluster_task.stack_size = 3500;
   // cluster_task.slave_stack_size = 3400;
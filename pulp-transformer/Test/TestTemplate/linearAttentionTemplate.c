@@ -0,0 +1,233 @@
+/* ----------------------------------------------------------------------
+#
+# File: linearAttentionTemplate.c
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*/
+
+
+#include "../inc/${testInputHeaderName}.h"
+
+#include "pmsis.h"
+#include "bsp/fs.h"
+#include "bsp/bsp.h"
+#include <bsp/flash/spiflash.h>
+#include <bsp/fs/readfs.h>
+
+// #include "../inc/dory.h"
+#include "../inc/thorir_dma.h"
+#include "../inc/pulp_nn_utils.h"
+#include "../inc/pulp_nn_kernels.h"
+#include "../inc/stats.h"
+
+#define FLASH_BUFF_SIZE 128
+
+#define TEST_INPUTS
+#define PROFILING
+
+#ifdef PROFILING
+  #define START_PROFILING(){\
+      if(CORE_STATS_CORE()){\
+        pi_perf_conf((1<<${perf_counter}) | CORE_STATS_EVENTS);\
+        pi_perf_start();\
+      }\
+    }
+
+  #define STOP_PROFILING(){\
+    if(CORE_STATS_CORE()){\
+      pi_perf_stop();\
+      CORE_STATS_SAVE();\
+    }\
+    if(pi_core_id()==0){\
+      printf("Kernel Execution: %d\n", pi_perf_read(PI_PERF_ACTIVE_CYCLES));\
+      printf("${perf_counter}:%d\n", pi_perf_read(${perf_counter}));\
+    }\
+    CORE_STATS_PRINT("Kernel Execution");\
+  }
+#else
+
+#define START_PROFILING()
+#define STOP_PROFILING()
+
+#endif
+
+struct pi_mx25u51245g_conf flash_conf;
+static struct pi_hyper_conf ram_conf;
+static struct pi_device ram;
+static int activations_input;
+static uint8_t flashBuffer[FLASH_BUFF_SIZE];
+
+void cluster_fork(void *args) {
+
+  // Unpack args
+  char *Q = ((char **)args)[0];
+  char *K = ((char **)args)[1];
+  char *V = ((char **)args)[2];
+  char *O = ((char **)args)[3];
+  int32_t *scratch = ((int32_t **)args)[4];
+
+  // DMA Transfer Inputs from L2 to L1
+  printf("Allocate DMA Channel: ");
+  volatile DMA_copy DMA_copy_Q, DMA_copy_K, DMA_copy_V;
+  printf("DONE\n");
+
+  DMA_copy_Q.hwc_to_chw = 0;
+  DMA_copy_Q.stride_2d = 0;
+  DMA_copy_Q.stride_1d = 0;
+  DMA_copy_Q.dir = 1;
+  DMA_copy_Q.number_of_2d_copies = 1;
+  DMA_copy_Q.number_of_1d_copies = 1;
+  DMA_copy_Q.length_1d_copy = ${dmaTransferSize};
+
+  DMA_copy_K.hwc_to_chw = 0;
+  DMA_copy_K.stride_2d = 0;
+  DMA_copy_K.stride_1d = 0;
+  DMA_copy_K.dir = 1;
+  DMA_copy_K.number_of_2d_copies = 1;
+  DMA_copy_K.number_of_1d_copies = 1;
+  DMA_copy_K.length_1d_copy = ${dmaTransferSize};
+
+  DMA_copy_V.hwc_to_chw = 0;
+  DMA_copy_V.stride_2d = 0;
+  DMA_copy_V.stride_1d = 0;
+  DMA_copy_V.dir = 1;
+  DMA_copy_V.number_of_2d_copies = 1;
+  DMA_copy_V.number_of_1d_copies = 1;
+  DMA_copy_V.length_1d_copy = ${dmaTransferSize};
+
+  printf("Transfer Inputs: ");
+  for(int i = 0; i < ${numberOfTransferQ}; i++){
+    DMA_copy_Q.ext = (int)&(${vectorNameQ}) + ${dmaTransferSize}*i;
+    DMA_copy_Q.loc = Q + ${dmaTransferSize}*i;
+    thorir_dma(DMA_copy_Q);
+    DMA_copy_K.ext = (int)&(${vectorNameK}) + ${dmaTransferSize}*i;
+    DMA_copy_K.loc = K + ${dmaTransferSize}*i;
+    thorir_dma(DMA_copy_K);
+    DMA_copy_V.ext = (int)&(${vectorNameV}) + ${dmaTransferSize}*i;
+    DMA_copy_V.loc = V + ${dmaTransferSize}*i;
+    thorir_dma(DMA_copy_V);
+    pi_cl_team_barrier(0);
+  }
+  printf("DONE\n");
+
+  #ifdef TEST_INPUTS
+    if (pi_core_id()==0) {
+      printf("Tensor Q, K, V check:\n");
+      int check = 1;
+      for(int i = 0; i < ${sizeQ}; i++){
+        if((int8_t)Q[i] != ${vectorNameQ}[i] || (int8_t)K[i] != ${vectorNameK}[i] || (int8_t)V[i] != ${vectorNameV}[i]){
+          printf("\nError: Tensor Q, K, V Transfer Error at %d\n", i);
+          check = 0;
+        }
+      }
+      if(check){
+        printf("Tensor Q, K, V Transfer Correct");
+      }
+      printf("\n");
+    }
+  #endif
+
+  pi_cl_team_barrier(0);
+  START_PROFILING();
+  ${kernelName}(Q, K, V, O, scratch, ${S}, ${P}, ${H});
+  STOP_PROFILING();
+  pi_cl_team_barrier(0);
+
+  if (pi_core_id()==0) {
+  printf("Output:\n");
+  for(int i = 0; i < ${outputSize}; i++){
+  printf("%d, ", (int8_t)O[i]);
+  }
+    printf("\n");
+  }
+}
+
+void kernel_task(void *task_args) {
+
+  char* L1_buffer = pi_cl_l1_malloc((void *) 0, (uint32_t) ${l1BufferSize});
+
+  // Create L1 tensor pointers; the KV / z scratch is word aligned
+  printf("Declare Buffer Pointers: ");
+  char *Q = (char *) (L1_buffer + ${dmaTransferSize});
+  char *K = (char *) (L1_buffer + ${dmaTransferSize} + ${int(sizeQ + dmaTransferSize)});
+  char *V = (char *) (L1_buffer + ${dmaTransferSize} + ${int(2*(sizeQ + dmaTransferSize))});
+  char *O = (char *) (L1_buffer + ${dmaTransferSize} + ${int(3*(sizeQ + dmaTransferSize))});
+  int32_t *scratch = (int32_t *) (L1_buffer + ${dmaTransferSize} + ${int((4*(sizeQ + dmaTransferSize) + 3) & ~3)});
+  printf("DONE\n");
+
+   // Build agrs to give to cluster
+  unsigned int args[5] = {
+    Q,
+    K,
+    V,
+    O,
+    scratch
+  };
+
+  pi_cl_team_fork(NUM_CORES, cluster_fork, args);
+  pi_cl_l1_free((void *) 0, L1_buffer, (uint32_t) ${l1BufferSize});
+}
+
+int main () {
+
+  char* L1_buffer;
+  char* L2_buffer;
+
+  printf("Configure mcu: ");
+  struct pi_device cluster_dev = {0};
+  struct pi_cluster_conf conf;
+  struct pi_cluster_task cluster_task = {0};
+  struct pi_device fs;
+  struct pi_device flash;
+  
+  pi_freq_set(PI_FREQ_DOMAIN_FC, ${fcFrequency});
+  pi_time_wait_us(10000);
+  pi_freq_set(PI_FREQ_DOMAIN_CL, ${clFrequency});
+  pi_time_wait_us(10000);
+
+  pi_cluster_conf_init(&conf);
+  conf.id=0;
+  printf("DONE\n");
+
+  printf("Allocate L2: ");
+  L2_buffer = pi_l2_malloc((uint32_t) ${l2BufferSize});
+  printf("DONE\n");
+
+  unsigned int empty_args[0] = {};
+
+  // Start cluster job
+  printf("Start Cluster Task");
+  // Prepare Task
+  pi_cluster_task(&cluster_task, kernel_task, empty_args);
+
+  pi_open_from_conf(&cluster_dev, &conf);
+  if (pi_cluster_open(&cluster_dev)){
+    printf("Error: Can't open cluster\n");
+    return -1;
+  }
+
+  // Then offload an entry point, this will get executed on the cluster controller
+  // cluster_task.stack_size = 3500;
+  // cluster_task.slave_stack_size = 3400;
+  pi_cluster_send_task_to_cl(&cluster_dev, &cluster_task);
+
+  // Close the cluster
+  printf("End Cluster Task");
+  pi_cluster_close(&cluster_dev);
+}
\ No newline at end of file
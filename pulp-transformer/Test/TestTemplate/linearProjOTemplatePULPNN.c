@@ -37,6 +37,7 @@
 #include "../inc/thorir_dma.h"
 #include "../inc/pulp_nn_utils.h"
 #include "../inc/pulp_nn_kernels.h"
+#include "../inc/stats.h"
 
 #define clip8(x) __builtin_pulp_clip_r(x, 127)
 
@@ -46,8 +47,8 @@
 #define PROFILING
 
 #ifdef PROFILING
-  #define START_PROFILING()  if(pi_core_id()==0){ pi_perf_conf((1<<PI_PERF_ACTIVE_CYCLES)); pi_perf_reset(); pi_perf_stop(); pi_perf_start();}
-  #define STOP_PROFILING(str)  if(pi_core_id()==0){ pi_perf_stop(); printf("%s: %d\n", #str, pi_perf_read(PI_PERF_ACTIVE_CYCLES));}
+  #define START_PROFILING()  if(CORE_STATS_CORE()){ pi_perf_conf((1<<PI_PERF_ACTIVE_CYCLES) | CORE_STATS_EVENTS); pi_perf_reset(); pi_perf_stop(); pi_perf_start();}
+  #define STOP_PROFILING(str)  { if(CORE_STATS_CORE()){ pi_perf_stop(); CORE_STATS_SAVE(); } if(pi_core_id()==0){ printf("%s: %d\n", #str, pi_perf_read(PI_PERF_ACTIVE_CYCLES));} CORE_STATS_PRINT(#str); }
 #else
   #define START_PROFILING()
   #define STOP_PROFILING()
@@ -37,6 +37,7 @@
 #include "../inc/thorir_dma.h"
 #include "../inc/pulp_nn_utils.h"
 #include "../inc/pulp_nn_kernels.h"
+#include "../inc/stats.h"
 
 #define clip8(x) __builtin_pulp_clip_r(x, 127)
 
@@ -47,18 +48,22 @@
 
 #ifdef PROFILING
   #define START_PROFILING(){\
-      if(pi_core_id()==0){\
-        pi_perf_conf(1<<${perf_counter});\
+      if(CORE_STATS_CORE()){\
+        pi_perf_conf((1<<${perf_counter}) | CORE_STATS_EVENTS);\
         pi_perf_start();\
       }\
     }
 
   #define STOP_PROFILING(){\
-    if(pi_core_id()==0){\
+    if(CORE_STATS_CORE()){\
       pi_perf_stop();\
+      CORE_STATS_SAVE();\
+    }\
+    if(pi_core_id()==0){\
       printf("Kernel Execution: %d\n", pi_perf_read(PI_PERF_ACTIVE_CYCLES));\
       printf("${perf_counter}:%d\n", pi_perf_read(${perf_counter}));\
     }\
+    CORE_STATS_PRINT("Kernel Execution");\
   }
 
 #else
@@ -144,6 +149,25 @@ void cluster_fork(void *args) {
   pi_cl_team_barrier(0);
   // STOP_PROFILING();
 
+% if normWeightSize:
+  // layerNorm weights and biases of the fused epilogue, after the output
+  int32_t *N = (int32_t *) (O + ${outputSize + dmaTransferSize});
+  volatile DMA_copy DMA_copy_N;
+
+  DMA_copy_N.hwc_to_chw = 0;
+  DMA_copy_N.stride_2d = 0;
+  DMA_copy_N.stride_1d = 0;
+  DMA_copy_N.dir = 1;
+  DMA_copy_N.ext = &${normWeightVectorName};
+  DMA_copy_N.loc = N;
+  DMA_copy_N.number_of_2d_copies = 1;
+  DMA_copy_N.number_of_1d_copies = 1;
+  DMA_copy_N.length_1d_copy = ${normWeightSize};
+
+  thorir_dma(DMA_copy_N);
+  pi_cl_team_barrier(0);
+% endif
+
   #ifdef TEST_INPUTS
     if (pi_core_id()==0) {
       printf("Input check:\n");
@@ -190,7 +214,7 @@ void cluster_fork(void *args) {
   
   pi_cl_team_barrier(0);
   START_PROFILING();
-  ${kernelName}(I, W, B, O, ${S}, ${E}, ${P}, ${H}, ${requantDiv}, ${requantMul});
+  ${kernelName}(I, W, B, O, ${S}, ${E}, ${P}, ${H}, ${requantDiv}, ${requantMul}${epilogueArgs});
   pi_cl_team_barrier(0);
   STOP_PROFILING();
   
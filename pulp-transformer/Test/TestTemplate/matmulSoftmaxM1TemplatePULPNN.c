@@ -37,6 +37,7 @@
 #include "../inc/thorir_dma.h"
 #include "../inc/pulp_nn_utils.h"
 #include "../inc/pulp_nn_kernels.h"
+#include "../inc/stats.h"
 
 #define FLASH_BUFF_SIZE 128
 
@@ -48,18 +49,22 @@
 
 #ifdef PROFILING
   #define START_PROFILING(){\
-      if(pi_core_id()==0){\
-        pi_perf_conf(1<<${perf_counter});\
+      if(CORE_STATS_CORE()){\
+        pi_perf_conf((1<<${perf_counter}) | CORE_STATS_EVENTS);\
         pi_perf_start();\
       }\
     }
 
   #define STOP_PROFILING(){\
-    if(pi_core_id()==0){\
+    if(CORE_STATS_CORE()){\
       pi_perf_stop();\
+      CORE_STATS_SAVE();\
+    }\
+    if(pi_core_id()==0){\
       printf("Kernel Execution: %d\n", pi_perf_read(PI_PERF_ACTIVE_CYCLES));\
       printf("${perf_counter}:%d\n", pi_perf_read(${perf_counter}));\
     }\
+    CORE_STATS_PRINT("Kernel Execution");\
   }
 #else
   #define START_PROFILING()
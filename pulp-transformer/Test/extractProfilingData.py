@@ -2,7 +2,7 @@
 #
 # File: extractProfilingData.py
 #
-# Last edited: 28.09.2023
+# Last edited: 14.10.2026
 #
 # Copyright (C) 2023, ETH Zurich and University of Bologna.
 #
@@ -25,6 +25,67 @@
  
 
 import argparse
+import re
+import yaml
+
+# Theoretical SIMD peak per core: sdotsp4 (PULP) / SMLAD (Cortex-M, armProj*)
+PEAK_MACS_PER_CORE = 4
+PEAK_MACS_PER_CORE_ARM = 2
+
+def kernel_macs(test_name, S, E, P, H):
+
+    test_name_SEPH = ['projQK', 'projQKMacLoad', 'projV', 'projO', 'projPULPNN', 'projOPULPNN',
+                      'projQKW4', 'projVW4', 'projOW4', 'projW4PULPNN', 'armProjQK', 'armProjV', 'armProjO']
+
+    MACs = 0
+    if test_name in test_name_SEPH:
+        MACs = S*E*P*H
+    elif test_name == 'projQKV':
+        MACs = 3*S*E*P*H
+    elif test_name == 'linearAttention':
+        MACs = 2*H*S*P*P # relu(K)^T V, then relu(Q) KV
+    elif test_name.startswith('matmulSoftmaxFWA') and test_name.endswith('Causal'):
+        MACs = H*S*E*E + H*E*S*(S+1)//2 # scores of the keys j <= i only
+    elif test_name.startswith('matmulSoftmaxFWA'):
+        MACs = H*S*E*(E+S) # fused-weight projection, then the scores
+    elif test_name.endswith('Causal'):
+        MACs = H*P*S*(S+1)//2
+    else:
+        MACs = H*S*S*P
+    return MACs
+
+def kernel_l1_bytes(kernel_name, MACs):
+
+    # Operand bytes the inner loops load from L1. A block of rowsA activation
+    # rows x rowsW weight rows loads rowsA + rowsW words per rowsA * rowsW
+    # SIMD MACs, so 1/rowsW + wBytes/rowsA bytes per MAC (wBytes = 0.5 with
+    # packed int4 weights). Outputs, biases and softmax are not counted.
+    if '4x4' in kernel_name:
+        rowsA, rowsW = 4, 4
+    elif kernel_name.startswith('pulp_nn'):
+        rowsA, rowsW = 1, 2
+    elif kernel_name.startswith('linearV'):
+        rowsA, rowsW = 4, 2
+    else:
+        rowsA, rowsW = 2, 4
+    wBytes = 0.5 if ('_w4' in kernel_name or 'i8_i8_i4' in kernel_name) else 1
+    return MACs * (1/rowsW + wBytes/rowsA)
+
+def core_stats_field(core_stats):
+
+    # Per-core counters of the kernel (Helpers/stats.h CORE_STATS lines) as
+    # one result-log field: imbalance = max / mean active cycles, and the
+    # stall (load-use, jump-register, I-cache miss) and TCDM contention
+    # cycles as shares of the active cycles of all cores
+    if not core_stats:
+        return ''
+    active = [c["active"] for c in core_stats.values()]
+    total = max(sum(active), 1)
+    mean = total / len(active)
+    stall = sum(c["ld_stall"] + c["jr_stall"] + c["imiss"] for c in core_stats.values())
+    tcdm = sum(c["tcdm_cont"] for c in core_stats.values())
+    return (f"cores={len(active)},imb={max(active)/mean:.2f},"
+            f"stall={100*stall/total:.1f}%,tcdm={100*tcdm/total:.1f}%")
 
 def extract_profiling_data(log_file, result_file, args):
 
@@ -35,20 +96,25 @@ def extract_profiling_data(log_file, result_file, args):
 
     log_perf_counter = True
 
-    test_name_SEPH = ['projQK', 'projV', 'projO', 'projPULPNN', 'projOPULPNN']
-
-    MACs = 0
-    if args.test_name in test_name_SEPH:
-        MACs = S*E*P*H
-    else:
-        MACs = H*S*S*P
+    MACs = kernel_macs(args.test_name, S, E, P, H)
 
     with open(log_file, 'r') as f_log:
         with open(result_file, 'a') as f_result:
             sequential_cycles = 0
             execution_cycles = 0
             perf_counter = ''
+            core_stats = {}
+            core_line = re.compile(r"CORE_STATS Kernel Execution: core=(\d+) (.*)")
             for line in f_log:
+                if line.startswith("CORE_STATS"):
+                    match = core_line.search(line)
+                    if match is not None:
+                        # The last "Kernel Execution" region of the log counts
+                        if int(match.group(1)) == 0:
+                            core_stats = {}
+                        core_stats[int(match.group(1))] = {key: int(value) for key, value in
+                                                           (field.split("=") for field in match.group(2).split())}
+                    continue
                 if "Kernel Execution:" in line:
                     execution_cycles += int(line.split("Kernel Execution:")[1].strip())
                 if "Sequential:" in line:
@@ -61,15 +127,184 @@ def extract_profiling_data(log_file, result_file, args):
             
             if log_perf_counter:
                 log_str = log_str.strip() + ":" + perf_counter.strip() + '\n'
+            log_str = log_str.strip() + ":" + core_stats_field(core_stats) + '\n'
             f_result.write(log_str)
 
+def read_profiling_results(result_file):
+
+    # test name -> {(S, E, P, H): cycles}, from the extract_profiling_data lines
+    results = {}
+    pattern = re.compile(r"^(\w+):\(S=(\d+),E=(\d+),P=(\d+),H=(\d+)\):(\d+):")
+    with open(result_file, 'r') as f_result:
+        for line in f_result:
+            match = pattern.match(line)
+            if match is None:
+                continue
+            test_name = match.group(1)
+            shape = tuple(int(match.group(i)) for i in range(2, 6))
+            cycles = int(match.group(6))
+            # A failed run logs 1 cycle (no "Kernel Execution:" line)
+            if cycles > 1:
+                results.setdefault(test_name, {})[shape] = cycles
+    return results
+
+def read_core_stats(result_file):
+
+    # test name -> {(S, E, P, H): (imbalance, stall %, tcdm %)}, from the
+    # core_stats_field of the result lines that have one
+    stats = {}
+    shape = re.compile(r"^(\w+):\(S=(\d+),E=(\d+),P=(\d+),H=(\d+)\):")
+    field = re.compile(r"imb=([\d.]+),stall=([\d.]+)%,tcdm=([\d.]+)%")
+    with open(result_file, 'r') as f_result:
+        for line in f_result:
+            match, values = shape.match(line), field.search(line)
+            if match is None or values is None:
+                continue
+            key = tuple(int(match.group(i)) for i in range(2, 6))
+            stats.setdefault(match.group(1), {})[key] = tuple(float(values.group(i)) for i in range(1, 4))
+    return stats
+
+def emit_report(result_file, config_file, out_file, sweep=None):
+
+    # Roofline / utilization table of the result log, one block per shape with
+    # the tests in testToRun order, so kernels can be compared at a glance
+    with open(config_file, 'r') as f_config:
+        config = yaml.safe_load(f_config)
+    cores = config["cores"]
+    results = read_profiling_results(result_file)
+    core_stats = read_core_stats(result_file)
+
+    order = list((config[sweep] if sweep else config).get("testToRun", []))
+    order += sorted(test for test in results if test not in order)
+    shapes = sorted(set(shape for test in results for shape in results[test]))
+
+    header = f"{'test':<26} {'kernel':<30} {'cycles':>10} {'MACs':>10} {'MAC/cyc':>8} {'/core':>6} {'peak%':>6} {'L1 bytes':>10} {'MAC/B':>6} {'imb':>5} {'stall%':>6} {'tcdm%':>6}"
+    lines = []
+    lines.append(f"# Kernel utilization from {result_file}")
+    lines.append(f"# peak: {PEAK_MACS_PER_CORE} MAC/cycle per core (sdotsp4) x {cores} cores, "
+                 f"{PEAK_MACS_PER_CORE_ARM} MAC/cycle on 1 core for armProj*")
+    lines.append("# L1 bytes: operand loads of the inner loops (kernel_l1_bytes), MAC/B: arithmetic intensity")
+    lines.append("# imb: max / mean active cycles over the cores, stall% / tcdm%: stall and TCDM contention cycles "
+                 "per active cycle (Helpers/stats.h)")
+    for S, E, P, H in shapes:
+        lines.append("")
+        lines.append(f"S={S} E={E} P={P} H={H}")
+        lines.append(header)
+        for test in order:
+            cycles = results.get(test, {}).get((S, E, P, H))
+            if cycles is None:
+                continue
+            kernel_name = str(config.get(test, {}).get("kernelName", test))
+            if test.startswith('arm'):
+                test_cores, peak = 1, PEAK_MACS_PER_CORE_ARM
+            else:
+                test_cores, peak = cores, PEAK_MACS_PER_CORE * cores
+            MACs = kernel_macs(test, S, E, P, H)
+            l1_bytes = kernel_l1_bytes(kernel_name, MACs)
+            rate = MACs / cycles
+            imb, stall, tcdm = core_stats.get(test, {}).get((S, E, P, H), (None, None, None))
+            cores_str = (f" {imb:>5.2f} {stall:>5.1f}% {tcdm:>5.1f}%" if imb is not None
+                         else f" {'-':>5} {'-':>6} {'-':>6}")
+            lines.append(f"{test:<26} {kernel_name:<30} {cycles:>10} {MACs:>10} {rate:>8.2f} {rate/test_cores:>6.2f} "
+                         f"{100*rate/peak:>5.1f}% {int(l1_bytes):>10} {MACs/l1_bytes:>6.2f}" + cores_str)
+
+    with open(out_file, 'w') as f_out:
+        f_out.write("\n".join(lines) + "\n")
+    print("\n".join(lines))
+
+def emit_compare(result_file, base_file, out_file):
+
+    # Speedup of the result log over a baseline log (e.g. WORK_QUEUE=1 against
+    # the static split), for every test and shape both logs measured
+    results = read_profiling_results(result_file)
+    base = read_profiling_results(base_file)
+    stats, base_stats = read_core_stats(result_file), read_core_stats(base_file)
+
+    lines = []
+    lines.append(f"# Cycles of {result_file} against {base_file}")
+    lines.append(f"{'test':<26} {'shape':<22} {'base':>10} {'cycles':>10} {'speedup':>7} {'imb':>11}")
+    for test in sorted(set(results) & set(base)):
+        for shape in sorted(set(results[test]) & set(base[test])):
+            S, E, P, H = shape
+            imb = [s.get(test, {}).get(shape, (None,))[0] for s in (base_stats, stats)]
+            imb_str = " -> ".join(f"{i:.2f}" if i is not None else "-" for i in imb)
+            lines.append(f"{test:<26} {f'S={S},E={E},P={P},H={H}':<22} {base[test][shape]:>10} "
+                         f"{results[test][shape]:>10} {base[test][shape] / results[test][shape]:>6.2f}x {imb_str:>11}")
+
+    with open(out_file, 'w') as f_out:
+        f_out.write("\n".join(lines) + "\n")
+    print("\n".join(lines))
+
+def emit_dispatch(result_file, config_file, out_file):
+
+    with open(config_file, 'r') as f_config:
+        config = yaml.safe_load(f_config)
+    stages = config["autotune"]["stages"]
+    results = read_profiling_results(result_file)
+
+    # shape -> [(stage, fastest kernel, cycles, other candidates)]
+    choices = {}
+    for stage, tests in stages.items():
+        shapes = set()
+        for test in tests:
+            shapes |= set(results.get(test, {}).keys())
+        for shape in shapes:
+            measured = [(results[test][shape], config[test]["kernelName"]) for test in tests if shape in results.get(test, {})]
+            measured.sort()
+            others = ", ".join(f"{kernel}: {cycles}" for cycles, kernel in measured[1:])
+            choices.setdefault(shape, []).append((stage, measured[0][1], measured[0][0], others))
+
+    lines = []
+    lines.append("// Generated by extractProfilingData.py --emit_dispatch from")
+    lines.append(f"// {result_file}: fastest measured kernel per MHSA stage and shape.")
+    lines.append("// Kernel/includes/mhsa_dispatch.h documents the macros.")
+    lines.append("")
+    lines.append("#ifndef __MHSA_DISPATCH__")
+    lines.append("#define __MHSA_DISPATCH__")
+    lines.append("")
+    for i, shape in enumerate(sorted(choices)):
+        S, E, P, H = shape
+        cond = f"MHSA_S == {S} && MHSA_E == {E} && MHSA_P == {P} && MHSA_H == {H}"
+        lines.append(("#if " if i == 0 else "#elif ") + cond)
+        for stage, kernel, cycles, others in sorted(choices[shape]):
+            comment = f"// {cycles} cycles" + (f" ({others})" if others else "")
+            lines.append(f"#define {stage} {kernel} {comment}")
+    if choices:
+        lines.append("#endif")
+        lines.append("")
+    lines.append("// Defaults for shapes that were not tuned")
+    for stage, tests in stages.items():
+        lines.append(f"#ifndef {stage}")
+        lines.append(f"#define {stage} {config[tests[0]]['kernelName']}")
+        lines.append("#endif")
+    lines.append("")
+    lines.append("#endif")
+
+    with open(out_file, 'w') as f_out:
+        f_out.write("\n".join(lines) + "\n")
+    print(f"Dispatch for {len(choices)} shapes written to {out_file}")
+
 if __name__ == '__main__':
     parser = argparse.ArgumentParser(description='Extract profiling data from log.')
     parser.add_argument('--log_file', type=str, required=True, help='Path to the log file.')
     parser.add_argument('--MHSA_params', nargs=4, type=int, help='MHSA parameters (S E P H).')
-    parser.add_argument('--kernel_name', type=str, required=True, help='Name of the kernel.')
-    parser.add_argument('--test_name', type=str, required=True, help='Name of the test.')
-    parser.add_argument('--result_file', type=str, required=True, help='Path to the result file.')
+    parser.add_argument('--kernel_name', type=str, help='Name of the kernel.')
+    parser.add_argument('--test_name', type=str, help='Name of the test.')
+    parser.add_argument('--result_file', type=str, help='Path to the result file.')
+    parser.add_argument('--emit_dispatch', type=str, metavar='HEADER', help='Write the fastest kernel per stage and shape found in the result log (--log_file) to HEADER.')
+    parser.add_argument('--report', type=str, metavar='FILE', help='Write the utilization table of the result log (--log_file) to FILE.')
+    parser.add_argument('--compare', type=str, metavar='BASE_LOG', help='With --report: write the speedup of the result log (--log_file) over BASE_LOG instead.')
+    parser.add_argument('--sweep', type=str, help='Sweep block whose testToRun orders the report (--report).')
+    parser.add_argument('--config', type=str, default='testConfig.yml', help='Config file with the autotune stages (--emit_dispatch) and testToRun / cores (--report).')
 
     args = parser.parse_args()
-    extract_profiling_data(args.log_file, args.result_file, args)
+    if args.emit_dispatch:
+        emit_dispatch(args.log_file, args.config, args.emit_dispatch)
+    elif args.report and args.compare:
+        emit_compare(args.log_file, args.compare, args.report)
+    elif args.report:
+        emit_report(args.log_file, args.config, args.report, args.sweep)
+    else:
+        if args.MHSA_params is None or args.kernel_name is None or args.test_name is None or args.result_file is None:
+            parser.error('--MHSA_params, --kernel_name, --test_name and --result_file are required')
+        extract_profiling_data(args.log_file, args.result_file, args)
@@ -2,7 +2,7 @@
 #
 # File: generateGoldenOutput.py
 #
-# Last edited: 29.08.2023
+# Last edited: 14.10.2026
 #
 # Copyright (C) 2023, ETH Zurich and University of Bologna.
 #
@@ -32,6 +32,74 @@ import yaml
 
 import GoldenModel
 
+GOLDEN_CACHE_DIR = "./Results/goldenCache"
+
+def goldenIo(config, testName, MHSAParams: Dict, requantParams: Dict):
+
+    # Inputs and golden output of a test at one shape, generated from the
+    # config seed and cached in GOLDEN_CACHE_DIR by (input generator, golden
+    # kernel, shape, requant, seed): the kernels of a sweep or autotune stage
+    # that share a golden model only compute it once. GOLDEN_CACHE=0 bypasses
+    # the cache.
+    S, E, P, H = MHSAParams["S"], MHSAParams["E"], MHSAParams["P"], MHSAParams["H"]
+    inputGenName = config[testName]["inputGen"]
+    goldenKernelName = config[testName]["goldenKernel"]
+
+    if inputGenName == "None":
+        return None, None
+
+    cacheFile = os.path.join(GOLDEN_CACHE_DIR, f"{inputGenName}-{goldenKernelName}-S{S}E{E}P{P}H{H}"
+                             f"-r{requantParams['div']}x{requantParams['mul']}-seed{config['seed']}.pt")
+    useCache = os.environ.get("GOLDEN_CACHE", "1") != "0"
+
+    if useCache and os.path.exists(cacheFile):
+        cached = torch.load(cacheFile)
+        return cached["inputs"], cached["output"]
+
+    torch.manual_seed(config["seed"])
+    inputDict = getattr(GoldenModel, inputGenName)(S, E, P, H)
+
+    output = None
+    if goldenKernelName != "None":
+        # The golden models get a copy, so the cached inputs are the headers' ones
+        goldenInputs = {name: dict(tensor, data=tensor["data"].clone()) for name, tensor in inputDict.items()}
+        output = getattr(GoldenModel, goldenKernelName)(goldenInputs, requantParams, MHSAParams)
+
+    if useCache:
+        os.makedirs(GOLDEN_CACHE_DIR, exist_ok=True)
+        torch.save({"inputs": inputDict, "output": output}, cacheFile)
+
+    return inputDict, output
+
+def warmGoldenCache(sweep=None):
+
+    # Fill the golden cache for every test and shape of a run in this one
+    # process, before kernelTest.sh starts a generateIoAndTemplate.py per test
+    with open('./testConfig.yml', 'r') as file:
+        config = yaml.load(file, Loader=yaml.FullLoader)
+
+    block = config[sweep] if sweep else config
+    if "stages" in block:
+        tests = [test for stage in block["stages"].values() for test in stage]
+    else:
+        tests = block["testToRun"]
+
+    requantParams = {"div": 16, "mul": 385}
+    done = set()
+    for S in block["S"]:
+        for E in block["E"]:
+            for P in block["P"]:
+                for H in block["H"]:
+                    MHSAParams = {"S": S, "E": E, "P": P, "H": H}
+                    for testName in tests:
+                        key = (config[testName]["inputGen"], config[testName]["goldenKernel"], S, E, P, H)
+                        if key in done:
+                            continue
+                        done.add(key)
+                        goldenIo(config, testName, MHSAParams, requantParams)
+
+    print(f"Golden cache: {len(done)} golden models in {GOLDEN_CACHE_DIR}")
+
 
 def generateIoAndTemplate(args):
 
@@ -49,28 +117,33 @@ def generateIoAndTemplate(args):
     with open('./testConfig.yml', 'r') as file:
         config = yaml.load(file, Loader=yaml.FullLoader)
 
-    testName = config["testToRun"][args.test_idx]
+    testName = args.test_name if args.test_name else config["testToRun"][args.test_idx]
+
+    inputDict, output = goldenIo(config, testName, MHSAParams, requantParams)
 
-    if config[testName]["inputGen"] != "None":
-        inputGen = getattr(GoldenModel, config[testName]["inputGen"])
-        inputDict = inputGen(S, E, P, H)
+    if inputDict is not None:
         generateHeaders(inputDict, args)
 
-    if config[testName]["goldenKernel"] != "None":
-        goldenKernel = getattr(GoldenModel, config[testName]["goldenKernel"])
-        output = goldenKernel(inputDict, requantParams, MHSAParams)
+    if output is not None:
         torch.save(output, f'{args.app_folder}/testGoldenOutput.pt')
 
     torch.manual_seed(config["seed"])
 
-    headerToCopy = ["dory.h", "mchan_test.h", "pulp_nn_kernels.h", "pulp_nn_utils.h", "thorir_dma.h"]
-    srcToCopy = ["dory.c", "iSoftmax.c", "thorir_dma.c"]
+    headerToCopy = ["dory.h", "mchan_test.h", "pulp_nn_kernels.h", "pulp_nn_utils.h", "pulp_nn_macload.h", "thorir_dma.h", "mhsa_dispatch.h", "mhsa_mailbox.h", "stats.h", "cluster_work_queue.h", "l3_prefetch.h"]
+    srcToCopy = ["dory.c", "iSoftmax.c", "thorir_dma.c", "l3_prefetch.c"]
 
     if args.kernel_name != "MHSA":
-        srcToCopy += ["linearQK_4x2_H.c", "linearV_4x2_H.c", "matmulSoftmax_4x2_S.c", 
+        srcToCopy += ["linearQK_4x2_H.c", "linearV_4x2_H.c", "linearQKV_4x2_H.c", "matmulSoftmax_4x2_S.c", 
                       "matmul_4x2_S.c", "linearO_4x2_H.c", "matmulSoftmax_FWA_v3_H.c", 
                       "matmulSoftmax_FWA_v3_S.c", "pulp_nn_linear_i8_i8_i8.c", "matmulSoftmax_4x2_H.c", 
-                      "matmul_4x2_H.c"]
+                      "matmul_4x2_H.c", "linearO_4x2_H_LN.c", "pulp_nn_linear_gelu_i8_i8_i8.c",
+                      "linearO_4x2_H_GELU.c", "encoderLayer_FWA.c",
+                      "mhsaTiled_H.c", "linearQK_4x2_H_tiled.c", "matmulSoftmax_FWA_v3_H_tiled.c",
+                      "matmul_4x2_S_tiled.c", "linearO_4x2_H_tiled.c", "matmulSoftmax_4x2_H_causal.c",
+                      "matmulSoftmax_FWA_v3_H_causal.c", "tinyformerEncoder.c",
+                      "linearQK_4x4_H_macload.c", "matmulSoftmax_4x4_H_macload.c", "matmul_4x4_H_macload.c",
+                      "linearQK_4x2_H_w4.c", "linearV_4x2_H_w4.c", "linearO_4x2_H_w4.c",
+                      "pulp_nn_linear_i8_i8_i4.c", "linearAttention_H.c"]
     else:
         srcToCopy += [args.kernel_name + ".c"]
 
@@ -79,7 +152,7 @@ def generateIoAndTemplate(args):
     templateGen = getattr(GoldenModel, config[testName]["templateGen"])
     templateGen(MHSAParams, requantParams, args)
 
-def generateHeaders(tensorDict: Dict, args):
+def generateHeaders(tensorDict: Dict, args, include='#include "pmsis.h"'):
 
     retStr = ""
     for name, tensorDict in tensorDict.items():
@@ -88,7 +161,7 @@ def generateHeaders(tensorDict: Dict, args):
         tensor = tensor.numpy()
         tensor = tensor.astype(int)
 
-        retStr += '#include "pmsis.h"\n\n'
+        retStr += include + '\n\n'
         retStr += f"{tensorDict['type']} testInputVector{name}[] ="
         retStr += "{"
         list_str = (", ").join([str(x) for x in tensor])
@@ -99,7 +172,7 @@ def generateHeaders(tensorDict: Dict, args):
     f.write(retStr)
     f.close()
 
-def copyFilesToApp(headerToCopy: List[str], srcToCopy: List[str], app_folder):
+def copyFilesToApp(headerToCopy: List[str], srcToCopy: List[str], app_folder, kernel_folder="../Kernel", makefile="Makefile"):
 
     # Ensure the destination directories exist
     os.makedirs(os.path.join(app_folder, "inc"), exist_ok=True)
@@ -107,16 +180,19 @@ def copyFilesToApp(headerToCopy: List[str], srcToCopy: List[str], app_folder):
 
     # Copy header files
     for header in headerToCopy:
-        source_path_kernel = os.path.join("../Kernel/includes", header) 
+        source_path_kernel = os.path.join(kernel_folder, "includes", header)
         source_path_helpers = os.path.join("./Helpers", header)
+        source_path_results = os.path.join("./Results", header)   # Autotuned mhsa_dispatch.h
 
         # Determine which source path exists
-        if os.path.exists(source_path_helpers):
+        if os.path.exists(source_path_results):
+            source_path = source_path_results
+        elif os.path.exists(source_path_helpers):
             source_path = source_path_helpers
         elif os.path.exists(source_path_kernel):
             source_path = source_path_kernel
         else:
-            print(f"Warning: Source file {header} not found in Helpers or ../Kernel/src.")
+            print(f"Warning: Source file {header} not found in Helpers or {kernel_folder}/includes.")
             continue
 
         dest_path = os.path.join(app_folder, "inc", header)
@@ -125,7 +201,7 @@ def copyFilesToApp(headerToCopy: List[str], srcToCopy: List[str], app_folder):
     # Copy source files
     for src in srcToCopy:
         source_path_helpers = os.path.join("./Helpers", src)   # Look in Helpers
-        source_path_kernel = os.path.join("../Kernel/src", src)  # Look in Kernel/src
+        source_path_kernel = os.path.join(kernel_folder, "src", src)  # Look in Kernel/src
 
         # Determine which source path exists
         if os.path.exists(source_path_helpers):
@@ -133,14 +209,14 @@ def copyFilesToApp(headerToCopy: List[str], srcToCopy: List[str], app_folder):
         elif os.path.exists(source_path_kernel):
             source_path = source_path_kernel
         else:
-            print(f"Warning: Source file {src} not found in Helpers or ../Kernel/src.")
+            print(f"Warning: Source file {src} not found in Helpers or {kernel_folder}/src.")
             continue
 
         dest_path = os.path.join(app_folder, "src", src)
         shutil.copy2(source_path, dest_path)
     
     # Copy Makefile
-    source_path = os.path.join("./Helpers", "Makefile")
+    source_path = os.path.join("./Helpers", makefile)
     dest_path = os.path.join(app_folder, "Makefile")
     shutil.copy2(source_path, dest_path)
 
@@ -160,39 +236,52 @@ def generateIOHeadersARM(args):
     with open('./testConfig.yml', 'r') as file:
         config = yaml.load(file, Loader=yaml.FullLoader)
 
-    testName = config["testToRun"][args.test_idx]
+    testName = args.test_name if args.test_name else config["testToRun"][args.test_idx]
 
-    inputGen = getattr(GoldenModel, config[testName]["inputGen"])
     templateGen = getattr(GoldenModel, config[testName]["templateGen"])
-    goldenKernel = getattr(GoldenModel, config[testName]["goldenKernel"])
 
     torch.manual_seed(config["seed"])
 
-    inputDict = inputGen(S, E, P, H)
-    output = goldenKernel(inputDict, requantParams, MHSAParams)
+    inputDict, output = goldenIo(config, testName, MHSAParams, requantParams)
+    torch.save(output, f'{args.app_folder}/testGoldenOutput.pt')
 
-    # Generate headers ARM
+    # Generate headers ARM: no pmsis, the kernels come from Kernel/ARM and
+    # Helpers/Makefile.arm builds them for the Cortex-M given by CPU
+    generateHeaders(inputDict, args, include='#include <stdint.h>')
 
-    
+    headerToCopy = ["arm_kernels.h", "arm_kernels_utils.h"]
+    srcToCopy = ["arm_gemm_4x2.c", "iSoftmax.c", args.kernel_name + ".c"]
+
+    copyFilesToApp(headerToCopy, srcToCopy, args.app_folder, kernel_folder="../Kernel/ARM", makefile="Makefile.arm")
+
+    templateGen(MHSAParams, requantParams, args)
 
 if __name__ == "__main__":
 
     parser = argparse.ArgumentParser(description="Process MHSA parameters and other options.")
 
     # MHSA_params expects exactly 4 arguments
-    parser.add_argument('--MHSA_params', type=int,  nargs=4, metavar=('S', 'E', 'P', 'H'), required=True, help='Provide exactly 4 arguments for MHSA parameters.')
+    parser.add_argument('--MHSA_params', type=int,  nargs=4, metavar=('S', 'E', 'P', 'H'), help='Provide exactly 4 arguments for MHSA parameters.')
     # kernel_name expects a single argument
-    parser.add_argument('--kernel_name', type=str, required=True, help='Kernel name.')
+    parser.add_argument('--kernel_name', type=str, help='Kernel name.')
     # app_folder expects a single argument
-    parser.add_argument('--app_folder', type=str, required=True, help='Application folder.')
-    parser.add_argument('--board', type=str, required=True, help='Board to use.')
-    parser.add_argument('--test_idx', type=int, required=True, help='Index of the test to run.')
+    parser.add_argument('--app_folder', type=str, help='Application folder.')
+    parser.add_argument('--board', type=str, help='Board to use.')
+    parser.add_argument('--test_idx', type=int, help='Index of the test to run.')
+    parser.add_argument('--test_name', type=str, help='Name of the test to run (default: testToRun[test_idx]), for SWEEP and AUTOTUNE runs.')
     parser.add_argument('--ARM', type=bool, help='Run on ARM.')
     parser.add_argument('--perf_cnt', type=str)
 
+    parser.add_argument('--warm_cache', action='store_true', help='Only fill the golden cache for every test and shape of the run.')
+    parser.add_argument('--sweep', type=str, help='With --warm_cache: config block of the run (SWEEP name or autotune).')
+
     args = parser.parse_args()
 
-    if args.ARM:
+    if args.warm_cache:
+        warmGoldenCache(args.sweep)
+    elif None in (args.MHSA_params, args.kernel_name, args.app_folder, args.board, args.test_idx):
+        parser.error('--MHSA_params, --kernel_name, --app_folder, --board and --test_idx are required')
+    elif args.ARM:
         generateIOHeadersARM(args)
     else:
         generateIoAndTemplate(args)
@@ -8,6 +8,31 @@ get_yaml_value() {
 
 config_file="testConfig.yml"
 
+# SWEEP=<block>: take the S/E/P/H lists and testToRun from that block of the
+# config file (e.g. SWEEP=balanceSweep ./kernelTest.sh)
+prefix=""
+if [ -n "$SWEEP" ]; then
+    prefix="$SWEEP."
+fi
+
+# AUTOTUNE=1: run every candidate kernel of the autotune stages over the
+# autotune shapes, then write the fastest one per stage and shape to
+# Results/mhsa_dispatch.h (used by the MHSA templates instead of
+# Kernel/includes/mhsa_dispatch.h)
+result_file="./Results/kernelTestResults.log"
+# WORK_QUEUE=1: build the kernels with the shared work queue
+# (cluster_work_queue.h) and log to Results/kernelTestResultsWorkQueue.log,
+# then compare it with the static-split log of an earlier run
+if [ "$WORK_QUEUE" == "1" ]; then
+    result_file="./Results/kernelTestResultsWorkQueue.log"
+fi
+if [ "$AUTOTUNE" == "1" ]; then
+    prefix="autotune."
+    result_file="./Results/autotune.log"
+    mkdir -p ./Results
+    rm -f $result_file
+fi
+
 # S=$(get_yaml_value "S")
 # E=$(get_yaml_value "E")
 # P=$(get_yaml_value "P")
@@ -17,12 +42,21 @@ cores=$(get_yaml_value "cores")
 board=$(get_yaml_value "board")
 board=${board:1:-1}
 
-listS=$(get_yaml_value "S[]")
-listE=$(get_yaml_value "E[]")
-listP=$(get_yaml_value "P[]")
-listH=$(get_yaml_value "H[]")
+listS=$(get_yaml_value "${prefix}S[]")
+listE=$(get_yaml_value "${prefix}E[]")
+listP=$(get_yaml_value "${prefix}P[]")
+listH=$(get_yaml_value "${prefix}H[]")
+
+testList=$(get_yaml_value "${prefix}testToRun[]")
+if [ "$AUTOTUNE" == "1" ]; then
+    testList=$(get_yaml_value "autotune.stages[][]")
+fi
 
-testList=$(get_yaml_value "testToRun[]")
+# Inputs and golden outputs of every test and shape in one process, cached in
+# Results/goldenCache by shape and seed (GOLDEN_CACHE=0 regenerates them)
+if [ "$GOLDEN_CACHE" != "0" ]; then
+    python generateIoAndTemplate.py --warm_cache ${prefix:+--sweep ${prefix%.}}
+fi
 
 for S in $listS; do
     for E in $listE; do
@@ -43,8 +77,34 @@ for S in $listS; do
                     mkdir -p $app_folder
 
                     if [ "$platform" == "ARM_QEMU" ]; then
-                        echo "ARM config"
-                    
+                        # Cortex-M backend (Kernel/ARM), ARM_CPU=cortex-m4|cortex-m7|cortex-m55
+                        arm_cpu=${ARM_CPU:-cortex-m55}
+                        mkdir -p $app_folder/inc
+                        mkdir -p $app_folder/src
+                        touch $app_folder/qemu.log
+
+                        echo "Test $test ($arm_cpu):"
+                        echo -e "\t S: $S"
+                        echo -e "\t E: $E"
+                        echo -e "\t P: $P"
+                        echo -e "\t H: $H"
+                        echo -e "\t kernel_name: $kernel_name"
+                        echo -e "\t app_folder: $app_folder"
+
+                        python generateIoAndTemplate.py --MHSA_params $S $E $P $H --kernel_name $kernel_name --app_folder $app_folder --board $board --test_idx $idx --test_name $test_name --ARM True $1 $2
+                        idx=$((idx + 1))
+
+                        echo "Running the test..."
+                        make clean -C $app_folder >/dev/null
+                        echo "make all -C $app_folder CPU=$arm_cpu > /dev/null"
+                        make all -C $app_folder CPU=$arm_cpu > /dev/null
+                        echo "make run -C $app_folder CPU=$arm_cpu > $app_folder/qemu.log"
+                        make run -C $app_folder CPU=$arm_cpu > $app_folder/qemu.log
+
+                        echo "Comparing the output..."
+                        python compareOutput.py --log_file $app_folder/qemu.log --MHSA_params $S $E $P $H --kernel_name $kernel_name --app_folder $app_folder
+                        python extractProfilingData.py --log_file $app_folder/qemu.log --MHSA_params $S $E $P $H --kernel_name $kernel_name --test_name $test_name --result_file $result_file
+
                     else
                         mkdir -p $app_folder/inc
                         mkdir -p $app_folder/src
@@ -59,7 +119,7 @@ for S in $listS; do
                         echo -e "\t app_folder: $app_folder"
 
                         # Generate and save golden I/O and create the template
-                        python generateIoAndTemplate.py --MHSA_params $S $E $P $H --kernel_name $kernel_name --app_folder $app_folder --board $board --test_idx $idx $1 $2
+                        python generateIoAndTemplate.py --MHSA_params $S $E $P $H --kernel_name $kernel_name --app_folder $app_folder --board $board --test_idx $idx --test_name $test_name $1 $2
                         idx=$((idx + 1))
 
                         # Run the test and dump outputs
@@ -83,13 +143,13 @@ for S in $listS; do
                             fi
                         fi
                         
-                        if [ $test_name != "MHSA" ] && [ $test_name != "MHSAFWA" ] && [ $test_name != "MHSAPULPNN" ]; then
+                        if [ $test_name != "MHSA" ] && [ $test_name != "MHSAPipelined" ] && [ $test_name != "MHSAFWA" ] && [ $test_name != "MHSAPULPNN" ] && [ $test_name != "EncoderLayerFWA" ] && [ $test_name != "TinyFormerEncoder" ] && [ $test_name != "MHSATiled" ] && [ $test_name != "MHSATiledT" ] && [ $test_name != "MHSATiledLayers" ] && [ $test_name != "MHSALayersL3" ]; then
                             echo "Comparing the output..."
                             # Collect output from the log file and compare with the golden output
                             python compareOutput.py --log_file $app_folder/gvsoc.log --MHSA_params $S $E $P $H --kernel_name $kernel_name --app_folder $app_folder
 
                             # Write profiling data to the log file
-                            python extractProfilingData.py --log_file $app_folder/gvsoc.log --MHSA_params $S $E $P $H --kernel_name $kernel_name --test_name $test_name --result_file ./Results/kernelTestResults.log
+                            python extractProfilingData.py --log_file $app_folder/gvsoc.log --MHSA_params $S $E $P $H --kernel_name $kernel_name --test_name $test_name --result_file $result_file
                         fi
                     fi
                 done
@@ -98,13 +158,15 @@ for S in $listS; do
     done
 done
 
-
-
-
-
-
-
-
-
-
-
+if [ "$AUTOTUNE" == "1" ]; then
+    python extractProfilingData.py --log_file $result_file --config $config_file --emit_dispatch ./Results/mhsa_dispatch.h
+fi
+
+# MAC/cycle, share of the SIMD peak and arithmetic intensity of every kernel
+# in the result log, side by side per shape
+if [ -f $result_file ]; then
+    python extractProfilingData.py --log_file $result_file --config $config_file --report ./Results/kernelReport.txt ${SWEEP:+--sweep $SWEEP}
+fi
+if [ "$WORK_QUEUE" == "1" ] && [ -f ./Results/kernelTestResults.log ]; then
+    python extractProfilingData.py --log_file $result_file --compare ./Results/kernelTestResults.log --report ./Results/workQueueReport.txt
+fi
@@ -0,0 +1,289 @@
+# ----------------------------------------------------------------------
+#
+# File: tilingSolver.py
+#
+# Last edited: 14.10.2026
+#
+# Copyright (C) 2023, ETH Zurich and University of Bologna.
+#
+# ----------------------------------------------------------------------
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+
+# L2/L1 tiling of the MHSA layers for the _tiled wrappers in Kernel/src
+# (linearQK_4x2_H_tiled, matmulSoftmax_FWA_v3_H_tiled, matmul_4x2_S_tiled,
+# linearO_4x2_H_tiled). Port of Legacy/layer_generator/tiling_creation.py to
+# the current kernels: for every layer the tile size that fits the L1 budget
+# and minimises the estimated cycles is picked, and the result is written to a
+# header read by the test templates.
+#
+# The tiled dimension is the heads (or the sequence for linearO), so there are
+# at most H (or S) candidates per layer and they are enumerated instead of
+# handed to a constraint solver; ceil() and max() in the cost model are then
+# exact instead of linearised.
+#
+# Models whose weights do not fit L2 add a third level: the weights of every
+# layer stay in L3 (HyperRAM or flash, read through the FC) and are prefetched
+# into one of two L2 slots while the cluster tiles the previous ones from L2
+# into L1. solve_l3_schedule() picks the prefetch unit, the weights of a whole
+# layer or of one kernel, for an L2 budget and the L3 bandwidth.
+
+import argparse
+import math
+
+NUM_CORES = 8
+# Throughput of the 4x2 int8 kernels, in MACs per cycle and core
+MACS_PER_CYCLE = 8
+# iSoftmax cycles per score and core
+SOFTMAX_CYCLES = 12
+# L2 -> L1 DMA bytes per cycle
+DMA_BYTES_PER_CYCLE = 8
+# DMA setup, waits and barriers per tile
+TILE_OVERHEAD = 400
+# DMA_copy.length_1d_copy is an unsigned short
+DMA_MAX_LENGTH = 65535
+
+L1_BUDGET_DEFAULT = 120000
+
+# L3 -> L2 bytes per cluster cycle: an 8-bit DDR HyperRAM at 200 MHz against a
+# 370 MHz cluster; the FC reads flash at about half of that
+L3_BYTES_PER_CYCLE = 1
+# Cluster -> FC request, FC driver and the wait of core 0 per L3 transfer
+L3_REQUEST_OVERHEAD = 1000
+
+L2_BUDGET_DEFAULT = 700000
+
+
+def align4(x):
+    return (x + 3) & ~3
+
+
+def ceil_div(a, b):
+    return (a + b - 1) // b
+
+
+def n_buffers(n, tile):
+    # Single-tile layers are not double buffered (TILED_BUFFERS)
+    return 2 if ceil_div(n, tile) > 1 else 1
+
+
+def core_cycles(work, blocks):
+    # The kernels split blocks evenly over the cores, the slowest core sets the
+    # layer latency
+    return work / blocks * ceil_div(blocks, NUM_CORES)
+
+
+class Layer():
+    # One tiled layer: tile candidates, L1 footprint, DMA transfers and cost.
+    def __init__(self, name, macro, n, footprint, transfers, compute, load, store, valid=None):
+        self.name = name
+        self.macro = macro
+        self.n = n
+        self.footprint = footprint
+        self.transfers = transfers
+        self.compute = compute
+        self.load = load
+        self.store = store
+        self.valid = valid
+
+    def cost(self, tile):
+        # First load and last store are exposed, every other transfer overlaps
+        # with the compute of the neighbouring tile
+        tiles = ceil_div(self.n, tile)
+        sizes = [min(tile, self.n - t * tile) for t in range(tiles)]
+        cycles = self.load(sizes[0]) / DMA_BYTES_PER_CYCLE + self.store(sizes[-1]) / DMA_BYTES_PER_CYCLE
+        for t, size in enumerate(sizes):
+            dma = 0
+            if t + 1 < tiles:
+                dma += self.load(sizes[t + 1]) / DMA_BYTES_PER_CYCLE
+            if t > 0:
+                dma += self.store(sizes[t - 1]) / DMA_BYTES_PER_CYCLE
+            cycles += max(self.compute(size), dma) + TILE_OVERHEAD
+        return int(cycles)
+
+    def solve(self, l1_budget):
+        best = None
+        for tile in range(1, self.n + 1):
+            if self.footprint(tile) > l1_budget:
+                continue
+            if max(self.transfers(tile)) > DMA_MAX_LENGTH:
+                continue
+            if self.valid is not None and not self.valid(tile):
+                continue
+            cost = self.cost(tile)
+            # Ties go to the larger tile
+            if best is None or cost <= best[1]:
+                best = (tile, cost)
+        return best
+
+
+def mhsa_layers(S, E, P, H):
+    HP = H * P
+    layers = []
+
+    # linearQK_4x2_H: X resident, W/B/Out tiled over heads
+    layers.append(Layer('linearQK_4x2_H', 'TILING_QK_HEADS', H,
+        lambda th: align4(S * E) + n_buffers(H, th) * (align4(th * P * E) + align4(2 * th * P) + align4(th * S * P)),
+        lambda th: [S * E, th * P * E, 2 * th * P, th * S * P],
+        lambda nh: core_cycles(nh * S * P * E / MACS_PER_CYCLE, nh * ceil_div(S, 2)),
+        lambda nh: nh * P * E + 2 * nh * P,
+        lambda nh: nh * S * P))
+
+    # matmulSoftmax_FWA_v3_H: X resident, W/B/Out (+ intermediate) tiled over heads
+    layers.append(Layer('matmulSoftmax_FWA_v3_H', 'TILING_FWA_HEADS', H,
+        lambda th: align4(S * E) + n_buffers(H, th) * (align4(th * E * E) + align4(2 * th * E) + align4(th * S * (S + E))),
+        lambda th: [S * E, th * E * E, 2 * th * E, th * S * S],
+        lambda nh: core_cycles(nh * (S * E * E + S * S * E) / MACS_PER_CYCLE + nh * S * S * SOFTMAX_CYCLES, nh * ceil_div(S, 2)),
+        lambda nh: nh * E * E + 2 * nh * E,
+        lambda nh: nh * S * S))
+
+    # matmul_4x2_S: A (2D columns), V and Out (2D columns) tiled over heads
+    layers.append(Layer('matmul_4x2_S', 'TILING_MATMUL_HEADS', H,
+        lambda th: n_buffers(H, th) * (align4(S * th * S) + align4(th * P * S) + align4(S * th * P)),
+        lambda th: [th * S, th * P * S, th * P],
+        lambda nh: core_cycles(nh * S * S * P / MACS_PER_CYCLE, ceil_div(S, 2)),
+        lambda nh: S * nh * S + nh * P * S,
+        lambda nh: S * nh * P))
+
+    # linearO_4x2_H: W/B resident, In/Out tiled over the sequence. The kernel
+    # splits row pairs evenly over the cores, so partial tiles must be
+    # multiples of 2*NUM_CORES rows.
+    rows = 2 * NUM_CORES
+    layers.append(Layer('linearO_4x2_H', 'TILING_O_SEQ', S,
+        lambda ts: align4(E * HP) + align4(2 * E) + n_buffers(S, ts) * (align4(ts * HP) + align4(ts * E)),
+        lambda ts: [E * HP, 2 * E, ts * HP, ts * E],
+        lambda ns: core_cycles(ns * E * HP / MACS_PER_CYCLE, ceil_div(ns, 2)),
+        lambda ns: ns * HP,
+        lambda ns: ns * E,
+        lambda ts: ts >= S or (ts % rows == 0 and (S % ts) % rows == 0)))
+
+    return layers
+
+
+def solve_mhsa_tiling(S, E, P, H, l1_budget=L1_BUDGET_DEFAULT):
+    # Returns {macro: (layer, tile, tiles, L1 bytes, estimated cycles)}
+    tiling = {}
+    for layer in mhsa_layers(S, E, P, H):
+        best = layer.solve(l1_budget)
+        if best is None:
+            raise ValueError("%s: no tiling of S=%d E=%d P=%d H=%d fits %d bytes of L1" % (layer.name, S, E, P, H, l1_budget))
+        tile, cost = best
+        tiling[layer.macro] = (layer.name, tile, ceil_div(layer.n, tile), layer.footprint(tile), cost)
+    return tiling
+
+
+def mhsa_weights(E, P, H):
+    # {name: (offset, bytes)} of the weights of one layer as they are laid out
+    # in L3, in the order the kernels use them
+    sizes = [('Wqk', H * P * E), ('Bqk', 2 * H * P), ('Wfwa', H * E * E), ('Bfwa', 2 * H * E),
+             ('Wo', E * H * P), ('Bo', 2 * E)]
+    weights, offset = {}, 0
+    for name, size in sizes:
+        weights[name] = (offset, size)
+        offset += align4(size)
+    return weights
+
+
+def mhsa_l2_activations(S, E, P, H):
+    # L2 bytes of the activations of MHSALayersL3: X, V, A, the context and the
+    # output, the two slots come on top
+    return sum(align4(size) for size in (S * E, H * S * P, H * S * S, S * H * P, S * E))
+
+
+def l3_cycles(size, l3_bytes_per_cycle):
+    return L3_REQUEST_OVERHEAD + size / l3_bytes_per_cycle
+
+
+def solve_l3_schedule(S, E, P, H, layers, tiling, l2_resident, l2_budget=L2_BUDGET_DEFAULT,
+                      l3_bytes_per_cycle=L3_BYTES_PER_CYCLE):
+    # Prefetch of the layers' weights from L3 for the L1 tiling of
+    # solve_mhsa_tiling(), with l2_resident bytes of activations in L2. Unit i+1
+    # is loaded while unit i is computed, so the first load is exposed and every
+    # unit after it costs max(compute, load of the next unit). A unit is either
+    # the weights of a layer, or of one kernel (matmul_4x2_S has none and runs
+    # in the unit of matmulSoftmax_FWA_v3_H): the smaller slots of the latter fit
+    # a smaller L2 and hide loads behind shorter kernels, the former pays the
+    # request overhead once per layer. Returns {per_layer, units, slot, l2,
+    # cycles, exposed}, the cheapest schedule whose two slots fit the L2 budget.
+    w = mhsa_weights(E, P, H)
+    unit_bytes = lambda first, last: w[last][0] + align4(w[last][1]) - w[first][0]
+    qk, fwa, mm, o = (tiling[m][4] for m in ('TILING_QK_HEADS', 'TILING_FWA_HEADS', 'TILING_MATMUL_HEADS', 'TILING_O_SEQ'))
+    schedules = {
+        True: [(unit_bytes('Wqk', 'Bo'), qk + fwa + mm + o)],
+        False: [(unit_bytes('Wqk', 'Bqk'), qk), (unit_bytes('Wfwa', 'Bfwa'), fwa + mm), (unit_bytes('Wo', 'Bo'), o)],
+    }
+
+    best = None
+    for per_layer, layer_units in schedules.items():
+        units = layer_units * layers
+        slot = max(size for size, _ in units)
+        l2 = l2_resident + 2 * slot
+        if l2 > l2_budget:
+            continue
+        cycles = l3_cycles(units[0][0], l3_bytes_per_cycle)
+        for u, (_, compute) in enumerate(units):
+            load = l3_cycles(units[u + 1][0], l3_bytes_per_cycle) if u + 1 < len(units) else 0
+            cycles += max(compute, load)
+        exposed = cycles - sum(compute for _, compute in units)
+        # Ties go to the fewer, larger transfers
+        if best is None or cycles < best['cycles']:
+            best = {'per_layer': per_layer, 'units': len(units), 'slot': slot, 'l2': l2,
+                    'cycles': int(cycles), 'exposed': int(exposed)}
+    if best is None:
+        raise ValueError("no L3 prefetch of S=%d E=%d P=%d H=%d fits %d bytes of L2" % (S, E, P, H, l2_budget))
+    return best
+
+
+def write_tiling_header(tiling, S, E, P, H, l1_budget, header, l3=None, layers=0):
+    l1_size = max(entry[3] for entry in tiling.values())
+    with open(header, 'w') as f:
+        f.write("// Generated by tilingSolver.py for S=%d E=%d P=%d H=%d, L1 budget %d bytes\n\n" % (S, E, P, H, l1_budget))
+        f.write("#pragma once\n\n")
+        for macro, (name, tile, tiles, footprint, cost) in tiling.items():
+            f.write("// %s: %d tiles, %d bytes of L1, ~%d cycles\n" % (name, tiles, footprint, cost))
+            f.write("#define %s %d\n" % (macro, tile))
+        f.write("\n// L1 buffer shared by the tiled layers\n")
+        f.write("#define TILING_L1_SIZE %d\n" % l1_size)
+        if l3 is not None:
+            unit = "layer" if l3['per_layer'] else "kernel"
+            f.write("\n// L3 -> L2 weight prefetch of %d layers: one transfer per %s, %d transfers,\n" % (layers, unit, l3['units']))
+            f.write("// %d bytes of L2, ~%d cycles of which ~%d not hidden by compute\n" % (l3['l2'], l3['cycles'], l3['exposed']))
+            f.write("#define TILING_L3_LAYERS %d\n" % layers)
+            f.write("#define TILING_L3_PER_LAYER %d\n" % int(l3['per_layer']))
+            f.write("#define TILING_L2_SLOT_SIZE %d\n" % l3['slot'])
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Pick the L1 tile sizes of the tiled MHSA layers.')
+    parser.add_argument('--MHSA_params', nargs=4, type=int, required=True, help='MHSA parameters (S E P H).')
+    parser.add_argument('--l1_budget', type=int, default=L1_BUDGET_DEFAULT, help='L1 bytes available to the tiled layers.')
+    parser.add_argument('--layers', type=int, default=0, help='Also prefetch the weights of this many layers from L3.')
+    parser.add_argument('--l2_budget', type=int, default=L2_BUDGET_DEFAULT, help='L2 bytes for the activations and the weight slots.')
+    parser.add_argument('--l3_bytes_per_cycle', type=float, default=L3_BYTES_PER_CYCLE, help='L3 -> L2 bandwidth in bytes per cluster cycle.')
+    parser.add_argument('--out', type=str, default='mhsa_tiling.h', help='Path to the generated header.')
+
+    args = parser.parse_args()
+    S, E, P, H = args.MHSA_params
+    tiling = solve_mhsa_tiling(S, E, P, H, args.l1_budget)
+    for macro, (name, tile, tiles, footprint, cost) in tiling.items():
+        print("  %s tiling:" % name)
+        print("    %s = %d (%d tiles, %d bytes of L1, ~%d cycles)" % (macro, tile, tiles, footprint, cost))
+    l3 = None
+    if args.layers > 0:
+        l3 = solve_l3_schedule(S, E, P, H, args.layers, tiling, mhsa_l2_activations(S, E, P, H),
+                               args.l2_budget, args.l3_bytes_per_cycle)
+        print("  L3 prefetch of %d layers:" % args.layers)
+        print("    TILING_L3_PER_LAYER = %d (%d transfers, %d bytes of L2, ~%d cycles, ~%d exposed)" %
+              (int(l3['per_layer']), l3['units'], l3['l2'], l3['cycles'], l3['exposed']))
+    write_tiling_header(tiling, S, E, P, H, args.l1_budget, args.out, l3, args.layers)
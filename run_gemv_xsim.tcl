@@ -1,4 +1,18 @@
 # Vivado 2025.2 xsim script for GEMV core testbench.
+#
+# Optional settings (set before sourcing):
+#   gemv_pipeline 1   gemv_core PIPELINE=1 (registered datapath) in the testbench and synthesis
+#   gemv_lanes    n   LANES of gemv_core (default 1)
+#   gemv_timing   1   also synthesize gemv_core out of context and write
+#                     gemv_timing_p<pipeline>_l<lanes>.rpt / gemv_util_p<pipeline>_l<lanes>.rpt
+#   gemv_part         device for gemv_timing (default the Arty A7-35T, xc7a35ticsg324-1L)
+#   gemv_clk_ns       clock period constraint for gemv_timing (default 10.0)
+
+if {![info exists gemv_pipeline]} { set gemv_pipeline 0 }
+if {![info exists gemv_lanes]}    { set gemv_lanes 1 }
+if {![info exists gemv_timing]}   { set gemv_timing 0 }
+if {![info exists gemv_part]}     { set gemv_part xc7a35ticsg324-1L }
+if {![info exists gemv_clk_ns]}   { set gemv_clk_ns 10.0 }
 
 # Compile DUT (gemv_core) first
 xvlog -sv hw_extensions/gemv/rtl/gemv_core.v
@@ -7,7 +21,7 @@ xvlog -sv hw_extensions/gemv/rtl/gemv_core.v
 xvlog -sv hw_extensions/sim/tb_gemv.sv
 
 # Elaborate
-xelab tb_gemv -s tb_gemv_sim
+xelab tb_gemv -generic_top "LANES=$gemv_lanes" -generic_top "PIPELINE=$gemv_pipeline" -s tb_gemv_sim
 
 # Create batch Tcl for xsim run and VCD dumping
 set fp [open xsim_gemv_do.tcl "w"]
@@ -20,3 +34,17 @@ close $fp
 
 # Run simulation with batch script
 xsim tb_gemv_sim -tclbatch xsim_gemv_do.tcl
+
+# Timing: out-of-context synthesis, worst slack against gemv_clk_ns and the
+# DSP / BRAM use (PIPELINE=1 should map the lane products to DSP48 and W to BRAM)
+if {$gemv_timing} {
+    set tag "p${gemv_pipeline}_l${gemv_lanes}"
+    read_verilog hw_extensions/gemv/rtl/gemv_core.v
+    synth_design -top gemv_core -part $gemv_part -mode out_of_context \
+        -generic LANES=$gemv_lanes -generic PIPELINE=$gemv_pipeline
+    create_clock -name clk -period $gemv_clk_ns [get_ports clk]
+    report_timing_summary -max_paths 10 -file gemv_timing_${tag}.rpt
+    report_utilization -file gemv_util_${tag}.rpt
+    puts "gemv_core $tag: WNS [get_property SLACK [get_timing_paths -max_paths 1 -nworst 1 -setup]] ns at $gemv_clk_ns ns"
+    close_design
+}
@@ -0,0 +1,22 @@
+# Vivado 2025.2 xsim script for perfmon testbench.
+
+# Compile DUT (perfmon_core) first
+xvlog -sv hw_extensions/perfmon/rtl/perfmon_core.v
+
+# Compile testbench
+xvlog -sv hw_extensions/sim/tb_perfmon.sv
+
+# Elaborate
+xelab tb_perfmon -s tb_perfmon_sim
+
+# Create batch Tcl for xsim run and VCD dumping
+set fp [open xsim_perfmon_do.tcl "w"]
+puts $fp "open_vcd tb_perfmon.vcd"
+puts $fp "log_vcd [get_objects -r tb_perfmon/*]"
+puts $fp "run all"
+puts $fp "close_vcd"
+puts $fp "quit"
+close $fp
+
+# Run simulation with batch script
+xsim tb_perfmon_sim -tclbatch xsim_perfmon_do.tcl
@@ -0,0 +1,22 @@
+# Vivado 2025.2 xsim script for softmax testbench.
+
+# Compile DUT (softmax_core) first
+xvlog -sv hw_extensions/softmax/rtl/softmax_core.v
+
+# Compile testbench
+xvlog -sv hw_extensions/sim/tb_softmax.sv
+
+# Elaborate
+xelab tb_softmax -s tb_softmax_sim
+
+# Create batch Tcl for xsim run and VCD dumping
+set fp [open xsim_softmax_do.tcl "w"]
+puts $fp "open_vcd tb_softmax.vcd"
+puts $fp "log_vcd [get_objects -r tb_softmax/*]"
+puts $fp "run all"
+puts $fp "close_vcd"
+puts $fp "quit"
+close $fp
+
+# Run simulation with batch script
+xsim tb_softmax_sim -tclbatch xsim_softmax_do.tcl
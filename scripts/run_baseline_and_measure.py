@@ -4,9 +4,23 @@ Enhanced FPGA Baseline Measurement Script with Comprehensive UART Debugging
 
 This script runs the baseline TinyML algorithm on an FPGA via UART and measures
 execution time. It includes extensive debugging features to diagnose communication issues.
+
+With --bench it is a benchmark driver instead: for each Makefile TARGET it builds
+the firmware with PROFILE=1, flashes it (--flash_cmd), captures one demo_run()
+and parses ENC_CKSUM, the predictions and the per-stage "PROF" cycle lines. The
+correctness gate (every target matches the baseline checksums and predictions)
+is enforced, a per-stage speedup table is written as CSV and JSON, and the run is
+appended to a history file. A stage that got slower than the previous history
+entry by more than --regress_pct fails the run.
 """
-import serial
-import serial.tools.list_ports
+try:
+    import serial
+    import serial.tools.list_ports
+except ImportError:  # only needed on the board; --bench --from_logs runs without it
+    serial = None
+import json
+import re
+import subprocess
 import time
 import sys
 import csv
@@ -14,6 +28,23 @@ import argparse
 from pathlib import Path
 
 
+BENCH_TARGETS = ["baseline", "accel_dot8", "accel_lut", "accel_gemv",
+                 "accel_dot8_lut", "accel_all"]
+PROF_STAGES = ["qkv", "attn", "oproj", "ffn", "head", "total"]
+
+# Exit codes of --bench
+EXIT_GATE_FAIL = 2
+EXIT_REGRESSION = 3
+
+RE_CKSUM = re.compile(r"ENC_CKSUM=0x([0-9A-Fa-f]{8})")
+RE_SAMPLE = re.compile(r"Sample (\d+): pred=(\d+) exp=(\d+)")
+RE_PROF = re.compile(r"PROF (\w+) cycles=(\d+) instret=(\d+)")
+RE_PROF_SAMPLES = re.compile(r"PROF samples=(\d+)")
+RE_PERF = re.compile(r"PERF (\w+) (.*)")
+RE_PERF_EVENT = re.compile(r"(\w+)=(\d+)")
+RE_CYCLES = re.compile(r"^CYCLES=(\d+)")
+
+
 def find_serial_port():
     """Auto-detect USB-UART devices"""
     ports = list(serial.tools.list_ports.comports())
@@ -94,6 +125,284 @@ def capture_boot_messages(ser, timeout_s=2.0, debug_log=None, verbose=False):
     return lines
 
 
+def open_serial(port, args):
+    """Open the UART with the command-line settings."""
+    return serial.Serial(
+        port=port,
+        baudrate=args.baud,
+        bytesize=args.bytesize,
+        parity=args.parity,
+        stopbits=args.stopbits,
+        timeout=args.timeout_s,
+        xonxoff=args.xonxoff,
+        rtscts=args.rtscts,
+        dsrdtr=args.dsrdtr,
+        inter_byte_timeout=0.1  # Better readline() behavior
+    )
+
+
+# ---- Benchmark driver (--bench) ----
+
+def parse_demo_output(lines):
+    """
+    Parse one demo_run() capture: ENC_CKSUM per sample, predictions, the
+    TINYFORMER_PROFILE table, the perfmon event counts per stage (PERFMON=1
+    firmware) and the baseline's CYCLES= total (if printed).
+    """
+    res = {"cksums": [], "preds": [], "labels": [], "samples": None,
+           "cycles": {}, "instret": {}, "perf": {}, "demo_cycles": None}
+    for line in lines:
+        m = RE_CKSUM.search(line)
+        if m:
+            res["cksums"].append(m.group(1).upper())
+        m = RE_SAMPLE.search(line)
+        if m:
+            res["preds"].append(int(m.group(2)))
+            res["labels"].append(int(m.group(3)))
+        m = RE_PROF_SAMPLES.search(line)
+        if m:
+            res["samples"] = int(m.group(1))
+        m = RE_PROF.search(line)
+        if m:
+            res["cycles"][m.group(1)] = int(m.group(2))
+            res["instret"][m.group(1)] = int(m.group(3))
+        m = RE_PERF.search(line)
+        if m:
+            res["perf"][m.group(1)] = {k: int(v) for k, v in RE_PERF_EVENT.findall(m.group(2))}
+        m = RE_CYCLES.search(line)
+        if m:
+            res["demo_cycles"] = int(m.group(1))
+    return res
+
+
+def check_gate(target, res, golden):
+    """Correctness gate against the baseline capture. Returns error strings."""
+    errors = []
+    if not res["cksums"]:
+        errors.append(f"{target}: no ENC_CKSUM lines")
+    if res["cksums"] != golden["cksums"]:
+        errors.append(f"{target}: ENC_CKSUM {res['cksums']} != baseline {golden['cksums']}")
+    if res["preds"] != golden["preds"]:
+        errors.append(f"{target}: pred {res['preds']} != baseline {golden['preds']}")
+    if "total" not in res["cycles"]:
+        errors.append(f"{target}: no PROF lines (firmware not built with PROFILE=1?)")
+    return errors
+
+
+def build_target(litex_dir, target, make_args):
+    """make clean + make TARGET=<target> PROFILE=1; returns firmware.elf."""
+    subprocess.run(["make", "-C", str(litex_dir), "clean"], check=True)
+    subprocess.run(["make", "-C", str(litex_dir), f"TARGET={target}", "PROFILE=1"] + make_args,
+                   check=True)
+    return litex_dir / "firmware.elf"
+
+
+def flash_target(flash_cmd, target, elf, port):
+    """
+    Load the firmware: run flash_cmd ({target}, {elf}, {bin}, {port} are
+    substituted), or ask the user to do it when no command is given.
+    """
+    if flash_cmd:
+        cmd = flash_cmd.format(target=target, elf=elf, bin=elf.with_suffix(".bin"), port=port)
+        print(f"  flash: {cmd}")
+        subprocess.run(cmd, shell=True, check=True)
+    else:
+        input(f"  Load {elf} ({target}) and reset the board, then press Enter > ")
+
+
+def capture_demo(ser, timeout_s, idle_s, debug_log=None, verbose=False):
+    """
+    Read one demo_run() from the UART. Answers "Ready" with 's' (baseline
+    main), stops once the PROF total line was seen and the line is idle for
+    idle_s, or after timeout_s.
+    """
+    lines = []
+    seen_total = False
+    ser.timeout = idle_s
+    end_time = time.time() + timeout_s
+    while time.time() < end_time:
+        raw = ser.readline()
+        if not raw:
+            if seen_total:
+                break
+            continue
+        line = raw.decode("utf-8", errors="replace").strip()
+        if not line:
+            continue
+        lines.append(line)
+        if verbose:
+            print(f"  RX: {line}")
+        if debug_log:
+            debug_log.write(f"{line}\n")
+            debug_log.flush()
+        if line == "Ready" and not seen_total:
+            ser.write(b"s")
+        if line.startswith("PROF total"):
+            seen_total = True
+    return lines
+
+
+def git_revision(repo_root):
+    try:
+        out = subprocess.run(["git", "-C", str(repo_root), "rev-parse", "--short", "HEAD"],
+                             capture_output=True, text=True, check=True)
+        return out.stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def load_history(path):
+    """History file: one JSON object per line, oldest first."""
+    if not path.exists():
+        return []
+    with open(path, encoding="utf-8") as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+def find_regressions(results, history, pct):
+    """Stages slower than the latest history entry of the same target by more than pct %."""
+    regressions = []
+    for target, res in results.items():
+        prev = next((h["targets"][target] for h in reversed(history)
+                     if target in h.get("targets", {})), None)
+        if prev is None:
+            continue
+        for stage in PROF_STAGES:
+            old = prev["cycles"].get(stage)
+            new = res["cycles"].get(stage)
+            if old and new is not None and new > old * (1.0 + pct / 100.0):
+                regressions.append(f"{target} {stage}: {old} -> {new} cycles "
+                                   f"(+{100.0 * (new - old) / old:.1f}%)")
+    return regressions
+
+
+def speedup_rows(results):
+    """One row per target and stage: cycles, instret, speedup vs baseline."""
+    base = results.get("baseline")
+    rows = []
+    for target, res in results.items():
+        for stage in PROF_STAGES:
+            cyc = res["cycles"].get(stage)
+            if cyc is None:
+                continue
+            ref = base["cycles"].get(stage) if base else None
+            speedup = (ref / cyc) if ref and cyc else None
+            rows.append({"target": target, "stage": stage, "cycles": cyc,
+                         "instret": res["instret"].get(stage),
+                         "speedup": round(speedup, 3) if speedup else None})
+    return rows
+
+
+def write_bench_tables(rows, out_prefix):
+    csv_path = Path(f"{out_prefix}.csv")
+    json_path = Path(f"{out_prefix}.json")
+    with open(csv_path, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["target", "stage", "cycles", "instret", "speedup"])
+        writer.writeheader()
+        writer.writerows(rows)
+    with open(json_path, "w", encoding="utf-8") as f:
+        json.dump(rows, f, indent=2)
+    return csv_path, json_path
+
+
+def print_speedup_table(rows, targets):
+    by = {(r["target"], r["stage"]): r for r in rows}
+    print("\n" + "=" * 60)
+    print("PER-STAGE CYCLES (speedup vs baseline)")
+    print("=" * 60)
+    print(f"{'target':<16}" + "".join(f"{st:>14}" for st in PROF_STAGES))
+    for target in targets:
+        cells = []
+        for st in PROF_STAGES:
+            r = by.get((target, st))
+            if r is None:
+                cells.append(f"{'-':>14}")
+            elif r["speedup"] is None:
+                cells.append(f"{r['cycles']:>14}")
+            else:
+                cells.append(f"{r['cycles']:>8} {r['speedup']:>4.2f}x")
+        print(f"{target:<16}" + "".join(cells))
+
+
+def bench_main(args, port):
+    """--bench: build, flash and profile every target; gate, tabulate, track history."""
+    repo_root = Path(__file__).resolve().parents[1]
+    litex_dir = repo_root / "litex_port"
+    targets = args.targets.split(",")
+    history_path = Path(args.history)
+    history = load_history(history_path)
+    results = {}
+
+    debug_log = None
+    if args.debug_log and not args.from_logs:
+        debug_log = open(args.debug_log, "w", encoding="utf-8")
+    for target in targets:
+        print(f"\n--- {target} ---")
+        if args.from_logs:
+            log = Path(args.from_logs) / f"{target}.log"
+            lines = log.read_text(encoding="utf-8", errors="replace").splitlines()
+        else:
+            elf = litex_dir / "firmware.elf"
+            if not args.no_build:
+                elf = build_target(litex_dir, target, args.make_args.split())
+            # Port opened before flashing so the boot-time demo_run() of the
+            # accel mains is captured; flash_cmd must not use this UART.
+            ser = open_serial(port, args)
+            ser.reset_input_buffer()
+            if debug_log:
+                debug_log.write(f"\n=== {target} ===\n")
+            flash_target(args.flash_cmd, target, elf, port)
+            lines = capture_demo(ser, args.timeout_s, args.idle_s, debug_log, args.verbose)
+            ser.close()
+        results[target] = parse_demo_output(lines)
+        res = results[target]
+        print(f"  {len(res['cksums'])} samples, total {res['cycles'].get('total', '?')} cycles")
+    if debug_log:
+        debug_log.close()
+
+    # Correctness gate: the baseline of this run, else the last recorded one.
+    golden = results.get("baseline")
+    if golden is None:
+        golden = next((h["golden"] for h in reversed(history) if "golden" in h), None)
+    if golden is None:
+        print("\n❌ CORRECTNESS GATE: no baseline capture (add baseline to --targets)")
+        sys.exit(EXIT_GATE_FAIL)
+    errors = []
+    for target, res in results.items():
+        errors += check_gate(target, res, golden)
+    if errors:
+        print("\n❌ CORRECTNESS GATE FAILED")
+        for e in errors:
+            print(f"  {e}")
+        sys.exit(EXIT_GATE_FAIL)
+    print("\n✓ Correctness gate: all targets match the baseline ENC_CKSUM and predictions")
+
+    rows = speedup_rows(results)
+    print_speedup_table(rows, targets)
+    csv_path, json_path = write_bench_tables(rows, args.bench_out)
+    print(f"\n✓ Speedup table: {csv_path}, {json_path}")
+
+    regressions = find_regressions(results, history, args.regress_pct)
+    if regressions:
+        print(f"\n❌ PERFORMANCE REGRESSION (> {args.regress_pct}% slower than the last history entry)")
+        for r_ in regressions:
+            print(f"  {r_}")
+        print(f"History not updated: {history_path}")
+        sys.exit(EXIT_REGRESSION)
+
+    entry = {
+        "time": time.strftime("%Y-%m-%d %H:%M:%S"),
+        "git": git_revision(repo_root),
+        "golden": {"cksums": golden["cksums"], "preds": golden["preds"]},
+        "targets": {t: {"cycles": r["cycles"], "instret": r["instret"],
+                        "samples": r["samples"], **({"perf": r["perf"]} if r["perf"] else {})}
+                    for t, r in results.items()},
+    }
+    with open(history_path, "a", encoding="utf-8") as f:
+        f.write(json.dumps(entry) + "\n")
+    print(f"✓ History appended: {history_path}")
+
+
 def main():
     parser = argparse.ArgumentParser(
         description='Run baseline on FPGA and measure time with enhanced debugging.',
@@ -108,6 +417,12 @@ Examples:
   
   # Different serial settings
   %(prog)s --port COM3 --baud 9600 --timeout_s 60 --runs 5
+
+  # Benchmark every TARGET (per-stage PROF cycles, gate, speedups, history)
+  %(prog)s --bench --port /dev/ttyUSB1 --flash_cmd "openFPGALoader -b arty {bin}"
+
+  # Re-evaluate captured UART logs (<dir>/<target>.log), no board needed
+  %(prog)s --bench --from_logs logs/
         """
     )
     
@@ -139,9 +454,29 @@ Examples:
     parser.add_argument('--log_hex', action='store_true', help='Log raw bytes as hex in debug log')
     parser.add_argument('--verbose', action='store_true', help='Print all serial output to console')
     parser.add_argument('--show_boot', action='store_true', help='Always show boot messages (default: only if --verbose)')
-    
+
+    # Benchmark driver
+    parser.add_argument('--bench', action='store_true', help='Benchmark all --targets (see module docstring)')
+    parser.add_argument('--targets', default=",".join(BENCH_TARGETS), help='Comma-separated Makefile TARGETs (default: all)')
+    parser.add_argument('--no_build', action='store_true', help='Do not run make; flash the existing firmware')
+    parser.add_argument('--make_args', default='', help='Extra make arguments, e.g. "CC=riscv32-unknown-elf-gcc"')
+    parser.add_argument('--flash_cmd', default=None,
+                        help='Command that loads the firmware ({target} {elf} {bin} {port}); default: prompt')
+    parser.add_argument('--idle_s', type=float, default=1.0, help='Quiet time that ends a capture after "PROF total" (default: 1s)')
+    parser.add_argument('--from_logs', default=None, help='Parse <dir>/<target>.log instead of running the board')
+    parser.add_argument('--bench_out', default='bench_results', help='Speedup table prefix (.csv and .json)')
+    parser.add_argument('--history', default='bench_history.jsonl', help='History file, one JSON line per run')
+    parser.add_argument('--regress_pct', type=float, default=5.0, help='Fail if a stage is this %% slower than history (default: 5)')
+
     args = parser.parse_args()
 
+    if args.bench and args.from_logs:
+        bench_main(args, None)
+        return
+    if serial is None:
+        print("Error: pyserial is not installed (pip install pyserial).")
+        sys.exit(1)
+
     # Auto-detect port if not specified
     port = args.port
     if not port:
@@ -160,19 +495,12 @@ Examples:
     print(f"Flow Control: xonxoff={args.xonxoff}, rtscts={args.rtscts}, dsrdtr={args.dsrdtr}")
     print(f"Timeout: {args.timeout_s}s per run")
     
+    if args.bench:
+        bench_main(args, port)
+        return
+
     try:
-        ser = serial.Serial(
-            port=port,
-            baudrate=args.baud,
-            bytesize=args.bytesize,
-            parity=args.parity,
-            stopbits=args.stopbits,
-            timeout=args.timeout_s,
-            xonxoff=args.xonxoff,
-            rtscts=args.rtscts,
-            dsrdtr=args.dsrdtr,
-            inter_byte_timeout=0.1  # Better readline() behavior
-        )
+        ser = open_serial(port, args)
     except Exception as e:
         print(f"Error opening serial port {port}: {e}")
         print("\nTroubleshooting:")
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+Convert a TinyFormer event trace dump to Chrome / Perfetto trace JSON.
+
+Firmware built with make TRACE=1 (TINYFORMER_TRACE, litex_port/common/tf_trace.h)
+prints its trace rings as text between "TRACE BEGIN" and "TRACE END": one
+"T <hart> <cycle> <event> <arg>" hex line per record. This script takes the
+last such block from a UART capture, from the board's serial port or from a
+command's stdout, and writes JSON for chrome://tracing or ui.perfetto.dev.
+
+Each hart gets one track per source: "stages" (encoder stages, from one MARK /
+STAGE event to the next), "demo" (samples / windows), "gemv" (submit to done),
+"irq" (isr() entry to exit) and "uart" (TX flush waits, with the ISR's drains
+as instant events). Gaps on a track are idle time. The 32-bit cycle counter is
+unwrapped per hart; harts without a common counter are aligned at their first
+record. The summary on stderr gives each track's busy share of the trace.
+
+Usage:
+  python3 scripts/trace_to_chrome.py capture.log --out trace.json
+  python3 scripts/trace_to_chrome.py --port /dev/ttyUSB1 --out trace.json
+  python3 scripts/trace_to_chrome.py --exec "litex_port/host/tinyformer_trace_host demo" --cpu-mhz 0
+"""
+import argparse
+import json
+import shlex
+import subprocess
+import sys
+
+# TF_EV_* of tf_trace.h
+EV_MARK, EV_STAGE, EV_GEMV_SUBMIT, EV_GEMV_DONE = 1, 2, 3, 4
+EV_IRQ_ENTER, EV_IRQ_EXIT, EV_UART_DRAIN, EV_UART_FLUSH, EV_UART_FLUSHED = 5, 6, 7, 8, 9
+EV_SAMPLE, EV_SAMPLE_END = 10, 11
+
+STAGES = ["qkv", "attn", "oproj", "ffn", "head"]  # TINYFORMER_PROF_*
+TRACKS = ["stages", "demo", "gemv", "irq", "uart"]
+DONE_SRC = {0: "wait", 1: "isr", 2: "poll"}
+
+
+def read_lines(args):
+    """Lines of the capture, stopping after the first TRACE END when live."""
+    if args.port:
+        import serial
+
+        ser = serial.Serial(args.port, args.baud, timeout=args.timeout)
+        if args.start:
+            ser.write(args.start.encode())
+        while True:
+            raw = ser.readline()
+            if not raw:
+                raise SystemExit(f"no TRACE END within {args.timeout} s")
+            line = raw.decode(errors="replace").strip()
+            yield line
+            if line == "TRACE END":
+                ser.close()
+                return
+    if args.exec_cmd:
+        proc = subprocess.Popen(shlex.split(args.exec_cmd), stdin=subprocess.DEVNULL,
+                                stdout=subprocess.PIPE, text=True, errors="replace")
+        for line in proc.stdout:
+            yield line.strip()
+        proc.wait()
+        return
+    src = sys.stdin if args.log in (None, "-") else open(args.log, errors="replace")
+    for line in src:
+        yield line.strip()
+
+
+def parse_dump(lines):
+    """Records of the last complete dump: {hart: [(cycle, ev, arg), ...]}, lost counts."""
+    blocks, cur, lost = [], None, {}
+    for line in lines:
+        if line.startswith("TRACE BEGIN"):
+            cur, lost = {}, {}
+        elif cur is None:
+            continue
+        elif line == "TRACE END":
+            blocks.append((cur, lost))
+            cur = None
+        elif line.startswith("TRACE hart="):
+            kv = dict(f.split("=", 1) for f in line.split()[1:])
+            lost[int(kv["hart"])] = int(kv["lost"])
+        elif line.startswith("T "):
+            f = line.split()
+            if len(f) == 5:
+                cur.setdefault(int(f[1]), []).append((int(f[2], 16), int(f[3], 16), int(f[4], 16)))
+    if not blocks:
+        raise SystemExit("no complete TRACE BEGIN ... TRACE END block in the input")
+    return blocks[-1]
+
+
+def unwrap(recs):
+    out, t, prev = [], 0, None
+    for cycle, ev, arg in recs:
+        if prev is not None:
+            t += (cycle - prev) & 0xFFFFFFFF
+        prev = cycle
+        out.append((t, ev, arg))
+    return out
+
+
+def convert(rings, cycles_per_us):
+    """Chrome trace events and per-(hart, track) busy cycles."""
+    events, busy, spans, end = [], {}, {}, 0
+
+    def ts(c):
+        return c / cycles_per_us
+
+    def span(hart, track, name, t0, t1, args=None):
+        tid = hart * len(TRACKS) + TRACKS.index(track)
+        e = {"name": name, "ph": "X", "pid": 0, "tid": tid, "ts": ts(t0), "dur": ts(t1 - t0)}
+        if args:
+            e["args"] = args
+        events.append(e)
+        busy[(hart, track)] = busy.get((hart, track), 0) + (t1 - t0)
+        spans[(hart, track)] = spans.get((hart, track), 0) + 1
+
+    for hart, recs in sorted(rings.items()):
+        for i, track in enumerate(TRACKS):
+            events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": hart * len(TRACKS) + i,
+                           "args": {"name": f"hart{hart} {track}"}})
+        mark = sample = gemv = irq = flush = None
+        for t, ev, arg in unwrap(recs):
+            end = max(end, t)
+            if ev == EV_MARK:
+                mark = t
+            elif ev == EV_STAGE:
+                if mark is not None:
+                    name = STAGES[arg] if arg < len(STAGES) else f"stage{arg}"
+                    span(hart, "stages", name, mark, t)
+                mark = t
+            elif ev == EV_SAMPLE:
+                sample = (t, arg)
+            elif ev == EV_SAMPLE_END and sample is not None:
+                span(hart, "demo", f"sample {sample[1]}", sample[0], t)
+                sample = None
+            elif ev == EV_GEMV_SUBMIT:
+                gemv = (t, arg)
+            elif ev == EV_GEMV_DONE and gemv is not None:
+                span(hart, "gemv", "gemv", gemv[0], t, {"out_dim": gemv[1], "seen": DONE_SRC.get(arg, arg)})
+                gemv = None
+            elif ev == EV_IRQ_ENTER:
+                irq = (t, arg)
+            elif ev == EV_IRQ_EXIT and irq is not None:
+                span(hart, "irq", "isr", irq[0], t, {"lines": f"0x{irq[1]:X}"})
+                irq = None
+            elif ev == EV_UART_FLUSH:
+                flush = t
+            elif ev == EV_UART_FLUSHED and flush is not None:
+                span(hart, "uart", "tx flush", flush, t)
+                flush = None
+            elif ev == EV_UART_DRAIN:
+                events.append({"name": "tx drain", "ph": "i", "s": "t", "pid": 0,
+                               "tid": hart * len(TRACKS) + TRACKS.index("uart"), "ts": ts(t),
+                               "args": {"bytes": arg}})
+    return events, busy, spans, end
+
+
+def main():
+    parser = argparse.ArgumentParser(description="TinyFormer trace dump to Chrome / Perfetto JSON.")
+    parser.add_argument("log", nargs="?", help="UART capture with a TRACE block ('-' or none: stdin)")
+    parser.add_argument("--port", help="Read the dump live from the board's serial port")
+    parser.add_argument("--exec", dest="exec_cmd", help="Read the dump from a command's stdout")
+    parser.add_argument("--baud", type=int, default=115200, help="Baud rate (default: 115200)")
+    parser.add_argument("--start", default="", help="Bytes sent first on --port (e.g. 's')")
+    parser.add_argument("--timeout", type=float, default=30.0, help="--port read timeout in seconds")
+    parser.add_argument("--cpu-mhz", type=float, default=100.0,
+                        help="CPU clock for the time axis (default: 100; 0: 1 cycle = 1 us)")
+    parser.add_argument("--out", help="JSON output (default: stdout)")
+    args = parser.parse_args()
+
+    rings, lost = parse_dump(read_lines(args))
+    cycles_per_us = args.cpu_mhz if args.cpu_mhz > 0 else 1.0
+    events, busy, spans, end = convert(rings, cycles_per_us)
+    doc = {"traceEvents": events, "displayTimeUnit": "ns",
+           "otherData": {"source": "tinyformer tf_trace", "cpu_mhz": args.cpu_mhz}}
+    out = open(args.out, "w") if args.out else sys.stdout
+    json.dump(doc, out)
+    if out is not sys.stdout:
+        out.close()
+
+    n = sum(len(r) for r in rings.values())
+    print(f"TRACE harts={len(rings)} records={n} lost={sum(lost.values())} cycles={end}", file=sys.stderr)
+    for (hart, track), c in sorted(busy.items()):
+        pct = 100.0 * c / end if end else 0.0
+        print(f"TRACE hart={hart} track={track} spans={spans[(hart, track)]} busy_cycles={c} busy_pct={pct:.1f}",
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+Host driver of the framed binary UART protocol (litex_port/common/uart_frame.h).
+
+Pushes int8 windows to the board's demo_proto_run() server (firmware built with
+make PROTO=1) and collects the predictions, ENC_CKSUM, cycles and logits. Every
+frame is COBS(type, seq, body, CRC-16/CCITT-FALSE) followed by 0x00, so text
+printed before the server starts (banner, TF_SRAM line) is skipped as a bad
+frame.
+
+windows.bin is raw int8 [n][S][D] as for host/tinyformer_replay (e.g.
+tinyformer_replay -g windows.bin). The CSV has the replay columns
+window,pred,enc_cksum, so the two outputs can be compared with cmp; --logits adds
+cycles and the logits.
+
+Requests are sent stop-and-wait: the board's UART RX FIFO is only polled
+between windows. A window whose reply is lost or answered with UF_T_ERROR is
+sent again up to --retries times.
+
+Usage:
+  python3 scripts/uart_frame_host.py --port /dev/ttyUSB1 --windows windows.bin --out preds.csv
+  python3 scripts/uart_frame_host.py --exec "litex_port/host/tinyformer_host serve" --windows windows.bin
+"""
+import argparse
+import os
+import select
+import shlex
+import struct
+import subprocess
+import sys
+import time
+
+UF_VERSION = 1
+T_HELLO, T_WINDOW, T_STOP = 0x01, 0x02, 0x03
+T_INFO, T_RESULT, T_ACK, T_ERROR = 0x81, 0x82, 0x83, 0xFF
+ERRORS = {1: "crc", 2: "length", 3: "type", 4: "overflow"}
+
+
+def crc16(data: bytes, crc: int = 0xFFFF) -> int:
+    """CRC-16/CCITT-FALSE (uf_crc16)."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data: bytes) -> bytes:
+    out = bytearray()
+    i = 0
+    while True:
+        run = 0
+        while i + run < len(data) and data[i + run] != 0 and run < 254:
+            run += 1
+        out.append(run + 1)
+        out += data[i:i + run]
+        i += run
+        if i == len(data):
+            return bytes(out)
+        if run < 254:
+            i += 1
+
+
+def cobs_decode(data: bytes):
+    """Decoded bytes, or None if the blocks do not add up."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(ftype: int, seq: int, body: bytes = b"") -> bytes:
+    payload = bytes((ftype, seq & 0xFF)) + body
+    return cobs_encode(payload + struct.pack("<H", crc16(payload))) + b"\0"
+
+
+class SerialLink:
+    def __init__(self, port, baud, timeout):
+        import serial
+
+        self.ser = serial.Serial(port, baud, timeout=timeout)
+
+    def write(self, data):
+        self.ser.write(data)
+
+    def read(self, timeout):
+        self.ser.timeout = timeout
+        return self.ser.read(max(1, self.ser.in_waiting))
+
+    def close(self):
+        self.ser.close()
+
+
+class ProcessLink:
+    """The host build's `tinyformer_host serve` on a pipe."""
+
+    def __init__(self, cmd):
+        self.proc = subprocess.Popen(shlex.split(cmd), stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+
+    def write(self, data):
+        self.proc.stdin.write(data)
+        self.proc.stdin.flush()
+
+    def read(self, timeout):
+        fd = self.proc.stdout.fileno()
+        if not select.select([fd], [], [], timeout)[0]:
+            return b""
+        return os.read(fd, 4096)
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait(timeout=5)
+
+
+class Board:
+    def __init__(self, link, timeout):
+        self.link = link
+        self.timeout = timeout
+        self.rx = bytearray()
+        self.seq = 0
+        self.bytes_out = 0
+        self.bytes_in = 0
+
+    def recv(self, deadline):
+        """Next good frame as (type, seq, body), or None at the deadline."""
+        while True:
+            end = self.rx.find(0)
+            if end >= 0:
+                raw, self.rx = bytes(self.rx[:end]), self.rx[end + 1:]
+                dec = cobs_decode(raw) if raw else None
+                if dec is not None and len(dec) >= 4 and crc16(dec[:-2]) == struct.unpack("<H", dec[-2:])[0]:
+                    return dec[0], dec[1], dec[2:-2]
+                continue
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            data = self.link.read(left)
+            self.bytes_in += len(data)
+            self.rx += data
+
+    def request(self, ftype, body=b"", want=None, retries=3):
+        """Send one request and return the body of its reply."""
+        for _ in range(retries + 1):
+            self.seq = (self.seq + 1) & 0xFF
+            frame = encode_frame(ftype, self.seq, body)
+            self.link.write(frame)
+            self.bytes_out += len(frame)
+            deadline = time.monotonic() + self.timeout
+            while True:
+                reply = self.recv(deadline)
+                if reply is None:
+                    break
+                rtype, rseq, rbody = reply
+                if rtype == T_ERROR:
+                    code = rbody[0] if rbody else 0
+                    print(f"board error: {ERRORS.get(code, code)}, resending", file=sys.stderr)
+                    break
+                if rseq == self.seq and rtype == want:
+                    return rbody
+        raise TimeoutError(f"no reply to request type 0x{ftype:02X}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Binary UART protocol driver (uart_frame.h).")
+    src = parser.add_mutually_exclusive_group(required=True)
+    src.add_argument("--port", help="Serial port of the board (e.g. /dev/ttyUSB1)")
+    src.add_argument("--exec", dest="exec_cmd", help="Run a server on a pipe, e.g. 'litex_port/host/tinyformer_host serve'")
+    parser.add_argument("--baud", type=int, default=115200, help="Baud rate (default: 115200)")
+    parser.add_argument("--start", default="s", help="Bytes sent first to start demo_run() (default: 's'; '' for --exec)")
+    parser.add_argument("--windows", required=True, help="Raw int8 [n][S][D] window file")
+    parser.add_argument("--out", help="CSV output (default: stdout)")
+    parser.add_argument("--logits", action="store_true", help="Add cycles and logits columns to the CSV")
+    parser.add_argument("--timeout", type=float, default=2.0, help="Reply timeout in seconds (default: 2)")
+    parser.add_argument("--retries", type=int, default=3, help="Resends per request (default: 3)")
+    args = parser.parse_args()
+
+    link = ProcessLink(args.exec_cmd) if args.exec_cmd else SerialLink(args.port, args.baud, args.timeout)
+    board = Board(link, args.timeout)
+    if args.start and not args.exec_cmd:
+        link.write(args.start.encode())
+    link.write(b"\0")  # end whatever the board received before
+
+    info = board.request(T_HELLO, want=T_INFO, retries=args.retries)
+    version, S, D, n_classes, max_body, model = struct.unpack("<BBBBHB", info[:7])
+    if version != UF_VERSION:
+        raise SystemExit(f"protocol version {version}, expected {UF_VERSION}")
+    win_bytes = S * D
+    data = open(args.windows, "rb").read()
+    if not data or len(data) % win_bytes:
+        raise SystemExit(f"{args.windows}: size {len(data)} is not a multiple of {win_bytes}-byte windows")
+    print(f"INFO S={S} D={D} classes={n_classes} max_body={max_body} model={'blob' if model else 'built-in'}",
+          file=sys.stderr)
+
+    out = open(args.out, "w") if args.out else sys.stdout
+    out.write("window,pred,enc_cksum" + (",cycles," + ",".join(f"logit{c}" for c in range(n_classes)) if args.logits else "") + "\n")
+    t0 = time.monotonic()
+    n = len(data) // win_bytes
+    for i in range(n):
+        body = board.request(T_WINDOW, data[i * win_bytes:(i + 1) * win_bytes], want=T_RESULT, retries=args.retries)
+        pred, nc = body[0], body[1]
+        cksum, cycles = struct.unpack("<II", body[4:12])
+        row = f"{i},{pred},0x{cksum:08X}"
+        if args.logits:
+            logits = struct.unpack(f"<{nc}i", body[12:12 + 4 * nc])
+            row += f",{cycles}," + ",".join(str(v) for v in logits)
+        out.write(row + "\n")
+    dt = time.monotonic() - t0
+    board.request(T_STOP, want=T_ACK, retries=args.retries)
+    if out is not sys.stdout:
+        out.close()
+    link.close()
+    print(f"PROTO windows={n} s={dt:.3f} windows_per_s={n / dt:.1f} bytes_out={board.bytes_out} "
+          f"bytes_in={board.bytes_in}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Results table of the TinyFormer benchmark suite (litex_port, make BENCH=1,
+TINYFORMER_BENCH_SUITE in common/demo_runner.h): the SUITE lines of one or
+more suite runs as an MLPerf-Tiny-style table, one row per model and
+backend set.
+
+For each row:
+  latency     median encoder pass at --cpu-mhz
+  cycles/MAC  median cycles over the pass's MACs (Q/K/V, W_o, attention
+              scores and context, FFN)
+  x cpu       speedup over the cpu row of the same model and run
+  sram        activation bytes of the model's encoder instance (the kernel
+              scratch, shared by all models, is on the TF_SRAM line)
+  weights     weight and bias bytes
+  energy      active cycles per pass in millions (the CPU never sleeps in
+              a pass), or uJ with the board's active power --active-mw
+  kernels     kernel of the Q/K/V, W_o, FF1 and FF2 matvecs and the softmax
+              exp: the dispatch table is tuned for the default (har) shape,
+              and a shape none of its entries matches runs on DOT8 or the CPU
+The correctness gate fails (exit 1) if a model's output checksum differs
+between backends, if the har checksum differs from the first ENC_CKSUM of
+the sample replay that follows the suite, or if a run has no SUITE END line.
+
+Usage (from repo root TinyML_algo/):
+  python3 tools/bench_suite.py suite.log --cpu-mhz 100
+      a UART capture of the BENCH=1 firmware
+  python3 tools/bench_suite.py dot8.log all.log --active-mw 45 --csv suite.csv
+      several firmware builds (TARGET=...) in one table, plus a CSV
+  python3 tools/bench_suite.py --exec "litex_port/host/tinyformer_suite_host demo"
+      the host build (make suite-check)
+  python3 tools/bench_suite.py all.log --json suite.json --baseline last_release.json
+      adds the cycle change of each row against an earlier --json
+"""
+
+import argparse
+import json
+import re
+import subprocess
+import sys
+from pathlib import Path
+
+RE_BEGIN = re.compile(r"^SUITE BEGIN models=(\d+) backends=(\d+) runs=(\d+) hw=([0-9A-Fa-f]+)")
+RE_ROW = re.compile(r"^SUITE model=(\S+) (.*)")
+RE_FIELD = re.compile(r"(\w+)=(\S+)")
+RE_CKSUM = re.compile(r"^ENC_CKSUM=0x([0-9A-Fa-f]{8})")
+INT_FIELDS = ("S", "D", "FFN", "cycles", "best", "macs", "sram", "weights")
+KERNELS = ("qkv", "o", "ff1", "ff2", "exp")
+
+
+def parse(text, run):
+    """SUITE rows of one log as dicts, and a list of gate failures."""
+    rows, errors = [], []
+    begun = ended = False
+    first_cksum = None
+    for raw in text.splitlines():
+        line = raw.strip()
+        if RE_BEGIN.match(line):
+            begun = True
+        elif line == "SUITE END":
+            ended = True
+        elif RE_ROW.match(line):
+            m = RE_ROW.match(line)
+            row = {"run": run, "model": m.group(1)}
+            row.update(dict(RE_FIELD.findall(m.group(2))))
+            for k in INT_FIELDS:
+                row[k] = int(row[k])
+            row["cksum"] = int(row["cksum"], 16)
+            rows.append(row)
+        elif ended and first_cksum is None and RE_CKSUM.match(line):
+            first_cksum = int(RE_CKSUM.match(line).group(1), 16)
+    if not begun or not ended:
+        errors.append(f"{run}: no complete SUITE BEGIN .. SUITE END run")
+    sums = {}
+    for r in rows:
+        sums.setdefault(r["model"], set()).add(r["cksum"])
+    for model, s in sums.items():
+        if len(s) > 1:
+            errors.append(f"{run}: {model} checksums differ between backends: "
+                          + " ".join(f"0x{c:08X}" for c in sorted(s)))
+    if first_cksum is not None and "har" in sums and sums["har"] != {first_cksum}:
+        errors.append(f"{run}: har checksum is not the sample replay's ENC_CKSUM=0x{first_cksum:08X}")
+    return rows, errors
+
+
+def derive(rows, cpu_mhz, active_mw):
+    cpu = {(r["run"], r["model"]): r["cycles"] for r in rows if r["backend"] == "cpu"}
+    for r in rows:
+        r["latency_ms"] = r["cycles"] / (cpu_mhz * 1e3)
+        r["cycles_per_mac"] = r["cycles"] / r["macs"] if r["macs"] else 0.0
+        base = cpu.get((r["run"], r["model"]))
+        r["speedup"] = base / r["cycles"] if base and r["cycles"] else None
+        r["energy_uj"] = r["cycles"] / cpu_mhz * active_mw / 1e3 if active_mw else None
+        r["kernels"] = "/".join(r[k] for k in KERNELS)
+
+
+def key(r, with_run):
+    return (r["run"], r["model"], r["backend"]) if with_run else (r["model"], r["backend"])
+
+
+def table(rows, several, baseline):
+    head = ["Model", "S", "D", "FFN", "Backend", "Latency ms", "Cycles/MAC", "x cpu",
+            "SRAM B", "Weights B", "Energy", "Kernels qkv/o/ff1/ff2/exp"]
+    if several:
+        head.insert(0, "Run")
+    if baseline is not None:
+        head.append("vs base")
+    out = ["| " + " | ".join(head) + " |", "|" + "|".join("---" for _ in head) + "|"]
+    for r in rows:
+        energy = f"{r['energy_uj']:.1f} uJ" if r["energy_uj"] is not None else f"{r['cycles'] / 1e6:.3f} Mcyc"
+        cells = [r["model"], str(r["S"]), str(r["D"]), str(r["FFN"]), r["backend"],
+                 f"{r['latency_ms']:.3f}", f"{r['cycles_per_mac']:.2f}",
+                 f"{r['speedup']:.2f}" if r["speedup"] else "-",
+                 str(r["sram"]), str(r["weights"]), energy, r["kernels"]]
+        if several:
+            cells.insert(0, r["run"])
+        if baseline is not None:
+            b = baseline[1].get(key(r, baseline[0]))
+            cells.append(f"{(r['cycles'] - b) * 100.0 / b:+.1f} %" if b else "new")
+        out.append("| " + " | ".join(cells) + " |")
+    return "\n".join(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("logs", nargs="*", help="suite logs ('-': stdin)")
+    ap.add_argument("--exec", dest="exec_cmd", help="run this command and read its stdout as a log")
+    ap.add_argument("--cpu-mhz", type=float, default=100.0, help="core clock (default 100)")
+    ap.add_argument("--active-mw", type=float, default=0.0,
+                    help="board power while active: energy in uJ instead of active cycles")
+    ap.add_argument("--csv", help="also write the rows as CSV")
+    ap.add_argument("--json", help="also write the rows as JSON (a later --baseline)")
+    ap.add_argument("--baseline", help="JSON of an earlier run: adds the cycle change per row")
+    args = ap.parse_args()
+
+    logs = []
+    if args.exec_cmd:
+        try:
+            res = subprocess.run(args.exec_cmd, shell=True, check=True, capture_output=True, text=True)
+        except subprocess.CalledProcessError as e:
+            sys.exit(f"bench_suite: {args.exec_cmd}: exit {e.returncode}")
+        logs.append(("exec", res.stdout))
+    for path in args.logs:
+        text = sys.stdin.read() if path == "-" else Path(path).read_text(errors="replace")
+        logs.append((Path(path).stem if path != "-" else "stdin", text))
+    if not logs:
+        ap.error("nothing to do: give logs or --exec")
+
+    rows, errors = [], []
+    for run, text in logs:
+        r, e = parse(text, run)
+        rows += r
+        errors += e
+    derive(rows, args.cpu_mhz, args.active_mw)
+
+    baseline = None
+    if args.baseline:
+        base_rows = json.loads(Path(args.baseline).read_text())
+        # Rows match by run too only if both sides have several runs.
+        with_run = len(logs) > 1 and len({r["run"] for r in base_rows}) > 1
+        baseline = (with_run, {key(r, with_run): r["cycles"] for r in base_rows})
+    print(table(rows, len(logs) > 1, baseline))
+
+    if args.csv:
+        cols = ["run", "model", "S", "D", "FFN", "backend", "cycles", "best", "macs", "latency_ms",
+                "cycles_per_mac", "speedup", "sram", "weights", "energy_uj", "kernels", "cksum"]
+        with open(args.csv, "w") as f:
+            f.write(",".join(cols) + "\n")
+            for r in rows:
+                f.write(",".join("" if r[c] is None else str(r[c]) for c in cols) + "\n")
+    if args.json:
+        Path(args.json).write_text(json.dumps(rows, indent=1) + "\n")
+
+    for e in errors:
+        print("SUITE FAIL " + e)
+    if errors:
+        return 1
+    print(f"SUITE OK runs={len(logs)} rows={len(rows)}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
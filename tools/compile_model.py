@@ -0,0 +1,548 @@
+#!/usr/bin/env python3
+"""
+Ahead-of-time model compiler: emits a TinyFormer encoder specialized to one
+weight set as C (tinyformer_<name>.c / .h), with
+
+  void tinyformer_<name>_encode(const int8_t input[S][D], int8_t output[S][D]);
+
+bit-identical to tinyformer_encode() of litex_port/common/tinyformer.c run
+with the same weights on the default path: separate Q/K/V projections,
+two-pass softmax over the exp LUT, TINYFORMER_HEADS heads, and the fixed
+>> 7 requant (or, with --per-channel, TINYFORMER_PER_CHANNEL_REQUANT).
+
+Every matvec is unrolled completely with the weights as immediates. Zero
+weights (scalar) or all-zero 4-wide blocks (DOT8) are dropped, as are zero
+biases. Rows without weights become the constant their requantized bias
+gives, and the requant multipliers and shifts are baked into each row.
+There are no weight tables, no layer dispatch and no runtime shape: the
+token loop and the attention run with constant trip counts. Per layer, the
+matvec is emitted as
+  scalar  one multiply-add per non-zero weight (no peripheral needed)
+  dot8    dot8_mac / dot8_mac8 per non-zero weight word (dot8.h; USE_DOT8_HW
+          on the FPGA, the dot8_sw() fallback elsewhere)
+  gemv    gemv_matvec() on a baked [rows][cols] table plus the unrolled
+          requant (gemv.h, USE_GEMV_HW SoCs only)
+--backend auto takes dot8 for layers whose kept words average more than two
+non-zero weights, scalar otherwise. Other variants (FWA, low rank, linear or
+online attention, int4, FFN_U8_HIDDEN, FAST_SOFTMAX aside) are not
+generated; build tinyformer.c for them.
+
+Weights are read from the C sources the firmware compiles (--c-dir, default
+litex_port/common: trained_weights.c / .h, as tools/tinyformer_sim.py), from
+a model blob (--blob, tools/export_weights.py --blob; int8 only) or from a
+PyTorch checkpoint (--checkpoint artifacts/state_dict.pt; needs torch,
+quantized as the per-tensor export_weights.py).
+
+Usage (from repo root):
+  python3 tools/compile_model.py --name har --out-dir build
+      build/tinyformer_har.c / .h from litex_port/common/trained_weights.c
+  python3 tools/compile_model.py --name har --blob har.tfmb --backend dot8
+  python3 tools/compile_model.py --name har --layer-backend ff1=gemv,ff2=gemv
+  make -C litex_port aot-check
+      generates host/tinyformer_aot.c and compares it with tinyformer_encode()
+Link the generated .c into a firmware with make AOT_MODEL=<dir>/tinyformer_<name>.c
+(litex_port/Makefile) and call tinyformer_<name>_encode() in place of
+tinyformer_encode(). The gain is the pruned sparsity: on a dense weight set
+the unrolled code is larger, not much faster, than the generic kernels.
+"""
+
+import argparse
+import re
+import struct
+import sys
+from pathlib import Path
+
+S = 16
+D = 32
+FFN = 64
+
+REPO_ROOT = Path(__file__).resolve().parents[1]
+C_DIR = REPO_ROOT / "litex_port" / "common"
+
+# exp_lut of tinyformer.c (exp(x) * 2^10 over x in [-15, 0])
+EXP_LUT = (1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12)
+
+# (layer, rows, ReLU after the requant); the layer order of TINYFORMER_RQ_*
+LAYERS = (("q", D, False), ("k", D, False), ("v", D, False),
+          ("o", D, False), ("ff1", FFN, True), ("ff2", D, False))
+BACKENDS = ("scalar", "dot8", "gemv")
+
+# model_blob.h (TF_BLOB_*), as written by export_weights.py --blob
+BLOB_MAGIC = 0x424D4654
+BLOB_HEADER = struct.Struct("<IHHHHHHHHII")
+BLOB_TENSOR = struct.Struct("<HBBHHIII")
+BLOB_F_PER_CHANNEL = 0x0001
+BLOB_F_INT4 = 0x0002
+BLOB_F_HEADS_SHIFT = 8
+BLOB_INT8, BLOB_INT32, BLOB_UINT8 = 1, 3, 4
+BLOB_RQ_BIAS, BLOB_RQ_MUL, BLOB_RQ_SHIFT = 0x20, 0x30, 0x40
+
+
+class Model:
+    """int8 weight set: W[l] (list of rows), b[l], rq[l] = (bias, mul, shift) or None."""
+
+    def __init__(self, source: str):
+        self.source = source
+        self.W = {}
+        self.b = {}
+        self.rq = None
+        self.heads = 1
+
+    def check(self):
+        for l, rows, _ in LAYERS:
+            W = self.W[l]
+            cols = len(W[0]) if W else 0
+            if len(W) != rows or any(len(r) != cols for r in W) or cols % 4 != 0 or cols < 4:
+                raise ValueError(f"W_{l}: expected [{rows}][4k] rows, got {len(W)} x {cols}")
+            if len(self.b[l]) != rows:
+                raise ValueError(f"b_{l}: expected {rows} values")
+        if len(self.W["o"][0]) != D or len(self.W["ff1"][0]) != D or len(self.W["ff2"][0]) != FFN:
+            raise ValueError("W_o / W_ff1 / W_ff2 must be [D][D] / [FFN][D] / [D][FFN]")
+        d_in = len(self.W["q"][0])
+        if len(self.W["k"][0]) != d_in or len(self.W["v"][0]) != d_in or d_in > D:
+            raise ValueError("W_q / W_k / W_v must share their input width (<= D)")
+        if self.heads < 1 or D % (4 * self.heads) != 0:
+            raise ValueError(f"heads = {self.heads}: D / heads must be a multiple of 4")
+
+
+def rows_of(values, cols):
+    return [list(values[r:r + cols]) for r in range(0, len(values), cols)]
+
+
+def read_c_arrays(path: Path) -> dict:
+    """name -> values of every initialized int8/uint8/int32 array (as tinyformer_sim.py)."""
+    src = path.read_text()
+    arrays = {}
+    for name, body in re.findall(r"const (?:u?int8_t|int32_t) (\w+)\[[^=]*=\s*\{(.*?)\};", src, re.S):
+        arrays[name] = [int(v) for v in re.findall(r"-?\d+", body)]
+    return arrays
+
+
+def read_c_define(path: Path, name: str, default=None):
+    m = re.search(rf"#define {name}\s+(-?\d+)", path.read_text())
+    return int(m.group(1)) if m else default
+
+
+def load_c(c_dir: Path, per_channel: bool) -> Model:
+    arrays = read_c_arrays(c_dir / "trained_weights.c")
+    header = c_dir / "trained_weights.h"
+    if read_c_define(header, "TRAINED_WEIGHTS_LINEAR_ATTN"):
+        raise ValueError("trained with linear attention: not generated (build tinyformer.c)")
+    m = Model(str(c_dir / "trained_weights.c"))
+    m.heads = read_c_define(header, "TRAINED_WEIGHTS_HEADS", 1)
+    for l, rows, _ in LAYERS:
+        values = arrays[f"W_{l}"]
+        m.W[l] = rows_of(values, len(values) // rows)
+        m.b[l] = arrays[f"b_{l}"]
+    if per_channel:
+        if "rq_bias_q" not in arrays:
+            raise ValueError(f"--per-channel: no rq_bias_q in {m.source} (export with --per-channel)")
+        m.rq = {l: (arrays[f"rq_bias_{l}"], arrays[f"rq_mul_{l}"], arrays[f"rq_shift_{l}"])
+                for l, _, _ in LAYERS}
+    return m
+
+
+def load_blob(path: Path) -> Model:
+    blob = path.read_bytes()
+    (magic, _version, header_bytes, s, d, ffn, _n_classes, n_tensors, flags, total,
+     _crc) = BLOB_HEADER.unpack_from(blob, 0)
+    if magic != BLOB_MAGIC or total > len(blob):
+        raise ValueError(f"{path}: not a model blob")
+    if (s, d, ffn) != (S, D, FFN):
+        raise ValueError(f"{path}: shape {s}/{d}/{ffn}, expected {S}/{D}/{FFN}")
+    if flags & BLOB_F_INT4:
+        raise ValueError(f"{path}: int4 blobs are not generated")
+    tensors = {}
+    for n in range(n_tensors):
+        tid, dtype, _, rows, cols, offset, nbytes, _ = BLOB_TENSOR.unpack_from(
+            blob, header_bytes + n * BLOB_TENSOR.size)
+        fmt = {BLOB_INT8: "b", BLOB_INT32: "i", BLOB_UINT8: "B"}[dtype]
+        count = nbytes // struct.calcsize(fmt)
+        tensors[tid] = (rows, cols, list(struct.unpack_from(f"<{count}{fmt}", blob, offset)))
+    m = Model(str(path))
+    m.heads = 1 + ((flags >> BLOB_F_HEADS_SHIFT) & 0xFF)
+    for n, (l, _, _) in enumerate(LAYERS):
+        _, cols, values = tensors[1 + n]
+        m.W[l] = rows_of(values, cols)
+        m.b[l] = tensors[7 + n][2]
+    if flags & BLOB_F_PER_CHANNEL:
+        m.rq = {l: (tensors[BLOB_RQ_BIAS + n][2], tensors[BLOB_RQ_MUL + n][2], tensors[BLOB_RQ_SHIFT + n][2])
+                for n, (l, _, _) in enumerate(LAYERS)}
+    return m
+
+
+def load_checkpoint(path: Path) -> Model:
+    sys.path.insert(0, str(Path(__file__).resolve().parent))
+    import torch
+    import export_weights as ew
+
+    state = torch.load(path, map_location="cpu")
+    state = state.get("state_dict", state) if isinstance(state, dict) else state
+    if int(state.get("linear_attn", 0)):
+        raise ValueError("trained with linear attention: not generated (build tinyformer.c)")
+    m = Model(str(path))
+    m.heads = int(state.get("heads", 1))
+    target = {"ff1": (FFN, D), "ff2": (D, FFN)}
+    for l, _, _ in LAYERS:
+        W = state[f"W_{l}"].detach().cpu()
+        W = ew.maybe_transpose_ffn(f"W_{l}", W, target.get(l, (D, D)))
+        m.W[l] = ew.quantize_to_int8(W).tolist()
+        m.b[l] = ew.quantize_to_int8(state[f"b_{l}"].detach().cpu().view(-1)).tolist()
+    return m
+
+
+# --- Code generation -------------------------------------------------------
+
+def requant_const(acc: int, rq_c, relu: bool) -> int:
+    """requant() of tinyformer.c (then the FF1 ReLU) for a constant accumulator."""
+    if rq_c is None:
+        y = max(-128, min(127, acc >> 7))
+    else:
+        bias, mul, sh = rq_c
+        x = (acc + bias) * mul
+        y = max(-128, min(127, (x + (1 << (sh - 1))) >> sh))
+    return max(y, 0) if relu else y
+
+
+def pack_word(w4) -> int:
+    """dot8_pack() of 4 int8 weights: lane 0 in the LSB."""
+    return sum((v & 0xFF) << (8 * i) for i, v in enumerate(w4))
+
+
+def layer_stats(W):
+    nnz = sum(1 for r in W for v in r if v != 0)
+    blocks = sum(1 for r in W for j in range(0, len(r), 4) if any(r[j:j + 4]))
+    return nnz, blocks
+
+
+def pick_backend(W, choice: str) -> str:
+    if choice != "auto":
+        return choice
+    nnz, blocks = layer_stats(W)
+    return "dot8" if nnz > 2 * blocks else "scalar"
+
+
+def requant_expr(acc: str, rq_c, relu: bool) -> str:
+    if rq_c is None:
+        return f"{'tfg_relu8' if relu else 'tfg_rq7'}({acc})"
+    _, mul, sh = rq_c
+    return f"{'tfg_rqc_relu' if relu else 'tfg_rqc'}({acc}, {mul}, {sh})"
+
+
+def row_consts(m: Model, l: str, r: int):
+    """(accumulator start, requant entry) of row r: the int8 bias, or with
+    per-channel requant the int32 one (the int8 bias is then not read)."""
+    if m.rq is None:
+        return m.b[l][r], None
+    bias, mul, shift = (v[r] for v in m.rq[l])
+    return bias, (0, mul, shift)
+
+
+def c_sum(start: int, terms) -> str:
+    """start + sum of coefficient * operand, as a C expression."""
+    out = str(start) if start != 0 or not terms else ""
+    for coef, operand in terms:
+        mag = operand if abs(coef) == 1 else f"{abs(coef)} * {operand}"
+        if not out:
+            out = mag if coef > 0 else f"-{mag}"
+        else:
+            out += f" {'+' if coef > 0 else '-'} {mag}"
+    return out
+
+
+def emit_layer(m: Model, l: str, relu: bool, backend: str, fn: str) -> str:
+    """static void fn(const int8_t *x, int8_t *y): y = requant(W_l x + b_l)."""
+    W = m.W[l]
+    rows, cols = len(W), len(W[0])
+    nnz, blocks = layer_stats(W)
+    lines = [f"// {l}: [{rows}][{cols}] on {backend}, {nnz} non-zero weights in {blocks} words "
+             f"of {rows * cols // 4}.",
+             f"static TFG_TEXT void {fn}(const int8_t *x, int8_t *y)", "{"]
+    body = []
+    if backend == "gemv":
+        flat = ", ".join(str(v) for r in W for v in r)
+        has_b = m.rq is None and any(m.b[l])
+        lines.insert(0, f"static const int8_t {fn}_W[{rows * cols}] __attribute__((aligned(4))) = {{ {flat} }};")
+        if has_b:
+            lines.insert(1, f"static const int8_t {fn}_b[{rows}] = {{ {', '.join(str(v) for v in m.b[l])} }};")
+        body.append(f"    int32_t acc[{rows}];")
+        body.append(f"    gemv_matvec({fn}_W, x, {fn + '_b' if has_b else '0'}, acc, {rows}, {cols});")
+        for r in range(rows):
+            start, rq_c = row_consts(m, l, r)
+            add = start if m.rq is not None else 0
+            acc = f"acc[{r}] + {add}" if add > 0 else f"acc[{r}] - {-add}" if add < 0 else f"acc[{r}]"
+            body.append(f"    y[{r}] = {requant_expr(acc, rq_c, relu)};")
+        return "\n".join(lines + body + ["}", ""])
+
+    if backend == "dot8":
+        used = sorted({j // 4 for r in W for j in range(0, cols, 4) if any(r[j:j + 4])})
+        if used:
+            body.append(f"    uint32_t xp[{cols // 4}];")
+            body.append("    int32_t a;")
+        for j in used:
+            body.append(f"    xp[{j}] = dot8_pack(&x[{4 * j}]);")
+    for r in range(rows):
+        start, rq_c = row_consts(m, l, r)
+        row = W[r]
+        if not any(row):
+            body.append(f"    y[{r}] = {requant_const(start, rq_c, relu)};")
+            continue
+        if backend == "scalar":
+            terms = [(v, f"x[{i}]") for i, v in enumerate(row) if v != 0]
+            body.append(f"    y[{r}] = {requant_expr(c_sum(start, terms), rq_c, relu)};")
+            continue
+        words = [(j // 4, pack_word(row[j:j + 4])) for j in range(0, cols, 4) if any(row[j:j + 4])]
+        body.append(f"    a = {start};")
+        for k in range(0, len(words) - 1, 2):
+            (j0, w0), (j1, w1) = words[k], words[k + 1]
+            body.append(f"    a = dot8_mac8(a, 0x{w0:08X}u, 0x{w1:08X}u, xp[{j0}], xp[{j1}]);")
+        if len(words) % 2:
+            j0, w0 = words[-1]
+            body.append(f"    a = dot8_mac(a, 0x{w0:08X}u, xp[{j0}]);")
+        body.append(f"    y[{r}] = {requant_expr('a', rq_c, relu)};")
+    if not any(any(r) for r in W):
+        body.insert(0, "    (void)x;")
+    return "\n".join(lines + body + ["}", ""])
+
+
+ATTENTION = """\
+// Attention of tinyformer.c's attention_multi_head() (two-pass softmax, exp
+// LUT, {heads} head(s) of {hd} channels{causal}): ctx = softmax(q k^T >> {shift}) v.
+static TFG_TEXT void {p}_attention(void)
+{{
+    static const uint16_t lut[16] = {{ {lut} }};
+    uint16_t e[{S}];
+    int32_t sc[{S}];
+    int32_t i, h0, j, d;
+
+    for (i = 0; i < {S}; ++i) {{
+        for (h0 = 0; h0 < {D}; h0 += {hd}) {{
+            const int32_t n = {keys};
+            int32_t max_score = -2147483647;
+            uint32_t sum_exp = 0;
+            for (j = 0; j < n; ++j) {{
+                int32_t acc = 0;
+                for (d = h0; d < h0 + {hd}; ++d) {{
+                    acc += (int32_t){p}_q[i][d] * (int32_t){p}_k[j][d];
+                }}
+                acc >>= {shift};
+                sc[j] = acc;
+                if (acc > max_score) {{
+                    max_score = acc;
+                }}
+            }}
+            for (j = 0; j < n; ++j) {{
+                int16_t x = (int16_t)((sc[j] - max_score) >> 3);
+                if (x > 0) {{
+                    x = 0;
+                }} else if (x < -15) {{
+                    x = -15;
+                }}
+                e[j] = lut[-x];
+                sum_exp += e[j];
+            }}
+            if (sum_exp == 0u) {{
+                sum_exp = 1u;
+            }}
+{weights}
+            for (d = h0; d < h0 + {hd}; ++d) {{
+                int32_t acc = 0;
+                for (j = 0; j < n; ++j) {{
+                    acc += ((int32_t)e[j] * (int32_t){p}_v[j][d]) >> 15;
+                }}
+                {p}_ctx[i][d] = tfg_sat8(acc);
+            }}
+        }}
+    }}
+}}
+"""
+
+WEIGHTS_EXACT = """\
+            for (j = 0; j < n; ++j) {
+                e[j] = (uint16_t)(((uint32_t)e[j] << 15) / sum_exp);
+            }"""
+
+WEIGHTS_FAST = """\
+            {
+                const uint32_t recip = 0x80000000u / sum_exp;
+                for (j = 0; j < n; ++j) {
+                    e[j] = (uint16_t)(((uint32_t)e[j] * recip) >> 16);
+                }
+            }"""
+
+HELPERS = """\
+#ifndef TFG_TEXT
+#define TFG_TEXT  // e.g. __attribute__((section(".fast_text")))
+#endif
+
+static inline int8_t tfg_sat8(int32_t x)
+{
+    return (int8_t)(x > 127 ? 127 : (x < -128 ? -128 : x));
+}
+
+static inline __attribute__((unused)) int8_t tfg_rq7(int32_t acc)
+{
+    return tfg_sat8(acc >> 7);
+}
+
+static inline __attribute__((unused)) int8_t tfg_relu8(int32_t acc)
+{
+    const int8_t y = tfg_sat8(acc >> 7);
+    return (int8_t)(y < 0 ? 0 : y);
+}
+
+// Per-channel requant: sat8(round((acc + bias) * mul / 2^sh)), bias in acc.
+static inline __attribute__((unused)) int8_t tfg_rqc(int32_t acc, int32_t mul, int32_t sh)
+{
+    int64_t x = (int64_t)acc * (int64_t)mul;
+    x = (x + ((int64_t)1 << (sh - 1))) >> sh;
+    return (int8_t)(x > 127 ? 127 : (x < -128 ? -128 : x));
+}
+
+static inline __attribute__((unused)) int8_t tfg_rqc_relu(int32_t acc, int32_t mul, int32_t sh)
+{
+    const int8_t y = tfg_rqc(acc, mul, sh);
+    return (int8_t)(y < 0 ? 0 : y);
+}
+"""
+
+
+def generate(m: Model, name: str, backends: dict, score_shift: int, causal: bool,
+             fast_softmax: bool, source_note: str):
+    p = f"tinyformer_{name}"
+    d_in = len(m.W["q"][0])
+    hd = D // m.heads
+    uses = set(backends.values())
+    h = [f"// Generated by tools/compile_model.py from {source_note}; do not edit.",
+         f"// {p}_encode(): tinyformer_encode() specialized to this weight set.",
+         "", f"#ifndef {p.upper()}_H", f"#define {p.upper()}_H", "",
+         "#include <stdint.h>", "",
+         f"#define {p.upper()}_S {S}", f"#define {p.upper()}_D {D}", "",
+         f"void {p}_encode(const int8_t input[{S}][{D}], int8_t output[{S}][{D}]);", "",
+         f"#endif // {p.upper()}_H", ""]
+
+    c = [f"// Generated by tools/compile_model.py from {source_note}; do not edit.",
+         f"// Encoder specialized to one weight set: S={S}, D={D}, FFN={FFN}, "
+         f"Q/K/V on {d_in} input channels, {m.heads} head(s), score >> {score_shift}, "
+         f"{'per-channel' if m.rq else '>> 7'} requant"
+         f"{', causal' if causal else ''}{', fast softmax' if fast_softmax else ''}.",
+         "", f'#include "{p}.h"']
+    if "dot8" in uses:
+        c.append('#include "dot8.h"')
+    if "gemv" in uses:
+        c.append('#include "gemv.h"')
+    c += ["", HELPERS,
+          f"static int8_t {p}_q[{S}][{D}], {p}_k[{S}][{D}], {p}_v[{S}][{D}];",
+          f"static int8_t {p}_ctx[{S}][{D}], {p}_y[{S}][{D}];", ""]
+    for l, _, relu in LAYERS:
+        c.append(emit_layer(m, l, relu, backends[l], f"{p}_{l}_mv"))
+    c.append(ATTENTION.format(
+        p=p, S=S, D=D, hd=hd, heads=m.heads, shift=score_shift,
+        lut=", ".join(str(v) for v in EXP_LUT),
+        keys="i + 1" if causal else str(S), causal=", causal" if causal else "",
+        weights=WEIGHTS_FAST if fast_softmax else WEIGHTS_EXACT))
+    c.append(f"""\
+void {p}_encode(const int8_t input[{S}][{D}], int8_t output[{S}][{D}])
+{{
+    int8_t t[{D}], hid[{FFN}];
+    int32_t s, d;
+
+    for (s = 0; s < {S}; ++s) {{
+        {p}_q_mv(input[s], {p}_q[s]);
+        {p}_k_mv(input[s], {p}_k[s]);
+        {p}_v_mv(input[s], {p}_v[s]);
+    }}
+    {p}_attention();
+    for (s = 0; s < {S}; ++s) {{
+        {p}_o_mv({p}_ctx[s], t);
+        for (d = 0; d < {D}; ++d) {{
+            {p}_y[s][d] = tfg_sat8((int32_t)input[s][d] + (int32_t)t[d]);
+        }}
+    }}
+    for (s = 0; s < {S}; ++s) {{
+        {p}_ff1_mv({p}_y[s], hid);
+        {p}_ff2_mv(hid, t);
+        for (d = 0; d < {D}; ++d) {{
+            output[s][d] = tfg_sat8((int32_t){p}_y[s][d] + (int32_t)t[d]);
+        }}
+    }}
+}}
+""")
+    return "\n".join(c), "\n".join(h)
+
+
+def parse_layer_backends(spec: str) -> dict:
+    out = {}
+    for item in filter(None, (s.strip() for s in spec.split(","))):
+        l, _, b = item.partition("=")
+        if l not in {x[0] for x in LAYERS} or b not in BACKENDS + ("auto",):
+            raise ValueError(f"--layer-backend {item}: expected <q|k|v|o|ff1|ff2>=<{'|'.join(BACKENDS)}|auto>")
+        out[l] = b
+    return out
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Emit a TinyFormer encoder specialized to one weight set.")
+    parser.add_argument("--name", type=str, required=True, help="Model name: tinyformer_<name>.c / .h.")
+    parser.add_argument("--out-dir", type=str, default=".", help="Directory of the generated files.")
+    src = parser.add_mutually_exclusive_group()
+    src.add_argument("--c-dir", type=str, default=None,
+                     help="Directory of trained_weights.c / .h (default litex_port/common).")
+    src.add_argument("--blob", type=str, default=None, help="Model blob (export_weights.py --blob).")
+    src.add_argument("--checkpoint", type=str, default=None, help="PyTorch state_dict (needs torch).")
+    parser.add_argument("--per-channel", action="store_true",
+                        help="With --c-dir: the rq_* arrays of an export with --per-channel.")
+    parser.add_argument("--backend", choices=BACKENDS + ("auto",), default="auto",
+                        help="Matvec code of every layer (default auto: dot8 or scalar by density).")
+    parser.add_argument("--layer-backend", type=str, default="",
+                        help="Per-layer overrides, e.g. ff1=gemv,ff2=gemv,q=scalar.")
+    parser.add_argument("--score-shift", type=int, default=None,
+                        help="TINYFORMER_SCORE_SHIFT (default 5, 4 with heads > 1).")
+    parser.add_argument("--causal", action="store_true", help="TINYFORMER_CAUSAL.")
+    parser.add_argument("--fast-softmax", action="store_true", help="TINYFORMER_FAST_SOFTMAX.")
+    args = parser.parse_args()
+    if not re.fullmatch(r"[a-z_][a-z0-9_]*", args.name):
+        parser.error(f"--name {args.name}: lower-case C identifier expected")
+
+    try:
+        if args.blob:
+            model = load_blob(Path(args.blob))
+        elif args.checkpoint:
+            model = load_checkpoint(Path(args.checkpoint))
+        else:
+            model = load_c(Path(args.c_dir) if args.c_dir else C_DIR, args.per_channel)
+        model.check()
+        overrides = parse_layer_backends(args.layer_backend)
+    except (ValueError, KeyError) as e:
+        parser.error(str(e))
+    if args.per_channel and not args.c_dir and (args.blob or args.checkpoint):
+        parser.error("--per-channel is only read with --c-dir (blobs carry their own flag)")
+
+    backends = {l: pick_backend(model.W[l], overrides.get(l, args.backend)) for l, _, _ in LAYERS}
+    score_shift = args.score_shift if args.score_shift is not None else (5 if model.heads == 1 else 4)
+    try:
+        source_note = str(Path(model.source).resolve().relative_to(REPO_ROOT))
+    except ValueError:
+        source_note = Path(model.source).name
+    c_text, h_text = generate(model, args.name, backends, score_shift, args.causal,
+                              args.fast_softmax, source_note)
+    out_dir = Path(args.out_dir)
+    out_dir.mkdir(parents=True, exist_ok=True)
+    (out_dir / f"tinyformer_{args.name}.c").write_text(c_text)
+    (out_dir / f"tinyformer_{args.name}.h").write_text(h_text)
+
+    dense = kept = 0
+    for l, rows, _ in LAYERS:
+        W = model.W[l]
+        nnz, blocks = layer_stats(W)
+        const_rows = sum(1 for r in W if not any(r))
+        dense += rows * len(W[0])
+        kept += len(W[0]) * rows if backends[l] == "gemv" else nnz if backends[l] == "scalar" else 4 * blocks
+        print(f"{l:4s} {backends[l]:6s} [{rows}][{len(W[0])}] non-zero={nnz} words={blocks} "
+              f"constant_rows={const_rows}")
+    print(f"Wrote {out_dir / f'tinyformer_{args.name}.c'} and .h: "
+          f"{kept} of {dense} MACs per token kept")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,600 @@
+#!/usr/bin/env python3
+"""
+Analytical cycle-cost model of the TinyFormer encoder on a LiteX VexRiscv
+(litex_port/common/tinyformer.c) for the scalar, DOT8, GEMV and exp LUT
+backends, so that "what if D=48 / FFN=96 / int4" questions can be answered
+without building a bitstream.
+
+Each TINYFORMER_PROF_* stage of one window is a sum of counted operations
+times a per-operation cost in cycles:
+  mac, row, requant, elem   scalar MACs, per-row bookkeeping, requant +
+                            saturate, residual / ReLU / pool element ops
+  dot8_word, pack, int4     DOT8 MAC per 4 weights, packing 4 int8 into a
+                            word, unpacking 4 int4 weights
+  csr_write, csr_read       accelerator CSR accesses (GEMV, exp LUT)
+  gemv_cycle, gemv_call     GEMV core cycles (LEN / lanes + 1 per row) and
+                            per-run driver overhead
+  line_fill                 32-byte D-cache refills of the weights
+  score, exp_sw, exp_lut    per-score shift / max, software exp, LUT exp
+  div, ctx_mac              per-key Q15 division, weighted-V MAC
+  stage                     fixed cost per stage (loops, profile marks)
+The counts follow the firmware's loops:
+  - Q/K/V and W_o run all S tokens against one W, so GEMV loads each W once
+    per window. FF1 and FF2 alternate every token and are reloaded each time
+    when both are on the block.
+  - GEMV runs d_in 32 / 64 with d_out a multiple of 32 natively, and other
+    shapes through the zero-padded 64 x 64 tiles of gemv_matvec().
+  - Attention scores use DOT8 when the build has it (dot_i8), whatever the
+    matvec kernels.
+  - int4 weights never run on the GEMV block.
+  - A weight set larger than half the D-cache is refetched every token.
+Not modelled: TINYFORMER_FUSED_QKV, FWA, low-rank, block-sparse, online /
+linear attention, the softmax unit, GEMV_DMA and TINYFORMER_OVERLAP.
+
+The default costs are rough priors for a VexRiscv "standard" core with a
+4 KiB D-cache. calibrate fits them to a board's profiling output:
+  - PROF tables (make PROFILE=1) with the TUNE table printed before them
+    (AUTOTUNE=1 or CONSOLE=1), one stage observation per PROF line;
+  - each TUNE layer line as a one-matvec observation;
+  - the GEMV BENCH / DOT8 BENCH / LUT BENCH lines of the self-tests.
+The fit is least squares on relative errors, with each cost scaled from its
+prior and held near it (--ridge) where the logs do not constrain it. The
+PROF stages weigh most; the kernel timings (--micro-weight) mainly split a
+stage between its operations.
+check compares the per-stage predictions with the measured PROF numbers.
+A measurement repeated in the logs counts once, at its median run.
+A console session that benches every mode gives enough observations to
+calibrate from one boot.
+
+Usage (from repo root TinyML_algo/):
+  python3 tools/cost_model.py predict --shape D=48,FFN=96 --backend cpu,dot8,dot8+gemv+lut
+      per-stage cycles per window for each backend set (default costs or --calib)
+  python3 tools/cost_model.py predict --calib calib.json --shape bits=4 --layer ff1=dot8,ff2=cpu
+  python3 tools/cost_model.py calibrate console.log gemv_bench.log --out calib.json
+      fit the costs to the logs and print the residuals
+  python3 tools/cost_model.py check console2.log --calib calib.json --tolerance 15
+      exit 1 if a stage prediction is off by more than 15 %
+The logs carry no shape: --shape gives the one they were built with
+(default: the checked-in model, S=16 D=32 FFN=64 d_in=16).
+
+Python: cost_model.predict(Shape(D=48), plan("dot8+lut"), load_costs(path))
+returns {stage: cycles} for one window.
+"""
+
+import argparse
+import json
+import math
+import re
+import sys
+from dataclasses import dataclass, fields, replace
+
+STAGES = ("qkv", "attn", "oproj", "ffn", "head")  # TINYFORMER_PROF_*
+LAYERS = ("q", "k", "v", "o", "ff1", "ff2")        # TINYFORMER_RQ_* (print_tune)
+KERNELS = ("cpu", "dot8", "gemv")                  # TINYFORMER_KERNEL_*
+HW_DOT8, HW_GEMV, HW_EXP_LUT = 1, 2, 4             # TINYFORMER_HW_*
+
+# Prior cycles per operation (see the module doc).
+DEFAULT_COSTS = {
+    "stage": 300.0,
+    "mac": 5.0,
+    "row": 10.0,
+    "requant": 6.0,
+    "elem": 4.0,
+    "dot8_word": 5.0,
+    "pack": 8.0,
+    "int4": 4.0,
+    "csr_write": 5.0,
+    "csr_read": 8.0,
+    "gemv_cycle": 1.0,
+    "gemv_call": 40.0,
+    "line_fill": 30.0,
+    "score": 6.0,
+    "exp_sw": 8.0,
+    "exp_lut": 10.0,
+    "div": 36.0,
+    "ctx_mac": 6.0,
+}
+
+GEMV_TILE = 64  # gemv.c GEMV_TILE
+
+
+@dataclass(frozen=True)
+class Shape:
+    """Encoder shape and build; the defaults are the checked-in model."""
+    S: int = 16
+    D: int = 32
+    FFN: int = 64
+    d_in: int = 16       # Q/K/V input channels (TRAINED_WEIGHTS_D_IN)
+    heads: int = 1
+    bits: int = 8        # weight bits (4: TINYFORMER_INT4_WEIGHTS)
+    classes: int = 6
+    fast_softmax: bool = False
+    line_bytes: int = 32
+    dcache_bytes: int = 4096
+    gemv_lanes: int = 1
+
+    def layer_dims(self, layer):
+        """(d_out, d_in) of a TINYFORMER_RQ_* layer."""
+        return {"q": (self.D, self.d_in), "k": (self.D, self.d_in), "v": (self.D, self.d_in),
+                "o": (self.D, self.D), "ff1": (self.FFN, self.D), "ff2": (self.D, self.FFN)}[layer]
+
+    def w_bytes(self, layer):
+        d_out, d_in = self.layer_dims(layer)
+        return d_out * d_in * self.bits // 8
+
+
+@dataclass
+class Plan:
+    """Backends of one build: kernel per layer, exp LUT, DOT8 in the build."""
+    kernel: dict
+    exp_lut: bool = False
+    dot8_hw: bool = False
+
+
+def plan(backends, shape=Shape(), layer=None, costs=None):
+    """Plan for a backend set "cpu" / "dot8+gemv+lut" / ..., as
+    tinyformer_select_backends(): each layer on the last kernel of the set
+    that computes it (GEMV: d_in a multiple of 4, int8 weights; DOT8: d_in a
+    multiple of 4). layer overrides single layers, e.g. {"ff1": "gemv"}.
+    "auto" picks the fastest kernel per layer under costs (default:
+    DEFAULT_COSTS), as tinyformer_autotune() with every backend present."""
+    names = set(backends.split("+"))
+    unknown = names - {"cpu", "dot8", "gemv", "lut", "auto"}
+    if unknown:
+        raise ValueError(f"unknown backend {'+'.join(sorted(unknown))}")
+    if "auto" in names:
+        names = {"dot8", "gemv", "lut"}
+        p = Plan({}, exp_lut=True, dot8_hw=True)
+        for l in LAYERS:
+            cand = [k for k in KERNELS if k == "cpu" or (k in names and kernel_ok(k, l, shape))]
+            loads = 0 if l in ("q", "k", "v", "o") else 1   # as tf_tune_time()
+            p.kernel[l] = min(cand, key=lambda k: apply(costs or DEFAULT_COSTS,
+                                                        layer_features(k, l, shape, 1, loads)))
+    else:
+        p = Plan({}, exp_lut="lut" in names, dot8_hw="dot8" in names)
+        for l in LAYERS:
+            p.kernel[l] = "cpu"
+            for k in KERNELS[1:]:
+                if k in names and kernel_ok(k, l, shape):
+                    p.kernel[l] = k
+    for l, k in (layer or {}).items():
+        if l not in LAYERS or k not in KERNELS:
+            raise ValueError(f"bad layer override {l}={k}")
+        p.kernel[l] = k
+    return p
+
+
+def kernel_ok(kernel, layer, shape):
+    d_in = shape.layer_dims(layer)[1]
+    if kernel == "gemv":
+        return shape.bits == 8 and d_in % 4 == 0
+    if kernel == "dot8":
+        return d_in % (8 if shape.bits == 4 else 4) == 0
+    return True
+
+
+def add(f, key, n):
+    if n:
+        f[key] = f.get(key, 0) + n
+
+
+def apply(costs, f):
+    return sum(costs[k] * n for k, n in f.items())
+
+
+def gemv_runs(d_out, d_in):
+    """(rows, cols) of each GEMV run of one matvec: native runs of 64 / 32
+    rows, or zero-padded tiles through gemv_matvec()."""
+    if d_in in (32, 64) and d_out % 32 == 0:
+        runs, r0 = [], 0
+        while r0 < d_out:
+            rows = 64 if d_out - r0 >= 64 else 32
+            runs.append((rows, d_in))
+            r0 += rows
+        return runs
+    dim = lambda n: 32 if n <= 32 else 64
+    runs = []
+    for r0 in range(0, d_out, GEMV_TILE):
+        for c0 in range(0, d_in, GEMV_TILE):
+            runs.append((dim(min(GEMV_TILE, d_out - r0)), dim(min(GEMV_TILE, d_in - c0))))
+    return runs
+
+
+def layer_features(kernel, layer, shape, tokens, w_loads=None):
+    """Counts of tokens matvecs of layer on kernel (accumulators only, no
+    requant). w_loads: GEMV W loads (default: one unless the layer's runs
+    cannot stay resident)."""
+    f = {}
+    d_out, d_in = shape.layer_dims(layer)
+    if kernel == "cpu":
+        add(f, "mac", d_out * d_in * tokens)
+        add(f, "row", d_out * tokens)
+        if shape.bits == 4:
+            add(f, "int4", d_out * d_in // 4 * tokens)
+    elif kernel == "dot8":
+        words = -(-d_in // 4)
+        add(f, "pack", words * tokens)
+        add(f, "dot8_word", d_out * words * tokens)
+        add(f, "row", d_out * tokens)
+        if shape.bits == 4:
+            add(f, "int4", d_out * words * tokens)
+    else:
+        runs = gemv_runs(d_out, d_in)
+        if w_loads is None:
+            w_loads = 1 if len(runs) == 1 else tokens
+        for rows, cols in runs:
+            add(f, "pack", cols // 4 * tokens)
+            add(f, "csr_write", (cols // 4 + 1 + rows) * tokens)   # X, start, Y_NEXT
+            add(f, "csr_read", (rows + 1) * tokens)                # Y, status
+            add(f, "gemv_cycle", rows * (cols // shape.gemv_lanes + 1) * tokens)
+            add(f, "gemv_call", tokens)
+            add(f, "pack", rows * cols // 4 * w_loads)
+            add(f, "csr_write", (rows * cols // 4 + rows) * w_loads)  # W, b
+        if len(runs) > 1 and d_in not in (32, 64):
+            add(f, "elem", d_out * tokens)   # partial sums across column tiles
+    return f
+
+
+def weight_lines(shape, layers, tokens):
+    """D-cache refills of the weights of layers run together: once per window
+    while they fit in half the cache, else once per token."""
+    nbytes = sum(shape.w_bytes(l) for l in layers)
+    lines = -(-nbytes // shape.line_bytes)
+    return lines if nbytes <= shape.dcache_bytes // 2 else lines * tokens
+
+
+def stage_features(stage, shape, p):
+    """Operation counts of one window's stage."""
+    S, D, FFN = shape.S, shape.D, shape.FFN
+    f = {"stage": 1}
+
+    def linear(l, tokens, w_loads=None):
+        for k, n in layer_features(p.kernel[l], l, shape, tokens, w_loads).items():
+            add(f, k, n)
+        add(f, "requant", shape.layer_dims(l)[0] * tokens)
+
+    if stage == "qkv":
+        for l in ("q", "k", "v"):
+            linear(l, S)
+            add(f, "line_fill", weight_lines(shape, [l], S))
+    elif stage == "attn":
+        H, hd = shape.heads, D // shape.heads
+        keys = S * S * H
+        if p.dot8_hw and hd % 4 == 0:
+            add(f, "pack", 2 * keys * hd // 4)
+            add(f, "dot8_word", keys * hd // 4)
+        else:
+            add(f, "mac", keys * hd)
+        add(f, "score", keys)
+        add(f, "exp_lut" if p.exp_lut else "exp_sw", keys)
+        if shape.fast_softmax:
+            add(f, "div", S * H)
+            add(f, "elem", keys)
+        else:
+            add(f, "div", keys)
+        add(f, "ctx_mac", S * S * D)
+        add(f, "requant", S * D)
+    elif stage == "oproj":
+        linear("o", S)
+        add(f, "line_fill", weight_lines(shape, ["o"], S))
+        add(f, "elem", S * D)
+    elif stage == "ffn":
+        both = p.kernel["ff1"] == "gemv" and p.kernel["ff2"] == "gemv"
+        linear("ff1", S, S if both else None)
+        linear("ff2", S, S if both else None)
+        add(f, "elem", S * FFN + S * D)   # ReLU, residual
+        add(f, "line_fill", weight_lines(shape, ["ff1", "ff2"], S))
+    elif stage == "head":
+        add(f, "elem", S * D + D)
+        add(f, "mac", shape.classes * D)
+        add(f, "row", shape.classes)
+    return f
+
+
+def predict(shape, p, costs=None):
+    """{stage: cycles} of one window."""
+    costs = costs or DEFAULT_COSTS
+    return {st: apply(costs, stage_features(st, shape, p)) for st in STAGES}
+
+
+# --- Calibration -----------------------------------------------------------
+
+def load_costs(path):
+    """Costs of a calibrate --out file (None: DEFAULT_COSTS)."""
+    if path is None:
+        return dict(DEFAULT_COSTS)
+    with open(path) as fh:
+        doc = json.load(fh)
+    costs = dict(DEFAULT_COSTS)
+    costs.update(doc["costs"])
+    return costs
+
+
+def kv_fields(line):
+    return {k: v for k, v in re.findall(r"(\w+)=(\S+)", line)}
+
+
+def parse_log(path, shape):
+    """Observations (kind, label, features, measured cycles) of one log."""
+    obs = []
+    tune_hw, exp_lut, kernel = 0, False, {l: "cpu" for l in LAYERS}
+    prof = None
+    with open(path, errors="replace") as fh:
+        lines = fh.read().splitlines()
+    for n, raw in enumerate(lines, 1):
+        line = raw.strip()
+        kv = kv_fields(line)
+        if line.startswith("TUNE hw="):
+            tune_hw = int(kv["hw"], 16)
+            exp_lut = kv.get("exp") == "lut"
+        elif line.startswith("TUNE "):
+            f = line.split()
+            if len(f) >= 3 and f[1] in LAYERS and f[2] in KERNELS:
+                kernel[f[1]] = f[2]
+                c = int(kv.get("cycles", 0))
+                # Autotune keeps the projections' W resident, reloads FF1 / FF2.
+                if c:
+                    loads = 0 if f[1] in ("q", "k", "v", "o") else 1
+                    obs.append(("matvec", f"{path}:{n} {f[1]} {f[2]}",
+                                layer_features(f[2], f[1], shape, 1, loads), c))
+        elif line.startswith("PROF samples="):
+            prof = {"samples": int(kv["samples"]), "label": f"{path}:{n}",
+                    "plan": Plan(dict(kernel), exp_lut, bool(tune_hw & HW_DOT8))}
+        elif prof and line.startswith("PROF "):
+            st = line.split()[1]
+            if st in STAGES and prof["samples"]:
+                mode = "+".join(sorted(set(prof["plan"].kernel.values()) - {"cpu"})) or "cpu"
+                mode += "+lut" if prof["plan"].exp_lut else ""
+                obs.append(("stage", f"{prof['label']} {mode} {st}",
+                            stage_features(st, shape, prof["plan"]),
+                            int(kv["cycles"]) / prof["samples"]))
+            elif st == "total":
+                prof = None
+        elif line.startswith("GEMV BENCH "):
+            rows, cols = int(kv["out_dim"]), int(kv["len"])
+            words = rows * cols // 4
+            lanes = shape.gemv_lanes
+            for name, f in (
+                    ("load_x", {"pack": cols // 4, "csr_write": cols // 4}),
+                    ("load_w", {"pack": words, "csr_write": words,
+                                "line_fill": -(-rows * cols // shape.line_bytes)}),
+                    ("compute", {"gemv_cycle": rows * (cols // lanes + 1), "gemv_call": 1,
+                                 "csr_write": 1, "csr_read": 1}),
+                    ("read_y", {"csr_read": rows, "csr_write": rows}),
+                    ("sw", {"mac": rows * cols, "row": rows})):
+                if int(kv.get(name, 0)):
+                    obs.append(("bench", f"{path}:{n} gemv {rows}x{cols} {name}", f, int(kv[name])))
+        elif line.startswith("DOT8 BENCH ops="):
+            ops = int(kv["ops"])
+            if int(kv.get("mac_cycles", 0)):
+                obs.append(("bench", f"{path}:{n} dot8 mac", {"dot8_word": ops},
+                            int(kv["mac_cycles"])))
+        elif line.startswith("LUT BENCH lookups="):
+            k = int(kv["lookups"])
+            for name, f in (("hw", {"csr_write": k, "csr_read": k}),
+                            ("row", {"exp_lut": k}), ("sw", {"exp_sw": k})):
+                if int(kv.get(f"{name}_cycles", 0)):
+                    obs.append(("bench", f"{path}:{n} lut {name}", f, int(kv[f"{name}_cycles"])))
+    return obs
+
+
+def median_of(obs):
+    """One observation per measurement repeated in the logs (the same layer,
+    stage or bench under the same backends), at its median run, so that an
+    interrupted or cold-cache run (or a host's clock boost) does not skew
+    the fit."""
+    runs = {}
+    for o in obs:
+        runs.setdefault((o[0], o[1].split(" ", 1)[1]), []).append(o)
+    return [sorted(r, key=lambda o: o[3])[len(r) // 2] for r in runs.values()]
+
+
+def solve(a, b):
+    """Gaussian elimination with partial pivoting for a small dense system."""
+    n = len(b)
+    m = [row[:] + [b[i]] for i, row in enumerate(a)]
+    for c in range(n):
+        piv = max(range(c, n), key=lambda r: abs(m[r][c]))
+        m[c], m[piv] = m[piv], m[c]
+        if abs(m[c][c]) < 1e-12:
+            continue
+        for r in range(n):
+            if r != c and m[r][c]:
+                k = m[r][c] / m[c][c]
+                for j in range(c, n + 1):
+                    m[r][j] -= k * m[c][j]
+    return [m[i][n] / m[i][i] if abs(m[i][i]) >= 1e-12 else 0.0 for i in range(n)]
+
+
+def calibrate(obs, ridge=1e-3, prior=None, micro=0.1):
+    """Costs minimizing sum(wt * ((pred - meas) / meas)^2) + ridge * sum((s - 1)^2)
+    over the scale s of each prior cost; costs no observation uses keep their
+    prior, and none goes negative. wt is 1 for the PROF stages, which are
+    what the model predicts, and micro for the matvec / bench lines, which
+    time kernels out of context (other cache state, timer overhead) and
+    mainly split a stage's cycles between its operations."""
+    prior = dict(prior or DEFAULT_COSTS)
+    keys = sorted({k for _, _, f, _ in obs for k in f})
+    free = list(keys)
+    scale = {k: 1.0 for k in keys}
+    while free:
+        idx = {k: i for i, k in enumerate(free)}
+        n = len(free)
+        ata = [[0.0] * n for _ in range(n)]
+        atb = [0.0] * n
+        for kind, _, f, meas in obs:
+            wt = 1.0 if kind == "stage" else micro
+            row = [0.0] * n
+            rhs = 1.0
+            for k, c in f.items():
+                v = prior[k] * c / meas
+                if k in idx:
+                    row[idx[k]] += v
+                else:
+                    rhs -= v * scale[k]
+            for i in range(n):
+                if row[i]:
+                    atb[i] += wt * row[i] * rhs
+                    for j in range(n):
+                        ata[i][j] += wt * row[i] * row[j]
+        for i in range(n):
+            ata[i][i] += ridge
+            atb[i] += ridge
+        s = solve(ata, atb)
+        neg = [k for k in free if s[idx[k]] < 0]
+        for k in free:
+            scale[k] = max(s[idx[k]], 0.0)
+        if not neg:
+            break
+        free = [k for k in free if k not in neg]
+    costs = dict(prior)
+    for k in keys:
+        costs[k] = prior[k] * scale[k]
+    return costs
+
+
+def rel_err(costs, f, meas):
+    return (apply(costs, f) - meas) / meas
+
+
+# --- Command line ----------------------------------------------------------
+
+def parse_shape(text):
+    shape = Shape()
+    if not text:
+        return shape
+    names = {f.name: f.type for f in fields(Shape)}
+    changes = {}
+    for item in text.split(","):
+        k, _, v = item.partition("=")
+        k = k.strip()
+        if k not in names:
+            raise SystemExit(f"--shape: unknown field {k} ({', '.join(names)})")
+        changes[k] = v.strip() in ("1", "true", "yes") if names[k] in (bool, "bool") else int(v)
+    if "D" in changes and "d_in" not in changes:
+        changes["d_in"] = min(shape.d_in, changes["D"])
+    shape = replace(shape, **changes)
+    if shape.D % (4 * shape.heads) != 0:
+        raise SystemExit(f"--shape: D={shape.D} must be a multiple of 4 x heads")
+    return shape
+
+
+def parse_layers(items):
+    out = {}
+    for item in items or []:
+        for part in item.split(","):
+            l, _, k = part.partition("=")
+            out[l.strip()] = k.strip()
+    return out
+
+
+def cmd_predict(args):
+    shape = parse_shape(args.shape)
+    costs = load_costs(args.calib)
+    mhz = args.cpu_mhz
+    print(f"COST shape S={shape.S} D={shape.D} FFN={shape.FFN} d_in={shape.d_in} "
+          f"heads={shape.heads} bits={shape.bits} costs={args.calib or 'default'}")
+    for backends in args.backend.split(","):
+        p = plan(backends, shape, parse_layers(args.layer), costs)
+        cyc = predict(shape, p, costs)
+        total = sum(cyc.values())
+        kern = " ".join(f"{l}={p.kernel[l]}" for l in LAYERS)
+        print(f"COST backend={backends} {kern} exp={'lut' if p.exp_lut else 'sw'}")
+        for st in STAGES:
+            print(f"COST {backends} {st} cycles={cyc[st]:.0f} share={100.0 * cyc[st] / total:.1f}%")
+        line = f"COST {backends} total cycles={total:.0f}"
+        if mhz > 0:
+            line += f" us={total / mhz:.1f} windows_per_s={mhz * 1e6 / total:.0f}"
+        print(line)
+    return 0
+
+
+def report(obs, costs, show):
+    errs = []
+    for kind, label, f, meas in obs:
+        e = rel_err(costs, f, meas)
+        if kind == "stage":
+            errs.append(abs(e))
+        if show:
+            print(f"COST {kind} {label} measured={meas:.0f} predicted={apply(costs, f):.0f} "
+                  f"err={100.0 * e:+.1f}%")
+    return errs
+
+
+def cmd_calibrate(args):
+    shape = parse_shape(args.shape)
+    obs = median_of([o for path in args.logs for o in parse_log(path, shape)])
+    if not obs:
+        raise SystemExit("no PROF / TUNE / BENCH lines in the logs")
+    costs = calibrate(obs, args.ridge, load_costs(args.prior), args.micro_weight)
+    errs = report(obs, costs, True)
+    for k in sorted(costs):
+        print(f"COST cost {k}={costs[k]:.3f} prior={DEFAULT_COSTS[k]:.3f}")
+    rms = math.sqrt(sum(e * e for e in errs) / len(errs)) if errs else 0.0
+    print(f"COST CALIBRATED observations={len(obs)} stages={len(errs)} "
+          f"stage_rms_err={100.0 * rms:.1f}%")
+    if args.out:
+        with open(args.out, "w") as fh:
+            json.dump({"costs": costs, "shape": shape.__dict__, "logs": args.logs,
+                       "observations": len(obs), "stage_rms_err": rms}, fh, indent=2,
+                      sort_keys=True)
+            fh.write("\n")
+    return 0
+
+
+def cmd_check(args):
+    shape = parse_shape(args.shape)
+    costs = load_costs(args.calib)
+    obs = median_of([o for path in args.logs for o in parse_log(path, shape) if o[0] == "stage"])
+    if not obs:
+        raise SystemExit("no PROF stage lines in the logs")
+    errs = report(obs, costs, True)
+    worst = max(errs)
+    rms = math.sqrt(sum(e * e for e in errs) / len(errs))
+    ok = worst * 100.0 <= args.tolerance
+    print(f"COST CHECK {'OK' if ok else 'FAIL'} stages={len(errs)} max_err={100.0 * worst:.1f}% "
+          f"rms_err={100.0 * rms:.1f}% tolerance={args.tolerance:g}%")
+    return 0 if ok else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cycle-cost model of tinyformer.c backends.")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    shape_help = ("Comma-separated Shape fields, e.g. D=48,FFN=96,bits=4 "
+                  "(S D FFN d_in heads bits classes fast_softmax line_bytes dcache_bytes gemv_lanes)")
+
+    p = sub.add_parser("predict", help="Per-stage cycles of one window.")
+    p.add_argument("--shape", help=shape_help)
+    p.add_argument("--backend", default="cpu,dot8,dot8+lut,dot8+gemv+lut",
+                   help="Comma-separated backend sets (cpu, dot8, gemv, lut joined by '+', or auto)")
+    p.add_argument("--layer", action="append", help="Layer kernel overrides, e.g. ff1=gemv,ff2=dot8")
+    p.add_argument("--calib", help="Costs from calibrate --out (default: the priors)")
+    p.add_argument("--cpu-mhz", type=float, default=100.0, help="Clock for us / windows per s (0: off)")
+    p.set_defaults(fn=cmd_predict)
+
+    p = sub.add_parser("calibrate", help="Fit the costs to PROF / TUNE / BENCH logs.")
+    p.add_argument("logs", nargs="+", help="UART captures")
+    p.add_argument("--shape", help=shape_help)
+    p.add_argument("--prior", help="Start from these costs instead of the defaults")
+    p.add_argument("--ridge", type=float, default=1e-3, help="Pull of each cost towards its prior")
+    p.add_argument("--micro-weight", type=float, default=0.1,
+                   help="Weight of the TUNE / BENCH lines against the PROF stages")
+    p.add_argument("--out", help="Write the costs as JSON")
+    p.set_defaults(fn=cmd_calibrate)
+
+    p = sub.add_parser("check", help="Compare the per-stage predictions with PROF logs.")
+    p.add_argument("logs", nargs="+", help="UART captures")
+    p.add_argument("--shape", help=shape_help)
+    p.add_argument("--calib", help="Costs from calibrate --out (default: the priors)")
+    p.add_argument("--tolerance", type=float, default=20.0, help="Max per-stage error in percent")
+    p.set_defaults(fn=cmd_check)
+
+    args = parser.parse_args()
+    try:
+        sys.exit(args.fn(args))
+    except ValueError as e:
+        parser.error(str(e))
+
+
+if __name__ == "__main__":
+    main()
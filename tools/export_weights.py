@@ -6,7 +6,16 @@ Hyperparameters (fixed by C):
   S   = 16
   D   = 32
   FFN = 64
-  H   = 1 (single head, d_head = D)
+  H   = checkpoint "heads" (default 1; d_head = D / H, TINYFORMER_HEADS)
+  checkpoint "linear_attn" (default 0): trained with linear attention; the
+  header then defines TRAINED_WEIGHTS_LINEAR_ATTN (TINYFORMER_LINEAR_ATTN)
+  checkpoint "token_pool" (default 1, train_tinyformer_uci_har.py --token-pool):
+  the layer's stride in a pooled stack; not exported, the firmware passes the
+  strides of its layers to tinyformer_stack_encode_pooled()
+  checkpoint "tokens" (default S): tokens of a model tier (--distill students);
+  D and FFN then come from W_o and b_ff1. A tier other than S/D/FFN is
+  written with --blob only, for the TINYFORMER_TIERS instances of
+  litex_port/common/model_tiers.h
 
 Expected PyTorch checkpoint (state_dict or {"state_dict": ...}) keys:
   W_q   [D, D]
@@ -25,11 +34,168 @@ and written as:
   litex_port/trained_weights.h
   litex_port/trained_weights.c
 
+Each weight matrix is also emitted as a word-packed copy (<name>_packed,
+uint32_t [rows][cols / 4], 4 int8 lanes per word in dot8_pack() order: lane 0
+in the LSB). The packed copies are compiled only when TINYFORMER_PACKED_WEIGHTS
+is enabled (default for DOT8 builds, see tinyformer.h).
+
+For the fused QKV projection (TINYFORMER_FUSED_QKV) the exporter also emits
+W_qkv [3*D, D] = concat(W_q, W_k, W_v) along rows and b_qkv [3*D], plus a
+packed W_qkv_packed when TINYFORMER_PACKED_WEIGHTS is enabled.
+
+With --per-channel, each weight matrix is instead quantized with one scale per
+output channel (row), scale_c = 127 / max|W[c, :]|, and requantization
+parameters are emitted for TINYFORMER_PER_CHANNEL_REQUANT (compiled only when
+that option is enabled; the header defines TRAINED_WEIGHTS_PER_CHANNEL):
+
+  rq_bias_<l>  int32_t [rows]  round(b[c] * scale_c * ACT_SCALE)
+  rq_mul_<l>   int32_t [rows]  \  mul / 2^shift ~= 1 / scale_c, so activations
+  rq_shift_<l> uint8_t [rows]  /  stay at ACT_SCALE between layers
+
+for l in q, k, v, o, ff1, ff2 (and qkv with the fused block).
+
+With --int4, every matrix is additionally quantized per channel to int4
+(scale_c = 7 / max|W[c, :]|) for TINYFORMER_INT4_WEIGHTS (compiled only when that
+option is enabled; the header defines TRAINED_WEIGHTS_INT4):
+
+  <name>_int4  uint32_t [rows][cols / 8]  byte k of word j = W[8j+k] (low nibble)
+                                          | W[8j+k+4] << 4 (high nibble)
+  rq4_bias_<l>, rq4_mul_<l>, rq4_shift_<l>  requant for the int4 scales
+
+With --dead-inputs NPZ (data/uci_har_processed/uci_har_processed.npz), input
+channels that are zero in every X_train / X_test window (14..31, the padding
+of preprocess_uci_har.py) are pruned: their W_q / W_k / W_v columns are zeroed
+before quantization, exact for every output format since those inputs are
+always zero, and the removed projection MACs are reported. When the dead
+channels end the feature vector, trained_weights.c also stores W_q / W_k / W_v
+(and W_qkv) narrowed to their first TRAINED_WEIGHTS_D_IN columns, the live
+channels rounded up to a DOT8 word (8 channels with --int4), which the encoder
+reads as tinyformer_weights_t.d_in. The flash image and the blob keep D
+columns.
+
+With --block-sparse, every matrix is also emitted as a block-sparse table for
+TINYFORMER_BLOCK_SPARSE (compiled only when that option is enabled; the header
+defines TRAINED_WEIGHTS_BLOCK_SPARSE). Row r keeps only its non-zero 4-wide
+blocks, entries sp_row_<l>[r] .. sp_row_<l>[r + 1] - 1 of
+
+  sp_row_<l>   uint16_t [rows + 1]  first entry of each row
+  sp_block_<l> uint8_t  [nnz]       input block: channels 4 * block .. + 3
+  sp_w_<l>     uint32_t [nnz]       the block, dot8_pack() lane order
+
+for l in q, k, v, o, ff1, ff2 (and qkv with the fused block).
+
+With --low-rank R, every int8 matrix (narrowed with --dead-inputs, and the
+fused W_qkv) is also emitted as rank-R factors for TINYFORMER_LOW_RANK
+(compiled only when that option is enabled; the header defines
+TRAINED_WEIGHTS_LOW_RANK R and TRAINED_WEIGHTS_LR_SHIFT_<l>). From the SVD
+W = P diag(s) Q^T, split as sqrt(s) on either side:
+
+  lr_u_<l>  int8_t [rows][R]  P sqrt(s), scaled to a max of 127
+  lr_v_<l>  int8_t [R][cols]  sqrt(s) Q^T over that scale, << lr_shift
+
+(and their _packed copies), lr_shift being the largest shift that keeps lr_v
+in int8, so W ~= lr_u lr_v / 2^lr_shift. The encoder runs
+t = sat8((lr_v x) >> lr_shift) into an R-channel int8 bottleneck, then
+lr_u t + b with the layer's requant: R * (rows + cols) MACs instead of
+rows * cols. R is a multiple of 4 that saves MACs on every matrix; the
+reconstruction error and the MACs are reported, and
+tools/tinyformer_sim.py --low-rank --data ... measures the accuracy against
+the full-rank run. The flash image and the blob keep the full matrices.
+
+With --fwa, the query and key projections are also folded into one bilinear
+form for fused-weight attention (TINYFORMER_FWA, compiled only when that option
+is enabled; the header defines TRAINED_WEIGHTS_FWA and
+TRAINED_WEIGHTS_QK_SHIFT). Over the Q/K input columns (TRAINED_WEIGHTS_D_IN
+when narrowed), with the int8 W_q, W_k, b_q:
+
+  W_qk  int8_t  [d_in][d_in]  round(W_k^T W_q / 2^(14 - qk_shift))
+  b_qk  int32_t [d_in]        round(W_k^T b_q / 2^(14 - qk_shift))
+
+(and W_qk_packed), qk_shift being the largest shift <= 14 that keeps W_qk in
+int8. The encoder scores g_i . x_j with g_i = (W_qk x_i + b_qk) >> qk_shift,
+which is q_i . k_j of the two >> 7 projections up to terms that are constant
+per query, so the K projection is skipped.
+
+With --gemv-native, the layouts the GEMV block loads as they are are also
+emitted for TINYFORMER_GEMV_NATIVE (compiled only when that option is
+enabled; the header defines TRAINED_WEIGHTS_GEMV_NATIVE), so the firmware
+converts no weight at run time:
+
+  gemv_b_<l>  int32_t  [rows]  the int8 bias sign-extended, as B_IN takes it
+                               (the accumulator domain of W x)
+  gemv_w_<l>  uint32_t []      W pre-tiled for gemv_matvec_tiles(): row tiles
+                               of up to 64 rows, column tiles of up to 64
+                               zero-padded to 32 or 64, dot8_pack() words
+
+for l in q, k, v, o, ff1, ff2 (and qkv with the fused block); gemv_w_<l> only
+for the matrices the block does not take whole (d_in not 32 / 64, i.e. the
+Q/K/V matrices narrowed with --dead-inputs, and W_qk with --fwa). The others
+stream their <name>_packed copies, already in the block's row-major W_IN4
+order.
+
+With --ff2-cols, W_ff2 is also emitted transposed for the ReLU-sparse FFN
+(TINYFORMER_FFN_GATHER, compiled only when that option is enabled; the
+header defines TRAINED_WEIGHTS_FF2_COLS):
+
+  W_ff2_cols  int8_t  [FFN][D]  row k = column k of W_ff2, the weights of
+                                hidden unit k
+
+so the encoder adds only the columns of the units the ReLU left non-zero.
+
+With --shared-layers CKPT1,CKPT2,... (the state_dict_l<l>.pt of a
+train_tinyformer_uci_har.py --share-layers run), --checkpoint is layer 0 of
+a stack whose later layers share its matrices, which must be equal in every
+checkpoint. The matrices are written once; for TINYFORMER_SHARED_LAYERS
+(compiled only when that option is enabled; the header defines
+TRAINED_WEIGHTS_SHARED_LAYERS N, the layer count) the biases where layer k
+differs from layer 0 are written as
+
+  b_<l>_l<k>  int8_t [rows]  (b_qkv_l<k> with the fused block, b_qk_l<k> with --fwa)
+
+and collected in shared_layer_bias[N], one tinyformer_layer_bias_t per layer
+(layer 0 all null): tinyformer_share_layers(layers, N,
+&tinyformer_default_weights, shared_layer_bias). int8 biases only (not with
+--per-channel or --int4).
+
+With --flash-image PATH, one layer image for the SPI-flash weight store
+(litex_port/common/weight_store.h) is also written: the six int8 matrices
+(W_q, W_k, W_v, W_o, W_ff1, W_ff2, row-major) then the six int8 biases, padded
+to a word. Concatenate the images of several checkpoints for a multi-layer
+stack and flash the result at TF_STORE_FLASH_OFFSET. Add --compress to write
+the layer image entropy-coded instead (tools/weight_codec.py, the smaller of
+plain and per-row delta Huffman); the firmware attaches such images with
+tf_store_init_compressed() and expands each layer row by row as it loads.
+Compressed layer images concatenate the same way.
+
+With --blob PATH, the whole model is also written as one binary model blob
+(litex_port/common/model_blob.h) that the firmware loads in place with
+tf_blob_load(), so a new model needs no rebuild: a header (magic "TFMB",
+version, S/D/FFN, class count, flags, size, CRC-32), a tensor directory
+(id, dtype, shape, offset, bytes, scale) and the tensors, each at a 16-byte
+aligned offset. The blob holds the int8 matrices (int4 words with --int4), the
+biases, the requant tensors with --per-channel / --int4 and, with
+--classifier NPZ (artifacts/classifier.npz of the training flow), the
+classifier and early-exit heads quantized as in
+training/export_and_make_fpga_demo.py.
+
 Usage (from repo root TinyML_algo/):
   python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --output-dir litex_port
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --output-dir litex_port --per-channel
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --output-dir litex_port --int4
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --output-dir litex_port \
+      --dead-inputs data/uci_har_processed/uci_har_processed.npz --block-sparse
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --output-dir litex_port --fwa
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --output-dir litex_port --low-rank 8
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --output-dir litex_port --gemv-native
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --flash-image layer0.bin
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --flash-image layer0.tfwz --compress
+  python3 tools/export_weights.py --checkpoint path/to/state_dict.pt --blob model.blob --classifier artifacts/classifier.npz
 """
 
 import argparse
+import math
+import struct
+import zlib
 from pathlib import Path
 
 import torch
@@ -38,6 +204,10 @@ S = 16
 D = 32
 FFN = 64
 
+# int8 activation scale (x_int8 = round(x * ACT_SCALE)), as used for the demo
+# inputs in training/export_and_make_fpga_demo.py.
+ACT_SCALE = 32.0
+
 
 def quantize_to_int8(t: torch.Tensor) -> torch.Tensor:
     """Quantize to int8 with symmetric clipping to [-127, 127]."""
@@ -46,6 +216,48 @@ def quantize_to_int8(t: torch.Tensor) -> torch.Tensor:
     return t.to(torch.int8)
 
 
+def requant_mul_shift(m: float):
+    """Express a positive real multiplier as mul / 2^shift with mul in [2^14, 2^15)."""
+    if m <= 0.0:
+        return 0, 1
+    frac, exp = math.frexp(m)  # m = frac * 2^exp, frac in [0.5, 1)
+    mul = int(round(frac * (1 << 15)))
+    shift = 15 - exp
+    if mul == (1 << 15):
+        mul //= 2
+        shift -= 1
+    if shift < 1:
+        raise ValueError(f"requant multiplier {m} too large")
+    if shift > 62:
+        return 0, 1
+    return mul, shift
+
+
+def quantize_per_channel(W: torch.Tensor, b: torch.Tensor, qmax: int = 127):
+    """
+    Quantize W [rows, cols] to [-qmax, qmax] with one scale per row and fold the
+    bias into the accumulator domain. Returns (W_int8, (bias, mul, shift)) with
+    Python lists; qmax=7 gives int4 values (stored in an int8 tensor).
+    """
+    W = W.to(torch.float32)
+    b = b.to(torch.float32).view(-1)
+    max_abs = W.abs().amax(dim=1)
+    scale = torch.where(max_abs > 0, float(qmax) / max_abs, torch.ones_like(max_abs))
+    Wq = torch.clamp(torch.round(W * scale[:, None]), -float(qmax), float(qmax)).to(torch.int8)
+    bias, mul, shift = [], [], []
+    for bc, sc in zip(b.tolist(), scale.tolist()):
+        bias.append(max(-(1 << 31), min((1 << 31) - 1, int(round(bc * sc * ACT_SCALE)))))
+        m, sh = requant_mul_shift(1.0 / sc)
+        mul.append(m)
+        shift.append(sh)
+    return Wq, (bias, mul, shift)
+
+
+def ints_to_c_array(vals) -> str:
+    """Render a list of Python ints as a 1D C initializer."""
+    return "{ " + ", ".join(str(int(v)) for v in vals) + " }"
+
+
 def ensure_shape(name: str, tensor: torch.Tensor, expected_shapes):
     """Check tensor has one of the expected shapes."""
     shape = tuple(tensor.shape)
@@ -88,17 +300,411 @@ def tensor_to_c_array(name: str, tensor: torch.Tensor, indent: str = "    ") ->
     raise ValueError(f"{name}: expected 1D or 2D tensor, got {tensor.dim()}D")
 
 
-def write_header(path: Path) -> None:
+def tensor_to_c_packed_array(name: str, tensor: torch.Tensor, indent: str = "    ") -> str:
+    """Render a 2D int8 tensor as uint32 words of 4 lanes (lane 0 = LSB)."""
+    if tensor.dtype != torch.int8:
+        raise ValueError(f"{name}: expected int8 tensor, got {tensor.dtype}")
+    if tensor.dim() != 2 or tensor.shape[1] % 4 != 0:
+        raise ValueError(f"{name}: expected 2D tensor with cols % 4 == 0, got {tuple(tensor.shape)}")
+
+    rows = []
+    for row in tensor:
+        vals = [int(v) & 0xFF for v in row.view(-1)]
+        words = []
+        for i in range(0, len(vals), 4):
+            w = vals[i] | (vals[i + 1] << 8) | (vals[i + 2] << 16) | (vals[i + 3] << 24)
+            words.append(f"0x{w:08X}u")
+        rows.append(f"{indent}{{ {', '.join(words)} }}")
+    return "{\n" + ",\n".join(rows) + "\n}"
+
+
+def tensor_to_c_int4_array(name: str, tensor: torch.Tensor, indent: str = "    ") -> str:
+    """
+    Render a 2D int8 tensor of int4 values as uint32 words of 8 nibbles: byte k
+    of word j holds col 8j+k in the low nibble and col 8j+k+4 in the high one.
+    """
+    if tensor.dtype != torch.int8:
+        raise ValueError(f"{name}: expected int8 tensor, got {tensor.dtype}")
+    if tensor.dim() != 2 or tensor.shape[1] % 8 != 0:
+        raise ValueError(f"{name}: expected 2D tensor with cols % 8 == 0, got {tuple(tensor.shape)}")
+
+    rows = []
+    for row in tensor:
+        vals = [int(v) for v in row.view(-1)]
+        if any(v < -8 or v > 7 for v in vals):
+            raise ValueError(f"{name}: value out of int4 range")
+        words = []
+        for i in range(0, len(vals), 8):
+            w = 0
+            for k in range(4):
+                byte = (vals[i + k] & 0xF) | ((vals[i + k + 4] & 0xF) << 4)
+                w |= byte << (8 * k)
+            words.append(f"0x{w:08X}u")
+        rows.append(f"{indent}{{ {', '.join(words)} }}")
+    return "{\n" + ",\n".join(rows) + "\n}"
+
+
+# (name, rows macro, cols macro) for every weight matrix.
+MATRICES = (
+    ("W_q", "TINYFORMER_D", "TINYFORMER_D"),
+    ("W_k", "TINYFORMER_D", "TINYFORMER_D"),
+    ("W_v", "TINYFORMER_D", "TINYFORMER_D"),
+    ("W_o", "TINYFORMER_D", "TINYFORMER_D"),
+    ("W_ff1", "TINYFORMER_FFN", "TINYFORMER_D"),
+    ("W_ff2", "TINYFORMER_D", "TINYFORMER_FFN"),
+)
+
+def gemv_whole(rows: int, cols: int) -> bool:
+    """True if the GEMV block takes a rows x cols matrix in runs of 32 / 64 rows."""
+    return cols in (32, 64) and rows % 32 == 0
+
+
+def gemv_tile_words(tensor: torch.Tensor):
+    """
+    W_IN4 words of a 2D int8 tensor in gemv_matvec_tiles() order: row tiles of
+    up to 64 rows, column tiles of up to 64 inside each, every tile row padded
+    with zero columns to 32 or 64 (the order the driver's tiled loads write).
+    """
+    rows, cols = tensor.shape
+    if cols % 4 != 0:
+        raise ValueError(f"expected cols % 4 == 0, got {tuple(tensor.shape)}")
+    vals = [[int(v) & 0xFF for v in row.view(-1)] for row in tensor]
+    words = []
+    for r0 in range(0, rows, 64):
+        for c0 in range(0, cols, 64):
+            n = min(64, cols - c0)
+            hw_len = 32 if n <= 32 else 64
+            for row in vals[r0:r0 + 64]:
+                lanes = row[c0:c0 + n] + [0] * (hw_len - n)
+                for i in range(0, hw_len, 4):
+                    words.append(lanes[i] | (lanes[i + 1] << 8) | (lanes[i + 2] << 16) | (lanes[i + 3] << 24))
+    return words
+
+
+def write_gemv_arrays(f, l: str, rows: str, W: torch.Tensor, b: torch.Tensor) -> None:
+    """The int32 bias of one layer and, if the block does not take W whole, its tiles."""
+    ints = ints_to_c_array(int(v) for v in b.view(-1))
+    f.write(f"const int32_t gemv_b_{l}[{rows}] TINYFORMER_WEIGHTS(VEC, {l}) = {ints};\n")
+    if not gemv_whole(*W.shape):
+        words = ", ".join(f"0x{w:08X}u" for w in gemv_tile_words(W))
+        f.write(f"const uint32_t gemv_w_{l}[] TINYFORMER_WEIGHTS(PACKED, {l}) = {{ {words} }};\n")
+    f.write("\n")
+
+
+# Input columns of the narrowed Q/K/V matrices (see narrow_inputs).
+D_IN_MACRO = "TRAINED_WEIGHTS_D_IN"
+
+
+def c_matrices(d_in=None):
+    """MATRICES with the Q/K/V columns at D_IN_MACRO when they are narrowed."""
+    if d_in is None:
+        return MATRICES
+    return tuple((name, rows, D_IN_MACRO if name in ("W_q", "W_k", "W_v") else cols)
+                 for name, rows, cols in MATRICES)
+
+
+def narrow_width(dead, align: int):
+    """
+    Q/K/V input columns to keep when the dead channels include a trailing run:
+    the first dead channel of the run rounded up to align, or None if that
+    leaves all D columns.
+    """
+    c0 = D
+    while c0 > 0 and (c0 - 1) in dead:
+        c0 -= 1
+    d_in = -(-c0 // align) * align
+    return d_in if d_in < D else None
+
+
+def narrow_inputs(weights: dict, d_in):
+    """weights with W_q/W_k/W_v cut to their first d_in columns (the rest are zero)."""
+    if d_in is None:
+        return weights
+    out = dict(weights)
+    for name in ("W_q", "W_k", "W_v"):
+        if weights[name][:, d_in:].abs().max() != 0:
+            raise ValueError(f"{name}: non-zero weights past input channel {d_in}")
+        out[name] = weights[name][:, :d_in].contiguous()
+    return out
+
+
+# Requant layer suffix for each weight matrix (rq_bias_<l>, ...).
+RQ_LAYERS = (
+    ("q", "W_q", "TINYFORMER_D"),
+    ("k", "W_k", "TINYFORMER_D"),
+    ("v", "W_v", "TINYFORMER_D"),
+    ("o", "W_o", "TINYFORMER_D"),
+    ("ff1", "W_ff1", "TINYFORMER_FFN"),
+    ("ff2", "W_ff2", "TINYFORMER_D"),
+)
+
+
+def fuse_requant(requant: dict):
+    """Concatenate the Q/K/V requant lists for the fused projection."""
+    return tuple(requant["q"][i] + requant["k"][i] + requant["v"][i] for i in range(3))
+
+
+def fuse_qkv(weights: dict):
+    """Concatenate Q/K/V weights and biases row-wise for the fused projection."""
+    W_qkv = torch.cat([weights["W_q"], weights["W_k"], weights["W_v"]], dim=0)
+    b_qkv = torch.cat([weights["b_q"], weights["b_k"], weights["b_v"]], dim=0)
+    return W_qkv, b_qkv
+
+
+# q . k of two >> 7 projections is at 2^-14 of W_k^T W_q.
+QK_FULL_SHIFT = 14
+
+
+def fuse_qk(weights: dict):
+    """
+    Fused-weight attention (TINYFORMER_FWA): W_qk = W_k^T W_q and
+    b_qk = W_k^T b_q of the int8 (possibly narrowed) weights, divided by
+    2^(14 - shift) with round half up for the largest shift that keeps W_qk in
+    [-127, 127]. Returns (W_qk int8 [d_in][d_in], b_qk ints [d_in], shift).
+    """
+    W_q = weights["W_q"].to(torch.int64)
+    W_k = weights["W_k"].to(torch.int64)
+    P = W_k.t() @ W_q
+    c = W_k.t() @ weights["b_q"].to(torch.int64)
+    peak = int(P.abs().max())
+    shift = QK_FULL_SHIFT
+    while shift > 0 and (peak + (1 << (QK_FULL_SHIFT - shift) >> 1)) >> (QK_FULL_SHIFT - shift) > 127:
+        shift -= 1
+    drop = QK_FULL_SHIFT - shift
+    half = (1 << drop) >> 1
+    W_qk = torch.clamp((P + half) >> drop, -127, 127).to(torch.int8)
+    b_qk = [int(v) for v in (c + half) >> drop]
+    return W_qk, b_qk, shift
+
+
+def dead_input_channels(path: Path):
+    """Input channels that are zero in every X_train / X_test window of an npz."""
+    import numpy as np
+
+    data = np.load(path)
+    live = None
+    for split in ("X_train", "X_test"):
+        if split not in data:
+            continue
+        x = data[split]
+        nz = (x.reshape(-1, x.shape[-1]) != 0).any(axis=0)
+        live = nz if live is None else (live | nz)
+    if live is None:
+        raise KeyError(f"{path}: no X_train / X_test")
+    if live.shape[0] != D:
+        raise ValueError(f"{path}: {live.shape[0]} input channels, expected {D}")
+    return [c for c in range(D) if not live[c]]
+
+
+def sparse_blocks(tensor: torch.Tensor):
+    """
+    Block-sparse rows of a 2D int8 tensor: (row_start, block, words) with the
+    non-zero 4-wide blocks of each row as dot8_pack() words.
+    """
+    rows = tensor.tolist()
+    if not rows or len(rows[0]) % 4 != 0:
+        raise ValueError(f"sparse_blocks: expected cols % 4 == 0, got {len(rows[0]) if rows else 0}")
+    row_start, block, words = [0], [], []
+    for row in rows:
+        for j in range(0, len(row), 4):
+            lanes = [int(v) & 0xFF for v in row[j:j + 4]]
+            if any(lanes):
+                block.append(j // 4)
+                words.append(lanes[0] | (lanes[1] << 8) | (lanes[2] << 16) | (lanes[3] << 24))
+        row_start.append(len(block))
+    if len(block) > 0xFFFF:
+        raise ValueError("sparse_blocks: more than 65535 blocks")
+    return row_start, block, words
+
+
+def low_rank_factors(W: torch.Tensor, rank: int):
+    """
+    Rank-r factors of a 2D int8 tensor W [rows, cols]: (U [rows, r], V [r, cols],
+    shift, err), both int8 with W ~= U V / 2^shift (see --low-rank), err the
+    relative Frobenius error of that reconstruction.
+    """
+    Wf = W.double()
+    P, s, Qh = torch.linalg.svd(Wf, full_matrices=False)
+    root = s[:rank].sqrt()
+    A = P[:, :rank] * root
+    B = root[:, None] * Qh[:rank]
+    scale = 127.0 / max(float(A.abs().max()), 1e-12)
+    U = torch.round(A * scale).clamp(-127, 127)
+    B = B / scale
+    shift = min(max(int(math.floor(math.log2(127.0 / max(float(B.abs().max()), 1e-12)))), 0), 24)
+    V = torch.round(B * (1 << shift)).clamp(-127, 127)
+    err = float((Wf - U @ V / (1 << shift)).norm()) / max(float(Wf.norm()), 1e-12)
+    return U.to(torch.int8), V.to(torch.int8), shift, err
+
+
+def low_rank_matrices(weights: dict, d_in, rank: int) -> dict:
+    """
+    Layer key -> low_rank_factors() of every matrix of write_source (Q/K/V
+    narrowed to d_in, and the fused W_qkv).
+    """
+    weights = narrow_inputs(weights, d_in)
+    mats = {name: weights[name] for name, _, _ in MATRICES}
+    mats["W_qkv"] = fuse_qkv(weights)[0]
+    lowrank = {}
+    for name, W in mats.items():
+        rows, cols = W.shape
+        if rank * (rows + cols) >= rows * cols:
+            raise ValueError(f"--low-rank {rank}: no MACs saved on {name} [{rows}, {cols}]")
+        lowrank[layer_of(name)] = low_rank_factors(W, rank)
+    return lowrank
+
+
+def write_lowrank_externs(f, mats, qkv_cols: str) -> None:
+    for name, rows, cols in mats + (("W_qkv", "3 * TINYFORMER_D", qkv_cols),):
+        l = layer_of(name)
+        if l == "qkv":
+            f.write("#if TINYFORMER_FUSED_QKV\n")
+        f.write(
+            f"extern const int8_t lr_v_{l}[TRAINED_WEIGHTS_LOW_RANK][{cols}];\n"
+            f"extern const int8_t lr_u_{l}[{rows}][TRAINED_WEIGHTS_LOW_RANK];\n"
+            f"#if TINYFORMER_PACKED_WEIGHTS\n"
+            f"extern const uint32_t lr_v_{l}_packed[TRAINED_WEIGHTS_LOW_RANK][{cols} / 4];\n"
+            f"extern const uint32_t lr_u_{l}_packed[{rows}][TRAINED_WEIGHTS_LOW_RANK / 4];\n"
+            f"#endif\n"
+        )
+        if l == "qkv":
+            f.write("#endif\n")
+
+
+def write_lowrank_arrays(f, l: str, rows: str, cols: str, factors) -> None:
+    U, V, _, _ = factors
+    f.write(f"const int8_t lr_v_{l}[TRAINED_WEIGHTS_LOW_RANK][{cols}] TINYFORMER_WEIGHTS(I8, {l}) = ")
+    f.write(tensor_to_c_array(f"lr_v_{l}", V) + ";\n\n")
+    f.write(f"const int8_t lr_u_{l}[{rows}][TRAINED_WEIGHTS_LOW_RANK] TINYFORMER_WEIGHTS(I8, {l}) = ")
+    f.write(tensor_to_c_array(f"lr_u_{l}", U) + ";\n\n")
+    f.write("#if TINYFORMER_PACKED_WEIGHTS\n\n")
+    f.write(f"const uint32_t lr_v_{l}_packed[TRAINED_WEIGHTS_LOW_RANK][{cols} / 4] "
+            f"TINYFORMER_WEIGHTS(PACKED, {l}) = ")
+    f.write(tensor_to_c_packed_array(f"lr_v_{l}", V) + ";\n\n")
+    f.write(f"const uint32_t lr_u_{l}_packed[{rows}][TRAINED_WEIGHTS_LOW_RANK / 4] "
+            f"TINYFORMER_WEIGHTS(PACKED, {l}) = ")
+    f.write(tensor_to_c_packed_array(f"lr_u_{l}", U) + ";\n\n")
+    f.write("#endif // TINYFORMER_PACKED_WEIGHTS\n\n")
+
+
+def layer_of(name: str) -> str:
+    """Layer key of a weight array for TINYFORMER_WEIGHTS: W_ff1 / b_ff1 -> ff1."""
+    return name.split("_", 1)[1]
+
+
+def write_rq_externs(f, prefix: str = "rq") -> None:
+    for l, _, rows in RQ_LAYERS + (("qkv", None, "3 * TINYFORMER_D"),):
+        if l == "qkv":
+            f.write("#if TINYFORMER_FUSED_QKV\n")
+        f.write(
+            f"extern const int32_t {prefix}_bias_{l}[{rows}];\n"
+            f"extern const int32_t {prefix}_mul_{l}[{rows}];\n"
+            f"extern const uint8_t {prefix}_shift_{l}[{rows}];\n"
+        )
+        if l == "qkv":
+            f.write("#endif\n")
+
+
+def write_rq_arrays(f, l: str, rows: str, rq, prefix: str = "rq") -> None:
+    kind = "RQ4" if prefix == "rq4" else "RQ"
+    bias, mul, shift = rq
+    f.write(f"const int32_t {prefix}_bias_{l}[{rows}] TINYFORMER_WEIGHTS({kind}, {l}) = {ints_to_c_array(bias)};\n")
+    f.write(f"const int32_t {prefix}_mul_{l}[{rows}] TINYFORMER_WEIGHTS({kind}, {l}) = {ints_to_c_array(mul)};\n")
+    f.write(f"const uint8_t {prefix}_shift_{l}[{rows}] TINYFORMER_WEIGHTS({kind}, {l}) = {ints_to_c_array(shift)};\n\n")
+
+
+def write_sparse_externs(f) -> None:
+    for name, rows, _ in MATRICES + (("W_qkv", "3 * TINYFORMER_D", None),):
+        l = layer_of(name)
+        if l == "qkv":
+            f.write("#if TINYFORMER_FUSED_QKV\n")
+        f.write(
+            f"extern const uint16_t sp_row_{l}[{rows} + 1];\n"
+            f"extern const uint8_t sp_block_{l}[];\n"
+            f"extern const uint32_t sp_w_{l}[];\n"
+        )
+        if l == "qkv":
+            f.write("#endif\n")
+
+
+def write_sparse_arrays(f, l: str, rows: str, tensor: torch.Tensor) -> int:
+    """Write the block-sparse table of one matrix; returns its block count."""
+    row_start, block, words = sparse_blocks(tensor)
+    # An empty table still needs one (never read) entry to be valid C.
+    n = max(len(block), 1)
+    block = block or [0]
+    words = [f"0x{w:08X}u" for w in words] or ["0x00000000u"]
+    f.write(f"const uint16_t sp_row_{l}[{rows} + 1] TINYFORMER_WEIGHTS(SPARSE, {l}) = {ints_to_c_array(row_start)};\n")
+    f.write(f"const uint8_t sp_block_{l}[{n}] TINYFORMER_WEIGHTS(SPARSE, {l}) = {ints_to_c_array(block)};\n")
+    f.write(f"const uint32_t sp_w_{l}[{n}] TINYFORMER_WEIGHTS(SPARSE, {l}) = {{ {', '.join(words)} }};\n\n")
+    return row_start[-1]
+
+
+def write_header(path: Path, per_channel: bool = False, int4: bool = False, block_sparse: bool = False,
+                 d_in=None, fwa=None, attn_heads: int = 1, linear_attn: bool = False,
+                 lowrank: dict = None, shared_layers: int = 0, gemv_native: bool = False,
+                 ff2_cols: bool = False) -> None:
+    """
+    fwa, if given, is the qk_shift of the fused-weight attention arrays;
+    gemv_native adds the GEMV block layouts of --gemv-native, ff2_cols the
+    column-major W_ff2 of --ff2-cols;
+    lowrank, if given, the low_rank_matrices() of --low-rank;
+    shared_layers, if non-zero, the layer count of a --shared-layers stack;
+    attn_heads is the attention head count the weights were trained with and
+    linear_attn whether they were trained with linear attention.
+    """
     guard = "TRAINED_WEIGHTS_H"
+    mats = c_matrices(d_in)
+    qkv_cols = D_IN_MACRO if d_in is not None else "TINYFORMER_D"
     with path.open("w") as f:
         f.write(
             f"#ifndef {guard}\n"
             f"#define {guard}\n\n"
             f'#include "tinyformer.h"\n\n'
             f"// Trained TinyFormer encoder weights (generated by tools/export_weights.py)\n\n"
-            f"extern const int8_t W_q[TINYFORMER_D][TINYFORMER_D];\n"
-            f"extern const int8_t W_k[TINYFORMER_D][TINYFORMER_D];\n"
-            f"extern const int8_t W_v[TINYFORMER_D][TINYFORMER_D];\n"
+        )
+        if per_channel:
+            f.write(
+                "// Weights are quantized per output channel; see rq_* below.\n"
+                "#define TRAINED_WEIGHTS_PER_CHANNEL 1\n\n"
+            )
+        if int4:
+            f.write("// int4 copies are available (TINYFORMER_INT4_WEIGHTS).\n"
+                    "#define TRAINED_WEIGHTS_INT4 1\n\n")
+        if block_sparse:
+            f.write("// Block-sparse tables are available (TINYFORMER_BLOCK_SPARSE).\n"
+                    "#define TRAINED_WEIGHTS_BLOCK_SPARSE 1\n\n")
+        if d_in is not None:
+            f.write("// W_q/W_k/W_v keep their first input channels only; the others are dead.\n"
+                    f"#define {D_IN_MACRO} {d_in}\n\n")
+        if fwa is not None:
+            f.write("// Fused-weight attention arrays are available (TINYFORMER_FWA).\n"
+                    "#define TRAINED_WEIGHTS_FWA 1\n"
+                    f"#define TRAINED_WEIGHTS_QK_SHIFT {fwa}\n\n")
+        if lowrank is not None:
+            f.write("// Low-rank factors are available (TINYFORMER_LOW_RANK).\n"
+                    f"#define TRAINED_WEIGHTS_LOW_RANK {lowrank['q'][0].shape[1]}\n")
+            for l, (_, _, shift, _) in lowrank.items():
+                f.write(f"#define TRAINED_WEIGHTS_LR_SHIFT_{l} {shift}\n")
+            f.write("\n")
+        if gemv_native:
+            f.write("// GEMV block layouts are available (TINYFORMER_GEMV_NATIVE).\n"
+                    "#define TRAINED_WEIGHTS_GEMV_NATIVE 1\n\n")
+        if ff2_cols:
+            f.write("// Column-major W_ff2 is available (TINYFORMER_FFN_GATHER).\n"
+                    "#define TRAINED_WEIGHTS_FF2_COLS 1\n\n")
+        if shared_layers:
+            f.write("// Layers of the shared stack (TINYFORMER_SHARED_LAYERS).\n"
+                    f"#define TRAINED_WEIGHTS_SHARED_LAYERS {shared_layers}\n\n")
+        f.write("// Attention heads of the trained model (must match TINYFORMER_HEADS).\n"
+                f"#define TRAINED_WEIGHTS_HEADS {attn_heads}\n\n")
+        if linear_attn:
+            f.write("// Trained with linear attention (needs TINYFORMER_LINEAR_ATTN).\n"
+                    "#define TRAINED_WEIGHTS_LINEAR_ATTN 1\n\n")
+        f.write(
+            f"extern const int8_t W_q[TINYFORMER_D][{qkv_cols}];\n"
+            f"extern const int8_t W_k[TINYFORMER_D][{qkv_cols}];\n"
+            f"extern const int8_t W_v[TINYFORMER_D][{qkv_cols}];\n"
             f"extern const int8_t W_o[TINYFORMER_D][TINYFORMER_D];\n\n"
             f"extern const int8_t W_ff1[TINYFORMER_FFN][TINYFORMER_D];\n"
             f"extern const int8_t W_ff2[TINYFORMER_D][TINYFORMER_FFN];\n\n"
@@ -108,11 +714,123 @@ def write_header(path: Path) -> None:
             f"extern const int8_t b_o[TINYFORMER_D];\n\n"
             f"extern const int8_t b_ff1[TINYFORMER_FFN];\n"
             f"extern const int8_t b_ff2[TINYFORMER_D];\n\n"
-            f"#endif // {guard}\n"
+            f"#if TINYFORMER_PACKED_WEIGHTS\n"
+            f"// Word-packed copies: 4 int8 lanes per word, dot8_pack() lane order.\n"
         )
+        for name, rows, cols in mats:
+            f.write(f"extern const uint32_t {name}_packed[{rows}][{cols} / 4];\n")
+        f.write(
+            f"#endif\n\n"
+            f"#if TINYFORMER_FUSED_QKV\n"
+            f"// Fused QKV block: rows [0,D) = W_q, [D,2D) = W_k, [2D,3D) = W_v.\n"
+            f"extern const int8_t W_qkv[3 * TINYFORMER_D][{qkv_cols}];\n"
+            f"extern const int8_t b_qkv[3 * TINYFORMER_D];\n"
+            f"#if TINYFORMER_PACKED_WEIGHTS\n"
+            f"extern const uint32_t W_qkv_packed[3 * TINYFORMER_D][{qkv_cols} / 4];\n"
+            f"#endif\n"
+            f"#endif\n\n"
+        )
+        if fwa is not None:
+            f.write(
+                "#if TINYFORMER_FWA\n"
+                "// Fused-weight attention: g = (W_qk x + b_qk) >> TRAINED_WEIGHTS_QK_SHIFT.\n"
+                f"extern const int8_t W_qk[{qkv_cols}][{qkv_cols}];\n"
+                f"extern const int32_t b_qk[{qkv_cols}];\n"
+                "#if TINYFORMER_PACKED_WEIGHTS\n"
+                f"extern const uint32_t W_qk_packed[{qkv_cols}][{qkv_cols} / 4];\n"
+                "#endif\n"
+                "#endif\n\n"
+            )
+        if ff2_cols:
+            f.write(
+                "#if TINYFORMER_FFN_GATHER\n"
+                "// W_ff2 transposed: row k holds the weights of hidden unit k.\n"
+                "extern const int8_t W_ff2_cols[TINYFORMER_FFN][TINYFORMER_D];\n"
+                "#endif\n\n"
+            )
+        if per_channel:
+            f.write(
+                "#if TINYFORMER_PER_CHANNEL_REQUANT\n"
+                "// Per-channel requant: out = sat(round((acc + bias) * mul / 2^shift)).\n"
+            )
+            write_rq_externs(f, "rq")
+            f.write("#endif\n\n")
+        if int4:
+            f.write(
+                "#if TINYFORMER_INT4_WEIGHTS\n"
+                "// int4 copies: 8 nibbles per word, see TINYFORMER_INT4_WEIGHTS.\n"
+            )
+            for name, rows, cols in mats:
+                f.write(f"extern const uint32_t {name}_int4[{rows}][{cols} / 8];\n")
+            f.write(
+                "#if TINYFORMER_FUSED_QKV\n"
+                f"extern const uint32_t W_qkv_int4[3 * TINYFORMER_D][{qkv_cols} / 8];\n"
+                "#endif\n"
+            )
+            write_rq_externs(f, "rq4")
+            f.write("#endif\n\n")
+        if block_sparse:
+            f.write(
+                "#if TINYFORMER_BLOCK_SPARSE\n"
+                "// Block-sparse rows: non-zero 4-wide blocks, see tinyformer_sparse_t.\n"
+            )
+            write_sparse_externs(f)
+            f.write("#endif\n\n")
+        if lowrank is not None:
+            f.write(
+                "#if TINYFORMER_LOW_RANK\n"
+                "// Rank-R factors W ~= U V >> shift, see tinyformer_lowrank_t.\n"
+            )
+            write_lowrank_externs(f, mats, qkv_cols)
+            f.write("#endif\n\n")
+        if gemv_native:
+            f.write(
+                "#if TINYFORMER_GEMV_NATIVE\n"
+                "// GEMV layouts: int32 B_IN biases, pre-tiled W_IN4 words (gemv_matvec_tiles()).\n"
+            )
+            for l, name, rows in RQ_LAYERS:
+                f.write(f"extern const int32_t gemv_b_{l}[{rows}];\n")
+                if d_in is not None and name in ("W_q", "W_k", "W_v"):
+                    f.write(f"extern const uint32_t gemv_w_{l}[];\n")
+            f.write("#if TINYFORMER_FUSED_QKV\n"
+                    "extern const int32_t gemv_b_qkv[3 * TINYFORMER_D];\n")
+            if d_in is not None:
+                f.write("extern const uint32_t gemv_w_qkv[];\n")
+            f.write("#endif\n")
+            if fwa is not None and d_in is not None:
+                f.write("#if TINYFORMER_FWA\n"
+                        "extern const uint32_t gemv_w_qk[];\n"
+                        "#endif\n")
+            f.write("#endif\n\n")
+        if shared_layers:
+            f.write(
+                "#if TINYFORMER_SHARED_LAYERS\n"
+                "// Own biases of each layer for tinyformer_share_layers().\n"
+                "extern const tinyformer_layer_bias_t shared_layer_bias[TRAINED_WEIGHTS_SHARED_LAYERS];\n"
+                "#endif\n\n"
+            )
+        f.write(f"#endif // {guard}\n")
 
 
-def write_source(path: Path, weights: dict) -> None:
+def write_source(path: Path, weights: dict, requant: dict = None, int4=None, block_sparse: bool = False,
+                 d_in=None, fwa: bool = False, lowrank: dict = None, shared: list = None,
+                 gemv_native: bool = False, ff2_cols: bool = False) -> None:
+    """
+    int4, if given, is (weights4, requant4) from quantize_per_channel(qmax=7).
+    gemv_native adds the GEMV block layouts (write_gemv_arrays).
+    ff2_cols adds W_ff2 transposed (W_ff2_cols).
+    d_in narrows the Q/K/V matrices to their first d_in columns (narrow_inputs).
+    fwa adds the fused-weight attention arrays (fuse_qk).
+    lowrank, if given, is the low_rank_matrices() of the same weights.
+    shared, if given, holds the int8 biases of layers 1.. of a shared stack.
+    Returns the (blocks kept, blocks) of the block-sparse tables with block_sparse.
+    """
+    kept = total = 0
+    mats = c_matrices(d_in)
+    qkv_cols = D_IN_MACRO if d_in is not None else "TINYFORMER_D"
+    weights = narrow_inputs(weights, d_in)
+    if int4 is not None:
+        int4 = (narrow_inputs(int4[0], d_in), int4[1])
     with path.open("w") as f:
         f.write(
             '// Trained TinyFormer encoder weights (generated by tools/export_weights.py)\n\n'
@@ -123,16 +841,17 @@ def write_source(path: Path, weights: dict) -> None:
         # Projections
         for name in ("W_q", "W_k", "W_v", "W_o"):
             t = weights[name]
-            f.write(f"const int8_t {name}[TINYFORMER_D][TINYFORMER_D] = ")
+            cols = qkv_cols if name != "W_o" else "TINYFORMER_D"
+            f.write(f"const int8_t {name}[TINYFORMER_D][{cols}] TINYFORMER_WEIGHTS(I8, {layer_of(name)}) = ")
             f.write(tensor_to_c_array(name, t, indent="    "))
             f.write(";\n\n")
 
         # FFN
-        f.write("const int8_t W_ff1[TINYFORMER_FFN][TINYFORMER_D] = ")
+        f.write("const int8_t W_ff1[TINYFORMER_FFN][TINYFORMER_D] TINYFORMER_WEIGHTS(I8, ff1) = ")
         f.write(tensor_to_c_array("W_ff1", weights["W_ff1"], indent="    "))
         f.write(";\n\n")
 
-        f.write("const int8_t W_ff2[TINYFORMER_D][TINYFORMER_FFN] = ")
+        f.write("const int8_t W_ff2[TINYFORMER_D][TINYFORMER_FFN] TINYFORMER_WEIGHTS(I8, ff2) = ")
         f.write(tensor_to_c_array("W_ff2", weights["W_ff2"], indent="    "))
         f.write(";\n\n")
 
@@ -146,10 +865,361 @@ def write_source(path: Path, weights: dict) -> None:
             ("b_ff2", "TINYFORMER_D"),
         ):
             t = weights[name]
-            f.write(f"const int8_t {name}[{macro}] = ")
+            f.write(f"const int8_t {name}[{macro}] TINYFORMER_WEIGHTS(VEC, {layer_of(name)}) = ")
             f.write(tensor_to_c_array(name, t, indent="    "))
             f.write(";\n\n")
 
+        # Word-packed copies for the DOT8 path
+        f.write("#if TINYFORMER_PACKED_WEIGHTS\n\n")
+        for name, rows, cols in mats:
+            f.write(f"const uint32_t {name}_packed[{rows}][{cols} / 4] TINYFORMER_WEIGHTS(PACKED, {layer_of(name)}) = ")
+            f.write(tensor_to_c_packed_array(name, weights[name], indent="    "))
+            f.write(";\n\n")
+        f.write("#endif // TINYFORMER_PACKED_WEIGHTS\n\n")
+
+        # Fused QKV block
+        W_qkv, b_qkv = fuse_qkv(weights)
+        f.write("#if TINYFORMER_FUSED_QKV\n\n")
+        f.write(f"const int8_t W_qkv[3 * TINYFORMER_D][{qkv_cols}] TINYFORMER_WEIGHTS(I8, qkv) = ")
+        f.write(tensor_to_c_array("W_qkv", W_qkv, indent="    "))
+        f.write(";\n\n")
+        f.write("const int8_t b_qkv[3 * TINYFORMER_D] TINYFORMER_WEIGHTS(VEC, qkv) = ")
+        f.write(tensor_to_c_array("b_qkv", b_qkv, indent="    "))
+        f.write(";\n\n")
+        f.write("#if TINYFORMER_PACKED_WEIGHTS\n\n")
+        f.write(
+            f"const uint32_t W_qkv_packed[3 * TINYFORMER_D][{qkv_cols} / 4] TINYFORMER_WEIGHTS(PACKED, qkv) = "
+        )
+        f.write(tensor_to_c_packed_array("W_qkv", W_qkv, indent="    "))
+        f.write(";\n\n")
+        f.write("#endif // TINYFORMER_PACKED_WEIGHTS\n\n")
+        f.write("#endif // TINYFORMER_FUSED_QKV\n")
+
+        # Fused-weight attention
+        if fwa:
+            W_qk, b_qk, _ = fuse_qk(weights)
+            f.write("\n#if TINYFORMER_FWA\n\n")
+            f.write(f"const int8_t W_qk[{qkv_cols}][{qkv_cols}] TINYFORMER_WEIGHTS(I8, qk) = ")
+            f.write(tensor_to_c_array("W_qk", W_qk, indent="    "))
+            f.write(";\n\n")
+            f.write(f"const int32_t b_qk[{qkv_cols}] TINYFORMER_WEIGHTS(VEC, qk) = {ints_to_c_array(b_qk)};\n\n")
+            f.write("#if TINYFORMER_PACKED_WEIGHTS\n\n")
+            f.write(f"const uint32_t W_qk_packed[{qkv_cols}][{qkv_cols} / 4] TINYFORMER_WEIGHTS(PACKED, qk) = ")
+            f.write(tensor_to_c_packed_array("W_qk", W_qk, indent="    "))
+            f.write(";\n\n")
+            f.write("#endif // TINYFORMER_PACKED_WEIGHTS\n\n")
+            f.write("#endif // TINYFORMER_FWA\n")
+
+        # Column-major W_ff2 for the ReLU-sparse FFN
+        if ff2_cols:
+            f.write("\n#if TINYFORMER_FFN_GATHER\n\n")
+            f.write("const int8_t W_ff2_cols[TINYFORMER_FFN][TINYFORMER_D] TINYFORMER_WEIGHTS(COLS, ff2) = ")
+            f.write(tensor_to_c_array("W_ff2_cols", weights["W_ff2"].t().contiguous(), indent="    "))
+            f.write(";\n\n")
+            f.write("#endif // TINYFORMER_FFN_GATHER\n")
+
+        # Per-channel requant parameters
+        if requant is not None:
+            f.write("\n#if TINYFORMER_PER_CHANNEL_REQUANT\n\n")
+            for l, _, rows in RQ_LAYERS:
+                write_rq_arrays(f, l, rows, requant[l])
+            f.write("#if TINYFORMER_FUSED_QKV\n\n")
+            write_rq_arrays(f, "qkv", "3 * TINYFORMER_D", fuse_requant(requant))
+            f.write("#endif // TINYFORMER_FUSED_QKV\n\n")
+            f.write("#endif // TINYFORMER_PER_CHANNEL_REQUANT\n")
+
+        # int4 copies and their requant parameters
+        if int4 is not None:
+            weights4, requant4 = int4
+            f.write("\n#if TINYFORMER_INT4_WEIGHTS\n\n")
+            for name, rows, cols in mats:
+                f.write(f"const uint32_t {name}_int4[{rows}][{cols} / 8] TINYFORMER_WEIGHTS(INT4, {layer_of(name)}) = ")
+                f.write(tensor_to_c_int4_array(name, weights4[name], indent="    "))
+                f.write(";\n\n")
+            for l, _, rows in RQ_LAYERS:
+                write_rq_arrays(f, l, rows, requant4[l], "rq4")
+            W_qkv4 = torch.cat([weights4["W_q"], weights4["W_k"], weights4["W_v"]], dim=0)
+            f.write("#if TINYFORMER_FUSED_QKV\n\n")
+            f.write(
+                f"const uint32_t W_qkv_int4[3 * TINYFORMER_D][{qkv_cols} / 8] TINYFORMER_WEIGHTS(INT4, qkv) = "
+            )
+            f.write(tensor_to_c_int4_array("W_qkv", W_qkv4, indent="    "))
+            f.write(";\n\n")
+            write_rq_arrays(f, "qkv", "3 * TINYFORMER_D", fuse_requant(requant4), "rq4")
+            f.write("#endif // TINYFORMER_FUSED_QKV\n\n")
+            f.write("#endif // TINYFORMER_INT4_WEIGHTS\n")
+
+        # Block-sparse tables
+        if block_sparse:
+            f.write("\n#if TINYFORMER_BLOCK_SPARSE\n\n")
+            for name, rows, _ in MATRICES:
+                kept += write_sparse_arrays(f, layer_of(name), rows, weights[name])
+                total += weights[name].numel() // 4
+            f.write("#if TINYFORMER_FUSED_QKV\n\n")
+            write_sparse_arrays(f, "qkv", "3 * TINYFORMER_D", W_qkv)
+            f.write("#endif // TINYFORMER_FUSED_QKV\n\n")
+            f.write("#endif // TINYFORMER_BLOCK_SPARSE\n")
+
+        # Low-rank factors
+        if lowrank is not None:
+            f.write("\n#if TINYFORMER_LOW_RANK\n\n")
+            for name, rows, cols in mats:
+                write_lowrank_arrays(f, layer_of(name), rows, cols, lowrank[layer_of(name)])
+            f.write("#if TINYFORMER_FUSED_QKV\n\n")
+            write_lowrank_arrays(f, "qkv", "3 * TINYFORMER_D", qkv_cols, lowrank["qkv"])
+            f.write("#endif // TINYFORMER_FUSED_QKV\n\n")
+            f.write("#endif // TINYFORMER_LOW_RANK\n")
+
+        # GEMV block layouts
+        if gemv_native:
+            f.write("\n#if TINYFORMER_GEMV_NATIVE\n\n")
+            for l, name, rows in RQ_LAYERS:
+                write_gemv_arrays(f, l, rows, weights[name], weights["b_" + l])
+            f.write("#if TINYFORMER_FUSED_QKV\n\n")
+            write_gemv_arrays(f, "qkv", "3 * TINYFORMER_D", W_qkv, b_qkv)
+            f.write("#endif // TINYFORMER_FUSED_QKV\n\n")
+            if fwa:
+                W_qk = fuse_qk(weights)[0]
+                if not gemv_whole(*W_qk.shape):
+                    words = ", ".join(f"0x{w:08X}u" for w in gemv_tile_words(W_qk))
+                    f.write("#if TINYFORMER_FWA\n\n")
+                    f.write(f"const uint32_t gemv_w_qk[] TINYFORMER_WEIGHTS(PACKED, qk) = {{ {words} }};\n\n")
+                    f.write("#endif // TINYFORMER_FWA\n\n")
+            f.write("#endif // TINYFORMER_GEMV_NATIVE\n")
+
+        # Own biases of the layers of a shared stack
+        if shared is not None:
+            write_shared_arrays(f, weights, shared, fwa, qkv_cols)
+    return kept, total
+
+
+# Bias vectors of one layer and their lengths.
+BIASES = (
+    ("b_q", "TINYFORMER_D"),
+    ("b_k", "TINYFORMER_D"),
+    ("b_v", "TINYFORMER_D"),
+    ("b_o", "TINYFORMER_D"),
+    ("b_ff1", "TINYFORMER_FFN"),
+    ("b_ff2", "TINYFORMER_D"),
+)
+
+
+def shared_layer_biases(paths, matrices: dict):
+    """
+    int8 biases of the later layers of a shared stack (--shared-layers), whose
+    checkpoints must hold the same matrices as layer 0 (matrices, float).
+    """
+    out = []
+    for path in paths:
+        state = torch.load(path, map_location="cpu")
+        if isinstance(state, dict) and "state_dict" in state:
+            state = state["state_dict"]
+        for name, W in matrices.items():
+            if name not in state:
+                raise KeyError(f"{path}: missing {name}")
+            t = state[name].detach().cpu()
+            if name in ("W_ff1", "W_ff2"):
+                t = maybe_transpose_ffn(name, t, tuple(W.shape))
+            if tuple(t.shape) != tuple(W.shape) or not torch.equal(t, W):
+                raise ValueError(f"{path}: {name} differs from layer 0; not a shared stack")
+        biases = {}
+        for name, _ in BIASES:
+            if name not in state:
+                raise KeyError(f"{path}: missing {name}")
+            biases[name] = quantize_to_int8(state[name].detach().cpu().view(-1))
+        out.append(biases)
+    return out
+
+
+def write_shared_arrays(f, weights: dict, shared: list, fwa: bool, qkv_cols: str) -> None:
+    """The biases where layer k of a shared stack differs and shared_layer_bias[]."""
+    f.write("\n#if TINYFORMER_SHARED_LAYERS\n\n")
+    entries = []
+    for k, own in enumerate(shared, 1):
+        fields = []
+        for name, rows in BIASES:
+            if torch.equal(own[name], weights[name]):
+                continue
+            f.write(f"static const int8_t {name}_l{k}[{rows}] = ")
+            f.write(tensor_to_c_array(f"{name}_l{k}", own[name]))
+            f.write(";\n")
+            fields.append(f".{name} = {name}_l{k}")
+        layer = dict(weights, **own)
+        if any(not torch.equal(own[n], weights[n]) for n in ("b_q", "b_k", "b_v")):
+            b_qkv = torch.cat([own["b_q"], own["b_k"], own["b_v"]], dim=0)
+            f.write("#if TINYFORMER_FUSED_QKV\n")
+            f.write(f"static const int8_t b_qkv_l{k}[3 * TINYFORMER_D] = ")
+            f.write(tensor_to_c_array(f"b_qkv_l{k}", b_qkv))
+            f.write(";\n#endif\n")
+            fields.append(("TINYFORMER_FUSED_QKV", f".b_qkv = b_qkv_l{k}"))
+        if fwa and not torch.equal(own["b_q"], weights["b_q"]):
+            b_qk = fuse_qk(layer)[1]
+            f.write("#if TINYFORMER_FWA\n")
+            f.write(f"static const int32_t b_qk_l{k}[{qkv_cols}] = {ints_to_c_array(b_qk)};\n")
+            f.write("#endif\n")
+            fields.append(("TINYFORMER_FWA", f".b_qk = b_qk_l{k}"))
+        if fields:
+            f.write("\n")
+        entries.append(fields)
+
+    f.write("const tinyformer_layer_bias_t shared_layer_bias[TRAINED_WEIGHTS_SHARED_LAYERS] = {\n")
+    f.write("    { 0 },\n")
+    for fields in entries:
+        if not any(isinstance(field, str) for field in fields):
+            fields.insert(0, ".b_q = 0")
+        f.write("    {\n")
+        for field in fields:
+            if isinstance(field, tuple):
+                f.write(f"#if {field[0]}\n        {field[1]},\n#endif\n")
+            else:
+                f.write(f"        {field},\n")
+        f.write("    },\n")
+    f.write("};\n\n")
+    f.write("#endif // TINYFORMER_SHARED_LAYERS\n")
+
+
+# Layer image order of the SPI-flash weight store (weight_store.h).
+FLASH_LAYER_ORDER = ("W_q", "W_k", "W_v", "W_o", "W_ff1", "W_ff2",
+                     "b_q", "b_k", "b_v", "b_o", "b_ff1", "b_ff2")
+
+
+def write_flash_image(path: Path, weights: dict, compress: bool = False) -> int:
+    """
+    Write one weight-store layer image; returns its size (TF_STORE_LAYER_BYTES,
+    or the compressed size with compress).
+    """
+    data = b"".join(weights[name].contiguous().numpy().tobytes() for name in FLASH_LAYER_ORDER)
+    data += b"\0" * (-len(data) % 4)
+    if compress:
+        from weight_codec import compress as wz_compress
+
+        data = wz_compress(data)
+    path.write_bytes(data)
+    return len(data)
+
+
+# Model blob (model_blob.h): header, directory entry and tensor data alignment.
+BLOB_MAGIC = 0x424D4654  # "TFMB"
+BLOB_VERSION = 1
+BLOB_ALIGN = 16
+BLOB_HEADER = struct.Struct("<IHHHHHHHHII")
+BLOB_TENSOR = struct.Struct("<HBBHHIII")
+BLOB_F_PER_CHANNEL = 0x0001
+BLOB_F_INT4 = 0x0002
+BLOB_F_HEADS_SHIFT = 8  # attention heads - 1 in bits 8..15
+
+# tf_blob_tensor_t.dtype
+BLOB_INT8, BLOB_INT4, BLOB_INT32, BLOB_UINT8 = 1, 2, 3, 4
+
+# tf_blob_tensor_t.id: matrices, biases, requant bases (+ RQ_LAYERS index), heads.
+BLOB_ID = {name: 1 + i for i, (name, _, _) in enumerate(MATRICES)}
+BLOB_ID.update({"b_" + l: 7 + i for i, (l, _, _) in enumerate(RQ_LAYERS)})
+BLOB_RQ_BIAS, BLOB_RQ_MUL, BLOB_RQ_SHIFT = 0x20, 0x30, 0x40
+BLOB_HEAD_ID = {
+    "cls": (0x50, 0x51, None),
+    "exit_in": (0x52, 0x53, 0x54),
+    "exit_attn": (0x55, 0x56, 0x57),
+}
+
+# Classifier quantization of training/export_and_make_fpga_demo.py.
+HEAD_SCALE = 32.0
+EXIT_DISABLED = 0x7FFFFFFF
+
+
+def int4_words(tensor: torch.Tensor) -> bytes:
+    """int4 matrix as the little-endian words of tensor_to_c_int4_array()."""
+    out = bytearray()
+    for row in tensor:
+        vals = [int(v) for v in row.view(-1)]
+        for i in range(0, len(vals), 8):
+            out += bytes((vals[i + k] & 0xF) | ((vals[i + k + 4] & 0xF) << 4) for k in range(4))
+    return bytes(out)
+
+
+def load_heads(path: Path):
+    """Quantized (W, b, margin) per head from classifier.npz; margin is None for cls."""
+    import numpy as np
+
+    clf = np.load(path)
+    heads = {}
+    for name in BLOB_HEAD_ID:
+        if f"W_{name}" not in clf:
+            continue
+        W = np.clip(np.round(clf[f"W_{name}"] * HEAD_SCALE), -127.0, 127.0).astype(np.int8)
+        b = np.clip(np.round(clf[f"b_{name}"] * HEAD_SCALE), -127.0, 127.0).astype(np.int8)
+        margin = None
+        if name != "cls":
+            m = float(clf[f"margin_{name}"])
+            margin = EXIT_DISABLED
+            if np.isfinite(m):
+                margin = int(min(math.ceil(m * HEAD_SCALE * HEAD_SCALE), EXIT_DISABLED))
+        heads[name] = (W, b, margin)
+    if "cls" not in heads:
+        raise KeyError(f"{path}: no W_cls / b_cls")
+    return heads
+
+
+def write_model_blob(path: Path, weights: dict, requant: dict = None, int4=None, heads=None,
+                     attn_heads: int = 1, shape=(S, D, FFN)) -> int:
+    """
+    Write the model blob; int4 is (weights4, requant4) as for write_source(),
+    heads (the classifier heads) comes from load_heads(), attn_heads is the
+    attention head count and shape the (S, D, FFN) of a model tier. Returns
+    the blob size in bytes.
+    """
+    s, d, ffn = shape
+    flags = (attn_heads - 1) << BLOB_F_HEADS_SHIFT
+    if int4 is not None:
+        weights, requant = dict(weights, **int4[0]), int4[1]
+        flags |= BLOB_F_INT4
+    if requant is not None:
+        flags |= BLOB_F_PER_CHANNEL
+
+    # (id, dtype, rows, cols, data, scale); Q/K/V stay adjacent for the fused block.
+    tensors = []
+    for name, _, _ in MATRICES:
+        t = weights[name]
+        data = int4_words(t) if int4 is not None else t.contiguous().numpy().tobytes()
+        scale = 0.0 if requant is not None else 1.0
+        tensors.append((BLOB_ID[name], BLOB_INT4 if int4 is not None else BLOB_INT8,
+                        t.shape[0], t.shape[1], data, scale))
+    for l, _, _ in RQ_LAYERS:
+        t = weights["b_" + l]
+        tensors.append((BLOB_ID["b_" + l], BLOB_INT8, t.shape[0], 1, t.contiguous().numpy().tobytes(), 1.0))
+    if requant is not None:
+        for base, idx, fmt, dtype in ((BLOB_RQ_BIAS, 0, "i", BLOB_INT32), (BLOB_RQ_MUL, 1, "i", BLOB_INT32),
+                                      (BLOB_RQ_SHIFT, 2, "B", BLOB_UINT8)):
+            for n, (l, _, _) in enumerate(RQ_LAYERS):
+                vals = requant[l][idx]
+                tensors.append((base + n, dtype, len(vals), 1, struct.pack(f"<{len(vals)}{fmt}", *vals), 0.0))
+    n_classes = 0
+    for name, (w_id, b_id, m_id) in BLOB_HEAD_ID.items():
+        if not heads or name not in heads:
+            continue
+        W, b, margin = heads[name]
+        if W.shape[1] != d or (n_classes and W.shape[0] != n_classes):
+            raise ValueError(f"{name}: head shape {W.shape} does not match [n_classes, {d}]")
+        n_classes = W.shape[0]
+        tensors.append((w_id, BLOB_INT8, W.shape[0], W.shape[1], W.tobytes(), HEAD_SCALE))
+        tensors.append((b_id, BLOB_INT8, b.shape[0], 1, b.tobytes(), HEAD_SCALE))
+        if m_id is not None:
+            tensors.append((m_id, BLOB_INT32, 1, 1, struct.pack("<i", margin), HEAD_SCALE * HEAD_SCALE))
+
+    data_start = BLOB_HEADER.size + len(tensors) * BLOB_TENSOR.size
+    directory, body = b"", b""
+    for tid, dtype, rows, cols, data, scale in tensors:
+        body += b"\0" * (-(data_start + len(body)) % BLOB_ALIGN)
+        offset = data_start + len(body)
+        scale_bits = struct.unpack("<I", struct.pack("<f", scale))[0]
+        directory += BLOB_TENSOR.pack(tid, dtype, 0, rows, cols, offset, len(data), scale_bits)
+        body += data
+    total = data_start + len(body)
+    fields = [BLOB_MAGIC, BLOB_VERSION, BLOB_HEADER.size, s, d, ffn, n_classes, len(tensors), flags, total]
+    blob = BLOB_HEADER.pack(*fields, 0) + directory + body
+    blob = BLOB_HEADER.pack(*fields, zlib.crc32(blob) & 0xFFFFFFFF) + blob[BLOB_HEADER.size:]
+    path.write_bytes(blob)
+    return total
+
 
 def main() -> None:
     parser = argparse.ArgumentParser(description="Export TinyFormer weights to C int8_t arrays.")
@@ -160,7 +1230,95 @@ def main() -> None:
         default="litex_port",
         help="Directory for trained_weights.h/.c (default: litex_port).",
     )
+    parser.add_argument(
+        "--per-channel",
+        action="store_true",
+        help="Quantize weights per output channel and emit requant parameters.",
+    )
+    parser.add_argument(
+        "--int4",
+        action="store_true",
+        help="Also emit per-channel int4 weight copies for TINYFORMER_INT4_WEIGHTS.",
+    )
+    parser.add_argument(
+        "--dead-inputs",
+        type=str,
+        default=None,
+        help="Preprocessed npz whose always-zero input channels are pruned from W_q/W_k/W_v.",
+    )
+    parser.add_argument(
+        "--block-sparse",
+        action="store_true",
+        help="Also emit block-sparse tables of the 4-wide non-zero blocks for TINYFORMER_BLOCK_SPARSE.",
+    )
+    parser.add_argument(
+        "--fwa",
+        action="store_true",
+        help="Also emit the folded W_k^T W_q bilinear form for TINYFORMER_FWA.",
+    )
+    parser.add_argument(
+        "--low-rank",
+        type=int,
+        default=None,
+        metavar="R",
+        help="Also emit rank-R SVD factors of every matrix for TINYFORMER_LOW_RANK.",
+    )
+    parser.add_argument(
+        "--gemv-native",
+        action="store_true",
+        help="Also emit int32 biases and pre-tiled matrices for TINYFORMER_GEMV_NATIVE.",
+    )
+    parser.add_argument(
+        "--ff2-cols",
+        action="store_true",
+        help="Also emit W_ff2 transposed (one row per hidden unit) for TINYFORMER_FFN_GATHER.",
+    )
+    parser.add_argument(
+        "--flash-image",
+        type=str,
+        default=None,
+        help="Also write a layer image for the SPI-flash weight store (weight_store.h).",
+    )
+    parser.add_argument(
+        "--compress",
+        action="store_true",
+        help="Write --flash-image compressed for tf_store_init_compressed() (weight_codec.h).",
+    )
+    parser.add_argument(
+        "--shared-layers",
+        type=str,
+        default=None,
+        metavar="CKPTS",
+        help="Comma-separated checkpoints of layers 1.. sharing --checkpoint's matrices "
+             "(train_tinyformer_uci_har.py --share-layers); emits their biases for TINYFORMER_SHARED_LAYERS.",
+    )
+    parser.add_argument(
+        "--blob",
+        type=str,
+        default=None,
+        help="Also write the model as a binary blob for tf_blob_load() (model_blob.h).",
+    )
+    parser.add_argument(
+        "--classifier",
+        type=str,
+        default=None,
+        help="classifier.npz whose heads are added to --blob.",
+    )
     args = parser.parse_args()
+    if args.flash_image and args.per_channel:
+        parser.error("--flash-image stores per-tensor int8 layers; drop --per-channel")
+    if args.fwa and args.per_channel:
+        parser.error("--fwa folds the per-tensor >> 7 Q/K projections; drop --per-channel")
+    if args.classifier and not args.blob:
+        parser.error("--classifier is only used with --blob")
+    if args.compress and not args.flash_image:
+        parser.error("--compress is only used with --flash-image")
+    if args.low_rank is not None and (args.low_rank <= 0 or args.low_rank % 4 != 0):
+        parser.error("--low-rank: R must be a positive multiple of 4 (whole DOT8 words)")
+    if args.gemv_native and args.int4:
+        parser.error("--gemv-native lays out int8 matrices for the GEMV block; drop --int4")
+    if args.shared_layers and (args.per_channel or args.int4):
+        parser.error("--shared-layers emits int8 biases for the >> 7 requant; drop --per-channel / --int4")
 
     ckpt_path = Path(args.checkpoint)
     out_dir = Path(args.output_dir)
@@ -204,22 +1362,66 @@ def main() -> None:
     b_ff1 = state_dict["b_ff1"].detach().cpu().view(-1)
     b_ff2 = state_dict["b_ff2"].detach().cpu().view(-1)
 
+    # Model tier (train_tinyformer_uci_har.py --distill): its own S / D / FFN
+    d, ffn, s = W_o.shape[0], b_ff1.numel(), int(state_dict.get("tokens", S))
+    tier = (s, d, ffn) != (S, D, FFN)
+    if tier:
+        if d % 4 != 0 or ffn % 4 != 0 or S % s != 0:
+            raise ValueError(f"tier S/D/FFN = {s}/{d}/{ffn}: D and FFN must be multiples of 4, S divide {S}")
+        if not args.blob:
+            raise ValueError(f"tier S/D/FFN = {s}/{d}/{ffn}: trained_weights.c is the default shape; "
+                             "export it with --blob")
+        if args.dead_inputs or args.block_sparse or args.fwa or args.low_rank or args.flash_image \
+                or args.shared_layers or args.gemv_native:
+            raise ValueError("a model tier is exported as a blob only: drop --dead-inputs, "
+                             "--block-sparse, --fwa, --low-rank, --flash-image, --shared-layers "
+                             "and --gemv-native")
+
+    # Attention heads (train_tinyformer_uci_har.py --heads); whole DOT8 words per head
+    attn_heads = int(state_dict.get("heads", 1))
+    if attn_heads < 1 or d % (4 * attn_heads) != 0:
+        raise ValueError(f"heads = {attn_heads}: D / heads must be a multiple of 4")
+    if attn_heads > 1 and args.fwa:
+        raise ValueError("--fwa folds a single attention head")
+    # Linear attention (train_tinyformer_uci_har.py --linear-attn)
+    linear_attn = bool(int(state_dict.get("linear_attn", 0)))
+    if linear_attn and args.fwa:
+        raise ValueError("--fwa: relu(Q) and relu(K) of linear attention do not fold into W_qk")
+
     # Projections must be [D, D]
     for name, t in (("W_q", W_q), ("W_k", W_k), ("W_v", W_v), ("W_o", W_o)):
-        t, _ = ensure_shape(name, t, [(D, D)])
+        t, _ = ensure_shape(name, t, [(d, d)])
         locals()[name] = t  # not strictly needed, but keeps names consistent
 
     # FFN: normalize to W_ff1[FFN,D], W_ff2[D,FFN]
-    W_ff1 = maybe_transpose_ffn("W_ff1", W_ff1, (FFN, D))
-    W_ff2 = maybe_transpose_ffn("W_ff2", W_ff2, (D, FFN))
+    W_ff1 = maybe_transpose_ffn("W_ff1", W_ff1, (ffn, d))
+    W_ff2 = maybe_transpose_ffn("W_ff2", W_ff2, (d, ffn))
 
     # Bias shapes
-    b_q, _ = ensure_shape("b_q", b_q, [(D,)])
-    b_k, _ = ensure_shape("b_k", b_k, [(D,)])
-    b_v, _ = ensure_shape("b_v", b_v, [(D,)])
-    b_o, _ = ensure_shape("b_o", b_o, [(D,)])
-    b_ff1, _ = ensure_shape("b_ff1", b_ff1, [(FFN,)])
-    b_ff2, _ = ensure_shape("b_ff2", b_ff2, [(D,)])
+    b_q, _ = ensure_shape("b_q", b_q, [(d,)])
+    b_k, _ = ensure_shape("b_k", b_k, [(d,)])
+    b_v, _ = ensure_shape("b_v", b_v, [(d,)])
+    b_o, _ = ensure_shape("b_o", b_o, [(d,)])
+    b_ff1, _ = ensure_shape("b_ff1", b_ff1, [(ffn,)])
+    b_ff2, _ = ensure_shape("b_ff2", b_ff2, [(d,)])
+
+    # Later layers of a shared stack: same matrices, their own biases
+    shared = None
+    if args.shared_layers:
+        matrices = {"W_q": W_q, "W_k": W_k, "W_v": W_v, "W_o": W_o, "W_ff1": W_ff1, "W_ff2": W_ff2}
+        shared = shared_layer_biases([Path(p) for p in args.shared_layers.split(",")], matrices)
+
+    # Dead input channels: the Q/K/V columns they multiply never contribute
+    d_in = None
+    if args.dead_inputs:
+        dead = dead_input_channels(Path(args.dead_inputs))
+        for t in (W_q, W_k, W_v):
+            t[:, dead] = 0.0
+        d_in = narrow_width(set(dead), 8 if args.int4 else 4)
+        print(f"Pruned {len(dead)} dead input channels {dead}: "
+              f"{3 * D * len(dead)} of {3 * D * D} Q/K/V MACs per token")
+        if d_in is not None:
+            print(f"Q/K/V narrowed to {d_in} input channels: {3 * D * (D - d_in)} MACs per token skipped")
 
     weights = {
         "W_q": quantize_to_int8(W_q),
@@ -236,10 +1438,67 @@ def main() -> None:
         "b_ff2": quantize_to_int8(b_ff2),
     }
 
-    write_header(out_dir / "trained_weights.h")
-    write_source(out_dir / "trained_weights.c", weights)
+    float_weights = {"W_q": W_q, "W_k": W_k, "W_v": W_v, "W_o": W_o, "W_ff1": W_ff1, "W_ff2": W_ff2}
+    float_biases = {"q": b_q, "k": b_k, "v": b_v, "o": b_o, "ff1": b_ff1, "ff2": b_ff2}
+
+    requant = None
+    if args.per_channel:
+        requant = {}
+        for l, name, _ in RQ_LAYERS:
+            weights[name], requant[l] = quantize_per_channel(float_weights[name], float_biases[l])
+
+    int4 = None
+    if args.int4:
+        weights4, requant4 = {}, {}
+        for l, name, _ in RQ_LAYERS:
+            weights4[name], requant4[l] = quantize_per_channel(float_weights[name], float_biases[l], qmax=7)
+        int4 = (weights4, requant4)
+
+    if tier:
+        heads = load_heads(Path(args.classifier)) if args.classifier else None
+        n = write_model_blob(Path(args.blob), weights, requant, int4, heads, attn_heads, (s, d, ffn))
+        print(f"Wrote {n}-byte model blob of the S={s} D={d} FFN={ffn} tier to {args.blob}")
+        return
+
+    qk_shift = fuse_qk(narrow_inputs(weights, d_in))[2] if args.fwa else None
+    lowrank = low_rank_matrices(weights, d_in, args.low_rank) if args.low_rank else None
+    write_header(out_dir / "trained_weights.h", per_channel=args.per_channel, int4=args.int4,
+                 block_sparse=args.block_sparse, d_in=d_in, fwa=qk_shift, attn_heads=attn_heads,
+                 linear_attn=linear_attn, lowrank=lowrank,
+                 shared_layers=1 + len(shared) if shared is not None else 0, gemv_native=args.gemv_native,
+                 ff2_cols=args.ff2_cols)
+    kept, total = write_source(out_dir / "trained_weights.c", weights, requant, int4, args.block_sparse, d_in,
+                               args.fwa, lowrank, shared, args.gemv_native, args.ff2_cols)
 
     print(f"Exported trained weights to {out_dir/'trained_weights.h'} and {out_dir/'trained_weights.c'}")
+    if args.block_sparse:
+        print(f"Block-sparse tables keep {kept} of {total} 4-wide blocks ({100.0 * kept / total:.1f}% of the MACs)")
+    if args.fwa:
+        print(f"Fused-weight attention: W_qk >> {qk_shift}, K projection skipped")
+    if lowrank:
+        # Per-token MACs of the encoder's matrices (the separate Q/K/V, not W_qkv)
+        full = low = 0
+        for name, _, _ in MATRICES:
+            U, V, shift, err = lowrank[layer_of(name)]
+            full += U.shape[0] * V.shape[1]
+            low += V.numel() + U.numel()
+            print(f"Low-rank {name}: rank {V.shape[0]}, >> {shift}, relative error {err:.4f}")
+        print(f"Low-rank factors: {low} of {full} MACs per token ({full / low:.2f}x fewer)")
+
+    if shared is not None:
+        own = sum(1 for layer in shared for name, _ in BIASES if not torch.equal(layer[name], weights[name]))
+        print(f"Shared stack: {1 + len(shared)} layers on one set of matrices, "
+              f"{own} per-layer bias vectors")
+
+    if args.flash_image:
+        n = write_flash_image(Path(args.flash_image), weights, args.compress)
+        print(f"Wrote {n}-byte {'compressed ' if args.compress else ''}weight-store layer image "
+              f"to {args.flash_image}")
+
+    if args.blob:
+        heads = load_heads(Path(args.classifier)) if args.classifier else None
+        n = write_model_blob(Path(args.blob), weights, requant, int4, heads, attn_heads)
+        print(f"Wrote {n}-byte model blob to {args.blob}")
 
 
 if __name__ == "__main__":
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""
+Memory footprint report of a firmware ELF (litex_port/firmware.elf): the
+size of each allocated section, the bytes each source module puts in them and
+the largest buffers, read from the symbol table.
+
+Sections come from `readelf -S`. The symbols from
+`nm -S -l --defined-only`, with size and, from the -g line info of the build,
+the source file that defines them, so static buffers and function-local
+statics count for their module too. Each symbol goes to the section that
+holds its address: .text, .rodata, .fast_text, .weights, .fast_data, .data,
+.bss, .noinit, ... as linker.ld lays them out. Bytes of a section that no
+sized symbol covers (alignment, string literals, the linker's own symbols)
+are listed as "(unattributed)".
+
+With the linker.ld symbols _end and _fstack present, it also prints the free
+SRAM the stack may grow into; the firmware's STACK line
+(TINYFORMER_STACK_PAINT) reports how much of it the stack used.
+
+Usage (from litex_port/, or `make footprint`):
+  python3 ../tools/mem_report.py firmware.elf
+      sections, modules and the 20 largest buffers
+  python3 ../tools/mem_report.py firmware.elf --top 50 --csv footprint.csv
+      more buffers, plus one CSV row per symbol (module,section,symbol,bytes)
+  python3 ../tools/mem_report.py host/tinyformer_host --nm nm --readelf readelf
+      the same for a host build (make footprint-check)
+Exit status 1 if the tools fail or the symbols of a section add up to more
+than its size.
+"""
+
+import argparse
+import csv
+import os
+import re
+import subprocess
+import sys
+
+TOOL_PREFIX = "riscv64-unknown-elf-"
+
+# Sections listed first, in linker.ld order; the others follow by address.
+SECTION_ORDER = [".text", ".rodata", ".fast_text", ".weights", ".fast_data",
+                 ".data", ".bss", ".noinit", ".smp_stacks"]
+
+
+def run(cmd):
+    try:
+        return subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit("mem_report: %s: %s" % (" ".join(cmd), e))
+
+
+def read_sections(readelf, elf):
+    """Allocated sections: [(name, addr, size, flags, type)] by address."""
+    out = []
+    row = re.compile(r"^\s*\[\s*\d+\]\s+(\S+)\s+(\S+)\s+([0-9a-fA-F]+)\s+[0-9a-fA-F]+\s+"
+                     r"([0-9a-fA-F]+)\s+[0-9a-fA-F]+\s+(\S*)")
+    for line in run([readelf, "-S", "-W", elf]).splitlines():
+        m = row.match(line)
+        if not m:
+            continue
+        name, kind, flags = m.group(1), m.group(2), m.group(5)
+        addr, size = int(m.group(3), 16), int(m.group(4), 16)
+        if "A" in flags and size > 0:
+            out.append((name, addr, size, flags, kind))
+    out.sort(key=lambda s: s[1])
+    return out
+
+
+def read_symbols(nm, elf):
+    """Sized symbols [(name, addr, size, type, file or None)] and all
+    symbol addresses {name: addr}."""
+    syms, addrs = [], {}
+    for line in run([nm, "-S", "-l", "--defined-only", elf]).splitlines():
+        where = None
+        if "\t" in line:
+            line, where = line.split("\t", 1)
+            where = where.rsplit(":", 1)[0]
+        f = line.split()
+        if len(f) == 3:
+            addrs[f[2]] = int(f[0], 16)
+        elif len(f) == 4:
+            addr, size = int(f[0], 16), int(f[1], 16)
+            addrs[f[3]] = addr
+            if size > 0:
+                syms.append((f[3], addr, size, f[2], where))
+    return syms, addrs
+
+
+def section_of(sections, addr):
+    for s in sections:
+        if s[1] <= addr < s[1] + s[2]:
+            return s
+    return None
+
+
+def module_name(path, root):
+    if path is None:
+        return "(no line info)"
+    rel = os.path.relpath(path, root)
+    return path if rel.startswith(os.pardir + os.sep + os.pardir) else rel
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf")
+    ap.add_argument("--nm", default=TOOL_PREFIX + "nm")
+    ap.add_argument("--readelf", default=TOOL_PREFIX + "readelf")
+    ap.add_argument("--root", default=".", help="module paths relative to this (default: .)")
+    ap.add_argument("--top", type=int, default=20, help="largest buffers listed (default 20)")
+    ap.add_argument("--csv", help="also write one row per sized symbol here")
+    args = ap.parse_args()
+
+    sections = read_sections(args.readelf, args.elf)
+    syms, addrs = read_symbols(args.nm, args.elf)
+    root = os.path.abspath(args.root)
+
+    # bytes[module][section], and each section's attributed total
+    per_mod, covered, rows = {}, {}, []
+    for name, addr, size, kind, where in syms:
+        s = section_of(sections, addr)
+        if s is None:
+            continue
+        mod = module_name(where, root)
+        per_mod.setdefault(mod, {})
+        per_mod[mod][s[0]] = per_mod[mod].get(s[0], 0) + size
+        covered[s[0]] = covered.get(s[0], 0) + size
+        rows.append((mod, s[0], name, size, "X" in s[3]))
+
+    known = [n for n in SECTION_ORDER if any(s[0] == n for s in sections)]
+    order = known + [s[0] for s in sections if s[0] not in known]
+    size_of = {s[0]: s[2] for s in sections}
+    nobits = {s[0] for s in sections if s[4] == "NOBITS"}
+
+    bad = 0
+    print("SECTION %-20s %10s %10s" % ("name", "bytes", "symbols"))
+    for n in order:
+        print("SECTION %-20s %10d %10d%s" % (n, size_of[n], covered.get(n, 0),
+                                             "  (no load)" if n in nobits else ""))
+        if covered.get(n, 0) > size_of[n]:
+            print("mem_report: symbols of %s exceed its size" % n, file=sys.stderr)
+            bad = 1
+    print("TOTAL loaded=%d noload=%d" % (sum(size_of[n] for n in order if n not in nobits),
+                                         sum(size_of[n] for n in order if n in nobits)))
+
+    # Module table over the sections that hold symbols.
+    cols = [n for n in order if covered.get(n, 0) > 0]
+    short = [c.lstrip(".")[:10] for c in cols]
+    print()
+    print("%-40s " % "MODULE" + " ".join("%10s" % c for c in short) + " %10s" % "total")
+    unattr = {n: size_of[n] - covered.get(n, 0) for n in cols}
+    mods = sorted(per_mod.items(), key=lambda kv: -sum(kv[1].values()))
+    for mod, by in mods + [("(unattributed)", unattr)]:
+        print("%-40s " % mod[-40:] + " ".join("%10d" % by.get(c, 0) for c in cols) +
+              " %10d" % sum(by.get(c, 0) for c in cols))
+
+    # Largest buffers: symbols outside the executable sections.
+    bufs = sorted((r for r in rows if not r[4]), key=lambda r: -r[3])[:args.top]
+    print()
+    print("BUFFER %-36s %-12s %8s  %s" % ("symbol", "section", "bytes", "module"))
+    for mod, sec, name, size, _ in bufs:
+        print("BUFFER %-36s %-12s %8d  %s" % (name[:36], sec, size, mod))
+
+    if "_end" in addrs and "_fstack" in addrs and addrs["_fstack"] >= addrs["_end"]:
+        print()
+        print("STACK room=%d (_end 0x%08x .. _fstack 0x%08x)" %
+              (addrs["_fstack"] - addrs["_end"], addrs["_end"], addrs["_fstack"]))
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            w = csv.writer(f)
+            w.writerow(["module", "section", "symbol", "bytes"])
+            for mod, sec, name, size, _ in sorted(rows, key=lambda r: (r[0], r[1], -r[3])):
+                w.writerow([mod, sec, name, size])
+    return bad
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+cffi bindings of the C TinyFormer encoder (litex_port/common/tinyformer.c),
+the demo classifier head and the software DOT8 / exp LUT fallbacks, built as
+the shared library litex_port/host/libtinyformer.so (make pylib). Where
+tools/tinyformer_sim.py re-implements the integer kernels in NumPy, this runs
+the firmware's own C code at native speed, so the labels and ENC_CKSUM are
+the firmware's by construction; the library carries the weights and heads it
+was built with (rebuild it after re-exporting them).
+
+Batches are int8 [n, S, D] in C order. A NumPy array in that layout, or any
+bytes-like object of n * S * D bytes (bytes, bytearray, mmap), is passed to
+C without a copy; other arrays are converted once. Results are NumPy arrays,
+or array.array / bytearray without NumPy. Every call runs on its own
+encoder workspace and cffi releases the GIL, so Python threads may classify
+in parallel.
+
+Usage (from repo root TinyML_algo/, after make -C litex_port pylib):
+  python3 tools/tinyformer_c.py --check
+      demo samples against golden_cksum[] of litex_port/host/main_host.c
+  python3 tools/tinyformer_c.py --data data/uci_har_processed/uci_har_processed.npz
+      accuracy on the test split (inputs quantized as quantize_inputs)
+  python3 tools/tinyformer_c.py --windows litex_port/host/replay_windows.bin --out c.csv
+      the CSV of host/tinyformer_replay (window,pred,enc_cksum)
+  --early-exit adds the exit heads of DEMO_EARLY_EXIT (an exiting window has
+  ENC_CKSUM 0).
+
+Python:
+  tf = TinyFormerC()
+  pred, cksum = tf.classify(x_int8)          # x_int8: [n, 16, 32]
+  pred, cksum, logits, stage = tf.classify(x_int8, early_exit=True, logits=True)
+  y = tf.encode(x_int8)
+"""
+
+import argparse
+import array
+import mmap
+import re
+import sys
+import time
+from pathlib import Path
+
+try:
+    import numpy as np
+except ImportError:  # bytes-like batches only
+    np = None
+
+REPO_ROOT = Path(__file__).resolve().parents[1]
+DEFAULT_LIB = REPO_ROOT / "litex_port" / "host" / "libtinyformer.so"
+MAIN_HOST = REPO_ROOT / "litex_port" / "host" / "main_host.c"
+
+# int8 activation scale of the demo inputs (tinyformer_sim.ACT_SCALE)
+ACT_SCALE = 32.0
+
+# Interface of litex_port/host/tinyformer_py.c (TFPY_ABI).
+ABI = 1
+CDEF = """
+int tfpy_shape(int32_t *s, int32_t *d, int32_t *n_classes);
+int tfpy_demo_samples(const int8_t **inputs, const uint8_t **labels);
+int tfpy_encode(const int8_t *in, int8_t *out, uint32_t n);
+int tfpy_classify(const int8_t *in, uint32_t n, int early, int32_t *pred,
+                  uint32_t *cksum, int32_t *logits, int32_t *stage);
+"""
+
+STAGE_NAME = ("in", "attn", "full")
+
+
+class TinyFormerC:
+    """The shared library lib (default: litex_port/host/libtinyformer.so)."""
+
+    def __init__(self, lib=DEFAULT_LIB):
+        try:
+            import cffi
+        except ImportError:
+            raise RuntimeError("tinyformer_c: needs cffi (pip install cffi)") from None
+        self.ffi = cffi.FFI()
+        self.ffi.cdef(CDEF)
+        try:
+            self.lib = self.ffi.dlopen(str(lib))
+        except OSError as e:
+            raise RuntimeError(f"tinyformer_c: {lib}: {e} (make -C litex_port pylib)") from None
+        s, d, c = (self.ffi.new("int32_t *") for _ in range(3))
+        abi = self.lib.tfpy_shape(s, d, c)
+        if abi != ABI:
+            raise RuntimeError(f"tinyformer_c: {lib} has interface {abi}, expected {ABI}")
+        self.S, self.D, self.n_classes = s[0], d[0], c[0]
+
+    def _batch(self, x):
+        """(x as a C-contiguous int8 buffer, window count)."""
+        w = self.S * self.D
+        if np is not None and not isinstance(x, (bytes, bytearray, memoryview, mmap.mmap)):
+            x = np.ascontiguousarray(x, dtype=np.int8)
+            if x.ndim < 2 or x.shape[-2:] != (self.S, self.D):
+                raise ValueError(f"batch of shape {x.shape}, expected [n, {self.S}, {self.D}]")
+            return x, x.size // w
+        n = memoryview(x).nbytes
+        if n % w:
+            raise ValueError(f"{n} bytes: not whole [{self.S}][{self.D}] windows")
+        return x, n // w
+
+    def _out(self, kind, n):
+        """Result array of n int32 ('i'), uint32 ('I') or int8 ('b') values."""
+        if np is not None:
+            return np.empty(n, dtype={"i": np.int32, "I": np.uint32, "b": np.int8}[kind])
+        return bytearray(n) if kind == "b" else array.array(kind, bytes(4 * n))
+
+    def _ptr(self, ctype, buf):
+        return self.ffi.from_buffer(ctype, buf)
+
+    def encode(self, x):
+        """tinyformer_encode() of every window: int8 [n, S, D]."""
+        x, n = self._batch(x)
+        out = self._out("b", n * self.S * self.D)
+        if self.lib.tfpy_encode(self._ptr("int8_t[]", x), self._ptr("int8_t[]", out), n) != 0:
+            raise MemoryError("tinyformer_c: no encoder workspace")
+        return out.reshape(n, self.S, self.D) if np is not None else out
+
+    def classify(self, x, early_exit=False, logits=False):
+        """
+        tinyformer_classify() with the demo head: (pred, ENC_CKSUM), plus the
+        logits [n, n_classes] with logits=True and the TINYFORMER_EXIT_*
+        stage of each window with early_exit=True, in that order.
+        """
+        x, n = self._batch(x)
+        pred, cksum = self._out("i", n), self._out("I", n)
+        lg = self._out("i", n * self.n_classes) if logits else None
+        stage = self._out("i", n) if early_exit else None
+        ffi = self.ffi
+        rc = self.lib.tfpy_classify(self._ptr("int8_t[]", x), n, int(early_exit),
+                                    self._ptr("int32_t[]", pred), self._ptr("uint32_t[]", cksum),
+                                    self._ptr("int32_t[]", lg) if logits else ffi.NULL,
+                                    self._ptr("int32_t[]", stage) if early_exit else ffi.NULL)
+        if rc != 0:
+            raise MemoryError("tinyformer_c: no encoder workspace")
+        out = [pred, cksum]
+        if logits:
+            out.append(lg.reshape(n, self.n_classes) if np is not None else lg)
+        if early_exit:
+            out.append(stage)
+        return tuple(out)
+
+    def demo_samples(self):
+        """The built-in demo samples: (int8 bytes [n][S][D], labels)."""
+        inputs, labels = self.ffi.new("int8_t **"), self.ffi.new("uint8_t **")
+        n = self.lib.tfpy_demo_samples(inputs, labels)
+        raw = bytes(self.ffi.buffer(inputs[0], n * self.S * self.D))
+        return raw, [labels[0][i] for i in range(n)]
+
+
+def golden_cksums():
+    table = re.search(r"golden_cksum\[[^\]]*\]\s*=\s*\{(.*?)\};", MAIN_HOST.read_text(), re.S)
+    return [int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]+", table.group(1))]
+
+
+def check_golden(tf, early_exit=False):
+    """Demo samples against golden_cksum[], printed as the demo_run() lines;
+    number of mismatches."""
+    raw, labels = tf.demo_samples()
+    res = tf.classify(raw, early_exit=early_exit)
+    pred, sums = res[0], res[1]
+    golden = golden_cksums()
+    fails = 0
+    for i in range(len(labels)):
+        print(f"ENC_CKSUM=0x{int(sums[i]):08X}")
+        line = f"Sample {i}: pred={int(pred[i])} exp={labels[i]}"
+        print(line + (f" exit={STAGE_NAME[int(res[2][i])]}" if early_exit else ""))
+        if not early_exit and int(sums[i]) != golden[i]:
+            print(f"PYLIB GOLDEN FAIL sample={i} ENC_CKSUM=0x{int(sums[i]):08X} "
+                  f"expected=0x{golden[i]:08X}")
+            fails += 1
+    if fails == 0:
+        print(f"PYLIB GOLDEN OK samples={len(labels)}")
+    return fails
+
+
+def quantize_inputs(X):
+    """Float windows -> int8 encoder inputs, as export_and_make_fpga_demo.py."""
+    return np.clip(np.round(X * ACT_SCALE), -127.0, 127.0).astype(np.int8)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="The C TinyFormer encoder through cffi.")
+    parser.add_argument("--lib", type=str, default=str(DEFAULT_LIB),
+                        help="Shared library of make pylib.")
+    parser.add_argument("--check", action="store_true",
+                        help="Check the demo samples against the golden ENC_CKSUM.")
+    parser.add_argument("--data", type=str, default=None,
+                        help="uci_har_processed.npz: accuracy on X_test / y_test (needs numpy).")
+    parser.add_argument("--windows", type=str, default=None,
+                        help="Raw int8 [n][16][32] windows, as tinyformer_replay takes them.")
+    parser.add_argument("--out", type=str, default=None,
+                        help="With --windows: CSV window,pred,enc_cksum (default: stdout).")
+    parser.add_argument("--early-exit", action="store_true", help="Early exits as DEMO_EARLY_EXIT.")
+    args = parser.parse_args()
+    if not (args.check or args.data or args.windows):
+        parser.error("nothing to do: give --check, --data or --windows")
+    try:
+        tf = TinyFormerC(args.lib)
+    except RuntimeError as e:
+        sys.exit(str(e))
+    status = 0
+
+    if args.check:
+        status |= check_golden(tf, args.early_exit) != 0
+
+    if args.windows:
+        raw = Path(args.windows).read_bytes()
+        t0 = time.perf_counter()
+        pred, sums = tf.classify(raw, early_exit=args.early_exit)[:2]
+        dt = time.perf_counter() - t0
+        rows = "".join(f"{i},{int(p)},0x{int(c):08X}\n" for i, (p, c) in enumerate(zip(pred, sums)))
+        text = "window,pred,enc_cksum\n" + rows
+        if args.out:
+            Path(args.out).write_text(text)
+        else:
+            sys.stdout.write(text)
+        print(f"PYLIB windows={len(pred)} ms={dt * 1e3:.1f} windows_per_s={len(pred) / max(dt, 1e-9):.0f}",
+              file=sys.stderr)
+
+    if args.data:
+        if np is None:
+            sys.exit("tinyformer_c: --data needs numpy")
+        data = np.load(args.data)
+        x = quantize_inputs(data["X_test"].astype(np.float32))
+        labels = data["y_test"].astype(np.int64)
+        res = tf.classify(x, early_exit=args.early_exit)
+        print(f"PYLIB windows={len(x)} acc={float((res[0] == labels).mean()):.4f}", end="")
+        if args.early_exit:
+            print(f" exit_in={int((res[2] == 0).sum())} exit_attn={int((res[2] == 1).sum())}", end="")
+        print()
+
+    sys.exit(status)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,486 @@
+#!/usr/bin/env python3
+"""
+Bit-exact NumPy model of the TinyFormer integer encoder
+(litex_port/common/tinyformer.c) and the demo classification of
+litex_port/common/demo_runner.c, vectorized over windows, so that an
+integer-kernel change can be accuracy-checked on the full UCI HAR test split
+before it reaches the FPGA.
+
+Modelled build: the default per-tensor path (no TINYFORMER_PER_CHANNEL_REQUANT
+or TINYFORMER_INT4_WEIGHTS), two-pass softmax, TINYFORMER_HEADS heads:
+  linears     sat8((W x + b) >> 7), ReLU after the FF1 requant
+  scores      per head (q . k) >> 5 (>> 4 with heads > 1),
+              exp_lut[clamp(-((s - max) >> 3), 0, 15)]
+  weights     Q15 (e << 15) / sum
+  context     sat8(sum_j (w_j * v_j) >> 15)
+  residuals   saturating, X1 = X + O, Out = X1 + FF2
+  head        logits = b + W . sat8((sum_s Out + S / 2) / S), argmax (first max)
+  ENC_CKSUM   sum of the output bytes as uint8
+The options below select the variants of the same names in tinyformer.h
+(TINYFORMER_FAST_SOFTMAX, TINYFORMER_EXP_INTERP, TINYFORMER_EXP2_SOFTMAX,
+TINYFORMER_SPARSE_SOFTMAX, TINYFORMER_CAUSAL,
+TINYFORMER_FFN_U8_HIDDEN, TINYFORMER_FWA, TINYFORMER_LINEAR_ATTN,
+TINYFORMER_LOW_RANK; any of them with USE_*_HW gives the same result),
+and the shifts and the LUT can be overridden to try new ones.
+
+Weights, heads and exit margins are read from the C sources the firmware
+compiles (litex_port/common/trained_weights.c, demo_classifier.c/.h), so
+re-run tools/export_weights.py and training/export_and_make_fpga_demo.py
+first after retraining.
+
+Usage (from repo root TinyML_algo/):
+  python3 tools/tinyformer_sim.py --check
+      demo samples against golden_cksum[] of litex_port/host/main_host.c
+  python3 tools/tinyformer_sim.py --data data/uci_har_processed/uci_har_processed.npz
+      accuracy on the test split (inputs quantized as quantize_inputs)
+  python3 tools/tinyformer_sim.py --windows litex_port/host/replay_windows.bin --out sim.csv
+      the CSV of host/tinyformer_replay (window,pred,enc_cksum)
+  python3 tools/tinyformer_sim.py --data ... --fast-softmax --score-shift 4
+      same with a variant (--early-exit adds the exits of DEMO_EARLY_EXIT)
+  python3 tools/tinyformer_sim.py --data ... --low-rank
+      the rank-R factors of export_weights.py --low-rank R; the accuracy delta
+      against the run without --low-rank is the cost of the factorization
+  python3 tools/tinyformer_sim.py --data ... --exp2-softmax
+      the shift-only base-2 softmax; its accuracy delta against the LUT one
+"""
+
+import argparse
+import re
+import sys
+from dataclasses import dataclass
+from pathlib import Path
+
+import numpy as np
+
+S = 16
+D = 32
+FFN = 64
+
+# Per-window exit stage, as tinyformer.h TINYFORMER_EXIT_*
+EXIT_INPUT = 0
+EXIT_ATTN = 1
+EXIT_NONE = 2
+STAGE_NAME = ("in", "attn", "full")
+
+# exp_lut of tinyformer.c (exp(x) * 2^10 over x in [-15, 0])
+EXP_LUT = (1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12)
+
+# int8 activation scale of the demo inputs (quantize_inputs)
+ACT_SCALE = 32.0
+
+REPO_ROOT = Path(__file__).resolve().parents[1]
+C_DIR = REPO_ROOT / "litex_port" / "common"
+MAIN_HOST = REPO_ROOT / "litex_port" / "host" / "main_host.c"
+
+ENCODER_KEYS = ("W_q", "W_k", "W_v", "W_o", "W_ff1", "W_ff2",
+                "b_q", "b_k", "b_v", "b_o", "b_ff1", "b_ff2")
+
+
+@dataclass
+class Config:
+    """Integer-kernel variant; the defaults are the baseline firmware."""
+    requant_shift: int = 7
+    score_shift: int = None  # TINYFORMER_SCORE_SHIFT: 5, or 4 with attn_heads > 1
+    exp_shift: int = 3
+    exp_lut: tuple = EXP_LUT
+    exp_interp: bool = False
+    fast_softmax: bool = False
+    exp2_softmax: bool = False
+    sparse_softmax: bool = False
+    sparse_min_w: int = 256  # TINYFORMER_SPARSE_MIN_W
+    sparse_topk: int = 0     # TINYFORMER_SPARSE_TOPK (0: no top-k)
+    causal: bool = False
+    ffn_u8_hidden: bool = False
+    fwa: bool = False
+    attn_heads: int = 1
+    linear_attn: bool = False
+    low_rank: bool = False
+
+    def __post_init__(self):
+        if self.score_shift is None:
+            self.score_shift = 5 if self.attn_heads == 1 else 4
+
+
+def read_c_arrays(path: Path) -> dict:
+    """name -> flattened int64 values of every initialized int8/uint8/int32 array."""
+    src = path.read_text()
+    arrays = {}
+    for name, body in re.findall(r"const (?:u?int8_t|int32_t) (\w+)\[[^=]*=\s*\{(.*?)\};", src, re.S):
+        arrays[name] = np.array([int(v) for v in re.findall(r"-?\d+", body)], dtype=np.int64)
+    return arrays
+
+
+def read_c_define(path: Path, name: str) -> int:
+    m = re.search(rf"#define {name}\s+(-?\d+)", path.read_text())
+    if m is None:
+        raise KeyError(f"{path}: no #define {name}")
+    return int(m.group(1))
+
+
+def load_model(c_dir: Path = C_DIR):
+    """
+    Encoder weights {W_*: [rows, cols], b_*: [rows]} (and W_qk, b_qk, qk_shift
+    when exported with --fwa, lr: {q, ..., ff2: (U [rows, R], V [R, cols],
+    shift)} with --low-rank) and heads
+    {cls, exit_in, exit_attn: (W [classes, D], b [classes], margin)}.
+    """
+    arrays = read_c_arrays(c_dir / "trained_weights.c")
+    # W_q/W_k/W_v may be narrowed to their first TRAINED_WEIGHTS_D_IN columns
+    shapes = {"W_q": (D, -1), "W_k": (D, -1), "W_v": (D, -1), "W_ff1": (FFN, D), "W_ff2": (D, FFN)}
+    weights = {}
+    for key in ENCODER_KEYS:
+        values = arrays[key]
+        weights[key] = values.reshape(shapes.get(key, (D, D))) if key.startswith("W_") else values
+    if "W_qk" in arrays:
+        d_in = weights["W_q"].shape[1]
+        weights["W_qk"] = arrays["W_qk"].reshape(d_in, d_in)
+        weights["b_qk"] = arrays["b_qk"]
+        weights["qk_shift"] = read_c_define(c_dir / "trained_weights.h", "TRAINED_WEIGHTS_QK_SHIFT")
+    if "lr_u_q" in arrays:
+        rank = read_c_define(c_dir / "trained_weights.h", "TRAINED_WEIGHTS_LOW_RANK")
+        weights["lr"] = {
+            l: (arrays[f"lr_u_{l}"].reshape(-1, rank), arrays[f"lr_v_{l}"].reshape(rank, -1),
+                read_c_define(c_dir / "trained_weights.h", f"TRAINED_WEIGHTS_LR_SHIFT_{l}"))
+            for l in ("q", "k", "v", "o", "ff1", "ff2")
+        }
+
+    cls = read_c_arrays(c_dir / "demo_classifier.c")
+    header = c_dir / "demo_classifier.h"
+    heads = {}
+    for name, prefix, margin in (("cls", "cls", None),
+                                 ("exit_in", "exit_in", "DEMO_EXIT_IN_MARGIN"),
+                                 ("exit_attn", "exit_attn", "DEMO_EXIT_ATTN_MARGIN")):
+        W = cls[f"{prefix}_W"].reshape(-1, D)
+        heads[name] = (W, cls[f"{prefix}_b"], read_c_define(header, margin) if margin else None)
+    return weights, heads
+
+
+def sat8(x: np.ndarray) -> np.ndarray:
+    """saturate_int32_to_int8"""
+    return np.clip(x, -128, 127)
+
+
+def trunc_div(x: np.ndarray, n: int) -> np.ndarray:
+    """C integer division (rounds towards zero) by n > 0."""
+    return np.sign(x) * (np.abs(x) // n)
+
+
+def linear(x: np.ndarray, W: np.ndarray, b: np.ndarray) -> np.ndarray:
+    """int32 accumulators W x + b of x [..., cols]: [..., rows]."""
+    return x @ W.T + b
+
+
+def project(x: np.ndarray, weights: dict, l: str, cfg: Config) -> np.ndarray:
+    """
+    int32 accumulators of layer l (q, k, v, o, ff1, ff2): linear(), or with
+    low_rank the two passes U sat8((V x) >> shift) + b of its factors.
+    """
+    if not cfg.low_rank:
+        return linear(x, weights[f"W_{l}"], weights[f"b_{l}"])
+    U, V, shift = weights["lr"][l]
+    return sat8((x @ V.T) >> shift) @ U.T + weights[f"b_{l}"]
+
+
+def softmax_q15(scores: np.ndarray, cfg: Config) -> np.ndarray:
+    """
+    Q15 attention weights of scores [N, S, S] (already >> score_shift) as
+    attention_multi_head: exp LUT of the max-subtracted score, then the
+    division (or the reciprocal of TINYFORMER_FAST_SOFTMAX) by the row sum.
+    """
+    lut = np.array(cfg.exp_lut, dtype=np.int64)
+    last = len(cfg.exp_lut) - 1
+    if cfg.causal:
+        keep = np.tril(np.ones((S, S), dtype=bool))
+        scores = np.where(keep, scores, np.iinfo(np.int32).min)
+    shifted = scores - scores.max(axis=-1, keepdims=True)  # <= 0
+    if cfg.exp_interp:
+        neg = np.minimum(-shifted, last << cfg.exp_shift)
+        i = neg >> cfg.exp_shift
+        f = neg & ((1 << cfg.exp_shift) - 1)
+        nxt = lut[np.minimum(i + 1, last)]
+        e = lut[i] - (((lut[i] - nxt) * f) >> cfg.exp_shift)
+    else:
+        e = lut[np.minimum(-(shifted >> cfg.exp_shift), last)]
+    if cfg.causal:
+        e = np.where(keep, e, 0)
+    total = np.maximum(e.sum(axis=-1, keepdims=True), 1)
+    if cfg.fast_softmax:
+        return (e * (0x80000000 // total)) >> 16
+    return (e << 15) // total
+
+
+def softmax_exp2(scores: np.ndarray, cfg: Config):
+    """
+    (shift, live) of TINYFORMER_EXP2_SOFTMAX for scores [N, S, S], as
+    tf_exp2_row: n = min(15, (t + (t >> 1) - (t >> 4)) >> 3) of t = max - s,
+    the row sum of 2^(15 - n) rounded to 2^L, shift n + L - 15. live is 0 for
+    the keys masked by causal, 1 otherwise.
+    """
+    live = np.ones(scores.shape, dtype=np.int64)
+    if cfg.causal:
+        keep = np.tril(np.ones((S, S), dtype=bool))
+        scores = np.where(keep, scores, np.iinfo(np.int32).min)
+        live = np.where(keep, live, 0)
+    t = scores.max(axis=-1, keepdims=True) - scores  # >= 0
+    n = np.minimum((t + (t >> 1) - (t >> 4)) >> cfg.exp_shift, 15)
+    total = ((live << 15) >> n).sum(axis=-1, keepdims=True)  # >= 2^15
+    L = np.full(total.shape, 15, dtype=np.int64)
+    for _ in range(32):
+        L = L + ((total >> L) > 1)
+    L = L + ((total >> (L - 1)) & 1)
+    return n + L - 15, live
+
+
+def sparse_keys(w: np.ndarray, cfg: Config) -> np.ndarray:
+    """
+    0/1 keys of the Q15 weights w [N, S, S] that TINYFORMER_SPARSE_SOFTMAX
+    keeps, as tf_sparse_keys: w >= sparse_min_w and, with sparse_topk, fewer
+    than sparse_topk kept keys of larger weight or of equal weight before it.
+    """
+    keep = w >= cfg.sparse_min_w
+    if cfg.sparse_topk > 0:
+        wj, wk = w[:, :, :, None], w[:, :, None, :]  # [N, S, S(key j), S(key k)]
+        before = np.tril(np.ones((S, S), dtype=bool), -1)  # [j][k]: k < j
+        ahead = (wk > wj) | ((wk == wj) & before)
+        rank = (ahead & keep[:, :, None, :]).sum(axis=-1)
+        keep = keep & (rank < cfg.sparse_topk)
+    return keep.astype(np.int64)
+
+
+def linear_attention(q: np.ndarray, k: np.ndarray, v: np.ndarray, cfg: Config) -> np.ndarray:
+    """
+    attention_linear of one head, q/k/v [N, S, hd]: relu(q) . KV / relu(q) . z
+    with KV = sum_j relu(k_j) v_j^T and z = sum_j relu(k_j) over the attended
+    keys (a running sum with causal), both shifted until den < 2^24, then the
+    truncating int32 division (0 where den == 0).
+    """
+    fq, fk = np.maximum(q, 0), np.maximum(k, 0)
+    kv = fk[:, :, :, None] * v[:, :, None, :]  # [N, S(key), hd, hd]
+    if cfg.causal:
+        kv, z = kv.cumsum(axis=1), fk.cumsum(axis=1)
+    else:
+        kv, z = kv.sum(axis=1, keepdims=True), fk.sum(axis=1, keepdims=True)
+    num = (fq[:, :, :, None] * kv).sum(axis=2)  # [N, S, hd]
+    den = (fq * z).sum(axis=-1, keepdims=True)  # [N, S, 1]
+    sh = sum((den >= (1 << (24 + t))).astype(np.int64) for t in range(8))
+    num, den = num >> sh, den >> sh
+    c = np.sign(num) * (np.abs(num) // np.maximum(den, 1))
+    return sat8(np.where(den > 0, c, 0))
+
+
+def encode(x: np.ndarray, weights: dict, cfg: Config = Config()):
+    """
+    Encoder of int8 windows x [N, S, D]: (y, z), y the tokens after the
+    attention residual (where the attn exit is checked), z the output.
+    """
+    x = x.astype(np.int64)
+    rs = cfg.requant_shift
+    x_in = x[:, :, :weights["W_q"].shape[1]]
+    v = sat8(project(x_in, weights, "v", cfg) >> rs)
+    if cfg.fwa:
+        # Fused-weight attention: g . x against the block input as keys
+        g = sat8(linear(x_in, weights["W_qk"], weights["b_qk"]) >> weights["qk_shift"])
+        scores = (g @ x_in.transpose(0, 2, 1)) >> cfg.score_shift
+    else:
+        q = sat8(project(x_in, weights, "q", cfg) >> rs)
+        k = sat8(project(x_in, weights, "k", cfg) >> rs)
+    # One softmax per head over its D / attn_heads channels
+    hd = D // cfg.attn_heads
+    context = []
+    for h0 in range(0, D, hd):
+        if cfg.linear_attn:
+            context.append(linear_attention(q[:, :, h0:h0 + hd], k[:, :, h0:h0 + hd], v[:, :, h0:h0 + hd], cfg))
+            continue
+        if not cfg.fwa:
+            scores = (q[:, :, h0:h0 + hd] @ k[:, :, h0:h0 + hd].transpose(0, 2, 1)) >> cfg.score_shift
+        if cfg.exp2_softmax:
+            # Every term is v >> shift: [N, S(query), S(key), hd]
+            sh, live = softmax_exp2(scores, cfg)
+            terms = (v[:, None, :, h0:h0 + hd] >> sh[:, :, :, None]) * live[:, :, :, None]
+            context.append(sat8(terms.sum(axis=2)))
+            continue
+        w = softmax_q15(scores, cfg)
+        if cfg.sparse_softmax:
+            # Kept keys only, one >> 15 of the sum: [N, S(query), S(key), hd]
+            terms = (w * sparse_keys(w, cfg))[:, :, :, None] * v[:, None, :, h0:h0 + hd]
+            context.append(sat8(terms.sum(axis=2) >> 15))
+            continue
+        # Every w * v term is >> 15 before the sum: [N, S(query), S(key), hd]
+        context.append(sat8(((w[:, :, :, None] * v[:, None, :, h0:h0 + hd]) >> 15).sum(axis=2)))
+    context = np.concatenate(context, axis=-1)
+
+    y = sat8(x + sat8(project(context, weights, "o", cfg) >> rs))
+    if cfg.ffn_u8_hidden:
+        # uint8 hidden at half the int8 step; FF2 at twice the scale (and dense)
+        h = np.clip(project(y, weights, "ff1", cfg) >> (rs - 1), 0, 255)
+        f = sat8((h @ weights["W_ff2"].T + 2 * weights["b_ff2"]) >> (rs + 1))
+    else:
+        h = np.maximum(sat8(project(y, weights, "ff1", cfg) >> rs), 0)
+        f = sat8(project(h, weights, "ff2", cfg) >> rs)
+    z = sat8(y + f)
+    return y, z
+
+
+def head_apply(tokens: np.ndarray, head):
+    """tf_head_apply on tokens [N, S, D]: (pred, margin, logits)."""
+    W, b, _ = head
+    pooled = sat8(trunc_div(tokens.sum(axis=1) + S // 2, S))
+    logits = linear(pooled, W, b)
+    top = np.sort(logits, axis=1)
+    return logits.argmax(axis=1), top[:, -1] - top[:, -2], logits
+
+
+def cksum(z: np.ndarray) -> np.ndarray:
+    """ENC_CKSUM of output windows z [N, S, D]."""
+    return (z & 0xFF).sum(axis=(1, 2))
+
+
+def classify(x: np.ndarray, weights: dict, heads: dict, cfg: Config = Config(),
+             early_exit: bool = False):
+    """
+    tinyformer_classify (or tinyformer_classify_early with the exit heads
+    and margins of demo_classifier) of windows x [N, S, D]:
+    (pred, ENC_CKSUM of the full encoder, exit stage).
+    """
+    y, z = encode(x, weights, cfg)
+    pred, _, _ = head_apply(z, heads["cls"])
+    stage = np.full(len(x), EXIT_NONE)
+    if early_exit:
+        # exit_in is checked first in C, so it overrides exit_attn
+        for name, tokens, st in (("exit_attn", y, EXIT_ATTN), ("exit_in", x.astype(np.int64), EXIT_INPUT)):
+            label, margin, _ = head_apply(tokens, heads[name])
+            hit = margin >= heads[name][2]
+            pred = np.where(hit, label, pred)
+            stage = np.where(hit, st, stage)
+    return pred, cksum(z), stage
+
+
+def classify_batched(x: np.ndarray, weights: dict, heads: dict, cfg: Config,
+                     early_exit: bool = False, batch: int = 512):
+    """classify() in slices of batch windows (bounds the [N, S, S, D] context)."""
+    out = [classify(x[i:i + batch], weights, heads, cfg, early_exit) for i in range(0, len(x), batch)]
+    return tuple(np.concatenate([o[j] for o in out]) for j in range(3))
+
+
+def quantize_inputs(X: np.ndarray) -> np.ndarray:
+    """Float windows -> int8 encoder inputs, as export_and_make_fpga_demo.py."""
+    return np.clip(np.round(X * ACT_SCALE), -127.0, 127.0).astype(np.int64)
+
+
+def check_golden(weights: dict, heads: dict, cfg: Config, c_dir: Path,
+                 early_exit: bool = False) -> int:
+    """
+    Demo samples against golden_cksum[], printed as the demo_run() lines;
+    number of mismatches.
+    """
+    samples = read_c_arrays(c_dir / "demo_samples.c")
+    x = samples["demo_inputs"].reshape(-1, S, D)
+    table = re.search(r"golden_cksum\[[^\]]*\]\s*=\s*\{(.*?)\};", MAIN_HOST.read_text(), re.S)
+    golden = [int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]+", table.group(1))]
+    pred, sums, stage = classify(x, weights, heads, cfg, early_exit)
+    fails = 0
+    for i in range(len(x)):
+        print(f"ENC_CKSUM=0x{int(sums[i]):08X}")
+        line = f"Sample {i}: pred={int(pred[i])} exp={int(samples['demo_labels'][i])}"
+        print(line + (f" exit={STAGE_NAME[int(stage[i])]}" if early_exit else ""))
+        if int(sums[i]) != golden[i]:
+            print(f"SIM GOLDEN FAIL sample={i} ENC_CKSUM=0x{int(sums[i]):08X} expected=0x{golden[i]:08X}")
+            fails += 1
+    if fails == 0:
+        print(f"SIM GOLDEN OK samples={len(x)}")
+    return fails
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Bit-exact NumPy model of tinyformer.c.")
+    parser.add_argument("--c-dir", type=str, default=str(C_DIR),
+                        help="Directory of trained_weights.c, demo_classifier.c/.h, demo_samples.c.")
+    parser.add_argument("--check", action="store_true",
+                        help="Check the demo samples against the golden ENC_CKSUM (baseline options only).")
+    parser.add_argument("--data", type=str, default=None,
+                        help="uci_har_processed.npz: accuracy on X_test / y_test.")
+    parser.add_argument("--windows", type=str, default=None,
+                        help="Raw int8 [n][16][32] windows, as tinyformer_replay takes them.")
+    parser.add_argument("--out", type=str, default=None,
+                        help="With --windows: CSV window,pred,enc_cksum (default: stdout).")
+    parser.add_argument("--early-exit", action="store_true", help="Early exits as DEMO_EARLY_EXIT.")
+    parser.add_argument("--batch", type=int, default=512, help="Windows per vectorized step.")
+    parser.add_argument("--requant-shift", type=int, default=7, help="Linear requant shift (>> 7).")
+    parser.add_argument("--score-shift", type=int, default=None,
+                        help="Score shift before the softmax (>> 5, >> 4 with --heads > 1).")
+    parser.add_argument("--exp-shift", type=int, default=3, help="exp LUT index compress (>> 3).")
+    parser.add_argument("--exp-lut", type=str, default=None, help="Comma-separated exp LUT (Q10).")
+    parser.add_argument("--exp-interp", action="store_true", help="TINYFORMER_EXP_INTERP.")
+    parser.add_argument("--fast-softmax", action="store_true", help="TINYFORMER_FAST_SOFTMAX.")
+    parser.add_argument("--exp2-softmax", action="store_true",
+                        help="TINYFORMER_EXP2_SOFTMAX (shift-only base-2 softmax, no LUT).")
+    parser.add_argument("--causal", action="store_true", help="TINYFORMER_CAUSAL.")
+    parser.add_argument("--sparse-softmax", action="store_true", help="TINYFORMER_SPARSE_SOFTMAX.")
+    parser.add_argument("--sparse-min-w", type=int, default=256,
+                        help="TINYFORMER_SPARSE_MIN_W, smallest kept Q15 weight (default: 256).")
+    parser.add_argument("--sparse-topk", type=int, default=0,
+                        help="TINYFORMER_SPARSE_TOPK, keys kept per query (default: 0, no limit).")
+    parser.add_argument("--ffn-u8-hidden", action="store_true", help="TINYFORMER_FFN_U8_HIDDEN.")
+    parser.add_argument("--fwa", action="store_true", help="TINYFORMER_FWA (weights exported with --fwa).")
+    parser.add_argument("--heads", type=int, default=1, help="TINYFORMER_HEADS (attention heads).")
+    parser.add_argument("--linear-attn", action="store_true", help="TINYFORMER_LINEAR_ATTN.")
+    parser.add_argument("--low-rank", action="store_true",
+                        help="TINYFORMER_LOW_RANK (weights exported with --low-rank R).")
+    args = parser.parse_args()
+    if not (args.check or args.data or args.windows):
+        parser.error("nothing to do: give --check, --data or --windows")
+
+    cfg = Config(requant_shift=args.requant_shift, score_shift=args.score_shift,
+                 exp_shift=args.exp_shift, exp_interp=args.exp_interp,
+                 fast_softmax=args.fast_softmax, exp2_softmax=args.exp2_softmax, causal=args.causal,
+                 sparse_softmax=args.sparse_softmax, sparse_min_w=args.sparse_min_w,
+                 sparse_topk=args.sparse_topk,
+                 ffn_u8_hidden=args.ffn_u8_hidden, fwa=args.fwa, attn_heads=args.heads,
+                 linear_attn=args.linear_attn, low_rank=args.low_rank)
+    if args.exp_lut:
+        cfg.exp_lut = tuple(int(v) for v in args.exp_lut.split(","))
+    c_dir = Path(args.c_dir)
+    weights, heads = load_model(c_dir)
+    if args.fwa and "W_qk" not in weights:
+        parser.error(f"--fwa: no W_qk in {c_dir / 'trained_weights.c'} (export with --fwa)")
+    if args.low_rank and "lr" not in weights:
+        parser.error(f"--low-rank: no lr_u_q in {c_dir / 'trained_weights.c'} (export with --low-rank R)")
+    if args.linear_attn and args.fwa:
+        parser.error("--linear-attn: relu(Q) and relu(K) do not fold into W_qk (no --fwa)")
+    if args.exp2_softmax and (args.linear_attn or args.exp_interp or args.fast_softmax):
+        parser.error("--exp2-softmax: no LUT exp or Q15 normalize (no --linear-attn, --exp-interp, --fast-softmax)")
+    if args.sparse_softmax and (args.linear_attn or args.exp2_softmax):
+        parser.error("--sparse-softmax: needs a Q15 weight row (no --linear-attn, --exp2-softmax)")
+    if args.heads < 1 or D % (4 * args.heads) != 0 or (args.heads > 1 and args.fwa):
+        parser.error(f"--heads {args.heads}: D / heads must be a multiple of 4 (single head with --fwa)")
+    status = 0
+
+    if args.check:
+        status |= check_golden(weights, heads, cfg, c_dir, args.early_exit) != 0
+
+    if args.windows:
+        x = np.fromfile(args.windows, dtype=np.int8).reshape(-1, S, D)
+        pred, sums, _ = classify_batched(x, weights, heads, cfg, args.early_exit, args.batch)
+        rows = "".join(f"{i},{int(p)},0x{int(c):08X}\n" for i, (p, c) in enumerate(zip(pred, sums)))
+        text = "window,pred,enc_cksum\n" + rows
+        if args.out:
+            Path(args.out).write_text(text)
+        else:
+            sys.stdout.write(text)
+
+    if args.data:
+        data = np.load(args.data)
+        x = quantize_inputs(data["X_test"].astype(np.float32))
+        labels = data["y_test"].astype(np.int64)
+        pred, _, stage = classify_batched(x, weights, heads, cfg, args.early_exit, args.batch)
+        print(f"SIM windows={len(x)} acc={float((pred == labels).mean()):.4f}", end="")
+        if args.early_exit:
+            print(f" exit_in={int((stage == EXIT_INPUT).sum())}"
+                  f" exit_attn={int((stage == EXIT_ATTN).sum())}", end="")
+        print()
+
+    sys.exit(status)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+Compressed weight images for the firmware's streaming decoder
+(litex_port/common/weight_codec.h): one canonical Huffman code per image
+over its bytes, or over their per-row differences (--mode delta), with codes
+of at most 12 bits. Compressing a weight-store flash image
+(export_weights.py --flash-image) compresses each layer image separately, so
+the store can still expand one layer at a time (tf_store_init_compressed()).
+
+The image is a 48-byte header (magic "TFWZ", version, mode, raw and total
+size, CRC-32 of the raw bytes, row size, symbol count, codes per length),
+the symbols in code order and the code bits (MSB first, packed from the LSB
+of each byte), padded to a word. --mode auto (default) keeps the smaller of
+plain and delta.
+
+Usage (from repo root):
+  python3 tools/weight_codec.py layers.bin -o layers.tfwz
+      every TF_STORE_LAYER_BYTES layer of a flash image, back to back
+  python3 tools/weight_codec.py blob.bin -o blob.tfwz --layer-bytes 0
+      the whole file as one image
+  python3 tools/weight_codec.py layers.tfwz --decode -o layers.bin
+The encoder is pure Python (no torch / numpy); export_weights.py --compress
+uses it for --flash-image.
+"""
+
+import argparse
+import heapq
+import struct
+import zlib
+from pathlib import Path
+
+WZ_MAGIC = 0x5A574654  # "TFWZ"
+WZ_VERSION = 1
+WZ_MAX_LEN = 12
+WZ_PLAIN, WZ_DELTA = 0, 1
+WZ_HEADER = struct.Struct("<IHBBIIIHH12H")
+
+# TF_STORE_LAYER_BYTES of the default shape (S=16, D=32, FFN=64)
+D = 32
+FFN = 64
+STORE_LAYER_BYTES = (4 * D * D + 2 * FFN * D + 5 * D + FFN + 3) & ~3
+
+
+def symbols_of(data: bytes, mode: int, row_bytes: int) -> bytes:
+    if mode == WZ_PLAIN:
+        return bytes(data)
+    out = bytearray(len(data))
+    for i, b in enumerate(data):
+        prev = data[i - 1] if i % row_bytes else 0
+        out[i] = (b - prev) & 0xFF
+    return bytes(out)
+
+
+def code_lengths(freq: dict) -> dict:
+    """Huffman code lengths of the symbols in freq, at most WZ_MAX_LEN bits."""
+    if len(freq) == 1:
+        return {next(iter(freq)): 1}
+    weights = dict(freq)
+    while True:
+        heap = [(w, n, (s,)) for n, (s, w) in enumerate(sorted(weights.items()))]
+        heapq.heapify(heap)
+        depth = dict.fromkeys(weights, 0)
+        tie = len(heap)
+        while len(heap) > 1:
+            w0, _, a = heapq.heappop(heap)
+            w1, _, b = heapq.heappop(heap)
+            for s in a + b:
+                depth[s] += 1
+            heapq.heappush(heap, (w0 + w1, tie, a + b))
+            tie += 1
+        if max(depth.values()) <= WZ_MAX_LEN:
+            return depth
+        # Flatten the distribution until the longest code fits.
+        weights = {s: (w + 1) // 2 for s, w in weights.items()}
+
+
+def canonical_codes(lengths: dict):
+    """(symbols in code order, counts per length, symbol -> (code, length))."""
+    order = sorted(lengths, key=lambda s: (lengths[s], s))
+    counts = [0] * WZ_MAX_LEN
+    codes = {}
+    code, prev_len = 0, 1
+    for s in order:
+        code <<= lengths[s] - prev_len
+        prev_len = lengths[s]
+        codes[s] = (code, prev_len)
+        counts[prev_len - 1] += 1
+        code += 1
+    return bytes(order), counts, codes
+
+
+def encode(data: bytes, mode: int = WZ_PLAIN, row_bytes: int = D) -> bytes:
+    """One compressed image of data."""
+    syms = symbols_of(data, mode, row_bytes)
+    freq = {}
+    for s in syms:
+        freq[s] = freq.get(s, 0) + 1
+    if not freq:
+        freq[0] = 1
+    order, counts, codes = canonical_codes(code_lengths(freq))
+    bits = bytearray()
+    acc = n = 0
+    for s in syms:
+        code, length = codes[s]
+        for k in range(length - 1, -1, -1):
+            acc |= ((code >> k) & 1) << n
+            n += 1
+            if n == 8:
+                bits.append(acc)
+                acc = n = 0
+    if n:
+        bits.append(acc)
+    body = order + bytes(bits)
+    total = WZ_HEADER.size + len(body)
+    body += b"\0" * (-total % 4)
+    total += -total % 4
+    header = WZ_HEADER.pack(WZ_MAGIC, WZ_VERSION, mode, 0, len(data), total,
+                            zlib.crc32(data) & 0xFFFFFFFF, row_bytes, len(order), *counts)
+    return header + body
+
+
+def compress(data: bytes, mode: str = "auto", row_bytes: int = D) -> bytes:
+    """encode() in mode "plain", "delta" or "auto" (the smaller of the two)."""
+    if mode == "plain":
+        return encode(data, WZ_PLAIN, row_bytes)
+    if mode == "delta":
+        return encode(data, WZ_DELTA, row_bytes)
+    return min((encode(data, m, row_bytes) for m in (WZ_PLAIN, WZ_DELTA)), key=len)
+
+
+def compress_layers(data: bytes, layer_bytes: int = STORE_LAYER_BYTES, mode: str = "auto",
+                    row_bytes: int = D) -> bytes:
+    """Each layer_bytes layer of data compressed on its own, back to back."""
+    if layer_bytes <= 0:
+        return compress(data, mode, row_bytes)
+    if len(data) % layer_bytes:
+        raise ValueError(f"{len(data)} bytes is not a whole number of {layer_bytes}-byte layers")
+    return b"".join(compress(data[i:i + layer_bytes], mode, row_bytes)
+                    for i in range(0, len(data), layer_bytes))
+
+
+def decode(image: bytes) -> bytes:
+    """The raw bytes of back-to-back compressed images (checks the CRC)."""
+    out = bytearray()
+    pos = 0
+    while pos < len(image):
+        (magic, version, mode, _, raw, total, crc, row_bytes, n_sym,
+         *counts) = WZ_HEADER.unpack_from(image, pos)
+        if magic != WZ_MAGIC or version != WZ_VERSION:
+            raise ValueError(f"offset {pos}: not a compressed weight image")
+        syms = image[pos + WZ_HEADER.size:pos + WZ_HEADER.size + n_sym]
+        bits = image[pos + WZ_HEADER.size + n_sym:pos + total]
+        raw_out = bytearray()
+        bit = 0
+        prev = 0
+        while len(raw_out) < raw:
+            code = first = index = 0
+            for count in counts:
+                code |= (bits[bit >> 3] >> (bit & 7)) & 1
+                bit += 1
+                if code - count < first:
+                    break
+                index += count
+                first = (first + count) << 1
+                code <<= 1
+            else:
+                raise ValueError(f"offset {pos}: corrupt code bits")
+            s = syms[index + code - first]
+            if len(raw_out) % row_bytes == 0:
+                prev = 0
+            prev = (prev + s) & 0xFF if mode == WZ_DELTA else s
+            raw_out.append(prev)
+        if zlib.crc32(raw_out) & 0xFFFFFFFF != crc:
+            raise ValueError(f"offset {pos}: CRC mismatch")
+        out += raw_out
+        pos += total
+    return bytes(out)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Compress weight images for the firmware's row decoder.")
+    parser.add_argument("input", type=str, help="Raw image (or a compressed one with --decode).")
+    parser.add_argument("-o", "--output", type=str, required=True, help="Output file.")
+    parser.add_argument("--layer-bytes", type=int, default=STORE_LAYER_BYTES,
+                        help=f"Bytes per separately compressed layer (default {STORE_LAYER_BYTES}, "
+                             "TF_STORE_LAYER_BYTES; 0 for one image).")
+    parser.add_argument("--row-bytes", type=int, default=D, help="Delta row / decoder row size (default 32).")
+    parser.add_argument("--mode", choices=("auto", "plain", "delta"), default="auto", help="Code bytes or deltas.")
+    parser.add_argument("--decode", action="store_true", help="Expand a compressed image instead.")
+    args = parser.parse_args()
+    if not 1 <= args.row_bytes <= 0xFFFF:
+        parser.error("--row-bytes must be 1 ... 65535")
+
+    data = Path(args.input).read_bytes()
+    try:
+        out = decode(data) if args.decode else compress_layers(data, args.layer_bytes, args.mode, args.row_bytes)
+    except (ValueError, IndexError, struct.error) as e:
+        parser.error(f"{args.input}: {e or 'truncated image'}")
+    Path(args.output).write_bytes(out)
+    raw, packed = (len(out), len(data)) if args.decode else (len(data), len(out))
+    print(f"{args.input}: {raw} raw bytes, {packed} compressed ({raw / max(packed, 1):.2f}x)")
+
+
+if __name__ == "__main__":
+    main()
@@ -6,6 +6,13 @@ This script:
   1) Runs tools/export_weights.py on artifacts/state_dict.pt to generate:
        - litex_port/trained_weights.h
        - litex_port/trained_weights.c
+     and artifacts/model.blob, the same model plus the classifier heads of
+     artifacts/classifier.npz as one model blob (litex_port/common/model_blob.h)
+     for firmware that loads its model at boot (make MODEL_BLOB=...).
+     With distilled students (train_tinyformer_uci_har.py --distill) it also
+     exports artifacts/tiers/<tier>/model.blob and packs them after
+     artifacts/model.blob into artifacts/model_tiers.blob, the tier pack of
+     litex_port/common/model_tiers.h (make TIERS=1 MODEL_BLOB=...).
   2) Loads data/uci_har_processed/uci_har_processed.npz and selects a small set of test samples.
   3) Quantizes these samples to int8 using a global scale factor.
   4) Writes:
@@ -20,19 +27,44 @@ This script:
      containing:
        const int8_t cls_W[6][32];
        const int8_t cls_b[6];
+     and the early-exit heads (exit_in_W/b, exit_attn_W/b, same shapes) with
+     their DEMO_EXIT_*_MARGIN thresholds; artifacts without exit heads export
+     copies of the classifier with exits disabled.
+  6) Writes litex_port/common/imu_features_norm.c, the train mean/std of the
+     processed data as the fixed-point normalization of the device feature
+     stage (imu_features.h, preprocess_uci_har.fixed_norm).
+  7) With --c-check, builds the model of litex_port/common/ (the sources the
+     firmware compiles; a warning names the exported files that differ from
+     them) into the host shared library (make -C litex_port pylib) and runs
+     the whole test split through the C encoder (tools/tinyformer_c.py): the
+     accuracy of the firmware's integer path and the demo samples' ENC_CKSUM,
+     the golden_cksum[] values of litex_port/host/main_host.c for this model,
+     before any firmware is built.
 """
 
+import argparse
 import subprocess
+import sys
 from pathlib import Path
 
 import numpy as np
 
+from preprocess_uci_har import fixed_norm
+
 
 S = 16
 D = 32
 N_CLASSES = 6
 DEMO_NUM_SAMPLES = 10
 
+# Margin that never triggers an exit (int32 max).
+EXIT_DISABLED = 0x7FFFFFFF
+
+# Distilled tiers after the large model in the pack (model_tiers.h), and
+# the blob alignment of a pack entry (TF_BLOB_ALIGN).
+TIERS = ["medium", "small"]
+BLOB_ALIGN = 16
+
 
 def run_export_weights(repo_root: Path) -> None:
     ckpt = repo_root / "artifacts" / "state_dict.pt"
@@ -46,10 +78,36 @@ def run_export_weights(repo_root: Path) -> None:
         "--output-dir",
         "litex_port",
     ]
+    clf = repo_root / "artifacts" / "classifier.npz"
+    if clf.exists():
+        cmd += ["--blob", str(repo_root / "artifacts" / "model.blob"), "--classifier", str(clf)]
     print("Running:", " ".join(cmd))
     subprocess.check_call(cmd, cwd=repo_root)
 
 
+def write_tier_pack(repo_root: Path) -> None:
+    """Export the distilled tiers and pack them after artifacts/model.blob."""
+    art = repo_root / "artifacts"
+    tiers = [t for t in TIERS if (art / "tiers" / t / "state_dict.pt").exists()]
+    if not tiers or not (art / "model.blob").exists():
+        return
+    blobs = [art / "model.blob"]
+    for t in tiers:
+        d = art / "tiers" / t
+        cmd = ["python3", str(repo_root / "tools" / "export_weights.py"),
+               "--checkpoint", str(d / "state_dict.pt"), "--output-dir", str(d),
+               "--blob", str(d / "model.blob"), "--classifier", str(d / "classifier.npz")]
+        print("Running:", " ".join(cmd))
+        subprocess.check_call(cmd, cwd=repo_root)
+        blobs.append(d / "model.blob")
+    pack = bytearray()
+    for b in blobs:
+        pack += b.read_bytes()
+        pack += bytes(-len(pack) % BLOB_ALIGN)
+    (art / "model_tiers.blob").write_bytes(bytes(pack))
+    print(f"Wrote {len(pack)}-byte tier pack (large + {', '.join(tiers)}) to {art / 'model_tiers.blob'}")
+
+
 def select_demo_indices(y_test: np.ndarray) -> np.ndarray:
     """Select ~DEMO_NUM_SAMPLES test indices, attempting to cover all classes."""
     indices_per_class = {c: [] for c in range(N_CLASSES)}
@@ -136,7 +194,28 @@ def quantize_classifier(W_cls: np.ndarray, b_cls: np.ndarray, scale: float = 32.
     return Wq, bq
 
 
-def write_demo_classifier(repo_root: Path, Wq: np.ndarray, bq: np.ndarray) -> None:
+def quantize_exit_margin(margin: float, scale: float = 32.0) -> int:
+    """
+    Float logit margin -> int32 logit units of the C head: weights and inputs
+    are both scaled by `scale`, so W.x comes out scaled by scale^2.
+    """
+    if not np.isfinite(margin):
+        return EXIT_DISABLED
+    return int(min(np.ceil(margin * scale * scale), EXIT_DISABLED))
+
+
+def write_head(f, name: str, Wq: np.ndarray, bq: np.ndarray) -> None:
+    f.write(f"const int8_t {name}_W[DEMO_NUM_CLASSES][DEMO_D] = {{\n")
+    for c in range(Wq.shape[0]):
+        row = ", ".join(str(int(v)) for v in Wq[c, :])
+        f.write(f"    {{ {row} }},\n")
+    f.write("};\n\n")
+    b_str = ", ".join(str(int(v)) for v in bq)
+    f.write(f"const int8_t {name}_b[DEMO_NUM_CLASSES] = {{ {b_str} }};\n")
+
+
+def write_demo_classifier(repo_root: Path, Wq: np.ndarray, bq: np.ndarray,
+                          exits: dict) -> None:
     litex_dir = repo_root / "litex_port"
     h_path = litex_dir / "demo_classifier.h"
     c_path = litex_dir / "demo_classifier.c"
@@ -148,8 +227,20 @@ def write_demo_classifier(repo_root: Path, Wq: np.ndarray, bq: np.ndarray) -> No
             "#include <stdint.h>\n\n"
             "#define DEMO_NUM_CLASSES 6\n"
             "#define DEMO_D 32\n\n"
+            "// Early-exit heads (tinyformer_classify_early): a head exits when its\n"
+            "// top-1 logit leads the runner-up by at least its margin (int32 max: off).\n"
+            "#ifndef DEMO_EXIT_IN_MARGIN\n"
+            f"#define DEMO_EXIT_IN_MARGIN {exits['exit_in'][2]}\n"
+            "#endif\n"
+            "#ifndef DEMO_EXIT_ATTN_MARGIN\n"
+            f"#define DEMO_EXIT_ATTN_MARGIN {exits['exit_attn'][2]}\n"
+            "#endif\n\n"
             "extern const int8_t cls_W[DEMO_NUM_CLASSES][DEMO_D];\n"
-            "extern const int8_t cls_b[DEMO_NUM_CLASSES];\n\n"
+            "extern const int8_t cls_b[DEMO_NUM_CLASSES];\n"
+            "extern const int8_t exit_in_W[DEMO_NUM_CLASSES][DEMO_D];\n"
+            "extern const int8_t exit_in_b[DEMO_NUM_CLASSES];\n"
+            "extern const int8_t exit_attn_W[DEMO_NUM_CLASSES][DEMO_D];\n"
+            "extern const int8_t exit_attn_b[DEMO_NUM_CLASSES];\n\n"
             "#endif // DEMO_CLASSIFIER_H\n"
         )
 
@@ -159,23 +250,59 @@ def write_demo_classifier(repo_root: Path, Wq: np.ndarray, bq: np.ndarray) -> No
             '#include "demo_classifier.h"\n\n'
         )
 
-        # Weights
-        f.write("const int8_t cls_W[DEMO_NUM_CLASSES][DEMO_D] = {\n")
-        for c in range(Wq.shape[0]):
-            row = ", ".join(str(int(v)) for v in Wq[c, :])
-            f.write(f"    {{ {row} }},\n")
-        f.write("};\n\n")
+        write_head(f, "cls", Wq, bq)
+        for name in ("exit_in", "exit_attn"):
+            f.write("\n")
+            write_head(f, name, exits[name][0], exits[name][1])
+
 
-        # Biases
-        b_str = ", ".join(str(int(v)) for v in bq)
-        f.write(f"const int8_t cls_b[DEMO_NUM_CLASSES] = {{ {b_str} }};\n")
+def write_imu_norm(repo_root: Path, mean: np.ndarray, std: np.ndarray) -> None:
+    off, mul = fixed_norm(mean, std, scale=32.0)
+    c_path = repo_root / "litex_port" / "common" / "imu_features_norm.c"
+
+    with c_path.open("w") as f:
+        f.write(
+            '#include <stdint.h>\n'
+            '#include "imu_features.h"\n\n'
+            "// Training mean / std of the UCI HAR features (imu_features.h)\n"
+        )
+        for name, values in (("imu_norm_off", off), ("imu_norm_mul", mul)):
+            vals = ", ".join(str(int(v)) for v in values)
+            f.write(f"const int32_t {name}[IMU_FEAT_FEATURES] = {{ {vals} }};\n")
+
+
+def c_check(repo_root: Path, X_test_q: np.ndarray, y_test: np.ndarray, X_demo_q: np.ndarray) -> None:
+    """The exported model through the C encoder (tools/tinyformer_c.py)."""
+    litex_dir = repo_root / "litex_port"
+    for name in ("trained_weights", "demo_classifier", "demo_samples"):
+        for ext in (".c", ".h"):
+            out, built = litex_dir / (name + ext), litex_dir / "common" / (name + ext)
+            if out.exists() and (not built.exists() or out.read_bytes() != built.read_bytes()):
+                print(f"C_CHECK warning: {out} differs from {built}, which the firmware and "
+                      f"this check build; copy it there first")
+    cmd = ["make", "-C", str(litex_dir), "pylib"]
+    print("Running:", " ".join(cmd))
+    subprocess.check_call(cmd, cwd=repo_root)
+    sys.path.insert(0, str(repo_root / "tools"))
+    from tinyformer_c import TinyFormerC
+
+    tf = TinyFormerC()
+    pred, _ = tf.classify(X_test_q)
+    print(f"C_CHECK windows={len(y_test)} acc={float((pred == y_test).mean()):.4f}")
+    _, sums = tf.classify(X_demo_q)
+    print("C_CHECK golden_cksum = {" + ", ".join(f"0x{int(c):08X}" for c in sums) + "}")
 
 
 def main() -> None:
+    parser = argparse.ArgumentParser(description="Export the trained model and the FPGA demo sources.")
+    parser.add_argument("--c-check", action="store_true",
+                        help="Then run the test split through the C encoder (needs a C compiler and cffi).")
+    args = parser.parse_args()
     repo_root = Path(__file__).resolve().parents[1]
 
     # 1) Export TinyFormer encoder weights to C.
     run_export_weights(repo_root)
+    write_tier_pack(repo_root)
 
     # 2) Load processed data and select demo samples.
     data_path = repo_root / "data" / "uci_har_processed" / "uci_har_processed.npz"
@@ -199,9 +326,24 @@ def main() -> None:
     b_cls = clf["b_cls"]  # [6]
 
     Wq, bq = quantize_classifier(W_cls, b_cls, scale=32.0)
-    write_demo_classifier(repo_root, Wq, bq)
+    exits = {}
+    for name in ("exit_in", "exit_attn"):
+        if f"W_{name}" in clf:
+            We, be = quantize_classifier(clf[f"W_{name}"], clf[f"b_{name}"], scale=32.0)
+            exits[name] = (We, be, quantize_exit_margin(float(clf[f"margin_{name}"])))
+        else:
+            exits[name] = (Wq, bq, EXIT_DISABLED)
+    write_demo_classifier(repo_root, Wq, bq, exits)
     print("Wrote demo_classifier.c/h")
 
+    # 5) Normalization of the device feature stage.
+    write_imu_norm(repo_root, data["mean"], data["std"])
+    print("Wrote imu_features_norm.c")
+
+    # 7) The built model on the C encoder.
+    if args.c_check:
+        c_check(repo_root, quantize_inputs(X_test, scale=32.0), y_test, X_demo_q)
+
 
 if __name__ == "__main__":
     main()
@@ -25,16 +25,38 @@ Per-timestep feature vector (D = 32):
   11..13 : delta gyro  (gx, gy, gz) vs previous timestep (0 at t=0)
   14..31 : zero padding
 
+The arrays are also written uncompressed, one .npy per key, to
+data/uci_har_processed/cache/. load_processed() memory-maps them from there,
+so a training run (or each of a sweep's hundreds) skips the zip inflate of
+the npz; `--cache` builds the cache from an existing npz, and it is rebuilt
+whenever the npz is newer.
+
 Time axis is downsampled from 128 -> 16 using average pooling over 8-step chunks.
 Features are z-scored using train mean/std (computed over all train samples and
 timesteps, per feature) and the same normalization is applied to test.
+
+features_fixed() is the integer version of the device feature stage
+(litex_port/common/imu_features.c), which runs on raw samples in the
+firmware. `--fixed-check N --raw-out R --tokens-out T` writes the first N
+test windows as raw int16 Q12 samples [N][128][6] and their int8 tokens
+[N][16][32] for the host check (make feat-check), and reports how often they
+equal the quantized float features.
 """
 
+import argparse
+import math
 from pathlib import Path
 
 import numpy as np
 
 
+# Device feature stage: raw samples in Q12, pooled sums of 8 as Q15 means,
+# normalization (f - off) * mul >> NORM_SHIFT straight into the int8 inputs.
+RAW_FRAC_BITS = 12
+NORM_SHIFT = 24
+N_FEATURES = 14
+
+
 def load_inertial_set(base: Path, split: str):
     sig_dir = base / split / "Inertial Signals"
     fnames = [
@@ -117,9 +139,122 @@ def downsample_and_features(raw: np.ndarray) -> np.ndarray:
     return feats
 
 
+def quantize_raw(raw: np.ndarray) -> np.ndarray:
+    """raw: [N, 6, 128] float -> int16 Q12, as the board driver delivers it."""
+    scaled = np.round(raw.astype(np.float64) * (1 << RAW_FRAC_BITS))
+    return np.clip(scaled, -32768, 32767).astype(np.int16)
+
+
+def fixed_norm(mean: np.ndarray, std: np.ndarray, scale: float = 32.0):
+    """
+    Per-feature offset (Q15) and multiplier of the device normalization, from
+    the train mean/std and the int8 input scale of the demo export.
+    """
+    mean = mean.reshape(-1)[:N_FEATURES].astype(np.float64)
+    std = std.reshape(-1)[:N_FEATURES].astype(np.float64)
+    off = np.round(mean * (1 << 15)).astype(np.int64)
+    mul = np.round(scale / std * (1 << (NORM_SHIFT - 15))).astype(np.int64)
+    return off, mul
+
+
+def cache_dir(data_path: Path) -> Path:
+    return data_path.parent / "cache"
+
+
+def build_cache(data_path: Path) -> Path:
+    """Write every array of the npz at data_path as cache/<key>.npy."""
+    cache = cache_dir(data_path)
+    cache.mkdir(parents=True, exist_ok=True)
+    with np.load(data_path) as data:
+        keys = list(data.files)
+        for k in keys:
+            tmp = cache / f"{k}.npy.tmp"
+            with open(tmp, "wb") as fh:
+                np.save(fh, np.ascontiguousarray(data[k]))
+            tmp.replace(cache / f"{k}.npy")
+    # Written last: a cache with its key list is complete.
+    (cache / "keys.txt").write_text("\n".join(keys) + "\n")
+    return cache
+
+
+def load_processed(data_path: Path) -> dict:
+    """
+    The arrays of the npz at data_path by key, memory-mapped read-only from
+    its .npy cache, which is (re)built first if missing or older than the npz.
+    """
+    cache = cache_dir(data_path)
+    keys_file = cache / "keys.txt"
+    if not keys_file.exists() or keys_file.stat().st_mtime < data_path.stat().st_mtime:
+        build_cache(data_path)
+    keys = keys_file.read_text().split()
+    return {k: np.load(cache / f"{k}.npy", mmap_mode="r") for k in keys}
+
+
+def features_fixed(raw_q: np.ndarray, off: np.ndarray, mul: np.ndarray) -> np.ndarray:
+    """
+    raw_q: [N, 6, 128] int16 Q12 -> [N, 16, 32] int8, bit-exact with
+    imu_feat_window() in litex_port/common/imu_features.c.
+    """
+    N, C, T = raw_q.shape
+    assert C == 6 and T == 128
+
+    # Sums of 8 Q12 samples are the pooled means in Q15: [N, 16, 6]
+    pooled = raw_q.astype(np.int64).reshape(N, C, 16, 8).sum(axis=-1)
+    pooled = np.transpose(pooled, (0, 2, 1))
+
+    feats = np.zeros((N, 16, N_FEATURES), dtype=np.int64)
+    feats[:, :, 0:6] = pooled
+    for k, lo in enumerate((0, 3)):
+        sq = (pooled[:, :, lo:lo + 3] ** 2).sum(axis=-1)
+        feats[:, :, 6 + k] = np.array([math.isqrt(int(v)) for v in sq.reshape(-1)],
+                                      dtype=np.int64).reshape(N, 16)
+    feats[:, 1:, 8:14] = pooled[:, 1:] - pooled[:, :-1]
+
+    q = ((feats - off) * mul + (1 << (NORM_SHIFT - 1))) >> NORM_SHIFT
+    out = np.zeros((N, 16, 32), dtype=np.int8)
+    out[:, :, :N_FEATURES] = np.clip(q, -127, 127)
+    return out
+
+
+def fixed_check(uci_root: Path, data_path: Path, n: int, raw_out: Path, tokens_out: Path) -> None:
+    test_raw = load_inertial_set(uci_root, "test")[:n]  # [n, 6, 128]
+    data = np.load(data_path)
+    mean, std = data["mean"], data["std"]
+
+    raw_q = quantize_raw(test_raw)
+    tokens = features_fixed(raw_q, *fixed_norm(mean, std))
+    np.ascontiguousarray(np.transpose(raw_q, (0, 2, 1))).astype("<i2").tofile(raw_out)
+    tokens.tofile(tokens_out)
+
+    # Offline float pipeline, quantized as export_and_make_fpga_demo.py does
+    ref = np.clip(np.round((downsample_and_features(test_raw) - mean) / std * 32.0), -127, 127)
+    diff = np.abs(tokens.astype(np.int64) - ref.astype(np.int64))
+    print(f"FEAT windows={len(tokens)} equal={float((diff == 0).mean()) * 100:.2f}% "
+          f"max_diff={int(diff.max())}")
+
+
 def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--fixed-check", type=int, metavar="N",
+                        help="write N test windows for the device feature check instead")
+    parser.add_argument("--raw-out", type=Path, help="--fixed-check raw samples file")
+    parser.add_argument("--tokens-out", type=Path, help="--fixed-check tokens file")
+    parser.add_argument("--cache", action="store_true",
+                        help="only (re)build the memory-mapped cache of an existing npz")
+    args = parser.parse_args()
+
     repo_root = Path(__file__).resolve().parents[1]
     uci_root = repo_root / "data" / "uci_har_raw" / "UCI HAR Dataset"
+    out_path = repo_root / "data" / "uci_har_processed" / "uci_har_processed.npz"
+
+    if args.fixed_check:
+        if args.raw_out is None or args.tokens_out is None:
+            parser.error("--fixed-check needs --raw-out and --tokens-out")
+        fixed_check(uci_root, out_path, args.fixed_check, args.raw_out, args.tokens_out)
+        return
+    if args.cache:
+        print(f"Cached {out_path} in {build_cache(out_path)}")
+        return
 
     train_raw = load_inertial_set(uci_root, "train")  # [N_train, 6, 128]
     test_raw = load_inertial_set(uci_root, "test")    # [N_test, 6, 128]
@@ -145,7 +280,6 @@ def main() -> None:
     X_train_norm = (X_train - mean) / std
     X_test_norm = (X_test - mean) / std
 
-    out_path = repo_root / "data" / "uci_har_processed" / "uci_har_processed.npz"
     out_path.parent.mkdir(parents=True, exist_ok=True)
     np.savez_compressed(
         out_path,
@@ -156,7 +290,7 @@ def main() -> None:
         mean=mean.astype(np.float32),
         std=std.astype(np.float32),
     )
-    print(f"Saved preprocessed data to {out_path}")
+    print(f"Saved preprocessed data to {out_path} (cache: {build_cache(out_path)})")
     print(f"Train shape: {X_train_norm.shape}, Test shape: {X_test_norm.shape}")
 
 
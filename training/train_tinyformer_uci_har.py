@@ -9,20 +9,112 @@ Input:
 Output:
   artifacts/state_dict.pt   -- contains ONLY the TinyFormer encoder weights with
                                keys: W_q, W_k, W_v, W_o, W_ff1, W_ff2,
-                                     b_q, b_k, b_v, b_o, b_ff1, b_ff2
+                                     b_q, b_k, b_v, b_o, b_ff1, b_ff2,
+                                     heads (attention head count),
+                                     linear_attn (1 with --linear-attn)
   artifacts/classifier.npz  -- classifier head weights:
                                W_cls [6, 32], b_cls [6]
+                               and the early-exit heads (see train_exit_heads):
+                               W_exit_in/W_exit_attn [6, 32],
+                               b_exit_in/b_exit_attn [6],
+                               margin_exit_in/margin_exit_attn (float logits)
+
+With --qat the model is trained quantization-aware against the integer
+encoder of litex_port/common/tinyformer.c (default build: no per-channel
+requant, LUT softmax without TINYFORMER_EXP_INTERP): the forward pass runs on
+int8 tokens, x_int8 = clip(round(x * 32), -127, 127), with int8 weights and
+biases, sat8(acc >> 7) after every linear, scores >> 5, the 16-entry exp LUT
+indexed by (score - max) >> 3, Q15 weights (e << 15) / sum, the per-term
+>> 15 context, saturating residuals and the head on the rounded mean pool.
+Rounding, flooring and the LUT use straight-through gradients. The exported
+tensors are then already integers (state_dict.pt holds round(W * W_SCALE),
+which tools/export_weights.py keeps as is) and the classifier and exit heads
+keep the scale-32 convention of export_and_make_fpga_demo.py, so the C
+encoder reproduces the trained forward pass bit for bit.
+
+With --heads H the attention splits into H heads of D / H channels
+(TINYFORMER_HEADS=H in the C build; D / H a multiple of 4), each with its own
+softmax; the QAT scores of a multi-head model are >> 4 instead of >> 5
+(TINYFORMER_SCORE_SHIFT).
+
+With --linear-attn the softmax attention is replaced by linear attention with
+a ReLU feature map, context = relu(q) (relu(K)^T V) / (relu(q) . sum_j
+relu(k_j)), for long windows (TINYFORMER_LINEAR_ATTN=1 in the C build, O(S D^2)
+instead of O(S^2 D)). With --qat the numerator and denominator are the int64 /
+int32 sums of tinyformer.c, shifted until the denominator is below 2^24, and
+the context is their truncating division.
+
+With --layers N the encoder is a stack of N blocks (tinyformer_stack_encode
+in C), and --token-pool K0,K1,... (one stride per layer, default all 1)
+averages every K_l adjacent tokens before layer l, so later layers run on
+S / 2, S / 4, ... tokens (tinyformer_stack_encode_pooled, TINYFORMER_TOKEN_POOL
+=1). With --qat the mean of a group of m tokens is floor((sum + m / 2) / m), as
+in C. Layer 0 is written to artifacts/state_dict.pt and layer l > 0 to
+artifacts/state_dict_l<l>.pt (one tools/export_weights.py --flash-image each),
+and every layer carries its stride as "token_pool".
+
+With --share-layers (and --layers N) the stack shares its weight matrices
+across layers, ALBERT-style: every layer's projections and FFN use layer 0's
+W_*, while each layer keeps its own biases, unless --share-bias shares those
+too. The per-layer state dicts are still written, layers l > 0 marked
+"shared"; tools/export_weights.py --checkpoint state_dict.pt --shared-layers
+state_dict_l1.pt,... emits the matrices once plus each layer's own biases for
+tinyformer_share_layers() (TINYFORMER_SHARED_LAYERS=1).
+
+With --search the script trains no deployment model. It sweeps the grid of
+--search-d, --search-ffn, --search-heads, --search-s and --search-bits, and
+trains every candidate for --search-epochs (float, same seed and data).
+Shapes other than today's are fed as the firmware would be built for them:
+  - D < 32 keeps the first D input channels (the 14 live features fit in 16);
+  - D > 32 zero-pads them;
+  - S < 16 averages every 16 / S adjacent frames, as a token pool before
+    layer 0;
+  - --search-bits 4 trains against per-channel int4 fake-quantized weights
+    (qmax 7, the --int4 scales of tools/export_weights.py).
+Each candidate is scored with tools/cost_model.py: the predicted cycles per
+window on --search-backend, the priors or a board's --search-calib. Every
+candidate goes to artifacts/search_results.csv, and the Pareto front of test
+accuracy against predicted cycles is printed (PARETO lines). With
+--latency-budget C it also prints the most accurate candidate within C
+cycles per window (PICK). Retrain the pick with its shape to deploy it.
+
+With --distill medium,small the model trained as usual (the large tier) then
+teaches students of the tier shapes in TIERS, which match the TINYFORMER_TIERS
+instances of litex_port/common/model_tiers.h. Each student is trained for
+--distill-epochs on alpha * CE(labels) + (1 - alpha) * T^2 * KL(teacher ||
+student) at temperature T (--distill-alpha, --distill-temp), fed as the
+--search candidates above (first D channels, S / 16 frame averages). They are
+float models with the teacher's --heads / --linear-attn, since those are
+build options that every tier shares. Each student goes to
+artifacts/tiers/<tier>/state_dict.pt (with its "tokens") and classifier.npz;
+export_and_make_fpga_demo.py then packs them and the large model into the
+tier pack artifacts/model_tiers.blob.
+
+Data and batching are built for sweeps of many short trainings: the split
+is memory-mapped from the .npy cache of preprocess_uci_har.py, copied to the
+device once (through pinned memory on CUDA), and every batch is a slice or
+an index gather there, with no DataLoader workers or per-step host copies
+(--batch-size, default 64). --amp trains the float models under CUDA
+autocast (float16 with a gradient scaler); --qat and fake-quantized
+(--search-bits 4) models always train in float32, whose rounding the
+fake quantization depends on.
 """
 
+import argparse
+import csv
+import itertools
+import math
 import os
 import random
+import sys
 from pathlib import Path
 
 import numpy as np
 import torch
 import torch.nn as nn
 import torch.optim as optim
-from torch.utils.data import DataLoader, TensorDataset
+
+from preprocess_uci_har import load_processed
 
 
 S = 16
@@ -30,6 +122,28 @@ D = 32
 FFN = 64
 N_CLASSES = 6
 
+# Early exit: margins are chosen so that the samples that exit agree with the
+# full model's prediction at least this often (on the test split).
+EXIT_AGREEMENT = 0.99
+EXIT_EPOCHS = 5
+
+# Model tiers (S, D, FFN) of litex_port/common/model_tiers.h; large is the
+# default shape, the teacher of --distill.
+TIERS = {"large": (S, D, FFN), "medium": (8, 32, 64), "small": (8, 16, 32)}
+
+# Quantization-aware training (--qat). The encoder parameters are trained as
+# float W with the integer weight round(W * W_SCALE): with the >> 7 requant,
+# W_SCALE = 2^7 keeps the default nn.Linear init at unit gain. Inputs and the
+# heads use the int8 scale of export_and_make_fpga_demo.py.
+W_SCALE = 128.0
+ACT_SCALE = 32.0
+HEAD_SCALE = 32.0
+
+# exp_lut of tinyformer.c, 1024 * e^(-0.2965 i): the softmax gradient goes
+# through the smooth curve, the forward pass through the table.
+EXP_LUT = [1024, 754, 556, 410, 302, 223, 165, 122, 90, 67, 50, 37, 28, 21, 16, 12]
+EXP_LUT_DECAY = math.log(1024.0 / 12.0) / 15.0
+
 
 def set_seed(seed: int = 42) -> None:
     random.seed(seed)
@@ -38,9 +152,106 @@ def set_seed(seed: int = 42) -> None:
     torch.cuda.manual_seed_all(seed)
 
 
+def ste(x: torch.Tensor, q: torch.Tensor) -> torch.Tensor:
+    """Forward q, backward the identity to x."""
+    return x + (q - x).detach()
+
+
+def sat8(x: torch.Tensor) -> torch.Tensor:
+    """saturate_int32_to_int8."""
+    return torch.clamp(x, -128.0, 127.0)
+
+
+def floor_div(x: torch.Tensor, div: float) -> torch.Tensor:
+    """x >> log2(div) for integer-valued x (exact: div is a power of 2)."""
+    y = x / div
+    return ste(y, torch.floor(y))
+
+
+def quantize_weight(w: torch.Tensor, scale: float) -> torch.Tensor:
+    """int8 weight round(w * scale), clipped to [-127, 127] as export_weights.py."""
+    w = torch.clamp(w * scale, -127.0, 127.0)
+    return ste(w, torch.round(w))
+
+
+def quantize_input(x: torch.Tensor) -> torch.Tensor:
+    """x_int8 = clip(round(x * 32), -127, 127), as quantize_inputs."""
+    return torch.clamp(torch.round(x * ACT_SCALE), -127.0, 127.0)
+
+
+def token_pool(x: torch.Tensor, k: int, qat: bool) -> torch.Tensor:
+    """
+    [B, n, D] -> [B, ceil(n / k), D]: the mean of every k adjacent tokens (the
+    last group may be shorter); with qat tf_token_pool's floor((sum + m / 2) / m).
+    """
+    if k <= 1:
+        return x
+    groups = []
+    for g in range(0, x.shape[1], k):
+        part = x[:, g:g + k]
+        m = part.shape[1]
+        if qat:
+            y = (part.sum(dim=1) + m // 2) / m
+            groups.append(ste(y, torch.floor(y)))
+        else:
+            groups.append(part.mean(dim=1))
+    return torch.stack(groups, dim=1)
+
+
+def pool_int8(x: torch.Tensor) -> torch.Tensor:
+    """tf_head_apply's pool: sat8((sum + S / 2) / S), truncating division."""
+    y = (x.sum(dim=1) + x.shape[1] // 2) / x.shape[1]
+    return sat8(ste(y, torch.trunc(y)))
+
+
+class QuantHead(nn.Linear):
+    """
+    Classifier head as the C one: int8 W and b at HEAD_SCALE on the int8 pool,
+    int32 logits. forward returns them over HEAD_SCALE^2 (float logit units,
+    as quantize_exit_margin expects the margins).
+    """
+
+    def forward(self, x: torch.Tensor) -> torch.Tensor:
+        w = quantize_weight(self.weight, HEAD_SCALE)
+        b = quantize_weight(self.bias, HEAD_SCALE)
+        return nn.functional.linear(x, w, b) / (HEAD_SCALE * HEAD_SCALE)
+
+
+def make_head(qat: bool, d_model: int = D) -> nn.Linear:
+    return (QuantHead if qat else nn.Linear)(d_model, N_CLASSES, bias=True)
+
+
+def fake_quant_weight(w: torch.Tensor, bits: int) -> torch.Tensor:
+    """
+    w through per-row symmetric bits-bit quantization (--search-bits): the
+    scales of export_weights.py quantize_per_channel, qmax = 2^(bits-1) - 1.
+    """
+    qmax = float((1 << (bits - 1)) - 1)
+    scale = w.detach().abs().amax(dim=1, keepdim=True).clamp_min(1e-8) / qmax
+    return ste(w, torch.clamp(torch.round(w / scale), -qmax, qmax) * scale)
+
+
+def fit_channels(x: torch.Tensor, d_model: int) -> torch.Tensor:
+    """[B, S, 32] input tokens cut or zero-padded to d_model channels."""
+    if d_model <= x.shape[-1]:
+        return x[..., :d_model]
+    return nn.functional.pad(x, (0, d_model - x.shape[-1]))
+
+
 class TinyFormerEncoder(nn.Module):
-    def __init__(self, d_model: int = D, ffn_dim: int = FFN):
+    def __init__(self, d_model: int = D, ffn_dim: int = FFN, qat: bool = False, heads: int = 1,
+                 linear_attn: bool = False, weight_bits: int = 0):
         super().__init__()
+        assert d_model % (4 * heads) == 0, "D / heads must be a multiple of 4"
+        assert not (qat and weight_bits), "weight_bits is for float training"
+        self.qat = qat
+        self.d_model = d_model
+        self.weight_bits = weight_bits  # 0: float weights
+        self.heads = heads
+        self.linear_attn = linear_attn
+        self.head_dim = d_model // heads
+        # TINYFORMER_SCORE_SHIFT of the C build
+        self.score_shift = 5 if heads == 1 else 4
         self.proj_q = nn.Linear(d_model, d_model, bias=True)
         self.proj_k = nn.Linear(d_model, d_model, bias=True)
         self.proj_v = nn.Linear(d_model, d_model, bias=True)
@@ -56,79 +267,362 @@ class TinyFormerEncoder(nn.Module):
         x: [B, S, D]
         Returns: [B, S, D]
         """
+        return self.forward_with_mid(x)[1]
+
+    def forward_with_mid(self, x: torch.Tensor):
+        """
+        x: [B, S, D] (int8 tokens with qat)
+        Returns: (y, z), y = tokens after the attention residual, z = output
+        """
         B, S_, D_ = x.shape
-        assert S_ == S and D_ == D
+        assert S_ <= S and D_ == self.d_model
+        if self.qat:
+            return self.forward_int8(x)
 
         # Projections
-        q = self.proj_q(x)  # [B, S, D]
-        k = self.proj_k(x)
-        v = self.proj_v(x)
-
-        # Scaled dot-product attention (single head)
-        # Scores: [B, S, S]
-        scale = D ** 0.5
-        scores = torch.matmul(q, k.transpose(1, 2)) / scale
-        attn = torch.softmax(scores, dim=-1)  # [B, S, S]
-        context = torch.matmul(attn, v)      # [B, S, D]
+        q = self.linear(self.proj_q, x)  # [B, S, D]
+        k = self.linear(self.proj_k, x)
+        v = self.linear(self.proj_v, x)
+
+        # Scaled dot-product attention per head
+        # Scores: [B, H, S, S]
+        q, k, v = (self.split_heads(t) for t in (q, k, v))
+        if self.linear_attn:
+            context = self.merge_heads(self.linear_attention(q, k, v))
+        else:
+            scale = self.head_dim ** 0.5
+            scores = torch.matmul(q, k.transpose(-1, -2)) / scale
+            attn = torch.softmax(scores, dim=-1)  # [B, H, S, S]
+            context = self.merge_heads(torch.matmul(attn, v))  # [B, S, D]
 
         # Output projection + residual
-        attn_out = self.proj_o(context)
+        attn_out = self.linear(self.proj_o, context)
         y = x + attn_out
 
         # FFN + residual
-        h = self.relu(self.ffn1(y))
-        f = self.ffn2(h)
+        h = self.relu(self.linear(self.ffn1, y))
+        f = self.linear(self.ffn2, h)
         z = y + f
-        return z
+        return y, z
+
+    def linear(self, layer: nn.Linear, x: torch.Tensor) -> torch.Tensor:
+        """layer(x), with fake-quantized weights when weight_bits is set."""
+        if not self.weight_bits:
+            return layer(x)
+        return nn.functional.linear(x, fake_quant_weight(layer.weight, self.weight_bits), layer.bias)
+
+    def split_heads(self, t: torch.Tensor) -> torch.Tensor:
+        """[B, S, D] -> [B, H, S, head_dim]"""
+        return t.view(t.shape[0], t.shape[1], self.heads, self.head_dim).transpose(1, 2)
+
+    def merge_heads(self, t: torch.Tensor) -> torch.Tensor:
+        """[B, H, S, head_dim] -> [B, S, D]"""
+        return t.transpose(1, 2).reshape(t.shape[0], t.shape[2], self.d_model)
+
+    def linear_attention(self, q: torch.Tensor, k: torch.Tensor, v: torch.Tensor) -> torch.Tensor:
+        """
+        relu(q) (relu(K)^T V) / relu(q) . sum_j relu(k_j) of [B, H, S, head_dim]
+        heads; on int8 q, k, v (qat) the integer result of attention_linear.
+        """
+        fq, fk = self.relu(q), self.relu(k)
+        num = torch.matmul(fq, torch.matmul(fk.transpose(-1, -2), v))  # [B, H, S, head_dim]
+        den = (fq * fk.sum(dim=2, keepdim=True)).sum(dim=-1, keepdim=True)
+        context = num / den.clamp_min(1e-6)
+        if not self.qat:
+            return context
+        # int64 sums as in C, both shifted until den < 2^24, truncating division
+        num_i = torch.matmul(fq.detach().long(), torch.matmul(fk.detach().long().transpose(-1, -2),
+                                                              v.detach().long()))
+        den_i = den.detach().long()
+        sh = sum((den_i >= (1 << (24 + t))).long() for t in range(8))
+        num_i, den_i = num_i >> sh, den_i >> sh
+        c = torch.div(num_i, den_i.clamp_min(1), rounding_mode="trunc")
+        c = torch.where(den_i > 0, c, torch.zeros_like(c))
+        return ste(context, c.to(context.dtype))
+
+    def linear_int8(self, layer: nn.Linear, x: torch.Tensor) -> torch.Tensor:
+        """sat8((W x + b) >> 7) with the int8 W and b of layer."""
+        w = quantize_weight(layer.weight, W_SCALE)
+        b = quantize_weight(layer.bias, W_SCALE)
+        return sat8(floor_div(nn.functional.linear(x, w, b), 128.0))
+
+    def softmax_int8(self, scores: torch.Tensor) -> torch.Tensor:
+        """
+        Q15 attention weights of tinyformer.c from the shifted scores: the exp
+        LUT at clamp((score - max) >> 3, -15, 0), then (e << 15) / sum.
+        """
+        shifted = scores - scores.max(dim=-1, keepdim=True).values  # <= 0
+        idx = torch.clamp(torch.floor(shifted / 8.0), -15.0, 0.0).long()
+        lut = torch.tensor(EXP_LUT, dtype=scores.dtype, device=scores.device)
+        e = ste(1024.0 * torch.exp(shifted * (EXP_LUT_DECAY / 8.0)), lut[-idx])
+        total = e.sum(dim=-1, keepdim=True)
+        w = e * 32768.0 / total
+        w_int = torch.div(e.detach().long() << 15, total.detach().long(), rounding_mode="floor")
+        return ste(w, w_int.to(w.dtype))
+
+    def forward_int8(self, x: torch.Tensor):
+        """forward_with_mid on int8 tokens, integer op for op as tinyformer.c."""
+        q = self.linear_int8(self.proj_q, x)
+        k = self.linear_int8(self.proj_k, x)
+        v = self.linear_int8(self.proj_v, x)
+
+        q, k, v = (self.split_heads(t) for t in (q, k, v))
+        if self.linear_attn:
+            context = self.merge_heads(sat8(self.linear_attention(q, k, v)))
+        else:
+            scores = floor_div(torch.matmul(q, k.transpose(-1, -2)),
+                               float(1 << self.score_shift))              # >> score_shift
+            attn = self.softmax_int8(scores)                                # Q15
+            # Each w * v term is >> 15 before the sum: [B, H, S, S, head_dim]
+            terms = floor_div(attn.unsqueeze(-1) * v.unsqueeze(2), 32768.0)
+            context = self.merge_heads(sat8(terms.sum(dim=3)))
+
+        y = sat8(x + self.linear_int8(self.proj_o, context))
+        h = self.relu(self.linear_int8(self.ffn1, y))
+        z = sat8(y + self.linear_int8(self.ffn2, h))
+        return y, z
+
+    def export_tensor(self, t: torch.Tensor) -> torch.Tensor:
+        """A weight or bias for state_dict.pt: integer valued with qat."""
+        t = t.detach().cpu()
+        if self.qat:
+            t = torch.clamp(torch.round(t * W_SCALE), -127.0, 127.0)
+        return t
 
 
 class TinyFormerHARModel(nn.Module):
-    def __init__(self):
+    def __init__(self, qat: bool = False, heads: int = 1, linear_attn: bool = False,
+                 layers: int = 1, token_pool=None, share_layers: bool = False,
+                 share_bias: bool = False, d_model: int = D, ffn_dim: int = FFN,
+                 weight_bits: int = 0):
         super().__init__()
-        self.encoder = TinyFormerEncoder(d_model=D, ffn_dim=FFN)
-        self.classifier = nn.Linear(D, N_CLASSES, bias=True)
+        self.qat = qat
+        self.d_model = d_model
+        self.token_pool = list(token_pool) if token_pool else [1] * layers
+        assert len(self.token_pool) == layers and min(self.token_pool) >= 1
+        self.encoders = nn.ModuleList(
+            TinyFormerEncoder(d_model=d_model, ffn_dim=ffn_dim, qat=qat, heads=heads,
+                              linear_attn=linear_attn, weight_bits=weight_bits)
+            for _ in range(layers))
+        # Cross-layer sharing: later layers reuse layer 0's parameters
+        self.shared = share_layers and layers > 1
+        if self.shared:
+            base = self.encoders[0]
+            for enc in self.encoders[1:]:
+                for name in ("proj_q", "proj_k", "proj_v", "proj_o", "ffn1", "ffn2"):
+                    lin, ref = getattr(enc, name), getattr(base, name)
+                    lin.weight = ref.weight
+                    if share_bias:
+                        lin.bias = ref.bias
+        self.encoder = self.encoders[0]
+        self.classifier = make_head(qat, d_model)
+
+    def quantize(self, x: torch.Tensor) -> torch.Tensor:
+        """Input tokens as the encoder takes them (int8 with qat), with
+        d_model channels."""
+        x = fit_channels(x, self.d_model)
+        return quantize_input(x) if self.qat else x
+
+    def pool(self, x: torch.Tensor) -> torch.Tensor:
+        """[B, S, D] -> [B, D] mean-pool over time (int8 with qat)."""
+        return pool_int8(x) if self.qat else x.mean(dim=1)
+
+    def encode(self, x: torch.Tensor) -> torch.Tensor:
+        """The (pooled) encoder stack on quantized tokens: [B, S, D] -> [B, n, D]."""
+        for k, enc in zip(self.token_pool, self.encoders):
+            x = enc(token_pool(x, k, self.qat))
+        return x
 
     def forward(self, x: torch.Tensor) -> torch.Tensor:
         """
         x: [B, S, D]
         """
-        z = self.encoder(x)          # [B, S, D]
-        pooled = z.mean(dim=1)       # [B, D] mean-pool over time
+        z = self.encode(self.quantize(x))   # [B, n, D], n = S without pooling
+        pooled = self.pool(z)               # [B, D]
         logits = self.classifier(pooled)
         return logits
 
 
-def train_model():
+def pick_exit_margin(margin: torch.Tensor, agree: torch.Tensor) -> float:
+    """
+    Smallest top-1 margin m such that the samples with margin >= m agree with
+    the full model at least EXIT_AGREEMENT of the time (inf: never exit).
+    """
+    order = torch.argsort(margin, descending=True)
+    agree_sorted = agree[order].float()
+    rate = torch.cumsum(agree_sorted, 0) / torch.arange(1, len(order) + 1)
+    ok = (rate >= EXIT_AGREEMENT).nonzero()
+    if len(ok) == 0:
+        return float("inf")
+    return float(margin[order][int(ok[-1])])
+
+
+def train_exit_heads(model: TinyFormerHARModel, train_loader, test_loader, device):
+    """
+    Auxiliary linear heads for early exit, trained with the encoder frozen to
+    match the labels:
+      exit_in   -- on the mean-pooled input tokens (skips the whole encoder)
+      exit_attn -- on the mean-pooled tokens after the attention residual
+                   (skips the FFN)
+    Returns {name: (W, b, margin)}.
+    """
+    heads = {
+        "exit_in": make_head(model.qat, model.d_model).to(device),
+        "exit_attn": make_head(model.qat, model.d_model).to(device),
+    }
+    params = [p for h in heads.values() for p in h.parameters()]
+    optimizer = optim.Adam(params, lr=1e-3)
+    criterion = nn.CrossEntropyLoss()
+    model.eval()
+
+    def features(xb):
+        with torch.no_grad():
+            x = model.quantize(xb)
+            y, _ = model.encoder.forward_with_mid(token_pool(x, model.token_pool[0], model.qat))
+            full = model.classifier(model.pool(model.encode(x)))
+        return {"exit_in": model.pool(x), "exit_attn": model.pool(y)}, full
+
+    for epoch in range(1, EXIT_EPOCHS + 1):
+        total_loss = 0.0
+        total = 0
+        for xb, yb in train_loader:
+            xb = xb.to(device)
+            yb = yb.to(device)
+            feats, _ = features(xb)
+            optimizer.zero_grad()
+            loss = sum(criterion(heads[k](feats[k]), yb) for k in heads)
+            loss.backward()
+            optimizer.step()
+            total_loss += float(loss.item()) * xb.size(0)
+            total += xb.size(0)
+        print(f"Exit epoch {epoch}/{EXIT_EPOCHS} - loss {total_loss / total:.4f}")
+
+    margins = {k: [] for k in heads}
+    agrees = {k: [] for k in heads}
+    with torch.no_grad():
+        for xb, _ in test_loader:
+            xb = xb.to(device)
+            feats, full = features(xb)
+            for k, h in heads.items():
+                top2 = h(feats[k]).topk(2, dim=1)
+                margins[k].append((top2.values[:, 0] - top2.values[:, 1]).cpu())
+                agrees[k].append((top2.indices[:, 0] == full.argmax(dim=1)).cpu())
+
+    out = {}
+    for k, h in heads.items():
+        m = torch.cat(margins[k])
+        a = torch.cat(agrees[k])
+        margin = pick_exit_margin(m, a)
+        rate = float((m >= margin).float().mean())
+        print(f"{k}: margin {margin:.3f}, exit rate {rate:.3f} on test")
+        out[k] = (h.weight.detach().cpu().numpy(),
+                  h.bias.detach().cpu().numpy(), margin)
+    return out
+
+
+def export_layer(enc: TinyFormerEncoder, token_pool: int, path: Path, shared: bool = False,
+                 tokens: int = S) -> None:
+    """
+    One encoder layer as the state dict tools/export_weights.py reads; shared
+    marks a layer whose matrices are layer 0's (--share-layers) and tokens is
+    the S of a model tier (--distill).
+    """
+    state_to_export = {
+        "W_q": enc.export_tensor(enc.proj_q.weight),     # [32,32]
+        "W_k": enc.export_tensor(enc.proj_k.weight),
+        "W_v": enc.export_tensor(enc.proj_v.weight),
+        "W_o": enc.export_tensor(enc.proj_o.weight),
+        "W_ff1": enc.export_tensor(enc.ffn1.weight),     # [64,32]
+        "W_ff2": enc.export_tensor(enc.ffn2.weight),     # [32,64]
+        "b_q": enc.export_tensor(enc.proj_q.bias),       # [32]
+        "b_k": enc.export_tensor(enc.proj_k.bias),
+        "b_v": enc.export_tensor(enc.proj_v.bias),
+        "b_o": enc.export_tensor(enc.proj_o.bias),
+        "b_ff1": enc.export_tensor(enc.ffn1.bias),       # [64]
+        "b_ff2": enc.export_tensor(enc.ffn2.bias),       # [32]
+        "heads": torch.tensor(enc.heads),                # TINYFORMER_HEADS
+        "linear_attn": torch.tensor(int(enc.linear_attn)),  # TINYFORMER_LINEAR_ATTN
+        "token_pool": torch.tensor(token_pool),          # stride before this layer
+        "shared": torch.tensor(int(shared)),             # W_* are layer 0's
+        "tokens": torch.tensor(tokens),                  # S of the layer's tier
+    }
+    torch.save(state_to_export, path)
+    print(f"Saved TinyFormer encoder weights to {path}")
+
+
+class DeviceBatches:
+    """
+    (x, y) batches of a split held whole on device: one host-to-device copy
+    (pinned on CUDA), then slices, or with shuffle index gathers of a fresh
+    on-device permutation every epoch.
+    """
+
+    def __init__(self, X: np.ndarray, y: np.ndarray, batch_size: int, device, shuffle: bool = False):
+        x = torch.from_numpy(np.array(X, dtype=np.float32))
+        t = torch.from_numpy(np.array(y, dtype=np.int64))
+        if device.type == "cuda":
+            x, t = x.pin_memory(), t.pin_memory()
+        self.x = x.to(device, non_blocking=True)
+        self.y = t.to(device, non_blocking=True)
+        self.batch_size = batch_size
+        self.shuffle = shuffle
+
+    def __len__(self) -> int:
+        return (self.x.shape[0] + self.batch_size - 1) // self.batch_size
+
+    def __iter__(self):
+        n, bs = self.x.shape[0], self.batch_size
+        if self.shuffle:
+            order = torch.randperm(n, device=self.x.device)
+            for i in range(0, n, bs):
+                idx = order[i:i + bs]
+                yield self.x[idx], self.y[idx]
+        else:
+            for i in range(0, n, bs):
+                yield self.x[i:i + bs], self.y[i:i + bs]
+
+
+def load_data(batch_size: int = 64):
+    """Train / test batches of the preprocessed UCI HAR split and the device."""
     repo_root = Path(__file__).resolve().parents[1]
     data_path = repo_root / "data" / "uci_har_processed" / "uci_har_processed.npz"
-    artifacts_dir = repo_root / "artifacts"
-    artifacts_dir.mkdir(parents=True, exist_ok=True)
 
-    data = np.load(data_path)
-    X_train = data["X_train"].astype(np.float32)  # [N_train, 16, 32]
-    y_train = data["y_train"].astype(np.int64)
-    X_test = data["X_test"].astype(np.float32)
-    y_test = data["y_test"].astype(np.int64)
+    data = load_processed(data_path)  # X_*: [N, 16, 32], y_*: [N]
 
     set_seed(42)
 
     device = torch.device("cuda" if torch.cuda.is_available() else "cpu")
 
-    train_ds = TensorDataset(
-        torch.from_numpy(X_train), torch.from_numpy(y_train)
-    )
-    test_ds = TensorDataset(
-        torch.from_numpy(X_test), torch.from_numpy(y_test)
-    )
+    train_loader = DeviceBatches(data["X_train"], data["y_train"], batch_size, device, shuffle=True)
+    test_loader = DeviceBatches(data["X_test"], data["y_test"], 128, device)
+    return train_loader, test_loader, device
+
 
-    train_loader = DataLoader(train_ds, batch_size=64, shuffle=True)
-    test_loader = DataLoader(test_ds, batch_size=128, shuffle=False)
+def grad_scaler(enabled: bool):
+    """CUDA gradient scaler for --amp (a pass-through when disabled)."""
+    if hasattr(torch, "amp") and hasattr(torch.amp, "GradScaler"):
+        return torch.amp.GradScaler("cuda", enabled=enabled)
+    return torch.cuda.amp.GradScaler(enabled=enabled)
 
-    model = TinyFormerHARModel().to(device)
+
+def fit(model: nn.Module, train_loader, test_loader, device, epochs: int, tag: str = "",
+        teacher: nn.Module = None, temp: float = 4.0, alpha: float = 0.5,
+        amp: bool = False) -> float:
+    """
+    Adam training for epochs, one line per epoch; returns the last test
+    accuracy. With a teacher, the loss is alpha * CE + (1 - alpha) * the
+    temperature-scaled KL divergence to the teacher's logits. amp: mixed
+    precision on CUDA, unless the model fake-quantizes (QAT or weight_bits).
+    """
     optimizer = optim.Adam(model.parameters(), lr=1e-3)
     criterion = nn.CrossEntropyLoss()
+    if teacher is not None:
+        teacher.eval()
+    fake_quant = any(getattr(m, "qat", False) or getattr(m, "weight_bits", 0) for m in model.modules())
+    use_amp = amp and device.type == "cuda" and not fake_quant
+    scaler = grad_scaler(use_amp)
 
-    epochs = 15
+    test_acc = 0.0
     for epoch in range(1, epochs + 1):
         model.train()
         total_loss = 0.0
@@ -138,11 +632,19 @@ def train_model():
             xb = xb.to(device)
             yb = yb.to(device)
 
-            optimizer.zero_grad()
-            logits = model(xb)
-            loss = criterion(logits, yb)
-            loss.backward()
-            optimizer.step()
+            optimizer.zero_grad(set_to_none=True)
+            with torch.autocast(device_type=device.type, dtype=torch.float16, enabled=use_amp):
+                logits = model(xb)
+                loss = criterion(logits, yb)
+                if teacher is not None:
+                    with torch.no_grad():
+                        soft = torch.softmax(teacher(xb).float() / temp, dim=1)
+                    kd = nn.functional.kl_div(torch.log_softmax(logits.float() / temp, dim=1), soft,
+                                              reduction="batchmean")
+                    loss = alpha * loss + (1.0 - alpha) * temp * temp * kd
+            scaler.scale(loss).backward()
+            scaler.step(optimizer)
+            scaler.update()
 
             total_loss += float(loss.item()) * xb.size(0)
             preds = logits.argmax(dim=1)
@@ -160,42 +662,225 @@ def train_model():
             for xb, yb in test_loader:
                 xb = xb.to(device)
                 yb = yb.to(device)
-                logits = model(xb)
+                with torch.autocast(device_type=device.type, dtype=torch.float16, enabled=use_amp):
+                    logits = model(xb)
                 preds = logits.argmax(dim=1)
                 correct_test += (preds == yb).sum().item()
                 total_test += xb.size(0)
         test_acc = correct_test / total_test
 
-        print(f"Epoch {epoch}/{epochs} - loss {train_loss:.4f}, "
+        print(f"{tag}Epoch {epoch}/{epochs} - loss {train_loss:.4f}, "
               f"train acc {train_acc:.3f}, test acc {test_acc:.3f}")
+    return test_acc
+
+
+def distill_tiers(teacher: TinyFormerHARModel, tiers: list, train_loader, test_loader, device,
+                  epochs: int, temp: float, alpha: float, artifacts_dir: Path,
+                  amp: bool = False) -> None:
+    """Train and export one student per tier name of tiers (TIERS) from teacher."""
+    for name in tiers:
+        s, d, f = TIERS[name]
+        set_seed(42)
+        student = TinyFormerHARModel(heads=teacher.encoder.heads,
+                                     linear_attn=teacher.encoder.linear_attn,
+                                     token_pool=[S // s], d_model=d, ffn_dim=f).to(device)
+        acc = fit(student, train_loader, test_loader, device, epochs, f"[{name}] ",
+                  teacher=teacher, temp=temp, alpha=alpha, amp=amp)
+        out = artifacts_dir / "tiers" / name
+        out.mkdir(parents=True, exist_ok=True)
+        export_layer(student.encoder, student.token_pool[0], out / "state_dict.pt", tokens=s)
+        np.savez(out / "classifier.npz", W_cls=student.classifier.weight.detach().cpu().numpy(),
+                 b_cls=student.classifier.bias.detach().cpu().numpy())
+        print(f"TIER {name} S={s} D={d} FFN={f} test acc {acc:.3f} "
+              f"params={sum(t.numel() for t in student.encoder.parameters())}")
+
+
+def train_model(qat: bool = False, heads: int = 1, linear_attn: bool = False,
+                layers: int = 1, token_pool=None, share_layers: bool = False,
+                share_bias: bool = False, distill=None, distill_epochs: int = 15,
+                distill_temp: float = 4.0, distill_alpha: float = 0.5,
+                batch_size: int = 64, amp: bool = False):
+    repo_root = Path(__file__).resolve().parents[1]
+    artifacts_dir = repo_root / "artifacts"
+    artifacts_dir.mkdir(parents=True, exist_ok=True)
 
-    # Export TinyFormer encoder weights in the exact layout required by C.
-    enc = model.encoder
-    state_to_export = {
-        "W_q": enc.proj_q.weight.detach().cpu(),     # [32,32]
-        "W_k": enc.proj_k.weight.detach().cpu(),
-        "W_v": enc.proj_v.weight.detach().cpu(),
-        "W_o": enc.proj_o.weight.detach().cpu(),
-        "W_ff1": enc.ffn1.weight.detach().cpu(),     # [64,32]
-        "W_ff2": enc.ffn2.weight.detach().cpu(),     # [32,64]
-        "b_q": enc.proj_q.bias.detach().cpu(),       # [32]
-        "b_k": enc.proj_k.bias.detach().cpu(),
-        "b_v": enc.proj_v.bias.detach().cpu(),
-        "b_o": enc.proj_o.bias.detach().cpu(),
-        "b_ff1": enc.ffn1.bias.detach().cpu(),       # [64]
-        "b_ff2": enc.ffn2.bias.detach().cpu(),       # [32]
-    }
+    train_loader, test_loader, device = load_data(batch_size)
 
-    torch.save(state_to_export, artifacts_dir / "state_dict.pt")
-    print(f"Saved TinyFormer encoder weights to {artifacts_dir/'state_dict.pt'}")
+    model = TinyFormerHARModel(qat=qat, heads=heads, linear_attn=linear_attn,
+                               layers=layers, token_pool=token_pool,
+                               share_layers=share_layers, share_bias=share_bias).to(device)
+    fit(model, train_loader, test_loader, device, epochs=15, amp=amp)
+
+    # Export TinyFormer encoder weights in the exact layout required by C,
+    # one state dict per layer of the stack.
+    for l, enc in enumerate(model.encoders):
+        export_layer(enc, model.token_pool[l],
+                     artifacts_dir / ("state_dict.pt" if l == 0 else f"state_dict_l{l}.pt"),
+                     shared=model.shared and l > 0)
 
     # Export classifier head weights separately for FPGA demo.
     cls_W = model.classifier.weight.detach().cpu().numpy()  # [6, 32]
     cls_b = model.classifier.bias.detach().cpu().numpy()    # [6]
-    np.savez(artifacts_dir / "classifier.npz", W_cls=cls_W, b_cls=cls_b)
+    exits = train_exit_heads(model, train_loader, test_loader, device)
+    np.savez(artifacts_dir / "classifier.npz", W_cls=cls_W, b_cls=cls_b,
+             **{f"{p}_{k}": v for k, (W, b, m) in exits.items()
+                for p, v in (("W", W), ("b", b), ("margin", m))})
     print(f"Saved classifier head weights to {artifacts_dir/'classifier.npz'}")
 
+    if distill:
+        distill_tiers(model, distill, train_loader, test_loader, device, distill_epochs,
+                      distill_temp, distill_alpha, artifacts_dir, amp=amp)
+
+
+def pareto_front(results: list) -> list:
+    """The results no other one beats on both accuracy and cycles, by cycles."""
+    front = []
+    for r in sorted(results, key=lambda r: (r["cycles"], -r["acc"])):
+        if not front or r["acc"] > front[-1]["acc"]:
+            front.append(r)
+    return front
+
+
+def search_models(dims: list, ffns: list, heads_list: list, seqs: list, bits_list: list,
+                  epochs: int, backend: str, calib, budget, cpu_mhz: float,
+                  linear_attn: bool = False, batch_size: int = 64, amp: bool = False) -> None:
+    """
+    Latency-constrained search (--search): train every valid candidate of the
+    grid briefly and score it with the cost model of tools/cost_model.py.
+    """
+    repo_root = Path(__file__).resolve().parents[1]
+    sys.path.insert(0, str(repo_root / "tools"))
+    import cost_model
+
+    artifacts_dir = repo_root / "artifacts"
+    artifacts_dir.mkdir(parents=True, exist_ok=True)
+    costs = cost_model.load_costs(calib)
+    train_loader, test_loader, device = load_data(batch_size)
+
+    results = []
+    for d, f, h, s, bits in itertools.product(dims, ffns, heads_list, seqs, bits_list):
+        if d % (4 * h) != 0 or S % s != 0:
+            print(f"SKIP D={d} FFN={f} heads={h} S={s}: D / heads must be a multiple of 4 "
+                  f"and S divide {S}")
+            continue
+        shape = cost_model.Shape(S=s, D=d, FFN=f, d_in=min(d, 16), heads=h, bits=bits)
+        p = cost_model.plan(backend, shape, costs=costs)
+        cycles = sum(cost_model.predict(shape, p, costs).values())
+        tag = f"[D={d} FFN={f} heads={h} S={s} bits={bits}] "
+        set_seed(42)
+        model = TinyFormerHARModel(heads=h, linear_attn=linear_attn, token_pool=[S // s],
+                                   d_model=d, ffn_dim=f,
+                                   weight_bits=bits if bits < 8 else 0).to(device)
+        acc = fit(model, train_loader, test_loader, device, epochs, tag, amp=amp)
+        r = {"D": d, "FFN": f, "heads": h, "S": s, "bits": bits, "acc": acc,
+             "cycles": int(round(cycles)), "params": sum(t.numel() for t in model.encoder.parameters())}
+        results.append(r)
+        print(f"SEARCH D={d} FFN={f} heads={h} S={s} bits={bits} acc={acc:.4f} "
+              f"cycles={r['cycles']} params={r['params']}")
+    if not results:
+        raise SystemExit("--search: no valid candidate in the grid")
+
+    front = pareto_front(results)
+    for r in results:
+        r["pareto"] = int(r in front)
+    out = artifacts_dir / "search_results.csv"
+    with open(out, "w", newline="") as fh:
+        w = csv.DictWriter(fh, fieldnames=list(results[0]))
+        w.writeheader()
+        w.writerows(results)
+    print(f"Saved {len(results)} candidates to {out} (backend {backend}, "
+          f"costs {calib or 'default'})")
+
+    def line(r):
+        us = f" us={r['cycles'] / cpu_mhz:.0f}" if cpu_mhz > 0 else ""
+        return (f"D={r['D']} FFN={r['FFN']} heads={r['heads']} S={r['S']} bits={r['bits']} "
+                f"acc={r['acc']:.4f} cycles={r['cycles']}{us}")
+
+    for r in front:
+        print("PARETO " + line(r))
+    if budget is not None:
+        fit_budget = [r for r in front if r["cycles"] <= budget]
+        if fit_budget:
+            print("PICK " + line(fit_budget[-1]))
+        else:
+            print(f"PICK none within {budget} cycles (fastest: {front[0]['cycles']})")
+
 
 if __name__ == "__main__":
-    train_model()
+    parser = argparse.ArgumentParser(description="Train the TinyFormer UCI HAR classifier.")
+    parser.add_argument("--qat", action="store_true",
+                        help="Quantization-aware training against the integer C encoder.")
+    parser.add_argument("--heads", type=int, default=1,
+                        help="Attention heads (TINYFORMER_HEADS of the C build).")
+    parser.add_argument("--linear-attn", action="store_true",
+                        help="ReLU linear attention (TINYFORMER_LINEAR_ATTN of the C build).")
+    parser.add_argument("--layers", type=int, default=1,
+                        help="Encoder layers (tinyformer_stack_encode of the C build).")
+    parser.add_argument("--token-pool", default=None,
+                        help="Comma-separated token-pool stride before each layer, e.g. 1,2 "
+                             "(tinyformer_stack_encode_pooled, TINYFORMER_TOKEN_POOL).")
+    parser.add_argument("--share-layers", action="store_true",
+                        help="Share the weight matrices of all --layers (TINYFORMER_SHARED_LAYERS).")
+    parser.add_argument("--share-bias", action="store_true",
+                        help="With --share-layers, share the biases too.")
+    parser.add_argument("--batch-size", type=int, default=64, help="Training batch size.")
+    parser.add_argument("--amp", action="store_true",
+                        help="Mixed-precision (CUDA float16) training of the float models.")
+    parser.add_argument("--distill", default=None,
+                        help="Comma-separated tiers (medium, small) distilled from the trained model.")
+    parser.add_argument("--distill-epochs", type=int, default=15, help="Epochs per student.")
+    parser.add_argument("--distill-temp", type=float, default=4.0, help="Distillation temperature T.")
+    parser.add_argument("--distill-alpha", type=float, default=0.5,
+                        help="Weight of the label loss against the teacher's (0..1).")
+    parser.add_argument("--search", action="store_true",
+                        help="Latency-constrained architecture search over the --search-* grid "
+                             "instead of one training run.")
+    parser.add_argument("--search-d", default="16,32,48", help="Model widths D to try.")
+    parser.add_argument("--search-ffn", default="32,64,96", help="FFN widths to try.")
+    parser.add_argument("--search-heads", default="1,2", help="Head counts to try.")
+    parser.add_argument("--search-s", default="16,8", help="Token counts S to try (divisors of 16).")
+    parser.add_argument("--search-bits", default="8,4", help="Weight widths to try (8 or 4).")
+    parser.add_argument("--search-epochs", type=int, default=3, help="Epochs per candidate.")
+    parser.add_argument("--search-backend", default="auto",
+                        help="Backends the cost model plans with (tools/cost_model.py --backends).")
+    parser.add_argument("--search-calib", default=None,
+                        help="Calibrated costs JSON of tools/cost_model.py calibrate --out.")
+    parser.add_argument("--latency-budget", type=float, default=None,
+                        help="Cycle budget per window: print the most accurate candidate within it.")
+    parser.add_argument("--cpu-mhz", type=float, default=100.0,
+                        help="CPU clock for the us column of the search (0: cycles only).")
+    args = parser.parse_args()
+    if args.batch_size < 1:
+        parser.error("--batch-size must be positive")
+    if args.search:
+        if args.qat or args.layers != 1 or args.token_pool or args.share_layers:
+            parser.error("--search trains single-layer float models: no --qat, --layers, "
+                         "--token-pool or --share-layers")
+
+        def ints(v):
+            return [int(x) for x in v.split(",")]
+
+        bits = ints(args.search_bits)
+        if any(b not in (4, 8) for b in bits):
+            parser.error("--search-bits takes 8 and / or 4")
+        search_models(ints(args.search_d), ints(args.search_ffn), ints(args.search_heads),
+                      ints(args.search_s), bits, args.search_epochs, args.search_backend,
+                      args.search_calib, args.latency_budget, args.cpu_mhz,
+                      linear_attn=args.linear_attn, batch_size=args.batch_size, amp=args.amp)
+        sys.exit(0)
+    distill = args.distill.split(",") if args.distill else None
+    if distill and any(t not in TIERS or t == "large" for t in distill):
+        parser.error("--distill takes medium and / or small (the large tier is the teacher)")
+    if not 0.0 <= args.distill_alpha <= 1.0 or args.distill_temp <= 0:
+        parser.error("--distill-alpha must be in [0, 1] and --distill-temp positive")
+    if args.share_bias and not args.share_layers:
+        parser.error("--share-bias needs --share-layers")
+    token_pool = [int(k) for k in args.token_pool.split(",")] if args.token_pool else None
+    if token_pool is not None and (len(token_pool) != args.layers or min(token_pool) < 1):
+        parser.error("--token-pool needs one stride >= 1 per layer (--layers)")
+    train_model(qat=args.qat, heads=args.heads, linear_attn=args.linear_attn,
+                layers=args.layers, token_pool=token_pool, share_layers=args.share_layers,
+                share_bias=args.share_bias, distill=distill, distill_epochs=args.distill_epochs,
+                distill_temp=args.distill_temp, distill_alpha=args.distill_alpha,
+                batch_size=args.batch_size, amp=args.amp)
 